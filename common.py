@@ -35,6 +35,8 @@ def get_sources(env, is_editor_build, include_tests):
         "streams/*.cpp",
         "streams/sqlite/*.cpp",
         "streams/region/*.cpp",
+        "streams/log/*.cpp",
+        "streams/remote/*.cpp",
         "streams/vox/*.cpp",
 
         "storage/*.cpp",
@@ -42,6 +44,8 @@ def get_sources(env, is_editor_build, include_tests):
 
         "generators/*.cpp",
         "generators/graph/*.cpp",
+        # Other files of this folder are compiled with specific instruction sets
+        "generators/graph/simd/graph_kernels.cpp",
         "generators/simple/*.cpp",
         "generators/multipass/*.cpp",
 
@@ -73,8 +77,6 @@ def get_sources(env, is_editor_build, include_tests):
         "util/noise/spot_noise_gd.cpp",
         "util/string/*.cpp",
         "util/thread/thread.cpp",
-        "util/thread/spatial_lock_2d.cpp",
-        "util/thread/spatial_lock_3d.cpp",
         "util/tasks/*.cpp",
         "util/tasks/godot/*.cpp",
 
@@ -99,6 +101,7 @@ def get_sources(env, is_editor_build, include_tests):
         "util/godot/core/rect2i.cpp",
 
         "util/godot/direct_mesh_instance.cpp",
+        "util/godot/direct_mesh_instance_pool.cpp",
         "util/godot/direct_multimesh_instance.cpp",
         "util/godot/direct_static_body.cpp",
         "util/godot/file_utils.cpp",
@@ -17,6 +17,9 @@ def configure(env):
 
     env_vars.Add(BoolVariable("tracy", "Build with enabled Tracy Profiler integration", False))
 
+    env_vars.Add(BoolVariable("voxel_light_profiler",
+        "Build with the built-in light profiler, which is off by default at runtime", True))
+
     env_vars.Update(env)
     Help(env_vars.GenerateHelpText(env))
 
@@ -68,6 +71,7 @@ def get_doc_classes():
         "VoxelInstancer",
         "VoxelInstancerRigidBody",
         "VoxelLodTerrain",
+        "VoxelLodTerrainMultiplayerSynchronizer",
         "VoxelMesher",
         "VoxelMesherBlocky",
         "VoxelMesherCubes",
@@ -77,11 +81,16 @@ def get_doc_classes():
         "VoxelModifierMesh",
         "VoxelModifierSphere",
         "VoxelNode",
+        "VoxelPreGenerationJob",
+        "VoxelStreamCopyJob",
         "VoxelRaycastResult",
         "VoxelSaveCompletionTracker",
         "VoxelStream",
+        "VoxelStreamLog",
         "VoxelStreamMemory",
+        "VoxelStreamMemoryCache",
         "VoxelStreamRegionFiles",
+        "VoxelStreamRemote",
         "VoxelStreamScript",
         "VoxelStreamSQLite",
         "VoxelTerrain",
@@ -64,8 +64,25 @@ static const uint8_t TASK_PRIORITY_GENERATE_BAND2 = 10;
 static const uint8_t TASK_PRIORITY_LOAD_BAND2 = 10;
 static const uint8_t TASK_PRIORITY_SAVE_BAND2 = 9;
 static const uint8_t TASK_PRIORITY_DETAIL_TEXTURES_BAND2 = 8; // After meshes
+static const uint8_t TASK_PRIORITY_MESH_CLUSTER_BAND2 = 7; // After detail textures
+static const uint8_t TASK_PRIORITY_COMPRESS_COLD_BLOCKS_BAND2 = 6; // After mesh clusters
+static const uint8_t TASK_PRIORITY_BLOCKY_LIGHT_BAND2 = 10; // Changed light leads to meshing again
+static const uint8_t TASK_PRIORITY_BLOCKY_SIMULATION_BAND2 = 10; // Changed voxels lead to meshing again
 
 static const uint8_t TASK_PRIORITY_BAND3_DEFAULT = 10;
+// Used by meshing of blocks that were edited, so players see the result of their actions before streaming work
+static const uint8_t TASK_PRIORITY_BAND3_EDIT = 11;
+
+// Types of tasks for which the engine records latency statistics
+enum TaskLatencyCategory {
+	TASK_LATENCY_GENERATE = 0,
+	TASK_LATENCY_MESH,
+	TASK_LATENCY_LOAD,
+	TASK_LATENCY_SAVE,
+	TASK_LATENCY_DETAIL_TEXTURE,
+	TASK_LATENCY_GPU,
+	TASK_LATENCY_CATEGORY_COUNT
+};
 
 } // namespace zylann::voxel::constants
 
@@ -34,6 +34,8 @@ VoxelStringNames::VoxelStringNames() {
 	mesh_block_entered = StringName("mesh_block_entered");
 	mesh_block_exited = StringName("mesh_block_exited");
 
+	async_edits_completed = StringName("async_edits_completed");
+
 	store_colors_in_texture = StringName("store_colors_in_texture");
 	scale = StringName("scale");
 	enable_baked_lighting = StringName("enable_baked_lighting");
@@ -45,6 +47,7 @@ VoxelStringNames::VoxelStringNames() {
 
 	voxel_normalmap_atlas = StringName("voxel_normalmap_atlas");
 	voxel_normalmap_lookup = StringName("voxel_normalmap_lookup");
+	voxel_occluder_boxes = StringName("voxel_occluder_boxes");
 
 	u_voxel_normalmap_atlas = StringName("u_voxel_normalmap_atlas");
 	u_voxel_cell_lookup = StringName("u_voxel_cell_lookup");
@@ -83,6 +86,8 @@ VoxelStringNames::VoxelStringNames() {
 
 	_rpc_receive_blocks = StringName("_rpc_receive_blocks");
 	_rpc_receive_area = StringName("_rpc_receive_area");
+	_rpc_receive_block_hashes = StringName("_rpc_receive_block_hashes");
+	_rpc_request_blocks = StringName("_rpc_request_blocks");
 
 	unnamed = StringName("unnamed");
 	air = StringName("air");
@@ -29,6 +29,8 @@ public:
 	StringName mesh_block_entered;
 	StringName mesh_block_exited;
 
+	StringName async_edits_completed;
+
 	StringName store_colors_in_texture;
 	StringName scale;
 	StringName enable_baked_lighting;
@@ -40,6 +42,7 @@ public:
 
 	StringName voxel_normalmap_atlas;
 	StringName voxel_normalmap_lookup;
+	StringName voxel_occluder_boxes;
 
 	StringName u_voxel_normalmap_atlas;
 	StringName u_voxel_cell_lookup;
@@ -79,6 +82,8 @@ public:
 
 	StringName _rpc_receive_blocks;
 	StringName _rpc_receive_area;
+	StringName _rpc_receive_block_hashes;
+	StringName _rpc_request_blocks;
 
 	StringName unnamed;
 	StringName air;
@@ -0,0 +1,327 @@
+#include "connectivity_cache.h"
+#include "../storage/voxel_buffer.h"
+#include "../storage/voxel_data.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+uint32_t find_root(Span<uint32_t> parents, uint32_t i) {
+	while (parents[i] != i) {
+		// Path halving
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+	return i;
+}
+
+void unite(Span<uint32_t> parents, uint32_t a, uint32_t b) {
+	a = find_root(parents, a);
+	b = find_root(parents, b);
+	// The lowest label wins, so roots are stable
+	if (a < b) {
+		parents[b] = a;
+	} else if (b < a) {
+		parents[a] = b;
+	}
+}
+
+} // namespace
+
+void ConnectivityCache::invalidate_area(Box3i voxel_box) {
+	if (_blocks.size() == 0) {
+		return;
+	}
+	const Box3i blocks_box = voxel_box.downscaled(1 << _block_size_po2);
+	if (Vector3iUtil::get_volume(blocks_box.size) > static_cast<int64_t>(_blocks.size())) {
+		for (auto it = _blocks.begin(); it != _blocks.end();) {
+			if (blocks_box.contains(it->first)) {
+				it = _blocks.erase(it);
+			} else {
+				++it;
+			}
+		}
+	} else {
+		blocks_box.for_each_cell_zxy([this](Vector3i bpos) { _blocks.erase(bpos); });
+	}
+}
+
+void ConnectivityCache::clear() {
+	_blocks.clear();
+}
+
+void ConnectivityCache::compute_block_labels(const VoxelBuffer &voxels, BlockLabels &out_labels) {
+	ZN_PROFILE_SCOPE();
+
+	const Vector3i size = voxels.get_size();
+	const unsigned int volume = Vector3iUtil::get_volume(size);
+	// Temporary labels can't exceed half of the volume, but they have to fit in 16 bits
+	ZN_ASSERT(volume / 2 < 0xffff);
+
+	out_labels.labels.resize(volume);
+	Span<uint16_t> labels = to_span(out_labels.labels);
+
+	static thread_local StdVector<uint32_t> tls_parents;
+	tls_parents.clear();
+	// Label 0 is empty
+	tls_parents.push_back(0);
+
+	const unsigned int x_stride = size.y;
+	const unsigned int z_stride = size.x * size.y;
+
+	// First pass: give temporary labels and record which ones touch
+	Vector3i pos;
+	for (pos.z = 0; pos.z < size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < size.x; ++pos.x) {
+			pos.y = 0;
+			unsigned int i = Vector3iUtil::get_zxy_index(pos, size);
+
+			for (; pos.y < size.y; ++pos.y, ++i) {
+				if (voxels.get_voxel_f(pos.x, pos.y, pos.z, VoxelBuffer::CHANNEL_SDF) >= 0.f) {
+					labels[i] = 0;
+					continue;
+				}
+
+				uint32_t label = 0;
+				const uint16_t neighbor_labels[3] = {
+					pos.y > 0 ? labels[i - 1] : uint16_t(0),
+					pos.x > 0 ? labels[i - x_stride] : uint16_t(0),
+					pos.z > 0 ? labels[i - z_stride] : uint16_t(0),
+				};
+				for (const uint16_t neighbor_label : neighbor_labels) {
+					if (neighbor_label == 0) {
+						continue;
+					}
+					if (label == 0) {
+						label = neighbor_label;
+					} else {
+						unite(to_span(tls_parents), label, neighbor_label);
+					}
+				}
+
+				if (label == 0) {
+					label = tls_parents.size();
+					tls_parents.push_back(label);
+				}
+
+				labels[i] = label;
+			}
+		}
+	}
+
+	// Second pass: replace temporary labels with consecutive ones
+	static thread_local StdVector<uint16_t> tls_remap;
+	tls_remap.clear();
+	tls_remap.resize(tls_parents.size(), 0);
+	uint16_t count = 0;
+
+	for (uint16_t &label : labels) {
+		if (label == 0) {
+			continue;
+		}
+		const uint32_t root = find_root(to_span(tls_parents), label);
+		uint16_t &remapped = tls_remap[root];
+		if (remapped == 0) {
+			++count;
+			remapped = count;
+		}
+		label = remapped;
+	}
+
+	out_labels.count = count;
+}
+
+bool ConnectivityCache::label_area(
+		const VoxelData &data,
+		Box3i voxel_box,
+		Span<uint8_t> output,
+		unsigned int &out_label_count
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(output.size() == static_cast<size_t>(Vector3iUtil::get_volume(voxel_box.size)), false);
+
+	const unsigned int block_size_po2 = data.get_block_size_po2();
+	if (block_size_po2 != _block_size_po2) {
+		_blocks.clear();
+		_block_size_po2 = block_size_po2;
+	}
+
+	const int block_size = 1 << block_size_po2;
+	const int block_size_mask = block_size - 1;
+	const Vector3i block_size_v = Vector3iUtil::create(block_size);
+	const Box3i blocks_box = voxel_box.downscaled(block_size);
+	const unsigned int block_count = Vector3iUtil::get_volume(blocks_box.size);
+
+	// Get labels of each block, computing those that were edited or never queried
+
+	StdVector<const BlockLabels *> block_labels;
+	block_labels.resize(block_count, nullptr);
+	// Offset to add to labels of each block so they are unique across the area
+	StdVector<uint32_t> label_offsets;
+	label_offsets.resize(block_count, 0);
+	// Labels that can't be cached. Reserved so pointers remain valid.
+	StdVector<BlockLabels> uncached_labels;
+	uncached_labels.reserve(block_count);
+
+	uint32_t total_label_count = 0;
+	{
+		ZN_PROFILE_SCOPE_NAMED("Block labels");
+
+		VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_POOL);
+
+		unsigned int block_index = 0;
+		Vector3i bpos;
+		for (bpos.z = 0; bpos.z < blocks_box.size.z; ++bpos.z) {
+			for (bpos.x = 0; bpos.x < blocks_box.size.x; ++bpos.x) {
+				for (bpos.y = 0; bpos.y < blocks_box.size.y; ++bpos.y, ++block_index) {
+					const Vector3i block_pos = blocks_box.position + bpos;
+					const BlockLabels *labels = nullptr;
+
+					auto it = _blocks.find(block_pos);
+					if (it != _blocks.end()) {
+						labels = &it->second;
+
+					} else {
+						voxels.create(block_size_v);
+						data.copy(block_pos << block_size_po2, voxels, 1 << VoxelBuffer::CHANNEL_SDF);
+
+						BlockLabels new_labels;
+						compute_block_labels(voxels, new_labels);
+
+						// When streaming, areas that are not loaded yet fallback on the generator, but they might
+						// turn out to be different once loaded
+						if (!data.is_streaming_enabled() || data.has_block(block_pos, 0)) {
+							BlockLabels &cached_labels = _blocks[block_pos];
+							cached_labels = std::move(new_labels);
+							labels = &cached_labels;
+						} else {
+							uncached_labels.push_back(std::move(new_labels));
+							labels = &uncached_labels.back();
+						}
+					}
+
+					block_labels[block_index] = labels;
+					label_offsets[block_index] = total_label_count;
+					total_label_count += labels->count;
+				}
+			}
+		}
+	}
+
+	// Join labels of neighbor blocks where their faces touch
+
+	static thread_local StdVector<uint32_t> tls_parents;
+	tls_parents.resize(total_label_count + 1);
+	for (uint32_t i = 0; i < tls_parents.size(); ++i) {
+		tls_parents[i] = i;
+	}
+	Span<uint32_t> parents = to_span(tls_parents);
+
+	{
+		ZN_PROFILE_SCOPE_NAMED("Block borders");
+
+		// Index offsets to the next block along each axis
+		const unsigned int block_strides[3] = {
+			static_cast<unsigned int>(blocks_box.size.y), // X
+			1, // Y
+			static_cast<unsigned int>(blocks_box.size.x * blocks_box.size.y) // Z
+		};
+
+		unsigned int block_index = 0;
+		Vector3i bpos;
+		for (bpos.z = 0; bpos.z < blocks_box.size.z; ++bpos.z) {
+			for (bpos.x = 0; bpos.x < blocks_box.size.x; ++bpos.x) {
+				for (bpos.y = 0; bpos.y < blocks_box.size.y; ++bpos.y, ++block_index) {
+					const BlockLabels &labels = *block_labels[block_index];
+					if (labels.count == 0) {
+						continue;
+					}
+					const uint32_t offset = label_offsets[block_index];
+
+					for (unsigned int axis = 0; axis < 3; ++axis) {
+						if (bpos[axis] + 1 >= blocks_box.size[axis]) {
+							continue;
+						}
+						const unsigned int next_block_index = block_index + block_strides[axis];
+						const BlockLabels &next_labels = *block_labels[next_block_index];
+						if (next_labels.count == 0) {
+							continue;
+						}
+						const uint32_t next_offset = label_offsets[next_block_index];
+
+						// Visit the face of the current block and the opposite face of the next one
+						Vector3i pos;
+						const unsigned int u_axis = (axis + 1) % 3;
+						const unsigned int v_axis = (axis + 2) % 3;
+						for (pos[u_axis] = 0; pos[u_axis] < block_size; ++pos[u_axis]) {
+							for (pos[v_axis] = 0; pos[v_axis] < block_size; ++pos[v_axis]) {
+								pos[axis] = block_size - 1;
+								const uint16_t label = labels.labels[Vector3iUtil::get_zxy_index(pos, block_size_v)];
+								if (label == 0) {
+									continue;
+								}
+								pos[axis] = 0;
+								const uint16_t next_label =
+										next_labels.labels[Vector3iUtil::get_zxy_index(pos, block_size_v)];
+								if (next_label == 0) {
+									continue;
+								}
+								unite(parents, offset + label, next_offset + next_label);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Write labels of the area, made consecutive
+
+	static thread_local StdVector<uint8_t> tls_remap;
+	tls_remap.clear();
+	tls_remap.resize(tls_parents.size(), 0);
+	unsigned int label_count = 0;
+
+	{
+		ZN_PROFILE_SCOPE_NAMED("Output");
+
+		unsigned int output_index = 0;
+		Vector3i rpos;
+		for (rpos.z = 0; rpos.z < voxel_box.size.z; ++rpos.z) {
+			for (rpos.x = 0; rpos.x < voxel_box.size.x; ++rpos.x) {
+				for (rpos.y = 0; rpos.y < voxel_box.size.y; ++rpos.y, ++output_index) {
+					const Vector3i pos = voxel_box.position + rpos;
+					const Vector3i bpos = (pos >> block_size_po2) - blocks_box.position;
+					const unsigned int block_index = Vector3iUtil::get_zxy_index(bpos, blocks_box.size);
+					const Vector3i local_pos(
+							pos.x & block_size_mask, pos.y & block_size_mask, pos.z & block_size_mask
+					);
+
+					const uint16_t label =
+							block_labels[block_index]->labels[Vector3iUtil::get_zxy_index(local_pos, block_size_v)];
+					if (label == 0) {
+						output[output_index] = 0;
+						continue;
+					}
+
+					const uint32_t root = find_root(parents, label_offsets[block_index] + label);
+					uint8_t &remapped = tls_remap[root];
+					if (remapped == 0) {
+						if (label_count == MAX_LABELS) {
+							return false;
+						}
+						++label_count;
+						remapped = label_count;
+					}
+					output[output_index] = remapped;
+				}
+			}
+		}
+	}
+
+	out_label_count = label_count;
+	return true;
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,52 @@
+#ifndef VOXEL_CONNECTIVITY_CACHE_H
+#define VOXEL_CONNECTIVITY_CACHE_H
+
+#include "../util/containers/span.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+
+namespace zylann::voxel {
+
+class VoxelBuffer;
+class VoxelData;
+
+// Remembers which solid voxels are connected to each other within each data block of LOD0, so that finding groups of
+// connected voxels in an area only has to label again the blocks that were edited since the last query. Groups of
+// neighbor blocks are then joined with union-find, which is cheap compared to scanning voxels.
+// Voxels are considered solid where their SDF is negative. Connectivity is 6-way, like `IslandFinder`.
+// Must be used from the main thread.
+class ConnectivityCache {
+public:
+	// Output labels are 8-bit, and 0 is reserved for empty voxels
+	static const unsigned int MAX_LABELS = 255;
+
+	// Forgets labels of blocks intersecting the given area. Must be called when voxels are modified.
+	void invalidate_area(Box3i voxel_box);
+	void clear();
+
+	// Labels solid voxels of an area by connected group, with labels starting from 1. Empty voxels get 0.
+	// Groups touching each other outside of the area may share the same label.
+	// Returns false if there are more than `MAX_LABELS` groups.
+	bool label_area(const VoxelData &data, Box3i voxel_box, Span<uint8_t> output, unsigned int &out_label_count);
+
+	unsigned int get_cached_block_count() const {
+		return _blocks.size();
+	}
+
+private:
+	struct BlockLabels {
+		// One label per voxel in ZXY order, starting from 1. Empty voxels have label 0.
+		StdVector<uint16_t> labels;
+		uint16_t count = 0;
+	};
+
+	static void compute_block_labels(const VoxelBuffer &voxels, BlockLabels &out_labels);
+
+	StdUnorderedMap<Vector3i, BlockLabels> _blocks;
+	unsigned int _block_size_po2 = 0;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_CONNECTIVITY_CACHE_H
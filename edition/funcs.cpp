@@ -4,9 +4,11 @@
 #include "../util/containers/dynamic_bitset.h"
 #include "../util/containers/span.h"
 #include "../util/containers/std_vector.h"
+#include "../util/godot/core/packed_arrays.h"
 #include "../util/godot/core/random_pcg.h"
 #include "../util/profiling.h"
 #include "../util/string/format.h"
+#include "random_tick_index.h"
 
 #ifdef ZN_GODOT_EXTENSION
 using namespace godot;
@@ -133,6 +135,7 @@ void run_blocky_random_tick(
 		RandomPCG &random,
 		int voxel_count,
 		int batch_count,
+		RandomTickIndex *index,
 		void *callback_data,
 		bool (*callback)(void *, Vector3i, int64_t)
 ) {
@@ -147,7 +150,6 @@ void run_blocky_random_tick(
 	const Box3i block_box = voxel_box.downscaled(block_size);
 
 	const int block_count = voxel_count / batch_count;
-	// const int bs_mask = map.get_block_size_mask();
 	const VoxelBuffer::ChannelId channel = VoxelBuffer::CHANNEL_TYPE;
 
 	struct Pick {
@@ -157,8 +159,14 @@ void run_blocky_random_tick(
 	static thread_local StdVector<Pick> picks;
 	picks.reserve(batch_count);
 
+	// Tickable voxels of the current block, used when there is no index
+	static thread_local StdVector<uint16_t> tls_block_candidates;
+	// Tickable voxels of the current block that are inside the area
+	static thread_local StdVector<uint16_t> tls_area_candidates;
+
 	const float block_volume = math::cubed(block_size);
 	CRASH_COND(block_volume < 0.1f);
+	const Vector3i block_size_v = Vector3iUtil::create(block_size);
 
 	struct L {
 		static inline int urand(RandomPCG &random, uint32_t max_value) {
@@ -192,27 +200,51 @@ void run_blocky_random_tick(
 				// Doing ONLY reads here.
 				const VoxelBuffer &voxels = *voxels_ptr;
 
-				if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_UNIFORM) {
-					const uint64_t v = voxels.get_voxel(0, 0, 0, channel);
-					if (lib_data.has_model(v)) {
-						const VoxelBlockyModel::BakedData &vt = lib_data.models[v];
-						if (vt.is_random_tickable) {
-							// Skip whole block
-							continue;
-						}
-					}
+				// Only tickable voxels are sampled, most of the time they are a small part of the block
+				Span<const uint16_t> block_candidates;
+				if (index != nullptr) {
+					block_candidates =
+							index->get_block_candidates(block_pos, data.get_block_size_po2(), voxels_ptr, lib_data);
+				} else {
+					tls_block_candidates.clear();
+					RandomTickIndex::find_candidates(voxels, lib_data, tls_block_candidates);
+					block_candidates = to_span_const(tls_block_candidates);
+				}
+
+				if (block_candidates.size() == 0) {
+					continue;
 				}
 
-				const Box3i block_voxel_box(block_origin, Vector3iUtil::create(block_size));
+				const Box3i block_voxel_box(block_origin, block_size_v);
 				Box3i local_voxel_box = voxel_box.clipped(block_voxel_box);
 				local_voxel_box.position -= block_origin;
-				const float volume_ratio = Vector3iUtil::get_volume(local_voxel_box.size) / block_volume;
+
+				Span<const uint16_t> candidates = block_candidates;
+				if (local_voxel_box.size != block_size_v) {
+					tls_area_candidates.clear();
+					for (const uint16_t i : block_candidates) {
+						if (local_voxel_box.contains(Vector3iUtil::from_zxy_index(i, block_size_v))) {
+							tls_area_candidates.push_back(i);
+						}
+					}
+					candidates = to_span_const(tls_area_candidates);
+				}
+
+				const unsigned int local_volume = Vector3iUtil::get_volume(local_voxel_box.size);
+				const float volume_ratio = local_volume / block_volume;
 				const int local_batch_count = Math::ceil(batch_count * volume_ratio);
 
 				// Choose a bunch of voxels at random within the block.
 				// Batching this way improves performance a little by reducing block lookups.
+				// Picking a random voxel of the area and keeping it only if it is tickable is the same as picking a
+				// random number in the volume and keeping it only if it falls on a candidate. So voxels tick just as
+				// often as if all voxels were sampled.
 				for (int vi = 0; vi < local_batch_count; ++vi) {
-					const Vector3i rpos = local_voxel_box.position + L::urand_vec3i(random, local_voxel_box.size);
+					const unsigned int i = L::urand(random, local_volume);
+					if (i >= candidates.size()) {
+						continue;
+					}
+					const Vector3i rpos = Vector3iUtil::from_zxy_index(candidates[i], block_size_v);
 
 					const uint64_t v = voxels.get_voxel(rpos, channel);
 					picks.push_back(Pick{ v, rpos });
@@ -244,15 +276,59 @@ void run_blocky_random_tick(
 		RandomPCG &random,
 		int voxel_count,
 		int batch_count,
-		const Callable &callback
+		RandomTickIndex *index,
+		const Callable &callback,
+		bool batched_callback
 ) {
+	const Box3i voxel_box(math::floor_to_int(voxel_box_f.position), math::floor_to_int(voxel_box_f.size));
+
+	if (batched_callback) {
+		// Calling into scripts is expensive, so all picks are passed at once
+		struct CallbackData {
+			PackedVector3Array positions;
+			PackedInt64Array values;
+		};
+		CallbackData cb_self;
+
+		zylann::voxel::run_blocky_random_tick(
+				data,
+				voxel_box,
+				lib,
+				random,
+				voxel_count,
+				batch_count,
+				index,
+				&cb_self,
+				[](void *self, Vector3i pos, int64_t val) {
+					CallbackData *cd = reinterpret_cast<CallbackData *>(self);
+					cd->positions.push_back(Vector3(pos));
+					cd->values.push_back(val);
+					return true;
+				}
+		);
+
+		if (cb_self.positions.size() == 0) {
+			return;
+		}
+#ifdef ZN_GODOT
+		const Variant vpositions = cb_self.positions;
+		const Variant vvalues = cb_self.values;
+		const Variant *args[2] = { &vpositions, &vvalues };
+		Callable::CallError error;
+		Variant retval; // We don't care about the return value, Callable API requires it
+		callback.callp(args, 2, retval, error);
+		ERR_FAIL_COND(error.error != Callable::CallError::CALL_OK);
+#elif ZN_GODOT_EXTENSION
+		callback.call(cb_self.positions, cb_self.values);
+#endif
+		return;
+	}
+
 	struct CallbackData {
 		const Callable &callable;
 	};
 	CallbackData cb_self{ callback };
 
-	const Box3i voxel_box(math::floor_to_int(voxel_box_f.position), math::floor_to_int(voxel_box_f.size));
-
 	zylann::voxel::run_blocky_random_tick(
 			data,
 			voxel_box,
@@ -260,6 +336,7 @@ void run_blocky_random_tick(
 			random,
 			voxel_count,
 			batch_count,
+			index,
 			&cb_self,
 			[](void *self, Vector3i pos, int64_t val) {
 				const CallbackData *cd = reinterpret_cast<const CallbackData *>(self);
@@ -220,6 +220,7 @@ AABB get_path_aabb(Span<const Vector3> positions, Span<const float> radii);
 
 class VoxelData;
 class VoxelBlockyLibraryBase;
+class RandomTickIndex;
 
 // For easier unit testing (the regular one needs a terrain setup etc, harder to test atm)
 // The `_static` suffix is because it otherwise conflicts with the non-static method when registering the class
@@ -230,6 +231,8 @@ void run_blocky_random_tick(
 		RandomPCG &random,
 		int voxel_count,
 		int batch_count,
+		// Optional, speeds up repeated ticks by remembering where tickable voxels are
+		RandomTickIndex *index,
 		void *callback_data,
 		bool (*callback)(void *, Vector3i, int64_t)
 );
@@ -241,7 +244,10 @@ void run_blocky_random_tick(
 		RandomPCG &random,
 		int voxel_count,
 		int batch_count,
-		const Callable &callback
+		RandomTickIndex *index,
+		const Callable &callback,
+		// If true, the callback is called once with all picked positions and values in packed arrays
+		bool batched_callback
 );
 
 } // namespace zylann::voxel
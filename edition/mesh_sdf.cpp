@@ -1,4 +1,5 @@
 #include "mesh_sdf.h"
+#include "../util/containers/fixed_array.h"
 #include "../util/math/box3i.h"
 #include "../util/math/conv.h"
 #include "../util/math/triangle.h"
@@ -7,6 +8,8 @@
 #include "../util/string/format.h" // Debug
 #include "../util/voxel_raycast.h"
 
+#include <algorithm>
+
 // Debug
 // #define ZN_MESH_SDF_DEBUG_SLICES
 #ifdef ZN_MESH_SDF_DEBUG_SLICES
@@ -743,6 +746,181 @@ float get_mesh_signed_distance_at(const Vector3f pos, const ChunkGrid &chunk_gri
 	return -d;
 }
 
+// Small leaves prune more triangles, but make the tree deeper
+static const unsigned int BVH_MAX_TRIANGLES_PER_LEAF = 4;
+
+void build_triangle_bvh(Span<const Triangle> triangles, TriangleBVH &bvh) {
+	ZN_PROFILE_SCOPE();
+
+	bvh.nodes.clear();
+	bvh.triangles.clear();
+
+	if (triangles.size() == 0) {
+		return;
+	}
+
+	struct Item {
+		Vector3f centroid;
+		uint32_t triangle_index;
+	};
+
+	StdVector<Item> items;
+	items.resize(triangles.size());
+	for (unsigned int i = 0; i < triangles.size(); ++i) {
+		const Triangle &t = triangles[i];
+		items[i].centroid = (t.v1 + t.v2 + t.v3) / 3.f;
+		items[i].triangle_index = i;
+	}
+
+	struct Range {
+		uint32_t node_index;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	StdVector<Range> ranges_to_split;
+	ranges_to_split.push_back(Range{ 0, 0, static_cast<uint32_t>(items.size()) });
+	bvh.nodes.resize(1);
+
+	while (ranges_to_split.size() > 0) {
+		const Range range = ranges_to_split.back();
+		ranges_to_split.pop_back();
+
+		const Triangle &first_triangle = triangles[items[range.begin].triangle_index];
+		Vector3f min_pos = first_triangle.v1;
+		Vector3f max_pos = first_triangle.v1;
+		Vector3f centroids_min_pos = items[range.begin].centroid;
+		Vector3f centroids_max_pos = items[range.begin].centroid;
+
+		for (unsigned int i = range.begin; i < range.end; ++i) {
+			const Item &item = items[i];
+			const Triangle &t = triangles[item.triangle_index];
+			min_pos = math::min(min_pos, math::min(t.v1, math::min(t.v2, t.v3)));
+			max_pos = math::max(max_pos, math::max(t.v1, math::max(t.v2, t.v3)));
+			centroids_min_pos = math::min(centroids_min_pos, item.centroid);
+			centroids_max_pos = math::max(centroids_max_pos, item.centroid);
+		}
+
+		TriangleBVH::Node &node = bvh.nodes[range.node_index];
+		node.min_pos = min_pos;
+		node.max_pos = max_pos;
+
+		const uint32_t count = range.end - range.begin;
+		if (count <= BVH_MAX_TRIANGLES_PER_LEAF) {
+			node.first = range.begin;
+			node.count = count;
+			continue;
+		}
+
+		// Split at the median along the axis where triangles are the most spread out. This keeps the tree balanced.
+		const unsigned int axis = math::get_longest_axis(centroids_max_pos - centroids_min_pos);
+		const uint32_t mid = range.begin + count / 2;
+		std::nth_element(
+				items.begin() + range.begin,
+				items.begin() + mid,
+				items.begin() + range.end,
+				[axis](const Item &a, const Item &b) { return a.centroid[axis] < b.centroid[axis]; }
+		);
+
+		const uint32_t first_child_index = bvh.nodes.size();
+		node.first = first_child_index;
+		node.count = 0;
+		// Note, this invalidates `node`
+		bvh.nodes.resize(first_child_index + 2);
+
+		ranges_to_split.push_back(Range{ first_child_index, range.begin, mid });
+		ranges_to_split.push_back(Range{ first_child_index + 1, mid, range.end });
+	}
+
+	// Store triangles in the order leaves reference them, so each leaf reads contiguous memory
+	bvh.triangles.resize(items.size());
+	for (unsigned int i = 0; i < items.size(); ++i) {
+		bvh.triangles[i] = triangles[items[i].triangle_index];
+	}
+}
+
+inline float get_distance_squared_to_box(const Vector3f p, const Vector3f min_pos, const Vector3f max_pos) {
+	return math::length_squared(math::max(math::max(min_pos - p, p - max_pos), Vector3f()));
+}
+
+// Finds the closest triangle that is closer than `max_distance_squared`. Returns null if there is none.
+const Triangle *get_closest_triangle(
+		const Vector3f pos,
+		const TriangleBVH &bvh,
+		float max_distance_squared,
+		float &out_distance_squared
+) {
+	// Median splits keep the tree balanced, so this is deep enough for any triangle count that fits in memory
+	FixedArray<uint32_t, 64> stack;
+	unsigned int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	const Triangle *closest_tri = nullptr;
+	float min_distance_squared = max_distance_squared;
+
+	while (stack_size > 0) {
+		const TriangleBVH::Node &node = bvh.nodes[stack[--stack_size]];
+
+		if (get_distance_squared_to_box(pos, node.min_pos, node.max_pos) >= min_distance_squared) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			const unsigned int end = node.first + node.count;
+			for (unsigned int i = node.first; i < end; ++i) {
+				const Triangle &t = bvh.triangles[i];
+				const float sqd = get_distance_to_triangle_squared_precalc(t, pos);
+				if (sqd < min_distance_squared) {
+					min_distance_squared = sqd;
+					closest_tri = &t;
+				}
+			}
+			continue;
+		}
+
+		ZN_ASSERT(stack_size + 2 <= stack.size());
+
+		const TriangleBVH::Node &child0 = bvh.nodes[node.first];
+		const TriangleBVH::Node &child1 = bvh.nodes[node.first + 1];
+		const float child0_sqd = get_distance_squared_to_box(pos, child0.min_pos, child0.max_pos);
+		const float child1_sqd = get_distance_squared_to_box(pos, child1.min_pos, child1.max_pos);
+
+		// Visit the closest child first, it is more likely to prune the other one
+		if (child0_sqd < child1_sqd) {
+			stack[stack_size++] = node.first + 1;
+			stack[stack_size++] = node.first;
+		} else {
+			stack[stack_size++] = node.first;
+			stack[stack_size++] = node.first + 1;
+		}
+	}
+
+	out_distance_squared = min_distance_squared;
+	return closest_tri;
+}
+
+// `max_distance` must be larger than the distance to the mesh. It is only used to prune the search.
+float get_mesh_signed_distance_at(const Vector3f pos, const TriangleBVH &bvh, float max_distance) {
+	float min_distance_squared;
+	const Triangle *closest_tri = get_closest_triangle(pos, bvh, math::squared(max_distance), min_distance_squared);
+
+	if (closest_tri == nullptr) {
+		// The hint was too small due to precision errors
+		closest_tri = get_closest_triangle(pos, bvh, 9999999.f, min_distance_squared);
+		ZN_ASSERT(closest_tri != nullptr);
+	}
+
+	const float d = Math::sqrt(min_distance_squared);
+
+	const Vector3f plane_normal = get_normal(*closest_tri);
+	const float plane_d = math::dot(plane_normal, closest_tri->v1);
+
+	if (math::dot(plane_normal, pos) > plane_d) {
+		return d;
+	}
+	return -d;
+}
+
 struct GridToSpaceConverter {
 	const Vector3i res;
 	const Vector3f min_pos;
@@ -1004,6 +1182,60 @@ void generate_mesh_sdf_partitioned(
 	generate_mesh_sdf_partitioned(sdf_grid, res, Box3i(Vector3i(), res), min_pos, max_pos, chunk_grid);
 }
 
+void generate_mesh_sdf_bvh(
+		Span<float> sdf_grid,
+		const Vector3i res,
+		const Box3i sub_box,
+		const Vector3f min_pos,
+		const Vector3f max_pos,
+		const TriangleBVH &bvh
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(Box3i(Vector3i(), res).contains(sub_box));
+	ZN_ASSERT(int64_t(sdf_grid.size()) == Vector3iUtil::get_volume(res));
+	ZN_ASSERT_RETURN(bvh.nodes.size() > 0);
+
+	const Vector3f mesh_size = max_pos - min_pos;
+	const Vector3f cell_size = mesh_size / Vector3f(res.x, res.y, res.z);
+	const GridToSpaceConverter grid_to_space(res, min_pos, mesh_size, cell_size * 0.5f);
+
+	const Vector3i sub_box_end = sub_box.position + sub_box.size;
+
+	Vector3i grid_pos;
+	for (grid_pos.z = sub_box.position.z; grid_pos.z < sub_box_end.z; ++grid_pos.z) {
+		for (grid_pos.x = sub_box.position.x; grid_pos.x < sub_box_end.x; ++grid_pos.x) {
+			grid_pos.y = sub_box.position.y;
+			size_t grid_index = Vector3iUtil::get_zxy_index(grid_pos, res);
+
+			// Distances can't change faster than the distance between two cells, so the distance at the previous cell
+			// bounds the search at the next one.
+			float max_distance = 9999999.f;
+
+			for (; grid_pos.y < sub_box_end.y; ++grid_pos.y) {
+				const float sd = get_mesh_signed_distance_at(grid_to_space(grid_pos), bvh, max_distance);
+
+				ZN_ASSERT(grid_index < sdf_grid.size());
+				sdf_grid[grid_index] = sd;
+
+				max_distance = (Math::abs(sd) + cell_size.y) * 1.001f;
+				++grid_index;
+			}
+		}
+	}
+}
+
+void generate_mesh_sdf_bvh(
+		Span<float> sdf_grid,
+		const Vector3i res,
+		Span<const Triangle> triangles,
+		const Vector3f min_pos,
+		const Vector3f max_pos
+) {
+	TriangleBVH bvh;
+	build_triangle_bvh(triangles, bvh);
+	generate_mesh_sdf_bvh(sdf_grid, res, Box3i(Vector3i(), res), min_pos, max_pos, bvh);
+}
+
 CheckResult check_sdf(
 		Span<const float> sdf_grid,
 		Vector3i res,
@@ -1173,7 +1405,11 @@ void GenMeshSDFSubBoxTask::run(ThreadedTaskContext &ctx) {
 	Span<float> sdf_grid;
 	ZN_ASSERT(buffer.get_channel_data(channel, sdf_grid));
 
-	if (shared_data->use_chunk_grid) {
+	if (shared_data->use_bvh) {
+		generate_mesh_sdf_bvh(
+				sdf_grid, buffer.get_size(), box, shared_data->min_pos, shared_data->max_pos, shared_data->bvh
+		);
+	} else if (shared_data->use_chunk_grid) {
 		generate_mesh_sdf_partitioned(
 				sdf_grid, buffer.get_size(), box, shared_data->min_pos, shared_data->max_pos, shared_data->chunk_grid
 		);
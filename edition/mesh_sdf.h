@@ -48,6 +48,24 @@ struct ChunkGrid {
 	float chunk_size; // Size of a cubic cell in space units
 };
 
+// Bounding volume hierarchy of triangles, used to find the closest triangle to a point without checking all of them.
+// Unlike `ChunkGrid`, results are exact.
+struct TriangleBVH {
+	struct Node {
+		Vector3f min_pos;
+		Vector3f max_pos;
+		// If the node is a leaf, index of its first triangle. Otherwise, index of its first child node. The second
+		// child node follows the first one.
+		uint32_t first;
+		// Number of triangles in a leaf. Zero if the node has children.
+		uint32_t count;
+	};
+
+	StdVector<Node> nodes;
+	// Copies of triangles, ordered so each leaf references a contiguous range
+	StdVector<Triangle> triangles;
+};
+
 class GenMeshSDFSubBoxTask : public IThreadedTask {
 public:
 	struct SharedData {
@@ -58,6 +76,8 @@ public:
 		Vector3f max_pos;
 		ChunkGrid chunk_grid;
 		bool use_chunk_grid = false;
+		TriangleBVH bvh;
+		bool use_bvh = false;
 		bool boundary_sign_fix = false;
 
 		SharedData() : buffer(VoxelBuffer::ALLOCATOR_DEFAULT) {}
@@ -100,6 +120,9 @@ void partition_triangles(
 // This is necessary for functions using ChunkGrid.
 void compute_near_chunks(ChunkGrid &chunk_grid);
 
+// Builds a bounding volume hierarchy from prepared triangles.
+void build_triangle_bvh(Span<const Triangle> triangles, TriangleBVH &bvh);
+
 // A naive method to get a sampled SDF from a mesh, by checking every triangle at every cell. It's accurate, but much
 // slower than other techniques, but could be used as a CPU-based alternative, for less
 // realtime-intensive tasks. The mesh must be closed, otherwise the SDF will contain errors.
@@ -123,6 +146,17 @@ void generate_mesh_sdf_partitioned(
 		int subdiv
 );
 
+// Computes the SDF with the same accuracy as the naive method, using a bounding volume hierarchy to only check
+// triangles close to each cell. Cells are evaluated in memory order, and the distance found for a cell bounds the
+// search of the next one, which prunes most of the tree.
+void generate_mesh_sdf_bvh(
+		Span<float> sdf_grid,
+		const Vector3i res,
+		Span<const Triangle> triangles,
+		const Vector3f min_pos,
+		const Vector3f max_pos
+);
+
 // Generates an approximation.
 // Subdivides the grid into nodes spanning 4*4*4 cells each.
 // If a node's corner distances are close to the surface, the SDF is fully evaluated. Otherwise, it is interpolated.
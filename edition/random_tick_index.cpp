@@ -0,0 +1,140 @@
+#include "random_tick_index.h"
+#include "../storage/voxel_buffer.h"
+#include "../storage/voxel_buffer_view.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+template <typename T>
+void find_tickable_indices(
+		const VoxelBuffer &voxels,
+		unsigned int channel,
+		Span<const uint8_t> tickable,
+		StdVector<uint16_t> &out_indices
+) {
+	VoxelBufferReadView<T> view;
+	ZN_ASSERT_RETURN(view.init(voxels, channel));
+	const unsigned int volume = view.get_volume();
+	for (unsigned int i = 0; i < volume; ++i) {
+		const T v = view.get(i);
+		if (v < tickable.size() && tickable[v] != 0) {
+			out_indices.push_back(i);
+		}
+	}
+}
+
+} // namespace
+
+void RandomTickIndex::invalidate_area(Box3i voxel_box) {
+	if (_blocks.size() == 0) {
+		return;
+	}
+	const Box3i blocks_box = voxel_box.downscaled(1 << _block_size_po2);
+	if (Vector3iUtil::get_volume(blocks_box.size) > static_cast<int64_t>(_blocks.size())) {
+		for (auto it = _blocks.begin(); it != _blocks.end();) {
+			if (blocks_box.contains(it->first)) {
+				it = _blocks.erase(it);
+			} else {
+				++it;
+			}
+		}
+	} else {
+		blocks_box.for_each_cell_zxy([this](Vector3i bpos) { _blocks.erase(bpos); });
+	}
+}
+
+void RandomTickIndex::clear() {
+	_blocks.clear();
+}
+
+void RandomTickIndex::prune_unloaded_blocks() {
+	ZN_PROFILE_SCOPE();
+	for (auto it = _blocks.begin(); it != _blocks.end();) {
+		if (it->second.voxels.expired()) {
+			it = _blocks.erase(it);
+		} else {
+			++it;
+		}
+	}
+	_prune_threshold = math::max(_prune_threshold, 2 * _blocks.size());
+}
+
+Span<const uint16_t> RandomTickIndex::get_block_candidates(
+		Vector3i block_position,
+		unsigned int block_size_po2,
+		const std::shared_ptr<VoxelBuffer> &voxels,
+		const VoxelBlockyLibraryBase::BakedData &lib_data
+) {
+	ZN_ASSERT_RETURN_V(voxels != nullptr, Span<const uint16_t>());
+
+	if (block_size_po2 != _block_size_po2) {
+		_blocks.clear();
+		_block_size_po2 = block_size_po2;
+	}
+
+	auto it = _blocks.find(block_position);
+	if (it != _blocks.end()) {
+		Block &block = it->second;
+		if (block.voxels.lock() == voxels && block.lib_data == &lib_data && block.lib_revision == lib_data.revision) {
+			return to_span_const(block.indices);
+		}
+	} else {
+		if (_blocks.size() >= _prune_threshold) {
+			prune_unloaded_blocks();
+		}
+		it = _blocks.insert({ block_position, Block() }).first;
+	}
+
+	Block &block = it->second;
+	block.voxels = voxels;
+	block.lib_data = &lib_data;
+	block.lib_revision = lib_data.revision;
+	block.indices.clear();
+	find_candidates(*voxels, lib_data, block.indices);
+	// Blocks are often entirely air or entirely made of inert voxels
+	block.indices.shrink_to_fit();
+
+	return to_span_const(block.indices);
+}
+
+void RandomTickIndex::find_candidates(
+		const VoxelBuffer &voxels,
+		const VoxelBlockyLibraryBase::BakedData &lib_data,
+		StdVector<uint16_t> &out_indices
+) {
+	ZN_PROFILE_SCOPE();
+
+	const VoxelBuffer::ChannelId channel = VoxelBuffer::CHANNEL_TYPE;
+	const unsigned int volume = Vector3iUtil::get_volume(voxels.get_size());
+	ZN_ASSERT_RETURN(volume <= 0x10000);
+
+	if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_UNIFORM) {
+		const uint64_t v = voxels.get_voxel(0, 0, 0, channel);
+		if (lib_data.has_model(v) && lib_data.models[v].is_random_tickable) {
+			out_indices.resize(volume);
+			for (unsigned int i = 0; i < volume; ++i) {
+				out_indices[i] = i;
+			}
+		}
+		return;
+	}
+
+	static thread_local StdVector<uint8_t> tls_tickable;
+	tls_tickable.resize(lib_data.models.size());
+	bool any_tickable = false;
+	for (unsigned int i = 0; i < lib_data.models.size(); ++i) {
+		tls_tickable[i] = lib_data.models[i].is_random_tickable;
+		any_tickable |= lib_data.models[i].is_random_tickable;
+	}
+	if (!any_tickable) {
+		return;
+	}
+
+	dispatch_depth(voxels.get_channel_depth(channel), [&voxels, channel, &out_indices](auto zero) {
+		find_tickable_indices<decltype(zero)>(voxels, channel, to_span_const(tls_tickable), out_indices);
+	});
+}
+
+} // namespace zylann::voxel
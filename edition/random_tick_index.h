@@ -0,0 +1,64 @@
+#ifndef VOXEL_RANDOM_TICK_INDEX_H
+#define VOXEL_RANDOM_TICK_INDEX_H
+
+#include "../meshers/blocky/voxel_blocky_library_base.h"
+#include "../util/containers/span.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+#include <memory>
+
+namespace zylann::voxel {
+
+class VoxelBuffer;
+
+// Remembers where random-tickable voxels are within each data block of LOD0, so random ticks only have to sample those
+// instead of reading lots of voxels that can't tick (air, stone...).
+// Entries are computed the first time a block is ticked, and computed again when the block gets edited, when its
+// voxels get replaced (loading, generation) or when the library is baked again.
+// Must be used from the main thread.
+class RandomTickIndex {
+public:
+	// Forgets blocks intersecting the given area. Must be called when voxels are modified.
+	void invalidate_area(Box3i voxel_box);
+	void clear();
+
+	// Gets ZXY indices of tickable voxels within a block, in increasing order.
+	// The caller must keep the block locked for reading while using them.
+	Span<const uint16_t> get_block_candidates(
+			Vector3i block_position,
+			unsigned int block_size_po2,
+			const std::shared_ptr<VoxelBuffer> &voxels,
+			const VoxelBlockyLibraryBase::BakedData &lib_data
+	);
+
+	unsigned int get_cached_block_count() const {
+		return _blocks.size();
+	}
+
+	static void find_candidates(
+			const VoxelBuffer &voxels,
+			const VoxelBlockyLibraryBase::BakedData &lib_data,
+			StdVector<uint16_t> &out_indices
+	);
+
+private:
+	void prune_unloaded_blocks();
+
+	struct Block {
+		// Used to detect when the block got loaded or generated again
+		std::weak_ptr<VoxelBuffer> voxels;
+		const VoxelBlockyLibraryBase::BakedData *lib_data = nullptr;
+		uint32_t lib_revision = 0;
+		StdVector<uint16_t> indices;
+	};
+
+	StdUnorderedMap<Vector3i, Block> _blocks;
+	unsigned int _block_size_po2 = 0;
+	// Blocks get unloaded without notifying the index, so it is cleaned up from time to time as it grows
+	size_t _prune_threshold = 256;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_RANDOM_TICK_INDEX_H
@@ -145,6 +145,9 @@ void VoxelMeshSDF::bake() {
 		case BAKE_MODE_APPROX_INTERP:
 			mesh_sdf::generate_mesh_sdf_approx_interp(sdf_grid, res, to_span(triangles), box_min_pos, box_max_pos);
 			break;
+		case BAKE_MODE_ACCURATE_BVH:
+			mesh_sdf::generate_mesh_sdf_bvh(sdf_grid, res, to_span(triangles), box_min_pos, box_max_pos);
+			break;
 		case BAKE_MODE_APPROX_FLOODFILL: {
 			mesh_sdf::ChunkGrid chunk_grid;
 			mesh_sdf::partition_triangles(_partition_subdiv, to_span(triangles), box_min_pos, box_max_pos, chunk_grid);
@@ -249,8 +252,9 @@ void VoxelMeshSDF::bake_async(SceneTree *scene_tree) {
 
 			switch (bake_mode) {
 				case BAKE_MODE_ACCURATE_NAIVE:
-				case BAKE_MODE_ACCURATE_PARTITIONED: {
-					// These two approaches are better parallelized
+				case BAKE_MODE_ACCURATE_PARTITIONED:
+				case BAKE_MODE_ACCURATE_BVH: {
+					// These approaches are better parallelized
 
 					const bool partitioned = bake_mode == BAKE_MODE_ACCURATE_PARTITIONED;
 					if (partitioned) {
@@ -265,6 +269,12 @@ void VoxelMeshSDF::bake_async(SceneTree *scene_tree) {
 					}
 					shared_data->use_chunk_grid = partitioned;
 
+					const bool use_bvh = bake_mode == BAKE_MODE_ACCURATE_BVH;
+					if (use_bvh) {
+						mesh_sdf::build_triangle_bvh(to_span(shared_data->triangles), shared_data->bvh);
+					}
+					shared_data->use_bvh = use_bvh;
+
 					shared_data->boundary_sign_fix = boundary_sign_fix;
 
 					// Spawn a parallel task for every Z slice of the grid.
@@ -559,7 +569,7 @@ void VoxelMeshSDF::_bind_methods() {
 					Variant::INT,
 					"bake_mode",
 					PROPERTY_HINT_ENUM,
-					"AccurateNaive,AccuratePartitioned,ApproxInterp,FloodFill"
+					"AccurateNaive,AccuratePartitioned,ApproxInterp,FloodFill,AccurateBVH"
 			),
 			"set_bake_mode",
 			"get_bake_mode"
@@ -595,6 +605,7 @@ void VoxelMeshSDF::_bind_methods() {
 	BIND_ENUM_CONSTANT(BAKE_MODE_ACCURATE_PARTITIONED);
 	BIND_ENUM_CONSTANT(BAKE_MODE_APPROX_INTERP);
 	BIND_ENUM_CONSTANT(BAKE_MODE_APPROX_FLOODFILL);
+	BIND_ENUM_CONSTANT(BAKE_MODE_ACCURATE_BVH);
 	BIND_ENUM_CONSTANT(BAKE_MODE_COUNT);
 }
 
@@ -6,6 +6,42 @@
 
 namespace zylann::voxel {
 
+namespace {
+
+// Editing a uniform channel requires to decompress it, which is wasted if the edit doesn't change anything. For example
+// removing matter from a buffer that only contains air, or adding matter where it is already all solid.
+// `shape_min_sdf` is the lowest signed distance the shape can have.
+bool is_shape_edit_noop_on_uniform_channel(
+		const VoxelBuffer &vb,
+		VoxelBuffer::ChannelId channel,
+		ops::Mode mode,
+		float shape_min_sdf,
+		uint32_t blocky_value
+) {
+	if (vb.get_channel_compression(channel) != VoxelBuffer::COMPRESSION_UNIFORM) {
+		return false;
+	}
+
+	if (channel != VoxelBuffer::CHANNEL_SDF) {
+		// Blocky edits set the same value everywhere inside the shape
+		return vb.get_voxel(Vector3i(), channel) == blocky_value;
+	}
+
+	const float sdf = vb.get_voxel_f(0, 0, 0, channel);
+	switch (mode) {
+		case ops::MODE_ADD:
+			// Union keeps the lowest distance
+			return sdf <= shape_min_sdf;
+		case ops::MODE_REMOVE:
+			// Subtraction keeps the highest distance between existing voxels and the inverted shape
+			return sdf >= -shape_min_sdf;
+		default:
+			return false;
+	}
+}
+
+} // namespace
+
 VoxelToolBuffer::VoxelToolBuffer(Ref<godot::VoxelBuffer> vb) {
 	ERR_FAIL_COND(vb.is_null());
 	_buffer = vb;
@@ -36,6 +72,14 @@ void VoxelToolBuffer::do_sphere(Vector3 center, float radius) {
 	op.channel = get_channel();
 	op.strength = get_sdf_strength();
 
+	if (op.box.is_empty() ||
+		(op.shape.sdf_scale >= 0.f &&
+		 is_shape_edit_noop_on_uniform_channel(
+				 vb, op.channel, op.mode, -op.shape.radius * op.shape.sdf_scale, op.blocky_value
+		 ))) {
+		return;
+	}
+
 	op();
 
 	_post_edit(op.box);
@@ -75,12 +119,21 @@ void VoxelToolBuffer::do_box(Vector3i begin, Vector3i end) {
 		op.channel = get_channel();
 		op.strength = get_sdf_strength();
 
+		const Vector3f half_size = op.shape.half_size;
+		const float shape_min_sdf = -math::min(half_size.x, math::min(half_size.y, half_size.z)) * op.shape.sdf_scale;
+		if (op.box.is_empty() ||
+			(op.shape.sdf_scale >= 0.f &&
+			 is_shape_edit_noop_on_uniform_channel(vb, op.channel, op.mode, shape_min_sdf, op.blocky_value))) {
+			return;
+		}
+
 		op();
 #endif
 
 	} else {
 		const int value = _mode == MODE_REMOVE ? _eraser_value : _value;
-		box.for_each_cell([this, value](Vector3i pos) { _set_voxel(pos, value); });
+		// Doesn't decompress uniform channels if the value is the same or if the box covers the whole buffer
+		vb.fill_area(value, box.position, box.position + box.size, _channel);
 	}
 
 	_post_edit(box);
@@ -136,29 +189,49 @@ void VoxelToolBuffer::paste(Vector3i p_pos, const VoxelBuffer &src, uint8_t chan
 
 	const SmallVector<uint8_t, VoxelBuffer::MAX_CHANNELS> channels = VoxelBuffer::mask_to_channels_list(channels_mask);
 
+	if (box.is_empty()) {
+		return;
+	}
+
 	const Vector3i box_max = box.position + box.size;
+	const Vector3i src_min = box.position - min_noclamp;
+	const bool covers_whole_buffers = box.size == dst.get_size() && box.size == src.get_size();
 
 	for (const uint8_t channel_index : channels) {
-		for (int z = box.position.z; z < box_max.z; ++z) {
-			const int bz = z - min_noclamp.z;
+		if (src.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_UNIFORM) {
+			// Doesn't decompress the destination if it has the same value or if the box covers all of it
+			dst.fill_area(src.get_voxel(src_min, channel_index), box.position, box_max, channel_index);
+
+		} else if (src.get_channel_depth(channel_index) == dst.get_channel_depth(channel_index)) {
+			if (covers_whole_buffers) {
+				// Shares data until one of the buffers gets modified
+				dst.copy_channel_from(src, channel_index);
+			} else {
+				dst.copy_channel_from(src, src_min, src_min + box.size, box.position, channel_index);
+			}
 
-			for (int x = box.position.x; x < box_max.x; ++x) {
-				const int bx = x - min_noclamp.x;
+		} else {
+			for (int z = box.position.z; z < box_max.z; ++z) {
+				const int bz = z - min_noclamp.z;
 
-				for (int y = box.position.y; y < box_max.y; ++y) {
-					const int by = y - min_noclamp.y;
+				for (int x = box.position.x; x < box_max.x; ++x) {
+					const int bx = x - min_noclamp.x;
 
-					const uint64_t v = src.get_voxel(bx, by, bz, channel_index);
+					for (int y = box.position.y; y < box_max.y; ++y) {
+						const int by = y - min_noclamp.y;
 
-					dst.set_voxel(v, x, y, z, channel_index);
+						const uint64_t v = src.get_voxel(bx, by, bz, channel_index);
 
-					// Overwrite previous metadata
-					dst.erase_voxel_metadata(Vector3i(x, y, z));
+						dst.set_voxel(v, x, y, z, channel_index);
+					}
 				}
 			}
 		}
 	}
 
+	// Overwrite previous metadata
+	dst.clear_voxel_metadata_in_area(box);
+
 	dst.copy_voxel_metadata_in_area(src, Box3i(Vector3i(), src.get_size()), p_pos);
 }
 
@@ -1,10 +1,12 @@
 #include "voxel_tool_lod_terrain.h"
 #include "../constants/voxel_string_names.h"
+#include "../engine/voxel_engine.h"
 #include "../generators/graph/voxel_generator_graph.h"
 #include "../meshers/blocky/voxel_mesher_blocky.h"
 #include "../storage/voxel_buffer_gd.h"
 #include "../storage/voxel_data_grid.h"
 #include "../terrain/variable_lod/voxel_lod_terrain.h"
+#include "../util/containers/std_unordered_map.h"
 #include "../util/containers/std_vector.h"
 #include "../util/dstack.h"
 #include "../util/godot/classes/collision_shape_3d.h"
@@ -13,11 +15,12 @@
 #include "../util/godot/classes/mesh_instance_3d.h"
 #include "../util/godot/classes/rigid_body_3d.h"
 #include "../util/godot/classes/timer.h"
-#include "../util/island_finder.h"
+#include "../util/godot/core/packed_arrays.h"
 #include "../util/math/conv.h"
 #include "../util/string/format.h"
 #include "../util/tasks/async_dependency_tracker.h"
 #include "../util/voxel_raycast.h"
+#include "connectivity_cache.h"
 #include "funcs.h"
 #include "voxel_mesh_sdf_gd.h"
 
@@ -85,15 +88,34 @@ float approximate_distance_to_isosurface_binary_search(
 	}
 }
 
-Ref<VoxelRaycastResult> VoxelToolLodTerrain::raycast(
+namespace {
+
+struct SdfRaycastHit {
+	Vector3i position;
+	Vector3i previous_position;
+	float distance;
+};
+
+// This is not particularly optimized, but runs fast enough for player raycasts
+struct RaycastVolumeSampler {
+	const VoxelData &data;
+
+	inline float operator()(const Vector3i &pos) const {
+		VoxelSingleValue defval;
+		defval.f = constants::SDF_FAR_OUTSIDE;
+		const VoxelSingleValue value = data.get_voxel(pos, VoxelBuffer::CHANNEL_SDF, defval);
+		return value.f;
+	}
+};
+
+bool raycast_sdf_grid(
+		const VoxelData &data,
 		Vector3 pos,
 		Vector3 dir,
 		float max_distance,
-		uint32_t collision_mask
+		int binary_search_iterations,
+		SdfRaycastHit &out_hit
 ) {
-	// TODO Transform input if the terrain is rotated
-	// TODO Implement reverse raycast? (going from inside ground to air, could be useful for undigging)
-
 	// TODO Optimization: voxel raycast uses `get_voxel` which is the slowest, but could be made faster.
 	// Instead, do a broad-phase on blocks. If a block's voxels need to be parsed, get all positions the ray could go
 	// through in that block, then query them all at once (better for bulk processing without going again through
@@ -101,7 +123,7 @@ Ref<VoxelRaycastResult> VoxelToolLodTerrain::raycast(
 	// If no hit is found, carry on with next blocks.
 
 	struct RaycastPredicate {
-		VoxelData &data;
+		const VoxelData &data;
 
 		bool operator()(const VoxelRaycastState &rs) {
 			// This is not particularly optimized, but runs fast enough for player raycasts
@@ -112,10 +134,8 @@ Ref<VoxelRaycastResult> VoxelToolLodTerrain::raycast(
 		}
 	};
 
-	Ref<VoxelRaycastResult> res;
-
 	// We use grid-raycast as a middle-phase to roughly detect where the hit will be
-	RaycastPredicate predicate = { _terrain->get_storage() };
+	RaycastPredicate predicate = { data };
 	Vector3i hit_pos;
 	Vector3i prev_pos;
 	float hit_distance;
@@ -136,44 +156,281 @@ Ref<VoxelRaycastResult> VoxelToolLodTerrain::raycast(
 	// `voxel_raycast` operates on a discrete grid of cubic voxels, so to account for the smooth interpolation,
 	// we may offset the ray so that cubes act as if they were centered on the filtered result.
 	const Vector3 offset(0.5, 0.5, 0.5);
-	if (voxel_raycast(pos + offset, dir, predicate, max_distance, hit_pos, prev_pos, hit_distance, hit_distance_prev)) {
-		// Approximate surface
+	if (!voxel_raycast(
+				pos + offset, dir, predicate, max_distance, hit_pos, prev_pos, hit_distance, hit_distance_prev
+		)) {
+		return false;
+	}
 
-		float d = hit_distance;
+	// Approximate surface
 
-		if (_raycast_binary_search_iterations > 0) {
-			// This is not particularly optimized, but runs fast enough for player raycasts
-			struct VolumeSampler {
-				VoxelData &data;
-
-				inline float operator()(const Vector3i &pos) const {
-					VoxelSingleValue defval;
-					defval.f = constants::SDF_FAR_OUTSIDE;
-					const VoxelSingleValue value = data.get_voxel(pos, VoxelBuffer::CHANNEL_SDF, defval);
-					return value.f;
-				}
-			};
+	float d = hit_distance;
+
+	if (binary_search_iterations > 0) {
+		RaycastVolumeSampler sampler{ data };
+		d = hit_distance_prev +
+				approximate_distance_to_isosurface_binary_search(
+						sampler,
+						pos + dir * hit_distance_prev,
+						dir,
+						hit_distance - hit_distance_prev,
+						binary_search_iterations
+				);
+	}
+
+	out_hit.position = hit_pos;
+	out_hit.previous_position = prev_pos;
+	out_hit.distance = d;
+	return true;
+}
+
+// Steps are scaled down a little, because SDFs coming from noise or modifiers are often not exact distances
+static const float SPHERE_TRACING_STEP_SCALE = 0.9f;
+// Close to the surface, steps can't be smaller than this. Half a voxel is fine enough to not miss features the grid
+// raycast would find.
+static const float SPHERE_TRACING_MIN_STEP = 0.5f;
+// Distance from the center of a cubic cell of size 1 to its corners
+static const float SPHERE_TRACING_CELL_RADIUS = 0.87f;
+
+// Marches along the ray using the SDF as a distance bound, so empty space is crossed in large steps. Far from the
+// surface, values are read from coarser LODs, which are more likely to be loaded far away from viewers. Positions are
+// snapped to the grid of the LOD they are read from, so the radius of its cells is subtracted to keep steps
+// conservative.
+bool raycast_sdf_sphere_tracing(
+		const VoxelData &data,
+		Vector3 pos,
+		Vector3 dir,
+		float max_distance,
+		int binary_search_iterations,
+		SdfRaycastHit &out_hit
+) {
+	const unsigned int max_lod_index = data.get_lod_count() - 1;
+	const RaycastVolumeSampler sampler{ data };
+
+	VoxelSingleValue defval;
+	defval.f = constants::SDF_FAR_OUTSIDE;
+
+	float d = 0.f;
+	float prev_d = 0.f;
+	// Conservative distance to the surface found at the previous step. Starts at zero so the first step reads LOD0.
+	float prev_bound = 0.f;
+
+	while (d < max_distance) {
+		const Vector3 p = pos + dir * d;
 
-			VolumeSampler sampler{ _terrain->get_storage() };
-			d = hit_distance_prev +
+		// Pick the coarsest LOD whose cells are small enough compared to the distance we expect to travel
+		unsigned int lod_index = 0;
+		while (lod_index < max_lod_index &&
+			   SPHERE_TRACING_CELL_RADIUS * static_cast<float>(2 << lod_index) < 0.25f * prev_bound) {
+			++lod_index;
+		}
+
+		const Vector3i lod_pos = math::round_to_int(p / static_cast<real_t>(1 << lod_index)) << lod_index;
+		const float bound = data.get_voxel_at_lod(lod_pos, lod_index, VoxelBuffer::CHANNEL_SDF, defval).f -
+				SPHERE_TRACING_CELL_RADIUS * static_cast<float>(1 << lod_index);
+
+		if (bound > 0.f) {
+			prev_bound = bound;
+			prev_d = d;
+			d += math::max(bound * SPHERE_TRACING_STEP_SCALE, SPHERE_TRACING_MIN_STEP);
+			continue;
+		}
+
+		if (lod_index > 0) {
+			// Coarse data can't tell precisely, check again at full resolution
+			prev_bound = 0.f;
+			continue;
+		}
+
+		// Close to the surface, use the same interpolation as meshes
+		if (get_sdf_interpolated(sampler, p) >= 0.f) {
+			prev_bound = 0.f;
+			prev_d = d;
+			d += SPHERE_TRACING_MIN_STEP;
+			continue;
+		}
+
+		float hit_distance = d;
+		if (binary_search_iterations > 0) {
+			hit_distance = prev_d +
 					approximate_distance_to_isosurface_binary_search(
-							sampler,
-							pos + dir * hit_distance_prev,
-							dir,
-							hit_distance - hit_distance_prev,
-							_raycast_binary_search_iterations
+							sampler, pos + dir * prev_d, dir, d - prev_d, binary_search_iterations
 					);
 		}
 
+		// Same convention as the grid raycast, where voxels are centered on the filtered result
+		const Vector3 offset(0.5, 0.5, 0.5);
+		out_hit.position = math::floor_to_int(pos + dir * hit_distance + offset);
+		out_hit.previous_position = math::floor_to_int(pos + dir * math::max(hit_distance - 1.f, 0.f) + offset);
+		out_hit.distance = hit_distance;
+		return true;
+	}
+
+	return false;
+}
+
+bool raycast_sdf(
+		const VoxelData &data,
+		Vector3 pos,
+		Vector3 dir,
+		float max_distance,
+		int binary_search_iterations,
+		bool sphere_tracing,
+		SdfRaycastHit &out_hit
+) {
+	if (sphere_tracing) {
+		return raycast_sdf_sphere_tracing(data, pos, dir, max_distance, binary_search_iterations, out_hit);
+	}
+	return raycast_sdf_grid(data, pos, dir, max_distance, binary_search_iterations, out_hit);
+}
+
+// Rays processed by one threaded task
+static const unsigned int RAYS_PER_RAYCAST_TASK = 64;
+
+struct RaycastManyShared {
+	StdVector<Vector3> origins;
+	StdVector<Vector3> directions;
+	StdVector<float> distances;
+	Callable callback;
+	// Only accessed on the main thread
+	unsigned int remaining_tasks = 0;
+};
+
+class RaycastManyTask : public IThreadedTask {
+public:
+	const char *get_debug_name() const override {
+		return "RaycastMany";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		RaycastManyShared &rs = *shared;
+
+		for (unsigned int i = begin_index; i < end_index; ++i) {
+			SdfRaycastHit hit;
+			if (raycast_sdf(
+						*data,
+						rs.origins[i],
+						rs.directions[i],
+						max_distance,
+						binary_search_iterations,
+						sphere_tracing,
+						hit
+				)) {
+				rs.distances[i] = hit.distance;
+			} else {
+				rs.distances[i] = -1.f;
+			}
+		}
+	}
+
+	void apply_result() override {
+		RaycastManyShared &rs = *shared;
+		ZN_ASSERT_RETURN(rs.remaining_tasks > 0);
+		--rs.remaining_tasks;
+		if (rs.remaining_tasks > 0) {
+			return;
+		}
+		PackedFloat32Array distances;
+		copy_to(distances, rs.distances);
+		if (rs.callback.is_valid()) {
+			rs.callback.call(distances);
+		}
+	}
+
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<RaycastManyShared> shared;
+	unsigned int begin_index;
+	unsigned int end_index;
+	float max_distance;
+	int binary_search_iterations;
+	bool sphere_tracing;
+};
+
+} // namespace
+
+Ref<VoxelRaycastResult> VoxelToolLodTerrain::raycast(
+		Vector3 pos,
+		Vector3 dir,
+		float max_distance,
+		uint32_t collision_mask
+) {
+	// TODO Transform input if the terrain is rotated
+	// TODO Implement reverse raycast? (going from inside ground to air, could be useful for undigging)
+
+	ERR_FAIL_COND_V(_terrain == nullptr, Ref<VoxelRaycastResult>());
+
+	Ref<VoxelRaycastResult> res;
+
+	SdfRaycastHit hit;
+	if (raycast_sdf(
+				_terrain->get_storage(),
+				pos,
+				dir,
+				max_distance,
+				_raycast_binary_search_iterations,
+				_raycast_sphere_tracing,
+				hit
+		)) {
 		res.instantiate();
-		res->position = hit_pos;
-		res->previous_position = prev_pos;
-		res->distance_along_ray = d;
+		res->position = hit.position;
+		res->previous_position = hit.previous_position;
+		res->distance_along_ray = hit.distance;
 	}
 
 	return res;
 }
 
+void VoxelToolLodTerrain::raycast_many(
+		PackedVector3Array origins,
+		PackedVector3Array directions,
+		float max_distance,
+		Callable callback
+) {
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_COND(_terrain == nullptr);
+	ERR_FAIL_COND(origins.size() != directions.size());
+
+	const unsigned int ray_count = origins.size();
+
+	std::shared_ptr<RaycastManyShared> shared = make_shared_instance<RaycastManyShared>();
+	shared->origins.resize(ray_count);
+	shared->directions.resize(ray_count);
+	for (unsigned int i = 0; i < ray_count; ++i) {
+		shared->origins[i] = origins[i];
+		shared->directions[i] = directions[i].normalized();
+	}
+	shared->distances.resize(ray_count, -1.f);
+	shared->callback = callback;
+
+	if (ray_count == 0) {
+		if (callback.is_valid()) {
+			callback.call(PackedFloat32Array());
+		}
+		return;
+	}
+
+	const unsigned int task_count = (ray_count + RAYS_PER_RAYCAST_TASK - 1) / RAYS_PER_RAYCAST_TASK;
+	shared->remaining_tasks = task_count;
+
+	StdVector<IThreadedTask *> tasks;
+	tasks.reserve(task_count);
+
+	for (unsigned int begin_index = 0; begin_index < ray_count; begin_index += RAYS_PER_RAYCAST_TASK) {
+		RaycastManyTask *task = ZN_NEW(RaycastManyTask);
+		task->data = _terrain->get_storage_shared();
+		task->shared = shared;
+		task->begin_index = begin_index;
+		task->end_index = math::min(begin_index + RAYS_PER_RAYCAST_TASK, ray_count);
+		task->max_distance = max_distance;
+		task->binary_search_iterations = _raycast_binary_search_iterations;
+		task->sphere_tracing = _raycast_sphere_tracing;
+		tasks.push_back(task);
+	}
+
+	VoxelEngine::get_singleton().push_async_tasks(to_span(tasks));
+}
+
 void VoxelToolLodTerrain::do_box(Vector3i begin, Vector3i end) {
 	ZN_PROFILE_SCOPE();
 	ERR_FAIL_COND(_terrain == nullptr);
@@ -194,6 +451,15 @@ void VoxelToolLodTerrain::do_box(Vector3i begin, Vector3i end) {
 		return;
 	}
 
+	if (_batching) {
+		BatchOperation bop;
+		bop.type = BatchOperation::TYPE_BOX;
+		bop.center = op.shape.center;
+		bop.size = op.shape.half_size;
+		record_batch_operation(bop, op.box);
+		return;
+	}
+
 	VoxelData &data = _terrain->get_storage();
 
 	data.pre_generate_box(op.box);
@@ -232,6 +498,15 @@ void VoxelToolLodTerrain::do_sphere(Vector3 center, float radius) {
 		return;
 	}
 
+	if (_batching) {
+		BatchOperation bop;
+		bop.type = BatchOperation::TYPE_SPHERE;
+		bop.center = op.shape.center;
+		bop.size = Vector3f(radius, 0.f, 0.f);
+		record_batch_operation(bop, world_box);
+		return;
+	}
+
 	VoxelData &data = _terrain->get_storage();
 
 	data.pre_generate_box(world_box);
@@ -287,61 +562,390 @@ void VoxelToolLodTerrain::do_hemisphere(Vector3 center, float radius, Vector3 fl
 	_post_edit(op.box);
 }
 
-template <typename Op_T>
-class VoxelToolAsyncEdit : public IThreadedTask {
-public:
-	VoxelToolAsyncEdit(Op_T op, std::shared_ptr<VoxelData> data) : _op(op), _data(data) {
-		_tracker = make_shared_instance<AsyncDependencyTracker>(1);
-	}
+namespace {
 
+template <typename TShape>
+void apply_batch_operation(
+		const VoxelToolLodTerrain::BatchOperation &bop,
+		const TShape &shape,
+		Box3i box,
+		VoxelDataGrid &grid
+) {
+	ops::DoShapeChunked<TShape, ops::VoxelDataGridAccess> op;
+	op.shape = shape;
+	op.mode = bop.mode;
+	op.block_access.grid = &grid;
+	op.box = box;
+	op.channel = bop.channel;
+	op.texture_params = bop.texture_params;
+	op.blocky_value = bop.blocky_value;
+	op.strength = bop.strength;
+	op();
+}
+
+// Applies the operations of a batch affecting one data block. Each block of a batch gets its own task, so they can run
+// in parallel.
+class VoxelToolBatchEditTask : public IThreadedTask {
+public:
 	const char *get_debug_name() const override {
-		return "VoxelToolAsyncEdit";
+		return "VoxelToolBatchEdit";
 	}
 
 	void run(ThreadedTaskContext &ctx) override {
 		ZN_PROFILE_SCOPE();
-		ZN_ASSERT(_data != nullptr);
-		// TODO May want to fail if not all blocks were found
-		// TODO Need to apply modifiers
-		_data->get_blocks_grid(_op.blocks, _op.box, 0);
-		_op();
-		_tracker->post_complete();
-	}
+		ZN_ASSERT(data != nullptr);
+
+		VoxelDataGrid grid;
+		data->get_blocks_grid(grid, block_box, 0);
+		VoxelDataGrid::LockWrite wlock(grid);
 
-	std::shared_ptr<AsyncDependencyTracker> get_tracker() {
-		return _tracker;
+		for (const VoxelToolLodTerrain::BatchOperation &bop : operations) {
+			// Only the part of the operation inside this block
+			const Box3i box = bop.box.clipped(block_box);
+
+			switch (bop.type) {
+				case VoxelToolLodTerrain::BatchOperation::TYPE_SPHERE: {
+					ops::SdfSphere shape;
+					shape.center = bop.center;
+					shape.radius = bop.size.x;
+					shape.sdf_scale = bop.sdf_scale;
+					apply_batch_operation(bop, shape, box, grid);
+				} break;
+
+				case VoxelToolLodTerrain::BatchOperation::TYPE_BOX: {
+					ops::SdfAxisAlignedBox shape;
+					shape.center = bop.center;
+					shape.half_size = bop.size;
+					shape.sdf_scale = bop.sdf_scale;
+					apply_batch_operation(bop, shape, box, grid);
+				} break;
+
+				default:
+					ZN_PRINT_ERROR("Unknown batch operation");
+					break;
+			}
+		}
+
+		tracker->post_complete();
 	}
 
-private:
-	Op_T _op;
+	StdVector<VoxelToolLodTerrain::BatchOperation> operations;
+	Box3i block_box;
+	// Area actually modified by operations, within the block
+	Box3i edited_box;
 	// We reference this just to keep map pointers alive
-	std::shared_ptr<VoxelData> _data;
-	std::shared_ptr<AsyncDependencyTracker> _tracker;
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<AsyncDependencyTracker> tracker;
 };
 
+} // namespace
+
+void VoxelToolLodTerrain::begin_batch() {
+	ERR_FAIL_COND_MSG(_batching, "A batch was already started");
+	_batching = true;
+}
+
+bool VoxelToolLodTerrain::is_batching() const {
+	return _batching;
+}
+
+void VoxelToolLodTerrain::record_batch_operation(BatchOperation bop, Box3i box) {
+	bop.mode = static_cast<ops::Mode>(get_mode());
+	bop.channel = get_channel();
+	bop.box = box;
+	bop.texture_params = _texture_params;
+	bop.blocky_value = _value;
+	bop.sdf_scale = get_sdf_scale();
+	bop.strength = get_sdf_strength();
+
+	if (_batching) {
+		_batch_operations.push_back(bop);
+	} else {
+		// Applied right away, but still split by block so large edits run in parallel
+		push_block_edit_tasks(Span<const BatchOperation>(&bop, 1));
+	}
+}
+
+void VoxelToolLodTerrain::end_batch() {
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_COND_MSG(!_batching, "No batch was started");
+	_batching = false;
+
+	push_block_edit_tasks(to_span_const(_batch_operations));
+	_batch_operations.clear();
+}
+
+void VoxelToolLodTerrain::push_block_edit_tasks(Span<const BatchOperation> operations) {
+	ZN_PROFILE_SCOPE();
+	if (operations.size() == 0) {
+		return;
+	}
+	ERR_FAIL_COND(_terrain == nullptr);
+
+	std::shared_ptr<VoxelData> data = _terrain->get_storage_shared();
+	const unsigned int block_size_po2 = _terrain->get_data_block_size_pow2();
+	const int block_size = 1 << block_size_po2;
+
+	// Group operations by block, keeping their order
+	StdUnorderedMap<Vector3i, VoxelToolBatchEditTask *> tasks_per_block;
+	StdVector<VoxelToolBatchEditTask *> tasks;
+
+	for (const BatchOperation &bop : operations) {
+		if (bop.box.is_empty()) {
+			continue;
+		}
+		bop.box.downscaled(block_size).for_each_cell([&](Vector3i bpos) {
+			VoxelToolBatchEditTask *task;
+			auto it = tasks_per_block.find(bpos);
+			if (it == tasks_per_block.end()) {
+				task = ZN_NEW(VoxelToolBatchEditTask);
+				task->block_box = Box3i(bpos << block_size_po2, Vector3iUtil::create(block_size));
+				task->edited_box = bop.box.clipped(task->block_box);
+				task->data = data;
+				task->tracker = make_shared_instance<AsyncDependencyTracker>(1);
+				tasks_per_block.insert({ bpos, task });
+				tasks.push_back(task);
+			} else {
+				task = it->second;
+				task->edited_box = Box3i::get_bounding_box(task->edited_box, bop.box.clipped(task->block_box));
+			}
+			task->operations.push_back(bop);
+		});
+	}
+
+	for (VoxelToolBatchEditTask *task : tasks) {
+		// Post-edit happens per block when its task completes
+		_terrain->push_async_edit(task, task->edited_box, task->tracker);
+	}
+}
+
 void VoxelToolLodTerrain::do_sphere_async(Vector3 center, float radius) {
 	ERR_FAIL_COND(_terrain == nullptr);
 
-	ops::DoSphere op;
-	op.shape.center = to_vec3f(center);
-	op.shape.radius = radius;
-	op.shape.sdf_scale = get_sdf_scale();
-	op.box = op.shape.get_box().clipped(_terrain->get_voxel_bounds());
-	op.mode = ops::Mode(get_mode());
-	op.texture_params = _texture_params;
-	op.blocky_value = _value;
-	op.channel = get_channel();
-	op.strength = get_sdf_strength();
+	ops::SdfSphere shape;
+	shape.center = to_vec3f(center);
+	shape.radius = radius;
+	const Box3i box = shape.get_box().clipped(_terrain->get_voxel_bounds());
 
-	if (!is_area_editable(op.box)) {
+	if (!is_area_editable(box)) {
 		ZN_PRINT_WARNING("Area not editable");
 		return;
 	}
 
+	BatchOperation bop;
+	bop.type = BatchOperation::TYPE_SPHERE;
+	bop.center = shape.center;
+	bop.size = Vector3f(radius, 0.f, 0.f);
+	record_batch_operation(bop, box);
+}
+
+void VoxelToolLodTerrain::do_box_async(Vector3i begin, Vector3i end) {
+	ERR_FAIL_COND(_terrain == nullptr);
+
+	Vector3iUtil::sort_min_max(begin, end);
+
+	ops::SdfAxisAlignedBox shape;
+	shape.center = to_vec3f(begin + end) * 0.5f;
+	shape.half_size = to_vec3f(end - begin) * 0.5f;
+	const Box3i box = shape.get_box().clipped(_terrain->get_voxel_bounds());
+
+	if (!is_area_editable(box)) {
+		ZN_PRINT_WARNING("Area not editable");
+		return;
+	}
+
+	BatchOperation bop;
+	bop.type = BatchOperation::TYPE_BOX;
+	bop.center = shape.center;
+	bop.size = shape.half_size;
+	record_batch_operation(bop, box);
+}
+
+namespace {
+
+// Large async copies and pastes are split in chunks of this size, so they can run in parallel and report progress
+static const int ASYNC_COPY_PASTE_CHUNK_SIZE = 64;
+
+// State shared by tasks of the same async copy or paste. Only accessed on the main thread.
+struct AsyncCopyPasteShared {
+	// Copy only. Chunks of voxels keyed by their position relative to the copied area.
+	Dictionary chunks;
+	Callable callback;
+	Callable progress_callback;
+	unsigned int completed_chunk_count = 0;
+	unsigned int chunk_count = 0;
+
+	void on_chunk_completed() {
+		++completed_chunk_count;
+		if (progress_callback.is_valid()) {
+			progress_callback.call(completed_chunk_count, chunk_count);
+		}
+		if (completed_chunk_count == chunk_count && callback.is_valid()) {
+			callback.call(chunks);
+		}
+	}
+};
+
+class VoxelToolCopyChunkTask : public IThreadedTask {
+public:
+	const char *get_debug_name() const override {
+		return "VoxelToolCopyChunk";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		ZN_ASSERT(data != nullptr);
+		voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+		voxels->create(box.size);
+		data->copy(box.position, *voxels, channels_mask);
+		tracker->post_complete();
+	}
+
+	void apply_result() override {
+		if (voxels != nullptr) {
+			shared->chunks[box.position - origin] = godot::VoxelBuffer::create_shared(voxels);
+		}
+		shared->on_chunk_completed();
+	}
+
+	Box3i box;
+	Vector3i origin;
+	uint8_t channels_mask;
+	std::shared_ptr<VoxelBuffer> voxels;
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<AsyncDependencyTracker> tracker;
+	std::shared_ptr<AsyncCopyPasteShared> shared;
+};
+
+class VoxelToolPasteChunkTask : public IThreadedTask {
+public:
+	const char *get_debug_name() const override {
+		return "VoxelToolPasteChunk";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		ZN_ASSERT(data != nullptr);
+		ZN_ASSERT(src != nullptr);
+
+		VoxelBuffer part(VoxelBuffer::ALLOCATOR_POOL);
+		part.create(box.size);
+		const Vector3i src_min = box.position - src_origin;
+		for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+			if ((channels_mask & (1 << channel_index)) == 0) {
+				continue;
+			}
+			part.set_channel_depth(channel_index, src->get_channel_depth(channel_index));
+			part.copy_channel_from(*src, src_min, src_min + box.size, Vector3i(), channel_index);
+		}
+
+		data->paste(box.position, part, channels_mask, false);
+		tracker->post_complete();
+	}
+
+	void apply_result() override {
+		shared->on_chunk_completed();
+	}
+
+	Box3i box;
+	Vector3i src_origin;
+	uint8_t channels_mask;
+	// Not modified while tasks run
+	std::shared_ptr<const VoxelBuffer> src;
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<AsyncDependencyTracker> tracker;
+	std::shared_ptr<AsyncCopyPasteShared> shared;
+};
+
+} // namespace
+
+void VoxelToolLodTerrain::copy_async(
+		Vector3i pos,
+		Vector3i size,
+		int channels_mask,
+		Callable callback,
+		Callable progress_callback
+) {
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_COND(_terrain == nullptr);
+	ERR_FAIL_COND(!math::is_valid_size(size) || Vector3iUtil::get_volume(size) == 0);
+	ERR_FAIL_COND(callback.is_null());
+	if (channels_mask == 0) {
+		channels_mask = (1 << _channel);
+	}
+
 	std::shared_ptr<VoxelData> data = _terrain->get_storage_shared();
+	std::shared_ptr<AsyncCopyPasteShared> shared = make_shared_instance<AsyncCopyPasteShared>();
+	shared->callback = callback;
+	shared->progress_callback = progress_callback;
+
+	const Box3i box(pos, size);
+	// Chunks are relative to the copied area, so they are easy to paste back
+	const Box3i chunks_box = Box3i(Vector3i(), size).downscaled(ASYNC_COPY_PASTE_CHUNK_SIZE);
+	shared->chunk_count = Vector3iUtil::get_volume(chunks_box.size);
+
+	chunks_box.for_each_cell_zxy([&](Vector3i cpos) {
+		VoxelToolCopyChunkTask *task = ZN_NEW(VoxelToolCopyChunkTask);
+		task->box =
+				Box3i(pos + cpos * ASYNC_COPY_PASTE_CHUNK_SIZE, Vector3iUtil::create(ASYNC_COPY_PASTE_CHUNK_SIZE))
+						.clipped(box);
+		task->origin = pos;
+		task->channels_mask = channels_mask;
+		task->data = data;
+		task->tracker = make_shared_instance<AsyncDependencyTracker>(1);
+		task->shared = shared;
+		_terrain->push_async_edit(task, task->box.clipped(_terrain->get_voxel_bounds()), task->tracker, true);
+	});
+}
+
+void VoxelToolLodTerrain::paste_async(
+		Vector3i pos,
+		Ref<godot::VoxelBuffer> voxels,
+		int channels_mask,
+		Callable progress_callback
+) {
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_COND(_terrain == nullptr);
+	ERR_FAIL_COND(voxels.is_null());
+	if (channels_mask == 0) {
+		channels_mask = (1 << _channel);
+	}
 
-	VoxelToolAsyncEdit<ops::DoSphere> *task = ZN_NEW(VoxelToolAsyncEdit<ops::DoSphere>(op, data));
-	_terrain->push_async_edit(task, op.box, task->get_tracker());
+	const Box3i box = Box3i(pos, voxels->get_buffer().get_size()).clipped(_terrain->get_voxel_bounds());
+	if (box.is_empty()) {
+		return;
+	}
+	if (!is_area_editable(box)) {
+		ZN_PRINT_WARNING("Area not editable");
+		return;
+	}
+
+	// Tasks read from a snapshot of the source, so it can be modified or freed while they run. Channels are shared
+	// until one of the buffers is modified, so this doesn't copy voxels.
+	std::shared_ptr<VoxelBuffer> src = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	src->create(voxels->get_buffer().get_size());
+	src->copy_channels_from(voxels->get_buffer());
+
+	std::shared_ptr<VoxelData> data = _terrain->get_storage_shared();
+	std::shared_ptr<AsyncCopyPasteShared> shared = make_shared_instance<AsyncCopyPasteShared>();
+	shared->progress_callback = progress_callback;
+
+	// Chunks are aligned to data blocks, so tasks don't lock each other
+	const Box3i chunks_box = box.downscaled(ASYNC_COPY_PASTE_CHUNK_SIZE);
+	shared->chunk_count = Vector3iUtil::get_volume(chunks_box.size);
+
+	chunks_box.for_each_cell_zxy([&](Vector3i cpos) {
+		VoxelToolPasteChunkTask *task = ZN_NEW(VoxelToolPasteChunkTask);
+		task->box = Box3i(cpos * ASYNC_COPY_PASTE_CHUNK_SIZE, Vector3iUtil::create(ASYNC_COPY_PASTE_CHUNK_SIZE))
+							.clipped(box);
+		task->src_origin = pos;
+		task->channels_mask = channels_mask;
+		task->src = src;
+		task->data = data;
+		task->tracker = make_shared_instance<AsyncDependencyTracker>(1);
+		task->shared = shared;
+		_terrain->push_async_edit(task, task->box, task->tracker);
+	});
 }
 
 void VoxelToolLodTerrain::copy(Vector3i pos, VoxelBuffer &dst, uint8_t channels_mask) const {
@@ -428,6 +1032,14 @@ void VoxelToolLodTerrain::set_raycast_binary_search_iterations(int iterations) {
 	_raycast_binary_search_iterations = math::clamp(iterations, 0, 16);
 }
 
+bool VoxelToolLodTerrain::get_raycast_sphere_tracing() const {
+	return _raycast_sphere_tracing;
+}
+
+void VoxelToolLodTerrain::set_raycast_sphere_tracing(bool enabled) {
+	_raycast_sphere_tracing = enabled;
+}
+
 void box_propagate_ccl(Span<uint8_t> cells, const Vector3i size) {
 	ZN_PROFILE_SCOPE();
 
@@ -526,6 +1138,8 @@ void box_propagate_ccl(Span<uint8_t> cells, const Vector3i size) {
 // so there are probably other approaches that could be explored in the future, if they have better performance
 Array separate_floating_chunks(
 		VoxelTool &voxel_tool,
+		const VoxelData &data,
+		ConnectivityCache &connectivity_cache,
 		Box3i world_box,
 		Node *parent_node,
 		Transform3D transform,
@@ -561,16 +1175,14 @@ Array separate_floating_chunks(
 	{
 		// TODO Allow to run the algorithm at a different LOD, to trade precision for speed
 		ZN_PROFILE_SCOPE_NAMED("CCL scan");
-		IslandFinder island_finder;
-		island_finder.scan_3d(
-				Box3i(Vector3i(), world_box.size),
-				[&source_copy_buffer](Vector3i pos) {
-					// TODO Can be optimized further with direct access
-					return source_copy_buffer.get_voxel_f(pos.x, pos.y, pos.z, main_channel) < 0.f;
-				},
-				to_span(ccl_output),
-				&label_count
-		);
+		// Only blocks edited since the last call have to be scanned again
+		if (!connectivity_cache.label_area(data, world_box, to_span(ccl_output), label_count)) {
+			ZN_PRINT_ERROR(format(
+					"Too many separate groups of voxels in the area (max {}), try a smaller box",
+					ConnectivityCache::MAX_LABELS
+			));
+			return Array();
+		}
 	}
 
 	struct Bounds {
@@ -924,7 +1536,14 @@ Array VoxelToolLodTerrain::separate_floating_chunks(AABB world_box, Object *pare
 	materials.append(_terrain->get_material());
 	const Box3i int_world_box(math::floor_to_int(world_box.position), math::ceil_to_int(world_box.size));
 	return zylann::voxel::separate_floating_chunks(
-			*this, int_world_box, parent_node, _terrain->get_global_transform(), mesher, materials
+			*this,
+			_terrain->get_storage(),
+			_terrain->get_connectivity_cache(),
+			int_world_box,
+			parent_node,
+			_terrain->get_global_transform(),
+			mesher,
+			materials
 	);
 }
 
@@ -1128,7 +1747,8 @@ void VoxelToolLodTerrain::run_blocky_random_tick(
 		const AABB voxel_area,
 		const int voxel_count,
 		const Callable &callback,
-		const int block_batch_count
+		const int block_batch_count,
+		const bool batched_callback
 ) {
 	ZN_PROFILE_SCOPE();
 
@@ -1154,7 +1774,15 @@ void VoxelToolLodTerrain::run_blocky_random_tick(
 	VoxelData &data = _terrain->get_storage();
 
 	zylann::voxel::run_blocky_random_tick(
-			data, voxel_area, **library, _random, voxel_count, block_batch_count, callback
+			data,
+			voxel_area,
+			**library,
+			_random,
+			voxel_count,
+			block_batch_count,
+			&_terrain->get_random_tick_index(),
+			callback,
+			batched_callback
 	);
 }
 
@@ -1165,9 +1793,28 @@ void VoxelToolLodTerrain::_bind_methods() {
 			D_METHOD("set_raycast_binary_search_iterations", "iterations"), &Self::set_raycast_binary_search_iterations
 	);
 	ClassDB::bind_method(D_METHOD("get_raycast_binary_search_iterations"), &Self::get_raycast_binary_search_iterations);
+	ClassDB::bind_method(D_METHOD("set_raycast_sphere_tracing", "enabled"), &Self::set_raycast_sphere_tracing);
+	ClassDB::bind_method(D_METHOD("get_raycast_sphere_tracing"), &Self::get_raycast_sphere_tracing);
+	ClassDB::bind_method(
+			D_METHOD("raycast_many", "origins", "directions", "max_distance", "callback"), &Self::raycast_many
+	);
 	ClassDB::bind_method(D_METHOD("get_voxel_f_interpolated", "position"), &Self::get_voxel_f_interpolated);
 	ClassDB::bind_method(D_METHOD("separate_floating_chunks", "box", "parent_node"), &Self::separate_floating_chunks);
 	ClassDB::bind_method(D_METHOD("do_sphere_async", "center", "radius"), &Self::do_sphere_async);
+	ClassDB::bind_method(
+			D_METHOD("copy_async", "pos", "size", "channels_mask", "callback", "progress_callback"),
+			&Self::copy_async,
+			DEFVAL(Callable())
+	);
+	ClassDB::bind_method(
+			D_METHOD("paste_async", "pos", "voxels", "channels_mask", "progress_callback"),
+			&Self::paste_async,
+			DEFVAL(Callable())
+	);
+	ClassDB::bind_method(D_METHOD("do_box_async", "begin", "end"), &Self::do_box_async);
+	ClassDB::bind_method(D_METHOD("begin_batch"), &Self::begin_batch);
+	ClassDB::bind_method(D_METHOD("end_batch"), &Self::end_batch);
+	ClassDB::bind_method(D_METHOD("is_batching"), &Self::is_batching);
 	ClassDB::bind_method(D_METHOD("stamp_sdf", "mesh_sdf", "transform", "isolevel", "sdf_scale"), &Self::stamp_sdf);
 	ClassDB::bind_method(D_METHOD("do_graph", "graph", "transform", "area_size"), &Self::do_graph);
 	ClassDB::bind_method(
@@ -1176,9 +1823,10 @@ void VoxelToolLodTerrain::_bind_methods() {
 			DEFVAL(0.0)
 	);
 	ClassDB::bind_method(
-			D_METHOD("run_blocky_random_tick", "area", "voxel_count", "callback", "batch_count"),
+			D_METHOD("run_blocky_random_tick", "area", "voxel_count", "callback", "batch_count", "batched_callback"),
 			&Self::run_blocky_random_tick,
-			DEFVAL(16)
+			DEFVAL(16),
+			DEFVAL(false)
 	);
 }
 
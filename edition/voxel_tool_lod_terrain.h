@@ -1,6 +1,7 @@
 #ifndef VOXEL_TOOL_LOD_TERRAIN_H
 #define VOXEL_TOOL_LOD_TERRAIN_H
 
+#include "../util/containers/std_vector.h"
 #include "../util/godot/core/random_pcg.h"
 #include "../util/macros.h"
 #include "voxel_tool.h"
@@ -31,7 +32,23 @@ public:
 
 	int get_raycast_binary_search_iterations() const;
 	void set_raycast_binary_search_iterations(int iterations);
+	// When enabled, raycasts step through empty space by the distance given by the SDF, reading coarser LODs far from
+	// the surface, instead of visiting every voxel along the ray. Much faster for long rays.
+	bool get_raycast_sphere_tracing() const;
+	void set_raycast_sphere_tracing(bool enabled);
+	// Runs many raycasts on worker threads. `callback` is called on the main thread with the distance of each hit, or
+	// -1 if the ray didn't hit anything.
+	void raycast_many(PackedVector3Array origins, PackedVector3Array directions, float max_distance, Callable callback);
+	// Async edits are split by data block and run in parallel on worker threads. Results become visible in later
+	// frames, and `VoxelLodTerrain` emits `async_edits_completed` when all of them are applied.
 	void do_sphere_async(Vector3 center, float radius);
+	void do_box_async(Vector3i begin, Vector3i end);
+	// Copies or pastes large areas on worker threads, in chunks. Like async edits, missing blocks are generated first,
+	// and they run in order with edits. `progress_callback` is called with the number of completed chunks and the
+	// total. `copy_async` calls `callback` with a dictionary of `VoxelBuffer` chunks, keyed by their position relative
+	// to `pos`.
+	void copy_async(Vector3i pos, Vector3i size, int channels_mask, Callable callback, Callable progress_callback);
+	void paste_async(Vector3i pos, Ref<godot::VoxelBuffer> voxels, int channels_mask, Callable progress_callback);
 	void do_hemisphere(Vector3 center, float radius, Vector3 flat_direction, float smoothness);
 	float get_voxel_f_interpolated(Vector3 position) const;
 
@@ -49,9 +66,37 @@ public:
 			const AABB voxel_area,
 			const int voxel_count,
 			const Callable &callback,
-			const int block_batch_count
+			const int block_batch_count,
+			const bool batched_callback
 	);
 
+	// While a batch is open, `do_sphere` and `do_box` are recorded instead of being applied. When the batch ends, they
+	// are grouped by data block and applied asynchronously, with one task per block running in parallel. Each block
+	// is then saved, remeshed and updated once, instead of once per edit.
+	void begin_batch();
+	void end_batch();
+	bool is_batching() const;
+
+	// Internal
+
+	struct BatchOperation {
+		enum Type : uint8_t { //
+			TYPE_SPHERE,
+			TYPE_BOX
+		};
+		Type type;
+		ops::Mode mode;
+		VoxelBuffer::ChannelId channel;
+		// Sphere: center and radius in X. Box: center and half size.
+		Vector3f center;
+		Vector3f size;
+		Box3i box;
+		ops::TextureParams texture_params;
+		uint32_t blocky_value;
+		float sdf_scale;
+		float strength;
+	};
+
 protected:
 	uint64_t _get_voxel(Vector3i pos) const override;
 	float _get_voxel_f(Vector3i pos) const override;
@@ -60,11 +105,19 @@ protected:
 	void _post_edit(const Box3i &box) override;
 
 private:
+	// Records the operation if a batch is open, otherwise applies it asynchronously
+	void record_batch_operation(BatchOperation bop, Box3i box);
+	void push_block_edit_tasks(Span<const BatchOperation> operations);
+
 	static void _bind_methods();
 
 	VoxelLodTerrain *_terrain = nullptr;
 	int _raycast_binary_search_iterations = 0;
+	bool _raycast_sphere_tracing = false;
 	RandomPCG _random;
+	// Operations recorded since the batch began, in order
+	StdVector<BatchOperation> _batch_operations;
+	bool _batching = false;
 };
 
 } // namespace zylann::voxel
@@ -172,6 +172,8 @@ void VoxelToolTerrain::paste(Vector3i pos, const VoxelBuffer &src, uint8_t chann
 	if (channels_mask == 0) {
 		channels_mask = (1 << _channel);
 	}
+	// Voxels of blocks may have been evicted to save memory
+	_terrain->get_storage().pre_generate_box(Box3i(pos, src.get_size()));
 	_terrain->get_storage().paste(pos, src, channels_mask, false);
 	_post_edit(Box3i(pos, src.get_size()));
 }
@@ -188,6 +190,7 @@ void VoxelToolTerrain::paste_masked(
 	if (channels_mask == 0) {
 		channels_mask = (1 << _channel);
 	}
+	_terrain->get_storage().pre_generate_box(Box3i(pos, p_voxels->get_buffer().get_size()));
 	_terrain->get_storage().paste_masked(pos, p_voxels->get_buffer(), channels_mask, mask_channel, mask_value, false);
 	_post_edit(Box3i(pos, p_voxels->get_buffer().get_size()));
 }
@@ -206,6 +209,7 @@ void VoxelToolTerrain::paste_masked_writable_list( //
 	if (channels_mask == 0) {
 		channels_mask = (1 << _channel);
 	}
+	_terrain->get_storage().pre_generate_box(Box3i(pos, p_voxels->get_buffer().get_size()));
 	_terrain->get_storage().paste_masked_writable_list( //
 			pos, //
 			p_voxels->get_buffer(), //
@@ -249,6 +253,8 @@ void VoxelToolTerrain::do_box(Vector3i begin, Vector3i end) {
 
 	VoxelData &data = _terrain->get_storage();
 
+	data.pre_generate_box(op.box);
+
 	VoxelDataGrid grid;
 	data.get_blocks_grid(grid, op.box, 0);
 	op.block_access.grid = &grid;
@@ -283,6 +289,7 @@ void VoxelToolTerrain::do_sphere(Vector3 center, float radius) {
 
 	VoxelData &data = _terrain->get_storage();
 
+	data.pre_generate_box(op.box);
 	data.get_blocks_grid(op.blocks, op.box, 0);
 	op();
 
@@ -314,6 +321,8 @@ void VoxelToolTerrain::do_hemisphere(Vector3 center, float radius, Vector3 flat_
 
 	VoxelData &data = _terrain->get_storage();
 
+	data.pre_generate_box(op.box);
+
 	VoxelDataGrid grid;
 	data.get_blocks_grid(grid, op.box, 0);
 	op.block_access.grid = &grid;
@@ -356,6 +365,8 @@ void VoxelToolTerrain::_post_edit(const Box3i &box) {
 void VoxelToolTerrain::set_voxel_metadata(Vector3i pos, Variant meta) {
 	ERR_FAIL_COND(_terrain == nullptr);
 	VoxelData &data = _terrain->get_storage();
+	// Metadata is stored in voxel buffers, which may have been evicted to save memory
+	data.pre_generate_box(Box3i(pos, Vector3i(1, 1, 1)));
 	data.set_voxel_metadata(pos, meta);
 	_terrain->post_edit_area(Box3i(pos, Vector3i(1, 1, 1)), false);
 }
@@ -363,6 +374,7 @@ void VoxelToolTerrain::set_voxel_metadata(Vector3i pos, Variant meta) {
 Variant VoxelToolTerrain::get_voxel_metadata(Vector3i pos) const {
 	ERR_FAIL_COND_V(_terrain == nullptr, Variant());
 	VoxelData &data = _terrain->get_storage();
+	data.pre_generate_box(Box3i(pos, Vector3i(1, 1, 1)));
 	return data.get_voxel_metadata(pos);
 }
 
@@ -383,7 +395,8 @@ void VoxelToolTerrain::run_blocky_random_tick(
 		AABB voxel_area,
 		int voxel_count,
 		const Callable &callback,
-		int batch_count
+		int batch_count,
+		bool batched_callback
 ) {
 	ZN_PROFILE_SCOPE();
 
@@ -405,7 +418,20 @@ void VoxelToolTerrain::run_blocky_random_tick(
 	const VoxelBlockyLibraryBase &lib = **get_voxel_library(*_terrain);
 	VoxelData &data = _terrain->get_storage();
 
-	zylann::voxel::run_blocky_random_tick(data, voxel_area, lib, _random, voxel_count, batch_count, callback);
+	const Box3i voxel_box(math::floor_to_int(voxel_area.position), math::ceil_to_int(voxel_area.size));
+	data.pre_generate_box(voxel_box.clipped(data.get_bounds()));
+
+	zylann::voxel::run_blocky_random_tick(
+			data,
+			voxel_area,
+			lib,
+			_random,
+			voxel_count,
+			batch_count,
+			&_terrain->get_random_tick_index(),
+			callback,
+			batched_callback
+	);
 }
 
 void VoxelToolTerrain::for_each_voxel_metadata_in_area(AABB voxel_area, const Callable &callback) {
@@ -475,6 +501,7 @@ void VoxelToolTerrain::do_path(Span<const Vector3> positions, Span<const float>
 
 	VoxelData &data = _terrain->get_storage();
 
+	data.pre_generate_box(total_voxel_box);
 	data.get_blocks_grid(grid, total_voxel_box, 0);
 
 	{
@@ -536,9 +563,10 @@ void VoxelToolTerrain::do_path(Span<const Vector3> positions, Span<const float>
 
 void VoxelToolTerrain::_bind_methods() {
 	ClassDB::bind_method(
-			D_METHOD("run_blocky_random_tick", "area", "voxel_count", "callback", "batch_count"),
+			D_METHOD("run_blocky_random_tick", "area", "voxel_count", "callback", "batch_count", "batched_callback"),
 			&VoxelToolTerrain::run_blocky_random_tick,
-			DEFVAL(16)
+			DEFVAL(16),
+			DEFVAL(false)
 	);
 	ClassDB::bind_method(
 			D_METHOD("for_each_voxel_metadata_in_area", "voxel_area", "callback"),
@@ -393,6 +393,193 @@ inline void query_sdf(
 #endif
 }
 
+// Sample positions of a group of tiles. Each normal needs 4 samples:
+// (x,   y,   z  )
+// (x+s, y,   z  )
+// (x,   y+s, z  )
+// (x,   y,   z+s)
+struct TileSampleBuffers {
+	// One per normal
+	StdVector<Vector2i> positions;
+	StdVector<uint8_t> triangle_indices;
+	// Four per normal
+	StdVector<float> x;
+	StdVector<float> y;
+	StdVector<float> z;
+	StdVector<float> sdf;
+
+	void clear() {
+		positions.clear();
+		triangle_indices.clear();
+		x.clear();
+		y.clear();
+		z.clear();
+		sdf.clear();
+	}
+};
+
+// Projects pixels of a tile on the triangles of its cell, and appends sample positions where they hit
+void gather_tile_samples(
+		const CellTriangles &baked_triangles,
+		unsigned int triangle_count,
+		Vector3f quad_origin_world,
+		Vector3f direction,
+		unsigned int ax,
+		unsigned int ay,
+		unsigned int cell_size,
+		float step,
+		unsigned int tile_resolution,
+		Vector3i origin_in_voxels,
+		TileSampleBuffers &samples
+) {
+	ZN_PROFILE_SCOPE_NAMED("Compute positions");
+
+	for (unsigned int yi = 0; yi < tile_resolution; ++yi) {
+		for (unsigned int xi = 0; xi < tile_resolution; ++xi) {
+			// TODO Add bias to center differences when calculating the normals?
+			Vector3f pos000 = quad_origin_world;
+			// Casting to `int` here because even if the target is float, temporaries can be negative uints
+			pos000[ax] += int(xi) * step;
+			pos000[ay] += int(yi) * step;
+
+			// Project to triangles
+			const Vector3f ray_origin_world = pos000 - direction * cell_size;
+			const Vector3f ray_origin_mesh = ray_origin_world - to_vec3f(origin_in_voxels);
+			float nearest_hit_distance = 999999.f;
+			unsigned int hit_triangle_index = triangle_count;
+			for (unsigned int ti = 0; ti < triangle_count; ++ti) {
+				const math::TriangleIntersectionResult result =
+						baked_triangles[ti].intersect(ray_origin_mesh, direction);
+				if (result.case_id == math::TriangleIntersectionResult::INTERSECTION &&
+					result.distance < nearest_hit_distance) {
+					nearest_hit_distance = result.distance;
+					hit_triangle_index = ti;
+				}
+			}
+
+			if (hit_triangle_index == triangle_count) {
+				// Don't query if there is no triangle
+				continue;
+			}
+
+			pos000 = ray_origin_world + direction * nearest_hit_distance;
+			samples.positions.push_back(Vector2i(xi, yi));
+			samples.triangle_indices.push_back(hit_triangle_index);
+
+			samples.x.push_back(pos000.x);
+			samples.y.push_back(pos000.y);
+			samples.z.push_back(pos000.z);
+
+			Vector3f pos100 = pos000;
+			pos100.x += step;
+			samples.x.push_back(pos100.x);
+			samples.y.push_back(pos100.y);
+			samples.z.push_back(pos100.z);
+
+			Vector3f pos010 = pos000;
+			pos010.y += step;
+			samples.x.push_back(pos010.x);
+			samples.y.push_back(pos010.y);
+			samples.z.push_back(pos010.z);
+
+			Vector3f pos001 = pos000;
+			pos001.z += step;
+			samples.x.push_back(pos001.x);
+			samples.y.push_back(pos001.y);
+			samples.z.push_back(pos001.z);
+		}
+	}
+}
+
+// Computes normals of a tile from SDF samples, and writes them encoded into the output
+void compute_tile_normals(
+		Span<const float> sdf_buffer,
+		Span<const Vector2i> sample_positions,
+		Span<const uint8_t> sample_triangle_indices,
+		Span<const Vector3f> triangle_normals,
+		unsigned int tile_resolution,
+		float max_deviation_cosine,
+		float max_deviation_sine,
+		bool octahedral_encoding,
+		Span<uint8_t> encoded_normals
+) {
+	static thread_local StdVector<Vector3f> tls_tile_normals;
+	tls_tile_normals.clear();
+	tls_tile_normals.resize(math::squared(tile_resolution));
+
+	// Compute normals from SDF results
+	{
+		ZN_PROFILE_SCOPE_NAMED("Compute normals");
+		ZN_ASSERT(sample_positions.size() == sample_triangle_indices.size());
+		ZN_ASSERT(sdf_buffer.size() == sample_positions.size() * 4);
+
+		unsigned int bi = 0;
+
+		for (unsigned int si = 0; si < sample_positions.size(); ++si) {
+			const Vector2i sample_position = sample_positions[si];
+			const uint8_t sample_tri_index = sample_triangle_indices[si];
+
+			const float sd000 = sdf_buffer[bi];
+			const float sd100 = sdf_buffer[bi + 1];
+			const float sd010 = sdf_buffer[bi + 2];
+			const float sd001 = sdf_buffer[bi + 3];
+			bi += 4;
+
+			Vector3f normal = math::normalized(Vector3f(sd100 - sd000, sd010 - sd000, sd001 - sd000));
+
+			// Clamp normals if their dot product with triangle normal is higher than a threshold.
+			// This helps avoiding flipped normals on very low LODs because bias is very high. In the
+			// SolarSystem demo it can pick up caves from the surface which results in black spots.
+			const Vector3f &tri_normal = triangle_normals[sample_tri_index];
+			const float tdot = math::dot(normal, tri_normal);
+			if (tdot < max_deviation_cosine) {
+				if (tdot < -0.999) {
+					normal = tri_normal;
+				} else {
+					const Vector3f axis = math::normalized(math::cross(tri_normal, normal));
+					normal = math::rotated(tri_normal, axis, max_deviation_cosine, max_deviation_sine);
+				}
+			}
+
+			const unsigned int normal_index = sample_position.x + sample_position.y * tile_resolution;
+#ifdef DEBUG_ENABLED
+			ZN_ASSERT(normal_index < tls_tile_normals.size());
+#endif
+			tls_tile_normals[normal_index] = normal;
+		}
+	}
+
+	for (unsigned int dilation_steps = 0; dilation_steps < 2; ++dilation_steps) {
+		// Fill up some pixels around triangle borders, to give some margin when sampling near them in shader
+		dilate_normalmap(to_span(tls_tile_normals), Vector2i(tile_resolution, tile_resolution));
+	}
+
+	// Encode normals
+	if (octahedral_encoding) {
+		ZN_ASSERT(encoded_normals.size() == tls_tile_normals.size() * 2);
+		for (unsigned int i = 0; i < tls_tile_normals.size(); ++i) {
+			const unsigned int offset = i * 2;
+			const Vector2f n = encode_normal_octahedron(tls_tile_normals[i]);
+			encoded_normals[offset + 0] = unorm_to_u8(n.x);
+			encoded_normals[offset + 1] = unorm_to_u8(n.y);
+		}
+	} else {
+		ZN_ASSERT(encoded_normals.size() == tls_tile_normals.size() * 3);
+		for (unsigned int i = 0; i < tls_tile_normals.size(); ++i) {
+			const unsigned int offset = i * 3;
+			const Vector3f n = encode_normal_xyz(tls_tile_normals[i]);
+			encoded_normals[offset + 0] = unorm_to_u8(n.x);
+			encoded_normals[offset + 1] = unorm_to_u8(n.y);
+			encoded_normals[offset + 2] = unorm_to_u8(n.z);
+		}
+	}
+}
+
+// Tiles without edits only need to query the generator, so their samples are accumulated and queried in large
+// batches, which series generation processes a lot faster than many small ones. Batches are flushed once they have
+// at least this many samples.
+static const unsigned int CPU_DETAIL_TEXTURE_BATCH_SAMPLE_COUNT = 8192;
+
 // For each non-empty cell of the mesh, choose an axis-aligned projection based on triangle normals in the cell.
 // Sample voxels inside the cell to compute a tile of world space normals from the SDF.
 void compute_detail_texture_data(
@@ -441,6 +628,65 @@ void compute_detail_texture_data(
 
 	uint32_t skipped_count_due_to_high_volume = 0;
 
+	const VoxelModifierStack *modifiers = voxel_data != nullptr ? &voxel_data->get_modifiers() : nullptr;
+
+	struct BatchedTile {
+		unsigned int sample_begin;
+		unsigned int sample_count;
+		unsigned int output_begin;
+		FixedArray<Vector3f, CurrentCellInfo::MAX_TRIANGLES> triangle_normals;
+	};
+
+	static thread_local TileSampleBuffers tls_batch_samples;
+	static thread_local StdVector<BatchedTile> tls_batched_tiles;
+	tls_batch_samples.clear();
+	tls_batched_tiles.clear();
+	Vector3f batch_min_pos;
+	Vector3f batch_max_pos;
+
+	const unsigned int tile_output_size = math::squared(tile_resolution) * encoded_normal_size;
+
+	// Queries the generator for all batched tiles at once, then computes their normals
+	auto flush_batch = [&]() {
+		if (tls_batched_tiles.size() == 0) {
+			return;
+		}
+		ZN_PROFILE_SCOPE_NAMED("Batch");
+
+		tls_batch_samples.sdf.resize(tls_batch_samples.x.size());
+
+		query_sdf(
+				generator,
+				nullptr,
+				modifiers,
+				to_span(tls_batch_samples.x),
+				to_span(tls_batch_samples.y),
+				to_span(tls_batch_samples.z),
+				to_span(tls_batch_samples.sdf),
+				batch_min_pos,
+				batch_max_pos
+		);
+
+		for (const BatchedTile &tile : tls_batched_tiles) {
+			compute_tile_normals(
+					to_span_from_position_and_size(tls_batch_samples.sdf, tile.sample_begin * 4, tile.sample_count * 4),
+					to_span_from_position_and_size(tls_batch_samples.positions, tile.sample_begin, tile.sample_count),
+					to_span_from_position_and_size(
+							tls_batch_samples.triangle_indices, tile.sample_begin, tile.sample_count
+					),
+					to_span(tile.triangle_normals),
+					tile_resolution,
+					max_deviation_cosine,
+					max_deviation_sine,
+					octahedral_encoding,
+					to_span_from_position_and_size(normal_map_data.normals, tile.output_begin, tile_output_size)
+			);
+		}
+
+		tls_batch_samples.clear();
+		tls_batched_tiles.clear();
+	};
+
 	CurrentCellInfo cell_info;
 	for (unsigned int cell_index = 0; cell_iterator.next(cell_info); ++cell_index) {
 		// Re-use memory because it will be used a lot
@@ -449,13 +695,14 @@ void compute_detail_texture_data(
 		ClearVoxelDataGridOnExit grid_clear_on_exit{ tls_voxel_data_grid };
 
 		const Vector3f cell_origin_world = to_vec3f(origin_in_voxels + cell_info.position * cell_size);
+		const Vector3f cell_end_world = cell_origin_world + Vector3f(cell_size);
 
 		// In cases we only want tiles with edited voxels, check this early so we can skip the tile.
 		const bool cell_has_edits = voxel_data != nullptr &&
 				try_query_edited_blocks(tls_voxel_data_grid,
 										*voxel_data,
 										cell_origin_world,
-										cell_origin_world + Vector3f(cell_size),
+										cell_end_world,
 										skipped_count_due_to_high_volume);
 		if (!cell_has_edits && edited_tiles_only) {
 			continue;
@@ -477,34 +724,6 @@ void compute_detail_texture_data(
 		Vector3f direction;
 		direction[az] = 1.f;
 
-		static thread_local StdVector<Vector2i> tls_tile_sample_positions;
-		tls_tile_sample_positions.clear();
-		tls_tile_sample_positions.reserve(math::squared(tile_resolution));
-
-		static thread_local StdVector<uint8_t> tls_tile_sample_triangle_index;
-		tls_tile_sample_triangle_index.clear();
-		tls_tile_sample_triangle_index.reserve(math::squared(tile_resolution));
-
-		// Each normal needs 4 samples:
-		// (x,   y,   z  )
-		// (x+s, y,   z  )
-		// (x,   y+s, z  )
-		// (x,   y,   z+s)
-		const unsigned int max_buffer_size = math::squared(tile_resolution) * 4;
-
-		static thread_local StdVector<float> tls_sdf_buffer;
-		static thread_local StdVector<float> tls_x_buffer;
-		static thread_local StdVector<float> tls_y_buffer;
-		static thread_local StdVector<float> tls_z_buffer;
-		tls_sdf_buffer.clear();
-		tls_x_buffer.clear();
-		tls_y_buffer.clear();
-		tls_z_buffer.clear();
-		tls_sdf_buffer.reserve(max_buffer_size);
-		tls_x_buffer.reserve(max_buffer_size);
-		tls_y_buffer.reserve(max_buffer_size);
-		tls_z_buffer.reserve(max_buffer_size);
-
 		// Optimize triangles
 		CellTriangles baked_triangles;
 		unsigned int triangle_count =
@@ -518,174 +737,96 @@ void compute_detail_texture_data(
 			triangle_normals[i] = tri_normal;
 		}
 
-		// Fill query buffers
-		{
-			ZN_PROFILE_SCOPE_NAMED("Compute positions");
-			for (unsigned int yi = 0; yi < tile_resolution; ++yi) {
-				for (unsigned int xi = 0; xi < tile_resolution; ++xi) {
-					// TODO Add bias to center differences when calculating the normals?
-					Vector3f pos000 = quad_origin_world;
-					// Casting to `int` here because even if the target is float, temporaries can be negative uints
-					pos000[ax] += int(xi) * step;
-					pos000[ay] += int(yi) * step;
-
-					// Project to triangles
-					const Vector3f ray_origin_world = pos000 - direction * cell_size;
-					const Vector3f ray_origin_mesh = ray_origin_world - to_vec3f(origin_in_voxels);
-					float nearest_hit_distance = 999999.f;
-					unsigned int hit_triangle_index = triangle_count;
-					for (unsigned int ti = 0; ti < triangle_count; ++ti) {
-						const math::TriangleIntersectionResult result =
-								baked_triangles[ti].intersect(ray_origin_mesh, direction);
-						if (result.case_id == math::TriangleIntersectionResult::INTERSECTION &&
-							result.distance < nearest_hit_distance) {
-							nearest_hit_distance = result.distance;
-							hit_triangle_index = ti;
-						}
-					}
-
-					if (hit_triangle_index == triangle_count) {
-						// Don't query if there is no triangle
-						continue;
-					}
-
-					pos000 = ray_origin_world + direction * nearest_hit_distance;
-					tls_tile_sample_positions.push_back(Vector2i(xi, yi));
-					tls_tile_sample_triangle_index.push_back(hit_triangle_index);
-
-					tls_x_buffer.push_back(pos000.x);
-					tls_y_buffer.push_back(pos000.y);
-					tls_z_buffer.push_back(pos000.z);
-
-					Vector3f pos100 = pos000;
-					pos100.x += step;
-					tls_x_buffer.push_back(pos100.x);
-					tls_y_buffer.push_back(pos100.y);
-					tls_z_buffer.push_back(pos100.z);
-
-					Vector3f pos010 = pos000;
-					pos010.y += step;
-					tls_x_buffer.push_back(pos010.x);
-					tls_y_buffer.push_back(pos010.y);
-					tls_z_buffer.push_back(pos010.z);
-
-					Vector3f pos001 = pos000;
-					pos001.z += step;
-					tls_x_buffer.push_back(pos001.x);
-					tls_y_buffer.push_back(pos001.y);
-					tls_z_buffer.push_back(pos001.z);
-				}
-			}
-		}
-
-		tls_sdf_buffer.resize(tls_x_buffer.size());
+		// Resizing as we go, because depending on settings we may have to skip some cells.
+		// Normals of batched tiles are written later, but their location is known now.
+		const unsigned int tile_begin = normal_map_data.normals.size();
+		normal_map_data.normals.resize(normal_map_data.normals.size() + tile_output_size);
+
+		if (cell_has_edits) {
+			// Edits are only gathered around the current tile, so it can't be batched with others
+			static thread_local TileSampleBuffers tls_tile_samples;
+			tls_tile_samples.clear();
+
+			gather_tile_samples(
+					baked_triangles,
+					triangle_count,
+					quad_origin_world,
+					direction,
+					ax,
+					ay,
+					cell_size,
+					step,
+					tile_resolution,
+					origin_in_voxels,
+					tls_tile_samples
+			);
 
-		{
-			const VoxelDataGrid *edits_grid = cell_has_edits ? &tls_voxel_data_grid : nullptr;
-			const VoxelModifierStack *modifiers = voxel_data != nullptr ? &voxel_data->get_modifiers() : nullptr;
+			tls_tile_samples.sdf.resize(tls_tile_samples.x.size());
 
 			// Query voxel data
 			query_sdf(
 					generator,
-					edits_grid,
+					&tls_voxel_data_grid,
 					modifiers,
-					to_span(tls_x_buffer),
-					to_span(tls_y_buffer),
-					to_span(tls_z_buffer),
-					to_span(tls_sdf_buffer),
+					to_span(tls_tile_samples.x),
+					to_span(tls_tile_samples.y),
+					to_span(tls_tile_samples.z),
+					to_span(tls_tile_samples.sdf),
 					cell_origin_world,
-					cell_origin_world + Vector3f(cell_size)
+					cell_end_world
 			);
-		}
-
-		static thread_local StdVector<Vector3f> tls_tile_normals;
-		tls_tile_normals.clear();
-		tls_tile_normals.resize(math::squared(tile_resolution));
-
-		// Compute normals from SDF results
-		{
-			ZN_PROFILE_SCOPE_NAMED("Compute normals");
-			ZN_ASSERT(tls_tile_sample_positions.size() == tls_tile_sample_triangle_index.size());
 
-			unsigned int bi = 0;
+			compute_tile_normals(
+					to_span(tls_tile_samples.sdf),
+					to_span(tls_tile_samples.positions),
+					to_span(tls_tile_samples.triangle_indices),
+					to_span(triangle_normals),
+					tile_resolution,
+					max_deviation_cosine,
+					max_deviation_sine,
+					octahedral_encoding,
+					to_span_from_position_and_size(normal_map_data.normals, tile_begin, tile_output_size)
+			);
 
-			for (unsigned int si = 0; si < tls_tile_sample_positions.size(); ++si) {
-				const Vector2i sample_position = tls_tile_sample_positions[si];
-				const uint8_t sample_tri_index = tls_tile_sample_triangle_index[si];
+		} else {
+			BatchedTile batched_tile;
+			batched_tile.sample_begin = tls_batch_samples.positions.size();
+			batched_tile.output_begin = tile_begin;
+			batched_tile.triangle_normals = triangle_normals;
+
+			gather_tile_samples(
+					baked_triangles,
+					triangle_count,
+					quad_origin_world,
+					direction,
+					ax,
+					ay,
+					cell_size,
+					step,
+					tile_resolution,
+					origin_in_voxels,
+					tls_batch_samples
+			);
 
-				const unsigned int bi000 = bi;
-				const unsigned int bi100 = bi + 1;
-				const unsigned int bi010 = bi + 2;
-				const unsigned int bi001 = bi + 3;
-				bi += 4;
-				// TODO I wish this was solved https://github.com/godotengine/godot/issues/31608
-#ifdef DEBUG_ENABLED
-				ZN_ASSERT(bi000 < tls_sdf_buffer.size());
-				ZN_ASSERT(bi100 < tls_sdf_buffer.size());
-				ZN_ASSERT(bi010 < tls_sdf_buffer.size());
-				ZN_ASSERT(bi001 < tls_sdf_buffer.size());
-#endif
-				const float sd000 = tls_sdf_buffer[bi000];
-				const float sd100 = tls_sdf_buffer[bi100];
-				const float sd010 = tls_sdf_buffer[bi010];
-				const float sd001 = tls_sdf_buffer[bi001];
-
-				Vector3f normal = math::normalized(Vector3f(sd100 - sd000, sd010 - sd000, sd001 - sd000));
-
-				// Clamp normals if their dot product with triangle normal is higher than a threshold.
-				// This helps avoiding flipped normals on very low LODs because bias is very high. In the
-				// SolarSystem demo it can pick up caves from the surface which results in black spots.
-				const Vector3f &tri_normal = triangle_normals[sample_tri_index];
-				const float tdot = math::dot(normal, tri_normal);
-				if (tdot < max_deviation_cosine) {
-					if (tdot < -0.999) {
-						normal = tri_normal;
-					} else {
-						const Vector3f axis = math::normalized(math::cross(tri_normal, normal));
-						normal = math::rotated(tri_normal, axis, max_deviation_cosine, max_deviation_sine);
-					}
-				}
+			batched_tile.sample_count = tls_batch_samples.positions.size() - batched_tile.sample_begin;
 
-				const unsigned int normal_index = sample_position.x + sample_position.y * tile_resolution;
-#ifdef DEBUG_ENABLED
-				ZN_ASSERT(normal_index < tls_tile_normals.size());
-#endif
-				tls_tile_normals[normal_index] = normal;
+			if (tls_batched_tiles.size() == 0) {
+				batch_min_pos = cell_origin_world;
+				batch_max_pos = cell_end_world;
+			} else {
+				batch_min_pos = math::min(batch_min_pos, cell_origin_world);
+				batch_max_pos = math::max(batch_max_pos, cell_end_world);
 			}
-		}
-
-		for (unsigned int dilation_steps = 0; dilation_steps < 2; ++dilation_steps) {
-			// Fill up some pixels around triangle borders, to give some margin when sampling near them in shader
-			dilate_normalmap(to_span(tls_tile_normals), Vector2i(tile_resolution, tile_resolution));
-		}
+			tls_batched_tiles.push_back(batched_tile);
 
-		// Resizing as we go, because depending on settings we may have to skip some cells
-		const unsigned int tile_begin = normal_map_data.normals.size();
-		normal_map_data.normals.resize(
-				normal_map_data.normals.size() + math::squared(tile_resolution) * encoded_normal_size
-		);
-
-		// Encode normals
-		if (octahedral_encoding) {
-			for (unsigned int i = 0; i < tls_tile_normals.size(); ++i) {
-				const unsigned int offset = tile_begin + i * encoded_normal_size;
-				ZN_ASSERT(offset + encoded_normal_size <= normal_map_data.normals.size());
-				const Vector2f n = encode_normal_octahedron(tls_tile_normals[i]);
-				normal_map_data.normals[offset + 0] = unorm_to_u8(n.x);
-				normal_map_data.normals[offset + 1] = unorm_to_u8(n.y);
-			}
-		} else {
-			for (unsigned int i = 0; i < tls_tile_normals.size(); ++i) {
-				const unsigned int offset = tile_begin + i * encoded_normal_size; //
-				ZN_ASSERT(offset + encoded_normal_size <= normal_map_data.normals.size());
-				const Vector3f n = encode_normal_xyz(tls_tile_normals[i]);
-				normal_map_data.normals[offset + 0] = unorm_to_u8(n.x);
-				normal_map_data.normals[offset + 1] = unorm_to_u8(n.y);
-				normal_map_data.normals[offset + 2] = unorm_to_u8(n.z);
+			if (tls_batch_samples.x.size() >= CPU_DETAIL_TEXTURE_BATCH_SAMPLE_COUNT) {
+				flush_batch();
 			}
 		}
 	}
 
+	flush_batch();
+
 	if (skipped_count_due_to_high_volume > 0) {
 		// Logging here to reduce spam
 		ZN_PRINT_VERBOSE(format(
@@ -857,6 +998,21 @@ DetailTextures store_normalmap_data_to_textures(const DetailImages &data) {
 	return textures;
 }
 
+uint64_t get_detail_textures_size_in_bytes(const DetailTextures &textures) {
+	uint64_t size = 0;
+	if (textures.atlas.is_valid()) {
+		size += 4 * static_cast<uint64_t>(textures.atlas->get_width()) * textures.atlas->get_height();
+#ifdef VOXEL_VIRTUAL_TEXTURE_USE_TEXTURE_ARRAY
+		size *= textures.atlas->get_layers();
+#endif
+	}
+	if (textures.lookup.is_valid()) {
+		// RG8
+		size += 2 * static_cast<uint64_t>(textures.lookup->get_width()) * textures.lookup->get_height();
+	}
+	return size;
+}
+
 unsigned int get_detail_texture_tile_resolution_for_lod(
 		const DetailRenderingSettings &settings,
 		unsigned int lod_index
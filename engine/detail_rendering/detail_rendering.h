@@ -147,6 +147,10 @@ DetailImages store_normalmap_data_to_images(
 // This may not be allowed to run in a different thread than the main thread if the renderer is not using Vulkan.
 DetailTextures store_normalmap_data_to_textures(const DetailImages &data);
 
+// Estimates how much video memory the given textures use. Drivers usually store 3-channel textures with 4 channels, so
+// this assumes the atlas takes 4 bytes per pixel.
+uint64_t get_detail_textures_size_in_bytes(const DetailTextures &textures);
+
 struct DetailTextureOutput {
 	// Normalmap atlas used for smooth voxels.
 	// If textures can't be created from threads, images are returned instead.
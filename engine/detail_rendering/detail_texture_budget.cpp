@@ -0,0 +1,109 @@
+#include "detail_texture_budget.h"
+#include "../../util/errors.h"
+#include "../../util/profiling.h"
+#include <algorithm>
+
+namespace zylann::voxel {
+
+void DetailTextureBudget::set_budget_bytes(uint64_t budget) {
+	_budget = budget;
+}
+
+void DetailTextureBudget::add(
+		Vector3i position,
+		unsigned int lod_index,
+		uint64_t size_in_bytes,
+		bool visible,
+		uint64_t time
+) {
+	ZN_ASSERT_RETURN(lod_index < _lods.size());
+	Entry &entry = _lods[lod_index][position];
+	_used -= entry.size_in_bytes;
+	_used += size_in_bytes;
+	entry.size_in_bytes = size_in_bytes;
+	entry.last_visible_time = time;
+	entry.visible = visible;
+}
+
+void DetailTextureBudget::remove(Vector3i position, unsigned int lod_index) {
+	ZN_ASSERT_RETURN(lod_index < _lods.size());
+	StdUnorderedMap<Vector3i, Entry> &map = _lods[lod_index];
+	auto it = map.find(position);
+	if (it != map.end()) {
+		_used -= it->second.size_in_bytes;
+		map.erase(it);
+	}
+}
+
+void DetailTextureBudget::set_visible(Vector3i position, unsigned int lod_index, bool visible, uint64_t time) {
+	ZN_ASSERT_RETURN(lod_index < _lods.size());
+	StdUnorderedMap<Vector3i, Entry> &map = _lods[lod_index];
+	auto it = map.find(position);
+	if (it != map.end()) {
+		Entry &entry = it->second;
+		if (entry.visible && !visible) {
+			entry.last_visible_time = time;
+		}
+		entry.visible = visible;
+	}
+}
+
+void DetailTextureBudget::clear() {
+	for (StdUnorderedMap<Vector3i, Entry> &map : _lods) {
+		map.clear();
+	}
+	_used = 0;
+}
+
+unsigned int DetailTextureBudget::get_count() const {
+	unsigned int count = 0;
+	for (const StdUnorderedMap<Vector3i, Entry> &map : _lods) {
+		count += map.size();
+	}
+	return count;
+}
+
+void DetailTextureBudget::evict(StdVector<Key> &out_evicted) {
+	if (_budget == 0 || _used <= _budget) {
+		return;
+	}
+	ZN_PROFILE_SCOPE();
+
+	struct Candidate {
+		Key key;
+		uint64_t last_visible_time;
+		uint64_t size_in_bytes;
+	};
+
+	static thread_local StdVector<Candidate> tls_candidates;
+	tls_candidates.clear();
+
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		for (auto it = _lods[lod_index].begin(); it != _lods[lod_index].end(); ++it) {
+			const Entry &entry = it->second;
+			if (!entry.visible) {
+				const Key key{ it->first, static_cast<uint8_t>(lod_index) };
+				tls_candidates.push_back(Candidate{ key, entry.last_visible_time, entry.size_in_bytes });
+			}
+		}
+	}
+
+	// Least recently visible first. When equal, evict larger textures first.
+	std::sort(tls_candidates.begin(), tls_candidates.end(), [](const Candidate &a, const Candidate &b) {
+		if (a.last_visible_time != b.last_visible_time) {
+			return a.last_visible_time < b.last_visible_time;
+		}
+		return a.size_in_bytes > b.size_in_bytes;
+	});
+
+	for (const Candidate &candidate : tls_candidates) {
+		if (_used <= _budget) {
+			break;
+		}
+		_lods[candidate.key.lod_index].erase(candidate.key.position);
+		_used -= candidate.size_in_bytes;
+		out_evicted.push_back(candidate.key);
+	}
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,59 @@
+#ifndef VOXEL_DETAIL_TEXTURE_BUDGET_H
+#define VOXEL_DETAIL_TEXTURE_BUDGET_H
+
+#include "../../constants/voxel_constants.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/vector3i.h"
+
+namespace zylann::voxel {
+
+// Keeps track of detail textures resident in video memory for each mesh block, so their total size can be kept under a
+// fixed budget. When the budget is exceeded, textures of blocks that were not visible for the longest time are evicted
+// first. Textures of visible blocks are never evicted, so the budget can still be exceeded if they don't fit.
+// Must be used from the main thread.
+class DetailTextureBudget {
+public:
+	struct Key {
+		Vector3i position;
+		uint8_t lod_index;
+	};
+
+	// 0 means unlimited
+	void set_budget_bytes(uint64_t budget);
+	uint64_t get_budget_bytes() const {
+		return _budget;
+	}
+
+	// Registers the textures of a block, replacing previous ones if any
+	void add(Vector3i position, unsigned int lod_index, uint64_t size_in_bytes, bool visible, uint64_t time);
+	void remove(Vector3i position, unsigned int lod_index);
+	void set_visible(Vector3i position, unsigned int lod_index, bool visible, uint64_t time);
+	void clear();
+
+	// Picks textures to evict until usage fits the budget, removing them from the tracked set.
+	void evict(StdVector<Key> &out_evicted);
+
+	uint64_t get_used_bytes() const {
+		return _used;
+	}
+
+	unsigned int get_count() const;
+
+private:
+	struct Entry {
+		uint64_t size_in_bytes = 0;
+		// Last time the block went out of view
+		uint64_t last_visible_time = 0;
+		bool visible = false;
+	};
+
+	FixedArray<StdUnorderedMap<Vector3i, Entry>, constants::MAX_LOD> _lods;
+	uint64_t _budget = 0;
+	uint64_t _used = 0;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_DETAIL_TEXTURE_BUDGET_H
@@ -19,6 +19,17 @@ using namespace zylann::godot;
 
 namespace zylann::voxel {
 
+void RenderDetailTextureGPUTask::prepare_cpu() {
+	ZN_PROFILE_SCOPE();
+
+	copy_bytes_to<Vector4f>(_mesh_vertices_pba, to_span(mesh_vertices));
+	copy_bytes_to<int32_t>(_mesh_indices_pba, to_span(mesh_indices));
+	copy_bytes_to<int32_t>(_cell_triangles_pba, to_span(cell_triangles));
+	copy_bytes_to<TileData>(_tile_data_pba, to_span(tile_data));
+
+	_cpu_prepared = true;
+}
+
 void RenderDetailTextureGPUTask::prepare(GPUTaskContext &ctx) {
 	ZN_PROFILE_SCOPE();
 	ZN_DSTACK();
@@ -30,6 +41,10 @@ void RenderDetailTextureGPUTask::prepare(GPUTaskContext &ctx) {
 	ERR_FAIL_COND(shader == nullptr);
 	ERR_FAIL_COND(!shader->is_valid());
 
+	if (!_cpu_prepared) {
+		prepare_cpu();
+	}
+
 	RenderingDevice &rd = ctx.rendering_device;
 	GPUStorageBufferPool &storage_buffer_pool = ctx.storage_buffer_pool;
 
@@ -92,10 +107,8 @@ void RenderDetailTextureGPUTask::prepare(GPUTaskContext &ctx) {
 
 	// Mesh vertices
 
-	PackedByteArray mesh_vertices_pba;
-	copy_bytes_to<Vector4f>(mesh_vertices_pba, to_span(mesh_vertices));
-
-	_mesh_vertices_sb = storage_buffer_pool.allocate(mesh_vertices_pba);
+	_mesh_vertices_sb = storage_buffer_pool.allocate(_mesh_vertices_pba);
+	_mesh_vertices_pba = PackedByteArray();
 	ERR_FAIL_COND(_mesh_vertices_sb.is_null());
 
 	Ref<RDUniform> mesh_vertices_uniform;
@@ -105,10 +118,8 @@ void RenderDetailTextureGPUTask::prepare(GPUTaskContext &ctx) {
 
 	// Mesh indices
 
-	PackedByteArray mesh_indices_pba;
-	copy_bytes_to<int32_t>(mesh_indices_pba, to_span(mesh_indices));
-
-	_mesh_indices_sb = storage_buffer_pool.allocate(mesh_indices_pba);
+	_mesh_indices_sb = storage_buffer_pool.allocate(_mesh_indices_pba);
+	_mesh_indices_pba = PackedByteArray();
 	ERR_FAIL_COND(_mesh_indices_sb.is_null());
 
 	Ref<RDUniform> mesh_indices_uniform;
@@ -118,10 +129,8 @@ void RenderDetailTextureGPUTask::prepare(GPUTaskContext &ctx) {
 
 	// Cell tris
 
-	PackedByteArray cell_triangles_pba;
-	copy_bytes_to<int32_t>(cell_triangles_pba, to_span(cell_triangles));
-
-	_cell_triangles_sb = storage_buffer_pool.allocate(cell_triangles_pba);
+	_cell_triangles_sb = storage_buffer_pool.allocate(_cell_triangles_pba);
+	_cell_triangles_pba = PackedByteArray();
 	ERR_FAIL_COND(_cell_triangles_sb.is_null());
 
 	Ref<RDUniform> cell_triangles_uniform;
@@ -131,10 +140,8 @@ void RenderDetailTextureGPUTask::prepare(GPUTaskContext &ctx) {
 
 	// Tiles data
 
-	PackedByteArray tile_data_pba;
-	copy_bytes_to<TileData>(tile_data_pba, to_span(tile_data));
-
-	_tile_data_sb = storage_buffer_pool.allocate(tile_data_pba);
+	_tile_data_sb = storage_buffer_pool.allocate(_tile_data_pba);
+	_tile_data_pba = PackedByteArray();
 	ERR_FAIL_COND(_tile_data_sb.is_null());
 
 	Ref<RDUniform> tile_data_uniform;
@@ -70,6 +70,7 @@ public:
 	VolumeID volume_id;
 	uint8_t lod_index;
 
+	void prepare_cpu() override;
 	void prepare(GPUTaskContext &ctx) override;
 	void collect(GPUTaskContext &ctx) override;
 
@@ -77,6 +78,13 @@ public:
 	PackedByteArray collect_texture_and_cleanup(RenderingDevice &rd, GPUStorageBufferPool &storage_buffer_pool);
 
 private:
+	// Input data packed for upload, which can be done before the rendering device is available
+	PackedByteArray _mesh_vertices_pba;
+	PackedByteArray _mesh_indices_pba;
+	PackedByteArray _cell_triangles_pba;
+	PackedByteArray _tile_data_pba;
+	bool _cpu_prepared = false;
+
 	RID _normalmap_texture0_rid;
 	RID _normalmap_texture1_rid;
 
@@ -144,6 +144,10 @@ TaskPriority RenderDetailTextureTask::get_priority() {
 	return p;
 }
 
+int RenderDetailTextureTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
 bool RenderDetailTextureTask::is_cancelled() {
 	// TODO Cancel if too far?
 	return false;
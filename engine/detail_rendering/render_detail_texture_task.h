@@ -1,6 +1,7 @@
 #ifndef VOXEL_RENDER_DETAIL_TEXTURE_TASK_H
 #define VOXEL_RENDER_DETAIL_TEXTURE_TASK_H
 
+#include "../../constants/voxel_constants.h"
 #include "../../generators/voxel_generator.h"
 #include "../../meshers/voxel_mesher.h"
 #include "../../util/containers/std_vector.h"
@@ -46,10 +47,15 @@ public:
 		return "RenderDetailTexture";
 	}
 
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_DETAIL_TEXTURE;
+	}
+
 	void run(ThreadedTaskContext &ctx) override;
 	void apply_result() override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 
 	// This is exposed for testing
 	RenderDetailTextureGPUTask *make_gpu_task();
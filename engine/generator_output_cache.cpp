@@ -0,0 +1,105 @@
+#include "generator_output_cache.h"
+#include "../generators/voxel_generator.h"
+#include "../storage/voxel_buffer.h"
+#include "../util/hash_funcs.h"
+#include "../util/memory/memory.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+size_t GeneratorOutputCache::KeyHasher::operator()(const Key &key) const {
+	uint64_t h = hash_djb2_one_64(key.generator_id);
+	h = hash_djb2_one_64(key.generator_revision, h);
+	h = hash_djb2_one_64(key.channel_depths | (uint64_t(key.lod_index) << 16), h);
+	h = hash_djb2_one_64(Vector3iHasher::hash(key.origin_in_voxels), h);
+	h = hash_djb2_one_64(Vector3iHasher::hash(key.block_size), h);
+	return h;
+}
+
+GeneratorOutputCache::Key GeneratorOutputCache::make_key(
+		const VoxelGenerator &generator,
+		const VoxelBuffer &buffer,
+		Vector3i origin,
+		uint8_t lod_index
+) {
+	uint16_t channel_depths = 0;
+	for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+		channel_depths |= buffer.get_channel_depth(channel_index) << (channel_index * 2);
+	}
+	Key key;
+	key.generator_id = static_cast<uint64_t>(generator.get_instance_id());
+	key.generator_revision = generator.get_output_revision();
+	key.channel_depths = channel_depths;
+	key.lod_index = lod_index;
+	key.origin_in_voxels = origin;
+	key.block_size = buffer.get_size();
+	return key;
+}
+
+void GeneratorOutputCache::set_memory_budget(uint64_t budget_bytes) {
+	_memory_budget.store(budget_bytes, std::memory_order_relaxed);
+	MutexLock mlock(_mutex);
+	_blocks.evict(budget_bytes);
+}
+
+uint64_t GeneratorOutputCache::get_memory_budget() const {
+	return _memory_budget.load(std::memory_order_relaxed);
+}
+
+bool GeneratorOutputCache::try_load(const Key &key, VoxelBuffer &dst) {
+	ZN_PROFILE_SCOPE();
+	MutexLock mlock(_mutex);
+
+	std::shared_ptr<VoxelBuffer> *voxels = _blocks.get(key);
+	if (voxels == nullptr) {
+		++_misses;
+		return false;
+	}
+
+	++_hits;
+
+	// Channel data is shared, not duplicated, so this is cheap to do while locked
+	(*voxels)->copy_to(dst, true);
+	return true;
+}
+
+void GeneratorOutputCache::store(const Key &key, const VoxelBuffer &src) {
+	ZN_PROFILE_SCOPE();
+
+	const uint64_t budget = _memory_budget.load(std::memory_order_relaxed);
+	if (budget == 0) {
+		return;
+	}
+
+	std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	src.copy_to(*voxels, true);
+	voxels->compress_uniform_channels();
+	voxels->compress_palette_channels();
+
+	const uint64_t size_in_bytes = voxels->get_channels_size_in_bytes() + sizeof(VoxelBuffer);
+	if (size_in_bytes > budget) {
+		return;
+	}
+
+	MutexLock mlock(_mutex);
+	// Another task could have generated the same block at the same time, in which case it is replaced
+	_blocks.set(key, voxels, size_in_bytes);
+	_blocks.evict(budget);
+}
+
+void GeneratorOutputCache::clear() {
+	MutexLock mlock(_mutex);
+	_blocks.clear();
+}
+
+GeneratorOutputCache::Stats GeneratorOutputCache::get_stats() const {
+	MutexLock mlock(_mutex);
+	Stats stats;
+	stats.block_count = _blocks.get_count();
+	stats.memory_usage_bytes = _blocks.get_memory_usage();
+	stats.hits = _hits;
+	stats.misses = _misses;
+	return stats;
+}
+
+} // namespace zylann::voxel
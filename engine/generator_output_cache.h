@@ -0,0 +1,80 @@
+#ifndef VOXEL_GENERATOR_OUTPUT_CACHE_H
+#define VOXEL_GENERATOR_OUTPUT_CACHE_H
+
+#include "../util/containers/byte_budget_lru_map.h"
+#include "../util/math/vector3i.h"
+#include "../util/thread/mutex.h"
+#include <atomic>
+#include <memory>
+
+namespace zylann::voxel {
+
+class VoxelBuffer;
+class VoxelGenerator;
+
+// Keeps copies of blocks recently produced by generators, so terrains sharing the same generator don't generate
+// identical blocks again. Blocks are stored compressed, and the least recently used ones are dropped when the cache
+// exceeds its memory budget. Generators are assumed to be deterministic.
+// Blocks must be stored before modifiers are applied to them, since modifiers are specific to each terrain.
+// Thread-safe.
+class GeneratorOutputCache {
+public:
+	struct Key {
+		uint64_t generator_id;
+		// Changes when the generator's output changes, so outdated blocks can't be found anymore
+		uint32_t generator_revision;
+		// Depth of each channel, 2 bits per channel
+		uint16_t channel_depths;
+		uint8_t lod_index;
+		Vector3i origin_in_voxels;
+		Vector3i block_size;
+
+		bool operator==(const Key &other) const {
+			return generator_id == other.generator_id && generator_revision == other.generator_revision &&
+					channel_depths == other.channel_depths && lod_index == other.lod_index &&
+					origin_in_voxels == other.origin_in_voxels && block_size == other.block_size;
+		}
+	};
+
+	struct KeyHasher {
+		size_t operator()(const Key &key) const;
+	};
+
+	// The format of `buffer` is part of the key, so it must be created with the size and channel depths expected from
+	// the generator.
+	static Key make_key(const VoxelGenerator &generator, const VoxelBuffer &buffer, Vector3i origin, uint8_t lod_index);
+
+	// A budget of 0 disables the cache.
+	void set_memory_budget(uint64_t budget_bytes);
+	uint64_t get_memory_budget() const;
+
+	inline bool is_enabled() const {
+		return _memory_budget.load(std::memory_order_relaxed) > 0;
+	}
+
+	// Copies the cached block into `dst`. Returns false if the block isn't in the cache.
+	bool try_load(const Key &key, VoxelBuffer &dst);
+	void store(const Key &key, const VoxelBuffer &src);
+
+	void clear();
+
+	struct Stats {
+		unsigned int block_count;
+		uint64_t memory_usage_bytes;
+		uint64_t hits;
+		uint64_t misses;
+	};
+
+	Stats get_stats() const;
+
+private:
+	ByteBudgetLRUMap<Key, std::shared_ptr<VoxelBuffer>, KeyHasher> _blocks;
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+	std::atomic<uint64_t> _memory_budget = { 0 };
+	mutable Mutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_GENERATOR_OUTPUT_CACHE_H
@@ -0,0 +1,148 @@
+#include "compute_resource_cache.h"
+#include "../../util/errors.h"
+#include "../../util/godot/classes/rd_uniform.h"
+#include "../../util/hash_funcs.h"
+#include "../../util/io/log.h"
+#include "../../util/profiling.h"
+
+namespace zylann::voxel {
+
+ComputeResourceCache::ComputeResourceCache(RenderingDevice &rd) : _rendering_device(rd) {}
+
+ComputeResourceCache::~ComputeResourceCache() {
+	clear();
+}
+
+RID ComputeResourceCache::get_or_create_compute_pipeline(RID shader_rid) {
+	RenderingDevice &rd = _rendering_device;
+
+	auto it = _compute_pipelines.find(shader_rid.get_id());
+	if (it != _compute_pipelines.end()) {
+		if (rd.compute_pipeline_is_valid(it->second)) {
+			return it->second;
+		}
+		// The shader was freed and its pipeline with it
+		_compute_pipelines.erase(it);
+	}
+
+	ZN_PROFILE_SCOPE();
+	const RID pipeline_rid = rd.compute_pipeline_create(shader_rid);
+	ZN_ASSERT_RETURN_V(pipeline_rid.is_valid(), RID());
+	_compute_pipelines.insert({ shader_rid.get_id(), pipeline_rid });
+	return pipeline_rid;
+}
+
+RID ComputeResourceCache::get_or_create_uniform_set(const Array &uniforms, RID shader_rid, int shader_set) {
+	RenderingDevice &rd = _rendering_device;
+
+	StdVector<uint64_t> &key = _temp_key;
+	key.clear();
+	key.push_back(shader_rid.get_id());
+	key.push_back(shader_set);
+	for (int i = 0; i < uniforms.size(); ++i) {
+		Ref<RDUniform> uniform = uniforms[i];
+		ZN_ASSERT_CONTINUE(uniform.is_valid());
+		key.push_back(uniform->get_uniform_type());
+		key.push_back(uniform->get_binding());
+		const Array ids = uniform->get_ids();
+		key.push_back(ids.size());
+		for (int j = 0; j < ids.size(); ++j) {
+			const RID id = ids[j];
+			key.push_back(id.get_id());
+		}
+	}
+
+	uint64_t hash = hash_djb2_one_64(0);
+	for (const uint64_t v : key) {
+		hash = hash_djb2_one_64(v, hash);
+	}
+
+	auto it = _uniform_sets.find(hash);
+	if (it != _uniform_sets.end()) {
+		UniformSet &cached_set = it->second;
+		if (rd.uniform_set_is_valid(cached_set.rid)) {
+			if (cached_set.key == key) {
+				return cached_set.rid;
+			}
+			// Different set with the same hash. It is rare enough to not be cached. The set might be in use by the
+			// current batch, so it isn't replaced.
+			ZN_PROFILE_SCOPE_NAMED("Uncached uniform set");
+			const RID uniform_set_rid = zylann::godot::uniform_set_create(rd, uniforms, shader_rid, shader_set);
+			ZN_ASSERT_RETURN_V(uniform_set_rid.is_valid(), RID());
+			_uncached_uniform_sets.push_back(uniform_set_rid);
+			return uniform_set_rid;
+		}
+		// One of its dependencies was freed, so RenderingDevice freed it too
+		_uniform_sets.erase(it);
+	}
+
+	ZN_PROFILE_SCOPE();
+	const RID uniform_set_rid = zylann::godot::uniform_set_create(rd, uniforms, shader_rid, shader_set);
+	ZN_ASSERT_RETURN_V(uniform_set_rid.is_valid(), RID());
+	_uniform_sets.insert({ hash, UniformSet{ uniform_set_rid, key } });
+	return uniform_set_rid;
+}
+
+void ComputeResourceCache::free_uncached_uniform_sets() {
+	RenderingDevice &rd = _rendering_device;
+	for (const RID rid : _uncached_uniform_sets) {
+		if (rd.uniform_set_is_valid(rid)) {
+			zylann::godot::free_rendering_device_rid(rd, rid);
+		}
+	}
+	_uncached_uniform_sets.clear();
+}
+
+void ComputeResourceCache::prune() {
+	ZN_PROFILE_SCOPE();
+	RenderingDevice &rd = _rendering_device;
+
+	free_uncached_uniform_sets();
+
+	for (auto it = _uniform_sets.begin(); it != _uniform_sets.end();) {
+		if (rd.uniform_set_is_valid(it->second.rid)) {
+			++it;
+		} else {
+			it = _uniform_sets.erase(it);
+		}
+	}
+
+	for (auto it = _compute_pipelines.begin(); it != _compute_pipelines.end();) {
+		if (rd.compute_pipeline_is_valid(it->second)) {
+			++it;
+		} else {
+			it = _compute_pipelines.erase(it);
+		}
+	}
+
+	// Sets still referring to live resources may never be used again, so the cache is reset when it grows too much
+	if (_uniform_sets.size() > MAX_UNIFORM_SETS) {
+		ZN_PRINT_VERBOSE("Clearing compute uniform set cache");
+		for (auto it = _uniform_sets.begin(); it != _uniform_sets.end(); ++it) {
+			zylann::godot::free_rendering_device_rid(rd, it->second.rid);
+		}
+		_uniform_sets.clear();
+	}
+}
+
+void ComputeResourceCache::clear() {
+	RenderingDevice &rd = _rendering_device;
+
+	free_uncached_uniform_sets();
+
+	for (auto it = _uniform_sets.begin(); it != _uniform_sets.end(); ++it) {
+		if (rd.uniform_set_is_valid(it->second.rid)) {
+			zylann::godot::free_rendering_device_rid(rd, it->second.rid);
+		}
+	}
+	_uniform_sets.clear();
+
+	for (auto it = _compute_pipelines.begin(); it != _compute_pipelines.end(); ++it) {
+		if (rd.compute_pipeline_is_valid(it->second)) {
+			zylann::godot::free_rendering_device_rid(rd, it->second);
+		}
+	}
+	_compute_pipelines.clear();
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,52 @@
+#ifndef VOXEL_COMPUTE_RESOURCE_CACHE_H
+#define VOXEL_COMPUTE_RESOURCE_CACHE_H
+
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/rendering_device.h"
+
+namespace zylann::voxel {
+
+// Keeps compute pipelines and uniform sets alive so they can be re-used by the next batches of GPU tasks, instead of
+// creating them every time. Tasks tend to use the same shaders with the same buffers, since storage buffers are pooled.
+// Resources depending on a freed shader or buffer are freed by RenderingDevice, so they are checked before re-use.
+// Not thread-safe.
+class ComputeResourceCache {
+public:
+	ComputeResourceCache(RenderingDevice &rd);
+	~ComputeResourceCache();
+
+	// Resources returned by the cache are owned by the cache, they must not be freed.
+	RID get_or_create_compute_pipeline(RID shader_rid);
+	RID get_or_create_uniform_set(const Array &uniforms, RID shader_rid, int shader_set);
+
+	// Forgets resources freed by RenderingDevice and limits the size of the cache. Must only be called when no work
+	// using resources of the cache is pending, like after syncing with the device.
+	void prune();
+
+	void clear();
+
+private:
+	static const unsigned int MAX_UNIFORM_SETS = 4096;
+
+	void free_uncached_uniform_sets();
+
+	struct UniformSet {
+		RID rid;
+		// Full description of the uniform set, in case different sets have the same hash
+		StdVector<uint64_t> key;
+	};
+
+	RenderingDevice &_rendering_device;
+	// Shader RID => pipeline
+	StdUnorderedMap<uint64_t, RID> _compute_pipelines;
+	// Hash of the uniform set description => uniform set
+	StdUnorderedMap<uint64_t, UniformSet> _uniform_sets;
+	// Uniform sets which could not be cached, freed after the work using them is done
+	StdVector<RID> _uncached_uniform_sets;
+	StdVector<uint64_t> _temp_key;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_COMPUTE_RESOURCE_CACHE_H
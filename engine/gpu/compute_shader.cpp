@@ -1,12 +1,111 @@
 #include "compute_shader.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/file_access.h"
 #include "../../util/godot/classes/rd_shader_source.h"
+#include "../../util/godot/classes/rd_shader_spirv.h"
 #include "../../util/godot/core/array.h" // for `varray` in GDExtension builds
 #include "../../util/godot/core/print_string.h"
+#include "../../util/godot/file_utils.h"
+#include "../../util/io/log.h"
+#include "../../util/math/funcs.h"
 #include "../../util/profiling.h"
+#include "../../util/thread/mutex.h"
+#include "../../util/thread/thread.h"
 #include "../voxel_engine.h"
+#include <atomic>
+#include <cstring>
 
 namespace zylann::voxel {
 
+namespace {
+
+// Compiling GLSL into SPIR-V is slow, so results are saved to disk and re-used next time the same source is compiled,
+// typically when the project starts again.
+
+const char *SHADER_CACHE_DIRECTORY = "user://voxel_shader_cache";
+const uint32_t SHADER_CACHE_MAGIC = 0x43535856; // "VXSC"
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+// Shaders may be compiled from different threads
+BinaryMutex g_shader_cache_mutex;
+
+String get_shader_cache_file_path(const String &source_text) {
+	return String(SHADER_CACHE_DIRECTORY).path_join(String::num_uint64(source_text.hash(), 16) + ".spv");
+}
+
+// Returns null if the shader isn't in the cache. The source is saved with the bytecode and compared, so files with the
+// same hash but a different source are not used.
+Ref<RDShaderSPIRV> load_cached_spirv(const String &source_text) {
+	ZN_PROFILE_SCOPE();
+	MutexLock mlock(g_shader_cache_mutex);
+
+	Error err;
+	Ref<FileAccess> f = zylann::godot::open_file(get_shader_cache_file_path(source_text), FileAccess::READ, err);
+	if (f.is_null()) {
+		return Ref<RDShaderSPIRV>();
+	}
+
+	if (f->get_32() != SHADER_CACHE_MAGIC || f->get_32() != SHADER_CACHE_VERSION) {
+		return Ref<RDShaderSPIRV>();
+	}
+
+	const CharString source_utf8 = source_text.utf8();
+	const uint32_t source_size = f->get_32();
+	if (source_size != static_cast<uint32_t>(source_utf8.length())) {
+		return Ref<RDShaderSPIRV>();
+	}
+	StdVector<uint8_t> cached_source;
+	cached_source.resize(source_size);
+	if (zylann::godot::get_buffer(**f, to_span(cached_source)) != source_size ||
+		memcmp(cached_source.data(), source_utf8.get_data(), source_size) != 0) {
+		return Ref<RDShaderSPIRV>();
+	}
+
+	const uint32_t spirv_size = f->get_32();
+	if (spirv_size == 0 || spirv_size > f->get_length() - f->get_position()) {
+		return Ref<RDShaderSPIRV>();
+	}
+	PackedByteArray spirv;
+	spirv.resize(spirv_size);
+	if (zylann::godot::get_buffer(**f, Span<uint8_t>(spirv.ptrw(), spirv_size)) != spirv_size) {
+		return Ref<RDShaderSPIRV>();
+	}
+
+	Ref<RDShaderSPIRV> shader_spirv;
+	shader_spirv.instantiate();
+	shader_spirv->set_stage_bytecode(RenderingDevice::SHADER_STAGE_COMPUTE, spirv);
+	return shader_spirv;
+}
+
+void save_cached_spirv(const String &source_text, const PackedByteArray &spirv) {
+	ZN_PROFILE_SCOPE();
+	MutexLock mlock(g_shader_cache_mutex);
+
+	if (zylann::godot::check_directory_created(SHADER_CACHE_DIRECTORY) != OK) {
+		return;
+	}
+
+	Error err;
+	Ref<FileAccess> f = zylann::godot::open_file(get_shader_cache_file_path(source_text), FileAccess::WRITE, err);
+	if (f.is_null()) {
+		ZN_PRINT_VERBOSE("Could not write compute shader to cache");
+		return;
+	}
+
+	const CharString source_utf8 = source_text.utf8();
+	f->store_32(SHADER_CACHE_MAGIC);
+	f->store_32(SHADER_CACHE_VERSION);
+	f->store_32(source_utf8.length());
+	zylann::godot::store_buffer(
+			**f, Span<const uint8_t>(reinterpret_cast<const uint8_t *>(source_utf8.get_data()), source_utf8.length())
+	);
+	f->store_32(spirv.size());
+	zylann::godot::store_buffer(**f, to_span(spirv));
+}
+
+} // namespace
+
 ComputeShader::ComputeShader() {}
 
 ComputeShader::ComputeShader(RID p_rid) : _rid(p_rid) {}
@@ -45,9 +144,12 @@ String format_source_code_with_line_numbers(String src) {
 	return dst;
 }
 
-void ComputeShader::load_from_glsl(String source_text, String name) {
+namespace {
+
+// Returns null if compilation failed. Doesn't create anything on the rendering device, so it may be called from
+// multiple threads.
+Ref<RDShaderSPIRV> compile_glsl_to_spirv(RenderingDevice &rd, const String &source_text, const String &name) {
 	ZN_PROFILE_SCOPE();
-	clear();
 
 	// For debugging
 	// {
@@ -56,17 +158,22 @@ void ComputeShader::load_from_glsl(String source_text, String name) {
 	// 	f->store_string(source_text);
 	// }
 
+	const bool use_cache = VoxelEngine::get_singleton().is_shader_cache_enabled();
+
+	if (use_cache) {
+		Ref<RDShaderSPIRV> cached_spirv = load_cached_spirv(source_text);
+		if (cached_spirv.is_valid()) {
+			return cached_spirv;
+		}
+	}
+
 	Ref<RDShaderSource> shader_source;
 	shader_source.instantiate();
 	shader_source->set_language(RenderingDevice::SHADER_LANGUAGE_GLSL);
 	shader_source->set_stage_source(RenderingDevice::SHADER_STAGE_COMPUTE, source_text);
 
-	ZN_ASSERT_RETURN(VoxelEngine::get_singleton().has_rendering_device());
-	RenderingDevice &rd = VoxelEngine::get_singleton().get_rendering_device();
-	// MutexLock mlock(VoxelEngine::get_singleton().get_rendering_device_mutex());
-
 	Ref<RDShaderSPIRV> shader_spirv = zylann::godot::shader_compile_spirv_from_source(rd, **shader_source, false);
-	ERR_FAIL_COND(shader_spirv.is_null());
+	ERR_FAIL_COND_V(shader_spirv.is_null(), Ref<RDShaderSPIRV>());
 
 	const String error_message = shader_spirv->get_stage_compile_error(RenderingDevice::SHADER_STAGE_COMPUTE);
 	if (error_message != "") {
@@ -78,6 +185,28 @@ void ComputeShader::load_from_glsl(String source_text, String name) {
 			::print_line(formatted_source_text);
 		}
 
+		return Ref<RDShaderSPIRV>();
+	}
+
+	if (use_cache) {
+		save_cached_spirv(source_text, shader_spirv->get_stage_bytecode(RenderingDevice::SHADER_STAGE_COMPUTE));
+	}
+
+	return shader_spirv;
+}
+
+} // namespace
+
+void ComputeShader::load_from_glsl(String source_text, String name) {
+	ZN_PROFILE_SCOPE();
+	clear();
+
+	ZN_ASSERT_RETURN(VoxelEngine::get_singleton().has_rendering_device());
+	RenderingDevice &rd = VoxelEngine::get_singleton().get_rendering_device();
+	// MutexLock mlock(VoxelEngine::get_singleton().get_rendering_device_mutex());
+
+	Ref<RDShaderSPIRV> shader_spirv = compile_glsl_to_spirv(rd, source_text, name);
+	if (shader_spirv.is_null()) {
 		return;
 	}
 
@@ -88,6 +217,76 @@ void ComputeShader::load_from_glsl(String source_text, String name) {
 	_rid = shader_rid;
 }
 
+void ComputeShader::load_from_glsl_multithreaded(Span<const GLSLSource> sources) {
+	ZN_PROFILE_SCOPE();
+
+	if (sources.size() == 0) {
+		return;
+	}
+
+	ZN_ASSERT_RETURN(VoxelEngine::get_singleton().has_rendering_device());
+	RenderingDevice &rd = VoxelEngine::get_singleton().get_rendering_device();
+
+	struct Context {
+		RenderingDevice *rd;
+		Span<const GLSLSource> sources;
+		StdVector<Ref<RDShaderSPIRV>> results;
+		std::atomic_uint32_t next_index = { 0 };
+
+		void run() {
+			for (unsigned int i = next_index++; i < sources.size(); i = next_index++) {
+				results[i] = compile_glsl_to_spirv(*rd, sources[i].text, sources[i].name);
+			}
+		}
+	};
+
+	Context context;
+	context.rd = &rd;
+	context.sources = sources;
+	context.results.resize(sources.size());
+
+	// The calling thread compiles too
+	const unsigned int MAX_EXTRA_THREADS = 8;
+	FixedArray<Thread, MAX_EXTRA_THREADS> threads;
+	const unsigned int extra_thread_count = math::min(
+			math::min(math::max(Thread::get_hardware_concurrency(), 1u), static_cast<unsigned int>(sources.size())) - 1,
+			MAX_EXTRA_THREADS
+	);
+
+	for (unsigned int i = 0; i < extra_thread_count; ++i) {
+		threads[i].start(
+				[](void *p_userdata) {
+					Context *ctx = static_cast<Context *>(p_userdata);
+					ctx->run();
+				},
+				&context
+		);
+	}
+
+	context.run();
+
+	for (unsigned int i = 0; i < extra_thread_count; ++i) {
+		threads[i].wait_to_finish();
+	}
+
+	// Shaders are created on the device from this thread only
+	for (unsigned int i = 0; i < sources.size(); ++i) {
+		const GLSLSource &source = sources[i];
+		ComputeShader &shader = *source.shader;
+		shader.clear();
+
+		const Ref<RDShaderSPIRV> &shader_spirv = context.results[i];
+		if (shader_spirv.is_null()) {
+			continue;
+		}
+
+		const RID shader_rid = zylann::godot::shader_create_from_spirv(rd, **shader_spirv, source.name);
+		ERR_CONTINUE(!shader_rid.is_valid());
+
+		shader._rid = shader_rid;
+	}
+}
+
 std::shared_ptr<ComputeShader> ComputeShader::create_from_glsl(String source_text, String name) {
 	std::shared_ptr<ComputeShader> shader = make_shared_instance<ComputeShader>();
 	shader->load_from_glsl(source_text, name);
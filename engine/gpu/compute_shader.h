@@ -1,6 +1,7 @@
 #ifndef VOXEL_COMPUTE_SHADER_H
 #define VOXEL_COMPUTE_SHADER_H
 
+#include "../../util/containers/span.h"
 #include "../../util/godot/core/rid.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/memory/memory.h"
@@ -25,6 +26,16 @@ public:
 
 	void load_from_glsl(String source_text, String name);
 
+	struct GLSLSource {
+		ComputeShader *shader;
+		String text;
+		String name;
+	};
+
+	// Loads several shaders at once. Compiling to SPIR-V is spread over multiple threads, which is faster than loading
+	// them one by one when they are not in the cache yet.
+	static void load_from_glsl_multithreaded(Span<const GLSLSource> sources);
+
 	// An invalid instance means the shader failed to compile
 	inline bool is_valid() const {
 		return _rid.is_valid();
@@ -43,6 +43,7 @@ void GPUStorageBufferPool::clear() {
 		}
 		for (GPUStorageBuffer &b : pool.buffers) {
 			godot::free_rendering_device_rid(rd, b.rid);
+			_allocated_bytes -= b.size;
 		}
 		pool.buffers.clear();
 		++pool_index;
@@ -88,8 +89,21 @@ GPUStorageBuffer GPUStorageBufferPool::allocate(uint32_t p_size, const PackedByt
 	ZN_ASSERT_RETURN_V(_rendering_device != nullptr, GPUStorageBuffer());
 	RenderingDevice &rd = *_rendering_device;
 
-	const unsigned int pool_index = get_pool_index_from_size(p_size);
+	unsigned int pool_index = get_pool_index_from_size(p_size);
 	ZN_ASSERT_RETURN_V(pool_index < _pools.size(), GPUStorageBuffer());
+
+	if (_pools[pool_index].buffers.size() == 0) {
+		const unsigned int max_pool_index =
+				math::min(pool_index + MAX_LARGER_POOL_FALLBACK, static_cast<unsigned int>(_pools.size()) - 1);
+		for (unsigned int larger_pool_index = pool_index + 1; larger_pool_index <= max_pool_index;
+			 ++larger_pool_index) {
+			if (_pools[larger_pool_index].buffers.size() > 0) {
+				pool_index = larger_pool_index;
+				break;
+			}
+		}
+	}
+
 	Pool &pool = _pools[pool_index];
 
 	GPUStorageBuffer b;
@@ -108,6 +122,8 @@ GPUStorageBuffer GPUStorageBufferPool::allocate(uint32_t p_size, const PackedByt
 			godot::update_storage_buffer(rd, b.rid, 0, pba->size(), *pba);
 		}
 		b.size = capacity;
+		_allocated_bytes += capacity;
+		++_created_buffers;
 
 	} else {
 		b = pool.buffers.back();
@@ -120,6 +136,12 @@ GPUStorageBuffer GPUStorageBufferPool::allocate(uint32_t p_size, const PackedByt
 
 	++pool.used_buffers;
 
+	const uint64_t used_bytes = _used_bytes + b.size;
+	_used_bytes = used_bytes;
+	if (used_bytes > _peak_used_bytes) {
+		_peak_used_bytes = used_bytes;
+	}
+
 	return b;
 }
 
@@ -135,6 +157,7 @@ void GPUStorageBufferPool::recycle(GPUStorageBuffer b) {
 
 	ZN_ASSERT(pool.used_buffers > 0);
 	--pool.used_buffers;
+	_used_bytes -= b.size;
 
 #if DEV_ENABLED
 	for (const GPUStorageBuffer &sb : pool.buffers) {
@@ -157,8 +180,21 @@ void GPUStorageBufferPool::debug_print() const {
 		ss << "Pool[" << i << "] block size: " << block_size << ", pooled buffers: " << pool.buffers.size()
 		   << ", capacity: " << pool.buffers.capacity() << "\n";
 	}
+	const Stats stats = get_stats();
+	ss << "Allocated: " << stats.allocated_bytes << " bytes, used: " << stats.used_bytes
+	   << " bytes, peak used: " << stats.peak_used_bytes << " bytes, created buffers: " << stats.created_buffers
+	   << "\n";
 	ss << "----";
 	print_line(ss.str());
 }
 
+GPUStorageBufferPool::Stats GPUStorageBufferPool::get_stats() const {
+	Stats stats;
+	stats.allocated_bytes = _allocated_bytes;
+	stats.used_bytes = _used_bytes;
+	stats.peak_used_bytes = _peak_used_bytes;
+	stats.created_buffers = _created_buffers;
+	return stats;
+}
+
 } // namespace zylann::voxel
@@ -5,6 +5,7 @@
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/rendering_device.h"
 #include <array>
+#include <atomic>
 
 namespace zylann::voxel {
 
@@ -23,9 +24,20 @@ struct GPUStorageBuffer {
 };
 
 // Pools storage buffers of specific sizes so they can be re-used.
-// Not thread-safe.
+// Not thread-safe, except `get_stats`.
 class GPUStorageBufferPool {
 public:
+	struct Stats {
+		// Total size of buffers created by the pool, including those not in use
+		uint64_t allocated_bytes = 0;
+		// Total size of buffers currently in use
+		uint64_t used_bytes = 0;
+		// Highest value `used_bytes` reached
+		uint64_t peak_used_bytes = 0;
+		// How many times buffers had to be created. This can stall the rendering device.
+		uint32_t created_buffers = 0;
+	};
+
 	GPUStorageBufferPool();
 	~GPUStorageBufferPool();
 
@@ -36,6 +48,9 @@ public:
 	void recycle(GPUStorageBuffer b);
 	void debug_print() const;
 
+	// Can be called from any thread
+	Stats get_stats() const;
+
 private:
 	GPUStorageBuffer allocate(uint32_t p_size, const PackedByteArray *pba);
 
@@ -49,9 +64,18 @@ private:
 	// Up to roughly 800 Mb with the current size formula
 	static const unsigned int POOL_COUNT = 48;
 
+	// When no buffer is available in the pool of the requested size, free buffers of up to this many larger pools may
+	// be used instead of creating a new one. Creating buffers is costly, while they are only slightly larger.
+	static const unsigned int MAX_LARGER_POOL_FALLBACK = 2;
+
 	std::array<uint32_t, POOL_COUNT> _pool_sizes;
 	FixedArray<Pool, POOL_COUNT> _pools;
 	RenderingDevice *_rendering_device = nullptr;
+
+	std::atomic_uint64_t _allocated_bytes = { 0 };
+	std::atomic_uint64_t _used_bytes = { 0 };
+	std::atomic_uint64_t _peak_used_bytes = { 0 };
+	std::atomic_uint32_t _created_buffers = { 0 };
 };
 
 } // namespace zylann::voxel
@@ -2,13 +2,30 @@
 #include "../../util/dstack.h"
 #include "../../util/errors.h"
 #include "../../util/godot/classes/rendering_device.h"
+#include "../../util/godot/classes/time.h"
 #include "../../util/math/funcs.h"
 #include "../../util/memory/memory.h"
 #include "../../util/profiling.h"
+#include "compute_resource_cache.h"
 
 namespace zylann::voxel {
 
-GPUTaskRunner::GPUTaskRunner() {}
+namespace {
+
+// Godot does not support async compute, so in order to get results from a compute shader, the only way is to sync
+// with the device, waiting for everything to complete. So instead of running one shader at a time, we run a few of
+// them. Larger batches amortize the cost of submitting and downloading, but take longer to complete and compete more
+// with rendering. So the amount of tasks per batch adapts to aim for a target duration.
+// 4 tasks was good enough on an nVidia 1060 for detail rendering, but for tasks with different costs it might need
+// different quota to prevent rendering slowdowns...
+const unsigned int INITIAL_BATCH_SIZE = 16;
+const unsigned int MIN_BATCH_SIZE = 1;
+const unsigned int MAX_BATCH_SIZE = 256;
+const uint64_t TARGET_BATCH_DURATION_USEC = 8000;
+
+} // namespace
+
+GPUTaskRunner::GPUTaskRunner() : _batch_size(INITIAL_BATCH_SIZE) {}
 
 GPUTaskRunner::~GPUTaskRunner() {
 	stop();
@@ -46,8 +63,10 @@ void GPUTaskRunner::stop() {
 
 void GPUTaskRunner::push(IGPUTask *task) {
 	ZN_ASSERT_RETURN(task != nullptr);
+	const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
 	MutexLock mlock(_mutex);
 	_shared_tasks.push_back(task);
+	_shared_task_push_times_usec.push_back(now_usec);
 	_semaphore.post();
 	++_pending_count;
 }
@@ -61,6 +80,7 @@ void GPUTaskRunner::thread_func() {
 	ZN_DSTACK();
 
 	StdVector<IGPUTask *> tasks;
+	StdVector<uint64_t> task_push_times_usec;
 
 	// We use a common output buffer for tasks that need to download results back to the CPU,
 	// because a single call to `buffer_get_data` is cheaper than multiple ones, due to Godot's API being synchronous.
@@ -72,31 +92,37 @@ void GPUTaskRunner::thread_func() {
 	};
 	StdVector<SBRange> shared_output_storage_buffer_segments;
 
-	// Godot does not support async compute, so in order to get results from a compute shader, the only way is to sync
-	// with the device, waiting for everything to complete. So instead of running one shader at a time, we run a few of
-	// them.
-	// It's also unclear how much to execute per frame.
-	// 4 tasks was good enough on an nVidia 1060 for detail rendering, but for tasks with different costs it might need
-	// different quota to prevent rendering slowdowns...
-	const unsigned int batch_count = 16;
+	ZN_ASSERT(_rendering_device != nullptr);
+	// Pipelines and uniform sets are kept across batches instead of being created by every task
+	ComputeResourceCache compute_resource_cache(*_rendering_device);
+
+	unsigned int batch_size = _batch_size;
 
 	while (_running) {
 		{
 			MutexLock mlock(_mutex);
 			tasks = std::move(_shared_tasks);
+			task_push_times_usec = std::move(_shared_task_push_times_usec);
 		}
 		if (tasks.size() == 0) {
 			_semaphore.wait();
 			continue;
 		}
 
-		ZN_ASSERT(_rendering_device != nullptr);
-		GPUTaskContext ctx(*_rendering_device, *_storage_buffer_pool);
+		GPUTaskContext ctx(*_rendering_device, *_storage_buffer_pool, compute_resource_cache);
+
+		// Tasks before this index already had their CPU preparation done while the previous batch was running
+		size_t cpu_prepared_end_index = 0;
 
-		for (size_t begin_index = 0; begin_index < tasks.size(); begin_index += batch_count) {
+		for (size_t begin_index = 0; begin_index < tasks.size();) {
 			ZN_PROFILE_SCOPE_NAMED("Batch");
 
-			const size_t end_index = math::min(begin_index + batch_count, tasks.size());
+			const size_t end_index = math::min(begin_index + batch_size, tasks.size());
+
+			const uint64_t batch_start_time_usec = Time::get_singleton()->get_ticks_usec();
+			for (size_t i = begin_index; i < end_index; ++i) {
+				_latency_stats.wait.add(batch_start_time_usec - task_push_times_usec[i]);
+			}
 
 			unsigned int required_shared_output_buffer_size = 0;
 			shared_output_storage_buffer_segments.clear();
@@ -116,10 +142,11 @@ void GPUTaskRunner::thread_func() {
 				if (shared_output_storage_buffer_rid.is_valid()) {
 					godot::free_rendering_device_rid(ctx.rendering_device, shared_output_storage_buffer_rid);
 				}
-				// TODO Resize to some multiplier above?
-				shared_output_storage_buffer_rid =
-						ctx.rendering_device.storage_buffer_create(required_shared_output_buffer_size);
-				shared_output_storage_buffer_capacity = required_shared_output_buffer_size;
+				// Leave some headroom so growing batches don't cause the buffer to be created again every time
+				const unsigned int new_capacity =
+						required_shared_output_buffer_size + required_shared_output_buffer_size / 2;
+				shared_output_storage_buffer_rid = ctx.rendering_device.storage_buffer_create(new_capacity);
+				shared_output_storage_buffer_capacity = new_capacity;
 				ZN_ASSERT_CONTINUE(shared_output_storage_buffer_rid.is_valid());
 			}
 
@@ -134,6 +161,9 @@ void GPUTaskRunner::thread_func() {
 				ctx.shared_output_buffer_size = range.size;
 
 				IGPUTask *task = tasks[i];
+				if (i >= cpu_prepared_end_index) {
+					task->prepare_cpu();
+				}
 				task->prepare(ctx);
 			}
 
@@ -142,6 +172,15 @@ void GPUTaskRunner::thread_func() {
 				ZN_PROFILE_SCOPE_NAMED("RD Submit");
 				ctx.rendering_device.submit();
 			}
+			// `sync` blocks until the graphics card is done, so meanwhile, get the next batch ready on the CPU side.
+			// Its size may still change after this batch completes, tasks left over get prepared normally.
+			{
+				ZN_PROFILE_SCOPE_NAMED("GPU Task Prepare CPU ahead");
+				cpu_prepared_end_index = math::min(end_index + batch_size, tasks.size());
+				for (size_t i = end_index; i < cpu_prepared_end_index; ++i) {
+					tasks[i]->prepare_cpu();
+				}
+			}
 			{
 				ZN_PROFILE_SCOPE_NAMED("RD Sync");
 				ctx.rendering_device.sync();
@@ -172,11 +211,33 @@ void GPUTaskRunner::thread_func() {
 			}
 
 			ctx.downloaded_shared_output_data = PackedByteArray();
+
+			// Nothing is running on the device at this point, so resources freed since last time can be forgotten
+			compute_resource_cache.prune();
+
+			// Tasks of a batch run together on the graphics card, so they all count the duration of the batch
+			const uint64_t batch_duration_usec = Time::get_singleton()->get_ticks_usec() - batch_start_time_usec;
+			for (size_t i = begin_index; i < end_index; ++i) {
+				_latency_stats.run.add(batch_duration_usec);
+			}
+
+			// Adapt the size of the next batches. Batches that weren't full don't tell if more tasks would fit.
+			if (batch_duration_usec > TARGET_BATCH_DURATION_USEC) {
+				batch_size = math::max(batch_size / 2, MIN_BATCH_SIZE);
+			} else if (end_index - begin_index == batch_size && batch_duration_usec < TARGET_BATCH_DURATION_USEC / 2) {
+				batch_size = math::min(batch_size * 2, MAX_BATCH_SIZE);
+			}
+			_batch_size = batch_size;
+
+			begin_index = end_index;
 		}
 
 		tasks.clear();
+		task_push_times_usec.clear();
 	}
 
+	compute_resource_cache.clear();
+
 	if (shared_output_storage_buffer_rid.is_valid()) {
 		godot::free_rendering_device_rid(*_rendering_device, shared_output_storage_buffer_rid);
 	}
@@ -7,6 +7,7 @@
 #include "../../util/godot/core/rid.h"
 #include "../../util/godot/macros.h"
 #include "../../util/macros.h"
+#include "../../util/tasks/latency_histogram.h"
 #include "../../util/thread/mutex.h"
 #include "../../util/thread/semaphore.h"
 #include "../../util/thread/thread.h"
@@ -20,10 +21,13 @@ using namespace godot;
 namespace zylann::voxel {
 
 class GPUStorageBufferPool;
+class ComputeResourceCache;
 
 struct GPUTaskContext {
 	RenderingDevice &rendering_device;
 	GPUStorageBufferPool &storage_buffer_pool;
+	// Pipelines and uniform sets re-used across batches
+	ComputeResourceCache &compute_resource_cache;
 
 	// Buffer shared by multiple tasks in the current batch.
 	// It will be downloaded in one go before collection, which is faster than downloading multiple individual buffers,
@@ -33,8 +37,8 @@ struct GPUTaskContext {
 	RID shared_output_buffer_rid;
 	PackedByteArray downloaded_shared_output_data;
 
-	GPUTaskContext(RenderingDevice &rd, GPUStorageBufferPool &sb_pool) :
-			rendering_device(rd), storage_buffer_pool(sb_pool) {}
+	GPUTaskContext(RenderingDevice &rd, GPUStorageBufferPool &sb_pool, ComputeResourceCache &resource_cache) :
+			rendering_device(rd), storage_buffer_pool(sb_pool), compute_resource_cache(resource_cache) {}
 };
 
 class IGPUTask {
@@ -45,6 +49,10 @@ public:
 		return 0;
 	}
 
+	// Optional step run before `prepare`, which must not use the rendering device. The runner may call it while the
+	// previous batch is still running on the graphics card, so CPU-heavy work like packing input data is done ahead.
+	virtual void prepare_cpu() {}
+
 	virtual void prepare(GPUTaskContext &ctx) = 0;
 	virtual void collect(GPUTaskContext &ctx) = 0;
 };
@@ -60,12 +68,25 @@ public:
 	void push(IGPUTask *task);
 	unsigned int get_pending_task_count() const;
 
+	// Gets how many tasks are currently run per batch. It adapts to how long batches take on the graphics card.
+	unsigned int get_batch_size() const {
+		return _batch_size;
+	}
+
+	// Gets how long tasks waited before their batch started, and how long their batch took to complete.
+	// Can be read from any thread.
+	const TaskLatencyStats &get_latency_stats() const {
+		return _latency_stats;
+	}
+
 private:
 	void thread_func();
 
 	RenderingDevice *_rendering_device = nullptr;
 	GPUStorageBufferPool *_storage_buffer_pool = nullptr;
 	StdVector<IGPUTask *> _shared_tasks;
+	// Times at which each task in `_shared_tasks` was pushed
+	StdVector<uint64_t> _shared_task_push_times_usec;
 	Mutex _mutex;
 	Semaphore _semaphore;
 	// Using a thread because so far it looks like the only way to submit and receive data with RenderingDevice is to
@@ -74,6 +95,8 @@ private:
 	Thread _thread;
 	bool _running = false;
 	std::atomic_uint32_t _pending_count = 0;
+	std::atomic_uint32_t _batch_size;
+	TaskLatencyStats _latency_stats;
 };
 
 } // namespace zylann::voxel
@@ -0,0 +1,94 @@
+#include "memory_usage.h"
+#include "../storage/voxel_data.h"
+#include "../terrain/voxel_mesh_block.h"
+#include "../util/errors.h"
+
+namespace zylann::voxel {
+
+VolumeMemoryUsage::VolumeMemoryUsage() {
+	fill(bytes, uint64_t(0));
+}
+
+void VolumeMemoryUsage::add_voxels(const VoxelBuffer &voxels) {
+	for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+		const size_t size = voxels.get_channel_size_in_bytes(channel_index);
+		if (size == 0) {
+			continue;
+		}
+		switch (voxels.get_channel_compression(channel_index)) {
+			case VoxelBuffer::COMPRESSION_PALETTE:
+				bytes[CATEGORY_VOXELS_PALETTE] += size;
+				break;
+			case VoxelBuffer::COMPRESSION_BRICKS:
+				bytes[CATEGORY_VOXELS_BRICKS] += size;
+				break;
+			default:
+				// Dense channels are the only ones left allocating memory
+				bytes[CATEGORY_VOXELS_8_BIT + voxels.get_channel_depth(channel_index)] += size;
+				break;
+		}
+	}
+
+	// Payloads of custom metadata types are not included
+	bytes[CATEGORY_METADATA] += voxels.get_voxel_metadata().size() *
+					sizeof(FlatMapMoveOnly<Vector3i, VoxelMetadata>::Pair) +
+			voxels.get_voxel_sparse_values().get_memory_usage();
+}
+
+void VolumeMemoryUsage::add_voxel_data(const VoxelData &data) {
+	const unsigned int lod_count = data.get_lod_count();
+	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+		data.for_each_block_at_lod_r(
+				[this](const Vector3i bpos, const VoxelDataBlock &block) {
+					++data_block_count;
+					if (block.is_voxels_compressed()) {
+						// Not decompressing them just to get statistics
+						bytes[CATEGORY_VOXELS_COMPRESSED] += block.get_voxels_size_in_bytes();
+					} else if (block.has_voxels()) {
+						add_voxels(block.get_voxels_const());
+					}
+				},
+				lod_index
+		);
+	}
+}
+
+void VolumeMemoryUsage::add_mesh_block(const VoxelMeshBlock &block) {
+	++mesh_block_count;
+	if (block.has_mesh()) {
+		bytes[CATEGORY_MESHES] += block.mesh_size_in_bytes;
+	}
+	if (block.has_collision_shape()) {
+		bytes[CATEGORY_COLLISIONS] += block.collision_size_in_bytes;
+	}
+}
+
+uint64_t VolumeMemoryUsage::get_total() const {
+	uint64_t total = 0;
+	for (const uint64_t size : bytes) {
+		total += size;
+	}
+	return total;
+}
+
+const char *VolumeMemoryUsage::get_category_name(Category category) {
+	static const char *s_names[CATEGORY_COUNT] = {
+		"voxels_8_bit",
+		"voxels_16_bit",
+		"voxels_32_bit",
+		"voxels_64_bit",
+		"voxels_palette",
+		"voxels_bricks",
+		"voxels_compressed",
+		"metadata",
+		"meshes",
+		"collisions",
+		"detail_textures",
+		"instances",
+		"stream_cache",
+	};
+	ZN_ASSERT_RETURN_V(category >= 0 && category < CATEGORY_COUNT, "");
+	return s_names[category];
+}
+
+} // namespace zylann::voxel
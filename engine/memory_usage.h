@@ -0,0 +1,66 @@
+#ifndef VOXEL_MEMORY_USAGE_H
+#define VOXEL_MEMORY_USAGE_H
+
+#include "../util/containers/fixed_array.h"
+#include <cstdint>
+
+namespace zylann::voxel {
+
+class VoxelBuffer;
+class VoxelData;
+class VoxelMeshBlock;
+
+// Approximate amount of memory used by a volume, in bytes, split by category.
+// Sizes are estimated from what the module allocates itself. Overhead of containers, allocators and the renderer or
+// physics engine's internal structures is not included, so the real usage is higher.
+struct VolumeMemoryUsage {
+	enum Category {
+		// Voxels stored without compression, by channel depth
+		CATEGORY_VOXELS_8_BIT,
+		CATEGORY_VOXELS_16_BIT,
+		CATEGORY_VOXELS_32_BIT,
+		CATEGORY_VOXELS_64_BIT,
+		// Voxels stored with palette compression (palettes and packed indices)
+		CATEGORY_VOXELS_PALETTE,
+		// Voxels stored with brick compression
+		CATEGORY_VOXELS_BRICKS,
+		// Voxels of blocks compressed in memory with LZ4, including their metadata
+		CATEGORY_VOXELS_COMPRESSED,
+		// Per-voxel metadata and sparse values
+		CATEGORY_METADATA,
+		// Mesh arrays given to the renderer, which may also keep a copy in video memory
+		CATEGORY_MESHES,
+		// Triangles of collision shapes
+		CATEGORY_COLLISIONS,
+		// Detail textures in video memory
+		CATEGORY_DETAIL_TEXTURES,
+		// Transforms of instances
+		CATEGORY_INSTANCES,
+		// Blocks kept in memory by the stream
+		CATEGORY_STREAM_CACHE,
+		CATEGORY_COUNT
+	};
+
+	FixedArray<uint64_t, CATEGORY_COUNT> bytes;
+	// Instance ID of the node owning the volume
+	uint64_t object_id = 0;
+	unsigned int data_block_count = 0;
+	unsigned int mesh_block_count = 0;
+
+	VolumeMemoryUsage();
+
+	// Adds voxels and metadata of a buffer
+	void add_voxels(const VoxelBuffer &voxels);
+	// Adds voxels of all loaded blocks. Buffers shared between blocks are counted for each of them.
+	void add_voxel_data(const VoxelData &data);
+	// Adds the mesh and collision shape of a block, if it has them
+	void add_mesh_block(const VoxelMeshBlock &block);
+
+	uint64_t get_total() const;
+
+	static const char *get_category_name(Category category);
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_MEMORY_USAGE_H
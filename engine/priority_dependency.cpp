@@ -4,37 +4,132 @@
 
 namespace zylann::voxel {
 
+namespace {
+
+// Closer is higher priority. Decreases over distance.
+// Scaled by LOD because we segment priority by LOD too in band 1.
+inline uint8_t get_distance_band(float distance, uint8_t lod_index) {
+	return math::max(TaskPriority::BAND_MAX - math::arithmetic_rshift(static_cast<int>(distance), 4 + lod_index), 0);
+}
+
+// Blocks within the view cone of a viewer are prioritized as if they were closer, and blocks behind as if they were
+// further away. Blocks close to the viewer are left alone, they are needed regardless of where it looks (collisions).
+constexpr float VIEW_CONE_MIN_DISTANCE = 32.f;
+constexpr float VIEW_CONE_IN_VIEW_DISTANCE_SCALE = 0.5f;
+constexpr float VIEW_CONE_BEHIND_DISTANCE_SCALE = 2.f;
+
+inline float get_view_cone_distance_sq_scale(
+		const PriorityDependency::ViewCone &cone,
+		Vector3f viewer_position,
+		Vector3f block_position,
+		float distance_sq
+) {
+	if (distance_sq < VIEW_CONE_MIN_DISTANCE * VIEW_CONE_MIN_DISTANCE) {
+		return 1.f;
+	}
+	const float cos_angle = math::dot(cone.direction, block_position - viewer_position) / Math::sqrt(distance_sq);
+	if (cos_angle >= cone.cos_half_angle) {
+		return VIEW_CONE_IN_VIEW_DISTANCE_SCALE * VIEW_CONE_IN_VIEW_DISTANCE_SCALE;
+	}
+	if (cos_angle < 0.f) {
+		return VIEW_CONE_BEHIND_DISTANCE_SCALE * VIEW_CONE_BEHIND_DISTANCE_SCALE;
+	}
+	return 1.f;
+}
+
+} // namespace
+
 TaskPriority PriorityDependency::evaluate(uint8_t lod_index, uint8_t band2_priority, float *out_closest_distance_sq) {
 	TaskPriority priority;
 	ZN_ASSERT_RETURN_V(shared != nullptr, priority);
 
-	const StdVector<Vector3f> &viewer_positions = shared->viewers;
-	const unsigned int viewer_count = shared->viewers_count;
+	const uint32_t version = shared->version;
+	const double travelled_distance = shared->travelled_distance;
+
+	bool reuse_cache = false;
+	if (has_cached_evaluation && version == cached_version) {
+		if (cached_with_view_cones) {
+			// Where blocks are relative to view cones changes as viewers move, so any movement can change priority
+			reuse_cache = travelled_distance == cached_travelled_distance;
+		} else {
+			// Viewers have moved by this distance at most, so the closest one is within that range
+			const float max_change = static_cast<float>(travelled_distance - cached_travelled_distance);
+			const float min_distance = math::max(cached_closest_distance - max_change, 0.f);
+			const float max_distance = cached_closest_distance + max_change;
+			reuse_cache = get_distance_band(min_distance, lod_index) == get_distance_band(max_distance, lod_index);
+			if (reuse_cache && out_closest_distance_sq != nullptr) {
+				// The caller compares distance with the drop distance, which must not change either
+				const float min_drop_distance = math::max(cached_closest_drop_distance - max_change, 0.f);
+				const float max_drop_distance = cached_closest_drop_distance + max_change;
+				reuse_cache = (min_drop_distance * min_drop_distance > drop_distance_squared) ==
+						(max_drop_distance * max_drop_distance > drop_distance_squared);
+			}
+		}
+	}
 
-	const Vector3f block_position = world_position;
+	if (!reuse_cache) {
+		const StdVector<Vector3f> &viewer_positions = shared->viewers;
+		const StdVector<Vector3f> &predicted_viewer_positions = shared->predicted_viewers;
+		const StdVector<ViewCone> &view_cones = shared->view_cones;
+		const unsigned int viewer_count = shared->viewers_count;
+		const bool has_view_cones = view_cones.size() >= viewer_count;
 
-	float closest_distance_sq = 99999.f;
-	if (viewer_positions.size() == 0) {
-		// Assume origin
-		closest_distance_sq = math::length_squared(block_position);
-	} else {
-		for (unsigned int i = 0; i < viewer_count; ++i) {
-			const float d = math::distance_squared(viewer_positions[i], block_position);
-			if (d < closest_distance_sq) {
-				closest_distance_sq = d;
+		const Vector3f block_position = world_position;
+
+		// Distance used for priority, modified by view cones
+		float closest_distance_sq = 99999.f;
+		float closest_drop_distance_sq = 99999.f;
+		bool with_view_cones = false;
+		if (viewer_positions.size() == 0) {
+			// Assume origin
+			closest_distance_sq = math::length_squared(block_position);
+			closest_drop_distance_sq = closest_distance_sq;
+		} else {
+			for (unsigned int i = 0; i < viewer_count; ++i) {
+				const float d = math::distance_squared(viewer_positions[i], block_position);
+				if (d < closest_drop_distance_sq) {
+					closest_drop_distance_sq = d;
+				}
+				float priority_d = d;
+				if (has_view_cones && view_cones[i].enabled) {
+					priority_d *=
+							get_view_cone_distance_sq_scale(view_cones[i], viewer_positions[i], block_position, d);
+					with_view_cones = true;
+				}
+				if (priority_d < closest_distance_sq) {
+					closest_distance_sq = priority_d;
+				}
+			}
+			// Priority only depends on current positions, so blocks ahead of viewers come after those around them.
+			// But they must not be dropped, otherwise they could not be streamed in advance.
+			if (predicted_viewer_positions.size() >= viewer_count) {
+				for (unsigned int i = 0; i < viewer_count; ++i) {
+					const float d = math::distance_squared(predicted_viewer_positions[i], block_position);
+					if (d < closest_drop_distance_sq) {
+						closest_drop_distance_sq = d;
+					}
+				}
 			}
 		}
+
+		// TODO Any way to optimize out the sqrt? Maybe with a fast integer version?
+		// I added it because the LOD modifier was not working with squared distances,
+		// which led blocks to subdivide too much compared to their neighbors, making cracks more likely to happen
+		cached_closest_distance = Math::sqrt(closest_distance_sq);
+		cached_closest_drop_distance = closest_drop_distance_sq == closest_distance_sq
+				? cached_closest_distance
+				: Math::sqrt(closest_drop_distance_sq);
+		cached_travelled_distance = travelled_distance;
+		cached_with_view_cones = with_view_cones;
+		cached_version = version;
+		cached_band0 = get_distance_band(cached_closest_distance, lod_index);
+		has_cached_evaluation = true;
 	}
 
 	if (out_closest_distance_sq != nullptr) {
-		*out_closest_distance_sq = closest_distance_sq;
+		*out_closest_distance_sq = cached_closest_drop_distance * cached_closest_drop_distance;
 	}
 
-	// TODO Any way to optimize out the sqrt? Maybe with a fast integer version?
-	// I added it because the LOD modifier was not working with squared distances,
-	// which led blocks to subdivide too much compared to their neighbors, making cracks more likely to happen
-	const int distance = static_cast<int>(Math::sqrt(closest_distance_sq));
-
 	// TODO Prioritizing LOD makes generation slower... but not prioritizing makes cracks more likely to appear...
 	// This could be fixed by allowing the volume to preemptively request blocks of the next LOD?
 	//
@@ -42,9 +137,7 @@ TaskPriority PriorityDependency::evaluate(uint8_t lod_index, uint8_t band2_prior
 	// Then comes distance, which is modified by how much in view the block is
 	// priority += (constants::MAX_LOD - lod_index) * 10000;
 
-	// Closer is higher priority. Decreases over distance.
-	// Scaled by LOD because we segment priority by LOD too in band 1.
-	priority.band0 = math::max(TaskPriority::BAND_MAX - math::arithmetic_rshift(distance, 4 + lod_index), 0);
+	priority.band0 = cached_band0;
 	// Note: in the past, making lower LOD indices (aka closer detailed ones) have higher priority made cracks between
 	// meshes more likely to appear somehow, so for a while I had it inverted. But that priority makes sense so I
 	// changed it back. Will see later if that really causes any issue.
@@ -11,6 +11,15 @@ namespace zylann::voxel {
 
 // Information to calculate the priority of a voxel task having a specific location
 struct PriorityDependency {
+	// Approximation of what a viewer can see, used to prioritize blocks in view
+	struct ViewCone {
+		// Normalized direction the viewer is looking at
+		Vector3f direction;
+		// Cosine of the angle between the direction and the edges of the cone
+		float cos_half_angle = 1.f;
+		bool enabled = false;
+	};
+
 	struct ViewersData {
 		// These positions are written by the main thread and read by block processing threads.
 		// Order doesn't matter.
@@ -19,9 +28,21 @@ struct PriorityDependency {
 		// This vector is never resized after the instance is created. It is just big enough to have room for all
 		// viewers.
 		StdVector<Vector3f> viewers;
+		// Where viewers are expected to be soon, based on their velocity. Same layout as `viewers`, and equal to them
+		// for viewers without prediction. Tasks near these positions are not dropped, so blocks can be streamed
+		// ahead of fast viewers. If smaller than the viewer count, no prediction is done.
+		StdVector<Vector3f> predicted_viewers;
+		// Same layout as `viewers`. Blocks within view cones come first, and blocks behind viewers come last. Only
+		// affects priority, not dropping. If smaller than the viewer count, view cones are not used.
+		StdVector<ViewCone> view_cones;
 		// Use this count instead of `viewers.size()`. Can change, but will always be <= `viewers.size()`
 		std::atomic_uint32_t viewers_count;
 		float highest_view_distance = 999999;
+		// Incremented when viewers are added or removed, which invalidates priorities cached by tasks
+		std::atomic_uint32_t version = { 0 };
+		// Sum of the largest distance any viewer moved at each update. The distance between a task and its closest
+		// viewer can't have changed by more than the difference between two values of this.
+		std::atomic<double> travelled_distance = { 0.0 };
 	};
 
 	// TODO If viewers are created at the same time as the first terrain for the first time in a session, loading tasks
@@ -45,6 +66,21 @@ struct PriorityDependency {
 	// it's not always reliable and requires to handle "task drops" which is annoying
 	float drop_distance_squared;
 
+	// Results of the last evaluation. Viewers move often, but the priority of most tasks only changes when they cross
+	// a distance ring of their LOD, or the drop distance. So the distance to viewers is not recomputed as long as
+	// viewers haven't travelled enough for that to happen.
+	float cached_closest_distance = 0.f;
+	// Closest distance to either current or predicted positions of viewers, used to decide dropping
+	float cached_closest_drop_distance = 0.f;
+	double cached_travelled_distance = 0.0;
+	uint32_t cached_version = 0;
+	uint8_t cached_band0 = 0;
+	bool has_cached_evaluation = false;
+	// View cones were involved in the last evaluation, which prevents reusing it after viewers moved
+	bool cached_with_view_cones = false;
+
+	// The distance written to `out_closest_distance_sq` is meant to be compared with the drop distance. It accounts for
+	// predicted positions of viewers, while priority only depends on their current positions.
 	TaskPriority evaluate(uint8_t lod_index, uint8_t band2_priority, float *out_closest_distance_sq);
 };
 
@@ -2,6 +2,7 @@
 #define VOXEL_STREAMING_DEPENDENCY_H
 
 #include "../generators/voxel_generator.h"
+#include "../streams/save_block_queue.h"
 #include "../streams/voxel_stream.h"
 
 namespace zylann::voxel {
@@ -13,6 +14,9 @@ namespace zylann::voxel {
 struct StreamingDependency {
 	Ref<VoxelStream> stream;
 	Ref<VoxelGenerator> generator;
+	// Voxels waiting to be saved to the stream. Kept across instances using the same stream, so loading tasks of the
+	// new instance can still see them.
+	std::shared_ptr<SaveBlockQueue> save_queue = make_shared_instance<SaveBlockQueue>();
 	bool valid = true;
 
 	static void reset(
@@ -20,12 +24,19 @@ struct StreamingDependency {
 			Ref<VoxelStream> stream,
 			Ref<VoxelGenerator> generator
 	) {
+		std::shared_ptr<SaveBlockQueue> save_queue;
 		if (ref != nullptr) {
 			ref->valid = false;
+			if (ref->stream == stream) {
+				save_queue = ref->save_queue;
+			}
 		}
 		ref = make_shared_instance<StreamingDependency>();
 		ref->stream = stream;
 		ref->generator = generator;
+		if (save_queue != nullptr) {
+			ref->save_queue = save_queue;
+		}
 		ref->valid = true;
 	}
 };
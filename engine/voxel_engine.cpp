@@ -3,22 +3,48 @@
 #include "../generators/generate_block_task.h"
 #include "../meshers/mesh_block_task.h"
 #include "../shaders/shaders.h"
+#include "../storage/voxel_memory_pool.h"
 #include "../streams/load_all_blocks_data_task.h"
 #include "../streams/load_block_data_task.h"
 #include "../streams/save_block_data_task.h"
 #include "../util/godot/classes/rd_sampler_state.h"
 #include "../util/godot/classes/rendering_device.h"
 #include "../util/godot/classes/rendering_server.h"
+#include "../util/godot/classes/time.h"
 #include "../util/io/log.h"
 #include "../util/macros.h"
 #include "../util/math/conv.h"
 #include "../util/profiling.h"
 #include "../util/string/format.h"
+#include <array>
 
 namespace zylann::voxel {
 
 VoxelEngine *g_voxel_engine = nullptr;
 
+namespace {
+
+// Freeing many blocks can take a while, so it is done in a thread
+class TrimVoxelMemoryPoolTask : public IThreadedTask {
+public:
+	TrimVoxelMemoryPoolTask(uint64_t now_msec) : _now_msec(now_msec) {}
+
+	void run(ThreadedTaskContext &ctx) override {
+		VoxelMemoryPool::get_singleton().trim(_now_msec);
+	}
+
+	const char *get_debug_name() const override {
+		return "TrimVoxelMemoryPool";
+	}
+
+private:
+	uint64_t _now_msec;
+};
+
+const uint64_t MEMORY_POOL_TRIM_PERIOD_MSEC = 1000;
+
+} // namespace
+
 VoxelEngine &VoxelEngine::get_singleton() {
 	ZN_ASSERT_MSG(g_voxel_engine != nullptr, "Accessing singleton while it's null");
 	return *g_voxel_engine;
@@ -59,13 +85,27 @@ VoxelEngine::VoxelEngine(Config config) {
 	}
 
 	_general_thread_pool.set_name("Voxel general");
-	_general_thread_pool.set_thread_count(thread_count);
+	_general_thread_pool.set_cpu_affinity_groups(to_span(config.thread_cpu_affinity_groups));
+	if (config.thread_count_adaptive) {
+		// All threads are created upfront, and those above the limit stay parked until the load requires them
+		_general_thread_pool.set_thread_count(maximum_thread_count);
+		_general_thread_pool.set_thread_limit(thread_count);
+	} else {
+		_general_thread_pool.set_thread_count(thread_count);
+	}
+	_adaptive_thread_count.enabled = config.thread_count_adaptive;
+	_adaptive_thread_count.minimum = math::min(
+			static_cast<uint32_t>(config.thread_count_minimum), _general_thread_pool.get_thread_count()
+	);
+	_adaptive_thread_count.maximum = _general_thread_pool.get_thread_count();
 	_general_thread_pool.set_priority_update_period(200);
 
 	// Init world
 	_world.shared_priority_dependency = make_shared_instance<PriorityDependency::ViewersData>();
 	// Give initial capacity to make invalidation less likely
 	_world.shared_priority_dependency->viewers.resize(64);
+	_world.shared_priority_dependency->predicted_viewers.resize(64);
+	_world.shared_priority_dependency->view_cones.resize(64);
 
 	ZN_PRINT_VERBOSE(format("Size of LoadBlockDataTask: {}", sizeof(LoadBlockDataTask)));
 	ZN_PRINT_VERBOSE(format("Size of SaveBlockDataTask: {}", sizeof(SaveBlockDataTask)));
@@ -98,6 +138,21 @@ VoxelEngine::VoxelEngine(Config config) {
 	}
 
 	set_main_thread_time_budget_usec(config.main_thread_budget_usec);
+	set_main_thread_target_frame_time_usec(config.main_thread_target_frame_time_usec);
+
+	VoxelMemoryPool &memory_pool = VoxelMemoryPool::get_singleton();
+	memory_pool.set_unused_memory_budget(
+			config.memory_pool_unused_budget > 0 ? config.memory_pool_unused_budget
+												 : std::numeric_limits<uint64_t>::max()
+	);
+	memory_pool.set_max_idle_time_msec(config.memory_pool_max_idle_time_msec);
+	memory_pool.set_arenas_enabled(config.memory_pool_arenas_enabled);
+
+	_save_queue_flush_interval_msec = config.save_queue_flush_interval_msec;
+	_save_queue_max_blocks = math::max(config.save_queue_max_blocks, uint32_t(1));
+	_shader_cache_enabled = config.shader_cache_enabled;
+	_threaded_collision_shape_building_enabled = config.threaded_collision_shape_building_enabled;
+	_generator_output_cache.set_memory_budget(config.generator_output_cache_budget);
 }
 
 void VoxelEngine::load_shaders() {
@@ -106,33 +161,31 @@ void VoxelEngine::load_shaders() {
 	if (_rendering_device != nullptr) {
 		ZN_PRINT_VERBOSE("Loading VoxelEngine shaders");
 
-		_dilate_normalmap_shader.load_from_glsl(g_dilate_normalmap_shader, "zylann.voxel.dilate_normalmap");
-		_detail_gather_hits_shader.load_from_glsl(g_detail_gather_hits_shader, "zylann.voxel.detail_gather_hits");
-		_detail_normalmap_shader.load_from_glsl(g_detail_normalmap_shader, "zylann.voxel.detail_normalmap_shader");
-
-		_detail_modifier_sphere_shader.load_from_glsl(
-				String(g_detail_modifier_shader_template_0) + String(g_modifier_sphere_shader_snippet) +
-						String(g_detail_modifier_shader_template_1),
-				"zylann.voxel.detail_modifier_sphere_shader"
-		);
-
-		_detail_modifier_mesh_shader.load_from_glsl(
-				String(g_detail_modifier_shader_template_0) + String(g_modifier_mesh_shader_snippet) +
-						String(g_detail_modifier_shader_template_1),
-				"zylann.voxel.detail_modifier_mesh_shader"
-		);
-
-		_block_modifier_sphere_shader.load_from_glsl(
-				String(g_block_modifier_shader_template_0) + String(g_modifier_sphere_shader_snippet) +
-						String(g_block_modifier_shader_template_1),
-				"zylann.voxel.block_modifier_sphere_shader"
-		);
-
-		_block_modifier_mesh_shader.load_from_glsl(
-				String(g_block_modifier_shader_template_0) + String(g_modifier_mesh_shader_snippet) +
-						String(g_block_modifier_shader_template_1),
-				"zylann.voxel.block_modifier_mesh_shader"
-		);
+		// Compiling takes a while when shaders are not in the cache yet, so they are compiled in parallel
+		std::array<ComputeShader::GLSLSource, 8> sources = { {
+			{ &_dilate_normalmap_shader, g_dilate_normalmap_shader, "zylann.voxel.dilate_normalmap" },
+			{ &_detail_gather_hits_shader, g_detail_gather_hits_shader, "zylann.voxel.detail_gather_hits" },
+			{ &_detail_normalmap_shader, g_detail_normalmap_shader, "zylann.voxel.detail_normalmap_shader" },
+			{ &_detail_modifier_sphere_shader,
+			  String(g_detail_modifier_shader_template_0) + String(g_modifier_sphere_shader_snippet) +
+					  String(g_detail_modifier_shader_template_1),
+			  "zylann.voxel.detail_modifier_sphere_shader" },
+			{ &_detail_modifier_mesh_shader,
+			  String(g_detail_modifier_shader_template_0) + String(g_modifier_mesh_shader_snippet) +
+					  String(g_detail_modifier_shader_template_1),
+			  "zylann.voxel.detail_modifier_mesh_shader" },
+			{ &_block_modifier_sphere_shader,
+			  String(g_block_modifier_shader_template_0) + String(g_modifier_sphere_shader_snippet) +
+					  String(g_block_modifier_shader_template_1),
+			  "zylann.voxel.block_modifier_sphere_shader" },
+			{ &_block_modifier_mesh_shader,
+			  String(g_block_modifier_shader_template_0) + String(g_modifier_mesh_shader_snippet) +
+					  String(g_block_modifier_shader_template_1),
+			  "zylann.voxel.block_modifier_mesh_shader" },
+			{ &_block_output_pack_shader, g_block_output_pack_shader, "zylann.voxel.block_output_pack_shader" },
+		} };
+
+		ComputeShader::load_from_glsl_multithreaded(to_span(sources));
 	}
 }
 
@@ -155,6 +208,7 @@ VoxelEngine::~VoxelEngine() {
 		_detail_modifier_mesh_shader.clear();
 		_block_modifier_sphere_shader.clear();
 		_block_modifier_mesh_shader.clear();
+		_block_output_pack_shader.clear();
 
 		zylann::godot::free_rendering_device_rid(*_rendering_device, _filtering_sampler_rid);
 		_filtering_sampler_rid = RID();
@@ -179,7 +233,7 @@ void VoxelEngine::wait_and_clear_all_tasks(bool warn) {
 			ZN_PRINT_WARNING("General tasks remain on module cleanup, "
 							 "this could become a problem if they reference scripts");
 		}
-		ZN_DELETE(task);
+		task->dispose();
 	});
 }
 
@@ -187,7 +241,13 @@ VolumeID VoxelEngine::add_volume(VolumeCallbacks callbacks) {
 	ZN_ASSERT(callbacks.check_callbacks());
 	Volume volume;
 	volume.callbacks = callbacks;
-	return _world.volumes.add(volume);
+	const VolumeID volume_id = _world.volumes.add(volume);
+	const int task_group = get_volume_task_group(volume_id);
+	if (task_group >= 0) {
+		// The group may have been used by a volume that was removed
+		_general_thread_pool.reset_group(task_group);
+	}
+	return volume_id;
 }
 
 VoxelEngine::VolumeCallbacks VoxelEngine::get_volume_callbacks(VolumeID volume_id) const {
@@ -206,6 +266,24 @@ void VoxelEngine::remove_volume(VolumeID volume_id) {
 	}
 }
 
+void VoxelEngine::set_volume_task_settings(VolumeID volume_id, ThreadedTaskRunner::GroupSettings settings) {
+	ZN_ASSERT_RETURN(is_volume_valid(volume_id));
+	const int task_group = get_volume_task_group(volume_id);
+	if (task_group < 0) {
+		ZN_PRINT_WARNING("Too many volumes, task settings are not supported on this one");
+		return;
+	}
+	_general_thread_pool.set_group_settings(task_group, settings);
+}
+
+ThreadedTaskRunner::GroupStats VoxelEngine::get_volume_task_stats(VolumeID volume_id) const {
+	const int task_group = get_volume_task_group(volume_id);
+	if (task_group < 0) {
+		return ThreadedTaskRunner::GroupStats();
+	}
+	return _general_thread_pool.get_group_stats(task_group);
+}
+
 bool VoxelEngine::is_volume_valid(VolumeID volume_id) const {
 	return _world.volumes.exists(volume_id);
 }
@@ -273,6 +351,49 @@ int VoxelEngine::get_viewer_network_peer_id(ViewerID viewer_id) const {
 	return viewer.network_peer_id;
 }
 
+void VoxelEngine::set_viewer_prediction_time(ViewerID viewer_id, float seconds) {
+	Viewer &viewer = _world.viewers.get(viewer_id);
+	viewer.prediction_time = math::max(seconds, 0.f);
+}
+
+float VoxelEngine::get_viewer_prediction_time(ViewerID viewer_id) const {
+	const Viewer &viewer = _world.viewers.get(viewer_id);
+	return viewer.prediction_time;
+}
+
+void VoxelEngine::set_viewer_velocity_estimation_enabled(ViewerID viewer_id, bool enabled) {
+	Viewer &viewer = _world.viewers.get(viewer_id);
+	viewer.velocity_estimation_enabled = enabled;
+	// Start estimating from the next position, the previous one may be outdated
+	viewer.has_previous_world_position = false;
+}
+
+void VoxelEngine::set_viewer_velocity(ViewerID viewer_id, Vector3 velocity) {
+	Viewer &viewer = _world.viewers.get(viewer_id);
+	viewer.velocity = velocity;
+}
+
+Vector3 VoxelEngine::get_viewer_velocity(ViewerID viewer_id) const {
+	const Viewer &viewer = _world.viewers.get(viewer_id);
+	return viewer.velocity;
+}
+
+void VoxelEngine::set_viewer_view_direction(ViewerID viewer_id, Vector3 direction) {
+	ZN_ASSERT_RETURN(!direction.is_zero_approx());
+	Viewer &viewer = _world.viewers.get(viewer_id);
+	viewer.view_direction = direction.normalized();
+}
+
+void VoxelEngine::set_viewer_view_cone_half_angle(ViewerID viewer_id, float radians) {
+	Viewer &viewer = _world.viewers.get(viewer_id);
+	viewer.view_cone_half_angle = math::clamp(radians, 0.f, math::PI_32);
+}
+
+float VoxelEngine::get_viewer_view_cone_half_angle(ViewerID viewer_id) const {
+	const Viewer &viewer = _world.viewers.get(viewer_id);
+	return viewer.view_cone_half_angle;
+}
+
 bool VoxelEngine::viewer_exists(ViewerID viewer_id) const {
 	return _world.viewers.exists(viewer_id);
 }
@@ -296,6 +417,114 @@ void VoxelEngine::set_main_thread_time_budget_usec(unsigned int usec) {
 	_main_thread_time_budget_usec = usec;
 }
 
+void VoxelEngine::set_main_thread_target_frame_time_usec(unsigned int usec) {
+	_main_thread_target_frame_time_usec = usec;
+}
+
+void VoxelEngine::update_main_thread_time_budget() {
+	const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
+	const uint64_t frame_time_usec = now_usec - _last_process_time_usec;
+	const bool first_frame = _last_process_time_usec == 0;
+	_last_process_time_usec = now_usec;
+	_last_frame_time_usec = first_frame ? 0 : frame_time_usec;
+
+	const unsigned int target_usec = _main_thread_target_frame_time_usec;
+	if (target_usec == 0 || first_frame) {
+		return;
+	}
+
+	// Frame time is measured between two calls, which includes waiting for vsync. So it can't tell how much headroom
+	// is left, only whether the target was missed. The budget shrinks quickly when it is, and grows back slowly while
+	// tasks were limited by it.
+	// Leaving at least half of the frame to the rest of the game.
+	const unsigned int max_budget_usec = math::max(target_usec / 2, MIN_ADAPTIVE_MAIN_THREAD_BUDGET_USEC);
+
+	if (frame_time_usec > target_usec + target_usec / 5) {
+		_main_thread_time_budget_usec =
+				math::max(_main_thread_time_budget_usec * 3 / 4, MIN_ADAPTIVE_MAIN_THREAD_BUDGET_USEC);
+
+	} else if (_time_spread_tasks_were_left) {
+		_main_thread_time_budget_usec =
+				math::min(_main_thread_time_budget_usec + ADAPTIVE_MAIN_THREAD_BUDGET_STEP_USEC, max_budget_usec);
+	}
+}
+
+void VoxelEngine::update_adaptive_thread_count() {
+	AdaptiveThreadCount &atc = _adaptive_thread_count;
+	const uint32_t current_limit = _general_thread_pool.get_thread_limit();
+
+	if (atc.power_saving || !atc.enabled) {
+		const uint32_t limit = atc.power_saving ? atc.minimum : _general_thread_pool.get_thread_count();
+		if (limit != current_limit) {
+			_general_thread_pool.set_thread_limit(limit);
+		}
+		atc.missed_target_duration_usec = 0;
+		atc.backlog_duration_usec = 0;
+		return;
+	}
+
+	const uint64_t frame_time_usec = _last_frame_time_usec;
+	if (frame_time_usec == 0) {
+		return;
+	}
+	if (atc.average_frame_time_usec == 0) {
+		atc.average_frame_time_usec = frame_time_usec;
+	} else {
+		atc.average_frame_time_usec = (atc.average_frame_time_usec * 7 + frame_time_usec) / 8;
+	}
+
+	const uint64_t target_usec = _main_thread_target_frame_time_usec != 0
+			? _main_thread_target_frame_time_usec
+			: DEFAULT_ADAPTIVE_THREAD_COUNT_TARGET_FRAME_TIME_USEC;
+	const unsigned int pending_tasks = _general_thread_pool.get_debug_remaining_tasks();
+
+	// Like the main thread budget, frame time includes waiting for vsync, so it only tells whether the target is
+	// missed. Frames between the two thresholds leave the count unchanged, to avoid ping-pong.
+	if (atc.average_frame_time_usec > target_usec + target_usec / 5) {
+		// Worker threads may be taking CPU time from the main and rendering threads
+		atc.missed_target_duration_usec += frame_time_usec;
+		atc.backlog_duration_usec = 0;
+
+	} else if (atc.average_frame_time_usec <= target_usec + target_usec / 20 &&
+			   pending_tasks > current_limit * ADAPTIVE_THREAD_COUNT_BACKLOG_PER_THREAD) {
+		atc.backlog_duration_usec += frame_time_usec;
+		atc.missed_target_duration_usec = 0;
+
+	} else {
+		atc.missed_target_duration_usec = 0;
+		atc.backlog_duration_usec = 0;
+	}
+
+	const uint64_t now_usec = _last_process_time_usec;
+	if (now_usec - atc.last_change_time_usec < ADAPTIVE_THREAD_COUNT_COOLDOWN_USEC) {
+		return;
+	}
+
+	if (atc.missed_target_duration_usec >= ADAPTIVE_THREAD_COUNT_SHRINK_DELAY_USEC && current_limit > atc.minimum) {
+		_general_thread_pool.set_thread_limit(current_limit - 1);
+		atc.last_change_time_usec = now_usec;
+		atc.last_decrease_time_usec = now_usec;
+		atc.missed_target_duration_usec = 0;
+		ZN_PRINT_VERBOSE(format("Voxel: frames are too long, thread limit decreased to {}", current_limit - 1));
+
+	} else if (atc.backlog_duration_usec >= ADAPTIVE_THREAD_COUNT_GROW_DELAY_USEC && current_limit < atc.maximum &&
+			   (atc.last_decrease_time_usec == 0 ||
+				now_usec - atc.last_decrease_time_usec >= ADAPTIVE_THREAD_COUNT_GROW_BACKOFF_USEC)) {
+		_general_thread_pool.set_thread_limit(current_limit + 1);
+		atc.last_change_time_usec = now_usec;
+		atc.backlog_duration_usec = 0;
+		ZN_PRINT_VERBOSE(format("Voxel: tasks are piling up, thread limit increased to {}", current_limit + 1));
+	}
+}
+
+void VoxelEngine::set_thread_power_saving_enabled(bool enabled) {
+	_adaptive_thread_count.power_saving = enabled;
+}
+
+bool VoxelEngine::is_thread_power_saving_enabled() const {
+	return _adaptive_thread_count.power_saving;
+}
+
 void VoxelEngine::set_threaded_graphics_resource_building_enabled(bool enable) {
 	_threaded_graphics_resource_building_enabled = enable;
 }
@@ -340,19 +569,68 @@ void VoxelEngine::process() {
 	// Receive generation and meshing results
 	_general_thread_pool.dequeue_completed_tasks([](zylann::IThreadedTask *task) {
 		task->apply_result();
-		ZN_DELETE(task);
+		task->dispose();
 	});
 
+	update_main_thread_time_budget();
+	ZN_PROFILE_PLOT("Main thread budget", int64_t(_main_thread_time_budget_usec));
+	update_adaptive_thread_count();
+	ZN_PROFILE_PLOT("Thread limit", int64_t(_general_thread_pool.get_thread_limit()));
+
 	// Run this after dequeueing threaded tasks, because they can add some to this runner,
 	// which could in turn complete right away (we avoid 1-frame delays this way).
 	_time_spread_task_runner.process(_main_thread_time_budget_usec);
+	_time_spread_tasks_were_left = _time_spread_task_runner.get_pending_count() > 0;
 
 	_progressive_task_runner.process();
 
 	// Update viewer dependencies
 	sync_viewers_task_priority_data();
 
+	trim_memory_pool();
+
 	ZN_PROFILE_PLOT("Pending GPU tasks", int64_t(_gpu_task_runner.get_pending_task_count()));
+
+#ifdef ZN_PROFILER_ENABLED
+	plot_task_latencies();
+#endif
+}
+
+#ifdef ZN_PROFILER_ENABLED
+
+void VoxelEngine::plot_task_latencies() const {
+	// Plot names must be string literals, so they are not generated from categories
+	auto p95 = [](const LatencyHistogram &h) { return int64_t(h.get_percentile_usec(0.95f)); };
+	const TaskLatencyStats &generate = get_task_latency_stats(constants::TASK_LATENCY_GENERATE);
+	const TaskLatencyStats &mesh = get_task_latency_stats(constants::TASK_LATENCY_MESH);
+	const TaskLatencyStats &load = get_task_latency_stats(constants::TASK_LATENCY_LOAD);
+	const TaskLatencyStats &save = get_task_latency_stats(constants::TASK_LATENCY_SAVE);
+	const TaskLatencyStats &detail_texture = get_task_latency_stats(constants::TASK_LATENCY_DETAIL_TEXTURE);
+	const TaskLatencyStats &gpu = get_task_latency_stats(constants::TASK_LATENCY_GPU);
+	ZN_PROFILE_PLOT("Generate wait P95 (us)", p95(generate.wait));
+	ZN_PROFILE_PLOT("Generate run P95 (us)", p95(generate.run));
+	ZN_PROFILE_PLOT("Mesh wait P95 (us)", p95(mesh.wait));
+	ZN_PROFILE_PLOT("Mesh run P95 (us)", p95(mesh.run));
+	ZN_PROFILE_PLOT("Load wait P95 (us)", p95(load.wait));
+	ZN_PROFILE_PLOT("Load run P95 (us)", p95(load.run));
+	ZN_PROFILE_PLOT("Save wait P95 (us)", p95(save.wait));
+	ZN_PROFILE_PLOT("Save run P95 (us)", p95(save.run));
+	ZN_PROFILE_PLOT("Detail texture wait P95 (us)", p95(detail_texture.wait));
+	ZN_PROFILE_PLOT("Detail texture run P95 (us)", p95(detail_texture.run));
+	ZN_PROFILE_PLOT("GPU wait P95 (us)", p95(gpu.wait));
+	ZN_PROFILE_PLOT("GPU run P95 (us)", p95(gpu.run));
+}
+
+#endif
+
+void VoxelEngine::trim_memory_pool() {
+	const uint64_t now_msec = Time::get_singleton()->get_ticks_msec();
+	if (now_msec < _last_memory_pool_trim_time_msec + MEMORY_POOL_TRIM_PERIOD_MSEC) {
+		return;
+	}
+	_last_memory_pool_trim_time_msec = now_msec;
+	ZN_PROFILE_PLOT("VoxelMemoryPool unused", int64_t(VoxelMemoryPool::get_singleton().debug_get_unused_memory()));
+	push_async_task(ZN_NEW(TrimVoxelMemoryPoolTask(now_msec)));
 }
 
 void VoxelEngine::sync_viewers_task_priority_data() {
@@ -371,20 +649,82 @@ void VoxelEngine::sync_viewers_task_priority_data() {
 		// TODO We can avoid the invalidation by using an atomic size or memory barrier?
 		_world.shared_priority_dependency = make_shared_instance<PriorityDependency::ViewersData>();
 		_world.shared_priority_dependency->viewers.resize(viewer_count);
+		_world.shared_priority_dependency->predicted_viewers.resize(viewer_count);
+		_world.shared_priority_dependency->view_cones.resize(viewer_count);
 	}
 
 	PriorityDependency::ViewersData &dep = *_world.shared_priority_dependency;
 
+	const bool viewers_changed = viewer_count != dep.viewers_count;
+
+	const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
+	const float delta_time = _world.last_viewer_sync_time_usec == 0
+			? 0.f
+			: static_cast<float>(now_usec - _world.last_viewer_sync_time_usec) / 1000000.f;
+	_world.last_viewer_sync_time_usec = now_usec;
+
 	size_t i = 0;
 	unsigned int max_distance = 0;
-	_world.viewers.for_each_value([&i, &max_distance, &dep](Viewer &viewer) {
-		dep.viewers[i] = to_vec3f(viewer.world_position);
+	float max_move_distance_sq = 0.f;
+	bool view_cones_changed = false;
+	const float min_view_cone_turn_cos = Math::cos(VIEW_CONE_PRIORITY_UPDATE_ANGLE);
+	_world.viewers.for_each_value([&](Viewer &viewer) {
+		if (viewer.velocity_estimation_enabled) {
+			if (viewer.has_previous_world_position && delta_time > 0.f) {
+				const Vector3 sample_velocity = (viewer.world_position - viewer.previous_world_position) / delta_time;
+				viewer.velocity = viewer.velocity.lerp(sample_velocity, VIEWER_VELOCITY_SMOOTHING);
+			}
+			viewer.previous_world_position = viewer.world_position;
+			viewer.has_previous_world_position = true;
+		}
+
+		const Vector3f position = to_vec3f(viewer.world_position);
+		max_move_distance_sq = math::max(max_move_distance_sq, math::distance_squared(dep.viewers[i], position));
+		dep.viewers[i] = position;
+
+		// Tasks may be kept alive because of predicted positions, so their travel counts too
+		const Vector3f predicted_position = to_vec3f(viewer.get_predicted_world_position());
+		max_move_distance_sq =
+				math::max(max_move_distance_sq, math::distance_squared(dep.predicted_viewers[i], predicted_position));
+		dep.predicted_viewers[i] = predicted_position;
+
+		// View cones are only updated after turning enough, because it invalidates all cached priorities
+		PriorityDependency::ViewCone &cone = dep.view_cones[i];
+		const bool cone_enabled = viewer.view_cone_half_angle > 0.f;
+		const float cos_half_angle = Math::cos(viewer.view_cone_half_angle);
+		const Vector3f view_direction = to_vec3f(viewer.view_direction);
+		if (cone.enabled != cone_enabled ||
+			(cone_enabled &&
+			 (cone.cos_half_angle != cos_half_angle ||
+			  math::dot(cone.direction, view_direction) < min_view_cone_turn_cos))) {
+			cone.direction = view_direction;
+			cone.cos_half_angle = cos_half_angle;
+			cone.enabled = cone_enabled;
+			view_cones_changed = true;
+		}
+
 		max_distance = math::max(max_distance, viewer.view_distances.max());
 		++i;
 	});
 
 	dep.viewers_count = viewer_count;
 
+	if (viewers_changed || view_cones_changed) {
+		++dep.version;
+		_world.viewer_travel_since_priority_update = PRIORITY_UPDATE_TRAVEL_DISTANCE;
+	} else if (max_move_distance_sq > 0.f) {
+		const float move_distance = Math::sqrt(max_move_distance_sq);
+		dep.travelled_distance = dep.travelled_distance + move_distance;
+		_world.viewer_travel_since_priority_update += move_distance;
+	}
+
+	// When viewers move fast, waiting for the next periodic update would let tasks run in the wrong order for a while,
+	// or even run tasks that are now out of range
+	if (_world.viewer_travel_since_priority_update >= PRIORITY_UPDATE_TRAVEL_DISTANCE) {
+		_general_thread_pool.request_priority_update();
+		_world.viewer_travel_since_priority_update = 0.f;
+	}
+
 	// Cancel distance is increased because of two reasons:
 	// - Some volumes use a cubic area which has higher distances on their corners
 	// - Hysteresis is needed to reduce ping-pong
@@ -409,6 +749,7 @@ VoxelEngine::Stats::ThreadPoolStats debug_get_pool_stats(const zylann::ThreadedT
 	d.tasks = pool.get_debug_remaining_tasks();
 	d.active_threads = debug_get_active_thread_count(pool);
 	d.thread_count = pool.get_thread_count();
+	d.thread_limit = pool.get_thread_limit();
 
 	fill(d.active_task_names, (const char *)nullptr);
 	for (unsigned int i = 0; i < d.thread_count; ++i) {
@@ -418,8 +759,27 @@ VoxelEngine::Stats::ThreadPoolStats debug_get_pool_stats(const zylann::ThreadedT
 	return d;
 }
 
+VoxelEngine::Stats::LatencyPercentiles debug_get_latency_percentiles(const TaskLatencyStats &stats) {
+	VoxelEngine::Stats::LatencyPercentiles d;
+	d.count = stats.run.get_count();
+	d.wait_p50_usec = stats.wait.get_percentile_usec(0.50f);
+	d.wait_p95_usec = stats.wait.get_percentile_usec(0.95f);
+	d.wait_p99_usec = stats.wait.get_percentile_usec(0.99f);
+	d.run_p50_usec = stats.run.get_percentile_usec(0.50f);
+	d.run_p95_usec = stats.run.get_percentile_usec(0.95f);
+	d.run_p99_usec = stats.run.get_percentile_usec(0.99f);
+	return d;
+}
+
 } // namespace
 
+const TaskLatencyStats &VoxelEngine::get_task_latency_stats(constants::TaskLatencyCategory category) const {
+	if (category == constants::TASK_LATENCY_GPU) {
+		return _gpu_task_runner.get_latency_stats();
+	}
+	return _general_thread_pool.get_latency_stats(category);
+}
+
 VoxelEngine::Stats VoxelEngine::get_stats() const {
 	Stats s;
 	s.general = debug_get_pool_stats(_general_thread_pool);
@@ -427,7 +787,25 @@ VoxelEngine::Stats VoxelEngine::get_stats() const {
 	s.meshing_tasks = MeshBlockTask::debug_get_running_count();
 	s.streaming_tasks = LoadBlockDataTask::debug_get_running_count() + SaveBlockDataTask::debug_get_running_count();
 	s.main_thread_tasks = _time_spread_task_runner.get_pending_count() + _progressive_task_runner.get_pending_count();
+	s.main_thread_time_budget_usec = _main_thread_time_budget_usec;
+	s.gpu_storage_buffers = _gpu_storage_buffer_pool.get_stats();
+	for (unsigned int i = 0; i < s.task_latencies.size(); ++i) {
+		s.task_latencies[i] =
+				debug_get_latency_percentiles(get_task_latency_stats(static_cast<constants::TaskLatencyCategory>(i)));
+	}
 	return s;
 }
 
+void VoxelEngine::get_memory_usage(StdVector<VolumeMemoryUsage> &out_volumes) const {
+	ZN_PROFILE_SCOPE();
+	_world.volumes.for_each_value([&out_volumes](const Volume &volume) {
+		if (volume.callbacks.memory_usage_callback == nullptr) {
+			return;
+		}
+		VolumeMemoryUsage usage;
+		volume.callbacks.memory_usage_callback(volume.callbacks.data, usage);
+		out_volumes.push_back(usage);
+	});
+}
+
 } // namespace zylann::voxel
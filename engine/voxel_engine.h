@@ -1,11 +1,14 @@
 #ifndef VOXEL_ENGINE_H
 #define VOXEL_ENGINE_H
 
+#include "../constants/voxel_constants.h"
 #include "../meshers/voxel_mesher.h"
 #include "../streams/instance_data.h"
 #include "../util/containers/slot_map.h"
 #include "../util/containers/std_vector.h"
+#include "../util/godot/classes/array_mesh.h"
 #include "../util/godot/classes/rendering_device.h"
+#include "../util/godot/classes/shape_3d.h"
 #include "../util/io/file_locker.h"
 #include "../util/memory/memory.h"
 #include "../util/string/std_string.h"
@@ -13,10 +16,12 @@
 #include "../util/tasks/threaded_task_runner.h"
 #include "../util/tasks/time_spread_task_runner.h"
 #include "detail_rendering/detail_rendering.h"
+#include "generator_output_cache.h"
 #include "gpu/compute_shader.h"
 #include "gpu/gpu_storage_buffer_pool.h"
 #include "gpu/gpu_task_runner.h"
 #include "ids.h"
+#include "memory_usage.h"
 #include "priority_dependency.h"
 
 ZN_GODOT_FORWARD_DECLARE(class RenderingDevice);
@@ -47,6 +52,12 @@ public:
 		// TODO Optimize: candidate for small vector optimization. A big majority of meshes will have a handful of
 		// surfaces, which would fit here without allocating.
 		StdVector<uint16_t> mesh_material_indices;
+		// Only used if `has_staged_surfaces` is true. Surfaces of the mesh already formatted for the renderer, so
+		// building the mesh on the main thread only has to upload them. `mesh_material_indices` applies to them.
+		StdVector<zylann::godot::StagedMeshSurface> staged_surfaces;
+		// Only used if `has_collision_shape` is true. Otherwise, the collision shape has to be built from `surfaces` on
+		// the main thread if it is needed. Can be null if the mesh has no triangles.
+		Ref<Shape3D> collision_shape;
 		// In mesh block coordinates
 		Vector3i position;
 		// TODO Rename lod_index
@@ -54,6 +65,10 @@ public:
 		// Tells if the mesh resource was built as part of the task. If not, you need to build it on the main thread if
 		// it is needed.
 		bool has_mesh_resource;
+		// Tells if the task prepared mesh surfaces for the renderer, when it couldn't build the mesh resource itself.
+		bool has_staged_surfaces = false;
+		// Tells if the collision shape was built as part of the task.
+		bool has_collision_shape = false;
 		// Tells if the meshing task was required to build a rendering mesh if possible.
 		bool visual_was_required;
 		// Can be null. Attached to meshing output so it is tracked more easily, because it is baked asynchronously
@@ -95,6 +110,8 @@ public:
 		void (*mesh_output_callback)(void *, BlockMeshOutput &) = nullptr;
 		void (*data_output_callback)(void *, BlockDataOutput &) = nullptr;
 		void (*detail_texture_output_callback)(void *, BlockDetailTextureOutput &) = nullptr;
+		// Optional. Called on the main thread to report memory used by the volume.
+		void (*memory_usage_callback)(void *, VolumeMemoryUsage &) = nullptr;
 		void *data = nullptr;
 
 		inline bool check_callbacks() const {
@@ -122,14 +139,54 @@ public:
 		// 	FLAGS_COUNT = 3
 		// };
 		Vector3 world_position;
+		// Velocity in world units per second. Either estimated from position changes, or reported by the game.
+		Vector3 velocity;
+		// Position at the previous velocity estimation
+		Vector3 previous_world_position;
 		Distances view_distances;
+		// Direction the viewer is looking at, used when `view_cone_half_angle` is greater than zero
+		Vector3 view_direction = Vector3(0, 0, -1);
+		// Blocks within this angle around the view direction have higher priority. 0 disables it.
+		float view_cone_half_angle = 0.f;
+		// How far ahead in time blocks are streamed along the viewer's motion. 0 disables prediction.
+		float prediction_time = 0.f;
+		bool velocity_estimation_enabled = true;
+		bool has_previous_world_position = false;
 		bool require_collisions = true;
 		bool require_visuals = true;
 		bool requires_data_block_notifications = false;
 		int network_peer_id = -1;
+
+		inline Vector3 get_predicted_world_position() const {
+			return world_position + velocity * prediction_time;
+		}
 	};
 
 	static constexpr unsigned int DEFAULT_MAIN_THREAD_BUDGET_USEC = 8000;
+	static constexpr unsigned int DEFAULT_SAVE_QUEUE_FLUSH_INTERVAL_MSEC = 200;
+	static constexpr unsigned int DEFAULT_SAVE_QUEUE_MAX_BLOCKS = 256;
+	static constexpr unsigned int MIN_ADAPTIVE_MAIN_THREAD_BUDGET_USEC = 1000;
+	static constexpr unsigned int ADAPTIVE_MAIN_THREAD_BUDGET_STEP_USEC = 500;
+	// Frame time the adaptive thread count aims for when the main thread has no target frame time
+	static constexpr unsigned int DEFAULT_ADAPTIVE_THREAD_COUNT_TARGET_FRAME_TIME_USEC = 16667;
+	// A thread is added when more tasks than this are pending per active thread
+	static constexpr unsigned int ADAPTIVE_THREAD_COUNT_BACKLOG_PER_THREAD = 8;
+	// How long conditions must last before the thread count changes
+	static constexpr uint64_t ADAPTIVE_THREAD_COUNT_GROW_DELAY_USEC = 2'000'000;
+	static constexpr uint64_t ADAPTIVE_THREAD_COUNT_SHRINK_DELAY_USEC = 500'000;
+	// Minimum time between two changes of the thread count
+	static constexpr uint64_t ADAPTIVE_THREAD_COUNT_COOLDOWN_USEC = 1'000'000;
+	// After a thread was removed because frames were too long, threads are not added back for this long
+	static constexpr uint64_t ADAPTIVE_THREAD_COUNT_GROW_BACKOFF_USEC = 10'000'000;
+	// Task priorities are updated as soon as viewers have moved by this distance, which is the smallest distance
+	// affecting priority
+	static constexpr float PRIORITY_UPDATE_TRAVEL_DISTANCE = 16.f;
+	// How much a new velocity sample contributes to the estimated velocity of viewers each frame. Smooths out jitter
+	// from frame times and small movements.
+	static constexpr float VIEWER_VELOCITY_SMOOTHING = 0.25f;
+	// Task priorities are updated when the view direction of a viewer turns by more than this angle (in radians).
+	// Turning the camera happens all the time, and a small angle doesn't change much which blocks are in view.
+	static constexpr float VIEW_CONE_PRIORITY_UPDATE_ANGLE = 0.25f;
 
 	struct Config {
 		int thread_count_minimum = 1;
@@ -137,7 +194,35 @@ public:
 		int thread_count_margin_below_max = 1;
 		// Portion of available CPU threads to attempt using
 		float thread_count_ratio_over_max = 0.5;
+		// If enabled, threads are created up to the maximum count, and how many of them run tasks adapts between the
+		// minimum and maximum counts, depending on pending tasks and frame time. The count obtained with the ratio is
+		// used as a starting point.
+		bool thread_count_adaptive = false;
+		// Groups of CPUs threads are restricted to, assigned to threads in turn. Empty means no restriction.
+		StdVector<StdVector<uint32_t>> thread_cpu_affinity_groups;
 		unsigned int main_thread_budget_usec = DEFAULT_MAIN_THREAD_BUDGET_USEC;
+		// If not zero, the main thread time budget adapts to keep frames under this duration, starting from
+		// `main_thread_budget_usec`
+		unsigned int main_thread_target_frame_time_usec = 0;
+		// How much memory VoxelMemoryPool can keep unused for reuse. 0 means no limit.
+		uint64_t memory_pool_unused_budget = 0;
+		// How long VoxelMemoryPool can keep blocks unused before freeing them. 0 means no limit.
+		uint32_t memory_pool_max_idle_time_msec = 0;
+		// If enabled, VoxelMemoryPool carves blocks from large slabs of memory, backed by large pages if possible
+		bool memory_pool_arenas_enabled = false;
+		// How long saved voxel blocks can wait in save queues before being written. 0 means they are written as soon
+		// as possible.
+		uint32_t save_queue_flush_interval_msec = DEFAULT_SAVE_QUEUE_FLUSH_INTERVAL_MSEC;
+		// How many voxel blocks a save queue can hold before they have to be written
+		uint32_t save_queue_max_blocks = DEFAULT_SAVE_QUEUE_MAX_BLOCKS;
+		// If enabled, compute shaders compiled to SPIR-V are saved to disk and loaded next time instead of compiling
+		// them again
+		bool shader_cache_enabled = true;
+		// If enabled, meshing tasks also build collision shapes when needed, so the main thread only has to assign
+		// them. Requires the physics engine to support creating shapes from multiple threads.
+		bool threaded_collision_shape_building_enabled = true;
+		// How much memory blocks produced by generators can use when cached for re-use. 0 disables the cache.
+		uint64_t generator_output_cache_budget = 0;
 	};
 
 	static VoxelEngine &get_singleton();
@@ -150,6 +235,20 @@ public:
 	void remove_volume(VolumeID volume_id);
 	bool is_volume_valid(VolumeID volume_id) const;
 
+	// Tasks of a volume can belong to a group in the general thread pool, so a volume streaming heavily doesn't take
+	// all threads from others. Returns -1 if the volume has no group, which happens when there are too many volumes,
+	// or for tasks created without a volume (default ID, which has version 0).
+	// Thread-safe.
+	static inline int get_volume_task_group(VolumeID volume_id) {
+		if (volume_id.version.value == 0 || volume_id.index >= ThreadedTaskRunner::MAX_GROUPS) {
+			return -1;
+		}
+		return volume_id.index;
+	}
+	// Sets the share of threads tasks of a volume get, relative to other volumes.
+	void set_volume_task_settings(VolumeID volume_id, ThreadedTaskRunner::GroupSettings settings);
+	ThreadedTaskRunner::GroupStats get_volume_task_stats(VolumeID volume_id) const;
+
 	std::shared_ptr<PriorityDependency::ViewersData> get_shared_viewers_data_from_default_world() const {
 		return _world.shared_priority_dependency;
 	}
@@ -167,8 +266,26 @@ public:
 	bool is_viewer_requiring_data_block_notifications(ViewerID viewer_id) const;
 	void set_viewer_network_peer_id(ViewerID viewer_id, int peer_id);
 	int get_viewer_network_peer_id(ViewerID viewer_id) const;
+	void set_viewer_prediction_time(ViewerID viewer_id, float seconds);
+	float get_viewer_prediction_time(ViewerID viewer_id) const;
+	// When enabled, velocity is estimated from position changes. Otherwise, it has to be set with
+	// `set_viewer_velocity`.
+	void set_viewer_velocity_estimation_enabled(ViewerID viewer_id, bool enabled);
+	void set_viewer_velocity(ViewerID viewer_id, Vector3 velocity);
+	Vector3 get_viewer_velocity(ViewerID viewer_id) const;
+	void set_viewer_view_direction(ViewerID viewer_id, Vector3 direction);
+	// Half-angle in radians of the cone around the view direction in which blocks are prioritized. 0 disables it.
+	void set_viewer_view_cone_half_angle(ViewerID viewer_id, float radians);
+	float get_viewer_view_cone_half_angle(ViewerID viewer_id) const;
 	bool viewer_exists(ViewerID viewer_id) const;
 	void sync_viewers_task_priority_data();
+	void update_main_thread_time_budget();
+	void update_adaptive_thread_count();
+
+	// Limits running threads to the minimum count, for example when the device runs on battery. Threads are not
+	// destroyed, so they can resume quickly when this is turned off.
+	void set_thread_power_saving_enabled(bool enabled);
+	bool is_thread_power_saving_enabled() const;
 
 	template <typename F>
 	inline void for_each_viewer(F f) const {
@@ -180,7 +297,11 @@ public:
 			TimeSpreadTaskRunner::Priority priority = TimeSpreadTaskRunner::PRIORITY_NORMAL
 	);
 	int get_main_thread_time_budget_usec() const;
+	// When the target frame time is set, the budget keeps adapting from the value given here.
 	void set_main_thread_time_budget_usec(unsigned int usec);
+	// When not zero, the main thread time budget shrinks when frames take longer than this, and grows back while tasks
+	// are pending and frames are short enough.
+	void set_main_thread_target_frame_time_usec(unsigned int usec);
 
 	// Allows/disallows building Mesh and Texture resources from inside threads.
 	// Depends on Godot's efficiency at doing so, and which renderer is used.
@@ -191,6 +312,25 @@ public:
 
 	void push_main_thread_progressive_task(IProgressiveTask *task);
 
+	// Thread-safe.
+	inline uint32_t get_save_queue_flush_interval_msec() const {
+		return _save_queue_flush_interval_msec;
+	}
+	// Thread-safe.
+	inline uint32_t get_save_queue_max_blocks() const {
+		return _save_queue_max_blocks;
+	}
+
+	// Thread-safe.
+	inline unsigned int get_thread_count() const {
+		return _general_thread_pool.get_thread_count();
+	}
+	// Thread-safe. How many threads are allowed to run tasks. Can be lower than the thread count when it is adaptive
+	// or power saving is enabled.
+	inline unsigned int get_thread_limit() const {
+		return _general_thread_pool.get_thread_limit();
+	}
+
 	// Thread-safe.
 	void push_async_task(IThreadedTask *task);
 	// Thread-safe.
@@ -208,6 +348,10 @@ public:
 		return _file_locker;
 	}
 
+	inline GeneratorOutputCache &get_generator_output_cache() {
+		return _generator_output_cache;
+	}
+
 	static inline int get_octree_lod_block_region_extent(float lod_distance, float block_size) {
 		// This is a bounding radius of blocks around a viewer within which we may load them.
 		// `lod_distance` is the distance under which a block should subdivide into a smaller one.
@@ -218,20 +362,54 @@ public:
 	struct Stats {
 		struct ThreadPoolStats {
 			unsigned int thread_count;
+			// Threads allowed to run tasks, others are parked
+			unsigned int thread_limit;
 			unsigned int active_threads;
 			unsigned int tasks;
 			FixedArray<const char *, ThreadedTaskRunner::MAX_THREADS> active_task_names;
 		};
 
+		struct LatencyPercentiles {
+			uint64_t count;
+			// Time spent between scheduling and running
+			uint64_t wait_p50_usec;
+			uint64_t wait_p95_usec;
+			uint64_t wait_p99_usec;
+			// Time spent running
+			uint64_t run_p50_usec;
+			uint64_t run_p95_usec;
+			uint64_t run_p99_usec;
+		};
+
 		ThreadPoolStats general;
+		// Indexed by `constants::TaskLatencyCategory`
+		FixedArray<LatencyPercentiles, constants::TASK_LATENCY_CATEGORY_COUNT> task_latencies;
 		int generation_tasks;
 		int streaming_tasks;
 		int meshing_tasks;
 		int main_thread_tasks;
+		unsigned int main_thread_time_budget_usec;
+		GPUStorageBufferPool::Stats gpu_storage_buffers;
 	};
 
 	Stats get_stats() const;
 
+	// Gathers memory used by each volume that reports it. Must be called on the main thread.
+	void get_memory_usage(StdVector<VolumeMemoryUsage> &out_volumes) const;
+
+	// Gets latency histograms of a type of task since the engine started
+	const TaskLatencyStats &get_task_latency_stats(constants::TaskLatencyCategory category) const;
+
+	// Thread-safe.
+	inline bool is_shader_cache_enabled() const {
+		return _shader_cache_enabled;
+	}
+
+	// Thread-safe.
+	inline bool is_threaded_collision_shape_building_enabled() const {
+		return _threaded_collision_shape_building_enabled;
+	}
+
 	bool has_rendering_device() const {
 		return _rendering_device != nullptr;
 	}
@@ -269,6 +447,10 @@ public:
 		return _block_modifier_mesh_shader;
 	}
 
+	const ComputeShader &get_block_output_pack_shader() const {
+		return _block_output_pack_shader;
+	}
+
 	RID get_filtering_sampler() const {
 		return _filtering_sampler_rid;
 	}
@@ -301,6 +483,10 @@ private:
 	VoxelEngine(Config config);
 
 	void load_shaders();
+	void trim_memory_pool();
+#ifdef ZN_PROFILER_ENABLED
+	void plot_task_latencies() const;
+#endif
 
 	// Since we are going to send data to tasks running in multiple threads, a few strategies are in place:
 	//
@@ -324,6 +510,9 @@ private:
 
 		// Must be overwritten with a new instance if count changes.
 		std::shared_ptr<PriorityDependency::ViewersData> shared_priority_dependency;
+		// Largest distance viewers moved since task priorities were last requested to update
+		float viewer_travel_since_priority_update = 0.f;
+		uint64_t last_viewer_sync_time_usec = 0;
 	};
 
 	// TODO multi-world support in the future
@@ -333,10 +522,39 @@ private:
 	// For tasks that can only run on the main thread and be spread out over frames
 	TimeSpreadTaskRunner _time_spread_task_runner;
 	unsigned int _main_thread_time_budget_usec = DEFAULT_MAIN_THREAD_BUDGET_USEC;
+	unsigned int _main_thread_target_frame_time_usec = 0;
+	uint64_t _last_process_time_usec = 0;
+	// Time between the last two calls to `process`. 0 on the first frame.
+	uint64_t _last_frame_time_usec = 0;
+
+	struct AdaptiveThreadCount {
+		bool enabled = false;
+		bool power_saving = false;
+		uint32_t minimum = 1;
+		uint32_t maximum = 1;
+		// Smoothed so a single long frame, like when a scene loads, doesn't remove threads
+		uint64_t average_frame_time_usec = 0;
+		// How long frames have been missing the target
+		uint64_t missed_target_duration_usec = 0;
+		// How long tasks have been piling up while frames were meeting the target
+		uint64_t backlog_duration_usec = 0;
+		uint64_t last_change_time_usec = 0;
+		uint64_t last_decrease_time_usec = 0;
+	};
+	AdaptiveThreadCount _adaptive_thread_count;
+	// True if time-spread tasks were left pending last frame, because of the time budget
+	bool _time_spread_tasks_were_left = false;
+	// Only set at construction
+	uint32_t _save_queue_flush_interval_msec = DEFAULT_SAVE_QUEUE_FLUSH_INTERVAL_MSEC;
+	uint32_t _save_queue_max_blocks = DEFAULT_SAVE_QUEUE_MAX_BLOCKS;
+	bool _shader_cache_enabled = true;
+	bool _threaded_collision_shape_building_enabled = true;
 	ProgressiveTaskRunner _progressive_task_runner;
 
 	FileLocker _file_locker;
 
+	GeneratorOutputCache _generator_output_cache;
+
 	bool _threaded_graphics_resource_building_enabled = false;
 
 	// Rendering device used for compute shaders. May not be available depending on the chosen renderer.
@@ -356,6 +574,9 @@ private:
 	ComputeShader _detail_modifier_mesh_shader;
 	ComputeShader _block_modifier_sphere_shader;
 	ComputeShader _block_modifier_mesh_shader;
+	ComputeShader _block_output_pack_shader;
+
+	uint64_t _last_memory_pool_trim_time_msec = 0;
 
 	// There can be multiple types of generation tasks, so we count them with a common counter.
 	std::atomic_int _debug_generate_block_task_count = { 0 };
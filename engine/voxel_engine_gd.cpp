@@ -5,8 +5,12 @@
 #include "../util/godot/classes/project_settings.h"
 #include "../util/godot/classes/rendering_server.h"
 #include "../util/godot/core/packed_arrays.h"
+#include "../util/godot/core/string.h"
+#include "../util/io/log.h"
+#include "../util/light_profiler.h"
 #include "../util/macros.h"
 #include "../util/profiling.h"
+#include "../util/string/format.h"
 #include "../util/tasks/godot/threaded_task_gd.h"
 #include "voxel_engine.h"
 
@@ -31,6 +35,44 @@ void VoxelEngine::destroy_singleton() {
 	g_voxel_engine = nullptr;
 }
 
+namespace {
+
+// Parses groups of CPU indices separated with `;`. Each group is a list of indices or ranges separated with `,`.
+// For example, "0-15,32-47;16-31,48-63" makes two groups of 32 CPUs.
+StdVector<StdVector<uint32_t>> parse_cpu_affinity_groups(const String &str) {
+	StdVector<StdVector<uint32_t>> groups;
+	const PackedStringArray group_strs = str.split(";", false);
+	for (int group_index = 0; group_index < group_strs.size(); ++group_index) {
+		StdVector<uint32_t> group;
+		const PackedStringArray item_strs = group_strs[group_index].split(",", false);
+		for (int item_index = 0; item_index < item_strs.size(); ++item_index) {
+			const String item_str = item_strs[item_index].strip_edges();
+			const int dash_pos = item_str.find("-");
+			const String begin_str = dash_pos == -1 ? item_str : item_str.substr(0, dash_pos).strip_edges();
+			const String end_str = dash_pos == -1 ? item_str : item_str.substr(dash_pos + 1).strip_edges();
+			if (!begin_str.is_valid_int() || !end_str.is_valid_int()) {
+				ZN_PRINT_ERROR(format("Invalid CPU index or range in \"{}\"", GodotStringWrapper(str)));
+				continue;
+			}
+			const int64_t begin = begin_str.to_int();
+			const int64_t end = end_str.to_int();
+			if (begin < 0 || end < begin) {
+				ZN_PRINT_ERROR(format("Invalid CPU index or range in \"{}\"", GodotStringWrapper(str)));
+				continue;
+			}
+			for (int64_t i = begin; i <= end; ++i) {
+				group.push_back(i);
+			}
+		}
+		if (group.size() > 0) {
+			groups.push_back(std::move(group));
+		}
+	}
+	return groups;
+}
+
+} // namespace
+
 VoxelEngine::Config VoxelEngine::get_config_from_godot() {
 	ZN_ASSERT(ProjectSettings::get_singleton() != nullptr);
 	ProjectSettings &ps = *ProjectSettings::get_singleton();
@@ -46,13 +88,57 @@ VoxelEngine::Config VoxelEngine::get_config_from_godot() {
 	add_custom_project_setting(
 			Variant::FLOAT, "voxel/threads/count/ratio_over_max", PROPERTY_HINT_RANGE, "0,1,0.1", 0.5f, true
 	);
+	add_custom_project_setting(Variant::BOOL, "voxel/threads/count/adaptive", PROPERTY_HINT_NONE, "", false, true);
 	add_custom_project_setting(
 			Variant::INT, "voxel/threads/main/time_budget_ms", PROPERTY_HINT_RANGE, "0,1000", 8, true
 	);
+	add_custom_project_setting(
+			Variant::FLOAT, "voxel/threads/main/target_frame_time_ms", PROPERTY_HINT_RANGE, "0,100,0.1", 0.f, true
+	);
+	add_custom_project_setting(
+			Variant::STRING, "voxel/threads/cpu_affinity", PROPERTY_HINT_PLACEHOLDER_TEXT, "0-15;16-31", "", true
+	);
 
 	add_custom_project_setting(Variant::BOOL, "voxel/ownership_checks", PROPERTY_HINT_NONE, "", true, true);
 
+	add_custom_project_setting(
+			Variant::INT, "voxel/memory/unused_budget_mb", PROPERTY_HINT_RANGE, "0,65536,1,or_greater", 0, true
+	);
+	add_custom_project_setting(
+			Variant::INT, "voxel/memory/max_idle_time_s", PROPERTY_HINT_RANGE, "0,3600,1,or_greater", 60, true
+	);
+	add_custom_project_setting(Variant::BOOL, "voxel/memory/large_page_arenas", PROPERTY_HINT_NONE, "", false, true);
+	add_custom_project_setting(
+			Variant::INT, "voxel/memory/generator_cache_budget_mb", PROPERTY_HINT_RANGE, "0,65536,1,or_greater", 0, true
+	);
+
+	add_custom_project_setting(
+			Variant::INT,
+			"voxel/streaming/save_flush_interval_ms",
+			PROPERTY_HINT_RANGE,
+			"0,10000,1,or_greater",
+			zylann::voxel::VoxelEngine::DEFAULT_SAVE_QUEUE_FLUSH_INTERVAL_MSEC,
+			true
+	);
+	add_custom_project_setting(
+			Variant::INT,
+			"voxel/streaming/save_queue_max_blocks",
+			PROPERTY_HINT_RANGE,
+			"1,65536,1,or_greater",
+			zylann::voxel::VoxelEngine::DEFAULT_SAVE_QUEUE_MAX_BLOCKS,
+			true
+	);
+
+	add_custom_project_setting(Variant::BOOL, "voxel/gpu/shader_cache", PROPERTY_HINT_NONE, "", true, true);
+
+	add_custom_project_setting(
+			Variant::BOOL, "voxel/physics/threaded_collision_shape_building", PROPERTY_HINT_NONE, "", true, true
+	);
+
 	config.inner.main_thread_budget_usec = 1000 * int(ps.get("voxel/threads/main/time_budget_ms"));
+	const float target_frame_time_ms = ps.get("voxel/threads/main/target_frame_time_ms");
+	config.inner.main_thread_target_frame_time_usec =
+			static_cast<unsigned int>(1000.f * math::max(target_frame_time_ms, 0.f));
 
 	config.inner.thread_count_minimum = math::max(1, int(ps.get("voxel/threads/count/minimum")));
 
@@ -63,8 +149,28 @@ VoxelEngine::Config VoxelEngine::get_config_from_godot() {
 	config.inner.thread_count_ratio_over_max =
 			math::clamp(float(ps.get("voxel/threads/count/ratio_over_max")), 0.f, 1.f);
 
+	config.inner.thread_count_adaptive = ps.get("voxel/threads/count/adaptive");
+
+	config.inner.thread_cpu_affinity_groups = parse_cpu_affinity_groups(ps.get("voxel/threads/cpu_affinity"));
+
 	config.ownership_checks = ps.get("voxel/ownership_checks");
 
+	config.inner.memory_pool_unused_budget =
+			uint64_t(math::max(int64_t(0), int64_t(ps.get("voxel/memory/unused_budget_mb")))) * 1024 * 1024;
+	config.inner.memory_pool_max_idle_time_msec =
+			1000 * uint32_t(math::max(int64_t(0), int64_t(ps.get("voxel/memory/max_idle_time_s"))));
+	config.inner.memory_pool_arenas_enabled = ps.get("voxel/memory/large_page_arenas");
+	config.inner.generator_output_cache_budget =
+			uint64_t(math::max(int64_t(0), int64_t(ps.get("voxel/memory/generator_cache_budget_mb")))) * 1024 * 1024;
+
+	config.inner.save_queue_flush_interval_msec =
+			uint32_t(math::max(int64_t(0), int64_t(ps.get("voxel/streaming/save_flush_interval_ms"))));
+	config.inner.save_queue_max_blocks =
+			uint32_t(math::max(int64_t(1), int64_t(ps.get("voxel/streaming/save_queue_max_blocks"))));
+
+	config.inner.shader_cache_enabled = ps.get("voxel/gpu/shader_cache");
+	config.inner.threaded_collision_shape_building_enabled = ps.get("voxel/physics/threaded_collision_shape_building");
+
 	return config;
 }
 
@@ -95,6 +201,7 @@ Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats::ThreadPoolStats &sta
 	d["tasks"] = stats.tasks;
 	d["active_threads"] = stats.active_threads;
 	d["thread_count"] = stats.thread_count;
+	d["thread_limit"] = stats.thread_limit;
 
 	PackedStringArray task_names;
 	{
@@ -113,6 +220,18 @@ Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats::ThreadPoolStats &sta
 	return d;
 }
 
+Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats::LatencyPercentiles &stats) {
+	Dictionary d;
+	d["count"] = stats.count;
+	d["wait_p50_usec"] = stats.wait_p50_usec;
+	d["wait_p95_usec"] = stats.wait_p95_usec;
+	d["wait_p99_usec"] = stats.wait_p99_usec;
+	d["run_p50_usec"] = stats.run_p50_usec;
+	d["run_p95_usec"] = stats.run_p95_usec;
+	d["run_p99_usec"] = stats.run_p99_usec;
+	return d;
+}
+
 Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats &stats) {
 	Dictionary pools;
 	pools["general"] = to_dict(stats.general);
@@ -122,12 +241,43 @@ Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats &stats) {
 	tasks["generation"] = stats.generation_tasks;
 	tasks["meshing"] = stats.meshing_tasks;
 	tasks["main_thread"] = stats.main_thread_tasks;
+	tasks["main_thread_time_budget_usec"] = stats.main_thread_time_budget_usec;
+
+	using namespace zylann::voxel::constants;
+	Dictionary latencies;
+	latencies["generate"] = to_dict(stats.task_latencies[TASK_LATENCY_GENERATE]);
+	latencies["mesh"] = to_dict(stats.task_latencies[TASK_LATENCY_MESH]);
+	latencies["load"] = to_dict(stats.task_latencies[TASK_LATENCY_LOAD]);
+	latencies["save"] = to_dict(stats.task_latencies[TASK_LATENCY_SAVE]);
+	latencies["detail_texture"] = to_dict(stats.task_latencies[TASK_LATENCY_DETAIL_TEXTURE]);
+	latencies["gpu"] = to_dict(stats.task_latencies[TASK_LATENCY_GPU]);
 
 	// This part is additional for scripts because VoxelMemoryPool is not exposed
 	Dictionary mem;
 	mem["voxel_total"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_total_memory());
 	mem["voxel_used"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_used_memory());
 	mem["block_count"] = VoxelMemoryPool::get_singleton().debug_get_used_blocks();
+	const VoxelMemoryPool::ThreadCacheStats cache_stats =
+			VoxelMemoryPool::get_singleton().debug_get_thread_cache_total_stats();
+	mem["voxel_thread_cache_hits"] = cache_stats.hits;
+	mem["voxel_thread_cache_misses"] = cache_stats.misses;
+	mem["voxel_unused"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_unused_memory());
+	mem["voxel_arenas"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_arena_memory());
+	mem["voxel_large_page_slabs"] = VoxelMemoryPool::get_singleton().debug_get_large_page_slab_count();
+	Array size_classes;
+	for (unsigned int pool_index = 0; pool_index < VoxelMemoryPool::get_pool_count(); ++pool_index) {
+		const VoxelMemoryPool::PoolStats pool_stats = VoxelMemoryPool::get_singleton().debug_get_pool_stats(pool_index);
+		if (pool_stats.allocated_blocks == 0) {
+			continue;
+		}
+		Dictionary size_class;
+		size_class["block_size"] = ZN_SIZE_T_TO_VARIANT(pool_stats.block_size);
+		size_class["allocated_blocks"] = pool_stats.allocated_blocks;
+		size_class["unused_blocks"] = pool_stats.unused_blocks;
+		size_class["slab_count"] = pool_stats.slab_count;
+		size_classes.append(size_class);
+	}
+	mem["voxel_size_classes"] = size_classes;
 #ifdef DEBUG_ENABLED
 	const uint64_t std_allocated = static_cast<int64_t>(StdDefaultAllocatorCounters::g_allocated);
 	const uint64_t std_deallocated = static_cast<int64_t>(StdDefaultAllocatorCounters::g_deallocated);
@@ -140,10 +290,18 @@ Dictionary to_dict(const zylann::voxel::VoxelEngine::Stats &stats) {
 	mem["std_current"] = -1;
 #endif
 
+	Dictionary gpu;
+	gpu["storage_buffer_allocated"] = ZN_SIZE_T_TO_VARIANT(stats.gpu_storage_buffers.allocated_bytes);
+	gpu["storage_buffer_used"] = ZN_SIZE_T_TO_VARIANT(stats.gpu_storage_buffers.used_bytes);
+	gpu["storage_buffer_peak_used"] = ZN_SIZE_T_TO_VARIANT(stats.gpu_storage_buffers.peak_used_bytes);
+	gpu["storage_buffers_created"] = stats.gpu_storage_buffers.created_buffers;
+
 	Dictionary d;
 	d["thread_pools"] = pools;
 	d["tasks"] = tasks;
+	d["task_latencies"] = latencies;
 	d["memory_pools"] = mem;
+	d["gpu"] = gpu;
 	return d;
 }
 
@@ -152,12 +310,92 @@ Dictionary VoxelEngine::get_stats() const {
 	return to_dict(zylann::voxel::VoxelEngine::get_singleton().get_stats());
 }
 
+Dictionary VoxelEngine::get_memory_usage() const {
+	ZN_PROFILE_SCOPE();
+	zylann::voxel::VoxelEngine &engine = zylann::voxel::VoxelEngine::get_singleton();
+	const zylann::voxel::VoxelEngine::Stats stats = engine.get_stats();
+
+	Dictionary tasks;
+	tasks["streaming"] = stats.streaming_tasks;
+	tasks["generation"] = stats.generation_tasks;
+	tasks["meshing"] = stats.meshing_tasks;
+	tasks["main_thread"] = stats.main_thread_tasks;
+	tasks["general_pool"] = stats.general.tasks;
+
+	Dictionary shared;
+	shared["voxel_pool_used"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_used_memory());
+	shared["voxel_pool_total"] = ZN_SIZE_T_TO_VARIANT(VoxelMemoryPool::get_singleton().debug_get_total_memory());
+	shared["generator_output_cache"] = engine.get_generator_output_cache().get_stats().memory_usage_bytes;
+	shared["gpu_storage_buffers"] = ZN_SIZE_T_TO_VARIANT(stats.gpu_storage_buffers.allocated_bytes);
+	shared["pending_tasks"] = tasks;
+
+	StdVector<VolumeMemoryUsage> volume_usages;
+	engine.get_memory_usage(volume_usages);
+
+	Array volumes;
+	for (const VolumeMemoryUsage &usage : volume_usages) {
+		Dictionary bytes;
+		for (unsigned int i = 0; i < VolumeMemoryUsage::CATEGORY_COUNT; ++i) {
+			bytes[VolumeMemoryUsage::get_category_name(VolumeMemoryUsage::Category(i))] = usage.bytes[i];
+		}
+		Dictionary volume;
+		volume["object_id"] = usage.object_id;
+		volume["data_blocks"] = usage.data_block_count;
+		volume["mesh_blocks"] = usage.mesh_block_count;
+		volume["total"] = usage.get_total();
+		volume["bytes"] = bytes;
+		volumes.append(volume);
+	}
+
+	Dictionary d;
+	d["engine"] = shared;
+	d["volumes"] = volumes;
+	return d;
+}
+
 void VoxelEngine::schedule_task(Ref<ZN_ThreadedTask> task) {
 	ERR_FAIL_COND(task.is_null());
 	ERR_FAIL_COND_MSG(task->is_scheduled(), "Cannot schedule again a task that is already scheduled");
 	zylann::voxel::VoxelEngine::get_singleton().push_async_task(task->create_task());
 }
 
+void VoxelEngine::set_thread_power_saving_enabled(bool enabled) {
+	zylann::voxel::VoxelEngine::get_singleton().set_thread_power_saving_enabled(enabled);
+}
+
+bool VoxelEngine::is_thread_power_saving_enabled() const {
+	return zylann::voxel::VoxelEngine::get_singleton().is_thread_power_saving_enabled();
+}
+
+void VoxelEngine::set_light_profiler_enabled(bool enabled) {
+	light_profiler::set_enabled(enabled);
+}
+
+bool VoxelEngine::is_light_profiler_enabled() const {
+	return light_profiler::is_enabled();
+}
+
+void VoxelEngine::clear_light_profiler() {
+	light_profiler::clear();
+}
+
+Dictionary VoxelEngine::get_light_profiler_counters() const {
+	StdVector<light_profiler::CounterSample> counters;
+	light_profiler::get_counters(counters);
+	Dictionary d;
+	for (const light_profiler::CounterSample &counter : counters) {
+		d[counter.name] = counter.value;
+	}
+	return d;
+}
+
+String VoxelEngine::get_light_profiler_chrome_trace() const {
+	ZN_PROFILE_SCOPE();
+	StdString json;
+	light_profiler::write_chrome_trace(json);
+	return to_godot(json);
+}
+
 void VoxelEngine::_on_rendering_server_frame_post_draw() {
 #ifdef ZN_PROFILER_ENABLED
 	ZN_PROFILE_MARK_FRAME();
@@ -186,6 +424,17 @@ void VoxelEngine::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_version_minor"), &VoxelEngine::get_version_minor);
 	ClassDB::bind_method(D_METHOD("get_version_patch"), &VoxelEngine::get_version_patch);
 	ClassDB::bind_method(D_METHOD("get_stats"), &VoxelEngine::get_stats);
+	ClassDB::bind_method(D_METHOD("get_memory_usage"), &VoxelEngine::get_memory_usage);
+
+	ClassDB::bind_method(
+			D_METHOD("set_thread_power_saving_enabled", "enabled"), &VoxelEngine::set_thread_power_saving_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_thread_power_saving_enabled"), &VoxelEngine::is_thread_power_saving_enabled);
+	ClassDB::bind_method(D_METHOD("set_light_profiler_enabled", "enabled"), &VoxelEngine::set_light_profiler_enabled);
+	ClassDB::bind_method(D_METHOD("is_light_profiler_enabled"), &VoxelEngine::is_light_profiler_enabled);
+	ClassDB::bind_method(D_METHOD("clear_light_profiler"), &VoxelEngine::clear_light_profiler);
+	ClassDB::bind_method(D_METHOD("get_light_profiler_counters"), &VoxelEngine::get_light_profiler_counters);
+	ClassDB::bind_method(D_METHOD("get_light_profiler_chrome_trace"), &VoxelEngine::get_light_profiler_chrome_trace);
 }
 
 } // namespace zylann::voxel::godot
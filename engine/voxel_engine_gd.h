@@ -32,8 +32,18 @@ public:
 	int get_version_patch() const;
 
 	Dictionary get_stats() const;
+	Dictionary get_memory_usage() const;
 	void schedule_task(Ref<ZN_ThreadedTask> task);
 
+	void set_thread_power_saving_enabled(bool enabled);
+	bool is_thread_power_saving_enabled() const;
+
+	void set_light_profiler_enabled(bool enabled);
+	bool is_light_profiler_enabled() const;
+	void clear_light_profiler();
+	Dictionary get_light_profiler_counters() const;
+	String get_light_profiler_chrome_trace() const;
+
 #ifdef TOOLS_ENABLED
 	void set_editor_camera_info(Vector3 position, Vector3 direction);
 	Vector3 get_editor_camera_position() const;
@@ -1,4 +1,6 @@
 #include "generate_block_gpu_task.h"
+#include "../constants/voxel_constants.h"
+#include "../engine/gpu/compute_resource_cache.h"
 #include "../engine/gpu/compute_shader.h"
 #include "../engine/gpu/compute_shader_parameters.h"
 #include "../engine/voxel_engine.h"
@@ -20,18 +22,48 @@ GenerateBlockGPUTask::~GenerateBlockGPUTask() {
 		// If we get here, it means the engine got shut down before a mesh task could complete,
 		// so we still have ownership on this task and it should be deleted from here.
 		ZN_PRINT_VERBOSE("Freeing interrupted consumer task");
-		// TODO We may not assume how this task was allocated
-		ZN_DELETE(consumer_task);
+		consumer_task->dispose();
 	}
 }
 
+namespace {
+
+// Must match the shader
+const unsigned int MAX_PACKED_OUTPUTS = 8;
+const unsigned int PACK_GROUP_SIZE = 64;
+
+// SDF is downloaded as 16-bit values, which halves the amount of data to read back from the graphics card, and is
+// the format voxel buffers use by default. Other outputs are downloaded as floats.
+inline GenerateBlockGPUTaskResult::Format get_download_format(VoxelGenerator::ShaderOutput::Type type) {
+	return type == VoxelGenerator::ShaderOutput::TYPE_SDF ? GenerateBlockGPUTaskResult::FORMAT_SNORM16
+														  : GenerateBlockGPUTaskResult::FORMAT_FLOAT32;
+}
+
+// Size in bytes of one output of one box in the shared output buffer
+unsigned int get_download_size(GenerateBlockGPUTaskResult::Format format, unsigned int volume) {
+	switch (format) {
+		case GenerateBlockGPUTaskResult::FORMAT_SNORM16:
+			// Values are packed by pairs into 32-bit elements
+			return ((volume + 1) / 2) * sizeof(uint32_t);
+		case GenerateBlockGPUTaskResult::FORMAT_FLOAT32:
+			return volume * sizeof(float);
+		default:
+			ZN_CRASH_MSG("Unhandled format");
+			return 0;
+	}
+}
+
+} // namespace
+
 unsigned int GenerateBlockGPUTask::get_required_shared_output_buffer_size() const {
-	unsigned int volume = 0;
+	unsigned int size = 0;
 	for (const Box3i &box : boxes_to_generate) {
-		volume += Vector3iUtil::get_volume(box.size);
+		const unsigned int volume = Vector3iUtil::get_volume(box.size);
+		for (const VoxelGenerator::ShaderOutput &output : generator_shader_outputs->outputs) {
+			size += get_download_size(get_download_format(output.type), volume);
+		}
 	}
-	// All outputs are floats at the moment...
-	return generator_shader_outputs->outputs.size() * volume * sizeof(float);
+	return size;
 }
 
 void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
@@ -44,6 +76,10 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 	ZN_ASSERT_RETURN(generator_shader_params != nullptr);
 	ZN_ASSERT_RETURN(generator_shader_outputs != nullptr);
 	ZN_ASSERT_RETURN(generator_shader_outputs->outputs.size() > 0);
+	ZN_ASSERT_RETURN(generator_shader_outputs->outputs.size() <= MAX_PACKED_OUTPUTS);
+
+	const ComputeShader &pack_shader = VoxelEngine::get_singleton().get_block_output_pack_shader();
+	ZN_ASSERT_RETURN(pack_shader.is_valid());
 
 	ZN_ASSERT(consumer_task != nullptr);
 
@@ -67,7 +103,8 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 
 	_boxes_data.resize(boxes_to_generate.size());
 
-	unsigned int out_offset_elements = 0;
+	const unsigned int output_count = generator_shader_outputs->outputs.size();
+	unsigned int out_offset_bytes = 0;
 
 	for (unsigned int i = 0; i < _boxes_data.size(); ++i) {
 		BoxData &bd = _boxes_data[i];
@@ -88,9 +125,8 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 		params.origin_in_voxels = to_vec3f((box.position << lod_index) + origin_in_voxels);
 		params.voxel_size = 1 << lod_index;
 		params.block_size = buffer_resolution;
-		params.output_buffer_start = (ctx.shared_output_buffer_begin / sizeof(float)) + out_offset_elements;
-
-		out_offset_elements += buffer_volume * generator_shader_outputs->outputs.size();
+		// Outputs are written to a separate buffer first
+		params.output_buffer_start = 0;
 
 		PackedByteArray params_pba;
 		zylann::godot::copy_bytes_to(params_pba, params);
@@ -104,25 +140,74 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 
 		// Output
 
+		bd.work_sb = storage_buffer_pool.allocate(output_count * buffer_volume * sizeof(float));
+		ERR_FAIL_COND(bd.work_sb.is_null());
+
 		bd.output_uniform.instantiate();
 		bd.output_uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
-		bd.output_uniform->add_id(ctx.shared_output_buffer_rid);
+		bd.output_uniform->add_id(bd.work_sb.rid);
+
+		// Packing into the shared output buffer
+
+		struct PackParams {
+			int32_t volume;
+			int32_t output_count;
+			int32_t dst_offset;
+			float sd_scale;
+			FixedArray<int32_t, MAX_PACKED_OUTPUTS> packed_outputs;
+		};
+
+		PackParams pack_params;
+		pack_params.volume = buffer_volume;
+		pack_params.output_count = output_count;
+		pack_params.dst_offset = (ctx.shared_output_buffer_begin + out_offset_bytes) / sizeof(uint32_t);
+		pack_params.sd_scale = constants::QUANTIZED_SDF_16_BITS_SCALE;
+		fill(pack_params.packed_outputs, int32_t(0));
+		for (unsigned int output_index = 0; output_index < output_count; ++output_index) {
+			const GenerateBlockGPUTaskResult::Format format =
+					get_download_format(generator_shader_outputs->outputs[output_index].type);
+			pack_params.packed_outputs[output_index] = format == GenerateBlockGPUTaskResult::FORMAT_SNORM16 ? 1 : 0;
+			out_offset_bytes += get_download_size(format, buffer_volume);
+		}
+
+		PackedByteArray pack_params_pba;
+		zylann::godot::copy_bytes_to(pack_params_pba, pack_params);
+
+		bd.pack_params_sb = storage_buffer_pool.allocate(pack_params_pba);
+		ERR_FAIL_COND(bd.pack_params_sb.is_null());
+
+		bd.pack_params_uniform.instantiate();
+		bd.pack_params_uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
+		bd.pack_params_uniform->add_id(bd.pack_params_sb.rid);
 	}
 
+	Ref<RDUniform> shared_output_uniform;
+	shared_output_uniform.instantiate();
+	shared_output_uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
+	shared_output_uniform->add_id(ctx.shared_output_buffer_rid);
+
 	// Pipelines
-	// Not sure what a pipeline is required for in compute shaders, it seems to be required "just because"
+	// Not sure what a pipeline is required for in compute shaders, it seems to be required "just because".
+	// They are kept in a cache along with uniform sets, so they don't have to be created again for every batch.
+
+	ComputeResourceCache &resource_cache = ctx.compute_resource_cache;
 
 	const RID generator_shader_rid = generator_shader->get_rid();
-	_generator_pipeline_rid = rd.compute_pipeline_create(generator_shader_rid);
-	ERR_FAIL_COND(!_generator_pipeline_rid.is_valid());
+	const RID generator_pipeline_rid = resource_cache.get_or_create_compute_pipeline(generator_shader_rid);
+	ERR_FAIL_COND(!generator_pipeline_rid.is_valid());
 
+	StdVector<RID> modifier_pipelines;
 	for (const ModifierData &modifier : modifiers) {
 		ERR_FAIL_COND(!modifier.shader_rid.is_valid());
-		const RID rid = rd.compute_pipeline_create(modifier.shader_rid);
+		const RID rid = resource_cache.get_or_create_compute_pipeline(modifier.shader_rid);
 		ERR_FAIL_COND(!rid.is_valid());
-		_modifier_pipelines.push_back(rid);
+		modifier_pipelines.push_back(rid);
 	}
 
+	const RID pack_shader_rid = pack_shader.get_rid();
+	const RID pack_pipeline_rid = resource_cache.get_or_create_compute_pipeline(pack_shader_rid);
+	ERR_FAIL_COND(!pack_pipeline_rid.is_valid());
+
 	// Make compute list
 
 	const int compute_list_id = rd.compute_list_begin();
@@ -148,12 +233,13 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 		// Note, this internally locks RenderingDeviceVulkan's class mutex. Which means it could perhaps be used outside
 		// of the compute list (which already locks the class mutex until it ends). Thankfully, it uses a recursive
 		// Mutex (instead of BinaryMutex)
+		// Params buffers come from a pool, so the same sets are found again in later batches.
 		const RID generator_uniform_set =
-				zylann::godot::uniform_set_create(rd, generator_uniforms, generator_shader_rid, 0);
+				resource_cache.get_or_create_uniform_set(generator_uniforms, generator_shader_rid, 0);
 
 		{
 			ZN_PROFILE_SCOPE_NAMED("compute_list_bind_compute_pipeline");
-			rd.compute_list_bind_compute_pipeline(compute_list_id, _generator_pipeline_rid);
+			rd.compute_list_bind_compute_pipeline(compute_list_id, generator_pipeline_rid);
 		}
 		{
 			ZN_PROFILE_SCOPE_NAMED("compute_list_bind_uniform_set");
@@ -204,9 +290,9 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 				}
 
 				const RID modifier_uniform_set =
-						zylann::godot::uniform_set_create(rd, modifier_uniforms, modifier_data.shader_rid, 0);
+						resource_cache.get_or_create_uniform_set(modifier_uniforms, modifier_data.shader_rid, 0);
 
-				const RID pipeline_rid = _modifier_pipelines[modifier_index];
+				const RID pipeline_rid = modifier_pipelines[modifier_index];
 				rd.compute_list_bind_compute_pipeline(compute_list_id, pipeline_rid);
 				rd.compute_list_bind_uniform_set(compute_list_id, modifier_uniform_set, 0);
 
@@ -217,6 +303,30 @@ void GenerateBlockGPUTask::prepare(GPUTaskContext &ctx) {
 		}
 	}
 
+	// Pack outputs into the shared buffer that will be downloaded. Previous steps ended with a barrier.
+
+	for (unsigned int box_index = 0; box_index < _boxes_data.size(); ++box_index) {
+		BoxData &bd = _boxes_data[box_index];
+
+		bd.pack_params_uniform->set_binding(0);
+		bd.output_uniform->set_binding(1);
+		shared_output_uniform->set_binding(2);
+
+		Array pack_uniforms;
+		pack_uniforms.resize(3);
+		pack_uniforms[0] = bd.pack_params_uniform;
+		pack_uniforms[1] = bd.output_uniform;
+		pack_uniforms[2] = shared_output_uniform;
+
+		const RID pack_uniform_set = resource_cache.get_or_create_uniform_set(pack_uniforms, pack_shader_rid, 0);
+
+		const unsigned int pair_count = (Vector3iUtil::get_volume(boxes_to_generate[box_index].size) + 1) / 2;
+
+		rd.compute_list_bind_compute_pipeline(compute_list_id, pack_pipeline_rid);
+		rd.compute_list_bind_uniform_set(compute_list_id, pack_uniform_set, 0);
+		rd.compute_list_dispatch(compute_list_id, math::ceildiv(pair_count, PACK_GROUP_SIZE), 1, 1);
+	}
+
 	rd.compute_list_end();
 }
 
@@ -238,7 +348,7 @@ void convert_gpu_output_sdf(VoxelBuffer &dst, Span<const float> src_data_f, cons
 	ZN_PROFILE_SCOPE();
 
 	const VoxelBuffer::Depth depth = dst.get_channel_depth(VoxelBuffer::CHANNEL_SDF);
-	const float sd_scale = VoxelBuffer::get_sdf_quantization_scale(depth);
+	const float sd_scale = dst.get_sdf_channel_quantization_scale();
 
 	switch (depth) {
 		case VoxelBuffer::DEPTH_8_BIT: {
@@ -278,6 +388,64 @@ void convert_gpu_output_sdf(VoxelBuffer &dst, Span<const float> src_data_f, cons
 	}
 }
 
+// Values were quantized on the graphics card with the same scale as 16-bit SDF
+void convert_gpu_output_sdf_snorm16(VoxelBuffer &dst, Span<const int16_t> src_data_s16, const Box3i &box) {
+	ZN_PROFILE_SCOPE();
+
+	const VoxelBuffer::Depth depth = dst.get_channel_depth(VoxelBuffer::CHANNEL_SDF);
+	const float sd_scale = dst.get_sdf_channel_quantization_scale();
+
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT: {
+			Span<int8_t> sd_data = get_temporary_conversion_memory_tls<int8_t>(src_data_s16.size());
+			for (unsigned int i = 0; i < src_data_s16.size(); ++i) {
+				const float sd = s16_to_snorm(src_data_s16[i]) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
+				sd_data[i] = snorm_to_s8(sd_scale * sd);
+			}
+			dst.copy_channel_from(
+					sd_data.to_const(), box.size, Vector3i(), box.size, box.position, VoxelBuffer::CHANNEL_SDF
+			);
+		} break;
+
+		case VoxelBuffer::DEPTH_16_BIT:
+			if (sd_scale == constants::QUANTIZED_SDF_16_BITS_SCALE) {
+				// Same format, no conversion needed
+				dst.copy_channel_from(
+						src_data_s16, box.size, Vector3i(), box.size, box.position, VoxelBuffer::CHANNEL_SDF
+				);
+			} else {
+				// The buffer uses a different quantization factor
+				Span<int16_t> sd_data = get_temporary_conversion_memory_tls<int16_t>(src_data_s16.size());
+				for (unsigned int i = 0; i < src_data_s16.size(); ++i) {
+					const float sd = s16_to_snorm(src_data_s16[i]) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
+					sd_data[i] = snorm_to_s16(sd_scale * sd);
+				}
+				dst.copy_channel_from(
+						sd_data.to_const(), box.size, Vector3i(), box.size, box.position, VoxelBuffer::CHANNEL_SDF
+				);
+			}
+			break;
+
+		case VoxelBuffer::DEPTH_32_BIT: {
+			Span<float> sd_data = get_temporary_conversion_memory_tls<float>(src_data_s16.size());
+			for (unsigned int i = 0; i < src_data_s16.size(); ++i) {
+				sd_data[i] = s16_to_snorm(src_data_s16[i]) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
+			}
+			dst.copy_channel_from(
+					sd_data.to_const(), box.size, Vector3i(), box.size, box.position, VoxelBuffer::CHANNEL_SDF
+			);
+		} break;
+
+		case VoxelBuffer::DEPTH_64_BIT: {
+			ZN_PRINT_ERROR("64-bit SDF is not supported");
+		} break;
+
+		default:
+			ZN_PRINT_ERROR("Unhandled depth");
+			break;
+	}
+}
+
 void convert_gpu_output_single_texture(VoxelBuffer &dst, Span<const float> src_data_f, const Box3i &box) {
 	ZN_PROFILE_SCOPE();
 	const uint16_t encoded_weights = encode_weights_to_packed_u16_lossy(255, 0, 0, 0);
@@ -377,8 +545,16 @@ void convert_gpu_output_uint(
 } // namespace
 
 void GenerateBlockGPUTaskResult::convert_to_voxel_buffer(VoxelBuffer &dst) {
-	// Shaders can only output float arrays for now. Also looks like GLSL does not have 8-bit or 16-bit data types?
-	// TODO Should we convert in the compute shader to reduce bandwidth and CPU work?
+	if (_format == FORMAT_SNORM16) {
+		// Only SDF is packed at the moment. Values are packed by pairs, so there can be one extra value.
+		ZN_ASSERT_RETURN(_type == VoxelGenerator::ShaderOutput::TYPE_SDF);
+		Span<const int16_t> src_data_s16 =
+				_bytes.reinterpret_cast_to<const int16_t>().sub(0, Vector3iUtil::get_volume(_box.size));
+		convert_gpu_output_sdf_snorm16(dst, src_data_s16, _box);
+		return;
+	}
+
+	// Other outputs are floats. Looks like GLSL does not have 8-bit or 16-bit data types?
 	Span<const float> src_data_f = _bytes.reinterpret_cast_to<const float>();
 
 	switch (_type) {
@@ -417,7 +593,6 @@ void GenerateBlockGPUTask::collect(GPUTaskContext &ctx) {
 	ZN_PROFILE_SCOPE();
 	ZN_DSTACK();
 
-	RenderingDevice &rd = ctx.rendering_device;
 	GPUStorageBufferPool &storage_buffer_pool = ctx.storage_buffer_pool;
 
 	StdVector<GenerateBlockGPUTaskResult> results;
@@ -433,34 +608,34 @@ void GenerateBlockGPUTask::collect(GPUTaskContext &ctx) {
 		BoxData &bd = _boxes_data[box_index];
 		const Box3i box = boxes_to_generate[box_index];
 
-		// Every output is the same size for now
-		const unsigned int size_per_output = Vector3iUtil::get_volume(box.size) * sizeof(float);
+		const unsigned int volume = Vector3iUtil::get_volume(box.size);
 
 		for (unsigned int output_index = 0; output_index < generator_shader_outputs->outputs.size(); ++output_index) {
 			const VoxelGenerator::ShaderOutput &output_info = generator_shader_outputs->outputs[output_index];
+			const GenerateBlockGPUTaskResult::Format format = get_download_format(output_info.type);
+			const unsigned int output_size = get_download_size(format, volume);
 
 			GenerateBlockGPUTaskResult result(
 					box,
 					output_info.type,
+					format,
 					// Get span for that specific output
-					outputs_bytes.sub(box_offset + size_per_output * output_index, size_per_output),
+					outputs_bytes.sub(box_offset, output_size),
 					// Pass reference to the backing buffer to keep it valid until all consumers are done with it
 					ctx.downloaded_shared_output_data
 			);
 
 			results.push_back(result);
-		}
 
-		box_offset += size_per_output * generator_shader_outputs->outputs.size();
+			box_offset += output_size;
+		}
 
 		storage_buffer_pool.recycle(bd.params_sb);
+		storage_buffer_pool.recycle(bd.work_sb);
+		storage_buffer_pool.recycle(bd.pack_params_sb);
 	}
 
-	zylann::godot::free_rendering_device_rid(rd, _generator_pipeline_rid);
-
-	for (RID rid : _modifier_pipelines) {
-		zylann::godot::free_rendering_device_rid(rd, rid);
-	}
+	// Pipelines and uniform sets are owned by the resource cache, they are not freed here
 
 	// We leave conversion to the CPU task, because we have only one thread for GPU work and it only exists for waiting
 	// blocking functions, not doing work
@@ -14,13 +14,21 @@ namespace zylann::voxel {
 
 class GenerateBlockGPUTaskResult {
 public:
+	// How values are stored in the downloaded buffer
+	enum Format {
+		FORMAT_FLOAT32,
+		// Signed normalized 16-bit values, scaled the same way as 16-bit SDF in voxel buffers
+		FORMAT_SNORM16
+	};
+
 	GenerateBlockGPUTaskResult(
 			Box3i p_box,
 			VoxelGenerator::ShaderOutput::Type p_type,
+			Format p_format,
 			Span<const uint8_t> p_bytes,
 			PackedByteArray p_shared_bytes
 	) :
-			_box(p_box), _type(p_type), _bytes(p_bytes), _shared_bytes(p_shared_bytes) {}
+			_box(p_box), _type(p_type), _format(p_format), _bytes(p_bytes), _shared_bytes(p_shared_bytes) {}
 
 	static void convert_to_voxel_buffer(Span<GenerateBlockGPUTaskResult> boxes_data, VoxelBuffer &dst);
 
@@ -29,6 +37,7 @@ private:
 
 	Box3i _box;
 	VoxelGenerator::ShaderOutput::Type _type;
+	Format _format;
 	// Span of the shared output buffer pertaining to results in this particular box.
 	Span<const uint8_t> _bytes;
 	// This is the buffer that was directly downloaded from GPU. It is shared among multiple consumers, and should
@@ -80,13 +89,15 @@ public:
 private:
 	struct BoxData {
 		GPUStorageBuffer params_sb;
+		// Outputs as floats. They are only used on the graphics card, then packed into the shared output buffer.
+		GPUStorageBuffer work_sb;
+		GPUStorageBuffer pack_params_sb;
 		Ref<RDUniform> params_uniform;
 		Ref<RDUniform> output_uniform;
+		Ref<RDUniform> pack_params_uniform;
 	};
 
 	StdVector<BoxData> _boxes_data;
-	RID _generator_pipeline_rid;
-	StdVector<RID> _modifier_pipelines;
 };
 
 } // namespace zylann::voxel
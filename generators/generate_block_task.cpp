@@ -38,7 +38,7 @@ GenerateBlockTask::~GenerateBlockTask() {
 
 void GenerateBlockTask::run(zylann::ThreadedTaskContext &ctx) {
 	ZN_DSTACK();
-	ZN_PROFILE_SCOPE();
+	ZN_PROFILE_SCOPE_NAMED("GenerateBlockTask::run");
 
 	CRASH_COND(_stream_dependency == nullptr);
 	Ref<VoxelGenerator> generator = _stream_dependency->generator;
@@ -48,6 +48,8 @@ void GenerateBlockTask::run(zylann::ThreadedTaskContext &ctx) {
 		_voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
 		_voxels->create(_block_size, _block_size, _block_size);
 	}
+	// Distant LODs store larger distances, so they are quantized with a wider range
+	_voxels->set_sdf_quantization_factor(VoxelBuffer::get_sdf_quantization_factor_for_lod(_lod_index));
 
 	if (_use_gpu) {
 		if (_stage == 0) {
@@ -127,9 +129,28 @@ void GenerateBlockTask::run_cpu_generation() {
 
 	Ref<VoxelGenerator> generator = _stream_dependency->generator;
 
+	// Other terrains using the same generator may have generated the same block already
+	GeneratorOutputCache &cache = VoxelEngine::get_singleton().get_generator_output_cache();
+	const bool use_cache = cache.is_enabled();
+	GeneratorOutputCache::Key cache_key;
+	bool found_in_cache = false;
+	if (use_cache) {
+		// The key must be obtained before generating, in case the generator changes in the meantime
+		cache_key = GeneratorOutputCache::make_key(**generator, *_voxels, origin_in_voxels, _lod_index);
+		found_in_cache = cache.try_load(cache_key, *_voxels);
+	}
+
 	VoxelGenerator::VoxelQueryData query_data{ *_voxels, origin_in_voxels, _lod_index };
-	const VoxelGenerator::Result result = generator->generate_block(query_data);
-	_max_lod_hint = result.max_lod_hint;
+
+	if (!found_in_cache) {
+		const VoxelGenerator::Result result = generator->generate_block(query_data);
+		// TODO The hint isn't cached, it is only an optimization
+		_max_lod_hint = result.max_lod_hint;
+
+		if (use_cache) {
+			cache.store(cache_key, *_voxels);
+		}
+	}
 
 	if (_data != nullptr) {
 		_data->get_modifiers().apply(
@@ -140,6 +161,7 @@ void GenerateBlockTask::run_cpu_generation() {
 }
 
 void GenerateBlockTask::run_stream_saving_and_finish() {
+	ZN_PROFILE_COUNTER_ADD("Voxel blocks generated", 1);
 	if (_stream_dependency->valid) {
 		Ref<VoxelStream> stream = _stream_dependency->stream;
 
@@ -161,7 +183,7 @@ void GenerateBlockTask::run_stream_saving_and_finish() {
 					_volume_id, _position, _lod_index, voxels_copy, _stream_dependency, nullptr, false
 			));
 
-			VoxelEngine::get_singleton().push_async_io_task(save_task);
+			VoxelEngine::get_singleton().push_async_task(save_task);
 		}
 	}
 
@@ -177,6 +199,10 @@ TaskPriority GenerateBlockTask::get_priority() {
 	return p;
 }
 
+int GenerateBlockTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(_volume_id);
+}
+
 bool GenerateBlockTask::is_cancelled() {
 	if (_stream_dependency->valid == false) {
 		return false;
@@ -187,6 +213,10 @@ bool GenerateBlockTask::is_cancelled() {
 	return _too_far; // || stream_dependency->stream->get_fallback_generator().is_null();
 }
 
+void GenerateBlockTask::dispose() {
+	ThreadedTaskPool<GenerateBlockTask>::get_singleton().recycle(this);
+}
+
 void GenerateBlockTask::apply_result() {
 	bool aborted = true;
 
@@ -1,11 +1,13 @@
 #ifndef GENERATE_BLOCK_TASK_H
 #define GENERATE_BLOCK_TASK_H
 
+#include "../constants/voxel_constants.h"
 #include "../engine/ids.h"
 #include "../engine/priority_dependency.h"
 #include "../engine/streaming_dependency.h"
 #include "../util/containers/std_vector.h"
 #include "../util/tasks/threaded_task.h"
+#include "../util/tasks/threaded_task_pool.h"
 #include "generate_block_gpu_task.h"
 
 namespace zylann {
@@ -26,10 +28,17 @@ public:
 		return "GenerateBlock";
 	}
 
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_GENERATE;
+	}
+
 	void run(ThreadedTaskContext &ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 	void apply_result() override;
+	// Instances are allocated with `ThreadedTaskPool<GenerateBlockTask>`, so they go back to it
+	void dispose() override;
 
 	void set_gpu_results(StdVector<GenerateBlockGPUTaskResult> &&results) override;
 
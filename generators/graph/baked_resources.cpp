@@ -0,0 +1,84 @@
+#include "baked_resources.h"
+#include "../../util/errors.h"
+#include "../../util/godot/classes/curve.h"
+#include "../../util/godot/classes/image.h"
+#include "../../util/string/format.h"
+
+namespace zylann {
+
+CurveLUT::CurveLUT() {
+	_values.push_back(0.f);
+}
+
+void CurveLUT::bake(Curve &curve) {
+	// Also makes sure the curve is baked before we read it
+	curve.bake();
+
+	const int res = curve.get_bake_resolution();
+	_values.clear();
+
+	if (res < 2) {
+		_values.push_back(curve.sample_baked(0.f));
+	} else {
+		_values.resize(res);
+		// Same positions as the baked cache of Curve, so sampling gives the same results
+		for (int i = 0; i < res; ++i) {
+			_values[i] = curve.sample_baked(static_cast<float>(i) / (res - 1));
+		}
+	}
+
+	_last_index = _values.size() - 1;
+	_last_index_f = _last_index;
+}
+
+namespace {
+
+bool is_red_8bit(Image::Format format) {
+	switch (format) {
+		case Image::FORMAT_L8:
+		case Image::FORMAT_LA8:
+		case Image::FORMAT_R8:
+		case Image::FORMAT_RG8:
+		case Image::FORMAT_RGB8:
+		case Image::FORMAT_RGBA8:
+			return true;
+		default:
+			return false;
+	}
+}
+
+} // namespace
+
+void ImagePixels::bake(const Image &im) {
+	ZN_ASSERT_RETURN_MSG(!im.is_compressed(), format("Image format not supported: {}", im.get_format()));
+
+	_width = im.get_width();
+	_height = im.get_height();
+	_u8.clear();
+	_f32.clear();
+
+	const unsigned int pixel_count = _width * _height;
+
+	// This is a one-time cost at compile time, so we don't need direct access to image data
+	if (is_red_8bit(im.get_format())) {
+		_u8.resize(pixel_count);
+		unsigned int i = 0;
+		for (int y = 0; y < _height; ++y) {
+			for (int x = 0; x < _width; ++x) {
+				_u8[i] = static_cast<uint8_t>(math::clamp(Math::round(im.get_pixel(x, y).r * 255.f), 0.f, 255.f));
+				++i;
+			}
+		}
+	} else {
+		_f32.resize(pixel_count);
+		unsigned int i = 0;
+		for (int y = 0; y < _height; ++y) {
+			for (int x = 0; x < _width; ++x) {
+				_f32[i] = im.get_pixel(x, y).r;
+				++i;
+			}
+		}
+	}
+}
+
+} // namespace zylann
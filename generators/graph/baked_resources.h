@@ -0,0 +1,117 @@
+#ifndef VOXEL_GRAPH_BAKED_RESOURCES_H
+#define VOXEL_GRAPH_BAKED_RESOURCES_H
+
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/macros.h"
+#include "../../util/math/funcs.h"
+#include <cstdint>
+
+ZN_GODOT_FORWARD_DECLARE(class Curve)
+ZN_GODOT_FORWARD_DECLARE(class Image)
+
+namespace zylann {
+
+// Copy of the baked values of a Curve, sampled the same way as `Curve::sample_baked` over the range [0..1].
+// Unlike Curve, it can be sampled from multiple threads without going through the Godot API, and sampling has no
+// branches, so loops using it can be vectorized by the compiler.
+class CurveLUT {
+public:
+	CurveLUT();
+
+	void bake(Curve &curve);
+
+	inline float sample(float x) const {
+		const float fi = x * _last_index_f;
+		// Written such that NaN clamps to 0
+		float cfi = fi > 0.f ? fi : 0.f;
+		cfi = cfi < _last_index_f ? cfi : _last_index_f;
+		const unsigned int i0 = static_cast<unsigned int>(cfi);
+		const unsigned int i1 = math::min(i0 + 1, _last_index);
+		return math::lerp(_values[i0], _values[i1], cfi - static_cast<float>(i0));
+	}
+
+	inline unsigned int get_resolution() const {
+		return _values.size();
+	}
+
+private:
+	// Never empty
+	StdVector<float> _values;
+	unsigned int _last_index = 0;
+	float _last_index_f = 0.f;
+};
+
+// Copy of the red channel of an Image, which is what graph nodes sample. Formats with 8 bits per channel are kept as
+// bytes, other formats are converted to floats.
+// Unlike Image, it can be sampled from multiple threads without going through the Godot API.
+class ImagePixels {
+public:
+	struct PixelsU8 {
+		const uint8_t *data;
+
+		inline float get(unsigned int i) const {
+			return static_cast<float>(data[i]) / 255.f;
+		}
+	};
+
+	struct PixelsF32 {
+		const float *data;
+
+		inline float get(unsigned int i) const {
+			return data[i];
+		}
+	};
+
+	void bake(const Image &im);
+
+	inline int get_width() const {
+		return _width;
+	}
+
+	inline int get_height() const {
+		return _height;
+	}
+
+	// Calls `f` with either `PixelsU8` or `PixelsF32`, depending on the format. Doing this once per buffer rather than
+	// once per pixel keeps the format out of loops.
+	template <typename F>
+	inline void visit(F f) const {
+		if (_u8.size() > 0) {
+			f(PixelsU8{ _u8.data() });
+		} else {
+			f(PixelsF32{ _f32.data() });
+		}
+	}
+
+private:
+	StdVector<uint8_t> _u8;
+	StdVector<float> _f32;
+	int _width = 0;
+	int _height = 0;
+};
+
+template <typename Pixels_T>
+inline float get_pixel_repeat(const Pixels_T &pixels, int x, int y, int w, int h) {
+	return pixels.get(math::wrap(x, w) + math::wrap(y, h) * w);
+}
+
+template <typename Pixels_T>
+inline float get_pixel_repeat_linear(const Pixels_T &pixels, float x, float y, int w, int h) {
+	const int x0 = int(Math::floor(x));
+	const int y0 = int(Math::floor(y));
+
+	const float xf = x - x0;
+	const float yf = y - y0;
+
+	const float h00 = get_pixel_repeat(pixels, x0, y0, w, h);
+	const float h10 = get_pixel_repeat(pixels, x0 + 1, y0, w, h);
+	const float h01 = get_pixel_repeat(pixels, x0, y0 + 1, w, h);
+	const float h11 = get_pixel_repeat(pixels, x0 + 1, y0 + 1, w, h);
+
+	// Bilinear filter
+	return Math::lerp(Math::lerp(h00, h10, xf), Math::lerp(h01, h11, xf), yf);
+}
+
+} // namespace zylann
+
+#endif // VOXEL_GRAPH_BAKED_RESOURCES_H
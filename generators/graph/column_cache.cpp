@@ -0,0 +1,125 @@
+#include "column_cache.h"
+#include "../../util/errors.h"
+#include "../../util/math/funcs.h"
+#include <cstring>
+
+namespace zylann::voxel {
+
+namespace {
+
+// Buffers not read by the query may not have been computed when using an execution map
+inline bool is_buffer_read(const pg::Runtime::Buffer &buffer, bool using_execution_map) {
+	return !using_execution_map || buffer.local_users_count > 0;
+}
+
+} // namespace
+
+void GraphColumnCache::set_capacity(unsigned int capacity) {
+	MutexLock mlock(_mutex);
+	_capacity = math::max(capacity, 1u);
+	while (_columns.size() > _capacity) {
+		evict_least_recently_used();
+	}
+}
+
+void GraphColumnCache::evict_least_recently_used() {
+	// Linear search is fine, the cache doesn't have to be large, and this is much cheaper than computing a column
+	auto oldest_it = _columns.begin();
+	for (auto it = _columns.begin(); it != _columns.end(); ++it) {
+		if (it->second.last_used_time < oldest_it->second.last_used_time) {
+			oldest_it = it;
+		}
+	}
+	if (oldest_it != _columns.end()) {
+		_columns.erase(oldest_it);
+	}
+}
+
+void GraphColumnCache::clear() {
+	MutexLock mlock(_mutex);
+	_columns.clear();
+}
+
+bool GraphColumnCache::try_load(
+		Vector3i key,
+		const pg::Runtime::State &state,
+		Span<const uint16_t> addresses,
+		bool using_execution_map
+) {
+	const unsigned int buffer_size = state.get_buffer_size();
+
+	MutexLock mlock(_mutex);
+
+	auto it = _columns.find(key);
+	if (it == _columns.end()) {
+		return false;
+	}
+	Column &column = it->second;
+
+	if (column.buffer_size != buffer_size || column.valid.size() != addresses.size()) {
+		return false;
+	}
+
+	for (unsigned int i = 0; i < addresses.size(); ++i) {
+		const pg::Runtime::Buffer &buffer = state.get_buffer(addresses[i]);
+		if (is_buffer_read(buffer, using_execution_map) && !column.valid[i]) {
+			return false;
+		}
+	}
+
+	for (unsigned int i = 0; i < addresses.size(); ++i) {
+		if (!column.valid[i]) {
+			continue;
+		}
+		const pg::Runtime::Buffer &buffer = state.get_buffer(addresses[i]);
+		ZN_ASSERT(buffer.data != nullptr);
+		memcpy(buffer.data, column.values.data() + i * buffer_size, buffer_size * sizeof(float));
+	}
+
+	column.last_used_time = ++_time;
+	return true;
+}
+
+void GraphColumnCache::store(
+		Vector3i key,
+		const pg::Runtime::State &state,
+		Span<const uint16_t> addresses,
+		bool using_execution_map
+) {
+	const unsigned int buffer_size = state.get_buffer_size();
+
+	MutexLock mlock(_mutex);
+
+	auto it = _columns.find(key);
+
+	if (it == _columns.end()) {
+		if (_columns.size() >= _capacity) {
+			evict_least_recently_used();
+		}
+		it = _columns.insert(std::make_pair(key, Column())).first;
+	}
+
+	Column &column = it->second;
+
+	if (column.buffer_size != buffer_size || column.valid.size() != addresses.size()) {
+		column.buffer_size = buffer_size;
+		column.values.resize(addresses.size() * buffer_size);
+		column.valid.clear();
+		column.valid.resize(addresses.size(), 0);
+	}
+
+	// Values previously cached remain valid, since they only depend on the column
+	for (unsigned int i = 0; i < addresses.size(); ++i) {
+		const pg::Runtime::Buffer &buffer = state.get_buffer(addresses[i]);
+		if (!is_buffer_read(buffer, using_execution_map)) {
+			continue;
+		}
+		ZN_ASSERT(buffer.data != nullptr);
+		memcpy(column.values.data() + i * buffer_size, buffer.data, buffer_size * sizeof(float));
+		column.valid[i] = 1;
+	}
+
+	column.last_used_time = ++_time;
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,59 @@
+#ifndef VOXEL_GRAPH_COLUMN_CACHE_H
+#define VOXEL_GRAPH_COLUMN_CACHE_H
+
+#include "../../util/containers/span.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
+#include "voxel_graph_runtime.h"
+
+namespace zylann::voxel {
+
+// Stores values computed by the outer group of a graph (operations only depending on X and Z), so areas above or below
+// each other in the same column can re-use them instead of computing them again. This typically avoids re-computing
+// heightmaps for every block of a tall terrain.
+// It can be used by multiple threads. When full, the least recently used columns are discarded.
+class GraphColumnCache {
+public:
+	// Columns are identified by the origin of the area they cover in voxels along X and Z, and by LOD index.
+	static inline Vector3i make_key(int origin_x, int origin_z, unsigned int lod_index) {
+		return Vector3i(origin_x, origin_z, lod_index);
+	}
+
+	void set_capacity(unsigned int capacity);
+	void clear();
+
+	// Copies cached values into buffers of the state. Returns false if the column isn't cached, or if one of the
+	// buffers that will be read by the query wasn't cached, in which case buffers must be computed as usual.
+	bool try_load(
+			Vector3i key,
+			const pg::Runtime::State &state,
+			Span<const uint16_t> addresses,
+			bool using_execution_map
+	);
+
+	// Saves values of buffers of the state. Must be called after the outer group ran.
+	void store(Vector3i key, const pg::Runtime::State &state, Span<const uint16_t> addresses, bool using_execution_map);
+
+private:
+	struct Column {
+		// Values of each buffer one after the other
+		StdVector<float> values;
+		// Which buffers have valid values. When using an execution map, some buffers may not have been computed.
+		StdVector<uint8_t> valid;
+		unsigned int buffer_size = 0;
+		uint32_t last_used_time = 0;
+	};
+
+	void evict_least_recently_used();
+
+	StdUnorderedMap<Vector3i, Column> _columns;
+	unsigned int _capacity = 256;
+	uint32_t _time = 0;
+	BinaryMutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_GRAPH_COLUMN_CACHE_H
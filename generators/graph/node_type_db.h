@@ -81,6 +81,9 @@ struct NodeType {
 	bool debug_only = false;
 	// Pseudo nodes are replaced during compilation with one or multiple real nodes, they have no logic on their own
 	bool is_pseudo_node = false;
+	// Elementwise nodes compute each output value only from input values at the same index, and process as many
+	// values as their buffers' `size`. Such nodes can be fused, i.e run over chunks of buffers one after the other.
+	bool is_elementwise = false;
 	Category category;
 	StdVector<Port> inputs;
 	StdVector<Port> outputs;
@@ -1,5 +1,6 @@
 #include "../../../util/godot/classes/curve.h"
 #include "../../../util/profiling.h"
+#include "../baked_resources.h"
 #include "../node_type_db.h"
 #include "../range_utility.h"
 
@@ -10,8 +11,7 @@ void register_curve_node(Span<NodeType> types) {
 
 	{
 		struct Params {
-			// TODO Should be `const` but isn't because it auto-bakes, and it's a concern for multithreading
-			Curve *curve;
+			const CurveLUT *curve_lut;
 			const CurveRangeData *curve_range_data;
 		};
 		NodeType &t = types[VoxelGraphFunction::NODE_CURVE];
@@ -36,15 +36,17 @@ void register_curve_node(Span<NodeType> types) {
 				ctx.make_error(String(ZN_TTR("{0} instance is null")).format(varray(Curve::get_class_static())));
 				return;
 			}
-			// Make sure it is baked. We don't want multithreading to bail out because of a write operation
-			// happening in `interpolate_baked`...
-			curve->bake();
+			// Take a copy of baked values, so evaluation doesn't have to go through the Curve, which isn't
+			// thread-safe and is slow to call per element
+			CurveLUT *curve_lut = ZN_NEW(CurveLUT);
+			curve_lut->bake(**curve);
 			CurveRangeData *curve_range_data = ZN_NEW(CurveRangeData);
-			get_curve_monotonic_sections(**curve, curve_range_data->sections);
+			get_curve_range_data(**curve, *curve_range_data);
 			Params p;
+			p.curve_lut = curve_lut;
 			p.curve_range_data = curve_range_data;
-			p.curve = *curve;
 			ctx.set_params(p);
+			ctx.add_delete_cleanup(curve_lut);
 			ctx.add_delete_cleanup(curve_range_data);
 		};
 		t.process_buffer_func = [](Runtime::ProcessBufferContext &ctx) {
@@ -52,18 +54,19 @@ void register_curve_node(Span<NodeType> types) {
 			const Runtime::Buffer &a = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
+			const CurveLUT &lut = *p.curve_lut;
 			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = p.curve->sample_baked(a.data[i]);
+				out.data[i] = lut.sample(a.data[i]);
 			}
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
 			const Params p = ctx.get_params<Params>();
 			if (a.is_single_value()) {
-				const float v = p.curve->sample_baked(a.min);
+				const float v = p.curve_lut->sample(a.min);
 				ctx.set_output(0, Interval::from_single_value(v));
 			} else {
-				const Interval r = get_curve_range(*p.curve, p.curve_range_data->sections, a);
+				const Interval r = get_curve_range(*p.curve_lut, *p.curve_range_data, a);
 				ctx.set_output(0, r);
 			}
 		};
@@ -1,33 +1,12 @@
 #include "../../../constants/voxel_constants.h"
 #include "../../../util/godot/classes/image.h"
 #include "../../../util/profiling.h"
+#include "../baked_resources.h"
 #include "../image_range_grid.h"
 #include "../node_type_db.h"
 
 namespace zylann::voxel::pg {
 
-inline float get_pixel_repeat(const Image &im, int x, int y, int w, int h) {
-	return im.get_pixel(math::wrap(x, w), math::wrap(y, h)).r;
-}
-
-inline float get_pixel_repeat_linear(const Image &im, float x, float y, int im_w, int im_h) {
-	const int x0 = int(Math::floor(x));
-	const int y0 = int(Math::floor(y));
-
-	const float xf = x - x0;
-	const float yf = y - y0;
-
-	const float h00 = get_pixel_repeat(im, x0, y0, im_w, im_h);
-	const float h10 = get_pixel_repeat(im, x0 + 1, y0, im_w, im_h);
-	const float h01 = get_pixel_repeat(im, x0, y0 + 1, im_w, im_h);
-	const float h11 = get_pixel_repeat(im, x0 + 1, y0 + 1, im_w, im_h);
-
-	// Bilinear filter
-	const float h = Math::lerp(Math::lerp(h00, h10, xf), Math::lerp(h01, h11, xf), yf);
-
-	return h;
-}
-
 inline float skew3(float x) {
 	return (x * x * x + x) * 0.5f;
 }
@@ -37,13 +16,16 @@ inline math::Interval skew3(math::Interval x) {
 }
 
 // This is mostly useful for generating planets from an existing heightmap
+template <typename Pixels_T>
 inline float sdf_sphere_heightmap(
 		float x,
 		float y,
 		float z,
 		float r,
 		float m,
-		const Image &im,
+		const Pixels_T &pixels,
+		int im_w,
+		int im_h,
 		float min_h,
 		float max_h,
 		float norm_x,
@@ -69,7 +51,7 @@ inline float sdf_sphere_heightmap(
 	const float ys = skew3(ny);
 	const float uvy = -0.5f * ys + 0.5f;
 	// TODO Could use bicubic interpolation when the image is sampled at lower resolution than voxels
-	const float h = get_pixel_repeat_linear(im, uvx * norm_x, uvy * norm_y, im.get_width(), im.get_height());
+	const float h = get_pixel_repeat_linear(pixels, uvx * norm_x, uvy * norm_y, im_w, im_h);
 	return sd - m * h;
 }
 
@@ -120,7 +102,7 @@ void register_image_nodes(Span<NodeType> types) {
 	{
 		enum Filter : uint32_t { FILTER_NEAREST = 0, FILTER_BILINEAR };
 		struct Params {
-			const Image *image;
+			const ImagePixels *image_pixels;
 			const ImageRangeGrid *image_range_grid;
 			Filter filter;
 		};
@@ -148,13 +130,18 @@ void register_image_nodes(Span<NodeType> types) {
 									   .format(varray(Image::get_class_static())));
 				return;
 			}
+			// Take a copy of pixels, so evaluation doesn't have to go through the Image, which is slow to call per
+			// pixel
+			ImagePixels *im_pixels = ZN_NEW(ImagePixels);
+			im_pixels->bake(**image);
 			ImageRangeGrid *im_range = ZN_NEW(ImageRangeGrid);
 			im_range->generate(**image);
 			Params p;
-			p.image = *image;
+			p.image_pixels = im_pixels;
 			p.image_range_grid = im_range;
 			p.filter = static_cast<Filter>(static_cast<int>(ctx.get_param(1)));
 			ctx.set_params(p);
+			ctx.add_delete_cleanup(im_pixels);
 			ctx.add_delete_cleanup(im_range);
 		};
 		t.process_buffer_func = [](Runtime::ProcessBufferContext &ctx) {
@@ -163,20 +150,20 @@ void register_image_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &y = ctx.get_input(1);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			const Image &im = *p.image;
-			// Cache image size to reduce API calls in GDExtension
+			const ImagePixels &im = *p.image_pixels;
 			const int w = im.get_width();
 			const int h = im.get_height();
-			// TODO Optimized path for most used formats, `get_pixel` is kinda slow
-			if (p.filter == FILTER_NEAREST) {
-				for (uint32_t i = 0; i < out.size; ++i) {
-					out.data[i] = get_pixel_repeat(im, x.data[i], y.data[i], w, h);
+			im.visit([&x, &y, &out, &p, w, h](const auto &pixels) {
+				if (p.filter == FILTER_NEAREST) {
+					for (uint32_t i = 0; i < out.size; ++i) {
+						out.data[i] = get_pixel_repeat(pixels, x.data[i], y.data[i], w, h);
+					}
+				} else {
+					for (uint32_t i = 0; i < out.size; ++i) {
+						out.data[i] = get_pixel_repeat_linear(pixels, x.data[i], y.data[i], w, h);
+					}
 				}
-			} else {
-				for (uint32_t i = 0; i < out.size; ++i) {
-					out.data[i] = get_pixel_repeat_linear(im, x.data[i], y.data[i], w, h);
-				}
-			}
+			});
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -197,7 +184,7 @@ void register_image_nodes(Span<NodeType> types) {
 			float max_height;
 			float norm_x;
 			float norm_y;
-			const Image *image;
+			const ImagePixels *image_pixels;
 			const ImageRangeGrid *image_range_grid;
 		};
 
@@ -223,6 +210,8 @@ void register_image_nodes(Span<NodeType> types) {
 									   .format(varray(Image::get_class_static())));
 				return;
 			}
+			ImagePixels *im_pixels = ZN_NEW(ImagePixels);
+			im_pixels->bake(**image);
 			ImageRangeGrid *im_range = ZN_NEW(ImageRangeGrid);
 			im_range->generate(**image);
 			const float factor = ctx.get_param(2);
@@ -230,13 +219,14 @@ void register_image_nodes(Span<NodeType> types) {
 			Params p;
 			p.min_height = range.min;
 			p.max_height = range.max;
-			p.image = *image;
+			p.image_pixels = im_pixels;
 			p.image_range_grid = im_range;
 			p.radius = ctx.get_param(1);
 			p.factor = factor;
 			p.norm_x = image->get_width();
 			p.norm_y = image->get_height();
 			ctx.set_params(p);
+			ctx.add_delete_cleanup(im_pixels);
 			ctx.add_delete_cleanup(im_range);
 		};
 
@@ -248,21 +238,27 @@ void register_image_nodes(Span<NodeType> types) {
 			Runtime::Buffer &out = ctx.get_output(0);
 			// TODO Allow to use bilinear filtering?
 			const Params p = ctx.get_params<Params>();
-			const Image &im = *p.image;
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = sdf_sphere_heightmap(
-						x.data[i],
-						y.data[i],
-						z.data[i],
-						p.radius,
-						p.factor,
-						im,
-						p.min_height,
-						p.max_height,
-						p.norm_x,
-						p.norm_y
-				);
-			}
+			const ImagePixels &im = *p.image_pixels;
+			const int w = im.get_width();
+			const int h = im.get_height();
+			im.visit([&x, &y, &z, &out, &p, w, h](const auto &pixels) {
+				for (uint32_t i = 0; i < out.size; ++i) {
+					out.data[i] = sdf_sphere_heightmap(
+							x.data[i],
+							y.data[i],
+							z.data[i],
+							p.radius,
+							p.factor,
+							pixels,
+							w,
+							h,
+							p.min_height,
+							p.max_height,
+							p.norm_x,
+							p.norm_y
+					);
+				}
+			});
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
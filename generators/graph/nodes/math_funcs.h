@@ -14,6 +14,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SIN];
 		t.name = "Sin";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
@@ -35,6 +36,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_FLOOR];
 		t.name = "Floor";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
@@ -56,6 +58,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_ABS];
 		t.name = "Abs";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
@@ -77,6 +80,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SQRT];
 		t.name = "Sqrt";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) { //
@@ -98,6 +102,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_FRACT];
 		t.name = "Fract";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
@@ -119,6 +124,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_STEPIFY];
 		t.name = "Stepify";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("step", 1.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -150,6 +156,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_WRAP];
 		t.name = "Wrap";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("length", 1.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -181,11 +188,13 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_MIN];
 		t.name = "Min";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return min(a, b); });
+			const simd::Kernels &k = simd::get_kernels();
+			do_binop(ctx, [](float a, float b) { return min(a, b); }, k.min, k.min_constant, k.min_constant);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -204,11 +213,13 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_MAX];
 		t.name = "Max";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.inputs.push_back(NodeType::Port("b", 0.f, VoxelGraphFunction::AUTO_CONNECT_NONE, false));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.process_buffer_func = [](ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return max(a, b); });
+			const simd::Kernels &k = simd::get_kernels();
+			do_binop(ctx, [](float a, float b) { return max(a, b); }, k.max, k.max_constant, k.max_constant);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -227,6 +238,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_CLAMP];
 		t.name = "Clamp";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.inputs.push_back(NodeType::Port("min", -1.f));
 		t.inputs.push_back(NodeType::Port("max", 1.f));
@@ -236,9 +248,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &minv = ctx.get_input(1);
 			const Runtime::Buffer &maxv = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = clamp(a.data[i], minv.data[i], maxv.data[i]);
-			}
+			simd::get_kernels().clamp(a.data, minv.data, maxv.data, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -268,6 +278,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_CLAMP_C];
 		t.name = "ClampC";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.params.push_back(NodeType::Param("min", Variant::FLOAT, -1.f));
@@ -282,9 +293,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &a = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = clamp(a.data[i], p.min, p.max);
-			}
+			simd::get_kernels().clamp_constant(a.data, p.min, p.max, out.data, out.size);
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -307,6 +316,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_MIX];
 		t.name = "Mix";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.inputs.push_back(NodeType::Port("ratio"));
@@ -359,9 +369,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 						out.data[i] = a.data[i];
 					}
 				} else {
-					for (uint32_t i = 0; i < buffer_size; ++i) {
-						out.data[i] = Math::lerp(a.data[i], b.data[i], r.data[i]);
-					}
+					simd::get_kernels().mix(a.data, b.data, r.data, out.data, buffer_size);
 				}
 			}
 		};
@@ -412,6 +420,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_REMAP];
 		t.name = "Remap";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.params.push_back(NodeType::Param("min0", Variant::FLOAT, -1.f));
@@ -453,6 +462,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SMOOTHSTEP];
 		t.name = "Smoothstep";
 		t.category = CATEGORY_CONVERT;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.outputs.push_back(NodeType::Port("out"));
 		t.params.push_back(NodeType::Param("edge0", Variant::FLOAT, 0.f));
@@ -467,8 +477,13 @@ void register_math_func_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &a = ctx.get_input(0);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = smoothstep(p.edge0, p.edge1, a.data[i]);
+			if (Math::is_equal_approx(p.edge0, p.edge1)) {
+				// Same as what `smoothstep` does in this case
+				for (uint32_t i = 0; i < out.size; ++i) {
+					out.data[i] = p.edge0;
+				}
+			} else {
+				simd::get_kernels().smoothstep(a.data, p.edge0, p.edge1, out.data, out.size);
 			}
 		};
 		t.range_analysis_func = [](RangeAnalysisContext &ctx) {
@@ -494,6 +509,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_POWI];
 		t.name = "Powi";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.params.push_back(NodeType::Param("power", Variant::INT, 2));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -557,6 +573,7 @@ void register_math_func_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_POW];
 		t.name = "Pow";
 		t.category = CATEGORY_MATH;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x"));
 		t.inputs.push_back(NodeType::Port("p", 2.f));
 		t.outputs.push_back(NodeType::Port("out"));
@@ -1,5 +1,6 @@
 #include "../../../util/profiling.h"
 #include "../node_type_db.h"
+#include "../simd/graph_kernels.h"
 
 namespace zylann::voxel::pg {
 
@@ -21,9 +22,7 @@ void register_math_vector_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &x1 = ctx.get_input(2);
 			const Runtime::Buffer &y1 = ctx.get_input(3);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = Math::sqrt(squared(x1.data[i] - x0.data[i]) + squared(y1.data[i] - y0.data[i]));
-			}
+			simd::get_kernels().distance_2d(x0.data, y0.data, x1.data, y1.data, out.data, out.size);
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval x0 = ctx.get_input(0);
@@ -59,10 +58,7 @@ void register_math_vector_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &y1 = ctx.get_input(4);
 			const Runtime::Buffer &z1 = ctx.get_input(5);
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = Math::sqrt(squared(x1.data[i] - x0.data[i]) + squared(y1.data[i] - y0.data[i]) +
-						squared(z1.data[i] - z0.data[i]));
-			}
+			simd::get_kernels().distance_3d(x0.data, y0.data, z0.data, x1.data, y1.data, z1.data, out.data, out.size);
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval x0 = ctx.get_input(0);
@@ -104,17 +100,9 @@ void register_math_vector_nodes(Span<NodeType> types) {
 			Runtime::Buffer &out_ny = ctx.get_output(1);
 			Runtime::Buffer &out_nz = ctx.get_output(2);
 			Runtime::Buffer &out_len = ctx.get_output(3);
-			const uint32_t buffer_size = out_nx.size;
-			for (uint32_t i = 0; i < buffer_size; ++i) {
-				const float x = xb.data[i];
-				const float y = yb.data[i];
-				const float z = zb.data[i];
-				const float len = Math::sqrt(squared(x) + squared(y) + squared(z));
-				out_nx.data[i] = x / len;
-				out_ny.data[i] = y / len;
-				out_nz.data[i] = z / len;
-				out_len.data[i] = len;
-			}
+			simd::get_kernels().normalize_3d(
+					xb.data, yb.data, zb.data, out_nx.data, out_ny.data, out_nz.data, out_len.data, out_nx.size
+			);
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
@@ -308,9 +308,12 @@ void register_noise_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = p.noise->get_noise_3d(x.data[i], y.data[i], z.data[i]);
-			}
+			p.noise->get_noise_3d_series(
+					Span<const float>(x.data, out.size),
+					Span<const float>(y.data, out.size),
+					Span<const float>(z.data, out.size),
+					Span<float>(out.data, out.size)
+			);
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
@@ -523,8 +526,13 @@ void register_noise_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &y = ctx.get_input(1);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			p.noise->get_noise_2d_series(Span<const float>(x.data, x.size), Span<const float>(y.data, y.size),
-					Span<float>(out.data, out.size));
+			const Span<const float> xs(x.data, x.size);
+			const Span<const float> ys(y.data, y.size);
+			const Span<float> outs(out.data, out.size);
+			// Inputs are often coordinates of the block being generated, in which case they can be generated as a grid
+			if (!p.noise->try_get_noise_2d_series_as_grid(xs, ys, outs)) {
+				p.noise->get_noise_2d_series(xs, ys, outs);
+			}
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
@@ -573,8 +581,13 @@ void register_noise_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			p.noise->get_noise_3d_series(Span<const float>(x.data, x.size), Span<const float>(y.data, y.size),
-					Span<const float>(z.data, z.size), Span<float>(out.data, out.size));
+			const Span<const float> xs(x.data, x.size);
+			const Span<const float> ys(y.data, y.size);
+			const Span<const float> zs(z.data, z.size);
+			const Span<float> outs(out.data, out.size);
+			if (!p.noise->try_get_noise_3d_series_as_grid(xs, ys, zs, outs)) {
+				p.noise->get_noise_3d_series(xs, ys, zs, outs);
+			}
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
@@ -652,10 +665,15 @@ void register_noise_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &spot_size = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params params = ctx.get_params<Params>();
-			for (unsigned int i = 0; i < out.size; ++i) {
-				out.data[i] = SpotNoise::spot_noise_2d(Vector2f(x.data[i], y.data[i]), params.cell_size,
-						spot_size.data[i], params.jitter, params.seed);
-			}
+			SpotNoise::spot_noise_2d_series(
+					Span<const float>(x.data, out.size),
+					Span<const float>(y.data, out.size),
+					Span<const float>(spot_size.data, out.size),
+					params.cell_size,
+					params.jitter,
+					params.seed,
+					Span<float>(out.data, out.size)
+			);
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
@@ -738,10 +756,16 @@ void register_noise_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &spot_size = ctx.get_input(3);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params params = ctx.get_params<Params>();
-			for (unsigned int i = 0; i < out.size; ++i) {
-				out.data[i] = SpotNoise::spot_noise_3d(Vector3f(x.data[i], y.data[i], z.data[i]), params.cell_size,
-						spot_size.data[i], params.jitter, params.seed);
-			}
+			SpotNoise::spot_noise_3d_series(
+					Span<const float>(x.data, out.size),
+					Span<const float>(y.data, out.size),
+					Span<const float>(z.data, out.size),
+					Span<const float>(spot_size.data, out.size),
+					params.cell_size,
+					params.jitter,
+					params.seed,
+					Span<float>(out.data, out.size)
+			);
 		};
 
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
@@ -12,11 +12,13 @@ void register_sdf_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_PLANE];
 		t.name = "SdfPlane";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("height"));
 		t.outputs.push_back(NodeType::Port("sdf"));
 		t.process_buffer_func = [](Runtime::ProcessBufferContext &ctx) {
-			do_binop(ctx, [](float a, float b) { return a - b; });
+			const simd::Kernels &k = simd::get_kernels();
+			do_binop(ctx, [](float a, float b) { return a - b; }, k.subtract, k.constant_subtract, k.subtract_constant);
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval a = ctx.get_input(0);
@@ -36,6 +38,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_BOX];
 		t.name = "SdfBox";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("z", 0.f, VoxelGraphFunction::AUTO_CONNECT_Z));
@@ -56,10 +59,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			const Params p = ctx.get_params<Params>();
 			Runtime::Buffer &out = ctx.get_output(0);
-			const Vector3f size(p.size_x, p.size_y, p.size_z);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = math::sdf_box(Vector3f(x.data[i], y.data[i], z.data[i]), size);
-			}
+			simd::get_kernels().sdf_box(x.data, y.data, z.data, p.size_x, p.size_y, p.size_z, out.data, out.size);
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -98,6 +98,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_SPHERE];
 		t.name = "SdfSphere";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("z", 0.f, VoxelGraphFunction::AUTO_CONNECT_Z));
@@ -114,9 +115,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			Runtime::Buffer &out = ctx.get_output(0);
 			const Params p = ctx.get_params<Params>();
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = Math::sqrt(squared(x.data[i]) + squared(y.data[i]) + squared(z.data[i])) - p.radius;
-			}
+			simd::get_kernels().sdf_sphere(x.data, y.data, z.data, p.radius, out.data, out.size);
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -145,6 +144,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_TORUS];
 		t.name = "SdfTorus";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("x", 0.f, VoxelGraphFunction::AUTO_CONNECT_X));
 		t.inputs.push_back(NodeType::Port("y", 0.f, VoxelGraphFunction::AUTO_CONNECT_Y));
 		t.inputs.push_back(NodeType::Port("z", 0.f, VoxelGraphFunction::AUTO_CONNECT_Z));
@@ -163,9 +163,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 			const Runtime::Buffer &z = ctx.get_input(2);
 			const Params p = ctx.get_params<Params>();
 			Runtime::Buffer &out = ctx.get_output(0);
-			for (uint32_t i = 0; i < out.size; ++i) {
-				out.data[i] = math::sdf_torus(x.data[i], y.data[i], z.data[i], p.r1, p.r2);
-			}
+			simd::get_kernels().sdf_torus(x.data, y.data, z.data, p.r1, p.r2, out.data, out.size);
 		};
 		t.range_analysis_func = [](Runtime::RangeAnalysisContext &ctx) {
 			const Interval x = ctx.get_input(0);
@@ -202,6 +200,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_SMOOTH_UNION];
 		t.name = "SdfSmoothUnion";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.outputs.push_back(NodeType::Port("sdf"));
@@ -306,6 +305,7 @@ void register_sdf_nodes(Span<NodeType> types) {
 		NodeType &t = types[VoxelGraphFunction::NODE_SDF_SMOOTH_SUBTRACT];
 		t.name = "SdfSmoothSubtract";
 		t.category = CATEGORY_SDF;
+		t.is_elementwise = true;
 		t.inputs.push_back(NodeType::Port("a"));
 		t.inputs.push_back(NodeType::Port("b"));
 		t.outputs.push_back(NodeType::Port("sdf"));
@@ -1,6 +1,7 @@
 #ifndef VOXEL_GRAPH_NODES_UTIL_H
 #define VOXEL_GRAPH_NODES_UTIL_H
 
+#include "../simd/graph_kernels.h"
 #include "../voxel_graph_runtime.h"
 
 namespace zylann::voxel::pg {
@@ -59,6 +60,42 @@ inline void do_binop(pg::Runtime::ProcessBufferContext &ctx, F f) {
 	}
 }
 
+// Same as `do_binop`, using vectorized kernels when at least one operand is not constant.
+// `constant_a_kernel` computes `c op b[i]` and `constant_b_kernel` computes `a[i] op c`. They are the same function for
+// commutative operations.
+template <typename F>
+inline void do_binop(
+		pg::Runtime::ProcessBufferContext &ctx,
+		F f,
+		simd::Kernels::BinopFunc kernel,
+		simd::Kernels::BinopConstantFunc constant_a_kernel,
+		simd::Kernels::BinopConstantFunc constant_b_kernel
+) {
+	const Runtime::Buffer &a = ctx.get_input(0);
+	const Runtime::Buffer &b = ctx.get_input(1);
+	Runtime::Buffer &out = ctx.get_output(0);
+	const uint32_t buffer_size = out.size;
+
+	if (a.is_constant || b.is_constant) {
+		if (!b.is_constant) {
+			constant_a_kernel(b.data, a.constant_value, out.data, buffer_size);
+
+		} else if (!a.is_constant) {
+			constant_b_kernel(a.data, b.constant_value, out.data, buffer_size);
+
+		} else {
+			// Normally this case should have been optimized out at compile-time
+			const float c = f(a.constant_value, b.constant_value);
+			for (uint32_t i = 0; i < buffer_size; ++i) {
+				out.data[i] = c;
+			}
+		}
+
+	} else {
+		kernel(a.data, b.data, out.data, buffer_size);
+	}
+}
+
 } // namespace zylann::voxel::pg
 
 #endif // VOXEL_GRAPH_NODES_UTIL_H
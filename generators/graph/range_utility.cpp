@@ -1,8 +1,10 @@
 #include "range_utility.h"
+#include "baked_resources.h"
 #include "../../util/godot/classes/curve.h"
 #include "../../util/godot/classes/image.h"
 #include "../../util/math/vector2i.h"
 #include "../../util/string/format.h"
+#include <algorithm>
 
 namespace zylann {
 
@@ -62,46 +64,126 @@ void get_curve_monotonic_sections(Curve &curve, StdVector<CurveMonotonicSection>
 	sections.push_back(section);
 }
 
-Interval get_curve_range(Curve &curve, const StdVector<CurveMonotonicSection> &sections, Interval x) {
-	// This implementation is linear. It assumes curves usually don't have many points.
-	// If a curve has too many points, we may consider dynamically choosing a different algorithm.
-	Interval y;
-	unsigned int i = 0;
-	if (x.min < sections[0].x_min) {
-		// X range starts before the curve's minimum X
-		y = Interval::from_single_value(curve.sample_baked(0.f));
-	} else {
-		// Find section from where the range starts
-		for (; i < sections.size(); ++i) {
-			const CurveMonotonicSection &section = sections[i];
-			if (x.min >= section.x_min) {
-				const float begin_y = curve.sample_baked(x.min);
-				if (x.max < section.x_max) {
-					// X range starts and ends in that section
-					return Interval::from_unordered_values(begin_y, curve.sample_baked(x.max))
-							.padded(CURVE_RANGE_MARGIN);
-				} else {
-					// X range starts in that section, and continues after it.
-					// Will need to keep iterating, starting from here
-					y = Interval::from_unordered_values(begin_y, curve.sample_baked(section.x_max));
-					++i;
-					break;
-				}
+namespace {
+
+// Gets the index of the section containing X. X values outside of the curve are in the first or last section.
+unsigned int find_curve_section(const StdVector<CurveMonotonicSection> &sections, float x) {
+	// Sections are sorted and contiguous
+	auto it = std::upper_bound(
+			sections.begin(),
+			sections.end(),
+			x,
+			[](float v, const CurveMonotonicSection &section) { //
+				return v < section.x_max;
 			}
+	);
+	if (it == sections.end()) {
+		return sections.size() - 1;
+	}
+	return it - sections.begin();
+}
+
+// `sample(x)` must return the value of the curve at X.
+// `get_sections_range(begin, end)` must return the range of Y values covered by sections from `begin` included to `end`
+// excluded.
+template <typename Sample_F, typename SectionsRange_F>
+Interval get_curve_range(
+		Sample_F sample,
+		const StdVector<CurveMonotonicSection> &sections,
+		Interval x,
+		SectionsRange_F get_sections_range
+) {
+	ZN_ASSERT_RETURN_V(sections.size() > 0, Interval());
+
+	const unsigned int begin_index = find_curve_section(sections, x.min);
+	const unsigned int end_index = find_curve_section(sections, x.max);
+
+	const float begin_y = sample(x.min);
+	const float end_y = sample(x.max);
+
+	if (begin_index == end_index) {
+		// X range starts and ends in the same section
+		return Interval::from_unordered_values(begin_y, end_y).padded(CURVE_RANGE_MARGIN);
+	}
+
+	// X range starts in a section and continues after it
+	Interval y = Interval::from_unordered_values(begin_y, sections[begin_index].y_max);
+	// X range ends in another section
+	y.add_interval(Interval::from_unordered_values(sections[end_index].y_min, end_y));
+	// Sections in between are fully covered
+	if (begin_index + 1 < end_index) {
+		y.add_interval(get_sections_range(begin_index + 1, end_index));
+	}
+	return y.padded(CURVE_RANGE_MARGIN);
+}
+
+inline Interval get_section_range(const CurveMonotonicSection &section) {
+	return Interval::from_unordered_values(section.y_min, section.y_max);
+}
+
+} // namespace
+
+Interval get_curve_range(Curve &curve, const StdVector<CurveMonotonicSection> &sections, Interval x) {
+	const auto sample = [&curve](float v) { return curve.sample_baked(v); };
+	return get_curve_range(sample, sections, x, [&sections](unsigned int begin, unsigned int end) {
+		Interval y = get_section_range(sections[begin]);
+		for (unsigned int i = begin + 1; i < end; ++i) {
+			y.add_interval(get_section_range(sections[i]));
 		}
+		return y;
+	});
+}
+
+void get_curve_range_data(Curve &curve, CurveRangeData &data) {
+	get_curve_monotonic_sections(curve, data.sections);
+
+	const unsigned int count = data.sections.size();
+	data.section_ranges.clear();
+
+	StdVector<Interval> &level0 = data.section_ranges.emplace_back();
+	level0.resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		level0[i] = get_section_range(data.sections[i]);
 	}
-	for (; i < sections.size(); ++i) {
-		const CurveMonotonicSection &section = sections[i];
-		if (x.max >= section.x_max) {
-			// X range covers this whole section and maybe more after it
-			y.add_interval(Interval::from_unordered_values(section.y_min, section.y_max));
-		} else {
-			// X range ends in that section
-			y.add_interval(Interval::from_unordered_values(section.y_min, curve.sample_baked(x.max)));
-			break;
+
+	for (unsigned int span = 2; span <= count; span *= 2) {
+		StdVector<Interval> &level = data.section_ranges.emplace_back();
+		const StdVector<Interval> &prev_level = data.section_ranges[data.section_ranges.size() - 2];
+		const unsigned int half_span = span / 2;
+		level.resize(count - span + 1);
+		for (unsigned int i = 0; i < level.size(); ++i) {
+			level[i] = prev_level[i];
+			level[i].add_interval(prev_level[i + half_span]);
 		}
 	}
-	return y.padded(CURVE_RANGE_MARGIN);
+}
+
+namespace {
+
+template <typename Sample_F>
+Interval get_curve_range(Sample_F sample, const CurveRangeData &data, Interval x) {
+	return get_curve_range(sample, data.sections, x, [&data](unsigned int begin, unsigned int end) {
+		// Combine the two largest spans of sections fitting in the range. They may overlap.
+		const unsigned int count = end - begin;
+		unsigned int level_index = 0;
+		while ((2u << level_index) <= count) {
+			++level_index;
+		}
+		const StdVector<Interval> &level = data.section_ranges[level_index];
+		Interval y = level[begin];
+		y.add_interval(level[end - (1u << level_index)]);
+		return y;
+	});
+}
+
+} // namespace
+
+Interval get_curve_range(Curve &curve, const CurveRangeData &data, Interval x) {
+	return get_curve_range([&curve](float v) { return curve.sample_baked(v); }, data, x);
+}
+
+Interval get_curve_range(const CurveLUT &lut, const CurveRangeData &data, Interval x) {
+	return get_curve_range([&lut](float v) { return lut.sample(v); }, data, x);
 }
 
 Interval get_curve_range(Curve &curve, bool &is_monotonic_increasing) {
@@ -11,6 +11,8 @@ ZN_GODOT_FORWARD_DECLARE(class Image)
 
 namespace zylann {
 
+class CurveLUT;
+
 // Curve ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct CurveMonotonicSection {
@@ -24,6 +26,9 @@ struct CurveMonotonicSection {
 
 struct CurveRangeData {
 	StdVector<CurveMonotonicSection> sections;
+	// Sparse table of Y ranges covered by consecutive sections. Level N contains ranges of 2^N sections starting at
+	// each index, so the range of any sequence of sections can be obtained by combining two of them.
+	StdVector<StdVector<math::Interval>> section_ranges;
 };
 
 static const float CURVE_RANGE_MARGIN = CMP_EPSILON;
@@ -38,6 +43,13 @@ void get_curve_monotonic_sections(Curve &curve, StdVector<CurveMonotonicSection>
 // Gets the range of Y values for a range of X values on a curve, using precalculated monotonic segments
 math::Interval get_curve_range(Curve &curve, const StdVector<CurveMonotonicSection> &sections, math::Interval x);
 
+// Gathers monotonic sections of a curve, and precomputes ranges of consecutive sections
+void get_curve_range_data(Curve &curve, CurveRangeData &data);
+// Same as the function taking sections, but doesn't depend on the number of sections covered by the X range
+math::Interval get_curve_range(Curve &curve, const CurveRangeData &data, math::Interval x);
+// Same as above, sampling a copy of the curve that can be used from any thread
+math::Interval get_curve_range(const CurveLUT &lut, const CurveRangeData &data, math::Interval x);
+
 // Legacy
 math::Interval get_curve_range(Curve &curve, bool &is_monotonic_increasing);
 
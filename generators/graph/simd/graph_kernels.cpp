@@ -0,0 +1,196 @@
+#include "graph_kernels.h"
+#include "../../../util/containers/fixed_array.h"
+#include "../../../util/errors.h"
+#include "../../../util/io/log.h"
+#include "../../../util/string/format.h"
+#include "graph_kernels_impl.h"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VOXEL_GRAPH_SIMD_X86
+#endif
+
+// SSE2 is always available on x86_64, so it doesn't need a separate file
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VOXEL_GRAPH_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(VOXEL_GRAPH_SIMD_AVX2) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace zylann::voxel::pg::simd {
+
+#ifdef VOXEL_GRAPH_SIMD_AVX2
+// Defined in a separate file compiled with AVX2 enabled
+Kernels get_avx2_kernels();
+#endif
+
+namespace {
+
+#ifdef VOXEL_GRAPH_SIMD_SSE2
+
+struct SSE2Ops {
+	typedef __m128 V;
+	static const unsigned int WIDTH = 4;
+
+	static inline V load(const float *p) {
+		return _mm_loadu_ps(p);
+	}
+	static inline void store(float *p, V v) {
+		_mm_storeu_ps(p, v);
+	}
+	static inline V set1(float v) {
+		return _mm_set1_ps(v);
+	}
+	static inline V add(V a, V b) {
+		return _mm_add_ps(a, b);
+	}
+	static inline V sub(V a, V b) {
+		return _mm_sub_ps(a, b);
+	}
+	static inline V mul(V a, V b) {
+		return _mm_mul_ps(a, b);
+	}
+	static inline V div(V a, V b) {
+		return _mm_div_ps(a, b);
+	}
+	static inline V min(V a, V b) {
+		return _mm_min_ps(a, b);
+	}
+	static inline V max(V a, V b) {
+		return _mm_max_ps(a, b);
+	}
+	static inline V sqrt(V a) {
+		return _mm_sqrt_ps(a);
+	}
+	static inline V abs(V a) {
+		return _mm_andnot_ps(_mm_set1_ps(-0.f), a);
+	}
+};
+
+#endif
+
+bool detect_avx2() {
+#if defined(VOXEL_GRAPH_SIMD_AVX2) && defined(VOXEL_GRAPH_SIMD_X86)
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	const bool has_osxsave = (info[2] & (1 << 27)) != 0;
+	const bool has_avx = (info[2] & (1 << 28)) != 0;
+	if (!has_osxsave || !has_avx) {
+		return false;
+	}
+	// The OS must also save YMM registers when switching threads
+	if ((_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	// Also checks support from the OS
+	return __builtin_cpu_supports("avx2");
+#endif
+#else
+	return false;
+#endif
+}
+
+struct KernelTables {
+	FixedArray<Kernels, SIMD_LEVEL_COUNT> kernels;
+	FixedArray<bool, SIMD_LEVEL_COUNT> supported;
+	SIMDLevel best_level = SIMD_SCALAR;
+
+	KernelTables() {
+		fill(supported, false);
+
+		kernels[SIMD_SCALAR] = KernelSet<ScalarOps>::get();
+		supported[SIMD_SCALAR] = true;
+
+#ifdef VOXEL_GRAPH_SIMD_SSE2
+		kernels[SIMD_SSE2] = KernelSet<SSE2Ops>::get();
+		supported[SIMD_SSE2] = true;
+		best_level = SIMD_SSE2;
+#endif
+
+#ifdef VOXEL_GRAPH_SIMD_AVX2
+		if (detect_avx2()) {
+			kernels[SIMD_AVX2] = get_avx2_kernels();
+			supported[SIMD_AVX2] = true;
+			best_level = SIMD_AVX2;
+		}
+#endif
+
+		ZN_PRINT_VERBOSE(format("Voxel graph SIMD level: {}", get_simd_level_name(best_level)));
+	}
+};
+
+const KernelTables &get_tables() {
+	static KernelTables s_tables;
+	return s_tables;
+}
+
+// Kernels returned to nodes. Initialized on first use, can be changed for benchmarking.
+std::atomic<const Kernels *> g_active_kernels = { nullptr };
+
+} // namespace
+
+SIMDLevel get_simd_level() {
+	return get_tables().best_level;
+}
+
+bool is_simd_level_supported(SIMDLevel level) {
+	ZN_ASSERT_RETURN_V(level >= 0 && level < SIMD_LEVEL_COUNT, false);
+	return get_tables().supported[level];
+}
+
+const char *get_simd_level_name(SIMDLevel level) {
+	switch (level) {
+		case SIMD_SCALAR:
+			return "Scalar";
+		case SIMD_SSE2:
+			return "SSE2";
+		case SIMD_AVX2:
+			return "AVX2";
+		default:
+			ZN_PRINT_ERROR("Unknown SIMD level");
+			return "<error>";
+	}
+}
+
+const Kernels &get_kernels() {
+	// Cached separately to skip a few indirections, this is called by nodes every time they process a buffer
+	const Kernels *kernels = g_active_kernels.load(std::memory_order_acquire);
+	if (kernels == nullptr) {
+		const Kernels *best_kernels = &get_kernels(get_simd_level());
+		// Don't overwrite a level that was set in the meantime
+		if (g_active_kernels.compare_exchange_strong(kernels, best_kernels, std::memory_order_acq_rel)) {
+			kernels = best_kernels;
+		}
+	}
+	return *kernels;
+}
+
+void set_active_simd_level(SIMDLevel level) {
+	ZN_ASSERT_RETURN(is_simd_level_supported(level));
+	g_active_kernels.store(&get_kernels(level), std::memory_order_release);
+}
+
+SIMDLevel get_active_simd_level() {
+	return static_cast<SIMDLevel>(&get_kernels() - get_tables().kernels.data());
+}
+
+const Kernels &get_kernels(SIMDLevel level) {
+	const KernelTables &tables = get_tables();
+	ZN_ASSERT(level >= 0 && level < SIMD_LEVEL_COUNT);
+	ZN_ASSERT(tables.supported[level]);
+	return tables.kernels[level];
+}
+
+} // namespace zylann::voxel::pg::simd
@@ -0,0 +1,130 @@
+#ifndef VOXEL_GRAPH_KERNELS_H
+#define VOXEL_GRAPH_KERNELS_H
+
+namespace zylann::voxel::pg::simd {
+
+enum SIMDLevel {
+	SIMD_SCALAR = 0,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_LEVEL_COUNT
+};
+
+// Vectorized implementations of the most used graph nodes and of built-in modifiers, processing `count` values from
+// buffers.
+// Every instruction set is compiled separately, and the best one supported by the CPU is picked at runtime.
+// Results are the same regardless of which instruction set is used (for example, FMA is not used), so generators
+// remain deterministic across machines.
+struct Kernels {
+	// out[i] = a[i] op b[i]
+	typedef void (*BinopFunc)(const float *a, const float *b, float *out, unsigned int count);
+	// out[i] = v[i] op c, or out[i] = c op v[i] for `constant_*` variants of non-commutative operations
+	typedef void (*BinopConstantFunc)(const float *v, float c, float *out, unsigned int count);
+
+	BinopFunc add;
+	BinopConstantFunc add_constant;
+	BinopFunc subtract;
+	BinopConstantFunc subtract_constant;
+	BinopConstantFunc constant_subtract;
+	BinopFunc multiply;
+	BinopConstantFunc multiply_constant;
+	BinopFunc min;
+	BinopConstantFunc min_constant;
+	BinopFunc max;
+	BinopConstantFunc max_constant;
+
+	void (*clamp)(const float *x, const float *min_value, const float *max_value, float *out, unsigned int count);
+	void (*clamp_constant)(const float *x, float min_value, float max_value, float *out, unsigned int count);
+	void (*mix)(const float *a, const float *b, const float *ratio, float *out, unsigned int count);
+	// Edges must not be approximately equal, this case has to be handled by the caller
+	void (*smoothstep)(const float *x, float edge0, float edge1, float *out, unsigned int count);
+
+	void (*sdf_sphere)(const float *x, const float *y, const float *z, float radius, float *out, unsigned int count);
+	void (*sdf_box)(
+			const float *x,
+			const float *y,
+			const float *z,
+			float size_x,
+			float size_y,
+			float size_z,
+			float *out,
+			unsigned int count
+	);
+	void (*sdf_torus)(
+			const float *x,
+			const float *y,
+			const float *z,
+			float radius1,
+			float radius2,
+			float *out,
+			unsigned int count
+	);
+
+	void (*distance_2d)(
+			const float *x0,
+			const float *y0,
+			const float *x1,
+			const float *y1,
+			float *out,
+			unsigned int count
+	);
+	void (*distance_3d)(
+			const float *x0,
+			const float *y0,
+			const float *z0,
+			const float *x1,
+			const float *y1,
+			const float *z1,
+			float *out,
+			unsigned int count
+	);
+	void (*normalize_3d)(
+			const float *x,
+			const float *y,
+			const float *z,
+			float *out_x,
+			float *out_y,
+			float *out_z,
+			float *out_length,
+			unsigned int count
+	);
+
+	// Same as `math::sdf_smooth_union(a, b, smoothness)` and `math::sdf_smooth_subtract(b, a, smoothness)`
+	void (*sdf_smooth_union)(const float *a, const float *b, float smoothness, float *out, unsigned int count);
+	void (*sdf_smooth_subtract)(const float *b, const float *a, float smoothness, float *out, unsigned int count);
+
+	// Combines a sphere with existing signed distances in place, in a single pass
+	typedef void (*SdfSphereOperationFunc)(
+			const float *x,
+			const float *y,
+			const float *z,
+			float center_x,
+			float center_y,
+			float center_z,
+			float radius,
+			float smoothness,
+			float *inout_sdf,
+			unsigned int count
+	);
+	SdfSphereOperationFunc sdf_sphere_smooth_union;
+	SdfSphereOperationFunc sdf_sphere_smooth_subtract;
+};
+
+// Best level supported both by the build and the current CPU. Detected once.
+SIMDLevel get_simd_level();
+bool is_simd_level_supported(SIMDLevel level);
+const char *get_simd_level_name(SIMDLevel level);
+
+// Gets kernels of the best level supported by the current CPU.
+const Kernels &get_kernels();
+// Gets kernels of a specific level, which must be supported. Mainly useful for testing.
+const Kernels &get_kernels(SIMDLevel level);
+
+// Changes the level of kernels returned by `get_kernels()`, which must be supported. Graphs running meanwhile may use
+// either level for a while. Mainly useful for benchmarking.
+void set_active_simd_level(SIMDLevel level);
+SIMDLevel get_active_simd_level();
+
+} // namespace zylann::voxel::pg::simd
+
+#endif // VOXEL_GRAPH_KERNELS_H
@@ -0,0 +1,56 @@
+// This file is compiled with AVX2 enabled. Its code must only run after checking the CPU supports it, so it should
+// not contain anything that could be shared with other files (see `graph_kernels_impl.h`).
+
+#include "graph_kernels_impl.h"
+#include <immintrin.h>
+
+namespace zylann::voxel::pg::simd {
+
+namespace {
+
+struct AVX2Ops {
+	typedef __m256 V;
+	static const unsigned int WIDTH = 8;
+
+	static inline V load(const float *p) {
+		return _mm256_loadu_ps(p);
+	}
+	static inline void store(float *p, V v) {
+		_mm256_storeu_ps(p, v);
+	}
+	static inline V set1(float v) {
+		return _mm256_set1_ps(v);
+	}
+	static inline V add(V a, V b) {
+		return _mm256_add_ps(a, b);
+	}
+	static inline V sub(V a, V b) {
+		return _mm256_sub_ps(a, b);
+	}
+	static inline V mul(V a, V b) {
+		return _mm256_mul_ps(a, b);
+	}
+	static inline V div(V a, V b) {
+		return _mm256_div_ps(a, b);
+	}
+	static inline V min(V a, V b) {
+		return _mm256_min_ps(a, b);
+	}
+	static inline V max(V a, V b) {
+		return _mm256_max_ps(a, b);
+	}
+	static inline V sqrt(V a) {
+		return _mm256_sqrt_ps(a);
+	}
+	static inline V abs(V a) {
+		return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a);
+	}
+};
+
+} // namespace
+
+Kernels get_avx2_kernels() {
+	return KernelSet<AVX2Ops>::get();
+}
+
+} // namespace zylann::voxel::pg::simd
@@ -0,0 +1,506 @@
+#ifndef VOXEL_GRAPH_KERNELS_IMPL_H
+#define VOXEL_GRAPH_KERNELS_IMPL_H
+
+#include "graph_kernels.h"
+#include <cmath>
+
+// Kernels are written once against a small set of operations on vectors of floats, and instantiated for every
+// instruction set in a separate file compiled with the corresponding flags.
+// This header must only be included by those files. Everything is in an anonymous namespace on purpose: code
+// compiled with different instruction sets must not be merged by the linker, otherwise a CPU could end up running
+// instructions it doesn't support.
+
+namespace zylann::voxel::pg::simd {
+namespace {
+
+// Fallback operating on one value at a time, also used to process the remainder of buffers.
+// Operations must give the same results as those of wider vectors.
+struct ScalarOps {
+	typedef float V;
+	static const unsigned int WIDTH = 1;
+
+	static inline V load(const float *p) {
+		return *p;
+	}
+	static inline void store(float *p, V v) {
+		*p = v;
+	}
+	static inline V set1(float v) {
+		return v;
+	}
+	static inline V add(V a, V b) {
+		return a + b;
+	}
+	static inline V sub(V a, V b) {
+		return a - b;
+	}
+	static inline V mul(V a, V b) {
+		return a * b;
+	}
+	static inline V div(V a, V b) {
+		return a / b;
+	}
+	// Same as `math::min` and `math::max`, which is also how SSE and AVX instructions behave
+	static inline V min(V a, V b) {
+		return a < b ? a : b;
+	}
+	static inline V max(V a, V b) {
+		return a > b ? a : b;
+	}
+	static inline V sqrt(V a) {
+		return std::sqrt(a);
+	}
+	static inline V abs(V a) {
+		return std::abs(a);
+	}
+};
+
+// Runs `f` over inputs and writes the result to `out`, using vectors as long as there are enough values left.
+template <typename S, typename F, typename... Inputs>
+inline void transform(float *out, unsigned int count, F f, const Inputs *...inputs) {
+	unsigned int i = 0;
+	for (; i + S::WIDTH <= count; i += S::WIDTH) {
+		S::store(out + i, f(S(), S::load(inputs + i)...));
+	}
+	for (; i < count; ++i) {
+		out[i] = f(ScalarOps(), inputs[i]...);
+	}
+}
+
+// Same as `math::sdf_smooth_union`
+template <typename O>
+inline typename O::V sdf_smooth_union_v(typename O::V a, typename O::V b, typename O::V s) {
+	const typename O::V one = O::set1(1.f);
+	const typename O::V half = O::set1(0.5f);
+	typename O::V h = O::div(O::mul(half, O::sub(b, a)), s);
+	h = O::min(O::max(O::add(half, h), O::set1(0.f)), one);
+	// lerp(b, a, h) - s * h * (1 - h)
+	return O::sub(O::add(b, O::mul(O::sub(a, b), h)), O::mul(O::mul(s, h), O::sub(one, h)));
+}
+
+// Same as `math::sdf_smooth_subtract`, subtracts `a` from `b`
+template <typename O>
+inline typename O::V sdf_smooth_subtract_v(typename O::V b, typename O::V a, typename O::V s) {
+	const typename O::V zero = O::set1(0.f);
+	const typename O::V one = O::set1(1.f);
+	const typename O::V half = O::set1(0.5f);
+	typename O::V h = O::div(O::mul(half, O::add(b, a)), s);
+	h = O::min(O::max(O::sub(half, h), zero), one);
+	// lerp(b, -a, h) + s * h * (1 - h)
+	return O::add(O::add(b, O::mul(O::sub(O::sub(zero, a), b), h)), O::mul(O::mul(s, h), O::sub(one, h)));
+}
+
+// Same as `math::sdf_sphere`
+template <typename O>
+inline typename O::V sdf_sphere_v(
+		typename O::V x,
+		typename O::V y,
+		typename O::V z,
+		float center_x,
+		float center_y,
+		float center_z,
+		float radius
+) {
+	const typename O::V dx = O::sub(x, O::set1(center_x));
+	const typename O::V dy = O::sub(y, O::set1(center_y));
+	const typename O::V dz = O::sub(z, O::set1(center_z));
+	const typename O::V len_sq = O::add(O::add(O::mul(dx, dx), O::mul(dy, dy)), O::mul(dz, dz));
+	return O::sub(O::sqrt(len_sq), O::set1(radius));
+}
+
+template <typename S>
+struct KernelSet {
+	static void add(const float *a, const float *b, float *out, unsigned int count) {
+		transform<S>(out, count, [](auto o, auto va, auto vb) { return decltype(o)::add(va, vb); }, a, b);
+	}
+
+	static void add_constant(const float *v, float c, float *out, unsigned int count) {
+		transform<S>(out, count, [c](auto o, auto vv) { return decltype(o)::add(vv, decltype(o)::set1(c)); }, v);
+	}
+
+	static void subtract(const float *a, const float *b, float *out, unsigned int count) {
+		transform<S>(out, count, [](auto o, auto va, auto vb) { return decltype(o)::sub(va, vb); }, a, b);
+	}
+
+	static void subtract_constant(const float *v, float c, float *out, unsigned int count) {
+		transform<S>(out, count, [c](auto o, auto vv) { return decltype(o)::sub(vv, decltype(o)::set1(c)); }, v);
+	}
+
+	static void constant_subtract(const float *v, float c, float *out, unsigned int count) {
+		transform<S>(out, count, [c](auto o, auto vv) { return decltype(o)::sub(decltype(o)::set1(c), vv); }, v);
+	}
+
+	static void multiply(const float *a, const float *b, float *out, unsigned int count) {
+		transform<S>(out, count, [](auto o, auto va, auto vb) { return decltype(o)::mul(va, vb); }, a, b);
+	}
+
+	static void multiply_constant(const float *v, float c, float *out, unsigned int count) {
+		transform<S>(out, count, [c](auto o, auto vv) { return decltype(o)::mul(vv, decltype(o)::set1(c)); }, v);
+	}
+
+	static void min(const float *a, const float *b, float *out, unsigned int count) {
+		transform<S>(out, count, [](auto o, auto va, auto vb) { return decltype(o)::min(va, vb); }, a, b);
+	}
+
+	static void min_constant(const float *v, float c, float *out, unsigned int count) {
+		transform<S>(out, count, [c](auto o, auto vv) { return decltype(o)::min(vv, decltype(o)::set1(c)); }, v);
+	}
+
+	static void max(const float *a, const float *b, float *out, unsigned int count) {
+		transform<S>(out, count, [](auto o, auto va, auto vb) { return decltype(o)::max(va, vb); }, a, b);
+	}
+
+	static void max_constant(const float *v, float c, float *out, unsigned int count) {
+		transform<S>(out, count, [c](auto o, auto vv) { return decltype(o)::max(vv, decltype(o)::set1(c)); }, v);
+	}
+
+	static void clamp(const float *x, const float *min_value, const float *max_value, float *out, unsigned int count) {
+		transform<S>(
+				out,
+				count,
+				[](auto o, auto vx, auto vmin, auto vmax) {
+					typedef decltype(o) O;
+					return O::min(O::max(vx, vmin), vmax);
+				},
+				x,
+				min_value,
+				max_value
+		);
+	}
+
+	static void clamp_constant(const float *x, float min_value, float max_value, float *out, unsigned int count) {
+		transform<S>(
+				out,
+				count,
+				[min_value, max_value](auto o, auto vx) {
+					typedef decltype(o) O;
+					return O::min(O::max(vx, O::set1(min_value)), O::set1(max_value));
+				},
+				x
+		);
+	}
+
+	static void mix(const float *a, const float *b, const float *ratio, float *out, unsigned int count) {
+		// Same as `Math::lerp`
+		transform<S>(
+				out,
+				count,
+				[](auto o, auto va, auto vb, auto vr) {
+					typedef decltype(o) O;
+					return O::add(va, O::mul(O::sub(vb, va), vr));
+				},
+				a,
+				b,
+				ratio
+		);
+	}
+
+	static void smoothstep(const float *x, float edge0, float edge1, float *out, unsigned int count) {
+		// Same as `math::smoothstep`
+		transform<S>(
+				out,
+				count,
+				[edge0, edge1](auto o, auto vx) {
+					typedef decltype(o) O;
+					const auto e0 = O::set1(edge0);
+					auto t = O::div(O::sub(vx, e0), O::sub(O::set1(edge1), e0));
+					t = O::min(O::max(t, O::set1(0.f)), O::set1(1.f));
+					return O::mul(O::mul(t, t), O::sub(O::set1(3.f), O::mul(O::set1(2.f), t)));
+				},
+				x
+		);
+	}
+
+	static void sdf_sphere(
+			const float *x,
+			const float *y,
+			const float *z,
+			float radius,
+			float *out,
+			unsigned int count
+	) {
+		transform<S>(
+				out,
+				count,
+				[radius](auto o, auto vx, auto vy, auto vz) {
+					typedef decltype(o) O;
+					const auto len_sq = O::add(O::add(O::mul(vx, vx), O::mul(vy, vy)), O::mul(vz, vz));
+					return O::sub(O::sqrt(len_sq), O::set1(radius));
+				},
+				x,
+				y,
+				z
+		);
+	}
+
+	static void sdf_box(
+			const float *x,
+			const float *y,
+			const float *z,
+			float size_x,
+			float size_y,
+			float size_z,
+			float *out,
+			unsigned int count
+	) {
+		// Same as `math::sdf_box`
+		transform<S>(
+				out,
+				count,
+				[size_x, size_y, size_z](auto o, auto vx, auto vy, auto vz) {
+					typedef decltype(o) O;
+					const auto zero = O::set1(0.f);
+					const auto dx = O::sub(O::abs(vx), O::set1(size_x));
+					const auto dy = O::sub(O::abs(vy), O::set1(size_y));
+					const auto dz = O::sub(O::abs(vz), O::set1(size_z));
+					const auto inside = O::min(O::max(dx, O::max(dy, dz)), zero);
+					const auto mx = O::max(dx, zero);
+					const auto my = O::max(dy, zero);
+					const auto mz = O::max(dz, zero);
+					const auto len_sq = O::add(O::add(O::mul(mx, mx), O::mul(my, my)), O::mul(mz, mz));
+					return O::add(inside, O::sqrt(len_sq));
+				},
+				x,
+				y,
+				z
+		);
+	}
+
+	static void sdf_torus(
+			const float *x,
+			const float *y,
+			const float *z,
+			float radius1,
+			float radius2,
+			float *out,
+			unsigned int count
+	) {
+		// Same as `math::sdf_torus`
+		transform<S>(
+				out,
+				count,
+				[radius1, radius2](auto o, auto vx, auto vy, auto vz) {
+					typedef decltype(o) O;
+					const auto qx = O::sub(O::sqrt(O::add(O::mul(vx, vx), O::mul(vz, vz))), O::set1(radius1));
+					return O::sub(O::sqrt(O::add(O::mul(qx, qx), O::mul(vy, vy))), O::set1(radius2));
+				},
+				x,
+				y,
+				z
+		);
+	}
+
+	static void distance_2d(
+			const float *x0,
+			const float *y0,
+			const float *x1,
+			const float *y1,
+			float *out,
+			unsigned int count
+	) {
+		transform<S>(
+				out,
+				count,
+				[](auto o, auto vx0, auto vy0, auto vx1, auto vy1) {
+					typedef decltype(o) O;
+					const auto dx = O::sub(vx1, vx0);
+					const auto dy = O::sub(vy1, vy0);
+					return O::sqrt(O::add(O::mul(dx, dx), O::mul(dy, dy)));
+				},
+				x0,
+				y0,
+				x1,
+				y1
+		);
+	}
+
+	static void distance_3d(
+			const float *x0,
+			const float *y0,
+			const float *z0,
+			const float *x1,
+			const float *y1,
+			const float *z1,
+			float *out,
+			unsigned int count
+	) {
+		transform<S>(
+				out,
+				count,
+				[](auto o, auto vx0, auto vy0, auto vz0, auto vx1, auto vy1, auto vz1) {
+					typedef decltype(o) O;
+					const auto dx = O::sub(vx1, vx0);
+					const auto dy = O::sub(vy1, vy0);
+					const auto dz = O::sub(vz1, vz0);
+					return O::sqrt(O::add(O::add(O::mul(dx, dx), O::mul(dy, dy)), O::mul(dz, dz)));
+				},
+				x0,
+				y0,
+				z0,
+				x1,
+				y1,
+				z1
+		);
+	}
+
+	template <typename O>
+	static inline void normalize_3d_at(
+			const float *x,
+			const float *y,
+			const float *z,
+			float *out_x,
+			float *out_y,
+			float *out_z,
+			float *out_length,
+			unsigned int i
+	) {
+		const typename O::V vx = O::load(x + i);
+		const typename O::V vy = O::load(y + i);
+		const typename O::V vz = O::load(z + i);
+		const typename O::V len = O::sqrt(O::add(O::add(O::mul(vx, vx), O::mul(vy, vy)), O::mul(vz, vz)));
+		O::store(out_x + i, O::div(vx, len));
+		O::store(out_y + i, O::div(vy, len));
+		O::store(out_z + i, O::div(vz, len));
+		O::store(out_length + i, len);
+	}
+
+	static void normalize_3d(
+			const float *x,
+			const float *y,
+			const float *z,
+			float *out_x,
+			float *out_y,
+			float *out_z,
+			float *out_length,
+			unsigned int count
+	) {
+		unsigned int i = 0;
+		for (; i + S::WIDTH <= count; i += S::WIDTH) {
+			normalize_3d_at<S>(x, y, z, out_x, out_y, out_z, out_length, i);
+		}
+		for (; i < count; ++i) {
+			normalize_3d_at<ScalarOps>(x, y, z, out_x, out_y, out_z, out_length, i);
+		}
+	}
+
+	static void sdf_smooth_union(const float *a, const float *b, float smoothness, float *out, unsigned int count) {
+		transform<S>(
+				out,
+				count,
+				[smoothness](auto o, auto va, auto vb) {
+					typedef decltype(o) O;
+					return sdf_smooth_union_v<O>(va, vb, O::set1(smoothness));
+				},
+				a,
+				b
+		);
+	}
+
+	static void sdf_smooth_subtract(
+			const float *b,
+			const float *a,
+			float smoothness,
+			float *out,
+			unsigned int count
+	) {
+		transform<S>(
+				out,
+				count,
+				[smoothness](auto o, auto vb, auto va) {
+					typedef decltype(o) O;
+					return sdf_smooth_subtract_v<O>(vb, va, O::set1(smoothness));
+				},
+				b,
+				a
+		);
+	}
+
+	static void sdf_sphere_smooth_union(
+			const float *x,
+			const float *y,
+			const float *z,
+			float center_x,
+			float center_y,
+			float center_z,
+			float radius,
+			float smoothness,
+			float *inout_sdf,
+			unsigned int count
+	) {
+		transform<S>(
+				inout_sdf,
+				count,
+				[center_x, center_y, center_z, radius, smoothness](auto o, auto vsdf, auto vx, auto vy, auto vz) {
+					typedef decltype(o) O;
+					const auto sd = sdf_sphere_v<O>(vx, vy, vz, center_x, center_y, center_z, radius);
+					return sdf_smooth_union_v<O>(vsdf, sd, O::set1(smoothness));
+				},
+				inout_sdf,
+				x,
+				y,
+				z
+		);
+	}
+
+	static void sdf_sphere_smooth_subtract(
+			const float *x,
+			const float *y,
+			const float *z,
+			float center_x,
+			float center_y,
+			float center_z,
+			float radius,
+			float smoothness,
+			float *inout_sdf,
+			unsigned int count
+	) {
+		transform<S>(
+				inout_sdf,
+				count,
+				[center_x, center_y, center_z, radius, smoothness](auto o, auto vsdf, auto vx, auto vy, auto vz) {
+					typedef decltype(o) O;
+					const auto sd = sdf_sphere_v<O>(vx, vy, vz, center_x, center_y, center_z, radius);
+					return sdf_smooth_subtract_v<O>(vsdf, sd, O::set1(smoothness));
+				},
+				inout_sdf,
+				x,
+				y,
+				z
+		);
+	}
+
+	static Kernels get() {
+		Kernels k;
+		k.add = add;
+		k.add_constant = add_constant;
+		k.subtract = subtract;
+		k.subtract_constant = subtract_constant;
+		k.constant_subtract = constant_subtract;
+		k.multiply = multiply;
+		k.multiply_constant = multiply_constant;
+		k.min = min;
+		k.min_constant = min_constant;
+		k.max = max;
+		k.max_constant = max_constant;
+		k.clamp = clamp;
+		k.clamp_constant = clamp_constant;
+		k.mix = mix;
+		k.smoothstep = smoothstep;
+		k.sdf_sphere = sdf_sphere;
+		k.sdf_box = sdf_box;
+		k.sdf_torus = sdf_torus;
+		k.distance_2d = distance_2d;
+		k.distance_3d = distance_3d;
+		k.normalize_3d = normalize_3d;
+		k.sdf_smooth_union = sdf_smooth_union;
+		k.sdf_smooth_subtract = sdf_smooth_subtract;
+		k.sdf_sphere_smooth_union = sdf_sphere_smooth_union;
+		k.sdf_sphere_smooth_subtract = sdf_sphere_smooth_subtract;
+		return k;
+	}
+};
+
+} // namespace
+} // namespace zylann::voxel::pg::simd
+
+#endif // VOXEL_GRAPH_KERNELS_IMPL_H
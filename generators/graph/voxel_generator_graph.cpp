@@ -523,6 +523,13 @@ void fill_zx_integer_slice(
 
 } // namespace
 
+namespace {
+
+// Sections of blocks are not split further than this size
+const int MIN_ADAPTIVE_SECTION_SIZE = 8;
+
+} // namespace
+
 VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::VoxelQueryData &input) {
 	std::shared_ptr<Runtime> runtime_ptr;
 	{
@@ -530,11 +537,47 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 		runtime_ptr = _runtime;
 	}
 
-	Result result;
+	if (runtime_ptr == nullptr) {
+		return Result();
+	}
+
+	unsigned int prepared_buffer_size = 0;
+	return generate_block(*runtime_ptr, get_tls_cache(), input, prepared_buffer_size);
+}
+
+void VoxelGeneratorGraph::generate_blocks(Span<VoxelQueryData> queries, Span<Result> out_results) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(queries.size() == out_results.size());
+
+	std::shared_ptr<Runtime> runtime_ptr;
+	{
+		RWLockRead rlock(_runtime_lock);
+		runtime_ptr = _runtime;
+	}
 
 	if (runtime_ptr == nullptr) {
-		return result;
+		for (Result &result : out_results) {
+			result = Result();
+		}
+		return;
+	}
+
+	// The runtime, the cache and its state are shared by all blocks, so they are setup only once
+	Cache &cache = get_tls_cache();
+	unsigned int prepared_buffer_size = 0;
+
+	for (unsigned int i = 0; i < queries.size(); ++i) {
+		out_results[i] = generate_block(*runtime_ptr, cache, queries[i], prepared_buffer_size);
 	}
+}
+
+VoxelGenerator::Result VoxelGeneratorGraph::generate_block(
+		Runtime &runtime_wrapper,
+		Cache &cache,
+		VoxelGenerator::VoxelQueryData &input,
+		unsigned int &prepared_buffer_size
+) {
+	Result result;
 
 	VoxelBuffer &out_buffer = input.voxel_buffer;
 
@@ -546,7 +589,7 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 	// Storing voxels is lossy on some depth configurations. They use normalized SDF,
 	// so we must scale the values to make better use of the offered resolution
 	const VoxelBuffer::Depth sdf_channel_depth = out_buffer.get_channel_depth(sdf_channel);
-	const float sdf_scale = VoxelBuffer::get_sdf_quantization_scale(sdf_channel_depth);
+	const float sdf_scale = out_buffer.get_sdf_channel_quantization_scale();
 
 	const VoxelBuffer::ChannelId type_channel = VoxelBuffer::CHANNEL_TYPE;
 	const VoxelBuffer::Depth type_channel_depth = out_buffer.get_channel_depth(type_channel);
@@ -562,16 +605,20 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 
 	const Vector3i section_size =
 			_use_subdivision && can_use_subdivision ? Vector3iUtil::create(_subdivision_size) : bs;
+	// Sections in which range analysis is inconclusive can be split further, in case smaller parts can be resolved
+	const bool use_adaptive_subdivision = _use_subdivision && can_use_subdivision;
 	// ERR_FAIL_COND_V(bs.x % section_size != 0, result);
 	// ERR_FAIL_COND_V(bs.y % section_size != 0, result);
 	// ERR_FAIL_COND_V(bs.z % section_size != 0, result);
 
-	Cache &cache = get_tls_cache();
-
 	// Slice is on the Y axis
 	const unsigned int slice_buffer_size = section_size.x * section_size.z;
-	pg::Runtime &runtime = runtime_ptr->runtime;
-	runtime.prepare_state(cache.state, slice_buffer_size, false);
+	pg::Runtime &runtime = runtime_wrapper.runtime;
+	// When generating multiple blocks in a row, the state can be re-used if it was prepared for the same size
+	if (prepared_buffer_size != slice_buffer_size) {
+		runtime.prepare_state(cache.state, slice_buffer_size, false);
+		prepared_buffer_size = slice_buffer_size;
+	}
 
 	cache.x_cache.resize(slice_buffer_size);
 	cache.y_cache.resize(slice_buffer_size);
@@ -584,9 +631,9 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 	const float air_sdf = _debug_clipped_blocks ? constants::SDF_FAR_INSIDE : constants::SDF_FAR_OUTSIDE;
 	const float matter_sdf = _debug_clipped_blocks ? constants::SDF_FAR_OUTSIDE : constants::SDF_FAR_INSIDE;
 
-	FixedArray<uint8_t, 4> spare_texture_indices = runtime_ptr->spare_texture_indices;
-	const int sdf_output_buffer_index = runtime_ptr->sdf_output_buffer_index;
-	const int type_output_buffer_index = runtime_ptr->type_output_buffer_index;
+	FixedArray<uint8_t, 4> spare_texture_indices = runtime_wrapper.spare_texture_indices;
+	const int sdf_output_buffer_index = runtime_wrapper.sdf_output_buffer_index;
+	const int type_output_buffer_index = runtime_wrapper.type_output_buffer_index;
 
 	bool all_sdf_is_air = (sdf_output_buffer_index != -1) && (type_output_buffer_index == -1);
 	bool all_sdf_is_matter = all_sdf_is_air;
@@ -594,7 +641,7 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 	math::Interval sdf_input_range;
 	Span<float> input_sdf_full_cache;
 	Span<float> input_sdf_slice_cache;
-	if (runtime_ptr->sdf_input_index != -1) {
+	if (runtime_wrapper.sdf_input_index != -1) {
 		ZN_PROFILE_SCOPE();
 		cache.input_sdf_slice_cache.resize(slice_buffer_size);
 		input_sdf_slice_cache = to_span(cache.input_sdf_slice_cache);
@@ -612,198 +659,253 @@ VoxelGenerator::Result VoxelGeneratorGraph::generate_block(VoxelGenerator::Voxel
 		}
 	}
 
-	// For each subdivision of the block
+	// Sections which can't be resolved by range analysis can be split further, so they are processed from a stack
+	StdVector<Box3i> &sections = cache.sections;
+	sections.clear();
 	for (int sz = 0; sz < bs.z; sz += section_size.z) {
 		for (int sy = 0; sy < bs.y; sy += section_size.y) {
 			for (int sx = 0; sx < bs.x; sx += section_size.x) {
-				ZN_PROFILE_SCOPE_NAMED("Section");
-
-				const Vector3i rmin(sx, sy, sz);
-				const Vector3i rmax = rmin + Vector3i(section_size);
-				const Vector3i gmin = origin + (rmin << input.lod);
-				const Vector3i gmax = origin + (rmax << input.lod);
-
-				// Do a quick analysis of the area. We'll only compute voxels if necessary.
-				{
-					QueryInputs<math::Interval> range_inputs(
-							*runtime_ptr,
-							math::Interval(gmin.x, gmax.x),
-							math::Interval(gmin.y, gmax.y),
-							math::Interval(gmin.z, gmax.z),
-							sdf_input_range
+				sections.push_back(Box3i(Vector3i(sx, sy, sz), section_size));
+			}
+		}
+	}
+
+	while (sections.size() > 0) {
+		ZN_PROFILE_SCOPE_NAMED("Section");
+
+		const Box3i section = sections.back();
+		sections.pop_back();
+
+		const Vector3i rmin = section.position;
+		const Vector3i rmax = section.position + section.size;
+		const Vector3i gmin = origin + (rmin << input.lod);
+		const Vector3i gmax = origin + (rmax << input.lod);
+
+		// Do a quick analysis of the area. We'll only compute voxels if necessary.
+		{
+			QueryInputs<math::Interval> range_inputs(
+					runtime_wrapper,
+					math::Interval(gmin.x, gmax.x),
+					math::Interval(gmin.y, gmax.y),
+					math::Interval(gmin.z, gmax.z),
+					sdf_input_range
+			);
+			runtime.analyze_range(cache.state, range_inputs.get());
+		}
+
+		SmallVector<unsigned int, pg::Runtime::MAX_OUTPUTS> required_outputs;
+
+		bool sdf_is_air = true;
+		bool sdf_is_uniform = true;
+		if (sdf_output_buffer_index != -1) {
+			const math::Interval sdf_range = cache.state.get_range(sdf_output_buffer_index);
+			bool sdf_is_matter = false;
+
+			if (sdf_range.min > clip_threshold && sdf_range.max > clip_threshold) {
+				out_buffer.fill_area_f(air_sdf, rmin, rmax, sdf_channel);
+				sdf_is_air = true;
+
+			} else if (sdf_range.min < -clip_threshold && sdf_range.max < -clip_threshold) {
+				out_buffer.fill_area_f(matter_sdf, rmin, rmax, sdf_channel);
+				sdf_is_air = false;
+				sdf_is_matter = true;
+
+			} else if (sdf_range.is_single_value()) {
+				out_buffer.fill_area_f(sdf_range.min, rmin, rmax, sdf_channel);
+				sdf_is_air = sdf_range.min > 0.f;
+				sdf_is_matter = !sdf_is_air;
+
+			} else if (use_adaptive_subdivision && section.size.x >= 2 * MIN_ADAPTIVE_SECTION_SIZE &&
+					   section.size.x % 2 == 0 && (sdf_range.min < -clip_threshold || sdf_range.max > clip_threshold)) {
+				// Most of the volume of a terrain is usually far from its surface. Range analysis is more precise
+				// over smaller areas, so parts of this section might still be clipped. If the range is already within
+				// the clipping threshold, smaller parts can't be clipped either so it's not worth splitting.
+				const Vector3i half_size = section.size / 2;
+				for (unsigned int i = 0; i < 8; ++i) {
+					const Vector3i offset(
+							(i & 1) * half_size.x, ((i >> 1) & 1) * half_size.y, ((i >> 2) & 1) * half_size.z
 					);
-					runtime.analyze_range(cache.state, range_inputs.get());
+					sections.push_back(Box3i(rmin + offset, half_size));
 				}
+				continue;
 
-				SmallVector<unsigned int, pg::Runtime::MAX_OUTPUTS> required_outputs;
+			} else {
+				// SDF is not uniform, we'll need to compute it per voxel
+				required_outputs.push_back(runtime_wrapper.sdf_output_index);
+				sdf_is_air = false;
+				sdf_is_uniform = false;
+			}
 
-				bool sdf_is_air = true;
-				bool sdf_is_uniform = true;
-				if (sdf_output_buffer_index != -1) {
-					const math::Interval sdf_range = cache.state.get_range(sdf_output_buffer_index);
-					bool sdf_is_matter = false;
+			all_sdf_is_air = all_sdf_is_air && sdf_is_air;
+			all_sdf_is_matter = all_sdf_is_matter && sdf_is_matter;
+		}
 
-					if (sdf_range.min > clip_threshold && sdf_range.max > clip_threshold) {
-						out_buffer.fill_area_f(air_sdf, rmin, rmax, sdf_channel);
-						sdf_is_air = true;
+		bool type_is_uniform = false;
+		if (type_output_buffer_index != -1) {
+			const math::Interval type_range = cache.state.get_range(type_output_buffer_index);
+			if (type_range.is_single_value()) {
+				out_buffer.fill_area(int(type_range.min), rmin, rmax, type_channel);
+				type_is_uniform = true;
+			} else {
+				// Types are not uniform, we'll need to compute them per voxel
+				required_outputs.push_back(runtime_wrapper.type_output_index);
+			}
+		}
 
-					} else if (sdf_range.min < -clip_threshold && sdf_range.max < -clip_threshold) {
-						out_buffer.fill_area_f(matter_sdf, rmin, rmax, sdf_channel);
-						sdf_is_air = false;
-						sdf_is_matter = true;
+		if (runtime_wrapper.weight_outputs_count > 0 && !sdf_is_air) {
+			// We can skip this when SDF is air because there won't be any matter to give a texture to
+			// TODO Range analysis on that?
+			// Not easy to do that from here, they would have to ALL be locally constant in order to use a
+			// short-circuit...
+			for (unsigned int i = 0; i < runtime_wrapper.weight_outputs_count; ++i) {
+				required_outputs.push_back(runtime_wrapper.weight_output_indices[i]);
+			}
+		}
 
-					} else if (sdf_range.is_single_value()) {
-						out_buffer.fill_area_f(sdf_range.min, rmin, rmax, sdf_channel);
-						sdf_is_air = sdf_range.min > 0.f;
-						sdf_is_matter = !sdf_is_air;
+		// TODO Instead of filling this ourselves, can we leave this to the graph runtime?
+		// Because currently our logic seems redundant and more complicated, since we also have to not request
+		// those outputs later if any other output isn't uniform. Instead, the graph runtime can figure out
+		// that stuff is constant.
+		bool single_texture_is_uniform = false;
+		if (runtime_wrapper.single_texture_output_index != -1 && !sdf_is_air) {
+			const math::Interval index_range =
+					cache.state.get_range(runtime_wrapper.single_texture_output_buffer_index);
+			if (index_range.is_single_value()) {
+				// Make sure other indices are different so the weights associated with them don't override the
+				// first index's weight
+				const int index = static_cast<int>(index_range.min);
+				const uint16_t encoded_indices = make_encoded_indices_for_single_texture(index);
+				const uint16_t encoded_weights = make_encoded_weights_for_single_texture();
+				out_buffer.fill_area(encoded_indices, rmin, rmax, VoxelBuffer::CHANNEL_INDICES);
+				out_buffer.fill_area(encoded_weights, rmin, rmax, VoxelBuffer::CHANNEL_WEIGHTS);
+				single_texture_is_uniform = true;
+			} else {
+				required_outputs.push_back(runtime_wrapper.single_texture_output_index);
+			}
+		}
 
-					} else {
-						// SDF is not uniform, we'll need to compute it per voxel
-						required_outputs.push_back(runtime_ptr->sdf_output_index);
-						sdf_is_air = false;
-						sdf_is_uniform = false;
-					}
+		if (required_outputs.size() == 0) {
+			// We found all we need with range analysis, no need to calculate per voxel.
+			continue;
+		}
 
-					all_sdf_is_air = all_sdf_is_air && sdf_is_air;
-					all_sdf_is_matter = all_sdf_is_matter && sdf_is_matter;
-				}
+		// At least one channel needs per-voxel computation.
 
-				bool type_is_uniform = false;
-				if (type_output_buffer_index != -1) {
-					const math::Interval type_range = cache.state.get_range(type_output_buffer_index);
-					if (type_range.is_single_value()) {
-						out_buffer.fill_area(int(type_range.min), rmin, rmax, type_channel);
-						type_is_uniform = true;
-					} else {
-						// Types are not uniform, we'll need to compute them per voxel
-						required_outputs.push_back(runtime_ptr->type_output_index);
-					}
-				}
+		// Sections may have been split, in which case they are smaller
+		const unsigned int section_buffer_size = section.size.x * section.size.z;
+		if (section_buffer_size != prepared_buffer_size) {
+			runtime.prepare_state(cache.state, section_buffer_size, false);
+			prepared_buffer_size = section_buffer_size;
+		}
 
-				if (runtime_ptr->weight_outputs_count > 0 && !sdf_is_air) {
-					// We can skip this when SDF is air because there won't be any matter to give a texture to
-					// TODO Range analysis on that?
-					// Not easy to do that from here, they would have to ALL be locally constant in order to use a
-					// short-circuit...
-					for (unsigned int i = 0; i < runtime_ptr->weight_outputs_count; ++i) {
-						required_outputs.push_back(runtime_ptr->weight_output_indices[i]);
-					}
-				}
+		Span<float> section_x_cache = x_cache.sub(0, section_buffer_size);
+		Span<float> section_y_cache = y_cache.sub(0, section_buffer_size);
+		Span<float> section_z_cache = z_cache.sub(0, section_buffer_size);
+		Span<float> section_input_sdf_cache;
+		if (input_sdf_slice_cache.size() != 0) {
+			section_input_sdf_cache = input_sdf_slice_cache.sub(0, section_buffer_size);
+		}
 
-				// TODO Instead of filling this ourselves, can we leave this to the graph runtime?
-				// Because currently our logic seems redundant and more complicated, since we also have to not request
-				// those outputs later if any other output isn't uniform. Instead, the graph runtime can figure out
-				// that stuff is constant.
-				bool single_texture_is_uniform = false;
-				if (runtime_ptr->single_texture_output_index != -1 && !sdf_is_air) {
-					const math::Interval index_range =
-							cache.state.get_range(runtime_ptr->single_texture_output_buffer_index);
-					if (index_range.is_single_value()) {
-						// Make sure other indices are different so the weights associated with them don't override the
-						// first index's weight
-						const int index = static_cast<int>(index_range.min);
-						const uint16_t encoded_indices = make_encoded_indices_for_single_texture(index);
-						const uint16_t encoded_weights = make_encoded_weights_for_single_texture();
-						out_buffer.fill_area(encoded_indices, rmin, rmax, VoxelBuffer::CHANNEL_INDICES);
-						out_buffer.fill_area(encoded_weights, rmin, rmax, VoxelBuffer::CHANNEL_WEIGHTS);
-						single_texture_is_uniform = true;
-					} else {
-						required_outputs.push_back(runtime_ptr->single_texture_output_index);
-					}
-				}
+		if (_use_optimized_execution_map) {
+			runtime.generate_optimized_execution_map(
+					cache.state, cache.optimized_execution_map, to_span(required_outputs), false
+			);
+		}
+
+		// Values computed by the outer group of the graph only depend on X and Z, so they can be shared with
+		// other blocks of the same column. Only sections that were not split are cached.
+		const Span<const uint16_t> outer_group_output_addresses = runtime.get_outer_group_output_addresses();
+		const bool use_column_cache =
+				_use_xz_caching && outer_group_output_addresses.size() > 0 && section.size == section_size;
+		const Vector3i column_key = GraphColumnCache::make_key(gmin.x, gmin.z, input.lod);
+		bool outer_group_cached = false;
+		if (use_column_cache) {
+			outer_group_cached = runtime_wrapper.column_cache.try_load(
+					column_key, cache.state, outer_group_output_addresses, _use_optimized_execution_map
+			);
+		}
 
-				if (required_outputs.size() == 0) {
-					// We found all we need with range analysis, no need to calculate per voxel.
-					continue;
+		{
+			unsigned int i = 0;
+			for (int rz = rmin.z, gz = gmin.z; rz < rmax.z; ++rz, gz += stride) {
+				for (int rx = rmin.x, gx = gmin.x; rx < rmax.x; ++rx, gx += stride) {
+					section_x_cache[i] = gx;
+					section_z_cache[i] = gz;
+					++i;
 				}
+			}
+		}
 
-				// At least one channel needs per-voxel computation.
+		for (int ry = rmin.y, gy = gmin.y; ry < rmax.y; ++ry, gy += stride) {
+			ZN_PROFILE_SCOPE_NAMED("Full slice");
 
-				if (_use_optimized_execution_map) {
-					runtime.generate_optimized_execution_map(
-							cache.state, cache.optimized_execution_map, to_span(required_outputs), false
-					);
-				}
+			section_y_cache.fill(gy);
 
-				{
-					unsigned int i = 0;
-					for (int rz = rmin.z, gz = gmin.z; rz < rmax.z; ++rz, gz += stride) {
-						for (int rx = rmin.x, gx = gmin.x; rx < rmax.x; ++rx, gx += stride) {
-							x_cache[i] = gx;
-							z_cache[i] = gz;
-							++i;
-						}
+			if (input_sdf_full_cache.size() != 0) {
+				// Copy input SDF using expected coordinate convention.
+				// VoxelBuffer is ZXY, but the graph runs in YXZ.
+				unsigned int i = 0;
+				for (int rz = rmin.z; rz < rmax.z; ++rz) {
+					for (int rx = rmin.x; rx < rmax.x; ++rx) {
+						const unsigned int loc = Vector3iUtil::get_zxy_index(rx, ry, rz, bs.x, bs.y);
+						section_input_sdf_cache[i] = input_sdf_full_cache[loc];
+						++i;
 					}
 				}
+			}
 
-				for (int ry = rmin.y, gy = gmin.y; ry < rmax.y; ++ry, gy += stride) {
-					ZN_PROFILE_SCOPE_NAMED("Full slice");
-
-					y_cache.fill(gy);
-
-					if (input_sdf_full_cache.size() != 0) {
-						// Copy input SDF using expected coordinate convention.
-						// VoxelBuffer is ZXY, but the graph runs in YXZ.
-						unsigned int i = 0;
-						for (int rz = rmin.z; rz < rmax.z; ++rz) {
-							for (int rx = rmin.x; rx < rmax.x; ++rx) {
-								const unsigned int loc = Vector3iUtil::get_zxy_index(rx, ry, rz, bs.x, bs.y);
-								input_sdf_slice_cache[i] = input_sdf_full_cache[loc];
-								++i;
-							}
-						}
-					}
+			// Full query (unless using execution map)
+			{
+				QueryInputs query_inputs(
+						runtime_wrapper, section_x_cache, section_y_cache, section_z_cache, section_input_sdf_cache
+				);
+				runtime.generate_set(
+						cache.state,
+						query_inputs.get(),
+						_use_xz_caching && (ry != rmin.y || outer_group_cached),
+						_use_optimized_execution_map ? &cache.optimized_execution_map : nullptr
+				);
+			}
 
-					// Full query (unless using execution map)
-					{
-						QueryInputs query_inputs(*runtime_ptr, x_cache, y_cache, z_cache, input_sdf_slice_cache);
-						runtime.generate_set(
-								cache.state,
-								query_inputs.get(),
-								_use_xz_caching && ry != rmin.y,
-								_use_optimized_execution_map ? &cache.optimized_execution_map : nullptr
-						);
-					}
+			if (use_column_cache && !outer_group_cached && ry == rmin.y) {
+				runtime_wrapper.column_cache.store(
+						column_key, cache.state, outer_group_output_addresses, _use_optimized_execution_map
+				);
+			}
 
-					if (sdf_output_buffer_index != -1
-						// If SDF was found uniform, we already filled the results, and we did not require it in the
-						// query. But if another output exists, a query might still run (so we end up at this
-						// `if`), and we should not gather SDF results. Otherwise it would overwrite the slice with
-						// garbage since SDF was skipped.
-						// The same logic goes for other outputs: if they aren't in the query, we must not fill
-						// them.
-						&& !sdf_is_uniform) {
-						const pg::Runtime::Buffer &sdf_buffer = cache.state.get_buffer(sdf_output_buffer_index);
-						fill_zx_sdf_slice(
-								sdf_buffer, out_buffer, sdf_channel, sdf_channel_depth, sdf_scale, rmin, rmax, ry
-						);
-					}
+			if (sdf_output_buffer_index != -1
+				// If SDF was found uniform, we already filled the results, and we did not require it in the
+				// query. But if another output exists, a query might still run (so we end up at this
+				// `if`), and we should not gather SDF results. Otherwise it would overwrite the slice with
+				// garbage since SDF was skipped.
+				// The same logic goes for other outputs: if they aren't in the query, we must not fill
+				// them.
+				&& !sdf_is_uniform) {
+				const pg::Runtime::Buffer &sdf_buffer = cache.state.get_buffer(sdf_output_buffer_index);
+				fill_zx_sdf_slice(sdf_buffer, out_buffer, sdf_channel, sdf_channel_depth, sdf_scale, rmin, rmax, ry);
+			}
 
-					if (type_output_buffer_index != -1 && !type_is_uniform) {
-						const pg::Runtime::Buffer &type_buffer = cache.state.get_buffer(type_output_buffer_index);
-						fill_zx_integer_slice(
-								type_buffer, out_buffer, type_channel, type_channel_depth, rmin, rmax, ry
-						);
-					}
+			if (type_output_buffer_index != -1 && !type_is_uniform) {
+				const pg::Runtime::Buffer &type_buffer = cache.state.get_buffer(type_output_buffer_index);
+				fill_zx_integer_slice(type_buffer, out_buffer, type_channel, type_channel_depth, rmin, rmax, ry);
+			}
 
-					if (runtime_ptr->single_texture_output_index != -1 && !single_texture_is_uniform) {
-						gather_indices_and_weights_from_single_texture(
-								runtime_ptr->single_texture_output_buffer_index, cache.state, rmin, rmax, ry, out_buffer
-						);
-					}
+			if (runtime_wrapper.single_texture_output_index != -1 && !single_texture_is_uniform) {
+				gather_indices_and_weights_from_single_texture(
+						runtime_wrapper.single_texture_output_buffer_index, cache.state, rmin, rmax, ry, out_buffer
+				);
+			}
 
-					if (runtime_ptr->weight_outputs_count > 0) {
-						gather_indices_and_weights(
-								to_span_const(runtime_ptr->weight_outputs, runtime_ptr->weight_outputs_count),
-								cache.state,
-								rmin,
-								rmax,
-								ry,
-								out_buffer,
-								spare_texture_indices
-						);
-					}
-				}
+			if (runtime_wrapper.weight_outputs_count > 0) {
+				gather_indices_and_weights(
+						to_span_const(runtime_wrapper.weight_outputs, runtime_wrapper.weight_outputs_count),
+						cache.state,
+						rmin,
+						rmax,
+						ry,
+						out_buffer,
+						spare_texture_indices
+				);
 			}
 		}
 	}
@@ -854,8 +956,7 @@ bool VoxelGeneratorGraph::generate_broad_block(VoxelGenerator::VoxelQueryData &i
 	// TODO This may be shared across the module
 	// Storing voxels is lossy on some depth configurations. They use normalized SDF,
 	// so we must scale the values to make better use of the offered resolution
-	const VoxelBuffer::Depth sdf_channel_depth = out_buffer.get_channel_depth(sdf_channel);
-	const float sdf_scale = VoxelBuffer::get_sdf_quantization_scale(sdf_channel_depth);
+	const float sdf_scale = out_buffer.get_sdf_channel_quantization_scale();
 
 	const VoxelBuffer::ChannelId type_channel = VoxelBuffer::CHANNEL_TYPE;
 
@@ -1167,6 +1268,8 @@ pg::CompilationResult VoxelGeneratorGraph::compile(bool debug) {
 	// Store valid result
 	RWLockWrite wlock(_runtime_lock);
 	_runtime = r;
+	// Blocks generated with the previous runtime may be different
+	increment_output_revision();
 
 	const int64_t time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
 	ZN_PRINT_VERBOSE(format("Voxel graph compiled in {} us", time_spent));
@@ -1230,6 +1333,8 @@ void VoxelGeneratorGraph::generate_series(
 		Vector3f min_pos,
 		Vector3f max_pos
 ) {
+	ZN_PROFILE_SCOPE();
+
 	std::shared_ptr<Runtime> runtime_ptr;
 	{
 		RWLockRead rlock(_runtime_lock);
@@ -1239,14 +1344,17 @@ void VoxelGeneratorGraph::generate_series(
 		return;
 	}
 
+	int output_index;
 	int buffer_index;
 	float defval = 0.f;
 	switch (channel) {
 		case VoxelBuffer::CHANNEL_SDF:
+			output_index = runtime_ptr->sdf_output_index;
 			buffer_index = runtime_ptr->sdf_output_buffer_index;
 			defval = VoxelBuffer::get_default_value_static(channel);
 			break;
 		case VoxelBuffer::CHANNEL_TYPE:
+			output_index = runtime_ptr->type_output_index;
 			buffer_index = runtime_ptr->type_output_buffer_index;
 			break;
 		default:
@@ -1260,20 +1368,85 @@ void VoxelGeneratorGraph::generate_series(
 		return;
 	}
 
+	const unsigned int count = out_values.size();
+	ZN_ASSERT_RETURN(positions_x.size() == count && positions_y.size() == count && positions_z.size() == count);
+	if (count == 0) {
+		return;
+	}
+
+	// The bounds given by the caller are not always conservative (callers may sample a bit around them), so the
+	// actual bounds of the series are used for range analysis
+	min_pos = Vector3f(positions_x[0], positions_y[0], positions_z[0]);
+	max_pos = min_pos;
+	for (unsigned int i = 1; i < count; ++i) {
+		min_pos.x = math::min(min_pos.x, positions_x[i]);
+		min_pos.y = math::min(min_pos.y, positions_y[i]);
+		min_pos.z = math::min(min_pos.z, positions_z[i]);
+		max_pos.x = math::max(max_pos.x, positions_x[i]);
+		max_pos.y = math::max(max_pos.y, positions_y[i]);
+		max_pos.z = math::max(max_pos.z, positions_z[i]);
+	}
+
+	Cache &cache = get_tls_cache();
+	pg::Runtime &runtime = runtime_ptr->runtime;
+	runtime.prepare_state(cache.state, count, false);
+
+	// Graphs having an SDF input get default values
+	Span<float> in_sdf;
+	if (runtime_ptr->sdf_input_index != -1) {
+		cache.input_sdf_full_cache.resize(count);
+		in_sdf = to_span(cache.input_sdf_full_cache);
+		in_sdf.fill(0.f);
+	}
+
+	{
+		QueryInputs<math::Interval> range_inputs(
+				*runtime_ptr,
+				math::Interval(min_pos.x, max_pos.x),
+				math::Interval(min_pos.y, max_pos.y),
+				math::Interval(min_pos.z, max_pos.z),
+				math::Interval::from_single_value(0.f)
+		);
+		runtime.analyze_range(cache.state, range_inputs.get());
+	}
+
+	// Series are often small and localized (instances of a block, detail rendering tiles), so the output can be
+	// uniform over the whole area
+	const math::Interval output_range = cache.state.get_range(buffer_index);
+	if (output_range.is_single_value()) {
+		out_values.fill(output_range.min);
+		return;
+	}
+
+	// Only run operations contributing to the requested output
+	if (_use_optimized_execution_map) {
+		const unsigned int required_output = output_index;
+		runtime.generate_optimized_execution_map(
+				cache.state, cache.optimized_execution_map, Span<const unsigned int>(&required_output, 1), false
+		);
+	}
+
 	{
 		// The implementation cannot guarantee constness at compile time, but it should not modifiy the data either way
 		float *ptr_x = const_cast<float *>(positions_x.data());
 		float *ptr_y = const_cast<float *>(positions_y.data());
 		float *ptr_z = const_cast<float *>(positions_z.data());
-		generate_set(
-				Span<float>(ptr_x, positions_x.size()),
-				Span<float>(ptr_y, positions_y.size()),
-				Span<float>(ptr_z, positions_z.size())
+
+		QueryInputs inputs(
+				*runtime_ptr, Span<float>(ptr_x, count), Span<float>(ptr_y, count), Span<float>(ptr_z, count), in_sdf
+		);
+
+		runtime.generate_set(
+				cache.state,
+				inputs.get(),
+				false,
+				_use_optimized_execution_map ? &cache.optimized_execution_map : nullptr
 		);
 	}
 
-	const pg::Runtime::Buffer &buffer = get_tls_cache().state.get_buffer(buffer_index);
-	memcpy(out_values.data(), buffer.data, sizeof(float) * out_values.size());
+	// Note, when generating SDF, we don't scale it because the return values are uncompressed floats.
+	const pg::Runtime::Buffer &buffer = cache.state.get_buffer(buffer_index);
+	memcpy(out_values.data(), buffer.data, sizeof(float) * count);
 }
 
 const pg::Runtime::State &VoxelGeneratorGraph::get_last_state_from_current_thread() {
@@ -6,12 +6,14 @@
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/core/dictionary.h"
 #include "../../util/macros.h"
+#include "../../util/math/box3i.h"
 #include "../../util/math/vector2.h"
 #include "../../util/math/vector3.h"
 #include "../../util/math/vector3f.h"
 #include "../../util/math/vector3i.h"
 #include "../../util/thread/rw_lock.h"
 #include "../voxel_generator.h"
+#include "column_cache.h"
 #include "program_graph.h"
 #include "voxel_graph_function.h"
 #include "voxel_graph_runtime.h"
@@ -63,6 +65,7 @@ public:
 	int get_used_channels_mask() const override;
 
 	Result generate_block(VoxelGenerator::VoxelQueryData &input) override;
+	void generate_blocks(Span<VoxelQueryData> queries, Span<Result> out_results) override;
 	bool generate_broad_block(VoxelGenerator::VoxelQueryData &input) override;
 	// float generate_single(const Vector3i &position);
 	bool supports_single_generation() const override {
@@ -218,6 +221,10 @@ private:
 		// List of indices to feed queries. The order doesn't matter, can be different from `weight_outputs`.
 		FixedArray<unsigned int, 16> weight_output_indices;
 		unsigned int weight_outputs_count = 0;
+
+		// Results of the outer group shared between blocks of the same column, when XZ caching is enabled.
+		// It lives with the compiled runtime, so it gets discarded when the graph changes.
+		GraphColumnCache column_cache;
 	};
 
 	// Helper to setup inputs for runtime queries
@@ -259,9 +266,20 @@ private:
 		// TODO Use the runtime and state from `VoxelGraphFunction`
 		pg::Runtime::State state;
 		pg::Runtime::ExecutionMap optimized_execution_map;
+		// Sections of the block being generated
+		StdVector<Box3i> sections;
 	};
 
 	static Cache &get_tls_cache();
+
+	// `prepared_buffer_size` is the size the state of the cache was last prepared with, so it isn't prepared again
+	// when generating several blocks in a row.
+	Result generate_block(
+			Runtime &runtime_wrapper,
+			Cache &cache,
+			VoxelGenerator::VoxelQueryData &input,
+			unsigned int &prepared_buffer_size
+	);
 };
 
 } // namespace zylann::voxel
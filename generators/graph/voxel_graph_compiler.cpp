@@ -10,10 +10,17 @@
 #include "node_type_db.h"
 #include "voxel_graph_function.h"
 
+#include <atomic>
 #include <limits>
 
 namespace zylann::voxel::pg {
 
+std::atomic_bool g_optimizations_enabled = { true };
+
+void set_optimizations_enabled(bool enabled) {
+	g_optimizations_enabled.store(enabled, std::memory_order_relaxed);
+}
+
 namespace {
 
 // Updates remaps for replacing one node with one other, where old and new nodes have the same number of outputs.
@@ -438,6 +445,62 @@ struct NodePair {
 	}
 };
 
+bool is_node_equivalent(
+		const ProgramGraph &graph,
+		const ProgramGraph::Node &node1,
+		const ProgramGraph::Node &node2,
+		StdVector<NodePair> &equivalences
+);
+
+bool is_input_equivalent(
+		const ProgramGraph &graph,
+		const ProgramGraph::Node &node1,
+		unsigned int node1_input_index,
+		const ProgramGraph::Node &node2,
+		unsigned int node2_input_index,
+		StdVector<NodePair> &equivalences
+) {
+	const ProgramGraph::Port &node1_input = node1.inputs[node1_input_index];
+	const ProgramGraph::Port &node2_input = node2.inputs[node2_input_index];
+	if (node1_input.connections.size() != node2_input.connections.size()) {
+		return false;
+	}
+	ZN_ASSERT_RETURN_V_MSG(node1_input.connections.size() <= 1, false, "Multiple input connections isn't supported");
+	if (node1_input.connections.size() == 0) {
+		// Continuing the paranoia here, but that's because Godot doesn't define `_DEBUG` (and I can't define it in
+		// my module without failing to link), so standard library bound checks are in the toilet
+		ZN_ASSERT(node1.default_inputs.size() == node1.inputs.size());
+		ZN_ASSERT(node2.default_inputs.size() == node2.inputs.size());
+		// No ancestor, check default inputs (autoconnect is ignored, it must have been applied earlier)
+		const Variant v1 = node1.default_inputs[node1_input_index];
+		const Variant v2 = node2.default_inputs[node2_input_index];
+		// Different default inputs?
+		return v1 == v2;
+	}
+	const ProgramGraph::PortLocation &node1_src = node1_input.connections[0];
+	const ProgramGraph::PortLocation &node2_src = node2_input.connections[0];
+	if (node1_src.port_index != node2_src.port_index) {
+		// Different ancestor output
+		return false;
+	}
+	const ProgramGraph::Node &ancestor1 = graph.get_node(node1_src.node_id);
+	const ProgramGraph::Node &ancestor2 = graph.get_node(node2_src.node_id);
+	return is_node_equivalent(graph, ancestor1, ancestor2, equivalences);
+}
+
+// Tells if the two inputs of a node can be swapped without changing its result
+bool is_commutative(uint32_t type_id) {
+	switch (type_id) {
+		case VoxelGraphFunction::NODE_ADD:
+		case VoxelGraphFunction::NODE_MULTIPLY:
+		case VoxelGraphFunction::NODE_MIN:
+		case VoxelGraphFunction::NODE_MAX:
+			return true;
+		default:
+			return false;
+	}
+}
+
 bool is_node_equivalent(
 		const ProgramGraph &graph,
 		const ProgramGraph::Node &node1,
@@ -473,44 +536,25 @@ bool is_node_equivalent(
 			return false;
 		}
 	}
+	// Equivalences found in ancestors are discarded if the nodes turn out to be different
+	const size_t equivalences_checkpoint = equivalences.size();
+	bool inputs_equivalent = true;
 	for (unsigned int input_index = 0; input_index < node1.inputs.size(); ++input_index) {
-		const ProgramGraph::Port &node1_input = node1.inputs[input_index];
-		const ProgramGraph::Port &node2_input = node2.inputs[input_index];
-		if (node1_input.connections.size() != node2_input.connections.size()) {
-			return false;
-		}
-		ZN_ASSERT_RETURN_V_MSG(
-				node1_input.connections.size() <= 1, false, "Multiple input connections isn't supported"
-		);
-		// TODO Some nodes like `*` and `+` have unordered inputs, we need to handle that
-		if (node1_input.connections.size() == 0) {
-			// Continuing the paranoia here, but that's because Godot doesn't define `_DEBUG` (and I can't define it in
-			// my module without failing to link), so standard library bound checks are in the toilet
-			ZN_ASSERT(node1.default_inputs.size() == node1.inputs.size());
-			ZN_ASSERT(node2.default_inputs.size() == node2.inputs.size());
-			// No ancestor, check default inputs (autoconnect is ignored, it must have been applied earlier)
-			const Variant v1 = node1.default_inputs[input_index];
-			const Variant v2 = node2.default_inputs[input_index];
-			if (v1 != v2) {
-				// Different default inputs
-				return false;
-			}
-		} else {
-			const ProgramGraph::PortLocation &node1_src = node1_input.connections[0];
-			const ProgramGraph::PortLocation &node2_src = node2_input.connections[0];
-			if (node1_src.port_index != node2_src.port_index) {
-				// Different ancestor output
-				return false;
-			}
-			const ProgramGraph::Node &ancestor1 = graph.get_node(node1_src.node_id);
-			const ProgramGraph::Node &ancestor2 = graph.get_node(node2_src.node_id);
-			if (!is_node_equivalent(graph, ancestor1, ancestor2, equivalences)) {
-				// Different ancestors
-				equivalences.clear();
-				return false;
-			}
+		if (!is_input_equivalent(graph, node1, input_index, node2, input_index, equivalences)) {
+			inputs_equivalent = false;
+			break;
 		}
 	}
+	if (!inputs_equivalent && node1.inputs.size() == 2 && is_commutative(node1.type_id)) {
+		// Inputs may be connected the other way around, like `a + b` and `b + a`
+		equivalences.resize(equivalences_checkpoint);
+		inputs_equivalent = is_input_equivalent(graph, node1, 0, node2, 1, equivalences) &&
+				is_input_equivalent(graph, node1, 1, node2, 0, equivalences);
+	}
+	if (!inputs_equivalent) {
+		equivalences.resize(equivalences_checkpoint);
+		return false;
+	}
 	NodePair equivalence{ node1.id, node2.id };
 #ifdef DEBUG_ENABLED
 	for (const NodePair &p : equivalences) {
@@ -656,7 +700,29 @@ void apply_auto_connects(
 	}
 }
 
-void try_simplify_clamp_node(
+// Gets the value of an input if it is known at compile time, either because it isn't connected or because it is
+// connected to a constant node.
+bool try_get_constant_input(
+		const ProgramGraph &graph,
+		const ProgramGraph::Node &node,
+		unsigned int input_index,
+		float &out_value
+) {
+	const ProgramGraph::Port &input = node.inputs[input_index];
+	if (input.connections.size() == 0) {
+		ZN_ASSERT(node.default_inputs.size() == node.inputs.size());
+		out_value = node.default_inputs[input_index];
+		return true;
+	}
+	const ProgramGraph::Node &src_node = graph.get_node(input.connections[0].node_id);
+	if (src_node.type_id == VoxelGraphFunction::NODE_CONSTANT) {
+		ZN_ASSERT(src_node.params.size() == 1);
+		out_value = src_node.params[0];
+		return true;
+	}
+	return false;
+}
+
 		ProgramGraph &graph,
 		const ProgramGraph::Node &node,
 		const NodeTypeDB &type_db,
@@ -674,15 +740,12 @@ void try_simplify_clamp_node(
 	const uint32_t clampc_min_param_id = 0;
 	const uint32_t clampc_max_param_id = 1;
 
-	if (node.inputs[clamp_min_input_id].connections.size() == 0 &&
-		node.inputs[clamp_max_input_id].connections.size() == 0) {
+	float minv;
+	float maxv;
+	if (try_get_constant_input(graph, node, clamp_min_input_id, minv) &&
+		try_get_constant_input(graph, node, clamp_max_input_id, maxv)) {
 		// Can be replaced with a clamp version with constant bounds
 
-		ZN_ASSERT(node.default_inputs.size() == node.inputs.size());
-
-		const float minv = node.default_inputs[clamp_min_input_id];
-		const float maxv = node.default_inputs[clamp_max_input_id];
-
 		// Create new node
 		ProgramGraph::Node &clampc_node = create_node(graph, type_db, VoxelGraphFunction::NODE_CLAMP_C);
 
@@ -733,6 +796,141 @@ void replace_simplifiable_nodes(ProgramGraph &graph, const NodeTypeDB &type_db,
 	}
 }
 
+// Computes the result of a node from constant inputs. Returns false if the node can't be evaluated at compile time.
+bool try_evaluate_constant_node(
+		const ProgramGraph::Node &node,
+		const NodeTypeDB &type_db,
+		Span<const float> inputs,
+		float &out_value
+) {
+	switch (node.type_id) {
+		// These nodes have no expression function because they are operators in expressions
+		case VoxelGraphFunction::NODE_ADD:
+			out_value = inputs[0] + inputs[1];
+			return true;
+		case VoxelGraphFunction::NODE_SUBTRACT:
+			out_value = inputs[0] - inputs[1];
+			return true;
+		case VoxelGraphFunction::NODE_MULTIPLY:
+			out_value = inputs[0] * inputs[1];
+			return true;
+		case VoxelGraphFunction::NODE_DIVIDE:
+			// Same as the runtime implementation
+			out_value = inputs[1] == 0.f ? 0.f : inputs[0] / inputs[1];
+			return true;
+		default:
+			break;
+	}
+	const NodeType &type = type_db.get_type(node.type_id);
+	// Nodes with parameters could have their own behavior, and multiple outputs can't be folded into one constant
+	if (type.expression_func == nullptr || type.params.size() != 0 || type.outputs.size() != 1 ||
+		type.inputs.size() != inputs.size()) {
+		return false;
+	}
+	out_value = type.expression_func(inputs);
+	return true;
+}
+
+// Replaces nodes having only constant inputs with a constant node holding their result. Nodes are visited in
+// dependency order, so folding propagates down branches. This mostly happens after expanding functions, where
+// parameters of a function are often constant in the graph using it.
+void fold_constants(ProgramGraph &graph, const NodeTypeDB &type_db, GraphRemappingInfo *remap_info) {
+	ZN_PROFILE_SCOPE();
+
+	// Start from nodes whose outputs are not used, so every node gets visited
+	StdVector<uint32_t> end_node_ids;
+	graph.for_each_node_const([&end_node_ids](const ProgramGraph::Node &node) {
+		for (const ProgramGraph::Port &output : node.outputs) {
+			if (output.connections.size() > 0) {
+				return;
+			}
+		}
+		end_node_ids.push_back(node.id);
+	});
+
+	StdVector<uint32_t> order;
+	graph.find_dependencies(end_node_ids, order);
+
+	StdVector<float> input_values;
+
+	for (const uint32_t node_id : order) {
+		const ProgramGraph::Node &node = graph.get_node(node_id);
+		if (node.type_id == VoxelGraphFunction::NODE_CONSTANT || node.inputs.size() == 0 || node.outputs.size() != 1) {
+			continue;
+		}
+
+		input_values.resize(node.inputs.size());
+		bool all_inputs_constant = true;
+		for (unsigned int input_index = 0; input_index < node.inputs.size(); ++input_index) {
+			if (!try_get_constant_input(graph, node, input_index, input_values[input_index])) {
+				all_inputs_constant = false;
+				break;
+			}
+		}
+		if (!all_inputs_constant) {
+			continue;
+		}
+
+		float value;
+		if (!try_evaluate_constant_node(node, type_db, to_span(input_values), value)) {
+			continue;
+		}
+
+		ProgramGraph::Node &constant_node = create_node(graph, type_db, VoxelGraphFunction::NODE_CONSTANT);
+		constant_node.params[0] = value;
+
+		// Making a copy because we first need to disconnect those connections
+		const StdVector<ProgramGraph::PortLocation> output_connections = node.outputs[0].connections;
+		for (const ProgramGraph::PortLocation &dst : output_connections) {
+			graph.disconnect(ProgramGraph::PortLocation{ node_id, 0 }, dst);
+			graph.connect(ProgramGraph::PortLocation{ constant_node.id, 0 }, dst);
+		}
+
+		// Update remaps for debug tracing
+		if (remap_info != nullptr) {
+			add_remap(*remap_info, node_id, constant_node.id, 1);
+		}
+
+		// Constants that were only used by this node are left unused, they get removed afterwards
+		graph.remove_node(node_id);
+	}
+}
+
+// Removes nodes that don't contribute to any output of the graph. That includes outputs of expanded functions that
+// the graph doesn't use, and constants left behind by folding. Doing this early also reduces the work of later passes.
+// Input nodes are kept, because they get bindings even when they are not used.
+void remove_unused_nodes(ProgramGraph &graph, const NodeTypeDB &type_db) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<uint32_t> root_node_ids;
+	graph.for_each_node_const([&root_node_ids, &type_db](const ProgramGraph::Node &node) {
+		const NodeType &type = type_db.get_type(node.type_id);
+		if (type.category == pg::CATEGORY_OUTPUT || type.category == pg::CATEGORY_INPUT ||
+			type.category == pg::CATEGORY_DEBUG) {
+			root_node_ids.push_back(node.id);
+		}
+	});
+
+	StdVector<uint32_t> used_node_ids;
+	graph.find_dependencies(root_node_ids, used_node_ids);
+	if (used_node_ids.size() == graph.get_nodes_count()) {
+		return;
+	}
+
+	StdUnorderedSet<uint32_t> used_node_ids_set;
+	for (const uint32_t node_id : used_node_ids) {
+		used_node_ids_set.insert(node_id);
+	}
+
+	StdVector<uint32_t> node_ids;
+	graph.get_node_ids(node_ids);
+	for (const uint32_t node_id : node_ids) {
+		if (used_node_ids_set.find(node_id) == used_node_ids_set.end()) {
+			graph.remove_node(node_id);
+		}
+	}
+}
+
 // If the passed node corresponds to a port, adds it to the list of nodes corresponding to the port.
 bool try_add_io_node(
 		Span<const VoxelGraphFunction::Port> ports,
@@ -1203,8 +1401,12 @@ CompilationResult expand_graph(
 		return expr_expand_result;
 	}
 
-	merge_equivalences(expanded_graph, remap_info);
-	replace_simplifiable_nodes(expanded_graph, type_db, remap_info);
+	if (g_optimizations_enabled.load(std::memory_order_relaxed)) {
+		fold_constants(expanded_graph, type_db, remap_info);
+		remove_unused_nodes(expanded_graph, type_db);
+		merge_equivalences(expanded_graph, remap_info);
+		replace_simplifiable_nodes(expanded_graph, type_db, remap_info);
+	}
 	const CompilationResult input_combining_result =
 			combine_inputs(expanded_graph, input_defs, type_db, remap_info, input_node_ids);
 	if (!input_combining_result.success) {
@@ -1315,6 +1517,109 @@ uint32_t move_outer_group_operations_up(StdVector<uint32_t> &order, const Progra
 	return inner_group_start_index;
 }
 
+// Operations can only be fused when they are consecutive in execution order (see `fuse_elementwise_operations`). The
+// order found from dependencies often interleaves elementwise operations with other ones, notably when an expression
+// takes several inputs coming from other nodes. Its operations would then be split into several short runs.
+// This reorders nodes such that elementwise nodes are grouped as much as dependencies allow: ready elementwise nodes
+// are scheduled until none are left, then ready non-elementwise nodes, and so on. Nodes that don't become operations
+// (inputs, constants...) are scheduled in either phase. Otherwise, nodes keep their original relative order.
+void group_elementwise_nodes(Span<uint32_t> order, const ProgramGraph &graph, const NodeTypeDB &type_db) {
+	ZN_PROFILE_SCOPE();
+
+	enum Kind : uint8_t {
+		KIND_NO_OPERATION,
+		KIND_ELEMENTWISE,
+		KIND_OTHER,
+	};
+
+	struct Item {
+		uint32_t node_id;
+		// Connections coming from nodes of the range which are not scheduled yet
+		uint32_t pending_connections;
+		Kind kind;
+		bool scheduled;
+	};
+
+	StdVector<Item> items;
+	items.reserve(order.size());
+	StdUnorderedMap<uint32_t, uint32_t> node_id_to_item_index;
+
+	for (const uint32_t node_id : order) {
+		const ProgramGraph::Node &node = graph.get_node(node_id);
+		const NodeType &type = type_db.get_type(node.type_id);
+		Kind kind = KIND_NO_OPERATION;
+		if (type.process_buffer_func != nullptr) {
+			kind = type.is_elementwise ? KIND_ELEMENTWISE : KIND_OTHER;
+		}
+		node_id_to_item_index.insert(std::make_pair(node_id, items.size()));
+		items.push_back(Item{ node_id, 0, kind, false });
+	}
+
+	for (Item &item : items) {
+		const ProgramGraph::Node &node = graph.get_node(item.node_id);
+		for (const ProgramGraph::Port &port : node.inputs) {
+			for (const ProgramGraph::PortLocation src : port.connections) {
+				if (node_id_to_item_index.find(src.node_id) != node_id_to_item_index.end()) {
+					++item.pending_connections;
+				}
+			}
+		}
+	}
+
+	StdVector<uint32_t> new_order;
+	new_order.reserve(order.size());
+
+	Kind phase = KIND_OTHER;
+	unsigned int phases_without_progress = 0;
+
+	while (new_order.size() < items.size()) {
+		const size_t count_before_phase = new_order.size();
+
+		// Scheduling a node can make nodes found earlier ready, so scan again until nothing changes
+		bool progress = true;
+		while (progress) {
+			progress = false;
+
+			for (Item &item : items) {
+				if (item.scheduled || item.pending_connections > 0 ||
+					(item.kind != phase && item.kind != KIND_NO_OPERATION)) {
+					continue;
+				}
+
+				item.scheduled = true;
+				new_order.push_back(item.node_id);
+				progress = true;
+
+				const ProgramGraph::Node &node = graph.get_node(item.node_id);
+				for (const ProgramGraph::Port &port : node.outputs) {
+					for (const ProgramGraph::PortLocation dst : port.connections) {
+						auto it = node_id_to_item_index.find(dst.node_id);
+						if (it != node_id_to_item_index.end()) {
+							Item &dst_item = items[it->second];
+							ZN_ASSERT(dst_item.pending_connections > 0);
+							--dst_item.pending_connections;
+						}
+					}
+				}
+			}
+		}
+
+		if (new_order.size() == count_before_phase) {
+			++phases_without_progress;
+			// Can't happen if the range is in dependency order. Keep the original order if it does.
+			ZN_ASSERT_RETURN(phases_without_progress < 2);
+		} else {
+			phases_without_progress = 0;
+		}
+
+		phase = phase == KIND_OTHER ? KIND_ELEMENTWISE : KIND_OTHER;
+	}
+
+	for (unsigned int i = 0; i < new_order.size(); ++i) {
+		order[i] = new_order[i];
+	}
+}
+
 void compute_node_execution_order(
 		StdVector<uint32_t> &order,
 		const ProgramGraph &graph,
@@ -1363,6 +1668,10 @@ CompilationResult Runtime::compile_preprocessed_graph(
 
 	const uint32_t inner_group_start_index = move_outer_group_operations_up(order, graph);
 
+	// Nodes can't move across groups
+	group_elementwise_nodes(to_span(order).sub(0, inner_group_start_index), graph, type_db);
+	group_elementwise_nodes(to_span(order).sub(inner_group_start_index), graph, type_db);
+
 	struct MemoryHelper {
 		StdVector<BufferSpec> &buffer_specs;
 		unsigned int next_address = 0;
@@ -1435,6 +1744,7 @@ CompilationResult Runtime::compile_preprocessed_graph(
 		DependencyGraph::Node &dg_node = program.dependency_graph.nodes.back();
 		dg_node.is_input = true;
 		dg_node.op_address = 0;
+		dg_node.op_index = 0;
 		dg_node.first_dependency = 0;
 		dg_node.end_dependency = 0;
 		dg_node.debug_node_id = node_id;
@@ -1459,6 +1769,8 @@ CompilationResult Runtime::compile_preprocessed_graph(
 		DependencyGraph::Node &dg_node = program.dependency_graph.nodes.back();
 		dg_node.is_input = false;
 		dg_node.op_address = operations.size();
+		// Every operation is added to the default execution map
+		dg_node.op_index = program.default_execution_map.operations.size();
 		dg_node.first_dependency = program.dependency_graph.dependencies.size();
 		dg_node.end_dependency = dg_node.first_dependency;
 		dg_node.debug_node_id = node_id;
@@ -1520,8 +1832,12 @@ CompilationResult Runtime::compile_preprocessed_graph(
 		if (order_index == inner_group_start_index) {
 			program.default_execution_map.inner_group_start_index = program.default_execution_map.operations.size();
 		}
-		program.default_execution_map.operations.push_back(ExecutionMap::OperationInfo{ uint16_t(operations.size()), 0 }
-		);
+		{
+			ExecutionMap::OperationInfo op_info;
+			op_info.address = operations.size();
+			op_info.index = program.default_execution_map.operations.size();
+			program.default_execution_map.operations.push_back(op_info);
+		}
 		if (debug) {
 			// Will be remapped later if the node is an expanded one
 			program.default_execution_map.debug_nodes.push_back(node_id);
@@ -1708,6 +2024,11 @@ CompilationResult Runtime::compile_preprocessed_graph(
 				ZN_ASSERT(address_it != program.output_port_addresses.end());
 				BufferSpec &src_buffer_spec = buffer_specs[address_it->second];
 				src_buffer_spec.is_pinned = true;
+
+				if (!src_buffer_spec.is_binding && !src_buffer_spec.is_constant &&
+					!contains(to_span_const(program.outer_group_output_addresses), src_buffer_spec.address)) {
+					program.outer_group_output_addresses.push_back(src_buffer_spec.address);
+				}
 			}
 		}
 	}
@@ -1843,6 +2164,9 @@ CompilationResult Runtime::compile_preprocessed_graph(
 		program.buffer_data_count = data_helper.datas.size();
 	}
 
+	decode_operations(program);
+	fuse_elementwise_operations(program.default_execution_map, to_span_const(program.operations));
+
 	ZN_PRINT_VERBOSE(
 			format("Compiled voxel graph. Program size: {}b, ports: {}, buffers: {}",
 				   program.operations.size() * sizeof(uint16_t),
@@ -1855,4 +2179,46 @@ CompilationResult Runtime::compile_preprocessed_graph(
 	return result;
 }
 
+// Each operation normally runs over entire buffers, which means every intermediate result gets written to memory and
+// read back by the next operation. When a graph is large, that traffic dominates over actual computations. Chains of
+// elementwise operations can instead run chunk by chunk, which keeps intermediate values in cache. Only node types
+// flagged with `is_elementwise` are considered.
+void Runtime::fuse_elementwise_operations(ExecutionMap &execution_map, Span<const uint16_t> operations) {
+	const NodeTypeDB &type_db = NodeTypeDB::get_singleton();
+	Span<ExecutionMap::OperationInfo> operation_infos = to_span(execution_map.operations);
+
+	struct L {
+		static bool is_elementwise(const NodeTypeDB &type_db, Span<const uint16_t> operations, uint16_t op_address) {
+			const uint16_t opid = operations[op_address];
+			return type_db.get_type(opid).is_elementwise;
+		}
+	};
+
+	unsigned int begin_index = 0;
+	while (begin_index < operation_infos.size()) {
+		ExecutionMap::OperationInfo &begin_info = operation_infos[begin_index];
+		begin_info.fused_count = 0;
+
+		if (!L::is_elementwise(type_db, operations, begin_info.address)) {
+			++begin_index;
+			continue;
+		}
+
+		unsigned int end_index = begin_index + 1;
+		// Groups must not span across the start of the inner group, because the outer group can be skipped
+		while (end_index < operation_infos.size() && end_index != execution_map.inner_group_start_index &&
+			   end_index - begin_index < std::numeric_limits<uint16_t>::max() &&
+			   L::is_elementwise(type_db, operations, operation_infos[end_index].address)) {
+			operation_infos[end_index].fused_count = 0;
+			++end_index;
+		}
+
+		if (end_index - begin_index > 1) {
+			begin_info.fused_count = end_index - begin_index;
+		}
+
+		begin_index = end_index;
+	}
+}
+
 } // namespace zylann::voxel::pg
@@ -37,6 +37,11 @@ CompilationResult expand_graph(
 		GraphRemappingInfo *remap_info
 );
 
+// Rewrites done by `expand_graph` (constant folding, removal of unused nodes, merging of equivalent nodes and node
+// simplifications) can be turned off. Graphs then compute the same results with more work, which is only useful to
+// test that these rewrites don't change results.
+void set_optimizations_enabled(bool enabled);
+
 // Functions usable by node implementations during the compilation stage
 class CompileContext {
 public:
@@ -75,6 +75,10 @@ const Runtime::ExecutionMap &Runtime::get_default_execution_map() const {
 	return _program.default_execution_map;
 }
 
+Span<const uint16_t> Runtime::get_outer_group_output_addresses() const {
+	return to_span(_program.outer_group_output_addresses);
+}
+
 // Generates a list of adresses for the operations to execute,
 // skipping those that are deemed constant by the last range analysis.
 // If a non-constant operation only contributes to a constant one, it will also be skipped.
@@ -234,8 +238,13 @@ void Runtime::generate_optimized_execution_map(
 					inner_group_start_not_assigned = false;
 				}
 
-				execution_map.operations.push_back(
-						ExecutionMap::OperationInfo{ node.op_address, uint16_t(tls_constant_fills.size()) });
+				{
+					ExecutionMap::OperationInfo op_info;
+					op_info.address = node.op_address;
+					op_info.constant_fill_count = tls_constant_fills.size();
+					op_info.index = node.op_index;
+					execution_map.operations.push_back(op_info);
+				}
 
 				// TODO Only do constant fills that actually get used
 				// The following approach isn't optimal. If 50% of a graph gets skipped and the remaining nodes don't
@@ -256,6 +265,8 @@ void Runtime::generate_optimized_execution_map(
 				break;
 		}
 	}
+
+	fuse_elementwise_operations(execution_map, operations);
 }
 
 void Runtime::generate_single(State &state, Span<float> inputs, const ExecutionMap *execution_map) const {
@@ -386,6 +397,10 @@ void Runtime::prepare_state(State &state, unsigned int buffer_size, bool with_pr
 
 namespace {
 
+// How many values are processed at once by each operation when running fused operations. Small enough for
+// intermediate values to stay in L1 cache, large enough to amortize the cost of calling each operation.
+const unsigned int FUSED_CHUNK_SIZE = 128;
+
 inline Span<const uint8_t> read_params(Span<const uint16_t> operations, unsigned int &pc) {
 	const uint16_t params_size_in_words = operations[pc];
 	++pc;
@@ -459,27 +474,46 @@ void Runtime::generate_set(
 		L::bind_buffer(buffers, _program.inputs[i].buffer_address, p_inputs[i]);
 	}
 
-	const Span<const uint16_t> operations(_program.operations.data(), 0, _program.operations.size());
+	const Span<const DecodedOperation> decoded_operations = to_span(_program.decoded_operations);
 
 	const ExecutionMap &execution_map = p_execution_map != nullptr ? *p_execution_map : _program.default_execution_map;
 	Span<const ExecutionMap::OperationInfo> operation_infos = to_span(execution_map.operations);
 	const Span<const ExecutionMap::ConstantFill> constant_fills = to_span(execution_map.constant_fills);
 
+	unsigned int constant_fill_index = 0;
+
 	if (skip_outer_group && operation_infos.size() > 0) {
 		const unsigned int offset = execution_map.inner_group_start_index;
+		// Constant fills of skipped operations must be skipped too
+		for (unsigned int i = 0; i < offset; ++i) {
+			constant_fill_index += operation_infos[i].constant_fill_count;
+		}
 		operation_infos = operation_infos.sub(offset);
 	}
 
+	// Fusion only pays off when buffers are larger than a chunk
+	bool allow_fusion = state.buffer_size > FUSED_CHUNK_SIZE;
+
 #ifdef TOOLS_ENABLED
 	ProfilingClock profiling_clock;
 	const bool profile = state.debug_profiler_times.size() > 0;
+	// Fused operations can't be timed individually
+	allow_fusion = allow_fusion && !profile;
 #endif
 
-	unsigned int constant_fill_index = 0;
-
 	for (unsigned int execution_map_index = 0; execution_map_index < operation_infos.size(); ++execution_map_index) {
 		const ExecutionMap::OperationInfo op_info = operation_infos[execution_map_index];
 
+		if (allow_fusion && op_info.fused_count > 1) {
+			const Span<const ExecutionMap::OperationInfo> fused_infos =
+					operation_infos.sub(execution_map_index, op_info.fused_count);
+			generate_fused_operations(
+					state, fused_infos, constant_fills, constant_fill_index, p_execution_map != nullptr
+			);
+			execution_map_index += op_info.fused_count - 1;
+			continue;
+		}
+
 		for (unsigned int i = 0; i < op_info.constant_fill_count; ++i) {
 			const ExecutionMap::ConstantFill &cf = constant_fills[constant_fill_index];
 			ZN_ASSERT(cf.data != nullptr);
@@ -489,25 +523,12 @@ void Runtime::generate_set(
 			++constant_fill_index;
 		}
 
-		unsigned int pc = op_info.address;
-
-		const uint16_t opid = operations[pc++];
-		const NodeType &node_type = NodeTypeDB::get_singleton().get_type(opid);
-
-		const uint32_t inputs_count = node_type.inputs.size();
-		const uint32_t outputs_count = node_type.outputs.size();
-
-		const Span<const uint16_t> op_inputs = operations.sub(pc, inputs_count);
-		pc += inputs_count;
-		const Span<const uint16_t> op_outputs = operations.sub(pc, outputs_count);
-		pc += outputs_count;
-
-		Span<const uint8_t> op_params = read_params(operations, pc);
+		const DecodedOperation &op = decoded_operations[op_info.index];
 
 		// TODO Buffers will stay bound if this error occurs!
-		ZN_ASSERT_RETURN(node_type.process_buffer_func != nullptr);
-		ProcessBufferContext ctx(op_inputs, op_outputs, op_params, buffers, p_execution_map != nullptr);
-		node_type.process_buffer_func(ctx);
+		ZN_ASSERT_RETURN(op.process_buffer_func != nullptr);
+		ProcessBufferContext ctx(op.inputs, op.outputs, op.params, buffers, p_execution_map != nullptr);
+		op.process_buffer_func(ctx);
 
 #ifdef TOOLS_ENABLED
 		if (profile) {
@@ -524,6 +545,91 @@ void Runtime::generate_set(
 	}
 }
 
+void Runtime::generate_fused_operations(
+		State &state,
+		Span<const ExecutionMap::OperationInfo> operation_infos,
+		Span<const ExecutionMap::ConstantFill> constant_fills,
+		unsigned int &constant_fill_index,
+		bool using_execution_map
+) const {
+	struct FusedOperation {
+		const DecodedOperation *op;
+		uint16_t constant_fill_count;
+	};
+
+	struct BufferView {
+		Buffer *buffer;
+		float *data;
+		unsigned int size;
+	};
+
+	static thread_local StdVector<FusedOperation> tls_operations;
+	static thread_local StdVector<BufferView> tls_buffer_views;
+	tls_operations.clear();
+	tls_buffer_views.clear();
+
+	Span<Buffer> buffers = to_span(state.buffers);
+
+	// Remember the full extent of every buffer used by operations. Buffers may appear multiple times, which is fine
+	// since they are all saved before being modified.
+	for (const ExecutionMap::OperationInfo &op_info : operation_infos) {
+		const DecodedOperation &op = _program.decoded_operations[op_info.index];
+		ZN_ASSERT(op.process_buffer_func != nullptr);
+
+		tls_operations.push_back(FusedOperation{ &op, op_info.constant_fill_count });
+
+		for (const uint16_t address : op.inputs) {
+			Buffer &buffer = buffers[address];
+			tls_buffer_views.push_back(BufferView{ &buffer, buffer.data, buffer.size });
+		}
+		for (const uint16_t address : op.outputs) {
+			Buffer &buffer = buffers[address];
+			tls_buffer_views.push_back(BufferView{ &buffer, buffer.data, buffer.size });
+		}
+	}
+
+	// Operations are run in the same order for every value, so values of buffers sharing the same data are still
+	// written and read in the same order as if each operation had processed the whole buffer.
+	const unsigned int buffer_size = state.buffer_size;
+	unsigned int chunk_constant_fill_index = constant_fill_index;
+
+	for (unsigned int chunk_begin = 0; chunk_begin < buffer_size; chunk_begin += FUSED_CHUNK_SIZE) {
+		const unsigned int chunk_size = math::min(FUSED_CHUNK_SIZE, buffer_size - chunk_begin);
+
+		for (const BufferView &view : tls_buffer_views) {
+			// Constants not requiring a buffer have no data
+			if (view.data != nullptr) {
+				view.buffer->data = view.data + chunk_begin;
+			}
+			view.buffer->size = chunk_size;
+		}
+
+		chunk_constant_fill_index = constant_fill_index;
+
+		for (const FusedOperation &fused_op : tls_operations) {
+			for (unsigned int i = 0; i < fused_op.constant_fill_count; ++i) {
+				const ExecutionMap::ConstantFill &cf = constant_fills[chunk_constant_fill_index];
+				ZN_ASSERT(cf.data != nullptr);
+				for (unsigned int j = chunk_begin; j < chunk_begin + chunk_size; ++j) {
+					cf.data[j] = cf.value;
+				}
+				++chunk_constant_fill_index;
+			}
+
+			const DecodedOperation &op = *fused_op.op;
+			ProcessBufferContext ctx(op.inputs, op.outputs, op.params, buffers, using_execution_map);
+			op.process_buffer_func(ctx);
+		}
+	}
+
+	constant_fill_index = chunk_constant_fill_index;
+
+	for (const BufferView &view : tls_buffer_views) {
+		view.buffer->data = view.data;
+		view.buffer->size = view.size;
+	}
+}
+
 void Runtime::analyze_range(State &state, Span<math::Interval> p_inputs) const {
 	ZN_PROFILE_SCOPE();
 
@@ -546,34 +652,49 @@ void Runtime::analyze_range(State &state, Span<math::Interval> p_inputs) const {
 		ranges[bi] = p_inputs[i];
 	}
 
-	const Span<const uint16_t> operations(_program.operations.data(), 0, _program.operations.size());
-
 	// Here operations must all be analyzed, because we do this as a broad-phase.
 	// Only narrow-phase may skip some operations eventually.
+	for (const DecodedOperation &op : _program.decoded_operations) {
+		ZN_ASSERT_RETURN(op.range_analysis_func != nullptr);
+		RangeAnalysisContext ctx(op.inputs, op.outputs, op.params, ranges, buffers);
+		op.range_analysis_func(ctx);
+	}
+}
+
+void Runtime::decode_operations(Program &program) {
+	const Span<const uint16_t> operations = to_span_const(program.operations);
+	const NodeTypeDB &type_db = NodeTypeDB::get_singleton();
+
+	program.decoded_operations.clear();
+
 	uint32_t pc = 0;
 	while (pc < operations.size()) {
 		const uint16_t opid = operations[pc++];
-		const NodeType &node_type = NodeTypeDB::get_singleton().get_type(opid);
+		const NodeType &node_type = type_db.get_type(opid);
 
 		const uint32_t inputs_count = node_type.inputs.size();
 		const uint32_t outputs_count = node_type.outputs.size();
 
-		const Span<const uint16_t> op_inputs = operations.sub(pc, inputs_count);
+		DecodedOperation op;
+		op.process_buffer_func = node_type.process_buffer_func;
+		op.range_analysis_func = node_type.range_analysis_func;
+		op.inputs = operations.sub(pc, inputs_count);
 		pc += inputs_count;
-		const Span<const uint16_t> op_outputs = operations.sub(pc, outputs_count);
+		op.outputs = operations.sub(pc, outputs_count);
 		pc += outputs_count;
-
-		Span<const uint8_t> op_params = read_params(operations, pc);
-
-		ZN_ASSERT_RETURN(node_type.range_analysis_func != nullptr);
-		RangeAnalysisContext ctx(op_inputs, op_outputs, op_params, ranges, buffers);
-		node_type.range_analysis_func(ctx);
+		op.params = read_params(operations, pc);
 
 #ifdef VOXEL_DEBUG_GRAPH_PROG_SENTINEL
 		// If this fails, the program is ill-formed
-		ZN_ASSERT(read<uint16_t>(_program, pc) == VOXEL_DEBUG_GRAPH_PROG_SENTINEL);
+		ZN_ASSERT(operations[pc] == VOXEL_DEBUG_GRAPH_PROG_SENTINEL);
+		++pc;
 #endif
+
+		program.decoded_operations.push_back(op);
 	}
+
+	// Operations are indexed the same way in the default execution map
+	ZN_ASSERT(program.decoded_operations.size() == program.default_execution_map.operations.size());
 }
 
 #ifdef DEBUG_ENABLED
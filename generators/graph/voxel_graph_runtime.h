@@ -83,6 +83,12 @@ public:
 			uint16_t address = 0;
 			// How many constant fills to execute before this operation.
 			uint16_t constant_fill_count = 0;
+			// If greater than 1, this operation and the next ones up to that count are elementwise, and can be run
+			// together over small chunks of their buffers, so intermediate values stay in cache instead of being
+			// written to and read back from memory. Only set on the first operation of such a group.
+			uint16_t fused_count = 0;
+			// Index of the operation in the program, used to get its pre-decoded form.
+			uint16_t index = 0;
 		};
 
 		StdVector<OperationInfo> operations;
@@ -261,6 +267,10 @@ public:
 
 	const ExecutionMap &get_default_execution_map() const;
 
+	// Gets addresses of buffers computed by the outer group which are used by the inner group. After running the outer
+	// group once, restoring their values is enough to run the inner group with `skip_outer_group`.
+	Span<const uint16_t> get_outer_group_output_addresses() const;
+
 	// Gets the buffer address of a specific output port
 	bool try_get_output_port_address(ProgramGraph::PortLocation port, uint16_t &out_address) const;
 
@@ -402,6 +412,20 @@ private:
 
 	bool is_operation_constant(const State &state, uint16_t op_address) const;
 
+	// Fills `decoded_operations` once all operations of the program have been written.
+	static void decode_operations(Program &program);
+
+	// Finds groups of consecutive elementwise operations in the execution map, which can be run chunk by chunk.
+	static void fuse_elementwise_operations(ExecutionMap &execution_map, Span<const uint16_t> operations);
+
+	void generate_fused_operations(
+			State &state,
+			Span<const ExecutionMap::OperationInfo> operation_infos,
+			Span<const ExecutionMap::ConstantFill> constant_fills,
+			unsigned int &constant_fill_index,
+			bool using_execution_map
+	) const;
+
 	struct BufferSpec {
 		// Index the buffer should be stored at
 		uint16_t address = 0;
@@ -431,6 +455,8 @@ private:
 			uint16_t first_dependency;
 			uint16_t end_dependency;
 			uint16_t op_address;
+			// Index of the operation in the program. Only relevant if the node is not an input.
+			uint16_t op_index;
 			bool is_input;
 			// Node ID from the expanded ProgramGraph (non user-provided, so may need remap)
 			uint32_t debug_node_id;
@@ -447,6 +473,16 @@ private:
 		}
 	};
 
+	// Operation from `Program::operations`, decoded once after compilation so running the program doesn't have to
+	// parse operations and look up their node type every time.
+	struct DecodedOperation {
+		ProcessBufferFunc process_buffer_func = nullptr;
+		RangeAnalysisFunc range_analysis_func = nullptr;
+		Span<const uint16_t> inputs;
+		Span<const uint16_t> outputs;
+		Span<const uint8_t> params;
+	};
+
 	// Compiled program data.
 	// Remains constant and read-only after compilation.
 	struct Program {
@@ -466,6 +502,9 @@ private:
 		// It's better to have it ordered because memory access will be more predictable.
 		StdVector<uint16_t> operations;
 
+		// Same operations as above in the same order, but ready to run. They point to data inside `operations`.
+		StdVector<DecodedOperation> decoded_operations;
+
 		// Describes dependencies between operations. It is generated at compile time.
 		// It is used to perform dynamic optimization in case some operations can be predicted as constant.
 		DependencyGraph dependency_graph;
@@ -491,6 +530,10 @@ private:
 		// cases.
 		uint32_t inner_group_start_op_index;
 
+		// Addresses of buffers written by the outer group and read by the inner group. Their values only depend on
+		// outer group inputs, so they may be re-used for other queries with the same outer group inputs.
+		StdVector<uint16_t> outer_group_output_addresses;
+
 		StdVector<InputInfo> inputs;
 
 		FixedArray<OutputInfo, MAX_OUTPUTS> outputs;
@@ -518,6 +561,7 @@ private:
 
 		void clear() {
 			operations.clear();
+			decoded_operations.clear();
 			buffer_specs.clear();
 			inner_group_start_op_index = 0;
 			default_execution_map.clear();
@@ -525,6 +569,7 @@ private:
 			user_port_to_expanded_port.clear();
 			expanded_node_id_to_user_node_id.clear();
 			dependency_graph.clear();
+			outer_group_output_addresses.clear();
 			inputs.clear();
 			outputs_count = 0;
 			compilation_result = CompilationResult();
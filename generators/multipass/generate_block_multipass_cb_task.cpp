@@ -207,7 +207,7 @@ void GenerateBlockMultipassCBTask::run_stream_saving_and_finish() {
 					_volume_id, _block_position, _lod_index, voxels_copy, _stream_dependency, nullptr, false
 			));
 
-			VoxelEngine::get_singleton().push_async_io_task(save_task);
+			VoxelEngine::get_singleton().push_async_task(save_task);
 		}
 	}
 
@@ -223,6 +223,10 @@ TaskPriority GenerateBlockMultipassCBTask::get_priority() {
 	return p;
 }
 
+int GenerateBlockMultipassCBTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(_volume_id);
+}
+
 bool GenerateBlockMultipassCBTask::is_cancelled() {
 	if (_stream_dependency->valid == false) {
 		return true;
@@ -1,6 +1,7 @@
 #ifndef VOXEL_GENERATE_BLOCK_MULTIPASS_CB_TASK_H
 #define VOXEL_GENERATE_BLOCK_MULTIPASS_CB_TASK_H
 
+#include "../../constants/voxel_constants.h"
 #include "../../engine/ids.h"
 #include "../../engine/priority_dependency.h"
 #include "../../engine/streaming_dependency.h"
@@ -24,9 +25,14 @@ public:
 		return "GenerateBlockMultipassCBTask";
 	}
 
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_GENERATE;
+	}
+
 	void run(ThreadedTaskContext &ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 	void apply_result() override;
 
 	// Not an input, but can be assigned a re-usable instance to avoid allocating one in the task
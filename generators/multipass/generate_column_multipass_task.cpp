@@ -5,10 +5,14 @@
 #include "../../util/containers/std_vector.h"
 #include "../../util/dstack.h"
 #include "../../util/godot/classes/time.h"
+#include "../../util/math/funcs.h"
 #include "../../util/string/format.h"
+#include "../../util/thread/thread.h"
 
 namespace zylann::voxel {
 
+using namespace VoxelGeneratorMultipassCBStructs;
+
 namespace {
 #ifdef ZN_PROFILER_ENABLED
 std::atomic_int g_task_count[VoxelGeneratorMultipassCB::MAX_SUBPASSES] = { 0 };
@@ -23,9 +27,69 @@ const char *g_profiling_task_names[VoxelGeneratorMultipassCB::MAX_SUBPASSES] = {
 };
 #endif
 
-} // namespace
+// Runs the first pass on vertical slices of a column. Slices don't depend on each other, because the first pass has no
+// dependencies, so several threads can take slices until there are none left.
+struct FirstPassSlices {
+	Ref<VoxelGeneratorMultipassCB> generator;
+	// Blocks of the column, from bottom to top
+	StdVector<Block *> blocks;
+	Vector2i column_position;
+	int column_base_y_blocks;
+	int slice_height_blocks;
+	unsigned int slice_count;
+	uint8_t block_size;
+	std::atomic_uint32_t next_slice_index = { 0 };
+	std::atomic_uint32_t completed_slice_count = { 0 };
+
+	// Returns once all slices were taken. Slices taken by other threads may still be running.
+	void run_remaining_slices() {
+		for (unsigned int slice_index = next_slice_index++; slice_index < slice_count;
+			 slice_index = next_slice_index++) {
+			run_slice(slice_index);
+			++completed_slice_count;
+		}
+	}
 
-using namespace VoxelGeneratorMultipassCBStructs;
+	void run_slice(unsigned int slice_index) {
+		ZN_PROFILE_SCOPE();
+		const unsigned int begin = slice_index * slice_height_blocks;
+		const unsigned int end = math::min(begin + slice_height_blocks, static_cast<unsigned int>(blocks.size()));
+		const int slice_base_y_blocks = column_base_y_blocks + begin;
+
+		PassInput input;
+		input.grid = to_span(blocks).sub(begin, end - begin);
+		input.grid_size = Vector3i(1, end - begin, 1);
+		input.grid_origin = Vector3i(column_position.x, slice_base_y_blocks, column_position.y);
+		input.main_block_position = input.grid_origin;
+		input.pass_index = 0;
+		input.block_size = block_size;
+
+		generator->generate_pass(input);
+	}
+};
+
+// Helps the task generating a column to run its slices
+class GenerateFirstPassSlicesTask : public IThreadedTask {
+public:
+	std::shared_ptr<FirstPassSlices> slices;
+	TaskPriority priority;
+
+	const char *get_debug_name() const override {
+		return "GenerateFirstPassSlices";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		// Does nothing if all slices were taken already
+		slices->run_remaining_slices();
+	}
+
+	TaskPriority get_priority() override {
+		return priority;
+	}
+};
+
+} // namespace
 
 GenerateColumnMultipassTask::GenerateColumnMultipassTask(
 		Vector2i p_column_position,
@@ -104,6 +168,7 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 				// Unregister task from the column
 				Column &column = column_it->second;
 				column.pending_subpass_tasks_mask &= ~(1 << _subpass_index);
+				schedule_waiting_tasks(column, task_scheduler);
 
 				if (_subpass_index == final_subpass_index) {
 					// Schedule pending block requests to make them handle cancellation
@@ -180,6 +245,8 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 
 		bool spawned_subtasks = false;
 		bool postpone = false;
+		// Column on which a task is pending to process one of our dependencies
+		Column *waited_column = nullptr;
 
 		// Check loading levels
 		{
@@ -198,6 +265,7 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 
 					if (main_column != nullptr) {
 						main_column->pending_subpass_tasks_mask &= ~(1 << _subpass_index);
+						schedule_waiting_tasks(*main_column, task_scheduler);
 
 						if (_subpass_index == final_subpass_index) {
 							// Schedule pending block requests to make them handle cancellation
@@ -226,18 +294,18 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 
 						if (column->loading) {
 							// A task is pending to work on the dependency, so we wait.
-							// TODO Ideally we should subscribe to the completion of that task.
+							// TODO Subscribe to the completion of loading tasks, once they are implemented
 							// println(format("O {} {} {} {} {}", int(_subpass_index), _column_position.x, 0,
 							// 		_column_position.y, Time::get_singleton()->get_ticks_usec()));
 							postpone = true;
 
 						} else if ((column->pending_subpass_tasks_mask & (1 << prev_subpass_index)) != 0) {
-							// A task is pending to work on the dependency, so we wait.
-							// TODO Ideally we should subscribe to the completion of that task.
-							// We can do that
+							// A task is pending to work on the dependency, so we wait for it to finish.
 							// println(format("O {} {} {} {} {}", int(_subpass_index), _column_position.x, 0,
 							// 		_column_position.y, Time::get_singleton()->get_ticks_usec()));
-							postpone = true;
+							if (waited_column == nullptr) {
+								waited_column = column;
+							}
 
 						} else {
 							// No task is pending to work on the dependency, spawn one.
@@ -279,12 +347,23 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 		}
 
 		if (spawned_subtasks) {
+			// We will be scheduled again when all subtasks are done. If we were also waiting for other tasks, we will
+			// re-check them at that point.
 			ctx.status = ThreadedTaskContext::STATUS_TAKEN_OUT;
 
 		} else if (postpone) {
 			ctx.status = ThreadedTaskContext::STATUS_POSTPONED;
 			return;
 
+		} else if (waited_column != nullptr) {
+			// Instead of polling until the dependency is ready, subscribe to the completion of the task working on
+			// it. We don't need to wait on every column: when we get scheduled again, all dependencies are checked
+			// again, and we will wait on the next one if necessary.
+			// This is thread-safe because the task working on that column has to lock it, which we are doing too.
+			waited_column->waiting_tasks.push_back(this);
+			ctx.status = ThreadedTaskContext::STATUS_TAKEN_OUT;
+			return;
+
 		} else {
 			ZN_PROFILE_SCOPE_NAMED("Run pass");
 			// We can run the pass
@@ -327,22 +406,41 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 						}
 					}
 
-					PassInput input;
-					input.grid = to_span(blocks);
-					input.grid_size = Vector3i(neighbors_box.size.x, column_height_blocks, neighbors_box.size.y);
-					input.grid_origin =
-							Vector3i(neighbors_box.position.x, column_base_y_blocks, neighbors_box.position.y);
-					input.main_block_position = Vector3i(_column_position.x, column_base_y_blocks, _column_position.y);
-					input.pass_index = pass_index;
-					input.block_size = _block_size;
-
-					// This should be the ONLY place where `_generator` is used.
-					_generator->generate_pass(input);
+					const int slice_height_blocks = _generator_internal->first_pass_slice_height_blocks;
+
+					if (pass_index == 0 && slice_height_blocks > 0 && column_height_blocks > slice_height_blocks) {
+						// The first pass only has the main column
+						run_first_pass_in_slices(std::move(blocks), slice_height_blocks);
+
+					} else {
+						PassInput input;
+						input.grid = to_span(blocks);
+						input.grid_size = Vector3i(neighbors_box.size.x, column_height_blocks, neighbors_box.size.y);
+						input.grid_origin =
+								Vector3i(neighbors_box.position.x, column_base_y_blocks, neighbors_box.position.y);
+						input.main_block_position =
+								Vector3i(_column_position.x, column_base_y_blocks, _column_position.y);
+						input.pass_index = pass_index;
+						input.block_size = _block_size;
+
+						// This and slices of the first pass should be the ONLY places where `_generator` is used.
+						_generator->generate_pass(input);
+					}
 				}
 
 				// Update levels
 				main_column->subpass_index = _subpass_index;
 
+				if (_subpass_index == final_subpass_index) {
+					// Generation no longer modifies finished columns, but they can remain in the cache for a long time
+					// while neighbors are generating, so we compress them.
+					ZN_PROFILE_SCOPE_NAMED("Compress column");
+					for (Block &block : main_column->blocks) {
+						block.voxels.compress_uniform_channels();
+						block.voxels.compress_palette_channels();
+					}
+				}
+
 				// for (Column *column : columns) {
 				// 	column->subpass_iterations[_subpass_index]++;
 				// }
@@ -353,6 +451,8 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 			}
 
 			main_column->pending_subpass_tasks_mask &= ~(1 << _subpass_index);
+			// Tasks waiting for this column can now proceed
+			schedule_waiting_tasks(*main_column, task_scheduler);
 
 			if (main_column->subpass_index == final_subpass_index) {
 				// All tasks that were waiting for this column to be complete (and did not spawn column subtasks
@@ -369,6 +469,40 @@ void GenerateColumnMultipassTask::run(ThreadedTaskContext &ctx) {
 	task_scheduler.flush();
 }
 
+// Must be called while the column is locked. Doesn't return until all slices are done, so other threads can't access
+// blocks of the column after it gets unlocked.
+void GenerateColumnMultipassTask::run_first_pass_in_slices(StdVector<Block *> &&blocks, int slice_height_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	std::shared_ptr<FirstPassSlices> slices = make_shared_instance<FirstPassSlices>();
+	slices->generator = _generator;
+	slices->column_position = _column_position;
+	slices->column_base_y_blocks = _generator_internal->column_base_y_blocks;
+	slices->slice_height_blocks = slice_height_blocks;
+	slices->slice_count = (blocks.size() + slice_height_blocks - 1) / slice_height_blocks;
+	slices->block_size = _block_size;
+	slices->blocks = std::move(blocks);
+
+	// Not using the buffered scheduler, because it only flushes after the current task
+	StdVector<IThreadedTask *> helper_tasks;
+	helper_tasks.reserve(slices->slice_count - 1);
+	for (unsigned int i = 1; i < slices->slice_count; ++i) {
+		GenerateFirstPassSlicesTask *task = ZN_NEW(GenerateFirstPassSlicesTask);
+		task->slices = slices;
+		task->priority = _priority;
+		helper_tasks.push_back(task);
+	}
+	VoxelEngine::get_singleton().push_async_tasks(to_span(helper_tasks));
+
+	// The current thread works too, so slices still progress if all other threads are busy
+	slices->run_remaining_slices();
+
+	// Remaining slices were taken by threads which are running them, so this only waits for them to finish
+	while (slices->completed_slice_count < slices->slice_count) {
+		Thread::sleep_usec(50);
+	}
+}
+
 void GenerateColumnMultipassTask::schedule_final_block_tasks(Column &column, BufferedTaskScheduler &task_scheduler) {
 	for (Block &block : column.blocks) {
 		if (block.final_pending_task != nullptr) {
@@ -379,6 +513,14 @@ void GenerateColumnMultipassTask::schedule_final_block_tasks(Column &column, Buf
 	}
 }
 
+void GenerateColumnMultipassTask::schedule_waiting_tasks(Column &column, BufferedTaskScheduler &task_scheduler) {
+	for (IThreadedTask *task : column.waiting_tasks) {
+		ZN_ASSERT(task != this);
+		task_scheduler.push_main_task(task);
+	}
+	column.waiting_tasks.clear();
+}
+
 void GenerateColumnMultipassTask::return_to_caller(bool success) {
 	ZN_ASSERT(_caller_task != nullptr);
 	ZN_ASSERT(_caller_task_dependency_counter != nullptr);
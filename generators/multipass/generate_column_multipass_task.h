@@ -13,7 +13,8 @@ class BufferedTaskScheduler;
 // If at least one column isn't found in the map, the task is cancelled, and so should be all its callers.
 // Otherwise:
 // If a column doesn't fulfills dependency requirements:
-//     - If another task is working on that column, the current task is postponed to run later.
+//     - If another task is working on that column, the current task is taken out and registered in that column, so
+//       it gets scheduled again when the other task finishes.
 //     - Otherwise, a subtask is spawned to work on the dependency.
 //       The current task is queued after every subtask spawned this way.
 // Otherwise, the task runs the pass, re-schedules its caller, and returns.
@@ -53,10 +54,18 @@ public:
 	// bool is_cancelled() {}
 
 private:
+	void run_first_pass_in_slices(
+			StdVector<VoxelGeneratorMultipassCBStructs::Block *> &&blocks,
+			int slice_height_blocks
+	);
 	void schedule_final_block_tasks(
 			VoxelGeneratorMultipassCBStructs::Column &column,
 			BufferedTaskScheduler &task_scheduler
 	);
+	void schedule_waiting_tasks(
+			VoxelGeneratorMultipassCBStructs::Column &column,
+			BufferedTaskScheduler &task_scheduler
+	);
 	void return_to_caller(bool success);
 
 	Vector2i _column_position;
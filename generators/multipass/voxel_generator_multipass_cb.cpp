@@ -130,6 +130,21 @@ void VoxelGeneratorMultipassCB::set_column_height_blocks(int new_height) {
 	re_initialize_column_refcounts();
 }
 
+int VoxelGeneratorMultipassCB::get_first_pass_slice_height_blocks() const {
+	return get_internal()->first_pass_slice_height_blocks;
+}
+
+void VoxelGeneratorMultipassCB::set_first_pass_slice_height_blocks(int new_height) {
+	new_height = math::clamp(new_height, 0, MAX_COLUMN_HEIGHT_BLOCKS);
+	if (get_first_pass_slice_height_blocks() == new_height) {
+		return;
+	}
+	reset_internal([new_height](Internal &internal) { //
+		internal.first_pass_slice_height_blocks = new_height;
+	});
+	re_initialize_column_refcounts();
+}
+
 int VoxelGeneratorMultipassCB::get_pass_extent_blocks(int pass_index) const {
 	std::shared_ptr<Internal> internal = get_internal();
 	ZN_ASSERT_RETURN_V(pass_index >= 0 && pass_index < int(internal->passes.size()), 0);
@@ -330,6 +345,11 @@ void VoxelGeneratorMultipassCB::process_viewer_diff_internal(Box3i p_requested_b
 							block.final_pending_task = nullptr;
 						}
 					}
+					// Same for column tasks waiting on this column
+					for (IThreadedTask *task : column.waiting_tasks) {
+						task_scheduler.push_main_task(task);
+					}
+					column.waiting_tasks.clear();
 
 					// TODO Implement saving tasks
 					// We remove immediately for now
@@ -408,6 +428,54 @@ bool VoxelGeneratorMultipassCB::debug_try_get_column_states(StdVector<DebugColum
 	return true;
 }
 
+VoxelGeneratorMultipassCB::CacheStats VoxelGeneratorMultipassCB::get_cache_stats() const {
+	ZN_PROFILE_SCOPE();
+
+	CacheStats stats;
+	fill(stats.column_count_per_subpass, 0u);
+
+	std::shared_ptr<Internal> internal = get_internal();
+	Map &map = internal->map;
+
+	SpatialLock2D::Read srlock(map.spatial_lock, BoxBounds2i::from_everywhere());
+	MutexLock mlock(map.mutex);
+
+	for (auto it = map.columns.begin(); it != map.columns.end(); ++it) {
+		const Column &column = it->second;
+
+		++stats.column_count;
+		if (column.subpass_index < 0) {
+			++stats.empty_column_count;
+		} else if (column.subpass_index < MAX_SUBPASSES) {
+			++stats.column_count_per_subpass[column.subpass_index];
+		}
+
+		for (const Block &block : column.blocks) {
+			stats.memory_usage_bytes += block.voxels.get_channels_size_in_bytes();
+		}
+	}
+
+	return stats;
+}
+
+Dictionary VoxelGeneratorMultipassCB::_b_get_cache_stats() const {
+	const CacheStats stats = get_cache_stats();
+
+	const int subpass_count = get_subpass_count_from_pass_count(get_pass_count());
+	PackedInt32Array column_count_per_subpass;
+	column_count_per_subpass.resize(subpass_count);
+	for (int i = 0; i < subpass_count; ++i) {
+		column_count_per_subpass.set(i, stats.column_count_per_subpass[i]);
+	}
+
+	Dictionary d;
+	d["column_count"] = stats.column_count;
+	d["empty_column_count"] = stats.empty_column_count;
+	d["column_count_per_subpass"] = column_count_per_subpass;
+	d["memory_usage_bytes"] = stats.memory_usage_bytes;
+	return d;
+}
+
 #ifdef TOOLS_ENABLED
 
 void VoxelGeneratorMultipassCB::get_configuration_warnings(PackedStringArray &out_warnings) const {
@@ -630,11 +698,22 @@ void VoxelGeneratorMultipassCB::_bind_methods() {
 			D_METHOD("set_column_height_blocks", "y"), &VoxelGeneratorMultipassCB::set_column_height_blocks
 	);
 
+	ClassDB::bind_method(
+			D_METHOD("get_first_pass_slice_height_blocks"),
+			&VoxelGeneratorMultipassCB::get_first_pass_slice_height_blocks
+	);
+	ClassDB::bind_method(
+			D_METHOD("set_first_pass_slice_height_blocks", "height"),
+			&VoxelGeneratorMultipassCB::set_first_pass_slice_height_blocks
+	);
+
 	ClassDB::bind_method(
 			D_METHOD("debug_generate_test_column", "column_position_blocks"),
 			&VoxelGeneratorMultipassCB::debug_generate_test_column
 	);
 
+	ClassDB::bind_method(D_METHOD("get_cache_stats"), &VoxelGeneratorMultipassCB::_b_get_cache_stats);
+
 #if defined(ZN_GODOT)
 	// TODO Test if GDVIRTUAL can print errors properly when GDScript fails inside a different thread.
 	GDVIRTUAL_BIND(_generate_pass, "voxel_tool", "pass_index");
@@ -650,6 +729,17 @@ void VoxelGeneratorMultipassCB::_bind_methods() {
 			PropertyInfo(Variant::INT, "column_height_blocks"), "set_column_height_blocks", "get_column_height_blocks"
 	);
 
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::INT,
+					"first_pass_slice_height_blocks",
+					PROPERTY_HINT_RANGE,
+					String("0,{0}").format(varray(MAX_COLUMN_HEIGHT_BLOCKS))
+			),
+			"set_first_pass_slice_height_blocks",
+			"get_first_pass_slice_height_blocks"
+	);
+
 	ADD_PROPERTY(
 			PropertyInfo(
 					Variant::INT, "pass_count", PROPERTY_HINT_RANGE, String("{0},{1}").format(varray(1, MAX_PASSES))
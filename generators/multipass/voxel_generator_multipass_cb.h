@@ -3,6 +3,7 @@
 
 #include "../../engine/ids.h"
 #include "../../storage/voxel_buffer_gd.h"
+#include "../../util/containers/fixed_array.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/core/gdvirtual.h"
 #include "../../util/math/box3i.h"
@@ -81,6 +82,9 @@ public:
 	int get_column_height_blocks() const;
 	void set_column_height_blocks(int new_height);
 
+	int get_first_pass_slice_height_blocks() const;
+	void set_first_pass_slice_height_blocks(int new_height);
+
 	int get_pass_extent_blocks(int pass_index) const;
 	void set_pass_extent_blocks(int pass_index, int new_extent);
 
@@ -115,6 +119,19 @@ public:
 
 	bool debug_try_get_column_states(StdVector<DebugColumnState> &out_states);
 
+	struct CacheStats {
+		unsigned int column_count = 0;
+		// Columns on which no subpass ran yet
+		unsigned int empty_column_count = 0;
+		// How many columns are at each subpass
+		FixedArray<unsigned int, MAX_SUBPASSES> column_count_per_subpass;
+		// Voxel data of all blocks in the cache
+		uint64_t memory_usage_bytes = 0;
+	};
+
+	// Locks the whole cache while it runs, so it should not be called too often.
+	CacheStats get_cache_stats() const;
+
 protected:
 	bool _set(const StringName &p_name, const Variant &p_value);
 	bool _get(const StringName &p_name, Variant &r_ret) const;
@@ -128,6 +145,8 @@ protected:
 	GDVIRTUAL0RC(int, _get_used_channels_mask)
 
 private:
+	Dictionary _b_get_cache_stats() const;
+
 	void process_viewer_diff_internal(Box3i p_requested_box, Box3i p_prev_requested_box);
 	void re_initialize_column_refcounts();
 	void generate_block_fallback_script(VoxelQueryData &input);
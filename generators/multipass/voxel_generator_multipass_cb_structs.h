@@ -77,6 +77,12 @@ struct Column {
 	// Each bit is set to 1 when a task is pending to process this block at a given subpass.
 	uint8_t pending_subpass_tasks_mask = 0;
 
+	// Column tasks that could not run because a task was pending to process this column. They are scheduled when
+	// that task finishes or cancels, or when the column gets unloaded, so they don't have to poll. Like
+	// `Block::final_pending_task`, only non-scheduled, non-running tasks can be referenced here, and they are owned by
+	// the column while they are here.
+	StdVector<IThreadedTask *> waiting_tasks;
+
 	// Currently unused, because if chunks get removed from the cache or don't get saved for any reason,
 	// it can become out of sync and we wouldn't know. It would be a nice optimization tho...
 	//
@@ -137,6 +143,9 @@ struct Internal {
 	SmallVector<Pass, MAX_PASSES> passes;
 	int column_base_y_blocks = -4;
 	int column_height_blocks = 8;
+	// If not zero, the first pass runs on vertical slices of columns of this height in parallel, instead of whole
+	// columns. This is possible because the first pass has no dependencies.
+	int first_pass_slice_height_blocks = 0;
 
 	// Set to `true` if the generator's configuration changed. Means a new instance of Internal has been made.
 	// Existing tasks may still finish their work using the old instance, but results will be thrown away. Such
@@ -152,6 +161,7 @@ struct Internal {
 		passes = other.passes;
 		column_base_y_blocks = other.column_base_y_blocks;
 		column_height_blocks = other.column_height_blocks;
+		first_pass_slice_height_blocks = other.first_pass_slice_height_blocks;
 	}
 };
 
@@ -143,6 +143,91 @@ void VoxelToolMultipassGenerator::paste_masked_writable_list(
 	);
 }
 
+namespace {
+
+template <typename FPaste>
+void paste_multiple(
+		Span<const Vector3> positions,
+		const VoxelBuffer &src,
+		const Box3i &editable_voxel_box,
+		unsigned int block_size_po2,
+		uint8_t channels_mask,
+		GetPassInputBlock get_block_func,
+		FPaste paste_func
+) {
+	const Vector3i src_size = src.get_size();
+
+	for (const Vector3 &position : positions) {
+		const Vector3i pos = to_vec3i(math::floor(position));
+
+		if (!Box3i(pos, src_size).intersects(editable_voxel_box)) {
+			continue;
+		}
+
+		paste_to_chunked_storage_tp(src, pos, block_size_po2, channels_mask, get_block_func, paste_func);
+	}
+}
+
+} // namespace
+
+void VoxelToolMultipassGenerator::paste_masked_multiple(
+		PackedVector3Array positions,
+		Ref<godot::VoxelBuffer> p_voxels,
+		uint8_t channels_mask,
+		uint8_t src_mask_channel,
+		uint64_t src_mask_value,
+		uint8_t dst_mask_channel,
+		PackedInt32Array dst_writable_list
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(p_voxels.is_valid());
+	ZN_ASSERT_RETURN(src_mask_channel < VoxelBuffer::MAX_CHANNELS);
+	ZN_ASSERT_RETURN(dst_mask_channel < VoxelBuffer::MAX_CHANNELS);
+
+	const VoxelBuffer &src = p_voxels->get_buffer();
+	const Span<const Vector3> positions_s = to_span(positions);
+
+	using namespace paste_functors;
+
+	// The paste functor is set up once for all placements
+	if (dst_writable_list.size() == 0) {
+		paste_multiple(
+				positions_s,
+				src,
+				_editable_voxel_box,
+				_block_size_po2,
+				channels_mask,
+				GetPassInputBlock{ _pass_input },
+				SrcMasked{ src_mask_channel, src_mask_value }
+		);
+
+	} else if (dst_writable_list.size() == 1) {
+		const uint64_t dst_mask_value = dst_writable_list[0];
+		paste_multiple(
+				positions_s,
+				src,
+				_editable_voxel_box,
+				_block_size_po2,
+				channels_mask,
+				GetPassInputBlock{ _pass_input },
+				SrcMasked_DstWritableValue{ src_mask_channel, dst_mask_channel, src_mask_value, dst_mask_value }
+		);
+
+	} else {
+		DynamicBitset bitarray;
+		indices_to_bitarray_u16(to_span(dst_writable_list), bitarray);
+		paste_multiple(
+				positions_s,
+				src,
+				_editable_voxel_box,
+				_block_size_po2,
+				channels_mask,
+				GetPassInputBlock{ _pass_input },
+				SrcMasked_DstWritableBitArray{ src_mask_channel, dst_mask_channel, src_mask_value, bitarray }
+		);
+	}
+}
+
 Block *VoxelToolMultipassGenerator::get_block_and_relative_position(
 		Vector3i terrain_voxel_pos,
 		Vector3i &out_voxel_rpos
@@ -287,6 +372,20 @@ void VoxelToolMultipassGenerator::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_main_area_min"), &VoxelToolMultipassGenerator::get_main_area_min);
 	ClassDB::bind_method(D_METHOD("get_main_area_max"), &VoxelToolMultipassGenerator::get_main_area_max);
 
+	ClassDB::bind_method(
+			D_METHOD(
+					"paste_masked_multiple",
+					"positions",
+					"voxels",
+					"channels_mask",
+					"src_mask_channel",
+					"src_mask_value",
+					"dst_mask_channel",
+					"dst_writable_list"
+			),
+			&VoxelToolMultipassGenerator::paste_masked_multiple
+	);
+
 	// ClassDB::bind_static_method(VoxelToolMultipassGenerator::get_class_static(),
 	// 		D_METHOD("create_offline", "grid_origin_blocks", "grid_size_blocks", "main_block_position",
 	// 				"block_size_po2"),
@@ -46,6 +46,18 @@ public:
 
 	// Specific methods
 
+	// Pastes the same buffer at many locations. Locations outside of the editable area are skipped, and pastes are
+	// clipped to it. If `dst_writable_list` is empty, destination voxels are not checked.
+	void paste_masked_multiple(
+			PackedVector3Array positions,
+			Ref<godot::VoxelBuffer> p_voxels,
+			uint8_t channels_mask,
+			uint8_t src_mask_channel,
+			uint64_t src_mask_value,
+			uint8_t dst_mask_channel,
+			PackedInt32Array dst_writable_list
+	);
+
 	Vector3i get_editable_area_min() const;
 	Vector3i get_editable_area_max() const;
 
@@ -115,6 +115,37 @@ VoxelGenerator::Result VoxelGeneratorFlat::generate_block(VoxelGenerator::VoxelQ
 	return result;
 }
 
+void VoxelGeneratorFlat::generate_series(
+		Span<const float> positions_x,
+		Span<const float> positions_y,
+		Span<const float> positions_z,
+		unsigned int channel,
+		Span<float> out_values,
+		Vector3f min_pos,
+		Vector3f max_pos
+) {
+	Parameters params;
+	{
+		RWLockRead rlock(_parameters_lock);
+		params = _parameters;
+	}
+
+	ZN_ASSERT_RETURN(positions_y.size() == out_values.size());
+
+	// Only Y matters, and loops are kept branchless so they can be vectorized by the compiler
+	if (channel == VoxelBuffer::CHANNEL_SDF) {
+		for (unsigned int i = 0; i < out_values.size(); ++i) {
+			// Not scaling here, since the return values are uncompressed floats
+			out_values[i] = positions_y[i] - params.height;
+		}
+	} else {
+		const float matter_type = params.voxel_type;
+		for (unsigned int i = 0; i < out_values.size(); ++i) {
+			out_values[i] = positions_y[i] < params.height ? matter_type : 0.f;
+		}
+	}
+}
+
 void VoxelGeneratorFlat::_b_set_channel(godot::VoxelBuffer::ChannelId p_channel) {
 	set_channel(VoxelBuffer::ChannelId(p_channel));
 }
@@ -22,6 +22,20 @@ public:
 
 	Result generate_block(VoxelGenerator::VoxelQueryData &input) override;
 
+	bool supports_series_generation() const override {
+		return true;
+	}
+
+	void generate_series(
+			Span<const float> positions_x,
+			Span<const float> positions_y,
+			Span<const float> positions_z,
+			unsigned int channel,
+			Span<float> out_values,
+			Vector3f min_pos,
+			Vector3f max_pos
+	) override;
+
 	void set_voxel_type(int t);
 	int get_voxel_type() const;
 
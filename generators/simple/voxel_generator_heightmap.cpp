@@ -1,13 +1,112 @@
 #include "voxel_generator_heightmap.h"
+#include "../../storage/funcs.h"
 #include "../../util/containers/fixed_array.h"
 #include "../../util/containers/span.h"
+#include "../../util/io/log.h"
 
 namespace zylann::voxel {
 
+namespace {
+
+template <typename Data_T, typename F>
+void write_sdf_columns(
+		Span<Data_T> channel_data,
+		Span<const float> heights,
+		unsigned int column_height,
+		int origin_y,
+		int stride,
+		float iso_scale,
+		F convert_func
+) {
+	ZN_ASSERT_RETURN(channel_data.size() == heights.size() * column_height);
+	// Voxels are stored in ZXY order, so each column is contiguous
+	Data_T *column = channel_data.data();
+	for (const float h : heights) {
+		int gy = origin_y;
+		for (unsigned int y = 0; y < column_height; ++y, gy += stride) {
+			column[y] = convert_func(iso_scale * (gy - h));
+		}
+		column += column_height;
+	}
+}
+
+} // namespace
+
 VoxelGeneratorHeightmap::VoxelGeneratorHeightmap() {}
 
 VoxelGeneratorHeightmap::~VoxelGeneratorHeightmap() {}
 
+void VoxelGeneratorHeightmap::fill_sdf_columns(
+		VoxelBuffer &out_buffer,
+		unsigned int channel,
+		Span<const float> heights,
+		int origin_y,
+		int stride,
+		float iso_scale
+) {
+	if (out_buffer.get_channel_compression(channel) != VoxelBuffer::COMPRESSION_NONE) {
+		out_buffer.decompress_channel(channel);
+	}
+	Span<uint8_t> channel_bytes;
+	ZN_ASSERT_RETURN(out_buffer.get_channel_as_bytes(channel, channel_bytes));
+	const unsigned int column_height = out_buffer.get_size().y;
+	const float sdf_scale = out_buffer.get_sdf_channel_quantization_scale();
+
+	switch (out_buffer.get_channel_depth(channel)) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			write_sdf_columns(
+					channel_bytes.reinterpret_cast_to<int8_t>(),
+					heights,
+					column_height,
+					origin_y,
+					stride,
+					iso_scale,
+					[sdf_scale](float v) { return snorm_to_s8(v * sdf_scale); }
+			);
+			break;
+
+		case VoxelBuffer::DEPTH_16_BIT:
+			write_sdf_columns(
+					channel_bytes.reinterpret_cast_to<int16_t>(),
+					heights,
+					column_height,
+					origin_y,
+					stride,
+					iso_scale,
+					[sdf_scale](float v) { return snorm_to_s16(v * sdf_scale); }
+			);
+			break;
+
+		case VoxelBuffer::DEPTH_32_BIT:
+			write_sdf_columns(
+					channel_bytes.reinterpret_cast_to<float>(),
+					heights,
+					column_height,
+					origin_y,
+					stride,
+					iso_scale,
+					[](float v) { return v; }
+			);
+			break;
+
+		case VoxelBuffer::DEPTH_64_BIT:
+			write_sdf_columns(
+					channel_bytes.reinterpret_cast_to<double>(),
+					heights,
+					column_height,
+					origin_y,
+					stride,
+					iso_scale,
+					[](float v) { return double(v); }
+			);
+			break;
+
+		default:
+			ZN_PRINT_ERROR("Unknown depth");
+			break;
+	}
+}
+
 void VoxelGeneratorHeightmap::set_channel(VoxelBuffer::ChannelId p_channel) {
 	ERR_FAIL_INDEX(p_channel, VoxelBuffer::MAX_CHANNELS);
 	bool changed = false;
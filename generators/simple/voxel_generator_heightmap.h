@@ -5,6 +5,7 @@
 #include "../../storage/voxel_buffer.h"
 #include "../../storage/voxel_buffer_gd.h"
 #include "../../util/containers/span.h"
+#include "../../util/containers/std_vector.h"
 #include "../../util/math/funcs.h"
 #include "../../util/math/vector3f.h"
 #include "../../util/math/vector3i.h"
@@ -34,8 +35,19 @@ public:
 	void set_iso_scale(float iso_scale);
 	float get_iso_scale() const;
 
+	// Writes SDF in every column of the block, given their heights in XZ order.
+	static void fill_sdf_columns(
+			VoxelBuffer &out_buffer,
+			unsigned int channel,
+			Span<const float> heights,
+			int origin_y,
+			int stride,
+			float iso_scale
+	);
+
 protected:
 	void _b_set_channel(godot::VoxelBuffer::ChannelId p_channel);
+
 	godot::VoxelBuffer::ChannelId _b_get_channel() const;
 
 	// float height_func(x, y)
@@ -67,45 +79,61 @@ protected:
 
 		const int stride = 1 << lod;
 
-		if (use_sdf) {
+		// Heights only depend on X and Z, so they are computed once per column
+		static thread_local StdVector<float> tls_heights;
+		StdVector<float> &heights = tls_heights;
+		heights.resize(bs.x * bs.z);
+		{
+			unsigned int i = 0;
 			int gz = origin.z;
-
 			for (int z = 0; z < bs.z; ++z, gz += stride) {
 				int gx = origin.x;
-
 				for (int x = 0; x < bs.x; ++x, gx += stride) {
-					float h = params.range.xform(height_func(gx, gz));
-					int gy = origin.y;
-					for (int y = 0; y < bs.y; ++y, gy += stride) {
-						const float sdf = params.iso_scale * (gy - h);
-						out_buffer.set_voxel_f(sdf, x, y, z, channel);
-					}
+					heights[i] = params.range.xform(height_func(gx, gz));
+					++i;
+				}
+			}
+		}
 
-				} // for x
-			} // for z
+		if (use_sdf) {
+			fill_sdf_columns(out_buffer, channel, to_span_const(heights), origin.y, stride, params.iso_scale);
 
 		} else {
 			// Blocky
 
-			int gz = origin.z;
+			// Output is blocky, so we can go for just one sample
+			static thread_local StdVector<int> tls_column_heights;
+			StdVector<int> &column_heights = tls_column_heights;
+			column_heights.resize(heights.size());
+			int min_ih = bs.y;
+			int max_ih = 0;
+			for (unsigned int i = 0; i < heights.size(); ++i) {
+				const int ih = math::clamp(math::arithmetic_rshift(int(heights[i] - origin.y), lod), 0, bs.y);
+				column_heights[i] = ih;
+				min_ih = math::min(min_ih, ih);
+				max_ih = math::max(max_ih, ih);
+			}
 
-			for (int z = 0; z < bs.z; ++z, gz += stride) {
-				int gx = origin.x;
+			if (max_ih == 0) {
+				// All columns are below the block
+				return Result();
+			}
+			if (min_ih == bs.y) {
+				// All columns are above the block
+				out_buffer.fill(params.matter_type, channel);
+				return Result();
+			}
 
-				for (int x = 0; x < bs.x; ++x, gx += stride) {
-					// Output is blocky, so we can go for just one sample
-					float h = params.range.xform(height_func(gx, gz));
-					h -= origin.y;
-					int ih = math::arithmetic_rshift(int(h), lod);
+			unsigned int i = 0;
+			for (int z = 0; z < bs.z; ++z) {
+				for (int x = 0; x < bs.x; ++x) {
+					const int ih = column_heights[i];
 					if (ih > 0) {
-						if (ih > bs.y) {
-							ih = bs.y;
-						}
 						out_buffer.fill_area(
 								params.matter_type, Vector3i(x, 0, z), Vector3i(x + 1, ih, z + 1), channel
 						);
 					}
-
+					++i;
 				} // for x
 			} // for z
 		} // use_sdf
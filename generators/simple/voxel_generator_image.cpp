@@ -2,6 +2,8 @@
 #include "../../util/containers/fixed_array.h"
 #include "../../util/containers/span.h"
 #include "../../util/godot/classes/image.h"
+#include "../../util/memory/memory.h"
+#include "../../util/profiling.h"
 
 namespace zylann::voxel {
 
@@ -26,20 +28,73 @@ VoxelGeneratorImage::VoxelGeneratorImage() {}
 
 VoxelGeneratorImage::~VoxelGeneratorImage() {}
 
+std::shared_ptr<const VoxelGeneratorImage::Mipmaps> VoxelGeneratorImage::create_mipmaps(
+		const Image &image,
+		bool blur_enabled
+) {
+	ZN_PROFILE_SCOPE();
+
+	std::shared_ptr<Mipmaps> mipmaps = make_shared_instance<Mipmaps>();
+
+	{
+		Mipmaps::Level level;
+		level.width = image.get_width();
+		level.height = image.get_height();
+		level.heights.resize(level.width * level.height);
+
+		unsigned int i = 0;
+		for (int y = 0; y < level.height; ++y) {
+			for (int x = 0; x < level.width; ++x) {
+				level.heights[i] = blur_enabled ? get_height_blurred(image, x, y) : get_height_repeat(image, x, y);
+				++i;
+			}
+		}
+
+		mipmaps->levels.push_back(std::move(level));
+	}
+
+	while (true) {
+		const Mipmaps::Level &src = mipmaps->levels.back();
+		if (src.width < 2 || src.height < 2 || (src.width % 2) != 0 || (src.height % 2) != 0) {
+			break;
+		}
+
+		Mipmaps::Level dst;
+		dst.width = src.width / 2;
+		dst.height = src.height / 2;
+		dst.heights.resize(dst.width * dst.height);
+
+		unsigned int i = 0;
+		for (int y = 0; y < dst.height; ++y) {
+			const float *src_row0 = &src.heights[2 * y * src.width];
+			const float *src_row1 = src_row0 + src.width;
+			for (int x = 0; x < dst.width; ++x) {
+				const float sum = src_row0[2 * x] + src_row0[2 * x + 1] + src_row1[2 * x] + src_row1[2 * x + 1];
+				dst.heights[i] = 0.25f * sum;
+				++i;
+			}
+		}
+
+		// Don't use `src` after this, it may be reallocated
+		mipmaps->levels.push_back(std::move(dst));
+	}
+
+	return mipmaps;
+}
+
 void VoxelGeneratorImage::set_image(Ref<Image> im) {
 	if (im == _image) {
 		return;
 	}
+	std::shared_ptr<const Mipmaps> mipmaps;
 	if (im.is_valid()) {
 		ERR_FAIL_COND(im->is_compressed());
+		ERR_FAIL_COND(im->is_empty());
+		mipmaps = create_mipmaps(**im, is_blur_enabled());
 	}
 	_image = im;
-	Ref<Image> copy;
-	if (im.is_valid()) {
-		copy = im->duplicate();
-	}
 	RWLockWrite wlock(_parameters_lock);
-	_parameters.image = copy;
+	_parameters.mipmaps = mipmaps;
 }
 
 Ref<Image> VoxelGeneratorImage::get_image() const {
@@ -47,8 +102,17 @@ Ref<Image> VoxelGeneratorImage::get_image() const {
 }
 
 void VoxelGeneratorImage::set_blur_enabled(bool enable) {
+	if (enable == is_blur_enabled()) {
+		return;
+	}
+	// Blur is baked into heights
+	std::shared_ptr<const Mipmaps> mipmaps;
+	if (_image.is_valid()) {
+		mipmaps = create_mipmaps(**_image, enable);
+	}
 	RWLockWrite wlock(_parameters_lock);
 	_parameters.blur_enabled = enable;
+	_parameters.mipmaps = mipmaps;
 }
 
 bool VoxelGeneratorImage::is_blur_enabled() const {
@@ -67,29 +131,57 @@ VoxelGenerator::Result VoxelGeneratorImage::generate_block(VoxelGenerator::Voxel
 
 	Result result;
 
-	ERR_FAIL_COND_V(params.image.is_null(), result);
-	const Image &image = **params.image;
-
-	if (params.blur_enabled) {
-		result = VoxelGeneratorHeightmap::generate(
-				out_buffer,
-				[&image](int x, int z) { return get_height_blurred(image, x, z); },
-				input.origin_in_voxels,
-				input.lod
-		);
-	} else {
-		result = VoxelGeneratorHeightmap::generate(
-				out_buffer,
-				[&image](int x, int z) { return get_height_repeat(image, x, z); },
-				input.origin_in_voxels,
-				input.lod
-		);
-	}
+	ERR_FAIL_COND_V(params.mipmaps == nullptr, result);
+	const Mipmaps &mipmaps = *params.mipmaps;
+	const unsigned int lod = input.lod;
+
+	// Blocks of lower LOD sample heights averaged over the area covered by each of their voxels
+	result = VoxelGeneratorHeightmap::generate(
+			out_buffer,
+			[&mipmaps, lod](int x, int z) { return mipmaps.get_height(x, z, lod); },
+			input.origin_in_voxels,
+			input.lod
+	);
 
 	out_buffer.compress_uniform_channels();
 	return result;
 }
 
+void VoxelGeneratorImage::generate_series(
+		Span<const float> positions_x,
+		Span<const float> positions_y,
+		Span<const float> positions_z,
+		unsigned int channel,
+		Span<float> out_values,
+		Vector3f min_pos,
+		Vector3f max_pos
+) {
+	Parameters params;
+	{
+		RWLockRead rlock(_parameters_lock);
+		params = _parameters;
+	}
+
+	ERR_FAIL_COND(params.mipmaps == nullptr);
+	const Mipmaps &mipmaps = *params.mipmaps;
+
+	// Same sampling as blocks of LOD 0, which use integer coordinates
+	generate_series_template(
+			[&mipmaps](float x, float z) {
+				const int ix = static_cast<int>(Math::floor(x));
+				const int iz = static_cast<int>(Math::floor(z));
+				return mipmaps.get_height(ix, iz, 0);
+			},
+			positions_x,
+			positions_y,
+			positions_z,
+			channel,
+			out_values,
+			min_pos,
+			max_pos
+	);
+}
+
 void VoxelGeneratorImage::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_image", "image"), &VoxelGeneratorImage::set_image);
 	ClassDB::bind_method(D_METHOD("get_image"), &VoxelGeneratorImage::get_image);
@@ -1,9 +1,11 @@
 #ifndef HEADER_VOXEL_GENERATOR_IMAGE
 #define HEADER_VOXEL_GENERATOR_IMAGE
 
+#include "../../util/containers/std_vector.h"
 #include "../../util/godot/macros.h"
 #include "../../util/thread/rw_lock.h"
 #include "voxel_generator_heightmap.h"
+#include <memory>
 
 ZN_GODOT_FORWARD_DECLARE(class Image)
 
@@ -25,18 +27,51 @@ public:
 
 	Result generate_block(VoxelGenerator::VoxelQueryData &input) override;
 
+	bool supports_series_generation() const override {
+		return true;
+	}
+
+	void generate_series(
+			Span<const float> positions_x,
+			Span<const float> positions_y,
+			Span<const float> positions_z,
+			unsigned int channel,
+			Span<float> out_values,
+			Vector3f min_pos,
+			Vector3f max_pos
+	) override;
+
 private:
 	static void _bind_methods();
 
-private:
+	// Heights read from the image, with prefiltered levels so blocks of lower LOD don't alias.
+	struct Mipmaps {
+		struct Level {
+			StdVector<float> heights;
+			int width = 0;
+			int height = 0;
+		};
+		// Levels are only made while sizes are even, so all of them tile the same way as the image.
+		StdVector<Level> levels;
+
+		// Gets the height at the given pixel of the image, averaged over a square of `1 << lod` pixels
+		inline float get_height(int x, int y, unsigned int lod) const {
+			const unsigned int level_index = math::min(lod, static_cast<unsigned int>(levels.size() - 1));
+			const Level &level = levels[level_index];
+			const int lx = math::wrap(math::arithmetic_rshift(x, level_index), level.width);
+			const int ly = math::wrap(math::arithmetic_rshift(y, level_index), level.height);
+			return level.heights[lx + ly * level.width];
+		}
+	};
+
+	static std::shared_ptr<const Mipmaps> create_mipmaps(const Image &image, bool blur_enabled);
+
 	// Proper reference used for external access.
 	Ref<Image> _image;
 
 	struct Parameters {
-		// This is a read-only copy of the image.
-		// It wastes memory for sure, but Godot does not offer any way to secure this better.
-		// If this is a problem one day, we could add an option to dereference the external image in game.
-		Ref<Image> image;
+		// Heights are copied from the image, so it can't be modified while they are used by threads.
+		std::shared_ptr<const Mipmaps> mipmaps;
 		// Mostly here as demo/tweak. It's better recommended to use an EXR/float image.
 		bool blur_enabled = false;
 	};
@@ -35,6 +35,40 @@ VoxelGenerator::Result VoxelGeneratorWaves::generate_block(VoxelGenerator::Voxel
 	);
 }
 
+void VoxelGeneratorWaves::generate_series(
+		Span<const float> positions_x,
+		Span<const float> positions_y,
+		Span<const float> positions_z,
+		unsigned int channel,
+		Span<float> out_values,
+		Vector3f min_pos,
+		Vector3f max_pos
+) {
+	Parameters params;
+	{
+		RWLockRead rlock(_parameters_lock);
+		params = _parameters;
+	}
+
+	const Vector2 freq(
+			Math_PI / static_cast<float>(params.pattern_size.x), Math_PI / static_cast<float>(params.pattern_size.y)
+	);
+	const Vector2 offset = params.pattern_offset;
+
+	generate_series_template(
+			[freq, offset](float x, float z) {
+				return 0.5 + 0.25 * (Math::cos((x + offset.x) * freq.x) + Math::sin((z + offset.y) * freq.y));
+			},
+			positions_x,
+			positions_y,
+			positions_z,
+			channel,
+			out_values,
+			min_pos,
+			max_pos
+	);
+}
+
 Vector2 VoxelGeneratorWaves::get_pattern_size() const {
 	RWLockRead rlock(_parameters_lock);
 	return _parameters.pattern_size;
@@ -10,15 +10,33 @@
 
 namespace zylann::voxel {
 
-VoxelGenerator::VoxelGenerator() {}
+VoxelGenerator::VoxelGenerator() {
+	// Parameters of generators emit this signal when they change
+	connect(VoxelStringNames::get_singleton().changed, callable_mp(this, &VoxelGenerator::_on_changed));
+}
+
+void VoxelGenerator::_on_changed() {
+	increment_output_revision();
+}
+
+void VoxelGenerator::increment_output_revision() {
+	_output_revision.fetch_add(1, std::memory_order_acq_rel);
+}
 
 VoxelGenerator::Result VoxelGenerator::generate_block(VoxelQueryData &input) {
 	return Result();
 }
 
+void VoxelGenerator::generate_blocks(Span<VoxelQueryData> queries, Span<Result> out_results) {
+	ZN_ASSERT_RETURN(queries.size() == out_results.size());
+	for (unsigned int i = 0; i < queries.size(); ++i) {
+		out_results[i] = generate_block(queries[i]);
+	}
+}
+
 IThreadedTask *VoxelGenerator::create_block_task(const BlockTaskParams &params) const {
 	// Default generic task
-	return ZN_NEW(GenerateBlockTask(params));
+	return ThreadedTaskPool<GenerateBlockTask>::get_singleton().create(params);
 }
 
 int VoxelGenerator::get_used_channels_mask() const {
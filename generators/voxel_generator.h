@@ -12,6 +12,7 @@
 #include "../util/tasks/cancellation_token.h"
 #include "../util/thread/mutex.h"
 
+#include <atomic>
 #include <memory>
 
 namespace zylann {
@@ -61,6 +62,10 @@ public:
 
 	virtual Result generate_block(VoxelQueryData &input);
 
+	// Generates multiple blocks at once. `out_results` must have the same size as `queries`. Generators may override
+	// this to share setup costs between blocks, which matters when many small or cheap blocks are requested.
+	virtual void generate_blocks(Span<VoxelQueryData> queries, Span<Result> out_results);
+
 	struct BlockTaskParams {
 		Vector3i block_position;
 		VolumeID volume_id;
@@ -175,6 +180,12 @@ public:
 
 	virtual void clear_cache();
 
+	// Changes every time the output of the generator may have changed, so blocks generated earlier and cached by the
+	// engine are not used anymore. Thread-safe.
+	inline uint32_t get_output_revision() const {
+		return _output_revision.load(std::memory_order_acquire);
+	}
+
 	// Editor
 
 #ifdef TOOLS_ENABLED
@@ -186,12 +197,20 @@ protected:
 
 	void _b_generate_block(Ref<godot::VoxelBuffer> out_buffer, Vector3 origin_in_voxels, int lod);
 
+	// Must be called when the output of the generator changes without emitting the `changed` signal
+	void increment_output_revision();
+
 	std::shared_ptr<ComputeShader> _detail_rendering_shader;
 	std::shared_ptr<ComputeShaderParameters> _detail_rendering_shader_parameters;
 	std::shared_ptr<ComputeShader> _block_rendering_shader;
 	std::shared_ptr<ComputeShaderParameters> _block_rendering_shader_parameters;
 	std::shared_ptr<ShaderOutputs> _block_rendering_shader_outputs;
 	Mutex _shader_mutex;
+
+private:
+	void _on_changed();
+
+	std::atomic<uint32_t> _output_revision = { 0 };
 };
 
 } // namespace voxel
@@ -2,12 +2,117 @@
 #include "../constants/voxel_string_names.h"
 #include "../storage/voxel_buffer_gd.h"
 #include "../util/godot/check_ref_ownership.h"
+#include "../util/godot/core/packed_arrays.h"
+#include "../util/io/log.h"
+#include "../util/profiling.h"
+#include "../util/string/format.h"
+#include "simple/voxel_generator_heightmap.h"
 
 namespace zylann::voxel {
 
 VoxelGeneratorScript::VoxelGeneratorScript() {}
 
 VoxelGenerator::Result VoxelGeneratorScript::generate_block(VoxelGenerator::VoxelQueryData &input) {
+	if (try_generate_blocks_in_bulk(Span<VoxelQueryData>(&input, 1))) {
+		return Result();
+	}
+	return generate_block_with_buffer_wrapper(input);
+}
+
+void VoxelGeneratorScript::generate_blocks(Span<VoxelQueryData> queries, Span<Result> out_results) {
+	ZN_ASSERT_RETURN(queries.size() == out_results.size());
+
+	// Consecutive blocks of the same size and LOD index are sent to the script in a single call
+	unsigned int begin = 0;
+	while (begin < queries.size()) {
+		const VoxelQueryData &first = queries[begin];
+		const Vector3i block_size = first.voxel_buffer.get_size();
+
+		unsigned int end = begin + 1;
+		while (end < queries.size() && queries[end].lod == first.lod &&
+			   queries[end].voxel_buffer.get_size() == block_size) {
+			++end;
+		}
+
+		if (try_generate_blocks_in_bulk(queries.sub(begin, end - begin))) {
+			for (unsigned int i = begin; i < end; ++i) {
+				out_results[i] = Result();
+			}
+		} else {
+			for (unsigned int i = begin; i < end; ++i) {
+				out_results[i] = generate_block_with_buffer_wrapper(queries[i]);
+			}
+		}
+
+		begin = end;
+	}
+}
+
+bool VoxelGeneratorScript::try_generate_blocks_in_bulk(Span<VoxelQueryData> queries) const {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(queries.size() > 0, false);
+
+	const Vector3i block_size = queries[0].voxel_buffer.get_size();
+	const int lod = queries[0].lod;
+
+	TypedArray<Vector3i> origins;
+	origins.resize(queries.size());
+	for (unsigned int i = 0; i < queries.size(); ++i) {
+		origins[i] = queries[i].origin_in_voxels;
+	}
+
+	const unsigned int channel = VoxelBuffer::CHANNEL_SDF;
+	PackedFloat32Array values;
+
+	if (GDVIRTUAL_CALL(_generate_sdf, origins, block_size, lod, values)) {
+		const unsigned int volume = Vector3iUtil::get_volume(block_size);
+		if (static_cast<unsigned int>(values.size()) != volume * queries.size()) {
+			ZN_PRINT_ERROR(format(
+					"VoxelGeneratorScript::_generate_sdf returned {} values, expected {}",
+					values.size(),
+					volume * queries.size()
+			));
+			return true;
+		}
+		Span<const float> values_s = to_span(values);
+		for (unsigned int i = 0; i < queries.size(); ++i) {
+			VoxelBuffer &buffer = queries[i].voxel_buffer;
+			buffer.decompress_channel(channel);
+			scale_and_store_sdf(buffer, values_s.sub(i * volume, volume));
+		}
+		return true;
+	}
+
+	if (GDVIRTUAL_CALL(_generate_heights, origins, block_size, lod, values)) {
+		const unsigned int column_count = block_size.x * block_size.z;
+		if (static_cast<unsigned int>(values.size()) != column_count * queries.size()) {
+			ZN_PRINT_ERROR(format(
+					"VoxelGeneratorScript::_generate_heights returned {} values, expected {}",
+					values.size(),
+					column_count * queries.size()
+			));
+			return true;
+		}
+		Span<const float> values_s = to_span(values);
+		for (unsigned int i = 0; i < queries.size(); ++i) {
+			VoxelGeneratorHeightmap::fill_sdf_columns(
+					queries[i].voxel_buffer,
+					channel,
+					values_s.sub(i * column_count, column_count),
+					queries[i].origin_in_voxels.y,
+					1 << lod,
+					1.f
+			);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+VoxelGenerator::Result VoxelGeneratorScript::generate_block_with_buffer_wrapper(
+		VoxelGenerator::VoxelQueryData &input
+) {
 	Result result;
 
 	// Create a temporary wrapper so Godot can pass it to scripts
@@ -47,6 +152,8 @@ int VoxelGeneratorScript::get_used_channels_mask() const {
 
 void VoxelGeneratorScript::_bind_methods() {
 	GDVIRTUAL_BIND(_generate_block, "out_buffer", "origin_in_voxels", "lod");
+	GDVIRTUAL_BIND(_generate_sdf, "origins_in_voxels", "block_size", "lod");
+	GDVIRTUAL_BIND(_generate_heights, "origins_in_voxels", "block_size", "lod");
 	GDVIRTUAL_BIND(_get_used_channels_mask);
 }
 
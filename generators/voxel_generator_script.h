@@ -2,6 +2,7 @@
 #define VOXEL_GENERATOR_SCRIPT_H
 
 #include "../util/godot/core/gdvirtual.h"
+#include "../util/godot/core/typed_array.h"
 #include "voxel_generator.h"
 
 #ifdef ZN_GODOT_EXTENSION
@@ -13,19 +14,29 @@ namespace zylann::voxel {
 
 // Generator based on a script, like GDScript, C# or NativeScript.
 // The script is expected to properly handle multithreading.
+// Scripts may generate SDF of multiple blocks at once as packed arrays, which are then copied in bulk. This is much
+// faster than accessing voxels one by one from a script.
 class VoxelGeneratorScript : public VoxelGenerator {
 	GDCLASS(VoxelGeneratorScript, VoxelGenerator)
 public:
 	VoxelGeneratorScript();
 
 	Result generate_block(VoxelGenerator::VoxelQueryData &input) override;
+	void generate_blocks(Span<VoxelQueryData> queries, Span<Result> out_results) override;
 	int get_used_channels_mask() const override;
 
 protected:
 	GDVIRTUAL3(_generate_block, Ref<godot::VoxelBuffer>, Vector3i, int)
+	GDVIRTUAL3RC(PackedFloat32Array, _generate_sdf, TypedArray<Vector3i>, Vector3i, int)
+	GDVIRTUAL3RC(PackedFloat32Array, _generate_heights, TypedArray<Vector3i>, Vector3i, int)
 	GDVIRTUAL0RC(int, _get_used_channels_mask) // I think `C` means `const`?
 
 private:
+	// Generates blocks having the same size and LOD index with one of the bulk methods, if the script implements one.
+	// Returns false if it doesn't.
+	bool try_generate_blocks_in_bulk(Span<VoxelQueryData> queries) const;
+	Result generate_block_with_buffer_wrapper(VoxelGenerator::VoxelQueryData &input);
+
 	static void _bind_methods();
 };
 
@@ -0,0 +1,56 @@
+#include "blocky_section_cache.h"
+#include "../../util/profiling.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+template <typename T>
+inline uint64_t get_capacity_in_bytes(const StdVector<T> &v) {
+	return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+uint64_t BlockySectionCache::Section::get_size_in_bytes() const {
+	uint64_t size = sizeof(Section) + get_capacity_in_bytes(voxels) + get_capacity_in_bytes(arrays_per_material) +
+			get_capacity_in_bytes(collision_positions) + get_capacity_in_bytes(collision_indices);
+	for (const VoxelMesherBlocky::Arrays &arrays : arrays_per_material) {
+		size += get_capacity_in_bytes(arrays.positions) + get_capacity_in_bytes(arrays.normals) +
+				get_capacity_in_bytes(arrays.uvs) + get_capacity_in_bytes(arrays.colors) +
+				get_capacity_in_bytes(arrays.indices) + get_capacity_in_bytes(arrays.tangents);
+	}
+	return size;
+}
+
+uint64_t BlockySectionCache::Block::get_size_in_bytes() const {
+	// Sections shared with a previous version of the block are counted again. This overestimates memory usage until
+	// the previous version is replaced, which happens right after.
+	uint64_t size = sizeof(Block) + get_capacity_in_bytes(sections);
+	for (const std::shared_ptr<const Section> &section : sections) {
+		size += section->get_size_in_bytes();
+	}
+	return size;
+}
+
+std::shared_ptr<const BlockySectionCache::Block> BlockySectionCache::get(Vector3i origin_in_voxels) {
+	MutexLock mlock(_mutex);
+	std::shared_ptr<const Block> *block = _blocks.get(origin_in_voxels);
+	return block != nullptr ? *block : nullptr;
+}
+
+void BlockySectionCache::set(Vector3i origin_in_voxels, std::shared_ptr<const Block> block) {
+	ZN_PROFILE_SCOPE();
+	const uint64_t size_in_bytes = block->get_size_in_bytes();
+
+	MutexLock mlock(_mutex);
+	_blocks.set(origin_in_voxels, block, size_in_bytes);
+	_blocks.evict(MEMORY_BUDGET);
+}
+
+void BlockySectionCache::clear() {
+	MutexLock mlock(_mutex);
+	_blocks.clear();
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,61 @@
+#ifndef VOXEL_BLOCKY_SECTION_CACHE_H
+#define VOXEL_BLOCKY_SECTION_CACHE_H
+
+#include "../../util/containers/byte_budget_lru_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
+#include "voxel_mesher_blocky.h"
+#include <memory>
+
+namespace zylann::voxel {
+
+// Keeps the geometry of recently meshed blocks, split into sections of fixed size. When a block is meshed again, only
+// sections whose voxels changed have to be rebuilt, the others are reused as-is. Sections are compared by content
+// rather than relying on edit notifications, so outdated sections can't be reused.
+// The least recently used blocks are dropped when memory usage exceeds the budget.
+// Thread-safe.
+class BlockySectionCache {
+public:
+	static const unsigned int SECTION_SIZE = 8;
+	static const uint64_t MEMORY_BUDGET = 32 * 1024 * 1024;
+
+	struct Section {
+		// Copy of the voxels the section was built from, including the neighbors read by the mesher.
+		// Ordered the same way as in VoxelBuffer (ZXY).
+		StdVector<uint8_t> voxels;
+		StdVector<VoxelMesherBlocky::Arrays> arrays_per_material;
+		StdVector<Vector3f> collision_positions;
+		StdVector<int> collision_indices;
+
+		uint64_t get_size_in_bytes() const;
+	};
+
+	struct Block {
+		// Size of the voxel buffer including padding
+		Vector3i block_size;
+		uint32_t parameters_revision = 0;
+		uint32_t library_revision = 0;
+		uint8_t bytes_per_voxel = 0;
+		bool collision = false;
+		// Sections ordered ZXY
+		StdVector<std::shared_ptr<const Section>> sections;
+
+		uint64_t get_size_in_bytes() const;
+	};
+
+	// Blocks are identified by their origin. Different terrains using the same mesher may share them, which is fine
+	// because sections are validated against voxels before being reused.
+	std::shared_ptr<const Block> get(Vector3i origin_in_voxels);
+	void set(Vector3i origin_in_voxels, std::shared_ptr<const Block> block);
+
+	void clear();
+
+private:
+	ByteBudgetLRUMap<Vector3i, std::shared_ptr<const Block>> _blocks;
+	Mutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_BLOCKY_SECTION_CACHE_H
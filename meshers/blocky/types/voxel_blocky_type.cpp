@@ -421,6 +421,11 @@ void VoxelBlockyType::bake(
 		}
 	}
 
+	// Models of types get their IDs when the type library is baked, so they can't refer to each other
+	for (VoxelBlockyModel::BakedData &baked_model : baked_models) {
+		baked_model.lod_replacement_id = -1;
+	}
+
 	out_keys = std::move(keys);
 }
 
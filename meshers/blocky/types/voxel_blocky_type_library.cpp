@@ -1,15 +1,16 @@
 #include "voxel_blocky_type_library.h"
 #include "../../../constants/voxel_string_names.h"
-#include "../../../util/containers/container_funcs.h"
 #include "../../../util/godot/classes/json.h"
 #include "../../../util/godot/classes/object.h"
 #include "../../../util/godot/classes/time.h"
 #include "../../../util/godot/core/array.h"
 #include "../../../util/godot/core/string.h"
 #include "../../../util/godot/core/typed_array.h"
+#include "../../../util/hash_funcs.h"
 #include "../../../util/profiling.h"
 #include "../../../util/string/format.h"
 #include "../voxel_blocky_model_cube.h"
+#include <algorithm>
 
 namespace zylann::voxel {
 
@@ -41,20 +42,20 @@ void VoxelBlockyTypeLibrary::load_default() {
 void VoxelBlockyTypeLibrary::bake() {
 	ZN_PROFILE_SCOPE();
 
-	RWLockWrite lock(_baked_data_rw_lock);
-
 	const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
 
-	// This is the only place we modify the data.
+	// Baked into new data, so meshing tasks still using the current one are not affected
+	BakedData baked_data;
 
 	_indexed_materials.clear();
-	_baked_data.models.clear();
 
 	StdVector<VoxelBlockyModel::BakedData> baked_models;
 	StdVector<VoxelBlockyType::VariantKey> keys;
 	VoxelBlockyModel::MaterialIndexer material_indexer{ _indexed_materials };
 
-	_baked_data.models.resize(_id_map.size());
+	baked_data.models.resize(_id_map.size());
+
+	IDMapIndex id_map_index(_id_map);
 
 	for (size_t i = 0; i < _types.size(); ++i) {
 		Ref<VoxelBlockyType> type = _types[i];
@@ -67,23 +68,15 @@ void VoxelBlockyTypeLibrary::bake() {
 
 		unsigned int rel_key_index = 0;
 		for (VoxelBlockyModel::BakedData &baked_model : baked_models) {
-			// _baked_data.models.push_back(std::move(baked_model));
+			// baked_data.models.push_back(std::move(baked_model));
 			id.variant_key = keys[rel_key_index];
 
-			size_t model_index;
-			// TODO Optimize this (when needed)
-			// Find existing slot in the ID map. If found, use pre-allocated index.
-			if (!find(to_span_const(_id_map), id, model_index)) {
-				// If not found, pick an empty slot if any
-				if (!find(to_span_const(_id_map), VoxelID(), model_index)) {
-					// If not found, allocate a new index at the end
-					model_index = _baked_data.models.size();
-					_baked_data.models.push_back(VoxelBlockyModel::BakedData());
-					_id_map.push_back(id);
-				}
+			const size_t model_index = id_map_index.get_or_allocate(id);
+			if (model_index >= baked_data.models.size()) {
+				baked_data.models.resize(model_index + 1);
 			}
 
-			_baked_data.models[model_index] = std::move(baked_model);
+			baked_data.models[model_index] = std::move(baked_model);
 
 			++rel_key_index;
 		}
@@ -92,17 +85,19 @@ void VoxelBlockyTypeLibrary::bake() {
 		keys.clear();
 	}
 
-	if (_baked_data.models.size() > MAX_MODELS) {
-		const int extra = _baked_data.models.size() - MAX_MODELS;
+	if (baked_data.models.size() > MAX_MODELS) {
+		const int extra = baked_data.models.size() - MAX_MODELS;
 		ZN_PRINT_ERROR(
 				format("Reached maximum supported models {}. {} extra models will not be used.", MAX_MODELS, extra)
 		);
-		_baked_data.models.resize(MAX_MODELS);
+		baked_data.models.resize(MAX_MODELS);
 	}
 
-	_baked_data.indexed_materials_count = _indexed_materials.size();
+	baked_data.indexed_materials_count = _indexed_materials.size();
 
-	generate_side_culling_matrix(_baked_data);
+	bake_side_culling(baked_data);
+
+	publish_baked_data(std::move(baked_data));
 
 	const uint64_t time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
 	ZN_PRINT_VERBOSE(
@@ -116,6 +111,7 @@ void VoxelBlockyTypeLibrary::update_id_map() {
 
 void VoxelBlockyTypeLibrary::update_id_map(StdVector<VoxelID> &id_map, StdVector<uint16_t> *used_ids) const {
 	StdVector<VoxelBlockyType::VariantKey> keys;
+	IDMapIndex id_map_index(id_map);
 
 	for (size_t i = 0; i < _types.size(); ++i) {
 		Ref<VoxelBlockyType> type = _types[i];
@@ -132,17 +128,7 @@ void VoxelBlockyTypeLibrary::update_id_map(StdVector<VoxelID> &id_map, StdVector
 		for (const VoxelBlockyType::VariantKey &key : keys) {
 			id.variant_key = key;
 
-			size_t model_index;
-			// TODO Optimize this (when needed)
-			// Find existing slot in the ID map. If found, use pre-allocated index.
-			if (!find(to_span_const(id_map), id, model_index)) {
-				// If not found, pick an empty slot if any
-				if (!find(to_span_const(id_map), VoxelID(), model_index)) {
-					// If not found, allocate a new index at the end
-					model_index = id_map.size();
-					id_map.push_back(id);
-				}
-			}
+			const size_t model_index = id_map_index.get_or_allocate(id);
 
 			if (used_ids != nullptr) {
 				used_ids->push_back(model_index);
@@ -153,6 +139,49 @@ void VoxelBlockyTypeLibrary::update_id_map(StdVector<VoxelID> &id_map, StdVector
 	}
 }
 
+size_t VoxelBlockyTypeLibrary::VoxelIDHasher::operator()(const VoxelID &id) const {
+	uint64_t h = hash_djb2_one_64(id.type_name.hash());
+	for (unsigned int i = 0; i < VoxelBlockyType::MAX_ATTRIBUTES; ++i) {
+		h = hash_djb2_one_64(id.variant_key.attribute_names[i].hash(), h);
+		h = hash_djb2_one_64(id.variant_key.attribute_values[i], h);
+	}
+	return h;
+}
+
+VoxelBlockyTypeLibrary::IDMapIndex::IDMapIndex(StdVector<VoxelID> &id_map) : _id_map(id_map) {
+	for (size_t i = 0; i < id_map.size(); ++i) {
+		const VoxelID &id = id_map[i];
+		if (id == VoxelID()) {
+			_empty_slots.push_back(i);
+		} else {
+			// If the map contains duplicates, the first one is used
+			_indices.insert({ id, i });
+		}
+	}
+	std::reverse(_empty_slots.begin(), _empty_slots.end());
+}
+
+size_t VoxelBlockyTypeLibrary::IDMapIndex::get_or_allocate(const VoxelID &id) {
+	// Find existing slot in the ID map. If found, use pre-allocated index.
+	auto it = _indices.find(id);
+	if (it != _indices.end()) {
+		return it->second;
+	}
+	size_t index;
+	if (_empty_slots.size() > 0) {
+		// If not found, pick an empty slot if any
+		index = _empty_slots.back();
+		_empty_slots.pop_back();
+		_id_map[index] = id;
+	} else {
+		// If not found, allocate a new index at the end
+		index = _id_map.size();
+		_id_map.push_back(id);
+	}
+	_indices.insert({ id, index });
+	return index;
+}
+
 #ifdef TOOLS_ENABLED
 
 void VoxelBlockyTypeLibrary::get_configuration_warnings(PackedStringArray &out_warnings) const {
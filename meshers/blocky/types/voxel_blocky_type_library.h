@@ -1,6 +1,7 @@
 #ifndef VOXEL_BLOCKY_TYPE_LIBRARY_H
 #define VOXEL_BLOCKY_TYPE_LIBRARY_H
 
+#include "../../../util/containers/std_unordered_map.h"
 #include "../../../util/containers/std_vector.h"
 #include "../voxel_blocky_library_base.h"
 #include "voxel_blocky_type.h"
@@ -77,6 +78,27 @@ private:
 		}
 	};
 
+	struct VoxelIDHasher {
+		size_t operator()(const VoxelID &id) const;
+	};
+
+	// Finds slots of IDs in an ID map without searching it for every ID, since libraries can have thousands of
+	// models.
+	class IDMapIndex {
+	public:
+		IDMapIndex(StdVector<VoxelID> &id_map);
+
+		// Finds the slot of an ID in the map. If not found, picks an empty slot if any, or allocates a new one at the
+		// end of the map.
+		size_t get_or_allocate(const VoxelID &id);
+
+	private:
+		StdVector<VoxelID> &_id_map;
+		StdUnorderedMap<VoxelID, size_t, VoxelIDHasher> _indices;
+		// In descending order, so the first empty slot gets used first
+		StdVector<size_t> _empty_slots;
+	};
+
 	void update_id_map();
 	void update_id_map(StdVector<VoxelID> &id_map, StdVector<uint16_t> *used_ids) const;
 	static PackedStringArray serialize_id_map_to_string_array(const StdVector<VoxelID> &id_map);
@@ -47,28 +47,29 @@ void VoxelBlockyLibrary::load_default() {
 void VoxelBlockyLibrary::bake() {
 	ZN_PROFILE_SCOPE();
 
-	RWLockWrite lock(_baked_data_rw_lock);
-
 	const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
 
-	// This is the only place we modify the data.
+	// Baked into new data, so meshing tasks still using the current one are not affected
+	BakedData baked_data;
 
 	_indexed_materials.clear();
 	VoxelBlockyModel::MaterialIndexer materials{ _indexed_materials };
 
-	_baked_data.models.resize(_voxel_models.size());
+	baked_data.models.resize(_voxel_models.size());
 	for (size_t i = 0; i < _voxel_models.size(); ++i) {
 		Ref<VoxelBlockyModel> config = _voxel_models[i];
 		if (config.is_valid()) {
-			config->bake(_baked_data.models[i], _bake_tangents, materials);
+			config->bake(baked_data.models[i], _bake_tangents, materials);
 		} else {
-			_baked_data.models[i].clear();
+			baked_data.models[i].clear();
 		}
 	}
 
-	_baked_data.indexed_materials_count = _indexed_materials.size();
+	baked_data.indexed_materials_count = _indexed_materials.size();
+
+	bake_side_culling(baked_data);
 
-	generate_side_culling_matrix(_baked_data);
+	publish_baked_data(std::move(baked_data));
 
 	uint64_t time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
 	ZN_PRINT_VERBOSE(
@@ -1,6 +1,13 @@
 #include "voxel_blocky_library_base.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/godot/core/packed_arrays.h"
+#include "../../util/hash_funcs.h"
+#include "../../util/io/serialization.h"
+#include "../../util/math/funcs.h"
 #include "../../util/math/triangle.h"
 #include "../../util/profiling.h"
+#include "../../util/thread/thread.h"
+#include <atomic>
 #include <bitset>
 
 namespace zylann::voxel {
@@ -20,6 +27,19 @@ void VoxelBlockyLibraryBase::bake() {
 	// Implemented in child classes
 }
 
+std::shared_ptr<const VoxelBlockyLibraryBase::BakedData> VoxelBlockyLibraryBase::get_baked_data_snapshot() const {
+	MutexLock mlock(_baked_data_mutex);
+	return _baked_data;
+}
+
+void VoxelBlockyLibraryBase::publish_baked_data(BakedData &&baked_data) {
+	baked_data.revision = _baked_data->revision + 1;
+	std::shared_ptr<const BakedData> new_baked_data = make_shared_instance<BakedData>(std::move(baked_data));
+	// The previous data gets freed when the last meshing task using it is done
+	MutexLock mlock(_baked_data_mutex);
+	_baked_data = new_baked_data;
+}
+
 void VoxelBlockyLibraryBase::set_bake_tangents(bool bt) {
 	_bake_tangents = bt;
 	_needs_baking = true;
@@ -40,6 +60,32 @@ void VoxelBlockyLibraryBase::_b_bake() {
 	bake();
 }
 
+void VoxelBlockyLibraryBase::bake_side_culling(BakedData &baked_data) {
+	const uint64_t geometry_hash = get_side_culling_geometry_hash(baked_data);
+
+	if (load_side_culling_cache(baked_data, geometry_hash, to_span_const(_side_culling_cache))) {
+		return;
+	}
+
+	generate_side_culling_matrix(baked_data);
+
+	_side_culling_cache.clear();
+	save_side_culling_cache(baked_data, geometry_hash, _side_culling_cache);
+}
+
+PackedByteArray VoxelBlockyLibraryBase::_b_get_side_culling_cache() const {
+	PackedByteArray data;
+	copy_to(data, to_span_const(_side_culling_cache));
+	return data;
+}
+
+void VoxelBlockyLibraryBase::_b_set_side_culling_cache(PackedByteArray data) {
+	_side_culling_cache.resize(data.size());
+	if (data.size() > 0) {
+		copy_to(to_span(_side_culling_cache), data);
+	}
+}
+
 Ref<Material> VoxelBlockyLibraryBase::get_material_by_index(unsigned int index) const {
 	ZN_ASSERT_RETURN_V(index < _indexed_materials.size(), Ref<Material>());
 	return _indexed_materials[index];
@@ -65,8 +111,22 @@ void VoxelBlockyLibraryBase::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("bake"), &VoxelBlockyLibraryBase::_b_bake);
 
+	ClassDB::bind_method(D_METHOD("_get_side_culling_cache"), &VoxelBlockyLibraryBase::_b_get_side_culling_cache);
+	ClassDB::bind_method(
+			D_METHOD("_set_side_culling_cache", "data"), &VoxelBlockyLibraryBase::_b_set_side_culling_cache
+	);
+
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "bake_tangents"), "set_bake_tangents", "get_bake_tangents");
 
+	// Internal property
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::PACKED_BYTE_ARRAY, "_side_culling_cache", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE
+			),
+			"_set_side_culling_cache",
+			"_get_side_culling_cache"
+	);
+
 	BIND_CONSTANT(MAX_MODELS);
 	BIND_CONSTANT(MAX_MATERIALS);
 }
@@ -102,6 +162,7 @@ void rasterize_triangle_barycentric(Vector2f a, Vector2f b, Vector2f c, F output
 
 namespace {
 static const unsigned int RASTER_SIZE = 32;
+typedef std::bitset<RASTER_SIZE * RASTER_SIZE> SideBitmap;
 } // namespace
 
 void rasterize_side( //
@@ -174,6 +235,193 @@ void rasterize_side_all_surfaces( //
 	}
 }
 
+// Gets the axis perpendicular to a side, and the two axes along it
+void get_side_axes(unsigned int side, unsigned int &out_n, unsigned int &out_u, unsigned int &out_v) {
+	const Vector3i normal = Cube::g_side_normals[side];
+	out_n = normal.x != 0 ? Vector3i::AXIS_X : (normal.y != 0 ? Vector3i::AXIS_Y : Vector3i::AXIS_Z);
+	out_u = (out_n + 1) % 3;
+	out_v = (out_n + 2) % 3;
+}
+
+// Finds how UVs change along the axes of a side made of a single quad covering the whole face of the cube, so the
+// quad can be stretched over several voxels while repeating its texture. Returns false if the side is not such a quad.
+bool get_quad_uv_steps(
+		const VoxelBlockyModel::BakedData::SideSurface &side_surface,
+		unsigned int u_axis,
+		unsigned int v_axis,
+		Vector2f &out_u_step,
+		Vector2f &out_v_step
+) {
+	if (side_surface.positions.size() != 4 || side_surface.indices.size() != 6) {
+		return false;
+	}
+	constexpr float tolerance = 0.001f;
+	int i00 = -1;
+	int i10 = -1;
+	int i01 = -1;
+	for (unsigned int i = 0; i < 4; ++i) {
+		const Vector3f p = side_surface.positions[i];
+		const bool u0 = math::abs(p[u_axis]) < tolerance;
+		const bool v0 = math::abs(p[v_axis]) < tolerance;
+		const bool u1 = math::abs(p[u_axis] - 1.f) < tolerance;
+		const bool v1 = math::abs(p[v_axis] - 1.f) < tolerance;
+		if (u0 && v0) {
+			i00 = i;
+		} else if (u1 && v0) {
+			i10 = i;
+		} else if (u0 && v1) {
+			i01 = i;
+		} else if (!(u1 && v1)) {
+			return false;
+		}
+	}
+	if (i00 == -1 || i10 == -1 || i01 == -1) {
+		return false;
+	}
+	out_u_step = side_surface.uvs[i10] - side_surface.uvs[i00];
+	out_v_step = side_surface.uvs[i01] - side_surface.uvs[i00];
+	return true;
+}
+
+namespace {
+
+bool is_side_mergeable(const VoxelBlockyModel::BakedData::Model &model, unsigned int side) {
+	if (model.surface_count != 1 || (model.full_sides_mask & (1 << side)) == 0) {
+		return false;
+	}
+	unsigned int n, u, v;
+	get_side_axes(side, n, u, v);
+	Vector2f u_step;
+	Vector2f v_step;
+	return get_quad_uv_steps(model.surfaces[0].sides[side], u, v, u_step, v_step);
+}
+
+// Copies what meshing checks the most into a compact array
+void update_model_culling(VoxelBlockyLibraryBase::BakedData &baked_data) {
+	baked_data.model_culling.resize(baked_data.models.size());
+	for (unsigned int type_id = 0; type_id < baked_data.models.size(); ++type_id) {
+		const VoxelBlockyModel::BakedData &model_data = baked_data.models[type_id];
+		VoxelBlockyLibraryBase::BakedData::ModelCulling &culling = baked_data.model_culling[type_id];
+
+		culling.side_pattern_indices = model_data.model.side_pattern_indices;
+		culling.empty_sides_mask = model_data.model.empty_sides_mask;
+		culling.mergeable_sides_mask = 0;
+		for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
+			if (is_side_mergeable(model_data.model, side)) {
+				culling.mergeable_sides_mask |= (1 << side);
+			}
+		}
+		culling.transparency_index = model_data.transparency_index;
+		culling.empty = model_data.empty;
+		culling.culls_neighbors = model_data.culls_neighbors;
+		culling.contributes_to_ao = model_data.contributes_to_ao;
+	}
+}
+
+// Below this count, starting threads would take longer than rasterizing
+static const unsigned int MIN_MODELS_PER_RASTER_THREAD = 64;
+static const unsigned int MAX_RASTER_THREADS = 16;
+
+// Rasterizes all sides of all models, indexed by `model_index * Cube::SIDE_COUNT + side`. Models are split among
+// several threads when there are many of them.
+void rasterize_sides_of_all_models(Span<const VoxelBlockyModel::BakedData> models, StdVector<SideBitmap> &out_bitmaps) {
+	ZN_PROFILE_SCOPE();
+
+	out_bitmaps.clear();
+	out_bitmaps.resize(models.size() * Cube::SIDE_COUNT);
+
+	struct Context {
+		Span<const VoxelBlockyModel::BakedData> models;
+		Span<SideBitmap> bitmaps;
+		std::atomic_uint32_t next_model_index = { 0 };
+
+		// Each thread takes small ranges of models until there are none left, because some models have a lot more
+		// triangles than others
+		static void run(void *userdata) {
+			Context &ctx = *static_cast<Context *>(userdata);
+			const unsigned int batch_size = 16;
+			while (true) {
+				const unsigned int begin = ctx.next_model_index.fetch_add(batch_size);
+				if (begin >= ctx.models.size()) {
+					break;
+				}
+				const unsigned int end = math::min(begin + batch_size, static_cast<unsigned int>(ctx.models.size()));
+				for (unsigned int model_index = begin; model_index < end; ++model_index) {
+					for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
+						rasterize_side_all_surfaces(
+								ctx.models[model_index], side, ctx.bitmaps[model_index * Cube::SIDE_COUNT + side]
+						);
+					}
+				}
+			}
+		}
+	};
+
+	Context ctx;
+	ctx.models = models;
+	ctx.bitmaps = to_span(out_bitmaps);
+
+	const unsigned int thread_count = math::min(
+			math::min(Thread::get_hardware_concurrency(), MAX_RASTER_THREADS),
+			static_cast<unsigned int>(models.size()) / MIN_MODELS_PER_RASTER_THREAD
+	);
+
+	// The calling thread works too
+	StdVector<UniquePtr<Thread>> threads;
+	for (unsigned int i = 1; i < thread_count; ++i) {
+		UniquePtr<Thread> thread = make_unique_instance<Thread>();
+		thread->start(Context::run, &ctx);
+		threads.push_back(std::move(thread));
+	}
+
+	Context::run(&ctx);
+
+	for (UniquePtr<Thread> &thread : threads) {
+		thread->wait_to_finish();
+	}
+}
+
+} // namespace
+
+void get_lod_replacements(const VoxelBlockyLibraryBase::BakedData &baked_data, StdVector<uint16_t> &out_replacements) {
+	const unsigned int model_count = baked_data.models.size();
+	out_replacements.resize(model_count);
+	for (unsigned int i = 0; i < model_count; ++i) {
+		const int32_t id = baked_data.models[i].lod_replacement_id;
+		// Invalid IDs keep the model
+		out_replacements[i] = id >= 0 && static_cast<uint32_t>(id) < model_count ? id : i;
+	}
+}
+
+void get_light_properties(
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		blocky_light::ModelProperties &out_properties
+) {
+	const unsigned int model_count = baked_data.models.size();
+	out_properties.emission.resize(model_count);
+	out_properties.opaque.resize(model_count);
+	for (unsigned int i = 0; i < model_count; ++i) {
+		const VoxelBlockyModel::BakedData &model = baked_data.models[i];
+		out_properties.emission[i] = model.light_emission;
+		out_properties.opaque[i] = !model.empty && model.transparency_index == 0 && !model.is_transparent &&
+				model.model.full_sides_mask == (1 << Cube::SIDE_COUNT) - 1;
+	}
+}
+
+void get_simulation_properties(
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		blocky_simulation::ModelProperties &out_properties
+) {
+	const unsigned int model_count = baked_data.models.size();
+	out_properties.behaviors.resize(model_count);
+	out_properties.replaceable.resize(model_count);
+	for (unsigned int i = 0; i < model_count; ++i) {
+		const VoxelBlockyModel::BakedData &model = baked_data.models[i];
+		out_properties.behaviors[i] = model.simulation_behavior;
+		out_properties.replaceable[i] = model.empty;
+	}
+}
+
 void generate_side_culling_matrix(VoxelBlockyLibraryBase::BakedData &baked_data) {
 	ZN_PROFILE_SCOPE();
 	// When two blocky voxels are next to each other, they share a side.
@@ -190,13 +438,19 @@ void generate_side_culling_matrix(VoxelBlockyLibraryBase::BakedData &baked_data)
 	//	};
 
 	struct Pattern {
-		std::bitset<RASTER_SIZE * RASTER_SIZE> bitmap;
+		SideBitmap bitmap;
 		// StdVector<TypeAndSide> occurrences;
 	};
 
 	StdVector<Pattern> patterns;
+	// Finds existing patterns in constant time, libraries can have thousands of models
+	StdUnorderedMap<SideBitmap, uint32_t> pattern_indices;
 	uint32_t full_side_pattern_index = VoxelBlockyLibraryBase::NULL_INDEX;
 
+	// Rasterizing is what takes the most time, and doesn't depend on other models
+	StdVector<SideBitmap> side_bitmaps;
+	rasterize_sides_of_all_models(to_span_const(baked_data.models), side_bitmaps);
+
 	// Gather patterns for each model
 	for (uint16_t type_id = 0; type_id < baked_data.models.size(); ++type_id) {
 		VoxelBlockyModel::BakedData &model_data = baked_data.models[type_id];
@@ -204,40 +458,24 @@ void generate_side_culling_matrix(VoxelBlockyLibraryBase::BakedData &baked_data)
 
 		// For each side
 		for (uint16_t side = 0; side < Cube::SIDE_COUNT; ++side) {
-			std::bitset<RASTER_SIZE * RASTER_SIZE> bitmap;
-			rasterize_side_all_surfaces(model_data, side, bitmap);
-
-			{
-				std::bitset<RASTER_SIZE * RASTER_SIZE> full_bitmap;
-				full_bitmap.set();
-
-				if ((bitmap & full_bitmap) == full_bitmap) {
-					model_data.model.full_sides_mask |= (1 << side);
-				}
-			}
+			const SideBitmap &bitmap = side_bitmaps[type_id * Cube::SIDE_COUNT + side];
 
-			// Find if the same pattern already exists
-			uint32_t pattern_index = VoxelBlockyLibraryBase::NULL_INDEX;
-			for (unsigned int i = 0; i < patterns.size(); ++i) {
-				if (patterns[i].bitmap == bitmap) {
-					pattern_index = i;
-					break;
-				}
+			if (bitmap.all()) {
+				model_data.model.full_sides_mask |= (1 << side);
 			}
 
 			// Get or create pattern
-			Pattern *pattern = nullptr;
-			if (pattern_index != VoxelBlockyLibraryBase::NULL_INDEX) {
-				pattern = &patterns[pattern_index];
+			uint32_t pattern_index;
+			auto pattern_it = pattern_indices.find(bitmap);
+			if (pattern_it != pattern_indices.end()) {
+				pattern_index = pattern_it->second;
 			} else {
 				pattern_index = patterns.size();
 				patterns.push_back(Pattern());
-				pattern = &patterns.back();
-				pattern->bitmap = bitmap;
+				patterns.back().bitmap = bitmap;
+				pattern_indices.insert({ bitmap, pattern_index });
 			}
 
-			CRASH_COND(pattern == nullptr);
-
 			if (full_side_pattern_index == VoxelBlockyLibraryBase::NULL_INDEX && bitmap.all()) {
 				full_side_pattern_index = pattern_index;
 			}
@@ -252,6 +490,8 @@ void generate_side_culling_matrix(VoxelBlockyLibraryBase::BakedData &baked_data)
 		} // side
 	} // type
 
+	update_model_culling(baked_data);
+
 	// Find which pattern occludes which
 
 	baked_data.side_pattern_count = patterns.size();
@@ -337,4 +577,140 @@ void generate_side_culling_matrix(VoxelBlockyLibraryBase::BakedData &baked_data)
 	print_line("");*/
 }
 
+namespace {
+// Increment when the layout of side culling caches changes
+static const uint8_t SIDE_CULLING_CACHE_VERSION = 0;
+// Version, geometry hash, model count, pattern count
+static const unsigned int SIDE_CULLING_CACHE_HEADER_SIZE = 1 + 8 + 4 + 4;
+// Pattern indices, full sides mask, contributes to AO
+static const unsigned int SIDE_CULLING_CACHE_MODEL_SIZE = Cube::SIDE_COUNT * 4 + 1 + 1;
+} // namespace
+
+uint64_t get_side_culling_geometry_hash(const VoxelBlockyLibraryBase::BakedData &baked_data) {
+	ZN_PROFILE_SCOPE();
+
+	struct L {
+		static uint64_t hash_u32(uint32_t v, uint64_t h) {
+			return hash_fnv1a_64(reinterpret_cast<const uint8_t *>(&v), sizeof(v), h);
+		}
+		template <typename T>
+		static uint64_t hash_vector(const StdVector<T> &v, uint64_t h) {
+			h = hash_u32(v.size(), h);
+			return hash_fnv1a_64(reinterpret_cast<const uint8_t *>(v.data()), v.size() * sizeof(T), h);
+		}
+	};
+
+	// Only what rasterizing sides depends on. Also includes the version, so caches made by different formats or
+	// rasterization methods don't match.
+	uint64_t h = hash_fnv1a_64(&SIDE_CULLING_CACHE_VERSION, 1);
+	h = L::hash_u32(RASTER_SIZE, h);
+	h = L::hash_u32(baked_data.models.size(), h);
+
+	for (const VoxelBlockyModel::BakedData &model_data : baked_data.models) {
+		const VoxelBlockyModel::BakedData::Model &model = model_data.model;
+		h = L::hash_u32(model.surface_count, h);
+		for (unsigned int surface_index = 0; surface_index < model.surface_count; ++surface_index) {
+			const VoxelBlockyModel::BakedData::Surface &surface = model.surfaces[surface_index];
+			for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
+				const VoxelBlockyModel::BakedData::SideSurface &side_surface = surface.sides[side];
+				h = L::hash_vector(side_surface.positions, h);
+				h = L::hash_vector(side_surface.indices, h);
+			}
+		}
+	}
+
+	return h;
+}
+
+void save_side_culling_cache(
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		uint64_t geometry_hash,
+		StdVector<uint8_t> &dst
+) {
+	ZN_PROFILE_SCOPE();
+
+	MemoryWriter w(dst, ENDIANNESS_LITTLE_ENDIAN);
+	w.store_8(SIDE_CULLING_CACHE_VERSION);
+	w.store_64(geometry_hash);
+	w.store_32(baked_data.models.size());
+	w.store_32(baked_data.side_pattern_count);
+
+	for (const VoxelBlockyModel::BakedData &model_data : baked_data.models) {
+		for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
+			w.store_32(model_data.model.side_pattern_indices[side]);
+		}
+		w.store_8(model_data.model.full_sides_mask);
+		w.store_8(model_data.contributes_to_ao ? 1 : 0);
+	}
+
+	// Bits of the matrix, packed 8 per byte
+	const unsigned int bit_count = baked_data.side_pattern_culling.size();
+	for (unsigned int i = 0; i < bit_count; i += 8) {
+		uint8_t byte = 0;
+		for (unsigned int j = 0; j < 8 && i + j < bit_count; ++j) {
+			if (baked_data.side_pattern_culling.get(i + j)) {
+				byte |= (1 << j);
+			}
+		}
+		w.store_8(byte);
+	}
+}
+
+bool load_side_culling_cache(
+		VoxelBlockyLibraryBase::BakedData &baked_data,
+		uint64_t geometry_hash,
+		Span<const uint8_t> src
+) {
+	ZN_PROFILE_SCOPE();
+
+	if (src.size() < SIDE_CULLING_CACHE_HEADER_SIZE) {
+		return false;
+	}
+
+	MemoryReader r(src, ENDIANNESS_LITTLE_ENDIAN);
+	if (r.get_8() != SIDE_CULLING_CACHE_VERSION) {
+		return false;
+	}
+	if (r.get_64() != geometry_hash) {
+		// Models changed since the cache was saved
+		return false;
+	}
+	const uint32_t model_count = r.get_32();
+	const uint32_t pattern_count = r.get_32();
+	if (model_count != baked_data.models.size()) {
+		return false;
+	}
+
+	const uint64_t bit_count = static_cast<uint64_t>(pattern_count) * pattern_count;
+	const uint64_t expected_size = SIDE_CULLING_CACHE_HEADER_SIZE +
+			static_cast<uint64_t>(model_count) * SIDE_CULLING_CACHE_MODEL_SIZE + (bit_count + 7) / 8;
+	ZN_ASSERT_RETURN_V_MSG(src.size() == expected_size, false, "Side culling cache has unexpected size");
+
+	for (VoxelBlockyModel::BakedData &model_data : baked_data.models) {
+		for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
+			const uint32_t pattern_index = r.get_32();
+			ZN_ASSERT_RETURN_V_MSG(pattern_index < pattern_count, false, "Side culling cache is corrupted");
+			model_data.model.side_pattern_indices[side] = pattern_index;
+		}
+		model_data.model.full_sides_mask = r.get_8();
+		model_data.contributes_to_ao = r.get_8() != 0;
+	}
+
+	update_model_culling(baked_data);
+
+	baked_data.side_pattern_count = pattern_count;
+	baked_data.side_pattern_culling.resize_no_init(static_cast<unsigned int>(bit_count));
+	baked_data.side_pattern_culling.fill(false);
+	for (unsigned int i = 0; i < bit_count; i += 8) {
+		const uint8_t byte = r.get_8();
+		for (unsigned int j = 0; j < 8 && i + j < bit_count; ++j) {
+			if ((byte & (1 << j)) != 0) {
+				baked_data.side_pattern_culling.set(i + j);
+			}
+		}
+	}
+
+	return true;
+}
+
 } // namespace zylann::voxel
@@ -1,10 +1,13 @@
 #ifndef VOXEL_BLOCKY_LIBRARY_BASE_H
 #define VOXEL_BLOCKY_LIBRARY_BASE_H
 
+#include "../../storage/blocky_light.h"
+#include "../../storage/blocky_simulation.h"
 #include "../../util/containers/dynamic_bitset.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/resource.h"
-#include "../../util/thread/rw_lock.h"
+#include "../../util/memory/memory.h"
+#include "../../util/thread/mutex.h"
 #include "voxel_blocky_model.h"
 
 namespace zylann::voxel {
@@ -37,6 +40,22 @@ public:
 		// Lots of data can get moved but it's only on load.
 		StdVector<VoxelBlockyModel::BakedData> models;
 
+		// Compact copy of what meshing checks for every voxel and its neighbors. Model data is large, so it only has to
+		// be read when a face turns out to be visible.
+		struct ModelCulling {
+			FixedArray<uint32_t, Cube::SIDE_COUNT> side_pattern_indices;
+			uint8_t empty_sides_mask = 0;
+			// Sides made of a single quad covering the face of the cube, which greedy meshing can merge
+			uint8_t mergeable_sides_mask = 0;
+			uint8_t transparency_index = 0;
+			bool empty = true;
+			bool culls_neighbors = false;
+			bool contributes_to_ao = false;
+		};
+
+		// Indexed like `models`. Filled by `generate_side_culling_matrix`.
+		StdVector<ModelCulling> model_culling;
+
 		// struct VariantInfo {
 		// 	uint16_t type_index;
 		// 	FixedArray<uint8_t, 4> attributes;
@@ -46,6 +65,9 @@ public:
 
 		unsigned int indexed_materials_count = 0;
 
+		// Incremented every time the library is baked, so results derived from baked data can be invalidated
+		uint32_t revision = 0;
+
 		inline bool has_model(uint32_t i) const {
 			return i < models.size();
 		}
@@ -74,13 +96,15 @@ public:
 	//-------------------------
 	// Internal use
 
+	// Must be used from the main thread. Other threads must use `get_baked_data_snapshot`.
 	const BakedData &get_baked_data() const {
-		return _baked_data;
-	}
-	const RWLock &get_baked_data_rw_lock() const {
-		return _baked_data_rw_lock;
+		return *_baked_data;
 	}
 
+	// Gets the current baked data. It can be used from any thread without locking, because baking again publishes
+	// new data instead of modifying it. It stays valid as long as the pointer is kept.
+	std::shared_ptr<const BakedData> get_baked_data_snapshot() const;
+
 	Ref<Material> get_material_by_index(unsigned int index) const;
 	unsigned int get_material_index_count() const;
 
@@ -93,6 +117,8 @@ private:
 	// which can be passed to VoxelMesher::build for testing
 	TypedArray<Material> _b_get_materials() const;
 	void _b_bake();
+	PackedByteArray _b_get_side_culling_cache() const;
+	void _b_set_side_culling_cache(PackedByteArray data);
 
 	static void _bind_methods();
 
@@ -101,16 +127,71 @@ protected:
 	bool _needs_baking = true;
 	bool _bake_tangents = true;
 
-	// Used in multithread context by the mesher. Don't modify that outside of bake().
-	RWLock _baked_data_rw_lock;
-	BakedData _baked_data;
+	// Replaces current baked data. Must be called at the end of bake().
+	void publish_baked_data(BakedData &&baked_data);
+
+	// Generates side culling data of baked models, or loads it from the cache if their geometry is the same as when
+	// the cache was saved. Libraries with thousands of models would otherwise spend most of their loading time here.
+	void bake_side_culling(BakedData &baked_data);
+
+	// Used in multithread context by the mesher. Never modified once published.
+	std::shared_ptr<const BakedData> _baked_data = make_shared_instance<BakedData>();
+	// Only protects the pointer, not the data
+	mutable Mutex _baked_data_mutex;
 	// One of the entries can be null to represent "The default material". If all non-empty models have materials, there
 	// won't be a null entry.
 	StdVector<Ref<Material>> _indexed_materials;
+
+	// Side culling data of the last bake, saved with the library.
+	StdVector<uint8_t> _side_culling_cache;
 };
 
 void generate_side_culling_matrix(VoxelBlockyLibraryBase::BakedData &baked_data);
 
+// Side culling only depends on the geometry of sides, so its results can be saved and loaded later, as long as that
+// geometry has the same hash.
+uint64_t get_side_culling_geometry_hash(const VoxelBlockyLibraryBase::BakedData &baked_data);
+void save_side_culling_cache(
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		uint64_t geometry_hash,
+		StdVector<uint8_t> &dst
+);
+// Returns false if the cache doesn't match, in which case baked data must be generated instead.
+bool load_side_culling_cache(
+		VoxelBlockyLibraryBase::BakedData &baked_data,
+		uint64_t geometry_hash,
+		Span<const uint8_t> src
+);
+
+// Gets which model is used in place of each model when computing lower LODs, indexed by model ID
+void get_lod_replacements(const VoxelBlockyLibraryBase::BakedData &baked_data, StdVector<uint16_t> &out_replacements);
+
+// Gets light emitted by each model, and which models block light. Light only spreads through models that are not
+// opaque full cubes.
+void get_light_properties(
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		blocky_light::ModelProperties &out_properties
+);
+
+// Gets how each model is simulated. Simulated voxels can only move into empty models.
+void get_simulation_properties(
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		blocky_simulation::ModelProperties &out_properties
+);
+
+// Gets the axis perpendicular to a side, and the two axes along it
+void get_side_axes(unsigned int side, unsigned int &out_n, unsigned int &out_u, unsigned int &out_v);
+
+// Finds how UVs change along the axes of a side made of a single quad covering the whole face of the cube, so the
+// quad can be stretched over several voxels while repeating its texture. Returns false if the side is not such a quad.
+bool get_quad_uv_steps(
+		const VoxelBlockyModel::BakedData::SideSurface &side_surface,
+		unsigned int u_axis,
+		unsigned int v_axis,
+		Vector2f &out_u_step,
+		Vector2f &out_v_step
+);
+
 } // namespace zylann::voxel
 
 #endif // VOXEL_BLOCKY_LIBRARY_BASE_H
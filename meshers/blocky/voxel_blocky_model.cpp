@@ -1,4 +1,5 @@
 #include "voxel_blocky_model.h"
+#include "../../storage/blocky_light.h"
 #include "../../util/containers/container_funcs.h"
 #include "../../util/godot/classes/array_mesh.h"
 #include "../../util/godot/classes/base_material_3d.h"
@@ -239,6 +240,9 @@ void VoxelBlockyModel::bake(BakedData &baked_data, bool bake_tangents, MaterialI
 	baked_data.culls_neighbors = _culls_neighbors;
 	baked_data.color = _color;
 	baked_data.is_random_tickable = _random_tickable;
+	baked_data.lod_replacement_id = _lod_replacement_id;
+	baked_data.light_emission = _light_emission;
+	baked_data.simulation_behavior = blocky_simulation::Behavior(_simulation_behavior);
 	baked_data.box_collision_mask = _collision_mask;
 	baked_data.box_collision_aabbs = _collision_aabbs;
 
@@ -331,6 +335,36 @@ bool VoxelBlockyModel::is_random_tickable() const {
 	return _random_tickable;
 }
 
+void VoxelBlockyModel::set_lod_replacement_id(int id) {
+	ZN_ASSERT_RETURN(id >= -1 && id < static_cast<int>(VoxelBlockyLibraryBase::MAX_MODELS));
+	_lod_replacement_id = id;
+	emit_changed();
+}
+
+int VoxelBlockyModel::get_lod_replacement_id() const {
+	return _lod_replacement_id;
+}
+
+void VoxelBlockyModel::set_light_emission(int level) {
+	ZN_ASSERT_RETURN(level >= 0 && level <= blocky_light::MAX_LEVEL);
+	_light_emission = level;
+	emit_changed();
+}
+
+int VoxelBlockyModel::get_light_emission() const {
+	return _light_emission;
+}
+
+void VoxelBlockyModel::set_simulation_behavior(SimulationBehavior behavior) {
+	ZN_ASSERT_RETURN(behavior >= 0 && behavior < SIMULATION_BEHAVIOR_COUNT);
+	_simulation_behavior = behavior;
+	emit_changed();
+}
+
+VoxelBlockyModel::SimulationBehavior VoxelBlockyModel::get_simulation_behavior() const {
+	return _simulation_behavior;
+}
+
 bool VoxelBlockyModel::is_empty() const {
 	ZN_PRINT_ERROR("Not implemented");
 	// Implemented in child classes
@@ -343,6 +377,9 @@ void VoxelBlockyModel::copy_base_properties_from(const VoxelBlockyModel &src) {
 	_transparency_index = src._transparency_index;
 	_culls_neighbors = src._culls_neighbors;
 	_random_tickable = src._random_tickable;
+	_lod_replacement_id = src._lod_replacement_id;
+	_light_emission = src._light_emission;
+	_simulation_behavior = src._simulation_behavior;
 	_color = src._color;
 	_collision_aabbs = src._collision_aabbs;
 	_collision_mask = src._collision_mask;
@@ -567,6 +604,15 @@ void VoxelBlockyModel::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_random_tickable"), &VoxelBlockyModel::is_random_tickable);
 	ClassDB::bind_method(D_METHOD("set_random_tickable"), &VoxelBlockyModel::set_random_tickable);
 
+	ClassDB::bind_method(D_METHOD("set_lod_replacement_id", "id"), &VoxelBlockyModel::set_lod_replacement_id);
+	ClassDB::bind_method(D_METHOD("get_lod_replacement_id"), &VoxelBlockyModel::get_lod_replacement_id);
+
+	ClassDB::bind_method(D_METHOD("set_light_emission", "level"), &VoxelBlockyModel::set_light_emission);
+	ClassDB::bind_method(D_METHOD("get_light_emission"), &VoxelBlockyModel::get_light_emission);
+
+	ClassDB::bind_method(D_METHOD("set_simulation_behavior", "behavior"), &VoxelBlockyModel::set_simulation_behavior);
+	ClassDB::bind_method(D_METHOD("get_simulation_behavior"), &VoxelBlockyModel::get_simulation_behavior);
+
 	ClassDB::bind_method(
 			D_METHOD("set_mesh_collision_enabled", "surface_index", "enabled"),
 			&VoxelBlockyModel::set_mesh_collision_enabled
@@ -594,6 +640,21 @@ void VoxelBlockyModel::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "transparency_index"), "set_transparency_index", "get_transparency_index");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "culls_neighbors"), "set_culls_neighbors", "get_culls_neighbors");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "random_tickable"), "set_random_tickable", "is_random_tickable");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "lod_replacement_id", PROPERTY_HINT_RANGE, "-1,65535,1"),
+			"set_lod_replacement_id",
+			"get_lod_replacement_id"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "light_emission", PROPERTY_HINT_RANGE, "0,15,1"),
+			"set_light_emission",
+			"get_light_emission"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "simulation_behavior", PROPERTY_HINT_ENUM, "None,Fall,Flow,Spread"),
+			"set_simulation_behavior",
+			"get_simulation_behavior"
+	);
 
 	ADD_GROUP("Box collision", "");
 
@@ -621,6 +682,12 @@ void VoxelBlockyModel::_bind_methods() {
 	BIND_ENUM_CONSTANT(SIDE_NEGATIVE_Z);
 	BIND_ENUM_CONSTANT(SIDE_POSITIVE_Z);
 	BIND_ENUM_CONSTANT(SIDE_COUNT);
+
+	BIND_ENUM_CONSTANT(SIMULATION_NONE);
+	BIND_ENUM_CONSTANT(SIMULATION_FALL);
+	BIND_ENUM_CONSTANT(SIMULATION_FLOW);
+	BIND_ENUM_CONSTANT(SIMULATION_SPREAD);
+	BIND_ENUM_CONSTANT(SIMULATION_BEHAVIOR_COUNT);
 }
 
 } // namespace zylann::voxel
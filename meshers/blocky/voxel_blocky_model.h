@@ -2,6 +2,7 @@
 #define VOXEL_BLOCKY_MODEL_H
 
 #include "../../constants/cube_tables.h"
+#include "../../storage/blocky_simulation.h"
 #include "../../util/containers/fixed_array.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/material.h"
@@ -110,6 +111,12 @@ public:
 		bool empty;
 		bool is_random_tickable;
 		bool is_transparent;
+		// Model used in place of this one when computing lower LODs. -1 means this model is kept.
+		int32_t lod_replacement_id = -1;
+		// Level of light emitted by voxels of this model, from 0 to 15
+		uint8_t light_emission = 0;
+		// How voxels of this model move or spread when the terrain simulates them
+		blocky_simulation::Behavior simulation_behavior = blocky_simulation::BEHAVIOR_NONE;
 
 		uint32_t box_collision_mask;
 		StdVector<AABB> box_collision_aabbs;
@@ -132,6 +139,14 @@ public:
 		SIDE_COUNT = Cube::SIDE_COUNT
 	};
 
+	enum SimulationBehavior {
+		SIMULATION_NONE = blocky_simulation::BEHAVIOR_NONE,
+		SIMULATION_FALL = blocky_simulation::BEHAVIOR_FALL,
+		SIMULATION_FLOW = blocky_simulation::BEHAVIOR_FLOW,
+		SIMULATION_SPREAD = blocky_simulation::BEHAVIOR_SPREAD,
+		SIMULATION_BEHAVIOR_COUNT = blocky_simulation::BEHAVIOR_COUNT
+	};
+
 	// Properties
 
 	void set_color(Color color);
@@ -168,6 +183,15 @@ public:
 	void set_random_tickable(bool rt);
 	bool is_random_tickable() const;
 
+	void set_lod_replacement_id(int id);
+	int get_lod_replacement_id() const;
+
+	void set_light_emission(int level);
+	int get_light_emission() const;
+
+	void set_simulation_behavior(SimulationBehavior behavior);
+	SimulationBehavior get_simulation_behavior() const;
+
 	void set_mesh_ortho_rotation_index(int i);
 	int get_mesh_ortho_rotation_index() const;
 
@@ -256,6 +280,10 @@ private:
 	bool _culls_neighbors = true;
 	bool _random_tickable = false;
 	uint8_t _mesh_ortho_rotation = 0;
+	// Model used in place of this one when computing lower LODs. -1 keeps this model.
+	int32_t _lod_replacement_id = -1;
+	uint8_t _light_emission = 0;
+	SimulationBehavior _simulation_behavior = SIMULATION_NONE;
 
 	Color _color;
 
@@ -265,5 +293,6 @@ private:
 } // namespace zylann::voxel
 
 VARIANT_ENUM_CAST(zylann::voxel::VoxelBlockyModel::Side)
+VARIANT_ENUM_CAST(zylann::voxel::VoxelBlockyModel::SimulationBehavior)
 
 #endif // VOXEL_BLOCKY_MODEL_H
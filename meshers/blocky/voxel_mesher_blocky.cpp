@@ -1,14 +1,20 @@
 #include "voxel_mesher_blocky.h"
 #include "../../constants/cube_tables.h"
+#include "../../storage/blocky_light.h"
 #include "../../storage/voxel_buffer.h"
+#include "../../storage/voxel_buffer_gd.h"
+#include "../../util/containers/container_funcs.h"
 #include "../../util/containers/span.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/core/packed_arrays.h"
 #include "../../util/macros.h"
+#include "../../util/math/box3i.h"
 #include "../../util/math/conv.h"
 // TODO GDX: String has no `operator+=`
 #include "../../util/godot/core/string.h"
 #include "../../util/profiling.h"
+#include "../occluder_boxes.h"
+#include "blocky_section_cache.h"
 
 using namespace zylann::godot;
 
@@ -27,18 +33,18 @@ const int g_opposite_side[6] = {
 
 inline bool is_face_visible(
 		const VoxelBlockyLibraryBase::BakedData &lib,
-		const VoxelBlockyModel::BakedData &vt,
+		const VoxelBlockyLibraryBase::BakedData::ModelCulling &vt,
 		uint32_t other_voxel_id,
 		int side
 ) {
-	if (other_voxel_id < lib.models.size()) {
-		const VoxelBlockyModel::BakedData &other_vt = lib.models[other_voxel_id];
+	if (other_voxel_id < lib.model_culling.size()) {
+		const VoxelBlockyLibraryBase::BakedData::ModelCulling &other_vt = lib.model_culling[other_voxel_id];
 		// TODO Maybe we could get rid of `empty` here and instead set `culls_neighbors` to false during baking
 		if (other_vt.empty || (other_vt.transparency_index > vt.transparency_index) || !other_vt.culls_neighbors) {
 			return true;
 		} else {
-			const unsigned int ai = vt.model.side_pattern_indices[side];
-			const unsigned int bi = other_vt.model.side_pattern_indices[g_opposite_side[side]];
+			const unsigned int ai = vt.side_pattern_indices[side];
+			const unsigned int bi = other_vt.side_pattern_indices[g_opposite_side[side]];
 			// Patterns are not the same, and B does not occlude A
 			return (ai != bi) && !lib.get_side_pattern_occlusion(bi, ai);
 		}
@@ -47,9 +53,8 @@ inline bool is_face_visible(
 }
 
 inline bool contributes_to_ao(const VoxelBlockyLibraryBase::BakedData &lib, uint32_t voxel_id) {
-	if (voxel_id < lib.models.size()) {
-		const VoxelBlockyModel::BakedData &t = lib.models[voxel_id];
-		return t.contributes_to_ao;
+	if (voxel_id < lib.model_culling.size()) {
+		return lib.model_culling[voxel_id].contributes_to_ao;
 	}
 	return true;
 }
@@ -59,6 +64,30 @@ StdVector<int> &get_tls_index_offsets() {
 	return tls_index_offsets;
 }
 
+// Per side, one key per voxel of the block telling which face to merge there. 0 means no face.
+FixedArray<StdVector<uint32_t>, Cube::SIDE_COUNT> &get_tls_greedy_keys() {
+	static thread_local FixedArray<StdVector<uint32_t>, Cube::SIDE_COUNT> tls_greedy_keys;
+	return tls_greedy_keys;
+}
+
+inline uint32_t make_greedy_key(uint32_t voxel_id, uint8_t light_level, uint8_t ao) {
+	return ((voxel_id << 6) | (light_level << 2) | ao) + 1;
+}
+
+inline uint8_t get_light_level(const Span<const uint8_t> light_buffer, int voxel_index) {
+	// Without light, everything is fully lit
+	return light_buffer.size() > 0 ? (light_buffer[voxel_index] & blocky_light::LEVEL_MASK) : blocky_light::MAX_LEVEL;
+}
+
+inline Color get_light_color(uint8_t light_level, float min_brightness) {
+	if (light_level == blocky_light::MAX_LEVEL) {
+		return Color(1, 1, 1);
+	}
+	const float b = min_brightness +
+			(1.f - min_brightness) * static_cast<float>(light_level) / static_cast<float>(blocky_light::MAX_LEVEL);
+	return Color(b, b, b);
+}
+
 } // namespace
 
 template <typename Type_T>
@@ -67,9 +96,16 @@ void generate_blocky_mesh( //
 		VoxelMesher::Output::CollisionSurface *collision_surface, //
 		const Span<const Type_T> type_buffer, //
 		const Vector3i block_size, //
+		// Area of voxels to mesh, in padded coordinates
+		const Vector3i min, //
+		const Vector3i max, //
 		const VoxelBlockyLibraryBase::BakedData &library, //
 		bool bake_occlusion, //
-		float baked_occlusion_darkness //
+		float baked_occlusion_darkness, //
+		bool greedy_meshing, //
+		// Light levels of voxels, laid out like types. Empty if light is not used.
+		const Span<const uint8_t> light_buffer, //
+		float light_min_brightness //
 ) {
 	// TODO Optimization: not sure if this mandates a template function. There is so much more happening in this
 	// function other than reading voxels, although reading is on the hottest path. It needs to be profiled. If
@@ -81,22 +117,33 @@ void generate_blocky_mesh( //
 			block_size.z < static_cast<int>(2 * VoxelMesherBlocky::PADDING)
 	);
 
+	// Data must be padded, hence the off-by-one
+	const Vector3i padding = Vector3iUtil::create(VoxelMesherBlocky::PADDING);
+	ZN_ASSERT_RETURN(Box3i::from_min_max(padding, block_size - padding).encloses(Box3i::from_min_max(min, max)));
+
 	// Build lookup tables so to speed up voxel access.
 	// These are values to add to an address in order to get given neighbor.
 
 	const int row_size = block_size.y;
 	const int deck_size = block_size.x * row_size;
 
-	// Data must be padded, hence the off-by-one
-	const Vector3i min = Vector3iUtil::create(VoxelMesherBlocky::PADDING);
-	const Vector3i max = block_size - Vector3iUtil::create(VoxelMesherBlocky::PADDING);
-
 	StdVector<int> &index_offsets = get_tls_index_offsets();
 	index_offsets.clear();
 	index_offsets.resize(out_arrays_per_material.size(), 0);
 
 	int collision_surface_index_offset = 0;
 
+	FixedArray<StdVector<uint32_t>, Cube::SIDE_COUNT> &greedy_keys = get_tls_greedy_keys();
+	if (greedy_meshing) {
+		// Keys are all consumed by the greedy pass, so buffers are left zeroed for the next call
+		const unsigned int volume = Vector3iUtil::get_volume(block_size);
+		for (StdVector<uint32_t> &keys : greedy_keys) {
+			if (keys.size() != volume) {
+				keys.assign(volume, 0);
+			}
+		}
+	}
+
 	FixedArray<int, Cube::SIDE_COUNT> side_neighbor_lut;
 	side_neighbor_lut[Cube::SIDE_LEFT] = row_size;
 	side_neighbor_lut[Cube::SIDE_RIGHT] = -row_size;
@@ -166,6 +213,8 @@ void generate_blocky_mesh( //
 					continue;
 				}
 
+				// Culling only reads compact data, geometry is accessed once a face turns out to be visible
+				const VoxelBlockyLibraryBase::BakedData::ModelCulling &culling = library.model_culling[voxel_id];
 				const VoxelBlockyModel::BakedData &voxel = library.models[voxel_id];
 				const VoxelBlockyModel::BakedData::Model &model = voxel.model;
 
@@ -174,17 +223,20 @@ void generate_blocky_mesh( //
 
 				// Sides
 				for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
-					if ((model.empty_sides_mask & (1 << side)) != 0) {
+					if ((culling.empty_sides_mask & (1 << side)) != 0) {
 						// This side is empty
 						continue;
 					}
 
 					const uint32_t neighbor_voxel_id = type_buffer[voxel_index + side_neighbor_lut[side]];
 
-					if (!is_face_visible(library, voxel, neighbor_voxel_id, side)) {
+					if (!is_face_visible(library, culling, neighbor_voxel_id, side)) {
 						continue;
 					}
 
+					// Sides are lit by the voxel they face
+					const uint8_t light_level = get_light_level(light_buffer, voxel_index + side_neighbor_lut[side]);
+
 					// The face is visible
 
 					int shaded_corner[8] = { 0 };
@@ -220,6 +272,19 @@ void generate_blocky_mesh( //
 						}
 					}
 
+					if (greedy_meshing && (culling.mergeable_sides_mask & (1 << side)) != 0) {
+						// Faces can only be merged if their 4 corners have the same occlusion, otherwise it would not
+						// be interpolated the same way
+						const unsigned int *side_corners = Cube::g_side_corners[side];
+						const int ao = shaded_corner[side_corners[0]];
+						if (shaded_corner[side_corners[1]] == ao && shaded_corner[side_corners[2]] == ao &&
+							shaded_corner[side_corners[3]] == ao) {
+							// Deferred to the greedy pass
+							greedy_keys[side][voxel_index] = make_greedy_key(voxel_id, light_level, ao);
+							continue;
+						}
+					}
+
 					// Subtracting 1 because the data is padded
 					const Vector3f pos(x - 1, y - 1, z - 1);
 
@@ -277,7 +342,8 @@ void generate_blocky_mesh( //
 							const int append_index = arrays.colors.size();
 							arrays.colors.resize(arrays.colors.size() + vertex_count);
 							Color *w = arrays.colors.data() + append_index;
-							const Color modulate_color = voxel.color;
+							const Color modulate_color =
+									voxel.color * get_light_color(light_level, light_min_brightness);
 
 							if (bake_occlusion) {
 								for (unsigned int i = 0; i < vertex_count; ++i) {
@@ -372,7 +438,8 @@ void generate_blocky_mesh( //
 
 					const StdVector<Vector3f> &positions = surface.positions;
 					const unsigned int vertex_count = positions.size();
-					const Color modulate_color = voxel.color;
+					const Color modulate_color = voxel.color *
+							get_light_color(get_light_level(light_buffer, voxel_index), light_min_brightness);
 
 					const StdVector<Vector3f> &normals = surface.normals;
 					const StdVector<Vector2f> &uvs = surface.uvs;
@@ -422,6 +489,292 @@ void generate_blocky_mesh( //
 			}
 		}
 	}
+
+	if (!greedy_meshing) {
+		return;
+	}
+
+	// Greedy pass: merge rectangles of identical faces into single quads.
+	// See https://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
+
+	const Vector3i jump(row_size, 1, deck_size);
+
+	for (unsigned int side = 0; side < Cube::SIDE_COUNT; ++side) {
+		StdVector<uint32_t> &keys = greedy_keys[side];
+
+		unsigned int n_axis;
+		unsigned int u_axis;
+		unsigned int v_axis;
+		get_side_axes(side, n_axis, u_axis, v_axis);
+
+		const int u_jump = jump[u_axis];
+		const int v_jump = jump[v_axis];
+
+		Vector3i p;
+		for (p[n_axis] = min[n_axis]; p[n_axis] < max[n_axis]; ++p[n_axis]) {
+			for (p[v_axis] = min[v_axis]; p[v_axis] < max[v_axis]; ++p[v_axis]) {
+				for (p[u_axis] = min[u_axis]; p[u_axis] < max[u_axis]; ++p[u_axis]) {
+					const int voxel_index = p.y + p.x * row_size + p.z * deck_size;
+					const uint32_t key = keys[voxel_index];
+					if (key == 0) {
+						continue;
+					}
+
+					// Expand along U
+					int width = 1;
+					while (p[u_axis] + width < max[u_axis] && keys[voxel_index + width * u_jump] == key) {
+						++width;
+					}
+
+					// Expand along V while the whole row matches
+					int height = 1;
+					while (p[v_axis] + height < max[v_axis]) {
+						const int row_index = voxel_index + height * v_jump;
+						bool row_matches = true;
+						for (int i = 0; i < width; ++i) {
+							if (keys[row_index + i * u_jump] != key) {
+								row_matches = false;
+								break;
+							}
+						}
+						if (!row_matches) {
+							break;
+						}
+						++height;
+					}
+
+					// Consume merged faces
+					for (int j = 0; j < height; ++j) {
+						for (int i = 0; i < width; ++i) {
+							keys[voxel_index + i * u_jump + j * v_jump] = 0;
+						}
+					}
+
+					const uint32_t voxel_id = (key - 1) >> 6;
+					const uint8_t light_level = ((key - 1) >> 2) & blocky_light::LEVEL_MASK;
+					const uint32_t ao = (key - 1) & 3;
+
+					const VoxelBlockyModel::BakedData &voxel = library.models[voxel_id];
+					const VoxelBlockyModel::BakedData::Surface &surface = voxel.model.surfaces[0];
+					const VoxelBlockyModel::BakedData::SideSurface &side_surface = surface.sides[side];
+
+					Vector2f u_step;
+					Vector2f v_step;
+					get_quad_uv_steps(side_surface, u_axis, v_axis, u_step, v_step);
+
+					// Subtracting 1 because the data is padded
+					const Vector3f pos(p.x - 1, p.y - 1, p.z - 1);
+					Vector3f scale(1.f);
+					scale[u_axis] = width;
+					scale[v_axis] = height;
+
+					VoxelMesherBlocky::Arrays &arrays = out_arrays_per_material[surface.material_id];
+					int &index_offset = index_offsets[surface.material_id];
+
+					const float shade = 1.f - baked_occlusion_darkness * static_cast<float>(ao);
+					const Color light_color = get_light_color(light_level, light_min_brightness);
+					const Color color = Color(shade, shade, shade) * voxel.color * light_color;
+					const Vector3f normal = to_vec3f(Cube::g_side_normals[side]);
+
+					for (unsigned int i = 0; i < 4; ++i) {
+						const Vector3f vp = side_surface.positions[i];
+						arrays.positions.push_back(pos + vp * scale);
+						// Extend UVs beyond the face so the texture repeats over the merged quad
+						arrays.uvs.push_back(
+								side_surface.uvs[i] + u_step * (vp[u_axis] * (width - 1)) +
+								v_step * (vp[v_axis] * (height - 1))
+						);
+						arrays.normals.push_back(normal);
+						arrays.colors.push_back(color);
+					}
+
+					if (side_surface.tangents.size() > 0) {
+						const int append_index = arrays.tangents.size();
+						arrays.tangents.resize(arrays.tangents.size() + 4 * 4);
+						memcpy(arrays.tangents.data() + append_index,
+							   side_surface.tangents.data(),
+							   (4 * 4) * sizeof(float));
+					}
+
+					for (unsigned int i = 0; i < 6; ++i) {
+						arrays.indices.push_back(index_offset + side_surface.indices[i]);
+					}
+
+					if (collision_surface != nullptr && surface.collision_enabled) {
+						for (unsigned int i = 0; i < 4; ++i) {
+							collision_surface->positions.push_back(pos + side_surface.positions[i] * scale);
+						}
+						for (unsigned int i = 0; i < 6; ++i) {
+							collision_surface->indices.push_back(
+									collision_surface_index_offset + side_surface.indices[i]
+							);
+						}
+						collision_surface_index_offset += 4;
+					}
+
+					index_offset += 4;
+				}
+			}
+		}
+	}
+}
+
+// Appends voxels of the given area to `dst` as bytes, in the same order as VoxelBuffer (ZXY)
+template <typename Type_T>
+void copy_section_voxels(
+		const Span<const Type_T> type_buffer,
+		const Vector3i block_size,
+		const Vector3i min,
+		const Vector3i max,
+		StdVector<uint8_t> &dst
+) {
+	const Vector3i size = max - min;
+	const unsigned int column_size_in_bytes = size.y * sizeof(Type_T);
+	const size_t append_index = dst.size();
+	dst.resize(append_index + size.x * size.z * column_size_in_bytes);
+	uint8_t *w = dst.data() + append_index;
+	for (int z = min.z; z < max.z; ++z) {
+		for (int x = min.x; x < max.x; ++x) {
+			const unsigned int src_index = Vector3iUtil::get_zxy_index(Vector3i(x, min.y, z), block_size);
+			memcpy(w, type_buffer.data() + src_index, column_size_in_bytes);
+			w += column_size_in_bytes;
+		}
+	}
+}
+
+void append_indices(StdVector<int> &dst, const StdVector<int> &src, const int index_offset) {
+	const size_t append_index = dst.size();
+	dst.resize(append_index + src.size());
+	int *w = dst.data() + append_index;
+	for (size_t i = 0; i < src.size(); ++i) {
+		w[i] = src[i] + index_offset;
+	}
+}
+
+void append_arrays(VoxelMesherBlocky::Arrays &dst, const VoxelMesherBlocky::Arrays &src) {
+	append_indices(dst.indices, src.indices, dst.positions.size());
+	append_array(dst.positions, src.positions);
+	append_array(dst.normals, src.normals);
+	append_array(dst.uvs, src.uvs);
+	append_array(dst.colors, src.colors);
+	append_array(dst.tangents, src.tangents);
+}
+
+// Same as `generate_blocky_mesh`, but the block is meshed in sections. Sections whose voxels didn't change since the
+// block was last meshed are taken from the cache instead of being meshed again, and all sections are then spliced
+// together. Greedy meshing does not merge faces across sections.
+template <typename Type_T>
+void generate_blocky_mesh_in_sections(
+		StdVector<VoxelMesherBlocky::Arrays> &out_arrays_per_material,
+		VoxelMesher::Output::CollisionSurface *collision_surface,
+		const Span<const Type_T> type_buffer,
+		const Vector3i block_size,
+		const VoxelBlockyLibraryBase::BakedData &library,
+		bool bake_occlusion,
+		float baked_occlusion_darkness,
+		bool greedy_meshing,
+		const Span<const uint8_t> light_buffer,
+		float light_min_brightness,
+		// Changes when parameters affecting geometry change
+		uint32_t parameters_revision,
+		BlockySectionCache &section_cache,
+		const Vector3i origin_in_voxels
+) {
+	ZN_PROFILE_SCOPE();
+
+	using Section = BlockySectionCache::Section;
+	using Block = BlockySectionCache::Block;
+
+	const Vector3i padding = Vector3iUtil::create(VoxelMesherBlocky::PADDING);
+	const Vector3i section_size = Vector3iUtil::create(BlockySectionCache::SECTION_SIZE);
+	const Vector3i section_counts = math::ceildiv(block_size - padding * 2, section_size);
+
+	std::shared_ptr<const Block> previous_block = section_cache.get(origin_in_voxels);
+	if (previous_block != nullptr &&
+		(previous_block->block_size != block_size || previous_block->parameters_revision != parameters_revision ||
+		 previous_block->library_revision != library.revision || previous_block->bytes_per_voxel != sizeof(Type_T) ||
+		 previous_block->collision != (collision_surface != nullptr))) {
+		previous_block = nullptr;
+	}
+
+	std::shared_ptr<Block> block = make_shared_instance<Block>();
+	block->block_size = block_size;
+	block->parameters_revision = parameters_revision;
+	block->library_revision = library.revision;
+	block->bytes_per_voxel = sizeof(Type_T);
+	block->collision = collision_surface != nullptr;
+	block->sections.resize(Vector3iUtil::get_volume(section_counts));
+
+	static thread_local StdVector<uint8_t> tls_section_voxels;
+	StdVector<uint8_t> &section_voxels = tls_section_voxels;
+
+	unsigned int section_index = 0;
+	Vector3i section_position;
+	for (section_position.z = 0; section_position.z < section_counts.z; ++section_position.z) {
+		for (section_position.x = 0; section_position.x < section_counts.x; ++section_position.x) {
+			for (section_position.y = 0; section_position.y < section_counts.y; ++section_position.y) {
+				const Vector3i min = padding + section_position * BlockySectionCache::SECTION_SIZE;
+				const Vector3i max = math::min(min + section_size, block_size - padding);
+
+				// Neighbors are read when meshing the section, so they have to match too
+				section_voxels.clear();
+				copy_section_voxels(type_buffer, block_size, min - padding, max + padding, section_voxels);
+				if (light_buffer.size() > 0) {
+					copy_section_voxels(light_buffer, block_size, min - padding, max + padding, section_voxels);
+				}
+
+				if (previous_block != nullptr) {
+					const std::shared_ptr<const Section> &previous_section = previous_block->sections[section_index];
+					if (previous_section->voxels == section_voxels) {
+						block->sections[section_index] = previous_section;
+						++section_index;
+						continue;
+					}
+				}
+
+				std::shared_ptr<Section> section = make_shared_instance<Section>();
+				section->voxels = section_voxels;
+				section->arrays_per_material.resize(library.indexed_materials_count);
+
+				VoxelMesher::Output::CollisionSurface section_collision_surface;
+
+				generate_blocky_mesh(
+						section->arrays_per_material,
+						collision_surface != nullptr ? &section_collision_surface : nullptr,
+						type_buffer,
+						block_size,
+						min,
+						max,
+						library,
+						bake_occlusion,
+						baked_occlusion_darkness,
+						greedy_meshing,
+						light_buffer,
+						light_min_brightness
+				);
+
+				section->collision_positions = std::move(section_collision_surface.positions);
+				section->collision_indices = std::move(section_collision_surface.indices);
+
+				block->sections[section_index] = section;
+				++section_index;
+			}
+		}
+	}
+
+	for (const std::shared_ptr<const Section> &section : block->sections) {
+		for (unsigned int material_index = 0; material_index < section->arrays_per_material.size(); ++material_index) {
+			append_arrays(out_arrays_per_material[material_index], section->arrays_per_material[material_index]);
+		}
+		if (collision_surface != nullptr) {
+			append_indices(
+					collision_surface->indices, section->collision_indices, collision_surface->positions.size()
+			);
+			append_array(collision_surface->positions, section->collision_positions);
+		}
+	}
+
+	section_cache.set(origin_in_voxels, block);
 }
 
 struct OccluderArrays {
@@ -827,6 +1180,44 @@ void generate_shadow_occluders(
 	);
 }
 
+// Only opaque models with all sides full can be used as occluders, because they entirely hide what is inside them
+inline bool is_occluder_model(const VoxelBlockyModel::BakedData &model) {
+	return !model.empty && model.transparency_index == 0 && !model.is_transparent &&
+			model.model.full_sides_mask == (1 << Cube::SIDE_COUNT) - 1;
+}
+
+template <typename TModelID>
+void generate_occluder_boxes(
+		StdVector<Box3f> &out_boxes,
+		Span<const TModelID> id_buffer,
+		const Vector3i block_size,
+		const VoxelBlockyLibraryBase::BakedData &baked_data,
+		const float scale
+) {
+	ZN_PROFILE_SCOPE();
+
+	const Vector3i min = Vector3iUtil::create(VoxelMesherBlocky::PADDING);
+	const Vector3i max = block_size - Vector3iUtil::create(VoxelMesherBlocky::PADDING);
+	const Vector3i grid_size = max - min;
+
+	static thread_local StdVector<uint8_t> tls_solid_cells;
+	StdVector<uint8_t> &solid_cells = tls_solid_cells;
+	solid_cells.resize(Vector3iUtil::get_volume(grid_size));
+
+	unsigned int cell_index = 0;
+	for (int z = min.z; z < max.z; ++z) {
+		for (int x = min.x; x < max.x; ++x) {
+			for (int y = min.y; y < max.y; ++y) {
+				const TModelID id = id_buffer[Vector3iUtil::get_zxy_index(Vector3i(x, y, z), block_size)];
+				solid_cells[cell_index] = id < baked_data.models.size() && is_occluder_model(baked_data.models[id]);
+				++cell_index;
+			}
+		}
+	}
+
+	find_occluder_boxes(to_span(solid_cells), grid_size, Vector3f(), scale, out_boxes);
+}
+
 bool is_empty(const StdVector<VoxelMesherBlocky::Arrays> &arrays_per_material) {
 	for (const VoxelMesherBlocky::Arrays &arrays : arrays_per_material) {
 		if (arrays.indices.size() > 0) {
@@ -1036,6 +1427,7 @@ void append_seams(
 
 VoxelMesherBlocky::VoxelMesherBlocky() {
 	set_padding(PADDING, PADDING);
+	_section_cache = make_unique_instance<BlockySectionCache>();
 }
 
 VoxelMesherBlocky::~VoxelMesherBlocky() {}
@@ -1048,6 +1440,7 @@ VoxelMesherBlocky::Cache &VoxelMesherBlocky::get_tls_cache() {
 void VoxelMesherBlocky::set_library(Ref<VoxelBlockyLibraryBase> library) {
 	RWLockWrite wlock(_parameters_lock);
 	_parameters.library = library;
+	++_parameters.geometry_revision;
 }
 
 Ref<VoxelBlockyLibraryBase> VoxelMesherBlocky::get_library() const {
@@ -1058,6 +1451,7 @@ Ref<VoxelBlockyLibraryBase> VoxelMesherBlocky::get_library() const {
 void VoxelMesherBlocky::set_occlusion_darkness(float darkness) {
 	RWLockWrite wlock(_parameters_lock);
 	_parameters.baked_occlusion_darkness = math::clamp(darkness, 0.0f, 1.0f);
+	++_parameters.geometry_revision;
 }
 
 float VoxelMesherBlocky::get_occlusion_darkness() const {
@@ -1068,6 +1462,7 @@ float VoxelMesherBlocky::get_occlusion_darkness() const {
 void VoxelMesherBlocky::set_occlusion_enabled(bool enable) {
 	RWLockWrite wlock(_parameters_lock);
 	_parameters.bake_occlusion = enable;
+	++_parameters.geometry_revision;
 }
 
 bool VoxelMesherBlocky::get_occlusion_enabled() const {
@@ -1075,6 +1470,87 @@ bool VoxelMesherBlocky::get_occlusion_enabled() const {
 	return _parameters.bake_occlusion;
 }
 
+void VoxelMesherBlocky::set_greedy_meshing_enabled(bool enable) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.greedy_meshing = enable;
+	++_parameters.geometry_revision;
+}
+
+bool VoxelMesherBlocky::is_greedy_meshing_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.greedy_meshing;
+}
+
+void VoxelMesherBlocky::set_vertex_compression_enabled(bool enable) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.vertex_compression = enable;
+}
+
+bool VoxelMesherBlocky::is_vertex_compression_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.vertex_compression;
+}
+
+void VoxelMesherBlocky::set_incremental_meshing_enabled(bool enable) {
+	{
+		RWLockWrite wlock(_parameters_lock);
+		_parameters.incremental_meshing = enable;
+	}
+	if (!enable) {
+		_section_cache->clear();
+	}
+}
+
+bool VoxelMesherBlocky::is_incremental_meshing_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.incremental_meshing;
+}
+
+void VoxelMesherBlocky::set_occluder_boxes_enabled(bool enable) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.occluder_boxes = enable;
+}
+
+bool VoxelMesherBlocky::is_occluder_boxes_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.occluder_boxes;
+}
+
+void VoxelMesherBlocky::set_light_enabled(bool enable) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.light_enabled = enable;
+	++_parameters.geometry_revision;
+}
+
+bool VoxelMesherBlocky::is_light_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.light_enabled;
+}
+
+void VoxelMesherBlocky::set_light_channel(int channel) {
+	ZN_ASSERT_RETURN(channel >= 0 && channel < VoxelBuffer::MAX_CHANNELS);
+	ZN_ASSERT_RETURN_MSG(channel != VoxelBuffer::CHANNEL_TYPE, "Light can't be stored in the TYPE channel");
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.light_channel = channel;
+	++_parameters.geometry_revision;
+}
+
+int VoxelMesherBlocky::get_light_channel() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.light_channel;
+}
+
+void VoxelMesherBlocky::set_light_min_brightness(float brightness) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.light_min_brightness = math::clamp(brightness, 0.f, 1.f);
+	++_parameters.geometry_revision;
+}
+
+float VoxelMesherBlocky::get_light_min_brightness() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.light_min_brightness;
+}
+
 void VoxelMesherBlocky::set_shadow_occluder_side(Side side, bool enabled) {
 	RWLockWrite wlock(_parameters_lock);
 	if (enabled) {
@@ -1109,6 +1585,12 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 	}
 	// ERR_FAIL_COND(params.library.is_null());
 
+	// Baking the library again publishes new data instead of modifying this one, so it can be read without locking.
+	// The same snapshot is used for the whole block so all parts of the mesh agree.
+	const std::shared_ptr<const VoxelBlockyLibraryBase::BakedData> library_baked_data_snapshot =
+			params.library->get_baked_data_snapshot();
+	const VoxelBlockyLibraryBase::BakedData &library_baked_data = *library_baked_data_snapshot;
+
 	Cache &cache = get_tls_cache();
 
 	StdVector<Arrays> &arrays_per_material = cache.arrays_per_material;
@@ -1123,12 +1605,13 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 	}
 
 	// The technique is Culled faces.
-	// Could be improved with greedy meshing: https://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
-	// However I don't feel it's worth it yet:
+	// Optionally, full sides of cubes can be merged with greedy meshing:
+	// https://0fps.net/2012/06/30/meshing-in-a-minecraft-game/
+	// It isn't the default because:
 	// - Not so much gain for organic worlds with lots of texture variations
 	// - Works well with cubes but not with any shape
+	// - Textures must be able to repeat over merged quads, which isn't the case with atlases
 	// - Slower
-	// => Could be implemented in a separate class?
 
 	const VoxelBuffer &voxels = input.voxels;
 
@@ -1145,6 +1628,15 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 		// TODO Handle edge case of uniform block with non-cubic voxels!
 		// If the type of voxel still produces geometry in this situation (which is an absurd use case but not an
 		// error), decompress into a backing array to still allow the use of the same algorithm.
+		if (params.occluder_boxes) {
+			// A block entirely made of solid cubes can be fully used as an occluder
+			const uint64_t id = voxels.get_voxel(0, 0, 0, channel);
+			if (id < library_baked_data.models.size() && is_occluder_model(library_baked_data.models[id])) {
+				const float lod_scale = 1 << input.lod_index;
+				const Vector3i size = voxels.get_size() - Vector3iUtil::create(2 * PADDING);
+				output.occluder_boxes.push_back(Box3f{ Vector3f(), to_vec3f(size) * lod_scale });
+			}
+		}
 		return;
 
 	} else if (voxels.get_channel_compression(channel) != VoxelBuffer::COMPRESSION_NONE) {
@@ -1168,11 +1660,28 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 		collision_surface = &output.collision_surface;
 	}
 
+	// Light levels are indexed like types. Left empty when light is not used.
+	Span<const uint8_t> light_buffer;
+	if (params.light_enabled) {
+		const unsigned int light_channel = params.light_channel;
+		if (voxels.get_channel_depth(light_channel) != VoxelBuffer::DEPTH_8_BIT) {
+			ERR_PRINT("VoxelMesherBlocky expects light levels in an 8-bit channel");
+
+		} else if (voxels.get_channel_compression(light_channel) == VoxelBuffer::COMPRESSION_UNIFORM) {
+			// Often the case in places without light sources
+			static thread_local StdVector<uint8_t> tls_uniform_light;
+			tls_uniform_light.assign(Vector3iUtil::get_volume(block_size), voxels.get_voxel(0, 0, 0, light_channel));
+			light_buffer = to_span_const(tls_uniform_light);
+
+		} else if (!voxels.get_channel_as_bytes_read_only(light_channel, light_buffer)) {
+			ERR_PRINT("VoxelMesherBlocky received unsupported light channel compression");
+		}
+	}
+	const float light_min_brightness = params.light_min_brightness;
+
 	unsigned int material_count = 0;
 	{
 		// We can only access baked data. Only this data is made for multithreaded access.
-		RWLockRead lock(params.library->get_baked_data_rw_lock());
-		const VoxelBlockyLibraryBase::BakedData &library_baked_data = params.library->get_baked_data();
 
 		material_count = library_baked_data.indexed_materials_count;
 
@@ -1180,17 +1689,44 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 			arrays_per_material.resize(material_count);
 		}
 
+		// Sections are only kept for LOD0, which is where edits usually happen
+		const bool incremental = params.incremental_meshing && input.lod_index == 0;
+		const Vector3i padding = Vector3iUtil::create(PADDING);
+
 		switch (channel_depth) {
 			case VoxelBuffer::DEPTH_8_BIT:
-				generate_blocky_mesh( //
-						arrays_per_material, //
-						collision_surface, //
-						raw_channel, //
-						block_size, //
-						library_baked_data, //
-						params.bake_occlusion, //
-						baked_occlusion_darkness //
-				);
+				if (incremental) {
+					generate_blocky_mesh_in_sections(
+							arrays_per_material,
+							collision_surface,
+							raw_channel,
+							block_size,
+							library_baked_data,
+							params.bake_occlusion,
+							baked_occlusion_darkness,
+							params.greedy_meshing,
+							light_buffer,
+							light_min_brightness,
+							params.geometry_revision,
+							*_section_cache,
+							input.origin_in_voxels
+					);
+				} else {
+					generate_blocky_mesh( //
+							arrays_per_material, //
+							collision_surface, //
+							raw_channel, //
+							block_size, //
+							padding, //
+							block_size - padding, //
+							library_baked_data, //
+							params.bake_occlusion, //
+							baked_occlusion_darkness, //
+							params.greedy_meshing, //
+							light_buffer, //
+							light_min_brightness //
+					);
+				}
 				if (input.lod_index > 0) {
 					append_seams(raw_channel, block_size, arrays_per_material, library_baked_data);
 				}
@@ -1198,15 +1734,38 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 
 			case VoxelBuffer::DEPTH_16_BIT: {
 				Span<const uint16_t> model_ids = raw_channel.reinterpret_cast_to<const uint16_t>();
-				generate_blocky_mesh(
-						arrays_per_material,
-						collision_surface,
-						model_ids,
-						block_size,
-						library_baked_data,
-						params.bake_occlusion,
-						baked_occlusion_darkness
-				);
+				if (incremental) {
+					generate_blocky_mesh_in_sections(
+							arrays_per_material,
+							collision_surface,
+							model_ids,
+							block_size,
+							library_baked_data,
+							params.bake_occlusion,
+							baked_occlusion_darkness,
+							params.greedy_meshing,
+							light_buffer,
+							light_min_brightness,
+							params.geometry_revision,
+							*_section_cache,
+							input.origin_in_voxels
+					);
+				} else {
+					generate_blocky_mesh(
+							arrays_per_material,
+							collision_surface,
+							model_ids,
+							block_size,
+							padding,
+							block_size - padding,
+							library_baked_data,
+							params.bake_occlusion,
+							baked_occlusion_darkness,
+							params.greedy_meshing,
+							light_buffer,
+							light_min_brightness
+					);
+				}
 				if (input.lod_index > 0) {
 					append_seams(model_ids, block_size, arrays_per_material, library_baked_data);
 				}
@@ -1233,6 +1792,11 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 		}
 	}
 
+	if (!input.visual_hint) {
+		// Only collision was requested, rendering surfaces and occluders are not needed
+		return;
+	}
+
 	// TODO Optimization: we could return a single byte array and use Mesh::add_surface down the line?
 	// That API does not seem to exist yet though.
 
@@ -1281,11 +1845,12 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 	}
 
 	if (params.shadow_occluders_mask != 0 && !is_empty(arrays_per_material)) {
-		// TODO Candidate for temp allocator (maybe even stack allocator in this case?)
-		OccluderArrays occluder_arrays;
+		// Kept per thread so memory is reused across blocks instead of being reallocated every time
+		static thread_local OccluderArrays tls_occluder_arrays;
+		OccluderArrays &occluder_arrays = tls_occluder_arrays;
+		occluder_arrays.vertices.clear();
+		occluder_arrays.indices.clear();
 
-		RWLockRead lock(params.library->get_baked_data_rw_lock());
-		const VoxelBlockyLibraryBase::BakedData &library_baked_data = params.library->get_baked_data();
 
 		generate_shadow_occluders( //
 				occluder_arrays, //
@@ -1326,7 +1891,34 @@ void VoxelMesherBlocky::build(VoxelMesher::Output &output, const VoxelMesher::In
 		}
 	}
 
+	if (params.occluder_boxes) {
+		const float lod_scale = 1 << input.lod_index;
+
+		switch (channel_depth) {
+			case VoxelBuffer::DEPTH_8_BIT:
+				generate_occluder_boxes(output.occluder_boxes, raw_channel, block_size, library_baked_data, lod_scale);
+				break;
+
+			case VoxelBuffer::DEPTH_16_BIT:
+				generate_occluder_boxes(
+						output.occluder_boxes,
+						raw_channel.reinterpret_cast_to<const uint16_t>(),
+						block_size,
+						library_baked_data,
+						lod_scale
+				);
+				break;
+
+			default:
+				break;
+		}
+	}
+
 	output.primitive_type = Mesh::PRIMITIVE_TRIANGLES;
+
+	if (params.vertex_compression) {
+		output.mesh_flags |= zylann::godot::get_mesh_attribute_compression_flags();
+	}
 }
 
 Ref<Resource> VoxelMesherBlocky::duplicate(bool p_subresources) const {
@@ -1343,10 +1935,15 @@ Ref<Resource> VoxelMesherBlocky::duplicate(bool p_subresources) const {
 	Ref<VoxelMesherBlocky> c;
 	c.instantiate();
 	c->_parameters = params;
+	c->set_mesh_optimization_enabled(is_mesh_optimization_enabled());
 	return c;
 }
 
 int VoxelMesherBlocky::get_used_channels_mask() const {
+	RWLockRead rlock(_parameters_lock);
+	if (_parameters.light_enabled) {
+		return (1 << VoxelBuffer::CHANNEL_TYPE) | (1 << _parameters.light_channel);
+	}
 	return (1 << VoxelBuffer::CHANNEL_TYPE);
 }
 
@@ -1381,7 +1978,6 @@ void VoxelMesherBlocky::get_configuration_warnings(PackedStringArray &out_warnin
 	}
 
 	const VoxelBlockyLibraryBase::BakedData &baked_data = library->get_baked_data();
-	RWLockRead rlock(library->get_baked_data_rw_lock());
 
 	if (baked_data.models.size() == 0) {
 		out_warnings.append(String(ZN_TTR("The {0} assigned to {1} has no baked models."))
@@ -1404,6 +2000,39 @@ void VoxelMesherBlocky::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_occlusion_darkness", "value"), &VoxelMesherBlocky::set_occlusion_darkness);
 	ClassDB::bind_method(D_METHOD("get_occlusion_darkness"), &VoxelMesherBlocky::get_occlusion_darkness);
 
+	ClassDB::bind_method(
+			D_METHOD("set_greedy_meshing_enabled", "enable"), &VoxelMesherBlocky::set_greedy_meshing_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_greedy_meshing_enabled"), &VoxelMesherBlocky::is_greedy_meshing_enabled);
+
+	ClassDB::bind_method(
+			D_METHOD("set_vertex_compression_enabled", "enable"), &VoxelMesherBlocky::set_vertex_compression_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_vertex_compression_enabled"), &VoxelMesherBlocky::is_vertex_compression_enabled);
+
+	ClassDB::bind_method(
+			D_METHOD("set_incremental_meshing_enabled", "enable"), &VoxelMesherBlocky::set_incremental_meshing_enabled
+	);
+	ClassDB::bind_method(
+			D_METHOD("is_incremental_meshing_enabled"), &VoxelMesherBlocky::is_incremental_meshing_enabled
+	);
+
+	ClassDB::bind_method(
+			D_METHOD("set_occluder_boxes_enabled", "enable"), &VoxelMesherBlocky::set_occluder_boxes_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_occluder_boxes_enabled"), &VoxelMesherBlocky::is_occluder_boxes_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_light_enabled", "enable"), &VoxelMesherBlocky::set_light_enabled);
+	ClassDB::bind_method(D_METHOD("is_light_enabled"), &VoxelMesherBlocky::is_light_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_light_channel", "channel"), &VoxelMesherBlocky::set_light_channel);
+	ClassDB::bind_method(D_METHOD("get_light_channel"), &VoxelMesherBlocky::get_light_channel);
+
+	ClassDB::bind_method(
+			D_METHOD("set_light_min_brightness", "brightness"), &VoxelMesherBlocky::set_light_min_brightness
+	);
+	ClassDB::bind_method(D_METHOD("get_light_min_brightness"), &VoxelMesherBlocky::get_light_min_brightness);
+
 	ClassDB::bind_method(
 			D_METHOD("set_shadow_occluder_side", "side", "enabled"), &VoxelMesherBlocky::set_shadow_occluder_side
 	);
@@ -1430,6 +2059,41 @@ void VoxelMesherBlocky::_bind_methods() {
 			"get_occlusion_darkness"
 	);
 
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "greedy_meshing_enabled"),
+			"set_greedy_meshing_enabled",
+			"is_greedy_meshing_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "vertex_compression_enabled"),
+			"set_vertex_compression_enabled",
+			"is_vertex_compression_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "incremental_meshing_enabled"),
+			"set_incremental_meshing_enabled",
+			"is_incremental_meshing_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "occluder_boxes_enabled"),
+			"set_occluder_boxes_enabled",
+			"is_occluder_boxes_enabled"
+	);
+
+	ADD_GROUP("Light", "light_");
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "light_enabled"), "set_light_enabled", "is_light_enabled");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "light_channel", PROPERTY_HINT_ENUM, godot::VoxelBuffer::CHANNEL_ID_HINT_STRING),
+			"set_light_channel",
+			"get_light_channel"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "light_min_brightness", PROPERTY_HINT_RANGE, "0,1,0.01"),
+			"set_light_min_brightness",
+			"get_light_min_brightness"
+	);
+
 	ADD_GROUP("Shadow Occluders", "shadow_occluder_");
 
 #define ADD_SHADOW_OCCLUDER_PROPERTY(m_name, m_flag)                                                                   \
@@ -1,7 +1,9 @@
 #ifndef VOXEL_MESHER_BLOCKY_H
 #define VOXEL_MESHER_BLOCKY_H
 
+#include "../../storage/voxel_buffer.h"
 #include "../../util/godot/classes/mesh.h"
+#include "../../util/memory/memory.h"
 #include "../../util/thread/rw_lock.h"
 #include "../voxel_mesher.h"
 #include "voxel_blocky_library_base.h"
@@ -10,6 +12,8 @@
 
 namespace zylann::voxel {
 
+class BlockySectionCache;
+
 // Interprets voxel values as indexes to models in a VoxelBlockyLibrary, and batches them together.
 // Overlapping faces are removed from the final mesh.
 class VoxelMesherBlocky : public VoxelMesher {
@@ -30,6 +34,34 @@ public:
 	void set_occlusion_enabled(bool enable);
 	bool get_occlusion_enabled() const;
 
+	// Merges identical full sides of adjacent voxels into larger quads
+	void set_greedy_meshing_enabled(bool enable);
+	bool is_greedy_meshing_enabled() const;
+
+	// Stores vertex attributes of produced meshes in a compressed format, using less memory
+	void set_vertex_compression_enabled(bool enable);
+	bool is_vertex_compression_enabled() const;
+
+	// Keeps the geometry of recently built blocks split in sections, so meshing a block again after a small edit only
+	// rebuilds sections whose voxels changed
+	void set_incremental_meshing_enabled(bool enable);
+	bool is_incremental_meshing_enabled() const;
+
+	// Outputs boxes covering the inside of regions made of opaque full cubes, which can be used for occlusion culling
+	void set_occluder_boxes_enabled(bool enable);
+	bool is_occluder_boxes_enabled() const;
+
+	// Darkens vertex colors using light levels found in a channel. Light is computed by VoxelTerrain when enabled.
+	void set_light_enabled(bool enable);
+	bool is_light_enabled() const;
+
+	void set_light_channel(int channel);
+	int get_light_channel() const;
+
+	// Brightness of voxels receiving no light, between 0 and 1
+	void set_light_min_brightness(float brightness);
+	float get_light_min_brightness() const;
+
 	enum Side {
 		SIDE_NEGATIVE_X = 0,
 		SIDE_POSITIVE_X,
@@ -57,7 +89,7 @@ public:
 	int get_used_channels_mask() const override;
 
 	bool supports_lod() const override {
-		return false;
+		return true;
 	}
 
 	Ref<Material> get_material_by_index(unsigned int index) const override;
@@ -98,6 +130,15 @@ private:
 	struct Parameters {
 		float baked_occlusion_darkness = 0.8;
 		bool bake_occlusion = true;
+		bool greedy_meshing = false;
+		bool vertex_compression = false;
+		bool incremental_meshing = false;
+		bool occluder_boxes = false;
+		bool light_enabled = false;
+		uint8_t light_channel = VoxelBuffer::CHANNEL_DATA5;
+		float light_min_brightness = 0.1f;
+		// Incremented when a parameter affecting geometry changes, so sections of previous meshes are not reused
+		uint32_t geometry_revision = 0;
 		uint8_t shadow_occluders_mask = 0;
 		Ref<VoxelBlockyLibraryBase> library;
 	};
@@ -110,6 +151,8 @@ private:
 	Parameters _parameters;
 	RWLock _parameters_lock;
 
+	UniquePtr<BlockySectionCache> _section_cache;
+
 	// Work cache
 	static Cache &get_tls_cache();
 };
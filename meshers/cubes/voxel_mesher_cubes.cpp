@@ -10,6 +10,7 @@
 #include "../../util/math/conv.h"
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
+#include "../occluder_boxes.h"
 
 // TODO Binary greedy mesher optimization
 // https://www.youtube.com/watch?v=qnGoGq7DWMc
@@ -407,6 +408,210 @@ void build_voxel_mesh_as_greedy_cubes(
 	}
 }
 
+// Properties of the 256 possible values of 8-bit voxels, looked up once per mesh instead of once per face
+struct IndexedColorLUT {
+	FixedArray<uint8_t, 256> alpha_indices;
+	FixedArray<uint8_t, 256> material_indices;
+	FixedArray<Color, 256> colors;
+
+	template <typename Color_F>
+	void build(Color_F color_func) {
+		for (unsigned int i = 0; i < 256; ++i) {
+			const Color8 color = color_func(i);
+			alpha_indices[i] = get_alpha_index(color);
+			material_indices[i] = color.a < 255;
+			colors[i] = color;
+		}
+	}
+};
+
+// Specialization of `build_voxel_mesh_as_greedy_cubes` for 8-bit palette indices. Faces are compared and merged using
+// their index packed with their side, and colors are only looked up once per quad.
+void build_voxel_mesh_as_greedy_cubes_indexed(
+		FixedArray<VoxelMesherCubes::Arrays, VoxelMesherCubes::MATERIAL_COUNT> &out_arrays_per_material,
+		const Span<const uint8_t> voxel_buffer,
+		const Vector3i block_size,
+		StdVector<uint8_t> &mask_memory_pool,
+		const IndexedColorLUT &lut
+) {
+	//
+	ERR_FAIL_COND(
+			block_size.x < static_cast<int>(2 * VoxelMesherCubes::PADDING) ||
+			block_size.y < static_cast<int>(2 * VoxelMesherCubes::PADDING) ||
+			block_size.z < static_cast<int>(2 * VoxelMesherCubes::PADDING)
+	);
+
+	// Mask values have the palette index in the low byte and the side in the high byte
+	typedef uint16_t MaskValue;
+	const MaskValue MASK_NONE = FACE_SIDE_NONE << 8;
+
+	const Vector3i min_pos = Vector3iUtil::create(VoxelMesherCubes::PADDING);
+	const Vector3i max_pos = block_size - Vector3iUtil::create(VoxelMesherCubes::PADDING);
+	const unsigned int row_size = block_size.y;
+	const unsigned int deck_size = block_size.x * row_size;
+
+	// Note: voxel buffers are indexed in ZXY order
+	FixedArray<uint32_t, Vector3iUtil::AXIS_COUNT> neighbor_offset_d_lut;
+	neighbor_offset_d_lut[Vector3i::AXIS_X] = block_size.y;
+	neighbor_offset_d_lut[Vector3i::AXIS_Y] = 1;
+	neighbor_offset_d_lut[Vector3i::AXIS_Z] = block_size.x * block_size.y;
+
+	FixedArray<uint32_t, VoxelMesherCubes::MATERIAL_COUNT> index_offsets;
+	fill(index_offsets, uint32_t(0));
+
+	// For each axis
+	for (unsigned int za = 0; za < Vector3iUtil::AXIS_COUNT; ++za) {
+		const unsigned int xa = g_face_axes_lut[za][0];
+		const unsigned int ya = g_face_axes_lut[za][1];
+
+		const unsigned int mask_size_x = (max_pos[xa] - min_pos[xa]);
+		const unsigned int mask_size_y = (max_pos[ya] - min_pos[ya]);
+		const unsigned int mask_area = mask_size_x * mask_size_y;
+		// Using the vector as memory pool
+		mask_memory_pool.resize(mask_area * sizeof(MaskValue));
+		Span<MaskValue> mask(reinterpret_cast<MaskValue *>(mask_memory_pool.data()), 0, mask_area);
+
+		// For each deck
+		for (unsigned int d = min_pos[za] - VoxelMesherCubes::PADDING; d < (unsigned int)max_pos[za]; ++d) {
+			// For each cell of the deck, gather face info
+			for (unsigned int fy = min_pos[ya]; fy < (unsigned int)max_pos[ya]; ++fy) {
+				for (unsigned int fx = min_pos[xa]; fx < (unsigned int)max_pos[xa]; ++fx) {
+					FixedArray<unsigned int, Vector3iUtil::AXIS_COUNT> pos;
+					pos[xa] = fx;
+					pos[ya] = fy;
+					pos[za] = d;
+
+					const unsigned int voxel_index = pos[Vector3i::AXIS_Y] + pos[Vector3i::AXIS_X] * row_size +
+							pos[Vector3i::AXIS_Z] * deck_size;
+
+					const uint8_t i0 = voxel_buffer[voxel_index];
+					const uint8_t i1 = voxel_buffer[voxel_index + neighbor_offset_d_lut[za]];
+
+					const uint8_t ai0 = lut.alpha_indices[i0];
+					const uint8_t ai1 = lut.alpha_indices[i1];
+
+					MaskValue mv;
+					if (ai0 == ai1) {
+						mv = MASK_NONE;
+					} else if (ai0 > ai1) {
+						mv = i0 | (FACE_SIDE_BACK << 8);
+					} else {
+						mv = i1 | (FACE_SIDE_FRONT << 8);
+					}
+
+					mask[(fx - VoxelMesherCubes::PADDING) + (fy - VoxelMesherCubes::PADDING) * mask_size_x] = mv;
+				}
+			}
+
+			struct L {
+				static inline bool is_range_equal(
+						const Span<MaskValue> &mask,
+						unsigned int xmin,
+						unsigned int xmax,
+						MaskValue v
+				) {
+					for (unsigned int x = xmin; x < xmax; ++x) {
+						if (mask[x] != v) {
+							return false;
+						}
+					}
+					return true;
+				}
+			};
+
+			// Greedy quads
+			for (unsigned int fy = 0; fy < mask_size_y; ++fy) {
+				for (unsigned int fx = 0; fx < mask_size_x; ++fx) {
+					const unsigned int mask_index = fx + fy * mask_size_x;
+					const MaskValue m = mask[mask_index];
+
+					if (m == MASK_NONE) {
+						continue;
+					}
+
+					// Check if the next faces are the same along X
+					unsigned int rx = fx + 1;
+					while (rx < mask_size_x && mask[rx + fy * mask_size_x] == m) {
+						++rx;
+					}
+
+					// Check if the next rows of faces are the same along Y
+					unsigned int ry = fy + 1;
+					while (ry < mask_size_y && L::is_range_equal(mask, fx + ry * mask_size_x, rx + ry * mask_size_x, m)
+					) {
+						++ry;
+					}
+
+					// Commit face to the mesh
+
+					const uint8_t palette_index = m & 0xff;
+					const uint8_t side = m >> 8;
+					const Color colorf = lut.colors[palette_index];
+					const uint8_t material_index = lut.material_indices[palette_index];
+					VoxelMesherCubes::Arrays &arrays = out_arrays_per_material[material_index];
+
+					Vector3f v0;
+					v0[xa] = fx;
+					v0[ya] = fy;
+					v0[za] = d;
+
+					Vector3f v1;
+					v1[xa] = rx;
+					v1[ya] = fy;
+					v1[za] = d;
+
+					Vector3f v2;
+					v2[xa] = fx;
+					v2[ya] = ry;
+					v2[za] = d;
+
+					Vector3f v3;
+					v3[xa] = rx;
+					v3[ya] = ry;
+					v3[za] = d;
+
+					Vector3f n;
+					n[za] = side == FACE_SIDE_FRONT ? -1 : 1;
+
+					// 2-----3
+					// |     |
+					// |     |
+					// 0-----1
+
+					arrays.positions.push_back(v0);
+					arrays.positions.push_back(v1);
+					arrays.positions.push_back(v2);
+					arrays.positions.push_back(v3);
+
+					arrays.colors.push_back(colorf);
+					arrays.colors.push_back(colorf);
+					arrays.colors.push_back(colorf);
+					arrays.colors.push_back(colorf);
+
+					arrays.normals.push_back(n);
+					arrays.normals.push_back(n);
+					arrays.normals.push_back(n);
+					arrays.normals.push_back(n);
+
+					const unsigned int index_offset = index_offsets[material_index];
+					CRASH_COND(za >= 3 || side >= 2);
+					const uint8_t *indices_lut = g_indices_lut[za][side];
+					for (unsigned int i = 0; i < 6; ++i) {
+						arrays.indices.push_back(index_offset + indices_lut[i]);
+					}
+					index_offsets[material_index] += 4;
+
+					for (unsigned int j = fy; j < ry; ++j) {
+						for (unsigned int i = fx; i < rx; ++i) {
+							mask[i + j * mask_size_x] = MASK_NONE;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
 template <typename Voxel_T, typename Color_F>
 void build_voxel_mesh_as_greedy_cubes_atlased(
 		FixedArray<VoxelMesherCubes::Arrays, VoxelMesherCubes::MATERIAL_COUNT> &out_arrays_per_material,
@@ -657,11 +862,13 @@ Ref<Image> make_greedy_atlas(
 	ZN_PROFILE_SCOPE();
 
 	// Pack rectangles
-	StdVector<Vector2i> result_points;
+	static thread_local StdVector<Vector2i> tls_result_points;
+	StdVector<Vector2i> &result_points = tls_result_points;
 	Vector2i result_size;
 	{
 		ZN_PROFILE_SCOPE_NAMED("Packing");
-		StdVector<Vector2i> sizes;
+		static thread_local StdVector<Vector2i> tls_sizes;
+		StdVector<Vector2i> &sizes = tls_sizes;
 		sizes.resize(atlas_data.images.size());
 		for (unsigned int i = 0; i < atlas_data.images.size(); ++i) {
 			const VoxelMesherCubes::GreedyAtlasData::ImageInfo &im = atlas_data.images[i];
@@ -745,6 +952,52 @@ VoxelMesherCubes::Cache &VoxelMesherCubes::get_tls_cache() {
 	return cache;
 }
 
+// Transparent voxels can't be used as occluders, so only voxels with maximum alpha are considered solid
+template <typename Voxel_T, typename Color_F>
+void generate_occluder_boxes(
+		StdVector<Box3f> &out_boxes,
+		const Span<const Voxel_T> voxel_buffer,
+		const Vector3i block_size,
+		const float scale,
+		Color_F color_func
+) {
+	ZN_PROFILE_SCOPE();
+
+	const Vector3i min = Vector3iUtil::create(VoxelMesherCubes::PADDING);
+	const Vector3i max = block_size - Vector3iUtil::create(VoxelMesherCubes::PADDING);
+	const Vector3i grid_size = max - min;
+
+	static thread_local StdVector<uint8_t> tls_solid_cells;
+	StdVector<uint8_t> &solid_cells = tls_solid_cells;
+	solid_cells.resize(Vector3iUtil::get_volume(grid_size));
+
+	unsigned int cell_index = 0;
+	for (int z = min.z; z < max.z; ++z) {
+		for (int x = min.x; x < max.x; ++x) {
+			for (int y = min.y; y < max.y; ++y) {
+				const Voxel_T raw_color = voxel_buffer[Vector3iUtil::get_zxy_index(Vector3i(x, y, z), block_size)];
+				solid_cells[cell_index] = color_func(raw_color).a == 255;
+				++cell_index;
+			}
+		}
+	}
+
+	find_occluder_boxes(to_span(solid_cells), grid_size, Vector3f(), scale, out_boxes);
+}
+
+inline Color8 get_raw_color8(uint64_t raw_color, VoxelBuffer::Depth depth) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			return Color8::from_u8(raw_color);
+		case VoxelBuffer::DEPTH_16_BIT:
+			return Color8::from_u16(raw_color);
+		case VoxelBuffer::DEPTH_32_BIT:
+			return Color8::from_u32(raw_color);
+		default:
+			return Color8();
+	}
+}
+
 void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Input &input) {
 	ZN_PROFILE_SCOPE();
 	const int channel = VoxelBuffer::CHANNEL_COLOR;
@@ -757,6 +1010,13 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 
 	const VoxelBuffer &voxels = input.voxels;
 
+	Parameters params;
+	{
+		RWLockRead rlock(_parameters_lock);
+		params = _parameters;
+	}
+	// Note, we don't lock the palette because its data has fixed-size
+
 	// Iterate 3D padded data to extract voxel faces.
 	// This is the most intensive job in this class, so all required data should be as fit as possible.
 
@@ -767,6 +1027,21 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 	if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_UNIFORM) {
 		// All voxels have the same type.
 		// If it's all air, nothing to do. If it's all cubes, nothing to do either.
+		if (params.occluder_boxes) {
+			// A block entirely made of opaque voxels can be fully used as an occluder
+			const uint64_t raw_color = voxels.get_voxel(0, 0, 0, channel);
+			Color8 color;
+			if (params.color_mode == COLOR_RAW) {
+				color = get_raw_color8(raw_color, voxels.get_channel_depth(channel));
+			} else if (params.palette.is_valid()) {
+				color = params.palette->get_color8(raw_color);
+			}
+			if (color.a == 255) {
+				const float lod_scale = 1 << input.lod_index;
+				const Vector3i size = voxels.get_size() - Vector3iUtil::create(2 * PADDING);
+				output.occluder_boxes.push_back(Box3f{ Vector3f(), to_vec3f(size) * lod_scale });
+			}
+		}
 		return;
 
 	} else if (voxels.get_channel_compression(channel) != VoxelBuffer::COMPRESSION_NONE) {
@@ -785,13 +1060,6 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 	const Vector3i block_size = voxels.get_size();
 	const VoxelBuffer::Depth channel_depth = voxels.get_channel_depth(channel);
 
-	Parameters params;
-	{
-		RWLockRead rlock(_parameters_lock);
-		params = _parameters;
-	}
-	// Note, we don't lock the palette because its data has fixed-size
-
 	Ref<Image> atlas_image;
 
 	switch (params.color_mode) {
@@ -886,12 +1154,10 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 							atlas_image =
 									make_greedy_atlas(cache.greedy_atlas_data, to_span(cache.arrays_per_material));
 						} else {
-							build_voxel_mesh_as_greedy_cubes(
-									cache.arrays_per_material,
-									raw_channel,
-									block_size,
-									cache.mask_memory_pool,
-									get_color_from_palette
+							IndexedColorLUT lut;
+							lut.build(get_color_from_palette);
+							build_voxel_mesh_as_greedy_cubes_indexed(
+									cache.arrays_per_material, raw_channel, block_size, cache.mask_memory_pool, lut
 							);
 						}
 					} else {
@@ -941,12 +1207,10 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 			switch (channel_depth) {
 				case VoxelBuffer::DEPTH_8_BIT:
 					if (params.greedy_meshing) {
-						build_voxel_mesh_as_greedy_cubes(
-								cache.arrays_per_material,
-								raw_channel,
-								block_size,
-								cache.mask_memory_pool,
-								get_index_from_palette
+						IndexedColorLUT lut;
+						lut.build(get_index_from_palette);
+						build_voxel_mesh_as_greedy_cubes_indexed(
+								cache.arrays_per_material, raw_channel, block_size, cache.mask_memory_pool, lut
 						);
 					} else {
 						build_voxel_mesh_as_simple_cubes(
@@ -985,6 +1249,61 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 			break;
 	}
 
+	if (params.occluder_boxes) {
+		const float lod_scale = 1 << input.lod_index;
+
+		if (params.color_mode == COLOR_RAW) {
+			switch (channel_depth) {
+				case VoxelBuffer::DEPTH_8_BIT:
+					generate_occluder_boxes(output.occluder_boxes, raw_channel, block_size, lod_scale, Color8::from_u8);
+					break;
+				case VoxelBuffer::DEPTH_16_BIT:
+					generate_occluder_boxes(
+							output.occluder_boxes,
+							raw_channel.reinterpret_cast_to<const uint16_t>(),
+							block_size,
+							lod_scale,
+							Color8::from_u16
+					);
+					break;
+				case VoxelBuffer::DEPTH_32_BIT:
+					generate_occluder_boxes(
+							output.occluder_boxes,
+							raw_channel.reinterpret_cast_to<const uint32_t>(),
+							block_size,
+							lod_scale,
+							Color8::from_u32
+					);
+					break;
+				default:
+					break;
+			}
+
+		} else if (params.palette.is_valid()) {
+			const VoxelColorPalette &palette = **params.palette;
+			const auto get_color_from_palette = [&palette](uint64_t i) { return palette.get_color8(i); };
+
+			switch (channel_depth) {
+				case VoxelBuffer::DEPTH_8_BIT:
+					generate_occluder_boxes(
+							output.occluder_boxes, raw_channel, block_size, lod_scale, get_color_from_palette
+					);
+					break;
+				case VoxelBuffer::DEPTH_16_BIT:
+					generate_occluder_boxes(
+							output.occluder_boxes,
+							raw_channel.reinterpret_cast_to<const uint16_t>(),
+							block_size,
+							lod_scale,
+							get_color_from_palette
+					);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
 	if (input.lod_index > 0) {
 		// TODO This is very crude LOD, there will be cracks at the borders.
 		// One way would be to not cull faces on chunk borders if any neighbor face is air
@@ -1045,6 +1364,11 @@ void VoxelMesherCubes::build(VoxelMesher::Output &output, const VoxelMesher::Inp
 	}
 
 	output.primitive_type = Mesh::PRIMITIVE_TRIANGLES;
+
+	if (params.vertex_compression) {
+		output.mesh_flags |= zylann::godot::get_mesh_attribute_compression_flags();
+	}
+
 	output.atlas_image = atlas_image;
 
 	// if (params.store_colors_in_texture) {
@@ -1064,6 +1388,26 @@ bool VoxelMesherCubes::is_greedy_meshing_enabled() const {
 	return _parameters.greedy_meshing;
 }
 
+void VoxelMesherCubes::set_vertex_compression_enabled(bool enable) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.vertex_compression = enable;
+}
+
+bool VoxelMesherCubes::is_vertex_compression_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.vertex_compression;
+}
+
+void VoxelMesherCubes::set_occluder_boxes_enabled(bool enable) {
+	RWLockWrite wlock(_parameters_lock);
+	_parameters.occluder_boxes = enable;
+}
+
+bool VoxelMesherCubes::is_occluder_boxes_enabled() const {
+	RWLockRead rlock(_parameters_lock);
+	return _parameters.occluder_boxes;
+}
+
 void VoxelMesherCubes::set_palette(Ref<VoxelColorPalette> palette) {
 	RWLockWrite wlock(_parameters_lock);
 	_parameters.palette = palette;
@@ -1108,6 +1452,7 @@ Ref<Resource> VoxelMesherCubes::duplicate(bool p_subresources) const {
 	Ref<VoxelMesherCubes> d;
 	d.instantiate();
 	d->_parameters = params;
+	d->set_mesh_optimization_enabled(is_mesh_optimization_enabled());
 
 	return d;
 }
@@ -1234,6 +1579,12 @@ void VoxelMesherCubes::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_greedy_meshing_enabled", "enable"), &Self::set_greedy_meshing_enabled);
 	ClassDB::bind_method(D_METHOD("is_greedy_meshing_enabled"), &Self::is_greedy_meshing_enabled);
 
+	ClassDB::bind_method(D_METHOD("set_vertex_compression_enabled", "enable"), &Self::set_vertex_compression_enabled);
+	ClassDB::bind_method(D_METHOD("is_vertex_compression_enabled"), &Self::is_vertex_compression_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_occluder_boxes_enabled", "enable"), &Self::set_occluder_boxes_enabled);
+	ClassDB::bind_method(D_METHOD("is_occluder_boxes_enabled"), &Self::is_occluder_boxes_enabled);
+
 	ClassDB::bind_method(D_METHOD("set_palette", "palette"), &Self::set_palette);
 	ClassDB::bind_method(D_METHOD("get_palette"), &Self::get_palette);
 
@@ -1259,6 +1610,16 @@ void VoxelMesherCubes::_bind_methods() {
 			"set_greedy_meshing_enabled",
 			"is_greedy_meshing_enabled"
 	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "vertex_compression_enabled"),
+			"set_vertex_compression_enabled",
+			"is_vertex_compression_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "occluder_boxes_enabled"),
+			"set_occluder_boxes_enabled",
+			"is_occluder_boxes_enabled"
+	);
 	ADD_PROPERTY(
 			PropertyInfo(Variant::INT, "color_mode", PROPERTY_HINT_ENUM, "Raw,MesherPalette,ShaderPalette"),
 			"set_color_mode",
@@ -45,6 +45,14 @@ public:
 	void set_greedy_meshing_enabled(bool enable);
 	bool is_greedy_meshing_enabled() const;
 
+	// Stores vertex attributes of produced meshes in a compressed format, using less memory
+	void set_vertex_compression_enabled(bool enable);
+	bool is_vertex_compression_enabled() const;
+
+	// Outputs boxes covering the inside of regions made of opaque voxels, which can be used for occlusion culling
+	void set_occluder_boxes_enabled(bool enable);
+	bool is_occluder_boxes_enabled() const;
+
 	void set_color_mode(ColorMode mode);
 	ColorMode get_color_mode() const;
 
@@ -125,6 +133,8 @@ private:
 		Ref<VoxelColorPalette> palette;
 		bool greedy_meshing = true;
 		bool store_colors_in_texture = false;
+		bool vertex_compression = false;
+		bool occluder_boxes = false;
 	};
 
 	struct Cache {
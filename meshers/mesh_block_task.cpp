@@ -2,8 +2,10 @@
 #include "../engine/detail_rendering/render_detail_texture_task.h"
 #include "../meshers/transvoxel/voxel_mesher_transvoxel.h"
 #include "../storage/voxel_data.h"
+#include "../streams/mesh_block_serializer.h"
 #include "../terrain/voxel_mesh_block.h"
 #include "../util/dstack.h"
+#include "../util/godot/classes/concave_polygon_shape_3d.h"
 #include "../util/godot/classes/mesh.h"
 #include "../util/io/log.h"
 #include "../util/math/conv.h"
@@ -94,6 +96,8 @@ void copy_block_and_neighbors(
 	// for (unsigned int ci = 0; ci < channels.size(); ++ci) {
 	// 	dst.set_channel_depth(ci, central_buffer->get_channel_depth(ci));
 	// }
+	// Used if no block is found, same as blocks generated at this LOD
+	dst.set_sdf_quantization_factor(VoxelBuffer::get_sdf_quantization_factor_for_lod(lod_index));
 	// This is a hack
 	for (unsigned int i = 0; i < blocks.size(); ++i) {
 		const std::shared_ptr<VoxelBuffer> &buffer = blocks[i];
@@ -122,7 +126,8 @@ void copy_block_and_neighbors(
 	// TODO Candidate for temp allocator (or SmallVector?)
 	StdVector<Box3i> boxes_to_generate;
 	const Box3i mesh_data_box = Box3i::from_min_max(min_pos, max_pos);
-	if (contains(blocks.to_const(), std::shared_ptr<VoxelBuffer>())) {
+	const bool has_missing_blocks = contains(blocks.to_const(), std::shared_ptr<VoxelBuffer>());
+	if (has_missing_blocks) {
 		const Box3i bounds_local(bounds_in_voxels.position - origin_in_voxels_without_padding, bounds_in_voxels.size);
 		const Box3i box = mesh_data_box.clipped(bounds_local); // Prevent generation outside fixed bounds
 		if (!box.is_empty()) {
@@ -130,10 +135,11 @@ void copy_block_and_neighbors(
 		}
 	}
 
+	// Snapshot blocks while they are locked. Snapshots share voxel data instead of copying it, so the lock is held
+	// only briefly, and copying with padding can be done after releasing it.
+	StdVector<VoxelBuffer> snapshots;
+	snapshots.reserve(blocks.size());
 	{
-		// TODO The following logic might as well be simplified and moved to VoxelData.
-		// We are just sampling or generating data in a given area.
-
 		const Vector3i data_block_pos0 = mesh_block_pos * area_info.mesh_block_size_factor;
 		SpatialLock3D::Read srlock(
 				voxel_data.get_spatial_lock(lod_index),
@@ -142,16 +148,53 @@ void copy_block_and_neighbors(
 				)
 		);
 
+		for (const std::shared_ptr<VoxelBuffer> &src : blocks) {
+			snapshots.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+			if (src == nullptr) {
+				continue;
+			}
+			VoxelBuffer &snapshot = snapshots.back();
+			snapshot.create(src->get_size());
+			for (const uint8_t channel_index : channels) {
+				snapshot.set_channel_depth(channel_index, src->get_channel_depth(channel_index));
+				snapshot.copy_channel_from(*src, channel_index);
+			}
+		}
+	}
+
+	if (!has_missing_blocks) {
+		// All blocks are present, so they will overwrite the whole destination. If the central block is uniform,
+		// start from its value: neighbors with the same value are then skipped by `copy_channel_from`, and when the
+		// whole neighborhood is uniform (air, or deep underground) the channel is neither allocated nor filled.
+		const VoxelBuffer &central_snapshot = snapshots[area_info.anchor_buffer_index];
+		for (const uint8_t channel_index : channels) {
+			if (central_snapshot.is_uniform(channel_index)) {
+				if (channel_index == VoxelBuffer::CHANNEL_SDF &&
+					dst.get_sdf_quantization_factor() != central_snapshot.get_sdf_quantization_factor()) {
+					// Blocks were not all quantized with the same scale
+					dst.clear_channel_f(channel_index, central_snapshot.get_voxel_f(0, 0, 0, channel_index));
+				} else {
+					dst.clear_channel(channel_index, central_snapshot.get_voxel(0, 0, 0, channel_index));
+				}
+			}
+		}
+	}
+
+	{
+		// TODO The following logic might as well be simplified and moved to VoxelData.
+		// We are just sampling or generating data in a given area.
+
 		// Using ZXY as convention to reconstruct positions with thread locking consistency
 		unsigned int block_index = 0;
 		for (int z = -1; z < area_info.edge_size - 1; ++z) {
 			for (int x = -1; x < area_info.edge_size - 1; ++x) {
 				for (int y = -1; y < area_info.edge_size - 1; ++y) {
 					const Vector3i offset = data_block_size * Vector3i(x, y, z);
-					const std::shared_ptr<VoxelBuffer> &src = blocks[block_index];
+					const bool has_block = blocks[block_index] != nullptr;
+					const VoxelBuffer &src = snapshots[block_index];
 					++block_index;
 
-					if (src == nullptr) {
+					if (!has_block) {
 						continue;
 					}
 
@@ -159,7 +202,7 @@ void copy_block_and_neighbors(
 					const Vector3i src_max = max_pos - offset;
 
 					for (const uint8_t channel_index : channels) {
-						dst.copy_channel_from(*src, src_min, src_max, Vector3i(), channel_index);
+						dst.copy_channel_from(src, src_min, src_max, Vector3i(), channel_index);
 					}
 
 					if (boxes_to_generate.size() > 0) {
@@ -189,6 +232,9 @@ void copy_block_and_neighbors(
 		}
 	}
 
+	// Don't keep blocks shared longer than necessary, writing to them would have to copy their data
+	snapshots.clear();
+
 	// Undo padding to go back to proper buffer coordinates
 	for (Box3i &box : boxes_to_generate) {
 		box.position += Vector3iUtil::create(min_padding);
@@ -205,28 +251,44 @@ void copy_block_and_neighbors(
 	} else {
 		// Complete data with generated voxels on the CPU
 		ZN_PROFILE_SCOPE_NAMED("Generate");
-		VoxelBuffer generated_voxels(VoxelBuffer::ALLOCATOR_POOL);
 
 		const VoxelModifierStack &modifiers = voxel_data.get_modifiers();
 
+		// All boxes are generated in one batch, so generators can share their setup costs. There are often many small
+		// boxes to generate around edited blocks.
+		StdVector<VoxelBuffer> generated_voxels;
+		generated_voxels.reserve(boxes_to_generate.size());
+		StdVector<VoxelGenerator::VoxelQueryData> queries;
+		queries.reserve(boxes_to_generate.size());
+
 		for (const Box3i &box : boxes_to_generate) {
-			ZN_PROFILE_SCOPE_NAMED("Box");
 			// print_line(String("size={0}").format(varray(box.size.to_vec3())));
-			generated_voxels.create(box.size);
-			// generated_voxels.set_voxel_f(2.0f, box.size.x / 2, box.size.y / 2, box.size.z / 2,
-			// VoxelBuffer::CHANNEL_SDF);
-			VoxelGenerator::VoxelQueryData q{ generated_voxels,
-											  (box.position << lod_index) + origin_in_voxels_lod0,
-											  lod_index };
-
-			if (generator.is_valid()) {
-				generator->generate_block(q);
-			}
+			generated_voxels.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+			VoxelBuffer &voxels = generated_voxels.back();
+			voxels.create(box.size);
+			// Same scale as the destination, so generated distances are copied as-is
+			voxels.set_sdf_quantization_factor(dst.get_sdf_quantization_factor());
+			// voxels.set_voxel_f(2.0f, box.size.x / 2, box.size.y / 2, box.size.z / 2, VoxelBuffer::CHANNEL_SDF);
+			const Vector3i origin_in_voxels = (box.position << lod_index) + origin_in_voxels_lod0;
+			queries.push_back(VoxelGenerator::VoxelQueryData{ voxels, origin_in_voxels, lod_index });
+		}
+
+		if (generator.is_valid()) {
+			StdVector<VoxelGenerator::Result> results;
+			results.resize(queries.size());
+			generator->generate_blocks(to_span(queries), to_span(results));
+		}
+
+		for (unsigned int i = 0; i < queries.size(); ++i) {
+			ZN_PROFILE_SCOPE_NAMED("Box");
+			const VoxelGenerator::VoxelQueryData &q = queries[i];
+			const Box3i &box = boxes_to_generate[i];
+
 			modifiers.apply(q.voxel_buffer, AABB(q.origin_in_voxels, q.voxel_buffer.get_size() << lod_index));
 
 			for (const uint8_t channel_index : channels) {
 				dst.copy_channel_from(
-						generated_voxels, Vector3i(), generated_voxels.get_size(), box.position, channel_index
+						q.voxel_buffer, Vector3i(), q.voxel_buffer.get_size(), box.position, channel_index
 				);
 			}
 		}
@@ -267,7 +329,7 @@ Ref<ArrayMesh> build_mesh(
 
 		// TODO Use `add_surface`, it's about 20% faster after measuring in Tracy (though we may see if Godot 4 expects
 		// the same)
-		mesh->add_surface_from_arrays(primitive, arrays, Array(), Dictionary(), flags);
+		mesh->add_surface_from_arrays(primitive, arrays, Array(), surface.lods, flags);
 
 		mesh_material_indices.push_back(surface.material_index);
 	}
@@ -293,6 +355,63 @@ Ref<ArrayMesh> build_mesh(
 	return mesh;
 }
 
+bool stage_mesh_surfaces(
+		Span<const VoxelMesher::Output::Surface> surfaces,
+		Mesh::PrimitiveType primitive,
+		int flags,
+		StdVector<zylann::godot::StagedMeshSurface> &out_surfaces,
+		StdVector<uint16_t> &mesh_material_indices
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(mesh_material_indices.size() == 0);
+
+	for (unsigned int i = 0; i < surfaces.size(); ++i) {
+		const VoxelMesher::Output::Surface &surface = surfaces[i];
+		const Array &arrays = surface.arrays;
+
+		// Same filtering as `build_mesh`
+		if (arrays.is_empty()) {
+			continue;
+		}
+		CRASH_COND(arrays.size() != Mesh::ARRAY_MAX);
+		if (!zylann::godot::is_surface_triangulated(arrays)) {
+			continue;
+		}
+
+		out_surfaces.push_back(zylann::godot::StagedMeshSurface());
+		if (!zylann::godot::stage_mesh_surface(out_surfaces.back(), primitive, arrays, surface.lods, flags)) {
+			out_surfaces.clear();
+			mesh_material_indices.clear();
+			return false;
+		}
+
+		mesh_material_indices.push_back(surface.material_index);
+	}
+
+	return true;
+}
+
+Ref<ArrayMesh> build_mesh(Span<const zylann::godot::StagedMeshSurface> surfaces) {
+	ZN_PROFILE_SCOPE();
+
+	if (surfaces.size() == 0) {
+		return Ref<ArrayMesh>();
+	}
+
+	Ref<ArrayMesh> mesh;
+	mesh.instantiate();
+
+	for (const zylann::godot::StagedMeshSurface &surface : surfaces) {
+		zylann::godot::add_staged_mesh_surface(**mesh, surface);
+	}
+
+	if (zylann::godot::is_mesh_empty(**mesh)) {
+		mesh = Ref<Mesh>();
+	}
+
+	return mesh;
+}
+
 Ref<ArrayMesh> build_mesh(Array surface) {
 	if (surface.is_empty()) {
 		return Ref<ArrayMesh>();
@@ -323,7 +442,8 @@ int MeshBlockTask::debug_get_running_count() {
 
 void MeshBlockTask::run(zylann::ThreadedTaskContext &ctx) {
 	ZN_DSTACK();
-	ZN_PROFILE_SCOPE();
+	ZN_PROFILE_SCOPE_NAMED("MeshBlockTask::run");
+	ZN_PROFILE_COUNTER_ADD("Voxel blocks meshed", 1);
 	ZN_ASSERT(meshing_dependency != nullptr);
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT_RETURN_MSG(
@@ -342,6 +462,20 @@ void MeshBlockTask::run(zylann::ThreadedTaskContext &ctx) {
 	// end up with a huge surface at the bottom facing down, since the default for chunks outside bounds is air.
 	// We would have to somehow expose a way to set what these areas default to as well...
 
+	if (_stage == 0 && is_output_known_empty()) {
+		// Nothing to gather or build, the result is an empty mesh
+		ZN_PROFILE_COUNTER_ADD("Voxel blocks skipped", 1);
+		_has_run = true;
+		return;
+	}
+
+	if (_stage == 0 && try_load_baked_mesh()) {
+		// The mesh was baked before, voxels don't need to be gathered
+		ZN_PROFILE_COUNTER_ADD("Voxel blocks loaded baked", 1);
+		finish_output();
+		return;
+	}
+
 	if (block_generation_use_gpu) {
 		if (_stage == 0) {
 			gather_voxels_gpu(ctx);
@@ -359,6 +493,72 @@ void MeshBlockTask::run(zylann::ThreadedTaskContext &ctx) {
 	}
 }
 
+bool MeshBlockTask::is_output_known_empty() const {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(data != nullptr);
+	Span<const std::shared_ptr<VoxelBuffer>> blocks_span = to_span_const(blocks, blocks_count);
+
+	const CubicAreaInfo area_info = get_cubic_area_info_from_size(blocks_span.size());
+	ZN_ASSERT_RETURN_V(area_info.is_valid(), false);
+
+	// Same area as the one locked when gathering voxels
+	const Vector3i data_block_pos0 = mesh_block_position * area_info.mesh_block_size_factor;
+	SpatialLock3D::Read srlock(
+			data->get_spatial_lock(lod_index),
+			BoxBounds3i(
+					data_block_pos0 - Vector3i(1, 1, 1), data_block_pos0 + Vector3iUtil::create(area_info.edge_size)
+			)
+	);
+
+	return meshing_dependency->mesher->is_output_known_empty(blocks_span);
+}
+
+bool MeshBlockTask::try_load_baked_mesh() {
+	if (baked_mesh_stream.is_null() || !require_visual) {
+		return false;
+	}
+	if (caused_by_edit) {
+		// Voxels changed since the mesh was baked
+		return false;
+	}
+	if (detail_texture_settings.enabled //
+		&& require_detail_texture //
+		&& lod_index >= detail_texture_settings.begin_lod_index //
+	) {
+		// Detail textures are rendered from cells found while meshing, which are not stored
+		return false;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	VoxelStream::MeshesQueryData q{ StdVector<uint8_t>(), mesh_block_position, lod_index, VoxelStream::RESULT_ERROR };
+	baked_mesh_stream->load_mesh_blocks(Span<VoxelStream::MeshesQueryData>(&q, 1));
+	if (q.result != VoxelStream::RESULT_BLOCK_FOUND) {
+		return false;
+	}
+
+	VoxelMesher::Output output;
+	if (!deserialize_mesh_block(to_span_const(q.data), baked_mesh_settings_hash, collision_hint, output)) {
+		return false;
+	}
+	_surfaces_output = std::move(output);
+	return true;
+}
+
+void MeshBlockTask::save_baked_mesh() {
+	if (baked_mesh_stream.is_null() || !require_visual || !can_serialize_mesh_block(_surfaces_output)) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	VoxelStream::MeshesQueryData q{ StdVector<uint8_t>(), mesh_block_position, lod_index, VoxelStream::RESULT_ERROR };
+	if (!serialize_mesh_block(_surfaces_output, baked_mesh_settings_hash, collision_hint, q.data)) {
+		return;
+	}
+	baked_mesh_stream->save_mesh_blocks(Span<VoxelStream::MeshesQueryData>(&q, 1));
+}
+
 void MeshBlockTask::gather_voxels_gpu(zylann::ThreadedTaskContext &ctx) {
 	ZN_ASSERT(meshing_dependency != nullptr);
 	ZN_ASSERT(data != nullptr);
@@ -501,12 +701,19 @@ void MeshBlockTask::build_mesh() {
 		collision_hint,
 		lod_hint,
 		// TODO Gathering detail texture information is not always necessary
-		true // detail_texture_hint
+		true, // detail_texture_hint
+		require_visual
 	};
 	mesher->build(_surfaces_output, input);
 
 	const bool mesh_is_empty = VoxelMesher::is_mesh_empty(_surfaces_output.surfaces);
 
+	if (require_visual && !mesh_is_empty && mesher->is_mesh_optimization_enabled()) {
+		VoxelMesher::optimize_output_for_gpu(_surfaces_output);
+	}
+
+	save_baked_mesh();
+
 	// Currently, Transvoxel only is supported in combination with detail normalmap texturing, because the algorithm
 	// provides a cheap source for cells subdividing the mesh. It should be possible to obtain cells from any mesh,
 	// but it is more expensive to find them from scratch, and for now Transvoxel is the most viable algorithm for
@@ -561,6 +768,12 @@ void MeshBlockTask::build_mesh() {
 		VoxelEngine::get_singleton().push_async_task(nm_task);
 	}
 
+	finish_output();
+}
+
+void MeshBlockTask::finish_output() {
+	Ref<VoxelMesher> mesher = meshing_dependency->mesher;
+
 	if (require_visual && VoxelEngine::get_singleton().is_threaded_graphics_resource_building_enabled()) {
 		// This can only run if the engine supports building meshes from multiple threads
 
@@ -579,6 +792,29 @@ void MeshBlockTask::build_mesh() {
 
 	} else {
 		_has_mesh_resource = false;
+
+		if (require_visual) {
+			// The mesh has to be created on the main thread, but we can still prepare its data so the main thread
+			// only has to upload it
+			// If staging isn't supported, the main thread will build the mesh from surface arrays instead
+			_has_staged_surfaces = stage_mesh_surfaces(
+					to_span(_surfaces_output.surfaces),
+					_surfaces_output.primitive_type,
+					_surfaces_output.mesh_flags,
+					_staged_surfaces,
+					_mesh_material_indices
+			);
+		}
+	}
+
+	if (require_collision_shape && VoxelEngine::get_singleton().is_threaded_collision_shape_building_enabled()) {
+		// Creating the shape also builds physics acceleration structures, which is one of the most expensive things
+		// to do when a mesh is applied
+		_collision_shape = make_collision_shape_from_mesher_output(_surfaces_output, **mesher);
+		_has_collision_shape = true;
+
+	} else {
+		_has_collision_shape = false;
 	}
 
 	_has_run = true;
@@ -586,12 +822,19 @@ void MeshBlockTask::build_mesh() {
 
 TaskPriority MeshBlockTask::get_priority() {
 	float closest_viewer_distance_sq;
-	const TaskPriority p =
+	TaskPriority p =
 			priority_dependency.evaluate(lod_index, constants::TASK_PRIORITY_MESH_BAND2, &closest_viewer_distance_sq);
+	if (caused_by_edit) {
+		p.band3 = constants::TASK_PRIORITY_BAND3_EDIT;
+	}
 	_too_far = closest_viewer_distance_sq > priority_dependency.drop_distance_squared;
 	return p;
 }
 
+int MeshBlockTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
 bool MeshBlockTask::is_cancelled() {
 	if (cancellation_token.is_valid()) {
 		return cancellation_token.is_cancelled();
@@ -599,6 +842,10 @@ bool MeshBlockTask::is_cancelled() {
 	return !meshing_dependency->valid || _too_far;
 }
 
+void MeshBlockTask::dispose() {
+	ThreadedTaskPool<MeshBlockTask>::get_singleton().recycle(this);
+}
+
 void MeshBlockTask::apply_result() {
 	if (VoxelEngine::get_singleton().is_volume_valid(volume_id)) {
 		// The request response must match the dependency it would have been requested with.
@@ -622,6 +869,10 @@ void MeshBlockTask::apply_result() {
 			o.shadow_occluder_mesh = _shadow_occluder_mesh;
 			o.mesh_material_indices = std::move(_mesh_material_indices);
 			o.has_mesh_resource = _has_mesh_resource;
+			o.staged_surfaces = std::move(_staged_surfaces);
+			o.has_staged_surfaces = _has_staged_surfaces;
+			o.collision_shape = _collision_shape;
+			o.has_collision_shape = _has_collision_shape;
 			o.visual_was_required = require_visual;
 			o.detail_textures = _detail_textures;
 
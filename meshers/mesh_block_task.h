@@ -8,10 +8,13 @@
 #include "../engine/priority_dependency.h"
 #include "../generators/generate_block_gpu_task.h"
 #include "../storage/voxel_buffer.h"
+#include "../streams/voxel_stream.h"
 #include "../util/containers/std_vector.h"
 #include "../util/godot/classes/array_mesh.h"
+#include "../util/godot/classes/shape_3d.h"
 #include "../util/tasks/cancellation_token.h"
 #include "../util/tasks/threaded_task.h"
+#include "../util/tasks/threaded_task_pool.h"
 
 namespace zylann::voxel {
 
@@ -27,10 +30,17 @@ public:
 		return "MeshBlock";
 	}
 
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_MESH;
+	}
+
 	void run(ThreadedTaskContext &ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 	void apply_result() override;
+	// Instances are allocated with `ThreadedTaskPool<MeshBlockTask>`, so they go back to it
+	void dispose() override;
 
 	void set_gpu_results(StdVector<GenerateBlockGPUTaskResult> &&results) override;
 
@@ -48,6 +58,8 @@ public:
 	bool require_visual = true;
 	// If true, a collision mesh is required if possible
 	bool collision_hint = false;
+	// If true, the collision shape resource will be created if possible, so the main thread doesn't have to
+	bool require_collision_shape = false;
 	// If true, the mesh will be used in a context with LOD, which might require a few extra things in the way it is
 	// built
 	bool lod_hint = false;
@@ -57,27 +69,41 @@ public:
 	uint8_t detail_texture_generator_override_begin_lod_index = 0;
 	bool detail_texture_use_gpu = false;
 	bool block_generation_use_gpu = false;
+	// If true, the task was scheduled because voxels got edited, and will run before tasks caused by streaming
+	bool caused_by_edit = false;
 	PriorityDependency priority_dependency;
 	std::shared_ptr<MeshingDependency> meshing_dependency;
 	std::shared_ptr<VoxelData> data;
 	DetailRenderingSettings detail_texture_settings;
 	Ref<VoxelGenerator> detail_texture_generator_override;
+	// If set, the mesh is loaded from this stream when it was baked with the same settings, and is saved to it after
+	// being built otherwise.
+	Ref<VoxelStream> baked_mesh_stream;
+	uint64_t baked_mesh_settings_hash = 0;
 	TaskCancellationToken cancellation_token;
 
 private:
+	bool is_output_known_empty() const;
+	bool try_load_baked_mesh();
+	void save_baked_mesh();
 	void gather_voxels_gpu(zylann::ThreadedTaskContext &ctx);
 	void gather_voxels_cpu();
 	void build_mesh();
+	void finish_output();
 
 	bool _has_run = false;
 	bool _too_far = false;
 	bool _has_mesh_resource = false;
+	bool _has_staged_surfaces = false;
+	bool _has_collision_shape = false;
 	uint8_t _stage = 0;
 	VoxelBuffer _voxels;
 	VoxelMesher::Output _surfaces_output;
 	Ref<Mesh> _mesh;
 	Ref<Mesh> _shadow_occluder_mesh;
+	Ref<Shape3D> _collision_shape;
 	StdVector<uint16_t> _mesh_material_indices; // Indexed by mesh surface
+	StdVector<zylann::godot::StagedMeshSurface> _staged_surfaces;
 	std::shared_ptr<DetailTextureOutput> _detail_textures;
 	StdVector<GenerateBlockGPUTaskResult> _gpu_generation_results;
 };
@@ -92,6 +118,20 @@ Ref<ArrayMesh> build_mesh( //
 		StdVector<uint16_t> &mesh_material_indices //
 );
 
+// Formats surfaces for the renderer so a mesh can be created from them with less work on the main thread. Empty
+// surfaces are skipped, and material indices of the others are written to `mesh_material_indices`, like `build_mesh`.
+// Can be called from any thread. Returns false if staging is not supported, in which case outputs are left empty.
+bool stage_mesh_surfaces(
+		Span<const VoxelMesher::Output::Surface> surfaces,
+		Mesh::PrimitiveType primitive,
+		int flags,
+		StdVector<zylann::godot::StagedMeshSurface> &out_surfaces,
+		StdVector<uint16_t> &mesh_material_indices
+);
+
+// Builds a mesh resource from surfaces formatted with `stage_mesh_surfaces`. Returns null if the mesh is empty.
+Ref<ArrayMesh> build_mesh(Span<const zylann::godot::StagedMeshSurface> surfaces);
+
 // Builds a triangles mesh resource from a single surface. If the surface is empty, returns null.
 Ref<ArrayMesh> build_mesh(Array surface);
 
@@ -0,0 +1,124 @@
+#include "occluder_boxes.h"
+#include "../util/errors.h"
+#include "../util/math/conv.h"
+#include "../util/profiling.h"
+#include <algorithm>
+
+namespace zylann::voxel {
+
+void find_occluder_boxes(
+		Span<const uint8_t> solid_cells,
+		const Vector3i grid_size,
+		const Vector3f origin,
+		const float cell_size,
+		StdVector<Box3f> &out_boxes
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(solid_cells.size() == static_cast<size_t>(Vector3iUtil::get_volume(grid_size)));
+
+	// Cells already covered by a box
+	static thread_local StdVector<uint8_t> tls_visited;
+	StdVector<uint8_t> &visited = tls_visited;
+	visited.clear();
+	visited.resize(solid_cells.size(), 0);
+
+	static thread_local StdVector<Box3i> tls_boxes;
+	StdVector<Box3i> &boxes = tls_boxes;
+	boxes.clear();
+
+	// ZXY order
+	const unsigned int row_size = grid_size.y;
+	const unsigned int deck_size = grid_size.x * grid_size.y;
+
+	struct L {
+		static inline bool is_free(Span<const uint8_t> solid, Span<const uint8_t> visited, unsigned int i) {
+			return solid[i] != 0 && visited[i] == 0;
+		}
+	};
+
+	// Greedy expansion, first along Y, then X, then Z. This doesn't find the optimal set of boxes, but it is fast and
+	// works well on the large uniform regions we are interested in.
+	for (int z = 0; z < grid_size.z; ++z) {
+		for (int x = 0; x < grid_size.x; ++x) {
+			for (int y = 0; y < grid_size.y; ++y) {
+				const unsigned int origin_index = y + x * row_size + z * deck_size;
+				if (!L::is_free(solid_cells, to_span(visited), origin_index)) {
+					continue;
+				}
+
+				int end_y = y + 1;
+				while (end_y < grid_size.y && L::is_free(solid_cells, to_span(visited), origin_index + (end_y - y))) {
+					++end_y;
+				}
+
+				int end_x = x + 1;
+				for (; end_x < grid_size.x; ++end_x) {
+					const unsigned int row_index = origin_index + (end_x - x) * row_size;
+					bool row_free = true;
+					for (int ry = 0; ry < end_y - y; ++ry) {
+						if (!L::is_free(solid_cells, to_span(visited), row_index + ry)) {
+							row_free = false;
+							break;
+						}
+					}
+					if (!row_free) {
+						break;
+					}
+				}
+
+				int end_z = z + 1;
+				for (; end_z < grid_size.z; ++end_z) {
+					const unsigned int deck_index = origin_index + (end_z - z) * deck_size;
+					bool deck_free = true;
+					for (int rx = 0; rx < end_x - x && deck_free; ++rx) {
+						const unsigned int row_index = deck_index + rx * row_size;
+						for (int ry = 0; ry < end_y - y; ++ry) {
+							if (!L::is_free(solid_cells, to_span(visited), row_index + ry)) {
+								deck_free = false;
+								break;
+							}
+						}
+					}
+					if (!deck_free) {
+						break;
+					}
+				}
+
+				for (int bz = z; bz < end_z; ++bz) {
+					for (int bx = x; bx < end_x; ++bx) {
+						const unsigned int row_index = y + bx * row_size + bz * deck_size;
+						for (int by = y; by < end_y; ++by) {
+							visited[row_index + (by - y)] = 1;
+						}
+					}
+				}
+
+				const Vector3i size(end_x - x, end_y - y, end_z - z);
+				if (size.x >= OCCLUDER_BOX_MIN_SIZE && size.y >= OCCLUDER_BOX_MIN_SIZE &&
+						size.z >= OCCLUDER_BOX_MIN_SIZE) {
+					boxes.push_back(Box3i(Vector3i(x, y, z), size));
+				}
+			}
+		}
+	}
+
+	if (boxes.size() > OCCLUDER_BOX_MAX_COUNT) {
+		std::partial_sort(
+				boxes.begin(),
+				boxes.begin() + OCCLUDER_BOX_MAX_COUNT,
+				boxes.end(),
+				[](const Box3i &a, const Box3i &b) {
+					return Vector3iUtil::get_volume(a.size) > Vector3iUtil::get_volume(b.size);
+				}
+		);
+		boxes.resize(OCCLUDER_BOX_MAX_COUNT);
+	}
+
+	for (const Box3i &box : boxes) {
+		const Vector3f min = origin + to_vec3f(box.position) * cell_size;
+		const Vector3f max = origin + to_vec3f(box.position + box.size) * cell_size;
+		out_boxes.push_back(Box3f{ min, max });
+	}
+}
+
+} // namespace zylann::voxel
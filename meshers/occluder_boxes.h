@@ -0,0 +1,34 @@
+#ifndef VOXEL_OCCLUDER_BOXES_H
+#define VOXEL_OCCLUDER_BOXES_H
+
+#include "../util/containers/span.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3f.h"
+#include "../util/math/box3i.h"
+#include "../util/math/vector3f.h"
+
+namespace zylann::voxel {
+
+// Occluder boxes are a conservative approximation of solid interiors of a mesh: everything inside them is hidden by
+// the mesh, so they can be given to occlusion culling systems. They are kept few and large, because small occluders
+// cost more than they save.
+
+// Boxes thinner than this along any axis are not worth using as occluders
+static const int OCCLUDER_BOX_MIN_SIZE = 2;
+// Maximum amount of boxes produced for a single block. The largest ones are kept.
+static const unsigned int OCCLUDER_BOX_MAX_COUNT = 8;
+
+// Finds large boxes covering solid cells of a grid ordered ZXY, where non-zero cells are solid. Boxes don't overlap.
+// They are appended to `out_boxes`, converted to mesh space, where the first cell starts at `origin` and cells have
+// a size of `cell_size`.
+void find_occluder_boxes(
+		Span<const uint8_t> solid_cells,
+		const Vector3i grid_size,
+		const Vector3f origin,
+		const float cell_size,
+		StdVector<Box3f> &out_boxes
+);
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_OCCLUDER_BOXES_H
@@ -6,6 +6,7 @@
 #include "../../util/math/funcs.h"
 #include "../../util/profiling.h"
 #include "transvoxel_tables.cpp"
+#include <algorithm>
 
 // #define VOXEL_TRANSVOXEL_REUSE_VERTEX_ON_COINCIDENT_CASES
 
@@ -155,6 +156,27 @@ inline Vector3f get_corner_gradient(unsigned int data_index, Span<const Sdf_T> s
 	return Vector3f(nx - px, ny - py, nz - pz);
 }
 
+// Corners are shared by neighbor cells, so their gradient is computed only once and then taken from the cache
+template <typename Sdf_T>
+inline Vector3f get_corner_gradient_cached(
+		Cache &cache,
+		const bool use_cache,
+		const Vector3i padded_pos,
+		unsigned int data_index,
+		Span<const Sdf_T> sdf_data,
+		const Vector3i block_size
+) {
+	if (!use_cache) {
+		return get_corner_gradient<Sdf_T>(data_index, sdf_data, block_size);
+	}
+	CornerGradientCell &cell = cache.get_corner_gradient_cell(padded_pos);
+	if (cell.z != padded_pos.z) {
+		cell.gradient = get_corner_gradient<Sdf_T>(data_index, sdf_data, block_size);
+		cell.z = padded_pos.z;
+	}
+	return cell.gradient;
+}
+
 inline uint32_t pack_bytes(const FixedArray<uint8_t, 4> &a) {
 	return (a[0] | (a[1] << 8) | (a[2] << 16) | (a[3] << 24));
 }
@@ -183,6 +205,83 @@ struct CellTextureDatas {
 	FixedArray<FixedArray<uint8_t, MAX_TEXTURE_BLENDS>, NVoxels> weights;
 };
 
+// Sorts 4 indices in ascending order, and gives where each sorted index was in the input
+inline void sort_indices_with_permutation(
+		FixedArray<uint8_t, MAX_TEXTURE_BLENDS> &indices,
+		FixedArray<uint8_t, MAX_TEXTURE_BLENDS> &permutation
+) {
+	for (unsigned int i = 0; i < permutation.size(); ++i) {
+		permutation[i] = i;
+	}
+	// Sorting network
+	const auto sort2 = [&indices, &permutation](unsigned int a, unsigned int b) {
+		if (indices[a] > indices[b]) {
+			std::swap(indices[a], indices[b]);
+			std::swap(permutation[a], permutation[b]);
+		}
+	};
+	sort2(0, 1);
+	sort2(2, 3);
+	sort2(0, 2);
+	sort2(1, 3);
+	sort2(1, 2);
+}
+
+// Fast path of `select_textures_4_per_voxel`, for cells where all used voxels have the same 4 indices, which is the
+// most common case. The result has the same weights, without having to accumulate and sort weights of all textures.
+template <unsigned int NVoxels, typename WeightSampler_T>
+bool try_select_textures_4_per_voxel_same_indices(
+		const FixedArray<unsigned int, NVoxels> &voxel_indices,
+		const Span<const uint16_t> indices_data,
+		const WeightSampler_T &weights_sampler,
+		const unsigned int case_code,
+		CellTextureDatas<NVoxels> &cell_textures
+) {
+	unsigned int ci = 0;
+	// Find the first voxel that isn't air
+	while (ci < voxel_indices.size() && (case_code & (1 << ci)) != 0) {
+		++ci;
+	}
+	if (ci == voxel_indices.size()) {
+		return false;
+	}
+
+	const uint16_t packed_indices = indices_data[voxel_indices[ci]];
+
+	for (++ci; ci < voxel_indices.size(); ++ci) {
+		if ((case_code & (1 << ci)) == 0 && indices_data[voxel_indices[ci]] != packed_indices) {
+			return false;
+		}
+	}
+
+	// With duplicate indices, weights of the same texture don't add up in the general path
+	if (!are_packed_u16_indices_distinct(packed_indices)) {
+		return false;
+	}
+
+	FixedArray<uint8_t, MAX_TEXTURE_BLENDS> permutation;
+	cell_textures.indices = decode_indices_from_packed_u16(packed_indices);
+	sort_indices_with_permutation(cell_textures.indices, permutation);
+	cell_textures.packed_indices = pack_bytes(cell_textures.indices);
+
+	for (ci = 0; ci < voxel_indices.size(); ++ci) {
+		FixedArray<uint8_t, MAX_TEXTURE_BLENDS> &dst_weights = cell_textures.weights[ci];
+
+		// Skip air voxels
+		if ((case_code & (1 << ci)) != 0) {
+			fill(dst_weights, uint8_t(0));
+			continue;
+		}
+
+		const FixedArray<uint8_t, 4> src_weights = weights_sampler.get_weights(voxel_indices[ci]);
+		for (unsigned int i = 0; i < dst_weights.size(); ++i) {
+			dst_weights[i] = src_weights[permutation[i]];
+		}
+	}
+
+	return true;
+}
+
 template <unsigned int NVoxels, typename WeightSampler_T>
 CellTextureDatas<NVoxels> select_textures_4_per_voxel(
 		const FixedArray<unsigned int, NVoxels> &voxel_indices,
@@ -193,6 +292,16 @@ CellTextureDatas<NVoxels> select_textures_4_per_voxel(
 	// TODO Optimization: this function takes almost half of the time when polygonizing non-empty cells.
 	// I wonder how it can be optimized further?
 
+	{
+		CellTextureDatas<NVoxels> cell_textures;
+		const bool same_indices = try_select_textures_4_per_voxel_same_indices(
+				voxel_indices, indices_data, weights_sampler, case_code, cell_textures
+		);
+		if (same_indices) {
+			return cell_textures;
+		}
+	}
+
 	struct IndexAndWeight {
 		unsigned int index;
 		unsigned int weight;
@@ -329,6 +438,77 @@ inline float get_isolevel<float>() {
 	return 0.f;
 }
 
+// Computes one bit per voxel telling if it is above the isolevel. Bits are packed in 64-bit words along Y, with
+// `words_per_column` words for each column of voxels, and columns in ZX order.
+template <typename Sdf_T>
+void compute_sign_bits(
+		Span<const Sdf_T> sdf_data,
+		const Vector3i size,
+		const Sdf_T isolevel,
+		const unsigned int words_per_column,
+		StdVector<uint64_t> &out_bits
+) {
+	ZN_PROFILE_SCOPE();
+	out_bits.resize(size.x * size.z * words_per_column);
+
+	unsigned int column_index = 0;
+	for (int z = 0; z < size.z; ++z) {
+		for (int x = 0; x < size.x; ++x, ++column_index) {
+			const unsigned int data_index = Vector3iUtil::get_zxy_index(Vector3i(x, 0, z), size);
+			const Span<const Sdf_T> column = sdf_data.sub(data_index, size.y);
+
+			for (unsigned int word_index = 0; word_index < words_per_column; ++word_index) {
+				const unsigned int y0 = word_index * 64;
+				const unsigned int count = math::min(64u, size.y - y0);
+				// Branchless so the compiler can vectorize it
+				uint64_t word = 0;
+				for (unsigned int i = 0; i < count; ++i) {
+					word |= uint64_t(column[y0 + i] > isolevel) << i;
+				}
+				out_bits[column_index * words_per_column + word_index] = word;
+			}
+		}
+	}
+}
+
+// Sign bits of the voxel above each voxel of a column
+inline uint64_t get_next_sign_bits(const uint64_t *column, unsigned int word_index, unsigned int words_per_column) {
+	uint64_t bits = column[word_index] >> 1;
+	if (word_index + 1 < words_per_column) {
+		bits |= column[word_index + 1] << 63;
+	}
+	return bits;
+}
+
+// Iterates indices of bits set in a sequence of 64-bit words, in increasing order
+class SetBitIterator {
+public:
+	SetBitIterator(Span<const uint64_t> words) : _words(words) {
+		if (_words.size() > 0) {
+			_current = _words[0];
+		}
+	}
+
+	bool next(unsigned int &out_index) {
+		while (_current == 0) {
+			++_word_index;
+			if (_word_index >= _words.size()) {
+				return false;
+			}
+			_current = _words[_word_index];
+		}
+		out_index = _word_index * 64 + math::get_lowest_set_bit_index_64(_current);
+		// Clear lowest bit
+		_current &= _current - 1;
+		return true;
+	}
+
+private:
+	Span<const uint64_t> _words;
+	unsigned int _word_index = 0;
+	uint64_t _current = 0;
+};
+
 // This function is template so we avoid branches and checks when sampling voxels
 template <typename Sdf_T, typename WeightSampler_T>
 void build_regular_mesh(
@@ -342,7 +522,8 @@ void build_regular_mesh(
 		MeshArrays &output,
 		StdVector<CellInfo> *cell_info,
 		const float edge_clamp_margin,
-		const bool textures_skip_air_voxels
+		const bool textures_skip_air_voxels,
+		const ReferenceOptions reference_options
 ) {
 	ZN_PROFILE_SCOPE();
 
@@ -373,38 +554,93 @@ void build_regular_mesh(
 	// Get direct representation of the isolevel (not always zero since we are not using signed integers yet)
 	const Sdf_T isolevel = get_isolevel<Sdf_T>();
 
-	// Iterate all cells with padding (expected to be neighbors)
+	const bool cache_corner_gradients = !reference_options.compute_all_corner_gradients;
+
+	// Signs of all voxels are computed up-front, so cells not crossing the isolevel can be found 64 at a time with
+	// bitwise operations. Most cells of a typical block don't cross it, and are never visited.
+	const unsigned int words_per_column = (block_size_with_padding.y + 63) / 64;
+	const bool sign_bits_prepass_enabled = !reference_options.check_cell_corners;
+	static thread_local StdVector<uint64_t> tls_sign_bits;
+	StdVector<uint64_t> &sign_bits = tls_sign_bits;
+	if (sign_bits_prepass_enabled) {
+		compute_sign_bits(sdf_data, block_size_with_padding, isolevel, words_per_column, sign_bits);
+	}
+
+	// Only cells between min and max positions along Y can be visited
+	static thread_local StdVector<uint64_t> tls_y_range_bits;
+	StdVector<uint64_t> &y_range_bits = tls_y_range_bits;
+	y_range_bits.assign(words_per_column, 0);
+	for (int y = min_pos.y; y < max_pos.y; ++y) {
+		y_range_bits[y / 64] |= uint64_t(1) << (y % 64);
+	}
+
+	static thread_local StdVector<uint64_t> tls_crossing_bits;
+	StdVector<uint64_t> &crossing_bits = tls_crossing_bits;
+	crossing_bits.resize(words_per_column);
+
+	// Iterate all cells with padding (expected to be neighbors).
+	// Cells are visited in the same order as voxels are laid out in memory (ZXY), so corners of successive cells
+	// share cache lines. Cells on the negative side are still visited first, which vertex reuse relies on.
 	Vector3i pos;
 	for (pos.z = min_pos.z; pos.z < max_pos.z; ++pos.z) {
-		for (pos.y = min_pos.y; pos.y < max_pos.y; ++pos.y) {
-			// TODO Optimization: change iteration to be ZXY? (Data is laid out with Y as deepest coordinate)
-			unsigned int data_index =
-					Vector3iUtil::get_zxy_index(Vector3i(min_pos.x, pos.y, pos.z), block_size_with_padding);
-
-			for (pos.x = min_pos.x; pos.x < max_pos.x; ++pos.x, data_index += block_size_with_padding.y) {
-				{
-					// The chosen comparison here is very important. This relates to case selections where 4 samples
-					// are equal to the isolevel and 4 others are above or below:
-					// In one of these two cases, there has to be a surface to extract, otherwise no surface will be
-					// allowed to appear if it happens to line up with integer coordinates.
-					// If we used `<` instead of `>`, it would appear to work, but would break those edge cases.
-					// `>` is chosen because it must match the comparison we do with case selection (in Transvoxel
-					// it is inverted).
-					const bool s = sdf_data[data_index] > isolevel;
+		for (pos.x = min_pos.x; pos.x < max_pos.x; ++pos.x) {
+			const unsigned int row_data_index =
+					Vector3iUtil::get_zxy_index(Vector3i(pos.x, 0, pos.z), block_size_with_padding);
+
+			if (sign_bits_prepass_enabled) {
+				// The 4 columns of voxels touched by this row of cells
+				const unsigned int column_index = pos.z * block_size_with_padding.x + pos.x;
+				FixedArray<const uint64_t *, 4> columns;
+				columns[0] = &sign_bits[column_index * words_per_column];
+				columns[1] = &sign_bits[(column_index + 1) * words_per_column];
+				columns[2] = &sign_bits[(column_index + block_size_with_padding.x) * words_per_column];
+				columns[3] = &sign_bits[(column_index + block_size_with_padding.x + 1) * words_per_column];
+
+				// A cell crosses the isolevel if its 8 corners don't all have the same sign.
+				// The comparison used to compute signs is very important. This relates to case selections where 4
+				// samples are equal to the isolevel and 4 others are above or below:
+				// In one of these two cases, there has to be a surface to extract, otherwise no surface will be
+				// allowed to appear if it happens to line up with integer coordinates.
+				// If we used `<` instead of `>`, it would appear to work, but would break those edge cases.
+				// `>` is chosen because it must match the comparison we do with case selection (in Transvoxel
+				// it is inverted).
+				for (unsigned int word_index = 0; word_index < words_per_column; ++word_index) {
+					uint64_t any_above = 0;
+					uint64_t all_above = ~uint64_t(0);
+					for (const uint64_t *column : columns) {
+						const uint64_t bits = column[word_index];
+						const uint64_t next_bits = get_next_sign_bits(column, word_index, words_per_column);
+						any_above |= bits | next_bits;
+						all_above &= bits & next_bits;
+					}
+					crossing_bits[word_index] = any_above & ~all_above & y_range_bits[word_index];
+				}
 
+			} else {
+				// Reference check, comparing the 8 corners of each cell
+				std::fill(crossing_bits.begin(), crossing_bits.end(), 0);
+				for (int y = min_pos.y; y < max_pos.y; ++y) {
+					const unsigned int data_index = row_data_index + y;
+					const bool s = sdf_data[data_index] > isolevel;
 					if ( //
-							(sdf_data[data_index + n010] > isolevel) == s &&
-							(sdf_data[data_index + n100] > isolevel) == s &&
-							(sdf_data[data_index + n110] > isolevel) == s &&
-							(sdf_data[data_index + n001] > isolevel) == s &&
-							(sdf_data[data_index + n011] > isolevel) == s &&
-							(sdf_data[data_index + n101] > isolevel) == s &&
-							(sdf_data[data_index + n111] > isolevel) == s) {
-						// Not crossing the isolevel, this cell won't produce any geometry.
-						// We must figure this out as fast as possible, because it will happen a lot.
-						continue;
+							(sdf_data[data_index + n010] > isolevel) != s ||
+							(sdf_data[data_index + n100] > isolevel) != s ||
+							(sdf_data[data_index + n110] > isolevel) != s ||
+							(sdf_data[data_index + n001] > isolevel) != s ||
+							(sdf_data[data_index + n011] > isolevel) != s ||
+							(sdf_data[data_index + n101] > isolevel) != s ||
+							(sdf_data[data_index + n111] > isolevel) != s) {
+						crossing_bits[y / 64] |= uint64_t(1) << (y % 64);
 					}
 				}
+			}
+
+			SetBitIterator crossing_cells(to_span_const(crossing_bits));
+			unsigned int cell_y;
+
+			while (crossing_cells.next(cell_y)) {
+				pos.y = cell_y;
+				const unsigned int data_index = row_data_index + cell_y;
 
 				// ZN_PROFILE_SCOPE();
 
@@ -582,11 +818,21 @@ void build_regular_mesh(
 							// I'm not sure how to overcome this because if we sample low-detail normals, we get a
 							// "blocky" result due to SDF clipping. If we sample high-detail gradients, we get details,
 							// but if details are bumpy, we also get noisy results.
-							const Vector3f cg0 = get_corner_gradient<Sdf_T>(
-									corner_data_indices[v0], sdf_data, block_size_with_padding
+							const Vector3f cg0 = get_corner_gradient_cached<Sdf_T>(
+									cache,
+									cache_corner_gradients,
+									padded_corner_positions[v0],
+									corner_data_indices[v0],
+									sdf_data,
+									block_size_with_padding
 							);
-							const Vector3f cg1 = get_corner_gradient<Sdf_T>(
-									corner_data_indices[v1], sdf_data, block_size_with_padding
+							const Vector3f cg1 = get_corner_gradient_cached<Sdf_T>(
+									cache,
+									cache_corner_gradients,
+									padded_corner_positions[v1],
+									corner_data_indices[v1],
+									sdf_data,
+									block_size_with_padding
 							);
 							const Vector3f normal = normalized_not_null(cg0 * t0 + cg1 * t1);
 
@@ -629,8 +875,14 @@ void build_regular_mesh(
 
 						const Vector3i primary = p1;
 						const Vector3f primaryf = to_vec3f(primary);
-						const Vector3f cg1 =
-								get_corner_gradient<Sdf_T>(corner_data_indices[v1], sdf_data, block_size_with_padding);
+						const Vector3f cg1 = get_corner_gradient_cached<Sdf_T>(
+								cache,
+								cache_corner_gradients,
+								padded_corner_positions[v1],
+								corner_data_indices[v1],
+								sdf_data,
+								block_size_with_padding
+						);
 						const Vector3f normal = normalized_not_null(cg1);
 
 						Vector3f secondary;
@@ -689,8 +941,13 @@ void build_regular_mesh(
 
 							const Vector3i primary = t == 0 ? p1 : p0;
 							const Vector3f primaryf = to_vec3f(primary);
-							const Vector3f cg = get_corner_gradient<Sdf_T>(
-									corner_data_indices[vi], sdf_data, block_size_with_padding
+							const Vector3f cg = get_corner_gradient_cached<Sdf_T>(
+									cache,
+									cache_corner_gradients,
+									padded_corner_positions[vi],
+									corner_data_indices[vi],
+									sdf_data,
+									block_size_with_padding
 							);
 							const Vector3f normal = normalized_not_null(cg);
 
@@ -1345,11 +1602,30 @@ Span<const T> get_or_decompress_channel(const VoxelBuffer &voxels, StdVector<T>
 		}
 		return to_span_const(backing_buffer);
 
-	} else {
+	} else if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_NONE) {
 		Span<const uint8_t> data_bytes;
 		ZN_ASSERT(voxels.get_channel_as_bytes_read_only(channel, data_bytes) == true);
 		return data_bytes.reinterpret_cast_to<const T>();
+
+	} else {
+		backing_buffer.resize(Vector3iUtil::get_volume(voxels.get_size()));
+		voxels.decompress_channel_to(channel, to_span(backing_buffer).template reinterpret_cast_to<uint8_t>());
+		return to_span_const(backing_buffer);
+	}
+}
+
+Span<const uint8_t> get_or_decompress_sdf(const VoxelBuffer &voxels, unsigned int sdf_channel) {
+	if (voxels.get_channel_compression(sdf_channel) == VoxelBuffer::COMPRESSION_NONE) {
+		Span<const uint8_t> sdf_data_raw;
+		ZN_ASSERT(voxels.get_channel_as_bytes_read_only(sdf_channel, sdf_data_raw) == true);
+		return sdf_data_raw;
 	}
+	static thread_local StdVector<uint8_t> tls_sdf_backing_buffer;
+	tls_sdf_backing_buffer.resize(
+			VoxelBuffer::get_size_in_bytes_for_volume(voxels.get_size(), voxels.get_channel_depth(sdf_channel))
+	);
+	voxels.decompress_channel_to(sdf_channel, to_span(tls_sdf_backing_buffer));
+	return to_span_const(tls_sdf_backing_buffer);
 }
 
 TextureIndicesData get_texture_indices_data(
@@ -1363,8 +1639,8 @@ TextureIndicesData get_texture_indices_data(
 
 	if (voxels.is_uniform(channel)) {
 		const uint16_t encoded_indices = voxels.get_voxel(Vector3i(), channel);
-		data.default_indices = decode_indices_from_packed_u16(encoded_indices);
-		data.packed_default_indices = pack_bytes(data.default_indices);
+		data.packed_default_indices = decode_indices_from_packed_u16_to_u32(encoded_indices);
+		data.default_indices = unpack_bytes(data.packed_default_indices);
 
 		out_default_texture_indices_data.indices = data.default_indices;
 		out_default_texture_indices_data.packed_indices = data.packed_default_indices;
@@ -1467,13 +1743,13 @@ DefaultTextureIndicesData build_regular_mesh(
 		MeshArrays &output,
 		StdVector<CellInfo> *cell_infos,
 		const float edge_clamp_margin,
-		const bool textures_ignore_air_voxels
+		const bool textures_ignore_air_voxels,
+		const ReferenceOptions reference_options
 ) {
 	ZN_PROFILE_SCOPE();
 	// From this point, we expect the buffer to contain allocated data in the relevant channels.
 
-	Span<const uint8_t> sdf_data_raw;
-	ZN_ASSERT(voxels.get_channel_as_bytes_read_only(sdf_channel, sdf_data_raw) == true);
+	const Span<const uint8_t> sdf_data_raw = get_or_decompress_sdf(voxels, sdf_channel);
 
 	const unsigned int voxels_count = Vector3iUtil::get_volume(voxels.get_size());
 
@@ -1524,7 +1800,8 @@ DefaultTextureIndicesData build_regular_mesh(
 					output,
 					cell_infos,
 					edge_clamp_margin,
-					textures_ignore_air_voxels
+					textures_ignore_air_voxels,
+					reference_options
 			);
 		} break;
 
@@ -1541,7 +1818,8 @@ DefaultTextureIndicesData build_regular_mesh(
 					output,
 					cell_infos,
 					edge_clamp_margin,
-					textures_ignore_air_voxels
+					textures_ignore_air_voxels,
+					reference_options
 			);
 		} break;
 
@@ -1561,7 +1839,8 @@ DefaultTextureIndicesData build_regular_mesh(
 					output,
 					cell_infos,
 					edge_clamp_margin,
-					textures_ignore_air_voxels
+					textures_ignore_air_voxels,
+					reference_options
 			);
 		} break;
 
@@ -1593,8 +1872,7 @@ void build_transition_mesh(
 	ZN_PROFILE_SCOPE();
 	// From this point, we expect the buffer to contain allocated data in the relevant channels.
 
-	Span<const uint8_t> sdf_data_raw;
-	ZN_ASSERT(voxels.get_channel_as_bytes_read_only(sdf_channel, sdf_data_raw) == true);
+	const Span<const uint8_t> sdf_data_raw = get_or_decompress_sdf(voxels, sdf_channel);
 
 	const unsigned int voxels_count = Vector3iUtil::get_volume(voxels.get_size());
 
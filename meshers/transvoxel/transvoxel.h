@@ -97,6 +97,14 @@ struct ReuseCell {
 	unsigned int packed_texture_indices = 0;
 };
 
+// Gradient of the SDF at a corner, which is shared by up to 8 cells
+struct CornerGradientCell {
+	Vector3f gradient;
+	// Z coordinate of the corner the gradient was computed for. Decks of corners are recycled, so a different value
+	// means the gradient has to be computed.
+	int z = -1;
+};
+
 struct ReuseTransitionCell {
 	FixedArray<int, 12> vertices;
 	unsigned int packed_texture_indices = 0;
@@ -114,6 +122,13 @@ public:
 				fill(deck[j].vertices, -1);
 			}
 		}
+		for (unsigned int i = 0; i < _corner_gradients.size(); ++i) {
+			StdVector<CornerGradientCell> &deck = _corner_gradients[i];
+			deck.resize(deck_area);
+			for (size_t j = 0; j < deck.size(); ++j) {
+				deck[j].z = -1;
+			}
+		}
 	}
 
 	void reset_reuse_cells_2d(Vector3i p_block_size) {
@@ -128,11 +143,20 @@ public:
 
 	ReuseCell &get_reuse_cell(Vector3i pos) {
 		unsigned int j = pos.z & 1;
-		unsigned int i = pos.y * _block_size.x + pos.x;
+		// Same order as cells are visited
+		unsigned int i = pos.x * _block_size.y + pos.y;
 		ZN_ASSERT(i < _cache[j].size());
 		return _cache[j][i];
 	}
 
+	// Cells of a deck only touch corners of two decks, so gradients are kept for two decks of corners
+	CornerGradientCell &get_corner_gradient_cell(Vector3i pos) {
+		unsigned int j = pos.z & 1;
+		unsigned int i = pos.x * _block_size.y + pos.y;
+		ZN_ASSERT(i < _corner_gradients[j].size());
+		return _corner_gradients[j][i];
+	}
+
 	ReuseTransitionCell &get_reuse_cell_2d(int x, int y) {
 		unsigned int j = y & 1;
 		unsigned int i = x;
@@ -142,6 +166,7 @@ public:
 
 private:
 	FixedArray<StdVector<ReuseCell>, 2> _cache;
+	FixedArray<StdVector<CornerGradientCell>, 2> _corner_gradients;
 	FixedArray<StdVector<ReuseTransitionCell>, 2> _cache_2d;
 	Vector3i _block_size;
 };
@@ -158,6 +183,15 @@ struct CellInfo {
 	uint32_t triangle_count;
 };
 
+// Slower code paths of the mesher, which are only useful to test that the optimized ones give the same meshes
+struct ReferenceOptions {
+	// Find cells crossing the isolevel by checking the 8 corners of each cell, instead of using a pre-pass computing
+	// the sign of every voxel
+	bool check_cell_corners = false;
+	// Compute the gradient of a corner for every cell touching it, instead of taking it from the cache
+	bool compute_all_corner_gradients = false;
+};
+
 DefaultTextureIndicesData build_regular_mesh(
 		const VoxelBuffer &voxels,
 		const unsigned int sdf_channel,
@@ -167,7 +201,8 @@ DefaultTextureIndicesData build_regular_mesh(
 		MeshArrays &output,
 		StdVector<CellInfo> *cell_infos,
 		const float edge_clamp_margin,
-		const bool textures_ignore_air_voxels
+		const bool textures_ignore_air_voxels,
+		const ReferenceOptions reference_options = ReferenceOptions()
 );
 
 void build_transition_mesh(
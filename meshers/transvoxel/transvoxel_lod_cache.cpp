@@ -0,0 +1,38 @@
+#include "transvoxel_lod_cache.h"
+#include "../../util/hash_funcs.h"
+
+namespace zylann::voxel {
+
+uint64_t TransvoxelLodCache::Block::get_size_in_bytes() const {
+	uint64_t size = sizeof(Block) + lods.capacity() * sizeof(Lod);
+	for (const Lod &lod : lods) {
+		size += lod.indices.capacity() * sizeof(int32_t);
+	}
+	return size;
+}
+
+size_t TransvoxelLodCache::KeyHasher::operator()(const Key &key) const {
+	return hash_djb2_one_32(key.lod_index, Vector3iHasher::hash(key.origin_in_voxels));
+}
+
+std::shared_ptr<const TransvoxelLodCache::Block> TransvoxelLodCache::get(Vector3i origin_in_voxels, uint8_t lod_index) {
+	MutexLock mlock(_mutex);
+	std::shared_ptr<const Block> *block = _blocks.get(Key{ origin_in_voxels, lod_index });
+	return block != nullptr ? *block : nullptr;
+}
+
+void TransvoxelLodCache::set(Vector3i origin_in_voxels, uint8_t lod_index, std::shared_ptr<const Block> block) {
+	const uint64_t size_in_bytes = block->get_size_in_bytes();
+	const Key key{ origin_in_voxels, lod_index };
+
+	MutexLock mlock(_mutex);
+	_blocks.set(key, block, size_in_bytes);
+	_blocks.evict(MEMORY_BUDGET);
+}
+
+void TransvoxelLodCache::clear() {
+	MutexLock mlock(_mutex);
+	_blocks.clear();
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,62 @@
+#ifndef VOXEL_TRANSVOXEL_LOD_CACHE_H
+#define VOXEL_TRANSVOXEL_LOD_CACHE_H
+
+#include "../../util/containers/byte_budget_lru_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
+#include <memory>
+
+namespace zylann::voxel {
+
+// Keeps simplified index buffers produced for the mesh LODs of recently meshed blocks. Simplification is expensive,
+// and blocks are often meshed again while their regular mesh remains the same, for example when only their transition
+// meshes change after an edit in a neighbor block.
+// The least recently used blocks are dropped when memory usage exceeds the budget.
+// Thread-safe.
+class TransvoxelLodCache {
+public:
+	static const uint64_t MEMORY_BUDGET = 16 * 1024 * 1024;
+
+	struct Lod {
+		// Error of the simplified mesh, in the same units as vertex positions
+		float error;
+		StdVector<int32_t> indices;
+	};
+
+	struct Block {
+		// Identifies the regular mesh and settings the LODs were generated from
+		uint64_t source_hash;
+		StdVector<Lod> lods;
+
+		uint64_t get_size_in_bytes() const;
+	};
+
+	// Blocks are identified by their origin and LOD index. Different terrains using the same mesher may share them,
+	// which is fine because the source hash is checked before results are reused.
+	std::shared_ptr<const Block> get(Vector3i origin_in_voxels, uint8_t lod_index);
+	void set(Vector3i origin_in_voxels, uint8_t lod_index, std::shared_ptr<const Block> block);
+
+	void clear();
+
+private:
+	struct Key {
+		Vector3i origin_in_voxels;
+		uint8_t lod_index;
+
+		bool operator==(const Key &other) const {
+			return origin_in_voxels == other.origin_in_voxels && lod_index == other.lod_index;
+		}
+	};
+
+	struct KeyHasher {
+		size_t operator()(const Key &key) const;
+	};
+
+	ByteBudgetLRUMap<Key, std::shared_ptr<const Block>, KeyHasher> _blocks;
+	Mutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_TRANSVOXEL_LOD_CACHE_H
@@ -0,0 +1,55 @@
+#include "transvoxel_transition_cache.h"
+#include "../../util/hash_funcs.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+template <typename T>
+inline uint64_t get_capacity_in_bytes(const StdVector<T> &v) {
+	return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+uint64_t TransvoxelTransitionCache::Transition::get_size_in_bytes() const {
+	return sizeof(Transition) + get_capacity_in_bytes(arrays.vertices) + get_capacity_in_bytes(arrays.normals) +
+			get_capacity_in_bytes(arrays.lod_data) + get_capacity_in_bytes(arrays.texturing_data) +
+			get_capacity_in_bytes(arrays.indices);
+}
+
+size_t TransvoxelTransitionCache::KeyHasher::operator()(const Key &key) const {
+	const uint32_t h = hash_djb2_one_32(key.lod_index, Vector3iHasher::hash(key.origin_in_voxels));
+	return hash_djb2_one_32(key.side, h);
+}
+
+std::shared_ptr<const TransvoxelTransitionCache::Transition> TransvoxelTransitionCache::get(
+		Vector3i origin_in_voxels,
+		uint8_t lod_index,
+		uint8_t side
+) {
+	MutexLock mlock(_mutex);
+	std::shared_ptr<const Transition> *transition = _transitions.get(Key{ origin_in_voxels, lod_index, side });
+	return transition != nullptr ? *transition : nullptr;
+}
+
+void TransvoxelTransitionCache::set(
+		Vector3i origin_in_voxels,
+		uint8_t lod_index,
+		uint8_t side,
+		std::shared_ptr<const Transition> transition
+) {
+	const uint64_t size_in_bytes = transition->get_size_in_bytes();
+	const Key key{ origin_in_voxels, lod_index, side };
+
+	MutexLock mlock(_mutex);
+	_transitions.set(key, transition, size_in_bytes);
+	_transitions.evict(MEMORY_BUDGET);
+}
+
+void TransvoxelTransitionCache::clear() {
+	MutexLock mlock(_mutex);
+	_transitions.clear();
+}
+
+} // namespace zylann::voxel
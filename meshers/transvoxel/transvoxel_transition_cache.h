@@ -0,0 +1,58 @@
+#ifndef VOXEL_TRANSVOXEL_TRANSITION_CACHE_H
+#define VOXEL_TRANSVOXEL_TRANSITION_CACHE_H
+
+#include "../../util/containers/byte_budget_lru_map.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
+#include "transvoxel.h"
+#include <memory>
+
+namespace zylann::voxel {
+
+// Keeps transition meshes of recently meshed blocks, one per side. Each of them only depends on a thin layer of voxels
+// along its side, so when a block is meshed again after an edit, sides far from the edit can be reused as-is.
+// The least recently used transitions are dropped when memory usage exceeds the budget.
+// Thread-safe.
+class TransvoxelTransitionCache {
+public:
+	static const uint64_t MEMORY_BUDGET = 8 * 1024 * 1024;
+
+	struct Transition {
+		// Identifies the border voxels and settings the mesh was generated from
+		uint64_t source_hash;
+		// Indices start from zero, they must be offset when appended after other geometry
+		transvoxel::MeshArrays arrays;
+
+		uint64_t get_size_in_bytes() const;
+	};
+
+	// Transitions are identified by the origin and LOD index of their block, and the side they are on. Different
+	// terrains using the same mesher may share them, which is fine because the source hash is checked before results
+	// are reused.
+	std::shared_ptr<const Transition> get(Vector3i origin_in_voxels, uint8_t lod_index, uint8_t side);
+	void set(Vector3i origin_in_voxels, uint8_t lod_index, uint8_t side, std::shared_ptr<const Transition> transition);
+
+	void clear();
+
+private:
+	struct Key {
+		Vector3i origin_in_voxels;
+		uint8_t lod_index;
+		uint8_t side;
+
+		bool operator==(const Key &other) const {
+			return origin_in_voxels == other.origin_in_voxels && lod_index == other.lod_index && side == other.side;
+		}
+	};
+
+	struct KeyHasher {
+		size_t operator()(const Key &key) const;
+	};
+
+	ByteBudgetLRUMap<Key, std::shared_ptr<const Transition>, KeyHasher> _transitions;
+	Mutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_TRANSVOXEL_TRANSITION_CACHE_H
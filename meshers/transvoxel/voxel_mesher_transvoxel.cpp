@@ -5,14 +5,21 @@
 #include "../../storage/voxel_buffer_gd.h"
 #include "../../storage/voxel_data.h"
 #include "../../thirdparty/meshoptimizer/meshoptimizer.h"
+#include "../../util/containers/container_funcs.h"
+#include "../../util/containers/std_unordered_map.h"
 #include "../../util/godot/classes/array_mesh.h"
 #include "../../util/godot/classes/rendering_server.h"
 #include "../../util/godot/classes/shader.h"
 #include "../../util/godot/classes/shader_material.h"
 #include "../../util/godot/core/packed_arrays.h"
+#include "../../util/hash_funcs.h"
 #include "../../util/math/conv.h"
 #include "../../util/profiling.h"
+#include "../occluder_boxes.h"
+#include "transvoxel_lod_cache.h"
+#include "transvoxel_transition_cache.h"
 #include "transvoxel_tables.cpp"
+#include <algorithm>
 
 using namespace zylann::godot;
 
@@ -60,6 +67,8 @@ void VoxelMesherTransvoxel::free_static_resources() {
 
 VoxelMesherTransvoxel::VoxelMesherTransvoxel() {
 	set_padding(transvoxel::MIN_PADDING, transvoxel::MAX_PADDING);
+	_lod_cache = make_unique_instance<TransvoxelLodCache>();
+	_transition_cache = make_unique_instance<TransvoxelTransitionCache>();
 }
 
 VoxelMesherTransvoxel::~VoxelMesherTransvoxel() {}
@@ -72,6 +81,28 @@ int VoxelMesherTransvoxel::get_used_channels_mask() const {
 	return (1 << VoxelBuffer::CHANNEL_SDF);
 }
 
+bool VoxelMesherTransvoxel::is_output_known_empty(Span<const std::shared_ptr<VoxelBuffer>> blocks) const {
+	const VoxelBuffer::ChannelId sdf_channel = VoxelBuffer::CHANNEL_SDF;
+	bool all_inside = true;
+	bool all_outside = true;
+
+	for (const std::shared_ptr<VoxelBuffer> &block : blocks) {
+		if (block == nullptr || !block->is_uniform(sdf_channel)) {
+			return false;
+		}
+		const bool inside = block->get_voxel_f(0, 0, 0, sdf_channel) < 0.f;
+		all_inside &= inside;
+		all_outside &= !inside;
+	}
+
+	if (all_inside) {
+		// Solid blocks still produce occluder boxes
+		return !_occluder_boxes_enabled;
+	}
+	// Without a change of sign, the isosurface can't cross any cell
+	return all_outside;
+}
+
 bool VoxelMesherTransvoxel::is_generating_collision_surface() const {
 	// Via submesh indices
 	return true;
@@ -129,6 +160,179 @@ void remap_vertex_array(
 	);
 }
 
+// Gets the texture with the highest blending weight over the 3 corners of a triangle
+uint8_t get_triangle_main_texture(const Vector2f *corners_texturing_data) {
+	// See `add_texture_data` in transvoxel.cpp for the layout
+	struct IntUV {
+		uint32_t packed_indices;
+		uint32_t packed_weights;
+	};
+	static_assert(sizeof(IntUV) == sizeof(Vector2f), "Expected same binary size");
+
+	FixedArray<uint8_t, 12> indices;
+	FixedArray<uint8_t, 12> weights;
+	for (unsigned int corner = 0; corner < 3; ++corner) {
+		const IntUV iuv = *reinterpret_cast<const IntUV *>(&corners_texturing_data[corner]);
+		for (unsigned int i = 0; i < 4; ++i) {
+			indices[corner * 4 + i] = (iuv.packed_indices >> (i * 8)) & 0xff;
+			weights[corner * 4 + i] = (iuv.packed_weights >> (i * 8)) & 0xff;
+		}
+	}
+
+	uint8_t main_texture = indices[0];
+	unsigned int main_weight = 0;
+	for (unsigned int i = 0; i < indices.size(); ++i) {
+		unsigned int weight = 0;
+		for (unsigned int j = 0; j < indices.size(); ++j) {
+			if (indices[j] == indices[i]) {
+				weight += weights[j];
+			}
+		}
+		if (weight > main_weight) {
+			main_weight = weight;
+			main_texture = indices[i];
+		}
+	}
+	return main_texture;
+}
+
+// Duplicates vertices shared by triangles having different main textures. Meshoptimizer treats vertices having the
+// same position but a different index as attribute seams, and only collapses them along the seam, which preserves
+// boundaries between textures.
+void split_texture_seams(
+		Span<const int32_t> src_indices,
+		Span<const Vector3f> src_positions,
+		Span<const Vector2f> src_texturing_data,
+		StdVector<unsigned int> &dst_indices,
+		StdVector<Vector3f> &dst_positions,
+		// Index of the source vertex of each split vertex
+		StdVector<unsigned int> &dst_source_vertices
+) {
+	ZN_PROFILE_SCOPE();
+
+	static const uint32_t NO_TEXTURE = 0xffffffff;
+
+	// First split of each vertex, which is the only one for most vertices
+	static thread_local StdVector<uint32_t> tls_vertex_textures;
+	static thread_local StdVector<unsigned int> tls_vertex_splits;
+	// Other splits, keyed by source vertex and texture
+	static thread_local StdUnorderedMap<uint64_t, unsigned int> tls_extra_splits;
+
+	StdVector<uint32_t> &vertex_textures = tls_vertex_textures;
+	StdVector<unsigned int> &vertex_splits = tls_vertex_splits;
+	StdUnorderedMap<uint64_t, unsigned int> &extra_splits = tls_extra_splits;
+
+	vertex_textures.clear();
+	vertex_textures.resize(src_positions.size(), NO_TEXTURE);
+	vertex_splits.resize(src_positions.size());
+	extra_splits.clear();
+
+	dst_indices.resize(src_indices.size());
+	dst_positions.clear();
+	dst_source_vertices.clear();
+
+	for (unsigned int triangle_index = 0; triangle_index + 2 < src_indices.size(); triangle_index += 3) {
+		FixedArray<Vector2f, 3> corners_texturing_data;
+		for (unsigned int corner = 0; corner < 3; ++corner) {
+			corners_texturing_data[corner] = src_texturing_data[src_indices[triangle_index + corner]];
+		}
+		const uint32_t texture = get_triangle_main_texture(corners_texturing_data.data());
+
+		for (unsigned int corner = 0; corner < 3; ++corner) {
+			const unsigned int src_vertex = src_indices[triangle_index + corner];
+			unsigned int split_vertex;
+
+			if (vertex_textures[src_vertex] == texture) {
+				split_vertex = vertex_splits[src_vertex];
+
+			} else if (vertex_textures[src_vertex] == NO_TEXTURE) {
+				split_vertex = dst_positions.size();
+				vertex_textures[src_vertex] = texture;
+				vertex_splits[src_vertex] = split_vertex;
+				dst_positions.push_back(src_positions[src_vertex]);
+				dst_source_vertices.push_back(src_vertex);
+
+			} else {
+				const uint64_t key = (static_cast<uint64_t>(src_vertex) << 32) | texture;
+				auto it = extra_splits.find(key);
+				if (it != extra_splits.end()) {
+					split_vertex = it->second;
+				} else {
+					split_vertex = dst_positions.size();
+					extra_splits.insert({ key, split_vertex });
+					dst_positions.push_back(src_positions[src_vertex]);
+					dst_source_vertices.push_back(src_vertex);
+				}
+			}
+
+			dst_indices[triangle_index + corner] = split_vertex;
+		}
+	}
+}
+
+// Simplifies triangles of a mesh. Resulting indices refer to the same vertices.
+// If texturing data is provided, boundaries between textures are preserved.
+void simplify_indices(
+		Span<const int32_t> src_indices,
+		Span<const Vector3f> positions,
+		Span<const Vector2f> texturing_data,
+		unsigned int target_index_count,
+		float target_error,
+		StdVector<int32_t> &dst_indices,
+		float &out_error
+) {
+	ZN_PROFILE_SCOPE();
+
+	static thread_local StdVector<unsigned int> tls_split_indices;
+	static thread_local StdVector<Vector3f> tls_split_positions;
+	static thread_local StdVector<unsigned int> tls_split_source_vertices;
+
+	const bool split_textures = texturing_data.size() != 0;
+
+	const unsigned int *indices = reinterpret_cast<const unsigned int *>(src_indices.data());
+	Span<const Vector3f> simplified_positions = positions;
+
+	if (split_textures) {
+		split_texture_seams(
+				src_indices,
+				positions,
+				texturing_data,
+				tls_split_indices,
+				tls_split_positions,
+				tls_split_source_vertices
+		);
+		indices = tls_split_indices.data();
+		simplified_positions = to_span(tls_split_positions);
+	}
+
+	dst_indices.resize(src_indices.size());
+
+	{
+		ZN_PROFILE_SCOPE_NAMED("meshopt_simplify");
+
+		// TODO See build script about the `zylannmeshopt::` namespace
+		const unsigned int lod_index_count = zylannmeshopt::meshopt_simplify(
+				reinterpret_cast<unsigned int *>(dst_indices.data()),
+				indices,
+				src_indices.size(),
+				&simplified_positions[0].x,
+				simplified_positions.size(),
+				sizeof(Vector3f),
+				target_index_count,
+				target_error,
+				&out_error
+		);
+
+		dst_indices.resize(lod_index_count);
+	}
+
+	if (split_textures) {
+		for (int32_t &i : dst_indices) {
+			i = tls_split_source_vertices[i];
+		}
+	}
+}
+
 void simplify(
 		const transvoxel::MeshArrays &src_mesh,
 		transvoxel::MeshArrays &dst_mesh,
@@ -146,43 +350,32 @@ void simplify(
 
 	const unsigned int target_index_count = p_target_ratio * src_mesh.indices.size();
 
-	static thread_local StdVector<unsigned int> lod_indices;
-	lod_indices.clear();
-	lod_indices.resize(src_mesh.indices.size());
+	static thread_local StdVector<int32_t> lod_indices;
 
 	float lod_error = 0.f;
 
 	// Simplify
-	{
-		ZN_PROFILE_SCOPE_NAMED("meshopt_simplify");
-
-		// TODO See build script about the `zylannmeshopt::` namespace
-		const unsigned int lod_index_count = zylannmeshopt::meshopt_simplify(
-				&lod_indices[0],
-				reinterpret_cast<const unsigned int *>(src_mesh.indices.data()),
-				src_mesh.indices.size(),
-				&src_mesh.vertices[0].x,
-				src_mesh.vertices.size(),
-				sizeof(Vector3f),
-				target_index_count,
-				p_error_threshold,
-				&lod_error
-		);
-
-		lod_indices.resize(lod_index_count);
-	}
+	simplify_indices(
+			to_span(src_mesh.indices),
+			to_span(src_mesh.vertices),
+			to_span(src_mesh.texturing_data),
+			target_index_count,
+			p_error_threshold,
+			lod_indices,
+			lod_error
+	);
 
 	// Produce output
 
-	Array surface;
-	surface.resize(Mesh::ARRAY_MAX);
-
 	static thread_local StdVector<unsigned int> remap_indices;
 	remap_indices.clear();
 	remap_indices.resize(src_mesh.vertices.size());
 
 	const unsigned int unique_vertex_count = zylannmeshopt::meshopt_optimizeVertexFetchRemap(
-			&remap_indices[0], lod_indices.data(), lod_indices.size(), src_mesh.vertices.size()
+			&remap_indices[0],
+			reinterpret_cast<const unsigned int *>(lod_indices.data()),
+			lod_indices.size(),
+			src_mesh.vertices.size()
 	);
 
 	remap_vertex_array(src_mesh.vertices, dst_mesh.vertices, remap_indices, unique_vertex_count);
@@ -194,12 +387,294 @@ void simplify(
 	// TODO Not sure if arguments are correct
 	zylannmeshopt::meshopt_remapIndexBuffer(
 			reinterpret_cast<unsigned int *>(dst_mesh.indices.data()),
-			lod_indices.data(),
+			reinterpret_cast<const unsigned int *>(lod_indices.data()),
 			lod_indices.size(),
 			remap_indices.data()
 	);
 }
 
+uint64_t hash_bytes(Span<const uint8_t> bytes, uint64_t hash) {
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes.data() + i, sizeof(uint64_t));
+		hash = hash_djb2_one_64(word, hash);
+	}
+	for (; i < bytes.size(); ++i) {
+		hash = hash_djb2_one_64(bytes[i], hash);
+	}
+	return hash;
+}
+
+template <typename T>
+uint64_t hash_array(const StdVector<T> &array, uint64_t hash) {
+	const Span<const uint8_t> bytes(reinterpret_cast<const uint8_t *>(array.data()), array.size() * sizeof(T));
+	return hash_djb2_one_64(array.size(), hash_bytes(bytes, hash));
+}
+
+// Hashes voxels of a channel within a box
+uint64_t hash_voxels(const VoxelBuffer &voxels, unsigned int channel, const Box3i box, uint64_t hash) {
+	if (voxels.is_uniform(channel)) {
+		return hash_djb2_one_64(voxels.get_voxel(0, 0, 0, channel), hash);
+	}
+	Span<const uint8_t> data;
+	if (!voxels.get_channel_as_bytes_read_only(channel, data)) {
+		// Compressed channel, slower path
+		for (int z = box.position.z; z < box.position.z + box.size.z; ++z) {
+			for (int x = box.position.x; x < box.position.x + box.size.x; ++x) {
+				for (int y = box.position.y; y < box.position.y + box.size.y; ++y) {
+					hash = hash_djb2_one_64(voxels.get_voxel(x, y, z, channel), hash);
+				}
+			}
+		}
+		return hash;
+	}
+
+	const unsigned int bytes_per_voxel = VoxelBuffer::get_depth_byte_count(voxels.get_channel_depth(channel));
+	const Vector3i size = voxels.get_size();
+	// Voxels are ordered ZXY, so columns along Y are contiguous
+	for (int z = box.position.z; z < box.position.z + box.size.z; ++z) {
+		for (int x = box.position.x; x < box.position.x + box.size.x; ++x) {
+			const size_t begin = Vector3iUtil::get_zxy_index(Vector3i(x, box.position.y, z), size) * bytes_per_voxel;
+			hash = hash_bytes(data.sub(begin, box.size.y * bytes_per_voxel), hash);
+		}
+	}
+	return hash;
+}
+
+// Hashes everything the transition mesh of a side depends on. It only reads voxels in a layer along that side, a
+// bit thicker than the face itself so normals can be computed.
+uint64_t hash_transition_source(
+		const VoxelBuffer &voxels,
+		const int direction,
+		const uint8_t lod_index,
+		const VoxelMesherTransvoxel::TexturingMode texturing_mode,
+		const transvoxel::DefaultTextureIndicesData default_texture_indices_data,
+		const float edge_clamp_margin,
+		const bool textures_ignore_air_voxels
+) {
+	ZN_PROFILE_SCOPE();
+
+	static const int LAYER_THICKNESS = transvoxel::MIN_PADDING + 2;
+
+	const Vector3i size = voxels.get_size();
+	Box3i box(Vector3i(), size);
+	// Same convention as `face_to_block` in the Transvoxel implementation
+	switch (direction) {
+		case Cube::SIDE_NEGATIVE_X:
+			box.size.x = LAYER_THICKNESS;
+			break;
+		case Cube::SIDE_POSITIVE_X:
+			box.position.x = size.x - LAYER_THICKNESS;
+			box.size.x = LAYER_THICKNESS;
+			break;
+		case Cube::SIDE_NEGATIVE_Y:
+			box.size.y = LAYER_THICKNESS;
+			break;
+		case Cube::SIDE_POSITIVE_Y:
+			box.position.y = size.y - LAYER_THICKNESS;
+			box.size.y = LAYER_THICKNESS;
+			break;
+		case Cube::SIDE_NEGATIVE_Z:
+			box.size.z = LAYER_THICKNESS;
+			break;
+		case Cube::SIDE_POSITIVE_Z:
+			box.position.z = size.z - LAYER_THICKNESS;
+			box.size.z = LAYER_THICKNESS;
+			break;
+		default:
+			ZN_CRASH();
+	}
+
+	uint64_t hash = hash_djb2_one_64(direction);
+	hash = hash_djb2_one_64(lod_index, hash);
+	hash = hash_djb2_one_64(Vector3iHasher::hash(size), hash);
+	hash = hash_djb2_one_64(texturing_mode, hash);
+	hash = hash_djb2_one_64(static_cast<uint64_t>(edge_clamp_margin * 1'000'000.f), hash);
+	hash = hash_djb2_one_64(textures_ignore_air_voxels, hash);
+
+	const unsigned int sdf_channel = VoxelBuffer::CHANNEL_SDF;
+	hash = hash_djb2_one_64(voxels.get_channel_depth(sdf_channel), hash);
+	hash = hash_voxels(voxels, sdf_channel, box, hash);
+
+	if (texturing_mode == VoxelMesherTransvoxel::TEXTURES_BLEND_4_OVER_16) {
+		hash = hash_djb2_one_64(default_texture_indices_data.use, hash);
+		hash = hash_djb2_one_64(default_texture_indices_data.packed_indices, hash);
+		hash = hash_voxels(voxels, VoxelBuffer::CHANNEL_INDICES, box, hash);
+		hash = hash_voxels(voxels, VoxelBuffer::CHANNEL_WEIGHTS, box, hash);
+	}
+
+	return hash;
+}
+
+// Appends a mesh whose indices start from zero
+void append_mesh(transvoxel::MeshArrays &dst, const transvoxel::MeshArrays &src) {
+	const int32_t index_offset = dst.vertices.size();
+	append_array(dst.vertices, src.vertices);
+	append_array(dst.normals, src.normals);
+	append_array(dst.lod_data, src.lod_data);
+	append_array(dst.texturing_data, src.texturing_data);
+	const size_t indices_begin = dst.indices.size();
+	append_array(dst.indices, src.indices);
+	for (size_t i = indices_begin; i < dst.indices.size(); ++i) {
+		dst.indices[i] += index_offset;
+	}
+}
+
+// Generates index buffers of simplified versions of a mesh, each having about half the triangles of the previous one.
+std::shared_ptr<const TransvoxelLodCache::Block> build_mesh_lods(
+		const transvoxel::MeshArrays &mesh,
+		unsigned int lod_count,
+		float error_threshold,
+		uint64_t source_hash
+) {
+	ZN_PROFILE_SCOPE();
+
+	std::shared_ptr<TransvoxelLodCache::Block> block = make_shared_instance<TransvoxelLodCache::Block>();
+	block->source_hash = source_hash;
+	// Reserved because each LOD refers to the indices of the previous one
+	block->lods.reserve(lod_count);
+
+	// Errors are relative to the size of the mesh, while Godot expects them in mesh units
+	const float scale = zylannmeshopt::meshopt_simplifyScale(
+			&mesh.vertices[0].x, mesh.vertices.size(), sizeof(Vector3f)
+	);
+
+	static thread_local StdVector<int32_t> tls_lod_indices;
+	StdVector<int32_t> &lod_indices = tls_lod_indices;
+
+	Span<const int32_t> src_indices = to_span(mesh.indices);
+
+	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+		const unsigned int target_index_count = src_indices.size() / 2;
+		// Allow more error for lower details
+		const float target_error = error_threshold * static_cast<float>(lod_index + 1) / static_cast<float>(lod_count);
+
+		float lod_error = 0.f;
+		// Each LOD is simplified from the previous one, which is faster than starting from the full mesh
+		simplify_indices(
+				src_indices,
+				to_span(mesh.vertices),
+				to_span(mesh.texturing_data),
+				target_index_count,
+				target_error,
+				lod_indices,
+				lod_error
+		);
+
+		if (lod_indices.size() == 0 || lod_indices.size() >= src_indices.size()) {
+			// Can't simplify further within the error threshold
+			break;
+		}
+
+		block->lods.push_back(TransvoxelLodCache::Lod{ math::max(lod_error * scale, 0.0001f), lod_indices });
+		src_indices = to_span(block->lods.back().indices);
+	}
+
+	return block;
+}
+
+template <typename Sdf_T>
+void get_inside_samples(
+		Span<const Sdf_T> sdf_data,
+		const Vector3i block_size,
+		const Vector3i min,
+		const Vector3i max,
+		StdVector<uint8_t> &out_inside
+) {
+	unsigned int i = 0;
+	for (int z = min.z; z < max.z; ++z) {
+		for (int x = min.x; x < max.x; ++x) {
+			for (int y = min.y; y < max.y; ++y) {
+				out_inside[i] = sdf_data[Vector3iUtil::get_zxy_index(Vector3i(x, y, z), block_size)] < 0;
+				++i;
+			}
+		}
+	}
+}
+
+void generate_occluder_boxes(StdVector<Box3f> &out_boxes, const VoxelBuffer &voxels, const unsigned int lod_index) {
+	ZN_PROFILE_SCOPE();
+
+	const unsigned int sdf_channel = VoxelBuffer::CHANNEL_SDF;
+	const Vector3i block_size = voxels.get_size();
+
+	// Cells along the borders of the block are excluded, because their vertices can be moved inwards to make room
+	// for transition meshes
+	const Vector3i min = Vector3iUtil::create(transvoxel::MIN_PADDING + 1);
+	// Exclusive
+	const Vector3i max = block_size - Vector3iUtil::create(transvoxel::MAX_PADDING);
+	const Vector3i samples_size = max - min;
+	if (samples_size.x < 2 || samples_size.y < 2 || samples_size.z < 2) {
+		return;
+	}
+
+	static thread_local StdVector<uint8_t> tls_inside_samples;
+	StdVector<uint8_t> &inside_samples = tls_inside_samples;
+	inside_samples.resize(Vector3iUtil::get_volume(samples_size));
+
+	Span<const uint8_t> sdf_data;
+	if (voxels.is_uniform(sdf_channel)) {
+		const uint8_t inside = voxels.get_voxel_f(0, 0, 0, sdf_channel) < 0.f;
+		std::fill(inside_samples.begin(), inside_samples.end(), inside);
+
+	} else if (voxels.get_channel_as_bytes_read_only(sdf_channel, sdf_data)) {
+		switch (voxels.get_channel_depth(sdf_channel)) {
+			case VoxelBuffer::DEPTH_8_BIT:
+				get_inside_samples(sdf_data.reinterpret_cast_to<const int8_t>(), block_size, min, max, inside_samples);
+				break;
+			case VoxelBuffer::DEPTH_16_BIT:
+				get_inside_samples(sdf_data.reinterpret_cast_to<const int16_t>(), block_size, min, max, inside_samples);
+				break;
+			case VoxelBuffer::DEPTH_32_BIT:
+				get_inside_samples(sdf_data.reinterpret_cast_to<const float>(), block_size, min, max, inside_samples);
+				break;
+			default:
+				return;
+		}
+
+	} else {
+		// Compressed channel, slower path
+		unsigned int i = 0;
+		for (int z = min.z; z < max.z; ++z) {
+			for (int x = min.x; x < max.x; ++x) {
+				for (int y = min.y; y < max.y; ++y) {
+					inside_samples[i] = voxels.get_voxel_f(x, y, z, sdf_channel) < 0.f;
+					++i;
+				}
+			}
+		}
+	}
+
+	// A cell is solid if all its corners are inside, so the surface can't go through it
+	const Vector3i grid_size = samples_size - Vector3i(1, 1, 1);
+	static thread_local StdVector<uint8_t> tls_solid_cells;
+	StdVector<uint8_t> &solid_cells = tls_solid_cells;
+	solid_cells.resize(Vector3iUtil::get_volume(grid_size));
+
+	const unsigned int n010 = 1;
+	const unsigned int n100 = samples_size.y;
+	const unsigned int n001 = samples_size.y * samples_size.x;
+
+	unsigned int cell_index = 0;
+	for (int z = 0; z < grid_size.z; ++z) {
+		for (int x = 0; x < grid_size.x; ++x) {
+			for (int y = 0; y < grid_size.y; ++y) {
+				const unsigned int i = Vector3iUtil::get_zxy_index(Vector3i(x, y, z), samples_size);
+				solid_cells[cell_index] = inside_samples[i] && inside_samples[i + n010] && inside_samples[i + n100] &&
+						inside_samples[i + n010 + n100] && inside_samples[i + n001] &&
+						inside_samples[i + n010 + n001] && inside_samples[i + n100 + n001] &&
+						inside_samples[i + n010 + n100 + n001];
+				++cell_index;
+			}
+		}
+	}
+
+	const float lod_scale = 1 << lod_index;
+	const Vector3f origin = to_vec3f(min - Vector3iUtil::create(transvoxel::MIN_PADDING)) * lod_scale;
+	find_occluder_boxes(to_span(solid_cells), grid_size, origin, lod_scale, out_boxes);
+}
+
 } // namespace
 
 void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher::Input &input) {
@@ -219,6 +694,12 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 	mesh_arrays.clear();
 
 	const VoxelBuffer &voxels = input.voxels;
+
+	if (_occluder_boxes_enabled && input.visual_hint) {
+		// Done first, because solid blocks don't produce any mesh
+		generate_occluder_boxes(output.occluder_boxes, voxels, input.lod_index);
+	}
+
 	if (voxels.is_uniform(sdf_channel)) {
 		// There won't be anything to polygonize since the SDF has no variations, so it can't cross the isolevel
 		return;
@@ -226,9 +707,15 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 
 	// const uint64_t time_before = Time::get_singleton()->get_ticks_usec();
 
+	// When only collision is needed, texturing doesn't have to be computed. Unless the mesh gets simplified, because
+	// boundaries between textures are preserved, and the collider must match the mesh seen by clients.
+	const bool collision_only = !input.visual_hint && input.collision_hint;
+	const TexturingMode texture_mode =
+			collision_only && !_mesh_optimization_params.enabled ? TEXTURES_NONE : _texture_mode;
+
 	transvoxel::DefaultTextureIndicesData default_texture_indices_data;
 	StdVector<transvoxel::CellInfo> *cell_infos = nullptr;
-	if (input.detail_texture_hint) {
+	if (input.detail_texture_hint && input.visual_hint) {
 		transvoxel::get_tls_cell_infos().clear();
 		cell_infos = &transvoxel::get_tls_cell_infos();
 	}
@@ -237,7 +724,7 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 			voxels,
 			sdf_channel,
 			input.lod_index,
-			static_cast<transvoxel::TexturingMode>(_texture_mode),
+			static_cast<transvoxel::TexturingMode>(texture_mode),
 			tls_cache,
 			mesh_arrays,
 			cell_infos,
@@ -256,8 +743,7 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 
 	transvoxel::MeshArrays *combined_mesh_arrays = &mesh_arrays;
 	if (_mesh_optimization_params.enabled) {
-		// TODO When voxel texturing is enabled, this will decrease quality a lot.
-		// There is no support yet for taking textures into account when simplifying.
+		// Boundaries between textures are preserved, though blending within a texture may still lose quality.
 		// See https://github.com/zeux/meshoptimizer/issues/158
 		simplify(
 				mesh_arrays,
@@ -269,9 +755,37 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 		combined_mesh_arrays = &tls_simplified_mesh_arrays;
 	}
 
+	if (collision_only) {
+		// Transitions are not needed because they are not part of the collider. Rendering arrays are not built.
+		output.collision_surface.positions = combined_mesh_arrays->vertices;
+		append_array(output.collision_surface.indices, combined_mesh_arrays->indices);
+		output.primitive_type = Mesh::PRIMITIVE_TRIANGLES;
+		return;
+	}
+
 	output.collision_surface.submesh_vertex_end = combined_mesh_arrays->vertices.size();
 	output.collision_surface.submesh_index_end = combined_mesh_arrays->indices.size();
 
+	std::shared_ptr<const TransvoxelLodCache::Block> mesh_lods;
+	if (_mesh_lod_params.count > 0) {
+		// Transition meshes are not part of the hash, so results can be reused when only they change
+		uint64_t source_hash = hash_djb2_one_64(_mesh_lod_params.count);
+		source_hash =
+				hash_djb2_one_64(static_cast<uint64_t>(_mesh_lod_params.error_threshold * 1'000'000.f), source_hash);
+		source_hash = hash_array(combined_mesh_arrays->vertices, source_hash);
+		source_hash = hash_array(combined_mesh_arrays->texturing_data, source_hash);
+		source_hash = hash_array(combined_mesh_arrays->indices, source_hash);
+
+		mesh_lods = _lod_cache->get(input.origin_in_voxels, input.lod_index);
+
+		if (mesh_lods == nullptr || mesh_lods->source_hash != source_hash) {
+			mesh_lods = build_mesh_lods(
+					*combined_mesh_arrays, _mesh_lod_params.count, _mesh_lod_params.error_threshold, source_hash
+			);
+			_lod_cache->set(input.origin_in_voxels, input.lod_index, mesh_lods);
+		}
+	}
+
 	if (_transitions_enabled && input.lod_hint) {
 		// We combine transition meshes with the regular mesh, because it results in less draw calls than if they were
 		// separate. This only requires a vertex shader trick to discard them when neighbors change.
@@ -280,18 +794,44 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 		for (int dir = 0; dir < Cube::SIDE_COUNT; ++dir) {
 			ZN_PROFILE_SCOPE();
 
-			transvoxel::build_transition_mesh(
+			// Each side only depends on voxels along it, so after an edit, sides far from it don't have to be rebuilt.
+			// Transitions don't depend on the LOD of neighbors, so changes in them don't need remeshing either.
+			const uint64_t source_hash = hash_transition_source(
 					voxels,
-					sdf_channel,
 					dir,
 					input.lod_index,
-					static_cast<transvoxel::TexturingMode>(_texture_mode),
-					tls_cache,
-					*combined_mesh_arrays,
+					_texture_mode,
 					default_texture_indices_data,
 					_edge_clamp_margin,
 					_textures_ignore_air_voxels
 			);
+
+			std::shared_ptr<const TransvoxelTransitionCache::Transition> transition =
+					_transition_cache->get(input.origin_in_voxels, input.lod_index, dir);
+
+			if (transition == nullptr || transition->source_hash != source_hash) {
+				std::shared_ptr<TransvoxelTransitionCache::Transition> new_transition =
+						make_shared_instance<TransvoxelTransitionCache::Transition>();
+				new_transition->source_hash = source_hash;
+
+				transvoxel::build_transition_mesh(
+						voxels,
+						sdf_channel,
+						dir,
+						input.lod_index,
+						static_cast<transvoxel::TexturingMode>(_texture_mode),
+						tls_cache,
+						new_transition->arrays,
+						default_texture_indices_data,
+						_edge_clamp_margin,
+						_textures_ignore_air_voxels
+				);
+
+				_transition_cache->set(input.origin_in_voxels, input.lod_index, dir, new_transition);
+				transition = new_transition;
+			}
+
+			append_mesh(*combined_mesh_arrays, transition->arrays);
 		}
 	}
 
@@ -299,6 +839,22 @@ void VoxelMesherTransvoxel::build(VoxelMesher::Output &output, const VoxelMesher
 	fill_surface_arrays(gd_arrays, *combined_mesh_arrays);
 	output.surfaces.push_back({ gd_arrays, 0 });
 
+	if (mesh_lods != nullptr) {
+		// Transition meshes are kept intact in every LOD, they are already small and must match neighbors
+		Span<const int32_t> transition_indices =
+				to_span(combined_mesh_arrays->indices).sub(output.collision_surface.submesh_index_end);
+
+		Dictionary &lods = output.surfaces.back().lods;
+		for (const TransvoxelLodCache::Lod &lod : mesh_lods->lods) {
+			PackedInt32Array indices;
+			indices.resize(lod.indices.size() + transition_indices.size());
+			int32_t *w = indices.ptrw();
+			memcpy(w, lod.indices.data(), lod.indices.size() * sizeof(int32_t));
+			memcpy(w + lod.indices.size(), transition_indices.data(), transition_indices.size() * sizeof(int32_t));
+			lods[lod.error] = indices;
+		}
+	}
+
 	// const uint64_t time_spent = Time::get_singleton()->get_ticks_usec() - time_before;
 	// print_line(String("VoxelMesherTransvoxel spent {0} us").format(varray(time_spent)));
 
@@ -398,6 +954,25 @@ float VoxelMesherTransvoxel::get_mesh_optimization_target_ratio() const {
 	return _mesh_optimization_params.target_ratio;
 }
 
+void VoxelMesherTransvoxel::set_mesh_lod_count(int count) {
+	_mesh_lod_params.count = math::clamp(count, 0, static_cast<int>(MAX_MESH_LODS));
+	if (_mesh_lod_params.count == 0) {
+		_lod_cache->clear();
+	}
+}
+
+int VoxelMesherTransvoxel::get_mesh_lod_count() const {
+	return _mesh_lod_params.count;
+}
+
+void VoxelMesherTransvoxel::set_mesh_lod_error_threshold(float threshold) {
+	_mesh_lod_params.error_threshold = math::clamp(threshold, 0.f, 1.f);
+}
+
+float VoxelMesherTransvoxel::get_mesh_lod_error_threshold() const {
+	return _mesh_lod_params.error_threshold;
+}
+
 void VoxelMesherTransvoxel::set_transitions_enabled(bool enable) {
 	_transitions_enabled = enable;
 }
@@ -406,6 +981,14 @@ bool VoxelMesherTransvoxel::get_transitions_enabled() const {
 	return _transitions_enabled;
 }
 
+void VoxelMesherTransvoxel::set_occluder_boxes_enabled(bool enable) {
+	_occluder_boxes_enabled = enable;
+}
+
+bool VoxelMesherTransvoxel::is_occluder_boxes_enabled() const {
+	return _occluder_boxes_enabled;
+}
+
 Ref<ShaderMaterial> VoxelMesherTransvoxel::get_default_lod_material() const {
 	return g_minimal_shader_material;
 }
@@ -444,9 +1027,18 @@ void VoxelMesherTransvoxel::_bind_methods() {
 	);
 	ClassDB::bind_method(D_METHOD("get_mesh_optimization_target_ratio"), &Self::get_mesh_optimization_target_ratio);
 
+	ClassDB::bind_method(D_METHOD("set_mesh_lod_count", "count"), &Self::set_mesh_lod_count);
+	ClassDB::bind_method(D_METHOD("get_mesh_lod_count"), &Self::get_mesh_lod_count);
+
+	ClassDB::bind_method(D_METHOD("set_mesh_lod_error_threshold", "threshold"), &Self::set_mesh_lod_error_threshold);
+	ClassDB::bind_method(D_METHOD("get_mesh_lod_error_threshold"), &Self::get_mesh_lod_error_threshold);
+
 	ClassDB::bind_method(D_METHOD("set_transitions_enabled", "enabled"), &Self::set_transitions_enabled);
 	ClassDB::bind_method(D_METHOD("get_transitions_enabled"), &Self::get_transitions_enabled);
 
+	ClassDB::bind_method(D_METHOD("set_occluder_boxes_enabled", "enable"), &Self::set_occluder_boxes_enabled);
+	ClassDB::bind_method(D_METHOD("is_occluder_boxes_enabled"), &Self::is_occluder_boxes_enabled);
+
 	ClassDB::bind_method(D_METHOD("get_edge_clamp_margin"), &Self::get_edge_clamp_margin);
 	ClassDB::bind_method(D_METHOD("set_edge_clamp_margin", "margin"), &Self::set_edge_clamp_margin);
 
@@ -482,6 +1074,19 @@ void VoxelMesherTransvoxel::_bind_methods() {
 			"get_mesh_optimization_target_ratio"
 	);
 
+	ADD_GROUP("Mesh LODs", "mesh_lod_");
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "mesh_lod_count", PROPERTY_HINT_RANGE, "0,4,1"),
+			"set_mesh_lod_count",
+			"get_mesh_lod_count"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "mesh_lod_error_threshold", PROPERTY_HINT_RANGE, "0,1,0.001"),
+			"set_mesh_lod_error_threshold",
+			"get_mesh_lod_error_threshold"
+	);
+
 	ADD_GROUP("Advanced", "");
 
 	ADD_PROPERTY(
@@ -490,6 +1095,12 @@ void VoxelMesherTransvoxel::_bind_methods() {
 
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "edge_clamp_margin"), "set_edge_clamp_margin", "get_edge_clamp_margin");
 
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "occluder_boxes_enabled"),
+			"set_occluder_boxes_enabled",
+			"is_occluder_boxes_enabled"
+	);
+
 	BIND_ENUM_CONSTANT(TEXTURES_NONE);
 	// TODO Rename MIXEL
 	BIND_ENUM_CONSTANT(TEXTURES_BLEND_4_OVER_16);
@@ -2,6 +2,7 @@
 #define VOXEL_MESHER_TRANSVOXEL_H
 
 #include "../../util/macros.h"
+#include "../../util/memory/memory.h"
 #include "../voxel_mesher.h"
 #include "transvoxel.h"
 
@@ -14,6 +15,9 @@ namespace godot {
 class VoxelBuffer;
 }
 
+class TransvoxelLodCache;
+class TransvoxelTransitionCache;
+
 class VoxelMesherTransvoxel : public VoxelMesher {
 	GDCLASS(VoxelMesherTransvoxel, VoxelMesher)
 
@@ -30,6 +34,7 @@ public:
 	Ref<ArrayMesh> build_transition_mesh(Ref<godot::VoxelBuffer> voxels, int direction);
 
 	int get_used_channels_mask() const override;
+	bool is_output_known_empty(Span<const std::shared_ptr<VoxelBuffer>> blocks) const override;
 
 	bool is_generating_collision_surface() const override;
 
@@ -48,12 +53,26 @@ public:
 	void set_mesh_optimization_target_ratio(float ratio);
 	float get_mesh_optimization_target_ratio() const;
 
+	static const unsigned int MAX_MESH_LODS = 4;
+
+	// Number of simplified versions of each mesh to generate for Godot's mesh LOD system. 0 disables them.
+	void set_mesh_lod_count(int count);
+	int get_mesh_lod_count() const;
+
+	// Maximum error of the most simplified version, relative to the size of the mesh
+	void set_mesh_lod_error_threshold(float threshold);
+	float get_mesh_lod_error_threshold() const;
+
 	void set_transitions_enabled(bool enable);
 	bool get_transitions_enabled() const;
 
 	void set_edge_clamp_margin(float margin);
 	float get_edge_clamp_margin() const;
 
+	// Outputs boxes covering the inside of solid regions, which can be used for occlusion culling
+	void set_occluder_boxes_enabled(bool enable);
+	bool is_occluder_boxes_enabled() const;
+
 	Ref<ShaderMaterial> get_default_lod_material() const override;
 
 	// Internal
@@ -91,6 +110,18 @@ private:
 
 	MeshOptimizationParams _mesh_optimization_params;
 
+	struct MeshLodParams {
+		uint8_t count = 0;
+		float error_threshold = 0.05;
+	};
+
+	MeshLodParams _mesh_lod_params;
+
+	// Simplification results are kept so they can be reused when a block's regular mesh doesn't change
+	UniquePtr<TransvoxelLodCache> _lod_cache;
+	// Transition meshes are kept so they can be reused when the border voxels of a side don't change
+	UniquePtr<TransvoxelTransitionCache> _transition_cache;
+
 	// When a marching cube cell is computed, vertices may be placed anywhere on edges of the cell, including very close
 	// to corners. This can lead to very thin or small triangles, which can be a problem notably for collision. this
 	// margin is the minimum distance from corners, below which vertices will be clamped to it. Increasing this value
@@ -99,6 +130,8 @@ private:
 
 	bool _transitions_enabled = true;
 
+	bool _occluder_boxes_enabled = false;
+
 	bool _textures_ignore_air_voxels = false;
 };
 
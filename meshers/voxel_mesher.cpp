@@ -4,10 +4,14 @@
 #include "../generators/voxel_generator.h"
 #include "../meshers/transvoxel/voxel_mesher_transvoxel.h"
 #include "../storage/voxel_buffer_gd.h"
+#include "../thirdparty/meshoptimizer/meshoptimizer.h"
+#include "../util/errors.h"
 #include "../util/godot/classes/array_mesh.h"
 #include "../util/godot/classes/mesh.h"
 #include "../util/godot/classes/shader_material.h"
+#include "../util/math/conv.h"
 #include "../util/profiling.h"
+#include "../util/string/format.h"
 #include "transvoxel/transvoxel_cell_iterator.h"
 
 using namespace zylann::godot;
@@ -51,6 +55,10 @@ Ref<Mesh> VoxelMesher::build_mesh(
 		return Ref<ArrayMesh>();
 	}
 
+	if (is_mesh_optimization_enabled()) {
+		optimize_output_for_gpu(output);
+	}
+
 	Ref<ArrayMesh> mesh;
 	mesh.instantiate();
 
@@ -76,11 +84,21 @@ Ref<Mesh> VoxelMesher::build_mesh(
 			material = get_material_by_index(surface.material_index);
 		}
 
-		mesh->add_surface_from_arrays(output.primitive_type, arrays, Array(), Dictionary(), output.mesh_flags);
+		mesh->add_surface_from_arrays(output.primitive_type, arrays, Array(), surface.lods, output.mesh_flags);
 		mesh->surface_set_material(gd_surface_index, material);
 		++gd_surface_index;
 	}
 
+	if (output.occluder_boxes.size() > 0) {
+		Array boxes;
+		boxes.resize(output.occluder_boxes.size());
+		for (unsigned int i = 0; i < output.occluder_boxes.size(); ++i) {
+			const Box3f &box = output.occluder_boxes[i];
+			boxes[i] = AABB(to_vec3(box.min), to_vec3(box.max - box.min));
+		}
+		mesh->set_meta(VoxelStringNames::get_singleton().voxel_occluder_boxes, boxes);
+	}
+
 	if (detail_texture_settings.enabled && input.generator != nullptr) {
 		VoxelMesherTransvoxel *transvoxel_mesher = Object::cast_to<VoxelMesherTransvoxel>(this);
 
@@ -169,6 +187,219 @@ bool VoxelMesher::is_mesh_empty(const StdVector<Output::Surface> &surfaces) {
 	return true;
 }
 
+namespace {
+
+size_t get_surfaces_size_in_bytes(const StdVector<VoxelMesher::Output::Surface> &surfaces) {
+	size_t size = 0;
+	for (const VoxelMesher::Output::Surface &surface : surfaces) {
+		size += zylann::godot::get_surface_size_in_bytes(surface.arrays);
+		const Array lod_indices = surface.lods.values();
+		for (int i = 0; i < lod_indices.size(); ++i) {
+			const PackedInt32Array indices = lod_indices[i];
+			size += indices.size() * sizeof(int32_t);
+		}
+	}
+	return size;
+}
+
+} // namespace
+
+size_t VoxelMesher::get_mesh_size_in_bytes(const Output &output) {
+	size_t size = get_surfaces_size_in_bytes(output.surfaces);
+	for (const StdVector<Output::Surface> &surfaces : output.transition_surfaces) {
+		size += get_surfaces_size_in_bytes(surfaces);
+	}
+	size += zylann::godot::get_surface_size_in_bytes(output.shadow_occluder);
+	return size;
+}
+
+size_t VoxelMesher::get_collision_size_in_bytes(const Output &output) {
+	size_t index_count = 0;
+	if (output.collision_surface.submesh_index_end >= 0) {
+		index_count = output.collision_surface.submesh_index_end;
+	} else if (output.collision_surface.indices.size() > 0) {
+		index_count = output.collision_surface.indices.size();
+	} else {
+		// Collision shapes are made from render surfaces
+		for (const Output::Surface &surface : output.surfaces) {
+			if (surface.arrays.size() == Mesh::ARRAY_MAX) {
+				const PackedInt32Array indices = surface.arrays[Mesh::ARRAY_INDEX];
+				index_count += indices.size();
+			}
+		}
+	}
+	return index_count * sizeof(Vector3);
+}
+
+namespace {
+
+// Vertex attributes can have several components per vertex, like tangents or custom formats, so the stride is deduced
+// from the size of the array
+template <typename PackedArray_T>
+void remap_vertex_attribute(
+		Array &arrays,
+		const int array_index,
+		Span<const unsigned int> remap,
+		const unsigned int vertex_count,
+		const unsigned int unique_vertex_count
+) {
+	const PackedArray_T src = arrays[array_index];
+	if (src.size() == 0) {
+		return;
+	}
+	ZN_ASSERT_RETURN(src.size() % vertex_count == 0);
+	const unsigned int components = src.size() / vertex_count;
+
+	PackedArray_T dst;
+	dst.resize(unique_vertex_count * components);
+	zylannmeshopt::meshopt_remapVertexBuffer(
+			dst.ptrw(), src.ptr(), vertex_count, components * sizeof(*src.ptr()), remap.data()
+	);
+	arrays[array_index] = dst;
+}
+
+void remap_vertex_attribute(
+		Array &arrays,
+		const int array_index,
+		Span<const unsigned int> remap,
+		const unsigned int vertex_count,
+		const unsigned int unique_vertex_count
+) {
+	switch (arrays[array_index].get_type()) {
+		case Variant::NIL:
+			break;
+		case Variant::PACKED_VECTOR3_ARRAY:
+			remap_vertex_attribute<PackedVector3Array>(arrays, array_index, remap, vertex_count, unique_vertex_count);
+			break;
+		case Variant::PACKED_VECTOR2_ARRAY:
+			remap_vertex_attribute<PackedVector2Array>(arrays, array_index, remap, vertex_count, unique_vertex_count);
+			break;
+		case Variant::PACKED_COLOR_ARRAY:
+			remap_vertex_attribute<PackedColorArray>(arrays, array_index, remap, vertex_count, unique_vertex_count);
+			break;
+		case Variant::PACKED_FLOAT32_ARRAY:
+			remap_vertex_attribute<PackedFloat32Array>(arrays, array_index, remap, vertex_count, unique_vertex_count);
+			break;
+		case Variant::PACKED_INT32_ARRAY:
+			remap_vertex_attribute<PackedInt32Array>(arrays, array_index, remap, vertex_count, unique_vertex_count);
+			break;
+		case Variant::PACKED_BYTE_ARRAY:
+			remap_vertex_attribute<PackedByteArray>(arrays, array_index, remap, vertex_count, unique_vertex_count);
+			break;
+		default:
+			ZN_PRINT_ERROR(
+					format("Unhandled vertex array type {}", Variant::get_type_name(arrays[array_index].get_type()))
+			);
+			break;
+	}
+}
+
+void remap_index_array(PackedInt32Array &indices, Span<const unsigned int> remap) {
+	zylannmeshopt::meshopt_remapIndexBuffer(
+			reinterpret_cast<unsigned int *>(indices.ptrw()),
+			reinterpret_cast<const unsigned int *>(indices.ptr()),
+			indices.size(),
+			remap.data()
+	);
+}
+
+void optimize_surface_for_gpu(Array &arrays, Dictionary *lods) {
+	if (arrays.size() != Mesh::ARRAY_MAX) {
+		return;
+	}
+	PackedInt32Array indices = arrays[Mesh::ARRAY_INDEX];
+	const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+	const unsigned int vertex_count = vertices.size();
+	if (indices.size() < 3 || vertex_count == 0) {
+		return;
+	}
+
+	static thread_local StdVector<Vector3f> tls_positions;
+	static thread_local StdVector<unsigned int> tls_temp_indices;
+	static thread_local StdVector<unsigned int> tls_remap;
+
+	// Positions can be doubles depending on how Godot is compiled
+	tls_positions.resize(vertex_count);
+	for (unsigned int i = 0; i < vertex_count; ++i) {
+		tls_positions[i] = to_vec3f(vertices[i]);
+	}
+
+	unsigned int *indices_w = reinterpret_cast<unsigned int *>(indices.ptrw());
+	tls_temp_indices.resize(indices.size());
+
+	zylannmeshopt::meshopt_optimizeVertexCache(tls_temp_indices.data(), indices_w, indices.size(), vertex_count);
+	// Allowing a small loss of cache efficiency in favor of less overdraw, which is the default recommended by
+	// meshoptimizer
+	const float overdraw_threshold = 1.05f;
+	zylannmeshopt::meshopt_optimizeOverdraw(
+			indices_w,
+			tls_temp_indices.data(),
+			indices.size(),
+			&tls_positions[0].x,
+			vertex_count,
+			sizeof(Vector3f),
+			overdraw_threshold
+	);
+
+	tls_remap.resize(vertex_count);
+	const unsigned int unique_vertex_count =
+			zylannmeshopt::meshopt_optimizeVertexFetchRemap(tls_remap.data(), indices_w, indices.size(), vertex_count);
+	Span<const unsigned int> remap = to_span(tls_remap);
+
+	for (int array_index = 0; array_index < Mesh::ARRAY_MAX; ++array_index) {
+		if (array_index != Mesh::ARRAY_INDEX) {
+			remap_vertex_attribute(arrays, array_index, remap, vertex_count, unique_vertex_count);
+		}
+	}
+	remap_index_array(indices, remap);
+	arrays[Mesh::ARRAY_INDEX] = indices;
+
+	if (lods != nullptr) {
+		// LOD index buffers use the same vertices as the main one
+		const Array keys = lods->keys();
+		for (int i = 0; i < keys.size(); ++i) {
+			PackedInt32Array lod_indices = (*lods)[keys[i]];
+			remap_index_array(lod_indices, remap);
+			(*lods)[keys[i]] = lod_indices;
+		}
+	}
+}
+
+} // namespace
+
+void VoxelMesher::optimize_output_for_gpu(Output &output) {
+	ZN_PROFILE_SCOPE();
+
+	if (output.primitive_type != Mesh::PRIMITIVE_TRIANGLES) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < output.surfaces.size(); ++i) {
+		if (i == 0 && output.collision_surface.submesh_index_end >= 0) {
+			// Collision uses a range of the first surface, which must keep its order
+			continue;
+		}
+		Output::Surface &surface = output.surfaces[i];
+		optimize_surface_for_gpu(surface.arrays, &surface.lods);
+	}
+
+	for (StdVector<Output::Surface> &surfaces : output.transition_surfaces) {
+		for (Output::Surface &surface : surfaces) {
+			optimize_surface_for_gpu(surface.arrays, &surface.lods);
+		}
+	}
+
+	optimize_surface_for_gpu(output.shadow_occluder, nullptr);
+}
+
+void VoxelMesher::set_mesh_optimization_enabled(bool enabled) {
+	_mesh_optimization_enabled = enabled;
+}
+
+bool VoxelMesher::is_mesh_optimization_enabled() const {
+	return _mesh_optimization_enabled;
+}
+
 Ref<ShaderMaterial> VoxelMesher::get_default_lod_material() const {
 	return Ref<ShaderMaterial>();
 }
@@ -193,6 +424,17 @@ void VoxelMesher::_bind_methods() {
 	);
 	ClassDB::bind_method(D_METHOD("get_minimum_padding"), &VoxelMesher::get_minimum_padding);
 	ClassDB::bind_method(D_METHOD("get_maximum_padding"), &VoxelMesher::get_maximum_padding);
+
+	ClassDB::bind_method(
+			D_METHOD("set_mesh_optimization_enabled", "enabled"), &VoxelMesher::set_mesh_optimization_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_mesh_optimization_enabled"), &VoxelMesher::is_mesh_optimization_enabled);
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "mesh_optimization_enabled"),
+			"set_mesh_optimization_enabled",
+			"is_mesh_optimization_enabled"
+	);
 }
 
 } // namespace zylann::voxel
@@ -8,6 +8,9 @@
 #include "../util/godot/classes/image.h"
 #include "../util/godot/classes/mesh.h"
 #include "../util/macros.h"
+#include "../util/math/box3f.h"
+#include <atomic>
+#include <memory>
 
 ZN_GODOT_FORWARD_DECLARE(class ShaderMaterial)
 
@@ -45,12 +48,19 @@ public:
 		// If true, the mesher can collect some extra information which can be useful to speed up detail texture
 		// baking. Depends on the mesher.
 		bool detail_texture_hint = false;
+		// If false, the mesh will not be rendered, only `collision_surface` is needed if `collision_hint` is true.
+		// Meshers can then skip rendering attributes, transitions and other visual-only outputs. This is typically the
+		// case on servers, where viewers don't require visuals.
+		bool visual_hint = true;
 	};
 
 	struct Output {
 		struct Surface {
 			Array arrays;
 			uint16_t material_index = 0;
+			// Optional index buffers of simplified versions of the surface, used by Godot's mesh LOD system.
+			// Keys are the error of each version in mesh units, values are `PackedInt32Array`s.
+			Dictionary lods;
 		};
 		StdVector<Surface> surfaces;
 		FixedArray<StdVector<Surface>, Cube::SIDE_COUNT> transition_surfaces;
@@ -71,6 +81,10 @@ public:
 
 		Array shadow_occluder;
 
+		// Boxes in mesh space, entirely hidden behind the mesh. They can be used for occlusion culling.
+		// Only produced if the mesher has the option enabled.
+		StdVector<Box3f> occluder_boxes;
+
 		// May be used to store extra information needed in shader to render the mesh properly
 		// (currently used only by the cubes mesher when baking colors)
 		Ref<Image> atlas_image;
@@ -78,6 +92,18 @@ public:
 
 	static bool is_mesh_empty(const StdVector<Output::Surface> &surfaces);
 
+	// Gets how many bytes of mesh arrays the output has, including transitions, LODs and shadow occluders. This is
+	// about what the renderer will have to store once the output is turned into a mesh.
+	static size_t get_mesh_size_in_bytes(const Output &output);
+	// Estimates how many bytes a trimesh collision shape made from the output would use. The physics engine stores
+	// one position per triangle corner, and its acceleration structure is not counted.
+	static size_t get_collision_size_in_bytes(const Output &output);
+
+	// Reorders triangles and vertices of the render surfaces of an output so the GPU processes them faster. Triangles
+	// are sorted to reuse the post-transform vertex cache and reduce overdraw, then vertices are sorted in the order
+	// triangles use them. Only applies to indexed triangle surfaces.
+	static void optimize_output_for_gpu(Output &output);
+
 	// This can be called from multiple threads at once. Make sure member vars are protected or thread-local.
 	virtual void build(Output &output, const Input &voxels);
 
@@ -100,6 +126,14 @@ public:
 		return 0;
 	}
 
+	// Returns true if the mesher is certain to produce no output from the given blocks, which are those a mesh block
+	// gathers voxels from. Only cheap checks should be done, such as looking at uniform channels, so meshing tasks can
+	// skip gathering voxels. Null blocks are not loaded and make the result unknown.
+	// This can be called from multiple threads at once. Blocks must be locked for reading.
+	virtual bool is_output_known_empty(Span<const std::shared_ptr<VoxelBuffer>> blocks) const {
+		return false;
+	}
+
 	// Returns true if this mesher supports generating voxel data at multiple levels of detail.
 	virtual bool supports_lod() const {
 		return true;
@@ -130,6 +164,10 @@ public:
 	// Such material is not meant to be modified.
 	virtual Ref<ShaderMaterial> get_default_lod_material() const;
 
+	// If enabled, meshes built for terrains are passed to `optimize_output_for_gpu` in the meshing thread.
+	void set_mesh_optimization_enabled(bool enabled);
+	bool is_mesh_optimization_enabled() const;
+
 protected:
 	Ref<Mesh> _b_build_mesh(Ref<godot::VoxelBuffer> voxels, TypedArray<Material> materials, Dictionary additional_data);
 	static void _bind_methods();
@@ -140,6 +178,9 @@ private:
 	// Set in constructor and never changed after.
 	unsigned int _minimum_padding = 0;
 	unsigned int _maximum_padding = 0;
+
+	// Read from meshing threads
+	std::atomic_bool _mesh_optimization_enabled = { false };
 };
 
 } // namespace zylann::voxel
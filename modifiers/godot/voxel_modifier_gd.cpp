@@ -27,6 +27,10 @@ void post_edit_modifier(VoxelLodTerrain &volume, AABB aabb) {
 	volume.post_edit_modifiers(Box3i(math::floor_to_int(aabb.position), math::floor_to_int(aabb.size)));
 }
 
+void update_modifier_aabb(VoxelLodTerrain &volume, uint32_t id) {
+	volume.get_storage().get_modifiers().update_modifier_aabb(id);
+}
+
 void VoxelModifier::set_operation(Operation op) {
 	ZN_ASSERT_RETURN(op >= 0 && op < OPERATION_COUNT);
 	if (op == _operation) {
@@ -66,6 +70,7 @@ void VoxelModifier::set_smoothness(float s) {
 	zylann::voxel::VoxelModifierSdf *sdf_modifier = static_cast<zylann::voxel::VoxelModifierSdf *>(modifier);
 	const AABB prev_aabb = modifier->get_aabb();
 	sdf_modifier->set_smoothness(_smoothness);
+	update_modifier_aabb(*_volume, _modifier_id);
 	const AABB new_aabb = modifier->get_aabb();
 	post_edit_modifier(*_volume, prev_aabb);
 	post_edit_modifier(*_volume, new_aabb);
@@ -98,6 +103,7 @@ void VoxelModifier::_notification(int p_what) {
 				}
 
 				modifier->set_transform(get_transform());
+				modifiers.update_modifier_aabb(id);
 				_modifier_id = id;
 				// TODO Optimize: on loading of a scene, this could be very bad for performance because there could be,
 				// a lot of modifiers on the map, but there is no distinction possible in Godot at the moment...
@@ -129,6 +135,7 @@ void VoxelModifier::_notification(int p_what) {
 
 				const AABB prev_aabb = modifier->get_aabb();
 				modifier->set_transform(get_transform());
+				modifiers.update_modifier_aabb(_modifier_id);
 				const AABB aabb = modifier->get_aabb();
 				post_edit_modifier(*_volume, prev_aabb);
 				post_edit_modifier(*_volume, aabb);
@@ -55,6 +55,8 @@ private:
 // Helpers
 
 void post_edit_modifier(VoxelLodTerrain &volume, AABB aabb);
+// Must be called after changing properties affecting the bounds of a modifier
+void update_modifier_aabb(VoxelLodTerrain &volume, uint32_t id);
 
 template <typename T>
 T *get_modifier(VoxelLodTerrain &volume, uint32_t id, zylann::voxel::VoxelModifier::Type type) {
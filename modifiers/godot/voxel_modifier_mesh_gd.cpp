@@ -26,6 +26,7 @@ void VoxelModifierMesh::set_mesh_sdf(Ref<VoxelMeshSDF> mesh_sdf) {
 	ZN_ASSERT_RETURN(modifier != nullptr);
 	const AABB prev_aabb = modifier->get_aabb();
 	modifier->set_mesh_sdf(_mesh_sdf);
+	update_modifier_aabb(*_volume, _modifier_id);
 	const AABB new_aabb = modifier->get_aabb();
 	post_edit_modifier(*_volume, prev_aabb);
 	post_edit_modifier(*_volume, new_aabb);
@@ -69,6 +70,7 @@ void VoxelModifierMesh::_on_mesh_sdf_baked() {
 	ZN_ASSERT_RETURN(modifier != nullptr);
 	const AABB prev_aabb = modifier->get_aabb();
 	modifier->set_mesh_sdf(_mesh_sdf);
+	update_modifier_aabb(*_volume, _modifier_id);
 	const AABB new_aabb = modifier->get_aabb();
 	post_edit_modifier(*_volume, prev_aabb);
 	post_edit_modifier(*_volume, new_aabb);
@@ -11,7 +11,11 @@ namespace zylann::voxel {
 
 struct VoxelModifierContext {
 	Span<float> sdf; // Signed distance values to modify
-	Span<const Vector3f> positions; // Positions associated to each signed distance
+	// Positions associated to each signed distance. Coordinates are in separate arrays so they can be processed with
+	// SIMD.
+	Span<const float> positions_x;
+	Span<const float> positions_y;
+	Span<const float> positions_z;
 };
 
 class VoxelModifier {
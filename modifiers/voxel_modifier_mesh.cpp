@@ -1,6 +1,7 @@
 #include "voxel_modifier_mesh.h"
 #include "../edition/funcs.h"
 #include "../engine/voxel_engine.h"
+#include "../generators/graph/simd/graph_kernels.h"
 #include "../util/godot/core/packed_arrays.h"
 #include "../util/math/conv.h"
 #include "../util/profiling.h"
@@ -55,26 +56,46 @@ void VoxelModifierMesh::apply(VoxelModifierContext ctx) const {
 	ZN_ASSERT_RETURN(buffer.get_channel_data_read_only(VoxelBuffer::CHANNEL_SDF, buffer_sdf));
 	const float smoothness = get_smoothness();
 
-	ops::SdfBufferShape shape;
-	shape.buffer = buffer_sdf;
-	shape.buffer_size = buffer.get_size();
-	shape.isolevel = _isolevel;
-	shape.sdf_scale = get_largest_coord(model_to_world.get_basis().get_scale());
-	shape.world_to_buffer = buffer_to_world.affine_inverse();
+	const unsigned int count = ctx.sdf.size();
+	ZN_ASSERT_RETURN(ctx.positions_x.size() == count && ctx.positions_y.size() == count);
+	ZN_ASSERT_RETURN(ctx.positions_z.size() == count);
+
+	// Sample the shape first, then combine it with a vectorized pass
+	thread_local StdVector<float> tls_shape_sdf;
+	tls_shape_sdf.resize(count);
+	Span<float> shape_sdf = to_span(tls_shape_sdf);
+
+	{
+		ZN_PROFILE_SCOPE_NAMED("Sample");
+
+		// Single precision is enough for the area covered by the buffer, and is cheaper to transform
+		const Transform3f world_to_buffer = to_transform3f(buffer_to_world.affine_inverse());
+		const Vector3i buffer_size = buffer.get_size();
+		const Vector3f buffer_size_f = to_vec3f(buffer_size);
+		const float sdf_scale = get_largest_coord(model_to_world.get_basis().get_scale());
+
+		for (unsigned int i = 0; i < count; ++i) {
+			const Vector3f lpos =
+					world_to_buffer.xform(Vector3f(ctx.positions_x[i], ctx.positions_y[i], ctx.positions_z[i]));
+			if (lpos.x < 0 || lpos.y < 0 || lpos.z < 0 || lpos.x >= buffer_size_f.x || lpos.y >= buffer_size_f.y ||
+				lpos.z >= buffer_size_f.z) {
+				// Outside the buffer
+				shape_sdf[i] = constants::SDF_FAR_OUTSIDE;
+			} else {
+				shape_sdf[i] = interpolate_trilinear(buffer_sdf, buffer_size, lpos) * sdf_scale - _isolevel;
+			}
+		}
+	}
+
+	const pg::simd::Kernels &kernels = pg::simd::get_kernels();
 
 	switch (get_operation()) {
 		case OP_ADD:
-			for (unsigned int i = 0; i < ctx.sdf.size(); ++i) {
-				const float sd = shape(ctx.positions[i]);
-				ctx.sdf[i] = math::sdf_smooth_union(ctx.sdf[i], sd, smoothness);
-			}
+			kernels.sdf_smooth_union(ctx.sdf.data(), shape_sdf.data(), smoothness, ctx.sdf.data(), count);
 			break;
 
 		case OP_SUBTRACT:
-			for (unsigned int i = 0; i < ctx.sdf.size(); ++i) {
-				const float sd = shape(ctx.positions[i]);
-				ctx.sdf[i] = math::sdf_smooth_subtract(ctx.sdf[i], sd, smoothness);
-			}
+			kernels.sdf_smooth_subtract(ctx.sdf.data(), shape_sdf.data(), smoothness, ctx.sdf.data(), count);
 			break;
 
 		default:
@@ -1,5 +1,6 @@
 #include "voxel_modifier_sphere.h"
 #include "../engine/voxel_engine.h"
+#include "../generators/graph/simd/graph_kernels.h"
 #include "../util/godot/core/packed_arrays.h"
 #include "../util/math/conv.h"
 #include "../util/math/sdf.h"
@@ -33,28 +34,43 @@ void VoxelModifierSphere::apply(VoxelModifierContext ctx) const {
 	RWLockRead rlock(_rwlock);
 	const float smoothness = get_smoothness();
 	const Vector3f center = to_vec3f(get_transform().origin);
-	const float sdf_scale = 1.0f;
+
+	const unsigned int count = ctx.sdf.size();
+	ZN_ASSERT_RETURN(ctx.positions_x.size() == count && ctx.positions_y.size() == count);
+	ZN_ASSERT_RETURN(ctx.positions_z.size() == count);
 
 	// TODO Support transform scale
 
+	// Evaluating the sphere and combining it happens in a single pass
+	const pg::simd::Kernels &kernels = pg::simd::get_kernels();
+	pg::simd::Kernels::SdfSphereOperationFunc func;
+
 	switch (get_operation()) {
 		case OP_ADD:
-			for (unsigned int i = 0; i < ctx.sdf.size(); ++i) {
-				const float sd = sdf_scale * math::sdf_sphere(ctx.positions[i], center, _radius);
-				ctx.sdf[i] = math::sdf_smooth_union(ctx.sdf[i], sd, smoothness);
-			}
+			func = kernels.sdf_sphere_smooth_union;
 			break;
 
 		case OP_SUBTRACT:
-			for (unsigned int i = 0; i < ctx.sdf.size(); ++i) {
-				const float sd = sdf_scale * math::sdf_sphere(ctx.positions[i], center, _radius);
-				ctx.sdf[i] = math::sdf_smooth_subtract(ctx.sdf[i], sd, smoothness);
-			}
+			func = kernels.sdf_sphere_smooth_subtract;
 			break;
 
 		default:
 			ZN_CRASH();
+			return;
 	}
+
+	func(
+			ctx.positions_x.data(),
+			ctx.positions_y.data(),
+			ctx.positions_z.data(),
+			center.x,
+			center.y,
+			center.z,
+			_radius,
+			smoothness,
+			ctx.sdf.data(),
+			count
+	);
 }
 
 void VoxelModifierSphere::get_shader_data(ShaderData &out_shader_data) {
@@ -2,6 +2,7 @@
 #include "../edition/funcs.h"
 #include "../util/dstack.h"
 #include "../util/profiling.h"
+#include <algorithm>
 
 namespace zylann::voxel {
 
@@ -12,13 +13,27 @@ StdVector<float> &get_tls_sdf() {
 	return tls_sdf;
 }
 
-StdVector<Vector3f> &get_tls_positions() {
-	thread_local StdVector<Vector3f> tls_positions;
+struct PositionsBuffer {
+	StdVector<float> x;
+	StdVector<float> y;
+	StdVector<float> z;
+};
+
+PositionsBuffer &get_tls_positions() {
+	thread_local PositionsBuffer tls_positions;
 	return tls_positions;
 }
 
-void get_positions_buffer(Vector3i buffer_size, Vector3f origin, Vector3f size, StdVector<Vector3f> &positions) {
-	positions.resize(Vector3iUtil::get_volume(buffer_size));
+StdVector<VoxelModifier *> &get_tls_found_modifiers() {
+	thread_local StdVector<VoxelModifier *> tls_modifiers;
+	return tls_modifiers;
+}
+
+void get_positions_buffer(Vector3i buffer_size, Vector3f origin, Vector3f size, PositionsBuffer &positions) {
+	const size_t volume = Vector3iUtil::get_volume(buffer_size);
+	positions.x.resize(volume);
+	positions.y.resize(volume);
+	positions.z.resize(volume);
 
 	const Vector3f end = origin + size;
 	const Vector3f inv_bsf = Vector3f(1.0, 1.0, 1.0) / to_vec3f(buffer_size);
@@ -36,30 +51,15 @@ void get_positions_buffer(Vector3i buffer_size, Vector3f origin, Vector3f size,
 			for (int y = 0; y < buffer_size.y; ++y) {
 				pos.y = math::lerp(origin.y, end.y, y * inv_bsf.y);
 
-				positions[i] = pos;
+				positions.x[i] = pos.x;
+				positions.y[i] = pos.y;
+				positions.z[i] = pos.z;
 				++i;
 			}
 		}
 	}
 }
 
-Span<const Vector3f> get_positions_temporary(
-		Span<const float> x_buffer,
-		Span<const float> y_buffer,
-		Span<const float> z_buffer
-) {
-	ZN_ASSERT(x_buffer.size() == z_buffer.size() && y_buffer.size() == z_buffer.size());
-
-	get_tls_positions().resize(x_buffer.size());
-	Span<Vector3f> positions = to_span(get_tls_positions());
-
-	for (unsigned int i = 0; i < x_buffer.size(); ++i) {
-		positions[i] = Vector3f(x_buffer[i], y_buffer[i], z_buffer[i]);
-	}
-
-	return positions;
-}
-
 // TODO Use VoxelBuffer helper function
 void decompress_sdf_to_buffer(VoxelBuffer &voxels, StdVector<float> &sdf) {
 	ZN_DSTACK();
@@ -106,7 +106,7 @@ void decompress_sdf_to_buffer(VoxelBuffer &voxels, StdVector<float> &sdf) {
 			ZN_CRASH();
 	}
 
-	const float inv_scale = 1.0f / VoxelBuffer::get_sdf_quantization_scale(depth);
+	const float inv_scale = 1.0f / voxels.get_sdf_channel_quantization_scale();
 	for (unsigned int i = 0; i < sdf.size(); ++i) {
 		sdf[i] *= inv_scale;
 	}
@@ -132,6 +132,9 @@ void VoxelModifierStack::move_from_noclear(VoxelModifierStack &other) {
 		RWLockRead rlock(other._stack_lock);
 		_modifiers = std::move(other._modifiers);
 		_stack = std::move(other._stack);
+		_bvh = std::move(other._bvh);
+		_bvh_leaves = std::move(other._bvh_leaves);
+		_next_order = other._next_order;
 	}
 	_next_id = other._next_id;
 }
@@ -154,9 +157,47 @@ void VoxelModifierStack::remove_modifier(uint32_t id) {
 		}
 	}
 
+	auto leaf_it = _bvh_leaves.find(id);
+	if (leaf_it != _bvh_leaves.end()) {
+		_bvh.remove(leaf_it->second);
+		_bvh_leaves.erase(leaf_it);
+	}
+
 	_modifiers.erase(map_it);
 }
 
+void VoxelModifierStack::update_modifier_aabb(uint32_t id) {
+	RWLockWrite lock(_stack_lock);
+
+	auto map_it = _modifiers.find(id);
+	ZN_ASSERT_RETURN(map_it != _modifiers.end());
+
+	auto leaf_it = _bvh_leaves.find(id);
+	ZN_ASSERT_RETURN(leaf_it != _bvh_leaves.end());
+
+	_bvh.update(leaf_it->second, map_it->second->get_aabb());
+}
+
+void VoxelModifierStack::find_modifiers(AABB aabb, StdVector<VoxelModifier *> &out_modifiers) const {
+	thread_local StdVector<ModifierRef> tls_refs;
+	StdVector<ModifierRef> &refs = tls_refs;
+	refs.clear();
+
+	_bvh.query(aabb, [&refs](const ModifierRef &ref) { //
+		refs.push_back(ref);
+	});
+
+	// The tree returns modifiers in any order, but the result depends on the order they are applied
+	std::sort(refs.begin(), refs.end(), [](const ModifierRef &a, const ModifierRef &b) { //
+		return a.order < b.order;
+	});
+
+	out_modifiers.clear();
+	for (const ModifierRef &ref : refs) {
+		out_modifiers.push_back(ref.modifier);
+	}
+}
+
 bool VoxelModifierStack::has_modifier(uint32_t id) const {
 	return _modifiers.find(id) != _modifiers.end();
 }
@@ -192,70 +233,72 @@ void VoxelModifierStack::apply(VoxelBuffer &voxels, AABB aabb) const {
 	thread_local StdVector<float> tls_block_sdf;
 
 	StdVector<float> &area_sdf = get_tls_sdf();
-	StdVector<Vector3f> &area_positions = get_tls_positions();
+	PositionsBuffer &area_positions = get_tls_positions();
 
 	const Vector3 v_to_w = aabb.size / Vector3(voxels.get_size());
 	const Vector3 w_to_v = Vector3(voxels.get_size()) / aabb.size;
 	const Vector3i origin_voxels = Vector3i(math::floor(aabb.position * w_to_v));
 
-	for (unsigned int i = 0; i < _stack.size(); ++i) {
-		const VoxelModifier *modifier = _stack[i];
+	StdVector<VoxelModifier *> &modifiers = get_tls_found_modifiers();
+	find_modifiers(aabb, modifiers);
+
+	for (const VoxelModifier *modifier : modifiers) {
+		ZN_PROFILE_SCOPE_NAMED("Intersecting modifier");
 		ZN_ASSERT(modifier != nullptr);
 
 		const AABB modifier_aabb = modifier->get_aabb();
-		if (modifier_aabb.intersects(aabb)) {
-			ZN_PROFILE_SCOPE_NAMED("Intersecting modifier");
 
-			if (any_intersection == false) {
-				ZN_PROFILE_SCOPE_NAMED("Read block");
-				any_intersection = true;
+		if (any_intersection == false) {
+			ZN_PROFILE_SCOPE_NAMED("Read block");
+			any_intersection = true;
 
-				decompress_sdf_to_buffer(voxels, tls_block_sdf_initial);
-
-				tls_block_sdf.resize(tls_block_sdf_initial.size());
-				memcpy(tls_block_sdf.data(), tls_block_sdf_initial.data(), tls_block_sdf.size() * sizeof(float));
-			}
+			decompress_sdf_to_buffer(voxels, tls_block_sdf_initial);
 
-			// Get modifier bounds in voxels
-			Box3i modifier_box(math::floor(modifier_aabb.position * w_to_v), math::ceil(modifier_aabb.size * w_to_v));
-			modifier_box.clip(Box3i(origin_voxels, voxels.get_size()));
-			const Vector3i local_origin_in_voxels = modifier_box.position - origin_voxels;
-
-			const int64_t volume = Vector3iUtil::get_volume(modifier_box.size);
-			area_sdf.resize(volume);
-			copy_3d_region_zxy(
-					to_span(area_sdf),
-					modifier_box.size,
-					Vector3i(),
-					to_span_const(tls_block_sdf),
-					voxels.get_size(),
-					local_origin_in_voxels,
-					local_origin_in_voxels + modifier_box.size
-			);
-
-			get_positions_buffer(
-					modifier_box.size,
-					to_vec3f(v_to_w * modifier_box.position),
-					to_vec3f(v_to_w * modifier_box.size),
-					area_positions
-			);
-
-			ctx.positions = to_span(area_positions);
-			ctx.sdf = to_span(area_sdf);
-			modifier->apply(ctx);
-
-			// Write modifications back to the full-block decompressed buffer
-			// TODO Maybe use an unchecked version for a bit more speed?
-			copy_3d_region_zxy(
-					to_span(tls_block_sdf),
-					voxels.get_size(),
-					local_origin_in_voxels,
-					Span<const float>(ctx.sdf),
-					modifier_box.size,
-					Vector3i(),
-					modifier_box.size
-			);
+			tls_block_sdf.resize(tls_block_sdf_initial.size());
+			memcpy(tls_block_sdf.data(), tls_block_sdf_initial.data(), tls_block_sdf.size() * sizeof(float));
 		}
+
+		// Get modifier bounds in voxels
+		Box3i modifier_box(math::floor(modifier_aabb.position * w_to_v), math::ceil(modifier_aabb.size * w_to_v));
+		modifier_box.clip(Box3i(origin_voxels, voxels.get_size()));
+		const Vector3i local_origin_in_voxels = modifier_box.position - origin_voxels;
+
+		const int64_t volume = Vector3iUtil::get_volume(modifier_box.size);
+		area_sdf.resize(volume);
+		copy_3d_region_zxy(
+				to_span(area_sdf),
+				modifier_box.size,
+				Vector3i(),
+				to_span_const(tls_block_sdf),
+				voxels.get_size(),
+				local_origin_in_voxels,
+				local_origin_in_voxels + modifier_box.size
+		);
+
+		get_positions_buffer(
+				modifier_box.size,
+				to_vec3f(v_to_w * modifier_box.position),
+				to_vec3f(v_to_w * modifier_box.size),
+				area_positions
+		);
+
+		ctx.positions_x = to_span(area_positions.x);
+		ctx.positions_y = to_span(area_positions.y);
+		ctx.positions_z = to_span(area_positions.z);
+		ctx.sdf = to_span(area_sdf);
+		modifier->apply(ctx);
+
+		// Write modifications back to the full-block decompressed buffer
+		// TODO Maybe use an unchecked version for a bit more speed?
+		copy_3d_region_zxy(
+				to_span(tls_block_sdf),
+				voxels.get_size(),
+				local_origin_in_voxels,
+				Span<const float>(ctx.sdf),
+				modifier_box.size,
+				Vector3i(),
+				modifier_box.size
+		);
 	}
 
 	if (any_intersection) {
@@ -274,18 +317,19 @@ void VoxelModifierStack::apply(float &sdf, Vector3f position) const {
 	}
 
 	VoxelModifierContext ctx;
-	ctx.positions = Span<Vector3f>(&position, 1);
+	ctx.positions_x = Span<const float>(&position.x, 1);
+	ctx.positions_y = Span<const float>(&position.y, 1);
+	ctx.positions_z = Span<const float>(&position.z, 1);
 	ctx.sdf = Span<float>(&sdf, 1);
 
 	const AABB aabb(to_vec3(position), Vector3(1, 1, 1));
 
-	for (unsigned int i = 0; i < _stack.size(); ++i) {
-		const VoxelModifier *modifier = _stack[i];
-		ZN_ASSERT(modifier != nullptr);
+	StdVector<VoxelModifier *> &modifiers = get_tls_found_modifiers();
+	find_modifiers(aabb, modifiers);
 
-		if (modifier->get_aabb().intersects(aabb)) {
-			modifier->apply(ctx);
-		}
+	for (const VoxelModifier *modifier : modifiers) {
+		ZN_ASSERT(modifier != nullptr);
+		modifier->apply(ctx);
 	}
 }
 
@@ -304,19 +348,24 @@ void VoxelModifierStack::apply(
 		return;
 	}
 
+	ZN_ASSERT_RETURN(x_buffer.size() == sdf_buffer.size());
+	ZN_ASSERT_RETURN(y_buffer.size() == sdf_buffer.size());
+	ZN_ASSERT_RETURN(z_buffer.size() == sdf_buffer.size());
+
 	VoxelModifierContext ctx;
-	ctx.positions = get_positions_temporary(x_buffer, y_buffer, z_buffer);
+	ctx.positions_x = x_buffer;
+	ctx.positions_y = y_buffer;
+	ctx.positions_z = z_buffer;
 	ctx.sdf = sdf_buffer;
 
 	const AABB aabb(to_vec3(min_pos), to_vec3(max_pos - min_pos));
 
-	for (unsigned int i = 0; i < _stack.size(); ++i) {
-		const VoxelModifier *modifier = _stack[i];
-		ZN_ASSERT(modifier != nullptr);
+	StdVector<VoxelModifier *> &modifiers = get_tls_found_modifiers();
+	find_modifiers(aabb, modifiers);
 
-		if (modifier->get_aabb().intersects(aabb)) {
-			modifier->apply(ctx);
-		}
+	for (const VoxelModifier *modifier : modifiers) {
+		ZN_ASSERT(modifier != nullptr);
+		modifier->apply(ctx);
 	}
 }
 
@@ -332,16 +381,16 @@ void VoxelModifierStack::apply_for_gpu_rendering(
 		return;
 	}
 
-	for (unsigned int i = 0; i < _stack.size(); ++i) {
-		VoxelModifier *modifier = _stack[i];
+	StdVector<VoxelModifier *> &modifiers = get_tls_found_modifiers();
+	find_modifiers(aabb, modifiers);
+
+	for (VoxelModifier *modifier : modifiers) {
 		ZN_ASSERT(modifier != nullptr);
 
-		if (modifier->get_aabb().intersects(aabb)) {
-			VoxelModifier::ShaderData sd;
-			modifier->get_shader_data(sd);
-			if (sd.shader_rids[type].is_valid()) {
-				out_data.push_back(sd);
-			}
+		VoxelModifier::ShaderData sd;
+		modifier->get_shader_data(sd);
+		if (sd.shader_rids[type].is_valid()) {
+			out_data.push_back(sd);
 		}
 	}
 }
@@ -349,6 +398,8 @@ void VoxelModifierStack::apply_for_gpu_rendering(
 void VoxelModifierStack::clear() {
 	RWLockWrite lock(_stack_lock);
 	_stack.clear();
+	_bvh.clear();
+	_bvh_leaves.clear();
 	_modifiers.clear();
 }
 
@@ -1,6 +1,7 @@
 #ifndef VOXEL_MODIFIER_STACK_H
 #define VOXEL_MODIFIER_STACK_H
 
+#include "../util/containers/dynamic_aabb_tree.h"
 #include "../util/containers/std_unordered_map.h"
 #include "../util/containers/std_vector.h"
 #include "../util/math/vector3f.h"
@@ -28,10 +29,14 @@ public:
 		VoxelModifier *ptr = uptr.get();
 		RWLockWrite lock(_stack_lock);
 		_stack.push_back(ptr);
+		_bvh_leaves[id] = _bvh.add(ptr->get_aabb(), ModifierRef{ ptr, _next_order++ });
 		return static_cast<T *>(ptr);
 	}
 
 	void remove_modifier(uint32_t id);
+	// Must be called after changing properties of a modifier which affect its bounds, so it can be found in its new
+	// area when applying the stack.
+	void update_modifier_aabb(uint32_t id);
 	bool has_modifier(uint32_t id) const;
 	VoxelModifier *get_modifier(uint32_t id) const;
 	void apply(VoxelBuffer &voxels, AABB aabb) const;
@@ -63,12 +68,24 @@ public:
 	}
 
 private:
+	struct ModifierRef {
+		VoxelModifier *modifier = nullptr;
+		// Modifiers are applied in the order they were added
+		uint32_t order = 0;
+	};
+
 	void move_from_noclear(VoxelModifierStack &other);
+	// Gets modifiers intersecting a box, in the order they have to be applied. Must be called with the stack locked.
+	void find_modifiers(AABB aabb, StdVector<VoxelModifier *> &out_modifiers) const;
 
 	StdUnorderedMap<uint32_t, UniquePtr<VoxelModifier>> _modifiers;
 	uint32_t _next_id = 1;
-	// TODO Later, replace this with a spatial acceleration structure based on AABBs, like BVH
 	StdVector<VoxelModifier *> _stack;
+	// Spatial index of modifiers, so applying the stack doesn't have to check every one of them
+	DynamicAABBTree<ModifierRef> _bvh;
+	// Modifier ID => leaf in the BVH
+	StdUnorderedMap<uint32_t, uint32_t> _bvh_leaves;
+	uint32_t _next_order = 0;
 	RWLock _stack_lock;
 };
 
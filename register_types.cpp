@@ -39,11 +39,16 @@
 #include "storage/metadata/voxel_metadata_variant.h"
 #include "storage/voxel_buffer_gd.h"
 #include "storage/voxel_memory_pool.h"
+#include "streams/log/voxel_stream_log.h"
 #include "streams/region/voxel_stream_region_files.h"
+#include "streams/remote/voxel_stream_remote.h"
 #include "streams/sqlite/voxel_stream_sqlite.h"
 #include "streams/vox/vox_loader.h"
 #include "streams/voxel_block_serializer_gd.h"
+#include "streams/voxel_pre_generation_job.h"
+#include "streams/voxel_stream_copy_job.h"
 #include "streams/voxel_stream_memory.h"
+#include "streams/voxel_stream_memory_cache.h"
 #include "streams/voxel_stream_script.h"
 #include "terrain/fixed_lod/voxel_box_mover.h"
 #include "terrain/fixed_lod/voxel_terrain.h"
@@ -55,6 +60,7 @@
 #include "terrain/instancing/voxel_instancer.h"
 #include "terrain/instancing/voxel_instancer_rigidbody.h"
 #include "terrain/variable_lod/voxel_lod_terrain.h"
+#include "terrain/variable_lod/voxel_lod_terrain_multiplayer_synchronizer.h"
 #include "terrain/voxel_a_star_grid_3d.h"
 #include "terrain/voxel_mesh_block.h"
 #include "terrain/voxel_save_completion_tracker.h"
@@ -150,6 +156,10 @@
 
 #ifdef VOXEL_TESTS
 #include "tests/tests.h"
+#include "tests/util/benchmark_threaded_task_runner.h"
+#include "tests/voxel/benchmark_voxel_graph.h"
+#include "tests/voxel/benchmark_voxel_meshers.h"
+#include "tests/voxel/benchmark_voxel_streaming.h"
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -262,6 +272,11 @@ void initialize_voxel_module(ModuleInitializationLevel p_level) {
 		ClassDB::register_class<VoxelStreamScript>();
 		ClassDB::register_class<VoxelStreamSQLite>();
 		ClassDB::register_class<VoxelStreamMemory>();
+		ClassDB::register_class<VoxelStreamMemoryCache>();
+		ClassDB::register_class<VoxelStreamRemote>();
+		ClassDB::register_class<VoxelStreamLog>();
+		ClassDB::register_class<VoxelPreGenerationJob>();
+		ClassDB::register_class<VoxelStreamCopyJob>();
 
 		// Generators
 		ClassDB::register_abstract_class<VoxelGenerator>();
@@ -297,6 +312,7 @@ void initialize_voxel_module(ModuleInitializationLevel p_level) {
 #endif
 		ClassDB::register_class<VoxelMeshSDF>();
 		ClassDB::register_class<VoxelTerrainMultiplayerSynchronizer>();
+		ClassDB::register_class<VoxelLodTerrainMultiplayerSynchronizer>();
 		ClassDB::register_class<VoxelAStarGrid3D>();
 
 		// Meshers
@@ -309,6 +325,9 @@ void initialize_voxel_module(ModuleInitializationLevel p_level) {
 		// TODO GDX: I don't want to expose these classes, but there is no way not to expose them
 		ClassDB::register_class<ZN_GodotThreadHelper>();
 		ClassDB::register_class<VoxelEngineUpdater>();
+#ifdef VOXEL_TESTS
+		ClassDB::register_class<zylann::voxel::tests::VoxelStreamingBenchmarkRunner>();
+#endif
 #endif
 
 		print_size_reminders();
@@ -376,14 +395,52 @@ void initialize_voxel_module(ModuleInitializationLevel p_level) {
 #ifdef VOXEL_TESTS
 		const PackedStringArray command_line_arguments = zylann::godot::get_command_line_arguments();
 		const String tests_cmd = "--run_voxel_tests";
+		const String mesher_benchmarks_cmd = "--run_voxel_mesher_benchmarks";
+		// Can be given several times to benchmark meshers with MagicaVoxel models
+		const String benchmark_vox_prefix = "--voxel_benchmark_vox=";
+		const String graph_benchmarks_cmd = "--run_voxel_graph_benchmarks";
+		const String streaming_benchmarks_cmd = "--run_voxel_streaming_benchmarks";
+		const String task_runner_benchmarks_cmd = "--run_voxel_task_runner_benchmarks";
+		const String benchmark_output_prefix = "--voxel_benchmark_output=";
+
+		bool run_mesher_benchmarks = false;
+		StdVector<String> benchmark_vox_paths;
+		bool run_graph_benchmarks = false;
+		bool run_streaming_benchmarks = false;
+		bool run_task_runner_benchmarks = false;
+		String benchmark_output_path;
 
 		for (int i = 0; i < command_line_arguments.size(); ++i) {
 			const String arg = command_line_arguments[i];
 			if (arg == tests_cmd) {
 				zylann::voxel::tests::run_voxel_tests();
-				break;
+			} else if (arg == mesher_benchmarks_cmd) {
+				run_mesher_benchmarks = true;
+			} else if (arg.begins_with(benchmark_vox_prefix)) {
+				benchmark_vox_paths.push_back(arg.substr(benchmark_vox_prefix.length()));
+			} else if (arg == graph_benchmarks_cmd) {
+				run_graph_benchmarks = true;
+			} else if (arg == streaming_benchmarks_cmd) {
+				run_streaming_benchmarks = true;
+			} else if (arg == task_runner_benchmarks_cmd) {
+				run_task_runner_benchmarks = true;
+			} else if (arg.begins_with(benchmark_output_prefix)) {
+				benchmark_output_path = arg.substr(benchmark_output_prefix.length());
 			}
 		}
+
+		if (run_mesher_benchmarks) {
+			zylann::voxel::tests::run_voxel_mesher_benchmarks(benchmark_vox_paths);
+		}
+		if (run_graph_benchmarks) {
+			zylann::voxel::tests::run_voxel_graph_benchmarks();
+		}
+		if (run_streaming_benchmarks) {
+			zylann::voxel::tests::schedule_voxel_streaming_benchmarks(benchmark_output_path);
+		}
+		if (run_task_runner_benchmarks) {
+			zylann::tests::run_threaded_task_runner_benchmarks();
+		}
 #endif
 	}
 
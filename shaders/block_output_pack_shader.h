@@ -0,0 +1,66 @@
+// Generated file
+
+// clang-format off
+const char *g_block_output_pack_shader =
+"#version 450\n"
+"\n"
+"// Copies outputs of block generation into the buffer that will be downloaded to the CPU.\n"
+"// SDF outputs are quantized to 16-bit signed normalized values, the format used by default in voxel buffers. Two values\n"
+"// are packed in each element, so they take half the bandwidth of floats. Other outputs are copied as floats.\n"
+"\n"
+"layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;\n"
+"\n"
+"const int MAX_OUTPUTS = 8;\n"
+"\n"
+"layout (set = 0, binding = 0, std430) restrict readonly buffer Params {\n"
+"	int volume;\n"
+"	int output_count;\n"
+"	// Where to start writing in the destination buffer, in elements\n"
+"	int dst_offset;\n"
+"	// Scale applied to SDF values before quantization\n"
+"	float sd_scale;\n"
+"	// 1 if the output has to be packed as 16-bit values, 0 otherwise\n"
+"	int packed_outputs[MAX_OUTPUTS];\n"
+"} u_params;\n"
+"\n"
+"// Contains all outputs, each laid out in contiguous chunks of `volume` values\n"
+"layout (set = 0, binding = 1, std430) restrict readonly buffer SrcBuffer {\n"
+"	float values[];\n"
+"} u_src;\n"
+"\n"
+"layout (set = 0, binding = 2, std430) restrict writeonly buffer DstBuffer {\n"
+"	uint values[];\n"
+"} u_dst;\n"
+"\n"
+"void main() {\n"
+"	// Each invocation handles two consecutive values of every output\n"
+"	const int pair_index = int(gl_GlobalInvocationID.x);\n"
+"	const int pair_count = (u_params.volume + 1) / 2;\n"
+"	if (pair_index >= pair_count) {\n"
+"		return;\n"
+"	}\n"
+"\n"
+"	const int i0 = pair_index * 2;\n"
+"	const bool has_second_value = i0 + 1 < u_params.volume;\n"
+"	int dst_start = u_params.dst_offset;\n"
+"\n"
+"	for (int output_index = 0; output_index < u_params.output_count; ++output_index) {\n"
+"		const int src_start = output_index * u_params.volume;\n"
+"		const float v0 = u_src.values[src_start + i0];\n"
+"		const float v1 = has_second_value ? u_src.values[src_start + i0 + 1] : 0.0;\n"
+"\n"
+"		if (u_params.packed_outputs[output_index] != 0) {\n"
+"			// The first value goes in the lower 16 bits, so on the CPU they read as an array of int16\n"
+"			u_dst.values[dst_start + pair_index] = packSnorm2x16(vec2(v0, v1) * u_params.sd_scale);\n"
+"			dst_start += pair_count;\n"
+"\n"
+"		} else {\n"
+"			u_dst.values[dst_start + i0] = floatBitsToUint(v0);\n"
+"			if (has_second_value) {\n"
+"				u_dst.values[dst_start + i0 + 1] = floatBitsToUint(v1);\n"
+"			}\n"
+"			dst_start += u_params.volume;\n"
+"		}\n"
+"	}\n"
+"}\n";
+// clang-format on
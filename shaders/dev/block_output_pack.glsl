@@ -0,0 +1,62 @@
+#[compute]
+#version 450
+
+// Copies outputs of block generation into the buffer that will be downloaded to the CPU.
+// SDF outputs are quantized to 16-bit signed normalized values, the format used by default in voxel buffers. Two values
+// are packed in each element, so they take half the bandwidth of floats. Other outputs are copied as floats.
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+const int MAX_OUTPUTS = 8;
+
+layout (set = 0, binding = 0, std430) restrict readonly buffer Params {
+	int volume;
+	int output_count;
+	// Where to start writing in the destination buffer, in elements
+	int dst_offset;
+	// Scale applied to SDF values before quantization
+	float sd_scale;
+	// 1 if the output has to be packed as 16-bit values, 0 otherwise
+	int packed_outputs[MAX_OUTPUTS];
+} u_params;
+
+// Contains all outputs, each laid out in contiguous chunks of `volume` values
+layout (set = 0, binding = 1, std430) restrict readonly buffer SrcBuffer {
+	float values[];
+} u_src;
+
+layout (set = 0, binding = 2, std430) restrict writeonly buffer DstBuffer {
+	uint values[];
+} u_dst;
+
+void main() {
+	// Each invocation handles two consecutive values of every output
+	const int pair_index = int(gl_GlobalInvocationID.x);
+	const int pair_count = (u_params.volume + 1) / 2;
+	if (pair_index >= pair_count) {
+		return;
+	}
+
+	const int i0 = pair_index * 2;
+	const bool has_second_value = i0 + 1 < u_params.volume;
+	int dst_start = u_params.dst_offset;
+
+	for (int output_index = 0; output_index < u_params.output_count; ++output_index) {
+		const int src_start = output_index * u_params.volume;
+		const float v0 = u_src.values[src_start + i0];
+		const float v1 = has_second_value ? u_src.values[src_start + i0 + 1] : 0.0;
+
+		if (u_params.packed_outputs[output_index] != 0) {
+			// The first value goes in the lower 16 bits, so on the CPU they read as an array of int16
+			u_dst.values[dst_start + pair_index] = packSnorm2x16(vec2(v0, v1) * u_params.sd_scale);
+			dst_start += pair_count;
+
+		} else {
+			u_dst.values[dst_start + i0] = floatBitsToUint(v0);
+			if (has_second_value) {
+				u_dst.values[dst_start + i0 + 1] = floatBitsToUint(v1);
+			}
+			dst_start += u_params.volume;
+		}
+	}
+}
@@ -0,0 +1,295 @@
+#[compute]
+#version 450
+
+// Places instances on a mesh block, like `VoxelInstanceGenerator` does on the CPU. Each invocation handles one
+// candidate position, and writes its transform in the layout expected by multimesh buffers. Candidates that get
+// filtered out are flagged so the CPU can skip them.
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// Must match VoxelInstanceGenerator::EmitMode
+const int EMIT_FROM_VERTICES = 0;
+const int EMIT_FROM_FACES_FAST = 1;
+const int EMIT_ONE_PER_TRIANGLE = 3;
+
+// Must match UpMode
+const int UP_MODE_POSITIVE_Y = 0;
+const int UP_MODE_SPHERE = 1;
+
+// Must match VoxelInstanceGenerator::Distribution
+const int DISTRIBUTION_QUADRATIC = 1;
+const int DISTRIBUTION_CUBIC = 2;
+const int DISTRIBUTION_QUINTIC = 3;
+
+const int FLAG_RANDOM_VERTICAL_FLIP = 1;
+const int FLAG_RANDOM_ROTATION = 2;
+const int FLAG_NOISE = 4;
+const int FLAG_SLOPE_FILTER = 8;
+const int FLAG_HEIGHT_FILTER = 16;
+
+// Floats per transform in the output
+const int TRANSFORM_SIZE = 12;
+
+layout (set = 0, binding = 0, std430) restrict readonly buffer Params {
+	// Position of the mesh block relative to the instancer
+	vec3 block_origin;
+	float block_size;
+	int emit_mode;
+	int candidate_count;
+	int triangle_count;
+	uint seed;
+	float density;
+	float jitter;
+	float triangle_area_threshold;
+	float vertical_alignment;
+	float min_scale;
+	float max_scale;
+	int scale_distribution;
+	float offset_along_normal;
+	float min_normal_y;
+	float max_normal_y;
+	float min_height;
+	float max_height;
+	int up_mode;
+	int octant_mask;
+	int flags;
+	float noise_on_scale;
+	// Where to start writing in the output buffer, in elements
+	int dst_offset;
+} u_params;
+
+// Vertex positions and normals use vec4, because arrays of vec3 have the same stride in std430
+layout (set = 0, binding = 1, std430) restrict readonly buffer Vertices {
+	vec4 values[];
+} u_vertices;
+
+layout (set = 0, binding = 2, std430) restrict readonly buffer Normals {
+	vec4 values[];
+} u_normals;
+
+layout (set = 0, binding = 3, std430) restrict readonly buffer Indices {
+	int values[];
+} u_indices;
+
+// Contains `candidate_count` transforms, followed by `candidate_count` flags telling which ones are valid
+layout (set = 0, binding = 4, std430) restrict writeonly buffer OutBuffer {
+	uint values[];
+} u_out;
+
+// <PLACEHOLDER>
+float get_noise(vec3 pos) {
+	return 1.0;
+}
+// </PLACEHOLDER>
+
+uint hash_u32(uint x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+uint rand_u32(inout uint state) {
+	state = hash_u32(state);
+	return state;
+}
+
+// Returns a number between 0 and 1 (excluded)
+float rand_f(inout uint state) {
+	return float(rand_u32(state) >> 8) * (1.0 / 16777216.0);
+}
+
+float get_triangle_area(vec3 a, vec3 b, vec3 c) {
+	return 0.5 * length(cross(b - a, c - a));
+}
+
+bool get_candidate(int candidate_index, inout uint rng, out vec3 out_pos, out vec3 out_normal) {
+	if (u_params.emit_mode == EMIT_FROM_VERTICES) {
+		if (rand_f(rng) >= u_params.density) {
+			return false;
+		}
+		out_pos = u_vertices.values[candidate_index].xyz;
+		// Ignore vertices located on the positive faces of the block. They are usually shared with the neighbor block,
+		// which causes a density bias and overlapping instances
+		const float margin = u_params.block_size - u_params.block_size * 0.01;
+		if (out_pos.x > margin || out_pos.y > margin || out_pos.z > margin) {
+			return false;
+		}
+		out_normal = u_normals.values[candidate_index].xyz;
+		return true;
+	}
+
+	int triangle_index = candidate_index;
+	if (u_params.emit_mode == EMIT_FROM_FACES_FAST) {
+		triangle_index = int(rand_u32(rng) % uint(u_params.triangle_count));
+	}
+
+	const int ia = u_indices.values[triangle_index * 3];
+	const int ib = u_indices.values[triangle_index * 3 + 1];
+	const int ic = u_indices.values[triangle_index * 3 + 2];
+
+	const vec3 pa = u_vertices.values[ia].xyz;
+	const vec3 pb = u_vertices.values[ib].xyz;
+	const vec3 pc = u_vertices.values[ic].xyz;
+
+	const vec3 na = u_normals.values[ia].xyz;
+	const vec3 nb = u_normals.values[ib].xyz;
+	const vec3 nc = u_normals.values[ic].xyz;
+
+	const float t0 = rand_f(rng);
+	const float t1 = rand_f(rng);
+	// This is an approximation of a uniform distribution, same as on the CPU
+	const vec3 rp = mix(mix(pa, pb, t0), pc, t1);
+	const vec3 rn = mix(mix(na, nb, t0), nc, t1);
+
+	if (u_params.emit_mode == EMIT_FROM_FACES_FAST) {
+		out_pos = rp;
+		out_normal = rn;
+		return true;
+	}
+
+	// One per triangle
+	if (u_params.triangle_area_threshold > 0.0 &&
+			get_triangle_area(pa, pb, pc) < u_params.triangle_area_threshold) {
+		return false;
+	}
+	const vec3 cp = (pa + pb + pc) / 3.0;
+	const vec3 cn = (na + nb + nc) / 3.0;
+	out_pos = mix(cp, rp, u_params.jitter);
+	out_normal = mix(cn, rn, u_params.jitter);
+	return true;
+}
+
+void main() {
+	const int candidate_index = int(gl_GlobalInvocationID.x);
+	if (candidate_index >= u_params.candidate_count) {
+		return;
+	}
+
+	const int valid_index = u_params.dst_offset + u_params.candidate_count * TRANSFORM_SIZE + candidate_index;
+	u_out.values[valid_index] = 0;
+
+	// Each candidate gets its own random sequence, so they don't depend on each other
+	uint rng = hash_u32(u_params.seed ^ hash_u32(uint(candidate_index)));
+
+	vec3 pos;
+	vec3 surface_normal;
+	if (!get_candidate(candidate_index, rng, pos, surface_normal)) {
+		return;
+	}
+
+	// Filter out by octants, some of them may contain edited instances instead
+	const float half_block_size = u_params.block_size * 0.5;
+	const int octant_index = int(pos.x > half_block_size) | (int(pos.y > half_block_size) << 1) |
+			(int(pos.z > half_block_size) << 2);
+	if ((u_params.octant_mask & (1 << octant_index)) == 0) {
+		return;
+	}
+
+	const vec3 world_pos = u_params.block_origin + pos;
+
+	float noise = 1.0;
+	if ((u_params.flags & FLAG_NOISE) != 0) {
+		noise = get_noise(world_pos);
+		if (noise <= 0.0) {
+			return;
+		}
+	}
+
+	// Mesh normals are not always normalized
+	surface_normal = normalize(surface_normal);
+
+	vec3 global_up = vec3(0.0, 1.0, 0.0);
+	if (u_params.up_mode == UP_MODE_SPHERE) {
+		global_up = normalize(world_pos);
+	}
+
+	if ((u_params.flags & FLAG_SLOPE_FILTER) != 0) {
+		const float ny = dot(surface_normal, global_up);
+		if (ny < u_params.min_normal_y || ny > u_params.max_normal_y) {
+			return;
+		}
+	}
+
+	if ((u_params.flags & FLAG_HEIGHT_FILTER) != 0) {
+		const float height = u_params.up_mode == UP_MODE_SPHERE ? length(world_pos) : world_pos.y;
+		if (height < u_params.min_height || height > u_params.max_height) {
+			return;
+		}
+	}
+
+	vec3 axis_y;
+	if (u_params.vertical_alignment == 0.0) {
+		axis_y = surface_normal;
+	} else if (u_params.vertical_alignment < 1.0) {
+		axis_y = normalize(mix(surface_normal, global_up, u_params.vertical_alignment));
+	} else {
+		axis_y = global_up;
+	}
+
+	const vec3 origin = pos + u_params.offset_along_normal * axis_y;
+
+	// Allows to use two faces of a single rock to create variety in the same layer
+	if ((u_params.flags & FLAG_RANDOM_VERTICAL_FLIP) != 0 && (rand_u32(rng) & 1u) == 1u) {
+		axis_y = -axis_y;
+	}
+
+	const vec3 fixed_look_axis = u_params.up_mode == UP_MODE_POSITIVE_Y ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+	const vec3 fixed_look_axis_alternative =
+			u_params.up_mode == UP_MODE_POSITIVE_Y ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+
+	vec3 dir = fixed_look_axis;
+	if ((u_params.flags & FLAG_RANDOM_ROTATION) != 0) {
+		// Unlike the CPU version, only one direction is tried so all invocations take the same time
+		dir = normalize(vec3(rand_f(rng), rand_f(rng), rand_f(rng)) - 0.5);
+	}
+	if (abs(dot(dir, axis_y)) > 0.9999) {
+		dir = abs(dot(fixed_look_axis, axis_y)) > 0.9999 ? fixed_look_axis_alternative : fixed_look_axis;
+	}
+
+	const vec3 axis_x = normalize(cross(axis_y, dir));
+	const vec3 axis_z = cross(axis_x, axis_y);
+
+	float scale = u_params.min_scale;
+	const float scale_range = u_params.max_scale - u_params.min_scale;
+	if (scale_range > 0.0) {
+		float r = rand_f(rng);
+		if (u_params.scale_distribution == DISTRIBUTION_QUADRATIC) {
+			r = r * r;
+		} else if (u_params.scale_distribution == DISTRIBUTION_CUBIC) {
+			r = r * r * r;
+		} else if (u_params.scale_distribution == DISTRIBUTION_QUINTIC) {
+			r = r * r * r * r * r;
+		}
+		if ((u_params.flags & FLAG_NOISE) != 0 && u_params.noise_on_scale > 0.0) {
+			// Multiplied noise because it gives more pronounced results
+			r *= mix(1.0, clamp(noise * 2.0, 0.0, 1.0), u_params.noise_on_scale);
+		}
+		scale += scale_range * r;
+	}
+
+	// Rows of the basis followed by the origin component, like `RenderingServer.multimesh_set_buffer` expects
+	const vec3 bx = axis_x * scale;
+	const vec3 by = axis_y * scale;
+	const vec3 bz = axis_z * scale;
+	const int dst = u_params.dst_offset + candidate_index * TRANSFORM_SIZE;
+
+	u_out.values[dst + 0] = floatBitsToUint(bx.x);
+	u_out.values[dst + 1] = floatBitsToUint(by.x);
+	u_out.values[dst + 2] = floatBitsToUint(bz.x);
+	u_out.values[dst + 3] = floatBitsToUint(origin.x);
+
+	u_out.values[dst + 4] = floatBitsToUint(bx.y);
+	u_out.values[dst + 5] = floatBitsToUint(by.y);
+	u_out.values[dst + 6] = floatBitsToUint(bz.y);
+	u_out.values[dst + 7] = floatBitsToUint(origin.y);
+
+	u_out.values[dst + 8] = floatBitsToUint(bx.z);
+	u_out.values[dst + 9] = floatBitsToUint(by.z);
+	u_out.values[dst + 10] = floatBitsToUint(bz.z);
+	u_out.values[dst + 11] = floatBitsToUint(origin.z);
+
+	u_out.values[valid_index] = 1;
+}
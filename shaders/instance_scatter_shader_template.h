@@ -0,0 +1,298 @@
+// Generated file
+
+// clang-format off
+const char *g_instance_scatter_shader_template_0 =
+"#version 450\n"
+"\n"
+"// Places instances on a mesh block, like `VoxelInstanceGenerator` does on the CPU. Each invocation handles one\n"
+"// candidate position, and writes its transform in the layout expected by multimesh buffers. Candidates that get\n"
+"// filtered out are flagged so the CPU can skip them.\n"
+"\n"
+"layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;\n"
+"\n"
+"// Must match VoxelInstanceGenerator::EmitMode\n"
+"const int EMIT_FROM_VERTICES = 0;\n"
+"const int EMIT_FROM_FACES_FAST = 1;\n"
+"const int EMIT_ONE_PER_TRIANGLE = 3;\n"
+"\n"
+"// Must match UpMode\n"
+"const int UP_MODE_POSITIVE_Y = 0;\n"
+"const int UP_MODE_SPHERE = 1;\n"
+"\n"
+"// Must match VoxelInstanceGenerator::Distribution\n"
+"const int DISTRIBUTION_QUADRATIC = 1;\n"
+"const int DISTRIBUTION_CUBIC = 2;\n"
+"const int DISTRIBUTION_QUINTIC = 3;\n"
+"\n"
+"const int FLAG_RANDOM_VERTICAL_FLIP = 1;\n"
+"const int FLAG_RANDOM_ROTATION = 2;\n"
+"const int FLAG_NOISE = 4;\n"
+"const int FLAG_SLOPE_FILTER = 8;\n"
+"const int FLAG_HEIGHT_FILTER = 16;\n"
+"\n"
+"// Floats per transform in the output\n"
+"const int TRANSFORM_SIZE = 12;\n"
+"\n"
+"layout (set = 0, binding = 0, std430) restrict readonly buffer Params {\n"
+"	// Position of the mesh block relative to the instancer\n"
+"	vec3 block_origin;\n"
+"	float block_size;\n"
+"	int emit_mode;\n"
+"	int candidate_count;\n"
+"	int triangle_count;\n"
+"	uint seed;\n"
+"	float density;\n"
+"	float jitter;\n"
+"	float triangle_area_threshold;\n"
+"	float vertical_alignment;\n"
+"	float min_scale;\n"
+"	float max_scale;\n"
+"	int scale_distribution;\n"
+"	float offset_along_normal;\n"
+"	float min_normal_y;\n"
+"	float max_normal_y;\n"
+"	float min_height;\n"
+"	float max_height;\n"
+"	int up_mode;\n"
+"	int octant_mask;\n"
+"	int flags;\n"
+"	float noise_on_scale;\n"
+"	// Where to start writing in the output buffer, in elements\n"
+"	int dst_offset;\n"
+"} u_params;\n"
+"\n"
+"// Vertex positions and normals use vec4, because arrays of vec3 have the same stride in std430\n"
+"layout (set = 0, binding = 1, std430) restrict readonly buffer Vertices {\n"
+"	vec4 values[];\n"
+"} u_vertices;\n"
+"\n"
+"layout (set = 0, binding = 2, std430) restrict readonly buffer Normals {\n"
+"	vec4 values[];\n"
+"} u_normals;\n"
+"\n"
+"layout (set = 0, binding = 3, std430) restrict readonly buffer Indices {\n"
+"	int values[];\n"
+"} u_indices;\n"
+"\n"
+"// Contains `candidate_count` transforms, followed by `candidate_count` flags telling which ones are valid\n"
+"layout (set = 0, binding = 4, std430) restrict writeonly buffer OutBuffer {\n"
+"	uint values[];\n"
+"} u_out;\n"
+"\n";
+// clang-format on
+
+// clang-format off
+const char *g_instance_scatter_shader_template_1 =
+"\n"
+"uint hash_u32(uint x) {\n"
+"	x ^= x >> 16;\n"
+"	x *= 0x7feb352du;\n"
+"	x ^= x >> 15;\n"
+"	x *= 0x846ca68bu;\n"
+"	x ^= x >> 16;\n"
+"	return x;\n"
+"}\n"
+"\n"
+"uint rand_u32(inout uint state) {\n"
+"	state = hash_u32(state);\n"
+"	return state;\n"
+"}\n"
+"\n"
+"// Returns a number between 0 and 1 (excluded)\n"
+"float rand_f(inout uint state) {\n"
+"	return float(rand_u32(state) >> 8) * (1.0 / 16777216.0);\n"
+"}\n"
+"\n"
+"float get_triangle_area(vec3 a, vec3 b, vec3 c) {\n"
+"	return 0.5 * length(cross(b - a, c - a));\n"
+"}\n"
+"\n"
+"bool get_candidate(int candidate_index, inout uint rng, out vec3 out_pos, out vec3 out_normal) {\n"
+"	if (u_params.emit_mode == EMIT_FROM_VERTICES) {\n"
+"		if (rand_f(rng) >= u_params.density) {\n"
+"			return false;\n"
+"		}\n"
+"		out_pos = u_vertices.values[candidate_index].xyz;\n"
+"		// Ignore vertices located on the positive faces of the block. They are usually shared with the neighbor block,\n"
+"		// which causes a density bias and overlapping instances\n"
+"		const float margin = u_params.block_size - u_params.block_size * 0.01;\n"
+"		if (out_pos.x > margin || out_pos.y > margin || out_pos.z > margin) {\n"
+"			return false;\n"
+"		}\n"
+"		out_normal = u_normals.values[candidate_index].xyz;\n"
+"		return true;\n"
+"	}\n"
+"\n"
+"	int triangle_index = candidate_index;\n"
+"	if (u_params.emit_mode == EMIT_FROM_FACES_FAST) {\n"
+"		triangle_index = int(rand_u32(rng) % uint(u_params.triangle_count));\n"
+"	}\n"
+"\n"
+"	const int ia = u_indices.values[triangle_index * 3];\n"
+"	const int ib = u_indices.values[triangle_index * 3 + 1];\n"
+"	const int ic = u_indices.values[triangle_index * 3 + 2];\n"
+"\n"
+"	const vec3 pa = u_vertices.values[ia].xyz;\n"
+"	const vec3 pb = u_vertices.values[ib].xyz;\n"
+"	const vec3 pc = u_vertices.values[ic].xyz;\n"
+"\n"
+"	const vec3 na = u_normals.values[ia].xyz;\n"
+"	const vec3 nb = u_normals.values[ib].xyz;\n"
+"	const vec3 nc = u_normals.values[ic].xyz;\n"
+"\n"
+"	const float t0 = rand_f(rng);\n"
+"	const float t1 = rand_f(rng);\n"
+"	// This is an approximation of a uniform distribution, same as on the CPU\n"
+"	const vec3 rp = mix(mix(pa, pb, t0), pc, t1);\n"
+"	const vec3 rn = mix(mix(na, nb, t0), nc, t1);\n"
+"\n"
+"	if (u_params.emit_mode == EMIT_FROM_FACES_FAST) {\n"
+"		out_pos = rp;\n"
+"		out_normal = rn;\n"
+"		return true;\n"
+"	}\n"
+"\n"
+"	// One per triangle\n"
+"	if (u_params.triangle_area_threshold > 0.0 &&\n"
+"			get_triangle_area(pa, pb, pc) < u_params.triangle_area_threshold) {\n"
+"		return false;\n"
+"	}\n"
+"	const vec3 cp = (pa + pb + pc) / 3.0;\n"
+"	const vec3 cn = (na + nb + nc) / 3.0;\n"
+"	out_pos = mix(cp, rp, u_params.jitter);\n"
+"	out_normal = mix(cn, rn, u_params.jitter);\n"
+"	return true;\n"
+"}\n"
+"\n"
+"void main() {\n"
+"	const int candidate_index = int(gl_GlobalInvocationID.x);\n"
+"	if (candidate_index >= u_params.candidate_count) {\n"
+"		return;\n"
+"	}\n"
+"\n"
+"	const int valid_index = u_params.dst_offset + u_params.candidate_count * TRANSFORM_SIZE + candidate_index;\n"
+"	u_out.values[valid_index] = 0;\n"
+"\n"
+"	// Each candidate gets its own random sequence, so they don't depend on each other\n"
+"	uint rng = hash_u32(u_params.seed ^ hash_u32(uint(candidate_index)));\n"
+"\n"
+"	vec3 pos;\n"
+"	vec3 surface_normal;\n"
+"	if (!get_candidate(candidate_index, rng, pos, surface_normal)) {\n"
+"		return;\n"
+"	}\n"
+"\n"
+"	// Filter out by octants, some of them may contain edited instances instead\n"
+"	const float half_block_size = u_params.block_size * 0.5;\n"
+"	const int octant_index = int(pos.x > half_block_size) | (int(pos.y > half_block_size) << 1) |\n"
+"			(int(pos.z > half_block_size) << 2);\n"
+"	if ((u_params.octant_mask & (1 << octant_index)) == 0) {\n"
+"		return;\n"
+"	}\n"
+"\n"
+"	const vec3 world_pos = u_params.block_origin + pos;\n"
+"\n"
+"	float noise = 1.0;\n"
+"	if ((u_params.flags & FLAG_NOISE) != 0) {\n"
+"		noise = get_noise(world_pos);\n"
+"		if (noise <= 0.0) {\n"
+"			return;\n"
+"		}\n"
+"	}\n"
+"\n"
+"	// Mesh normals are not always normalized\n"
+"	surface_normal = normalize(surface_normal);\n"
+"\n"
+"	vec3 global_up = vec3(0.0, 1.0, 0.0);\n"
+"	if (u_params.up_mode == UP_MODE_SPHERE) {\n"
+"		global_up = normalize(world_pos);\n"
+"	}\n"
+"\n"
+"	if ((u_params.flags & FLAG_SLOPE_FILTER) != 0) {\n"
+"		const float ny = dot(surface_normal, global_up);\n"
+"		if (ny < u_params.min_normal_y || ny > u_params.max_normal_y) {\n"
+"			return;\n"
+"		}\n"
+"	}\n"
+"\n"
+"	if ((u_params.flags & FLAG_HEIGHT_FILTER) != 0) {\n"
+"		const float height = u_params.up_mode == UP_MODE_SPHERE ? length(world_pos) : world_pos.y;\n"
+"		if (height < u_params.min_height || height > u_params.max_height) {\n"
+"			return;\n"
+"		}\n"
+"	}\n"
+"\n"
+"	vec3 axis_y;\n"
+"	if (u_params.vertical_alignment == 0.0) {\n"
+"		axis_y = surface_normal;\n"
+"	} else if (u_params.vertical_alignment < 1.0) {\n"
+"		axis_y = normalize(mix(surface_normal, global_up, u_params.vertical_alignment));\n"
+"	} else {\n"
+"		axis_y = global_up;\n"
+"	}\n"
+"\n"
+"	const vec3 origin = pos + u_params.offset_along_normal * axis_y;\n"
+"\n"
+"	// Allows to use two faces of a single rock to create variety in the same layer\n"
+"	if ((u_params.flags & FLAG_RANDOM_VERTICAL_FLIP) != 0 && (rand_u32(rng) & 1u) == 1u) {\n"
+"		axis_y = -axis_y;\n"
+"	}\n"
+"\n"
+"	const vec3 fixed_look_axis = u_params.up_mode == UP_MODE_POSITIVE_Y ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);\n"
+"	const vec3 fixed_look_axis_alternative =\n"
+"			u_params.up_mode == UP_MODE_POSITIVE_Y ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);\n"
+"\n"
+"	vec3 dir = fixed_look_axis;\n"
+"	if ((u_params.flags & FLAG_RANDOM_ROTATION) != 0) {\n"
+"		// Unlike the CPU version, only one direction is tried so all invocations take the same time\n"
+"		dir = normalize(vec3(rand_f(rng), rand_f(rng), rand_f(rng)) - 0.5);\n"
+"	}\n"
+"	if (abs(dot(dir, axis_y)) > 0.9999) {\n"
+"		dir = abs(dot(fixed_look_axis, axis_y)) > 0.9999 ? fixed_look_axis_alternative : fixed_look_axis;\n"
+"	}\n"
+"\n"
+"	const vec3 axis_x = normalize(cross(axis_y, dir));\n"
+"	const vec3 axis_z = cross(axis_x, axis_y);\n"
+"\n"
+"	float scale = u_params.min_scale;\n"
+"	const float scale_range = u_params.max_scale - u_params.min_scale;\n"
+"	if (scale_range > 0.0) {\n"
+"		float r = rand_f(rng);\n"
+"		if (u_params.scale_distribution == DISTRIBUTION_QUADRATIC) {\n"
+"			r = r * r;\n"
+"		} else if (u_params.scale_distribution == DISTRIBUTION_CUBIC) {\n"
+"			r = r * r * r;\n"
+"		} else if (u_params.scale_distribution == DISTRIBUTION_QUINTIC) {\n"
+"			r = r * r * r * r * r;\n"
+"		}\n"
+"		if ((u_params.flags & FLAG_NOISE) != 0 && u_params.noise_on_scale > 0.0) {\n"
+"			// Multiplied noise because it gives more pronounced results\n"
+"			r *= mix(1.0, clamp(noise * 2.0, 0.0, 1.0), u_params.noise_on_scale);\n"
+"		}\n"
+"		scale += scale_range * r;\n"
+"	}\n"
+"\n"
+"	// Rows of the basis followed by the origin component, like `RenderingServer.multimesh_set_buffer` expects\n"
+"	const vec3 bx = axis_x * scale;\n"
+"	const vec3 by = axis_y * scale;\n"
+"	const vec3 bz = axis_z * scale;\n"
+"	const int dst = u_params.dst_offset + candidate_index * TRANSFORM_SIZE;\n"
+"\n"
+"	u_out.values[dst + 0] = floatBitsToUint(bx.x);\n"
+"	u_out.values[dst + 1] = floatBitsToUint(by.x);\n"
+"	u_out.values[dst + 2] = floatBitsToUint(bz.x);\n"
+"	u_out.values[dst + 3] = floatBitsToUint(origin.x);\n"
+"\n"
+"	u_out.values[dst + 4] = floatBitsToUint(bx.y);\n"
+"	u_out.values[dst + 5] = floatBitsToUint(by.y);\n"
+"	u_out.values[dst + 6] = floatBitsToUint(bz.y);\n"
+"	u_out.values[dst + 7] = floatBitsToUint(origin.y);\n"
+"\n"
+"	u_out.values[dst + 8] = floatBitsToUint(bx.z);\n"
+"	u_out.values[dst + 9] = floatBitsToUint(by.z);\n"
+"	u_out.values[dst + 10] = floatBitsToUint(bz.z);\n"
+"	u_out.values[dst + 11] = floatBitsToUint(origin.z);\n"
+"\n"
+"	u_out.values[valid_index] = 1;\n"
+"}\n";
+// clang-format on
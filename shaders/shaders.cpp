@@ -4,12 +4,14 @@ namespace zylann::voxel {
 
 #include "block_generator_shader_template.h"
 #include "block_modifier_shader_template.h"
+#include "block_output_pack_shader.h"
 #include "detail_gather_hits_shader.h"
 #include "detail_generator_shader_template.h"
 #include "detail_modifier_shader_template.h"
 #include "detail_normalmap_shader.h"
 #include "dilate_normalmap_shader.h"
 #include "fast_noise_lite_shader.h"
+#include "instance_scatter_shader_template.h"
 #include "modifier_mesh_shader_snippet.h"
 #include "modifier_sphere_shader_snippet.h"
 
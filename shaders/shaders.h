@@ -8,6 +8,7 @@ extern const char *g_block_generator_shader_template_1;
 extern const char *g_block_generator_shader_template_2;
 extern const char *g_block_modifier_shader_template_0;
 extern const char *g_block_modifier_shader_template_1;
+extern const char *g_block_output_pack_shader;
 extern const char *g_detail_gather_hits_shader;
 extern const char *g_detail_generator_shader_template_0;
 extern const char *g_detail_generator_shader_template_1;
@@ -15,6 +16,8 @@ extern const char *g_detail_modifier_shader_template_0;
 extern const char *g_detail_modifier_shader_template_1;
 extern const char *g_detail_normalmap_shader;
 extern const char *g_dilate_normalmap_shader;
+extern const char *g_instance_scatter_shader_template_0;
+extern const char *g_instance_scatter_shader_template_1;
 extern const char *g_modifier_sphere_shader_snippet;
 extern const char *g_modifier_mesh_shader_snippet;
 extern const char *g_fast_noise_lite_shader[];
@@ -0,0 +1,258 @@
+#include "blocky_light.h"
+#include "../util/profiling.h"
+#include "voxel_buffer.h"
+#include "voxel_data_grid.h"
+
+namespace zylann::voxel::blocky_light {
+
+namespace {
+
+const Vector3i g_neighbor_offsets[6] = {
+	Vector3i(-1, 0, 0), //
+	Vector3i(1, 0, 0), //
+	Vector3i(0, -1, 0), //
+	Vector3i(0, 1, 0), //
+	Vector3i(0, 0, -1), //
+	Vector3i(0, 0, 1) //
+};
+
+struct BlockState {
+	VoxelBuffer *voxels = nullptr;
+	// Light levels the block had before the update, captured the first time one of them changes
+	StdVector<uint8_t> initial_levels;
+};
+
+struct Location {
+	BlockState *block;
+	Vector3i rpos;
+};
+
+// Accesses light levels and voxel types of blocks referenced by a grid, remembering which blocks got modified
+class Area {
+public:
+	Area(VoxelDataGrid &grid, const ModelProperties &models, unsigned int channel) :
+			_models(models),
+			_channel(channel),
+			_origin_in_blocks(grid.get_origin_block_position_in_blocks()),
+			_size_in_blocks(grid.get_size_in_blocks()),
+			_block_size_po2(grid.get_block_size_po2()) {
+		_blocks.resize(Vector3iUtil::get_volume(_size_in_blocks));
+		unsigned int index = 0;
+		Box3i(_origin_in_blocks, _size_in_blocks).for_each_cell_zxy([this, &grid, &index](Vector3i bpos) {
+			_blocks[index].voxels = grid.get_block_no_lock(bpos);
+			++index;
+		});
+	}
+
+	// Returns false if the voxel is not in a loaded block
+	inline bool find(Vector3i pos, Location &out_location) {
+		const Vector3i bpos = (pos >> _block_size_po2) - _origin_in_blocks;
+		if (bpos.x < 0 || bpos.y < 0 || bpos.z < 0 || //
+			bpos.x >= _size_in_blocks.x || bpos.y >= _size_in_blocks.y || bpos.z >= _size_in_blocks.z) {
+			return false;
+		}
+		BlockState &block = _blocks[Vector3iUtil::get_zxy_index(bpos, _size_in_blocks)];
+		if (block.voxels == nullptr) {
+			return false;
+		}
+		out_location.block = &block;
+		out_location.rpos = pos & ((1 << _block_size_po2) - 1);
+		return true;
+	}
+
+	inline uint8_t get_level(const Location &loc) const {
+		return loc.block->voxels->get_voxel(loc.rpos, _channel) & LEVEL_MASK;
+	}
+
+	void set_level(const Location &loc, uint8_t level) {
+		BlockState &block = *loc.block;
+		if (block.initial_levels.size() == 0) {
+			capture_initial_levels(block);
+		}
+		const uint64_t v = block.voxels->get_voxel(loc.rpos, _channel);
+		block.voxels->set_voxel((v & ~uint64_t(LEVEL_MASK)) | level, loc.rpos, _channel);
+	}
+
+	inline uint32_t get_type(const Location &loc) const {
+		return loc.block->voxels->get_voxel(loc.rpos, VoxelBuffer::CHANNEL_TYPE);
+	}
+
+	inline uint8_t get_emission(const Location &loc) const {
+		return _models.get_emission(get_type(loc));
+	}
+
+	inline bool is_opaque(const Location &loc) const {
+		return _models.is_opaque(get_type(loc));
+	}
+
+	void get_changed_boxes(StdVector<Box3i> &out_boxes) const {
+		const Vector3i block_size = Vector3iUtil::create(1 << _block_size_po2);
+		unsigned int index = 0;
+
+		Box3i(_origin_in_blocks, _size_in_blocks).for_each_cell_zxy([&](Vector3i bpos) {
+			const BlockState &block = _blocks[index];
+			++index;
+			if (block.initial_levels.size() == 0) {
+				return;
+			}
+
+			Vector3i min_pos = block_size;
+			Vector3i max_pos = Vector3i(-1, -1, -1);
+			Vector3i rpos;
+			for (rpos.z = 0; rpos.z < block_size.z; ++rpos.z) {
+				for (rpos.x = 0; rpos.x < block_size.x; ++rpos.x) {
+					for (rpos.y = 0; rpos.y < block_size.y; ++rpos.y) {
+						const uint8_t level = block.voxels->get_voxel(rpos, _channel) & LEVEL_MASK;
+						if (level != block.initial_levels[Vector3iUtil::get_zxy_index(rpos, block_size)]) {
+							min_pos = math::min(min_pos, rpos);
+							max_pos = math::max(max_pos, rpos);
+						}
+					}
+				}
+			}
+
+			if (max_pos.x >= 0) {
+				// Levels may have changed and then came back to what they were
+				const Vector3i origin = bpos << _block_size_po2;
+				out_boxes.push_back(Box3i::from_min_max(origin + min_pos, origin + max_pos + Vector3i(1, 1, 1)));
+			}
+		});
+	}
+
+private:
+	void capture_initial_levels(BlockState &block) const {
+		const Vector3i block_size = Vector3iUtil::create(1 << _block_size_po2);
+		block.initial_levels.resize(Vector3iUtil::get_volume(block_size));
+		Vector3i rpos;
+		for (rpos.z = 0; rpos.z < block_size.z; ++rpos.z) {
+			for (rpos.x = 0; rpos.x < block_size.x; ++rpos.x) {
+				for (rpos.y = 0; rpos.y < block_size.y; ++rpos.y) {
+					block.initial_levels[Vector3iUtil::get_zxy_index(rpos, block_size)] =
+							block.voxels->get_voxel(rpos, _channel) & LEVEL_MASK;
+				}
+			}
+		}
+	}
+
+	const ModelProperties &_models;
+	const unsigned int _channel;
+	const Vector3i _origin_in_blocks;
+	const Vector3i _size_in_blocks;
+	const unsigned int _block_size_po2;
+	// Indexed in ZXY order, like the grid
+	StdVector<BlockState> _blocks;
+};
+
+struct RemovalNode {
+	Vector3i position;
+	// Level the voxel had before being cleared
+	uint8_t level;
+};
+
+} // namespace
+
+void update_area(
+		VoxelDataGrid &grid,
+		const ModelProperties &models,
+		unsigned int channel,
+		Box3i voxel_box,
+		StdVector<Box3i> &out_changed_boxes
+) {
+	ZN_PROFILE_SCOPE();
+
+	Area area(grid, models, channel);
+
+	StdVector<RemovalNode> removal_queue;
+	StdVector<Vector3i> add_queue;
+	StdVector<Vector3i> emitters;
+
+	// Clear light in the area. Light it spread around is cleared afterwards.
+	voxel_box.for_each_cell_zxy([&](Vector3i pos) {
+		Location loc;
+		if (!area.find(pos, loc)) {
+			return;
+		}
+		const uint8_t level = area.get_level(loc);
+		if (level > 0) {
+			area.set_level(loc, 0);
+			removal_queue.push_back(RemovalNode{ pos, level });
+		}
+		if (area.get_emission(loc) > 0) {
+			emitters.push_back(pos);
+		}
+	});
+
+	// Clear light that came from cleared voxels. Neighbors that are at least as bright are lit by something else, so
+	// they will spread their light again into cleared voxels.
+	for (size_t i = 0; i < removal_queue.size(); ++i) {
+		const RemovalNode node = removal_queue[i];
+
+		for (const Vector3i offset : g_neighbor_offsets) {
+			const Vector3i npos = node.position + offset;
+			Location nloc;
+			if (!area.find(npos, nloc)) {
+				continue;
+			}
+			const uint8_t nlevel = area.get_level(nloc);
+			if (nlevel == 0) {
+				continue;
+			}
+			if (nlevel < node.level) {
+				area.set_level(nloc, 0);
+				removal_queue.push_back(RemovalNode{ npos, nlevel });
+				if (area.get_emission(nloc) > 0) {
+					emitters.push_back(npos);
+				}
+			} else {
+				add_queue.push_back(npos);
+			}
+		}
+	}
+
+	// Light around the area can spread into it
+	voxel_box.padded(1).for_inner_outline([&area, &add_queue](Vector3i pos) {
+		Location loc;
+		if (area.find(pos, loc) && area.get_level(loc) > 1) {
+			add_queue.push_back(pos);
+		}
+	});
+
+	for (const Vector3i pos : emitters) {
+		Location loc;
+		// Emitters are always in loaded blocks
+		area.find(pos, loc);
+		const uint8_t emission = area.get_emission(loc);
+		if (area.get_level(loc) < emission) {
+			area.set_level(loc, emission);
+			add_queue.push_back(pos);
+		}
+	}
+
+	// Spread light
+	for (size_t i = 0; i < add_queue.size(); ++i) {
+		const Vector3i pos = add_queue[i];
+		Location loc;
+		area.find(pos, loc);
+		const uint8_t level = area.get_level(loc);
+		if (level <= 1) {
+			continue;
+		}
+
+		for (const Vector3i offset : g_neighbor_offsets) {
+			const Vector3i npos = pos + offset;
+			Location nloc;
+			if (!area.find(npos, nloc)) {
+				continue;
+			}
+			if (area.get_level(nloc) + 1 >= level || area.is_opaque(nloc)) {
+				continue;
+			}
+			area.set_level(nloc, level - 1);
+			add_queue.push_back(npos);
+		}
+	}
+
+	area.get_changed_boxes(out_changed_boxes);
+}
+
+} // namespace zylann::voxel::blocky_light
@@ -0,0 +1,56 @@
+#ifndef VOXEL_BLOCKY_LIGHT_H
+#define VOXEL_BLOCKY_LIGHT_H
+
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+#include <cstdint>
+
+namespace zylann::voxel {
+
+class VoxelDataGrid;
+
+// Light emitted by blocky voxels. Each voxel has a light level from 0 to MAX_LEVEL, stored in the lower bits of a
+// channel. Light spreads from emitting voxels to their neighbors, losing one level per voxel, and doesn't go through
+// opaque voxels. Upper bits of the channel are left untouched.
+// Light is derived from voxel types, so it can be computed again at any time.
+namespace blocky_light {
+
+static constexpr uint8_t MAX_LEVEL = 15;
+static constexpr uint8_t LEVEL_MASK = 0xf;
+
+// How far from an updated area light levels can change, and can be read from. Removing light affects voxels up to
+// MAX_LEVEL voxels away, and light coming from further than that can spread back into them.
+static constexpr int MAX_UPDATE_DISTANCE = 2 * MAX_LEVEL + 1;
+
+// Light properties of each model, indexed by voxel type
+struct ModelProperties {
+	// Level of light emitted, from 0 to MAX_LEVEL
+	StdVector<uint8_t> emission;
+	// 1 if light can't go through
+	StdVector<uint8_t> opaque;
+
+	inline uint8_t get_emission(uint32_t type) const {
+		return type < emission.size() ? emission[type] : 0;
+	}
+
+	inline bool is_opaque(uint32_t type) const {
+		return type < opaque.size() && opaque[type] != 0;
+	}
+};
+
+// Computes light again in the given area, after voxels changed in it or blocks were loaded there. Light spread from the
+// area into its surroundings is updated too. The grid should contain blocks at least MAX_UPDATE_DISTANCE voxels
+// around the area, and must be locked for writing. Voxels of missing blocks are left unlit and don't spread light.
+// For each block where light levels changed, a box enclosing the changed voxels is added to `out_changed_boxes`.
+void update_area(
+		VoxelDataGrid &grid,
+		const ModelProperties &models,
+		unsigned int channel,
+		Box3i voxel_box,
+		StdVector<Box3i> &out_changed_boxes
+);
+
+} // namespace blocky_light
+} // namespace zylann::voxel
+
+#endif // VOXEL_BLOCKY_LIGHT_H
@@ -0,0 +1,306 @@
+#include "blocky_simulation.h"
+#include "../util/profiling.h"
+#include "voxel_buffer.h"
+#include "voxel_buffer_view.h"
+#include "voxel_data_grid.h"
+#include <algorithm>
+
+namespace zylann::voxel::blocky_simulation {
+
+namespace {
+
+const Vector3i g_horizontal_offsets[4] = {
+	Vector3i(-1, 0, 0), //
+	Vector3i(0, 0, -1), //
+	Vector3i(1, 0, 0), //
+	Vector3i(0, 0, 1) //
+};
+
+// Voxels of a single block, in coordinates relative to the block
+class BlockAccess {
+public:
+	BlockAccess(VoxelBuffer &voxels, Vector3i origin, StdVector<Vector3i> &changed_cells) :
+			_voxels(voxels), _origin(origin), _changed_cells(changed_cells) {}
+
+	inline bool try_get_type(Vector3i pos, uint32_t &out_type) const {
+		if (!_voxels.is_position_valid(pos)) {
+			return false;
+		}
+		out_type = _voxels.get_voxel(pos, VoxelBuffer::CHANNEL_TYPE);
+		return true;
+	}
+
+	inline void set_type(Vector3i pos, uint32_t type) {
+		_voxels.set_voxel(type, pos, VoxelBuffer::CHANNEL_TYPE);
+		_changed_cells.push_back(_origin + pos);
+	}
+
+	inline Vector3i to_world(Vector3i pos) const {
+		return _origin + pos;
+	}
+
+private:
+	VoxelBuffer &_voxels;
+	const Vector3i _origin;
+	StdVector<Vector3i> &_changed_cells;
+};
+
+// Voxels of blocks referenced by a grid, in world coordinates
+class GridAccess {
+public:
+	GridAccess(VoxelDataGrid &grid, StdVector<Vector3i> &changed_cells) :
+			_grid(grid),
+			_origin_in_blocks(grid.get_origin_block_position_in_blocks()),
+			_size_in_blocks(grid.get_size_in_blocks()),
+			_block_size_po2(grid.get_block_size_po2()),
+			_changed_cells(changed_cells) {}
+
+	inline bool try_get_type(Vector3i pos, uint32_t &out_type) const {
+		const VoxelBuffer *voxels = get_block(pos);
+		if (voxels == nullptr) {
+			return false;
+		}
+		out_type = voxels->get_voxel(pos & ((1 << _block_size_po2) - 1), VoxelBuffer::CHANNEL_TYPE);
+		return true;
+	}
+
+	inline void set_type(Vector3i pos, uint32_t type) {
+		VoxelBuffer *voxels = get_block(pos);
+		// Only called on positions where `try_get_type` succeeded
+		voxels->set_voxel(type, pos & ((1 << _block_size_po2) - 1), VoxelBuffer::CHANNEL_TYPE);
+		_changed_cells.push_back(pos);
+	}
+
+	inline Vector3i to_world(Vector3i pos) const {
+		return pos;
+	}
+
+private:
+	inline VoxelBuffer *get_block(Vector3i pos) const {
+		const Vector3i bpos = pos >> _block_size_po2;
+		const Vector3i rbpos = bpos - _origin_in_blocks;
+		if (rbpos.x < 0 || rbpos.y < 0 || rbpos.z < 0 || //
+			rbpos.x >= _size_in_blocks.x || rbpos.y >= _size_in_blocks.y || rbpos.z >= _size_in_blocks.z) {
+			return nullptr;
+		}
+		return _grid.get_block_no_lock(bpos);
+	}
+
+	VoxelDataGrid &_grid;
+	const Vector3i _origin_in_blocks;
+	const Vector3i _size_in_blocks;
+	const unsigned int _block_size_po2;
+	StdVector<Vector3i> &_changed_cells;
+};
+
+template <typename Access_T>
+inline bool can_move_into(const Access_T &access, const ModelProperties &models, Vector3i pos) {
+	uint32_t type;
+	return access.try_get_type(pos, type) && models.is_replaceable(type);
+}
+
+template <typename Access_T>
+void move_voxel(Access_T &access, Vector3i src_pos, Vector3i dst_pos, uint32_t type, Behavior behavior) {
+	uint32_t dst_type;
+	access.try_get_type(dst_pos, dst_type);
+	access.set_type(dst_pos, type);
+	if (behavior != BEHAVIOR_SPREAD) {
+		// Swap, so voxels like air or gas take the place of the moving voxel
+		access.set_type(src_pos, dst_type);
+	}
+}
+
+// Each cell is stepped at most once per step, and cells are stepped bottom to top. Voxels only move into replaceable
+// voxels, which are never active cells themselves, so a voxel can't move twice in the same step.
+template <typename Access_T>
+void step_cell(Access_T &access, const ModelProperties &models, Vector3i pos, uint32_t step_index) {
+	uint32_t type;
+	if (!access.try_get_type(pos, type)) {
+		return;
+	}
+	const Behavior behavior = models.get_behavior(type);
+	if (behavior == BEHAVIOR_NONE) {
+		// Moved away earlier in this step
+		return;
+	}
+
+	const Vector3i below_pos = pos + Vector3i(0, -1, 0);
+	if (can_move_into(access, models, below_pos)) {
+		move_voxel(access, pos, below_pos, type, behavior);
+		return;
+	}
+
+	if (behavior == BEHAVIOR_FALL) {
+		return;
+	}
+
+	// Flowing voxels only move sideways towards a drop, or when pushed by voxels of the same type above them, so they
+	// settle down instead of wandering forever
+	bool pushed = false;
+	if (behavior == BEHAVIOR_FLOW) {
+		uint32_t above_type;
+		pushed = access.try_get_type(pos + Vector3i(0, 1, 0), above_type) && above_type == type;
+	}
+
+	// Directions are tried in an order depending on position and step, so voxels don't all go the same way
+	const uint32_t first_direction = Vector3iHasher::hash(access.to_world(pos)) + step_index;
+
+	for (unsigned int i = 0; i < 4; ++i) {
+		const Vector3i npos = pos + g_horizontal_offsets[(first_direction + i) & 3];
+		if (!can_move_into(access, models, npos)) {
+			continue;
+		}
+		if (behavior == BEHAVIOR_SPREAD) {
+			move_voxel(access, pos, npos, type, behavior);
+			continue;
+		}
+		if (pushed || can_move_into(access, models, npos + Vector3i(0, -1, 0))) {
+			move_voxel(access, pos, npos, type, behavior);
+			return;
+		}
+	}
+}
+
+// Adds positions of simulated voxels within a box of a block. `get_cells` is only called if there is any.
+template <typename T, typename GetCells_F>
+void find_active_cells_in_block(
+		const VoxelBuffer &voxels,
+		const ModelProperties &models,
+		Box3i local_box,
+		GetCells_F get_cells
+) {
+	VoxelBufferReadView<T> view;
+	ZN_ASSERT_RETURN(view.init(voxels, VoxelBuffer::CHANNEL_TYPE));
+
+	StdVector<Vector3i> *cells = nullptr;
+	const Vector3i min_pos = local_box.position;
+	const Vector3i max_pos = local_box.position + local_box.size;
+	Vector3i rpos;
+
+	for (rpos.z = min_pos.z; rpos.z < max_pos.z; ++rpos.z) {
+		for (rpos.x = min_pos.x; rpos.x < max_pos.x; ++rpos.x) {
+			rpos.y = min_pos.y;
+			unsigned int i = view.get_index(rpos);
+			for (; rpos.y < max_pos.y; ++rpos.y, i += VoxelBufferReadView<T>::Y_STRIDE) {
+				if (models.get_behavior(view.get(i)) == BEHAVIOR_NONE) {
+					continue;
+				}
+				if (cells == nullptr) {
+					cells = &get_cells();
+				}
+				cells->push_back(rpos);
+			}
+		}
+	}
+}
+
+inline bool is_on_block_border(Vector3i rpos, Vector3i block_size) {
+	return rpos.x == 0 || rpos.y == 0 || rpos.z == 0 || //
+			rpos.x == block_size.x - 1 || rpos.y == block_size.y - 1 || rpos.z == block_size.z - 1;
+}
+
+} // namespace
+
+bool ModelProperties::has_simulated_models() const {
+	for (const uint8_t behavior : behaviors) {
+		if (behavior != BEHAVIOR_NONE) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void sort_bottom_to_top(StdVector<Vector3i> &cells) {
+	std::sort(cells.begin(), cells.end(), [](const Vector3i &a, const Vector3i &b) {
+		if (a.y != b.y) {
+			return a.y < b.y;
+		}
+		if (a.z != b.z) {
+			return a.z < b.z;
+		}
+		return a.x < b.x;
+	});
+}
+
+void find_active_cells(
+		VoxelDataGrid &grid,
+		const ModelProperties &models,
+		Box3i voxel_box,
+		StdUnorderedMap<Vector3i, StdVector<Vector3i>> &out_cells_per_block
+) {
+	ZN_PROFILE_SCOPE();
+
+	const unsigned int block_size_po2 = grid.get_block_size_po2();
+	const Box3i grid_box_in_blocks(grid.get_origin_block_position_in_blocks(), grid.get_size_in_blocks());
+	const Box3i blocks_box = voxel_box.downscaled(1 << block_size_po2).clipped(grid_box_in_blocks);
+
+	blocks_box.for_each_cell_zxy([&](Vector3i bpos) {
+		const VoxelBuffer *voxels = grid.get_block_no_lock(bpos);
+		if (voxels == nullptr) {
+			return;
+		}
+		if (voxels->is_uniform(VoxelBuffer::CHANNEL_TYPE) &&
+			models.get_behavior(voxels->get_voxel(Vector3i(), VoxelBuffer::CHANNEL_TYPE)) == BEHAVIOR_NONE) {
+			return;
+		}
+
+		const Vector3i origin = bpos << block_size_po2;
+		const Box3i local_box = Box3i(voxel_box.position - origin, voxel_box.size).clipped(voxels->get_size());
+
+		dispatch_depth(voxels->get_channel_depth(VoxelBuffer::CHANNEL_TYPE), [&](auto zero) {
+			find_active_cells_in_block<decltype(zero)>(
+					*voxels, models, local_box, [&out_cells_per_block, bpos]() -> StdVector<Vector3i> & {
+						return out_cells_per_block[bpos];
+					}
+			);
+		});
+	});
+
+	// Boxes given in several calls may overlap
+	for (auto it = out_cells_per_block.begin(); it != out_cells_per_block.end(); ++it) {
+		StdVector<Vector3i> &cells = it->second;
+		sort_bottom_to_top(cells);
+		cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+	}
+}
+
+void step_block(
+		VoxelBuffer &voxels,
+		Vector3i block_origin,
+		Span<const Vector3i> cells,
+		const ModelProperties &models,
+		uint32_t step_index,
+		BlockStepResult &out_result
+) {
+	ZN_PROFILE_SCOPE();
+
+	BlockAccess access(voxels, block_origin, out_result.changed_cells);
+	const Vector3i block_size = voxels.get_size();
+
+	for (const Vector3i rpos : cells) {
+		// Cells on the border may access neighbor blocks
+		if (is_on_block_border(rpos, block_size)) {
+			out_result.border_cells.push_back(block_origin + rpos);
+			continue;
+		}
+		step_cell(access, models, rpos, step_index);
+	}
+}
+
+void step_cells(
+		VoxelDataGrid &grid,
+		Span<const Vector3i> cells,
+		const ModelProperties &models,
+		uint32_t step_index,
+		StdVector<Vector3i> &out_changed_cells
+) {
+	ZN_PROFILE_SCOPE();
+
+	GridAccess access(grid, out_changed_cells);
+
+	for (const Vector3i pos : cells) {
+		step_cell(access, models, pos, step_index);
+	}
+}
+
+} // namespace zylann::voxel::blocky_simulation
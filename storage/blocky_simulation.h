@@ -0,0 +1,95 @@
+#ifndef VOXEL_BLOCKY_SIMULATION_H
+#define VOXEL_BLOCKY_SIMULATION_H
+
+#include "../util/containers/span.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+#include <cstdint>
+
+namespace zylann::voxel {
+
+class VoxelBuffer;
+class VoxelDataGrid;
+
+// Cellular simulation of blocky voxels, such as falling sand or flowing water. Each step, voxels whose model has a
+// simulation behavior move or spread into neighbor voxels.
+// Only voxels near recent changes are simulated ("active cells"). Most of them are stepped block by block, which can be
+// done in parallel. Cells on the border of blocks need to access neighbor blocks, so they are stepped afterwards.
+namespace blocky_simulation {
+
+enum Behavior : uint8_t {
+	// Voxels don't move
+	BEHAVIOR_NONE = 0,
+	// Voxels fall into replaceable voxels below them
+	BEHAVIOR_FALL,
+	// Voxels fall, and otherwise move sideways towards drops, or when voxels of the same type are above them
+	BEHAVIOR_FLOW,
+	// Voxels copy themselves below them, or next to them if they can't go down
+	BEHAVIOR_SPREAD,
+	BEHAVIOR_COUNT
+};
+
+// Simulation properties of each model, indexed by voxel type
+struct ModelProperties {
+	// Behavior enum values
+	StdVector<uint8_t> behaviors;
+	// 1 if simulated voxels can move into voxels of this type
+	StdVector<uint8_t> replaceable;
+
+	inline Behavior get_behavior(uint32_t type) const {
+		return type < behaviors.size() ? Behavior(behaviors[type]) : BEHAVIOR_NONE;
+	}
+
+	inline bool is_replaceable(uint32_t type) const {
+		return type < replaceable.size() && replaceable[type] != 0;
+	}
+
+	bool has_simulated_models() const;
+};
+
+struct BlockStepResult {
+	// Active cells touching the border of the block, in world coordinates. They were not stepped, and must be
+	// stepped afterwards with `step_cells`.
+	StdVector<Vector3i> border_cells;
+	// Voxels that changed, in world coordinates
+	StdVector<Vector3i> changed_cells;
+};
+
+// Finds voxels of simulated models in a box, grouped by block position. Positions are relative to their block, sorted
+// bottom to top. The grid must be locked for reading.
+void find_active_cells(
+		VoxelDataGrid &grid,
+		const ModelProperties &models,
+		Box3i voxel_box,
+		StdUnorderedMap<Vector3i, StdVector<Vector3i>> &out_cells_per_block
+);
+
+// Steps active cells of a single block. `cells` are relative to the block, sorted bottom to top.
+// Only voxels of that block are accessed, so blocks can be stepped in parallel.
+void step_block(
+		VoxelBuffer &voxels,
+		Vector3i block_origin,
+		Span<const Vector3i> cells,
+		const ModelProperties &models,
+		uint32_t step_index,
+		BlockStepResult &out_result
+);
+
+// Steps cells in world coordinates, which may access neighbor blocks. The grid must contain blocks at least one
+// voxel around the cells, and must be locked for writing. Voxels of missing blocks can't be moved into.
+void step_cells(
+		VoxelDataGrid &grid,
+		Span<const Vector3i> cells,
+		const ModelProperties &models,
+		uint32_t step_index,
+		StdVector<Vector3i> &out_changed_cells
+);
+
+// Sorts positions so lower voxels are stepped first, which lets columns of voxels fall together
+void sort_bottom_to_top(StdVector<Vector3i> &cells);
+
+} // namespace blocky_simulation
+} // namespace zylann::voxel
+
+#endif // VOXEL_BLOCKY_SIMULATION_H
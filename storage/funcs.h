@@ -99,20 +99,23 @@ void fill_3d_region_zxy(Span<T> dst, Vector3i dst_size, Vector3i dst_min, Vector
 	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(area_size) <= dst.size());
 #endif
 
+	// Raw pointers are used in inner loops, because bound checks would prevent vectorization
+	T *dst_data = dst.data();
+
 	if (area_size == dst_size) {
 		for (unsigned int i = 0; i < dst.size(); ++i) {
-			dst[i] = value;
+			dst_data[i] = value;
 		}
 
 	} else {
 		const unsigned int dst_row_offset = dst_size.y;
-		Vector3i pos;
-		for (pos.z = 0; pos.z < area_size.z; ++pos.z) {
-			unsigned int dst_ri = Vector3iUtil::get_zxy_index(dst_min + pos, dst_size);
-			for (pos.x = 0; pos.x < area_size.x; ++pos.x) {
+		for (int z = 0; z < area_size.z; ++z) {
+			unsigned int dst_ri = Vector3iUtil::get_zxy_index(dst_min + Vector3i(0, 0, z), dst_size);
+			for (int x = 0; x < area_size.x; ++x) {
 				// Fill row
-				for (pos.y = 0; pos.y < area_size.y; ++pos.y) {
-					dst[dst_ri + pos.y] = value;
+				T *row = dst_data + dst_ri;
+				for (int y = 0; y < area_size.y; ++y) {
+					row[y] = value;
 				}
 				dst_ri += dst_row_offset;
 			}
@@ -120,6 +123,137 @@ void fill_3d_region_zxy(Span<T> dst, Vector3i dst_size, Vector3i dst_min, Vector
 	}
 }
 
+// Nearest-neighbor downscaling of a region of a 3D array by a factor of 2.
+// Each voxel of the destination area takes the value found at `src_min + (pos - dst_min) * 2` in the source.
+// Both areas must be inside their arrays. Rows along Y are processed in one go, so the compiler can vectorize them.
+template <typename T>
+void downscale_3d_region_zxy(
+		Span<T> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		Vector3i dst_max,
+		Span<const T> src,
+		Vector3i src_size,
+		Vector3i src_min
+) {
+	const Vector3i area_size = dst_max - dst_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		return;
+	}
+	const Vector3i src_last = src_min + ((area_size - Vector3i(1, 1, 1)) << 1);
+	ZN_ASSERT_RETURN(src_min.x >= 0 && src_min.y >= 0 && src_min.z >= 0);
+	ZN_ASSERT_RETURN(src_last.x < src_size.x && src_last.y < src_size.y && src_last.z < src_size.z);
+	ZN_ASSERT_RETURN(dst_min.x >= 0 && dst_min.y >= 0 && dst_min.z >= 0);
+	ZN_ASSERT_RETURN(dst_max.x <= dst_size.x && dst_max.y <= dst_size.y && dst_max.z <= dst_size.z);
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(src_size) <= src.size());
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(dst_size) <= dst.size());
+
+	const T *src_data = src.data();
+	T *dst_data = dst.data();
+	for (int z = 0; z < area_size.z; ++z) {
+		for (int x = 0; x < area_size.x; ++x) {
+			const T *src_row = src_data + Vector3iUtil::get_zxy_index(src_min + Vector3i(2 * x, 0, 2 * z), src_size);
+			T *dst_row = dst_data + Vector3iUtil::get_zxy_index(dst_min + Vector3i(x, 0, z), dst_size);
+			for (int y = 0; y < area_size.y; ++y) {
+				dst_row[y] = src_row[2 * y];
+			}
+		}
+	}
+}
+
+// Gets the most common non-zero value among the given values. If several values are equally common, the first one
+// found is returned. Returns 0 if all values are 0.
+template <typename T>
+inline T get_most_common_non_zero(const T *values, const unsigned int count) {
+	T best_value = 0;
+	unsigned int best_count = 0;
+	for (unsigned int i = 0; i < count; ++i) {
+		const T v = values[i];
+		if (v == 0) {
+			continue;
+		}
+		// Only counting forward, so later occurrences of the same value can't win over the first one
+		unsigned int v_count = 1;
+		for (unsigned int j = i + 1; j < count; ++j) {
+			if (values[j] == v) {
+				++v_count;
+			}
+		}
+		if (v_count > best_count) {
+			best_value = v;
+			best_count = v_count;
+		}
+	}
+	return best_value;
+}
+
+// Downscaling of a region of a 3D array by a factor of 2, where each voxel of the destination area takes the most
+// common non-zero value among the 8 voxels it covers in the source, starting at `src_min + (pos - dst_min) * 2`.
+// Source values are first replaced with `replacements[value]` if they are within its size.
+// This is suited to values that can't be interpolated, like block types, where picking one voxel out of 8 would make
+// thin or sparse features flicker or disappear.
+template <typename T>
+void downscale_3d_region_zxy_majority(
+		Span<T> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		Vector3i dst_max,
+		Span<const T> src,
+		Vector3i src_size,
+		Vector3i src_min,
+		Span<const uint16_t> replacements
+) {
+	const Vector3i area_size = dst_max - dst_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		return;
+	}
+	const Vector3i src_last = src_min + ((area_size - Vector3i(1, 1, 1)) << 1);
+	ZN_ASSERT_RETURN(src_min.x >= 0 && src_min.y >= 0 && src_min.z >= 0);
+	ZN_ASSERT_RETURN(src_last.x < src_size.x && src_last.y < src_size.y && src_last.z < src_size.z);
+	ZN_ASSERT_RETURN(dst_min.x >= 0 && dst_min.y >= 0 && dst_min.z >= 0);
+	ZN_ASSERT_RETURN(dst_max.x <= dst_size.x && dst_max.y <= dst_size.y && dst_max.z <= dst_size.z);
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(src_size) <= src.size());
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(dst_size) <= dst.size());
+
+	const T *src_data = src.data();
+	T *dst_data = dst.data();
+	T values[8];
+
+	for (int z = 0; z < area_size.z; ++z) {
+		for (int x = 0; x < area_size.x; ++x) {
+			const Vector3i src_pos0 = src_min + Vector3i(2 * x, 0, 2 * z);
+			// The last row or column of the source may be cut off if its size is odd
+			const Vector3i src_pos1(
+					math::min(src_pos0.x + 1, src_size.x - 1), 0, math::min(src_pos0.z + 1, src_size.z - 1)
+			);
+			const T *src_row00 = src_data + Vector3iUtil::get_zxy_index(src_pos0, src_size);
+			const T *src_row10 = src_data + Vector3iUtil::get_zxy_index(Vector3i(src_pos1.x, 0, src_pos0.z), src_size);
+			const T *src_row01 = src_data + Vector3iUtil::get_zxy_index(Vector3i(src_pos0.x, 0, src_pos1.z), src_size);
+			const T *src_row11 = src_data + Vector3iUtil::get_zxy_index(src_pos1, src_size);
+			T *dst_row = dst_data + Vector3iUtil::get_zxy_index(dst_min + Vector3i(x, 0, z), dst_size);
+
+			for (int y = 0; y < area_size.y; ++y) {
+				const int y0 = src_min.y + 2 * y;
+				const int y1 = math::min(y0 + 1, src_size.y - 1);
+				values[0] = src_row00[y0];
+				values[1] = src_row00[y1];
+				values[2] = src_row10[y0];
+				values[3] = src_row10[y1];
+				values[4] = src_row01[y0];
+				values[5] = src_row01[y1];
+				values[6] = src_row11[y0];
+				values[7] = src_row11[y1];
+				for (T &v : values) {
+					if (v < replacements.size()) {
+						v = replacements[v];
+					}
+				}
+				dst_row[y] = get_most_common_non_zero(values, 8);
+			}
+		}
+	}
+}
+
 // https://www.khronos.org/registry/vulkan/specs/1.1-extensions/html/vkspec.html#fundamentals-fixedconv
 // Converts an int8 value into a float in the range [-1..1], which includes an exact value for 0.
 // -128 is one value of the int8 which will not have a corresponding result, it will be clamped to -1.
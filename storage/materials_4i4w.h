@@ -11,19 +11,36 @@ namespace zylann::voxel {
 
 class VoxelBuffer;
 
+// Spreads the 4 nibbles of a 16-bit value into the 4 bytes of a 32-bit value, lowest first. This works on all 4
+// components at once within a regular integer register, and loops doing it are easily vectorized by compilers.
+inline constexpr uint32_t spread_nibbles_to_bytes(uint16_t packed) {
+	uint32_t v = packed;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	return v;
+}
+
+inline FixedArray<uint8_t, 4> unpack_bytes(uint32_t v) {
+	FixedArray<uint8_t, 4> a;
+	a[0] = v & 0xff;
+	a[1] = (v >> 8) & 0xff;
+	a[2] = (v >> 16) & 0xff;
+	a[3] = v >> 24;
+	return a;
+}
+
+// Same as `decode_weights_from_packed_u16`, but returns weights packed in bytes of a 32-bit value, lowest first
+inline constexpr uint32_t decode_weights_from_packed_u16_to_u32(uint16_t packed_weights) {
+	return spread_nibbles_to_bytes(packed_weights) << 4;
+}
+
+// Same as `decode_indices_from_packed_u16`, but returns indices packed in bytes of a 32-bit value, lowest first
+inline constexpr uint32_t decode_indices_from_packed_u16_to_u32(uint16_t packed_indices) {
+	return spread_nibbles_to_bytes(packed_indices);
+}
+
 inline FixedArray<uint8_t, 4> decode_weights_from_packed_u16(uint16_t packed_weights) {
-	FixedArray<uint8_t, 4> weights;
-	// SIMDable?
-	// weights[0] = ((packed_weights >> 0) & 0x0f) << 4;
-	// weights[1] = ((packed_weights >> 4) & 0x0f) << 4;
-	// weights[2] = ((packed_weights >> 8) & 0x0f) << 4;
-	// weights[3] = ((packed_weights >> 12) & 0x0f) << 4;
-
-	// Reduced but not SIMDable
-	weights[0] = (packed_weights & 0x0f) << 4;
-	weights[1] = packed_weights & 0xf0;
-	weights[2] = (packed_weights >> 4) & 0xf0;
-	weights[3] = (packed_weights >> 8) & 0xf0;
+	const FixedArray<uint8_t, 4> weights = unpack_bytes(decode_weights_from_packed_u16_to_u32(packed_weights));
 	// The code above is such that the maximum uint8_t value for a weight is 240, not 255.
 	// We could add extra computations in order to match the range exactly,
 	// but as a compromise I'm not doing them because it would kinda break bijectivity and is slower.
@@ -36,13 +53,37 @@ inline FixedArray<uint8_t, 4> decode_weights_from_packed_u16(uint16_t packed_wei
 }
 
 inline FixedArray<uint8_t, 4> decode_indices_from_packed_u16(uint16_t packed_indices) {
-	FixedArray<uint8_t, 4> indices;
-	// SIMDable?
-	indices[0] = (packed_indices >> 0) & 0x0f;
-	indices[1] = (packed_indices >> 4) & 0x0f;
-	indices[2] = (packed_indices >> 8) & 0x0f;
-	indices[3] = (packed_indices >> 12) & 0x0f;
-	return indices;
+	return unpack_bytes(decode_indices_from_packed_u16_to_u32(packed_indices));
+}
+
+// Returns the position of `texture_index` in packed indices, or 4 if it is not present.
+inline unsigned int find_index_in_packed_u16(uint16_t packed_indices, unsigned int texture_index) {
+	// Nibbles equal to the texture index become zero
+	const uint32_t x = packed_indices ^ ((texture_index & 0xf) * 0x1111);
+	if ((x & 0x000f) == 0) {
+		return 0;
+	}
+	if ((x & 0x00f0) == 0) {
+		return 1;
+	}
+	if ((x & 0x0f00) == 0) {
+		return 2;
+	}
+	if ((x & 0xf000) == 0) {
+		return 3;
+	}
+	return 4;
+}
+
+// Tells if the 4 packed indices are all different from each other
+inline bool are_packed_u16_indices_distinct(uint16_t packed_indices) {
+	// XORing with rotations of the value gives a zero nibble for each pair of equal indices. Rotating by 4 bits
+	// compares pairs (0,1), (1,2), (2,3), (3,0), and rotating by 8 bits compares (0,2), (1,3) in its lower 8 bits.
+	const uint32_t v = packed_indices;
+	const uint32_t x4 = v ^ (((v >> 4) | (v << 12)) & 0xffff);
+	const uint32_t x8 = v ^ (((v >> 8) | (v << 8)) & 0xffff);
+	return (x4 & 0x000f) != 0 && (x4 & 0x00f0) != 0 && (x4 & 0x0f00) != 0 && (x4 & 0xf000) != 0 &&
+			(x8 & 0x000f) != 0 && (x8 & 0x00f0) != 0;
 }
 
 inline constexpr uint16_t encode_indices_to_packed_u16(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
@@ -127,19 +168,18 @@ inline void blend_texture_packed_u16(
 	ZN_ASSERT_RETURN(target_weight >= 0.f && target_weight <= 1.f);
 #endif
 
-	FixedArray<uint8_t, 4> indices = decode_indices_from_packed_u16(encoded_indices);
+	// Search if our texture index is already present
+	unsigned int component_index = find_index_in_packed_u16(encoded_indices, texture_index);
+
 	FixedArray<uint8_t, 4> weights = decode_weights_from_packed_u16(encoded_weights);
 
-	// Search if our texture index is already present
-	unsigned int component_index = 4;
-	for (unsigned int i = 0; i < indices.size(); ++i) {
-		if (indices[i] == texture_index) {
-			component_index = i;
-			break;
-		}
+	if (component_index < 4 && weights[component_index] / 255.f >= target_weight) {
+		// Already present with enough weight, nothing to change
+		return;
 	}
 
-	bool index_was_changed = false;
+	FixedArray<uint8_t, 4> indices = decode_indices_from_packed_u16(encoded_indices);
+
 	if (component_index >= indices.size()) {
 		// Our texture index is not present, we'll replace the lowest weight
 		uint8_t lowest_weight = 255;
@@ -152,28 +192,30 @@ inline void blend_texture_packed_u16(
 			}
 		}
 		indices[component_index] = texture_index;
-		index_was_changed = true;
 	}
 
-	// TODO Optimization in case target_weight is 1?
+	encoded_indices = encode_indices_to_packed_u16(indices[0], indices[1], indices[2], indices[3]);
+
+	if (target_weight >= 1.f) {
+		// Normalizing would set all other weights to zero. Common in the middle of brushes.
+		encoded_weights = 0xf << (component_index * 4);
+		return;
+	}
 
 	FixedArray<float, 4> weights_f;
 	for (unsigned int i = 0; i < weights.size(); ++i) {
 		weights_f[i] = weights[i] / 255.f;
 	}
 
-	if (weights_f[component_index] < target_weight || index_was_changed) {
-		weights_f[component_index] = target_weight;
+	weights_f[component_index] = target_weight;
 
-		normalize_weights_preserving(weights_f, component_index);
+	normalize_weights_preserving(weights_f, component_index);
 
-		for (unsigned int i = 0; i < weights_f.size(); ++i) {
-			weights[i] = math::clamp(weights_f[i] * 255.f, 0.f, 255.f);
-		}
-
-		encoded_indices = encode_indices_to_packed_u16(indices[0], indices[1], indices[2], indices[3]);
-		encoded_weights = encode_weights_to_packed_u16_lossy(weights[0], weights[1], weights[2], weights[3]);
+	for (unsigned int i = 0; i < weights_f.size(); ++i) {
+		weights[i] = math::clamp(weights_f[i] * 255.f, 0.f, 255.f);
 	}
+
+	encoded_weights = encode_weights_to_packed_u16_lossy(weights[0], weights[1], weights[2], weights[3]);
 }
 
 void debug_check_texture_indices_packed_u16(const VoxelBuffer &voxels);
@@ -0,0 +1,60 @@
+#include "voxel_sparse_values.h"
+#include "../../util/errors.h"
+#include <algorithm>
+
+namespace zylann::voxel {
+
+bool VoxelSparseValues::get(uint32_t key, uint32_t &out_value) const {
+	auto it = std::lower_bound(_keys.begin(), _keys.end(), key);
+	if (it == _keys.end() || *it != key) {
+		return false;
+	}
+	out_value = _values[it - _keys.begin()];
+	return true;
+}
+
+void VoxelSparseValues::set(uint32_t key, uint32_t value) {
+	// Appending in increasing order is the common case when copying or loading
+	if (_keys.size() == 0 || _keys.back() < key) {
+		_keys.push_back(key);
+		_values.push_back(value);
+		return;
+	}
+	auto it = std::lower_bound(_keys.begin(), _keys.end(), key);
+	const size_t i = it - _keys.begin();
+	if (it != _keys.end() && *it == key) {
+		_values[i] = value;
+		return;
+	}
+	_keys.insert(it, key);
+	_values.insert(_values.begin() + i, value);
+}
+
+bool VoxelSparseValues::erase(uint32_t key) {
+	auto it = std::lower_bound(_keys.begin(), _keys.end(), key);
+	if (it == _keys.end() || *it != key) {
+		return false;
+	}
+	const size_t i = it - _keys.begin();
+	_keys.erase(it);
+	_values.erase(_values.begin() + i);
+	return true;
+}
+
+void VoxelSparseValues::clear() {
+	_keys.clear();
+	_values.clear();
+}
+
+void VoxelSparseValues::clear_and_set(Span<const uint32_t> keys, Span<const uint32_t> values) {
+	ZN_ASSERT_RETURN(keys.size() == values.size());
+#ifdef DEBUG_ENABLED
+	for (unsigned int i = 1; i < keys.size(); ++i) {
+		ZN_ASSERT_RETURN(keys[i - 1] < keys[i]);
+	}
+#endif
+	_keys.assign(keys.data(), keys.data() + keys.size());
+	_values.assign(values.data(), values.data() + values.size());
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,64 @@
+#ifndef VOXEL_SPARSE_VALUES_H
+#define VOXEL_SPARSE_VALUES_H
+
+#include "../../util/containers/span.h"
+#include "../../util/containers/std_vector.h"
+#include <cstdint>
+
+namespace zylann::voxel {
+
+// Compact alternative to voxel metadata, for small integer values attached to many voxels (ownership, damage...).
+// An entry takes 8 bytes, while a `VoxelMetadata` entry takes about 32, plus an allocation for custom types.
+// Keys and values are stored in separate arrays, with keys sorted so they can be found with a binary search.
+class VoxelSparseValues {
+public:
+	bool get(uint32_t key, uint32_t &out_value) const;
+	void set(uint32_t key, uint32_t value);
+	bool erase(uint32_t key);
+	void clear();
+
+	// Keys must be unique and in increasing order.
+	void clear_and_set(Span<const uint32_t> keys, Span<const uint32_t> values);
+
+	template <typename F>
+	void remove_if(F predicate) {
+		unsigned int dst = 0;
+		for (unsigned int src = 0; src < _keys.size(); ++src) {
+			if (!predicate(_keys[src], _values[src])) {
+				_keys[dst] = _keys[src];
+				_values[dst] = _values[src];
+				++dst;
+			}
+		}
+		_keys.resize(dst);
+		_values.resize(dst);
+	}
+
+	inline unsigned int size() const {
+		return _keys.size();
+	}
+
+	inline Span<const uint32_t> get_keys() const {
+		return to_span(_keys);
+	}
+
+	inline Span<const uint32_t> get_values() const {
+		return to_span(_values);
+	}
+
+	inline size_t get_memory_usage() const {
+		return (_keys.capacity() + _values.capacity()) * sizeof(uint32_t);
+	}
+
+	bool operator==(const VoxelSparseValues &other) const {
+		return _keys == other._keys && _values == other._values;
+	}
+
+private:
+	StdVector<uint32_t> _keys;
+	StdVector<uint32_t> _values;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_SPARSE_VALUES_H
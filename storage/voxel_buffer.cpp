@@ -37,6 +37,52 @@ inline void free_channel_data(uint8_t *data, uint32_t size, VoxelBuffer::Allocat
 	}
 }
 
+struct VoxelBuffer::SharedChannelData {
+	std::atomic_uint32_t refcount;
+	// Allocator the data comes from, which is not necessarily the one of the buffers sharing it
+	VoxelBuffer::Allocator allocator;
+};
+
+// Gets a new reference to the data of a channel, so another buffer can use it without copying.
+// `allocator` is the one of the buffer owning the channel.
+VoxelBuffer::SharedChannelData *acquire_channel_data(
+		const VoxelBuffer::Channel &channel,
+		VoxelBuffer::Allocator allocator
+) {
+	VoxelBuffer::SharedChannelData *shared = channel.shared.load(std::memory_order_acquire);
+	if (shared == nullptr) {
+		VoxelBuffer::SharedChannelData *new_shared = ZN_NEW(VoxelBuffer::SharedChannelData);
+		// The reference of the buffer owning the channel
+		new_shared->refcount.store(1, std::memory_order_relaxed);
+		new_shared->allocator = allocator;
+		if (channel.shared.compare_exchange_strong(
+					shared, new_shared, std::memory_order_acq_rel, std::memory_order_acquire
+			)) {
+			shared = new_shared;
+		} else {
+			// Another thread copied the channel at the same time
+			ZN_DELETE(new_shared);
+		}
+	}
+	shared->refcount.fetch_add(1, std::memory_order_relaxed);
+	return shared;
+}
+
+// Frees the data of a channel, unless other buffers still use it
+void release_channel_data(VoxelBuffer::Channel &channel, VoxelBuffer::Allocator allocator) {
+	VoxelBuffer::SharedChannelData *shared = channel.shared.load(std::memory_order_relaxed);
+	if (shared == nullptr) {
+		free_channel_data(channel.data, channel.size_in_bytes, allocator);
+		return;
+	}
+	channel.shared.store(nullptr, std::memory_order_relaxed);
+	const VoxelBuffer::Allocator shared_allocator = shared->allocator;
+	if (shared->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		free_channel_data(channel.data, channel.size_in_bytes, shared_allocator);
+		ZN_DELETE(shared);
+	}
+}
+
 // uint64_t g_depth_max_values[] = {
 // 	0xff, // 8
 // 	0xffff, // 16
@@ -70,13 +116,14 @@ union MarshallDouble {
 	uint64_t l;
 };
 
-inline uint64_t real_to_raw_voxel(real_t value, VoxelBuffer::Depth depth) {
+// `factor` is applied on top of the quantization scale of depths below 32 bits, see `set_sdf_quantization_factor`
+inline uint64_t real_to_raw_voxel(real_t value, VoxelBuffer::Depth depth, float factor) {
 	switch (depth) {
 		case VoxelBuffer::DEPTH_8_BIT:
-			return snorm_to_s8(value * constants::QUANTIZED_SDF_8_BITS_SCALE);
+			return snorm_to_s8(value * (constants::QUANTIZED_SDF_8_BITS_SCALE * factor));
 
 		case VoxelBuffer::DEPTH_16_BIT:
-			return snorm_to_s16(value * constants::QUANTIZED_SDF_16_BITS_SCALE);
+			return snorm_to_s16(value * (constants::QUANTIZED_SDF_16_BITS_SCALE * factor));
 
 		case VoxelBuffer::DEPTH_32_BIT: {
 			MarshallFloat m;
@@ -94,14 +141,14 @@ inline uint64_t real_to_raw_voxel(real_t value, VoxelBuffer::Depth depth) {
 	}
 }
 
-inline real_t raw_voxel_to_real(uint64_t value, VoxelBuffer::Depth depth) {
+inline real_t raw_voxel_to_real(uint64_t value, VoxelBuffer::Depth depth, float factor) {
 	// Depths below 32 are normalized between -1 and 1
 	switch (depth) {
 		case VoxelBuffer::DEPTH_8_BIT:
-			return s8_to_snorm(value) * constants::QUANTIZED_SDF_8_BITS_SCALE_INV;
+			return s8_to_snorm(value) * (constants::QUANTIZED_SDF_8_BITS_SCALE_INV / factor);
 
 		case VoxelBuffer::DEPTH_16_BIT:
-			return s16_to_snorm(value) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
+			return s16_to_snorm(value) * (constants::QUANTIZED_SDF_16_BITS_SCALE_INV / factor);
 
 		case VoxelBuffer::DEPTH_32_BIT: {
 			MarshallFloat m;
@@ -121,6 +168,334 @@ inline real_t raw_voxel_to_real(uint64_t value, VoxelBuffer::Depth depth) {
 	}
 }
 
+inline real_t raw_voxel_to_unscaled_real(uint64_t value, VoxelBuffer::Depth depth) {
+	// Same as `raw_voxel_to_real`, without applying quantization scale
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			return s8_to_snorm(value);
+
+		case VoxelBuffer::DEPTH_16_BIT:
+			return s16_to_snorm(value);
+
+		default:
+			return raw_voxel_to_real(value, depth, 1.f);
+	}
+}
+
+namespace {
+
+// Palette compression helpers
+
+inline uint64_t read_raw_value(const uint8_t *data, size_t i, VoxelBuffer::Depth depth) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			return data[i];
+		case VoxelBuffer::DEPTH_16_BIT:
+			return reinterpret_cast<const uint16_t *>(data)[i];
+		case VoxelBuffer::DEPTH_32_BIT:
+			return reinterpret_cast<const uint32_t *>(data)[i];
+		case VoxelBuffer::DEPTH_64_BIT:
+			return reinterpret_cast<const uint64_t *>(data)[i];
+		default:
+			ZN_CRASH();
+			return 0;
+	}
+}
+
+inline void write_raw_value(uint8_t *data, size_t i, VoxelBuffer::Depth depth, uint64_t value) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			data[i] = value;
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			reinterpret_cast<uint16_t *>(data)[i] = value;
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			reinterpret_cast<uint32_t *>(data)[i] = value;
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			reinterpret_cast<uint64_t *>(data)[i] = value;
+			break;
+		default:
+			ZN_CRASH();
+			break;
+	}
+}
+
+inline unsigned int get_palette_capacity(unsigned int index_bits) {
+	return 1 << index_bits;
+}
+
+inline size_t get_palette_entries_size_in_bytes(unsigned int index_bits, VoxelBuffer::Depth depth) {
+	return get_palette_capacity(index_bits) * VoxelBuffer::get_depth_byte_count(depth);
+}
+
+inline uint8_t *get_palette_indices(const VoxelBuffer::Channel &channel) {
+	return channel.data + get_palette_entries_size_in_bytes(channel.palette_index_bits, channel.depth);
+}
+
+inline uint64_t get_palette_voxel(const VoxelBuffer::Channel &channel, size_t i) {
+	const unsigned int palette_index = VoxelBuffer::get_packed_palette_index(
+			get_palette_indices(channel), i, channel.palette_index_bits
+	);
+	return read_raw_value(channel.data, palette_index, channel.depth);
+}
+
+inline void set_packed_palette_index(uint8_t *indices, size_t i, unsigned int index_bits, unsigned int index) {
+	const size_t bit_pos = i * index_bits;
+	const unsigned int shift = bit_pos & 7;
+	const unsigned int mask = ((1 << index_bits) - 1) << shift;
+	uint8_t &b = indices[bit_pos >> 3];
+	b = (b & ~mask) | ((index << shift) & mask);
+}
+
+// Finds the smallest supported index bit count able to address the given amount of palette entries
+inline unsigned int get_palette_index_bits_for_size(unsigned int palette_size) {
+	unsigned int bits = 1;
+	while (get_palette_capacity(bits) < palette_size) {
+		bits <<= 1;
+	}
+	return bits;
+}
+
+void copy_palette_region_to_dense(
+		Span<uint8_t> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		const VoxelBuffer::Channel &src_channel,
+		Vector3i src_size,
+		Vector3i src_min,
+		Vector3i src_max
+) {
+	Vector3iUtil::sort_min_max(src_min, src_max);
+	clip_copy_region(src_min, src_max, src_size, dst_min, dst_size);
+	const Vector3i area_size = src_max - src_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		// Degenerate area, we'll not copy anything.
+		return;
+	}
+
+	const VoxelBuffer::Depth depth = src_channel.depth;
+#ifdef DEBUG_ENABLED
+	ZN_ASSERT_RETURN(
+			Vector3iUtil::get_volume(dst_size) * VoxelBuffer::get_depth_byte_count(depth) <= int64_t(dst.size())
+	);
+#endif
+
+	// Decode the palette once, indices are then resolved with a lookup
+	FixedArray<uint64_t, VoxelBuffer::MAX_PALETTE_SIZE> palette;
+	const unsigned int capacity = get_palette_capacity(src_channel.palette_index_bits);
+	for (unsigned int i = 0; i < capacity; ++i) {
+		palette[i] = read_raw_value(src_channel.data, i, depth);
+	}
+	const uint8_t *indices = get_palette_indices(src_channel);
+	const unsigned int index_bits = src_channel.palette_index_bits;
+
+	Vector3i pos;
+	for (pos.z = 0; pos.z < area_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < area_size.x; ++pos.x) {
+			const size_t src_ri = Vector3iUtil::get_zxy_index(src_min + pos, src_size);
+			const size_t dst_ri = Vector3iUtil::get_zxy_index(dst_min + pos, dst_size);
+			for (int y = 0; y < area_size.y; ++y) {
+				const unsigned int pi = VoxelBuffer::get_packed_palette_index(indices, src_ri + y, index_bits);
+				write_raw_value(dst.data(), dst_ri + y, depth, palette[pi]);
+			}
+		}
+	}
+}
+
+// Brick compression helpers
+
+inline size_t align_to_8_bytes(size_t s) {
+	return (s + 7) & ~size_t(7);
+}
+
+struct BrickLayout {
+	Vector3i grid_size;
+	unsigned int brick_count;
+	int brick_size_po2;
+	size_t dense_brick_size_in_bytes;
+	size_t values_offset;
+	size_t dense_bricks_offset;
+};
+
+inline BrickLayout get_brick_layout(Vector3i size, unsigned int brick_size_po2, VoxelBuffer::Depth depth) {
+	const unsigned int item_size = VoxelBuffer::get_depth_byte_count(depth);
+	BrickLayout layout;
+	layout.grid_size = VoxelBuffer::get_brick_grid_size(size, brick_size_po2);
+	layout.brick_count = Vector3iUtil::get_volume(layout.grid_size);
+	layout.brick_size_po2 = brick_size_po2;
+	layout.dense_brick_size_in_bytes = (size_t(1) << (3 * brick_size_po2)) * item_size;
+	layout.values_offset = align_to_8_bytes(layout.brick_count * sizeof(uint16_t));
+	layout.dense_bricks_offset = align_to_8_bytes(layout.values_offset + layout.brick_count * item_size);
+	return layout;
+}
+
+inline BrickLayout get_brick_layout(const VoxelBuffer::Channel &channel, Vector3i size) {
+	return get_brick_layout(size, channel.brick_size_po2, channel.depth);
+}
+
+inline size_t get_bricks_size_in_bytes(const BrickLayout &layout, unsigned int dense_brick_count) {
+	return layout.dense_bricks_offset + dense_brick_count * layout.dense_brick_size_in_bytes;
+}
+
+inline unsigned int get_dense_brick_count(const VoxelBuffer::Channel &channel, const BrickLayout &layout) {
+	return (channel.size_in_bytes - layout.dense_bricks_offset) / layout.dense_brick_size_in_bytes;
+}
+
+inline uint16_t *get_brick_slots(const VoxelBuffer::Channel &channel) {
+	return reinterpret_cast<uint16_t *>(channel.data);
+}
+
+inline uint8_t *get_dense_brick(const VoxelBuffer::Channel &channel, const BrickLayout &layout, unsigned int slot) {
+	return channel.data + layout.dense_bricks_offset + slot * layout.dense_brick_size_in_bytes;
+}
+
+inline size_t get_index_in_brick(Vector3i local_pos, unsigned int brick_size_po2) {
+	// ZXY
+	return local_pos.y + ((local_pos.x + (local_pos.z << brick_size_po2)) << brick_size_po2);
+}
+
+inline uint64_t get_brick_voxel(const VoxelBuffer::Channel &channel, const BrickLayout &layout, Vector3i pos) {
+	const Vector3i brick_pos = pos >> layout.brick_size_po2;
+	const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+	const uint16_t slot = get_brick_slots(channel)[brick_index];
+	if (slot == VoxelBuffer::BRICK_UNIFORM) {
+		return read_raw_value(channel.data + layout.values_offset, brick_index, channel.depth);
+	}
+	const size_t i = get_index_in_brick(pos - (brick_pos << layout.brick_size_po2), layout.brick_size_po2);
+	return read_raw_value(get_dense_brick(channel, layout, slot), i, channel.depth);
+}
+
+// Calls `f(raw_value)` once for each uniform brick, and for each voxel of dense bricks that is inside the buffer.
+// Stops and returns false as soon as `f` returns false.
+template <typename F>
+bool for_each_brick_value(const VoxelBuffer::Channel &channel, Vector3i size, F f) {
+	const BrickLayout layout = get_brick_layout(channel, size);
+	const uint16_t *slots = get_brick_slots(channel);
+	const int po2 = layout.brick_size_po2;
+
+	Vector3i brick_pos;
+	for (brick_pos.z = 0; brick_pos.z < layout.grid_size.z; ++brick_pos.z) {
+		for (brick_pos.x = 0; brick_pos.x < layout.grid_size.x; ++brick_pos.x) {
+			for (brick_pos.y = 0; brick_pos.y < layout.grid_size.y; ++brick_pos.y) {
+				const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+				const uint16_t slot = slots[brick_index];
+
+				if (slot == VoxelBuffer::BRICK_UNIFORM) {
+					if (!f(read_raw_value(channel.data + layout.values_offset, brick_index, channel.depth))) {
+						return false;
+					}
+					continue;
+				}
+
+				// Only look at the part of the brick that is inside the buffer
+				const uint8_t *brick_data = get_dense_brick(channel, layout, slot);
+				const Vector3i local_max = math::min(Vector3iUtil::create(1 << po2), size - (brick_pos << po2));
+				Vector3i local_pos;
+				for (local_pos.z = 0; local_pos.z < local_max.z; ++local_pos.z) {
+					for (local_pos.x = 0; local_pos.x < local_max.x; ++local_pos.x) {
+						for (local_pos.y = 0; local_pos.y < local_max.y; ++local_pos.y) {
+							if (!f(read_raw_value(brick_data, get_index_in_brick(local_pos, po2), channel.depth))) {
+								return false;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void fill_raw_region_zxy(
+		Span<uint8_t> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		Vector3i area_size,
+		VoxelBuffer::Depth depth,
+		uint64_t value
+) {
+	Vector3i pos;
+	for (pos.z = 0; pos.z < area_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < area_size.x; ++pos.x) {
+			const size_t dst_ri = Vector3iUtil::get_zxy_index(dst_min + pos, dst_size);
+			for (int y = 0; y < area_size.y; ++y) {
+				write_raw_value(dst.data(), dst_ri + y, depth, value);
+			}
+		}
+	}
+}
+
+void copy_brick_region_to_dense(
+		Span<uint8_t> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		const VoxelBuffer::Channel &src_channel,
+		Vector3i src_size,
+		Vector3i src_min,
+		Vector3i src_max
+) {
+	Vector3iUtil::sort_min_max(src_min, src_max);
+	clip_copy_region(src_min, src_max, src_size, dst_min, dst_size);
+	const Vector3i area_size = src_max - src_min;
+	if (area_size.x <= 0 || area_size.y <= 0 || area_size.z <= 0) {
+		// Degenerate area, we'll not copy anything.
+		return;
+	}
+
+	const VoxelBuffer::Depth depth = src_channel.depth;
+	const unsigned int item_size = VoxelBuffer::get_depth_byte_count(depth);
+#ifdef DEBUG_ENABLED
+	ZN_ASSERT_RETURN(Vector3iUtil::get_volume(dst_size) * item_size <= int64_t(dst.size()));
+#endif
+
+	const BrickLayout layout = get_brick_layout(src_channel, src_size);
+	const int po2 = layout.brick_size_po2;
+	const Vector3i brick_size = Vector3iUtil::create(1 << po2);
+	const uint16_t *slots = get_brick_slots(src_channel);
+
+	const Vector3i min_brick_pos = src_min >> po2;
+	const Vector3i max_brick_pos = ((src_max - Vector3i(1, 1, 1)) >> po2) + Vector3i(1, 1, 1);
+
+	// Copy brick by brick, so uniform bricks are just fills
+	Vector3i brick_pos;
+	for (brick_pos.z = min_brick_pos.z; brick_pos.z < max_brick_pos.z; ++brick_pos.z) {
+		for (brick_pos.x = min_brick_pos.x; brick_pos.x < max_brick_pos.x; ++brick_pos.x) {
+			for (brick_pos.y = min_brick_pos.y; brick_pos.y < max_brick_pos.y; ++brick_pos.y) {
+				const Vector3i brick_origin = brick_pos << po2;
+				const Vector3i area_min = math::max(src_min, brick_origin);
+				const Vector3i area_max = math::min(src_max, brick_origin + brick_size);
+				const Vector3i brick_dst_min = dst_min + (area_min - src_min);
+
+				const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+				const uint16_t slot = slots[brick_index];
+
+				if (slot == VoxelBuffer::BRICK_UNIFORM) {
+					const uint64_t v = read_raw_value(src_channel.data + layout.values_offset, brick_index, depth);
+					fill_raw_region_zxy(dst, dst_size, brick_dst_min, area_max - area_min, depth, v);
+				} else {
+					Span<const uint8_t> brick_data(
+							get_dense_brick(src_channel, layout, slot), layout.dense_brick_size_in_bytes
+					);
+					copy_3d_region_zxy(
+							dst,
+							dst_size,
+							brick_dst_min,
+							brick_data,
+							brick_size,
+							area_min - brick_origin,
+							area_max - brick_origin,
+							item_size
+					);
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+
 namespace {
 const uint64_t g_default_values[VoxelBuffer::MAX_CHANNELS] = {
 	0, // TYPE
@@ -250,7 +625,9 @@ void VoxelBuffer::clear_channel(Channel &channel, uint64_t clear_value, Allocato
 void VoxelBuffer::clear_channel_f(unsigned int channel_index, real_t clear_value) {
 	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
 	const Channel &channel = _channels[channel_index];
-	clear_channel(channel_index, real_to_raw_voxel(clear_value, channel.depth));
+	clear_channel(
+			channel_index, real_to_raw_voxel(clear_value, channel.depth, get_quantization_factor(channel_index))
+	);
 }
 
 void VoxelBuffer::set_default_values(FixedArray<uint64_t, VoxelBuffer::MAX_CHANNELS> values) {
@@ -268,6 +645,12 @@ uint64_t VoxelBuffer::get_voxel(int x, int y, int z, unsigned int channel_index)
 	if (channel.compression == COMPRESSION_UNIFORM) {
 		return channel.defval;
 
+	} else if (channel.compression == COMPRESSION_PALETTE) {
+		return get_palette_voxel(channel, get_index(x, y, z));
+
+	} else if (channel.compression == COMPRESSION_BRICKS) {
+		return get_brick_voxel(channel, get_brick_layout(channel, _size), Vector3i(x, y, z));
+
 	} else {
 #ifdef DEV_ENABLED
 		ZN_ASSERT(channel.data != nullptr);
@@ -301,6 +684,10 @@ void VoxelBuffer::set_voxel(uint64_t value, int x, int y, int z, unsigned int ch
 
 	Channel &channel = _channels[channel_index];
 
+	if (channel.compression != COMPRESSION_UNIFORM) {
+		make_channel_data_unique(channel);
+	}
+
 	bool do_set = true;
 
 	if (channel.compression == COMPRESSION_UNIFORM) {
@@ -310,6 +697,40 @@ void VoxelBuffer::set_voxel(uint64_t value, int x, int y, int z, unsigned int ch
 		} else {
 			do_set = false;
 		}
+
+	} else if (channel.compression == COMPRESSION_PALETTE) {
+		unsigned int palette_index;
+		if (get_or_add_palette_index(channel, value, palette_index)) {
+			set_packed_palette_index(
+					get_palette_indices(channel), get_index(x, y, z), channel.palette_index_bits, palette_index
+			);
+			return;
+		}
+		// Too many different values, fallback on dense storage
+		ZN_ASSERT_RETURN(decompress_palette_channel(channel));
+
+	} else if (channel.compression == COMPRESSION_BRICKS) {
+		const BrickLayout layout = get_brick_layout(channel, _size);
+		const Vector3i pos(x, y, z);
+		const Vector3i brick_pos = pos >> layout.brick_size_po2;
+		const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+
+		bool is_dense = get_brick_slots(channel)[brick_index] != BRICK_UNIFORM;
+		if (!is_dense) {
+			if (read_raw_value(channel.data + layout.values_offset, brick_index, channel.depth) == value) {
+				return;
+			}
+			is_dense = add_dense_brick(channel, brick_index);
+		}
+
+		if (is_dense) {
+			const uint16_t slot = get_brick_slots(channel)[brick_index];
+			const size_t i = get_index_in_brick(pos - (brick_pos << layout.brick_size_po2), layout.brick_size_po2);
+			write_raw_value(get_dense_brick(channel, layout, slot), i, channel.depth, value);
+			return;
+		}
+		// Too many dense bricks, fallback on dense storage
+		ZN_ASSERT_RETURN(decompress_brick_channel(channel));
 	}
 
 	if (do_set) {
@@ -348,12 +769,22 @@ void VoxelBuffer::set_voxel(uint64_t value, int x, int y, int z, unsigned int ch
 
 real_t VoxelBuffer::get_voxel_f(int x, int y, int z, unsigned int channel_index) const {
 	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
-	return raw_voxel_to_real(get_voxel(x, y, z, channel_index), _channels[channel_index].depth);
+	return raw_voxel_to_real(
+			get_voxel(x, y, z, channel_index),
+			_channels[channel_index].depth,
+			get_quantization_factor(channel_index)
+	);
 }
 
 void VoxelBuffer::set_voxel_f(real_t value, int x, int y, int z, unsigned int channel_index) {
 	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
-	set_voxel(real_to_raw_voxel(value, _channels[channel_index].depth), x, y, z, channel_index);
+	set_voxel(
+			real_to_raw_voxel(value, _channels[channel_index].depth, get_quantization_factor(channel_index)),
+			x,
+			y,
+			z,
+			channel_index
+	);
 }
 
 void VoxelBuffer::fill(uint64_t defval, unsigned int channel_index) {
@@ -372,6 +803,19 @@ void VoxelBuffer::fill(uint64_t defval, unsigned int channel_index) {
 		return;
 	}
 
+	if (channel.compression == COMPRESSION_PALETTE || channel.compression == COMPRESSION_BRICKS) {
+		// The whole channel becomes the same value
+		clear_channel(channel, defval, _allocator);
+		return;
+	}
+
+	if (channel.shared.load(std::memory_order_relaxed) != nullptr) {
+		// No need to copy shared data since all of it will be overwritten
+		release_channel_data(channel, _allocator);
+		channel.data = allocate_channel_data(channel.size_in_bytes, _allocator);
+		ZN_ASSERT_RETURN(channel.data != nullptr); // Bad alloc?
+	}
+
 	const size_t volume = get_volume();
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT(channel.size_in_bytes == get_size_in_bytes_for_volume(_size, channel.depth));
@@ -421,6 +865,12 @@ void VoxelBuffer::fill_area(uint64_t defval, Vector3i min, Vector3i max, unsigne
 		return;
 	}
 
+	if (area_size == _size) {
+		// The whole channel becomes uniform, no need to decompress it
+		fill(defval, channel_index);
+		return;
+	}
+
 	Channel &channel = _channels[channel_index];
 
 	if (channel.compression == COMPRESSION_UNIFORM) {
@@ -429,61 +879,73 @@ void VoxelBuffer::fill_area(uint64_t defval, Vector3i min, Vector3i max, unsigne
 		} else {
 			ZN_ASSERT_RETURN(create_channel(channel_index, channel.defval));
 		}
+
+	} else if (channel.compression == COMPRESSION_PALETTE) {
+		make_channel_data_unique(channel);
+		unsigned int palette_index;
+		if (get_or_add_palette_index(channel, defval, palette_index)) {
+			uint8_t *indices = get_palette_indices(channel);
+			const unsigned int index_bits = channel.palette_index_bits;
+			Vector3i pos;
+			for (pos.z = min.z; pos.z < max.z; ++pos.z) {
+				for (pos.x = min.x; pos.x < max.x; ++pos.x) {
+					const size_t dst_ri = get_index(pos.x, min.y, pos.z);
+					for (int i = 0; i < area_size.y; ++i) {
+						set_packed_palette_index(indices, dst_ri + i, index_bits, palette_index);
+					}
+				}
+			}
+			return;
+		}
+		ZN_ASSERT_RETURN(decompress_palette_channel(channel));
+
+	} else if (channel.compression == COMPRESSION_BRICKS) {
+		// TODO Optimization: fill bricks individually, bricks fully inside the area could become uniform
+		ZN_ASSERT_RETURN(decompress_brick_channel(channel));
+
+	} else {
+		make_channel_data_unique(channel);
 	}
 
 #ifdef DEV_ENABLED
 	ZN_ASSERT(channel.data != nullptr);
 #endif
 
-	Vector3i pos;
-	const size_t volume = get_volume();
-
-	for (pos.z = min.z; pos.z < max.z; ++pos.z) {
-		for (pos.x = min.x; pos.x < max.x; ++pos.x) {
-			const size_t dst_ri = get_index(pos.x, pos.y + min.y, pos.z);
-			ZN_ASSERT(dst_ri < volume);
-
-			switch (channel.depth) {
-				case DEPTH_8_BIT:
-					// Fill row by row
-					memset(&channel.data[dst_ri], defval, area_size.y * sizeof(uint8_t));
-					break;
+	// Depth is resolved once, so rows are filled with tight loops
+	Span<uint8_t> data(channel.data, channel.size_in_bytes);
+	switch (channel.depth) {
+		case DEPTH_8_BIT:
+			fill_3d_region_zxy<uint8_t>(data, _size, min, max, defval);
+			break;
 
-				case DEPTH_16_BIT:
-					for (int i = 0; i < area_size.y; ++i) {
-						((uint16_t *)channel.data)[dst_ri + i] = defval;
-					}
-					break;
+		case DEPTH_16_BIT:
+			fill_3d_region_zxy<uint16_t>(data.reinterpret_cast_to<uint16_t>(), _size, min, max, defval);
+			break;
 
-				case DEPTH_32_BIT:
-					for (int i = 0; i < area_size.y; ++i) {
-						((uint32_t *)channel.data)[dst_ri + i] = defval;
-					}
-					break;
+		case DEPTH_32_BIT:
+			fill_3d_region_zxy<uint32_t>(data.reinterpret_cast_to<uint32_t>(), _size, min, max, defval);
+			break;
 
-				case DEPTH_64_BIT:
-					for (int i = 0; i < area_size.y; ++i) {
-						((uint64_t *)channel.data)[dst_ri + i] = defval;
-					}
-					break;
+		case DEPTH_64_BIT:
+			fill_3d_region_zxy<uint64_t>(data.reinterpret_cast_to<uint64_t>(), _size, min, max, defval);
+			break;
 
-				default:
-					CRASH_NOW();
-					break;
-			}
-		}
+		default:
+			CRASH_NOW();
+			break;
 	}
 }
 
 void VoxelBuffer::fill_area_f(float fvalue, Vector3i min, Vector3i max, unsigned int channel_index) {
 	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
 	const Channel &channel = _channels[channel_index];
-	fill_area(real_to_raw_voxel(fvalue, channel.depth), min, max, channel_index);
+	const uint64_t value = real_to_raw_voxel(fvalue, channel.depth, get_quantization_factor(channel_index));
+	fill_area(value, min, max, channel_index);
 }
 
 void VoxelBuffer::fill_f(real_t value, unsigned int channel) {
 	ZN_ASSERT_RETURN(channel < MAX_CHANNELS);
-	fill(real_to_raw_voxel(value, _channels[channel].depth), channel);
+	fill(real_to_raw_voxel(value, _channels[channel].depth, get_quantization_factor(channel)), channel);
 }
 
 template <typename T>
@@ -497,12 +959,31 @@ bool VoxelBuffer::is_uniform(unsigned int channel_index) const {
 	return is_uniform(channel);
 }
 
-bool VoxelBuffer::is_uniform(const Channel &channel) {
+bool VoxelBuffer::is_uniform(const Channel &channel) const {
 	if (channel.compression == COMPRESSION_UNIFORM) {
 		// Channel has been optimized
 		return true;
 	}
 
+	if (channel.compression == COMPRESSION_PALETTE) {
+		// Palette entries are unique, so comparing indices is enough
+		const uint8_t *indices = get_palette_indices(channel);
+		const unsigned int index_bits = channel.palette_index_bits;
+		const uint64_t volume = get_volume();
+		const unsigned int first = get_packed_palette_index(indices, 0, index_bits);
+		for (size_t i = 1; i < volume; ++i) {
+			if (get_packed_palette_index(indices, i, index_bits) != first) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (channel.compression == COMPRESSION_BRICKS) {
+		const uint64_t first = get_brick_voxel(channel, get_brick_layout(channel, _size), Vector3i());
+		return for_each_brick_value(channel, _size, [first](uint64_t v) { return v == first; });
+	}
+
 	// Channel isn't optimized, so must look at each voxel
 	switch (channel.depth) {
 		case DEPTH_8_BIT:
@@ -521,12 +1002,20 @@ bool VoxelBuffer::is_uniform(const Channel &channel) {
 	return true;
 }
 
-uint64_t get_first_voxel(const VoxelBuffer::Channel &channel) {
+uint64_t get_first_voxel(const VoxelBuffer::Channel &channel, Vector3i size) {
 	ZN_ASSERT(channel.compression != VoxelBuffer::COMPRESSION_UNIFORM);
 #ifdef DEV_ENABLED
 	ZN_ASSERT(channel.data != nullptr);
 #endif
 
+	if (channel.compression == VoxelBuffer::COMPRESSION_PALETTE) {
+		return get_palette_voxel(channel, 0);
+	}
+
+	if (channel.compression == VoxelBuffer::COMPRESSION_BRICKS) {
+		return get_brick_voxel(channel, get_brick_layout(channel, size), Vector3i());
+	}
+
 	switch (channel.depth) {
 		case VoxelBuffer::DEPTH_8_BIT:
 			return channel.data[0];
@@ -551,11 +1040,17 @@ void VoxelBuffer::compress_uniform_channels() {
 		Channel &channel = _channels[i];
 		compress_if_uniform(channel);
 	}
+
+	// SDF is often uniform far from the surface, but blocks crossed by it are not. Bricks keep the uniform parts
+	// cheap, without having to decompress when accessing individual voxels.
+	if (_channels[CHANNEL_SDF].compression == COMPRESSION_NONE) {
+		compress_channel_to_bricks(CHANNEL_SDF, get_default_brick_size_po2(_size));
+	}
 }
 
 void VoxelBuffer::compress_if_uniform(Channel &channel) {
 	if (channel.compression != COMPRESSION_UNIFORM && is_uniform(channel)) {
-		const uint64_t v = get_first_voxel(channel);
+		const uint64_t v = get_first_voxel(channel, _size);
 		clear_channel(channel, v, _allocator);
 	}
 }
@@ -567,6 +1062,13 @@ void VoxelBuffer::decompress_channel(unsigned int channel_index) {
 	Channel &channel = _channels[channel_index];
 	if (channel.compression == COMPRESSION_UNIFORM) {
 		ZN_ASSERT_RETURN(create_channel(channel_index, channel.defval));
+	} else if (channel.compression == COMPRESSION_PALETTE) {
+		ZN_ASSERT_RETURN(decompress_palette_channel(channel));
+	} else if (channel.compression == COMPRESSION_BRICKS) {
+		ZN_ASSERT_RETURN(decompress_brick_channel(channel));
+	} else {
+		// Decompressing is done before writing, so the channel must not share its data anymore
+		make_channel_data_unique(channel);
 	}
 }
 
@@ -576,10 +1078,24 @@ VoxelBuffer::Compression VoxelBuffer::get_channel_compression(unsigned int chann
 	return channel.compression;
 }
 
+size_t VoxelBuffer::get_channels_size_in_bytes() const {
+	size_t size = 0;
+	for (const Channel &channel : _channels) {
+		size += channel.size_in_bytes;
+	}
+	return size;
+}
+
+size_t VoxelBuffer::get_channel_size_in_bytes(unsigned int channel_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
+	return _channels[channel_index].size_in_bytes;
+}
+
 void VoxelBuffer::copy_format(const VoxelBuffer &other) {
 	for (unsigned int i = 0; i < MAX_CHANNELS; ++i) {
 		set_channel_depth(i, other.get_channel_depth(i));
 	}
+	_sdf_quantization_factor = other._sdf_quantization_factor;
 }
 
 void VoxelBuffer::copy_channels_from(const VoxelBuffer &other) {
@@ -600,16 +1116,23 @@ void VoxelBuffer::copy_channel_from(const VoxelBuffer &other, unsigned int chann
 	ZN_ASSERT_RETURN(other_channel.depth == channel.depth);
 
 	if (other_channel.compression != COMPRESSION_UNIFORM) {
-		// Other is not uniform, make sure we allocate our channel
-		if (channel.compression == COMPRESSION_UNIFORM) {
-			ZN_ASSERT_RETURN(create_channel_noinit(channel_index, _size));
-		}
-		ZN_ASSERT(channel.size_in_bytes == other_channel.size_in_bytes);
+		// Other is not uniform, share its data. It will be duplicated when one of the buffers gets modified.
+		// Palette and brick channels are shared as-is, so allocated size may differ from the dense size.
+		if (channel.compression == COMPRESSION_UNIFORM || channel.data != other_channel.data) {
+			if (channel.compression != COMPRESSION_UNIFORM) {
+				delete_channel(channel_index);
+			}
 #ifdef DEV_ENABLED
-		ZN_ASSERT(channel.data != nullptr);
-		ZN_ASSERT(other_channel.data != nullptr);
+			ZN_ASSERT(other_channel.data != nullptr);
 #endif
-		memcpy(channel.data, other_channel.data, channel.size_in_bytes);
+			channel.shared.store(acquire_channel_data(other_channel, other._allocator), std::memory_order_relaxed);
+			channel.data = other_channel.data;
+			channel.size_in_bytes = other_channel.size_in_bytes;
+		}
+		channel.compression = other_channel.compression;
+		channel.palette_index_bits = other_channel.palette_index_bits;
+		channel.palette_last_index = other_channel.palette_last_index;
+		channel.brick_size_po2 = other_channel.brick_size_po2;
 
 	} else {
 		// Other is uniform, deallocate our channel too
@@ -622,6 +1145,11 @@ void VoxelBuffer::copy_channel_from(const VoxelBuffer &other, unsigned int chann
 	// Not really necessary since we already require depths to be equal?
 	channel.depth = other_channel.depth;
 
+	if (channel_index == CHANNEL_SDF) {
+		// Raw values are shared, so they must keep meaning the same distances
+		_sdf_quantization_factor = other._sdf_quantization_factor;
+	}
+
 #ifdef DEV_ENABLED
 	ZN_ASSERT(channel.compression == other_channel.compression);
 #endif
@@ -644,6 +1172,22 @@ void VoxelBuffer::copy_channel_from(
 
 	ZN_ASSERT_RETURN(other_channel.depth == channel.depth);
 
+	if (needs_sdf_requantization(other, channel_index)) {
+		// Distances are quantized with a different scale, they have to be converted one by one
+		Vector3iUtil::sort_min_max(src_min, src_max);
+		clip_copy_region(src_min, src_max, other._size, dst_min, _size);
+		const Vector3i area_size = src_max - src_min;
+		Vector3i rpos;
+		for (rpos.z = 0; rpos.z < area_size.z; ++rpos.z) {
+			for (rpos.x = 0; rpos.x < area_size.x; ++rpos.x) {
+				for (rpos.y = 0; rpos.y < area_size.y; ++rpos.y) {
+					set_voxel_f(other.get_voxel_f(src_min + rpos, channel_index), dst_min + rpos, channel_index);
+				}
+			}
+		}
+		return;
+	}
+
 	if (channel.compression == COMPRESSION_UNIFORM && other_channel.compression == COMPRESSION_UNIFORM &&
 		channel.defval == other_channel.defval) {
 		// No action needed
@@ -651,19 +1195,23 @@ void VoxelBuffer::copy_channel_from(
 	}
 
 	if (other_channel.compression != COMPRESSION_UNIFORM) {
-		if (channel.compression == COMPRESSION_UNIFORM) {
-			// Note, we do this even if the pasted data happens to be all the same value as our current channel.
-			// We assume that this case is not frequent enough to bother, and compression can happen later
-			ZN_ASSERT_RETURN(create_channel(channel_index, channel.defval));
-		}
+		// Note, we decompress even if the pasted data happens to be all the same value as our current channel.
+		// We assume that this case is not frequent enough to bother, and compression can happen later
+		decompress_channel(channel_index);
 #ifdef DEV_ENABLED
 		ZN_ASSERT(channel.data != nullptr);
 		ZN_ASSERT(other_channel.data != nullptr);
 #endif
-		const unsigned int item_size = get_depth_byte_count(channel.depth);
-		Span<const uint8_t> src(other_channel.data, other_channel.size_in_bytes);
 		Span<uint8_t> dst(channel.data, channel.size_in_bytes);
-		copy_3d_region_zxy(dst, _size, dst_min, src, other._size, src_min, src_max, item_size);
+		if (other_channel.compression == COMPRESSION_PALETTE) {
+			copy_palette_region_to_dense(dst, _size, dst_min, other_channel, other._size, src_min, src_max);
+		} else if (other_channel.compression == COMPRESSION_BRICKS) {
+			copy_brick_region_to_dense(dst, _size, dst_min, other_channel, other._size, src_min, src_max);
+		} else {
+			const unsigned int item_size = get_depth_byte_count(channel.depth);
+			Span<const uint8_t> src(other_channel.data, other_channel.size_in_bytes);
+			copy_3d_region_zxy(dst, _size, dst_min, src, other._size, src_min, src_max, item_size);
+		}
 
 	} else if (channel.defval != other_channel.defval) {
 		// Other is uniform, but we are not, and we copy an area so we can't assume to become uniform too.
@@ -704,24 +1252,38 @@ void VoxelBuffer::move_to(VoxelBuffer &dst) {
 	dst._channels = _channels;
 	dst._size = _size;
 	dst._allocator = _allocator;
+	dst._sdf_quantization_factor = _sdf_quantization_factor;
 
 	dst._block_metadata = std::move(_block_metadata);
 	dst._voxel_metadata = std::move(_voxel_metadata);
+	dst._voxel_sparse_values = std::move(_voxel_sparse_values);
 
 	for (unsigned int i = 0; i < _channels.size(); ++i) {
 		Channel &channel = _channels[i];
 		channel.data = nullptr;
+		channel.shared.store(nullptr, std::memory_order_relaxed);
 		channel.compression = COMPRESSION_UNIFORM;
 		channel.size_in_bytes = 0;
+		channel.palette_index_bits = 0;
+		channel.palette_last_index = 0;
+		channel.brick_size_po2 = 0;
 	}
 }
 
 bool VoxelBuffer::get_channel_as_bytes(unsigned int channel_index, Span<uint8_t> &slice) {
-	const Channel &channel = _channels[channel_index];
+	Channel &channel = _channels[channel_index];
+	if (channel.compression == COMPRESSION_PALETTE) {
+		// Raw access requires dense storage
+		ZN_ASSERT_RETURN_V(decompress_palette_channel(channel), false);
+	} else if (channel.compression == COMPRESSION_BRICKS) {
+		ZN_ASSERT_RETURN_V(decompress_brick_channel(channel), false);
+	}
 	if (channel.compression != COMPRESSION_UNIFORM) {
 #ifdef DEV_ENABLED
 		ZN_ASSERT(channel.data != nullptr);
 #endif
+		// The caller may write to it
+		make_channel_data_unique(channel);
 		slice = Span<uint8_t>(channel.data, 0, channel.size_in_bytes);
 		return true;
 	}
@@ -732,7 +1294,9 @@ bool VoxelBuffer::get_channel_as_bytes(unsigned int channel_index, Span<uint8_t>
 
 bool VoxelBuffer::get_channel_as_bytes_read_only(unsigned int channel_index, Span<const uint8_t> &slice) const {
 	const Channel &channel = _channels[channel_index];
-	if (channel.compression != COMPRESSION_UNIFORM) {
+	// Palette and brick channels have no dense representation to expose here. Use `decompress_channel_to` or
+	// specific getters.
+	if (channel.compression == COMPRESSION_NONE) {
 #ifdef DEV_ENABLED
 		ZN_ASSERT(channel.data != nullptr);
 #endif
@@ -774,6 +1338,29 @@ bool VoxelBuffer::create_channel_noinit(int i, Vector3i size) {
 	return true;
 }
 
+void VoxelBuffer::make_channel_data_unique(Channel &channel) {
+	SharedChannelData *shared = channel.shared.load(std::memory_order_relaxed);
+	if (shared == nullptr) {
+		return;
+	}
+	// Buffers sharing data can't be written to while they are being copied, so this won't change concurrently
+	// unless other buffers release their reference, which is fine
+	if (shared->refcount.load(std::memory_order_acquire) == 1) {
+		// Other buffers don't use the data anymore
+		if (shared->allocator == _allocator) {
+			channel.shared.store(nullptr, std::memory_order_relaxed);
+			ZN_DELETE(shared);
+		}
+		return;
+	}
+	ZN_PROFILE_SCOPE();
+	uint8_t *data = allocate_channel_data(channel.size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN(data != nullptr); // Bad alloc?
+	memcpy(data, channel.data, channel.size_in_bytes);
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+}
+
 void VoxelBuffer::delete_channel(int i) {
 	Channel &channel = _channels[i];
 	delete_channel(channel, _allocator);
@@ -783,14 +1370,625 @@ void VoxelBuffer::delete_channel(Channel &channel, Allocator allocator) {
 	ZN_ASSERT_RETURN(channel.compression != COMPRESSION_UNIFORM);
 	// Don't use `_size` to obtain `data` byte count, since we could have changed `_size` up-front during a create().
 	// `size_in_bytes` reflects what is currently allocated inside `data`, regardless of anything else.
-	free_channel_data(channel.data, channel.size_in_bytes, allocator);
+	release_channel_data(channel, allocator);
 	channel.data = nullptr;
 	channel.compression = COMPRESSION_UNIFORM;
 	channel.size_in_bytes = 0;
+	channel.palette_index_bits = 0;
+	channel.palette_last_index = 0;
+	channel.brick_size_po2 = 0;
 }
 
-void VoxelBuffer::downscale_to(VoxelBuffer &dst, Vector3i src_min, Vector3i src_max, Vector3i dst_min) const {
-	// TODO Align input to multiple of two
+size_t VoxelBuffer::get_palette_indices_size_in_bytes(uint64_t volume, unsigned int index_bits) {
+	return (volume * index_bits + 7) >> 3;
+}
+
+unsigned int VoxelBuffer::get_max_palette_index_bits(Depth depth) {
+	// Indices must be smaller than values, otherwise there is no point using a palette
+	return math::min(get_depth_bit_count(depth) / 2, MAX_PALETTE_INDEX_BITS);
+}
+
+bool VoxelBuffer::compress_channel_to_palette(unsigned int channel_index) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	Channel &channel = _channels[channel_index];
+
+	if (channel.compression != COMPRESSION_NONE) {
+		return channel.compression == COMPRESSION_PALETTE;
+	}
+
+	const uint64_t volume = get_volume();
+	const Depth depth = channel.depth;
+	const unsigned int max_palette_size = get_palette_capacity(get_max_palette_index_bits(depth));
+
+	// Gather distinct values. Voxels often come in runs, so we remember the last one to skip most lookups.
+	FixedArray<uint64_t, MAX_PALETTE_SIZE> palette;
+	unsigned int palette_size = 1;
+	palette[0] = read_raw_value(channel.data, 0, depth);
+	uint64_t prev_value = palette[0];
+
+	for (size_t i = 1; i < volume; ++i) {
+		const uint64_t v = read_raw_value(channel.data, i, depth);
+		if (v == prev_value) {
+			continue;
+		}
+		prev_value = v;
+		unsigned int pi = 0;
+		for (; pi < palette_size; ++pi) {
+			if (palette[pi] == v) {
+				break;
+			}
+		}
+		if (pi == palette_size) {
+			if (palette_size == max_palette_size) {
+				// Too many distinct values
+				return false;
+			}
+			palette[palette_size] = v;
+			++palette_size;
+		}
+	}
+
+	if (palette_size == 1) {
+		clear_channel(channel, palette[0], _allocator);
+		return false;
+	}
+
+	const unsigned int index_bits = get_palette_index_bits_for_size(palette_size);
+	const size_t entries_size_in_bytes = get_palette_entries_size_in_bytes(index_bits, depth);
+	const size_t size_in_bytes = entries_size_in_bytes + get_palette_indices_size_in_bytes(volume, index_bits);
+	if (size_in_bytes >= channel.size_in_bytes) {
+		// Not worth it (can happen with tiny buffers)
+		return false;
+	}
+
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+	memset(data, 0, size_in_bytes);
+
+	for (unsigned int pi = 0; pi < palette_size; ++pi) {
+		write_raw_value(data, pi, depth, palette[pi]);
+	}
+
+	uint8_t *indices = data + entries_size_in_bytes;
+	prev_value = palette[0];
+	unsigned int prev_index = 0;
+	for (size_t i = 0; i < volume; ++i) {
+		const uint64_t v = read_raw_value(channel.data, i, depth);
+		if (v != prev_value) {
+			prev_value = v;
+			prev_index = 0;
+			while (palette[prev_index] != v) {
+				++prev_index;
+			}
+		}
+		set_packed_palette_index(indices, i, index_bits, prev_index);
+	}
+
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.compression = COMPRESSION_PALETTE;
+	channel.palette_index_bits = index_bits;
+	channel.palette_last_index = palette_size - 1;
+	return true;
+}
+
+void VoxelBuffer::compress_palette_channels() {
+	for (unsigned int channel_index = 0; channel_index < MAX_CHANNELS; ++channel_index) {
+		if (_channels[channel_index].compression == COMPRESSION_NONE) {
+			compress_channel_to_palette(channel_index);
+		}
+	}
+}
+
+unsigned int VoxelBuffer::get_channel_palette_size(unsigned int channel_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_PALETTE) {
+		return 0;
+	}
+	return channel.palette_last_index + 1;
+}
+
+unsigned int VoxelBuffer::get_channel_palette_index_bits(unsigned int channel_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_PALETTE) {
+		return 0;
+	}
+	return channel.palette_index_bits;
+}
+
+uint64_t VoxelBuffer::get_channel_palette_value(unsigned int channel_index, unsigned int palette_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
+	const Channel &channel = _channels[channel_index];
+	ZN_ASSERT_RETURN_V(channel.compression == COMPRESSION_PALETTE, 0);
+	ZN_ASSERT_RETURN_V(palette_index <= channel.palette_last_index, 0);
+	return read_raw_value(channel.data, palette_index, channel.depth);
+}
+
+bool VoxelBuffer::get_channel_palette_indices_read_only(unsigned int channel_index, Span<const uint8_t> &out_indices)
+		const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_PALETTE) {
+		return false;
+	}
+	out_indices = Span<const uint8_t>(
+			get_palette_indices(channel), get_palette_indices_size_in_bytes(get_volume(), channel.palette_index_bits)
+	);
+	return true;
+}
+
+bool VoxelBuffer::create_channel_palette(
+		unsigned int channel_index,
+		Span<const uint64_t> palette,
+		unsigned int index_bits,
+		Span<uint8_t> &out_indices
+) {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	ZN_ASSERT_RETURN_V(!Vector3iUtil::is_empty_size(_size), false);
+	Channel &channel = _channels[channel_index];
+
+	ZN_ASSERT_RETURN_V_MSG(
+			index_bits == 1 || index_bits == 2 || index_bits == 4 || index_bits == 8,
+			false,
+			format("Invalid palette index bits {}", index_bits)
+	);
+	ZN_ASSERT_RETURN_V(index_bits <= get_max_palette_index_bits(channel.depth), false);
+	ZN_ASSERT_RETURN_V(palette.size() > 0 && palette.size() <= get_palette_capacity(index_bits), false);
+
+	if (channel.compression != COMPRESSION_UNIFORM) {
+		delete_channel(channel_index);
+	}
+
+	const size_t entries_size_in_bytes = get_palette_entries_size_in_bytes(index_bits, channel.depth);
+	const size_t indices_size_in_bytes = get_palette_indices_size_in_bytes(get_volume(), index_bits);
+	const size_t size_in_bytes = entries_size_in_bytes + indices_size_in_bytes;
+	ZN_ASSERT_RETURN_V_MSG(size_in_bytes <= Channel::MAX_SIZE_IN_BYTES, false, "Buffer is too big");
+
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+	// Unused palette entries are zeroed, so indices are always safe to resolve even with corrupted data
+	memset(data, 0, size_in_bytes);
+
+	for (unsigned int pi = 0; pi < palette.size(); ++pi) {
+		write_raw_value(data, pi, channel.depth, palette[pi]);
+	}
+
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.compression = COMPRESSION_PALETTE;
+	channel.palette_index_bits = index_bits;
+	channel.palette_last_index = palette.size() - 1;
+
+	out_indices = Span<uint8_t>(data + entries_size_in_bytes, indices_size_in_bytes);
+	return true;
+}
+
+bool VoxelBuffer::decompress_palette_channel(Channel &channel) {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN_V(channel.compression == COMPRESSION_PALETTE, false);
+
+	const size_t size_in_bytes = get_size_in_bytes_for_volume(_size, channel.depth);
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+
+	copy_palette_region_to_dense(
+			Span<uint8_t>(data, size_in_bytes), _size, Vector3i(), channel, _size, Vector3i(), _size
+	);
+
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.compression = COMPRESSION_NONE;
+	channel.palette_index_bits = 0;
+	channel.palette_last_index = 0;
+	return true;
+}
+
+bool VoxelBuffer::grow_palette(Channel &channel) {
+	ZN_DSTACK();
+	const unsigned int old_index_bits = channel.palette_index_bits;
+	const unsigned int new_index_bits = old_index_bits * 2;
+	if (new_index_bits > get_max_palette_index_bits(channel.depth)) {
+		return false;
+	}
+
+	const uint64_t volume = get_volume();
+	const size_t old_entries_size_in_bytes = get_palette_entries_size_in_bytes(old_index_bits, channel.depth);
+	const size_t new_entries_size_in_bytes = get_palette_entries_size_in_bytes(new_index_bits, channel.depth);
+	const size_t size_in_bytes = new_entries_size_in_bytes + get_palette_indices_size_in_bytes(volume, new_index_bits);
+
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+	memset(data, 0, size_in_bytes);
+
+	memcpy(data, channel.data, old_entries_size_in_bytes);
+
+	const uint8_t *old_indices = channel.data + old_entries_size_in_bytes;
+	uint8_t *new_indices = data + new_entries_size_in_bytes;
+	for (size_t i = 0; i < volume; ++i) {
+		set_packed_palette_index(
+				new_indices, i, new_index_bits, get_packed_palette_index(old_indices, i, old_index_bits)
+		);
+	}
+
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.palette_index_bits = new_index_bits;
+	return true;
+}
+
+bool VoxelBuffer::get_or_add_palette_index(Channel &channel, uint64_t value, unsigned int &out_index) {
+	for (unsigned int pi = 0; pi <= channel.palette_last_index; ++pi) {
+		if (read_raw_value(channel.data, pi, channel.depth) == value) {
+			out_index = pi;
+			return true;
+		}
+	}
+	const unsigned int new_index = channel.palette_last_index + 1;
+	if (new_index == get_palette_capacity(channel.palette_index_bits)) {
+		if (!grow_palette(channel)) {
+			return false;
+		}
+	}
+	write_raw_value(channel.data, new_index, channel.depth, value);
+	channel.palette_last_index = new_index;
+	out_index = new_index;
+	return true;
+}
+
+void VoxelBuffer::copy_palette_channel_to(
+		Span<uint8_t> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		Vector3i src_min,
+		Vector3i src_max,
+		const Channel &channel
+) const {
+	copy_palette_region_to_dense(dst, dst_size, dst_min, channel, _size, src_min, src_max);
+}
+
+Vector3i VoxelBuffer::get_brick_grid_size(Vector3i size, unsigned int brick_size_po2) {
+	return math::ceildiv(size, 1 << brick_size_po2);
+}
+
+unsigned int VoxelBuffer::get_default_brick_size_po2(Vector3i size) {
+	// Big bricks are too coarse for small buffers, and small bricks have a larger table on big buffers
+	const int min_size = math::min(size.x, math::min(size.y, size.z));
+	return min_size >= 32 ? MAX_BRICK_SIZE_PO2 : MIN_BRICK_SIZE_PO2;
+}
+
+bool VoxelBuffer::compress_channel_to_bricks(unsigned int channel_index, unsigned int brick_size_po2) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	ZN_ASSERT_RETURN_V(brick_size_po2 >= MIN_BRICK_SIZE_PO2 && brick_size_po2 <= MAX_BRICK_SIZE_PO2, false);
+	Channel &channel = _channels[channel_index];
+
+	if (channel.compression != COMPRESSION_NONE) {
+		return channel.compression == COMPRESSION_BRICKS;
+	}
+
+	const Depth depth = channel.depth;
+	const unsigned int item_size = get_depth_byte_count(depth);
+	const BrickLayout layout = get_brick_layout(_size, brick_size_po2, depth);
+	const Vector3i brick_size = Vector3iUtil::create(1 << brick_size_po2);
+
+	// TODO Candidate for temp allocator
+	StdVector<uint16_t> slots;
+	StdVector<uint64_t> values;
+	slots.resize(layout.brick_count);
+	values.resize(layout.brick_count, 0);
+
+	unsigned int dense_brick_count = 0;
+	const uint64_t first_value = read_raw_value(channel.data, 0, depth);
+	bool all_same = true;
+
+	// Find which bricks are uniform
+	Vector3i brick_pos;
+	for (brick_pos.z = 0; brick_pos.z < layout.grid_size.z; ++brick_pos.z) {
+		for (brick_pos.x = 0; brick_pos.x < layout.grid_size.x; ++brick_pos.x) {
+			for (brick_pos.y = 0; brick_pos.y < layout.grid_size.y; ++brick_pos.y) {
+				const Vector3i origin = brick_pos << int(brick_size_po2);
+				const Vector3i local_max = math::min(brick_size, _size - origin);
+				const uint64_t brick_value =
+						read_raw_value(channel.data, get_index(origin.x, origin.y, origin.z), depth);
+
+				bool uniform = true;
+				for (int z = 0; z < local_max.z && uniform; ++z) {
+					for (int x = 0; x < local_max.x && uniform; ++x) {
+						const size_t ri = get_index(origin.x + x, origin.y, origin.z + z);
+						for (int y = 0; y < local_max.y; ++y) {
+							if (read_raw_value(channel.data, ri + y, depth) != brick_value) {
+								uniform = false;
+								break;
+							}
+						}
+					}
+				}
+
+				const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+				if (uniform) {
+					slots[brick_index] = BRICK_UNIFORM;
+					values[brick_index] = brick_value;
+					all_same = all_same && brick_value == first_value;
+				} else {
+					if (dense_brick_count + 1 == BRICK_UNIFORM) {
+						// Too many bricks to index
+						return false;
+					}
+					slots[brick_index] = dense_brick_count;
+					++dense_brick_count;
+					all_same = false;
+				}
+			}
+		}
+	}
+
+	if (all_same) {
+		clear_channel(channel, first_value, _allocator);
+		return false;
+	}
+
+	const size_t size_in_bytes = get_bricks_size_in_bytes(layout, dense_brick_count);
+	if (size_in_bytes * 4 > size_t(channel.size_in_bytes) * 3) {
+		// Not worth it, accessing bricks is a bit slower than dense voxels
+		return false;
+	}
+
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+	// Parts of bricks outside the buffer are never read, but keep them deterministic
+	memset(data, 0, size_in_bytes);
+
+	memcpy(data, slots.data(), slots.size() * sizeof(uint16_t));
+
+	const Span<const uint8_t> src(channel.data, channel.size_in_bytes);
+
+	for (brick_pos.z = 0; brick_pos.z < layout.grid_size.z; ++brick_pos.z) {
+		for (brick_pos.x = 0; brick_pos.x < layout.grid_size.x; ++brick_pos.x) {
+			for (brick_pos.y = 0; brick_pos.y < layout.grid_size.y; ++brick_pos.y) {
+				const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+				const uint16_t slot = slots[brick_index];
+				write_raw_value(data + layout.values_offset, brick_index, depth, values[brick_index]);
+
+				if (slot != BRICK_UNIFORM) {
+					const Vector3i origin = brick_pos << int(brick_size_po2);
+					Span<uint8_t> brick_data(
+							data + layout.dense_bricks_offset + slot * layout.dense_brick_size_in_bytes,
+							layout.dense_brick_size_in_bytes
+					);
+					copy_3d_region_zxy(
+							brick_data, brick_size, Vector3i(), src, _size, origin, origin + brick_size, item_size
+					);
+				}
+			}
+		}
+	}
+
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.compression = COMPRESSION_BRICKS;
+	channel.brick_size_po2 = brick_size_po2;
+	return true;
+}
+
+unsigned int VoxelBuffer::get_channel_brick_size_po2(unsigned int channel_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_BRICKS) {
+		return 0;
+	}
+	return channel.brick_size_po2;
+}
+
+Vector3i VoxelBuffer::get_channel_brick_grid_size(unsigned int channel_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, Vector3i());
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_BRICKS) {
+		return Vector3i(1, 1, 1);
+	}
+	return get_brick_grid_size(_size, channel.brick_size_po2);
+}
+
+bool VoxelBuffer::get_channel_brick_uniform_value(unsigned int channel_index, Vector3i brick_pos, uint64_t &out_value)
+		const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	const Channel &channel = _channels[channel_index];
+
+	if (channel.compression == COMPRESSION_UNIFORM) {
+		out_value = channel.defval;
+		return true;
+	}
+	if (channel.compression != COMPRESSION_BRICKS) {
+		return false;
+	}
+
+	const BrickLayout layout = get_brick_layout(channel, _size);
+	ZN_ASSERT_RETURN_V(Box3i(Vector3i(), layout.grid_size).contains(brick_pos), false);
+	const unsigned int brick_index = Vector3iUtil::get_zxy_index(brick_pos, layout.grid_size);
+	if (get_brick_slots(channel)[brick_index] != BRICK_UNIFORM) {
+		return false;
+	}
+	out_value = read_raw_value(channel.data + layout.values_offset, brick_index, channel.depth);
+	return true;
+}
+
+unsigned int VoxelBuffer::get_channel_dense_brick_count(unsigned int channel_index) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, 0);
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_BRICKS) {
+		return 0;
+	}
+	return get_dense_brick_count(channel, get_brick_layout(channel, _size));
+}
+
+bool VoxelBuffer::get_channel_bricks_read_only(
+		unsigned int channel_index,
+		Span<const uint16_t> &out_slots,
+		Span<const uint8_t> &out_uniform_values,
+		Span<const uint8_t> &out_dense_bricks
+) const {
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	const Channel &channel = _channels[channel_index];
+	if (channel.compression != COMPRESSION_BRICKS) {
+		return false;
+	}
+	const BrickLayout layout = get_brick_layout(channel, _size);
+	out_slots = Span<const uint16_t>(get_brick_slots(channel), layout.brick_count);
+	out_uniform_values = Span<const uint8_t>(
+			channel.data + layout.values_offset, layout.brick_count * get_depth_byte_count(channel.depth)
+	);
+	out_dense_bricks = Span<const uint8_t>(
+			channel.data + layout.dense_bricks_offset, channel.size_in_bytes - layout.dense_bricks_offset
+	);
+	return true;
+}
+
+bool VoxelBuffer::create_channel_bricks(
+		unsigned int channel_index,
+		unsigned int brick_size_po2,
+		unsigned int dense_brick_count,
+		Span<uint16_t> &out_slots,
+		Span<uint8_t> &out_uniform_values,
+		Span<uint8_t> &out_dense_bricks
+) {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, false);
+	ZN_ASSERT_RETURN_V(!Vector3iUtil::is_empty_size(_size), false);
+	ZN_ASSERT_RETURN_V_MSG(
+			brick_size_po2 >= MIN_BRICK_SIZE_PO2 && brick_size_po2 <= MAX_BRICK_SIZE_PO2,
+			false,
+			format("Invalid brick size {}", 1 << brick_size_po2)
+	);
+	ZN_ASSERT_RETURN_V(dense_brick_count < BRICK_UNIFORM, false);
+	Channel &channel = _channels[channel_index];
+
+	const BrickLayout layout = get_brick_layout(_size, brick_size_po2, channel.depth);
+	ZN_ASSERT_RETURN_V(dense_brick_count <= layout.brick_count, false);
+	const size_t size_in_bytes = get_bricks_size_in_bytes(layout, dense_brick_count);
+	ZN_ASSERT_RETURN_V_MSG(size_in_bytes <= Channel::MAX_SIZE_IN_BYTES, false, "Buffer is too big");
+
+	if (channel.compression != COMPRESSION_UNIFORM) {
+		delete_channel(channel_index);
+	}
+
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+	memset(data, 0, size_in_bytes);
+
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.compression = COMPRESSION_BRICKS;
+	channel.brick_size_po2 = brick_size_po2;
+
+	out_slots = Span<uint16_t>(get_brick_slots(channel), layout.brick_count);
+	out_uniform_values = Span<uint8_t>(
+			data + layout.values_offset, layout.brick_count * get_depth_byte_count(channel.depth)
+	);
+	out_dense_bricks = Span<uint8_t>(data + layout.dense_bricks_offset, size_in_bytes - layout.dense_bricks_offset);
+	return true;
+}
+
+bool VoxelBuffer::decompress_brick_channel(Channel &channel) {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN_V(channel.compression == COMPRESSION_BRICKS, false);
+
+	const size_t size_in_bytes = get_size_in_bytes_for_volume(_size, channel.depth);
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+
+	copy_brick_region_to_dense(
+			Span<uint8_t>(data, size_in_bytes), _size, Vector3i(), channel, _size, Vector3i(), _size
+	);
+
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	channel.compression = COMPRESSION_NONE;
+	channel.brick_size_po2 = 0;
+	return true;
+}
+
+bool VoxelBuffer::add_dense_brick(Channel &channel, unsigned int brick_index) {
+	ZN_DSTACK();
+	const BrickLayout layout = get_brick_layout(channel, _size);
+	const unsigned int dense_brick_count = get_dense_brick_count(channel, layout);
+	const size_t size_in_bytes = get_bricks_size_in_bytes(layout, dense_brick_count + 1);
+	if (dense_brick_count + 1 == BRICK_UNIFORM || size_in_bytes >= get_size_in_bytes_for_volume(_size, channel.depth)) {
+		return false;
+	}
+
+	uint8_t *data = allocate_channel_data(size_in_bytes, _allocator);
+	ZN_ASSERT_RETURN_V(data != nullptr, false); // Bad alloc?
+	memcpy(data, channel.data, channel.size_in_bytes);
+
+	// The new brick starts with the value the brick had when it was uniform
+	const uint64_t value = read_raw_value(channel.data + layout.values_offset, brick_index, channel.depth);
+	uint8_t *brick_data = data + channel.size_in_bytes;
+	const unsigned int brick_volume = 1 << (3 * layout.brick_size_po2);
+	for (unsigned int i = 0; i < brick_volume; ++i) {
+		write_raw_value(brick_data, i, channel.depth, value);
+	}
+	reinterpret_cast<uint16_t *>(data)[brick_index] = dense_brick_count;
+
+	release_channel_data(channel, _allocator);
+	channel.data = data;
+	channel.size_in_bytes = size_in_bytes;
+	return true;
+}
+
+void VoxelBuffer::copy_brick_channel_to(
+		Span<uint8_t> dst,
+		Vector3i dst_size,
+		Vector3i dst_min,
+		Vector3i src_min,
+		Vector3i src_max,
+		const Channel &channel
+) const {
+	copy_brick_region_to_dense(dst, dst_size, dst_min, channel, _size, src_min, src_max);
+}
+
+void VoxelBuffer::decompress_channel_to(unsigned int channel_index, Span<uint8_t> dst) const {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
+	const Channel &channel = _channels[channel_index];
+	const size_t size_in_bytes = get_size_in_bytes_for_volume(_size, channel.depth);
+	ZN_ASSERT_RETURN(dst.size() >= size_in_bytes);
+
+	switch (channel.compression) {
+		case COMPRESSION_NONE:
+			memcpy(dst.data(), channel.data, size_in_bytes);
+			break;
+		case COMPRESSION_UNIFORM:
+			fill_raw_region_zxy(dst, _size, Vector3i(), _size, channel.depth, channel.defval);
+			break;
+		case COMPRESSION_PALETTE:
+			copy_palette_region_to_dense(dst, _size, Vector3i(), channel, _size, Vector3i(), _size);
+			break;
+		case COMPRESSION_BRICKS:
+			copy_brick_region_to_dense(dst, _size, Vector3i(), channel, _size, Vector3i(), _size);
+			break;
+		default:
+			ZN_CRASH();
+			break;
+	}
+}
+
+void VoxelBuffer::downscale_to(
+		VoxelBuffer &dst,
+		Vector3i src_min,
+		Vector3i src_max,
+		Vector3i dst_min,
+		uint32_t channels_mask
+) const {
+	ZN_PROFILE_SCOPE();
+	// TODO Align input to multiple of two
 
 	src_min = src_min.clamp(Vector3i(), _size - Vector3i(1, 1, 1));
 	src_max = src_max.clamp(Vector3i(), _size);
@@ -801,40 +1999,219 @@ void VoxelBuffer::downscale_to(VoxelBuffer &dst, Vector3i src_min, Vector3i src_
 	dst_min = dst_min.clamp(Vector3i(), dst._size - Vector3i(1, 1, 1));
 	dst_max = dst_max.clamp(Vector3i(), dst._size);
 
+	if (dst_max.x <= dst_min.x || dst_max.y <= dst_min.y || dst_max.z <= dst_min.z) {
+		return;
+	}
+
+	// TODO Candidate for temp allocator
+	StdVector<uint8_t> decompressed_src;
+
 	for (int channel_index = 0; channel_index < MAX_CHANNELS; ++channel_index) {
+		if ((channels_mask & (1 << channel_index)) == 0) {
+			continue;
+		}
+
 		const Channel &src_channel = _channels[channel_index];
 		const Channel &dst_channel = dst._channels[channel_index];
+		// Blocks of different LODs may quantize SDF with different scales
+		const bool requantize = needs_sdf_requantization(dst, channel_index);
 
 		if (src_channel.compression == COMPRESSION_UNIFORM && dst_channel.compression == COMPRESSION_UNIFORM &&
-			src_channel.defval == dst_channel.defval) {
+			src_channel.defval == dst_channel.defval && !requantize) {
 			// No action needed
 			continue;
 		}
 
+		if (src_channel.compression == COMPRESSION_UNIFORM) {
+			if (requantize) {
+				dst.fill_area_f(get_voxel_f(0, 0, 0, channel_index), dst_min, dst_max, channel_index);
+			} else {
+				dst.fill_area(src_channel.defval, dst_min, dst_max, channel_index);
+			}
+			continue;
+		}
+
 		// Nearest-neighbor downscaling
 
+		if (requantize) {
+			Vector3i pos;
+			for (pos.z = dst_min.z; pos.z < dst_max.z; ++pos.z) {
+				for (pos.x = dst_min.x; pos.x < dst_max.x; ++pos.x) {
+					for (pos.y = dst_min.y; pos.y < dst_max.y; ++pos.y) {
+						const Vector3i src_pos = src_min + ((pos - dst_min) << 1);
+						dst.set_voxel_f(get_voxel_f(src_pos, channel_index), pos, channel_index);
+					}
+				}
+			}
+			continue;
+		}
+
+		if (dst_channel.compression == COMPRESSION_PALETTE || src_channel.depth != dst_channel.depth) {
+			// Setting voxels one by one keeps the palette if the source doesn't have too many different values
+			Vector3i pos;
+			for (pos.z = dst_min.z; pos.z < dst_max.z; ++pos.z) {
+				for (pos.x = dst_min.x; pos.x < dst_max.x; ++pos.x) {
+					for (pos.y = dst_min.y; pos.y < dst_max.y; ++pos.y) {
+						const Vector3i src_pos = src_min + ((pos - dst_min) << 1);
+						dst.set_voxel(get_voxel(src_pos, channel_index), pos, channel_index);
+					}
+				}
+			}
+			continue;
+		}
+
+		Span<const uint8_t> src_data;
+		if (src_channel.compression == COMPRESSION_NONE) {
+			src_data = Span<const uint8_t>(src_channel.data, src_channel.size_in_bytes);
+		} else {
+			decompressed_src.resize(get_size_in_bytes_for_volume(_size, src_channel.depth));
+			decompress_channel_to(channel_index, to_span(decompressed_src));
+			src_data = to_span_const(decompressed_src);
+		}
+
+		dst.decompress_channel(channel_index);
+		Span<uint8_t> dst_data(dst_channel.data, dst_channel.size_in_bytes);
+
+		switch (dst_channel.depth) {
+			case DEPTH_8_BIT:
+				downscale_3d_region_zxy(dst_data, dst._size, dst_min, dst_max, src_data, _size, src_min);
+				break;
+			case DEPTH_16_BIT:
+				downscale_3d_region_zxy(
+						dst_data.reinterpret_cast_to<uint16_t>(),
+						dst._size,
+						dst_min,
+						dst_max,
+						src_data.reinterpret_cast_to<const uint16_t>(),
+						_size,
+						src_min
+				);
+				break;
+			case DEPTH_32_BIT:
+				downscale_3d_region_zxy(
+						dst_data.reinterpret_cast_to<uint32_t>(),
+						dst._size,
+						dst_min,
+						dst_max,
+						src_data.reinterpret_cast_to<const uint32_t>(),
+						_size,
+						src_min
+				);
+				break;
+			case DEPTH_64_BIT:
+				downscale_3d_region_zxy(
+						dst_data.reinterpret_cast_to<uint64_t>(),
+						dst._size,
+						dst_min,
+						dst_max,
+						src_data.reinterpret_cast_to<const uint64_t>(),
+						_size,
+						src_min
+				);
+				break;
+			default:
+				ZN_CRASH();
+				break;
+		}
+	}
+}
+
+void VoxelBuffer::downscale_majority_to(
+		VoxelBuffer &dst,
+		Vector3i src_min,
+		Vector3i src_max,
+		Vector3i dst_min,
+		unsigned int channel_index,
+		Span<const uint16_t> replacements
+) const {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
+
+	const Channel &src_channel = _channels[channel_index];
+	const Channel &dst_channel = dst._channels[channel_index];
+
+	if (src_channel.depth != DEPTH_8_BIT && src_channel.depth != DEPTH_16_BIT) {
+		// Values don't fit in replacements, and such channels are not expected to hold types
+		downscale_to(dst, src_min, src_max, dst_min, 1 << channel_index);
+		return;
+	}
+
+	src_min = src_min.clamp(Vector3i(), _size - Vector3i(1, 1, 1));
+	src_max = src_max.clamp(Vector3i(), _size);
+
+	Vector3i dst_max = dst_min + ((src_max - src_min) >> 1);
+
+	dst_min = dst_min.clamp(Vector3i(), dst._size - Vector3i(1, 1, 1));
+	dst_max = dst_max.clamp(Vector3i(), dst._size);
+
+	if (dst_max.x <= dst_min.x || dst_max.y <= dst_min.y || dst_max.z <= dst_min.z) {
+		return;
+	}
+
+	struct L {
+		static inline uint64_t replace(uint64_t v, Span<const uint16_t> replacements) {
+			return v < replacements.size() ? replacements[v] : v;
+		}
+	};
+
+	if (src_channel.compression == COMPRESSION_UNIFORM) {
+		// All 8 voxels are the same
+		dst.fill_area(L::replace(src_channel.defval, replacements), dst_min, dst_max, channel_index);
+		return;
+	}
+
+	if (dst_channel.compression == COMPRESSION_PALETTE || src_channel.depth != dst_channel.depth) {
+		// Setting voxels one by one keeps the palette if the source doesn't have too many different values
+		FixedArray<uint64_t, 8> values;
+		const Vector3i src_last = _size - Vector3i(1, 1, 1);
 		Vector3i pos;
 		for (pos.z = dst_min.z; pos.z < dst_max.z; ++pos.z) {
 			for (pos.x = dst_min.x; pos.x < dst_max.x; ++pos.x) {
 				for (pos.y = dst_min.y; pos.y < dst_max.y; ++pos.y) {
-					const Vector3i src_pos = src_min + ((pos - dst_min) << 1);
-
-					// TODO Remove check once it works
-					ZN_ASSERT(is_position_valid(src_pos.x, src_pos.y, src_pos.z));
-
-					uint64_t v;
-					if (src_channel.compression != COMPRESSION_UNIFORM) {
-						// TODO Optimized version?
-						v = get_voxel(src_pos, channel_index);
-					} else {
-						v = src_channel.defval;
+					const Vector3i src_pos0 = src_min + ((pos - dst_min) << 1);
+					unsigned int i = 0;
+					for (int z = 0; z < 2; ++z) {
+						for (int x = 0; x < 2; ++x) {
+							for (int y = 0; y < 2; ++y) {
+								const Vector3i src_pos = math::min(src_pos0 + Vector3i(x, y, z), src_last);
+								values[i] = L::replace(get_voxel(src_pos, channel_index), replacements);
+								++i;
+							}
+						}
 					}
-
-					// TODO Could be optimized?
-					dst.set_voxel(v, pos, channel_index);
+					dst.set_voxel(get_most_common_non_zero(values.data(), values.size()), pos, channel_index);
 				}
 			}
 		}
+		return;
+	}
+
+	StdVector<uint8_t> decompressed_src;
+	Span<const uint8_t> src_data;
+	if (src_channel.compression == COMPRESSION_NONE) {
+		src_data = Span<const uint8_t>(src_channel.data, src_channel.size_in_bytes);
+	} else {
+		decompressed_src.resize(get_size_in_bytes_for_volume(_size, src_channel.depth));
+		decompress_channel_to(channel_index, to_span(decompressed_src));
+		src_data = to_span_const(decompressed_src);
+	}
+
+	dst.decompress_channel(channel_index);
+	Span<uint8_t> dst_data(dst_channel.data, dst_channel.size_in_bytes);
+
+	if (dst_channel.depth == DEPTH_8_BIT) {
+		downscale_3d_region_zxy_majority(dst_data, dst._size, dst_min, dst_max, src_data, _size, src_min, replacements);
+	} else {
+		downscale_3d_region_zxy_majority(
+				dst_data.reinterpret_cast_to<uint16_t>(),
+				dst._size,
+				dst_min,
+				dst_max,
+				src_data.reinterpret_cast_to<const uint16_t>(),
+				_size,
+				src_min,
+				replacements
+		);
 	}
 }
 
@@ -843,6 +2220,11 @@ bool VoxelBuffer::equals(const VoxelBuffer &p_other) const {
 		return false;
 	}
 
+	if (needs_sdf_requantization(p_other, CHANNEL_SDF)) {
+		// Same raw values would not represent the same distances
+		return false;
+	}
+
 	for (int channel_index = 0; channel_index < MAX_CHANNELS; ++channel_index) {
 		const Channel &channel = _channels[channel_index];
 		const Channel &other_channel = p_other._channels[channel_index];
@@ -862,11 +2244,26 @@ bool VoxelBuffer::equals(const VoxelBuffer &p_other) const {
 			}
 
 		} else {
+			if (channel.compression == COMPRESSION_PALETTE &&
+				(channel.palette_index_bits != other_channel.palette_index_bits ||
+				 channel.palette_last_index != other_channel.palette_last_index)) {
+				return false;
+			}
+			if (channel.compression == COMPRESSION_BRICKS &&
+				(channel.brick_size_po2 != other_channel.brick_size_po2 ||
+				 channel.size_in_bytes != other_channel.size_in_bytes)) {
+				// Bricks don't always need the same amount of memory
+				return false;
+			}
 			ZN_ASSERT_RETURN_V(channel.size_in_bytes == other_channel.size_in_bytes, false);
 #ifdef DEV_ENABLED
 			ZN_ASSERT(channel.data != nullptr);
 			ZN_ASSERT(other_channel.data != nullptr);
 #endif
+			if (channel.data == other_channel.data) {
+				// Shared
+				continue;
+			}
 			for (size_t i = 0; i < channel.size_in_bytes; ++i) {
 				if (channel.data[i] != other_channel.data[i]) {
 					return false;
@@ -911,62 +2308,117 @@ float VoxelBuffer::get_sdf_quantization_scale(Depth d) {
 	}
 }
 
+void VoxelBuffer::set_sdf_quantization_factor(float factor) {
+	ZN_ASSERT_RETURN(factor > 0.f);
+	_sdf_quantization_factor = factor;
+}
+
+float VoxelBuffer::get_channel_quantization_scale(unsigned int channel_index) const {
+	const Depth depth = _channels[channel_index].depth;
+	if (depth == DEPTH_8_BIT || depth == DEPTH_16_BIT) {
+		return get_sdf_quantization_scale(depth) * get_quantization_factor(channel_index);
+	}
+	return 1.f;
+}
+
+float VoxelBuffer::get_sdf_channel_quantization_scale() const {
+	return get_channel_quantization_scale(CHANNEL_SDF);
+}
+
+float VoxelBuffer::get_sdf_quantization_factor_for_lod(unsigned int lod_index) {
+	return 1.f / static_cast<float>(1 << lod_index);
+}
+
+bool VoxelBuffer::needs_sdf_requantization(const VoxelBuffer &other, unsigned int channel_index) const {
+	return channel_index == CHANNEL_SDF &&
+			get_channel_quantization_scale(channel_index) != other.get_channel_quantization_scale(channel_index);
+}
+
 void VoxelBuffer::get_range_f(float &out_min, float &out_max, ChannelId channel_index) const {
 	const Channel &channel = _channels[channel_index];
-	float min_value = get_voxel_f(0, 0, 0, channel_index);
-	float max_value = min_value;
 
 	if (channel.compression == COMPRESSION_UNIFORM) {
-		out_min = min_value;
-		out_max = max_value;
+		out_min = get_voxel_f(0, 0, 0, channel_index);
+		out_max = out_min;
 		return;
 	}
 
+	float min_value = raw_voxel_to_unscaled_real(get_voxel(0, 0, 0, channel_index), channel.depth);
+	float max_value = min_value;
+
 	const uint64_t volume = get_volume();
 
 #ifdef DEV_ENABLED
 	ZN_ASSERT(channel.data != nullptr);
 #endif
 
-	switch (channel.depth) {
-		case DEPTH_8_BIT:
-			for (unsigned int i = 0; i < volume; ++i) {
-				const float v = s8_to_snorm(channel.data[i]);
-				min_value = math::min(v, min_value);
-				max_value = math::max(v, max_value);
-			}
-			break;
-		case DEPTH_16_BIT: {
-			const int16_t *data = reinterpret_cast<const int16_t *>(channel.data);
-			for (unsigned int i = 0; i < volume; ++i) {
-				const float v = s16_to_snorm(data[i]);
-				min_value = math::min(v, min_value);
-				max_value = math::max(v, max_value);
-			}
-		} break;
-		case DEPTH_32_BIT: {
-			const float *data = reinterpret_cast<const float *>(channel.data);
-			for (unsigned int i = 0; i < volume; ++i) {
-				const float v = data[i];
-				min_value = math::min(v, min_value);
-				max_value = math::max(v, max_value);
-			}
-		} break;
-		case DEPTH_64_BIT: {
-			const double *data = reinterpret_cast<const double *>(channel.data);
-			for (unsigned int i = 0; i < volume; ++i) {
-				const double v = data[i];
-				min_value = math::min(v, double(min_value));
-				max_value = math::max(v, double(max_value));
+	if (channel.compression == COMPRESSION_PALETTE) {
+		// Only consider palette entries that are actually used
+		FixedArray<bool, MAX_PALETTE_SIZE> used;
+		zylann::fill(used, false);
+		const uint8_t *indices = get_palette_indices(channel);
+		for (size_t i = 0; i < volume; ++i) {
+			used[get_packed_palette_index(indices, i, channel.palette_index_bits)] = true;
+		}
+		for (unsigned int pi = 0; pi <= channel.palette_last_index; ++pi) {
+			if (!used[pi]) {
+				continue;
 			}
-		} break;
-		default:
-			CRASH_NOW();
+			const float v = raw_voxel_to_unscaled_real(read_raw_value(channel.data, pi, channel.depth), channel.depth);
+			min_value = math::min(v, min_value);
+			max_value = math::max(v, max_value);
+		}
+
+	} else if (channel.compression == COMPRESSION_BRICKS) {
+		const Depth depth = channel.depth;
+		for_each_brick_value(channel, _size, [&min_value, &max_value, depth](uint64_t raw) {
+			const float v = raw_voxel_to_unscaled_real(raw, depth);
+			min_value = math::min(v, min_value);
+			max_value = math::max(v, max_value);
+			return true;
+		});
+
+	} else {
+		switch (channel.depth) {
+			case DEPTH_8_BIT:
+				for (unsigned int i = 0; i < volume; ++i) {
+					const float v = s8_to_snorm(channel.data[i]);
+					min_value = math::min(v, min_value);
+					max_value = math::max(v, max_value);
+				}
+				break;
+			case DEPTH_16_BIT: {
+				const int16_t *data = reinterpret_cast<const int16_t *>(channel.data);
+				for (unsigned int i = 0; i < volume; ++i) {
+					const float v = s16_to_snorm(data[i]);
+					min_value = math::min(v, min_value);
+					max_value = math::max(v, max_value);
+				}
+			} break;
+			case DEPTH_32_BIT: {
+				const float *data = reinterpret_cast<const float *>(channel.data);
+				for (unsigned int i = 0; i < volume; ++i) {
+					const float v = data[i];
+					min_value = math::min(v, min_value);
+					max_value = math::max(v, max_value);
+				}
+			} break;
+			case DEPTH_64_BIT: {
+				const double *data = reinterpret_cast<const double *>(channel.data);
+				for (unsigned int i = 0; i < volume; ++i) {
+					const double v = data[i];
+					min_value = math::min(v, double(min_value));
+					max_value = math::max(v, double(max_value));
+				}
+			} break;
+			default:
+				CRASH_NOW();
+		}
 	}
 
-	const float q = get_sdf_quantization_scale(channel.depth);
-	out_min = min_value * q;
-	out_max = max_value * q;
+	const float inv_scale = 1.f / get_channel_quantization_scale(channel_index);
+	out_min = min_value * inv_scale;
+	out_max = max_value * inv_scale;
 }
 
 const VoxelMetadata *VoxelBuffer::get_voxel_metadata(Vector3i pos) const {
@@ -1004,6 +2456,21 @@ void VoxelBuffer::clear_and_set_voxel_metadata(Span<FlatMapMoveOnly<Vector3i, Vo
 	_voxel_metadata.clear_and_insert(pairs);
 }
 
+bool VoxelBuffer::get_voxel_sparse_value(Vector3i pos, uint32_t &out_value) const {
+	ZN_ASSERT_RETURN_V(is_position_valid(pos), false);
+	return _voxel_sparse_values.get(Vector3iUtil::get_zxy_index(pos, _size), out_value);
+}
+
+void VoxelBuffer::set_voxel_sparse_value(Vector3i pos, uint32_t value) {
+	ZN_ASSERT_RETURN(is_position_valid(pos));
+	_voxel_sparse_values.set(Vector3iUtil::get_zxy_index(pos, _size), value);
+}
+
+void VoxelBuffer::erase_voxel_sparse_value(Vector3i pos) {
+	ZN_ASSERT_RETURN(is_position_valid(pos));
+	_voxel_sparse_values.erase(Vector3iUtil::get_zxy_index(pos, _size));
+}
+
 /*#ifdef ZN_GODOT
 
 void VoxelBuffer::for_each_voxel_metadata(const Callable &callback) const {
@@ -1045,12 +2512,16 @@ void VoxelBuffer::for_each_voxel_metadata_in_area(const Callable &callback, Box3
 
 void VoxelBuffer::clear_voxel_metadata() {
 	_voxel_metadata.clear();
+	_voxel_sparse_values.clear();
 }
 
 void VoxelBuffer::clear_voxel_metadata_in_area(Box3i box) {
 	_voxel_metadata.remove_if([&box](const FlatMapMoveOnly<Vector3i, VoxelMetadata>::Pair &p) { //
 		return box.contains(p.key);
 	});
+	erase_voxel_sparse_values_if([&box](Vector3i pos, uint32_t value) { //
+		return box.contains(pos);
+	});
 }
 
 void VoxelBuffer::copy_voxel_metadata_in_area(const VoxelBuffer &src_buffer, Box3i src_box, Vector3i dst_origin) {
@@ -1070,6 +2541,14 @@ void VoxelBuffer::copy_voxel_metadata_in_area(const VoxelBuffer &src_buffer, Box
 			meta.copy_from(src_it->value);
 		}
 	}
+
+	// Translation preserves ZXY order within the area, so most of these end up appended
+	const Vector3i src_to_dst = dst_origin - src_box.position;
+	src_buffer.for_each_voxel_sparse_value_in_area(clipped_src_box, [this, src_to_dst](Vector3i src_pos, uint32_t v) {
+		const Vector3i dst_pos = src_pos + src_to_dst;
+		ZN_ASSERT(is_position_valid(dst_pos));
+		_voxel_sparse_values.set(Vector3iUtil::get_zxy_index(dst_pos, _size), v);
+	});
 }
 
 void VoxelBuffer::copy_voxel_metadata(const VoxelBuffer &src_buffer) {
@@ -1082,6 +2561,16 @@ void VoxelBuffer::copy_voxel_metadata(const VoxelBuffer &src_buffer) {
 		meta.copy_from(src_it->value);
 	}
 
+	if (_voxel_sparse_values.size() == 0) {
+		_voxel_sparse_values = src_buffer._voxel_sparse_values;
+	} else {
+		Span<const uint32_t> keys = src_buffer._voxel_sparse_values.get_keys();
+		Span<const uint32_t> values = src_buffer._voxel_sparse_values.get_values();
+		for (unsigned int i = 0; i < keys.size(); ++i) {
+			_voxel_sparse_values.set(keys[i], values[i]);
+		}
+	}
+
 	_block_metadata.copy_from(src_buffer._block_metadata);
 }
 
@@ -1093,6 +2582,7 @@ void get_unscaled_sdf(const VoxelBuffer &voxels, Span<float> sdf) {
 
 	const VoxelBuffer::ChannelId channel = VoxelBuffer::CHANNEL_SDF;
 	const VoxelBuffer::Depth depth = voxels.get_channel_depth(channel);
+	const float factor = voxels.get_sdf_quantization_factor();
 
 	if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_UNIFORM) {
 		const float uniform_value = voxels.get_voxel_f(0, 0, 0, channel);
@@ -1100,87 +2590,133 @@ void get_unscaled_sdf(const VoxelBuffer &voxels, Span<float> sdf) {
 		return;
 	}
 
+	if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_PALETTE) {
+		FixedArray<float, VoxelBuffer::MAX_PALETTE_SIZE> palette;
+		const unsigned int palette_size = voxels.get_channel_palette_size(channel);
+		for (unsigned int pi = 0; pi < palette_size; ++pi) {
+			palette[pi] = raw_voxel_to_real(voxels.get_channel_palette_value(channel, pi), depth, factor);
+		}
+		Span<const uint8_t> indices;
+		ZN_ASSERT(voxels.get_channel_palette_indices_read_only(channel, indices));
+		const unsigned int index_bits = voxels.get_channel_palette_index_bits(channel);
+		for (unsigned int i = 0; i < sdf.size(); ++i) {
+			const unsigned int pi = VoxelBuffer::get_packed_palette_index(indices.data(), i, index_bits);
+			// Out-of-range indices can only come from corrupted data
+			sdf[i] = pi < palette_size ? palette[pi] : 0.f;
+		}
+		return;
+	}
+
+	if (voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_BRICKS) {
+		// TODO Candidate for temp allocator
+		StdVector<uint8_t> raw;
+		raw.resize(VoxelBuffer::get_size_in_bytes_for_volume(voxels.get_size(), depth));
+		voxels.decompress_channel_to(channel, to_span(raw));
+		for (unsigned int i = 0; i < sdf.size(); ++i) {
+			sdf[i] = raw_voxel_to_real(read_raw_value(raw.data(), i, depth), depth, factor);
+		}
+		return;
+	}
+
+	const float inv_scale = 1.f / voxels.get_sdf_channel_quantization_scale();
+
+	// Converting and scaling in the same loop over raw pointers, so the compiler can vectorize it
 	switch (depth) {
 		case VoxelBuffer::DEPTH_8_BIT: {
 			Span<const int8_t> raw;
 			ZN_ASSERT(voxels.get_channel_data_read_only(channel, raw));
-			for (unsigned int i = 0; i < sdf.size(); ++i) {
-				sdf[i] = s8_to_snorm(raw[i]);
+			const int8_t *raw_data = raw.data();
+			float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				sdf_data[i] = s8_to_snorm(raw_data[i]) * inv_scale;
 			}
 		} break;
 
 		case VoxelBuffer::DEPTH_16_BIT: {
 			Span<const int16_t> raw;
 			ZN_ASSERT(voxels.get_channel_data_read_only(channel, raw));
-			for (unsigned int i = 0; i < sdf.size(); ++i) {
-				sdf[i] = s16_to_snorm(raw[i]);
+			const int16_t *raw_data = raw.data();
+			float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				sdf_data[i] = s16_to_snorm(raw_data[i]) * inv_scale;
 			}
 		} break;
 
 		case VoxelBuffer::DEPTH_32_BIT: {
 			Span<const float> raw;
 			ZN_ASSERT(voxels.get_channel_data_read_only(channel, raw));
-			memcpy(sdf.data(), raw.data(), sizeof(float) * sdf.size());
+			const float *raw_data = raw.data();
+			float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				sdf_data[i] = raw_data[i] * inv_scale;
+			}
 		} break;
 
 		case VoxelBuffer::DEPTH_64_BIT: {
 			Span<const double> raw;
 			ZN_ASSERT(voxels.get_channel_data_read_only(channel, raw));
-			for (unsigned int i = 0; i < sdf.size(); ++i) {
-				sdf[i] = raw[i];
+			const double *raw_data = raw.data();
+			float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				sdf_data[i] = raw_data[i] * inv_scale;
 			}
 		} break;
 
 		default:
 			ZN_CRASH();
 	}
-
-	const float inv_scale = 1.f / VoxelBuffer::get_sdf_quantization_scale(depth);
-
-	for (float &sd : sdf) {
-		sd *= inv_scale;
-	}
 }
 
-void scale_and_store_sdf(VoxelBuffer &voxels, Span<float> sdf) {
+void scale_and_store_sdf(VoxelBuffer &voxels, Span<const float> sdf) {
 	ZN_PROFILE_SCOPE();
 	const VoxelBuffer::ChannelId channel = VoxelBuffer::CHANNEL_SDF;
 	const VoxelBuffer::Depth depth = voxels.get_channel_depth(channel);
 	ZN_ASSERT_RETURN(voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_NONE);
 
-	const float scale = VoxelBuffer::get_sdf_quantization_scale(depth);
-	for (unsigned int i = 0; i < sdf.size(); ++i) {
-		sdf[i] *= scale;
-	}
+	const float scale = voxels.get_sdf_channel_quantization_scale();
 
 	switch (depth) {
 		case VoxelBuffer::DEPTH_8_BIT: {
 			Span<int8_t> raw;
 			ZN_ASSERT(voxels.get_channel_data(channel, raw));
-			for (unsigned int i = 0; i < sdf.size(); ++i) {
-				raw[i] = snorm_to_s8(sdf[i]);
+			ZN_ASSERT_RETURN(raw.size() == sdf.size());
+			int8_t *raw_data = raw.data();
+			const float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				raw_data[i] = snorm_to_s8(sdf_data[i] * scale);
 			}
 		} break;
 
 		case VoxelBuffer::DEPTH_16_BIT: {
 			Span<int16_t> raw;
 			ZN_ASSERT(voxels.get_channel_data(channel, raw));
-			for (unsigned int i = 0; i < sdf.size(); ++i) {
-				raw[i] = snorm_to_s16(sdf[i]);
+			ZN_ASSERT_RETURN(raw.size() == sdf.size());
+			int16_t *raw_data = raw.data();
+			const float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				raw_data[i] = snorm_to_s16(sdf_data[i] * scale);
 			}
 		} break;
 
 		case VoxelBuffer::DEPTH_32_BIT: {
 			Span<float> raw;
 			ZN_ASSERT(voxels.get_channel_data(channel, raw));
-			memcpy(raw.data(), sdf.data(), sizeof(float) * sdf.size());
+			ZN_ASSERT_RETURN(raw.size() == sdf.size());
+			float *raw_data = raw.data();
+			const float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				raw_data[i] = sdf_data[i] * scale;
+			}
 		} break;
 
 		case VoxelBuffer::DEPTH_64_BIT: {
 			Span<double> raw;
 			ZN_ASSERT(voxels.get_channel_data(channel, raw));
-			for (unsigned int i = 0; i < sdf.size(); ++i) {
-				raw[i] = sdf[i];
+			ZN_ASSERT_RETURN(raw.size() == sdf.size());
+			double *raw_data = raw.data();
+			const float *sdf_data = sdf.data();
+			for (size_t i = 0; i < sdf.size(); ++i) {
+				raw_data[i] = sdf_data[i] * scale;
 			}
 		} break;
 
@@ -1195,7 +2731,7 @@ void scale_and_store_sdf_if_modified(VoxelBuffer &voxels, Span<float> sdf, Span<
 	const VoxelBuffer::Depth depth = voxels.get_channel_depth(channel);
 	ZN_ASSERT_RETURN(voxels.get_channel_compression(channel) == VoxelBuffer::COMPRESSION_NONE);
 
-	const float scale = VoxelBuffer::get_sdf_quantization_scale(depth);
+	const float scale = voxels.get_sdf_channel_quantization_scale();
 	// for (unsigned int i = 0; i < sdf.size(); ++i) {
 	// 	sdf[i] *= scale;
 	// }
@@ -1327,6 +2863,26 @@ void paste_src_masked(
 					}
 				}
 		);
+
+		dst_buffer.erase_voxel_sparse_values_if(
+				[dst_box, &src_buffer, src_mask_channel, src_mask_value, dst_base_pos](Vector3i pos, uint32_t value) {
+					return dst_box.contains(pos) &&
+							src_buffer.get_voxel(pos - dst_base_pos, src_mask_channel) != src_mask_value;
+				}
+		);
+
+		src_buffer.for_each_voxel_sparse_value_in_area(
+				src_box,
+				[&src_buffer, src_mask_channel, src_mask_value, &dst_buffer, dst_box, dst_base_pos](
+						Vector3i src_pos, uint32_t value
+				) {
+					const Vector3i dst_pos = src_pos + dst_base_pos;
+					if (dst_box.contains(dst_pos) &&
+						src_buffer.get_voxel(src_pos, src_mask_channel) != src_mask_value) {
+						dst_buffer.set_voxel_sparse_value(dst_pos, value);
+					}
+				}
+		);
 	}
 }
 
@@ -1429,6 +2985,38 @@ void paste_src_masked_dst_predicate(
 					}
 				}
 		);
+
+		dst_buffer.erase_voxel_sparse_values_if([&src_buffer,
+												 src_mask_channel,
+												 src_mask_value,
+												 dst_box,
+												 dst_base_pos,
+												 &dst_buffer,
+												 dst_mask_channel,
+												 &dst_predicate](Vector3i pos, uint32_t value) {
+			return dst_box.contains(pos) //
+					&& src_buffer.get_voxel(pos - dst_base_pos, src_mask_channel) != src_mask_value //
+					&& dst_predicate(dst_buffer.get_voxel(pos, dst_mask_channel));
+		});
+
+		src_buffer.for_each_voxel_sparse_value_in_area(
+				src_box,
+				[&src_buffer,
+				 src_mask_channel,
+				 src_mask_value,
+				 &dst_buffer,
+				 dst_box,
+				 dst_base_pos,
+				 dst_mask_channel,
+				 &dst_predicate](Vector3i src_pos, uint32_t value) {
+					const Vector3i dst_pos = src_pos + dst_base_pos;
+					if (dst_box.contains(dst_pos) //
+						&& src_buffer.get_voxel(src_pos, src_mask_channel) != src_mask_value //
+						&& dst_predicate(dst_buffer.get_voxel(dst_pos, dst_mask_channel))) {
+						dst_buffer.set_voxel_sparse_value(dst_pos, value);
+					}
+				}
+		);
 	}
 }
 
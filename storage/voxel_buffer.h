@@ -7,7 +7,9 @@
 #include "../util/math/box3i.h"
 #include "funcs.h"
 #include "metadata/voxel_metadata.h"
+#include "metadata/voxel_sparse_values.h"
 
+#include <atomic>
 #include <limits>
 
 namespace zylann {
@@ -39,6 +41,13 @@ public:
 	enum Compression : uint8_t {
 		COMPRESSION_NONE = 0,
 		COMPRESSION_UNIFORM, // aka "no voxels allocated"
+		// Small list of distinct values, and voxels store bit-packed indices into that list.
+		// Only allocated channels can use it.
+		COMPRESSION_PALETTE,
+		// Voxels are split in cubic bricks, each of which is either uniform or dense. Only dense bricks store
+		// individual voxels. Suited to SDF data where the surface only crosses a small part of the buffer.
+		// Only allocated channels can use it.
+		COMPRESSION_BRICKS,
 		COMPRESSION_COUNT
 	};
 
@@ -94,6 +103,19 @@ public:
 	// Limit was made explicit for serialization reasons, and also because there must be a reasonable one
 	static const uint32_t MAX_SIZE = 65535;
 
+	// Palette indices are packed with power-of-two bit counts so they never straddle bytes.
+	static const uint32_t MAX_PALETTE_INDEX_BITS = 8;
+	static const uint32_t MAX_PALETTE_SIZE = 1 << MAX_PALETTE_INDEX_BITS;
+
+	// Bricks can be 4x4x4 or 8x8x8 voxels.
+	static const uint32_t MIN_BRICK_SIZE_PO2 = 2;
+	static const uint32_t MAX_BRICK_SIZE_PO2 = 3;
+	// Marks a brick as uniform in the brick table
+	static const uint16_t BRICK_UNIFORM = 0xffff;
+
+	// Reference count of channel data shared by several buffers. See `Channel::shared`.
+	struct SharedChannelData;
+
 	struct Channel {
 		union {
 			// Allocated when the channel is populated.
@@ -107,12 +129,48 @@ public:
 
 		Depth depth = DEFAULT_CHANNEL_DEPTH;
 		Compression compression = COMPRESSION_UNIFORM;
-		// [...] 2 unused bytes
+
+		// Only relevant with COMPRESSION_PALETTE.
+		// `data` then starts with `1 << palette_index_bits` palette entries of `depth` size, followed by packed
+		// indices in ZXY order.
+		uint8_t palette_index_bits = 0;
+		// Index of the last used palette entry (so the palette has `palette_last_index + 1` entries)
+		uint8_t palette_last_index = 0;
+
+		// Only relevant with COMPRESSION_BRICKS.
+		// `data` then starts with one `uint16_t` slot per brick (in ZXY order, `BRICK_UNIFORM` if the brick is
+		// uniform), followed by one value per brick (used if the brick is uniform), followed by dense bricks. Each
+		// section starts at an 8-byte boundary. Dense bricks are always full cubes, even where they overlap the end of
+		// the buffer.
+		uint8_t brick_size_po2 = 0;
 
 		// Storing gigabytes in a single buffer is neither supported nor practical.
 		uint32_t size_in_bytes = 0;
 
 		static const size_t MAX_SIZE_IN_BYTES = std::numeric_limits<uint32_t>::max();
+
+		// Set when `data` may be shared with other buffers, after copying a whole channel. Shared data is
+		// read-only: the first write duplicates it (copy-on-write). Created by the first copy, which can happen from
+		// several threads reading the same buffer at once, hence `mutable` and atomic.
+		mutable std::atomic<SharedChannelData *> shared = { nullptr };
+
+		Channel() {}
+
+		Channel(const Channel &other) {
+			*this = other;
+		}
+
+		Channel &operator=(const Channel &other) {
+			defval = other.defval;
+			depth = other.depth;
+			compression = other.compression;
+			palette_index_bits = other.palette_index_bits;
+			palette_last_index = other.palette_last_index;
+			brick_size_po2 = other.brick_size_po2;
+			size_in_bytes = other.size_in_bytes;
+			shared.store(other.shared.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return *this;
+		}
 	};
 
 	// VoxelBuffer();
@@ -172,6 +230,88 @@ public:
 	void decompress_channel(unsigned int channel_index);
 	Compression get_channel_compression(unsigned int channel_index) const;
 
+	// Gets how many bytes are allocated to store voxels of all channels. Data shared with other buffers is included.
+	size_t get_channels_size_in_bytes() const;
+	// Gets how many bytes are allocated to store voxels of one channel. Data shared with other buffers is included.
+	size_t get_channel_size_in_bytes(unsigned int channel_index) const;
+
+	// Palette compression.
+	// A channel holding few distinct values can be stored as a small palette plus bit-packed indices. Getters,
+	// setters and area functions keep working on it directly, and the palette grows when new values are written.
+	// If it can't grow anymore, the channel is decompressed. Functions giving raw access to voxel data will
+	// decompress it too.
+
+	// Converts an allocated channel to palette compression. Returns false if the channel has too many distinct values
+	// or if it would not save memory (uniform channels are left untouched).
+	bool compress_channel_to_palette(unsigned int channel_index);
+	void compress_palette_channels();
+
+	unsigned int get_channel_palette_size(unsigned int channel_index) const;
+	unsigned int get_channel_palette_index_bits(unsigned int channel_index) const;
+	uint64_t get_channel_palette_value(unsigned int channel_index, unsigned int palette_index) const;
+	bool get_channel_palette_indices_read_only(unsigned int channel_index, Span<const uint8_t> &out_indices) const;
+
+	// Replaces a channel with a palette-compressed one. Indices are left for the caller to fill.
+	bool create_channel_palette(
+			unsigned int channel_index,
+			Span<const uint64_t> palette,
+			unsigned int index_bits,
+			Span<uint8_t> &out_indices
+	);
+
+	static size_t get_palette_indices_size_in_bytes(uint64_t volume, unsigned int index_bits);
+	static unsigned int get_max_palette_index_bits(Depth depth);
+
+	static inline unsigned int get_packed_palette_index(const uint8_t *indices, size_t i, unsigned int index_bits) {
+		const size_t bit_pos = i * index_bits;
+		return (indices[bit_pos >> 3] >> (bit_pos & 7)) & ((1 << index_bits) - 1);
+	}
+
+	// Brick compression.
+	// A channel can be split into cubic bricks each stored either as a single value, or densely. It saves memory when
+	// only a small part of the channel has variations. Getters and setters work on it directly, area functions and
+	// raw access decompress it.
+
+	// Converts an allocated channel to brick compression. Returns false if that would not save memory (uniform
+	// channels are left untouched).
+	bool compress_channel_to_bricks(unsigned int channel_index, unsigned int brick_size_po2);
+	// Picks a brick size keeping the brick table small compared to the voxels it describes.
+	static unsigned int get_default_brick_size_po2(Vector3i size);
+
+	unsigned int get_channel_brick_size_po2(unsigned int channel_index) const;
+	Vector3i get_channel_brick_grid_size(unsigned int channel_index) const;
+	// Returns true if the brick at the given brick position is uniform, and outputs its value.
+	// Channels that are not using brick compression are considered to be one big brick.
+	bool get_channel_brick_uniform_value(unsigned int channel_index, Vector3i brick_pos, uint64_t &out_value) const;
+	unsigned int get_channel_dense_brick_count(unsigned int channel_index) const;
+
+	// Gives access to the sections of a brick channel:
+	// - Slots: one per brick, in ZXY order. Either an index into dense bricks, or `BRICK_UNIFORM`.
+	// - Uniform values: one per brick, with the depth of the channel.
+	// - Dense bricks: one after the other, each in ZXY order.
+	bool get_channel_bricks_read_only(
+			unsigned int channel_index,
+			Span<const uint16_t> &out_slots,
+			Span<const uint8_t> &out_uniform_values,
+			Span<const uint8_t> &out_dense_bricks
+	) const;
+
+	// Replaces a channel with a brick-compressed one. Its sections are left for the caller to fill.
+	bool create_channel_bricks(
+			unsigned int channel_index,
+			unsigned int brick_size_po2,
+			unsigned int dense_brick_count,
+			Span<uint16_t> &out_slots,
+			Span<uint8_t> &out_uniform_values,
+			Span<uint8_t> &out_dense_bricks
+	);
+
+	static Vector3i get_brick_grid_size(Vector3i size, unsigned int brick_size_po2);
+
+	// Decompresses the whole channel into a dense buffer, in ZXY order, whatever its compression is.
+	// `dst` must be at least `get_size_in_bytes_for_volume(get_size(), depth)` long.
+	void decompress_channel_to(unsigned int channel_index, Span<uint8_t> dst) const;
+
 	static size_t get_size_in_bytes_for_volume(Vector3i size, Depth depth);
 
 	void copy_format(const VoxelBuffer &other);
@@ -179,6 +319,8 @@ public:
 	// Specialized copy functions.
 	// Note: these functions don't include metadata on purpose.
 	// If you also want to copy metadata, use the specialized functions.
+	// Copying whole channels doesn't duplicate their data, it gets shared until one of the buffers is modified.
+	// So raw pointers obtained with `get_channel_as_bytes` must not be written to after the buffer was copied.
 	// TODO Rename `copy_channels_from`
 	void copy_channels_from(const VoxelBuffer &other);
 	void copy_channel_from(const VoxelBuffer &other, unsigned int channel_index);
@@ -245,6 +387,14 @@ public:
 
 		if (channel.compression == COMPRESSION_UNIFORM) {
 			fill_3d_region_zxy<T>(dst, dst_size, dst_min, dst_min + (src_max - src_min), channel.defval);
+		} else if (channel.compression == COMPRESSION_PALETTE) {
+			copy_palette_channel_to(
+					dst.template reinterpret_cast_to<uint8_t>(), dst_size, dst_min, src_min, src_max, channel
+			);
+		} else if (channel.compression == COMPRESSION_BRICKS) {
+			copy_brick_channel_to(
+					dst.template reinterpret_cast_to<uint8_t>(), dst_size, dst_min, src_min, src_max, channel
+			);
 		} else {
 			Span<const T> src(static_cast<const T *>(channel.data), channel.size_in_bytes / sizeof(T));
 			copy_3d_region_zxy<T>(dst, dst_size, dst_min, src, _size, src_min, src_max);
@@ -454,7 +604,25 @@ public:
 		return true;
 	}
 
-	void downscale_to(VoxelBuffer &dst, Vector3i src_min, Vector3i src_max, Vector3i dst_min) const;
+	void downscale_to(
+			VoxelBuffer &dst,
+			Vector3i src_min,
+			Vector3i src_max,
+			Vector3i dst_min,
+			uint32_t channels_mask = ALL_CHANNELS_MASK
+	) const;
+
+	// Same as `downscale_to` for one channel, except each destination voxel takes the most common non-zero value among
+	// the 8 voxels it covers. Values are first replaced with `replacements[value]` if they are within its size.
+	// Channels deeper than 16 bits are downscaled like `downscale_to`.
+	void downscale_majority_to(
+			VoxelBuffer &dst,
+			Vector3i src_min,
+			Vector3i src_max,
+			Vector3i dst_min,
+			unsigned int channel_index,
+			Span<const uint16_t> replacements
+	) const;
 
 	bool equals(const VoxelBuffer &p_other) const;
 
@@ -466,6 +634,20 @@ public:
 	// This returns that scale for a given depth configuration.
 	static float get_sdf_quantization_scale(Depth d);
 
+	// Factor applied on top of the quantization scale of the SDF channel, when it uses 8 or 16 bits. Lower values allow
+	// to store larger distances, at the cost of precision. It is part of the format of the buffer, so it is not reset
+	// by `create`, and changing it doesn't convert voxels that were already stored.
+	void set_sdf_quantization_factor(float factor);
+	inline float get_sdf_quantization_factor() const {
+		return _sdf_quantization_factor;
+	}
+	// Scale distances must be multiplied by before being quantized into the SDF channel of this buffer.
+	float get_sdf_channel_quantization_scale() const;
+
+	// Factor used for the SDF of blocks generated at a given LOD. Distances between voxels double with each LOD, so the
+	// range of stored distances does too, which keeps them from saturating in 8-bit or 16-bit.
+	static float get_sdf_quantization_factor_for_lod(unsigned int lod_index);
+
 	void get_range_f(float &out_min, float &out_max, ChannelId channel_index) const;
 
 	// Metadata
@@ -517,6 +699,42 @@ public:
 		return _voxel_metadata;
 	}
 
+	// Sparse values are a compact kind of metadata for voxels that only need a small integer. They are treated like
+	// other metadata: copied, pasted, cleared and serialized along with it.
+
+	bool get_voxel_sparse_value(Vector3i pos, uint32_t &out_value) const;
+	void set_voxel_sparse_value(Vector3i pos, uint32_t value);
+	void erase_voxel_sparse_value(Vector3i pos);
+
+	template <typename F>
+	void for_each_voxel_sparse_value_in_area(Box3i box, F callback) const {
+		Span<const uint32_t> keys = _voxel_sparse_values.get_keys();
+		Span<const uint32_t> values = _voxel_sparse_values.get_values();
+		for (unsigned int i = 0; i < keys.size(); ++i) {
+			const Vector3i pos = Vector3iUtil::from_zxy_index(keys[i], _size);
+			if (box.contains(pos)) {
+				callback(pos, values[i]);
+			}
+		}
+	}
+
+	// Predicate takes the position of the voxel and its value
+	template <typename F>
+	inline void erase_voxel_sparse_values_if(F predicate) {
+		const Vector3i size = _size;
+		_voxel_sparse_values.remove_if([size, &predicate](uint32_t key, uint32_t value) {
+			return predicate(Vector3iUtil::from_zxy_index(key, size), value);
+		});
+	}
+
+	// Keys are ZXY indices of voxels
+	const VoxelSparseValues &get_voxel_sparse_values() const {
+		return _voxel_sparse_values;
+	}
+	VoxelSparseValues &get_voxel_sparse_values() {
+		return _voxel_sparse_values;
+	}
+
 private:
 	void init_channel_defaults();
 	bool create_channel_noinit(int i, Vector3i size);
@@ -524,8 +742,39 @@ private:
 	void delete_channel(int i);
 	void compress_if_uniform(Channel &channel);
 	static void delete_channel(Channel &channel, Allocator allocator);
+	void make_channel_data_unique(Channel &channel);
 	static void clear_channel(Channel &channel, uint64_t clear_value, Allocator allocator);
-	static bool is_uniform(const Channel &channel);
+	bool is_uniform(const Channel &channel) const;
+
+	inline float get_quantization_factor(unsigned int channel_index) const {
+		return channel_index == CHANNEL_SDF ? _sdf_quantization_factor : 1.f;
+	}
+	float get_channel_quantization_scale(unsigned int channel_index) const;
+	// Tells if copying raw SDF values from `other` would change the distances they represent
+	bool needs_sdf_requantization(const VoxelBuffer &other, unsigned int channel_index) const;
+
+	bool decompress_palette_channel(Channel &channel);
+	bool grow_palette(Channel &channel);
+	bool get_or_add_palette_index(Channel &channel, uint64_t value, unsigned int &out_index);
+	void copy_palette_channel_to(
+			Span<uint8_t> dst,
+			Vector3i dst_size,
+			Vector3i dst_min,
+			Vector3i src_min,
+			Vector3i src_max,
+			const Channel &channel
+	) const;
+
+	bool decompress_brick_channel(Channel &channel);
+	bool add_dense_brick(Channel &channel, unsigned int brick_index);
+	void copy_brick_channel_to(
+			Span<uint8_t> dst,
+			Vector3i dst_size,
+			Vector3i dst_min,
+			Vector3i src_min,
+			Vector3i src_max,
+			const Channel &channel
+	) const;
 
 private:
 	// Each channel can store arbitrary data.
@@ -535,6 +784,9 @@ private:
 	// How many voxels are there in the three directions. All populated channels have the same size.
 	Vector3i _size;
 
+	// See `set_sdf_quantization_factor`
+	float _sdf_quantization_factor = 1.f;
+
 	// Which allocator will be used when storing individual voxels is needed.
 	// The default is the least likely to be misused, though not necessarily the fastest.
 	Allocator _allocator = ALLOCATOR_DEFAULT;
@@ -543,10 +795,11 @@ private:
 	VoxelMetadata _block_metadata;
 	// This metadata is expected to be sparse, with low amount of items.
 	FlatMapMoveOnly<Vector3i, VoxelMetadata> _voxel_metadata;
+	VoxelSparseValues _voxel_sparse_values;
 };
 
 void get_unscaled_sdf(const VoxelBuffer &voxels, Span<float> sdf);
-void scale_and_store_sdf(VoxelBuffer &voxels, Span<float> sdf);
+void scale_and_store_sdf(VoxelBuffer &voxels, Span<const float> sdf);
 void scale_and_store_sdf_if_modified(VoxelBuffer &voxels, Span<float> sdf, Span<const float> comparand);
 
 void paste(
@@ -2,6 +2,7 @@
 #include "../edition/voxel_tool_buffer.h"
 #include "../util/dstack.h"
 #include "../util/godot/classes/image.h"
+#include "../util/godot/core/packed_arrays.h"
 #include "../util/math/color.h"
 #include "../util/memory/memory.h"
 #include "../util/string/format.h"
@@ -9,6 +10,14 @@
 
 namespace zylann::voxel {
 
+// Scale applied to values of a channel before quantizing them, the same way as `get_voxel_f` and `set_voxel_f`
+float get_quantization_scale(const VoxelBuffer &buffer, VoxelBuffer::ChannelId channel) {
+	if (channel == VoxelBuffer::CHANNEL_SDF) {
+		return buffer.get_sdf_channel_quantization_scale();
+	}
+	return VoxelBuffer::get_sdf_quantization_scale(buffer.get_channel_depth(channel));
+}
+
 template <typename F>
 void op_buffer_value_f(
 		VoxelBuffer &dst,
@@ -22,13 +31,16 @@ void op_buffer_value_f(
 		return;
 	}
 
+	const float scale = get_quantization_scale(dst, channel);
+	const float inv_scale = 1.f / scale;
+
 	switch (dst.get_channel_depth(channel)) {
 		case VoxelBuffer::DEPTH_8_BIT: {
 			Span<int8_t> dst_data;
 			ZN_ASSERT(dst.get_channel_data(channel, dst_data));
 			for (int8_t &d : dst_data) {
-				const float a = s8_to_snorm(d) * constants::QUANTIZED_SDF_8_BITS_SCALE_INV;
-				d = snorm_to_s8(f(a, b) * constants::QUANTIZED_SDF_8_BITS_SCALE);
+				const float a = s8_to_snorm(d) * inv_scale;
+				d = snorm_to_s8(f(a, b) * scale);
 			}
 		} break;
 
@@ -36,8 +48,8 @@ void op_buffer_value_f(
 			Span<int16_t> dst_data;
 			ZN_ASSERT(dst.get_channel_data(channel, dst_data));
 			for (int16_t &d : dst_data) {
-				const float a = s16_to_snorm(d) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
-				d = snorm_to_s16(f(a, b) * constants::QUANTIZED_SDF_16_BITS_SCALE);
+				const float a = s16_to_snorm(d) * inv_scale;
+				d = snorm_to_s16(f(a, b) * scale);
 			}
 		} break;
 
@@ -72,10 +84,25 @@ void op_buffer_buffer_f(
 		return;
 	}
 
+	if (src.get_channel_compression(channel) != zylann::voxel::VoxelBuffer::COMPRESSION_NONE) {
+		// Other compressions can't be read directly, work on a decompressed copy instead
+		VoxelBuffer src_dense(VoxelBuffer::ALLOCATOR_DEFAULT);
+		src_dense.create(src.get_size());
+		src_dense.copy_channel_from(src, channel);
+		src_dense.decompress_channel(channel);
+		op_buffer_buffer_f(dst, src_dense, channel, f);
+		return;
+	}
+
 	if (dst.get_channel_compression(channel) == zylann::voxel::VoxelBuffer::COMPRESSION_UNIFORM) {
 		dst.decompress_channel(channel);
 	}
 
+	// Buffers may use different quantization factors
+	const float dst_scale = get_quantization_scale(dst, channel);
+	const float dst_inv_scale = 1.f / dst_scale;
+	const float src_inv_scale = 1.f / get_quantization_scale(src, channel);
+
 	switch (src.get_channel_depth(channel)) {
 		case VoxelBuffer::DEPTH_8_BIT: {
 			Span<const int8_t> src_data;
@@ -83,9 +110,9 @@ void op_buffer_buffer_f(
 			ZN_ASSERT(src.get_channel_data_read_only(channel, src_data));
 			ZN_ASSERT(dst.get_channel_data(channel, dst_data));
 			for (unsigned int i = 0; i < src_data.size(); ++i) {
-				const float a = s8_to_snorm(dst_data[i]) * constants::QUANTIZED_SDF_8_BITS_SCALE_INV;
-				const float b = s8_to_snorm(src_data[i]) * constants::QUANTIZED_SDF_8_BITS_SCALE_INV;
-				dst_data[i] = snorm_to_s8(f(a, b) * constants::QUANTIZED_SDF_8_BITS_SCALE);
+				const float a = s8_to_snorm(dst_data[i]) * dst_inv_scale;
+				const float b = s8_to_snorm(src_data[i]) * src_inv_scale;
+				dst_data[i] = snorm_to_s8(f(a, b) * dst_scale);
 			}
 		} break;
 
@@ -95,9 +122,9 @@ void op_buffer_buffer_f(
 			ZN_ASSERT(src.get_channel_data_read_only(channel, src_data));
 			ZN_ASSERT(dst.get_channel_data(channel, dst_data));
 			for (unsigned int i = 0; i < src_data.size(); ++i) {
-				const float a = s16_to_snorm(dst_data[i]) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
-				const float b = s16_to_snorm(src_data[i]) * constants::QUANTIZED_SDF_16_BITS_SCALE_INV;
-				dst_data[i] = snorm_to_s16(f(a, b) * constants::QUANTIZED_SDF_16_BITS_SCALE);
+				const float a = s16_to_snorm(dst_data[i]) * dst_inv_scale;
+				const float b = s16_to_snorm(src_data[i]) * src_inv_scale;
+				dst_data[i] = snorm_to_s16(f(a, b) * dst_scale);
 			}
 		} break;
 
@@ -121,6 +148,134 @@ void op_buffer_buffer_f(
 	}
 }
 
+// Copies a box of a channel into a dense array of raw values in ZXY order, whatever the compression of the channel.
+void copy_channel_area_to_bytes(const VoxelBuffer &src, Box3i box, unsigned int channel, Span<uint8_t> dst) {
+	if (box.position == Vector3i() && box.size == src.get_size()) {
+		src.decompress_channel_to(channel, dst);
+		return;
+	}
+	const Vector3i src_max = box.position + box.size;
+	switch (src.get_channel_depth(channel)) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			src.copy_channel_to(dst, box.size, Vector3i(), box.position, src_max, channel);
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			src.copy_channel_to(
+					dst.reinterpret_cast_to<uint16_t>(), box.size, Vector3i(), box.position, src_max, channel
+			);
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			src.copy_channel_to(
+					dst.reinterpret_cast_to<uint32_t>(), box.size, Vector3i(), box.position, src_max, channel
+			);
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			src.copy_channel_to(
+					dst.reinterpret_cast_to<uint64_t>(), box.size, Vector3i(), box.position, src_max, channel
+			);
+			break;
+		default:
+			ZN_CRASH();
+			break;
+	}
+}
+
+// Copies a dense array of raw values in ZXY order into a box of a channel. The channel gets decompressed.
+void copy_bytes_to_channel_area(VoxelBuffer &dst, Box3i box, unsigned int channel, Span<const uint8_t> src) {
+	switch (dst.get_channel_depth(channel)) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			dst.copy_channel_from(src, box.size, Vector3i(), box.size, box.position, channel);
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			dst.copy_channel_from(
+					src.reinterpret_cast_to<const uint16_t>(), box.size, Vector3i(), box.size, box.position, channel
+			);
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			dst.copy_channel_from(
+					src.reinterpret_cast_to<const uint32_t>(), box.size, Vector3i(), box.size, box.position, channel
+			);
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			dst.copy_channel_from(
+					src.reinterpret_cast_to<const uint64_t>(), box.size, Vector3i(), box.size, box.position, channel
+			);
+			break;
+		default:
+			ZN_CRASH();
+			break;
+	}
+}
+
+// Converts raw values to floats the same way as `get_voxel_f`
+void raw_values_to_floats(Span<const uint8_t> src, VoxelBuffer::Depth depth, float scale, Span<float> dst) {
+	const float inv_scale = 1.f / scale;
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT: {
+			Span<const int8_t> src_data = src.reinterpret_cast_to<const int8_t>();
+			for (unsigned int i = 0; i < src_data.size(); ++i) {
+				dst[i] = s8_to_snorm(src_data[i]) * inv_scale;
+			}
+		} break;
+
+		case VoxelBuffer::DEPTH_16_BIT: {
+			Span<const int16_t> src_data = src.reinterpret_cast_to<const int16_t>();
+			for (unsigned int i = 0; i < src_data.size(); ++i) {
+				dst[i] = s16_to_snorm(src_data[i]) * inv_scale;
+			}
+		} break;
+
+		case VoxelBuffer::DEPTH_32_BIT:
+			memcpy(dst.data(), src.data(), src.size());
+			break;
+
+		case VoxelBuffer::DEPTH_64_BIT: {
+			Span<const double> src_data = src.reinterpret_cast_to<const double>();
+			for (unsigned int i = 0; i < src_data.size(); ++i) {
+				dst[i] = src_data[i];
+			}
+		} break;
+
+		default:
+			ZN_CRASH();
+			break;
+	}
+}
+
+// Converts floats to raw values the same way as `set_voxel_f`
+void floats_to_raw_values(Span<const float> src, VoxelBuffer::Depth depth, float scale, Span<uint8_t> dst) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT: {
+			Span<int8_t> dst_data = dst.reinterpret_cast_to<int8_t>();
+			for (unsigned int i = 0; i < src.size(); ++i) {
+				dst_data[i] = snorm_to_s8(src[i] * scale);
+			}
+		} break;
+
+		case VoxelBuffer::DEPTH_16_BIT: {
+			Span<int16_t> dst_data = dst.reinterpret_cast_to<int16_t>();
+			for (unsigned int i = 0; i < src.size(); ++i) {
+				dst_data[i] = snorm_to_s16(src[i] * scale);
+			}
+		} break;
+
+		case VoxelBuffer::DEPTH_32_BIT:
+			memcpy(dst.data(), src.data(), dst.size());
+			break;
+
+		case VoxelBuffer::DEPTH_64_BIT: {
+			Span<double> dst_data = dst.reinterpret_cast_to<double>();
+			for (unsigned int i = 0; i < src.size(); ++i) {
+				dst_data[i] = src[i];
+			}
+		} break;
+
+		default:
+			ZN_CRASH();
+			break;
+	}
+}
+
 } // namespace zylann::voxel
 
 namespace zylann::voxel::godot {
@@ -222,6 +377,10 @@ void VoxelBuffer::compress_uniform_channels() {
 	_buffer->compress_uniform_channels();
 }
 
+void VoxelBuffer::compress_palette_channels() {
+	_buffer->compress_palette_channels();
+}
+
 VoxelBuffer::Compression VoxelBuffer::get_channel_compression(int channel_index) const {
 	ERR_FAIL_INDEX_V(channel_index, MAX_CHANNELS, VoxelBuffer::COMPRESSION_NONE);
 	return VoxelBuffer::Compression(_buffer->get_channel_compression(channel_index));
@@ -303,6 +462,122 @@ void VoxelBuffer::remap_values(unsigned int channel_index, PackedInt32Array map)
 	}
 }
 
+PackedByteArray VoxelBuffer::get_channel_as_byte_array(unsigned int channel_index) const {
+	return get_channel_area_as_byte_array(Vector3i(), get_size(), channel_index);
+}
+
+void VoxelBuffer::set_channel_from_byte_array(PackedByteArray data, unsigned int channel_index) {
+	set_channel_area_from_byte_array(data, Vector3i(), get_size(), channel_index);
+}
+
+PackedFloat32Array VoxelBuffer::get_channel_as_float_array(unsigned int channel_index) const {
+	return get_channel_area_as_float_array(Vector3i(), get_size(), channel_index);
+}
+
+void VoxelBuffer::set_channel_from_float_array(PackedFloat32Array values, unsigned int channel_index) {
+	set_channel_area_from_float_array(values, Vector3i(), get_size(), channel_index);
+}
+
+PackedByteArray VoxelBuffer::get_channel_area_as_byte_array(
+		Vector3i min_pos,
+		Vector3i max_pos,
+		unsigned int channel_index
+) const {
+	ZN_DSTACK();
+	PackedByteArray data;
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, data);
+	const Box3i box = Box3i::from_min_max(min_pos, max_pos);
+	ZN_ASSERT_RETURN_V(Vector3iUtil::is_valid_size(box.size) && _buffer->is_box_valid(box), data);
+
+	const zylann::voxel::VoxelBuffer::Depth depth = _buffer->get_channel_depth(channel_index);
+	data.resize(zylann::voxel::VoxelBuffer::get_size_in_bytes_for_volume(box.size, depth));
+	copy_channel_area_to_bytes(*_buffer, box, channel_index, Span<uint8_t>(data.ptrw(), data.size()));
+	return data;
+}
+
+void VoxelBuffer::set_channel_area_from_byte_array(
+		PackedByteArray data,
+		Vector3i min_pos,
+		Vector3i max_pos,
+		unsigned int channel_index
+) {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
+	const Box3i box = Box3i::from_min_max(min_pos, max_pos);
+	ZN_ASSERT_RETURN(Vector3iUtil::is_valid_size(box.size) && _buffer->is_box_valid(box));
+
+	const zylann::voxel::VoxelBuffer::Depth depth = _buffer->get_channel_depth(channel_index);
+	const size_t expected_size = zylann::voxel::VoxelBuffer::get_size_in_bytes_for_volume(box.size, depth);
+	ZN_ASSERT_RETURN_MSG(
+			static_cast<size_t>(data.size()) == expected_size,
+			format("Expected {} bytes, got {}", expected_size, data.size())
+	);
+	copy_bytes_to_channel_area(*_buffer, box, channel_index, to_span(data));
+}
+
+PackedFloat32Array VoxelBuffer::get_channel_area_as_float_array(
+		Vector3i min_pos,
+		Vector3i max_pos,
+		unsigned int channel_index
+) const {
+	ZN_DSTACK();
+	PackedFloat32Array values;
+	ZN_ASSERT_RETURN_V(channel_index < MAX_CHANNELS, values);
+	const Box3i box = Box3i::from_min_max(min_pos, max_pos);
+	ZN_ASSERT_RETURN_V(Vector3iUtil::is_valid_size(box.size) && _buffer->is_box_valid(box), values);
+
+	values.resize(Vector3iUtil::get_volume(box.size));
+	Span<float> values_w(values.ptrw(), values.size());
+
+	const zylann::voxel::VoxelBuffer::Depth depth = _buffer->get_channel_depth(channel_index);
+	if (depth == zylann::voxel::VoxelBuffer::DEPTH_32_BIT) {
+		// Values are already floats, copy them directly
+		copy_channel_area_to_bytes(*_buffer, box, channel_index, values_w.reinterpret_cast_to<uint8_t>());
+	} else {
+		StdVector<uint8_t> raw_values;
+		raw_values.resize(zylann::voxel::VoxelBuffer::get_size_in_bytes_for_volume(box.size, depth));
+		copy_channel_area_to_bytes(*_buffer, box, channel_index, to_span(raw_values));
+		raw_values_to_floats(
+				to_span(raw_values),
+				depth,
+				get_quantization_scale(*_buffer, static_cast<zylann::voxel::VoxelBuffer::ChannelId>(channel_index)),
+				values_w
+		);
+	}
+	return values;
+}
+
+void VoxelBuffer::set_channel_area_from_float_array(
+		PackedFloat32Array values,
+		Vector3i min_pos,
+		Vector3i max_pos,
+		unsigned int channel_index
+) {
+	ZN_DSTACK();
+	ZN_ASSERT_RETURN(channel_index < MAX_CHANNELS);
+	const Box3i box = Box3i::from_min_max(min_pos, max_pos);
+	ZN_ASSERT_RETURN(Vector3iUtil::is_valid_size(box.size) && _buffer->is_box_valid(box));
+
+	const int64_t volume = Vector3iUtil::get_volume(box.size);
+	ZN_ASSERT_RETURN_MSG(values.size() == volume, format("Expected {} values, got {}", volume, values.size()));
+
+	const zylann::voxel::VoxelBuffer::Depth depth = _buffer->get_channel_depth(channel_index);
+	if (depth == zylann::voxel::VoxelBuffer::DEPTH_32_BIT) {
+		// Values are already floats, copy them directly
+		copy_bytes_to_channel_area(*_buffer, box, channel_index, to_span(values).reinterpret_cast_to<const uint8_t>());
+	} else {
+		StdVector<uint8_t> raw_values;
+		raw_values.resize(zylann::voxel::VoxelBuffer::get_size_in_bytes_for_volume(box.size, depth));
+		floats_to_raw_values(
+				to_span(values),
+				depth,
+				get_quantization_scale(*_buffer, static_cast<zylann::voxel::VoxelBuffer::ChannelId>(channel_index)),
+				to_span(raw_values)
+		);
+		copy_bytes_to_channel_area(*_buffer, box, channel_index, to_span(raw_values));
+	}
+}
+
 VoxelBuffer::Allocator VoxelBuffer::get_allocator() const {
 	return static_cast<VoxelBuffer::Allocator>(_buffer->get_allocator());
 }
@@ -406,13 +681,17 @@ void VoxelBuffer::op_select_less_src_f_dst_i_values(
 	// Optimizable, but a bit too many combinations of formats than it's worth.
 	// If necessary, only optimize common formats.
 
+	const zylann::voxel::VoxelBuffer::Compression src_compression = src.get_channel_compression(src_channel);
+
 	if (src.get_channel_depth(src_channel) == zylann::voxel::VoxelBuffer::DEPTH_32_BIT &&
-		dst.get_channel_depth(dst_channel) == zylann::voxel::VoxelBuffer::DEPTH_16_BIT) {
+		dst.get_channel_depth(dst_channel) == zylann::voxel::VoxelBuffer::DEPTH_16_BIT &&
+		(src_compression == zylann::voxel::VoxelBuffer::COMPRESSION_NONE ||
+		 src_compression == zylann::voxel::VoxelBuffer::COMPRESSION_UNIFORM)) {
 		//
 		const uint16_t value_if_less_16 = math::clamp(value_if_less, 0, 65535);
 		const uint16_t value_if_more_16 = math::clamp(value_if_more, 0, 65535);
 
-		if (src.get_channel_compression(src_channel) == zylann::voxel::VoxelBuffer::COMPRESSION_UNIFORM) {
+		if (src_compression == zylann::voxel::VoxelBuffer::COMPRESSION_UNIFORM) {
 			const float src_v = src.get_voxel_f(0, 0, 0, src_channel);
 			const int16_t dst_v = select_less(src_v, threshold, value_if_less, value_if_more);
 			dst.fill(dst_v, dst_channel);
@@ -674,11 +953,37 @@ void VoxelBuffer::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("is_uniform", "channel"), &VoxelBuffer::is_uniform);
 	ClassDB::bind_method(D_METHOD("compress_uniform_channels"), &VoxelBuffer::compress_uniform_channels);
+	ClassDB::bind_method(D_METHOD("compress_palette_channels"), &VoxelBuffer::compress_palette_channels);
 	ClassDB::bind_method(D_METHOD("get_channel_compression", "channel"), &VoxelBuffer::get_channel_compression);
 	ClassDB::bind_method(D_METHOD("decompress_channel", "channel"), &VoxelBuffer::decompress_channel);
 
 	ClassDB::bind_method(D_METHOD("remap_values", "channel", "map"), &VoxelBuffer::remap_values);
 
+	ClassDB::bind_method(D_METHOD("get_channel_as_byte_array", "channel"), &VoxelBuffer::get_channel_as_byte_array);
+	ClassDB::bind_method(
+			D_METHOD("set_channel_from_byte_array", "data", "channel"), &VoxelBuffer::set_channel_from_byte_array
+	);
+	ClassDB::bind_method(D_METHOD("get_channel_as_float_array", "channel"), &VoxelBuffer::get_channel_as_float_array);
+	ClassDB::bind_method(
+			D_METHOD("set_channel_from_float_array", "values", "channel"), &VoxelBuffer::set_channel_from_float_array
+	);
+	ClassDB::bind_method(
+			D_METHOD("get_channel_area_as_byte_array", "min_pos", "max_pos", "channel"),
+			&VoxelBuffer::get_channel_area_as_byte_array
+	);
+	ClassDB::bind_method(
+			D_METHOD("set_channel_area_from_byte_array", "data", "min_pos", "max_pos", "channel"),
+			&VoxelBuffer::set_channel_area_from_byte_array
+	);
+	ClassDB::bind_method(
+			D_METHOD("get_channel_area_as_float_array", "min_pos", "max_pos", "channel"),
+			&VoxelBuffer::get_channel_area_as_float_array
+	);
+	ClassDB::bind_method(
+			D_METHOD("set_channel_area_from_float_array", "values", "min_pos", "max_pos", "channel"),
+			&VoxelBuffer::set_channel_area_from_float_array
+	);
+
 	ClassDB::bind_method(D_METHOD("op_add_buffer_f", "other", "channel"), &VoxelBuffer::op_add_buffer_f);
 	ClassDB::bind_method(D_METHOD("op_sub_buffer_f", "other", "channel"), &VoxelBuffer::op_sub_buffer_f);
 	ClassDB::bind_method(D_METHOD("op_mul_buffer_f", "other", "channel"), &VoxelBuffer::op_mul_buffer_f);
@@ -737,6 +1042,8 @@ void VoxelBuffer::_bind_methods() {
 
 	BIND_ENUM_CONSTANT(COMPRESSION_NONE);
 	BIND_ENUM_CONSTANT(COMPRESSION_UNIFORM);
+	BIND_ENUM_CONSTANT(COMPRESSION_PALETTE);
+	BIND_ENUM_CONSTANT(COMPRESSION_BRICKS);
 	BIND_ENUM_CONSTANT(COMPRESSION_COUNT);
 
 	BIND_ENUM_CONSTANT(ALLOCATOR_DEFAULT);
@@ -43,6 +43,8 @@ public:
 	enum Compression {
 		COMPRESSION_NONE = zylann::voxel::VoxelBuffer::COMPRESSION_NONE,
 		COMPRESSION_UNIFORM = zylann::voxel::VoxelBuffer::COMPRESSION_UNIFORM,
+		COMPRESSION_PALETTE = zylann::voxel::VoxelBuffer::COMPRESSION_PALETTE,
+		COMPRESSION_BRICKS = zylann::voxel::VoxelBuffer::COMPRESSION_BRICKS,
 		// COMPRESSION_RLE,
 		COMPRESSION_COUNT = zylann::voxel::VoxelBuffer::COMPRESSION_COUNT
 	};
@@ -139,6 +141,7 @@ public:
 	bool is_uniform(int channel_index) const;
 
 	void compress_uniform_channels();
+	void compress_palette_channels();
 	Compression get_channel_compression(int channel_index) const;
 	void decompress_channel(int channel_index);
 
@@ -153,6 +156,37 @@ public:
 
 	void remap_values(unsigned int channel_index, PackedInt32Array map);
 
+	// Bulk access, with values in ZXY order. Compressed channels are decompressed in the returned copy only, while
+	// setters decompress the channel. Float variants convert values the same way as `get_voxel_f` and `set_voxel_f`.
+
+	PackedByteArray get_channel_as_byte_array(unsigned int channel_index) const;
+	void set_channel_from_byte_array(PackedByteArray data, unsigned int channel_index);
+	PackedFloat32Array get_channel_as_float_array(unsigned int channel_index) const;
+	void set_channel_from_float_array(PackedFloat32Array values, unsigned int channel_index);
+
+	PackedByteArray get_channel_area_as_byte_array(
+			Vector3i min_pos,
+			Vector3i max_pos,
+			unsigned int channel_index
+	) const;
+	void set_channel_area_from_byte_array(
+			PackedByteArray data,
+			Vector3i min_pos,
+			Vector3i max_pos,
+			unsigned int channel_index
+	);
+	PackedFloat32Array get_channel_area_as_float_array(
+			Vector3i min_pos,
+			Vector3i max_pos,
+			unsigned int channel_index
+	) const;
+	void set_channel_area_from_float_array(
+			PackedFloat32Array values,
+			Vector3i min_pos,
+			Vector3i max_pos,
+			unsigned int channel_index
+	);
+
 	// When using lower than 32-bit resolution for terrain signed distance fields,
 	// it should be scaled to better fit the range of represented values since the storage is normalized to -1..1.
 	// This returns that scale for a given depth configuration.
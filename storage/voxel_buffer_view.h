@@ -0,0 +1,202 @@
+#ifndef VOXEL_BUFFER_VIEW_H
+#define VOXEL_BUFFER_VIEW_H
+
+#include "../util/containers/span.h"
+#include "../util/containers/std_vector.h"
+#include "../util/errors.h"
+#include "../util/non_copyable.h"
+#include "voxel_buffer.h"
+
+namespace zylann::voxel {
+
+// Typed read-only access to voxels of one channel of a VoxelBuffer, for loops going through many voxels.
+// Depth and compression are resolved once when the view is initialized, instead of for every voxel like
+// `VoxelBuffer::get_voxel` does. `T` must be the unsigned integer type matching the depth of the channel.
+//
+// Voxels are indexed in ZXY order like in VoxelBuffer, so Y is the fastest-changing coordinate. Indices of neighbors
+// can be obtained by adding offsets to an index.
+// Uniform channels are read through a mask that maps every index to the same value, so reads don't need to check for
+// it. Palette and brick channels are decompressed into memory owned by the view.
+//
+// The view must not outlive the buffer, and the channel must not be modified while the view is used. Views point to
+// their own memory when the channel is uniform or compressed, so they can't be copied.
+template <typename T>
+class VoxelBufferReadView : public NonCopyable {
+public:
+	static constexpr unsigned int Y_STRIDE = 1;
+
+	// Returns false if the depth of the channel doesn't match `T`
+	bool init(const VoxelBuffer &voxels, unsigned int channel_index) {
+		const VoxelBuffer::Depth depth = VoxelBuffer::get_depth_from_size(sizeof(T));
+		ZN_ASSERT_RETURN_V(voxels.get_channel_depth(channel_index) == depth, false);
+
+		_size = voxels.get_size();
+		_x_stride = _size.y;
+		_z_stride = _size.x * _size.y;
+
+		switch (voxels.get_channel_compression(channel_index)) {
+			case VoxelBuffer::COMPRESSION_UNIFORM:
+				_uniform_value = voxels.get_voxel(Vector3i(), channel_index);
+				_data = &_uniform_value;
+				_index_mask = 0;
+				break;
+
+			case VoxelBuffer::COMPRESSION_NONE: {
+				Span<const T> data;
+				ZN_ASSERT_RETURN_V(voxels.get_channel_data_read_only(channel_index, data), false);
+				_data = data.data();
+				_index_mask = ~0u;
+			} break;
+
+			default:
+				_decompressed.resize(Vector3iUtil::get_volume(_size));
+				voxels.decompress_channel_to(
+						channel_index, to_span(_decompressed).template reinterpret_cast_to<uint8_t>()
+				);
+				_data = _decompressed.data();
+				_index_mask = ~0u;
+				break;
+		}
+		return true;
+	}
+
+	inline T get(unsigned int index) const {
+		return _data[index & _index_mask];
+	}
+
+	inline T get(Vector3i pos) const {
+		return get(get_index(pos));
+	}
+
+	inline unsigned int get_index(Vector3i pos) const {
+		return pos.y + pos.x * _x_stride + pos.z * _z_stride;
+	}
+
+	inline unsigned int get_x_stride() const {
+		return _x_stride;
+	}
+
+	inline unsigned int get_z_stride() const {
+		return _z_stride;
+	}
+
+	// Gets what to add to an index to reach a voxel at the given relative position
+	inline int get_offset(Vector3i delta) const {
+		return delta.y + delta.x * static_cast<int>(_x_stride) + delta.z * static_cast<int>(_z_stride);
+	}
+
+	inline const Vector3i &get_size() const {
+		return _size;
+	}
+
+	inline unsigned int get_volume() const {
+		return _z_stride * _size.z;
+	}
+
+	// If true, all voxels have the value at index 0
+	inline bool is_uniform() const {
+		return _index_mask == 0;
+	}
+
+private:
+	const T *_data = nullptr;
+	unsigned int _index_mask = 0;
+	unsigned int _x_stride = 0;
+	unsigned int _z_stride = 0;
+	Vector3i _size;
+	T _uniform_value = 0;
+	StdVector<T> _decompressed;
+};
+
+// Typed read and write access to voxels of one channel of a VoxelBuffer. The channel gets decompressed when the view is
+// initialized. See VoxelBufferReadView.
+template <typename T>
+class VoxelBufferWriteView {
+public:
+	static constexpr unsigned int Y_STRIDE = 1;
+
+	// Returns false if the depth of the channel doesn't match `T`
+	bool init(VoxelBuffer &voxels, unsigned int channel_index) {
+		const VoxelBuffer::Depth depth = VoxelBuffer::get_depth_from_size(sizeof(T));
+		ZN_ASSERT_RETURN_V(voxels.get_channel_depth(channel_index) == depth, false);
+		voxels.decompress_channel(channel_index);
+		ZN_ASSERT_RETURN_V(voxels.get_channel_data(channel_index, _data), false);
+		_size = voxels.get_size();
+		_x_stride = _size.y;
+		_z_stride = _size.x * _size.y;
+		return true;
+	}
+
+	inline T get(unsigned int index) const {
+		return _data[index];
+	}
+
+	inline T get(Vector3i pos) const {
+		return get(get_index(pos));
+	}
+
+	inline void set(unsigned int index, T value) {
+		_data[index] = value;
+	}
+
+	inline void set(Vector3i pos, T value) {
+		set(get_index(pos), value);
+	}
+
+	inline unsigned int get_index(Vector3i pos) const {
+		return pos.y + pos.x * _x_stride + pos.z * _z_stride;
+	}
+
+	inline unsigned int get_x_stride() const {
+		return _x_stride;
+	}
+
+	inline unsigned int get_z_stride() const {
+		return _z_stride;
+	}
+
+	inline int get_offset(Vector3i delta) const {
+		return delta.y + delta.x * static_cast<int>(_x_stride) + delta.z * static_cast<int>(_z_stride);
+	}
+
+	inline const Vector3i &get_size() const {
+		return _size;
+	}
+
+	inline Span<T> get_data() const {
+		return _data;
+	}
+
+private:
+	Span<T> _data;
+	unsigned int _x_stride = 0;
+	unsigned int _z_stride = 0;
+	Vector3i _size;
+};
+
+// Calls `f` with a value of the unsigned integer type matching a depth, so it can pick the type of views to use.
+// Example: `dispatch_depth(depth, [&](auto zero) { VoxelBufferReadView<decltype(zero)> view; ... });`
+template <typename F>
+inline void dispatch_depth(VoxelBuffer::Depth depth, F f) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			f(uint8_t(0));
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			f(uint16_t(0));
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			f(uint32_t(0));
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			f(uint64_t(0));
+			break;
+		default:
+			ZN_PRINT_ERROR("Invalid depth");
+			break;
+	}
+}
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_BUFFER_VIEW_H
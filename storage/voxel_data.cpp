@@ -1,4 +1,5 @@
 #include "voxel_data.h"
+#include "../util/containers/container_funcs.h"
 #include "../util/containers/std_vector.h"
 #include "../util/dstack.h"
 #include "../util/math/conv.h"
@@ -7,6 +8,8 @@
 #include "metadata/voxel_metadata_variant.h"
 #include "voxel_data_grid.h"
 
+#include <algorithm>
+
 namespace zylann::voxel {
 
 namespace {
@@ -41,11 +44,11 @@ struct ScheduleSaveAction {
 			VoxelData::BlockToSave b;
 			// If a modified block has no voxels, it is equivalent to removing the block from the stream
 			if (block.has_voxels()) {
+				b.voxels = block.get_voxels_shared();
 				if (with_copy) {
-					b.voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
-					block.get_voxels_const().copy_to(*b.voxels, true);
-				} else {
-					b.voxels = block.get_voxels_shared();
+					// Copy-on-write: the block will copy its voxels only if it gets modified before the saving task
+					// is done with them
+					block.set_voxels_in_snapshot();
 				}
 			}
 			b.position = bpos;
@@ -103,6 +106,14 @@ void VoxelData::reset_maps_no_settings_lock() {
 			data_lod.map.clear();
 		}
 	}
+
+	{
+		MutexLock mlock(_deferred_lod_blocks_mutex);
+		for (StdVector<Vector3i> &positions : _deferred_lod_blocks) {
+			positions.clear();
+		}
+		_has_deferred_lod_blocks = false;
+	}
 }
 
 void VoxelData::set_bounds(Box3i bounds) {
@@ -120,6 +131,16 @@ void VoxelData::set_stream(Ref<VoxelStream> stream) {
 	_stream = stream;
 }
 
+void VoxelData::set_type_majority_downscaling(bool enabled, StdVector<uint16_t> lod_replacements) {
+	std::shared_ptr<TypeMajorityDownscaling> downscaling;
+	if (enabled) {
+		downscaling = make_shared_instance<TypeMajorityDownscaling>();
+		downscaling->lod_replacements = std::move(lod_replacements);
+	}
+	MutexLock wlock(_settings_mutex);
+	_type_majority_downscaling = downscaling;
+}
+
 void VoxelData::set_streaming_enabled(bool enabled) {
 	_streaming_enabled = enabled;
 }
@@ -141,24 +162,36 @@ inline VoxelSingleValue get_voxel_sv(VoxelBuffer &vb, Vector3i pos, unsigned int
 
 // TODO Piggyback on `copy`? The implementation is quite complex, and it's not supposed to be an efficient use case
 VoxelSingleValue VoxelData::get_voxel(Vector3i pos, unsigned int channel_index, VoxelSingleValue defval) const {
+	return get_voxel_at_lod(pos, 0, channel_index, defval);
+}
+
+VoxelSingleValue VoxelData::get_voxel_at_lod(
+		Vector3i pos,
+		unsigned int lod_index,
+		unsigned int channel_index,
+		VoxelSingleValue defval
+) const {
 	ZN_PROFILE_SCOPE();
 
 	if (!_bounds_in_voxels.contains(pos)) {
 		return defval;
 	}
 
-	Vector3i block_pos = pos >> get_block_size_po2();
+	const unsigned int lod_count = get_lod_count();
+	ZN_ASSERT_RETURN_V(lod_index < lod_count, defval);
+
+	Vector3i block_pos = pos >> (get_block_size_po2() + lod_index);
 	bool generate = false;
 
 	if (!_streaming_enabled) {
-		const Lod &data_lod0 = _lods[0];
+		const Lod &data_lod = _lods[lod_index];
 
-		data_lod0.spatial_lock.lock_read(BoxBounds3i::from_position(block_pos));
+		data_lod.spatial_lock.lock_read(BoxBounds3i::from_position(block_pos));
 
-		std::shared_ptr<VoxelBuffer> voxels = try_get_voxel_buffer_with_lock(data_lod0, block_pos, generate);
+		std::shared_ptr<VoxelBuffer> voxels = try_get_voxel_buffer_with_lock(data_lod, block_pos, generate);
 
 		if (voxels == nullptr) {
-			data_lod0.spatial_lock.unlock_read(BoxBounds3i::from_position(block_pos));
+			data_lod.spatial_lock.unlock_read(BoxBounds3i::from_position(block_pos));
 
 			// No voxel data. We know everything is loaded when data streaming is not used, so try to generate directly.
 			// TODO We should be able to get a value if modifiers are used but not a base generator
@@ -173,9 +206,9 @@ VoxelSingleValue VoxelData::get_voxel(Vector3i pos, unsigned int channel_index,
 				return value;
 			}
 		} else {
-			const Vector3i rpos = data_lod0.map.to_local(pos);
+			const Vector3i rpos = data_lod.map.to_local(pos >> lod_index);
 			const VoxelSingleValue sv = get_voxel_sv(*voxels, rpos, channel_index);
-			data_lod0.spatial_lock.unlock_read(BoxBounds3i::from_position(block_pos));
+			data_lod.spatial_lock.unlock_read(BoxBounds3i::from_position(block_pos));
 			return sv;
 		}
 		return defval;
@@ -183,12 +216,11 @@ VoxelSingleValue VoxelData::get_voxel(Vector3i pos, unsigned int channel_index,
 	} else {
 		// When data streaming is used, we try to find voxel data. If we don't and the location is also not loaded, we
 		// have to return the default value.
-		Vector3i voxel_pos = pos;
+		Vector3i voxel_pos = pos >> lod_index;
 		Ref<VoxelGenerator> generator = get_generator();
-		const unsigned int lod_count = get_lod_count();
 
 		// Check all LODs until we find a loaded location
-		for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+		for (; lod_index < lod_count; ++lod_index) {
 			const Lod &data_lod = _lods[lod_index];
 
 			data_lod.spatial_lock.lock_read(BoxBounds3i::from_position(block_pos));
@@ -641,7 +673,8 @@ void VoxelData::mark_area_modified(
 	// TODO We should probably merge this with edits, because that means two separate locks occur. There is some time in
 	// between where we end up with modified voxels yet not marked as modified yet.
 
-	const Box3i bbox = p_voxel_box.downscaled(get_block_size());
+	const int block_size = get_block_size();
+	const Box3i bbox = p_voxel_box.downscaled(block_size);
 
 	Lod &data_lod0 = _lods[0];
 	{
@@ -650,7 +683,9 @@ void VoxelData::mark_area_modified(
 		// Locking map for read because we won't add or remove blocks
 		RWLockRead rlock(data_lod0.map_lock);
 
-		bbox.for_each_cell([&data_lod0, lod0_new_blocks_to_lod, require_lod_updates](Vector3i block_pos_lod0) {
+		bbox.for_each_cell([&data_lod0, lod0_new_blocks_to_lod, require_lod_updates, &p_voxel_box, block_size](
+								   Vector3i block_pos_lod0
+						   ) {
 			VoxelDataBlock *block = data_lod0.map.get_block(block_pos_lod0);
 
 			// TODO Not finding a block or allocated voxels could indicate an error elsewhere, but is it worth printing?
@@ -667,13 +702,18 @@ void VoxelData::mark_area_modified(
 			block->set_modified(true);
 			block->set_edited(true);
 
-			// TODO That boolean is also modified by the threaded update task (always set to false)
-			if (!block->get_needs_lodding() && require_lod_updates) {
-				block->set_needs_lodding(true);
-
-				// This is what indirectly causes remeshing
-				if (lod0_new_blocks_to_lod != nullptr) {
-					lod0_new_blocks_to_lod->push_back(block_pos_lod0);
+			if (require_lod_updates) {
+				// Only the modified part of the block will be propagated to LODs
+				const Vector3i block_origin = block_pos_lod0 * block_size;
+				Box3i area = p_voxel_box.clipped(Box3i(block_origin, Vector3iUtil::create(block_size)));
+				area.position -= block_origin;
+
+				// This is also modified by the threaded update task, which also locks the block
+				if (block->add_lodding_area(area)) {
+					// This is what indirectly causes remeshing
+					if (lod0_new_blocks_to_lod != nullptr) {
+						lod0_new_blocks_to_lod->push_back(block_pos_lod0);
+					}
 				}
 			}
 		});
@@ -714,6 +754,23 @@ bool VoxelData::has_all_blocks_in_area_unbound(Box3i data_blocks_box, unsigned i
 	});
 }
 
+void VoxelData::get_blocks_presence_unbound(
+		Box3i data_blocks_box,
+		unsigned int lod_index,
+		StdVector<uint8_t> &out_presence
+) const {
+	ZN_PROFILE_SCOPE();
+	out_presence.resize(Vector3iUtil::get_volume(data_blocks_box.size));
+	const Lod &data_lod = _lods[lod_index];
+	RWLockRead rlock(data_lod.map_lock);
+
+	unsigned int i = 0;
+	data_blocks_box.for_each_cell_zxy([&data_lod, &out_presence, &i](Vector3i bpos) {
+		out_presence[i] = data_lod.map.has_block(bpos) ? 1 : 0;
+		++i;
+	});
+}
+
 unsigned int VoxelData::get_block_count() const {
 	unsigned int sum = 0;
 	const unsigned int lod_count = get_lod_count();
@@ -725,6 +782,140 @@ unsigned int VoxelData::get_block_count() const {
 	return sum;
 }
 
+uint64_t VoxelData::get_resident_voxel_bytes(unsigned int lod_index) const {
+	ZN_ASSERT_RETURN_V(lod_index < get_lod_count(), 0);
+	uint64_t bytes = 0;
+	for_each_block_at_lod_r(
+			[&bytes](const Vector3i bpos, const VoxelDataBlock &block) {
+				// Compressed blocks are not decompressed
+				bytes += block.get_voxels_size_in_bytes();
+			},
+			lod_index
+	);
+	return bytes;
+}
+
+void VoxelData::set_blocks_access_time(Box3i data_blocks_box, uint32_t time) {
+	Lod &lod = _lods[0];
+	// The access time is not shared with other threads, so only the map needs locking
+	RWLockRead rlock(lod.map_lock);
+	data_blocks_box.for_each_cell([&lod, time](Vector3i bpos) {
+		VoxelDataBlock *block = lod.map.get_block(bpos);
+		if (block != nullptr) {
+			block->set_last_access_time(time);
+		}
+	});
+}
+
+uint64_t VoxelData::evict_generated_block_voxels(uint64_t bytes_to_free) {
+	ZN_PROFILE_SCOPE();
+
+	if (bytes_to_free == 0 || get_generator().is_null()) {
+		// Evicted voxels could not be obtained again
+		return 0;
+	}
+
+	Lod &lod = _lods[0];
+
+	struct Candidate {
+		Vector3i position;
+		uint32_t access_time;
+	};
+
+	static thread_local StdVector<Candidate> tls_candidates;
+	StdVector<Candidate> &candidates = tls_candidates;
+	candidates.clear();
+
+	{
+		RWLockRead rlock(lod.map_lock);
+		lod.map.for_each_block([&candidates](const Vector3i bpos, const VoxelDataBlock &block) {
+			if (block.has_voxels() && !block.is_edited() && !block.is_modified()) {
+				candidates.push_back(Candidate{ bpos, block.get_last_access_time() });
+			}
+		});
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+		return a.access_time < b.access_time;
+	});
+
+	uint64_t freed_bytes = 0;
+
+	for (const Candidate &candidate : candidates) {
+		if (freed_bytes >= bytes_to_free) {
+			break;
+		}
+
+		const BoxBounds3i bounds = BoxBounds3i::from_position(candidate.position);
+		// Blocks being read by other threads are skipped rather than waited for
+		if (!lod.spatial_lock.try_lock_write(bounds)) {
+			continue;
+		}
+		{
+			RWLockRead rlock(lod.map_lock);
+			VoxelDataBlock *block = lod.map.get_block(candidate.position);
+			// State could have changed since candidates were gathered
+			if (block != nullptr && block->has_voxels() && !block->is_edited() && !block->is_modified()) {
+				freed_bytes += block->get_voxels_size_in_bytes();
+				block->clear_voxels();
+			}
+		}
+		lod.spatial_lock.unlock_write(bounds);
+	}
+
+	return freed_bytes;
+}
+
+void VoxelData::find_cold_blocks(
+		uint32_t access_time_threshold,
+		uint32_t current_time,
+		StdVector<Vector3i> &out_positions
+) {
+	ZN_PROFILE_SCOPE();
+	Lod &lod = _lods[0];
+	RWLockRead rlock(lod.map_lock);
+	lod.map.for_each_block([&](const Vector3i bpos, VoxelDataBlock &block) {
+		if (!block.has_voxels() || block.is_voxels_compressed()) {
+			return;
+		}
+		// Access times are only updated by the terrain, which doesn't know about reads and edits of voxels.
+		// Decompression tells they were used, so they don't get compressed again right away.
+		if (block.pop_decompressed_flag()) {
+			block.set_last_access_time(current_time);
+			return;
+		}
+		if (block.get_last_access_time() < access_time_threshold) {
+			out_positions.push_back(bpos);
+		}
+	});
+}
+
+uint64_t VoxelData::compress_block_voxels(Span<const Vector3i> positions) {
+	ZN_PROFILE_SCOPE();
+
+	Lod &lod = _lods[0];
+	uint64_t saved_bytes = 0;
+
+	for (const Vector3i bpos : positions) {
+		const BoxBounds3i bounds = BoxBounds3i::from_position(bpos);
+		// Blocks being accessed by other threads are skipped rather than waited for
+		if (!lod.spatial_lock.try_lock_write(bounds)) {
+			continue;
+		}
+		{
+			RWLockRead rlock(lod.map_lock);
+			VoxelDataBlock *block = lod.map.get_block(bpos);
+			// The block could have been unloaded since it was found
+			if (block != nullptr) {
+				saved_bytes += block->compress_voxels();
+			}
+		}
+		lod.spatial_lock.unlock_write(bounds);
+	}
+
+	return saved_bytes;
+}
+
 void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector<BlockLocation> *out_updated_blocks) {
 	ZN_DSTACK();
 	ZN_PROFILE_SCOPE();
@@ -734,11 +925,7 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 	// i.e there is no way for a block to be loaded if its parent LOD isn't loaded already.
 	// In the future we may implement storing of edits to be applied later if blocks can't be found.
 
-	const unsigned int data_block_size = get_block_size();
-	const int data_block_size_po2 = get_block_size_po2();
 	const unsigned int lod_count = get_lod_count();
-	const bool streaming_enabled = is_streaming_enabled();
-	Ref<VoxelGenerator> generator = get_generator();
 
 	static thread_local FixedArray<StdVector<Vector3i>, constants::MAX_LOD> tls_blocks_to_process_per_lod;
 
@@ -759,8 +946,11 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 		for (const Vector3i data_block_pos : blocks_pending_lodding_lod0) {
 			VoxelDataBlock *data_block = data_lod0.map.get_block(data_block_pos);
 			ERR_CONTINUE(data_block == nullptr);
-			// TODO Threading: this is set without spatial lock, so in theory another thread can also change this!
-			data_block->set_needs_lodding(false);
+			if (lod_count == 1) {
+				// Otherwise this is done when downscaling, which needs to know which area of the block changed
+				// TODO Threading: this is set without spatial lock, so in theory another thread can also change this!
+				data_block->clear_needs_lodding();
+			}
 
 			if (out_updated_blocks != nullptr) {
 				out_updated_blocks->push_back(BlockLocation{ data_block_pos, 0 });
@@ -768,15 +958,149 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 		}
 	}
 
+	if (lod_count == 1) {
+		return;
+	}
+
+	if (!is_streaming_enabled()) {
+		// All edits are in memory, so parent blocks missing edits would have to be generated, even where nothing
+		// uses them. Instead, they are updated when something needs them. Blocks stay flagged until then, so further
+		// edits only grow the area to update.
+		StdVector<Vector3i> &blocks_lod0 = tls_blocks_to_process_per_lod[0];
+		if (blocks_lod0.size() > 0) {
+			MutexLock mlock(_deferred_lod_blocks_mutex);
+			append_array(_deferred_lod_blocks[0], blocks_lod0);
+			_has_deferred_lod_blocks = true;
+		}
+		blocks_lod0.clear();
+		return;
+	}
+
+	// Blocks previously deferred are included, in case streaming got enabled since then
+	process_lod_updates(tls_blocks_to_process_per_lod, lod_count - 1, nullptr, out_updated_blocks);
+}
+
+void VoxelData::update_deferred_lods(
+		Span<const Box3i> blocks_boxes,
+		unsigned int lod_index,
+		StdVector<BlockLocation> *out_updated_blocks
+) {
+	if (!_has_deferred_lod_blocks || lod_index == 0 || lod_index >= get_lod_count() || blocks_boxes.size() == 0) {
+		return;
+	}
+	ZN_DSTACK();
+	ZN_PROFILE_SCOPE();
+
+	static thread_local FixedArray<StdVector<Vector3i>, constants::MAX_LOD> tls_blocks_to_process_per_lod;
+	process_lod_updates(tls_blocks_to_process_per_lod, lod_index, &blocks_boxes, out_updated_blocks);
+}
+
+void VoxelData::update_all_deferred_lods() {
+	if (!_has_deferred_lod_blocks) {
+		return;
+	}
+	ZN_DSTACK();
+	ZN_PROFILE_SCOPE();
+
+	static thread_local FixedArray<StdVector<Vector3i>, constants::MAX_LOD> tls_blocks_to_process_per_lod;
+	process_lod_updates(tls_blocks_to_process_per_lod, get_lod_count() - 1, nullptr, nullptr);
+}
+
+// Moves deferred blocks of a LOD into a list to process. If boxes are given, only blocks whose parent at
+// `max_lod_index` is inside one of them are taken. Otherwise, all are taken.
+void VoxelData::take_deferred_lod_blocks(
+		unsigned int lod_index,
+		unsigned int max_lod_index,
+		const Span<const Box3i> *blocks_boxes,
+		StdVector<Vector3i> &out_positions
+) {
+	if (!_has_deferred_lod_blocks) {
+		return;
+	}
+
+	MutexLock mlock(_deferred_lod_blocks_mutex);
+
+	StdVector<Vector3i> &deferred = _deferred_lod_blocks[lod_index];
+
+	if (blocks_boxes == nullptr) {
+		append_array(out_positions, deferred);
+		deferred.clear();
+
+	} else {
+		const unsigned int shift = max_lod_index - lod_index;
+		unordered_remove_if(deferred, [blocks_boxes, shift, &out_positions](const Vector3i bpos) {
+			const Vector3i parent_bpos = bpos >> shift;
+			for (const Box3i &box : *blocks_boxes) {
+				if (box.contains(parent_bpos)) {
+					out_positions.push_back(bpos);
+					return true;
+				}
+			}
+			return false;
+		});
+	}
+
+	bool has_deferred_blocks = false;
+	for (const StdVector<Vector3i> &positions : _deferred_lod_blocks) {
+		if (positions.size() > 0) {
+			has_deferred_blocks = true;
+			break;
+		}
+	}
+	_has_deferred_lod_blocks = has_deferred_blocks;
+}
+
+bool VoxelData::has_deferred_lod_blocks_in_area(Box3i blocks_box, unsigned int lod_index) const {
+	if (!_has_deferred_lod_blocks) {
+		return false;
+	}
+
+	MutexLock mlock(_deferred_lod_blocks_mutex);
+
+	for (unsigned int src_lod_index = 0; src_lod_index < lod_index; ++src_lod_index) {
+		const unsigned int shift = lod_index - src_lod_index;
+		for (const Vector3i bpos : _deferred_lod_blocks[src_lod_index]) {
+			if (blocks_box.contains(bpos >> shift)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// Downscales blocks listed for each LOD into their parents, from LOD 0 up to `max_lod_index`. Deferred blocks leading
+// to `deferred_blocks_boxes` are processed too. Parents getting edits they can't pass further up are deferred.
+void VoxelData::process_lod_updates(
+		FixedArray<StdVector<Vector3i>, constants::MAX_LOD> &blocks_to_process_per_lod,
+		const unsigned int max_lod_index,
+		const Span<const Box3i> *deferred_blocks_boxes,
+		StdVector<BlockLocation> *out_updated_blocks
+) {
+	const unsigned int data_block_size = get_block_size();
+	const int data_block_size_po2 = get_block_size_po2();
+	const unsigned int lod_count = get_lod_count();
+	const bool streaming_enabled = is_streaming_enabled();
+	Ref<VoxelGenerator> generator = get_generator();
+	std::shared_ptr<const TypeMajorityDownscaling> type_majority_downscaling;
+	{
+		MutexLock rlock(_settings_mutex);
+		type_majority_downscaling = _type_majority_downscaling;
+	}
+
+	ZN_ASSERT_RETURN(max_lod_index < lod_count);
+
 	const int half_bs = data_block_size >> 1;
 
 	// Process downscales upwards in pairs of consecutive LODs.
 	// This ensures we don't process multiple times the same blocks.
 	// Only LOD0 is editable at the moment, so we'll downscale from there
-	for (uint8_t dst_lod_index = 1; dst_lod_index < lod_count; ++dst_lod_index) {
+	for (uint8_t dst_lod_index = 1; dst_lod_index <= max_lod_index; ++dst_lod_index) {
 		const uint8_t src_lod_index = dst_lod_index - 1;
-		StdVector<Vector3i> &src_lod_blocks_to_process = tls_blocks_to_process_per_lod[src_lod_index];
-		StdVector<Vector3i> &dst_lod_blocks_to_process = tls_blocks_to_process_per_lod[dst_lod_index];
+		StdVector<Vector3i> &src_lod_blocks_to_process = blocks_to_process_per_lod[src_lod_index];
+		StdVector<Vector3i> &dst_lod_blocks_to_process = blocks_to_process_per_lod[dst_lod_index];
+
+		take_deferred_lod_blocks(src_lod_index, max_lod_index, deferred_blocks_boxes, src_lod_blocks_to_process);
 
 		// VoxelLodTerrainUpdateData::Lod &dst_lod = state.lods[dst_lod_index];
 
@@ -809,7 +1133,10 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 			}
 
 			ZN_ASSERT(src_block != nullptr);
-			src_block->set_needs_lodding(false);
+			// Edits may have happened since the block was queued
+			const Box3i src_block_box(Vector3i(), Vector3iUtil::create(data_block_size));
+			Box3i src_area = src_block->get_needs_lodding() ? src_block->get_lodding_area() : src_block_box;
+			src_block->clear_needs_lodding();
 
 			struct L {
 				static std::shared_ptr<VoxelBuffer> generate_voxels(
@@ -824,6 +1151,9 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 					std::shared_ptr<VoxelBuffer> voxels =
 							make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
 					voxels->create(Vector3iUtil::create(data_block_size));
+					voxels->set_sdf_quantization_factor(
+							VoxelBuffer::get_sdf_quantization_factor_for_lod(dst_lod_index)
+					);
 					VoxelGenerator::VoxelQueryData q{ //
 													  *voxels, //
 													  dst_bpos << (dst_lod_index + data_block_size_po2), //
@@ -841,6 +1171,8 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 				}
 			};
 
+			bool dst_voxels_generated = false;
+
 			if (dst_block == nullptr) {
 				if (!streaming_enabled) {
 					// TODO Doing this on the main thread can be very demanding and cause a stall.
@@ -853,6 +1185,7 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 						RWLockWrite wlock(dst_data_lod.map_lock);
 						dst_block = dst_data_lod.map.set_block_buffer(dst_bpos, voxels, true);
 					}
+					dst_voxels_generated = true;
 
 				} else {
 					ZN_PRINT_ERROR(
@@ -882,34 +1215,74 @@ void VoxelData::update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector
 						dst_bpos, dst_lod_index, data_block_size, data_block_size_po2, generator, _modifiers
 				);
 				dst_block->set_voxels(voxels);
+				dst_voxels_generated = true;
 			}
 
+			if (dst_voxels_generated) {
+				// Previous edits of the source block are not in generated voxels
+				src_area = src_block_box;
+			} else {
+				// Snap to even coordinates so voxels are sampled at the same positions as when downscaling the whole
+				// block
+				src_area = src_area.snapped(2).clipped(src_block_box);
+			}
+
+			const Vector3i rel = src_bpos - (dst_bpos << 1);
+			const Box3i dst_area((rel * half_bs) + (src_area.position >> 1), src_area.size >> 1);
+
 			dst_block->set_modified(true);
 
-			if (dst_lod_index != lod_count - 1 && !dst_block->get_needs_lodding()) {
-				dst_block->set_needs_lodding(true);
+			if (dst_lod_index != lod_count - 1 && dst_block->add_lodding_area(dst_area)) {
 				dst_lod_blocks_to_process.push_back(dst_bpos);
 			}
 
-			const Vector3i rel = src_bpos - (dst_bpos << 1);
-
 			// Update lower LOD
 			// This must always be done after an edit before it gets saved, otherwise LODs won't match and it will look
 			// ugly.
-			// TODO Optimization: try to narrow to edited region instead of taking whole block
 			{
 				ZN_PROFILE_SCOPE_NAMED("Downscale");
 				// TODO The destination block should be locked!
 				// Maybe it hasn't been done so far because nothing else accesses higher LOD indices yet, or because we
 				// are holding a lock on the map that contains it
-				src_block->get_voxels().downscale_to(
-						dst_block->get_voxels(), Vector3i(), src_block->get_voxels_const().get_size(), rel * half_bs
-				);
+				const VoxelBuffer &src_voxels = src_block->get_voxels_const();
+				VoxelBuffer &dst_voxels = dst_block->get_voxels();
+				const Vector3i src_max = src_area.position + src_area.size;
+				if (type_majority_downscaling != nullptr) {
+					const unsigned int type_channel = VoxelBuffer::CHANNEL_TYPE;
+					src_voxels.downscale_to(
+							dst_voxels,
+							src_area.position,
+							src_max,
+							dst_area.position,
+							VoxelBuffer::ALL_CHANNELS_MASK & ~(1 << type_channel)
+					);
+					src_voxels.downscale_majority_to(
+							dst_voxels,
+							src_area.position,
+							src_max,
+							dst_area.position,
+							type_channel,
+							to_span(type_majority_downscaling->lod_replacements)
+					);
+				} else {
+					src_voxels.downscale_to(dst_voxels, src_area.position, src_max, dst_area.position);
+				}
 			}
 		}
 
 		src_lod_blocks_to_process.clear();
-		// No need to clear the last list because we never add blocks to it
+	}
+
+	// Blocks of the last processed LOD got edits their parents don't have yet. No need to do this for the last LOD
+	// because we never add blocks to its list.
+	if (max_lod_index < lod_count - 1) {
+		StdVector<Vector3i> &remaining_blocks = blocks_to_process_per_lod[max_lod_index];
+		if (remaining_blocks.size() > 0) {
+			MutexLock mlock(_deferred_lod_blocks_mutex);
+			append_array(_deferred_lod_blocks[max_lod_index], remaining_blocks);
+			_has_deferred_lod_blocks = true;
+		}
+		remaining_blocks.clear();
 	}
 
 	//	uint64_t time_spent = profiling_clock.restart();
@@ -964,8 +1337,8 @@ bool VoxelData::consume_block_modifications(Vector3i bpos, VoxelData::BlockToSav
 	}
 	if (block->is_modified()) {
 		if (block->has_voxels()) {
-			out_to_save.voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
-			block->get_voxels_const().copy_to(*out_to_save.voxels, true);
+			out_to_save.voxels = block->get_voxels_shared();
+			block->set_voxels_in_snapshot();
 		}
 		out_to_save.position = bpos;
 		out_to_save.lod_index = 0;
@@ -976,6 +1349,9 @@ bool VoxelData::consume_block_modifications(Vector3i bpos, VoxelData::BlockToSav
 }
 
 void VoxelData::consume_all_modifications(StdVector<BlockToSave> &to_save, bool with_copy) {
+	// Saved LODs must match
+	update_all_deferred_lods();
+
 	const unsigned int lod_count = get_lod_count();
 	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
 		Lod &lod = _lods[lod_index];
@@ -1025,21 +1401,21 @@ void VoxelData::get_blocks_with_voxel_data(
 		unsigned int lod_index,
 		Span<std::shared_ptr<VoxelBuffer>> out_blocks
 ) const {
-	ZN_PROFILE_SCOPE();
-	ZN_ASSERT(int64_t(out_blocks.size()) >= Vector3iUtil::get_volume(p_blocks_box.size));
-
-	const Lod &data_lod = _lods[lod_index];
-
-	// Locking also with spatial lock because we need to check if blocks have voxels, which is a state that could be
-	// changed by another thread (in theory)
-	SpatialLock3D::Read srlock(data_lod.spatial_lock, p_blocks_box);
+	get_blocks_with_voxel_data(Span<const Box3i>(&p_blocks_box, 1), lod_index, out_blocks);
+}
 
-	RWLockRead rlock(data_lod.map_lock);
+namespace {
 
+// Map and spatial lock must be locked for reading
+unsigned int get_blocks_with_voxel_data_unlocked(
+		const VoxelDataMap &map,
+		Box3i blocks_box,
+		Span<std::shared_ptr<VoxelBuffer>> out_blocks
+) {
 	unsigned int index = 0;
 
-	p_blocks_box.for_each_cell_zxy([&index, &data_lod, &out_blocks](Vector3i data_block_pos) {
-		const VoxelDataBlock *nblock = data_lod.map.get_block(data_block_pos);
+	blocks_box.for_each_cell_zxy([&index, &map, &out_blocks](Vector3i data_block_pos) {
+		const VoxelDataBlock *nblock = map.get_block(data_block_pos);
 		// The block can actually be null on some occasions. Not sure yet if it's that bad
 		// CRASH_COND(nblock == nullptr);
 		if (nblock != nullptr && nblock->has_voxels()) {
@@ -1047,6 +1423,55 @@ void VoxelData::get_blocks_with_voxel_data(
 		}
 		++index;
 	});
+
+	return index;
+}
+
+} // namespace
+
+void VoxelData::get_blocks_with_voxel_data(
+		Span<const Box3i> p_blocks_boxes,
+		unsigned int lod_index,
+		Span<std::shared_ptr<VoxelBuffer>> out_blocks
+) const {
+	ZN_PROFILE_SCOPE();
+
+	if (p_blocks_boxes.size() == 0) {
+		return;
+	}
+
+	Box3i bounds = p_blocks_boxes[0];
+	int64_t total_volume = 0;
+	for (const Box3i &box : p_blocks_boxes) {
+		bounds.merge_with(box);
+		total_volume += Vector3iUtil::get_volume(box.size);
+	}
+	ZN_ASSERT(int64_t(out_blocks.size()) >= total_volume);
+
+	const Lod &data_lod = _lods[lod_index];
+
+	// Locking also with spatial lock because we need to check if blocks have voxels, which is a state that could be
+	// changed by another thread (in theory).
+	// Only one box can be locked at a time, so we attempt to lock the bounds of all boxes. They can be large, so if a
+	// writer is anywhere in there, we lock boxes one by one instead of waiting for an unrelated area.
+	if (data_lod.spatial_lock.try_lock_read(bounds)) {
+		{
+			RWLockRead rlock(data_lod.map_lock);
+			unsigned int index = 0;
+			for (const Box3i &box : p_blocks_boxes) {
+				index += get_blocks_with_voxel_data_unlocked(data_lod.map, box, out_blocks.sub(index));
+			}
+		}
+		data_lod.spatial_lock.unlock_read(bounds);
+
+	} else {
+		unsigned int index = 0;
+		for (const Box3i &box : p_blocks_boxes) {
+			SpatialLock3D::Read srlock(data_lod.spatial_lock, box);
+			RWLockRead rlock(data_lod.map_lock);
+			index += get_blocks_with_voxel_data_unlocked(data_lod.map, box, out_blocks.sub(index));
+		}
+	}
 }
 
 void VoxelData::get_blocks_grid(VoxelDataGrid &grid, Box3i box_in_voxels, unsigned int lod_index) const {
@@ -1088,7 +1513,7 @@ bool VoxelData::has_blocks_with_voxels_in_area_broad_mip_test(Box3i box_in_voxel
 			return block == nullptr || block->has_voxels() == false;
 		});
 
-		if (no_blocks_found) {
+		if (no_blocks_found && !has_deferred_lod_blocks_in_area(mip_blocks_box, top_lod_index)) {
 			// No edits found at this mip, we may assume there are no edits in lower LODs.
 			return false;
 		}
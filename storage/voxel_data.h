@@ -8,6 +8,8 @@
 #include "../util/thread/spatial_lock_3d.h"
 #include "voxel_data_map.h"
 
+#include <atomic>
+
 namespace zylann::voxel {
 
 class VoxelDataGrid;
@@ -81,6 +83,12 @@ public:
 		return _modifiers;
 	}
 
+	// Sets how the TYPE channel is downscaled when edits are propagated to lower LODs. By default, each voxel takes the
+	// value of one of the 8 voxels it covers. With majority downscaling, it takes the most common non-zero value among
+	// them, after replacing values with `lod_replacements[value]` if they are within its size. This suits blocky
+	// terrains, where thin or sparse features would otherwise flicker or disappear in the distance.
+	void set_type_majority_downscaling(bool enabled, StdVector<uint16_t> lod_replacements);
+
 	void set_streaming_enabled(bool enabled);
 
 	inline bool is_streaming_enabled() const {
@@ -98,6 +106,14 @@ public:
 	// When not specified, the used LOD index is 0.
 
 	VoxelSingleValue get_voxel(Vector3i pos, unsigned int channel_index, VoxelSingleValue defval) const;
+	// Same as `get_voxel`, but reads from the given LOD first. `pos` is in LOD0 coordinates and should be aligned to
+	// the grid of that LOD, in which case the value is the same as in LOD0 where mips are up to date.
+	VoxelSingleValue get_voxel_at_lod(
+			Vector3i pos,
+			unsigned int lod_index,
+			unsigned int channel_index,
+			VoxelSingleValue defval
+	) const;
 	bool try_set_voxel(uint64_t value, Vector3i pos, unsigned int channel_index);
 
 	float get_voxel_f(Vector3i pos, unsigned int channel_index) const;
@@ -228,9 +244,36 @@ public:
 	// Doesn't account for data boundaries, so if the given box overlaps outside, it will return false.
 	bool has_all_blocks_in_area_unbound(Box3i data_blocks_box, unsigned int lod_index) const;
 
+	// Gets which blocks are loaded in an area, as 1 (loaded) or 0 (not loaded) per block in ZXY order. This is
+	// cheaper than many calls to `has_all_blocks_in_area_unbound` on overlapping areas, as it locks and looks up
+	// each block only once. Doesn't account for data boundaries.
+	void get_blocks_presence_unbound(Box3i data_blocks_box, unsigned int lod_index, StdVector<uint8_t> &out_presence)
+			const;
+
 	// Gets the total amount of allocated blocks. This includes blocks having no voxel data.
 	unsigned int get_block_count() const;
 
+	// Gets how many bytes of voxel data are held in memory by blocks of the given LOD.
+	uint64_t get_resident_voxel_bytes(unsigned int lod_index) const;
+
+	// Sets the last access time of loaded LOD0 blocks in an area. Must be called from the same thread as
+	// `evict_generated_block_voxels` and `find_cold_blocks`.
+	void set_blocks_access_time(Box3i data_blocks_box, uint32_t time);
+
+	// Frees voxel data of LOD0 blocks that were never edited, least recently accessed first, until at least
+	// `bytes_to_free` bytes are freed. Blocks remain loaded, and their voxels will be obtained from the generator
+	// again when needed. Does nothing if there is no generator. Returns how many bytes were freed.
+	uint64_t evict_generated_block_voxels(uint64_t bytes_to_free);
+
+	// Gets positions of LOD0 blocks having uncompressed voxels which were last accessed before the given time. Blocks
+	// that were decompressed since the last call count as accessed at the current time.
+	void find_cold_blocks(uint32_t access_time_threshold, uint32_t current_time, StdVector<Vector3i> &out_positions);
+
+	// Compresses voxels of LOD0 blocks in memory with LZ4. They stay loaded, and are decompressed when accessed again.
+	// Blocks being accessed by other threads are skipped. Can be called from any thread. Returns how many bytes were
+	// saved.
+	uint64_t compress_block_voxels(Span<const Vector3i> positions);
+
 	struct BlockLocation {
 		Vector3i position;
 		uint32_t lod_index;
@@ -238,8 +281,27 @@ public:
 
 	// Updates the LODs of all blocks at given positions, and resets their flags telling that they need LOD updates.
 	// Optionally, returns a list of affected block positions.
+	// When streaming is disabled, LODs above 0 are not updated right away, because parent blocks would have to be
+	// generated even where nothing uses them. They are updated by `update_deferred_lods` instead, when needed.
 	void update_lods(Span<const Vector3i> modified_lod0_blocks, StdVector<BlockLocation> *out_updated_blocks);
 
+	// Updates blocks of the given LOD that didn't receive edits done in lower LODs yet. Boxes are in block coordinates
+	// of that LOD. Should be called before voxels of these blocks are used. Optionally, returns a list of affected
+	// block positions.
+	void update_deferred_lods(
+			Span<const Box3i> blocks_boxes,
+			unsigned int lod_index,
+			StdVector<BlockLocation> *out_updated_blocks
+	);
+
+	// Updates all blocks that didn't receive edits done in lower LODs yet.
+	void update_all_deferred_lods();
+
+	// Tells if some LOD blocks didn't receive edits done in lower LODs yet.
+	inline bool has_deferred_lod_updates() const {
+		return _has_deferred_lod_blocks;
+	}
+
 	struct BlockToSave {
 		std::shared_ptr<VoxelBuffer> voxels;
 		Vector3i position;
@@ -254,12 +316,14 @@ public:
 	// their data will be returned for the caller to save.
 	// void unload_blocks(Span<const Vector3i> positions, StdVector<BlockToSave> *to_save);
 
-	// If the block at the specified LOD0 position exists and is modified, marks it as non-modified and returns a copy
-	// of its data to save. Returns true if there is something to save.
+	// If the block at the specified LOD0 position exists and is modified, marks it as non-modified and returns a
+	// snapshot of its data to save. Voxels get copied only if the block is modified again while still referenced.
+	// Returns true if there is something to save.
 	bool consume_block_modifications(Vector3i bpos, BlockToSave &out_to_save);
 
 	// Marks all modified blocks as unmodified and returns their data to save. if `with_copy` is true, the returned data
-	// will be a copy, otherwise it will reference voxel data. Prefer using references when about to quit for example.
+	// is a snapshot: blocks edited afterwards copy their voxels first, so the snapshot remains consistent with the time
+	// of the call. Otherwise it will reference voxel data. Prefer using references when about to quit for example.
 	void consume_all_modifications(StdVector<BlockToSave> &to_save, bool with_copy);
 
 	// Gets missing blocks out of the given block positions.
@@ -287,6 +351,15 @@ public:
 			Span<std::shared_ptr<VoxelBuffer>> out_blocks
 	) const;
 
+	// Batched version of the above, which takes locks only once for all the given areas. This is faster
+	// when many areas are queried at once, such as when scheduling all mesh updates of a frame.
+	// Results of each area are placed one after the other, in the same order as areas.
+	void get_blocks_with_voxel_data(
+			Span<const Box3i> p_blocks_boxes,
+			unsigned int lod_index,
+			Span<std::shared_ptr<VoxelBuffer>> out_blocks
+	) const;
+
 	// Gets blocks with voxels at the given LOD and indexes them in a grid. This will query every location
 	// intersecting the box at the specified LOD, so if the area is large, you may want to do a broad check first.
 	// WARNING: data isn't locked, you have to keep a shared reference to VoxelData in order to use SpatialLock3D.
@@ -347,6 +420,22 @@ public:
 private:
 	void reset_maps_no_settings_lock();
 
+	void process_lod_updates(
+			FixedArray<StdVector<Vector3i>, constants::MAX_LOD> &blocks_to_process_per_lod,
+			unsigned int max_lod_index,
+			const Span<const Box3i> *deferred_blocks_boxes,
+			StdVector<BlockLocation> *out_updated_blocks
+	);
+
+	void take_deferred_lod_blocks(
+			unsigned int lod_index,
+			unsigned int max_lod_index,
+			const Span<const Box3i> *blocks_boxes,
+			StdVector<Vector3i> &out_positions
+	);
+
+	bool has_deferred_lod_blocks_in_area(Box3i blocks_box, unsigned int lod_index) const;
+
 	struct Lod {
 		// Storage for edited and cached voxels.
 		VoxelDataMap map;
@@ -438,6 +527,12 @@ private:
 	// Persistent storage (file(s)).
 	Ref<VoxelStream> _stream;
 
+	struct TypeMajorityDownscaling {
+		StdVector<uint16_t> lod_replacements;
+	};
+	// If null, majority downscaling is disabled. Replaced rather than modified, so threads can keep using it.
+	std::shared_ptr<const TypeMajorityDownscaling> _type_majority_downscaling;
+
 	// This should be locked when accessing settings members.
 	// If other locks are needed simultaneously such as voxel maps, they should always be locked AFTER, to prevent
 	// deadlocks.
@@ -448,6 +543,12 @@ private:
 	// There are times where locking can take longer, but it only happens rarely, when changing LOD count for
 	// example.
 	Mutex _settings_mutex;
+
+	// Positions of blocks having edits their parent didn't receive yet, for each LOD. These blocks are flagged as
+	// needing LOD updates, so a block is never listed twice.
+	FixedArray<StdVector<Vector3i>, constants::MAX_LOD> _deferred_lod_blocks;
+	std::atomic_bool _has_deferred_lod_blocks = { false };
+	mutable Mutex _deferred_lod_blocks_mutex;
 };
 
 } // namespace zylann::voxel
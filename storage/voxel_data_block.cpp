@@ -1,5 +1,9 @@
 #include "voxel_data_block.h"
+#include "voxel_buffer.h"
+#include "../streams/voxel_block_serializer.h"
 #include "../util/io/log.h"
+#include "../util/memory/memory.h"
+#include "../util/profiling.h"
 #include "../util/string/format.h"
 
 namespace zylann::voxel {
@@ -13,4 +17,85 @@ void VoxelDataBlock::set_modified(bool modified) {
 	_modified = modified;
 }
 
+void VoxelDataBlock::unshare_voxels() const {
+	_voxels_in_snapshot = false;
+	if (_voxels == nullptr || _voxels.use_count() == 1) {
+		// The snapshot was already released
+		return;
+	}
+	ZN_PROFILE_SCOPE();
+	std::shared_ptr<VoxelBuffer> copy = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+	_voxels->copy_to(*copy, true);
+	_voxels = copy;
+}
+
+size_t VoxelDataBlock::compress_voxels() {
+	if (_voxels == nullptr || is_voxels_compressed()) {
+		return 0;
+	}
+	if (_voxels.use_count() > 1) {
+		// Used by a snapshot or a task, compressing would not free memory
+		return 0;
+	}
+	const size_t size_in_bytes = _voxels->get_channels_size_in_bytes();
+	if (size_in_bytes == 0) {
+		// Only uniform channels
+		return 0;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(*_voxels);
+	ZN_ASSERT_RETURN_V(result.success, 0);
+	if (result.data.size() >= size_in_bytes) {
+		return 0;
+	}
+
+	std::shared_ptr<StdVector<uint8_t>> compressed_voxels = make_shared_instance<StdVector<uint8_t>>(result.data);
+	_compressed_voxels = compressed_voxels;
+	_voxels = nullptr;
+	_voxels_in_snapshot = false;
+	_voxels_compressed.store(true, std::memory_order_release);
+
+	return size_in_bytes - compressed_voxels->size();
+}
+
+void VoxelDataBlock::decompress_voxels() const {
+	_decompression_lock.lock();
+
+	// Another thread may have decompressed voxels while we were waiting
+	if (is_voxels_compressed()) {
+		ZN_PROFILE_SCOPE();
+
+		std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		if (!BlockSerializer::decompress_and_deserialize(to_span(*_compressed_voxels), *voxels)) {
+			ZN_PRINT_ERROR("Failed to decompress voxels of block");
+		}
+		_voxels = voxels;
+		_compressed_voxels = nullptr;
+		_decompressed = true;
+		_voxels_compressed.store(false, std::memory_order_release);
+	}
+
+	_decompression_lock.unlock();
+}
+
+size_t VoxelDataBlock::get_voxels_size_in_bytes() const {
+	if (is_voxels_compressed()) {
+		size_t size_in_bytes = 0;
+		_decompression_lock.lock();
+		if (is_voxels_compressed()) {
+			size_in_bytes = _compressed_voxels->size();
+		}
+		_decompression_lock.unlock();
+		if (size_in_bytes != 0) {
+			return size_in_bytes;
+		}
+	}
+	if (_voxels != nullptr) {
+		return _voxels->get_channels_size_in_bytes();
+	}
+	return 0;
+}
+
 } // namespace zylann::voxel
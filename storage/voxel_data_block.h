@@ -1,7 +1,11 @@
 #ifndef VOXEL_DATA_BLOCK_H
 #define VOXEL_DATA_BLOCK_H
 
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
 #include "../util/ref_count.h"
+#include "../util/thread/spin_lock.h"
+#include <atomic>
 #include <memory>
 
 namespace zylann::voxel {
@@ -26,26 +30,41 @@ public:
 	VoxelDataBlock(VoxelDataBlock &&src) :
 			viewers(src.viewers),
 			_voxels(std::move(src._voxels)),
+			_compressed_voxels(std::move(src._compressed_voxels)),
+			_voxels_compressed(src._voxels_compressed.load(std::memory_order_relaxed)),
+			_voxels_in_snapshot(src._voxels_in_snapshot),
 			_lod_index(src._lod_index),
 			_needs_lodding(src._needs_lodding),
 			_modified(src._modified),
-			_edited(src._edited) {}
+			_edited(src._edited),
+			_lodding_area(src._lodding_area),
+			_last_access_time(src._last_access_time) {}
 
 	VoxelDataBlock(const VoxelDataBlock &src) :
 			viewers(src.viewers),
 			_voxels(src._voxels),
+			_compressed_voxels(src._compressed_voxels),
+			_voxels_compressed(src._voxels_compressed.load(std::memory_order_relaxed)),
+			_voxels_in_snapshot(src._voxels_in_snapshot),
 			_lod_index(src._lod_index),
 			_needs_lodding(src._needs_lodding),
 			_modified(src._modified),
-			_edited(src._edited) {}
+			_edited(src._edited),
+			_lodding_area(src._lodding_area),
+			_last_access_time(src._last_access_time) {}
 
 	VoxelDataBlock &operator=(VoxelDataBlock &&src) {
 		viewers = src.viewers;
 		_lod_index = src._lod_index;
 		_voxels = std::move(src._voxels);
+		_compressed_voxels = std::move(src._compressed_voxels);
+		_voxels_compressed.store(src._voxels_compressed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		_voxels_in_snapshot = src._voxels_in_snapshot;
 		_needs_lodding = src._needs_lodding;
 		_modified = src._modified;
 		_edited = src._edited;
+		_lodding_area = src._lodding_area;
+		_last_access_time = src._last_access_time;
 		return *this;
 	}
 
@@ -53,9 +72,14 @@ public:
 		viewers = src.viewers;
 		_lod_index = src._lod_index;
 		_voxels = src._voxels;
+		_compressed_voxels = src._compressed_voxels;
+		_voxels_compressed.store(src._voxels_compressed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		_voxels_in_snapshot = src._voxels_in_snapshot;
 		_needs_lodding = src._needs_lodding;
 		_modified = src._modified;
 		_edited = src._edited;
+		_lodding_area = src._lodding_area;
+		_last_access_time = src._last_access_time;
 		return *this;
 	}
 
@@ -67,19 +91,29 @@ public:
 	// If false, it means the block has no edits and does not contain cached generated data,
 	// so we may fallback on procedural generators on the fly or request a cache.
 	inline bool has_voxels() const {
-		return _voxels != nullptr;
+		return is_voxels_compressed() || _voxels != nullptr;
 	}
 
-	// Get voxels, expecting them to be present
+	// Get voxels, expecting them to be present.
+	// If voxels are referenced by a snapshot, they are copied first so the snapshot is not affected by edits.
 	VoxelBuffer &get_voxels() {
+		if (is_voxels_compressed()) {
+			decompress_voxels();
+		}
 #ifdef DEBUG_ENABLED
 		ZN_ASSERT(_voxels != nullptr);
 #endif
+		if (_voxels_in_snapshot) {
+			unshare_voxels();
+		}
 		return *_voxels;
 	}
 
 	// Get voxels, expecting them to be present
 	const VoxelBuffer &get_voxels_const() const {
+		if (is_voxels_compressed()) {
+			decompress_voxels();
+		}
 #ifdef DEBUG_ENABLED
 		ZN_ASSERT(_voxels != nullptr);
 #endif
@@ -88,6 +122,9 @@ public:
 
 	// Get voxels, expecting them to be present
 	std::shared_ptr<VoxelBuffer> get_voxels_shared() const {
+		if (is_voxels_compressed()) {
+			decompress_voxels();
+		}
 #ifdef DEBUG_ENABLED
 		ZN_ASSERT(_voxels != nullptr);
 #endif
@@ -97,27 +134,88 @@ public:
 	void set_voxels(const std::shared_ptr<VoxelBuffer> &buffer) {
 		ZN_ASSERT_RETURN(buffer != nullptr);
 		_voxels = buffer;
+		_compressed_voxels = nullptr;
+		_voxels_compressed.store(false, std::memory_order_relaxed);
+		_voxels_in_snapshot = false;
 	}
 
 	void clear_voxels() {
 		_voxels = nullptr;
+		_compressed_voxels = nullptr;
+		_voxels_compressed.store(false, std::memory_order_relaxed);
+		_voxels_in_snapshot = false;
 		_edited = false;
 	}
 
+	// In-memory compression of blocks that are rarely accessed.
+	// Voxels can be compressed with LZ4 while the block stays loaded. They are decompressed the next time they are
+	// accessed, which can happen from several threads holding a read lock on the block.
+
+	// Compresses voxels if they are not referenced anywhere else and if it saves memory. Returns how many bytes were
+	// saved. The block must be locked for write.
+	size_t compress_voxels();
+
+	inline bool is_voxels_compressed() const {
+		return _voxels_compressed.load(std::memory_order_acquire);
+	}
+
+	// Gets how many bytes voxels use in memory, without decompressing them.
+	size_t get_voxels_size_in_bytes() const;
+
+	// Returns true if voxels were decompressed since the last call, which means they were accessed. Must not be
+	// called while voxels are compressed.
+	inline bool pop_decompressed_flag() {
+		const bool decompressed = _decompressed;
+		_decompressed = false;
+		return decompressed;
+	}
+
+	// Marks voxels as referenced by a snapshot, such as data about to be saved. They must not be modified in place
+	// anymore: the next write access will copy them instead. This avoids copying every block when saving, only blocks
+	// edited again before the save completes are copied.
+	inline void set_voxels_in_snapshot() {
+		_voxels_in_snapshot = _voxels != nullptr;
+	}
+
+	inline bool is_voxels_in_snapshot() const {
+		return _voxels_in_snapshot;
+	}
+
+	// Gives the block its own copy of voxels if they are referenced by a snapshot. This must be done before writing
+	// into voxels obtained with `get_voxels_shared`. The block must be locked for write.
+	void unshare_voxels() const;
+
 	void set_modified(bool modified);
 
 	inline bool is_modified() const {
 		return _modified;
 	}
 
-	void set_needs_lodding(bool need_lodding) {
-		_needs_lodding = need_lodding;
+	// Marks an area of the block as needing to be propagated to lower-resolution LODs. The area is in voxels, relative
+	// to the block. Returns true if the block didn't need lodding before.
+	bool add_lodding_area(const Box3i &area) {
+		if (_needs_lodding) {
+			_lodding_area = Box3i::get_bounding_box(_lodding_area, area);
+			return false;
+		}
+		_needs_lodding = true;
+		_lodding_area = area;
+		return true;
+	}
+
+	void clear_needs_lodding() {
+		_needs_lodding = false;
 	}
 
 	inline bool get_needs_lodding() const {
 		return _needs_lodding;
 	}
 
+	// Only relevant if the block needs lodding
+	inline const Box3i &get_lodding_area() const {
+		return _lodding_area;
+	}
+
 	inline void set_edited(bool edited) {
 		_edited = edited;
 	}
@@ -126,9 +224,33 @@ public:
 		return _edited;
 	}
 
+	// Time at which the block was last used, in an arbitrary unit chosen by the terrain. Used to evict least recently
+	// used blocks first.
+	inline void set_last_access_time(uint32_t time) {
+		_last_access_time = time;
+	}
+
+	inline uint32_t get_last_access_time() const {
+		return _last_access_time;
+	}
+
 private:
-	// Voxel data. If null, it means the data may be obtained with procedural generation.
-	std::shared_ptr<VoxelBuffer> _voxels;
+	void decompress_voxels() const;
+
+	// Voxel data. If null, it means the data may be obtained with procedural generation, or that it is compressed.
+	// Mutable because it may be swapped with a copy when unsharing from a snapshot, or created when decompressing,
+	// which don't change contents.
+	mutable std::shared_ptr<VoxelBuffer> _voxels;
+
+	// Serialized and compressed voxels, if the block was compressed in memory
+	mutable std::shared_ptr<const StdVector<uint8_t>> _compressed_voxels;
+	// Set while voxels are compressed. Cleared after `_voxels` is assigned when decompressing, so threads that see it
+	// cleared can access voxels without locking.
+	mutable std::atomic_bool _voxels_compressed = { false };
+	// Prevents several threads from decompressing voxels at the same time
+	mutable SpinLock _decompression_lock;
+	// Set when voxels get decompressed
+	mutable bool _decompressed = false;
 
 	// TODO Storing lod index here might not be necessary, it is known since we have to get the map first.
 	// For now it can remain here since in practice it doesn't cost space, due to other stored flags and alignment.
@@ -145,6 +267,14 @@ private:
 	// Once it becomes `true`, it usually never comes back to `false` unless reverted.
 	bool _edited = false;
 
+	// Part of the block that changed since lower-resolution LODs were last updated.
+	Box3i _lodding_area;
+
+	uint32_t _last_access_time = 0;
+
+	// If true, voxels are also referenced by a snapshot and must be copied before being modified.
+	mutable bool _voxels_in_snapshot = false;
+
 	// TODO Optimization: design a proper way to implement client-side caching for multiplayer
 	//
 	// Represents how many times the block was edited.
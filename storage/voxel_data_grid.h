@@ -55,6 +55,8 @@ public:
 		spatial_lock.unlock_read(blocks_box);
 
 		_spatial_lock = &spatial_lock;
+		_map = &map;
+		_map_lock = &map_lock;
 	}
 
 	inline bool has_any_block() const {
@@ -107,6 +109,7 @@ public:
 		ZN_ASSERT(!_locked);
 		_spatial_lock->lock_write(BoxBounds3i::from_position_size(_offset_in_blocks, _size_in_blocks));
 		_locked = true;
+		unshare_blocks_from_snapshots();
 	}
 
 	inline void unlock_write() {
@@ -192,6 +195,8 @@ public:
 		_blocks.clear();
 		_size_in_blocks = Vector3i();
 		_spatial_lock = nullptr;
+		_map = nullptr;
+		_map_lock = nullptr;
 	}
 
 	inline VoxelBuffer *get_block_no_lock(Vector3i position) {
@@ -202,6 +207,10 @@ public:
 		return _block_size_po2;
 	}
 
+	inline Vector3i get_size_in_blocks() const {
+		return _size_in_blocks;
+	}
+
 	inline Vector3i get_origin_block_position_in_blocks() const {
 		return _offset_in_blocks;
 	}
@@ -247,6 +256,36 @@ private:
 		}
 	}
 
+	// Blocks referenced by the grid may since have been handed to a snapshot (for saving), in which case they must not
+	// be written into. Gets blocks again from the map after giving them their own copy.
+	void unshare_blocks_from_snapshots() {
+		if (_map == nullptr) {
+			return;
+		}
+		RWLockRead rlock(*_map_lock);
+		const Box3i blocks_box(_offset_in_blocks, _size_in_blocks);
+		unsigned int index = 0;
+		blocks_box.for_each_cell_zxy([this, &index](const Vector3i pos) {
+			std::shared_ptr<VoxelBuffer> &slot = _blocks[index];
+			++index;
+			if (slot == nullptr) {
+				return;
+			}
+			const VoxelDataBlock *block = _map->get_block(pos);
+			if (block == nullptr || !block->has_voxels()) {
+				// Block was unloaded since the grid was created, writing into it would have no effect
+				slot = nullptr;
+				return;
+			}
+			if (block->is_voxels_in_snapshot()) {
+				// Release our reference first, so it doesn't force a copy if the snapshot is already done
+				slot = nullptr;
+				block->unshare_voxels();
+			}
+			slot = block->get_voxels_shared();
+		});
+	}
+
 	inline void create(Vector3i size, unsigned int block_size) {
 		ZN_PROFILE_SCOPE();
 		_blocks.clear();
@@ -299,6 +338,10 @@ private:
 	// For protecting voxel data against multithreaded accesses. Not owned. Lifetime must be guaranteed by the user, for
 	// example by having a std::shared_ptr<VoxelData> holding the spatial lock.
 	SpatialLock3D *_spatial_lock = nullptr;
+	// Map the blocks come from, used to unshare blocks from snapshots before writing. Not owned, same lifetime
+	// requirements as the spatial lock.
+	const VoxelDataMap *_map = nullptr;
+	RWLock *_map_lock = nullptr;
 	mutable bool _locked = false;
 };
 
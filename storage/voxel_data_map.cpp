@@ -63,7 +63,7 @@ VoxelDataBlock *VoxelDataMap::create_default_block(Vector3i bpos) {
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT_RETURN_V(!has_block(bpos), nullptr);
 #endif
-	VoxelDataBlock &map_block = _blocks_map[bpos];
+	VoxelDataBlock &map_block = _blocks_map.get_or_insert(bpos);
 	map_block = VoxelDataBlock(buffer, _lod_index);
 	return &map_block;
 }
@@ -106,19 +106,11 @@ void VoxelDataMap::set_voxel_f(real_t value, Vector3i pos, unsigned int c) {
 }
 
 VoxelDataBlock *VoxelDataMap::get_block(Vector3i bpos) {
-	auto it = _blocks_map.find(bpos);
-	if (it != _blocks_map.end()) {
-		return &it->second;
-	}
-	return nullptr;
+	return _blocks_map.find(bpos);
 }
 
 const VoxelDataBlock *VoxelDataMap::get_block(Vector3i bpos) const {
-	auto it = _blocks_map.find(bpos);
-	if (it != _blocks_map.end()) {
-		return &it->second;
-	}
-	return nullptr;
+	return _blocks_map.find(bpos);
 }
 
 VoxelDataBlock *VoxelDataMap::set_block_buffer(Vector3i bpos, std::shared_ptr<VoxelBuffer> &buffer, bool overwrite) {
@@ -127,7 +119,7 @@ VoxelDataBlock *VoxelDataMap::set_block_buffer(Vector3i bpos, std::shared_ptr<Vo
 	VoxelDataBlock *block = get_block(bpos);
 
 	if (block == nullptr) {
-		VoxelDataBlock &map_block = _blocks_map[bpos];
+		VoxelDataBlock &map_block = _blocks_map.get_or_insert(bpos);
 		map_block = VoxelDataBlock(buffer, _lod_index);
 		block = &map_block;
 
@@ -148,14 +140,14 @@ void VoxelDataMap::set_block(Vector3i bpos, const VoxelDataBlock &block) {
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT(block.get_lod_index() == _lod_index);
 #endif
-	_blocks_map[bpos] = block;
+	_blocks_map.get_or_insert(bpos) = block;
 }
 
 VoxelDataBlock *VoxelDataMap::set_empty_block(Vector3i bpos, bool overwrite) {
 	VoxelDataBlock *block = get_block(bpos);
 
 	if (block == nullptr) {
-		VoxelDataBlock &map_block = _blocks_map[bpos];
+		VoxelDataBlock &map_block = _blocks_map.get_or_insert(bpos);
 		map_block = VoxelDataBlock(_lod_index);
 		block = &map_block;
 
@@ -173,7 +165,7 @@ VoxelDataBlock *VoxelDataMap::set_empty_block(Vector3i bpos, bool overwrite) {
 }
 
 bool VoxelDataMap::has_block(Vector3i pos) const {
-	return _blocks_map.find(pos) != _blocks_map.end();
+	return _blocks_map.has(pos);
 }
 
 bool VoxelDataMap::is_block_surrounded(Vector3i pos) const {
@@ -4,7 +4,7 @@
 #include "../constants/voxel_constants.h"
 #include "../util/containers/fixed_array.h"
 #include "../util/containers/span.h"
-#include "../util/containers/std_unordered_map.h"
+#include "../util/containers/spatial_hash_map.h"
 #include "../util/math/box3i.h"
 #include "../util/profiling.h"
 #include "voxel_buffer.h" // Used in template methods
@@ -111,11 +111,7 @@ public:
 
 	template <typename Action_T>
 	void remove_block(Vector3i bpos, Action_T pre_delete) {
-		auto it = _blocks_map.find(bpos);
-		if (it != _blocks_map.end()) {
-			pre_delete(it->second);
-			_blocks_map.erase(it);
-		}
+		_blocks_map.erase(bpos, pre_delete);
 	}
 
 	VoxelDataBlock *get_block(Vector3i bpos);
@@ -131,25 +127,19 @@ public:
 	// op(Vector3i bpos)
 	template <typename Op_T>
 	inline void for_each_block_position(Op_T op) const {
-		for (auto it = _blocks_map.begin(); it != _blocks_map.end(); ++it) {
-			op(it->first);
-		}
+		_blocks_map.for_each_key(op);
 	}
 
 	// op(Vector3i bpos, VoxelDataBlock &block)
 	template <typename Op_T>
 	inline void for_each_block(Op_T op) {
-		for (auto it = _blocks_map.begin(); it != _blocks_map.end(); ++it) {
-			op(it->first, it->second);
-		}
+		_blocks_map.for_each(op);
 	}
 
 	// void op(Vector3i bpos, const VoxelDataBlock &block)
 	template <typename Op_T>
 	inline void for_each_block(Op_T op) const {
-		for (auto it = _blocks_map.begin(); it != _blocks_map.end(); ++it) {
-			op(it->first, it->second);
-		}
+		_blocks_map.for_each(op);
 	}
 
 	bool is_area_fully_loaded(const Box3i voxels_box) const;
@@ -216,9 +206,12 @@ private:
 	// Blocks stored with a spatial hash in all 3D directions.
 	// Before I used Godot 3's HashMap with RELATIONSHIP = 2 because that delivers better performance compared to
 	// defaults, but it sometimes has very long stalls on removal, which std::unordered_map doesn't seem to have
-	// (not as badly). Also overall performance is slightly better.
-	// Note: pointers to elements remain valid when inserting or removing others (only iterators may be invalidated)
-	StdUnorderedMap<Vector3i, VoxelDataBlock> _blocks_map;
+	// (not as badly). Then std::unordered_map was used, but lookups chased a pointer per node, which shows up when
+	// gathering many neighbors for copies and meshing. The open-addressing map doesn't have either problem, as removal
+	// only shifts a few buckets back.
+	// Note: pointers to elements remain valid when inserting or removing others. Some code relies on that to access
+	// blocks without keeping the map locked.
+	SpatialHashMap<VoxelDataBlock> _blocks_map;
 
 	// This was a possible optimization in a single-threaded scenario, but it's not in multithread.
 	// We want to be able to do shared read-accesses but this is a mutable variable.
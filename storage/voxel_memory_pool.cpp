@@ -4,6 +4,8 @@
 #include "../util/profiling.h"
 #include "../util/string/format.h"
 #include "../util/string/std_string.h"
+#include <algorithm>
+#include <cstring>
 
 namespace zylann::voxel {
 
@@ -119,27 +121,10 @@ uint8_t *VoxelMemoryPool::allocate(size_t size) {
 #endif
 	} else {
 		const unsigned int pot = get_pool_index_from_size(size);
-		Pool &pool = _pot_pools[pot];
-		pool.mutex.lock();
-		if (pool.blocks.size() > 0) {
-			block = pool.blocks.back();
-			pool.blocks.pop_back();
-			pool.mutex.unlock();
-		} else {
-			pool.mutex.unlock();
-			ZN_PROFILE_SCOPE_NAMED("new alloc");
-			// All allocations done in this pool have the same size,
-			// which must be greater or equal to `size`
-			const size_t capacity = get_size_from_pool_index(pot);
-#ifdef DEBUG_ENABLED
-			ZN_ASSERT(capacity >= size);
-#endif
-			block = (uint8_t *)ZN_ALLOC(capacity * sizeof(uint8_t));
-			_total_memory += size;
-		}
+		block = allocate_pooled(pot, size);
 #ifdef DEBUG_ENABLED
 		if (block != nullptr) {
-			pool.debug_used_blocks.add(block);
+			_pot_pools[pot].debug_used_blocks.add(block);
 		}
 #endif
 	}
@@ -170,43 +155,384 @@ void VoxelMemoryPool::recycle(uint8_t *block, size_t size) {
 		_total_memory -= size;
 	} else {
 		const unsigned int pot = get_pool_index_from_size(size);
-		Pool &pool = _pot_pools[pot];
 #ifdef DEBUG_ENABLED
 		// Make sure this allocation was done by this pool in this scenario
-		pool.debug_used_blocks.remove(block);
+		_pot_pools[pot].debug_used_blocks.remove(block);
 #endif
-		MutexLock lock(pool.mutex);
-		pool.blocks.push_back(block);
+		recycle_pooled(block, pot);
 	}
 	--_used_blocks;
 	_used_memory -= size;
 }
 
-void VoxelMemoryPool::clear_unused_blocks() {
+VoxelMemoryPool::ThreadCache::~ThreadCache() {
+	if (pool != nullptr && pool == g_memory_pool) {
+		pool->flush_thread_cache(*this);
+	} else {
+		// The pool is gone, the blocks can only be freed
+		free_orphaned_blocks();
+	}
+}
+
+void VoxelMemoryPool::ThreadCache::free_orphaned_blocks() {
+	for (unsigned int pot = 0; pot < magazines.size(); ++pot) {
+		Magazine &magazine = magazines[pot];
+		// Slabs were freed with the pool
+		if (!from_arenas || pot < MIN_ARENA_POOL_INDEX) {
+			for (unsigned int i = 0; i < magazine.count; ++i) {
+				ZN_FREE(magazine.blocks[i]);
+			}
+		}
+		magazine.count = 0;
+	}
+}
+
+VoxelMemoryPool::ThreadCache &VoxelMemoryPool::get_thread_cache() {
+	static thread_local ThreadCache tls_cache;
+	ThreadCache &cache = tls_cache;
+	const uint32_t generation = _thread_cache_generation.load(std::memory_order_relaxed);
+	if (cache.pool != this || cache.generation != generation) {
+		if (cache.pool == this) {
+			flush_thread_cache(cache);
+		} else if (cache.pool != nullptr) {
+			// Blocks from a previous pool
+			cache.free_orphaned_blocks();
+		}
+		cache.pool = this;
+		cache.generation = generation;
+		cache.from_arenas = _arenas_enabled;
+	}
+	return cache;
+}
+
+uint8_t *VoxelMemoryPool::allocate_pooled(unsigned int pot, size_t size) {
+	ThreadCache &cache = get_thread_cache();
+	ThreadCache::Magazine &magazine = cache.magazines[pot];
+
+	if (magazine.count > 0) {
+		++cache.stats.hits;
+		++cache.unreported_hits;
+		--magazine.count;
+		return magazine.blocks[magazine.count];
+	}
+
+	++cache.stats.misses;
+	++_thread_cache_misses;
+	_thread_cache_hits += cache.unreported_hits;
+	cache.unreported_hits = 0;
+
+	// All allocations done in this pool have the same size,
+	// which must be greater or equal to `size`
+	const size_t capacity = get_size_from_pool_index(pot);
+#ifdef DEBUG_ENABLED
+	ZN_ASSERT(capacity >= size);
+#endif
+
+	uint8_t *block = nullptr;
+	Pool &pool = _pot_pools[pot];
+	{
+		MutexLock lock(pool.mutex);
+		const size_t initial_count = pool.blocks.size();
+		if (pool.blocks.size() > 0) {
+			block = pool.blocks.back().data;
+			pool.blocks.pop_back();
+		}
+		// Take more blocks at once so the next allocations don't have to lock
+		const unsigned int refill_count = (get_magazine_capacity(pot) + 1) / 2;
+		while (magazine.count < refill_count && pool.blocks.size() > 0) {
+			magazine.blocks[magazine.count] = pool.blocks.back().data;
+			++magazine.count;
+			pool.blocks.pop_back();
+		}
+		_unused_memory -= (initial_count - pool.blocks.size()) * capacity;
+	}
+
+	if (block == nullptr) {
+		ZN_PROFILE_SCOPE_NAMED("new alloc");
+		if (uses_arenas(pot)) {
+			MutexLock lock(pool.mutex);
+			block = allocate_from_slabs(pool, pot);
+		} else {
+			block = (uint8_t *)ZN_ALLOC(capacity * sizeof(uint8_t));
+		}
+		if (block != nullptr) {
+			_total_memory += capacity;
+			++pool.allocated_blocks;
+		}
+	}
+
+	return block;
+}
+
+void VoxelMemoryPool::recycle_pooled(uint8_t *block, unsigned int pot) {
+	ThreadCache &cache = get_thread_cache();
+	ThreadCache::Magazine &magazine = cache.magazines[pot];
+	const unsigned int magazine_capacity = get_magazine_capacity(pot);
+
+	if (magazine.count < magazine_capacity) {
+		magazine.blocks[magazine.count] = block;
+		++magazine.count;
+		return;
+	}
+
+	Pool &pool = _pot_pools[pot];
+	MutexLock lock(pool.mutex);
+	push_unused_block(pool, block);
+	// Give back half of the cached blocks, so the next recycles don't have to lock
+	const unsigned int keep_count = magazine_capacity / 2;
+	while (magazine.count > keep_count) {
+		--magazine.count;
+		push_unused_block(pool, magazine.blocks[magazine.count]);
+	}
+	_unused_memory += (magazine_capacity - keep_count + 1) * get_size_from_pool_index(pot);
+	enforce_unused_memory_budgets(pool, pot);
+}
+
+void VoxelMemoryPool::flush_thread_cache(ThreadCache &cache) {
+	ZN_ASSERT(cache.pool == this);
+	for (unsigned int pot = 0; pot < cache.magazines.size(); ++pot) {
+		ThreadCache::Magazine &magazine = cache.magazines[pot];
+		if (magazine.count == 0) {
+			continue;
+		}
+		Pool &pool = _pot_pools[pot];
+		MutexLock lock(pool.mutex);
+		for (unsigned int i = 0; i < magazine.count; ++i) {
+			push_unused_block(pool, magazine.blocks[i]);
+		}
+		_unused_memory += magazine.count * get_size_from_pool_index(pot);
+		magazine.count = 0;
+		enforce_unused_memory_budgets(pool, pot);
+	}
+	_thread_cache_hits += cache.unreported_hits;
+	cache.unreported_hits = 0;
+}
+
+// Pool must be locked. Does not count unused memory.
+void VoxelMemoryPool::push_unused_block(Pool &pool, uint8_t *block) {
+	pool.blocks.push_back(UnusedBlock{ block, _time_msec.load(std::memory_order_relaxed) });
+}
+
+// Pool must be locked
+void VoxelMemoryPool::free_oldest_unused_blocks(Pool &pool, unsigned int pot, unsigned int count) {
+	if (count == 0) {
+		return;
+	}
+	ZN_ASSERT(count <= pool.blocks.size());
+	for (unsigned int i = 0; i < count; ++i) {
+		free_block(pool, pot, pool.blocks[i].data);
+	}
+	pool.blocks.erase(pool.blocks.begin(), pool.blocks.begin() + count);
+	const size_t size = count * get_size_from_pool_index(pot);
+	_unused_memory -= size;
+	_total_memory -= size;
+	pool.allocated_blocks -= count;
+}
+
+// Pool must be locked. Does not count memory.
+void VoxelMemoryPool::free_block(Pool &pool, unsigned int pot, uint8_t *block) {
+	if (uses_arenas(pot)) {
+		free_to_slabs(pool, pot, block);
+	} else {
+		ZN_FREE(block);
+	}
+}
+
+// Pool must be locked. Does not count memory.
+uint8_t *VoxelMemoryPool::allocate_from_slabs(Pool &pool, unsigned int pot) {
+	const unsigned int blocks_per_slab = SLAB_SIZE >> pot;
+
+	for (unsigned int slab_index = pool.slab_search_index; slab_index < pool.slabs.size(); ++slab_index) {
+		Slab &slab = pool.slabs[slab_index];
+		uint8_t *block = nullptr;
+		if (slab.free_list != nullptr) {
+			block = slab.free_list;
+			memcpy(&slab.free_list, block, sizeof(uint8_t *));
+		} else if (slab.carved_count < blocks_per_slab) {
+			block = slab.data + (size_t(slab.carved_count) << pot);
+			++slab.carved_count;
+		} else {
+			continue;
+		}
+		++slab.live_count;
+		pool.slab_search_index = slab_index;
+		return block;
+	}
+
+	// All slabs are full
+	ZN_PROFILE_SCOPE_NAMED("new slab");
+	bool large_pages = false;
+	uint8_t *data = static_cast<uint8_t *>(allocate_large_pages(SLAB_SIZE, large_pages));
+	if (data == nullptr) {
+		return nullptr;
+	}
+	auto it = std::upper_bound(pool.slabs.begin(), pool.slabs.end(), data, [](const uint8_t *d, const Slab &slab) {
+		return d < slab.data;
+	});
+	it = pool.slabs.insert(it, Slab{ data, nullptr, 1, 1, large_pages });
+	// Slabs before the new one are full
+	pool.slab_search_index = it - pool.slabs.begin();
+	++_slab_count;
+	if (large_pages) {
+		++_large_page_slab_count;
+	}
+	return data;
+}
+
+// Pool must be locked. Does not count memory.
+void VoxelMemoryPool::free_to_slabs(Pool &pool, unsigned int pot, uint8_t *block) {
+	auto it = std::upper_bound(pool.slabs.begin(), pool.slabs.end(), block, [](const uint8_t *b, const Slab &slab) {
+		return b < slab.data;
+	});
+	ZN_ASSERT_RETURN(it != pool.slabs.begin());
+	--it;
+	Slab &slab = *it;
+	ZN_ASSERT_RETURN(block < slab.data + SLAB_SIZE);
+	const unsigned int slab_index = it - pool.slabs.begin();
+
+	--slab.live_count;
+	if (slab.live_count > 0) {
+		memcpy(block, &slab.free_list, sizeof(uint8_t *));
+		slab.free_list = block;
+		if (slab_index < pool.slab_search_index) {
+			pool.slab_search_index = slab_index;
+		}
+		return;
+	}
+
+	// The slab is fully free
+	free_large_pages(slab.data, SLAB_SIZE);
+	--_slab_count;
+	if (slab.large_pages) {
+		--_large_page_slab_count;
+	}
+	pool.slabs.erase(it);
+	if (slab_index < pool.slab_search_index) {
+		--pool.slab_search_index;
+	}
+}
+
+// Pool must be locked
+void VoxelMemoryPool::enforce_unused_memory_budgets(Pool &pool, unsigned int pot) {
+	const size_t block_size = get_size_from_pool_index(pot);
+	const uint64_t global_budget = _unused_memory_budget.load(std::memory_order_relaxed);
+	const uint64_t unused_memory = _unused_memory;
+	size_t pool_unused_memory = pool.blocks.size() * block_size;
+
+	// Budgets are rarely exceeded, so checking them first avoids any work in the common case
+	if (pool_unused_memory <= pool.unused_memory_budget && unused_memory <= global_budget) {
+		return;
+	}
+
+	unsigned int count = 0;
+	while (count < pool.blocks.size() &&
+		   (pool_unused_memory > pool.unused_memory_budget || unused_memory - count * block_size > global_budget)) {
+		++count;
+		pool_unused_memory -= block_size;
+	}
+	free_oldest_unused_blocks(pool, pot, count);
+}
+
+void VoxelMemoryPool::trim(uint64_t now_msec) {
+	ZN_PROFILE_SCOPE();
+	_time_msec = now_msec;
+	const uint32_t max_idle_time_msec = _max_idle_time_msec;
+
 	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
 		Pool &pool = _pot_pools[pot];
 		MutexLock lock(pool.mutex);
-		for (unsigned int i = 0; i < pool.blocks.size(); ++i) {
-			void *block = pool.blocks[i];
-			ZN_FREE(block);
+
+		if (max_idle_time_msec > 0) {
+			// Blocks are sorted by recycle time, so idle ones are all at the beginning
+			unsigned int count = 0;
+			while (count < pool.blocks.size() &&
+				   pool.blocks[count].recycle_time_msec + max_idle_time_msec <= now_msec) {
+				++count;
+			}
+			free_oldest_unused_blocks(pool, pot, count);
 		}
-		_total_memory -= get_size_from_pool_index(pot) * pool.blocks.size();
-		pool.blocks.clear();
+
+		// Budgets may have changed since blocks were recycled
+		enforce_unused_memory_budgets(pool, pot);
+	}
+}
+
+void VoxelMemoryPool::set_unused_memory_budget(size_t size_in_bytes) {
+	_unused_memory_budget = size_in_bytes;
+}
+
+size_t VoxelMemoryPool::get_unused_memory_budget() const {
+	return _unused_memory_budget;
+}
+
+void VoxelMemoryPool::set_unused_memory_budget_for_block_size(size_t block_size, size_t budget_in_bytes) {
+	ZN_ASSERT_RETURN(block_size > 0 && block_size <= get_highest_supported_size());
+	Pool &pool = _pot_pools[get_pool_index_from_size(block_size)];
+	MutexLock lock(pool.mutex);
+	pool.unused_memory_budget = budget_in_bytes;
+}
+
+void VoxelMemoryPool::set_max_idle_time_msec(uint32_t msec) {
+	_max_idle_time_msec = msec;
+}
+
+uint32_t VoxelMemoryPool::get_max_idle_time_msec() const {
+	return _max_idle_time_msec;
+}
+
+void VoxelMemoryPool::set_arenas_enabled(bool enabled) {
+	if (enabled == _arenas_enabled) {
+		return;
+	}
+	// Blocks would not be freed the same way they were allocated
+	ZN_ASSERT_RETURN_MSG(_total_memory == 0, "Arenas can't be toggled while memory is allocated from the pool");
+	_arenas_enabled = enabled;
+	// Empty thread caches only need to update how they free their blocks
+	++_thread_cache_generation;
+}
+
+bool VoxelMemoryPool::is_arenas_enabled() const {
+	return _arenas_enabled;
+}
+
+void VoxelMemoryPool::clear_unused_blocks() {
+	// Other threads will give back their cached blocks when they next use the pool
+	++_thread_cache_generation;
+	flush_thread_cache(get_thread_cache());
+
+	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
+		Pool &pool = _pot_pools[pot];
+		MutexLock lock(pool.mutex);
+		free_oldest_unused_blocks(pool, pot, pool.blocks.size());
 	}
 }
 
 void VoxelMemoryPool::clear() {
+	// Blocks cached by other threads will be freed when these threads exit
+	flush_thread_cache(get_thread_cache());
+
 	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
 		Pool &pool = _pot_pools[pot];
 		MutexLock lock(pool.mutex);
-		for (unsigned int i = 0; i < pool.blocks.size(); ++i) {
-			void *block = pool.blocks[i];
-			ZN_FREE(block);
+		if (!uses_arenas(pot)) {
+			for (unsigned int i = 0; i < pool.blocks.size(); ++i) {
+				ZN_FREE(pool.blocks[i].data);
+			}
 		}
 		pool.blocks.clear();
+		pool.allocated_blocks = 0;
+		// Blocks still used at this point are leaks
+		for (const Slab &slab : pool.slabs) {
+			free_large_pages(slab.data, SLAB_SIZE);
+		}
+		pool.slabs.clear();
+		pool.slab_search_index = 0;
 	}
+	_slab_count = 0;
+	_large_page_slab_count = 0;
 	_used_memory = 0;
 	_total_memory = 0;
+	_unused_memory = 0;
 	_used_blocks = 0;
 }
 
@@ -215,8 +541,14 @@ void VoxelMemoryPool::debug_print() {
 	for (unsigned int pot = 0; pot < _pot_pools.size(); ++pot) {
 		Pool &pool = _pot_pools[pot];
 		MutexLock lock(pool.mutex);
-		print_line(format("Pool {}: {} blocks (capacity {})", pot, pool.blocks.size(), pool.blocks.capacity()));
+		print_line(format("Pool {}: {} allocated blocks, {} unused (capacity {}), {} slabs", pot,
+				pool.allocated_blocks.load(), pool.blocks.size(), pool.blocks.capacity(), pool.slabs.size()));
 	}
+	const ThreadCacheStats stats = debug_get_thread_cache_total_stats();
+	const uint64_t total = stats.hits + stats.misses;
+	const uint64_t hit_percent = total > 0 ? 100 * stats.hits / total : 0;
+	print_line(format("Unused memory: {} bytes", _unused_memory.load()));
+	print_line(format("Thread caches: {} hits, {} misses ({}% hits)", stats.hits, stats.misses, hit_percent));
 }
 
 unsigned int VoxelMemoryPool::debug_get_used_blocks() const {
@@ -231,4 +563,41 @@ size_t VoxelMemoryPool::debug_get_total_memory() const {
 	return _total_memory;
 }
 
+size_t VoxelMemoryPool::debug_get_unused_memory() const {
+	return _unused_memory;
+}
+
+size_t VoxelMemoryPool::debug_get_arena_memory() const {
+	return _slab_count * SLAB_SIZE;
+}
+
+unsigned int VoxelMemoryPool::debug_get_large_page_slab_count() const {
+	return _large_page_slab_count;
+}
+
+VoxelMemoryPool::PoolStats VoxelMemoryPool::debug_get_pool_stats(unsigned int pool_index) {
+	ZN_ASSERT_RETURN_V(pool_index < _pot_pools.size(), PoolStats());
+	Pool &pool = _pot_pools[pool_index];
+	PoolStats stats;
+	stats.block_size = get_size_from_pool_index(pool_index);
+	stats.allocated_blocks = pool.allocated_blocks;
+	{
+		MutexLock lock(pool.mutex);
+		stats.unused_blocks = pool.blocks.size();
+		stats.slab_count = pool.slabs.size();
+	}
+	return stats;
+}
+
+VoxelMemoryPool::ThreadCacheStats VoxelMemoryPool::debug_get_thread_cache_stats() {
+	return get_thread_cache().stats;
+}
+
+VoxelMemoryPool::ThreadCacheStats VoxelMemoryPool::debug_get_thread_cache_total_stats() const {
+	ThreadCacheStats stats;
+	stats.hits = _thread_cache_hits;
+	stats.misses = _thread_cache_misses;
+	return stats;
+}
+
 } // namespace zylann::voxel
@@ -8,6 +8,7 @@
 #include "../util/containers/std_vector.h"
 #include "../util/dstack.h"
 #include "../util/math/funcs.h"
+#include "../util/memory/large_pages.h"
 #include "../util/thread/mutex.h"
 
 #include <atomic>
@@ -20,7 +21,30 @@ namespace zylann::voxel {
 // The majority of VoxelBuffers use powers of two so most of the time
 // we won't waste memory. Sometimes non-power-of-two buffers are created,
 // but they are often temporary and less numerous.
+// Each thread also keeps a few recycled blocks of each size in a local cache, so most allocations and recycles don't
+// need to lock. Blocks move between that cache and the shared pools in batches.
+// Optionally, blocks can be carved from large slabs of memory ("arenas") instead of being allocated one by one, which
+// reduces TLB misses and page faults when a lot of voxel data is loaded. Slabs are backed by large pages if the system
+// allows it, and are freed once all their blocks are freed.
 class VoxelMemoryPool {
+public:
+	struct ThreadCacheStats {
+		// Allocations served from the local cache of a thread
+		uint64_t hits = 0;
+		// Allocations that had to go to the shared pool
+		uint64_t misses = 0;
+	};
+
+	struct PoolStats {
+		size_t block_size = 0;
+		// Blocks currently allocated from the system for this size, whether they are used or not
+		unsigned int allocated_blocks = 0;
+		// Blocks kept in the shared pool for reuse. Blocks cached by threads are not included.
+		unsigned int unused_blocks = 0;
+		// Slabs blocks of this size are carved from, when arenas are enabled
+		unsigned int slab_count = 0;
+	};
+
 private:
 #ifdef DEBUG_ENABLED
 	struct DebugUsedBlocks {
@@ -45,15 +69,77 @@ private:
 	};
 #endif
 
+	struct UnusedBlock {
+		uint8_t *data;
+		// Time at which the block was recycled, in milliseconds
+		uint64_t recycle_time_msec;
+	};
+
+	struct Slab {
+		uint8_t *data;
+		// Blocks given back to the slab, linked through their first bytes
+		uint8_t *free_list;
+		// Blocks carved from the beginning of the slab so far. Memory after them was never used.
+		uint32_t carved_count;
+		// Blocks of the slab that are not in the free list, whether they are used or unused in the pool
+		uint32_t live_count;
+		bool large_pages;
+	};
+
 	struct Pool {
 		Mutex mutex;
 		// Would a linked list be better?
-		StdVector<uint8_t *> blocks;
+		// Blocks are reused from the back, so they are also sorted from least to most recently recycled.
+		StdVector<UnusedBlock> blocks;
+		size_t unused_memory_budget = std::numeric_limits<size_t>::max();
+		std::atomic_uint32_t allocated_blocks = { 0 };
+		// Sorted by address, so the slab of a block can be found with a binary search
+		StdVector<Slab> slabs;
+		// All slabs before this index are full
+		unsigned int slab_search_index = 0;
 #ifdef DEBUG_ENABLED
 		DebugUsedBlocks debug_used_blocks;
 #endif
 	};
 
+	// We handle allocations with up to 2^20 = 1,048,576 bytes.
+	// This is chosen based on practical needs.
+	// Each slot in the pool array corresponds to allocations
+	// that contain 2^index bytes in them.
+	static const unsigned int POOL_COUNT = 21;
+
+	// Maximum amount of blocks a thread can cache for each size
+	static const unsigned int MAX_MAGAZINE_CAPACITY = 16;
+	// Maximum amount of memory a thread can cache for each size. Sizes for which this is less than one block are not
+	// cached.
+	static const size_t MAX_MAGAZINE_SIZE_IN_BYTES = 128 * 1024;
+
+	static const size_t SLAB_SIZE = LARGE_PAGE_SIZE;
+	// Smaller blocks can't hold the link of the free list of their slab, so they are not carved from slabs
+	static const unsigned int MIN_ARENA_POOL_INDEX = 3;
+
+	struct ThreadCache {
+		struct Magazine {
+			FixedArray<uint8_t *, MAX_MAGAZINE_CAPACITY> blocks;
+			unsigned int count = 0;
+		};
+
+		FixedArray<Magazine, POOL_COUNT> magazines;
+		// Pool the cached blocks were taken from
+		VoxelMemoryPool *pool = nullptr;
+		// Cached blocks are given back when this no longer matches the pool's generation
+		uint32_t generation = 0;
+		// If true, cached blocks of sizes using arenas belong to slabs of the pool, so they can't be freed on their own
+		bool from_arenas = false;
+		ThreadCacheStats stats;
+		// Hits not yet added to the pool's totals
+		uint64_t unreported_hits = 0;
+
+		~ThreadCache();
+		// Frees blocks after their pool was destroyed
+		void free_orphaned_blocks();
+	};
+
 public:
 	static void create_singleton();
 	static void destroy_singleton();
@@ -65,16 +151,76 @@ public:
 	uint8_t *allocate(size_t size);
 	void recycle(uint8_t *block, size_t size);
 
+	// Frees blocks that are not used. Blocks cached by other threads are given back to the pool the next time these
+	// threads use it, so they will be freed by a later call.
 	void clear_unused_blocks();
 
 	void debug_print();
 	unsigned int debug_get_used_blocks() const;
 	size_t debug_get_used_memory() const;
 	size_t debug_get_total_memory() const;
+	// Stats of the cache of the calling thread
+	ThreadCacheStats debug_get_thread_cache_stats();
+	// Stats of all threads. Hits are gathered when a thread accesses the shared pool, so they can lag behind.
+	ThreadCacheStats debug_get_thread_cache_total_stats() const;
+	// Memory kept in the shared pool for reuse
+	size_t debug_get_unused_memory() const;
+
+	static unsigned int get_pool_count() {
+		return POOL_COUNT;
+	}
+	PoolStats debug_get_pool_stats(unsigned int pool_index);
+
+	// Sets how much memory the shared pool can keep for reuse in total. When it is exceeded, the least recently
+	// recycled blocks of the size being recycled are freed.
+	void set_unused_memory_budget(size_t size_in_bytes);
+	size_t get_unused_memory_budget() const;
+
+	// Sets how much memory the shared pool can keep for reuse for blocks of a given size.
+	void set_unused_memory_budget_for_block_size(size_t block_size, size_t budget_in_bytes);
+
+	// Blocks unused for longer than this are freed by `trim`. 0 means blocks can stay unused indefinitely.
+	void set_max_idle_time_msec(uint32_t msec);
+	uint32_t get_max_idle_time_msec() const;
+
+	// Enables carving blocks from large slabs of memory. Can only be changed while no memory is allocated from the
+	// pool, so it is expected to be set on startup.
+	void set_arenas_enabled(bool enabled);
+	bool is_arenas_enabled() const;
+
+	// Memory reserved by slabs, whether their blocks are used or not
+	size_t debug_get_arena_memory() const;
+	// How many slabs are backed by large pages
+	unsigned int debug_get_large_page_slab_count() const;
+
+	// Frees unused blocks that have been idle for too long, or exceed budgets. Expected to be called periodically,
+	// which also gives the time used to measure how long blocks remain unused.
+	void trim(uint64_t now_msec);
 
 private:
 	void clear();
 
+	inline unsigned int get_magazine_capacity(unsigned int pool_index) const {
+		return static_cast<unsigned int>(
+				math::min(size_t(MAX_MAGAZINE_CAPACITY), MAX_MAGAZINE_SIZE_IN_BYTES >> pool_index)
+		);
+	}
+
+	ThreadCache &get_thread_cache();
+	uint8_t *allocate_pooled(unsigned int pool_index, size_t size);
+	void recycle_pooled(uint8_t *block, unsigned int pool_index);
+	void flush_thread_cache(ThreadCache &cache);
+	void push_unused_block(Pool &pool, uint8_t *block);
+	void free_oldest_unused_blocks(Pool &pool, unsigned int pool_index, unsigned int count);
+	void enforce_unused_memory_budgets(Pool &pool, unsigned int pool_index);
+	void free_block(Pool &pool, unsigned int pool_index, uint8_t *block);
+	uint8_t *allocate_from_slabs(Pool &pool, unsigned int pool_index);
+	void free_to_slabs(Pool &pool, unsigned int pool_index, uint8_t *block);
+
+	inline bool uses_arenas(unsigned int pool_index) const {
+		return _arenas_enabled && pool_index >= MIN_ARENA_POOL_INDEX;
+	}
+
 	inline size_t get_highest_supported_size() const {
 		return size_t(1) << (_pot_pools.size() - 1);
 	}
@@ -95,11 +241,7 @@ private:
 	void debug_print_used_blocks(unsigned int max_amount);
 #endif
 
-	// We handle allocations with up to 2^20 = 1,048,576 bytes.
-	// This is chosen based on practical needs.
-	// Each slot in this array corresponds to allocations
-	// that contain 2^index bytes in them.
-	FixedArray<Pool, 21> _pot_pools;
+	FixedArray<Pool, POOL_COUNT> _pot_pools;
 #ifdef DEBUG_ENABLED
 	DebugUsedBlocks _debug_nonpooled_used_blocks;
 #endif
@@ -107,6 +249,21 @@ private:
 	std::atomic_uint32_t _used_blocks = { 0 };
 	std::atomic_uint64_t _used_memory = { 0 };
 	std::atomic_uint64_t _total_memory = { 0 };
+
+	// Memory in `_pot_pools` waiting to be reused
+	std::atomic_uint64_t _unused_memory = { 0 };
+	std::atomic_uint64_t _unused_memory_budget = { std::numeric_limits<uint64_t>::max() };
+	std::atomic_uint32_t _max_idle_time_msec = { 0 };
+	// Time given by the last call to `trim`, used to date recycled blocks
+	std::atomic_uint64_t _time_msec = { 0 };
+
+	std::atomic_uint32_t _thread_cache_generation = { 0 };
+	std::atomic_uint64_t _thread_cache_hits = { 0 };
+	std::atomic_uint64_t _thread_cache_misses = { 0 };
+
+	bool _arenas_enabled = false;
+	std::atomic_uint32_t _slab_count = { 0 };
+	std::atomic_uint32_t _large_page_slab_count = { 0 };
 };
 
 } // namespace zylann::voxel
@@ -0,0 +1,54 @@
+#include "batched_stream_job.h"
+#include "../engine/voxel_engine.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+BatchedStreamJobTask::BatchedStreamJobTask(std::shared_ptr<BatchedStreamJobState> state, uint32_t batch_index) :
+		_job_state(state), _batch_index(batch_index) {
+	++_job_state->unfinished_task_count;
+	++_job_state->running_task_count;
+}
+
+BatchedStreamJobTask::~BatchedStreamJobTask() {
+	if (!_finished) {
+		// Cancelled before it could run
+		on_finished();
+	}
+}
+
+TaskPriority BatchedStreamJobTask::get_priority() {
+	// Run after everything else, so terrains being played keep streaming smoothly
+	return TaskPriority::min();
+}
+
+bool BatchedStreamJobTask::is_cancelled() {
+	return _job_state->cancelled;
+}
+
+void BatchedStreamJobTask::run(ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+
+	process_batch(_batch_index);
+
+	_batch_index = _job_state->next_batch_index++;
+	if (_batch_index < _job_state->batch_count && !_job_state->cancelled) {
+		ctx.status = ThreadedTaskContext::STATUS_POSTPONED;
+	} else {
+		on_finished();
+	}
+}
+
+void BatchedStreamJobTask::on_finished() {
+	_finished = true;
+	if (--_job_state->unfinished_task_count == 0) {
+		_job_state->finish();
+	}
+	--_job_state->running_task_count;
+}
+
+void push_batched_stream_job_tasks(Span<IThreadedTask *> tasks) {
+	VoxelEngine::get_singleton().push_async_tasks(tasks);
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,72 @@
+#ifndef VOXEL_BATCHED_STREAM_JOB_H
+#define VOXEL_BATCHED_STREAM_JOB_H
+
+#include "../util/containers/std_vector.h"
+#include "../util/math/funcs.h"
+#include "../util/tasks/threaded_task.h"
+#include <atomic>
+#include <memory>
+
+namespace zylann::voxel {
+
+// State shared by the tasks of a job which processes many batches of blocks in the thread pool, like pre-generating an
+// area or copying a stream. Jobs derive it with their own parameters and counters. Tasks may outlive the job.
+struct BatchedStreamJobState {
+	uint32_t batch_count = 0;
+	std::atomic_uint32_t next_batch_index = { 0 };
+	// Tasks which didn't finish yet, including those still waiting in the thread pool
+	std::atomic_uint32_t unfinished_task_count = { 0 };
+	// Decremented after `finish`, so the job is still seen as running while it happens
+	std::atomic_uint32_t running_task_count = { 0 };
+	std::atomic_bool cancelled = { false };
+
+	virtual ~BatchedStreamJobState() {}
+
+	// Called once by the last task of the job to go away, even if the job was cancelled
+	virtual void finish() {}
+};
+
+// Processes batches of a job one after the other. After each batch, the task gets postponed with the next batch, so
+// other tasks of the thread pool can run in between, and the job never has more tasks than it started with.
+class BatchedStreamJobTask : public IThreadedTask {
+public:
+	BatchedStreamJobTask(std::shared_ptr<BatchedStreamJobState> state, uint32_t batch_index);
+	~BatchedStreamJobTask();
+
+	TaskPriority get_priority() override;
+	bool is_cancelled() override;
+	void run(ThreadedTaskContext &ctx) override;
+
+protected:
+	virtual void process_batch(uint32_t batch_index) = 0;
+
+private:
+	void on_finished();
+
+	std::shared_ptr<BatchedStreamJobState> _job_state;
+	uint32_t _batch_index;
+	bool _finished = false;
+};
+
+void push_batched_stream_job_tasks(Span<IThreadedTask *> tasks);
+
+// Pushes up to `max_task_count` tasks of type `TTask` to process the batches of a job. They are constructed with the
+// state and the index of their first batch.
+template <typename TTask, typename TState>
+void start_batched_stream_job_tasks(std::shared_ptr<TState> state, unsigned int max_task_count) {
+	const unsigned int task_count = math::min(max_task_count, state->batch_count);
+	if (task_count == 0) {
+		return;
+	}
+	state->next_batch_index = task_count;
+
+	StdVector<IThreadedTask *> tasks;
+	for (unsigned int i = 0; i < task_count; ++i) {
+		tasks.push_back(ZN_NEW(TTask(state, i)));
+	}
+	push_batched_stream_job_tasks(to_span(tasks));
+}
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_BATCHED_STREAM_JOB_H
@@ -1,13 +1,178 @@
 #include "compressed_data.h"
 #include "../thirdparty/lz4/lz4.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/hash_funcs.h"
 #include "../util/io/serialization.h"
+#include "../util/memory/memory.h"
 #include "../util/profiling.h"
 #include "../util/string/format.h"
 
+#ifdef VOXEL_ENABLE_ZSTD
+// Provided by Godot Engine
+#include <zstd.h>
+#endif
+
+#include <algorithm>
 #include <limits>
 
 namespace zylann::voxel::CompressedData {
 
+namespace {
+
+const uint32_t LZ4_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+const uint32_t ZSTD_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t);
+
+#ifdef VOXEL_ENABLE_ZSTD
+
+// Contexts are expensive to create, so each thread keeps its own
+struct ZstdContexts {
+	ZSTD_CCtx *cctx = nullptr;
+	ZSTD_DCtx *dctx = nullptr;
+
+	~ZstdContexts() {
+		ZSTD_freeCCtx(cctx);
+		ZSTD_freeDCtx(dctx);
+	}
+
+	ZSTD_CCtx *get_cctx() {
+		if (cctx == nullptr) {
+			cctx = ZSTD_createCCtx();
+		}
+		return cctx;
+	}
+
+	ZSTD_DCtx *get_dctx() {
+		if (dctx == nullptr) {
+			dctx = ZSTD_createDCtx();
+		}
+		return dctx;
+	}
+};
+
+ZstdContexts &get_tls_zstd_contexts() {
+	thread_local ZstdContexts tls_contexts;
+	return tls_contexts;
+}
+
+#endif
+
+} // namespace
+
+ZstdDictionary::~ZstdDictionary() {
+#ifdef VOXEL_ENABLE_ZSTD
+	ZSTD_freeCDict(static_cast<ZSTD_CDict *>(_cdict));
+	ZSTD_freeDDict(static_cast<ZSTD_DDict *>(_ddict));
+#endif
+}
+
+std::shared_ptr<ZstdDictionary> ZstdDictionary::create(Span<const uint8_t> data, int compression_level) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(data.size() > 0, nullptr);
+
+	std::shared_ptr<ZstdDictionary> dictionary = make_shared_instance<ZstdDictionary>();
+	dictionary->_data.resize(data.size());
+	memcpy(dictionary->_data.data(), data.data(), data.size());
+	dictionary->_id = compute_id(data);
+	dictionary->_compression_level = compression_level;
+
+#ifdef VOXEL_ENABLE_ZSTD
+	// Zstd finds its parameters from the dictionary when it has the format produced by `zdict`, otherwise the whole
+	// dictionary is used as raw content
+	dictionary->_cdict = ZSTD_createCDict(dictionary->_data.data(), dictionary->_data.size(), compression_level);
+	dictionary->_ddict = ZSTD_createDDict(dictionary->_data.data(), dictionary->_data.size());
+	ZN_ASSERT_RETURN_V_MSG(
+			dictionary->_cdict != nullptr && dictionary->_ddict != nullptr, nullptr, "Failed to create Zstd dictionary"
+	);
+#endif
+
+	return dictionary;
+}
+
+uint32_t ZstdDictionary::compute_id(Span<const uint8_t> data) {
+	uint32_t h = HASH_MURMUR3_SEED;
+	for (const uint8_t b : data) {
+		h = hash_murmur3_one_32(b, h);
+	}
+	h = hash_fmix32(h ^ data.size());
+	// 0 means no dictionary
+	return h == 0 ? 1 : h;
+}
+
+bool is_zstd_supported() {
+#ifdef VOXEL_ENABLE_ZSTD
+	return true;
+#else
+	return false;
+#endif
+}
+
+void build_zstd_dictionary(Span<const Span<const uint8_t>> samples, unsigned int max_size, StdVector<uint8_t> &dst) {
+	ZN_PROFILE_SCOPE();
+
+	// This is a simplified version of the approach taken by `zdict`, which is not included in all builds: count how
+	// many samples contain each segment, and keep the most common ones. Since samples are mostly serialized blocks
+	// sharing the same layout, segments are taken at fixed offsets.
+	static const unsigned int SEGMENT_SIZE = 32;
+
+	struct Segment {
+		uint32_t first_sample_index;
+		uint32_t offset;
+		uint32_t last_sample_index;
+		uint32_t sample_count;
+	};
+
+	StdUnorderedMap<uint64_t, Segment> segments;
+
+	for (unsigned int sample_index = 0; sample_index < samples.size(); ++sample_index) {
+		const Span<const uint8_t> sample = samples[sample_index];
+
+		for (unsigned int offset = 0; offset + SEGMENT_SIZE <= sample.size(); offset += SEGMENT_SIZE) {
+			// FNV-1a
+			uint64_t h = 14695981039346656037ull;
+			for (unsigned int i = 0; i < SEGMENT_SIZE; ++i) {
+				h = (h ^ sample[offset + i]) * 1099511628211ull;
+			}
+
+			auto it = segments.find(h);
+			if (it == segments.end()) {
+				segments.insert({ h, Segment{ sample_index, offset, sample_index, 1 } });
+			} else if (it->second.last_sample_index != sample_index) {
+				it->second.last_sample_index = sample_index;
+				++it->second.sample_count;
+			}
+		}
+	}
+
+	StdVector<Segment> common_segments;
+	for (auto it = segments.begin(); it != segments.end(); ++it) {
+		// Segments found in only one sample are not worth including
+		if (it->second.sample_count > 1) {
+			common_segments.push_back(it->second);
+		}
+	}
+
+	std::sort(common_segments.begin(), common_segments.end(), [](const Segment &a, const Segment &b) {
+		if (a.sample_count != b.sample_count) {
+			return a.sample_count > b.sample_count;
+		}
+		if (a.first_sample_index != b.first_sample_index) {
+			return a.first_sample_index < b.first_sample_index;
+		}
+		return a.offset < b.offset;
+	});
+
+	const unsigned int segment_count = std::min<size_t>(common_segments.size(), max_size / SEGMENT_SIZE);
+
+	dst.resize(segment_count * SEGMENT_SIZE);
+
+	// Zstd references recent content with smaller offsets, so the most common segments go at the end
+	for (unsigned int i = 0; i < segment_count; ++i) {
+		const Segment &segment = common_segments[i];
+		const Span<const uint8_t> sample = samples[segment.first_sample_index];
+		memcpy(dst.data() + (segment_count - i - 1) * SEGMENT_SIZE, sample.data() + segment.offset, SEGMENT_SIZE);
+	}
+}
+
 bool decompress_lz4(MemoryReader &f, Span<const uint8_t> src, StdVector<uint8_t> &dst) {
 	const int decompressed_size = f.get_32();
 	ZN_ASSERT_RETURN_V(decompressed_size >= 0, false);
@@ -28,7 +193,74 @@ bool decompress_lz4(MemoryReader &f, Span<const uint8_t> src, StdVector<uint8_t>
 	return true;
 }
 
-bool decompress(Span<const uint8_t> src, StdVector<uint8_t> &dst) {
+bool decompress_zstd(
+		MemoryReader &f,
+		Span<const uint8_t> src,
+		StdVector<uint8_t> &dst,
+		Span<const std::shared_ptr<ZstdDictionary>> dictionaries
+) {
+#ifdef VOXEL_ENABLE_ZSTD
+	ZN_ASSERT_RETURN_V(src.size() >= ZSTD_HEADER_SIZE, false);
+
+	const uint32_t decompressed_size = f.get_32();
+	const uint32_t dictionary_id = f.get_32();
+
+	const ZstdDictionary *dictionary = nullptr;
+	if (dictionary_id != 0) {
+		for (const std::shared_ptr<ZstdDictionary> &d : dictionaries) {
+			if (d != nullptr && d->get_id() == dictionary_id) {
+				dictionary = d.get();
+				break;
+			}
+		}
+		ZN_ASSERT_RETURN_V_MSG(
+				dictionary != nullptr,
+				false,
+				format("Zstd dictionary {} required to decompress not found", dictionary_id)
+		);
+	}
+
+	dst.resize(decompressed_size);
+
+	ZSTD_DCtx *dctx = get_tls_zstd_contexts().get_dctx();
+	const uint8_t *compressed_data = src.data() + ZSTD_HEADER_SIZE;
+	const size_t compressed_size = src.size() - ZSTD_HEADER_SIZE;
+
+	const size_t actually_decompressed_size = dictionary != nullptr
+			? ZSTD_decompress_usingDDict(
+					  dctx,
+					  dst.data(),
+					  dst.size(),
+					  compressed_data,
+					  compressed_size,
+					  static_cast<const ZSTD_DDict *>(dictionary->get_ddict())
+			  )
+			: ZSTD_decompressDCtx(dctx, dst.data(), dst.size(), compressed_data, compressed_size);
+
+	ZN_ASSERT_RETURN_V_MSG(
+			!ZSTD_isError(actually_decompressed_size),
+			false,
+			format("Zstd decompression error: {}", ZSTD_getErrorName(actually_decompressed_size))
+	);
+
+	ZN_ASSERT_RETURN_V_MSG(
+			actually_decompressed_size == decompressed_size,
+			false,
+			format("Expected {} bytes, obtained {}", decompressed_size, actually_decompressed_size)
+	);
+
+	return true;
+#else
+	ZN_PRINT_ERROR("Can't decompress Zstd data, this build does not include Zstd");
+	return false;
+#endif
+}
+
+bool decompress(
+		Span<const uint8_t> src,
+		StdVector<uint8_t> &dst,
+		Span<const std::shared_ptr<ZstdDictionary>> zstd_dictionaries
+) {
 	ZN_PROFILE_SCOPE();
 
 	MemoryReader f(src, ENDIANNESS_LITTLE_ENDIAN);
@@ -54,6 +286,10 @@ bool decompress(Span<const uint8_t> src, StdVector<uint8_t> &dst) {
 			ZN_ASSERT_RETURN_V(decompress_lz4(f, src, dst), false);
 			break;
 
+		case COMPRESSION_ZSTD:
+			ZN_ASSERT_RETURN_V(decompress_zstd(f, src, dst, zstd_dictionaries), false);
+			break;
+
 		default:
 			ZN_PRINT_ERROR("Invalid compression header");
 			return false;
@@ -62,51 +298,143 @@ bool decompress(Span<const uint8_t> src, StdVector<uint8_t> &dst) {
 	return true;
 }
 
-bool compress_lz4(MemoryWriter &f, Span<const uint8_t> src, StdVector<uint8_t> &dst) {
+bool compress_lz4(Span<const uint8_t> src, Span<uint8_t> dst, Compression comp, size_t &out_size) {
+	ZN_ASSERT_RETURN_V(src.size() <= static_cast<size_t>(LZ4_MAX_INPUT_SIZE), false);
+	ZN_ASSERT_RETURN_V(dst.size() >= get_compressed_size_bound(src.size(), comp), false);
+
+	ByteSpanWithPosition dst_with_position(dst, 0);
+	MemoryWriterExistingBuffer f(dst_with_position, ENDIANNESS_LITTLE_ENDIAN);
+	f.store_8(comp);
+	f.store_32(src.size());
+
+	// The destination may be larger than needed if the caller re-uses it between calls
+	const size_t capacity =
+			std::min(dst.size() - LZ4_HEADER_SIZE, static_cast<size_t>(std::numeric_limits<int>::max()));
+
+	const int compressed_size = LZ4_compress_default(
+			(const char *)src.data(), (char *)dst.data() + LZ4_HEADER_SIZE, src.size(), capacity
+	);
+
+	ZN_ASSERT_RETURN_V(compressed_size > 0, false);
+
+	out_size = LZ4_HEADER_SIZE + compressed_size;
+	return true;
+}
+
+bool compress_zstd(Span<const uint8_t> src, Span<uint8_t> dst, const ZstdOptions &options, size_t &out_size) {
+#ifdef VOXEL_ENABLE_ZSTD
 	ZN_ASSERT_RETURN_V(src.size() <= std::numeric_limits<uint32_t>::max(), false);
+	ZN_ASSERT_RETURN_V(dst.size() >= get_compressed_size_bound(src.size(), COMPRESSION_ZSTD), false);
+
+	const ZstdDictionary *dictionary = options.dictionary;
 
+	ByteSpanWithPosition dst_with_position(dst, 0);
+	MemoryWriterExistingBuffer f(dst_with_position, ENDIANNESS_LITTLE_ENDIAN);
+	f.store_8(COMPRESSION_ZSTD);
 	f.store_32(src.size());
+	f.store_32(dictionary != nullptr ? dictionary->get_id() : 0);
 
-	const uint32_t header_size = sizeof(uint8_t) + sizeof(uint32_t);
-	dst.resize(header_size + LZ4_compressBound(src.size()));
+	ZSTD_CCtx *cctx = get_tls_zstd_contexts().get_cctx();
+	uint8_t *compressed_data = dst.data() + ZSTD_HEADER_SIZE;
+	const size_t capacity = dst.size() - ZSTD_HEADER_SIZE;
 
-	const uint32_t compressed_size = LZ4_compress_default(
-			(const char *)src.data(), (char *)dst.data() + header_size, src.size(), dst.size() - header_size);
+	size_t compressed_size;
+	if (dictionary == nullptr) {
+		compressed_size =
+				ZSTD_compressCCtx(cctx, compressed_data, capacity, src.data(), src.size(), options.compression_level);
 
-	ZN_ASSERT_RETURN_V(int(compressed_size) >= 0, false);
-	ZN_ASSERT_RETURN_V(compressed_size != 0, false);
+	} else if (dictionary->get_compression_level() == options.compression_level) {
+		// Fastest, the dictionary was already digested for this level
+		compressed_size = ZSTD_compress_usingCDict(
+				cctx,
+				compressed_data,
+				capacity,
+				src.data(),
+				src.size(),
+				static_cast<const ZSTD_CDict *>(dictionary->get_cdict())
+		);
 
-	dst.resize(header_size + compressed_size);
+	} else {
+		const Span<const uint8_t> dictionary_data = dictionary->get_data();
+		compressed_size = ZSTD_compress_usingDict(
+				cctx,
+				compressed_data,
+				capacity,
+				src.data(),
+				src.size(),
+				dictionary_data.data(),
+				dictionary_data.size(),
+				options.compression_level
+		);
+	}
+
+	ZN_ASSERT_RETURN_V_MSG(
+			!ZSTD_isError(compressed_size),
+			false,
+			format("Zstd compression error: {}", ZSTD_getErrorName(compressed_size))
+	);
 
+	out_size = ZSTD_HEADER_SIZE + compressed_size;
 	return true;
+#else
+	ZN_PRINT_ERROR("Can't compress with Zstd, this build does not include Zstd");
+	return false;
+#endif
 }
 
-bool compress(Span<const uint8_t> src, StdVector<uint8_t> &dst, Compression comp) {
+size_t get_compressed_size_bound(size_t src_size, Compression comp) {
+	switch (comp) {
+		case COMPRESSION_NONE:
+			return sizeof(uint8_t) + src_size;
+
+		case COMPRESSION_LZ4_BE:
+		case COMPRESSION_LZ4:
+			if (src_size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+				return 0;
+			}
+			return LZ4_HEADER_SIZE + LZ4_compressBound(src_size);
+
+		case COMPRESSION_ZSTD:
+#ifdef VOXEL_ENABLE_ZSTD
+			return ZSTD_HEADER_SIZE + ZSTD_compressBound(src_size);
+#else
+			return 0;
+#endif
+
+		default:
+			return 0;
+	}
+}
+
+bool compress(
+		Span<const uint8_t> src,
+		Span<uint8_t> dst,
+		size_t &out_size,
+		Compression comp,
+		const ZstdOptions &zstd_options
+) {
 	ZN_PROFILE_SCOPE();
 
 	switch (comp) {
-		case COMPRESSION_NONE: {
-			dst.resize(src.size() + 1);
+		case COMPRESSION_NONE:
+			ZN_ASSERT_RETURN_V(dst.size() >= src.size() + 1, false);
 			dst[0] = comp;
 			memcpy(dst.data() + 1, src.data(), src.size());
-		} break;
+			out_size = src.size() + 1;
+			break;
 
-		case COMPRESSION_LZ4_BE: {
+		case COMPRESSION_LZ4_BE:
 			ZN_PRINT_ERROR("Using deprecated LZ4_BE compression!");
-			dst.clear();
-			MemoryWriter f(dst, ENDIANNESS_LITTLE_ENDIAN);
-			f.store_8(comp);
-			compress_lz4(f, src, dst);
-		} break;
+			ZN_ASSERT_RETURN_V(compress_lz4(src, dst, comp, out_size), false);
+			break;
 
-		case COMPRESSION_LZ4: {
-			// Write header
-			// Must clear first because MemoryWriter writes from the end
-			dst.clear();
-			MemoryWriter f(dst, ENDIANNESS_LITTLE_ENDIAN);
-			f.store_8(comp);
-			compress_lz4(f, src, dst);
-		} break;
+		case COMPRESSION_LZ4:
+			ZN_ASSERT_RETURN_V(compress_lz4(src, dst, comp, out_size), false);
+			break;
+
+		case COMPRESSION_ZSTD:
+			ZN_ASSERT_RETURN_V(compress_zstd(src, dst, zstd_options, out_size), false);
+			break;
 
 		default:
 			ZN_PRINT_ERROR("Invalid compression header");
@@ -116,4 +444,15 @@ bool compress(Span<const uint8_t> src, StdVector<uint8_t> &dst, Compression comp
 	return true;
 }
 
+bool compress(Span<const uint8_t> src, StdVector<uint8_t> &dst, Compression comp, const ZstdOptions &zstd_options) {
+	dst.resize(get_compressed_size_bound(src.size(), comp));
+	size_t size = 0;
+	if (!compress(src, to_span(dst), size, comp, zstd_options)) {
+		dst.clear();
+		return false;
+	}
+	dst.resize(size);
+	return true;
+}
+
 } // namespace zylann::voxel::CompressedData
@@ -4,6 +4,7 @@
 #include "../util/containers/span.h"
 #include "../util/containers/std_vector.h"
 #include <cstdint>
+#include <memory>
 
 namespace zylann::voxel::CompressedData {
 
@@ -23,11 +24,102 @@ enum Compression {
 	// All following bytes are compressed data using LZ4 defaults.
 	// This is the fastest compression format.
 	COMPRESSION_LZ4 = 2,
-	COMPRESSION_COUNT = 3
+	// The next uint32_t will be the size of decompressed data (little endian).
+	// The next uint32_t will be the ID of the dictionary used to compress the data, or 0 if none was used.
+	// All following bytes are a Zstd frame.
+	// Slower to compress than LZ4 but produces smaller data, especially with a dictionary. Decompression stays fast.
+	// Only available in builds that include Zstd.
+	COMPRESSION_ZSTD = 3,
+	COMPRESSION_COUNT = 4
+};
+
+// Data commonly found in what gets compressed, which helps compressing small inputs like individual blocks.
+// Data compressed with a dictionary can only be decompressed with the same dictionary.
+// Once created, it can be used by multiple threads.
+class ZstdDictionary {
+public:
+	static std::shared_ptr<ZstdDictionary> create(Span<const uint8_t> data, int compression_level);
+
+	ZstdDictionary() {}
+	ZstdDictionary(const ZstdDictionary &) = delete;
+	~ZstdDictionary();
+
+	ZstdDictionary &operator=(const ZstdDictionary &) = delete;
+
+	inline uint32_t get_id() const {
+		return _id;
+	}
+
+	inline Span<const uint8_t> get_data() const {
+		return to_span(_data);
+	}
+
+	inline int get_compression_level() const {
+		return _compression_level;
+	}
+
+	// Underlying Zstd objects (`ZSTD_CDict` and `ZSTD_DDict`)
+	inline void *get_cdict() const {
+		return _cdict;
+	}
+
+	inline void *get_ddict() const {
+		return _ddict;
+	}
+
+	static uint32_t compute_id(Span<const uint8_t> data);
+
+private:
+	StdVector<uint8_t> _data;
+	void *_cdict = nullptr;
+	void *_ddict = nullptr;
+	uint32_t _id = 0;
+	int _compression_level = 0;
+};
+
+static const int ZSTD_MIN_COMPRESSION_LEVEL = 1;
+static const int ZSTD_MAX_COMPRESSION_LEVEL = 22;
+static const int ZSTD_DEFAULT_COMPRESSION_LEVEL = 3;
+
+struct ZstdOptions {
+	int compression_level = ZSTD_DEFAULT_COMPRESSION_LEVEL;
+	// Optional
+	const ZstdDictionary *dictionary = nullptr;
 };
 
-bool compress(Span<const uint8_t> src, StdVector<uint8_t> &dst, Compression comp);
-bool decompress(Span<const uint8_t> src, StdVector<uint8_t> &dst);
+bool is_zstd_supported();
+
+// Builds a raw content dictionary from samples of uncompressed data, favoring byte sequences found in many of them.
+void build_zstd_dictionary(Span<const Span<const uint8_t>> samples, unsigned int max_size, StdVector<uint8_t> &dst);
+
+// Maximum size of data produced by `compress` from `src_size` bytes, including headers.
+// Returns 0 if the compression mode is not available or can't compress that much data.
+size_t get_compressed_size_bound(size_t src_size, Compression comp);
+
+bool compress(
+		Span<const uint8_t> src,
+		StdVector<uint8_t> &dst,
+		Compression comp,
+		const ZstdOptions &zstd_options = ZstdOptions()
+);
+
+// Compresses into an existing buffer, which must be at least `get_compressed_size_bound` bytes long. It may be larger,
+// so the same buffer can be re-used for many calls without being resized. `out_size` receives the number of bytes
+// written at the beginning of `dst`.
+bool compress(
+		Span<const uint8_t> src,
+		Span<uint8_t> dst,
+		size_t &out_size,
+		Compression comp,
+		const ZstdOptions &zstd_options = ZstdOptions()
+);
+
+// `zstd_dictionaries` is where the dictionary used by compressed data will be searched, if it uses one.
+bool decompress(
+		Span<const uint8_t> src,
+		StdVector<uint8_t> &dst,
+		Span<const std::shared_ptr<ZstdDictionary>> zstd_dictionaries = Span<const std::shared_ptr<ZstdDictionary>>()
+);
 
 } // namespace zylann::voxel::CompressedData
 
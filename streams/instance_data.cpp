@@ -55,6 +55,129 @@ struct CompressedQuaternion4b {
 	}
 };
 
+void QuantizedInstanceTransforms::set(Span<const Transform3f> transforms) {
+	clear();
+
+	if (transforms.size() == 0) {
+		return;
+	}
+
+	Vector3f position_min = transforms[0].origin;
+	Vector3f position_max = position_min;
+	float scale_min = transforms[0].basis.get_scale_abs().y;
+	float scale_max = scale_min;
+
+	for (const Transform3f &t : transforms) {
+		position_min = math::min(position_min, t.origin);
+		position_max = math::max(position_max, t.origin);
+		const float scale = t.basis.get_scale_abs().y;
+		scale_min = math::min(scale_min, scale);
+		scale_max = math::max(scale_max, scale);
+	}
+
+	const Vector3f position_range = math::max(
+			position_max - position_min, Vector3f(InstanceBlockData::POSITION_RANGE_MINIMUM)
+	);
+	const float scale_range = math::max(scale_max - scale_min, InstanceBlockData::SIMPLE_11B_V1_SCALE_RANGE_MINIMUM);
+
+	_position_min = position_min;
+	_position_step = position_range / float(0xffff);
+	_scale_min = scale_min;
+	_scale_step = scale_range / float(0xff);
+
+	const Vector3f position_norm_scale = Vector3f(float(0xffff)) / position_range;
+	const float scale_norm_scale = float(0xff) / scale_range;
+
+	_positions_x.resize(transforms.size());
+	_positions_y.resize(transforms.size());
+	_positions_z.resize(transforms.size());
+	_scales.resize(transforms.size());
+	_rotations.resize(transforms.size());
+
+	for (unsigned int i = 0; i < transforms.size(); ++i) {
+		const Transform3f &t = transforms[i];
+
+		const Vector3f np = (t.origin - position_min) * position_norm_scale;
+		_positions_x[i] = math::clamp(static_cast<int>(np.x + 0.5f), 0, 0xffff);
+		_positions_y[i] = math::clamp(static_cast<int>(np.y + 0.5f), 0, 0xffff);
+		_positions_z[i] = math::clamp(static_cast<int>(np.z + 0.5f), 0, 0xffff);
+
+		const float scale = t.basis.get_scale_abs().y;
+		_scales[i] = math::clamp(static_cast<int>((scale - scale_min) * scale_norm_scale + 0.5f), 0, 0xff);
+
+		const CompressedQuaternion4b cq = CompressedQuaternion4b::from_quaternion(t.basis.get_rotation_quaternion());
+		_rotations[i] = cq.x | (cq.y << 8) | (cq.z << 16) | (cq.w << 24);
+	}
+}
+
+void QuantizedInstanceTransforms::clear() {
+	_positions_x.clear();
+	_positions_y.clear();
+	_positions_z.clear();
+	_scales.clear();
+	_rotations.clear();
+}
+
+Vector3f QuantizedInstanceTransforms::get_position(unsigned int i) const {
+	return _position_min + Vector3f(_positions_x[i], _positions_y[i], _positions_z[i]) * _position_step;
+}
+
+namespace {
+
+inline Basis3f decode_basis(uint32_t packed_rotation, float scale) {
+	CompressedQuaternion4b cq;
+	cq.x = packed_rotation & 0xff;
+	cq.y = (packed_rotation >> 8) & 0xff;
+	cq.z = (packed_rotation >> 16) & 0xff;
+	cq.w = (packed_rotation >> 24) & 0xff;
+	return Basis3f(cq.to_quaternion()).scaled(scale);
+}
+
+} // namespace
+
+Transform3f QuantizedInstanceTransforms::get_transform(unsigned int i) const {
+	return Transform3f(decode_basis(_rotations[i], _scale_min + _scales[i] * _scale_step), get_position(i));
+}
+
+void QuantizedInstanceTransforms::remove_unordered(unsigned int i) {
+	ZN_ASSERT_RETURN(i < size());
+	_positions_x[i] = _positions_x.back();
+	_positions_y[i] = _positions_y.back();
+	_positions_z[i] = _positions_z.back();
+	_scales[i] = _scales.back();
+	_rotations[i] = _rotations.back();
+	_positions_x.pop_back();
+	_positions_y.pop_back();
+	_positions_z.pop_back();
+	_scales.pop_back();
+	_rotations.pop_back();
+}
+
+void QuantizedInstanceTransforms::decode(StdVector<Transform3f> &dst, Vector3f offset) const {
+	const unsigned int begin_index = dst.size();
+	dst.resize(begin_index + size());
+	Transform3f *transforms = dst.data() + begin_index;
+
+	// Each component is decoded in its own loop so the compiler can vectorize them
+	const Vector3f origin = _position_min + offset;
+	for (unsigned int i = 0; i < size(); ++i) {
+		transforms[i].origin.x = origin.x + _positions_x[i] * _position_step.x;
+	}
+	for (unsigned int i = 0; i < size(); ++i) {
+		transforms[i].origin.y = origin.y + _positions_y[i] * _position_step.y;
+	}
+	for (unsigned int i = 0; i < size(); ++i) {
+		transforms[i].origin.z = origin.z + _positions_z[i] * _position_step.z;
+	}
+	for (unsigned int i = 0; i < size(); ++i) {
+		transforms[i].basis = decode_basis(_rotations[i], _scale_min + _scales[i] * _scale_step);
+	}
+}
+
+size_t QuantizedInstanceTransforms::get_memory_usage() const {
+	return size() * (3 * sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint32_t));
+}
+
 bool serialize_instance_block_data(const InstanceBlockData &src, StdVector<uint8_t> &dst) {
 	const uint8_t instance_format = InstanceBlockData::FORMAT_SIMPLE_11B_V1;
 
@@ -4,9 +4,88 @@
 #include "../util/io/log.h"
 #include "../util/profiling.h"
 #include "../util/string/format.h"
+#include "../util/tasks/async_dependency_tracker.h"
 
 namespace zylann::voxel {
 
+namespace {
+
+// Blocks decoded by one threaded task. Small enough to spread work over all threads, large enough to not spend too
+// much time scheduling tasks with big saves.
+static const unsigned int BLOCKS_PER_DECODE_CHUNK = 1024;
+
+// Blocks inserted into the terrain per time-spread step on the main thread
+static const unsigned int BLOCKS_PER_INSERT_STEP = 128;
+
+bool is_volume_still_interested(VolumeID volume_id, const StreamingDependency &stream_dependency) {
+	if (!VoxelEngine::get_singleton().is_volume_valid(volume_id)) {
+		// This can happen if the user removes the volume while requests are still about to return
+		ZN_PRINT_VERBOSE("Stream data request response came back but volume wasn't found");
+		return false;
+	}
+	// TODO Comparing pointer may not be guaranteed
+	// The request response must match the dependency it would have been requested with.
+	// If it doesn't match, we are no longer interested in the result.
+	return stream_dependency.valid;
+}
+
+// Inserts decoded blocks into the terrain on the main thread, a few at a time so it doesn't cause stalls
+class InsertAllBlocksChunkTask : public ITimeSpreadTask {
+public:
+	void run(TimeSpreadTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+
+		if (!is_volume_still_interested(volume_id, *stream_dependency)) {
+			return;
+		}
+
+		VoxelEngine::VolumeCallbacks callbacks = VoxelEngine::get_singleton().get_volume_callbacks(volume_id);
+		ERR_FAIL_COND(callbacks.data_output_callback == nullptr);
+
+		const unsigned int end_index =
+				math::min(next_index + BLOCKS_PER_INSERT_STEP, static_cast<unsigned int>(blocks.size()));
+
+		for (; next_index < end_index; ++next_index) {
+			VoxelStream::FullLoadingResult::Block &rb = blocks[next_index];
+			if (rb.voxels == nullptr) {
+				// Failed to decode
+				continue;
+			}
+
+			VoxelEngine::BlockDataOutput o;
+			o.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+			o.voxels = std::move(rb.voxels);
+			o.had_instances = false;
+			o.position = rb.position;
+			o.lod_index = rb.lod;
+			o.dropped = false;
+			o.max_lod_hint = false;
+			o.initial_load = true;
+
+			callbacks.data_output_callback(callbacks.data, o);
+		}
+
+		if (next_index < blocks.size()) {
+			ctx.postpone = true;
+			return;
+		}
+
+		tracker->post_complete();
+		if (tracker->is_complete()) {
+			data->set_full_load_completed(true);
+		}
+	}
+
+	VolumeID volume_id;
+	std::shared_ptr<StreamingDependency> stream_dependency;
+	std::shared_ptr<VoxelData> data;
+	StdVector<VoxelStream::FullLoadingResult::Block> blocks;
+	std::shared_ptr<AsyncDependencyTracker> tracker;
+	unsigned int next_index = 0;
+};
+
+} // namespace
+
 void LoadAllBlocksDataTask::run(zylann::ThreadedTaskContext &ctx) {
 	ZN_PROFILE_SCOPE();
 
@@ -14,6 +93,8 @@ void LoadAllBlocksDataTask::run(zylann::ThreadedTaskContext &ctx) {
 	Ref<VoxelStream> stream = stream_dependency->stream;
 	CRASH_COND(stream.is_null());
 
+	// Decoding is done in `DecodeAllBlocksChunkTask`, on multiple threads
+	_result.defer_voxel_decoding = true;
 	stream->load_all_blocks(_result);
 
 	ZN_PRINT_VERBOSE(format("Loaded {} blocks for volume {}", _result.blocks.size(), volume_id));
@@ -23,41 +104,98 @@ TaskPriority LoadAllBlocksDataTask::get_priority() {
 	return TaskPriority();
 }
 
+int LoadAllBlocksDataTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
 bool LoadAllBlocksDataTask::is_cancelled() {
 	return !stream_dependency->valid;
 }
 
 void LoadAllBlocksDataTask::apply_result() {
-	if (VoxelEngine::get_singleton().is_volume_valid(volume_id)) {
-		// TODO Comparing pointer may not be guaranteed
-		// The request response must match the dependency it would have been requested with.
-		// If it doesn't match, we are no longer interested in the result.
-		if (stream_dependency->valid) {
-			VoxelEngine::VolumeCallbacks callbacks = VoxelEngine::get_singleton().get_volume_callbacks(volume_id);
-			ERR_FAIL_COND(callbacks.data_output_callback == nullptr);
-
-			for (auto it = _result.blocks.begin(); it != _result.blocks.end(); ++it) {
-				VoxelStream::FullLoadingResult::Block &rb = *it;
-
-				VoxelEngine::BlockDataOutput o;
-				o.voxels = rb.voxels;
-				o.instances = std::move(rb.instances_data);
-				o.position = rb.position;
-				o.lod_index = rb.lod;
-				o.dropped = false;
-				o.max_lod_hint = false;
-				o.initial_load = true;
-
-				callbacks.data_output_callback(callbacks.data, o);
-			}
+	if (!is_volume_still_interested(volume_id, *stream_dependency)) {
+		return;
+	}
 
-			data->set_full_load_completed(true);
+	if (_result.blocks.size() == 0) {
+		data->set_full_load_completed(true);
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	const unsigned int chunk_count = (_result.blocks.size() + BLOCKS_PER_DECODE_CHUNK - 1) / BLOCKS_PER_DECODE_CHUNK;
+	std::shared_ptr<AsyncDependencyTracker> tracker = make_shared_instance<AsyncDependencyTracker>(chunk_count);
+
+	StdVector<IThreadedTask *> tasks;
+	tasks.reserve(chunk_count);
+
+	for (unsigned int begin_index = 0; begin_index < _result.blocks.size(); begin_index += BLOCKS_PER_DECODE_CHUNK) {
+		const unsigned int end_index =
+				math::min(begin_index + BLOCKS_PER_DECODE_CHUNK, static_cast<unsigned int>(_result.blocks.size()));
+
+		DecodeAllBlocksChunkTask *task = ZN_NEW(DecodeAllBlocksChunkTask);
+		task->volume_id = volume_id;
+		task->stream_dependency = stream_dependency;
+		task->data = data;
+		task->tracker = tracker;
+		task->blocks.reserve(end_index - begin_index);
+		for (unsigned int i = begin_index; i < end_index; ++i) {
+			task->blocks.push_back(std::move(_result.blocks[i]));
 		}
+		tasks.push_back(task);
+	}
 
-	} else {
-		// This can happen if the user removes the volume while requests are still about to return
-		ZN_PRINT_VERBOSE("Stream data request response came back but volume wasn't found");
+	_result.blocks.clear();
+
+	VoxelEngine::get_singleton().push_async_tasks(to_span(tasks));
+}
+
+void DecodeAllBlocksChunkTask::run(zylann::ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+
+	Ref<VoxelStream> stream = stream_dependency->stream;
+	CRASH_COND(stream.is_null());
+
+	for (VoxelStream::FullLoadingResult::Block &block : blocks) {
+		if (block.compressed_voxels.size() == 0) {
+			// Already decoded by the stream
+			continue;
+		}
+		std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		if (stream->decompress_voxel_block(to_span_const(block.compressed_voxels), *voxels)) {
+			block.voxels = voxels;
+		} else {
+			ZN_PRINT_ERROR(format("Failed to decompress block {} lod {}", block.position, block.lod));
+		}
+		block.compressed_voxels = StdVector<uint8_t>();
 	}
 }
 
-} // namespace zylann::voxel
\ No newline at end of file
+TaskPriority DecodeAllBlocksChunkTask::get_priority() {
+	return TaskPriority();
+}
+
+int DecodeAllBlocksChunkTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
+bool DecodeAllBlocksChunkTask::is_cancelled() {
+	return !stream_dependency->valid;
+}
+
+void DecodeAllBlocksChunkTask::apply_result() {
+	if (!is_volume_still_interested(volume_id, *stream_dependency)) {
+		return;
+	}
+
+	InsertAllBlocksChunkTask *task = ZN_NEW(InsertAllBlocksChunkTask);
+	task->volume_id = volume_id;
+	task->stream_dependency = stream_dependency;
+	task->data = data;
+	task->blocks = std::move(blocks);
+	task->tracker = tracker;
+	VoxelEngine::get_singleton().push_main_thread_time_spread_task(task);
+}
+
+} // namespace zylann::voxel
@@ -6,10 +6,16 @@
 #include "../util/tasks/threaded_task.h"
 #include "voxel_stream.h"
 
+namespace zylann {
+class AsyncDependencyTracker;
+}
+
 namespace zylann::voxel {
 
 class VoxelData;
 
+// Loads all blocks of a stream. Decoding them and inserting them into the terrain is then split in chunks, so it can
+// run on multiple threads and be spread over several frames on the main thread.
 class LoadAllBlocksDataTask : public IThreadedTask {
 public:
 	const char *get_debug_name() const override {
@@ -19,6 +25,7 @@ public:
 	void run(ThreadedTaskContext &ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 	void apply_result() override;
 
 	VolumeID volume_id;
@@ -29,6 +36,27 @@ private:
 	VoxelStream::FullLoadingResult _result;
 };
 
+// Decodes a chunk of blocks returned by `LoadAllBlocksDataTask`, then hands them over to the main thread.
+class DecodeAllBlocksChunkTask : public IThreadedTask {
+public:
+	const char *get_debug_name() const override {
+		return "DecodeAllBlocksChunk";
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+	bool is_cancelled() override;
+	int get_group() const override;
+	void apply_result() override;
+
+	VolumeID volume_id;
+	std::shared_ptr<StreamingDependency> stream_dependency;
+	std::shared_ptr<VoxelData> data;
+	StdVector<VoxelStream::FullLoadingResult::Block> blocks;
+	// Tracks chunks that are not inserted yet. Loading is complete when all of them are.
+	std::shared_ptr<AsyncDependencyTracker> tracker;
+};
+
 } // namespace zylann::voxel
 
 #endif // LOAD_ALL_BLOCKS_DATA_TASK_H
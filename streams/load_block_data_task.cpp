@@ -42,7 +42,8 @@ int LoadBlockDataTask::debug_get_running_count() {
 
 void LoadBlockDataTask::run(zylann::ThreadedTaskContext &ctx) {
 	ZN_DSTACK();
-	ZN_PROFILE_SCOPE();
+	ZN_PROFILE_SCOPE_NAMED("LoadBlockDataTask::run");
+	ZN_PROFILE_COUNTER_ADD("Voxel blocks loaded", 1);
 
 	CRASH_COND(_stream_dependency == nullptr);
 	Ref<VoxelStream> stream = _stream_dependency->stream;
@@ -59,7 +60,24 @@ void LoadBlockDataTask::run(zylann::ThreadedTaskContext &ctx) {
 	// TODO Assign max_lod_hint when available
 
 	VoxelStream::VoxelQueryData voxel_query_data{ *_voxels, _position, _lod_index, VoxelStream::RESULT_ERROR };
-	stream->load_voxel_block(voxel_query_data);
+	// Voxels read without decoding them, when the stream supports it
+	StdVector<uint8_t> compressed_voxels;
+
+	// The block may have been saved recently and not be written to the stream yet
+	if (_stream_dependency->save_queue->load_voxel_block(_position, _lod_index, *_voxels)) {
+		voxel_query_data.result = VoxelStream::RESULT_BLOCK_FOUND;
+
+	} else if (stream->supports_compressed_voxel_blocks()) {
+		VoxelStream::CompressedVoxelQueryData compressed_query{
+			StdVector<uint8_t>(), _position, _lod_index, VoxelStream::RESULT_ERROR
+		};
+		stream->load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData>(&compressed_query, 1));
+		voxel_query_data.result = compressed_query.result;
+		compressed_voxels = std::move(compressed_query.data);
+
+	} else {
+		stream->load_voxel_block(voxel_query_data);
+	}
 
 	if (voxel_query_data.result == VoxelStream::RESULT_ERROR) {
 		ERR_PRINT("Error loading voxel block");
@@ -114,6 +132,16 @@ void LoadBlockDataTask::run(zylann::ThreadedTaskContext &ctx) {
 		// which means it can be generated by the instancer after the meshing process
 	}
 
+	if (voxel_query_data.result == VoxelStream::RESULT_BLOCK_FOUND && compressed_voxels.size() > 0) {
+		// Decoding is left to the general pool, this task only accesses the stream
+		DecodeBlockDataTask *task = ThreadedTaskPool<DecodeBlockDataTask>::get_singleton().create(_volume_id,
+				_position, _lod_index, std::move(compressed_voxels), std::move(_voxels), std::move(_instances),
+				_stream_dependency, _priority_dependency, _cancellation_token);
+
+		VoxelEngine::get_singleton().push_async_task(task);
+		_requested_decoding_task = true;
+	}
+
 	_has_run = true;
 }
 
@@ -125,6 +153,10 @@ TaskPriority LoadBlockDataTask::get_priority() {
 	return p;
 }
 
+int LoadBlockDataTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(_volume_id);
+}
+
 bool LoadBlockDataTask::is_cancelled() {
 	if (_stream_dependency->valid == false) {
 		return true;
@@ -135,12 +167,16 @@ bool LoadBlockDataTask::is_cancelled() {
 	return _too_far;
 }
 
+void LoadBlockDataTask::dispose() {
+	ThreadedTaskPool<LoadBlockDataTask>::get_singleton().recycle(this);
+}
+
 void LoadBlockDataTask::apply_result() {
 	if (VoxelEngine::get_singleton().is_volume_valid(_volume_id)) {
 		// TODO Comparing pointer may not be guaranteed
 		// The request response must match the dependency it would have been requested with.
 		// If it doesn't match, we are no longer interested in the result.
-		if (_stream_dependency->valid && !_requested_generator_task) {
+		if (_stream_dependency->valid && !_requested_generator_task && !_requested_decoding_task) {
 			VoxelEngine::BlockDataOutput o;
 			o.voxels = _voxels;
 			o.instances = std::move(_instances);
@@ -162,4 +198,90 @@ void LoadBlockDataTask::apply_result() {
 	}
 }
 
+DecodeBlockDataTask::DecodeBlockDataTask(VolumeID p_volume_id, Vector3i p_block_pos, uint8_t p_lod,
+		StdVector<uint8_t> &&p_data, std::shared_ptr<VoxelBuffer> p_voxels, UniquePtr<InstanceBlockData> p_instances,
+		std::shared_ptr<StreamingDependency> p_stream_dependency, PriorityDependency p_priority_dependency,
+		TaskCancellationToken cancellation_token) :
+		_priority_dependency(p_priority_dependency),
+		_data(std::move(p_data)),
+		_voxels(p_voxels),
+		_instances(std::move(p_instances)),
+		_position(p_block_pos),
+		_volume_id(p_volume_id),
+		_lod_index(p_lod),
+		_stream_dependency(p_stream_dependency),
+		_cancellation_token(cancellation_token) {
+	// Still counted as a streaming task, since the block is not loaded yet
+	++g_debug_load_block_tasks_count;
+}
+
+DecodeBlockDataTask::~DecodeBlockDataTask() {
+	--g_debug_load_block_tasks_count;
+}
+
+void DecodeBlockDataTask::run(zylann::ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+
+	Ref<VoxelStream> stream = _stream_dependency->stream;
+	CRASH_COND(stream.is_null());
+	ZN_ASSERT(_voxels != nullptr);
+
+	if (!stream->decompress_voxel_block(to_span_const(_data), *_voxels)) {
+		ERR_PRINT("Error loading voxel block");
+	}
+	_data = StdVector<uint8_t>();
+
+	_has_run = true;
+}
+
+TaskPriority DecodeBlockDataTask::get_priority() {
+	float closest_viewer_distance_sq;
+	const TaskPriority p =
+			_priority_dependency.evaluate(_lod_index, constants::TASK_PRIORITY_LOAD_BAND2, &closest_viewer_distance_sq);
+	_too_far = closest_viewer_distance_sq > _priority_dependency.drop_distance_squared;
+	return p;
+}
+
+int DecodeBlockDataTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(_volume_id);
+}
+
+bool DecodeBlockDataTask::is_cancelled() {
+	if (_stream_dependency->valid == false) {
+		return true;
+	}
+	if (_cancellation_token.is_valid()) {
+		return _cancellation_token.is_cancelled();
+	}
+	return _too_far;
+}
+
+void DecodeBlockDataTask::dispose() {
+	ThreadedTaskPool<DecodeBlockDataTask>::get_singleton().recycle(this);
+}
+
+void DecodeBlockDataTask::apply_result() {
+	if (VoxelEngine::get_singleton().is_volume_valid(_volume_id)) {
+		if (_stream_dependency->valid) {
+			VoxelEngine::BlockDataOutput o;
+			o.voxels = _voxels;
+			o.instances = std::move(_instances);
+			o.position = _position;
+			o.lod_index = _lod_index;
+			o.dropped = !_has_run;
+			o.max_lod_hint = false;
+			o.initial_load = false;
+			o.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+
+			VoxelEngine::VolumeCallbacks callbacks = VoxelEngine::get_singleton().get_volume_callbacks(_volume_id);
+			CRASH_COND(callbacks.data_output_callback == nullptr);
+			callbacks.data_output_callback(callbacks.data, o);
+		}
+
+	} else {
+		// This can happen if the user removes the volume while requests are still about to return
+		ZN_PRINT_VERBOSE("Stream data request response came back but volume wasn't found");
+	}
+}
+
 } // namespace zylann::voxel
@@ -1,16 +1,21 @@
 #ifndef LOAD_BLOCK_DATA_TASK_H
 #define LOAD_BLOCK_DATA_TASK_H
 
+#include "../constants/voxel_constants.h"
 #include "../engine/ids.h"
 #include "../engine/priority_dependency.h"
 #include "../engine/streaming_dependency.h"
+#include "../util/containers/std_vector.h"
 #include "../util/memory/memory.h"
 #include "../util/tasks/threaded_task.h"
+#include "../util/tasks/threaded_task_pool.h"
 
 namespace zylann::voxel {
 
 class VoxelData;
 
+// Loads a block from the stream. This runs as an I/O task. If the stream supports compressed blocks, only raw data is
+// read here, and decoding it is left to a `DecodeBlockDataTask`, so the I/O thread can move on to other reads.
 class LoadBlockDataTask : public IThreadedTask {
 public:
 	LoadBlockDataTask(VolumeID p_volume_id, Vector3i p_block_pos, uint8_t p_lod, uint8_t p_block_size,
@@ -24,10 +29,17 @@ public:
 		return "LoadBlockData";
 	}
 
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_LOAD;
+	}
+
 	void run(ThreadedTaskContext &ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 	void apply_result() override;
+	// Instances are allocated with `ThreadedTaskPool<LoadBlockDataTask>`, so they go back to it
+	void dispose() override;
 
 	static int debug_get_running_count();
 
@@ -46,12 +58,49 @@ private:
 	bool _max_lod_hint = false;
 	bool _generate_cache_data = true;
 	bool _requested_generator_task = false;
+	bool _requested_decoding_task = false;
 	bool _generator_use_gpu = false;
 	std::shared_ptr<StreamingDependency> _stream_dependency;
 	std::shared_ptr<VoxelData> _voxel_data;
 	TaskCancellationToken _cancellation_token;
 };
 
+// Decodes voxels read by `LoadBlockDataTask`, on the general pool, and returns them to the volume in its place.
+class DecodeBlockDataTask : public IThreadedTask {
+public:
+	DecodeBlockDataTask(VolumeID p_volume_id, Vector3i p_block_pos, uint8_t p_lod, StdVector<uint8_t> &&p_data,
+			std::shared_ptr<VoxelBuffer> p_voxels, UniquePtr<InstanceBlockData> p_instances,
+			std::shared_ptr<StreamingDependency> p_stream_dependency, PriorityDependency p_priority_dependency,
+			TaskCancellationToken cancellation_token);
+
+	~DecodeBlockDataTask();
+
+	const char *get_debug_name() const override {
+		return "DecodeBlockData";
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+	bool is_cancelled() override;
+	int get_group() const override;
+	void apply_result() override;
+	// Instances are allocated with `ThreadedTaskPool<DecodeBlockDataTask>`, so they go back to it
+	void dispose() override;
+
+private:
+	PriorityDependency _priority_dependency;
+	StdVector<uint8_t> _data;
+	std::shared_ptr<VoxelBuffer> _voxels;
+	UniquePtr<InstanceBlockData> _instances;
+	Vector3i _position; // In data blocks of the specified lod
+	VolumeID _volume_id;
+	uint8_t _lod_index;
+	bool _has_run = false;
+	bool _too_far = false;
+	std::shared_ptr<StreamingDependency> _stream_dependency;
+	TaskCancellationToken _cancellation_token;
+};
+
 } // namespace zylann::voxel
 
 #endif // LOAD_BLOCK_DATA_TASK_H
@@ -0,0 +1,174 @@
+#include "load_blocks_in_box_data_task.h"
+#include "../engine/voxel_engine.h"
+#include "../generators/generate_block_task.h"
+#include "../storage/voxel_buffer.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/dstack.h"
+#include "../util/io/log.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+LoadBlocksInBoxDataTask::LoadBlocksInBoxDataTask(VolumeID p_volume_id, Box3i p_box, uint8_t p_lod,
+		uint8_t p_block_size, StdVector<BlockRequest> &&p_blocks,
+		std::shared_ptr<StreamingDependency> p_stream_dependency, PriorityDependency p_priority_dependency,
+		bool generate_cache_data, bool generator_use_gpu, const std::shared_ptr<VoxelData> &vdata) :
+		_priority_dependency(p_priority_dependency),
+		_box(p_box),
+		_blocks(std::move(p_blocks)),
+		_volume_id(p_volume_id),
+		_lod_index(p_lod),
+		_block_size(p_block_size),
+		_generate_cache_data(generate_cache_data),
+		_generator_use_gpu(generator_use_gpu),
+		_stream_dependency(p_stream_dependency),
+		_voxel_data(vdata) {
+	//
+#ifdef DEBUG_ENABLED
+	for (const BlockRequest &request : _blocks) {
+		ZN_ASSERT(_box.contains(request.position));
+	}
+#endif
+}
+
+void LoadBlocksInBoxDataTask::run(zylann::ThreadedTaskContext &ctx) {
+	ZN_DSTACK();
+	ZN_PROFILE_SCOPE();
+
+	CRASH_COND(_stream_dependency == nullptr);
+	Ref<VoxelStream> stream = _stream_dependency->stream;
+	CRASH_COND(stream.is_null());
+
+	VoxelStream::FullLoadingResult loading_result;
+	stream->load_voxel_blocks_in_box(_box, _lod_index, loading_result);
+
+	StdUnorderedMap<Vector3i, std::shared_ptr<VoxelBuffer>> found_blocks;
+	for (VoxelStream::FullLoadingResult::Block &block : loading_result.blocks) {
+		found_blocks[block.position] = std::move(block.voxels);
+	}
+
+	_results.resize(_blocks.size());
+
+	for (unsigned int i = 0; i < _blocks.size(); ++i) {
+		const BlockRequest &request = _blocks[i];
+		BlockResult &result = _results[i];
+
+		if (request.cancellation_token.is_valid() && request.cancellation_token.is_cancelled()) {
+			result.cancelled = true;
+			continue;
+		}
+
+		// The block may have been saved recently and not be written to the stream yet
+		std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		voxels->create(_block_size, _block_size, _block_size);
+		if (_stream_dependency->save_queue->load_voxel_block(request.position, _lod_index, *voxels)) {
+			result.voxels = voxels;
+			continue;
+		}
+
+		auto found_it = found_blocks.find(request.position);
+		if (found_it != found_blocks.end()) {
+			result.voxels = found_it->second;
+			continue;
+		}
+
+		if (_generate_cache_data) {
+			Ref<VoxelGenerator> generator = _stream_dependency->generator;
+
+			if (generator.is_valid()) {
+				VoxelGenerator::BlockTaskParams params;
+				params.voxels = voxels;
+				params.volume_id = _volume_id;
+				params.block_position = request.position;
+				params.lod_index = _lod_index;
+				params.block_size = _block_size;
+				params.stream_dependency = _stream_dependency;
+				params.priority_dependency = _priority_dependency;
+				params.use_gpu = _generator_use_gpu;
+				params.data = _voxel_data;
+				params.cancellation_token = request.cancellation_token;
+
+				IThreadedTask *task = generator->create_block_task(params);
+
+				VoxelEngine::get_singleton().push_async_task(task);
+				result.requested_generator_task = true;
+
+			} else {
+				// Same as `LoadBlockDataTask`, an empty block of default format is returned
+				result.voxels = voxels;
+			}
+		}
+		// Otherwise voxels remain null, telling the block was not found
+	}
+
+	_has_run = true;
+}
+
+TaskPriority LoadBlocksInBoxDataTask::get_priority() {
+	float closest_viewer_distance_sq;
+	const TaskPriority p =
+			_priority_dependency.evaluate(_lod_index, constants::TASK_PRIORITY_LOAD_BAND2, &closest_viewer_distance_sq);
+	_too_far = closest_viewer_distance_sq > _priority_dependency.drop_distance_squared;
+	return p;
+}
+
+int LoadBlocksInBoxDataTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(_volume_id);
+}
+
+bool LoadBlocksInBoxDataTask::is_cancelled() {
+	if (_stream_dependency->valid == false) {
+		return true;
+	}
+	bool has_tokens = false;
+	for (const BlockRequest &request : _blocks) {
+		if (request.cancellation_token.is_valid()) {
+			if (!request.cancellation_token.is_cancelled()) {
+				// At least one block is still needed
+				return false;
+			}
+			has_tokens = true;
+		}
+	}
+	return has_tokens || _too_far;
+}
+
+void LoadBlocksInBoxDataTask::apply_result() {
+	if (VoxelEngine::get_singleton().is_volume_valid(_volume_id)) {
+		// The request response must match the dependency it would have been requested with.
+		// If it doesn't match, we are no longer interested in the result.
+		if (_stream_dependency->valid) {
+			VoxelEngine::VolumeCallbacks callbacks = VoxelEngine::get_singleton().get_volume_callbacks(_volume_id);
+			CRASH_COND(callbacks.data_output_callback == nullptr);
+
+			for (unsigned int i = 0; i < _blocks.size(); ++i) {
+				VoxelEngine::BlockDataOutput o;
+				o.position = _blocks[i].position;
+				o.lod_index = _lod_index;
+				o.max_lod_hint = false;
+				o.initial_load = false;
+				o.type = VoxelEngine::BlockDataOutput::TYPE_LOADED;
+
+				if (_has_run) {
+					BlockResult &result = _results[i];
+					if (result.requested_generator_task) {
+						// The generator task will report that block
+						continue;
+					}
+					o.voxels = std::move(result.voxels);
+					o.dropped = result.cancelled;
+				} else {
+					o.dropped = true;
+				}
+
+				callbacks.data_output_callback(callbacks.data, o);
+			}
+		}
+
+	} else {
+		// This can happen if the user removes the volume while requests are still about to return
+		ZN_PRINT_VERBOSE("Stream data request response came back but volume wasn't found");
+	}
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,71 @@
+#ifndef LOAD_BLOCKS_IN_BOX_DATA_TASK_H
+#define LOAD_BLOCKS_IN_BOX_DATA_TASK_H
+
+#include "../constants/voxel_constants.h"
+#include "../engine/ids.h"
+#include "../engine/priority_dependency.h"
+#include "../engine/streaming_dependency.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+#include "../util/tasks/cancellation_token.h"
+#include "../util/tasks/threaded_task.h"
+
+namespace zylann::voxel {
+
+class VoxelData;
+
+// Loads voxels of a group of neighbor blocks with a single box query to the stream, which is cheaper than one task
+// per block with streams able to read them sequentially. Results are then reported block by block, like
+// `LoadBlockDataTask`. Instances are not loaded.
+class LoadBlocksInBoxDataTask : public IThreadedTask {
+public:
+	struct BlockRequest {
+		Vector3i position;
+		TaskCancellationToken cancellation_token;
+	};
+
+	// All requested blocks must be within the box, but not every block of the box has to be requested.
+	LoadBlocksInBoxDataTask(VolumeID p_volume_id, Box3i p_box, uint8_t p_lod, uint8_t p_block_size,
+			StdVector<BlockRequest> &&p_blocks, std::shared_ptr<StreamingDependency> p_stream_dependency,
+			PriorityDependency p_priority_dependency, bool generate_cache_data, bool generator_use_gpu,
+			const std::shared_ptr<VoxelData> &vdata);
+
+	const char *get_debug_name() const override {
+		return "LoadBlocksInBoxData";
+	}
+
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_LOAD;
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+	bool is_cancelled() override;
+	int get_group() const override;
+	void apply_result() override;
+
+private:
+	struct BlockResult {
+		std::shared_ptr<VoxelBuffer> voxels;
+		bool cancelled = false;
+		bool requested_generator_task = false;
+	};
+
+	PriorityDependency _priority_dependency;
+	Box3i _box; // In data blocks of the specified lod
+	StdVector<BlockRequest> _blocks;
+	StdVector<BlockResult> _results;
+	VolumeID _volume_id;
+	uint8_t _lod_index;
+	uint8_t _block_size;
+	bool _has_run = false;
+	bool _too_far = false;
+	bool _generate_cache_data = true;
+	bool _generator_use_gpu = false;
+	std::shared_ptr<StreamingDependency> _stream_dependency;
+	std::shared_ptr<VoxelData> _voxel_data;
+};
+
+} // namespace zylann::voxel
+
+#endif // LOAD_BLOCKS_IN_BOX_DATA_TASK_H
@@ -0,0 +1,1147 @@
+#include "voxel_stream_log.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../util/godot/classes/directory.h"
+#include "../../util/godot/core/string.h"
+#include "../../util/godot/file_utils.h"
+#include "../../util/hash_funcs.h"
+#include "../../util/io/serialization.h"
+#include "../../util/profiling.h"
+#include "../../util/string/format.h"
+#include "../compressed_data.h"
+#include "../instance_data.h"
+#include "../voxel_block_serializer.h"
+
+#include <algorithm>
+
+namespace zylann::voxel {
+
+namespace {
+
+const char *SEGMENT_FILE_EXTENSION = "seg";
+const char *CHECKPOINT_FILE_NAME = "index.bin";
+const char *CHECKPOINT_TEMP_FILE_NAME = "index.bin.tmp";
+
+const uint32_t RECORD_MAGIC = 0x474f4c56; // "VLOG"
+// Magic, type, LOD, flags, padding, position, data size, checksum
+const unsigned int RECORD_HEADER_SIZE = 4 + 1 + 1 + 1 + 1 + 3 * 4 + 4 + 8;
+// Part of the header covered by the checksum, which comes after it
+const unsigned int RECORD_HEADER_CHECKED_SIZE = RECORD_HEADER_SIZE - 8;
+const uint8_t RECORD_FLAG_DELETED = 1;
+
+const uint32_t CHECKPOINT_MAGIC = 0x4b43504c; // "LPCK"
+const uint8_t CHECKPOINT_VERSION = 0;
+// Type, LOD, position, segment ID, offset, size
+const unsigned int CHECKPOINT_ENTRY_SIZE = 1 + 1 + 3 * 4 + 4 + 4 + 4;
+// Set on the type of entries locating the deletion of a block
+const uint8_t CHECKPOINT_ENTRY_FLAG_DELETED = 0x80;
+
+// Records appended since the last checkpoint have to be read again when opening the stream, so checkpoints are saved
+// regularly to bound that time
+const uint64_t CHECKPOINT_INTERVAL_BYTES = 16 * 1024 * 1024;
+// Segments opened for reading are closed when this many are open
+const unsigned int MAX_OPEN_READ_FILES = 16;
+
+uint64_t get_record_checksum(Span<const uint8_t> header, Span<const uint8_t> data) {
+	const uint64_t h = hash_fnv1a_64(header.data(), header.size());
+	return hash_fnv1a_64(data.data(), data.size(), h);
+}
+
+inline void store_vector3i(MemoryWriter &w, Vector3i v) {
+	w.store_32(v.x);
+	w.store_32(v.y);
+	w.store_32(v.z);
+}
+
+inline Vector3i get_vector3i(MemoryReader &r) {
+	Vector3i v;
+	v.x = static_cast<int32_t>(r.get_32());
+	v.y = static_cast<int32_t>(r.get_32());
+	v.z = static_cast<int32_t>(r.get_32());
+	return v;
+}
+
+} // namespace
+
+VoxelStreamLog::VoxelStreamLog() {}
+
+VoxelStreamLog::~VoxelStreamLog() {
+	MutexLock mlock(_mutex);
+	close();
+}
+
+void VoxelStreamLog::set_directory(String dirpath) {
+	MutexLock mlock(_mutex);
+	if (dirpath == _directory_path) {
+		return;
+	}
+	close();
+	_directory_path = dirpath;
+}
+
+String VoxelStreamLog::get_directory() const {
+	MutexLock mlock(_mutex);
+	return _directory_path;
+}
+
+void VoxelStreamLog::load_voxel_block(VoxelStream::VoxelQueryData &q) {
+	load_voxel_blocks(Span<VoxelStream::VoxelQueryData>(&q, 1));
+}
+
+void VoxelStreamLog::save_voxel_block(VoxelStream::VoxelQueryData &q) {
+	save_voxel_blocks(Span<VoxelStream::VoxelQueryData>(&q, 1));
+}
+
+void VoxelStreamLog::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	// Read all blocks first, so they are decompressed without holding the lock
+	static thread_local StdVector<StdVector<uint8_t>> tls_block_data;
+	StdVector<StdVector<uint8_t>> &block_data = tls_block_data;
+	if (block_data.size() < p_blocks.size()) {
+		block_data.resize(p_blocks.size());
+	}
+	{
+		MutexLock mlock(_mutex);
+		if (!ensure_open()) {
+			for (VoxelQueryData &q : p_blocks) {
+				q.result = RESULT_ERROR;
+			}
+			return;
+		}
+		for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+			VoxelQueryData &q = p_blocks[i];
+			q.result = RESULT_BLOCK_NOT_FOUND;
+			ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+			const StdUnorderedMap<Vector3i, Location> &map = _lods[q.lod_index].blocks[RECORD_VOXELS];
+			auto it = map.find(q.position_in_blocks);
+			if (it == map.end()) {
+				continue;
+			}
+			q.result = read_record_data(it->second, block_data[i]) ? RESULT_BLOCK_FOUND : RESULT_ERROR;
+		}
+	}
+
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		VoxelQueryData &q = p_blocks[i];
+		if (q.result != RESULT_BLOCK_FOUND) {
+			continue;
+		}
+		if (!BlockSerializer::decompress_and_deserialize(to_span(block_data[i]), q.voxel_buffer)) {
+			ZN_PRINT_ERROR(format("Failed to decompress block {} lod {}", q.position_in_blocks, q.lod_index));
+			q.result = RESULT_ERROR;
+		}
+	}
+}
+
+void VoxelStreamLog::save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	static thread_local StdVector<uint8_t> tls_data;
+	static thread_local StdVector<PendingRecord> tls_records;
+	StdVector<uint8_t> &data = tls_data;
+	StdVector<PendingRecord> &records = tls_records;
+	data.clear();
+	records.clear();
+
+	for (const VoxelQueryData &q : p_blocks) {
+		ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+		BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(q.voxel_buffer);
+		ZN_ASSERT_CONTINUE(res.success);
+		records.push_back(
+				PendingRecord{ RECORD_VOXELS, q.lod_index, false, q.position_in_blocks, data.size(), res.data.size() }
+		);
+		data.insert(data.end(), res.data.begin(), res.data.end());
+	}
+
+	MutexLock mlock(_mutex);
+	if (!ensure_open()) {
+		return;
+	}
+	append_records(to_span(records), to_span(data));
+	compact_if_needed();
+}
+
+bool VoxelStreamLog::supports_compressed_voxel_blocks() const {
+	return true;
+}
+
+void VoxelStreamLog::load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> out_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	MutexLock mlock(_mutex);
+	if (!ensure_open()) {
+		for (CompressedVoxelQueryData &q : out_blocks) {
+			q.result = RESULT_ERROR;
+		}
+		return;
+	}
+	for (CompressedVoxelQueryData &q : out_blocks) {
+		q.result = RESULT_BLOCK_NOT_FOUND;
+		ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+		const StdUnorderedMap<Vector3i, Location> &map = _lods[q.lod_index].blocks[RECORD_VOXELS];
+		auto it = map.find(q.position_in_blocks);
+		if (it == map.end()) {
+			continue;
+		}
+		q.result = read_record_data(it->second, q.data) ? RESULT_BLOCK_FOUND : RESULT_ERROR;
+	}
+}
+
+void VoxelStreamLog::save_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	static thread_local StdVector<uint8_t> tls_data;
+	static thread_local StdVector<PendingRecord> tls_records;
+	StdVector<uint8_t> &data = tls_data;
+	StdVector<PendingRecord> &records = tls_records;
+	data.clear();
+	records.clear();
+
+	for (const CompressedVoxelQueryData &q : p_blocks) {
+		ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+		records.push_back(
+				PendingRecord{ RECORD_VOXELS, q.lod_index, false, q.position_in_blocks, data.size(), q.data.size() }
+		);
+		data.insert(data.end(), q.data.begin(), q.data.end());
+	}
+
+	MutexLock mlock(_mutex);
+	if (!ensure_open()) {
+		return;
+	}
+	append_records(to_span(records), to_span(data));
+	compact_if_needed();
+}
+
+bool VoxelStreamLog::supports_instance_blocks() const {
+	return true;
+}
+
+void VoxelStreamLog::load_instance_blocks(Span<VoxelStream::InstancesQueryData> out_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	static thread_local StdVector<StdVector<uint8_t>> tls_block_data;
+	StdVector<StdVector<uint8_t>> &block_data = tls_block_data;
+	if (block_data.size() < out_blocks.size()) {
+		block_data.resize(out_blocks.size());
+	}
+	{
+		MutexLock mlock(_mutex);
+		if (!ensure_open()) {
+			for (InstancesQueryData &q : out_blocks) {
+				q.result = RESULT_ERROR;
+			}
+			return;
+		}
+		for (unsigned int i = 0; i < out_blocks.size(); ++i) {
+			InstancesQueryData &q = out_blocks[i];
+			q.result = RESULT_BLOCK_NOT_FOUND;
+			ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+			const StdUnorderedMap<Vector3i, Location> &map = _lods[q.lod_index].blocks[RECORD_INSTANCES];
+			auto it = map.find(q.position_in_blocks);
+			if (it == map.end()) {
+				continue;
+			}
+			q.result = read_record_data(it->second, block_data[i]) ? RESULT_BLOCK_FOUND : RESULT_ERROR;
+		}
+	}
+
+	StdVector<uint8_t> temp_data;
+
+	for (unsigned int i = 0; i < out_blocks.size(); ++i) {
+		InstancesQueryData &q = out_blocks[i];
+		if (q.result != RESULT_BLOCK_FOUND) {
+			continue;
+		}
+		q.data = make_unique_instance<InstanceBlockData>();
+		if (!CompressedData::decompress(to_span(block_data[i]), temp_data) ||
+			!deserialize_instance_block_data(*q.data, to_span(temp_data))) {
+			ZN_PRINT_ERROR(format("Failed to load instance block {} lod {}", q.position_in_blocks, q.lod_index));
+			q.data.reset();
+			q.result = RESULT_ERROR;
+		}
+	}
+}
+
+void VoxelStreamLog::save_instance_blocks(Span<VoxelStream::InstancesQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	static thread_local StdVector<uint8_t> tls_data;
+	static thread_local StdVector<PendingRecord> tls_records;
+	StdVector<uint8_t> &data = tls_data;
+	StdVector<PendingRecord> &records = tls_records;
+	data.clear();
+	records.clear();
+
+	StdVector<uint8_t> temp_data;
+	StdVector<uint8_t> temp_compressed_data;
+
+	for (const InstancesQueryData &q : p_blocks) {
+		ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+		if (q.data == nullptr) {
+			// Removes the block
+			records.push_back(
+					PendingRecord{ RECORD_INSTANCES, q.lod_index, true, q.position_in_blocks, data.size(), 0 }
+			);
+			continue;
+		}
+		temp_data.clear();
+		ZN_ASSERT_CONTINUE(serialize_instance_block_data(*q.data, temp_data));
+		temp_compressed_data.clear();
+		ZN_ASSERT_CONTINUE(CompressedData::compress(
+				to_span_const(temp_data), temp_compressed_data, CompressedData::COMPRESSION_LZ4
+		));
+		records.push_back(PendingRecord{
+				RECORD_INSTANCES, q.lod_index, false, q.position_in_blocks, data.size(), temp_compressed_data.size() }
+		);
+		data.insert(data.end(), temp_compressed_data.begin(), temp_compressed_data.end());
+	}
+
+	MutexLock mlock(_mutex);
+	if (!ensure_open()) {
+		return;
+	}
+	append_records(to_span(records), to_span(data));
+	compact_if_needed();
+}
+
+bool VoxelStreamLog::get_voxel_block_keys(StdVector<BlockKey> &out_keys) {
+	MutexLock mlock(_mutex);
+	if (!ensure_open()) {
+		return false;
+	}
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		const StdUnorderedMap<Vector3i, Location> &map = _lods[lod_index].blocks[RECORD_VOXELS];
+		for (auto it = map.begin(); it != map.end(); ++it) {
+			out_keys.push_back(BlockKey{ it->first, static_cast<uint8_t>(lod_index) });
+		}
+	}
+	return true;
+}
+
+void VoxelStreamLog::load_all_blocks(FullLoadingResult &result) {
+	ZN_PROFILE_SCOPE();
+	{
+		MutexLock mlock(_mutex);
+		if (!ensure_open()) {
+			return;
+		}
+		for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+			const StdUnorderedMap<Vector3i, Location> &map = _lods[lod_index].blocks[RECORD_VOXELS];
+			for (auto it = map.begin(); it != map.end(); ++it) {
+				FullLoadingResult::Block &block = result.blocks.emplace_back();
+				block.position = it->first;
+				block.lod = lod_index;
+				if (!read_record_data(it->second, block.compressed_voxels)) {
+					result.blocks.pop_back();
+				}
+			}
+		}
+	}
+
+	if (result.defer_voxel_decoding) {
+		return;
+	}
+
+	for (FullLoadingResult::Block &block : result.blocks) {
+		block.voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		ZN_ASSERT_CONTINUE(
+				BlockSerializer::decompress_and_deserialize(to_span(block.compressed_voxels), *block.voxels)
+		);
+		block.compressed_voxels = StdVector<uint8_t>();
+	}
+}
+
+bool VoxelStreamLog::decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const {
+	return BlockSerializer::decompress_and_deserialize(data, out_voxels);
+}
+
+int VoxelStreamLog::get_used_channels_mask() const {
+	return VoxelBuffer::ALL_CHANNELS_MASK;
+}
+
+int VoxelStreamLog::get_lod_count() const {
+	return _lods.size();
+}
+
+void VoxelStreamLog::flush() {
+	MutexLock mlock(_mutex);
+	if (!_opened) {
+		return;
+	}
+	save_checkpoint();
+}
+
+int64_t VoxelStreamLog::get_memory_usage_bytes() const {
+	MutexLock mlock(_mutex);
+	int64_t count = 0;
+	for (const Lod &lod : _lods) {
+		for (const StdUnorderedMap<Vector3i, Location> &map : lod.blocks) {
+			count += map.size();
+		}
+		for (const StdUnorderedMap<Vector3i, Location> &map : lod.tombstones) {
+			count += map.size();
+		}
+	}
+	return count * (sizeof(Vector3i) + sizeof(Location));
+}
+
+void VoxelStreamLog::set_max_segment_size(int size_bytes) {
+	MutexLock mlock(_mutex);
+	_max_segment_size = math::clamp(size_bytes, MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE);
+}
+
+int VoxelStreamLog::get_max_segment_size() const {
+	MutexLock mlock(_mutex);
+	return _max_segment_size;
+}
+
+void VoxelStreamLog::set_compaction_threshold(float ratio) {
+	MutexLock mlock(_mutex);
+	_compaction_threshold = math::clamp(ratio, 0.f, 1.f);
+}
+
+float VoxelStreamLog::get_compaction_threshold() const {
+	MutexLock mlock(_mutex);
+	return _compaction_threshold;
+}
+
+int64_t VoxelStreamLog::compact_segments() {
+	ZN_PROFILE_SCOPE();
+	MutexLock mlock(_mutex);
+	if (!ensure_open()) {
+		return 0;
+	}
+
+	StdVector<uint32_t> segment_ids;
+	for (auto it = _segments.begin(); it != _segments.end(); ++it) {
+		const Segment &segment = it->second;
+		if (it->first != _current_segment_id && segment.live_size < segment.size) {
+			segment_ids.push_back(it->first);
+		}
+	}
+	// Oldest first, so blocks that didn't change for a long time end up next to each other
+	std::sort(segment_ids.begin(), segment_ids.end());
+
+	int64_t freed_bytes = 0;
+	for (const uint32_t segment_id : segment_ids) {
+		freed_bytes += compact_segment(segment_id);
+	}
+	return freed_bytes;
+}
+
+int VoxelStreamLog::get_segment_count() const {
+	MutexLock mlock(_mutex);
+	return _segments.size();
+}
+
+void VoxelStreamLog::close() {
+	if (!_opened) {
+		return;
+	}
+
+	auto current_it = _segments.find(_current_segment_id);
+	if (current_it != _segments.end() && current_it->second.size == 0) {
+		// Nothing was written since opening
+		current_it->second.file.unref();
+		_segments.erase(current_it);
+		Ref<DirAccess> da = zylann::godot::open_directory(_directory_path);
+		if (da.is_valid()) {
+			da->remove(get_segment_path(_current_segment_id));
+		}
+	}
+
+	save_checkpoint();
+
+	_segments.clear();
+	for (Lod &lod : _lods) {
+		for (StdUnorderedMap<Vector3i, Location> &map : lod.blocks) {
+			map.clear();
+		}
+		for (StdUnorderedMap<Vector3i, Location> &map : lod.tombstones) {
+			map.clear();
+		}
+	}
+	_open_read_files = 0;
+	_bytes_since_checkpoint = 0;
+	_opened = false;
+}
+
+bool VoxelStreamLog::ensure_open() {
+	using namespace zylann::godot;
+
+	if (_opened) {
+		return true;
+	}
+	if (_directory_path.is_empty()) {
+		return false;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	ZN_ASSERT_RETURN_V_MSG(
+			check_directory_created(_directory_path) == OK,
+			false,
+			format("Could not create directory {}", _directory_path)
+	);
+
+	StdVector<uint32_t> segment_ids;
+	{
+		Ref<DirAccess> da = open_directory(_directory_path);
+		ZN_ASSERT_RETURN_V(da.is_valid(), false);
+		const String ext = String(".") + SEGMENT_FILE_EXTENSION;
+		da->list_dir_begin();
+		while (true) {
+			const String fname = da->get_next();
+			if (fname == "") {
+				break;
+			}
+			if (da->current_is_dir() || !fname.ends_with(ext)) {
+				continue;
+			}
+			const String id_str = fname.get_basename();
+			if (!id_str.is_valid_int()) {
+				ZN_PRINT_ERROR(format("Found invalid segment file: '{}'", fname));
+				continue;
+			}
+			segment_ids.push_back(id_str.to_int());
+		}
+		da->list_dir_end();
+	}
+	std::sort(segment_ids.begin(), segment_ids.end());
+
+	uint32_t replay_segment_id = 0;
+	uint64_t replay_offset = 0;
+	if (!load_checkpoint(replay_segment_id, replay_offset)) {
+		// Read everything again
+		for (Lod &lod : _lods) {
+			for (StdUnorderedMap<Vector3i, Location> &map : lod.blocks) {
+				map.clear();
+			}
+			for (StdUnorderedMap<Vector3i, Location> &map : lod.tombstones) {
+				map.clear();
+			}
+		}
+		replay_segment_id = 0;
+		replay_offset = 0;
+	}
+
+	for (const uint32_t segment_id : segment_ids) {
+		Segment &segment = _segments[segment_id];
+		if (segment_id >= replay_segment_id) {
+			replay_segment(segment_id, segment_id == replay_segment_id ? replay_offset : 0);
+		} else {
+			Error err;
+			Ref<FileAccess> f = open_file(get_segment_path(segment_id), FileAccess::READ, err);
+			if (f.is_valid()) {
+				segment.size = f->get_length();
+			} else {
+				ZN_PRINT_ERROR(format("Could not open segment {}, error {}", segment_id, err));
+				_segments.erase(segment_id);
+			}
+		}
+	}
+
+	// Live sizes are derived from the index
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		Lod &lod = _lods[lod_index];
+		for (unsigned int type = 0; type < RECORD_TYPE_COUNT; ++type) {
+			for (unsigned int deleted = 0; deleted < 2; ++deleted) {
+				StdUnorderedMap<Vector3i, Location> &map = deleted ? lod.tombstones[type] : lod.blocks[type];
+				for (auto it = map.begin(); it != map.end();) {
+					auto segment_it = _segments.find(it->second.segment_id);
+					if (segment_it == _segments.end()) {
+						ZN_PRINT_ERROR(format(
+								"Block {} lod {} is in missing segment {}", it->first, lod_index, it->second.segment_id
+						));
+						it = map.erase(it);
+						continue;
+					}
+					segment_it->second.live_size += RECORD_HEADER_SIZE + it->second.size;
+					++it;
+				}
+			}
+		}
+	}
+
+	// Always continue writing in a new segment, the last one may end with a partially written record.
+	// The checkpoint may also refer to a segment that was removed because nothing was written to it.
+	_current_segment_id = segment_ids.size() > 0 ? segment_ids.back() + 1 : 0;
+	_current_segment_id = math::max(_current_segment_id, replay_segment_id);
+	_opened = true;
+	if (!start_new_segment()) {
+		close();
+		return false;
+	}
+
+	// Segments without live records are leftovers from an interrupted compaction or only contain outdated blocks.
+	// Deletions are no longer needed in the oldest segment if nothing else is live in it, which can cascade to the
+	// next segments.
+	Ref<DirAccess> da = open_directory(_directory_path);
+	bool is_oldest = true;
+	for (const uint32_t segment_id : segment_ids) {
+		auto it = _segments.find(segment_id);
+		if (it == _segments.end() || segment_id == _current_segment_id) {
+			continue;
+		}
+		if (is_oldest && it->second.live_size == get_tombstones_size(segment_id)) {
+			erase_tombstones(segment_id);
+		}
+		if (it->second.live_size == 0) {
+			if (da.is_valid()) {
+				da->remove(get_segment_path(segment_id));
+			}
+			_segments.erase(it);
+		} else {
+			is_oldest = false;
+		}
+	}
+
+	// Records that were read again are now covered by a checkpoint
+	save_checkpoint();
+
+	return true;
+}
+
+bool VoxelStreamLog::load_checkpoint(uint32_t &out_replay_segment_id, uint64_t &out_replay_offset) {
+	ZN_PROFILE_SCOPE();
+
+	Error err;
+	const String path = _directory_path.path_join(CHECKPOINT_FILE_NAME);
+	Ref<FileAccess> f = zylann::godot::open_file(path, FileAccess::READ, err);
+	if (f.is_null()) {
+		return false;
+	}
+
+	StdVector<uint8_t> data;
+	data.resize(f->get_length());
+	if (zylann::godot::get_buffer(**f, to_span(data)) != data.size()) {
+		ZN_PRINT_ERROR("Unexpected end of checkpoint file");
+		return false;
+	}
+	f.unref();
+
+	const size_t header_size = 4 + 1 + 4 + 8 + 4;
+	if (data.size() < header_size + 8) {
+		ZN_PRINT_ERROR("Checkpoint file is too small");
+		return false;
+	}
+
+	MemoryReader r(to_span_const(data), ENDIANNESS_LITTLE_ENDIAN);
+	const Span<const uint8_t> checked_data = r.data.sub(0, data.size() - 8);
+	MemoryReader checksum_reader(r.data.sub(checked_data.size(), 8), ENDIANNESS_LITTLE_ENDIAN);
+	if (checksum_reader.get_64() != hash_fnv1a_64(checked_data.data(), checked_data.size())) {
+		ZN_PRINT_ERROR("Checkpoint file is corrupted, all segments will be read again");
+		return false;
+	}
+
+	if (r.get_32() != CHECKPOINT_MAGIC) {
+		ZN_PRINT_ERROR("Checkpoint file has invalid magic");
+		return false;
+	}
+	const uint8_t version = r.get_8();
+	if (version != CHECKPOINT_VERSION) {
+		ZN_PRINT_ERROR(format("Unsupported checkpoint version {}", version));
+		return false;
+	}
+	out_replay_segment_id = r.get_32();
+	out_replay_offset = r.get_64();
+	const uint32_t entry_count = r.get_32();
+	if (header_size + uint64_t(entry_count) * CHECKPOINT_ENTRY_SIZE != checked_data.size()) {
+		ZN_PRINT_ERROR("Checkpoint file has an invalid size");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < entry_count; ++i) {
+		const uint8_t type_and_flags = r.get_8();
+		const uint8_t lod_index = r.get_8();
+		const Vector3i position = get_vector3i(r);
+		Location location;
+		location.segment_id = r.get_32();
+		location.offset = r.get_32();
+		location.size = r.get_32();
+		const uint8_t type = type_and_flags & ~CHECKPOINT_ENTRY_FLAG_DELETED;
+		ZN_ASSERT_CONTINUE(type < RECORD_TYPE_COUNT);
+		ZN_ASSERT_CONTINUE(lod_index < _lods.size());
+		Lod &lod = _lods[lod_index];
+		if ((type_and_flags & CHECKPOINT_ENTRY_FLAG_DELETED) != 0) {
+			lod.tombstones[type][position] = location;
+		} else {
+			lod.blocks[type][position] = location;
+		}
+	}
+
+	return true;
+}
+
+void VoxelStreamLog::replay_segment(uint32_t segment_id, uint64_t offset) {
+	ZN_PROFILE_SCOPE();
+
+	Segment &segment = _segments[segment_id];
+	const String path = get_segment_path(segment_id);
+
+	Error err;
+	Ref<FileAccess> f = zylann::godot::open_file(path, FileAccess::READ, err);
+	if (f.is_null()) {
+		ZN_PRINT_ERROR(format("Could not open segment {}, error {}", path, err));
+		// Not tracked, so the file doesn't get removed
+		_segments.erase(segment_id);
+		return;
+	}
+	const uint64_t file_length = f->get_length();
+	segment.size = file_length;
+	f->seek(offset);
+
+	FixedArray<uint8_t, RECORD_HEADER_SIZE> header;
+	StdVector<uint8_t> data;
+
+	while (offset + RECORD_HEADER_SIZE <= file_length) {
+		if (zylann::godot::get_buffer(**f, to_span(header)) != RECORD_HEADER_SIZE) {
+			break;
+		}
+		MemoryReader r(to_span_const(header), ENDIANNESS_LITTLE_ENDIAN);
+		if (r.get_32() != RECORD_MAGIC) {
+			break;
+		}
+		const uint8_t type = r.get_8();
+		const uint8_t lod_index = r.get_8();
+		const uint8_t flags = r.get_8();
+		r.get_8();
+		const Vector3i position = get_vector3i(r);
+		const uint32_t size = r.get_32();
+		const uint64_t checksum = r.get_64();
+
+		if (offset + RECORD_HEADER_SIZE + size > file_length) {
+			break;
+		}
+		data.resize(size);
+		if (zylann::godot::get_buffer(**f, to_span(data)) != size) {
+			break;
+		}
+		if (checksum != get_record_checksum(to_span_const(header).sub(0, RECORD_HEADER_CHECKED_SIZE), to_span(data))) {
+			break;
+		}
+
+		if (type < RECORD_TYPE_COUNT && lod_index < _lods.size()) {
+			Lod &lod = _lods[lod_index];
+			const Location location{ segment_id, static_cast<uint32_t>(offset), size };
+			if ((flags & RECORD_FLAG_DELETED) != 0) {
+				lod.blocks[type].erase(position);
+				lod.tombstones[type][position] = location;
+			} else {
+				lod.tombstones[type].erase(position);
+				lod.blocks[type][position] = location;
+			}
+		}
+
+		offset += RECORD_HEADER_SIZE + size;
+	}
+
+	if (offset < file_length) {
+		// Following records were not completely written, likely because the program stopped while saving
+		ZN_PRINT_WARNING(format("Ignoring {} bytes of invalid records at the end of {}", file_length - offset, path));
+	}
+}
+
+void VoxelStreamLog::save_checkpoint() {
+	ZN_PROFILE_SCOPE();
+	using namespace zylann::godot;
+
+	auto current_it = _segments.find(_current_segment_id);
+	if (current_it != _segments.end() && current_it->second.file.is_valid()) {
+		// Records the checkpoint covers must be written before it
+		current_it->second.file->flush();
+	}
+	const uint64_t current_size = current_it != _segments.end() ? current_it->second.size : 0;
+
+	uint32_t entry_count = 0;
+	for (const Lod &lod : _lods) {
+		for (const StdUnorderedMap<Vector3i, Location> &map : lod.blocks) {
+			entry_count += map.size();
+		}
+		for (const StdUnorderedMap<Vector3i, Location> &map : lod.tombstones) {
+			entry_count += map.size();
+		}
+	}
+
+	StdVector<uint8_t> data;
+	data.reserve(4 + 1 + 4 + 8 + 4 + entry_count * CHECKPOINT_ENTRY_SIZE + 8);
+	MemoryWriter w(data, ENDIANNESS_LITTLE_ENDIAN);
+	w.store_32(CHECKPOINT_MAGIC);
+	w.store_8(CHECKPOINT_VERSION);
+	w.store_32(_current_segment_id);
+	w.store_64(current_size);
+	w.store_32(entry_count);
+
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		const Lod &lod = _lods[lod_index];
+		for (unsigned int type = 0; type < lod.blocks.size(); ++type) {
+			for (unsigned int deleted = 0; deleted < 2; ++deleted) {
+				const StdUnorderedMap<Vector3i, Location> &map = deleted ? lod.tombstones[type] : lod.blocks[type];
+				for (auto it = map.begin(); it != map.end(); ++it) {
+					w.store_8(type | (deleted ? CHECKPOINT_ENTRY_FLAG_DELETED : 0));
+					w.store_8(lod_index);
+					store_vector3i(w, it->first);
+					w.store_32(it->second.segment_id);
+					w.store_32(it->second.offset);
+					w.store_32(it->second.size);
+				}
+			}
+		}
+	}
+
+	w.store_64(hash_fnv1a_64(data.data(), data.size()));
+
+	// Written next to the previous checkpoint first, so one of them is always complete
+	const String temp_path = _directory_path.path_join(CHECKPOINT_TEMP_FILE_NAME);
+	{
+		Error err;
+		Ref<FileAccess> f = open_file(temp_path, FileAccess::WRITE, err);
+		ZN_ASSERT_RETURN_MSG(f.is_valid(), format("Could not write checkpoint {}, error {}", temp_path, err));
+		store_buffer(**f, to_span(data));
+		f->flush();
+	}
+
+	Ref<DirAccess> da = open_directory(_directory_path);
+	ZN_ASSERT_RETURN(da.is_valid());
+	const Error rename_error = da->rename(temp_path, _directory_path.path_join(CHECKPOINT_FILE_NAME));
+	ZN_ASSERT_RETURN_MSG(rename_error == OK, format("Could not replace checkpoint, error {}", rename_error));
+
+	_bytes_since_checkpoint = 0;
+}
+
+bool VoxelStreamLog::start_new_segment() {
+	auto prev_it = _segments.find(_current_segment_id);
+	if (prev_it != _segments.end()) {
+		if (prev_it->second.size == 0) {
+			// Still empty, keep using it
+			return true;
+		}
+		// Sealed, it will be opened again for reading when needed
+		prev_it->second.file.unref();
+		++_current_segment_id;
+	}
+
+	const String path = get_segment_path(_current_segment_id);
+	Error err;
+	Ref<FileAccess> f = zylann::godot::open_file(path, FileAccess::WRITE_READ, err);
+	ZN_ASSERT_RETURN_V_MSG(f.is_valid(), false, format("Could not create segment {}, error {}", path, err));
+
+	Segment &segment = _segments[_current_segment_id];
+	segment.file = f;
+	segment.size = 0;
+	segment.live_size = 0;
+	return true;
+}
+
+String VoxelStreamLog::get_segment_path(uint32_t segment_id) const {
+	return _directory_path.path_join(String::num_uint64(segment_id) + "." + SEGMENT_FILE_EXTENSION);
+}
+
+VoxelStreamLog::Segment *VoxelStreamLog::get_segment_for_reading(uint32_t segment_id) {
+	auto it = _segments.find(segment_id);
+	ZN_ASSERT_RETURN_V(it != _segments.end(), nullptr);
+	Segment &segment = it->second;
+	if (segment.file.is_valid()) {
+		return &segment;
+	}
+
+	if (_open_read_files >= MAX_OPEN_READ_FILES) {
+		for (auto other_it = _segments.begin(); other_it != _segments.end(); ++other_it) {
+			if (other_it->first != _current_segment_id) {
+				other_it->second.file.unref();
+			}
+		}
+		_open_read_files = 0;
+	}
+
+	const String path = get_segment_path(segment_id);
+	Error err;
+	segment.file = zylann::godot::open_file(path, FileAccess::READ, err);
+	ZN_ASSERT_RETURN_V_MSG(
+			segment.file.is_valid(), nullptr, format("Could not open segment {}, error {}", path, err)
+	);
+	++_open_read_files;
+	return &segment;
+}
+
+bool VoxelStreamLog::read_record_data(const Location &location, StdVector<uint8_t> &dst) {
+	Segment *segment = get_segment_for_reading(location.segment_id);
+	if (segment == nullptr) {
+		return false;
+	}
+	FileAccess &f = **segment->file;
+	f.seek(uint64_t(location.offset) + RECORD_HEADER_SIZE);
+	dst.resize(location.size);
+	if (zylann::godot::get_buffer(f, to_span(dst)) != location.size) {
+		ZN_PRINT_ERROR(format("Unexpected end of segment {}", location.segment_id));
+		return false;
+	}
+	return true;
+}
+
+void VoxelStreamLog::append_records(Span<const PendingRecord> records, Span<const uint8_t> data) {
+	ZN_PROFILE_SCOPE();
+
+	FixedArray<uint8_t, RECORD_HEADER_SIZE> header;
+
+	for (const PendingRecord &record : records) {
+		if (record.deleted) {
+			const Lod &lod = _lods[record.lod_index];
+			const StdUnorderedMap<Vector3i, Location> &map = lod.blocks[record.type];
+			const StdUnorderedMap<Vector3i, Location> &tombstones = lod.tombstones[record.type];
+			if (map.find(record.position) == map.end() && tombstones.find(record.position) == tombstones.end()) {
+				// Nothing to delete
+				continue;
+			}
+		}
+
+		Segment *segment = &_segments[_current_segment_id];
+		if (segment->size + RECORD_HEADER_SIZE + record.data_size > _max_segment_size && segment->size > 0) {
+			segment->file->flush();
+			ZN_ASSERT_RETURN(start_new_segment());
+			segment = &_segments[_current_segment_id];
+		}
+		ZN_ASSERT_RETURN(segment->file.is_valid());
+
+		const Span<const uint8_t> record_data = data.sub(record.data_begin, record.data_size);
+
+		ByteSpanWithPosition header_buffer(to_span(header), 0);
+		MemoryWriterExistingBuffer w(header_buffer, ENDIANNESS_LITTLE_ENDIAN);
+		w.store_32(RECORD_MAGIC);
+		w.store_8(record.type);
+		w.store_8(record.lod_index);
+		w.store_8(record.deleted ? RECORD_FLAG_DELETED : 0);
+		w.store_8(0);
+		w.store_32(record.position.x);
+		w.store_32(record.position.y);
+		w.store_32(record.position.z);
+		w.store_32(record.data_size);
+		w.store_64(get_record_checksum(to_span_const(header).sub(0, RECORD_HEADER_CHECKED_SIZE), record_data));
+
+		// Reads may have moved the position
+		FileAccess &f = **segment->file;
+		f.seek_end();
+		zylann::godot::store_buffer(f, to_span_const(header));
+		zylann::godot::store_buffer(f, record_data);
+
+		const Location location{
+			_current_segment_id, static_cast<uint32_t>(segment->size), static_cast<uint32_t>(record.data_size)
+		};
+		segment->size += RECORD_HEADER_SIZE + record.data_size;
+		_bytes_since_checkpoint += RECORD_HEADER_SIZE + record.data_size;
+
+		set_location(record.type, record.lod_index, record.position, location, record.deleted);
+	}
+
+	Segment &segment = _segments[_current_segment_id];
+	if (segment.file.is_valid()) {
+		segment.file->flush();
+	}
+
+	if (_bytes_since_checkpoint >= CHECKPOINT_INTERVAL_BYTES) {
+		save_checkpoint();
+	}
+}
+
+void VoxelStreamLog::set_location(
+		RecordType type,
+		uint8_t lod_index,
+		Vector3i position,
+		const Location &location,
+		bool deleted
+) {
+	Lod &lod = _lods[lod_index];
+	// Previous versions of the block, or its previous deletion, are no longer live
+	erase_location(lod.blocks[type], position);
+	erase_location(lod.tombstones[type], position);
+
+	StdUnorderedMap<Vector3i, Location> &map = deleted ? lod.tombstones[type] : lod.blocks[type];
+	map.insert({ position, location });
+	_segments[location.segment_id].live_size += RECORD_HEADER_SIZE + location.size;
+}
+
+void VoxelStreamLog::erase_location(StdUnorderedMap<Vector3i, Location> &map, Vector3i position) {
+	auto it = map.find(position);
+	if (it == map.end()) {
+		return;
+	}
+	auto segment_it = _segments.find(it->second.segment_id);
+	if (segment_it != _segments.end()) {
+		segment_it->second.live_size -= RECORD_HEADER_SIZE + it->second.size;
+	}
+	map.erase(it);
+}
+
+uint64_t VoxelStreamLog::get_tombstones_size(uint32_t segment_id) const {
+	uint64_t size = 0;
+	for (const Lod &lod : _lods) {
+		for (const StdUnorderedMap<Vector3i, Location> &map : lod.tombstones) {
+			for (auto it = map.begin(); it != map.end(); ++it) {
+				if (it->second.segment_id == segment_id) {
+					size += RECORD_HEADER_SIZE + it->second.size;
+				}
+			}
+		}
+	}
+	return size;
+}
+
+void VoxelStreamLog::erase_tombstones(uint32_t segment_id) {
+	for (Lod &lod : _lods) {
+		for (StdUnorderedMap<Vector3i, Location> &map : lod.tombstones) {
+			for (auto it = map.begin(); it != map.end();) {
+				if (it->second.segment_id == segment_id) {
+					_segments[segment_id].live_size -= RECORD_HEADER_SIZE + it->second.size;
+					it = map.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+	}
+}
+
+bool VoxelStreamLog::has_segment_older_than(uint32_t segment_id) const {
+	for (auto it = _segments.begin(); it != _segments.end(); ++it) {
+		if (it->first < segment_id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t VoxelStreamLog::compact_segment(uint32_t segment_id) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(segment_id != _current_segment_id, 0);
+
+	auto segment_it = _segments.find(segment_id);
+	ZN_ASSERT_RETURN_V(segment_it != _segments.end(), 0);
+	const uint64_t old_size = segment_it->second.size;
+	const uint64_t live_size = segment_it->second.live_size;
+
+	struct LiveBlock {
+		RecordType type;
+		uint8_t lod_index;
+		bool deleted;
+		Vector3i position;
+		Location location;
+	};
+	StdVector<LiveBlock> live_blocks;
+	// Deletions only have to be carried over if older segments may still contain the deleted blocks
+	const bool keep_tombstones = has_segment_older_than(segment_id);
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		Lod &lod = _lods[lod_index];
+		for (unsigned int type = 0; type < lod.blocks.size(); ++type) {
+			const StdUnorderedMap<Vector3i, Location> &map = lod.blocks[type];
+			for (auto it = map.begin(); it != map.end(); ++it) {
+				if (it->second.segment_id == segment_id) {
+					live_blocks.push_back(LiveBlock{
+							static_cast<RecordType>(type), static_cast<uint8_t>(lod_index), false, it->first, it->second
+					});
+				}
+			}
+			StdUnorderedMap<Vector3i, Location> &tombstones = lod.tombstones[type];
+			for (auto it = tombstones.begin(); it != tombstones.end();) {
+				if (it->second.segment_id != segment_id) {
+					++it;
+				} else if (keep_tombstones) {
+					live_blocks.push_back(LiveBlock{
+							static_cast<RecordType>(type), static_cast<uint8_t>(lod_index), true, it->first, it->second
+					});
+					++it;
+				} else {
+					// The segment is going away, no need to update its live size
+					it = tombstones.erase(it);
+				}
+			}
+		}
+	}
+
+	// Read in file order
+	std::sort(live_blocks.begin(), live_blocks.end(), [](const LiveBlock &a, const LiveBlock &b) {
+		return a.location.offset < b.location.offset;
+	});
+
+	StdVector<uint8_t> data;
+	for (const LiveBlock &block : live_blocks) {
+		if (!read_record_data(block.location, data)) {
+			ZN_PRINT_ERROR(format("Could not compact segment {}", segment_id));
+			return 0;
+		}
+		const PendingRecord record{ block.type, block.lod_index, block.deleted, block.position, 0, data.size() };
+		append_records(Span<const PendingRecord>(&record, 1), to_span(data));
+	}
+
+	// The segment must no longer be needed after loading the checkpoint before it can be removed
+	save_checkpoint();
+
+	segment_it = _segments.find(segment_id);
+	if (segment_it->second.file.is_valid()) {
+		segment_it->second.file.unref();
+		--_open_read_files;
+	}
+	_segments.erase(segment_it);
+
+	Ref<DirAccess> da = zylann::godot::open_directory(_directory_path);
+	if (da.is_valid()) {
+		da->remove(get_segment_path(segment_id));
+	}
+
+	ZN_PRINT_VERBOSE(format("Compacted segment {}, {} of {} bytes were live", segment_id, live_size, old_size));
+	return old_size - live_size;
+}
+
+void VoxelStreamLog::compact_if_needed() {
+	uint32_t segment_id = 0;
+	float min_live_ratio = _compaction_threshold;
+	bool found = false;
+
+	for (auto it = _segments.begin(); it != _segments.end(); ++it) {
+		const Segment &segment = it->second;
+		if (it->first == _current_segment_id || segment.size == 0) {
+			continue;
+		}
+		const float live_ratio = static_cast<float>(segment.live_size) / static_cast<float>(segment.size);
+		if (live_ratio < min_live_ratio) {
+			min_live_ratio = live_ratio;
+			segment_id = it->first;
+			found = true;
+		}
+	}
+
+	// One segment at a time, so saving doesn't take too long
+	if (found) {
+		compact_segment(segment_id);
+	}
+}
+
+void VoxelStreamLog::_bind_methods() {
+	using Self = VoxelStreamLog;
+
+	ClassDB::bind_method(D_METHOD("set_directory", "directory"), &Self::set_directory);
+	ClassDB::bind_method(D_METHOD("get_directory"), &Self::get_directory);
+
+	ClassDB::bind_method(D_METHOD("set_max_segment_size", "size_bytes"), &Self::set_max_segment_size);
+	ClassDB::bind_method(D_METHOD("get_max_segment_size"), &Self::get_max_segment_size);
+
+	ClassDB::bind_method(D_METHOD("set_compaction_threshold", "ratio"), &Self::set_compaction_threshold);
+	ClassDB::bind_method(D_METHOD("get_compaction_threshold"), &Self::get_compaction_threshold);
+
+	ClassDB::bind_method(D_METHOD("compact_segments"), &Self::compact_segments);
+	ClassDB::bind_method(D_METHOD("get_segment_count"), &Self::get_segment_count);
+
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "directory", PROPERTY_HINT_DIR), "set_directory", "get_directory");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "max_segment_size", PROPERTY_HINT_RANGE, "65536,1073741824,1,or_greater"),
+			"set_max_segment_size",
+			"get_max_segment_size"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "compaction_threshold", PROPERTY_HINT_RANGE, "0.0,1.0,0.01"),
+			"set_compaction_threshold",
+			"get_compaction_threshold"
+	);
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,169 @@
+#ifndef VOXEL_STREAM_LOG_H
+#define VOXEL_STREAM_LOG_H
+
+#include "../../constants/voxel_constants.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/file_access.h"
+#include "../../util/thread/mutex.h"
+#include "../voxel_stream.h"
+
+namespace zylann::voxel {
+
+// Saves blocks into append-only files called segments, under a directory. Saving a block appends a new version of it
+// at the end of the current segment, so writes are sequential and never modify data that was already written. This
+// suits worlds that are edited constantly, like on a game server.
+//
+// Where the latest version of each block is found is indexed in memory. The index is saved from time to time as a
+// checkpoint, and when the stream is opened, records appended after the last checkpoint are read again. Records have a
+// checksum, so one that was only partially written when the program stopped is detected and ignored. Writing always
+// continues in a new segment after opening.
+//
+// Older versions of blocks are left in segments. When the live data of a full segment falls below a threshold, its live
+// blocks are appended again to the current segment and the file is deleted. This is done on the thread saving blocks,
+// one segment at a time. Records of deleted blocks are carried over the same way until no older segment remains.
+//
+// All files are accessed while holding a lock, but blocks are serialized and deserialized outside of it.
+//
+class VoxelStreamLog : public VoxelStream {
+	GDCLASS(VoxelStreamLog, VoxelStream)
+public:
+	static const int DEFAULT_MAX_SEGMENT_SIZE = 64 * 1024 * 1024;
+	static const int MIN_SEGMENT_SIZE = 64 * 1024;
+	// Segments store offsets in 32 bits
+	static const int MAX_SEGMENT_SIZE = 1024 * 1024 * 1024;
+
+	VoxelStreamLog();
+	~VoxelStreamLog();
+
+	void set_directory(String dirpath);
+	String get_directory() const;
+
+	void load_voxel_block(VoxelStream::VoxelQueryData &q) override;
+	void save_voxel_block(VoxelStream::VoxelQueryData &q) override;
+
+	void load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) override;
+	void save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) override;
+
+	bool supports_compressed_voxel_blocks() const override;
+	void load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> out_blocks) override;
+	void save_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> p_blocks) override;
+
+	bool get_voxel_block_keys(StdVector<BlockKey> &out_keys) override;
+
+	bool supports_instance_blocks() const override;
+
+	void load_instance_blocks(Span<VoxelStream::InstancesQueryData> out_blocks) override;
+	void save_instance_blocks(Span<VoxelStream::InstancesQueryData> p_blocks) override;
+
+	bool supports_loading_all_blocks() const override {
+		return true;
+	}
+
+	void load_all_blocks(FullLoadingResult &result) override;
+
+	bool decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const override;
+
+	int get_used_channels_mask() const override;
+
+	int get_lod_count() const override;
+
+	// Writes a checkpoint of the index, so opening the stream next time doesn't have to read records again.
+	void flush() override;
+
+	int64_t get_memory_usage_bytes() const override;
+
+	// Once the current segment reaches this size, writing continues in a new one.
+	void set_max_segment_size(int size_bytes);
+	int get_max_segment_size() const;
+
+	// Full segments are compacted when the fraction of their size taken by live blocks is below this ratio.
+	void set_compaction_threshold(float ratio);
+	float get_compaction_threshold() const;
+
+	// Compacts every full segment containing outdated blocks, regardless of the threshold. Returns how many bytes were
+	// freed. This can take a while, so it should preferably run in a background thread.
+	int64_t compact_segments();
+
+	int get_segment_count() const;
+
+private:
+	enum RecordType : uint8_t {
+		RECORD_VOXELS = 0,
+		RECORD_INSTANCES,
+		RECORD_TYPE_COUNT
+	};
+
+	// Where the latest version of a block is stored
+	struct Location {
+		uint32_t segment_id;
+		// Offset of the record in the segment file
+		uint32_t offset;
+		// Size of the data, not including the record header
+		uint32_t size;
+	};
+
+	struct Segment {
+		// Opened when reading from the segment, or always for the current segment
+		Ref<FileAccess> file;
+		uint64_t size = 0;
+		// How many bytes of records are still referenced by the index
+		uint64_t live_size = 0;
+	};
+
+	// Record to append, with data serialized outside of the lock
+	struct PendingRecord {
+		RecordType type;
+		uint8_t lod_index;
+		bool deleted;
+		Vector3i position;
+		// Range in the buffer of serialized data
+		size_t data_begin;
+		size_t data_size;
+	};
+
+	struct Lod {
+		FixedArray<StdUnorderedMap<Vector3i, Location>, RECORD_TYPE_COUNT> blocks;
+		// Where deletions of blocks are recorded. They remain live as long as older segments exist, because those may
+		// still contain records of the deleted blocks, which would come back if segments get read again.
+		FixedArray<StdUnorderedMap<Vector3i, Location>, RECORD_TYPE_COUNT> tombstones;
+	};
+
+	void close();
+	// Loads the checkpoint and records appended after it, if not done already. Must be called while holding the lock.
+	bool ensure_open();
+	bool load_checkpoint(uint32_t &out_replay_segment_id, uint64_t &out_replay_offset);
+	void replay_segment(uint32_t segment_id, uint64_t offset);
+	void save_checkpoint();
+	bool start_new_segment();
+	String get_segment_path(uint32_t segment_id) const;
+	Segment *get_segment_for_reading(uint32_t segment_id);
+	bool read_record_data(const Location &location, StdVector<uint8_t> &dst);
+	void append_records(Span<const PendingRecord> records, Span<const uint8_t> data);
+	void set_location(RecordType type, uint8_t lod_index, Vector3i position, const Location &location, bool deleted);
+	void erase_location(StdUnorderedMap<Vector3i, Location> &map, Vector3i position);
+	bool has_segment_older_than(uint32_t segment_id) const;
+	uint64_t get_tombstones_size(uint32_t segment_id) const;
+	void erase_tombstones(uint32_t segment_id);
+	uint64_t compact_segment(uint32_t segment_id);
+	void compact_if_needed();
+
+	static void _bind_methods();
+
+	String _directory_path;
+	FixedArray<Lod, constants::MAX_LOD> _lods;
+	StdUnorderedMap<uint32_t, Segment> _segments;
+	uint32_t _current_segment_id = 0;
+	unsigned int _open_read_files = 0;
+	// Bytes appended since the last checkpoint was saved
+	uint64_t _bytes_since_checkpoint = 0;
+	unsigned int _max_segment_size = DEFAULT_MAX_SEGMENT_SIZE;
+	float _compaction_threshold = 0.5f;
+	bool _opened = false;
+	mutable Mutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_STREAM_LOG_H
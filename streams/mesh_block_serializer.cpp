@@ -0,0 +1,229 @@
+#include "mesh_block_serializer.h"
+#include "../generators/voxel_generator.h"
+#include "../util/godot/classes/object.h"
+#include "../util/godot/core/variant.h"
+#include "../util/hash_funcs.h"
+#include "../util/io/serialization.h"
+#include "../util/profiling.h"
+#include "../util/string/format.h"
+#include "compressed_data.h"
+
+namespace zylann::voxel {
+
+namespace {
+const uint32_t TRAILING_MAGIC = 0x900df00d;
+enum FormatVersion {
+	MESH_BLOCK_FORMAT_VERSION_0 = 0,
+};
+
+void store_variant(MemoryWriter &w, const Variant &v) {
+	const size_t size = zylann::godot::get_variant_encoded_size(v);
+	w.store_32(size);
+	const size_t pos = w.data.size();
+	w.data.resize(pos + size);
+	zylann::godot::encode_variant(v, to_span(w.data).sub(pos, size));
+}
+
+bool load_variant(MemoryReader &r, Variant &v) {
+	ZN_ASSERT_RETURN_V(r.pos + sizeof(uint32_t) <= r.data.size(), false);
+	const uint32_t size = r.get_32();
+	ZN_ASSERT_RETURN_V(r.pos + size <= r.data.size(), false);
+	size_t read_size;
+	ZN_ASSERT_RETURN_V(zylann::godot::decode_variant(r.data.sub(r.pos, size), v, read_size), false);
+	r.pos += size;
+	return true;
+}
+
+void store_surfaces(MemoryWriter &w, const StdVector<VoxelMesher::Output::Surface> &surfaces) {
+	w.store_16(surfaces.size());
+	for (const VoxelMesher::Output::Surface &surface : surfaces) {
+		w.store_16(surface.material_index);
+		store_variant(w, surface.arrays);
+		store_variant(w, surface.lods);
+	}
+}
+
+bool load_surfaces(MemoryReader &r, StdVector<VoxelMesher::Output::Surface> &surfaces) {
+	ZN_ASSERT_RETURN_V(r.pos + sizeof(uint16_t) <= r.data.size(), false);
+	surfaces.resize(r.get_16());
+	for (VoxelMesher::Output::Surface &surface : surfaces) {
+		ZN_ASSERT_RETURN_V(r.pos + sizeof(uint16_t) <= r.data.size(), false);
+		surface.material_index = r.get_16();
+		Variant arrays;
+		ZN_ASSERT_RETURN_V(load_variant(r, arrays), false);
+		ZN_ASSERT_RETURN_V(arrays.get_type() == Variant::ARRAY, false);
+		surface.arrays = arrays;
+		Variant lods;
+		ZN_ASSERT_RETURN_V(load_variant(r, lods), false);
+		ZN_ASSERT_RETURN_V(lods.get_type() == Variant::DICTIONARY, false);
+		surface.lods = lods;
+	}
+	return true;
+}
+
+inline void store_vector3f(MemoryWriter &w, Vector3f v) {
+	w.store_float(v.x);
+	w.store_float(v.y);
+	w.store_float(v.z);
+}
+
+inline Vector3f get_vector3f(MemoryReader &r) {
+	Vector3f v;
+	v.x = r.get_float();
+	v.y = r.get_float();
+	v.z = r.get_float();
+	return v;
+}
+
+} // namespace
+
+uint64_t get_mesh_block_settings_hash(
+		const VoxelMesher &mesher,
+		const VoxelGenerator *generator,
+		unsigned int mesh_block_size
+) {
+	uint64_t hash = hash_djb2_one_64(MESH_BLOCK_FORMAT_VERSION_0);
+	hash = hash_djb2_one_64(mesh_block_size, hash);
+	hash = hash_djb2_one_64(String(mesher.get_class()).hash(), hash);
+	hash = zylann::godot::get_deep_hash(mesher, PROPERTY_USAGE_STORAGE | PROPERTY_USAGE_EDITOR, hash);
+	if (generator != nullptr) {
+		hash = hash_djb2_one_64(String(generator->get_class()).hash(), hash);
+		hash = zylann::godot::get_deep_hash(*generator, PROPERTY_USAGE_STORAGE | PROPERTY_USAGE_EDITOR, hash);
+	}
+	return hash;
+}
+
+bool can_serialize_mesh_block(const VoxelMesher::Output &output) {
+	// Atlases are images, they would take a lot of space and are not a common case
+	return output.atlas_image.is_null();
+}
+
+bool serialize_mesh_block(
+		const VoxelMesher::Output &src,
+		uint64_t settings_hash,
+		bool has_collision,
+		StdVector<uint8_t> &dst
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(can_serialize_mesh_block(src), false);
+
+	StdVector<uint8_t> data;
+	MemoryWriter w(data, ENDIANNESS_LITTLE_ENDIAN);
+
+	w.store_8(MESH_BLOCK_FORMAT_VERSION_0);
+	w.store_64(settings_hash);
+	w.store_8(has_collision ? 1 : 0);
+	w.store_8(src.primitive_type);
+	w.store_32(src.mesh_flags);
+
+	store_surfaces(w, src.surfaces);
+	for (const StdVector<VoxelMesher::Output::Surface> &surfaces : src.transition_surfaces) {
+		store_surfaces(w, surfaces);
+	}
+
+	const VoxelMesher::Output::CollisionSurface &cs = src.collision_surface;
+	w.store_32(cs.positions.size());
+	for (const Vector3f &p : cs.positions) {
+		store_vector3f(w, p);
+	}
+	w.store_32(cs.indices.size());
+	for (const int i : cs.indices) {
+		w.store_32(i);
+	}
+	w.store_32(cs.submesh_vertex_end);
+	w.store_32(cs.submesh_index_end);
+
+	store_variant(w, src.shadow_occluder);
+
+	w.store_32(src.occluder_boxes.size());
+	for (const Box3f &box : src.occluder_boxes) {
+		store_vector3f(w, box.min);
+		store_vector3f(w, box.max);
+	}
+
+	w.store_32(TRAILING_MAGIC);
+
+	return CompressedData::compress(to_span_const(data), dst, CompressedData::COMPRESSION_LZ4);
+}
+
+bool deserialize_mesh_block(
+		Span<const uint8_t> src,
+		uint64_t settings_hash,
+		bool require_collision,
+		VoxelMesher::Output &dst
+) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<uint8_t> data;
+	ZN_ASSERT_RETURN_V(CompressedData::decompress(src, data), false);
+
+	// Header
+	if (data.size() < 2 * sizeof(uint8_t) + sizeof(uint64_t)) {
+		return false;
+	}
+	MemoryReader r(to_span_const(data), ENDIANNESS_LITTLE_ENDIAN);
+	const uint8_t version = r.get_8();
+	if (version != MESH_BLOCK_FORMAT_VERSION_0) {
+		return false;
+	}
+	if (r.get_64() != settings_hash) {
+		// Baked with different settings, the mesh has to be rebuilt
+		return false;
+	}
+	const bool has_collision = r.get_8() != 0;
+	if (require_collision && !has_collision) {
+		return false;
+	}
+
+	ZN_ASSERT_RETURN_V(r.pos + sizeof(uint8_t) + sizeof(uint32_t) <= data.size(), false);
+	const uint8_t primitive_type = r.get_8();
+	ZN_ASSERT_RETURN_V(primitive_type < Mesh::PRIMITIVE_MAX, false);
+	dst.primitive_type = static_cast<Mesh::PrimitiveType>(primitive_type);
+	dst.mesh_flags = r.get_32();
+
+	ZN_ASSERT_RETURN_V(load_surfaces(r, dst.surfaces), false);
+	for (StdVector<VoxelMesher::Output::Surface> &surfaces : dst.transition_surfaces) {
+		ZN_ASSERT_RETURN_V(load_surfaces(r, surfaces), false);
+	}
+
+	VoxelMesher::Output::CollisionSurface &cs = dst.collision_surface;
+	ZN_ASSERT_RETURN_V(r.pos + sizeof(uint32_t) <= data.size(), false);
+	const uint32_t position_count = r.get_32();
+	ZN_ASSERT_RETURN_V(r.pos + position_count * 3 * sizeof(float) + sizeof(uint32_t) <= data.size(), false);
+	cs.positions.resize(position_count);
+	for (Vector3f &p : cs.positions) {
+		p = get_vector3f(r);
+	}
+	const uint32_t index_count = r.get_32();
+	ZN_ASSERT_RETURN_V(r.pos + index_count * sizeof(uint32_t) + 2 * sizeof(uint32_t) <= data.size(), false);
+	cs.indices.resize(index_count);
+	for (int &i : cs.indices) {
+		i = static_cast<int32_t>(r.get_32());
+	}
+	cs.submesh_vertex_end = static_cast<int32_t>(r.get_32());
+	cs.submesh_index_end = static_cast<int32_t>(r.get_32());
+
+	Variant shadow_occluder;
+	ZN_ASSERT_RETURN_V(load_variant(r, shadow_occluder), false);
+	if (shadow_occluder.get_type() == Variant::ARRAY) {
+		dst.shadow_occluder = shadow_occluder;
+	}
+
+	ZN_ASSERT_RETURN_V(r.pos + sizeof(uint32_t) <= data.size(), false);
+	const uint32_t box_count = r.get_32();
+	ZN_ASSERT_RETURN_V(r.pos + box_count * 6 * sizeof(float) + sizeof(uint32_t) <= data.size(), false);
+	dst.occluder_boxes.resize(box_count);
+	for (Box3f &box : dst.occluder_boxes) {
+		box.min = get_vector3f(r);
+		box.max = get_vector3f(r);
+	}
+
+	const uint32_t control_end = r.get_32();
+	ZN_ASSERT_RETURN_V_MSG(
+			control_end == TRAILING_MAGIC, false, format("Expected {}, found {}", TRAILING_MAGIC, control_end)
+	);
+
+	return true;
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,45 @@
+#ifndef VOXEL_MESH_BLOCK_SERIALIZER_H
+#define VOXEL_MESH_BLOCK_SERIALIZER_H
+
+#include "../meshers/voxel_mesher.h"
+#include "../util/containers/span.h"
+#include "../util/containers/std_vector.h"
+#include <cstdint>
+
+namespace zylann::voxel {
+
+class VoxelGenerator;
+
+// Gets a hash of the settings that affect meshes built by a terrain, so meshes stored in a stream can be discarded
+// when any of them changes. Properties of the mesher and generator are hashed recursively, so this must be called
+// on the main thread.
+uint64_t get_mesh_block_settings_hash(
+		const VoxelMesher &mesher,
+		const VoxelGenerator *generator,
+		unsigned int mesh_block_size
+);
+
+// Returns false if the output has data that can't be stored, like an atlas image.
+bool can_serialize_mesh_block(const VoxelMesher::Output &output);
+
+// Serializes and compresses the output of a mesher, so it can be saved with `VoxelStream::save_mesh_blocks`.
+// `has_collision` tells if the mesher was asked to produce a collision surface.
+bool serialize_mesh_block(
+		const VoxelMesher::Output &src,
+		uint64_t settings_hash,
+		bool has_collision,
+		StdVector<uint8_t> &dst
+);
+
+// Returns false if the data is invalid, was built with settings that don't match the given hash, or doesn't have a
+// collision surface while one is required. In that case the mesh has to be built again.
+bool deserialize_mesh_block(
+		Span<const uint8_t> src,
+		uint64_t settings_hash,
+		bool require_collision,
+		VoxelMesher::Output &dst
+);
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_MESH_BLOCK_SERIALIZER_H
@@ -1,8 +1,11 @@
 #include "region_file.h"
 #include "../../streams/voxel_block_serializer.h"
+#include "../../util/godot/classes/directory.h"
+#include "../../util/godot/classes/project_settings.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/io/log.h"
+#include "../../util/memory/memory.h"
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
 #include "file_utils.h"
@@ -21,6 +24,44 @@ const char *FORMAT_REGION_MAGIC = "VXR_";
 const uint32_t MAGIC_AND_VERSION_SIZE = 4 + 1;
 const uint32_t FIXED_HEADER_DATA_SIZE = 7 + RegionFormat::CHANNEL_COUNT;
 const uint32_t PALETTE_SIZE_IN_BYTES = 256 * 4;
+// Interleaves bits of coordinates, so sorting by this code keeps neighbor blocks close to each other.
+// Region sizes fit in 8 bits.
+uint32_t get_morton_code_u8(Vector3i position) {
+	const uint32_t x = position.x;
+	const uint32_t y = position.y;
+	const uint32_t z = position.z;
+	uint32_t code = 0;
+	for (unsigned int i = 0; i < 8; ++i) {
+		code |= ((x >> i) & 1) << (3 * i);
+		code |= ((y >> i) & 1) << (3 * i + 1);
+		code |= ((z >> i) & 1) << (3 * i + 2);
+	}
+	return code;
+}
+
+// Serializes a block as it is stored in sectors. The returned data remains valid until the next call in the same
+// thread.
+bool serialize_block(const VoxelBuffer &block, Span<const uint8_t> &out_data) {
+	// Only grows, so blocks can be serialized without allocating memory nor copying the result
+	thread_local StdVector<uint8_t> tls_block_data;
+
+	const CompressedData::Compression compression = CompressedData::COMPRESSION_LZ4;
+	const size_t size_bound = BlockSerializer::get_serialized_and_compressed_size_bound(block, compression);
+	if (tls_block_data.size() < size_bound) {
+		tls_block_data.resize(size_bound);
+	}
+
+	size_t size = 0;
+	ZN_ASSERT_RETURN_V(
+			BlockSerializer::serialize_and_compress(
+					block, to_span(tls_block_data), size, compression, CompressedData::ZstdOptions()
+			),
+			false
+	);
+	out_data = Span<const uint8_t>(tls_block_data.data(), size);
+	return true;
+}
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -284,6 +325,9 @@ Error RegionFile::close() {
 		}
 		_file_access.unref();
 	}
+	// Once closed, the file can be reopened and modified by another region file object, which would not know about
+	// readers of this mapping. So they have to be done first.
+	release_mapping();
 	_sectors.clear();
 	return err;
 }
@@ -345,6 +389,20 @@ Error RegionFile::load_block(Vector3i position, VoxelBuffer &out_block) {
 		out_block.set_channel_depth(channel_index, _header.format.channel_depths[channel_index]);
 	}
 
+	if (_memory_mapping_enabled) {
+		MappedBlockData mapped_data;
+		const Error mapped_err = get_mapped_block_data(position, mapped_data);
+		if (mapped_err == OK) {
+			ERR_FAIL_COND_V_MSG(!BlockSerializer::decompress_and_deserialize(mapped_data.get_data(), out_block),
+					ERR_PARSE_ERROR, String("Failed to read block {0}").format(varray(position)));
+			return OK;
+		}
+		if (mapped_err != ERR_UNAVAILABLE) {
+			return mapped_err;
+		}
+		// Fallback on FileAccess
+	}
+
 	const unsigned int sector_index = block_info.get_sector_index();
 	const unsigned int block_begin = _blocks_begin_offset + sector_index * _header.format.sector_size;
 
@@ -359,13 +417,130 @@ Error RegionFile::load_block(Vector3i position, VoxelBuffer &out_block) {
 	return OK;
 }
 
+void RegionFile::set_memory_mapping_enabled(bool enabled) {
+	_memory_mapping_enabled = enabled && MemoryMappedFile::is_supported();
+	if (!_memory_mapping_enabled) {
+		release_mapping();
+	}
+}
+
+bool RegionFile::is_memory_mapping_enabled() const {
+	return _memory_mapping_enabled;
+}
+
+bool RegionFile::update_mapping() {
+	if (_mapping != nullptr) {
+		return true;
+	}
+	ERR_FAIL_COND_V(_file_access.is_null(), false);
+	ZN_PROFILE_SCOPE();
+
+	// Buffered writes must reach the file before it can be mapped
+	_file_access->flush();
+
+	const String global_path = ProjectSettings::get_singleton()->globalize_path(_file_path);
+	const CharString global_path_utf8 = global_path.utf8();
+
+	std::shared_ptr<Mapping> mapping = make_shared_instance<Mapping>();
+	if (!mapping->file.open(global_path_utf8.get_data())) {
+		// Can happen if the file is not on the filesystem, like in a PCK. Don't try again.
+		ZN_PRINT_VERBOSE(format("Could not memory-map region file {}, falling back on regular reads", _file_path));
+		_memory_mapping_enabled = false;
+		return false;
+	}
+
+	_mapping = mapping;
+	return true;
+}
+
+void RegionFile::release_mapping() {
+	if (_mapping == nullptr) {
+		return;
+	}
+	// Wait for threads still reading from the mapping. No new readers can appear, because they would need to access
+	// this region file, which the caller has exclusive access to. The caller must not hold mapped data itself.
+	_mapping->lock.write_lock();
+	_mapping->lock.write_unlock();
+	_mapping.reset();
+}
+
+Error RegionFile::get_mapped_block_data(Vector3i position, MappedBlockData &out_data) {
+	out_data.release();
+
+	if (!_memory_mapping_enabled || !update_mapping()) {
+		return ERR_UNAVAILABLE;
+	}
+
+	ERR_FAIL_COND_V(!is_valid_block_position(position), ERR_INVALID_PARAMETER);
+	const unsigned int lut_index = get_block_index_in_header(position);
+	ERR_FAIL_COND_V(lut_index >= _header.blocks.size(), ERR_INVALID_PARAMETER);
+	const RegionBlockInfo &block_info = _header.blocks[lut_index];
+
+	if (block_info.data == 0) {
+		return ERR_DOES_NOT_EXIST;
+	}
+
+	const Span<const uint8_t> file_data = _mapping->file.get_data();
+
+	const size_t block_begin =
+			_blocks_begin_offset + size_t(block_info.get_sector_index()) * _header.format.sector_size;
+	ERR_FAIL_COND_V(block_begin + sizeof(uint32_t) > file_data.size(), ERR_FILE_CORRUPT);
+
+	// Stored in little-endian, like FileAccess does by default
+	const uint32_t block_data_size = uint32_t(file_data[block_begin]) | (uint32_t(file_data[block_begin + 1]) << 8) |
+			(uint32_t(file_data[block_begin + 2]) << 16) | (uint32_t(file_data[block_begin + 3]) << 24);
+
+	const size_t data_begin = block_begin + sizeof(uint32_t);
+	ERR_FAIL_COND_V_MSG(block_data_size > file_data.size() - data_begin, ERR_FILE_CORRUPT,
+			String("Block {0} is larger than the remaining file size").format(varray(position)));
+
+	_mapping->lock.read_lock();
+	out_data._mapping = _mapping;
+	out_data._data = file_data.sub(data_begin, block_data_size);
+
+	return OK;
+}
+
+Error RegionFile::load_block_data(Vector3i position, StdVector<uint8_t> &out_data) {
+	ERR_FAIL_COND_V(_file_access.is_null(), ERR_FILE_CANT_READ);
+	FileAccess &f = **_file_access;
+
+	ERR_FAIL_COND_V(!is_valid_block_position(position), ERR_INVALID_PARAMETER);
+	const unsigned int lut_index = get_block_index_in_header(position);
+	ERR_FAIL_COND_V(lut_index >= _header.blocks.size(), ERR_INVALID_PARAMETER);
+	const RegionBlockInfo &block_info = _header.blocks[lut_index];
+
+	if (block_info.data == 0) {
+		return ERR_DOES_NOT_EXIST;
+	}
+
+	f.seek(_blocks_begin_offset + uint64_t(block_info.get_sector_index()) * _header.format.sector_size);
+	const uint32_t block_data_size = f.get_32();
+	ERR_FAIL_COND_V_MSG(sizeof(uint32_t) + block_data_size > block_info.get_sector_count() * _header.format.sector_size,
+			ERR_FILE_CORRUPT, String("Block {0} is larger than its sectors").format(varray(position)));
+
+	out_data.resize(block_data_size);
+	ERR_FAIL_COND_V(zylann::godot::get_buffer(f, to_span(out_data)) != block_data_size, ERR_FILE_EOF);
+	return OK;
+}
+
 Error RegionFile::save_block(Vector3i position, VoxelBuffer &block) {
 	ERR_FAIL_COND_V(_header.format.verify_block(block) == false, ERR_INVALID_PARAMETER);
+
+	Span<const uint8_t> data;
+	ERR_FAIL_COND_V(!serialize_block(block, data), ERR_INVALID_PARAMETER);
+	return save_block_data(position, data);
+}
+
+Error RegionFile::save_block_data(Vector3i position, Span<const uint8_t> data) {
 	ERR_FAIL_COND_V(!is_valid_block_position(position), ERR_INVALID_PARAMETER);
 
 	ERR_FAIL_COND_V(_file_access == nullptr, ERR_FILE_CANT_WRITE);
 	FileAccess &f = **_file_access;
 
+	// Sectors can get moved around, the mapping has to be created again after this
+	release_mapping();
+
 	// We should be allowed to migrate before write operations
 	if (_header.version != FORMAT_VERSION) {
 		ERR_FAIL_COND_V(migrate_to_latest(f) == false, ERR_UNAVAILABLE);
@@ -384,11 +559,9 @@ Error RegionFile::save_block(Vector3i position, VoxelBuffer &block) {
 		// Check position matches the sectors rule
 		CRASH_COND((block_offset - _blocks_begin_offset) % _header.format.sector_size != 0);
 
-		BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block);
-		ERR_FAIL_COND_V(!res.success, ERR_INVALID_PARAMETER);
-		f.store_32(res.data.size());
-		const unsigned int written_size = sizeof(uint32_t) + res.data.size();
-		zylann::godot::store_buffer(f, to_span(res.data));
+		f.store_32(data.size());
+		const unsigned int written_size = sizeof(uint32_t) + data.size();
+		zylann::godot::store_buffer(f, data);
 
 		const unsigned int end_pos = f.get_position();
 		CRASH_COND_MSG(written_size != (end_pos - block_offset),
@@ -414,9 +587,6 @@ Error RegionFile::save_block(Vector3i position, VoxelBuffer &block) {
 		const int old_sector_count = block_info.get_sector_count();
 		CRASH_COND(old_sector_count < 1);
 
-		BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block);
-		ERR_FAIL_COND_V(!res.success, ERR_INVALID_PARAMETER);
-		const StdVector<uint8_t> &data = res.data;
 		const size_t written_size = sizeof(uint32_t) + data.size();
 
 		const int new_sector_count = get_sector_count_from_bytes(written_size);
@@ -435,7 +605,7 @@ Error RegionFile::save_block(Vector3i position, VoxelBuffer &block) {
 			f.seek(block_offset);
 
 			f.store_32(data.size());
-			zylann::godot::store_buffer(f, to_span(data));
+			zylann::godot::store_buffer(f, data);
 
 			const size_t end_pos = f.get_position();
 			CRASH_COND(written_size != (end_pos - block_offset));
@@ -453,7 +623,7 @@ Error RegionFile::save_block(Vector3i position, VoxelBuffer &block) {
 			f.seek(block_offset);
 
 			f.store_32(data.size());
-			zylann::godot::store_buffer(f, to_span(data));
+			zylann::godot::store_buffer(f, data);
 
 			const size_t end_pos = f.get_position();
 			CRASH_COND(written_size != (end_pos - block_offset));
@@ -610,6 +780,8 @@ bool RegionFile::migrate_to_latest(FileAccess &f) {
 	// }
 
 	if (version == FORMAT_VERSION_LEGACY_2) {
+		// Sectors will move
+		release_mapping();
 		ERR_FAIL_COND_V(!migrate_from_v2_to_v3(f, _header.format), false);
 		version = FORMAT_VERSION;
 	}
@@ -659,6 +831,175 @@ bool RegionFile::has_block(unsigned int index) const {
 	return _header.blocks[index].data != 0;
 }
 
+void RegionFile::get_blocks_in_box_sorted_by_offset(Box3i box, StdVector<Vector3i> &out_positions) const {
+	ERR_FAIL_COND(!is_open());
+	box.clip(Box3i(Vector3i(), _header.format.region_size));
+
+	struct BlockRef {
+		uint32_t sector_index;
+		Vector3i position;
+	};
+	StdVector<BlockRef> block_refs;
+
+	box.for_each_cell_zxy([this, &block_refs](const Vector3i pos) {
+		const RegionBlockInfo &block_info = _header.blocks[get_block_index_in_header(pos)];
+		if (block_info.data != 0) {
+			block_refs.push_back(BlockRef{ block_info.get_sector_index(), pos });
+		}
+	});
+
+	std::sort(block_refs.begin(), block_refs.end(), [](const BlockRef &a, const BlockRef &b) {
+		return a.sector_index < b.sector_index;
+	});
+
+	out_positions.reserve(out_positions.size() + block_refs.size());
+	for (const BlockRef &ref : block_refs) {
+		out_positions.push_back(ref.position);
+	}
+}
+
+Error RegionFile::compact(int64_t *out_freed_bytes) {
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_COND_V(_file_access.is_null(), ERR_FILE_CANT_READ);
+	FileAccess &f = **_file_access;
+
+	if (out_freed_bytes != nullptr) {
+		*out_freed_bytes = 0;
+	}
+
+	// We should be allowed to migrate before write operations
+	if (_header.version != FORMAT_VERSION) {
+		ERR_FAIL_COND_V(migrate_to_latest(f) == false, ERR_UNAVAILABLE);
+	}
+
+	struct BlockRef {
+		uint32_t morton_code;
+		uint32_t lut_index;
+	};
+
+	StdVector<BlockRef> block_refs;
+	for (uint32_t lut_index = 0; lut_index < _header.blocks.size(); ++lut_index) {
+		if (_header.blocks[lut_index].data != 0) {
+			block_refs.push_back(BlockRef{ get_morton_code_u8(get_block_position_from_index(lut_index)), lut_index });
+		}
+	}
+
+	std::sort(block_refs.begin(), block_refs.end(), [](const BlockRef &a, const BlockRef &b) {
+		return a.morton_code < b.morton_code;
+	});
+
+	const uint32_t sector_size = _header.format.sector_size;
+	const uint64_t old_length = f.get_length();
+
+	// Don't rewrite files that are already compact
+	{
+		bool ordered = true;
+		uint32_t expected_sector_index = 0;
+		for (const BlockRef &ref : block_refs) {
+			const RegionBlockInfo &block_info = _header.blocks[ref.lut_index];
+			if (block_info.get_sector_index() != expected_sector_index) {
+				ordered = false;
+				break;
+			}
+			expected_sector_index += block_info.get_sector_count();
+		}
+		if (ordered && old_length == _blocks_begin_offset + uint64_t(_sectors.size()) * sector_size) {
+			return OK;
+		}
+	}
+
+	const String temp_path = _file_path + ".compacting";
+	StdVector<RegionBlockInfo> new_block_infos = _header.blocks;
+	uint64_t new_length = 0;
+
+	{
+		Error file_error;
+		Ref<FileAccess> temp_file = zylann::godot::open_file(temp_path, FileAccess::WRITE, file_error);
+		ERR_FAIL_COND_V_MSG(
+				file_error != OK, file_error, String("Failed to create file {0}").format(varray(temp_path)));
+		FileAccess &tf = **temp_file;
+
+		// Block locations are not known yet, the header is written again at the end. Its size doesn't change.
+		ERR_FAIL_COND_V(!zylann::voxel::save_header(tf, _header.version, _header.format, new_block_infos),
+				ERR_FILE_CANT_WRITE);
+		ERR_FAIL_COND_V(tf.get_position() != _blocks_begin_offset, ERR_BUG);
+
+		StdVector<uint8_t> block_data;
+		uint32_t sector_index = 0;
+		bool success = true;
+
+		for (const BlockRef &ref : block_refs) {
+			const RegionBlockInfo &old_block_info = _header.blocks[ref.lut_index];
+
+			f.seek(_blocks_begin_offset + uint64_t(old_block_info.get_sector_index()) * sector_size);
+			const uint32_t block_data_size = f.get_32();
+			if (sizeof(uint32_t) + block_data_size > old_block_info.get_sector_count() * sector_size) {
+				ZN_PRINT_ERROR(format("Block {} is larger than its sectors in {}",
+						get_block_position_from_index(ref.lut_index), _file_path));
+				success = false;
+				break;
+			}
+			block_data.resize(block_data_size);
+			if (zylann::godot::get_buffer(f, to_span(block_data)) != block_data_size) {
+				ZN_PRINT_ERROR(format("Unexpected end of file {}", _file_path));
+				success = false;
+				break;
+			}
+
+			tf.store_32(block_data_size);
+			zylann::godot::store_buffer(tf, to_span(block_data));
+			pad_to_sector_size(tf);
+
+			RegionBlockInfo &new_block_info = new_block_infos[ref.lut_index];
+			new_block_info.set_sector_index(sector_index);
+			new_block_info.set_sector_count(get_sector_count_from_bytes(sizeof(uint32_t) + block_data_size));
+			sector_index += new_block_info.get_sector_count();
+		}
+
+		if (success) {
+			new_length = tf.get_position();
+			ZN_ASSERT(new_length == _blocks_begin_offset + uint64_t(sector_index) * sector_size);
+			success = zylann::voxel::save_header(tf, _header.version, _header.format, new_block_infos);
+			tf.flush();
+		}
+
+		temp_file.unref();
+
+		if (!success) {
+			Ref<DirAccess> da = zylann::godot::open_directory(temp_path.get_base_dir());
+			if (da.is_valid()) {
+				da->remove(temp_path);
+			}
+			return ERR_FILE_CORRUPT;
+		}
+	}
+
+	// Replace the original file. Readers of the mapping must be done first, some platforms can't replace mapped files.
+	release_mapping();
+	const String file_path = _file_path;
+	ERR_FAIL_COND_V(close() != OK, ERR_FILE_CANT_WRITE);
+
+	Ref<DirAccess> da = zylann::godot::open_directory(file_path.get_base_dir());
+	ERR_FAIL_COND_V(da.is_null(), ERR_FILE_CANT_OPEN);
+	const Error rename_error = da->rename(temp_path, file_path);
+	if (rename_error != OK) {
+		ZN_PRINT_ERROR(format("Could not replace {} with its compacted version, error {}", file_path, rename_error));
+		da->remove(temp_path);
+		// Keep using the original file
+		ERR_FAIL_COND_V(open(file_path, false) != OK, rename_error);
+		return rename_error;
+	}
+
+	const Error open_error = open(file_path, false);
+	ERR_FAIL_COND_V(open_error != OK, open_error);
+
+	if (out_freed_bytes != nullptr) {
+		*out_freed_bytes = int64_t(old_length) - int64_t(new_length);
+	}
+	ZN_PRINT_VERBOSE(format("Compacted {} from {} to {} bytes", file_path, old_length, new_length));
+	return OK;
+}
+
 // Checks to detect some corruption signs in the file
 void RegionFile::debug_check() {
 	ERR_FAIL_COND(!is_open());
@@ -5,8 +5,12 @@
 #include "../../util/containers/fixed_array.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/file_access.h"
+#include "../../util/io/memory_mapped_file.h"
+#include "../../util/math/box3i.h"
 #include "../../util/math/color8.h"
 #include "../../util/math/vector3i.h"
+#include "../../util/thread/rw_lock.h"
+#include <memory>
 
 namespace zylann::voxel {
 
@@ -68,10 +72,50 @@ static_assert(sizeof(RegionBlockInfo) == 4, "Data in this struct must have a con
 //
 // This is a stream implementation, where the file handle remains in use for read and write and only keeps a fraction
 // of data in memory.
-// It isn't thread-safe.
+// It isn't thread-safe, except for data obtained with `get_mapped_block_data`.
 //
 class RegionFile {
+private:
+	struct Mapping {
+		MemoryMappedFile file;
+		// Read-locked while block data is being read from the mapping, write-locked before the file gets modified
+		RWLock lock;
+	};
+
 public:
+	// Compressed data of a block read directly from a memory-mapped region file.
+	// The mapping is kept alive and won't be modified as long as this object exists, so it can be used while other
+	// threads use the region file. Writing to or closing the region file waits for it to be released, so the thread
+	// holding it must not do either.
+	class MappedBlockData {
+	public:
+		MappedBlockData() {}
+		~MappedBlockData() {
+			release();
+		}
+
+		MappedBlockData(const MappedBlockData &) = delete;
+		MappedBlockData &operator=(const MappedBlockData &) = delete;
+
+		inline Span<const uint8_t> get_data() const {
+			return _data;
+		}
+
+		void release() {
+			if (_mapping != nullptr) {
+				_mapping->lock.read_unlock();
+				_mapping.reset();
+				_data = Span<const uint8_t>();
+			}
+		}
+
+	private:
+		friend class RegionFile;
+
+		std::shared_ptr<Mapping> _mapping;
+		Span<const uint8_t> _data;
+	};
+
 	RegionFile();
 	~RegionFile();
 
@@ -86,11 +130,36 @@ public:
 	Error load_block(Vector3i position, VoxelBuffer &out_block);
 	Error save_block(Vector3i position, VoxelBuffer &block);
 
+	// Reads or writes a block as it is stored in sectors, serialized and compressed. This allows to move blocks between
+	// files without decoding them, as long as their format matches.
+	Error load_block_data(Vector3i position, StdVector<uint8_t> &out_data);
+	Error save_block_data(Vector3i position, Span<const uint8_t> data);
+
+	// When enabled, blocks are read from a read-only memory mapping of the file instead of using `FileAccess`.
+	// Falls back on `FileAccess` if the file can't be mapped (for example if it is inside a PCK).
+	void set_memory_mapping_enabled(bool enabled);
+	bool is_memory_mapping_enabled() const;
+
+	// Gets compressed data of a block without decompressing it, from a memory mapping of the file.
+	// Returns ERR_UNAVAILABLE if the file can't be mapped, in which case `load_block` should be used.
+	// The block's channel depths must be configured from the region format before deserializing the data.
+	Error get_mapped_block_data(Vector3i position, MappedBlockData &out_data);
+
 	unsigned int get_header_block_count() const;
 	bool has_block(Vector3i position) const;
 	bool has_block(unsigned int index) const;
 	Vector3i get_block_position_from_index(uint32_t i) const;
 
+	// Appends positions of blocks present within the given box, sorted by their offset in the file, so reading them in
+	// that order goes forward through the file. Positions are relative to the region.
+	void get_blocks_in_box_sorted_by_offset(Box3i box, StdVector<Vector3i> &out_positions) const;
+
+	// Rewrites the file so blocks are stored in Morton order of their positions, in adjacent sectors, then truncates
+	// it. Blocks close to each other in space end up close to each other in the file, and space left behind by blocks
+	// that shrank or moved is reclaimed. The file is written to a temporary copy first, and replaces the original once
+	// complete. If `out_freed_bytes` is not null, it receives how much smaller the file became.
+	Error compact(int64_t *out_freed_bytes = nullptr);
+
 	void debug_check();
 
 	bool is_valid_block_position(const Vector3 position) const;
@@ -105,6 +174,9 @@ private:
 	void pad_to_sector_size(FileAccess &f);
 	void remove_sectors_from_block(Vector3i block_pos, unsigned int p_sector_count);
 
+	bool update_mapping();
+	void release_mapping();
+
 	bool migrate_to_latest(FileAccess &f);
 	bool migrate_from_v2_to_v3(FileAccess &f, RegionFormat &format);
 
@@ -137,6 +209,10 @@ private:
 	StdVector<Vector3u16> _sectors;
 	uint32_t _blocks_begin_offset;
 	String _file_path;
+
+	bool _memory_mapping_enabled = false;
+	// Created on demand when loading blocks, and released before any write
+	std::shared_ptr<Mapping> _mapping;
 };
 
 } // namespace zylann::voxel
@@ -2,16 +2,18 @@
 #include "../../engine/voxel_engine.h"
 #include "../../util/godot/classes/directory.h"
 #include "../../util/godot/classes/json.h"
-#include "../../util/godot/classes/time.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/io/log.h"
 #include "../../util/math/box3i.h"
+#include "../../util/memory/memory.h"
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
+#include "../voxel_block_serializer.h"
 #include "file_utils.h"
 
 #include <algorithm>
+#include <limits>
 
 namespace zylann::voxel {
 
@@ -23,6 +25,8 @@ const uint8_t FORMAT_VERSION_LEGACY_2 = 2;
 
 const uint8_t FORMAT_VERSION_LEGACY_1 = 1;
 const char *META_FILE_NAME = "meta.vxrm";
+// Each open region holds a file handle, so this is limited by the operating system
+const int MAX_OPEN_REGIONS_LIMIT = 1024;
 
 } // namespace
 
@@ -119,107 +123,229 @@ void VoxelStreamRegionFiles::save_voxel_blocks(Span<VoxelStream::VoxelQueryData>
 	}
 }
 
+void VoxelStreamRegionFiles::load_voxel_blocks_in_box(
+		Box3i box_in_blocks, uint8_t lod_index, FullLoadingResult &result) {
+	ZN_PROFILE_SCOPE();
+
+	Vector3i block_size;
+	unsigned int region_size_po2;
+
+	{
+		MutexLock lock(_mutex);
+
+		if (_directory_path.is_empty()) {
+			return;
+		}
+
+		if (!_meta_loaded) {
+			const zylann::godot::FileResult load_res = load_meta();
+			if (load_res != zylann::godot::FILE_OK) {
+				// No block was ever saved
+				return;
+			}
+		}
+
+		ERR_FAIL_COND(lod_index >= _meta.lod_count);
+		block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
+		region_size_po2 = _meta.region_size_po2;
+	}
+
+	const Vector3i region_size = Vector3iUtil::create(1 << region_size_po2);
+	const Box3i region_box = box_in_blocks.downscaled(1 << region_size_po2);
+	StdVector<Vector3i> block_rpositions;
+
+	region_box.for_each_cell_zxy([&](const Vector3i region_pos) {
+		std::shared_ptr<CachedRegion> cache;
+		{
+			MutexLock lock(_mutex);
+			cache = open_region(region_pos, lod_index, false);
+		}
+		if (cache == nullptr || !cache->file_exists) {
+			return;
+		}
+
+		const Vector3i region_origin = region_pos << region_size_po2;
+		const Box3i box_in_region = box_in_blocks.clipped(Box3i(region_origin, region_size));
+
+		MutexLock region_lock(cache->mutex);
+		FileLocker::Read file_rlock(cache->file_lock);
+
+		block_rpositions.clear();
+		cache->region.get_blocks_in_box_sorted_by_offset(
+				Box3i(box_in_region.position - region_origin, box_in_region.size), block_rpositions
+		);
+
+		for (const Vector3i block_rpos : block_rpositions) {
+			std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+			voxels->create(block_size);
+			const Error err = cache->region.load_block(block_rpos, *voxels);
+			if (err != OK) {
+				ZN_PRINT_ERROR(format("Failed to read block {} at lod {}", region_origin + block_rpos, lod_index));
+				continue;
+			}
+			result.blocks.push_back(FullLoadingResult::Block{ voxels, region_origin + block_rpos, lod_index });
+		}
+	});
+}
+
 int VoxelStreamRegionFiles::get_used_channels_mask() const {
 	// Assuming all, since that stream can store anything.
 	return VoxelBuffer::ALL_CHANNELS_MASK;
 }
 
+VoxelStreamRegionFiles::EmergeResult VoxelStreamRegionFiles::get_emerge_result(Error region_error) {
+	switch (region_error) {
+		case OK:
+			return EMERGE_OK;
+
+		case ERR_DOES_NOT_EXIST:
+			return EMERGE_OK_FALLBACK;
+
+		default:
+			return EMERGE_FAILED;
+	}
+}
+
 VoxelStreamRegionFiles::EmergeResult VoxelStreamRegionFiles::_load_block(
 		VoxelBuffer &out_buffer, Vector3i block_pos, int lod) {
 	ZN_PROFILE_SCOPE();
 
-	MutexLock lock(_mutex);
+	std::shared_ptr<CachedRegion> cache;
+	Vector3i block_rpos;
+	bool memory_mapping_enabled;
+	RegionFile::MappedBlockData mapped_data;
 
-	if (_directory_path.is_empty()) {
-		return EMERGE_OK_FALLBACK;
-	}
+	{
+		MutexLock lock(_mutex);
 
-	if (!_meta_loaded) {
-		const zylann::godot::FileResult load_res = load_meta();
-		if (load_res != zylann::godot::FILE_OK) {
-			// No block was ever saved
+		if (_directory_path.is_empty()) {
 			return EMERGE_OK_FALLBACK;
 		}
-	}
 
-	const Vector3i block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
-	const Vector3i region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+		if (!_meta_loaded) {
+			const zylann::godot::FileResult load_res = load_meta();
+			if (load_res != zylann::godot::FILE_OK) {
+				// No block was ever saved
+				return EMERGE_OK_FALLBACK;
+			}
+		}
 
-	CRASH_COND(!_meta_loaded);
-	ERR_FAIL_COND_V(lod >= _meta.lod_count, EMERGE_FAILED);
-	ERR_FAIL_COND_V(block_size != out_buffer.get_size(), EMERGE_FAILED);
+		const Vector3i block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
+		const Vector3i region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
 
-	// Configure depths, as they might not be specified in old block data.
-	// Regions are expected to contain such depths, and use those in the buffer to know how much data to read.
-	for (unsigned int channel_index = 0; channel_index < _meta.channel_depths.size(); ++channel_index) {
-		out_buffer.set_channel_depth(channel_index, _meta.channel_depths[channel_index]);
-	}
+		CRASH_COND(!_meta_loaded);
+		ERR_FAIL_COND_V(lod >= _meta.lod_count, EMERGE_FAILED);
+		ERR_FAIL_COND_V(block_size != out_buffer.get_size(), EMERGE_FAILED);
+
+		// Configure depths, as they might not be specified in old block data.
+		// Regions are expected to contain such depths, and use those in the buffer to know how much data to read.
+		for (unsigned int channel_index = 0; channel_index < _meta.channel_depths.size(); ++channel_index) {
+			out_buffer.set_channel_depth(channel_index, _meta.channel_depths[channel_index]);
+		}
 
-	const Vector3i region_pos = get_region_position_from_blocks(block_pos);
+		const Vector3i region_pos = get_region_position_from_blocks(block_pos);
+
+		cache = open_region(region_pos, lod, false);
+		if (cache == nullptr || !cache->file_exists) {
+			return EMERGE_OK_FALLBACK;
+		}
 
-	CachedRegion *cache = open_region(region_pos, lod, false);
-	if (cache == nullptr || !cache->file_exists) {
-		return EMERGE_OK_FALLBACK;
+		block_rpos = math::wrap(block_pos, region_size);
+		memory_mapping_enabled = _memory_mapping_enabled;
 	}
 
-	const Vector3i block_rpos = math::wrap(block_pos, region_size);
+	// Only lock the region, so other threads can access other regions in the meantime
+	{
+		MutexLock region_lock(cache->mutex);
+		FileLocker::Read file_rlock(cache->file_lock);
+
+		if (memory_mapping_enabled) {
+			const Error mapped_err = cache->region.get_mapped_block_data(block_rpos, mapped_data);
+			switch (mapped_err) {
+				case OK:
+					// Decompress after unlocking, so other threads can access the region in the meantime
+					break;
 
-	const Error err = cache->region.load_block(block_rpos, out_buffer);
-	switch (err) {
-		case OK:
-			return EMERGE_OK;
+				case ERR_DOES_NOT_EXIST:
+					return EMERGE_OK_FALLBACK;
 
-		case ERR_DOES_NOT_EXIST:
-			return EMERGE_OK_FALLBACK;
+				case ERR_UNAVAILABLE:
+					// The file can't be mapped, fallback on regular reads
+					return get_emerge_result(cache->region.load_block(block_rpos, out_buffer));
 
-		default:
-			return EMERGE_FAILED;
+				default:
+					return EMERGE_FAILED;
+			}
+
+		} else {
+			return get_emerge_result(cache->region.load_block(block_rpos, out_buffer));
+		}
+	}
+
+	// Don't prevent the region from being closed while decompressing
+	cache.reset();
+
+	// The mapping remains valid and unmodified until `mapped_data` is released. Closing or writing to the region waits
+	// for it.
+	if (!BlockSerializer::decompress_and_deserialize(mapped_data.get_data(), out_buffer)) {
+		ZN_PRINT_ERROR(format("Failed to read block {} at lod {}", block_pos, lod));
+		return EMERGE_FAILED;
 	}
+	return EMERGE_OK;
 }
 
 void VoxelStreamRegionFiles::_save_block(VoxelBuffer &voxel_buffer, Vector3i block_pos, int lod) {
 	ZN_PROFILE_SCOPE();
 	using namespace zylann::godot;
 
-	MutexLock lock(_mutex);
+	std::shared_ptr<CachedRegion> cache;
+	Vector3i block_rpos;
 
-	ERR_FAIL_COND(_directory_path.is_empty());
-
-	if (!_meta_loaded) {
-		// If it's not loaded, always try to load meta file first if it exists already,
-		// because we could want to save blocks without reading any
-		FileResult load_res = load_meta();
-		if (load_res != FILE_OK && load_res != FILE_CANT_OPEN) {
-			// The file is present but there is a problem with it
-			String meta_path = _directory_path.path_join(META_FILE_NAME);
-			ERR_PRINT(String("Could not read {0}: error {1}")
-							  .format(varray(meta_path, zylann::godot::to_string(load_res))));
-			return;
+	{
+		MutexLock lock(_mutex);
+
+		ERR_FAIL_COND(_directory_path.is_empty());
+
+		if (!_meta_loaded) {
+			// If it's not loaded, always try to load meta file first if it exists already,
+			// because we could want to save blocks without reading any
+			FileResult load_res = load_meta();
+			if (load_res != FILE_OK && load_res != FILE_CANT_OPEN) {
+				// The file is present but there is a problem with it
+				String meta_path = _directory_path.path_join(META_FILE_NAME);
+				ERR_PRINT(String("Could not read {0}: error {1}")
+								  .format(varray(meta_path, zylann::godot::to_string(load_res))));
+				return;
+			}
 		}
-	}
 
-	if (!_meta_saved) {
-		// First time we save the meta file, initialize it from the first block format
-		for (unsigned int i = 0; i < _meta.channel_depths.size(); ++i) {
-			_meta.channel_depths[i] = voxel_buffer.get_channel_depth(i);
+		if (!_meta_saved) {
+			// First time we save the meta file, initialize it from the first block format
+			for (unsigned int i = 0; i < _meta.channel_depths.size(); ++i) {
+				_meta.channel_depths[i] = voxel_buffer.get_channel_depth(i);
+			}
+			FileResult err = save_meta();
+			ERR_FAIL_COND(err != FILE_OK);
 		}
-		FileResult err = save_meta();
-		ERR_FAIL_COND(err != FILE_OK);
-	}
 
-	// Verify format
-	const Vector3i block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
-	ERR_FAIL_COND(voxel_buffer.get_size() != block_size);
-	for (unsigned int i = 0; i < VoxelBuffer::MAX_CHANNELS; ++i) {
-		ERR_FAIL_COND(voxel_buffer.get_channel_depth(i) != _meta.channel_depths[i]);
-	}
+		// Verify format
+		const Vector3i block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
+		ERR_FAIL_COND(voxel_buffer.get_size() != block_size);
+		for (unsigned int i = 0; i < VoxelBuffer::MAX_CHANNELS; ++i) {
+			ERR_FAIL_COND(voxel_buffer.get_channel_depth(i) != _meta.channel_depths[i]);
+		}
 
-	const Vector3i region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
-	Vector3i region_pos = get_region_position_from_blocks(block_pos);
-	Vector3i block_rpos = math::wrap(block_pos, region_size);
+		const Vector3i region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+		const Vector3i region_pos = get_region_position_from_blocks(block_pos);
+		block_rpos = math::wrap(block_pos, region_size);
+
+		cache = open_region(region_pos, lod, true);
+		ERR_FAIL_COND_MSG(cache == nullptr, "Could not save region file data");
+	}
 
-	CachedRegion *cache = open_region(region_pos, lod, true);
-	ERR_FAIL_COND_MSG(cache == nullptr, "Could not save region file data");
+	// Only lock the region, so other threads can access other regions in the meantime
+	MutexLock region_lock(cache->mutex);
+	FileLocker::Write file_wlock(cache->file_lock);
 	ERR_FAIL_COND(cache->region.save_block(block_rpos, voxel_buffer) != OK);
 }
 
@@ -422,9 +548,11 @@ Vector3i VoxelStreamRegionFiles::get_region_position_from_blocks(const Vector3i
 
 void VoxelStreamRegionFiles::close_all_regions() {
 	for (unsigned int i = 0; i < _region_cache.size(); ++i) {
-		CachedRegion *cache = _region_cache[i];
-		close_region(cache);
-		ZN_DELETE(cache);
+		std::shared_ptr<CachedRegion> &cache = _region_cache[i];
+		// Regions still in use by other threads will be closed when they are done with them
+		if (cache.use_count() == 1) {
+			close_region(*cache);
+		}
 	}
 	_region_cache.clear();
 }
@@ -440,11 +568,12 @@ String VoxelStreamRegionFiles::get_region_file_path(const Vector3i &region_pos,
 	return _directory_path.path_join(String("regions/lod{0}/r.{1}.{2}.{3}.{4}").format(a));
 }
 
-VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::get_region_from_cache(const Vector3i pos, int lod) const {
+std::shared_ptr<VoxelStreamRegionFiles::CachedRegion> VoxelStreamRegionFiles::get_region_from_cache(
+		const Vector3i pos, int lod) const {
 	// A linear search might be better than a Map data structure,
 	// because it's unlikely to have more than about 10 regions cached at a time
 	for (unsigned int i = 0; i < _region_cache.size(); ++i) {
-		CachedRegion *r = _region_cache[i];
+		const std::shared_ptr<CachedRegion> &r = _region_cache[i];
 		if (r->position == pos && r->lod == lod) {
 			return r;
 		}
@@ -452,25 +581,29 @@ VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::get_region_from_ca
 	return nullptr;
 }
 
-VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::open_region(
+std::shared_ptr<VoxelStreamRegionFiles::CachedRegion> VoxelStreamRegionFiles::open_region(
 		const Vector3i region_pos, unsigned int lod, bool create_if_not_found) {
 	ZN_PROFILE_SCOPE();
 	ERR_FAIL_COND_V(!_meta_loaded, nullptr);
 	ZN_ASSERT_RETURN_V(lod < constants::MAX_LOD, nullptr);
 
-	CachedRegion *cached_region = get_region_from_cache(region_pos, lod);
+	std::shared_ptr<CachedRegion> cached_region = get_region_from_cache(region_pos, lod);
 	if (cached_region != nullptr) {
+		cached_region->last_accessed = ++_region_access_counter;
 		return cached_region;
 	}
 
-	while (_region_cache.size() > _max_open_regions - 1) {
-		close_oldest_region();
+	while (_region_cache.size() >= _max_open_regions) {
+		if (!close_oldest_region()) {
+			// All regions are in use by other threads. Exceed the limit until they are done.
+			break;
+		}
 	}
 	// Not in cache, we'll have to open or create it
 
 	String fpath = get_region_file_path(region_pos, lod);
 
-	cached_region = ZN_NEW(CachedRegion);
+	cached_region = make_shared_instance<CachedRegion>();
 
 	// Configure format because we might have to create the file, and some old file versions don't embed format
 	{
@@ -483,11 +616,20 @@ VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::open_region(
 		format.sector_size = _meta.sector_size;
 
 		cached_region->region.set_format(format);
+		cached_region->region.set_memory_mapping_enabled(_memory_mapping_enabled);
 		cached_region->position = region_pos;
 		cached_region->lod = lod;
 	}
 
-	const Error err = cached_region->region.open(fpath, create_if_not_found);
+	cached_region->file_lock =
+			VoxelEngine::get_singleton().get_file_locker().get_handle(zylann::godot::to_std_string(fpath));
+
+	Error err;
+	{
+		// Opening can create the file
+		FileLocker::Write file_wlock(cached_region->file_lock);
+		err = cached_region->region.open(fpath, create_if_not_found);
+	}
 
 	// Things we could do for optimization:
 	// - Cache the fact the file doesn't exist, so we won't need to do a system call to actually check it every time.
@@ -495,7 +637,6 @@ VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::open_region(
 	//   we assume no other process will modify region files.
 
 	if (err != OK) {
-		ZN_DELETE(cached_region);
 		if (create_if_not_found) {
 			// Could not create it apparently
 			ERR_PRINT(String("Could not open or create region file {0}, error: {1}").format(varray(fpath, err)));
@@ -514,7 +655,6 @@ VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::open_region(
 				|| format.region_size != Vector3iUtil::create(1 << _meta.region_size_po2) //
 				|| format.sector_size != _meta.sector_size) {
 			ERR_PRINT("Region file has unexpected format");
-			ZN_DELETE(cached_region);
 			return nullptr;
 		}
 	}
@@ -523,55 +663,177 @@ VoxelStreamRegionFiles::CachedRegion *VoxelStreamRegionFiles::open_region(
 	_region_cache.push_back(cached_region);
 
 	cached_region->file_exists = true;
-	cached_region->last_opened = Time::get_singleton()->get_ticks_usec();
+	cached_region->last_accessed = ++_region_access_counter;
 
 	return cached_region;
 }
 
 // TODO Get rid of to simplify?
-void VoxelStreamRegionFiles::close_region(CachedRegion *region) {
-	region->region.close();
+void VoxelStreamRegionFiles::close_region(CachedRegion &region) {
+	FileLocker::Write file_wlock(region.file_lock);
+	region.region.close();
 }
 
-void VoxelStreamRegionFiles::close_oldest_region() {
-	// Close region assumed to be the least recently used
-
-	if (_region_cache.size() == 0) {
-		return;
-	}
+bool VoxelStreamRegionFiles::close_oldest_region() {
+	// Close the least recently used region, among those which are not in use by other threads
 
 	int oldest_index = -1;
-	uint64_t oldest_time = 0;
-	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	uint64_t oldest_access = std::numeric_limits<uint64_t>::max();
 
 	for (unsigned int i = 0; i < _region_cache.size(); ++i) {
-		const CachedRegion *r = _region_cache[i];
-		const uint64_t time = now - r->last_opened;
-		if (time >= oldest_time) {
+		const std::shared_ptr<CachedRegion> &r = _region_cache[i];
+		// New references can only be taken while `_mutex` is locked, so if there are none, it is safe to close.
+		if (r.use_count() == 1 && r->last_accessed < oldest_access) {
+			oldest_access = r->last_accessed;
 			oldest_index = i;
 		}
 	}
 
-	CachedRegion *region = _region_cache[oldest_index];
+	if (oldest_index == -1) {
+		return false;
+	}
+
+	std::shared_ptr<CachedRegion> region = _region_cache[oldest_index];
 	_region_cache.erase(_region_cache.begin() + oldest_index);
 
-	close_region(region);
-	ZN_DELETE(region);
+	close_region(*region);
+	return true;
 }
 
-namespace {
+void VoxelStreamRegionFiles::get_region_file_list(StdVector<PositionAndLod> &out_regions) const {
+	using namespace zylann::godot;
+
+	for (unsigned int lod_index = 0; lod_index < _meta.lod_count; ++lod_index) {
+		const String lod_folder = _directory_path.path_join("regions").path_join("lod") + String::num_int64(lod_index);
+		const String ext = String(".") + RegionFormat::FILE_EXTENSION;
+
+		Ref<DirAccess> da = open_directory(lod_folder);
+		if (da.is_null()) {
+			continue;
+		}
+
+		da->list_dir_begin();
+
+		while (true) {
+			String fname = da->get_next();
+			if (fname == "") {
+				break;
+			}
+			if (da->current_is_dir()) {
+				continue;
+			}
+			if (fname.ends_with(ext)) {
+				PackedStringArray parts = fname.split(".");
+				// r.x.y.z.ext
+				if (parts.size() < 4) {
+					ZN_PRINT_ERROR(format("Found invalid region file: '{}'", fname));
+					continue;
+				}
+				PositionAndLod p;
+				p.position.x = parts[1].to_int();
+				p.position.y = parts[2].to_int();
+				p.position.z = parts[3].to_int();
+				p.lod_index = lod_index;
+				out_regions.push_back(p);
+			}
+		}
 
-inline int convert_block_coordinate(int p_x, int old_size, int new_size) {
-	return math::floordiv(p_x * old_size, new_size);
+		da->list_dir_end();
+	}
 }
 
-Vector3i convert_block_coordinates(Vector3i pos, Vector3i old_size, Vector3i new_size) {
-	return Vector3i(convert_block_coordinate(pos.x, old_size.x, new_size.x),
-			convert_block_coordinate(pos.y, old_size.y, new_size.y),
-			convert_block_coordinate(pos.z, old_size.z, new_size.z));
+bool VoxelStreamRegionFiles::get_voxel_block_keys(StdVector<BlockKey> &out_keys) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<PositionAndLod> region_list;
+	Vector3i region_size;
+	{
+		MutexLock lock(_mutex);
+
+		if (_directory_path.is_empty()) {
+			return false;
+		}
+		if (!_meta_loaded) {
+			if (load_meta() != zylann::godot::FILE_OK) {
+				// No block was ever saved
+				return true;
+			}
+		}
+
+		get_region_file_list(region_list);
+		region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+	}
+
+	for (const PositionAndLod &region_info : region_list) {
+		std::shared_ptr<CachedRegion> cache;
+		{
+			MutexLock lock(_mutex);
+			cache = open_region(region_info.position, region_info.lod_index, false);
+		}
+		if (cache == nullptr) {
+			continue;
+		}
+
+		MutexLock region_lock(cache->mutex);
+		const unsigned int block_count = cache->region.get_header_block_count();
+		for (unsigned int i = 0; i < block_count; ++i) {
+			if (cache->region.has_block(i)) {
+				const Vector3i block_rpos = cache->region.get_block_position_from_index(i);
+				out_keys.push_back(BlockKey{ block_rpos + region_info.position * region_size, region_info.lod_index });
+			}
+		}
+	}
+
+	return true;
 }
 
-} // namespace
+int64_t VoxelStreamRegionFiles::compact_region_files() {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<PositionAndLod> region_list;
+	{
+		MutexLock lock(_mutex);
+
+		if (_directory_path.is_empty()) {
+			return 0;
+		}
+		if (!_meta_loaded) {
+			if (load_meta() != zylann::godot::FILE_OK) {
+				// No block was ever saved
+				return 0;
+			}
+		}
+
+		get_region_file_list(region_list);
+	}
+
+	int64_t freed_bytes = 0;
+
+	for (const PositionAndLod &region_info : region_list) {
+		std::shared_ptr<CachedRegion> cache;
+		{
+			MutexLock lock(_mutex);
+			cache = open_region(region_info.position, region_info.lod_index, false);
+		}
+		if (cache == nullptr) {
+			continue;
+		}
+
+		// Other threads can keep using other regions in the meantime
+		MutexLock region_lock(cache->mutex);
+		int64_t region_freed_bytes = 0;
+		const Error err = cache->region.compact(&region_freed_bytes);
+		if (err != OK) {
+			ZN_PRINT_ERROR(format(
+					"Failed to compact region lod{}/{}, error {}", region_info.lod_index, region_info.position, err
+			));
+			continue;
+		}
+		freed_bytes += region_freed_bytes;
+	}
+
+	return freed_bytes;
+}
 
 void VoxelStreamRegionFiles::_convert_files(Meta new_meta) {
 	using namespace zylann::godot;
@@ -620,70 +882,34 @@ void VoxelStreamRegionFiles::_convert_files(Meta new_meta) {
 		ZN_PRINT_VERBOSE(format("Data backed up as {}", old_dir));
 	}
 
-	struct PositionAndLod {
-		Vector3i position;
-		uint8_t lod_index;
-	};
-
 	ERR_FAIL_COND(old_stream->load_meta() != FILE_OK);
 
 	StdVector<PositionAndLod> old_region_list;
 	Meta old_meta = old_stream->_meta;
 
 	// Get list of all regions from the old stream
-	{
-		for (unsigned int lod_index = 0; lod_index < old_meta.lod_count; ++lod_index) {
-			const String lod_folder =
-					old_stream->_directory_path.path_join("regions").path_join("lod") + String::num_int64(lod_index);
-			const String ext = String(".") + RegionFormat::FILE_EXTENSION;
-
-			Ref<DirAccess> da = open_directory(lod_folder);
-			if (da.is_null()) {
-				continue;
-			}
-
-			da->list_dir_begin();
-
-			while (true) {
-				String fname = da->get_next();
-				if (fname == "") {
-					break;
-				}
-				if (da->current_is_dir()) {
-					continue;
-				}
-				if (fname.ends_with(ext)) {
-					PackedStringArray parts = fname.split(".");
-					// r.x.y.z.ext
-					ERR_FAIL_COND_MSG(
-							parts.size() < 4, String("Found invalid region file: '{0}'").format(varray(fname)));
-					PositionAndLod p;
-					p.position.x = parts[1].to_int();
-					p.position.y = parts[2].to_int();
-					p.position.z = parts[3].to_int();
-					p.lod_index = lod_index;
-					old_region_list.push_back(p);
-				}
-			}
-
-			da->list_dir_end();
-		}
-	}
+	old_stream->get_region_file_list(old_region_list);
 
 	_meta = new_meta;
+	// Converting doesn't change the format of voxels
+	_meta.channel_depths = old_meta.channel_depths;
 	ERR_FAIL_COND(save_meta() != FILE_OK);
 
 	const Vector3i old_block_size = Vector3iUtil::create(1 << old_meta.block_size_po2);
 	const Vector3i new_block_size = Vector3iUtil::create(1 << _meta.block_size_po2);
 
 	const Vector3i old_region_size = Vector3iUtil::create(1 << old_meta.region_size_po2);
+	const Vector3i new_region_size = Vector3iUtil::create(1 << _meta.region_size_po2);
+
+	StdVector<uint8_t> block_data;
 
 	// Read all blocks from the old stream and write them into the new one
 
 	for (unsigned int i = 0; i < old_region_list.size(); ++i) {
 		PositionAndLod region_info = old_region_list[i];
 
-		const CachedRegion *old_region = old_stream->open_region(region_info.position, region_info.lod_index, false);
+		std::shared_ptr<CachedRegion> old_region =
+				old_stream->open_region(region_info.position, region_info.lod_index, false);
 		if (old_region == nullptr) {
 			continue;
 		}
@@ -696,6 +922,23 @@ void VoxelStreamRegionFiles::_convert_files(Meta new_meta) {
 				continue;
 			}
 
+			if (old_block_size == new_block_size) {
+				// Blocks keep the same size and format, so their data is moved without decoding it
+				const Vector3i block_rpos = old_region->region.get_block_position_from_index(j);
+				const Vector3i block_pos = block_rpos + region_info.position * old_region_size;
+				ERR_CONTINUE(old_region->region.load_block_data(block_rpos, block_data) != OK);
+
+				std::shared_ptr<CachedRegion> new_region =
+						open_region(get_region_position_from_blocks(block_pos), region_info.lod_index, true);
+				ERR_CONTINUE(new_region == nullptr);
+				ERR_CONTINUE(
+						new_region->region.save_block_data(
+								math::wrap(block_pos, new_region_size), to_span_const(block_data)
+						) != OK
+				);
+				continue;
+			}
+
 			VoxelBuffer old_block(VoxelBuffer::ALLOCATOR_POOL);
 			old_block.create(old_block_size.x, old_block_size.y, old_block_size.z);
 
@@ -714,72 +957,61 @@ void VoxelStreamRegionFiles::_convert_files(Meta new_meta) {
 			old_stream->load_voxel_block(old_block_load_query);
 
 			// Save it in the new one
-			if (old_block_size == new_block_size) {
-				VoxelStream::VoxelQueryData old_block_save_query{
-					old_block, //
-					block_pos, //
-					region_info.lod_index,
-					RESULT_ERROR //
+			Vector3i new_block_pos = convert_block_coordinates(block_pos, old_block_size, new_block_size);
+
+			// TODO Support any size? Assuming cubic blocks here
+			if (old_block_size.x < new_block_size.x) {
+				Vector3i ratio = new_block_size / old_block_size;
+				Vector3i rel = block_pos % ratio;
+
+				// Copy to a sub-area of one block
+				VoxelStream::VoxelQueryData new_block_load_query{ //
+					new_block, //
+					new_block_pos, //
+					region_info.lod_index, //
+					RESULT_ERROR
 				};
-				save_voxel_block(old_block_save_query);
+				load_voxel_block(new_block_load_query);
 
-			} else {
-				Vector3i new_block_pos = convert_block_coordinates(block_pos, old_block_size, new_block_size);
-
-				// TODO Support any size? Assuming cubic blocks here
-				if (old_block_size.x < new_block_size.x) {
-					Vector3i ratio = new_block_size / old_block_size;
-					Vector3i rel = block_pos % ratio;
-
-					// Copy to a sub-area of one block
-					VoxelStream::VoxelQueryData new_block_load_query{ //
-						new_block, //
-						new_block_pos, //
-						region_info.lod_index, //
-						RESULT_ERROR
-					};
-					load_voxel_block(new_block_load_query);
-
-					Vector3i dst_pos = rel * old_block.get_size();
-
-					for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
-						new_block.copy_channel_from(
-								old_block, Vector3i(), old_block.get_size(), dst_pos, channel_index);
-					}
+				Vector3i dst_pos = rel * old_block.get_size();
+
+				for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+					new_block.copy_channel_from(
+							old_block, Vector3i(), old_block.get_size(), dst_pos, channel_index);
+				}
 
-					new_block.compress_uniform_channels();
-					VoxelStream::VoxelQueryData new_block_save_query{ //
-						new_block, //
-						new_block_pos, //
-						region_info.lod_index, //
-						RESULT_ERROR
-					};
-					save_voxel_block(new_block_save_query);
-
-				} else {
-					// Copy to multiple blocks
-					Vector3i area = new_block_size / old_block_size;
-					Vector3i rpos;
-
-					for (rpos.z = 0; rpos.z < area.z; ++rpos.z) {
-						for (rpos.x = 0; rpos.x < area.x; ++rpos.x) {
-							for (rpos.y = 0; rpos.y < area.y; ++rpos.y) {
-								Vector3i src_min = rpos * new_block.get_size();
-								Vector3i src_max = src_min + new_block.get_size();
-
-								for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS;
-										++channel_index) {
-									new_block.copy_channel_from(old_block, src_min, src_max, Vector3i(), channel_index);
-								}
-
-								VoxelStream::VoxelQueryData new_block_save_query{ //
-									new_block, //
-									new_block_pos + rpos, //
-									region_info.lod_index, //
-									RESULT_ERROR
-								};
-								save_voxel_block(new_block_save_query);
+				new_block.compress_uniform_channels();
+				VoxelStream::VoxelQueryData new_block_save_query{ //
+					new_block, //
+					new_block_pos, //
+					region_info.lod_index, //
+					RESULT_ERROR
+				};
+				save_voxel_block(new_block_save_query);
+
+			} else {
+				// Copy to multiple blocks
+				Vector3i area = new_block_size / old_block_size;
+				Vector3i rpos;
+
+				for (rpos.z = 0; rpos.z < area.z; ++rpos.z) {
+					for (rpos.x = 0; rpos.x < area.x; ++rpos.x) {
+						for (rpos.y = 0; rpos.y < area.y; ++rpos.y) {
+							Vector3i src_min = rpos * new_block.get_size();
+							Vector3i src_max = src_min + new_block.get_size();
+
+							for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS;
+									++channel_index) {
+								new_block.copy_channel_from(old_block, src_min, src_max, Vector3i(), channel_index);
 							}
+
+							VoxelStream::VoxelQueryData new_block_save_query{ //
+								new_block, //
+								new_block_pos + rpos, //
+								region_info.lod_index, //
+								RESULT_ERROR
+							};
+							save_voxel_block(new_block_save_query);
 						}
 					}
 				}
@@ -886,6 +1118,40 @@ void VoxelStreamRegionFiles::set_lod_count(int p_lod_count) {
 	emit_changed();
 }
 
+void VoxelStreamRegionFiles::set_memory_mapping_enabled(bool enabled) {
+	MutexLock lock(_mutex);
+	if (enabled == _memory_mapping_enabled) {
+		return;
+	}
+	_memory_mapping_enabled = enabled;
+	for (std::shared_ptr<CachedRegion> &cr : _region_cache) {
+		MutexLock region_lock(cr->mutex);
+		cr->region.set_memory_mapping_enabled(enabled);
+	}
+}
+
+bool VoxelStreamRegionFiles::is_memory_mapping_enabled() const {
+	MutexLock lock(_mutex);
+	return _memory_mapping_enabled;
+}
+
+void VoxelStreamRegionFiles::set_max_open_regions(int count) {
+	ERR_FAIL_COND(count < 1);
+	ERR_FAIL_COND(count > MAX_OPEN_REGIONS_LIMIT);
+	MutexLock lock(_mutex);
+	_max_open_regions = count;
+	while (_region_cache.size() > _max_open_regions) {
+		if (!close_oldest_region()) {
+			break;
+		}
+	}
+}
+
+int VoxelStreamRegionFiles::get_max_open_regions() const {
+	MutexLock lock(_mutex);
+	return _max_open_regions;
+}
+
 void VoxelStreamRegionFiles::convert_files(Dictionary d) {
 	Meta meta;
 	meta.version = _meta.version;
@@ -921,7 +1187,8 @@ void VoxelStreamRegionFiles::convert_files(Dictionary d) {
 void VoxelStreamRegionFiles::flush() {
 	ZN_PROFILE_SCOPE();
 	MutexLock lock(_mutex);
-	for (CachedRegion *cr : _region_cache) {
+	for (std::shared_ptr<CachedRegion> &cr : _region_cache) {
+		MutexLock region_lock(cr->mutex);
 		cr->region.flush();
 	}
 }
@@ -941,9 +1208,22 @@ void VoxelStreamRegionFiles::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_region_size_po2"), &VoxelStreamRegionFiles::set_region_size_po2);
 	ClassDB::bind_method(D_METHOD("set_sector_size"), &VoxelStreamRegionFiles::set_sector_size);
 
+	ClassDB::bind_method(D_METHOD("set_memory_mapping_enabled", "enabled"),
+			&VoxelStreamRegionFiles::set_memory_mapping_enabled);
+	ClassDB::bind_method(
+			D_METHOD("is_memory_mapping_enabled"), &VoxelStreamRegionFiles::is_memory_mapping_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_max_open_regions", "count"), &VoxelStreamRegionFiles::set_max_open_regions);
+	ClassDB::bind_method(D_METHOD("get_max_open_regions"), &VoxelStreamRegionFiles::get_max_open_regions);
+
 	ClassDB::bind_method(D_METHOD("convert_files", "new_settings"), &VoxelStreamRegionFiles::convert_files);
+	ClassDB::bind_method(D_METHOD("compact_region_files"), &VoxelStreamRegionFiles::compact_region_files);
 
 	ADD_PROPERTY(PropertyInfo(Variant::STRING, "directory", PROPERTY_HINT_DIR), "set_directory", "get_directory");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "memory_mapping_enabled"), "set_memory_mapping_enabled",
+			"is_memory_mapping_enabled");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "max_open_regions", PROPERTY_HINT_RANGE, "1,1024"), "set_max_open_regions",
+			"get_max_open_regions");
 
 	ADD_GROUP("Dimensions", "");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "lod_count"), "set_lod_count", "get_lod_count");
@@ -4,9 +4,11 @@
 #include "../../util/containers/fixed_array.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/file_utils.h"
+#include "../../util/io/file_locker.h"
 #include "../../util/thread/mutex.h"
 #include "../voxel_stream.h"
 #include "region_file.h"
+#include <memory>
 
 namespace zylann::voxel {
 
@@ -17,7 +19,10 @@ namespace zylann::voxel {
 // because it allows to keep using the same file handles and avoid switching.
 // Inspired by https://www.seedofandromeda.com/blogs/1-creating-a-region-file-system-for-a-voxel-game
 //
-// Region files are not thread-safe. Because of this, internal mutexing may often constrain the use by one thread only.
+// Region files are not thread-safe, so each of them is locked while being accessed. Different regions can be accessed
+// by different threads at the same time.
+// When memory mapping is enabled, only locating blocks is serialized per region, decompression can run on multiple
+// threads.
 //
 class VoxelStreamRegionFiles : public VoxelStream {
 	GDCLASS(VoxelStreamRegionFiles, VoxelStream)
@@ -31,6 +36,12 @@ public:
 	void load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) override;
 	void save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) override;
 
+	// Each region overlapping the box is locked once, and its blocks are read in the order they appear in the file.
+	void load_voxel_blocks_in_box(Box3i box_in_blocks, uint8_t lod_index, FullLoadingResult &result) override;
+
+	// Regions are opened one by one to read which blocks their header contains.
+	bool get_voxel_block_keys(StdVector<BlockKey> &out_keys) override;
+
 	int get_used_channels_mask() const override;
 
 	String get_directory() const;
@@ -50,8 +61,19 @@ public:
 	void set_sector_size(int p_sector_size);
 	void set_lod_count(int p_lod_count);
 
+	void set_memory_mapping_enabled(bool enabled);
+	bool is_memory_mapping_enabled() const;
+
+	void set_max_open_regions(int count);
+	int get_max_open_regions() const;
+
 	void convert_files(Dictionary d);
 
+	// Compacts every region file, see `RegionFile::compact`. Returns how many bytes were freed.
+	// This can take a while, so it should preferably run in a background thread. It is safe to do so while the stream
+	// is in use, as regions are locked one by one.
+	int64_t compact_region_files();
+
 	void flush() override;
 
 protected:
@@ -67,6 +89,7 @@ private:
 		EMERGE_FAILED
 	};
 
+	static EmergeResult get_emerge_result(Error region_error);
 	EmergeResult _load_block(VoxelBuffer &out_buffer, Vector3i block_pos, int lod);
 	void _save_block(VoxelBuffer &voxel_buffer, Vector3i block_pos, int lod);
 
@@ -76,10 +99,10 @@ private:
 	Vector3i get_region_position_from_blocks(const Vector3i &block_position) const;
 	void close_all_regions();
 	String get_region_file_path(const Vector3i &region_pos, unsigned int lod) const;
-	CachedRegion *open_region(const Vector3i region_pos, unsigned int lod, bool create_if_not_found);
-	void close_region(CachedRegion *cache);
-	CachedRegion *get_region_from_cache(const Vector3i pos, int lod) const;
-	void close_oldest_region();
+	std::shared_ptr<CachedRegion> open_region(const Vector3i region_pos, unsigned int lod, bool create_if_not_found);
+	void close_region(CachedRegion &cache);
+	std::shared_ptr<CachedRegion> get_region_from_cache(const Vector3i pos, int lod) const;
+	bool close_oldest_region();
 
 	struct Meta {
 		uint8_t version = -1;
@@ -93,6 +116,14 @@ private:
 	static bool check_meta(const Meta &meta);
 	void _convert_files(Meta new_meta);
 
+	struct PositionAndLod {
+		Vector3i position;
+		uint8_t lod_index;
+	};
+
+	// Lists region files found in the directory, for all LODs of the current meta.
+	void get_region_file_list(StdVector<PositionAndLod> &out_regions) const;
+
 	// Orders block requests so those querying the same regions get grouped together
 	struct BlockQueryComparator {
 		VoxelStreamRegionFiles *self = nullptr;
@@ -113,27 +144,35 @@ private:
 		}
 	};
 
-	// TODO This is not thread-friendly.
-	// `VoxelRegionFile` is not thread-safe so we have to limit the usage to one thread at once, blocking the others.
-	// A refactoring should be done to allow better threading.
-
+	// `RegionFile` is not thread-safe, so only one thread at a time can use a given region, while holding its mutex.
+	// Regions are referenced by threads using them, so they don't get closed while in use. When they are removed from
+	// the cache while still referenced, the last reference closes them.
 	struct CachedRegion {
 		Vector3i position;
 		int lod = 0;
 		bool file_exists = false;
 		RegionFile region;
-		uint64_t last_opened = 0;
-		// uint64_t last_accessed;
+		// Value of the access counter when the region was last used
+		uint64_t last_accessed = 0;
+		Mutex mutex;
+		// Keeps the lock entry of the file while it is open, so other streams using the same file are synchronized
+		// without looking up its path every time
+		FileLocker::Handle file_lock;
 	};
 
 	String _directory_path;
 	Meta _meta;
 	bool _meta_loaded = false;
 	bool _meta_saved = false;
-	StdVector<CachedRegion *> _region_cache;
+	// Only the list is protected by `_mutex`, regions are protected by their own mutex
+	StdVector<std::shared_ptr<CachedRegion>> _region_cache;
+	// Incremented every time a region is used, to find the least recently used one
+	uint64_t _region_access_counter = 0;
 	// TODO Add memory caches to increase capacity.
 	unsigned int _max_open_regions = MIN(8, FOPEN_MAX);
+	bool _memory_mapping_enabled = false;
 
+	// Protects meta and the region cache. Must not be locked while holding the mutex of a region.
 	Mutex _mutex;
 };
 
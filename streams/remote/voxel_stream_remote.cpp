@@ -0,0 +1,621 @@
+#include "voxel_stream_remote.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../util/godot/classes/time.h"
+#include "../../util/godot/core/string.h"
+#include "../../util/io/log.h"
+#include "../../util/io/serialization.h"
+#include "../../util/math/funcs.h"
+#include "../../util/profiling.h"
+#include "../../util/string/format.h"
+#include "../../util/thread/thread.h"
+#include "../voxel_block_serializer.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+// Sent once when a connection is opened, followed by the protocol version
+const uint32_t PROTOCOL_MAGIC = 0x52584f56; // "VOXR" in little-endian
+const uint8_t PROTOCOL_VERSION = 0;
+
+enum Command : uint8_t { //
+	COMMAND_LOAD = 0,
+	COMMAND_SAVE = 1
+};
+
+enum Status : uint8_t { //
+	STATUS_OK = 0,
+	STATUS_NOT_FOUND = 1,
+	STATUS_NOT_MODIFIED = 2,
+	STATUS_ERROR = 3
+};
+
+// Compressed blocks larger than this are assumed to be garbage
+const uint32_t MAX_BLOCK_DATA_SIZE = 64 * 1024 * 1024;
+
+// Time to wait between checks when data is not available yet
+const uint32_t POLL_INTERVAL_USEC = 200;
+
+uint64_t get_ticks_msec() {
+	return Time::get_singleton()->get_ticks_msec();
+}
+
+bool wait_for_connection(StreamPeerTCP &peer, uint64_t deadline_msec) {
+	while (true) {
+		peer.poll();
+		const StreamPeerTCP::Status status = peer.get_status();
+		if (status == StreamPeerTCP::STATUS_CONNECTED) {
+			return true;
+		}
+		if (status != StreamPeerTCP::STATUS_CONNECTING || get_ticks_msec() > deadline_msec) {
+			return false;
+		}
+		Thread::sleep_usec(POLL_INTERVAL_USEC);
+	}
+}
+
+bool read_exactly(StreamPeerTCP &peer, Span<uint8_t> dst, uint64_t deadline_msec) {
+	size_t pos = 0;
+	while (pos < dst.size()) {
+		peer.poll();
+		if (peer.get_status() != StreamPeerTCP::STATUS_CONNECTED) {
+			return false;
+		}
+		int received = 0;
+		const Error err = zylann::godot::get_partial_data(peer, dst.sub(pos), received);
+		if (err != OK) {
+			return false;
+		}
+		pos += received;
+		if (received == 0) {
+			if (get_ticks_msec() > deadline_msec) {
+				return false;
+			}
+			Thread::sleep_usec(POLL_INTERVAL_USEC);
+		}
+	}
+	return true;
+}
+
+template <typename T>
+bool read_value(StreamPeerTCP &peer, T &out_value, uint64_t deadline_msec) {
+	FixedArray<uint8_t, sizeof(T)> bytes;
+	if (!read_exactly(peer, to_span(bytes), deadline_msec)) {
+		return false;
+	}
+	MemoryReader mr(to_span_const(bytes), ENDIANNESS_LITTLE_ENDIAN);
+	if constexpr (sizeof(T) == 1) {
+		out_value = mr.get_8();
+	} else if constexpr (sizeof(T) == 4) {
+		out_value = mr.get_32();
+	} else {
+		static_assert(sizeof(T) == 8);
+		out_value = mr.get_64();
+	}
+	return true;
+}
+
+} // namespace
+
+VoxelStreamRemote::VoxelStreamRemote() {}
+
+VoxelStreamRemote::~VoxelStreamRemote() {
+	// Connections close when the last reference to them is released
+	MutexLock lock(_connections_mutex);
+	_idle_connections.clear();
+}
+
+void VoxelStreamRemote::set_host(String host) {
+	{
+		MutexLock lock(_mutex);
+		if (host == _params.host) {
+			return;
+		}
+		_params.host = host;
+	}
+	MutexLock lock(_connections_mutex);
+	_connection_count -= _idle_connections.size();
+	_idle_connections.clear();
+	++_server_generation;
+}
+
+String VoxelStreamRemote::get_host() const {
+	MutexLock lock(_mutex);
+	return _params.host;
+}
+
+void VoxelStreamRemote::set_port(int port) {
+	ERR_FAIL_COND(port <= 0 || port > 65535);
+	{
+		MutexLock lock(_mutex);
+		if (port == _params.port) {
+			return;
+		}
+		_params.port = port;
+	}
+	MutexLock lock(_connections_mutex);
+	_connection_count -= _idle_connections.size();
+	_idle_connections.clear();
+	++_server_generation;
+}
+
+int VoxelStreamRemote::get_port() const {
+	MutexLock lock(_mutex);
+	return _params.port;
+}
+
+void VoxelStreamRemote::set_max_connections(int count) {
+	ERR_FAIL_COND(count < 1 || count > static_cast<int>(MAX_CONNECTIONS));
+	MutexLock lock(_mutex);
+	_params.max_connections = count;
+}
+
+int VoxelStreamRemote::get_max_connections() const {
+	MutexLock lock(_mutex);
+	return _params.max_connections;
+}
+
+void VoxelStreamRemote::set_timeout_msec(int msec) {
+	ERR_FAIL_COND(msec < 0);
+	MutexLock lock(_mutex);
+	_params.timeout_msec = msec;
+}
+
+int VoxelStreamRemote::get_timeout_msec() const {
+	MutexLock lock(_mutex);
+	return _params.timeout_msec;
+}
+
+void VoxelStreamRemote::set_cache_stream(Ref<VoxelStream> stream) {
+	ERR_FAIL_COND_MSG(stream.ptr() == this, "The stream can't use itself as cache");
+	MutexLock lock(_mutex);
+	_params.cache_stream = stream;
+	// Versions describe blocks of the previous cache
+	for (StdUnorderedMap<Vector3i, uint64_t> &versions : _versions) {
+		versions.clear();
+	}
+}
+
+Ref<VoxelStream> VoxelStreamRemote::get_cache_stream() const {
+	MutexLock lock(_mutex);
+	return _params.cache_stream;
+}
+
+void VoxelStreamRemote::set_cache_validation_enabled(bool enabled) {
+	MutexLock lock(_mutex);
+	_params.cache_validation_enabled = enabled;
+}
+
+bool VoxelStreamRemote::is_cache_validation_enabled() const {
+	MutexLock lock(_mutex);
+	return _params.cache_validation_enabled;
+}
+
+VoxelStreamRemote::Params VoxelStreamRemote::get_params() const {
+	MutexLock lock(_mutex);
+	return _params;
+}
+
+uint64_t VoxelStreamRemote::get_version(const VoxelQueryData &q) const {
+	MutexLock lock(_mutex);
+	const StdUnorderedMap<Vector3i, uint64_t> &versions = _versions[q.lod_index];
+	auto it = versions.find(q.position_in_blocks);
+	return it != versions.end() ? it->second : 0;
+}
+
+void VoxelStreamRemote::set_version(const VoxelQueryData &q, uint64_t version) {
+	MutexLock lock(_mutex);
+	_versions[q.lod_index][q.position_in_blocks] = version;
+}
+
+void VoxelStreamRemote::load_voxel_blocks(Span<VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	const Params params = get_params();
+
+	for (VoxelQueryData &q : p_blocks) {
+		q.result = RESULT_ERROR;
+	}
+
+	if (params.cache_stream.is_valid()) {
+		params.cache_stream->load_voxel_blocks(p_blocks);
+	}
+
+	StdVector<Request> requests;
+	for (VoxelQueryData &q : p_blocks) {
+		ZN_ASSERT_CONTINUE(q.lod_index < constants::MAX_LOD);
+		uint64_t known_version = 0;
+		if (q.result == RESULT_BLOCK_FOUND) {
+			if (!params.cache_validation_enabled) {
+				continue;
+			}
+			known_version = get_version(q);
+		}
+		requests.push_back(Request{ &q, known_version, StdVector<uint8_t>() });
+	}
+
+	if (requests.size() == 0) {
+		return;
+	}
+
+	if (params.host.is_empty()) {
+		// Working only with the cache
+		for (Request &request : requests) {
+			if (request.query->result != RESULT_BLOCK_FOUND) {
+				request.query->result = RESULT_BLOCK_NOT_FOUND;
+			}
+		}
+		return;
+	}
+
+	// Blocks already found in the cache remain valid if the server can't be reached
+	if (!run_requests(to_span(requests), false, params)) {
+		ZN_PRINT_ERROR(format(
+				"Could not load {} blocks from {}:{}",
+				requests.size(),
+				zylann::godot::GodotStringWrapper(params.host),
+				params.port
+		));
+		return;
+	}
+
+	if (params.cache_stream.is_null()) {
+		return;
+	}
+
+	// Write received blocks through to the cache. The cache may take ownership of buffers, so it gets copies.
+	StdVector<VoxelBuffer> cached_buffers;
+	StdVector<VoxelQueryData> cache_queries;
+	unsigned int received_count = 0;
+	for (const Request &request : requests) {
+		if (request.data.size() > 0) {
+			++received_count;
+		}
+	}
+	cached_buffers.reserve(received_count);
+	cache_queries.reserve(received_count);
+	for (const Request &request : requests) {
+		// Data is only kept for blocks received from the server
+		if (request.data.size() == 0) {
+			continue;
+		}
+		const VoxelQueryData &q = *request.query;
+		cached_buffers.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+		q.voxel_buffer.copy_to(cached_buffers.back(), true);
+		cache_queries.push_back(
+				VoxelQueryData{ cached_buffers.back(), q.position_in_blocks, q.lod_index, RESULT_BLOCK_FOUND }
+		);
+	}
+	if (cache_queries.size() > 0) {
+		params.cache_stream->save_voxel_blocks(to_span(cache_queries));
+	}
+}
+
+void VoxelStreamRemote::save_voxel_blocks(Span<VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	const Params params = get_params();
+
+	if (!params.host.is_empty()) {
+		StdVector<Request> requests;
+		requests.reserve(p_blocks.size());
+
+		for (VoxelQueryData &q : p_blocks) {
+			ZN_ASSERT_CONTINUE(q.lod_index < constants::MAX_LOD);
+			Request request{ &q, 0, StdVector<uint8_t>() };
+			const CompressedData::Compression compression = CompressedData::COMPRESSION_LZ4;
+			request.data.resize(BlockSerializer::get_serialized_and_compressed_size_bound(q.voxel_buffer, compression));
+			size_t size = 0;
+			ZN_ASSERT_CONTINUE(BlockSerializer::serialize_and_compress(
+					q.voxel_buffer, to_span(request.data), size, compression, CompressedData::ZstdOptions()
+			));
+			request.data.resize(size);
+			requests.push_back(std::move(request));
+		}
+
+		if (requests.size() > 0 && !run_requests(to_span(requests), true, params)) {
+			ZN_PRINT_ERROR(format(
+					"Could not save {} blocks to {}:{}",
+					requests.size(),
+					zylann::godot::GodotStringWrapper(params.host),
+					params.port
+			));
+		}
+	}
+
+	// The cache comes last because it may take ownership of buffers
+	if (params.cache_stream.is_valid()) {
+		params.cache_stream->save_voxel_blocks(p_blocks);
+	}
+}
+
+void VoxelStreamRemote::load_voxel_block(VoxelQueryData &query_data) {
+	load_voxel_blocks(Span<VoxelQueryData>(&query_data, 1));
+}
+
+void VoxelStreamRemote::save_voxel_block(VoxelQueryData &query_data) {
+	save_voxel_blocks(Span<VoxelQueryData>(&query_data, 1));
+}
+
+bool VoxelStreamRemote::run_requests(Span<Request> requests, bool save, const Params &params) {
+	const unsigned int wanted_connection_count = math::clamp(
+			math::ceildiv(static_cast<int>(requests.size()), static_cast<int>(MIN_BLOCKS_PER_CONNECTION)),
+			1,
+			static_cast<int>(params.max_connections)
+	);
+
+	StdVector<Connection> connections;
+	acquire_connections(wanted_connection_count, params, connections);
+
+	return run_requests_on_connections(requests, to_span(connections), save, params);
+}
+
+bool VoxelStreamRemote::run_requests_on_connections(
+		Span<Request> requests,
+		Span<Connection> connections,
+		bool save,
+		const Params &params
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V(connections.size() > 0, false);
+
+	const uint64_t deadline_msec = get_ticks_msec() + params.timeout_msec;
+
+	// Contiguous chunks of requests are assigned to each connection
+	const unsigned int chunk_size =
+			math::ceildiv(static_cast<int>(requests.size()), static_cast<int>(connections.size()));
+	FixedArray<bool, MAX_CONNECTIONS> healthy;
+	ZN_ASSERT_RETURN_V(connections.size() <= healthy.size(), false);
+	fill(healthy, true);
+
+	// Send all requests first, so the server can work on them while we wait for the first responses
+	StdVector<uint8_t> message;
+	for (unsigned int ci = 0; ci < connections.size(); ++ci) {
+		Connection &connection = connections[ci];
+
+		if (!wait_for_connection(*connection.peer.ptr(), deadline_msec)) {
+			healthy[ci] = false;
+			continue;
+		}
+
+		const unsigned int begin = ci * chunk_size;
+		const unsigned int end = math::min(begin + chunk_size, static_cast<unsigned int>(requests.size()));
+
+		message.clear();
+		MemoryWriter mw(message, ENDIANNESS_LITTLE_ENDIAN);
+		if (!connection.handshake_sent) {
+			connection.peer->set_no_delay(true);
+			mw.store_32(PROTOCOL_MAGIC);
+			mw.store_8(PROTOCOL_VERSION);
+			connection.handshake_sent = true;
+		}
+		for (unsigned int i = begin; i < end; ++i) {
+			const Request &request = requests[i];
+			const VoxelQueryData &q = *request.query;
+			mw.store_8(save ? COMMAND_SAVE : COMMAND_LOAD);
+			mw.store_32(q.position_in_blocks.x);
+			mw.store_32(q.position_in_blocks.y);
+			mw.store_32(q.position_in_blocks.z);
+			mw.store_8(q.lod_index);
+			if (save) {
+				mw.store_32(request.data.size());
+				mw.store_buffer(to_span(request.data));
+			} else {
+				mw.store_64(request.known_version);
+			}
+		}
+
+		if (zylann::godot::put_data(*connection.peer.ptr(), to_span(message)) != OK) {
+			healthy[ci] = false;
+		}
+	}
+
+	// Responses come in the same order as requests on each connection
+	for (unsigned int ci = 0; ci < connections.size(); ++ci) {
+		if (!healthy[ci]) {
+			continue;
+		}
+		StreamPeerTCP &peer = *connections[ci].peer.ptr();
+
+		const unsigned int begin = ci * chunk_size;
+		const unsigned int end = math::min(begin + chunk_size, static_cast<unsigned int>(requests.size()));
+
+		for (unsigned int i = begin; i < end && healthy[ci]; ++i) {
+			Request &request = requests[i];
+			VoxelQueryData &q = *request.query;
+
+			uint8_t status;
+			if (!read_value(peer, status, deadline_msec)) {
+				healthy[ci] = false;
+				break;
+			}
+
+			switch (status) {
+				case STATUS_OK: {
+					uint64_t version;
+					if (!read_value(peer, version, deadline_msec)) {
+						healthy[ci] = false;
+						break;
+					}
+					if (save) {
+						set_version(q, version);
+						break;
+					}
+					uint32_t size;
+					if (!read_value(peer, size, deadline_msec) || size > MAX_BLOCK_DATA_SIZE) {
+						healthy[ci] = false;
+						break;
+					}
+					request.data.resize(size);
+					if (!read_exactly(peer, to_span(request.data), deadline_msec)) {
+						healthy[ci] = false;
+						break;
+					}
+					// Decompressing here, this runs in a thread of the engine anyways
+					if (BlockSerializer::decompress_and_deserialize(to_span(request.data), q.voxel_buffer)) {
+						q.result = RESULT_BLOCK_FOUND;
+						set_version(q, version);
+					} else {
+						ZN_PRINT_ERROR(format(
+								"Failed to decompress block {} lod {} received from the server",
+								q.position_in_blocks,
+								static_cast<int>(q.lod_index)
+						));
+						q.result = RESULT_ERROR;
+						request.data.clear();
+					}
+				} break;
+
+				case STATUS_NOT_FOUND:
+					if (!save) {
+						q.result = RESULT_BLOCK_NOT_FOUND;
+					}
+					break;
+
+				case STATUS_NOT_MODIFIED:
+					// The block in the cache is up to date
+					break;
+
+				case STATUS_ERROR:
+					if (!save) {
+						q.result = RESULT_ERROR;
+					} else {
+						ZN_PRINT_ERROR(format(
+								"Server failed to save block {} lod {}",
+								q.position_in_blocks,
+								static_cast<int>(q.lod_index)
+						));
+					}
+					break;
+
+				default:
+					// Can't tell where the next response begins
+					ZN_PRINT_ERROR(format("Unexpected status {} received from the server", static_cast<int>(status)));
+					healthy[ci] = false;
+					break;
+			}
+		}
+	}
+
+	bool success = true;
+	for (unsigned int ci = 0; ci < connections.size(); ++ci) {
+		recycle_connection(connections[ci], healthy[ci]);
+		success &= healthy[ci];
+	}
+	return success;
+}
+
+void VoxelStreamRemote::acquire_connections(
+		unsigned int count,
+		const Params &params,
+		StdVector<Connection> &out_connections
+) {
+	while (true) {
+		{
+			MutexLock lock(_connections_mutex);
+
+			while (out_connections.size() < count && _idle_connections.size() > 0) {
+				out_connections.push_back(_idle_connections.back());
+				_idle_connections.pop_back();
+			}
+
+			while (out_connections.size() < count && _connection_count < params.max_connections) {
+				Ref<StreamPeerTCP> peer;
+				peer.instantiate();
+				// Connecting happens in the background. If it fails, the connection is still returned so the caller
+				// handles it like other communication errors.
+				const Error err = zylann::godot::connect_to_host(*peer.ptr(), params.host, params.port);
+				if (err != OK) {
+					ZN_PRINT_ERROR(format(
+							"Could not connect to {}:{}", zylann::godot::GodotStringWrapper(params.host), params.port
+					));
+				}
+				out_connections.push_back(Connection{ peer, _server_generation, false });
+				++_connection_count;
+			}
+
+			if (out_connections.size() > 0) {
+				return;
+			}
+		}
+
+		// All connections are used by other threads
+		_connection_recycled.wait();
+	}
+}
+
+void VoxelStreamRemote::recycle_connection(Connection connection, bool healthy) {
+	{
+		MutexLock lock(_connections_mutex);
+		if (healthy && connection.server_generation == _server_generation) {
+			_idle_connections.push_back(connection);
+		} else {
+			// The connection is closed when its last reference goes away
+			--_connection_count;
+		}
+	}
+	_connection_recycled.post();
+}
+
+int VoxelStreamRemote::get_used_channels_mask() const {
+	// Assuming all, since the server can store anything
+	return VoxelBuffer::ALL_CHANNELS_MASK;
+}
+
+int VoxelStreamRemote::get_lod_count() const {
+	return constants::MAX_LOD;
+}
+
+void VoxelStreamRemote::flush() {
+	Ref<VoxelStream> cache_stream = get_cache_stream();
+	if (cache_stream.is_valid()) {
+		cache_stream->flush();
+	}
+}
+
+void VoxelStreamRemote::_bind_methods() {
+	using Self = VoxelStreamRemote;
+
+	ClassDB::bind_method(D_METHOD("set_host", "host"), &Self::set_host);
+	ClassDB::bind_method(D_METHOD("get_host"), &Self::get_host);
+
+	ClassDB::bind_method(D_METHOD("set_port", "port"), &Self::set_port);
+	ClassDB::bind_method(D_METHOD("get_port"), &Self::get_port);
+
+	ClassDB::bind_method(D_METHOD("set_max_connections", "count"), &Self::set_max_connections);
+	ClassDB::bind_method(D_METHOD("get_max_connections"), &Self::get_max_connections);
+
+	ClassDB::bind_method(D_METHOD("set_timeout_msec", "msec"), &Self::set_timeout_msec);
+	ClassDB::bind_method(D_METHOD("get_timeout_msec"), &Self::get_timeout_msec);
+
+	ClassDB::bind_method(D_METHOD("set_cache_stream", "stream"), &Self::set_cache_stream);
+	ClassDB::bind_method(D_METHOD("get_cache_stream"), &Self::get_cache_stream);
+
+	ClassDB::bind_method(D_METHOD("set_cache_validation_enabled", "enabled"), &Self::set_cache_validation_enabled);
+	ClassDB::bind_method(D_METHOD("is_cache_validation_enabled"), &Self::is_cache_validation_enabled);
+
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "host"), "set_host", "get_host");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "port", PROPERTY_HINT_RANGE, "1,65535"), "set_port", "get_port");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "max_connections", PROPERTY_HINT_RANGE, "1,32"),
+			"set_max_connections",
+			"get_max_connections"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "timeout_msec", PROPERTY_HINT_RANGE, "0,60000,1,or_greater"),
+			"set_timeout_msec",
+			"get_timeout_msec"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "cache_stream", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()),
+			"set_cache_stream",
+			"get_cache_stream"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "cache_validation_enabled"),
+			"set_cache_validation_enabled",
+			"is_cache_validation_enabled"
+	);
+}
+
+} // namespace zylann::voxel
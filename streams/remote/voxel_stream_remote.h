@@ -0,0 +1,133 @@
+#ifndef VOXEL_STREAM_REMOTE_H
+#define VOXEL_STREAM_REMOTE_H
+
+#include "../../constants/voxel_constants.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/stream_peer_tcp.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
+#include "../../util/thread/semaphore.h"
+#include "../voxel_stream.h"
+
+namespace zylann::voxel {
+
+// Loads and saves blocks from a server over TCP, using the protocol described in `remote_protocol_v0.md`. Blocks are
+// sent in the same compressed format as other streams.
+// Requests of a batch are all sent before reading responses, and large batches are spread over several connections,
+// so latency is paid once per batch rather than once per block.
+// Blocks can be written through to a local cache stream (like VoxelStreamSQLite), which is used when the server can't
+// be reached. Versions of blocks received from the server are remembered, so blocks already in the cache are only
+// transferred again when they changed.
+class VoxelStreamRemote : public VoxelStream {
+	GDCLASS(VoxelStreamRemote, VoxelStream)
+public:
+	static const unsigned int DEFAULT_PORT = 9786;
+	static const unsigned int DEFAULT_MAX_CONNECTIONS = 4;
+	static const unsigned int MAX_CONNECTIONS = 32;
+	static const unsigned int DEFAULT_TIMEOUT_MSEC = 10000;
+	// Batches are not split into chunks smaller than this, because each connection adds some overhead
+	static const unsigned int MIN_BLOCKS_PER_CONNECTION = 16;
+
+	VoxelStreamRemote();
+	~VoxelStreamRemote();
+
+	// Changing the server closes existing connections
+	void set_host(String host);
+	String get_host() const;
+
+	void set_port(int port);
+	int get_port() const;
+
+	// Maximum number of connections opened at once with the server, shared by all threads using the stream
+	void set_max_connections(int count);
+	int get_max_connections() const;
+
+	void set_timeout_msec(int msec);
+	int get_timeout_msec() const;
+
+	// Local stream where blocks received from or sent to the server are also saved
+	void set_cache_stream(Ref<VoxelStream> stream);
+	Ref<VoxelStream> get_cache_stream() const;
+
+	// If disabled, blocks found in the cache are used without asking the server
+	void set_cache_validation_enabled(bool enabled);
+	bool is_cache_validation_enabled() const;
+
+	void load_voxel_blocks(Span<VoxelQueryData> p_blocks) override;
+	void save_voxel_blocks(Span<VoxelQueryData> p_blocks) override;
+	void load_voxel_block(VoxelQueryData &query_data) override;
+	void save_voxel_block(VoxelQueryData &query_data) override;
+
+	int get_used_channels_mask() const override;
+	int get_lod_count() const override;
+
+	void flush() override;
+
+private:
+	struct Request {
+		VoxelQueryData *query;
+		// Version of the block found in the cache, or 0
+		uint64_t known_version;
+		// Compressed block, when saving
+		StdVector<uint8_t> data;
+	};
+
+	struct Connection {
+		Ref<StreamPeerTCP> peer;
+		uint32_t server_generation;
+		// The protocol header is sent with the first requests, once connected
+		bool handshake_sent;
+	};
+
+	struct Params {
+		String host;
+		int port = DEFAULT_PORT;
+		unsigned int max_connections = DEFAULT_MAX_CONNECTIONS;
+		unsigned int timeout_msec = DEFAULT_TIMEOUT_MSEC;
+		Ref<VoxelStream> cache_stream;
+		bool cache_validation_enabled = true;
+	};
+
+	Params get_params() const;
+
+	// Runs requests over as many connections as the batch and the limit allow. Returns false if the server could not be
+	// reached, or if communication failed.
+	bool run_requests(Span<Request> requests, bool save, const Params &params);
+	bool run_requests_on_connections(
+			Span<Request> requests,
+			Span<Connection> connections,
+			bool save,
+			const Params &params
+	);
+
+	// Gets at least one connection, waiting for one to be recycled if the limit is reached
+	void acquire_connections(unsigned int count, const Params &params, StdVector<Connection> &out_connections);
+	void recycle_connection(Connection connection, bool healthy);
+
+	uint64_t get_version(const VoxelQueryData &q) const;
+	void set_version(const VoxelQueryData &q, uint64_t version);
+
+	static void _bind_methods();
+
+	Params _params;
+	// Protects parameters and versions
+	Mutex _mutex;
+
+	StdVector<Connection> _idle_connections;
+	// Connections currently opened, idle or not
+	unsigned int _connection_count = 0;
+	// Incremented when `host` or `port` change, so connections to the previous server are not recycled
+	uint32_t _server_generation = 0;
+	Mutex _connections_mutex;
+	// Posted when a connection is recycled, for threads waiting to get one
+	Semaphore _connection_recycled;
+
+	// Versions of blocks sent by the server. Only kept for the current session.
+	FixedArray<StdUnorderedMap<Vector3i, uint64_t>, constants::MAX_LOD> _versions;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_STREAM_REMOTE_H
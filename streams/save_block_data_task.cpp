@@ -10,8 +10,39 @@
 namespace zylann::voxel {
 
 namespace {
+
 std::atomic_int g_debug_save_block_tasks_count = { 0 };
-}
+
+// Writes blocks of a save queue. This is the only part of saving voxels that accesses files, so it runs as an I/O task
+// while blocks get compressed by save tasks on other threads.
+class FlushSaveBlockQueueTask : public IThreadedTask {
+public:
+	FlushSaveBlockQueueTask(std::shared_ptr<StreamingDependency> p_stream_dependency) :
+			_stream_dependency(p_stream_dependency) {}
+
+	const char *get_debug_name() const override {
+		return "FlushSaveBlockQueue";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		Ref<VoxelStream> stream = _stream_dependency->stream;
+		ZN_ASSERT_RETURN(stream.is_valid());
+		_stream_dependency->save_queue->flush(**stream);
+	}
+
+	TaskPriority get_priority() override {
+		TaskPriority p;
+		p.band2 = constants::TASK_PRIORITY_SAVE_BAND2;
+		p.band3 = constants::TASK_PRIORITY_BAND3_DEFAULT;
+		return p;
+	}
+
+private:
+	std::shared_ptr<StreamingDependency> _stream_dependency;
+};
+
+} // namespace
 
 SaveBlockDataTask::SaveBlockDataTask(
 		VolumeID p_volume_id,
@@ -33,6 +64,10 @@ SaveBlockDataTask::SaveBlockDataTask(
 		_tracker(p_tracker) {
 	//
 	++g_debug_save_block_tasks_count;
+
+	ZN_ASSERT(_stream_dependency != nullptr);
+	_stream_dependency->save_queue->add_pending_task();
+	_pending_in_save_queue = true;
 }
 
 SaveBlockDataTask::SaveBlockDataTask(
@@ -59,6 +94,16 @@ SaveBlockDataTask::SaveBlockDataTask(
 
 SaveBlockDataTask::~SaveBlockDataTask() {
 	--g_debug_save_block_tasks_count;
+
+	if (_pending_in_save_queue) {
+		// Should not happen since save tasks are never cancelled, but if it does, don't leave anything unsaved
+		SaveBlockQueue &save_queue = *_stream_dependency->save_queue;
+		if (save_queue.remove_pending_task()) {
+			Ref<VoxelStream> stream = _stream_dependency->stream;
+			ZN_ASSERT_RETURN(stream.is_valid());
+			save_queue.flush(**stream);
+		}
+	}
 }
 
 int SaveBlockDataTask::debug_get_running_count() {
@@ -72,43 +117,74 @@ void SaveBlockDataTask::run(zylann::ThreadedTaskContext &ctx) {
 	Ref<VoxelStream> stream = _stream_dependency->stream;
 	ZN_ASSERT_RETURN_MSG(stream.is_valid(), "Save task was triggered without a stream, this is a bug");
 
+	// Instances are saved first, so they are written by the time the tracker completes from the save queue
+	if (_save_instances && stream->supports_instance_blocks()) {
+		// If the provided data is null, it means this instance block was never modified.
+		// Since we are in a save request, the saved data will revert to unmodified.
+		// On the other hand, if we want to represent the fact that "everything was deleted here",
+		// this should not be null.
+
+		ZN_PRINT_VERBOSE(format(
+				"Saving instance block {} lod {} with data {}", _position, static_cast<int>(_lod), _instances.get()
+		));
+
+		VoxelStream::InstancesQueryData instances_query{
+			std::move(_instances), _position, _lod, VoxelStream::RESULT_ERROR
+		};
+		stream->save_instance_blocks(Span<VoxelStream::InstancesQueryData>(&instances_query, 1));
+	}
+
 	if (_save_voxels) {
+		SaveBlockQueue &save_queue = *_stream_dependency->save_queue;
+		_pending_in_save_queue = false;
+
 		if (_voxels == nullptr) {
 			if (_tracker != nullptr) {
 				_tracker->abort();
 			}
 			ZN_PRINT_ERROR("Voxels to save shouldn't be null");
+			if (save_queue.remove_pending_task()) {
+				save_queue.flush(**stream);
+			}
 			return;
 		}
 
-		VoxelBuffer voxels_copy(VoxelBuffer::ALLOCATOR_POOL);
+		std::shared_ptr<VoxelBuffer> voxels_copy = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
 		// Note, we are not locking voxels here. This is supposed to be done at the time this task is scheduled.
 		// If this is not a copy, it means the map it came from is getting unloaded anyways.
 		// TODO Optimization: is that copy necessary? It's possible it was already done while issuing the
 		// request
-		_voxels->copy_to(voxels_copy, true);
+		_voxels->copy_to(*voxels_copy, true);
 		_voxels = nullptr;
-		VoxelStream::VoxelQueryData q{ voxels_copy, _position, _lod, VoxelStream::RESULT_ERROR };
-		stream->save_voxel_block(q);
-	}
 
-	if (_save_instances && stream->supports_instance_blocks()) {
-		// If the provided data is null, it means this instance block was never modified.
-		// Since we are in a save request, the saved data will revert to unmodified.
-		// On the other hand, if we want to represent the fact that "everything was deleted here",
-		// this should not be null.
+		// Compressing is the expensive part of saving. It is done here, so the task writing the queue only has to
+		// access files. If the stream can't store compressed blocks, it compresses them when they get written.
+		StdVector<uint8_t> compressed_voxels;
+		if (stream->supports_compressed_voxel_blocks() &&
+			!stream->compress_voxel_block(*voxels_copy, compressed_voxels)) {
+			ZN_PRINT_ERROR(format("Failed to compress block {} lod {}", _position, static_cast<int>(_lod)));
+			compressed_voxels.clear();
+		}
 
-		ZN_PRINT_VERBOSE(format(
-				"Saving instance block {} lod {} with data {}", _position, static_cast<int>(_lod), _instances.get()
-		));
+		// Rather than writing right away, blocks are queued so repeated saves of the same block get written once, and
+		// in batches. The tracker gets completed when the block is actually written.
+		const SaveBlockQueue::PushResult res = save_queue.push(
+				_position, _lod, voxels_copy, std::move(compressed_voxels), _tracker, _flush_on_last_tracked_task
+		);
 
-		VoxelStream::InstancesQueryData instances_query{
-			std::move(_instances), _position, _lod, VoxelStream::RESULT_ERROR
-		};
-		stream->save_instance_blocks(Span<VoxelStream::InstancesQueryData>(&instances_query, 1));
+		VoxelEngine &engine = VoxelEngine::get_singleton();
+
+		if (res.pending_task_count == 0 || // No other task is coming to write the queue later
+			res.block_count >= engine.get_save_queue_max_blocks() || // Don't let the queue grow too large
+			res.oldest_age_msec >= engine.get_save_queue_flush_interval_msec()) {
+			if (save_queue.request_flush()) {
+				engine.push_async_io_task(ZN_NEW(FlushSaveBlockQueueTask(_stream_dependency)));
+			}
+		}
 	}
 
-	if (_tracker != nullptr) {
+	// Saved voxels are tracked by the save queue
+	if (_tracker != nullptr && !_save_voxels) {
 		if (_flush_on_last_tracked_task && _tracker->get_remaining_count() == 1) {
 			// This was the last task in a tracked group of saving tasks, we may flush now
 			stream->flush();
@@ -126,6 +202,10 @@ TaskPriority SaveBlockDataTask::get_priority() {
 	return p;
 }
 
+int SaveBlockDataTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(_volume_id);
+}
+
 bool SaveBlockDataTask::is_cancelled() {
 	return false;
 }
@@ -1,6 +1,7 @@
 #ifndef SAVE_BLOCK_DATA_TASK_H
 #define SAVE_BLOCK_DATA_TASK_H
 
+#include "../constants/voxel_constants.h"
 #include "../engine/ids.h"
 #include "../engine/streaming_dependency.h"
 #include "../util/memory/memory.h"
@@ -12,6 +13,9 @@ class AsyncDependencyTracker;
 
 namespace voxel {
 
+// Saving voxels doesn't access files: voxels are compressed and queued in the `SaveBlockQueue` of the stream, which
+// gets written by a separate I/O task. So these tasks should be scheduled on the general pool. Saving instances
+// accesses files, so these must be scheduled as I/O tasks.
 class SaveBlockDataTask : public IThreadedTask {
 public:
 	// For saving voxels only
@@ -42,9 +46,14 @@ public:
 		return "SaveBlockData";
 	}
 
+	int get_latency_category() const override {
+		return constants::TASK_LATENCY_SAVE;
+	}
+
 	void run(ThreadedTaskContext &ctx) override;
 	TaskPriority get_priority() override;
 	bool is_cancelled() override;
+	int get_group() const override;
 	void apply_result() override;
 
 	static int debug_get_running_count();
@@ -59,6 +68,8 @@ private:
 	bool _save_instances = false;
 	bool _save_voxels = false;
 	bool _flush_on_last_tracked_task = false;
+	// True while the task is counted as pending in the save queue
+	bool _pending_in_save_queue = false;
 	std::shared_ptr<StreamingDependency> _stream_dependency;
 	// Optional tracking, can be null
 	std::shared_ptr<AsyncDependencyTracker> _tracker;
@@ -0,0 +1,192 @@
+#include "save_block_queue.h"
+#include "../util/errors.h"
+#include "../util/godot/classes/time.h"
+#include "../util/profiling.h"
+#include "../util/tasks/async_dependency_tracker.h"
+#include "voxel_stream.h"
+
+namespace zylann::voxel {
+
+void SaveBlockQueue::add_pending_task() {
+	MutexLock lock(_mutex);
+	++_pending_task_count;
+}
+
+bool SaveBlockQueue::remove_pending_task() {
+	MutexLock lock(_mutex);
+	ZN_ASSERT_RETURN_V(_pending_task_count > 0, false);
+	--_pending_task_count;
+	return _pending_task_count == 0 && _block_count > 0;
+}
+
+SaveBlockQueue::PushResult SaveBlockQueue::push(
+		Vector3i position,
+		uint8_t lod_index,
+		std::shared_ptr<VoxelBuffer> voxels,
+		StdVector<uint8_t> &&compressed_voxels,
+		std::shared_ptr<AsyncDependencyTracker> tracker,
+		bool flush_stream_on_last_tracked_task
+) {
+	ZN_ASSERT(lod_index < _lods.size());
+	ZN_ASSERT(voxels != nullptr);
+
+	const uint64_t now = Time::get_singleton()->get_ticks_msec();
+
+	MutexLock lock(_mutex);
+
+	Block &block = _lods[lod_index][position];
+	if (block.voxels == nullptr) {
+		if (_block_count == 0) {
+			_oldest_push_time_msec = now;
+		}
+		++_block_count;
+	}
+	// Older data is replaced, it no longer needs to be written
+	block.voxels = voxels;
+	block.compressed_voxels = std::move(compressed_voxels);
+	if (tracker != nullptr) {
+		block.trackers.push_back(TrackerRef{ tracker, flush_stream_on_last_tracked_task });
+	}
+
+	ZN_ASSERT(_pending_task_count > 0);
+	--_pending_task_count;
+
+	PushResult res;
+	res.block_count = _block_count;
+	res.pending_task_count = _pending_task_count;
+	res.oldest_age_msec = now - _oldest_push_time_msec;
+	return res;
+}
+
+bool SaveBlockQueue::request_flush() {
+	MutexLock lock(_mutex);
+	if (_flush_requested) {
+		return false;
+	}
+	_flush_requested = true;
+	return true;
+}
+
+bool SaveBlockQueue::load_voxel_block(Vector3i position, uint8_t lod_index, VoxelBuffer &out_voxels) const {
+	ZN_ASSERT_RETURN_V(lod_index < _lods.size(), false);
+
+	MutexLock lock(_mutex);
+
+	const StdUnorderedMap<Vector3i, Block> &blocks = _lods[lod_index];
+	auto it = blocks.find(position);
+	if (it != blocks.end()) {
+		it->second.voxels->copy_to(out_voxels, true);
+		return true;
+	}
+
+	for (const FlushingBlock &fb : _flushing_blocks) {
+		if (fb.position == position && fb.lod_index == lod_index) {
+			fb.block.voxels->copy_to(out_voxels, true);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void SaveBlockQueue::flush(VoxelStream &stream) {
+	ZN_PROFILE_SCOPE();
+
+	MutexLock flush_lock(_flush_mutex);
+
+	// Streams may take ownership of the buffers they save, so they are given copies. Copies are cheap because voxel
+	// data is shared until modified.
+	StdVector<VoxelBuffer> voxels_to_save;
+	StdVector<unsigned int> voxels_to_save_indices;
+	StdVector<VoxelStream::CompressedVoxelQueryData> compressed_queries;
+
+	{
+		MutexLock lock(_mutex);
+		// Blocks pushed from now on will need another flush
+		_flush_requested = false;
+
+		if (_block_count == 0) {
+			return;
+		}
+
+		_flushing_blocks.reserve(_block_count);
+		for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+			StdUnorderedMap<Vector3i, Block> &blocks = _lods[lod_index];
+			for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+				_flushing_blocks.push_back(FlushingBlock{ it->first, static_cast<uint8_t>(lod_index), it->second });
+			}
+			blocks.clear();
+		}
+		_block_count = 0;
+
+		for (unsigned int i = 0; i < _flushing_blocks.size(); ++i) {
+			FlushingBlock &fb = _flushing_blocks[i];
+			if (fb.block.compressed_voxels.size() > 0) {
+				// Only loads need the buffer of flushing blocks, so the compressed data can be moved out
+				compressed_queries.push_back(VoxelStream::CompressedVoxelQueryData{
+						std::move(fb.block.compressed_voxels), fb.position, fb.lod_index, VoxelStream::RESULT_ERROR });
+			} else {
+				voxels_to_save.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+				fb.block.voxels->copy_to(voxels_to_save.back(), true);
+				voxels_to_save_indices.push_back(i);
+			}
+		}
+	}
+
+	if (compressed_queries.size() > 0) {
+		stream.save_compressed_voxel_blocks(to_span(compressed_queries));
+	}
+
+	if (voxels_to_save.size() > 0) {
+		StdVector<VoxelStream::VoxelQueryData> queries;
+		queries.reserve(voxels_to_save.size());
+		for (unsigned int i = 0; i < voxels_to_save.size(); ++i) {
+			const FlushingBlock &fb = _flushing_blocks[voxels_to_save_indices[i]];
+			queries.push_back(VoxelStream::VoxelQueryData{
+					voxels_to_save[i], fb.position, fb.lod_index, VoxelStream::RESULT_ERROR });
+		}
+		stream.save_voxel_blocks(to_span(queries));
+	}
+
+	// Count how many of the saves tracked by each tracker were just written, so we can tell if they were the last
+	StdUnorderedMap<AsyncDependencyTracker *, int> completed_counts;
+	for (const FlushingBlock &fb : _flushing_blocks) {
+		for (const TrackerRef &tr : fb.block.trackers) {
+			++completed_counts[tr.tracker.get()];
+		}
+	}
+
+	bool flush_stream = false;
+	for (const FlushingBlock &fb : _flushing_blocks) {
+		for (const TrackerRef &tr : fb.block.trackers) {
+			if (tr.flush_stream_on_last_tracked_task &&
+				tr.tracker->get_remaining_count() == completed_counts[tr.tracker.get()]) {
+				// These were the last tasks in a tracked group of saving tasks, we may flush now
+				flush_stream = true;
+			}
+		}
+	}
+	if (flush_stream) {
+		stream.flush();
+	}
+
+	// Take blocks out before completing trackers, so the saved data can't be seen as still pending
+	StdVector<FlushingBlock> flushed_blocks;
+	{
+		MutexLock lock(_mutex);
+		flushed_blocks.swap(_flushing_blocks);
+	}
+
+	for (const FlushingBlock &fb : flushed_blocks) {
+		for (const TrackerRef &tr : fb.block.trackers) {
+			tr.tracker->post_complete();
+		}
+	}
+}
+
+unsigned int SaveBlockQueue::get_block_count() const {
+	MutexLock lock(_mutex);
+	return _block_count;
+}
+
+} // namespace zylann::voxel
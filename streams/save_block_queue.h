@@ -0,0 +1,104 @@
+#ifndef VOXEL_SAVE_BLOCK_QUEUE_H
+#define VOXEL_SAVE_BLOCK_QUEUE_H
+
+#include "../constants/voxel_constants.h"
+#include "../storage/voxel_buffer.h"
+#include "../util/containers/fixed_array.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/containers/std_vector.h"
+#include "../util/thread/mutex.h"
+#include <memory>
+
+namespace zylann {
+
+class AsyncDependencyTracker;
+
+namespace voxel {
+
+class VoxelStream;
+
+// Write-behind stage for voxel blocks saved by `SaveBlockDataTask`.
+// Saves of the same block are coalesced, so only the most recent data gets written, and pending blocks are written
+// together in a single `save_voxel_blocks` call. Blocks are written once no more save tasks are pending, when the
+// oldest one has waited long enough, or when too many are queued.
+// If the stream supports compressed blocks, they are compressed before being queued, so writing them only has to
+// access files.
+// Shared by tasks using the same stream. Thread-safe.
+class SaveBlockQueue {
+public:
+	struct PushResult {
+		unsigned int block_count;
+		// How many save tasks have been scheduled and not run yet
+		unsigned int pending_task_count;
+		// How long the oldest block in the queue has been waiting
+		uint64_t oldest_age_msec;
+	};
+
+	// Must be called when a task that will push to the queue is created, so the queue knows more blocks are coming.
+	void add_pending_task();
+
+	// Must be called if a task that was counted with `add_pending_task` gets destroyed without pushing.
+	// Returns true if it was the last pending task and blocks remain to be written.
+	bool remove_pending_task();
+
+	// Queues voxels to be saved, replacing previously queued voxels at the same location. The queue takes ownership of
+	// the buffer. `compressed_voxels` may contain the same voxels compressed with `VoxelStream::compress_voxel_block`,
+	// or be empty. The tracker will be completed once the block is written. Also removes one pending task.
+	PushResult push(
+			Vector3i position,
+			uint8_t lod_index,
+			std::shared_ptr<VoxelBuffer> voxels,
+			StdVector<uint8_t> &&compressed_voxels,
+			std::shared_ptr<AsyncDependencyTracker> tracker,
+			bool flush_stream_on_last_tracked_task
+	);
+
+	// Returns true if no flush was requested since the last one started, in which case the caller must schedule a task
+	// calling `flush`. Used to write blocks on the I/O thread without scheduling more tasks than needed.
+	bool request_flush();
+
+	// If the block is waiting to be written, copies it into the provided buffer and returns true.
+	// Must be checked before loading from the stream, which could otherwise return older data.
+	bool load_voxel_block(Vector3i position, uint8_t lod_index, VoxelBuffer &out_voxels) const;
+
+	// Writes all queued blocks to the stream in one batch.
+	void flush(VoxelStream &stream);
+
+	unsigned int get_block_count() const;
+
+private:
+	struct TrackerRef {
+		std::shared_ptr<AsyncDependencyTracker> tracker;
+		bool flush_stream_on_last_tracked_task;
+	};
+
+	struct Block {
+		std::shared_ptr<VoxelBuffer> voxels;
+		// Same voxels compressed by the stream, or empty if the stream has to compress them itself
+		StdVector<uint8_t> compressed_voxels;
+		// Trackers of every save coalesced into this block
+		StdVector<TrackerRef> trackers;
+	};
+
+	struct FlushingBlock {
+		Vector3i position;
+		uint8_t lod_index;
+		Block block;
+	};
+
+	FixedArray<StdUnorderedMap<Vector3i, Block>, constants::MAX_LOD> _lods;
+	// Blocks being written. They can still be loaded from here until writing is complete.
+	StdVector<FlushingBlock> _flushing_blocks;
+	unsigned int _block_count = 0;
+	unsigned int _pending_task_count = 0;
+	uint64_t _oldest_push_time_msec = 0;
+	bool _flush_requested = false;
+	Mutex _mutex;
+	// Held while writing, so blocks get written in the order they were queued
+	Mutex _flush_mutex;
+};
+
+} // namespace voxel
+} // namespace zylann
+
+#endif // VOXEL_SAVE_BLOCK_QUEUE_H
@@ -0,0 +1,181 @@
+#include "block_key_index.h"
+#include "../../util/errors.h"
+#include "../../util/io/serialization.h"
+
+namespace zylann::voxel::sqlite {
+
+namespace {
+
+static const uint8_t BLOCK_KEY_INDEX_FORMAT_VERSION = 1;
+
+inline uint64_t get_bit_in_chunk(Vector3i bpos) {
+	const Vector3i rpos = bpos & (BlockKeyIndex::CHUNK_SIZE - 1);
+	const unsigned int bit_index = rpos.x | (rpos.y << BlockKeyIndex::CHUNK_SIZE_PO2) |
+			(rpos.z << (2 * BlockKeyIndex::CHUNK_SIZE_PO2));
+	return uint64_t(1) << bit_index;
+}
+
+} // namespace
+
+bool BlockKeyIndex::contains(Vector3i bpos, unsigned int lod_index) const {
+	ZN_ASSERT_RETURN_V(lod_index < _lods.size(), false);
+	const StdUnorderedMap<Vector3i, uint64_t> &chunks = _lods[lod_index];
+	RWLockRead rlock(_rw_lock);
+	auto it = chunks.find(bpos >> CHUNK_SIZE_PO2);
+	if (it == chunks.end()) {
+		return false;
+	}
+	return (it->second & get_bit_in_chunk(bpos)) != 0;
+}
+
+bool BlockKeyIndex::contains_any(Box3i box, unsigned int lod_index) const {
+	ZN_ASSERT_RETURN_V(lod_index < _lods.size(), false);
+	if (Vector3iUtil::is_empty_size(box.size)) {
+		return false;
+	}
+	const StdUnorderedMap<Vector3i, uint64_t> &chunks = _lods[lod_index];
+	const Box3i chunks_box = box.downscaled(CHUNK_SIZE);
+
+	RWLockRead rlock(_rw_lock);
+
+	// Assuming boxes are not much larger than chunks, otherwise iterating the map would be faster
+	Vector3i cpos;
+	for (cpos.z = chunks_box.position.z; cpos.z < chunks_box.position.z + chunks_box.size.z; ++cpos.z) {
+		for (cpos.x = chunks_box.position.x; cpos.x < chunks_box.position.x + chunks_box.size.x; ++cpos.x) {
+			for (cpos.y = chunks_box.position.y; cpos.y < chunks_box.position.y + chunks_box.size.y; ++cpos.y) {
+				auto it = chunks.find(cpos);
+				if (it == chunks.end()) {
+					continue;
+				}
+				const uint64_t bits = it->second;
+				const Box3i chunk_box(cpos << CHUNK_SIZE_PO2, Vector3iUtil::create(CHUNK_SIZE));
+				const Box3i box_in_chunk = box.clipped(chunk_box);
+				const Vector3i max_pos = box_in_chunk.position + box_in_chunk.size;
+
+				Vector3i bpos;
+				for (bpos.z = box_in_chunk.position.z; bpos.z < max_pos.z; ++bpos.z) {
+					for (bpos.x = box_in_chunk.position.x; bpos.x < max_pos.x; ++bpos.x) {
+						for (bpos.y = box_in_chunk.position.y; bpos.y < max_pos.y; ++bpos.y) {
+							if ((bits & get_bit_in_chunk(bpos)) != 0) {
+								return true;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void BlockKeyIndex::add(Vector3i bpos, unsigned int lod_index) {
+	RWLockWrite wlock(_rw_lock);
+	add_no_lock(bpos, lod_index);
+}
+
+void BlockKeyIndex::add_no_lock(Vector3i bpos, unsigned int lod_index) {
+	ZN_ASSERT_RETURN(lod_index < _lods.size());
+	uint64_t &bits = _lods[lod_index][bpos >> CHUNK_SIZE_PO2];
+	const uint64_t bit = get_bit_in_chunk(bpos);
+	if ((bits & bit) == 0) {
+		bits |= bit;
+		++_block_count;
+	}
+}
+
+void BlockKeyIndex::clear() {
+	RWLockWrite wlock(_rw_lock);
+	clear_no_lock();
+}
+
+void BlockKeyIndex::clear_no_lock() {
+	for (unsigned int i = 0; i < _lods.size(); ++i) {
+		_lods[i].clear();
+	}
+	_block_count = 0;
+}
+
+uint64_t BlockKeyIndex::get_block_count() const {
+	RWLockRead rlock(_rw_lock);
+	return _block_count;
+}
+
+size_t BlockKeyIndex::get_chunk_count() const {
+	RWLockRead rlock(_rw_lock);
+	size_t count = 0;
+	for (unsigned int i = 0; i < _lods.size(); ++i) {
+		count += _lods[i].size();
+	}
+	return count;
+}
+
+void BlockKeyIndex::serialize(StdVector<uint8_t> &dst) const {
+	RWLockRead rlock(_rw_lock);
+
+	dst.clear();
+	MemoryWriter w(dst, ENDIANNESS_LITTLE_ENDIAN);
+
+	w.store_8(BLOCK_KEY_INDEX_FORMAT_VERSION);
+	w.store_64(_block_count);
+	w.store_8(_lods.size());
+
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		const StdUnorderedMap<Vector3i, uint64_t> &chunks = _lods[lod_index];
+		w.store_32(chunks.size());
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			w.store_32(it->first.x);
+			w.store_32(it->first.y);
+			w.store_32(it->first.z);
+			w.store_64(it->second);
+		}
+	}
+}
+
+bool BlockKeyIndex::deserialize(Span<const uint8_t> src) {
+	clear();
+
+	// Version + block count + LOD count
+	static const size_t HEADER_SIZE = 1 + 8 + 1;
+	// Position + bits
+	static const size_t CHUNK_DATA_SIZE = 3 * 4 + 8;
+
+	ZN_ASSERT_RETURN_V(src.size() >= HEADER_SIZE, false);
+	MemoryReader r(src, ENDIANNESS_LITTLE_ENDIAN);
+
+	const uint8_t version = r.get_8();
+	ZN_ASSERT_RETURN_V(version == BLOCK_KEY_INDEX_FORMAT_VERSION, false);
+	const uint64_t block_count = r.get_64();
+	const unsigned int lod_count = r.get_8();
+	ZN_ASSERT_RETURN_V(lod_count <= _lods.size(), false);
+
+	RWLockWrite wlock(_rw_lock);
+
+	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+		if (r.pos + 4 > src.size()) {
+			ZN_PRINT_ERROR("Unexpected end of data");
+			clear_no_lock();
+			return false;
+		}
+		const uint32_t chunk_count = r.get_32();
+		if (r.pos + uint64_t(chunk_count) * CHUNK_DATA_SIZE > src.size()) {
+			ZN_PRINT_ERROR("Unexpected end of data");
+			clear_no_lock();
+			return false;
+		}
+		StdUnorderedMap<Vector3i, uint64_t> &chunks = _lods[lod_index];
+		chunks.reserve(chunk_count);
+		for (uint32_t i = 0; i < chunk_count; ++i) {
+			Vector3i cpos;
+			cpos.x = static_cast<int32_t>(r.get_32());
+			cpos.y = static_cast<int32_t>(r.get_32());
+			cpos.z = static_cast<int32_t>(r.get_32());
+			chunks[cpos] = r.get_64();
+		}
+	}
+
+	_block_count = block_count;
+	return true;
+}
+
+} // namespace zylann::voxel::sqlite
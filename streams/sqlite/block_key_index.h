@@ -0,0 +1,57 @@
+#ifndef VOXEL_STREAM_SQLITE_BLOCK_KEY_INDEX_H
+#define VOXEL_STREAM_SQLITE_BLOCK_KEY_INDEX_H
+
+#include "../../constants/voxel_constants.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/span.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/box3i.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/rw_lock.h"
+
+namespace zylann::voxel::sqlite {
+
+// Set of block positions present in a database, used to quickly tell if a block exists without querying it.
+// Positions are grouped in chunks of 4x4x4 blocks, each stored as a 64-bit mask. That is much more compact than
+// storing every position once many blocks are saved next to each other, which happens when terrains save everything
+// they generate.
+// Thread-safe, unless using functions suffixed with `_no_lock`.
+class BlockKeyIndex {
+public:
+	static constexpr unsigned int CHUNK_SIZE_PO2 = 2;
+	static constexpr unsigned int CHUNK_SIZE = 1 << CHUNK_SIZE_PO2;
+
+	bool contains(Vector3i bpos, unsigned int lod_index) const;
+	// Tells if at least one block of the box is present
+	bool contains_any(Box3i box, unsigned int lod_index) const;
+
+	void add(Vector3i bpos, unsigned int lod_index);
+	void add_no_lock(Vector3i bpos, unsigned int lod_index);
+
+	void clear();
+
+	// Number of block positions in the index
+	uint64_t get_block_count() const;
+	size_t get_chunk_count() const;
+
+	void serialize(StdVector<uint8_t> &dst) const;
+	// Replaces contents of the index. Returns false if the data is invalid, in which case the index is left empty.
+	bool deserialize(Span<const uint8_t> src);
+
+	// Should be held when using `_no_lock` functions
+	RWLock &get_lock() {
+		return _rw_lock;
+	}
+
+private:
+	void clear_no_lock();
+
+	FixedArray<StdUnorderedMap<Vector3i, uint64_t>, constants::MAX_LOD> _lods;
+	uint64_t _block_count = 0;
+	mutable RWLock _rw_lock;
+};
+
+} // namespace zylann::voxel::sqlite
+
+#endif // VOXEL_STREAM_SQLITE_BLOCK_KEY_INDEX_H
@@ -28,6 +28,20 @@ inline CoordinateColumnType get_coordinate_column_type(BlockLocation::Coordinate
 	}
 }
 
+const char *get_coordinate_column_sql_type(CoordinateColumnType type) {
+	switch (type) {
+		case COORDINATE_COLUMN_U64:
+			return "INTEGER";
+		case COORDINATE_COLUMN_STRING:
+			return "TEXT";
+		case COORDINATE_COLUMN_BLOB:
+			return "BLOB";
+		default:
+			ZN_CRASH_MSG("Invalid column type");
+			return "";
+	}
+}
+
 struct BindBlockCoordinates {
 	BlockLocationBuffer buffer;
 	CoordinateColumnType key_column_type;
@@ -172,6 +186,27 @@ static void finalize(sqlite3_stmt *&s) {
 	}
 }
 
+// Keys must use the same column type as the `blocks` table, which depends on the coordinate format of the database
+bool create_blocks_table(
+		sqlite3 *db,
+		const char *table_name,
+		const BlockLocation::CoordinateFormat coordinate_format
+) {
+	const StdString sql = format(
+			"CREATE TABLE IF NOT EXISTS {} (loc {} PRIMARY KEY, data BLOB)",
+			table_name,
+			get_coordinate_column_sql_type(get_coordinate_column_type(coordinate_format))
+	);
+	char *error_message = nullptr;
+	const int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error_message);
+	if (rc != SQLITE_OK) {
+		ZN_PRINT_ERROR(format("Failed to create table: {}", error_message));
+		sqlite3_free(error_message);
+		return false;
+	}
+	return true;
+}
+
 } // namespace
 
 Connection::Connection() {}
@@ -180,7 +215,11 @@ Connection::~Connection() {
 	close();
 }
 
-bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat preferred_coordinate_format) {
+bool Connection::open(
+		const char *fpath,
+		const BlockLocation::CoordinateFormat preferred_coordinate_format,
+		const bool wal_enabled
+) {
 	ZN_PROFILE_SCOPE();
 	close();
 
@@ -197,29 +236,48 @@ bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat p
 	sqlite3 *db = _db;
 	char *error_message = nullptr;
 
+	if (wal_enabled) {
+		// https://www.sqlite.org/wal.html
+		// The journal mode is persistent, so this only has an effect the first time.
+		// With WAL, `synchronous=NORMAL` only syncs on checkpoints. Transactions remain atomic and durable across
+		// application crashes, but the last ones could be rolled back after a power loss.
+		rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL", nullptr, nullptr, &error_message);
+		if (rc != SQLITE_OK) {
+			ZN_PRINT_ERROR(format("Failed to enable WAL mode: {}", error_message));
+			sqlite3_free(error_message);
+			close();
+			return false;
+		}
+		// Only one connection can write at a time, others wait their turn instead of failing
+		sqlite3_busy_timeout(db, BUSY_TIMEOUT_MSEC);
+	}
+
 	const CoordinateColumnType block_key_column_type = get_coordinate_column_type(preferred_coordinate_format);
 
 	// Create tables if they don't exist.
-	const char *tables[3] = {
+	const char *tables[5] = {
 		"CREATE TABLE IF NOT EXISTS meta (version INTEGER, block_size_po2 INTEGER, coordinate_format INTEGER)",
 		"",
-		"CREATE TABLE IF NOT EXISTS channels (idx INTEGER PRIMARY KEY, depth INTEGER)"
+		"CREATE TABLE IF NOT EXISTS channels (idx INTEGER PRIMARY KEY, depth INTEGER)",
+		// Optional, so they don't require a new version of the schema
+		"CREATE TABLE IF NOT EXISTS zstd_dictionaries (idx INTEGER PRIMARY KEY, data BLOB)",
+		"CREATE TABLE IF NOT EXISTS block_key_index (idx INTEGER PRIMARY KEY, data BLOB)"
 	};
 	switch (block_key_column_type) {
 		case COORDINATE_COLUMN_U64:
-			tables[1] = "CREATE TABLE IF NOT EXISTS blocks (loc INTEGER PRIMARY KEY, vb BLOB, instances BLOB)";
+			tables[1] = "CREATE TABLE IF NOT EXISTS blocks (loc INTEGER PRIMARY KEY, vb BLOB)";
 			break;
 		case COORDINATE_COLUMN_STRING:
-			tables[1] = "CREATE TABLE IF NOT EXISTS blocks (loc TEXT PRIMARY KEY, vb BLOB, instances BLOB)";
+			tables[1] = "CREATE TABLE IF NOT EXISTS blocks (loc TEXT PRIMARY KEY, vb BLOB)";
 			break;
 		case COORDINATE_COLUMN_BLOB:
-			tables[1] = "CREATE TABLE IF NOT EXISTS blocks (loc BLOB PRIMARY KEY, vb BLOB, instances BLOB)";
+			tables[1] = "CREATE TABLE IF NOT EXISTS blocks (loc BLOB PRIMARY KEY, vb BLOB)";
 			break;
 		default:
 			ZN_CRASH_MSG("Invalid column type");
 			break;
 	}
-	for (size_t i = 0; i < 3; ++i) {
+	for (size_t i = 0; i < 5; ++i) {
 		rc = sqlite3_exec(db, tables[i], nullptr, nullptr, &error_message);
 		if (rc != SQLITE_OK) {
 			ZN_PRINT_ERROR(format("Failed to create table: {}", error_message));
@@ -242,7 +300,8 @@ bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat p
 	if (!prepare(
 				db,
 				&_update_voxel_block_statement,
-				"INSERT INTO blocks VALUES (:loc, :vb, null) "
+				// Columns are named, because databases older than version 2 also have an `instances` column
+				"INSERT INTO blocks (loc, vb) VALUES (:loc, :vb) "
 				"ON CONFLICT(loc) DO UPDATE SET vb=excluded.vb"
 		)) {
 		return false;
@@ -250,17 +309,6 @@ bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat p
 	if (!prepare(db, &_get_voxel_block_statement, "SELECT vb FROM blocks WHERE loc=:loc")) {
 		return false;
 	}
-	if (!prepare(
-				db,
-				&_update_instance_block_statement,
-				"INSERT INTO blocks VALUES (:loc, null, :instances) "
-				"ON CONFLICT(loc) DO UPDATE SET instances=excluded.instances"
-		)) {
-		return false;
-	}
-	if (!prepare(db, &_get_instance_block_statement, "SELECT instances FROM blocks WHERE loc=:loc")) {
-		return false;
-	}
 	if (!prepare(db, &_begin_statement, "BEGIN")) {
 		return false;
 	}
@@ -275,7 +323,7 @@ bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat p
 		if (!prepare(db, &_save_meta_statement, "INSERT INTO meta VALUES (:version, :block_size_po2)")) {
 			return false;
 		}
-	} else if (version == VERSION_LATEST) {
+	} else if (version == VERSION_V1 || version == VERSION_V2) {
 		if (!prepare(
 					db, &_save_meta_statement, "INSERT INTO meta VALUES (:version, :block_size_po2, :coordinate_format)"
 			)) {
@@ -297,10 +345,44 @@ bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat p
 		)) {
 		return false;
 	}
-	if (!prepare(db, &_load_all_blocks_statement, "SELECT * FROM blocks")) {
+	if (!prepare(db, &_load_all_voxel_blocks_statement, "SELECT loc, vb FROM blocks WHERE vb IS NOT NULL")) {
+		return false;
+	}
+	if (!prepare(db, &_load_all_voxel_block_keys_statement, "SELECT loc FROM blocks")) {
+		return false;
+	}
+	if (!prepare(
+				db,
+				&_load_voxel_blocks_in_key_range_statement,
+				"SELECT loc, vb FROM blocks WHERE loc BETWEEN :min_loc AND :max_loc AND vb IS NOT NULL"
+		)) {
+		return false;
+	}
+	if (!prepare(
+				db,
+				&_load_random_voxel_blocks_statement,
+				"SELECT vb FROM blocks WHERE vb IS NOT NULL ORDER BY RANDOM() LIMIT :count"
+		)) {
+		return false;
+	}
+	if (!prepare(db, &_load_zstd_dictionaries_statement, "SELECT data FROM zstd_dictionaries ORDER BY idx")) {
+		return false;
+	}
+	if (!prepare(db, &_save_zstd_dictionary_statement, "INSERT INTO zstd_dictionaries (data) VALUES (:data)")) {
+		return false;
+	}
+	if (!prepare(db, &_load_block_key_index_statement, "SELECT data FROM block_key_index WHERE idx=0")) {
+		return false;
+	}
+	if (!prepare(
+				db,
+				&_save_block_key_index_statement,
+				"INSERT INTO block_key_index VALUES (0, :data) "
+				"ON CONFLICT(idx) DO UPDATE SET data=excluded.data"
+		)) {
 		return false;
 	}
-	if (!prepare(db, &_load_all_block_keys_statement, "SELECT loc FROM blocks")) {
+	if (!prepare(db, &_get_block_count_statement, "SELECT COUNT(*) FROM blocks")) {
 		return false;
 	}
 
@@ -341,6 +423,32 @@ bool Connection::open(const char *fpath, const BlockLocation::CoordinateFormat p
 		}
 	}
 
+	// Instance blocks are prepared last, because their table depends on the coordinate format of the database
+	if (meta.version >= VERSION_V2 && !create_blocks_table(db, "instance_blocks", meta.coordinate_format)) {
+		close();
+		return false;
+	}
+	if (!prepare_instance_block_statements(meta.version)) {
+		return false;
+	}
+
+	// Optional, so it doesn't require a new version of the schema
+	if (!create_blocks_table(db, "mesh_blocks", meta.coordinate_format)) {
+		close();
+		return false;
+	}
+	if (!prepare(
+				db,
+				&_update_mesh_block_statement,
+				"INSERT INTO mesh_blocks VALUES (:loc, :data) "
+				"ON CONFLICT(loc) DO UPDATE SET data=excluded.data"
+		)) {
+		return false;
+	}
+	if (!prepare(db, &_get_mesh_block_statement, "SELECT data FROM mesh_blocks WHERE loc=:loc")) {
+		return false;
+	}
+
 	_meta = meta;
 	_opened_path = fpath;
 	return true;
@@ -355,19 +463,92 @@ void Connection::close() {
 	finalize(_load_version_statement);
 	finalize(_update_voxel_block_statement);
 	finalize(_get_voxel_block_statement);
-	finalize(_update_instance_block_statement);
-	finalize(_get_instance_block_statement);
+	finalize_instance_block_statements();
+	finalize(_update_mesh_block_statement);
+	finalize(_get_mesh_block_statement);
 	finalize(_load_meta_statement);
 	finalize(_save_meta_statement);
 	finalize(_load_channels_statement);
 	finalize(_save_channel_statement);
-	finalize(_load_all_blocks_statement);
-	finalize(_load_all_block_keys_statement);
+	finalize(_load_all_voxel_blocks_statement);
+	finalize(_load_all_voxel_block_keys_statement);
+	finalize(_load_voxel_blocks_in_key_range_statement);
+	finalize(_load_random_voxel_blocks_statement);
+	finalize(_load_zstd_dictionaries_statement);
+	finalize(_save_zstd_dictionary_statement);
+	finalize(_load_block_key_index_statement);
+	finalize(_save_block_key_index_statement);
+	finalize(_get_block_count_statement);
 	sqlite3_close(_db);
 	_db = nullptr;
 	_opened_path.clear();
 }
 
+bool Connection::prepare_instance_block_statements(const int version) {
+	sqlite3 *db = _db;
+
+	if (version >= VERSION_V2) {
+		if (!prepare(
+					db,
+					&_update_instance_block_statement,
+					"INSERT INTO instance_blocks VALUES (:loc, :data) "
+					"ON CONFLICT(loc) DO UPDATE SET data=excluded.data"
+			)) {
+			return false;
+		}
+		if (!prepare(db, &_get_instance_block_statement, "SELECT data FROM instance_blocks WHERE loc=:loc")) {
+			return false;
+		}
+		if (!prepare(
+					db,
+					&_load_all_instance_blocks_statement,
+					"SELECT loc, data FROM instance_blocks WHERE data IS NOT NULL"
+			)) {
+			return false;
+		}
+		if (!prepare(db, &_load_all_instance_block_keys_statement, "SELECT loc FROM instance_blocks")) {
+			return false;
+		}
+
+	} else {
+		// Older databases store instances in a column of the `blocks` table
+		if (!prepare(
+					db,
+					&_update_instance_block_statement,
+					"INSERT INTO blocks (loc, instances) VALUES (:loc, :instances) "
+					"ON CONFLICT(loc) DO UPDATE SET instances=excluded.instances"
+			)) {
+			return false;
+		}
+		if (!prepare(db, &_get_instance_block_statement, "SELECT instances FROM blocks WHERE loc=:loc")) {
+			return false;
+		}
+		if (!prepare(
+					db,
+					&_load_all_instance_blocks_statement,
+					"SELECT loc, instances FROM blocks WHERE instances IS NOT NULL"
+			)) {
+			return false;
+		}
+		if (!prepare(
+					db,
+					&_load_all_instance_block_keys_statement,
+					"SELECT loc FROM blocks WHERE instances IS NOT NULL"
+			)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Connection::finalize_instance_block_statements() {
+	finalize(_update_instance_block_statement);
+	finalize(_get_instance_block_statement);
+	finalize(_load_all_instance_blocks_statement);
+	finalize(_load_all_instance_block_keys_statement);
+}
+
 const char *Connection::get_file_path() const {
 	if (_db == nullptr) {
 		return nullptr;
@@ -416,6 +597,9 @@ bool Connection::save_block(const BlockLocation loc, const Span<const uint8_t> b
 		case INSTANCES:
 			update_block_statement = _update_instance_block_statement;
 			break;
+		case MESHES:
+			update_block_statement = _update_mesh_block_statement;
+			break;
 		default:
 			CRASH_NOW();
 	}
@@ -434,8 +618,9 @@ bool Connection::save_block(const BlockLocation loc, const Span<const uint8_t> b
 	if (block_data.size() == 0) {
 		rc = sqlite3_bind_null(update_block_statement, 2);
 	} else {
-		// We use SQLITE_TRANSIENT so SQLite will make its own copy of the data
-		rc = sqlite3_bind_blob(update_block_statement, 2, block_data.data(), block_data.size(), SQLITE_TRANSIENT);
+		// We use SQLITE_STATIC so SQLite reads the data directly instead of making its own copy. Like block
+		// coordinates, it is only used by the step below, and will be bound to something else by the next query.
+		rc = sqlite3_bind_blob(update_block_statement, 2, block_data.data(), block_data.size(), SQLITE_STATIC);
 	}
 	if (rc != SQLITE_OK) {
 		ERR_PRINT(sqlite3_errmsg(db));
@@ -470,6 +655,9 @@ VoxelStream::ResultCode Connection::load_block(
 		case INSTANCES:
 			get_block_statement = _get_instance_block_statement;
 			break;
+		case MESHES:
+			get_block_statement = _get_mesh_block_statement;
+			break;
 		default:
 			CRASH_NOW();
 	}
@@ -516,19 +704,26 @@ VoxelStream::ResultCode Connection::load_block(
 }
 
 bool Connection::load_all_blocks(
+		const BlockType type,
 		void *callback_data,
-		void (*process_block_func)(
-				void *callback_data,
-				BlockLocation location,
-				Span<const uint8_t> voxel_data,
-				Span<const uint8_t> instances_data
-		)
+		void (*process_block_func)(void *callback_data, BlockLocation location, Span<const uint8_t> data)
 ) {
 	ZN_PROFILE_SCOPE();
 	CRASH_COND(process_block_func == nullptr);
 
 	sqlite3 *db = _db;
-	sqlite3_stmt *load_all_blocks_statement = _load_all_blocks_statement;
+
+	sqlite3_stmt *load_all_blocks_statement;
+	switch (type) {
+		case VOXELS:
+			load_all_blocks_statement = _load_all_voxel_blocks_statement;
+			break;
+		case INSTANCES:
+			load_all_blocks_statement = _load_all_instance_blocks_statement;
+			break;
+		default:
+			CRASH_NOW();
+	}
 
 	int rc;
 
@@ -551,19 +746,73 @@ bool Connection::load_all_blocks(
 					read_block_location(_meta.coordinate_format, key_column_type, load_all_blocks_statement, 0, loc)
 			);
 
-			const void *voxels_blob = sqlite3_column_blob(load_all_blocks_statement, 1);
-			const size_t voxels_blob_size = sqlite3_column_bytes(load_all_blocks_statement, 1);
-
-			const void *instances_blob = sqlite3_column_blob(load_all_blocks_statement, 2);
-			const size_t instances_blob_size = sqlite3_column_bytes(load_all_blocks_statement, 2);
+			const void *blob = sqlite3_column_blob(load_all_blocks_statement, 1);
+			const size_t blob_size = sqlite3_column_bytes(load_all_blocks_statement, 1);
 
 			// Using a function pointer because returning a big list of a copy of all the blobs can
 			// waste a lot of temporary memory
+			process_block_func(
+					callback_data, loc, Span<const uint8_t>(reinterpret_cast<const uint8_t *>(blob), blob_size)
+			);
+
+		} else if (rc == SQLITE_DONE) {
+			break;
+
+		} else {
+			ERR_PRINT(String("Unexpected SQLite return code: {0}; errmsg: {1}").format(rc, sqlite3_errmsg(db)));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Connection::load_voxel_blocks_in_key_range(
+		uint64_t min_key,
+		uint64_t max_key,
+		void *callback_data,
+		void (*process_block_func)(void *callback_data, BlockLocation location, Span<const uint8_t> voxel_data)
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(process_block_func != nullptr);
+	ZN_ASSERT_RETURN_V(get_coordinate_column_type(_meta.coordinate_format) == COORDINATE_COLUMN_U64, false);
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *statement = _load_voxel_blocks_in_key_range_statement;
+
+	int rc = sqlite3_reset(statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	// Keys are stored as signed integers. Both ends of a range must share the same prefix, so they have the same sign
+	// and remain ordered.
+	rc = sqlite3_bind_int64(statement, 1, static_cast<int64_t>(min_key));
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+	rc = sqlite3_bind_int64(statement, 2, static_cast<int64_t>(max_key));
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	while (true) {
+		rc = sqlite3_step(statement);
+
+		if (rc == SQLITE_ROW) {
+			const uint64_t eloc = sqlite3_column_int64(statement, 0);
+			const BlockLocation loc = BlockLocation::decode_u64(eloc, _meta.coordinate_format);
+
+			const void *voxels_blob = sqlite3_column_blob(statement, 1);
+			const size_t voxels_blob_size = sqlite3_column_bytes(statement, 1);
+
 			process_block_func(
 					callback_data,
 					loc,
-					Span<const uint8_t>(reinterpret_cast<const uint8_t *>(voxels_blob), voxels_blob_size),
-					Span<const uint8_t>(reinterpret_cast<const uint8_t *>(instances_blob), instances_blob_size)
+					Span<const uint8_t>(reinterpret_cast<const uint8_t *>(voxels_blob), voxels_blob_size)
 			);
 
 		} else if (rc == SQLITE_DONE) {
@@ -579,6 +828,7 @@ bool Connection::load_all_blocks(
 }
 
 bool Connection::load_all_block_keys(
+		const BlockType type,
 		void *callback_data,
 		void (*process_block_func)(void *callback_data, BlockLocation location)
 ) {
@@ -586,7 +836,18 @@ bool Connection::load_all_block_keys(
 	ZN_ASSERT(process_block_func != nullptr);
 
 	sqlite3 *db = _db;
-	sqlite3_stmt *load_all_block_keys_statement = _load_all_block_keys_statement;
+
+	sqlite3_stmt *load_all_block_keys_statement;
+	switch (type) {
+		case VOXELS:
+			load_all_block_keys_statement = _load_all_voxel_block_keys_statement;
+			break;
+		case INSTANCES:
+			load_all_block_keys_statement = _load_all_instance_block_keys_statement;
+			break;
+		default:
+			CRASH_NOW();
+	}
 
 	int rc;
 
@@ -625,6 +886,197 @@ bool Connection::load_all_block_keys(
 	return true;
 }
 
+bool Connection::load_random_voxel_blocks(
+		unsigned int count,
+		void *callback_data,
+		void (*process_block_func)(void *callback_data, Span<const uint8_t> voxel_data)
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(process_block_func != nullptr);
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *load_random_voxel_blocks_statement = _load_random_voxel_blocks_statement;
+
+	int rc;
+
+	rc = sqlite3_reset(load_random_voxel_blocks_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_bind_int(load_random_voxel_blocks_statement, 1, count);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	while (true) {
+		rc = sqlite3_step(load_random_voxel_blocks_statement);
+
+		if (rc == SQLITE_ROW) {
+			const void *voxels_blob = sqlite3_column_blob(load_random_voxel_blocks_statement, 0);
+			const size_t voxels_blob_size = sqlite3_column_bytes(load_random_voxel_blocks_statement, 0);
+
+			process_block_func(
+					callback_data,
+					Span<const uint8_t>(reinterpret_cast<const uint8_t *>(voxels_blob), voxels_blob_size)
+			);
+
+		} else if (rc == SQLITE_DONE) {
+			break;
+
+		} else {
+			ERR_PRINT(String("Unexpected SQLite return code: {0}; errmsg: {1}").format(rc, sqlite3_errmsg(db)));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Connection::load_zstd_dictionaries(StdVector<StdVector<uint8_t>> &out_dictionaries) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *load_zstd_dictionaries_statement = _load_zstd_dictionaries_statement;
+
+	int rc = sqlite3_reset(load_zstd_dictionaries_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	while (true) {
+		rc = sqlite3_step(load_zstd_dictionaries_statement);
+
+		if (rc == SQLITE_ROW) {
+			const void *blob = sqlite3_column_blob(load_zstd_dictionaries_statement, 0);
+			const size_t blob_size = sqlite3_column_bytes(load_zstd_dictionaries_statement, 0);
+
+			StdVector<uint8_t> &data = out_dictionaries.emplace_back();
+			data.resize(blob_size);
+			memcpy(data.data(), blob, blob_size);
+
+		} else if (rc == SQLITE_DONE) {
+			break;
+
+		} else {
+			ERR_PRINT(String("Unexpected SQLite return code: {0}; errmsg: {1}").format(rc, sqlite3_errmsg(db)));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Connection::save_zstd_dictionary(Span<const uint8_t> data) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *save_zstd_dictionary_statement = _save_zstd_dictionary_statement;
+
+	int rc = sqlite3_reset(save_zstd_dictionary_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_bind_blob(save_zstd_dictionary_statement, 1, data.data(), data.size(), SQLITE_TRANSIENT);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_step(save_zstd_dictionary_statement);
+	if (rc != SQLITE_DONE) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+bool Connection::load_block_key_index(StdVector<uint8_t> &out_data) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *load_block_key_index_statement = _load_block_key_index_statement;
+
+	out_data.clear();
+
+	int rc = sqlite3_reset(load_block_key_index_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_step(load_block_key_index_statement);
+
+	if (rc == SQLITE_ROW) {
+		const void *blob = sqlite3_column_blob(load_block_key_index_statement, 0);
+		const size_t blob_size = sqlite3_column_bytes(load_block_key_index_statement, 0);
+		out_data.resize(blob_size);
+		if (blob_size > 0) {
+			memcpy(out_data.data(), blob, blob_size);
+		}
+
+	} else if (rc != SQLITE_DONE) {
+		ERR_PRINT(String("Unexpected SQLite return code: {0}; errmsg: {1}").format(rc, sqlite3_errmsg(db)));
+		return false;
+	}
+
+	return true;
+}
+
+bool Connection::save_block_key_index(Span<const uint8_t> data) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *save_block_key_index_statement = _save_block_key_index_statement;
+
+	int rc = sqlite3_reset(save_block_key_index_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_bind_blob(save_block_key_index_statement, 1, data.data(), data.size(), SQLITE_TRANSIENT);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	rc = sqlite3_step(save_block_key_index_statement);
+	if (rc != SQLITE_DONE) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return false;
+	}
+
+	return true;
+}
+
+int64_t Connection::get_block_count() {
+	ZN_PROFILE_SCOPE();
+
+	sqlite3 *db = _db;
+	sqlite3_stmt *get_block_count_statement = _get_block_count_statement;
+
+	int rc = sqlite3_reset(get_block_count_statement);
+	if (rc != SQLITE_OK) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return -1;
+	}
+
+	rc = sqlite3_step(get_block_count_statement);
+	if (rc != SQLITE_ROW) {
+		ERR_PRINT(sqlite3_errmsg(db));
+		return -1;
+	}
+
+	return sqlite3_column_int64(get_block_count_statement, 0);
+}
+
 int Connection::load_version() {
 	sqlite3 *db = _db;
 	sqlite3_stmt *load_version_statement = _load_version_statement;
@@ -678,7 +1130,7 @@ Connection::Meta Connection::load_meta() {
 
 		if (meta.version == VERSION_V0) {
 			meta.coordinate_format = BlockLocation::FORMAT_INT64_X16_Y16_Z16_L16;
-		} else if (meta.version == VERSION_LATEST) {
+		} else if (meta.version == VERSION_V1 || meta.version == VERSION_V2) {
 			meta.coordinate_format =
 					static_cast<BlockLocation::CoordinateFormat>(sqlite3_column_int(load_meta_statement, 2));
 		} else {
@@ -762,7 +1214,7 @@ void Connection::save_meta(Meta meta) {
 		ERR_PRINT(sqlite3_errmsg(db));
 		return;
 	}
-	if (meta.version == VERSION_LATEST) {
+	if (meta.version >= VERSION_V1) {
 		rc = sqlite3_bind_int(save_meta_statement, 3, meta.coordinate_format);
 		if (rc != SQLITE_OK) {
 			ZN_PRINT_ERROR(sqlite3_errmsg(db));
@@ -863,11 +1315,100 @@ bool Connection::migrate_from_v0_to_v1() {
 	return true;
 }
 
+bool Connection::migrate_from_v1_to_v2() {
+	if (_meta.version == VERSION_V2) {
+		ZN_PRINT_WARNING("Version already matching");
+		return true;
+	}
+	ZN_ASSERT_RETURN_V(_meta.version == VERSION_V1, false);
+
+	ZN_ASSERT_RETURN_V(create_blocks_table(_db, "instance_blocks", _meta.coordinate_format), false);
+
+	// Statements using the `instances` column would prevent from dropping it
+	finalize_instance_block_statements();
+
+	// Prepare statements
+	struct Statements {
+		Connection &db;
+		sqlite3_stmt *copy_instances = nullptr;
+		sqlite3_stmt *drop_instances_column = nullptr;
+		sqlite3_stmt *delete_empty_blocks = nullptr;
+		sqlite3_stmt *update_table = nullptr;
+
+		Statements(Connection &p_db) : db(p_db) {}
+
+		~Statements() {
+			finalize(copy_instances);
+			finalize(drop_instances_column);
+			finalize(delete_empty_blocks);
+			finalize(update_table);
+		}
+	};
+
+	Statements statements(*this);
+
+	if (!prepare(
+				_db,
+				&statements.copy_instances,
+				"INSERT OR REPLACE INTO instance_blocks (loc, data) "
+				"SELECT loc, instances FROM blocks WHERE instances IS NOT NULL"
+		)) {
+		return false;
+	}
+	ZN_ASSERT_RETURN_V(
+			prepare(_db, &statements.drop_instances_column, "ALTER TABLE blocks DROP COLUMN instances"), false
+	);
+	// Rows which only had instances
+	ZN_ASSERT_RETURN_V(prepare(_db, &statements.delete_empty_blocks, "DELETE FROM blocks WHERE vb IS NULL"), false);
+	ZN_ASSERT_RETURN_V(prepare(_db, &statements.update_table, "UPDATE meta SET version = :version"), false);
+
+	// Run
+	{
+		TransactionScope scope(*this);
+
+		int rc = sqlite3_step(statements.copy_instances);
+		if (rc != SQLITE_DONE) {
+			ZN_PRINT_ERROR(sqlite3_errmsg(_db));
+			return false;
+		}
+
+		rc = sqlite3_step(statements.drop_instances_column);
+		if (rc != SQLITE_DONE) {
+			ZN_PRINT_ERROR(sqlite3_errmsg(_db));
+			return false;
+		}
+
+		rc = sqlite3_step(statements.delete_empty_blocks);
+		if (rc != SQLITE_DONE) {
+			ZN_PRINT_ERROR(sqlite3_errmsg(_db));
+			return false;
+		}
+
+		rc = sqlite3_bind_int(statements.update_table, 1, VERSION_V2);
+		if (rc != SQLITE_OK) {
+			ZN_PRINT_ERROR(sqlite3_errmsg(_db));
+			return false;
+		}
+
+		rc = sqlite3_step(statements.update_table);
+		if (rc != SQLITE_DONE) {
+			ZN_PRINT_ERROR(sqlite3_errmsg(_db));
+			return false;
+		}
+	}
+
+	_meta.version = VERSION_V2;
+	return prepare_instance_block_statements(VERSION_V2);
+}
+
 bool Connection::migrate_to_next_version() {
 	switch (_meta.version) {
 		case VERSION_V0:
 			return migrate_from_v0_to_v1();
 
+		case VERSION_V1:
+			return migrate_from_v1_to_v2();
+
 		case VERSION_LATEST:
 			ZN_PRINT_WARNING("Version is already latest");
 			break;
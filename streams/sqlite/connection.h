@@ -16,7 +16,11 @@ class Connection {
 public:
 	static constexpr int VERSION_V0 = 0;
 	static constexpr int VERSION_V1 = 1;
-	static constexpr int VERSION_LATEST = VERSION_V1;
+	// Instance blocks moved from a column of `blocks` to their own table
+	static constexpr int VERSION_V2 = 2;
+	static constexpr int VERSION_LATEST = VERSION_V2;
+	// How long a connection waits for another one to finish writing before failing with a busy error
+	static constexpr int BUSY_TIMEOUT_MSEC = 5000;
 
 	struct Meta {
 		int version = -1;
@@ -35,13 +39,21 @@ public:
 
 	enum BlockType { //
 		VOXELS,
-		INSTANCES
+		INSTANCES,
+		// Only supported by `save_block` and `load_block`
+		MESHES
 	};
 
 	Connection();
 	~Connection();
 
-	bool open(const char *fpath, const BlockLocation::CoordinateFormat preferred_coordinate_format);
+	// If `wal_enabled` is true, the database is switched to write-ahead logging, so readers and a writer using
+	// different connections don't block each other.
+	bool open(
+			const char *fpath,
+			const BlockLocation::CoordinateFormat preferred_coordinate_format,
+			const bool wal_enabled
+	);
 	void close();
 
 	bool is_open() const {
@@ -68,21 +80,46 @@ public:
 			const BlockType type
 	);
 
+	// Loads data of all blocks of the given type. Blocks without data of that type are skipped.
 	bool load_all_blocks(
+			const BlockType type,
 			void *callback_data,
-			void (*process_block_func)(
-					void *callback_data,
-					BlockLocation location,
-					Span<const uint8_t> voxel_data,
-					Span<const uint8_t> instances_data
-			)
+			void (*process_block_func)(void *callback_data, BlockLocation location, Span<const uint8_t> data)
+	);
+
+	// Loads voxel data of all blocks whose key is in the given inclusive range. Only usable with integer coordinate
+	// formats, in which keys of blocks sharing the same LOD, X and Y, with Z of the same sign, are contiguous.
+	bool load_voxel_blocks_in_key_range(
+			uint64_t min_key,
+			uint64_t max_key,
+			void *callback_data,
+			void (*process_block_func)(void *callback_data, BlockLocation location, Span<const uint8_t> voxel_data)
 	);
 
 	bool load_all_block_keys(
+			const BlockType type,
 			void *callback_data,
 			void (*process_block_func)(void *callback_data, BlockLocation location)
 	);
 
+	// Loads voxel data of up to `count` blocks picked randomly
+	bool load_random_voxel_blocks(
+			unsigned int count,
+			void *callback_data,
+			void (*process_block_func)(void *callback_data, Span<const uint8_t> voxel_data)
+	);
+
+	// Dictionaries are returned in the order they were saved
+	bool load_zstd_dictionaries(StdVector<StdVector<uint8_t>> &out_dictionaries);
+	bool save_zstd_dictionary(Span<const uint8_t> data);
+
+	// Data of the saved `BlockKeyIndex`. Returns empty data if there is none.
+	bool load_block_key_index(StdVector<uint8_t> &out_data);
+	bool save_block_key_index(Span<const uint8_t> data);
+
+	// Returns -1 if an error occurred
+	int64_t get_block_count();
+
 	const Meta &get_meta() const {
 		return _meta;
 	}
@@ -95,6 +132,9 @@ private:
 	void save_meta(Meta meta);
 	bool migrate_to_next_version();
 	bool migrate_from_v0_to_v1();
+	bool migrate_from_v1_to_v2();
+	bool prepare_instance_block_statements(const int version);
+	void finalize_instance_block_statements();
 
 	StdString _opened_path;
 	Meta _meta;
@@ -106,12 +146,23 @@ private:
 	sqlite3_stmt *_get_voxel_block_statement = nullptr;
 	sqlite3_stmt *_update_instance_block_statement = nullptr;
 	sqlite3_stmt *_get_instance_block_statement = nullptr;
+	sqlite3_stmt *_update_mesh_block_statement = nullptr;
+	sqlite3_stmt *_get_mesh_block_statement = nullptr;
 	sqlite3_stmt *_load_meta_statement = nullptr;
 	sqlite3_stmt *_save_meta_statement = nullptr;
 	sqlite3_stmt *_load_channels_statement = nullptr;
 	sqlite3_stmt *_save_channel_statement = nullptr;
-	sqlite3_stmt *_load_all_blocks_statement = nullptr;
-	sqlite3_stmt *_load_all_block_keys_statement = nullptr;
+	sqlite3_stmt *_load_all_voxel_blocks_statement = nullptr;
+	sqlite3_stmt *_load_all_voxel_block_keys_statement = nullptr;
+	sqlite3_stmt *_load_all_instance_blocks_statement = nullptr;
+	sqlite3_stmt *_load_all_instance_block_keys_statement = nullptr;
+	sqlite3_stmt *_load_voxel_blocks_in_key_range_statement = nullptr;
+	sqlite3_stmt *_load_random_voxel_blocks_statement = nullptr;
+	sqlite3_stmt *_load_zstd_dictionaries_statement = nullptr;
+	sqlite3_stmt *_save_zstd_dictionary_statement = nullptr;
+	sqlite3_stmt *_load_block_key_index_statement = nullptr;
+	sqlite3_stmt *_save_block_key_index_statement = nullptr;
+	sqlite3_stmt *_get_block_count_statement = nullptr;
 };
 
 } // namespace zylann::voxel::sqlite
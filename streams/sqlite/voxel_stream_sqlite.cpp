@@ -1,4 +1,5 @@
 #include "voxel_stream_sqlite.h"
+#include "../../util/containers/std_unordered_set.h"
 #include "../../util/godot/classes/project_settings.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/profiling.h"
@@ -7,6 +8,7 @@
 #include "../compressed_data.h"
 #include "connection.h"
 
+#include <limits>
 #include <string_view>
 #include <unordered_set>
 
@@ -23,6 +25,10 @@ StdVector<uint8_t> &get_tls_temp_compressed_block_data() {
 	thread_local StdVector<uint8_t> tls_temp_compressed_block_data;
 	return tls_temp_compressed_block_data;
 }
+StdVector<uint8_t> &get_tls_temp_voxel_block_data() {
+	thread_local StdVector<uint8_t> tls_temp_voxel_block_data;
+	return tls_temp_voxel_block_data;
+}
 
 BlockLocation::CoordinateFormat to_internal_coordinate_format(VoxelStreamSQLite::CoordinateFormat format) {
 	return static_cast<BlockLocation::CoordinateFormat>(format);
@@ -32,6 +38,18 @@ VoxelStreamSQLite::CoordinateFormat to_exposed_coordinate_format(BlockLocation::
 	return static_cast<VoxelStreamSQLite::CoordinateFormat>(format);
 }
 
+CompressedData::Compression to_internal_compression(VoxelStreamSQLite::CompressionMode mode) {
+	switch (mode) {
+		case VoxelStreamSQLite::COMPRESSION_LZ4:
+			return CompressedData::COMPRESSION_LZ4;
+		case VoxelStreamSQLite::COMPRESSION_ZSTD:
+			return CompressedData::COMPRESSION_ZSTD;
+		default:
+			ZN_PRINT_ERROR("Unhandled compression mode");
+			return CompressedData::COMPRESSION_LZ4;
+	}
+}
+
 bool validate_range(Vector3i pos, unsigned int lod_index, const Box3i coordinate_range, unsigned int lod_count) {
 	if (!coordinate_range.contains(pos)) {
 		ZN_PRINT_ERROR(format("Block position {} is outside of supported range {}", pos, coordinate_range));
@@ -44,15 +62,22 @@ bool validate_range(Vector3i pos, unsigned int lod_index, const Box3i coordinate
 	return true;
 }
 
+// Callback filling a `BlockKeyIndex` with keys loaded from the database
+void add_block_key_no_lock(void *ctx, BlockLocation loc) {
+	BlockKeyIndex *cache = static_cast<BlockKeyIndex *>(ctx);
+	cache->add_no_lock(loc.position, loc.lod);
+}
+
 } // namespace
 
 VoxelStreamSQLite::VoxelStreamSQLite() {}
 
 VoxelStreamSQLite::~VoxelStreamSQLite() {
 	ZN_PRINT_VERBOSE("~VoxelStreamSQLite");
-	if (!_globalized_connection_path.empty() && _cache.get_indicative_block_count() > 0) {
+	if (!_globalized_connection_path.empty() &&
+		(_cache.get_indicative_block_count() > 0 || has_unsaved_block_keys())) {
 		ZN_PRINT_VERBOSE("~VoxelStreamSQLite flushy flushy");
-		flush_cache();
+		flush();
 		ZN_PRINT_VERBOSE("~VoxelStreamSQLite flushy done");
 	}
 	for (auto it = _connection_pool.begin(); it != _connection_pool.end(); ++it) {
@@ -67,22 +92,39 @@ void VoxelStreamSQLite::set_database_path(String path) {
 	if (path == _user_specified_connection_path) {
 		return;
 	}
-	if (!_globalized_connection_path.empty() && _cache.get_indicative_block_count() > 0) {
+	if (!_globalized_connection_path.empty() &&
+		(_cache.get_indicative_block_count() > 0 || has_unsaved_block_keys())) {
 		// Save cached data before changing the path.
 		// Not using get_connection() because it locks, we are already locked.
 		sqlite::Connection con;
 		// Note, the path could be invalid,
 		// Since Godot helpfully sets the property for every character typed in the inspector.
 		// So there can be lots of errors in the editor if you type it.
-		if (con.open(_globalized_connection_path.data(), to_internal_coordinate_format(_preferred_coordinate_format))) {
+		if (con.open(
+					_globalized_connection_path.data(),
+					to_internal_coordinate_format(_preferred_coordinate_format),
+					_wal_enabled
+			)) {
 			flush_cache_to_connection(&con);
+			save_block_keys_cache(con);
 		}
 	}
 	for (auto it = _connection_pool.begin(); it != _connection_pool.end(); ++it) {
 		delete *it;
 	}
-	_block_keys_cache.clear();
+	{
+		MutexLock keys_lock(_block_keys_cache_load_mutex);
+		_block_keys_cache.clear();
+		_block_keys_cache_loaded = false;
+		_instance_block_keys_cache.clear();
+		_instance_block_keys_cache_loaded = false;
+	}
 	_connection_pool.clear();
+	{
+		RWLockWrite wlock(_zstd_dictionaries_lock);
+		_zstd_dictionaries.clear();
+		_zstd_dictionaries_loaded = false;
+	}
 
 	_user_specified_connection_path = path;
 	// To support Godot shortcuts like `user://` and `res://` (though the latter won't work on exported builds)
@@ -140,24 +182,33 @@ void VoxelStreamSQLite::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_bl
 	// TODO We should handle busy return codes
 	ERR_FAIL_COND(con->begin_transaction() == false);
 
-	for (unsigned int i = 0; i < blocks_to_load.size(); ++i) {
-		const unsigned int ri = blocks_to_load[i];
-		VoxelStream::VoxelQueryData &q = p_blocks[ri];
+	{
+		// Not held while recycling the connection, which locks another mutex
+		RWLockRead dictionaries_rlock(_zstd_dictionaries_lock);
+		const Span<const std::shared_ptr<CompressedData::ZstdDictionary>> zstd_dictionaries =
+				to_span_const(_zstd_dictionaries);
 
-		BlockLocation loc;
-		loc.position = q.position_in_blocks;
-		loc.lod = q.lod_index;
+		for (unsigned int i = 0; i < blocks_to_load.size(); ++i) {
+			const unsigned int ri = blocks_to_load[i];
+			VoxelStream::VoxelQueryData &q = p_blocks[ri];
+
+			BlockLocation loc;
+			loc.position = q.position_in_blocks;
+			loc.lod = q.lod_index;
 
-		StdVector<uint8_t> &temp_block_data = get_tls_temp_block_data();
+			StdVector<uint8_t> &temp_block_data = get_tls_temp_block_data();
 
-		const ResultCode res = con->load_block(loc, temp_block_data, sqlite::Connection::VOXELS);
+			const ResultCode res = con->load_block(loc, temp_block_data, sqlite::Connection::VOXELS);
 
-		if (res == RESULT_BLOCK_FOUND) {
-			// TODO Not sure if we should actually expect non-null. There can be legit not found blocks.
-			BlockSerializer::decompress_and_deserialize(to_span_const(temp_block_data), q.voxel_buffer);
-		}
+			if (res == RESULT_BLOCK_FOUND) {
+				// TODO Not sure if we should actually expect non-null. There can be legit not found blocks.
+				BlockSerializer::decompress_and_deserialize(
+						to_span_const(temp_block_data), q.voxel_buffer, zstd_dictionaries
+				);
+			}
 
-		q.result = res;
+			q.result = res;
+		}
 	}
 
 	ERR_FAIL_COND(con->end_transaction() == false);
@@ -203,11 +254,23 @@ void VoxelStreamSQLite::load_instance_blocks(Span<VoxelStream::InstancesQueryDat
 	// TODO Get block size from database
 	// const int bs_po2 = constants::DEFAULT_BLOCK_SIZE_PO2;
 
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+
+	if (_block_keys_cache_enabled) {
+		load_instance_block_keys_cache(*con);
+	}
+
 	// Check the cache first
 	StdVector<unsigned int> blocks_to_load;
 	for (size_t i = 0; i < out_blocks.size(); ++i) {
 		VoxelStream::InstancesQueryData &q = out_blocks[i];
 
+		if (_block_keys_cache_enabled && !_instance_block_keys_cache.contains(q.position_in_blocks, q.lod_index)) {
+			q.result = RESULT_BLOCK_NOT_FOUND;
+			continue;
+		}
+
 		if (_cache.load_instance_block(q.position_in_blocks, q.lod_index, q.data)) {
 			q.result = RESULT_BLOCK_FOUND;
 
@@ -218,12 +281,10 @@ void VoxelStreamSQLite::load_instance_blocks(Span<VoxelStream::InstancesQueryDat
 
 	if (blocks_to_load.size() == 0) {
 		// Everything was cached, no need to query the database
+		recycle_connection(con);
 		return;
 	}
 
-	sqlite::Connection *con = get_connection();
-	ERR_FAIL_COND(con == nullptr);
-
 	// TODO We should handle busy return codes
 	// TODO recycle on error
 	ERR_FAIL_COND(con->begin_transaction() == false);
@@ -266,6 +327,11 @@ void VoxelStreamSQLite::load_instance_blocks(Span<VoxelStream::InstancesQueryDat
 
 void VoxelStreamSQLite::save_instance_blocks(Span<VoxelStream::InstancesQueryData> p_blocks) {
 	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+	if (_block_keys_cache_enabled) {
+		// Must be loaded before adding keys, otherwise they would be lost when loading it later
+		load_instance_block_keys_cache(*con);
+	}
 	const BlockLocation::CoordinateFormat coordinate_format = con->get_meta().coordinate_format;
 	const Box3i coordinate_range = BlockLocation::get_coordinate_range(coordinate_format);
 	const unsigned int lod_count = BlockLocation::get_lod_count(coordinate_format);
@@ -281,7 +347,7 @@ void VoxelStreamSQLite::save_instance_blocks(Span<VoxelStream::InstancesQueryDat
 
 		_cache.save_instance_block(q.position_in_blocks, q.lod_index, std::move(q.data));
 		if (_block_keys_cache_enabled) {
-			_block_keys_cache.add(q.position_in_blocks, q.lod_index);
+			_instance_block_keys_cache.add(q.position_in_blocks, q.lod_index);
 		}
 	}
 
@@ -291,6 +357,172 @@ void VoxelStreamSQLite::save_instance_blocks(Span<VoxelStream::InstancesQueryDat
 	}
 }
 
+bool VoxelStreamSQLite::supports_mesh_blocks() const {
+	return true;
+}
+
+void VoxelStreamSQLite::load_mesh_blocks(Span<VoxelStream::MeshesQueryData> out_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+
+	// Meshes don't go through the cache, they are only written once after being built
+	// TODO recycle on error
+	ERR_FAIL_COND(con->begin_transaction() == false);
+
+	for (VoxelStream::MeshesQueryData &q : out_blocks) {
+		BlockLocation loc;
+		loc.position = q.position_in_blocks;
+		loc.lod = q.lod_index;
+		q.result = con->load_block(loc, q.data, sqlite::Connection::MESHES);
+	}
+
+	ERR_FAIL_COND(con->end_transaction() == false);
+
+	recycle_connection(con);
+}
+
+void VoxelStreamSQLite::save_mesh_blocks(Span<VoxelStream::MeshesQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+
+	const BlockLocation::CoordinateFormat coordinate_format = con->get_meta().coordinate_format;
+	const Box3i coordinate_range = BlockLocation::get_coordinate_range(coordinate_format);
+	const unsigned int lod_count = BlockLocation::get_lod_count(coordinate_format);
+
+	// TODO recycle on error
+	ERR_FAIL_COND(con->begin_transaction() == false);
+
+	for (const VoxelStream::MeshesQueryData &q : p_blocks) {
+		if (!validate_range(q.position_in_blocks, q.lod_index, coordinate_range, lod_count)) {
+			continue;
+		}
+		BlockLocation loc;
+		loc.position = q.position_in_blocks;
+		loc.lod = q.lod_index;
+		con->save_block(loc, to_span_const(q.data), sqlite::Connection::MESHES);
+	}
+
+	ERR_FAIL_COND(con->end_transaction() == false);
+
+	recycle_connection(con);
+}
+
+bool VoxelStreamSQLite::supports_compressed_voxel_blocks() const {
+	return true;
+}
+
+void VoxelStreamSQLite::load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> out_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+
+	StdVector<unsigned int> blocks_to_load;
+	for (unsigned int i = 0; i < out_blocks.size(); ++i) {
+		VoxelStream::CompressedVoxelQueryData &q = out_blocks[i];
+		const Vector3i pos = q.position_in_blocks;
+
+		if (_block_keys_cache_enabled && !_block_keys_cache.contains(pos, q.lod_index)) {
+			q.result = RESULT_BLOCK_NOT_FOUND;
+			continue;
+		}
+
+		// Blocks saved with `save_voxel_blocks` may still be in the cache. They have to be compressed again, but this
+		// only happens for recently saved blocks.
+		VoxelBuffer temp_voxels(VoxelBuffer::ALLOCATOR_POOL);
+		if (_cache.load_voxel_block(pos, q.lod_index, temp_voxels)) {
+			q.result = compress_voxel_block(temp_voxels, q.data) ? RESULT_BLOCK_FOUND : RESULT_ERROR;
+
+		} else {
+			blocks_to_load.push_back(i);
+		}
+	}
+
+	if (blocks_to_load.size() == 0) {
+		recycle_connection(con);
+		return;
+	}
+
+	ERR_FAIL_COND(con->begin_transaction() == false);
+
+	for (const unsigned int i : blocks_to_load) {
+		VoxelStream::CompressedVoxelQueryData &q = out_blocks[i];
+		BlockLocation loc;
+		loc.position = q.position_in_blocks;
+		loc.lod = q.lod_index;
+		q.result = con->load_block(loc, q.data, sqlite::Connection::VOXELS);
+	}
+
+	ERR_FAIL_COND(con->end_transaction() == false);
+
+	recycle_connection(con);
+}
+
+void VoxelStreamSQLite::save_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+
+	// Blocks in the cache were saved before these ones. They are written first, so they can't overwrite them later.
+	// This also waits for a flush that could be running on another connection.
+	flush_cache_to_connection(con);
+
+	const BlockLocation::CoordinateFormat coordinate_format = con->get_meta().coordinate_format;
+	const Box3i coordinate_range = BlockLocation::get_coordinate_range(coordinate_format);
+	const unsigned int lod_count = BlockLocation::get_lod_count(coordinate_format);
+
+	// TODO recycle on error
+	ERR_FAIL_COND(con->begin_transaction() == false);
+
+	for (const VoxelStream::CompressedVoxelQueryData &q : p_blocks) {
+		if (!validate_range(q.position_in_blocks, q.lod_index, coordinate_range, lod_count)) {
+			continue;
+		}
+		BlockLocation loc;
+		loc.position = q.position_in_blocks;
+		loc.lod = q.lod_index;
+		con->save_block(loc, to_span_const(q.data), sqlite::Connection::VOXELS);
+		if (_block_keys_cache_enabled) {
+			_block_keys_cache.add(q.position_in_blocks, q.lod_index);
+		}
+	}
+
+	ERR_FAIL_COND(con->end_transaction() == false);
+
+	recycle_connection(con);
+}
+
+bool VoxelStreamSQLite::has_portable_compressed_voxel_blocks() const {
+	RWLockRead rlock(_zstd_dictionaries_lock);
+	// Blocks compressed with a dictionary can only be decompressed with it
+	return _zstd_dictionaries_loaded && _zstd_dictionaries.size() == 0;
+}
+
+bool VoxelStreamSQLite::get_voxel_block_keys(StdVector<BlockKey> &out_keys) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND_V(con == nullptr, false);
+
+	flush_cache_to_connection(con);
+
+	struct L {
+		static void add_block_key(void *callback_data, BlockLocation location) {
+			StdVector<BlockKey> *keys = static_cast<StdVector<BlockKey> *>(callback_data);
+			keys->push_back(BlockKey{ location.position, location.lod });
+		}
+	};
+
+	const bool success = con->load_all_block_keys(sqlite::Connection::VOXELS, &out_keys, L::add_block_key);
+	recycle_connection(con);
+	return success;
+}
+
 void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
 	ZN_PROFILE_SCOPE();
 
@@ -299,6 +531,7 @@ void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
 
 	struct Context {
 		FullLoadingResult &result;
+		Span<const std::shared_ptr<CompressedData::ZstdDictionary>> zstd_dictionaries;
 	};
 
 	// Using local function instead of a lambda for quite stupid reason admittedly:
@@ -308,52 +541,184 @@ void VoxelStreamSQLite::load_all_blocks(FullLoadingResult &result) {
 		static void process_block_func(
 				void *callback_data,
 				const BlockLocation location,
-				Span<const uint8_t> voxel_data,
-				Span<const uint8_t> instances_data
+				Span<const uint8_t> voxel_data
 		) {
 			Context *ctx = reinterpret_cast<Context *>(callback_data);
 
-			if (voxel_data.size() == 0 && instances_data.size() == 0) {
-				ZN_PRINT_VERBOSE(format(
-						"Unexpected empty voxel data and instances data at {} lod {}", location.position, location.lod
-				));
-				return;
-			}
-
 			FullLoadingResult::Block result_block;
 			result_block.position = location.position;
 			result_block.lod = location.lod;
 
-			if (voxel_data.size() > 0) {
+			if (ctx->result.defer_voxel_decoding) {
+				// Decompression is the most expensive part, let the caller spread it on multiple threads
+				result_block.compressed_voxels.assign(voxel_data.data(), voxel_data.data() + voxel_data.size());
+			} else {
 				std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
-				ERR_FAIL_COND(!BlockSerializer::decompress_and_deserialize(voxel_data, *voxels));
+				ERR_FAIL_COND(
+						!BlockSerializer::decompress_and_deserialize(voxel_data, *voxels, ctx->zstd_dictionaries)
+				);
 				result_block.voxels = voxels;
 			}
 
-			if (instances_data.size() > 0) {
-				StdVector<uint8_t> &temp_block_data = get_tls_temp_block_data();
-				if (!CompressedData::decompress(instances_data, temp_block_data)) {
-					ERR_PRINT("Failed to decompress instance block");
-					return;
-				}
-				result_block.instances_data = make_unique_instance<InstanceBlockData>();
-				if (!deserialize_instance_block_data(*result_block.instances_data, to_span_const(temp_block_data))) {
-					ERR_PRINT("Failed to deserialize instance block");
-					return;
-				}
-			}
-
 			ctx->result.blocks.push_back(std::move(result_block));
 		}
 	};
 
-	// Had to suffix `_outer`,
-	// because otherwise GCC thinks it shadows a variable inside the local function/captureless lambda
-	Context ctx_outer{ result };
-	const bool request_result = con->load_all_blocks(&ctx_outer, L::process_block_func);
+	bool request_result;
+	{
+		// Had to suffix `_outer`,
+		// because otherwise GCC thinks it shadows a variable inside the local function/captureless lambda
+		RWLockRead dictionaries_rlock(_zstd_dictionaries_lock);
+		Context ctx_outer{ result, to_span_const(_zstd_dictionaries) };
+		// Instances are not read, they are loaded separately when an instancer requests them
+		request_result = con->load_all_blocks(sqlite::Connection::VOXELS, &ctx_outer, L::process_block_func);
+	}
+	recycle_connection(con);
 	ERR_FAIL_COND(request_result == false);
 }
 
+bool VoxelStreamSQLite::decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const {
+	RWLockRead dictionaries_rlock(_zstd_dictionaries_lock);
+	return BlockSerializer::decompress_and_deserialize(data, out_voxels, to_span_const(_zstd_dictionaries));
+}
+
+bool VoxelStreamSQLite::compress_voxel_block(const VoxelBuffer &voxels, StdVector<uint8_t> &out_data) const {
+	CompressedData::ZstdOptions zstd_options;
+	zstd_options.compression_level = _zstd_compression_level;
+
+	RWLockRead dictionaries_rlock(_zstd_dictionaries_lock);
+	if (_zstd_dictionaries.size() > 0) {
+		zstd_options.dictionary = _zstd_dictionaries.back().get();
+	}
+
+	const BlockSerializer::SerializeResult res =
+			BlockSerializer::serialize_and_compress(voxels, to_internal_compression(_compression_mode), zstd_options);
+	if (!res.success) {
+		return false;
+	}
+	out_data = res.data;
+	return true;
+}
+
+void VoxelStreamSQLite::load_voxel_blocks_in_box(Box3i box_in_blocks, uint8_t lod_index, FullLoadingResult &result) {
+	ZN_PROFILE_SCOPE();
+
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+
+	const BlockLocation::CoordinateFormat coordinate_format = con->get_meta().coordinate_format;
+	if (coordinate_format != BlockLocation::FORMAT_INT64_X16_Y16_Z16_L16 &&
+		coordinate_format != BlockLocation::FORMAT_INT64_X19_Y19_Z19_L7) {
+		// Keys of neighbor blocks are not ordered in other formats
+		recycle_connection(con);
+		VoxelStream::load_voxel_blocks_in_box(box_in_blocks, lod_index, result);
+		return;
+	}
+
+	box_in_blocks.clip(BlockLocation::get_coordinate_range(coordinate_format));
+
+	if (lod_index >= BlockLocation::get_lod_count(coordinate_format)) {
+		recycle_connection(con);
+		ZN_PRINT_ERROR(format("LOD index {} is out of range", lod_index));
+		return;
+	}
+
+	if (box_in_blocks.is_empty() ||
+		(_block_keys_cache_enabled && !_block_keys_cache.contains_any(box_in_blocks, lod_index))) {
+		recycle_connection(con);
+		return;
+	}
+
+	const unsigned int first_result_index = result.blocks.size();
+
+	// Blocks in the cache are more recent than those in the database
+	StdUnorderedSet<Vector3i> cached_positions;
+	std::shared_ptr<VoxelBuffer> cached_voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+	box_in_blocks.for_each_cell_zxy([this, lod_index, &result, &cached_positions, &cached_voxels](const Vector3i pos) {
+		if (_cache.load_voxel_block(pos, lod_index, *cached_voxels)) {
+			result.blocks.push_back(FullLoadingResult::Block{ cached_voxels, pos, lod_index });
+			cached_positions.insert(pos);
+			cached_voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		}
+	});
+
+	struct Context {
+		FullLoadingResult &result;
+		const StdUnorderedSet<Vector3i> &cached_positions;
+		Span<const std::shared_ptr<CompressedData::ZstdDictionary>> zstd_dictionaries;
+	};
+
+	struct L {
+		static void process_block_func(void *callback_data, BlockLocation location, Span<const uint8_t> voxel_data) {
+			Context *ctx = reinterpret_cast<Context *>(callback_data);
+
+			if (ctx->cached_positions.find(location.position) != ctx->cached_positions.end()) {
+				return;
+			}
+
+			std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+			ERR_FAIL_COND(!BlockSerializer::decompress_and_deserialize(voxel_data, *voxels, ctx->zstd_dictionaries));
+			ctx->result.blocks.push_back(FullLoadingResult::Block{ voxels, location.position, location.lod });
+		}
+	};
+
+	// TODO We should handle busy return codes
+	ERR_FAIL_COND(con->begin_transaction() == false);
+
+	{
+		RWLockRead dictionaries_rlock(_zstd_dictionaries_lock);
+		Context ctx_outer{ result, cached_positions, to_span_const(_zstd_dictionaries) };
+
+		// Z is the least significant part of keys, so each column of blocks along Z is a range of keys. Negative
+		// coordinates are stored in two's complement, so they come after positive ones, and columns crossing zero have
+		// to be split.
+		const int min_z = box_in_blocks.position.z;
+		const int max_z = box_in_blocks.position.z + box_in_blocks.size.z - 1;
+		FixedArray<int, 2> z_range_begins;
+		FixedArray<int, 2> z_range_ends;
+		unsigned int z_range_count = 1;
+		if (min_z < 0 && max_z >= 0) {
+			z_range_begins[0] = min_z;
+			z_range_ends[0] = -1;
+			z_range_begins[1] = 0;
+			z_range_ends[1] = max_z;
+			z_range_count = 2;
+		} else {
+			z_range_begins[0] = min_z;
+			z_range_ends[0] = max_z;
+		}
+
+		const Vector3i min_pos = box_in_blocks.position;
+		const Vector3i max_pos = box_in_blocks.position + box_in_blocks.size;
+		bool success = true;
+
+		for (int x = min_pos.x; x < max_pos.x && success; ++x) {
+			for (int y = min_pos.y; y < max_pos.y && success; ++y) {
+				for (unsigned int zri = 0; zri < z_range_count && success; ++zri) {
+					const BlockLocation min_loc{ Vector3i(x, y, z_range_begins[zri]), lod_index };
+					const BlockLocation max_loc{ Vector3i(x, y, z_range_ends[zri]), lod_index };
+					success = con->load_voxel_blocks_in_key_range(
+							min_loc.encode_u64(coordinate_format),
+							max_loc.encode_u64(coordinate_format),
+							&ctx_outer,
+							L::process_block_func
+					);
+				}
+			}
+		}
+
+		if (!success) {
+			ZN_PRINT_ERROR(format("Failed to load blocks in box {} at lod {}", box_in_blocks, lod_index));
+			// Don't return partial results
+			result.blocks.resize(first_result_index);
+		}
+	}
+
+	ERR_FAIL_COND(con->end_transaction() == false);
+
+	recycle_connection(con);
+}
+
 int VoxelStreamSQLite::get_used_channels_mask() const {
 	// Assuming all, since that stream can store anything.
 	return VoxelBuffer::ALL_CHANNELS_MASK;
@@ -367,7 +732,16 @@ void VoxelStreamSQLite::flush_cache() {
 }
 
 void VoxelStreamSQLite::flush() {
-	flush_cache();
+	sqlite::Connection *con = get_connection();
+	ERR_FAIL_COND(con == nullptr);
+	flush_cache_to_connection(con);
+	// Saved after blocks, so it doesn't claim to contain blocks that aren't in the database
+	save_block_keys_cache(*con);
+	recycle_connection(con);
+}
+
+int64_t VoxelStreamSQLite::get_memory_usage_bytes() const {
+	return _cache.get_memory_usage();
 }
 
 // This function does not lock any mutex for internal use.
@@ -380,54 +754,100 @@ void VoxelStreamSQLite::flush_cache_to_connection(sqlite::Connection *p_connecti
 
 	StdVector<uint8_t> &temp_data = get_tls_temp_block_data();
 	StdVector<uint8_t> &temp_compressed_data = get_tls_temp_compressed_block_data();
+	StdVector<uint8_t> &temp_voxel_data = get_tls_temp_voxel_block_data();
 
 	const BlockLocation::CoordinateFormat coordinate_format = p_connection->get_meta().coordinate_format;
 	const Box3i coordinate_range = BlockLocation::get_coordinate_range(coordinate_format);
 	const unsigned int lod_count = BlockLocation::get_lod_count(coordinate_format);
 
-	// TODO Needs better error rollback handling
-	_cache.flush([p_connection, &temp_data, &temp_compressed_data, coordinate_range, lod_count](
-						 VoxelStreamCache::Block &block
-				 ) {
-		ZN_ASSERT_RETURN(validate_range(block.position, block.lod, coordinate_range, lod_count));
+	const CompressedData::Compression compression = to_internal_compression(_compression_mode);
+	CompressedData::ZstdOptions zstd_options;
+	zstd_options.compression_level = _zstd_compression_level;
 
-		BlockLocation loc;
-		loc.position = block.position;
-		loc.lod = block.lod;
+	RWLockRead dictionaries_rlock(_zstd_dictionaries_lock);
+	if (_zstd_dictionaries.size() > 0) {
+		zstd_options.dictionary = _zstd_dictionaries.back().get();
+	}
 
-		// Save voxels
-		if (block.has_voxels) {
-			if (block.voxels_deleted) {
-				p_connection->save_block(loc, Span<const uint8_t>(), sqlite::Connection::VOXELS);
-			} else {
-				BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(block.voxels);
-				ERR_FAIL_COND(!res.success);
-				p_connection->save_block(loc, to_span(res.data), sqlite::Connection::VOXELS);
-			}
-		}
+	// Bytes written since the beginning of the current transaction
+	size_t transaction_size = 0;
 
-		// Save instances
-		temp_compressed_data.clear();
-		if (block.instances != nullptr) {
-			temp_data.clear();
+	// TODO Needs better error rollback handling
+	_cache.flush(
+			[p_connection,
+			 &temp_data,
+			 &temp_compressed_data,
+			 &temp_voxel_data,
+			 coordinate_range,
+			 lod_count,
+			 compression,
+			 &zstd_options,
+			 &transaction_size](const VoxelStreamCache::Block &block) {
+				ZN_ASSERT_RETURN(validate_range(block.position, block.lod, coordinate_range, lod_count));
+
+				BlockLocation loc;
+				loc.position = block.position;
+				loc.lod = block.lod;
+
+				// Save voxels
+				if (block.has_voxels) {
+					if (block.voxels_deleted) {
+						p_connection->save_block(loc, Span<const uint8_t>(), sqlite::Connection::VOXELS);
+					} else {
+						// Only grows, so blocks can be serialized without allocating memory nor copying the result
+						const size_t size_bound =
+								BlockSerializer::get_serialized_and_compressed_size_bound(block.voxels, compression);
+						if (temp_voxel_data.size() < size_bound) {
+							temp_voxel_data.resize(size_bound);
+						}
+						size_t size = 0;
+						ERR_FAIL_COND(!BlockSerializer::serialize_and_compress(
+								block.voxels, to_span(temp_voxel_data), size, compression, zstd_options
+						));
+						p_connection->save_block(
+								loc, Span<const uint8_t>(temp_voxel_data.data(), size), sqlite::Connection::VOXELS
+						);
+						transaction_size += size;
+					}
+				}
 
-			ERR_FAIL_COND(!serialize_instance_block_data(*block.instances, temp_data));
+				// Save instances. They are in a separate table, so blocks which only had voxels saved don't touch it.
+				if (block.has_instances) {
+					temp_compressed_data.clear();
+					if (block.instances != nullptr) {
+						temp_data.clear();
 
-			ERR_FAIL_COND(!CompressedData::compress(
-					to_span_const(temp_data), temp_compressed_data, CompressedData::COMPRESSION_NONE
-			));
-		}
-		p_connection->save_block(loc, to_span(temp_compressed_data), sqlite::Connection::INSTANCES);
+						ERR_FAIL_COND(!serialize_instance_block_data(*block.instances, temp_data));
 
-		// TODO Optimization: add a version of the query that can update both at once
-	});
+						ERR_FAIL_COND(!CompressedData::compress(
+								to_span_const(temp_data), temp_compressed_data, CompressedData::COMPRESSION_NONE
+						));
+					}
+					p_connection->save_block(loc, to_span(temp_compressed_data), sqlite::Connection::INSTANCES);
+					transaction_size += temp_compressed_data.size();
+				}
 
-	ERR_FAIL_COND(p_connection->end_transaction() == false);
+				// Committing large flushes in parts bounds how long the database stays locked for writing, and how
+				// much the journal grows. Blocks remain in the cache until the end, so they can't be seen partially
+				// written.
+				if (transaction_size >= TRANSACTION_MAX_BYTES) {
+					ERR_FAIL_COND(p_connection->end_transaction() == false);
+					ERR_FAIL_COND(p_connection->begin_transaction() == false);
+					transaction_size = 0;
+				}
+			},
+			[p_connection]() {
+				// Must be committed before blocks get removed from the cache, otherwise other connections could load
+				// older versions of them
+				ERR_FAIL_COND(p_connection->end_transaction() == false);
+			}
+	);
 }
 
 Connection *VoxelStreamSQLite::get_connection() {
 	StdString fpath;
 	CoordinateFormat preferred_coordinate_format;
+	bool wal_enabled;
 	{
 		MutexLock mlock(_connection_mutex);
 
@@ -442,22 +862,27 @@ Connection *VoxelStreamSQLite::get_connection() {
 		// First connection we get since we set the database path
 		fpath = _globalized_connection_path;
 		preferred_coordinate_format = _preferred_coordinate_format;
+		wal_enabled = _wal_enabled;
 	}
 
 	if (fpath.empty()) {
 		return nullptr;
 	}
 	sqlite::Connection *con = new sqlite::Connection();
-	if (!con->open(fpath.data(), to_internal_coordinate_format(preferred_coordinate_format))) {
+	if (!con->open(fpath.data(), to_internal_coordinate_format(preferred_coordinate_format), wal_enabled)) {
 		delete con;
 		return nullptr;
 	}
+	bool zstd_dictionaries_loaded;
+	{
+		RWLockRead rlock(_zstd_dictionaries_lock);
+		zstd_dictionaries_loaded = _zstd_dictionaries_loaded;
+	}
+	if (!zstd_dictionaries_loaded) {
+		load_zstd_dictionaries(*con);
+	}
 	if (_block_keys_cache_enabled) {
-		RWLockWrite wlock(_block_keys_cache.rw_lock);
-		con->load_all_block_keys(&_block_keys_cache, [](void *ctx, BlockLocation loc) {
-			BlockKeysCache *cache = static_cast<BlockKeysCache *>(ctx);
-			cache->add_no_lock(loc.position, loc.lod);
-		});
+		load_block_keys_cache(*con);
 	}
 	return con;
 }
@@ -483,6 +908,107 @@ bool VoxelStreamSQLite::is_key_cache_enabled() const {
 	return _block_keys_cache_enabled;
 }
 
+void VoxelStreamSQLite::set_key_cache_persistent(bool enable) {
+	_block_keys_cache_persistent = enable;
+}
+
+bool VoxelStreamSQLite::is_key_cache_persistent() const {
+	return _block_keys_cache_persistent;
+}
+
+void VoxelStreamSQLite::load_block_keys_cache(sqlite::Connection &con) {
+	ZN_PROFILE_SCOPE();
+
+	MutexLock lock(_block_keys_cache_load_mutex);
+	if (_block_keys_cache_loaded) {
+		return;
+	}
+	_block_keys_cache_loaded = true;
+
+	if (_block_keys_cache_persistent) {
+		StdVector<uint8_t> data;
+		if (con.load_block_key_index(data) && data.size() > 0 && _block_keys_cache.deserialize(to_span(data))) {
+			// Blocks could have been saved without updating the index, if the stream wasn't flushed before the game
+			// closed, or if they were saved by a version that didn't support it
+			if (static_cast<int64_t>(_block_keys_cache.get_block_count()) == con.get_block_count()) {
+				_block_keys_cache_saved_count = _block_keys_cache.get_block_count();
+				return;
+			}
+			ZN_PRINT_VERBOSE("VoxelStreamSQLite: saved key cache is outdated, rebuilding it");
+		}
+	}
+
+	_block_keys_cache.clear();
+	{
+		RWLockWrite wlock(_block_keys_cache.get_lock());
+		con.load_all_block_keys(sqlite::Connection::VOXELS, &_block_keys_cache, add_block_key_no_lock);
+	}
+	// Not saved yet
+	_block_keys_cache_saved_count = std::numeric_limits<uint64_t>::max();
+}
+
+void VoxelStreamSQLite::load_instance_block_keys_cache(sqlite::Connection &con) {
+	MutexLock lock(_block_keys_cache_load_mutex);
+	if (_instance_block_keys_cache_loaded) {
+		return;
+	}
+	_instance_block_keys_cache_loaded = true;
+
+	ZN_PROFILE_SCOPE();
+
+	_instance_block_keys_cache.clear();
+	RWLockWrite wlock(_instance_block_keys_cache.get_lock());
+	con.load_all_block_keys(sqlite::Connection::INSTANCES, &_instance_block_keys_cache, add_block_key_no_lock);
+}
+
+bool VoxelStreamSQLite::has_unsaved_block_keys() {
+	if (!_block_keys_cache_enabled || !_block_keys_cache_persistent) {
+		return false;
+	}
+	MutexLock lock(_block_keys_cache_load_mutex);
+	return _block_keys_cache_loaded && _block_keys_cache.get_block_count() != _block_keys_cache_saved_count;
+}
+
+void VoxelStreamSQLite::save_block_keys_cache(sqlite::Connection &con) {
+	if (!_block_keys_cache_enabled || !_block_keys_cache_persistent) {
+		return;
+	}
+
+	MutexLock lock(_block_keys_cache_load_mutex);
+	if (!_block_keys_cache_loaded) {
+		// Nothing was loaded, the database is untouched
+		return;
+	}
+	// Keys are never removed, so the count tells if any were added
+	const uint64_t block_count = _block_keys_cache.get_block_count();
+	if (block_count == _block_keys_cache_saved_count) {
+		return;
+	}
+
+	StdVector<uint8_t> data;
+	_block_keys_cache.serialize(data);
+	ZN_ASSERT_RETURN(con.save_block_key_index(to_span(data)));
+	_block_keys_cache_saved_count = block_count;
+}
+
+void VoxelStreamSQLite::set_wal_enabled(bool enable) {
+	MutexLock lock(_connection_mutex);
+	if (enable == _wal_enabled) {
+		return;
+	}
+	_wal_enabled = enable;
+	// Connections will be opened again with the new setting. Those currently in use will still be recycled.
+	for (auto it = _connection_pool.begin(); it != _connection_pool.end(); ++it) {
+		delete *it;
+	}
+	_connection_pool.clear();
+}
+
+bool VoxelStreamSQLite::is_wal_enabled() const {
+	MutexLock lock(_connection_mutex);
+	return _wal_enabled;
+}
+
 Box3i VoxelStreamSQLite::get_supported_block_range() const {
 	// const Connection *con = get_connection();
 	// const CoordinateFormat format = con != nullptr ? con->get_meta().coordinate_format :
@@ -541,22 +1067,140 @@ bool VoxelStreamSQLite::copy_blocks_to_other_sqlite_stream(Ref<VoxelStreamSQLite
 	struct Context {
 		sqlite::Connection *dst_con;
 
-		static void save(
-				void *cb_data,
-				BlockLocation location,
-				Span<const uint8_t> voxel_data,
-				Span<const uint8_t> instances_data
-		) {
+		static void save_voxels(void *cb_data, BlockLocation location, Span<const uint8_t> voxel_data) {
 			Context *ctx = static_cast<Context *>(cb_data);
 			ctx->dst_con->save_block(location, voxel_data, sqlite::Connection::VOXELS);
+		}
+
+		static void save_instances(void *cb_data, BlockLocation location, Span<const uint8_t> instances_data) {
+			Context *ctx = static_cast<Context *>(cb_data);
 			ctx->dst_con->save_block(location, instances_data, sqlite::Connection::INSTANCES);
 		}
 	};
 
 	Context context;
 	context.dst_con = dst_stream->get_connection();
+	ZN_ASSERT_RETURN_V(context.dst_con != nullptr, false);
 
-	return src_con->load_all_blocks(&context, Context::save);
+	// Blocks compressed with dictionaries can't be read without them
+	{
+		RWLockRead rlock(_zstd_dictionaries_lock);
+		for (const std::shared_ptr<CompressedData::ZstdDictionary> &dictionary : _zstd_dictionaries) {
+			ZN_ASSERT_RETURN_V(context.dst_con->save_zstd_dictionary(dictionary->get_data()), false);
+		}
+	}
+	dst_stream->load_zstd_dictionaries(*context.dst_con);
+
+	return src_con->load_all_blocks(sqlite::Connection::VOXELS, &context, Context::save_voxels) &&
+			src_con->load_all_blocks(sqlite::Connection::INSTANCES, &context, Context::save_instances);
+}
+
+void VoxelStreamSQLite::set_compression_mode(CompressionMode mode) {
+	ZN_ASSERT_RETURN(mode >= 0 && mode < COMPRESSION_MODE_COUNT);
+	ZN_ASSERT_RETURN_MSG(
+			mode != COMPRESSION_ZSTD || CompressedData::is_zstd_supported(), "This build does not include Zstd"
+	);
+	_compression_mode = mode;
+}
+
+VoxelStreamSQLite::CompressionMode VoxelStreamSQLite::get_compression_mode() const {
+	return _compression_mode;
+}
+
+void VoxelStreamSQLite::set_zstd_compression_level(int level) {
+	ZN_ASSERT_RETURN(
+			level >= CompressedData::ZSTD_MIN_COMPRESSION_LEVEL && level <= CompressedData::ZSTD_MAX_COMPRESSION_LEVEL
+	);
+	RWLockWrite wlock(_zstd_dictionaries_lock);
+	if (level == _zstd_compression_level) {
+		return;
+	}
+	_zstd_compression_level = level;
+	// Dictionaries are prepared for a specific level
+	for (std::shared_ptr<CompressedData::ZstdDictionary> &dictionary : _zstd_dictionaries) {
+		std::shared_ptr<CompressedData::ZstdDictionary> new_dictionary =
+				CompressedData::ZstdDictionary::create(dictionary->get_data(), level);
+		ZN_ASSERT_CONTINUE(new_dictionary != nullptr);
+		dictionary = new_dictionary;
+	}
+}
+
+int VoxelStreamSQLite::get_zstd_compression_level() const {
+	return _zstd_compression_level;
+}
+
+void VoxelStreamSQLite::load_zstd_dictionaries(sqlite::Connection &con) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<StdVector<uint8_t>> dictionaries_data;
+	ZN_ASSERT_RETURN(con.load_zstd_dictionaries(dictionaries_data));
+
+	RWLockWrite wlock(_zstd_dictionaries_lock);
+	_zstd_dictionaries.clear();
+	for (const StdVector<uint8_t> &data : dictionaries_data) {
+		std::shared_ptr<CompressedData::ZstdDictionary> dictionary =
+				CompressedData::ZstdDictionary::create(to_span(data), _zstd_compression_level);
+		ZN_ASSERT_CONTINUE(dictionary != nullptr);
+		_zstd_dictionaries.push_back(dictionary);
+	}
+	_zstd_dictionaries_loaded = true;
+}
+
+bool VoxelStreamSQLite::train_zstd_dictionary(int sample_count, int max_size_bytes) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_V_MSG(CompressedData::is_zstd_supported(), false, "This build does not include Zstd");
+	ZN_ASSERT_RETURN_V(sample_count > 0, false);
+	ZN_ASSERT_RETURN_V(max_size_bytes > 0, false);
+
+	// Recently saved blocks should be sampled too
+	flush_cache();
+
+	sqlite::Connection *con = get_connection();
+	ZN_ASSERT_RETURN_V(con != nullptr, false);
+
+	struct Context {
+		StdVector<StdVector<uint8_t>> samples;
+		Span<const std::shared_ptr<CompressedData::ZstdDictionary>> zstd_dictionaries;
+
+		static void add_sample(void *cb_data, Span<const uint8_t> voxel_data) {
+			Context *ctx = static_cast<Context *>(cb_data);
+			// Dictionaries apply to uncompressed data
+			StdVector<uint8_t> &sample = ctx->samples.emplace_back();
+			if (!CompressedData::decompress(voxel_data, sample, ctx->zstd_dictionaries)) {
+				ctx->samples.pop_back();
+			}
+		}
+	};
+
+	Context context;
+	bool load_result;
+	{
+		RWLockRead rlock(_zstd_dictionaries_lock);
+		context.zstd_dictionaries = to_span_const(_zstd_dictionaries);
+		load_result = con->load_random_voxel_blocks(sample_count, &context, Context::add_sample);
+	}
+
+	StdVector<uint8_t> dictionary_data;
+	if (load_result) {
+		StdVector<Span<const uint8_t>> samples;
+		samples.reserve(context.samples.size());
+		for (const StdVector<uint8_t> &sample : context.samples) {
+			samples.push_back(to_span(sample));
+		}
+		CompressedData::build_zstd_dictionary(to_span_const(samples), max_size_bytes, dictionary_data);
+	}
+
+	bool success = false;
+	if (dictionary_data.size() == 0) {
+		ZN_PRINT_ERROR("Could not find enough data in common between blocks to build a dictionary");
+
+	} else if (con->save_zstd_dictionary(to_span_const(dictionary_data))) {
+		load_zstd_dictionaries(*con);
+		success = true;
+	}
+
+	recycle_connection(con);
+	return success;
 }
 
 void VoxelStreamSQLite::_bind_methods() {
@@ -566,6 +1210,14 @@ void VoxelStreamSQLite::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_key_cache_enabled", "enabled"), &VoxelStreamSQLite::set_key_cache_enabled);
 	ClassDB::bind_method(D_METHOD("is_key_cache_enabled"), &VoxelStreamSQLite::is_key_cache_enabled);
 
+	ClassDB::bind_method(
+			D_METHOD("set_key_cache_persistent", "enabled"), &VoxelStreamSQLite::set_key_cache_persistent
+	);
+	ClassDB::bind_method(D_METHOD("is_key_cache_persistent"), &VoxelStreamSQLite::is_key_cache_persistent);
+
+	ClassDB::bind_method(D_METHOD("set_wal_enabled", "enabled"), &VoxelStreamSQLite::set_wal_enabled);
+	ClassDB::bind_method(D_METHOD("is_wal_enabled"), &VoxelStreamSQLite::is_wal_enabled);
+
 	ClassDB::bind_method(
 			D_METHOD("set_preferred_coordinate_format", "format"), &VoxelStreamSQLite::set_preferred_coordinate_format
 	);
@@ -579,6 +1231,23 @@ void VoxelStreamSQLite::_bind_methods() {
 	BIND_ENUM_CONSTANT(COORDINATE_FORMAT_BLOB80_X25_Y25_Z25_L5);
 	BIND_ENUM_CONSTANT(COORDINATE_FORMAT_COUNT);
 
+	ClassDB::bind_method(D_METHOD("set_compression_mode", "mode"), &VoxelStreamSQLite::set_compression_mode);
+	ClassDB::bind_method(D_METHOD("get_compression_mode"), &VoxelStreamSQLite::get_compression_mode);
+
+	ClassDB::bind_method(
+			D_METHOD("set_zstd_compression_level", "level"), &VoxelStreamSQLite::set_zstd_compression_level
+	);
+	ClassDB::bind_method(D_METHOD("get_zstd_compression_level"), &VoxelStreamSQLite::get_zstd_compression_level);
+
+	ClassDB::bind_method(
+			D_METHOD("train_zstd_dictionary", "sample_count", "max_size_bytes"),
+			&VoxelStreamSQLite::train_zstd_dictionary
+	);
+
+	BIND_ENUM_CONSTANT(COMPRESSION_LZ4);
+	BIND_ENUM_CONSTANT(COMPRESSION_ZSTD);
+	BIND_ENUM_CONSTANT(COMPRESSION_MODE_COUNT);
+
 	ADD_PROPERTY(
 			PropertyInfo(Variant::STRING, "database_path", PROPERTY_HINT_FILE), "set_database_path", "get_database_path"
 	);
@@ -593,6 +1262,20 @@ void VoxelStreamSQLite::_bind_methods() {
 			"set_database_path",
 			"get_database_path"
 	);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "wal_enabled"), "set_wal_enabled", "is_wal_enabled");
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "compression_mode", PROPERTY_HINT_ENUM, "LZ4,Zstd"),
+			"set_compression_mode",
+			"get_compression_mode"
+	);
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "zstd_compression_level", PROPERTY_HINT_RANGE, "1,22"),
+			"set_zstd_compression_level",
+			"get_zstd_compression_level"
+	);
 }
 
 } // namespace zylann::voxel
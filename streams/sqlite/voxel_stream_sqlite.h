@@ -1,13 +1,14 @@
 #ifndef VOXEL_STREAM_SQLITE_H
 #define VOXEL_STREAM_SQLITE_H
 
-#include "../../util/containers/std_unordered_set.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/string/std_string.h"
 #include "../../util/thread/mutex.h"
+#include "../compressed_data.h"
 #include "../voxel_block_serializer.h"
 #include "../voxel_stream.h"
 #include "../voxel_stream_cache.h"
+#include "block_key_index.h"
 
 namespace zylann::voxel::sqlite {
 class Connection;
@@ -20,6 +21,8 @@ class VoxelStreamSQLite : public VoxelStream {
 	GDCLASS(VoxelStreamSQLite, VoxelStream)
 public:
 	static const unsigned int CACHE_SIZE = 64;
+	// When flushing the cache, blocks are written in transactions of about this size
+	static const unsigned int TRANSACTION_MAX_BYTES = 1024 * 1024;
 
 	VoxelStreamSQLite();
 	~VoxelStreamSQLite();
@@ -41,20 +44,51 @@ public:
 	void load_instance_blocks(Span<VoxelStream::InstancesQueryData> out_blocks) override;
 	void save_instance_blocks(Span<VoxelStream::InstancesQueryData> p_blocks) override;
 
+	bool supports_mesh_blocks() const override;
+	void load_mesh_blocks(Span<VoxelStream::MeshesQueryData> out_blocks) override;
+	void save_mesh_blocks(Span<VoxelStream::MeshesQueryData> p_blocks) override;
+
+	// Compressed blocks are written directly to the database, without going through the cache.
+	bool supports_compressed_voxel_blocks() const override;
+	void load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> out_blocks) override;
+	void save_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData> p_blocks) override;
+	// Not portable when the database has Zstd dictionaries, or when no connection was opened yet to find out.
+	bool has_portable_compressed_voxel_blocks() const override;
+
+	// Blocks still in the cache are written to the database first.
+	bool get_voxel_block_keys(StdVector<BlockKey> &out_keys) override;
+
 	bool supports_loading_all_blocks() const override {
 		return true;
 	}
 	void load_all_blocks(FullLoadingResult &result) override;
+	bool decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const override;
+	bool compress_voxel_block(const VoxelBuffer &voxels, StdVector<uint8_t> &out_data) const override;
+
+	// With integer coordinate formats, blocks are fetched with one range query per column of blocks along Z.
+	void load_voxel_blocks_in_box(Box3i box_in_blocks, uint8_t lod_index, FullLoadingResult &result) override;
 
 	int get_used_channels_mask() const override;
 
 	void flush() override;
 	void flush_cache();
 
+	int64_t get_memory_usage_bytes() const override;
+
 	// Might improve query performance if saved data is very sparse (like when only edited blocks are saved).
 	void set_key_cache_enabled(bool enable);
 	bool is_key_cache_enabled() const;
 
+	// Saves the key cache in the database when flushing, so it doesn't have to be rebuilt from all blocks next time the
+	// database is opened. Has no effect if the key cache is not enabled.
+	void set_key_cache_persistent(bool enable);
+	bool is_key_cache_persistent() const;
+
+	// Switches the database to write-ahead logging when connections are opened. Threads loading blocks can then run in
+	// parallel, without waiting for a thread saving blocks. The database remains in that mode after being closed.
+	void set_wal_enabled(bool enable);
+	bool is_wal_enabled() const;
+
 	Box3i get_supported_block_range() const override;
 	int get_lod_count() const override;
 
@@ -73,45 +107,31 @@ public:
 
 	bool copy_blocks_to_other_sqlite_stream(Ref<VoxelStreamSQLite> dst_stream);
 
-private:
-	void rebuild_key_cache();
-
-	struct BlockKeysCache {
-		FixedArray<StdUnorderedSet<Vector3i>, constants::MAX_LOD> lods;
-		RWLock rw_lock;
-
-		inline bool contains(Vector3i bpos, unsigned int lod_index) const {
-			const StdUnorderedSet<Vector3i> &keys = lods[lod_index];
-			RWLockRead rlock(rw_lock);
-			return keys.find(bpos) != keys.end();
-		}
-
-		inline void add_no_lock(Vector3i bpos, unsigned int lod_index) {
-			lods[lod_index].insert(bpos);
-		}
-
-		inline void add(Vector3i bpos, unsigned int lod_index) {
-			RWLockWrite wlock(rw_lock);
-			add_no_lock(bpos, lod_index);
-		}
-
-		inline void clear() {
-			RWLockWrite wlock(rw_lock);
-			for (unsigned int i = 0; i < lods.size(); ++i) {
-				lods[i].clear();
-			}
-		}
-
-		// inline size_t get_memory_usage() const {
-		// 	size_t mem = 0;
-		// 	for (unsigned int i = 0; i < lods.size(); ++i) {
-		// 		const StdUnorderedSet<Vector3i> &keys = lods[i];
-		// 		mem += sizeof(Vector3i) * keys.size();
-		// 	}
-		// 	return mem;
-		// }
+	enum CompressionMode {
+		COMPRESSION_LZ4 = 0,
+		COMPRESSION_ZSTD,
+		COMPRESSION_MODE_COUNT
 	};
 
+	// Compression used when saving blocks. Blocks saved with another mode remain readable.
+	void set_compression_mode(CompressionMode mode);
+	CompressionMode get_compression_mode() const;
+
+	void set_zstd_compression_level(int level);
+	int get_zstd_compression_level() const;
+
+	// Builds a Zstd dictionary from blocks picked randomly in the database, and stores it in the database. Blocks
+	// saved afterward with Zstd will use it, which makes them much smaller. Blocks saved with previous dictionaries
+	// remain readable.
+	bool train_zstd_dictionary(int sample_count, int max_size_bytes);
+
+private:
+	void load_block_keys_cache(sqlite::Connection &con);
+	void load_instance_block_keys_cache(sqlite::Connection &con);
+	void save_block_keys_cache(sqlite::Connection &con);
+	bool has_unsaved_block_keys();
+	void load_zstd_dictionaries(sqlite::Connection &con);
+
 	// An SQlite3 database is safe to use with multiple threads in serialized mode,
 	// but after having a look at the implementation while stepping with a debugger, here are what actually happens:
 	//
@@ -125,6 +145,10 @@ private:
 	//
 	// Because of this, in our use case, it might be simpler to just leave SQLite in thread-safe mode,
 	// and synchronize ourselves.
+	//
+	// 3) The mutex from (2) belongs to the connection. Each thread takes its own connection from the pool, so they
+	//    don't share it. However, with the default rollback journal, readers and writers of the file still exclude
+	//    each other, so WAL mode has to be enabled for them to actually run in parallel.
 
 	sqlite::Connection *get_connection();
 	void recycle_connection(sqlite::Connection *con);
@@ -144,17 +168,35 @@ private:
 	// Therefore testing if a block is present is the beginning of the most frequently executed code path.
 	// In configurations where only edited blocks get saved, very few blocks even get stored in the database,
 	// so it makes sense to cache keys to make this query fast and concurrent.
-	// Note: in the long term, on a game that systematically saves everything it generates instead of just edits,
-	// such a cache can become quite large. In this case we could either allow turning it off, or use an octree.
-	BlockKeysCache _block_keys_cache;
+	// Keys are stored in groups of neighbor blocks, so it remains small even in games saving everything they generate.
+	sqlite::BlockKeyIndex _block_keys_cache;
 	bool _block_keys_cache_enabled = false;
+	bool _block_keys_cache_persistent = false;
+	// The cache is filled once, by the first connection opened
+	bool _block_keys_cache_loaded = false;
+	// Block count of the key cache when it was last saved in the database
+	uint64_t _block_keys_cache_saved_count = 0;
+	// Instance blocks are stored in a separate table, and usually are much fewer. Their keys are only loaded once
+	// instances are requested, and are not saved.
+	sqlite::BlockKeyIndex _instance_block_keys_cache;
+	bool _instance_block_keys_cache_loaded = false;
+	Mutex _block_keys_cache_load_mutex;
+	bool _wal_enabled = false;
 	// Format that will be used when creating new databases. May not necessarily match the format actually used by
 	// existing databases.
 	CoordinateFormat _preferred_coordinate_format = COORDINATE_FORMAT_STRING_CSD;
+	CompressionMode _compression_mode = COMPRESSION_LZ4;
+	int _zstd_compression_level = CompressedData::ZSTD_DEFAULT_COMPRESSION_LEVEL;
+	// Dictionaries stored in the database, in the order they were created. The last one is used for compression,
+	// others are needed to decompress older blocks.
+	StdVector<std::shared_ptr<CompressedData::ZstdDictionary>> _zstd_dictionaries;
+	bool _zstd_dictionaries_loaded = false;
+	RWLock _zstd_dictionaries_lock;
 };
 
 } // namespace zylann::voxel
 
 VARIANT_ENUM_CAST(zylann::voxel::VoxelStreamSQLite::CoordinateFormat);
+VARIANT_ENUM_CAST(zylann::voxel::VoxelStreamSQLite::CompressionMode);
 
 #endif // VOXEL_STREAM_SQLITE_H
@@ -246,14 +246,17 @@ Error Data::_load_from_file(String fpath) {
 			model->size = last_size;
 
 			const uint32_t num_voxels = f.get_32();
+			ERR_FAIL_COND_V(uint64_t(num_voxels) * 4 + 4 > chunk_size, ERR_PARSE_ERROR);
+
+			// Read all voxels at once, reading them one by one is very slow on large models
+			static thread_local StdVector<uint8_t> tls_xyzi;
+			tls_xyzi.resize(num_voxels * 4);
+			ERR_FAIL_COND_V(godot::get_buffer(f, to_span(tls_xyzi)) != tls_xyzi.size(), ERR_PARSE_ERROR);
 
 			for (uint32_t i = 0; i < num_voxels; ++i) {
-				Vector3i pos;
-				pos.x = f.get_8();
-				pos.y = f.get_8();
-				pos.z = f.get_8();
-				const uint32_t c = f.get_8();
-				pos = magica_to_opengl(pos);
+				const uint8_t *xyzi = &tls_xyzi[i * 4];
+				const Vector3i pos = magica_to_opengl(Vector3i(xyzi[0], xyzi[1], xyzi[2]));
+				const uint32_t c = xyzi[3];
 				ERR_FAIL_COND_V(pos.x >= model->size.x || pos.x < 0, ERR_PARSE_ERROR);
 				ERR_FAIL_COND_V(pos.y >= model->size.y || pos.y < 0, ERR_PARSE_ERROR);
 				ERR_FAIL_COND_V(pos.z >= model->size.z || pos.z < 0, ERR_PARSE_ERROR);
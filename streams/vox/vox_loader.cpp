@@ -2,7 +2,13 @@
 #include "../../meshers/cubes/voxel_color_palette.h"
 #include "../../storage/voxel_buffer_gd.h"
 #include "../../util/dstack.h"
+#include "../../util/math/box3i.h"
+#include "../../util/profiling.h"
+#include "../../util/thread/thread.h"
+#include "../voxel_stream.h"
 #include "vox_data.h"
+#include <algorithm>
+#include <atomic>
 
 namespace zylann::voxel {
 
@@ -79,6 +85,353 @@ int /*Error*/ VoxelVoxLoader::load_from_file(
 	return load_err;
 }
 
+namespace {
+
+// Rotations in MagicaVoxel scenes are multiples of 90 degrees, so they can be applied to voxels exactly.
+// Coordinates are doubled so cell centers are integers too.
+struct VoxTransform {
+	// Rows of the rotation matrix
+	FixedArray<Vector3i, 3> rows;
+	Vector3i translation;
+
+	static VoxTransform from_node(const magica::TransformNode &node) {
+		VoxTransform t;
+		for (unsigned int i = 0; i < 3; ++i) {
+			const Vector3 row = node.rotation.basis.rows[i];
+			t.rows[i] = Vector3i(Math::round(row.x), Math::round(row.y), Math::round(row.z));
+		}
+		t.translation = node.position * 2;
+		return t;
+	}
+
+	static VoxTransform identity() {
+		VoxTransform t;
+		t.rows[0] = Vector3i(1, 0, 0);
+		t.rows[1] = Vector3i(0, 1, 0);
+		t.rows[2] = Vector3i(0, 0, 1);
+		return t;
+	}
+
+	inline Vector3i rotate(Vector3i v) const {
+		return Vector3i(
+				rows[0].x * v.x + rows[0].y * v.y + rows[0].z * v.z,
+				rows[1].x * v.x + rows[1].y * v.y + rows[1].z * v.z,
+				rows[2].x * v.x + rows[2].y * v.y + rows[2].z * v.z
+		);
+	}
+
+	inline Vector3i rotate_inverse(Vector3i v) const {
+		// The matrix is orthogonal, so its inverse is its transpose
+		return Vector3i(
+				rows[0].x * v.x + rows[1].x * v.y + rows[2].x * v.z,
+				rows[0].y * v.x + rows[1].y * v.y + rows[2].y * v.z,
+				rows[0].z * v.x + rows[1].z * v.y + rows[2].z * v.z
+		);
+	}
+
+	VoxTransform operator*(const VoxTransform &child) const {
+		VoxTransform t;
+		for (unsigned int i = 0; i < 3; ++i) {
+			t.rows[i] = Vector3i(
+					rows[i].x * child.rows[0].x + rows[i].y * child.rows[1].x + rows[i].z * child.rows[2].x,
+					rows[i].x * child.rows[0].y + rows[i].y * child.rows[1].y + rows[i].z * child.rows[2].y,
+					rows[i].x * child.rows[0].z + rows[i].y * child.rows[1].z + rows[i].z * child.rows[2].z
+			);
+		}
+		t.translation = translation + rotate(child.translation);
+		return t;
+	}
+};
+
+struct VoxInstance {
+	const magica::Model *model;
+	// From doubled model coordinates relative to the pivot, to doubled world coordinates
+	VoxTransform transform;
+	// Doubled
+	Vector3i pivot;
+	Box3i world_box;
+
+	inline Vector3i model_to_world(Vector3i pos) const {
+		const Vector3i w = transform.rotate(pos * 2 + Vector3i(1, 1, 1) - pivot) + transform.translation;
+		// Cell centers are odd, so halving gives the cell containing them
+		return Vector3i(w.x >> 1, w.y >> 1, w.z >> 1);
+	}
+
+	inline Vector3i world_to_model(Vector3i pos) const {
+		const Vector3i m = transform.rotate_inverse(pos * 2 + Vector3i(1, 1, 1) - transform.translation) + pivot;
+		return Vector3i(m.x >> 1, m.y >> 1, m.z >> 1);
+	}
+};
+
+void add_instance(
+		const magica::Model &model,
+		const VoxTransform &transform,
+		Vector3i origin,
+		StdVector<VoxInstance> &instances
+) {
+	if (Vector3iUtil::get_volume(model.size) == 0) {
+		return;
+	}
+	VoxInstance instance;
+	instance.model = &model;
+	instance.transform = transform;
+	instance.transform.translation += origin * 2;
+	// Same pivot as the scene importer, which is at the center in MagicaVoxel
+	instance.pivot = (model.size / 2) * 2;
+
+	const Vector3i a = instance.model_to_world(Vector3i());
+	const Vector3i b = instance.model_to_world(model.size - Vector3i(1, 1, 1));
+	const Vector3i min_pos(math::min(a.x, b.x), math::min(a.y, b.y), math::min(a.z, b.z));
+	const Vector3i max_pos(math::max(a.x, b.x), math::max(a.y, b.y), math::max(a.z, b.z));
+	instance.world_box = Box3i::from_min_max(min_pos, max_pos + Vector3i(1, 1, 1));
+
+	instances.push_back(instance);
+}
+
+Error gather_instances_recursively(
+		const magica::Data &data,
+		int node_id,
+		const VoxTransform &parent_transform,
+		Vector3i origin,
+		int depth,
+		StdVector<VoxInstance> &instances
+) {
+	ERR_FAIL_COND_V(depth > 10, ERR_INVALID_DATA);
+	const magica::Node *node = data.get_node(node_id);
+
+	switch (node->type) {
+		case magica::Node::TYPE_TRANSFORM: {
+			const magica::TransformNode *transform_node = reinterpret_cast<const magica::TransformNode *>(node);
+			const VoxTransform transform = parent_transform * VoxTransform::from_node(*transform_node);
+			return gather_instances_recursively(
+					data, transform_node->child_node_id, transform, origin, depth + 1, instances
+			);
+		}
+
+		case magica::Node::TYPE_GROUP: {
+			const magica::GroupNode *group_node = reinterpret_cast<const magica::GroupNode *>(node);
+			for (const int child_node_id : group_node->child_node_ids) {
+				const Error err = gather_instances_recursively(
+						data, child_node_id, parent_transform, origin, depth + 1, instances
+				);
+				ERR_FAIL_COND_V(err != OK, err);
+			}
+		} break;
+
+		case magica::Node::TYPE_SHAPE: {
+			const magica::ShapeNode *shape_node = reinterpret_cast<const magica::ShapeNode *>(node);
+			add_instance(data.get_model(shape_node->model_id), parent_transform, origin, instances);
+		} break;
+
+		default:
+			ERR_FAIL_V(ERR_INVALID_DATA);
+	}
+
+	return OK;
+}
+
+template <typename T>
+bool fill_block(
+		Span<T> dst,
+		const Box3i block_box,
+		Span<const VoxInstance> instances,
+		Span<const uint32_t> instance_indices,
+		const FixedArray<uint16_t, 256> &values
+) {
+	bool not_empty = false;
+
+	// Instances are processed in scene order, so later ones overwrite earlier ones where they overlap
+	for (const uint32_t instance_index : instance_indices) {
+		const VoxInstance &instance = instances[instance_index];
+		const Box3i box = block_box.clipped(instance.world_box);
+		const magica::Model &model = *instance.model;
+
+		box.for_each_cell_zxy([&dst, &block_box, &instance, &model, &values, &not_empty](Vector3i pos) {
+			const Vector3i mpos = instance.world_to_model(pos);
+			const uint8_t ci = model.color_indexes[Vector3iUtil::get_zxy_index(mpos, model.size)];
+			if (ci != 0) {
+				dst[Vector3iUtil::get_zxy_index(pos - block_box.position, block_box.size)] = static_cast<T>(values[ci]);
+				not_empty = true;
+			}
+		});
+	}
+
+	return not_empty;
+}
+
+} // namespace
+
+int /*Error*/ VoxelVoxLoader::load_scene_into_stream(
+		String fpath,
+		Ref<VoxelStream> stream,
+		Vector3i origin,
+		Ref<VoxelColorPalette> palette,
+		godot::VoxelBuffer::ChannelId dst_channel
+) {
+	ZN_DSTACK();
+	ZN_PROFILE_SCOPE();
+	ERR_FAIL_INDEX_V(dst_channel, godot::VoxelBuffer::MAX_CHANNELS, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(stream.is_null(), ERR_INVALID_PARAMETER);
+
+	magica::Data data;
+	const Error load_err = data.load_from_file(fpath);
+	ERR_FAIL_COND_V(load_err != OK, load_err);
+
+	StdVector<VoxInstance> instances;
+	if (data.get_root_node_id() != -1) {
+		const Error err = gather_instances_recursively(
+				data, data.get_root_node_id(), VoxTransform::identity(), origin, 0, instances
+		);
+		ERR_FAIL_COND_V(err != OK, err);
+
+	} else if (data.get_model_count() > 0) {
+		// Some vox files don't have a scene graph. Put the lower corner of the first model at the origin.
+		const magica::Model &model = data.get_model(0);
+		VoxTransform transform = VoxTransform::identity();
+		transform.translation = (model.size / 2) * 2;
+		add_instance(model, transform, origin, instances);
+	}
+
+	// Palette indices are stored as they are, or converted to colors
+	Span<const Color8> src_palette = to_span_const(data.get_palette());
+	VoxelBuffer::Depth depth;
+	FixedArray<uint16_t, 256> values;
+	if (palette.is_valid()) {
+		for (unsigned int i = 0; i < src_palette.size(); ++i) {
+			palette->set_color8(i, src_palette[i]);
+			values[i] = i;
+		}
+		depth = VoxelBuffer::DEPTH_8_BIT;
+	} else {
+		for (unsigned int i = 0; i < src_palette.size(); ++i) {
+			values[i] = src_palette[i].to_u16();
+		}
+		depth = VoxelBuffer::DEPTH_16_BIT;
+	}
+
+	// Find which blocks are touched by which instances
+	const int block_size_po2 = stream->get_block_size_po2();
+	const Vector3i block_size = Vector3iUtil::create(1 << block_size_po2);
+	StdUnorderedMap<Vector3i, StdVector<uint32_t>> block_instances;
+	for (unsigned int instance_index = 0; instance_index < instances.size(); ++instance_index) {
+		const Box3i blocks_box = instances[instance_index].world_box.downscaled(block_size.x);
+		blocks_box.for_each_cell_zxy([&block_instances, instance_index](Vector3i bpos) {
+			block_instances[bpos].push_back(instance_index);
+		});
+	}
+
+	StdVector<Vector3i> block_positions;
+	block_positions.reserve(block_instances.size());
+	for (auto it = block_instances.begin(); it != block_instances.end(); ++it) {
+		block_positions.push_back(it->first);
+	}
+	std::sort(block_positions.begin(), block_positions.end());
+
+	struct Context {
+		Span<const VoxInstance> instances;
+		const StdUnorderedMap<Vector3i, StdVector<uint32_t>> *block_instances;
+		const FixedArray<uint16_t, 256> *values;
+		Span<const Vector3i> block_positions;
+		Vector3i block_size;
+		unsigned int channel;
+		VoxelBuffer::Depth depth;
+		StdVector<UniquePtr<VoxelBuffer>> buffers;
+		StdVector<uint8_t> not_empty;
+		std::atomic_uint32_t next_index = { 0 };
+
+		void run() {
+			for (unsigned int i = next_index++; i < block_positions.size(); i = next_index++) {
+				const Vector3i bpos = block_positions[i];
+				auto it = block_instances->find(bpos);
+				ZN_ASSERT_CONTINUE(it != block_instances->end());
+				const Box3i block_box(bpos * block_size, block_size);
+
+				VoxelBuffer &buffer = *buffers[i];
+				buffer.set_channel_depth(channel, depth);
+				buffer.create(block_size);
+				buffer.decompress_channel(channel);
+				Span<uint8_t> raw;
+				ZN_ASSERT_CONTINUE(buffer.get_channel_as_bytes(channel, raw));
+
+				if (depth == VoxelBuffer::DEPTH_8_BIT) {
+					not_empty[i] = fill_block(raw, block_box, instances, to_span(it->second), *values);
+				} else {
+					not_empty[i] = fill_block(
+							raw.reinterpret_cast_to<uint16_t>(), block_box, instances, to_span(it->second), *values
+					);
+				}
+
+				buffer.compress_uniform_channels();
+			}
+		}
+	};
+
+	// The calling thread fills blocks too
+	const unsigned int MAX_EXTRA_THREADS = 8;
+	const unsigned int extra_thread_count =
+			math::min(math::max(Thread::get_hardware_concurrency(), 1u) - 1, MAX_EXTRA_THREADS);
+	// Limits how many blocks are in memory at once
+	const unsigned int batch_size = 64 * (extra_thread_count + 1);
+
+	StdVector<VoxelStream::VoxelQueryData> queries;
+
+	for (unsigned int batch_begin = 0; batch_begin < block_positions.size(); batch_begin += batch_size) {
+		ZN_PROFILE_SCOPE_NAMED("Batch");
+
+		Context context;
+		context.instances = to_span_const(instances);
+		context.block_instances = &block_instances;
+		context.values = &values;
+		context.block_positions = to_span_from_position_and_size(
+				block_positions,
+				batch_begin,
+				math::min(batch_size, static_cast<unsigned int>(block_positions.size()) - batch_begin)
+		);
+		context.block_size = block_size;
+		context.channel = dst_channel;
+		context.depth = depth;
+		context.buffers.resize(context.block_positions.size());
+		for (UniquePtr<VoxelBuffer> &buffer : context.buffers) {
+			buffer = make_unique_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+		}
+		context.not_empty.resize(context.block_positions.size(), 0);
+
+		FixedArray<Thread, MAX_EXTRA_THREADS> threads;
+		const unsigned int thread_count =
+				math::min(extra_thread_count, static_cast<unsigned int>(context.block_positions.size()) - 1);
+
+		for (unsigned int i = 0; i < thread_count; ++i) {
+			threads[i].start(
+					[](void *p_userdata) {
+						Context *ctx = static_cast<Context *>(p_userdata);
+						ctx->run();
+					},
+					&context
+			);
+		}
+
+		context.run();
+
+		for (unsigned int i = 0; i < thread_count; ++i) {
+			threads[i].wait_to_finish();
+		}
+
+		// Streams are saved from the calling thread only
+		queries.clear();
+		for (unsigned int i = 0; i < context.block_positions.size(); ++i) {
+			if (context.not_empty[i] != 0) {
+				queries.push_back(VoxelStream::VoxelQueryData{
+						*context.buffers[i], context.block_positions[i], 0, VoxelStream::RESULT_ERROR });
+			}
+		}
+		stream->save_voxel_blocks(to_span(queries));
+	}
+
+	stream->flush();
+
+	return OK;
+}
+
 void VoxelVoxLoader::_bind_methods() {
 	ClassDB::bind_static_method(
 			VoxelVoxLoader::get_class_static(),
@@ -86,6 +439,12 @@ void VoxelVoxLoader::_bind_methods() {
 			&VoxelVoxLoader::load_from_file,
 			DEFVAL(godot::VoxelBuffer::CHANNEL_COLOR)
 	);
+	ClassDB::bind_static_method(
+			VoxelVoxLoader::get_class_static(),
+			D_METHOD("load_scene_into_stream", "fpath", "stream", "origin", "palette", "dst_channel"),
+			&VoxelVoxLoader::load_scene_into_stream,
+			DEFVAL(godot::VoxelBuffer::CHANNEL_COLOR)
+	);
 }
 
 } // namespace zylann::voxel
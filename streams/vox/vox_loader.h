@@ -7,6 +7,7 @@
 namespace zylann::voxel {
 
 class VoxelColorPalette;
+class VoxelStream;
 
 // Simple loader for MagicaVoxel
 class VoxelVoxLoader : public RefCounted {
@@ -20,7 +21,17 @@ public:
 			Ref<VoxelColorPalette> palette,
 			godot::VoxelBuffer::ChannelId dst_channel
 	);
-	// TODO Have chunked loading for better memory usage
+
+	// Loads all models of the scene graph at their location and saves them into a stream, split in blocks. Blocks are
+	// filled on multiple threads and saved in batches, so the scene never has to fit in a single buffer.
+	static int /*Error*/ load_scene_into_stream(
+			String fpath,
+			Ref<VoxelStream> stream,
+			Vector3i origin,
+			Ref<VoxelColorPalette> palette,
+			godot::VoxelBuffer::ChannelId dst_channel
+	);
+
 	// TODO Saving
 
 private:
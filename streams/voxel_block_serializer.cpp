@@ -22,6 +22,10 @@ namespace BlockSerializer {
 const unsigned int BLOCK_TRAILING_MAGIC = 0x900df00d;
 const unsigned int BLOCK_TRAILING_MAGIC_SIZE = 4;
 const unsigned int BLOCK_METADATA_HEADER_SIZE = sizeof(uint32_t);
+// Written in place of the X position of a voxel metadata entry to start the section of sparse values, which comes
+// after all voxel metadata. Older versions never write it since it isn't a valid position.
+const uint16_t SPARSE_VALUES_MARKER = 0xffff;
+static_assert(VoxelBuffer::MAX_SIZE <= SPARSE_VALUES_MARKER, "Sparse values marker must not be a valid position");
 
 // Temporary data buffers, re-used to reduce allocations
 
@@ -60,6 +64,32 @@ size_t get_metadata_size_in_bytes(const VoxelMetadata &meta) {
 	return size;
 }
 
+// Keys are ZXY indices, which fit in 16 bits for blocks up to 64x64x16 or 32x32x32 voxels
+unsigned int get_sparse_key_size_in_bytes(const VoxelBuffer &buffer) {
+	return Vector3iUtil::get_volume(buffer.get_size()) <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+unsigned int get_sparse_value_size_in_bytes(const VoxelSparseValues &sparse_values) {
+	for (const uint32_t v : sparse_values.get_values()) {
+		if (v > 0xffff) {
+			return sizeof(uint32_t);
+		}
+	}
+	return sizeof(uint16_t);
+}
+
+size_t get_sparse_values_size_in_bytes(const VoxelBuffer &buffer) {
+	const VoxelSparseValues &sparse_values = buffer.get_voxel_sparse_values();
+	if (sparse_values.size() == 0) {
+		return 0;
+	}
+	// Marker, count, key size, value size
+	const size_t header_size = sizeof(uint16_t) + sizeof(uint32_t) + 2 * sizeof(uint8_t);
+	return header_size +
+			sparse_values.size() *
+			(get_sparse_key_size_in_bytes(buffer) + get_sparse_value_size_in_bytes(sparse_values));
+}
+
 size_t get_metadata_size_in_bytes(const VoxelBuffer &buffer) {
 	size_t size = 0;
 
@@ -89,6 +119,8 @@ size_t get_metadata_size_in_bytes(const VoxelBuffer &buffer) {
 		size += get_metadata_size_in_bytes(it->value);
 	}
 
+	size += get_sparse_values_size_in_bytes(buffer);
+
 	// If no metadata is found at all, nothing is serialized, not even null.
 	// It spares 24 bytes (40 if real_t == double),
 	// and is backward compatible with saves made before introduction of metadata.
@@ -163,6 +195,33 @@ void serialize_metadata(Span<uint8_t> p_dst, const VoxelBuffer &buffer) {
 
 		serialize_metadata(it->value, mw);
 	}
+
+	const VoxelSparseValues &sparse_values = buffer.get_voxel_sparse_values();
+	if (sparse_values.size() > 0) {
+		const unsigned int key_size = get_sparse_key_size_in_bytes(buffer);
+		const unsigned int value_size = get_sparse_value_size_in_bytes(sparse_values);
+
+		mw.store_16(SPARSE_VALUES_MARKER);
+		mw.store_32(sparse_values.size());
+		mw.store_8(key_size);
+		mw.store_8(value_size);
+
+		// Keys and values are stored in separate runs, which compresses better
+		for (const uint32_t key : sparse_values.get_keys()) {
+			if (key_size == sizeof(uint16_t)) {
+				mw.store_16(key);
+			} else {
+				mw.store_32(key);
+			}
+		}
+		for (const uint32_t value : sparse_values.get_values()) {
+			if (value_size == sizeof(uint16_t)) {
+				mw.store_16(value);
+			} else {
+				mw.store_32(value);
+			}
+		}
+	}
 }
 
 template <typename T>
@@ -213,6 +272,47 @@ bool deserialize_metadata(VoxelMetadata &meta, MemoryReader &mr) {
 	return false;
 }
 
+bool deserialize_sparse_values(MemoryReader &mr, VoxelBuffer &buffer) {
+	const uint32_t count = mr.get_32();
+	const unsigned int key_size = mr.get_8();
+	const unsigned int value_size = mr.get_8();
+
+	ZN_ASSERT_RETURN_V_MSG(
+			(key_size == sizeof(uint16_t) || key_size == sizeof(uint32_t)) &&
+					(value_size == sizeof(uint16_t) || value_size == sizeof(uint32_t)),
+			false,
+			format("Invalid sparse value sizes {}, {}", key_size, value_size)
+	);
+	ZN_ASSERT_RETURN_V_MSG(
+			mr.pos + static_cast<size_t>(count) * (key_size + value_size) <= mr.data.size(),
+			false,
+			format("Not enough data for {} sparse values", count)
+	);
+
+	static thread_local StdVector<uint32_t> tls_keys;
+	static thread_local StdVector<uint32_t> tls_values;
+	tls_keys.resize(count);
+	tls_values.resize(count);
+
+	const uint64_t volume = Vector3iUtil::get_volume(buffer.get_size());
+
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t key = key_size == sizeof(uint16_t) ? mr.get_16() : mr.get_32();
+		ZN_ASSERT_RETURN_V_MSG(
+				key < volume && (i == 0 || key > tls_keys[i - 1]),
+				false,
+				format("Invalid sparse value key {} for buffer of size {}", key, buffer.get_size())
+		);
+		tls_keys[i] = key;
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		tls_values[i] = value_size == sizeof(uint16_t) ? mr.get_16() : mr.get_32();
+	}
+
+	buffer.get_voxel_sparse_values().clear_and_set(to_span_const(tls_keys), to_span_const(tls_values));
+	return true;
+}
+
 bool deserialize_metadata(Span<const uint8_t> p_src, VoxelBuffer &buffer) {
 	MemoryReader mr(p_src, ENDIANNESS_LITTLE_ENDIAN);
 
@@ -223,9 +323,17 @@ bool deserialize_metadata(Span<const uint8_t> p_src, VoxelBuffer &buffer) {
 	// Clear when exiting scope (including cases of error) so we don't store dangling Variants
 	ClearOnExit<StdVector<Pair>> clear_tls_pairs{ tls_pairs };
 
+	buffer.get_voxel_sparse_values().clear();
+
 	while (mr.pos < mr.data.size()) {
 		Vector3i pos;
 		pos.x = mr.get_16();
+
+		if (pos.x == SPARSE_VALUES_MARKER) {
+			ZN_ASSERT_RETURN_V(deserialize_sparse_values(mr, buffer), false);
+			break;
+		}
+
 		pos.y = mr.get_16();
 		pos.z = mr.get_16();
 
@@ -249,9 +357,159 @@ bool deserialize_metadata(Span<const uint8_t> p_src, VoxelBuffer &buffer) {
 	return true;
 }
 
+void store_value(MemoryWriterExistingBuffer &f, uint64_t v, VoxelBuffer::Depth depth) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			f.store_8(v);
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			f.store_16(v);
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			f.store_32(v);
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			f.store_64(v);
+			break;
+		default:
+			CRASH_NOW();
+	}
+}
+
+uint64_t get_value(MemoryReader &f, VoxelBuffer::Depth depth) {
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			return f.get_8();
+		case VoxelBuffer::DEPTH_16_BIT:
+			return f.get_16();
+		case VoxelBuffer::DEPTH_32_BIT:
+			return f.get_32();
+		case VoxelBuffer::DEPTH_64_BIT:
+			return f.get_64();
+		default:
+			CRASH_NOW();
+			return 0;
+	}
+}
+
+// Filters applied to uncompressed channels before the block goes through general-purpose compression such as LZ4.
+// They don't change the size of the data, but turn it into something with more repetitions.
+enum ChannelFilter : uint8_t {
+	FILTER_NONE = 0,
+	// Bytes of values are stored in planes: first bytes of all values, then second bytes of all values etc.
+	// Higher bytes of neighboring values are often equal, so they end up in long runs.
+	FILTER_BYTE_PLANES = 1,
+	// Values are replaced with their difference from the previous value along Y (wrapping around), then stored as
+	// byte planes. Suited for smooth data such as SDF, where differences are small.
+	FILTER_DELTA_BYTE_PLANES = 2,
+	FILTER_COUNT
+};
+
+ChannelFilter get_channel_filter(unsigned int channel_index, VoxelBuffer::Depth depth) {
+	if (channel_index == VoxelBuffer::CHANNEL_SDF) {
+		return FILTER_DELTA_BYTE_PLANES;
+	}
+	if (depth != VoxelBuffer::DEPTH_8_BIT) {
+		return FILTER_BYTE_PLANES;
+	}
+	return FILTER_NONE;
+}
+
+// Voxels are in ZXY order, so rows along Y are contiguous and `row_length` is the size of the buffer along Y.
+template <typename T>
+void apply_channel_filter(Span<const uint8_t> src_bytes, Span<uint8_t> dst, unsigned int row_length, bool delta) {
+	Span<const T> src = src_bytes.reinterpret_cast_to<const T>();
+	const size_t count = src.size();
+	for (size_t row_begin = 0; row_begin < count; row_begin += row_length) {
+		T prev = 0;
+		for (size_t i = row_begin; i < row_begin + row_length; ++i) {
+			const T v = src[i];
+			const T filtered = delta ? static_cast<T>(v - prev) : v;
+			prev = v;
+			for (unsigned int b = 0; b < sizeof(T); ++b) {
+				dst[b * count + i] = static_cast<uint8_t>(filtered >> (b * 8));
+			}
+		}
+	}
+}
+
+template <typename T>
+void revert_channel_filter(Span<const uint8_t> src, Span<uint8_t> dst_bytes, unsigned int row_length, bool delta) {
+	Span<T> dst = dst_bytes.reinterpret_cast_to<T>();
+	const size_t count = dst.size();
+	for (size_t row_begin = 0; row_begin < count; row_begin += row_length) {
+		T prev = 0;
+		for (size_t i = row_begin; i < row_begin + row_length; ++i) {
+			T v = 0;
+			for (unsigned int b = 0; b < sizeof(T); ++b) {
+				v |= static_cast<T>(static_cast<T>(src[b * count + i]) << (b * 8));
+			}
+			if (delta) {
+				v = static_cast<T>(v + prev);
+			}
+			prev = v;
+			dst[i] = v;
+		}
+	}
+}
+
+void apply_channel_filter(
+		Span<const uint8_t> src,
+		Span<uint8_t> dst,
+		VoxelBuffer::Depth depth,
+		unsigned int row_length,
+		ChannelFilter filter
+) {
+	ZN_ASSERT(src.size() == dst.size());
+	const bool delta = filter == FILTER_DELTA_BYTE_PLANES;
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			apply_channel_filter<uint8_t>(src, dst, row_length, delta);
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			apply_channel_filter<uint16_t>(src, dst, row_length, delta);
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			apply_channel_filter<uint32_t>(src, dst, row_length, delta);
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			apply_channel_filter<uint64_t>(src, dst, row_length, delta);
+			break;
+		default:
+			CRASH_NOW();
+	}
+}
+
+void revert_channel_filter(
+		Span<const uint8_t> src,
+		Span<uint8_t> dst,
+		VoxelBuffer::Depth depth,
+		unsigned int row_length,
+		ChannelFilter filter
+) {
+	ZN_ASSERT(src.size() == dst.size());
+	const bool delta = filter == FILTER_DELTA_BYTE_PLANES;
+	switch (depth) {
+		case VoxelBuffer::DEPTH_8_BIT:
+			revert_channel_filter<uint8_t>(src, dst, row_length, delta);
+			break;
+		case VoxelBuffer::DEPTH_16_BIT:
+			revert_channel_filter<uint16_t>(src, dst, row_length, delta);
+			break;
+		case VoxelBuffer::DEPTH_32_BIT:
+			revert_channel_filter<uint32_t>(src, dst, row_length, delta);
+			break;
+		case VoxelBuffer::DEPTH_64_BIT:
+			revert_channel_filter<uint64_t>(src, dst, row_length, delta);
+			break;
+		default:
+			CRASH_NOW();
+	}
+}
+
 size_t get_size_in_bytes(const VoxelBuffer &buffer, size_t &metadata_size) {
-	// Version and size
-	size_t size = 1 * sizeof(uint8_t) + 3 * sizeof(uint16_t);
+	// Version, size and SDF quantization factor
+	size_t size = 1 * sizeof(uint8_t) + 3 * sizeof(uint16_t) + sizeof(float);
 
 	const Vector3i size_in_voxels = buffer.get_size();
 
@@ -264,13 +522,34 @@ size_t get_size_in_bytes(const VoxelBuffer &buffer, size_t &metadata_size) {
 
 		switch (compression) {
 			case VoxelBuffer::COMPRESSION_NONE: {
-				size += VoxelBuffer::get_size_in_bytes_for_volume(size_in_voxels, depth);
+				// Filter and data
+				size += 1 + VoxelBuffer::get_size_in_bytes_for_volume(size_in_voxels, depth);
 			} break;
 
 			case VoxelBuffer::COMPRESSION_UNIFORM: {
 				size += VoxelBuffer::get_depth_bit_count(depth) >> 3;
 			} break;
 
+			case VoxelBuffer::COMPRESSION_PALETTE: {
+				const unsigned int index_bits = buffer.get_channel_palette_index_bits(channel_index);
+				// Palette size and index bits
+				size += sizeof(uint16_t) + sizeof(uint8_t);
+				size += buffer.get_channel_palette_size(channel_index) * VoxelBuffer::get_depth_byte_count(depth);
+				size += VoxelBuffer::get_palette_indices_size_in_bytes(
+						Vector3iUtil::get_volume(size_in_voxels), index_bits
+				);
+			} break;
+
+			case VoxelBuffer::COMPRESSION_BRICKS: {
+				Span<const uint16_t> slots;
+				Span<const uint8_t> uniform_values;
+				Span<const uint8_t> dense_bricks;
+				buffer.get_channel_bricks_read_only(channel_index, slots, uniform_values, dense_bricks);
+				// Brick size and dense brick count
+				size += sizeof(uint8_t) + sizeof(uint16_t);
+				size += slots.size() * sizeof(uint16_t) + uniform_values.size() + dense_bricks.size();
+			} break;
+
 			default:
 				ERR_PRINT("Unhandled compression mode");
 				CRASH_NOW();
@@ -287,40 +566,26 @@ size_t get_size_in_bytes(const VoxelBuffer &buffer, size_t &metadata_size) {
 	return size + metadata_size_with_header + BLOCK_TRAILING_MAGIC_SIZE;
 }
 
-SerializeResult serialize(const VoxelBuffer &voxel_buffer) {
+// Writes exactly `get_size_in_bytes` bytes into `dst`, which must have that size.
+bool serialize_to_buffer(const VoxelBuffer &voxel_buffer, Span<uint8_t> dst, size_t expected_metadata_size) {
 	ZN_PROFILE_SCOPE();
 
-	StdVector<uint8_t> &dst_data = get_tls_data();
-	StdVector<uint8_t> &metadata_tmp = get_tls_metadata_tmp();
-	dst_data.clear();
-	metadata_tmp.clear();
-
-	// Cannot serialize an empty block
-	ERR_FAIL_COND_V(Vector3iUtil::get_volume(voxel_buffer.get_size()) == 0, SerializeResult(dst_data, false));
-
-	size_t expected_metadata_size = 0;
-	const size_t expected_data_size = get_size_in_bytes(voxel_buffer, expected_metadata_size);
-	dst_data.reserve(expected_data_size);
-
-	MemoryWriter f(dst_data, ENDIANNESS_LITTLE_ENDIAN);
+	ByteSpanWithPosition dst_with_position(dst, 0);
+	MemoryWriterExistingBuffer f(dst_with_position, ENDIANNESS_LITTLE_ENDIAN);
 
 	f.store_8(BLOCK_FORMAT_VERSION);
 
-	ERR_FAIL_COND_V(
-			voxel_buffer.get_size().x > std::numeric_limits<uint16_t>().max(), SerializeResult(dst_data, false)
-	);
+	ERR_FAIL_COND_V(voxel_buffer.get_size().x > std::numeric_limits<uint16_t>().max(), false);
 	f.store_16(voxel_buffer.get_size().x);
 
-	ERR_FAIL_COND_V(
-			voxel_buffer.get_size().y > std::numeric_limits<uint16_t>().max(), SerializeResult(dst_data, false)
-	);
+	ERR_FAIL_COND_V(voxel_buffer.get_size().y > std::numeric_limits<uint16_t>().max(), false);
 	f.store_16(voxel_buffer.get_size().y);
 
-	ERR_FAIL_COND_V(
-			voxel_buffer.get_size().z > std::numeric_limits<uint16_t>().max(), SerializeResult(dst_data, false)
-	);
+	ERR_FAIL_COND_V(voxel_buffer.get_size().z > std::numeric_limits<uint16_t>().max(), false);
 	f.store_16(voxel_buffer.get_size().z);
 
+	f.store_float(voxel_buffer.get_sdf_quantization_factor());
+
 	for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
 		const VoxelBuffer::Compression compression = voxel_buffer.get_channel_compression(channel_index);
 		const VoxelBuffer::Depth depth = voxel_buffer.get_channel_depth(channel_index);
@@ -332,11 +597,19 @@ SerializeResult serialize(const VoxelBuffer &voxel_buffer) {
 		switch (compression) {
 			case VoxelBuffer::COMPRESSION_NONE: {
 				Span<const uint8_t> data;
-				ERR_FAIL_COND_V(
-						!voxel_buffer.get_channel_as_bytes_read_only(channel_index, data),
-						SerializeResult(dst_data, false)
-				);
-				f.store_buffer(data);
+				ERR_FAIL_COND_V(!voxel_buffer.get_channel_as_bytes_read_only(channel_index, data), false);
+				const ChannelFilter filter = get_channel_filter(channel_index, depth);
+				f.store_8(filter);
+				if (filter == FILTER_NONE) {
+					f.store_buffer(data);
+				} else {
+					// Written in place, the destination already has the exact size
+					const size_t data_begin = dst_with_position.size();
+					dst_with_position.resize(data_begin + data.size());
+					apply_channel_filter(
+							data, dst.sub(data_begin, data.size()), depth, voxel_buffer.get_size().y, filter
+					);
+				}
 			} break;
 
 			case VoxelBuffer::COMPRESSION_UNIFORM: {
@@ -359,6 +632,33 @@ SerializeResult serialize(const VoxelBuffer &voxel_buffer) {
 				}
 			} break;
 
+			case VoxelBuffer::COMPRESSION_PALETTE: {
+				const unsigned int palette_size = voxel_buffer.get_channel_palette_size(channel_index);
+				f.store_16(palette_size);
+				f.store_8(voxel_buffer.get_channel_palette_index_bits(channel_index));
+				for (unsigned int pi = 0; pi < palette_size; ++pi) {
+					store_value(f, voxel_buffer.get_channel_palette_value(channel_index, pi), depth);
+				}
+				Span<const uint8_t> indices;
+				ERR_FAIL_COND_V(!voxel_buffer.get_channel_palette_indices_read_only(channel_index, indices), false);
+				f.store_buffer(indices);
+			} break;
+
+			case VoxelBuffer::COMPRESSION_BRICKS: {
+				Span<const uint16_t> slots;
+				Span<const uint8_t> uniform_values;
+				Span<const uint8_t> dense_bricks;
+				ERR_FAIL_COND_V(
+						!voxel_buffer.get_channel_bricks_read_only(channel_index, slots, uniform_values, dense_bricks),
+						false
+				);
+				f.store_8(voxel_buffer.get_channel_brick_size_po2(channel_index));
+				f.store_16(voxel_buffer.get_channel_dense_brick_count(channel_index));
+				f.store_buffer(slots.reinterpret_cast_to<const uint8_t>());
+				f.store_buffer(uniform_values);
+				f.store_buffer(dense_bricks);
+			} break;
+
 			default:
 				CRASH_COND("Unhandled compression mode");
 		}
@@ -368,20 +668,46 @@ SerializeResult serialize(const VoxelBuffer &voxel_buffer) {
 	// we just discard all metadata as if it was empty.
 	if (expected_metadata_size > 0) {
 		f.store_32(expected_metadata_size);
-		metadata_tmp.resize(expected_metadata_size);
-		// This function brings me joy. </irony>
-		serialize_metadata(to_span(metadata_tmp), voxel_buffer);
-		f.store_buffer(to_span(metadata_tmp));
+		// Written in place, the destination already has the exact size
+		const size_t metadata_begin = dst_with_position.size();
+		dst_with_position.resize(metadata_begin + expected_metadata_size);
+		serialize_metadata(dst.sub(metadata_begin, expected_metadata_size), voxel_buffer);
 	}
 
 	f.store_32(BLOCK_TRAILING_MAGIC);
 
 	// Check out of bounds writing
-	CRASH_COND(dst_data.size() != expected_data_size);
+	CRASH_COND(dst_with_position.size() != dst.size());
+
+	return true;
+}
+
+SerializeResult serialize(const VoxelBuffer &voxel_buffer) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<uint8_t> &dst_data = get_tls_data();
+	dst_data.clear();
+
+	// Cannot serialize an empty block
+	ERR_FAIL_COND_V(Vector3iUtil::get_volume(voxel_buffer.get_size()) == 0, SerializeResult(dst_data, false));
+
+	size_t expected_metadata_size = 0;
+	const size_t expected_data_size = get_size_in_bytes(voxel_buffer, expected_metadata_size);
+	dst_data.resize(expected_data_size);
+
+	if (!serialize_to_buffer(voxel_buffer, to_span(dst_data), expected_metadata_size)) {
+		dst_data.clear();
+		return SerializeResult(dst_data, false);
+	}
 
 	return SerializeResult(dst_data, true);
 }
 
+size_t get_serialized_size(const VoxelBuffer &voxel_buffer) {
+	size_t metadata_size = 0;
+	return get_size_in_bytes(voxel_buffer, metadata_size);
+}
+
 namespace legacy {
 
 bool migrate_v3_to_v4(Span<const uint8_t> p_data, StdVector<uint8_t> &dst) {
@@ -608,6 +934,14 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer) {
 			return deserialize(to_span(migrated_data), out_voxel_buffer);
 		} break;
 
+		case 4:
+			// Version 5 only added palette and brick compression, so version 4 data can be read as-is
+		case 5:
+			// Version 6 only added filters to uncompressed channels, which are not present before
+		case 6:
+			// Version 7 only added the SDF quantization factor, which was always 1 before
+			break;
+
 		default:
 			ERR_FAIL_COND_V(format_version != BLOCK_FORMAT_VERSION, false);
 	}
@@ -618,6 +952,17 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer) {
 
 	out_voxel_buffer.create(Vector3i(size_x, size_y, size_z));
 
+	float sdf_quantization_factor = 1.f;
+	if (format_version >= 7) {
+		sdf_quantization_factor = f.get_float();
+		ERR_FAIL_COND_V_MSG(
+				!(sdf_quantization_factor > 0.f),
+				false,
+				"At offset 0x" + String::num_int64(f.get_position() - sizeof(float), 16)
+		);
+	}
+	out_voxel_buffer.set_sdf_quantization_factor(sdf_quantization_factor);
+
 	for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
 		const uint8_t fmt = f.get_8();
 		const uint8_t compression_value = fmt & 0xf;
@@ -644,10 +989,30 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer) {
 				Span<uint8_t> buffer;
 				CRASH_COND(!out_voxel_buffer.get_channel_as_bytes(channel_index, buffer));
 
-				const size_t read_len = f.get_buffer(buffer);
-				if (read_len != buffer.size()) {
-					ERR_PRINT("Unexpected end of file");
-					return false;
+				ChannelFilter filter = FILTER_NONE;
+				if (format_version >= 6) {
+					const uint8_t filter_value = f.get_8();
+					ERR_FAIL_COND_V_MSG(
+							filter_value >= FILTER_COUNT,
+							false,
+							"At offset 0x" + String::num_int64(f.get_position() - 1, 16)
+					);
+					filter = static_cast<ChannelFilter>(filter_value);
+				}
+
+				if (filter == FILTER_NONE) {
+					const size_t read_len = f.get_buffer(buffer);
+					if (read_len != buffer.size()) {
+						ERR_PRINT("Unexpected end of file");
+						return false;
+					}
+				} else {
+					if (f.pos + buffer.size() > f.data.size()) {
+						ERR_PRINT("Unexpected end of file");
+						return false;
+					}
+					revert_channel_filter(f.data.sub(f.pos, buffer.size()), buffer, depth, size_y, filter);
+					f.pos += buffer.size();
 				}
 
 			} break;
@@ -673,6 +1038,80 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer) {
 				out_voxel_buffer.clear_channel(channel_index, v);
 			} break;
 
+			case VoxelBuffer::COMPRESSION_PALETTE: {
+				ERR_FAIL_COND_V_MSG(
+						format_version < 5,
+						false,
+						"Palette compression is not supported before version 5, at offset 0x" +
+								String::num_int64(f.get_position() - 1, 16)
+				);
+				const unsigned int palette_size = f.get_16();
+				const unsigned int index_bits = f.get_8();
+				ERR_FAIL_COND_V(palette_size == 0 || palette_size > VoxelBuffer::MAX_PALETTE_SIZE, false);
+
+				FixedArray<uint64_t, VoxelBuffer::MAX_PALETTE_SIZE> palette;
+				for (unsigned int pi = 0; pi < palette_size; ++pi) {
+					palette[pi] = get_value(f, depth);
+				}
+
+				Span<uint8_t> indices;
+				ERR_FAIL_COND_V(
+						!out_voxel_buffer.create_channel_palette(
+								channel_index, to_span(palette, palette_size).to_const(), index_bits, indices
+						),
+						false
+				);
+
+				const size_t read_len = f.get_buffer(indices);
+				if (read_len != indices.size()) {
+					ERR_PRINT("Unexpected end of file");
+					return false;
+				}
+			} break;
+
+			case VoxelBuffer::COMPRESSION_BRICKS: {
+				ERR_FAIL_COND_V_MSG(
+						format_version < 5,
+						false,
+						"Brick compression is not supported before version 5, at offset 0x" +
+								String::num_int64(f.get_position() - 1, 16)
+				);
+				const unsigned int brick_size_po2 = f.get_8();
+				const unsigned int dense_brick_count = f.get_16();
+				ERR_FAIL_COND_V(
+						brick_size_po2 < VoxelBuffer::MIN_BRICK_SIZE_PO2 ||
+								brick_size_po2 > VoxelBuffer::MAX_BRICK_SIZE_PO2,
+						false
+				);
+
+				Span<uint16_t> slots;
+				Span<uint8_t> uniform_values;
+				Span<uint8_t> dense_bricks;
+				ERR_FAIL_COND_V(
+						!out_voxel_buffer.create_channel_bricks(
+								channel_index, brick_size_po2, dense_brick_count, slots, uniform_values, dense_bricks
+						),
+						false
+				);
+
+				Span<uint8_t> slots_bytes = slots.reinterpret_cast_to<uint8_t>();
+				if (f.get_buffer(slots_bytes) != slots_bytes.size() ||
+					f.get_buffer(uniform_values) != uniform_values.size() ||
+					f.get_buffer(dense_bricks) != dense_bricks.size()) {
+					ERR_PRINT("Unexpected end of file");
+					return false;
+				}
+
+				for (const uint16_t slot : slots) {
+					if (slot != VoxelBuffer::BRICK_UNIFORM && slot >= dense_brick_count) {
+						ERR_PRINT("Brick slot out of range");
+						// Don't leave invalid data behind
+						out_voxel_buffer.clear_channel(channel_index, 0);
+						return false;
+					}
+				}
+			} break;
+
 			default:
 				ERR_PRINT("Unhandled compression mode");
 				return false;
@@ -695,28 +1134,87 @@ bool deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer) {
 }
 
 SerializeResult serialize_and_compress(const VoxelBuffer &voxel_buffer) {
+	return serialize_and_compress(voxel_buffer, CompressedData::COMPRESSION_LZ4, CompressedData::ZstdOptions());
+}
+
+SerializeResult serialize_and_compress(
+		const VoxelBuffer &voxel_buffer,
+		CompressedData::Compression compression,
+		const CompressedData::ZstdOptions &zstd_options
+) {
 	ZN_PROFILE_SCOPE();
 
 	StdVector<uint8_t> &compressed_data = get_tls_compressed_data();
+	compressed_data.resize(get_serialized_and_compressed_size_bound(voxel_buffer, compression));
 
-	SerializeResult res = serialize(voxel_buffer);
-	ERR_FAIL_COND_V(!res.success, SerializeResult(compressed_data, false));
-	const StdVector<uint8_t> &data = res.data;
-
-	res.success = CompressedData::compress(
-			Span<const uint8_t>(data.data(), 0, data.size()), compressed_data, CompressedData::COMPRESSION_LZ4
-	);
-	ERR_FAIL_COND_V(!res.success, SerializeResult(compressed_data, false));
+	size_t size = 0;
+	if (!serialize_and_compress(voxel_buffer, to_span(compressed_data), size, compression, zstd_options)) {
+		compressed_data.clear();
+		return SerializeResult(compressed_data, false);
+	}
 
+	compressed_data.resize(size);
 	return SerializeResult(compressed_data, true);
 }
 
+size_t get_serialized_and_compressed_size_bound(
+		const VoxelBuffer &voxel_buffer,
+		CompressedData::Compression compression
+) {
+	return CompressedData::get_compressed_size_bound(get_serialized_size(voxel_buffer), compression);
+}
+
+bool serialize_and_compress(
+		const VoxelBuffer &voxel_buffer,
+		Span<uint8_t> dst,
+		size_t &out_size,
+		CompressedData::Compression compression,
+		const CompressedData::ZstdOptions &zstd_options
+) {
+	ZN_PROFILE_SCOPE();
+
+	// Cannot serialize an empty block
+	ERR_FAIL_COND_V(Vector3iUtil::get_volume(voxel_buffer.get_size()) == 0, false);
+
+	size_t metadata_size = 0;
+	const size_t data_size = get_size_in_bytes(voxel_buffer, metadata_size);
+
+	if (compression == CompressedData::COMPRESSION_NONE) {
+		// Uncompressed data only has a one-byte header, so we can serialize in place without an intermediate buffer
+		ERR_FAIL_COND_V(dst.size() < data_size + 1, false);
+		dst[0] = CompressedData::COMPRESSION_NONE;
+		ERR_FAIL_COND_V(!serialize_to_buffer(voxel_buffer, dst.sub(1, data_size), metadata_size), false);
+		out_size = data_size + 1;
+		return true;
+	}
+
+	// Only grows, so it stops allocating after the first few blocks
+	StdVector<uint8_t> &data = get_tls_data();
+	if (data.size() < data_size) {
+		data.resize(data_size);
+	}
+	const Span<uint8_t> data_span = to_span(data).sub(0, data_size);
+	ERR_FAIL_COND_V(!serialize_to_buffer(voxel_buffer, data_span, metadata_size), false);
+
+	return CompressedData::compress(data_span, dst, out_size, compression, zstd_options);
+}
+
 bool decompress_and_deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer) {
+	return decompress_and_deserialize(
+			p_data, out_voxel_buffer, Span<const std::shared_ptr<CompressedData::ZstdDictionary>>()
+	);
+}
+
+bool decompress_and_deserialize(
+		Span<const uint8_t> p_data,
+		VoxelBuffer &out_voxel_buffer,
+		Span<const std::shared_ptr<CompressedData::ZstdDictionary>> zstd_dictionaries
+) {
 	ZN_PROFILE_SCOPE();
 
 	StdVector<uint8_t> &data = get_tls_data();
 
-	const bool res = CompressedData::decompress(p_data, data);
+	const bool res = CompressedData::decompress(p_data, data, zstd_dictionaries);
 	ERR_FAIL_COND_V(!res, false);
 
 	return deserialize(to_span_const(data), out_voxel_buffer);
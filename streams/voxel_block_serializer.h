@@ -4,6 +4,7 @@
 #include "../util/containers/span.h"
 #include "../util/containers/std_vector.h"
 #include "../util/godot/macros.h"
+#include "compressed_data.h"
 
 #include <cstdint>
 
@@ -19,12 +20,12 @@ class VoxelBuffer;
 namespace BlockSerializer {
 
 // Latest version, used when serializing
-static const uint8_t BLOCK_FORMAT_VERSION = 4;
+static const uint8_t BLOCK_FORMAT_VERSION = 7;
 
 struct SerializeResult {
 	// The lifetime of the pointed object is only valid in the calling thread,
 	// until another serialization or deserialization call is made.
-	// TODO Eventually figure out allocators so the caller can decide
+	// See the `serialize_and_compress` overload taking a `Span` to write into a buffer owned by the caller.
 	const StdVector<uint8_t> &data;
 	bool success;
 
@@ -34,8 +35,38 @@ struct SerializeResult {
 SerializeResult serialize(const VoxelBuffer &voxel_buffer);
 bool deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer);
 
+// Uses LZ4
 SerializeResult serialize_and_compress(const VoxelBuffer &voxel_buffer);
+SerializeResult serialize_and_compress(
+		const VoxelBuffer &voxel_buffer,
+		CompressedData::Compression compression,
+		const CompressedData::ZstdOptions &zstd_options
+);
+
+// Size in bytes of the data `serialize` produces for the given buffer.
+size_t get_serialized_size(const VoxelBuffer &voxel_buffer);
+// Maximum size in bytes of the data `serialize_and_compress` can produce for the given buffer.
+size_t get_serialized_and_compressed_size_bound(
+		const VoxelBuffer &voxel_buffer,
+		CompressedData::Compression compression
+);
+// Serializes and compresses into a buffer owned by the caller, which must be at least
+// `get_serialized_and_compressed_size_bound` bytes long. `out_size` receives the number of bytes written at the
+// beginning of `dst`. Keeping the same buffer between calls avoids allocating memory and copying the result.
+bool serialize_and_compress(
+		const VoxelBuffer &voxel_buffer,
+		Span<uint8_t> dst,
+		size_t &out_size,
+		CompressedData::Compression compression,
+		const CompressedData::ZstdOptions &zstd_options
+);
+
 bool decompress_and_deserialize(Span<const uint8_t> p_data, VoxelBuffer &out_voxel_buffer);
+bool decompress_and_deserialize(
+		Span<const uint8_t> p_data,
+		VoxelBuffer &out_voxel_buffer,
+		Span<const std::shared_ptr<CompressedData::ZstdDictionary>> zstd_dictionaries
+);
 bool decompress_and_deserialize(FileAccess &f, unsigned int size_to_read, VoxelBuffer &out_voxel_buffer);
 
 // Temporary thread-local buffers for internal use
@@ -0,0 +1,301 @@
+#include "voxel_pre_generation_job.h"
+#include "../constants/voxel_constants.h"
+#include "../storage/voxel_buffer.h"
+#include "../util/containers/std_unordered_set.h"
+#include "../util/containers/std_vector.h"
+#include "../util/godot/core/class_db.h"
+#include "../util/math/box3i.h"
+#include "../util/math/funcs.h"
+#include "../util/string/format.h"
+#include "batched_stream_job.h"
+#include <atomic>
+
+namespace zylann::voxel {
+
+// Side length of the group of blocks processed by a task at once, in blocks. The stream is queried with a box of
+// that size to find which blocks already exist.
+static const int BATCH_SIZE_IN_BLOCKS = 4;
+
+struct VoxelPreGenerationJob::State : BatchedStreamJobState {
+	struct Batch {
+		Box3i box; // In blocks of the LOD
+		uint8_t lod_index;
+	};
+
+	Ref<VoxelGenerator> generator;
+	Ref<VoxelStream> stream;
+	StdVector<Batch> batches;
+	uint32_t total_block_count = 0;
+	uint8_t block_size_po2 = 0;
+
+	std::atomic_uint32_t generated_block_count = { 0 };
+	std::atomic_uint32_t skipped_block_count = { 0 };
+};
+
+namespace {
+
+class PreGenerateBlocksTask : public BatchedStreamJobTask {
+public:
+	PreGenerateBlocksTask(std::shared_ptr<VoxelPreGenerationJob::State> state, uint32_t batch_index) :
+			BatchedStreamJobTask(state, batch_index), _state(state) {}
+
+	const char *get_debug_name() const override {
+		return "PreGenerateBlocks";
+	}
+
+protected:
+	void process_batch(uint32_t batch_index) override {
+		const VoxelPreGenerationJob::State::Batch &batch = _state->batches[batch_index];
+
+		VoxelGenerator &generator = **_state->generator;
+		VoxelStream &stream = **_state->stream;
+
+		// Find blocks that were saved already, by an earlier run of the job or by terrains.
+		// That loads their voxels which we don't need, but streams have no cheaper way to tell.
+		VoxelStream::FullLoadingResult existing_blocks;
+		stream.load_voxel_blocks_in_box(batch.box, batch.lod_index, existing_blocks);
+		StdUnorderedSet<Vector3i> existing_positions;
+		for (const VoxelStream::FullLoadingResult::Block &block : existing_blocks.blocks) {
+			existing_positions.insert(block.position);
+		}
+		existing_blocks.blocks.clear();
+
+		StdVector<Vector3i> positions;
+		batch.box.for_each_cell_zxy([&positions, &existing_positions](Vector3i bpos) {
+			if (existing_positions.find(bpos) == existing_positions.end()) {
+				positions.push_back(bpos);
+			}
+		});
+
+		_state->skipped_block_count += Vector3iUtil::get_volume(batch.box.size) - positions.size();
+
+		if (positions.size() == 0) {
+			return;
+		}
+
+		const int block_size = 1 << _state->block_size_po2;
+
+		StdVector<VoxelBuffer> buffers;
+		buffers.reserve(positions.size());
+		for (unsigned int i = 0; i < positions.size(); ++i) {
+			buffers.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+			buffers.back().create(Vector3iUtil::create(block_size));
+		}
+
+		// Queries reference buffers, so they are made once buffers no longer move
+		StdVector<VoxelGenerator::VoxelQueryData> generator_queries;
+		generator_queries.reserve(positions.size());
+		for (unsigned int i = 0; i < positions.size(); ++i) {
+			const Vector3i origin_in_voxels = positions[i] * (block_size << batch.lod_index);
+			generator_queries.push_back(
+					VoxelGenerator::VoxelQueryData{ buffers[i], origin_in_voxels, batch.lod_index }
+			);
+		}
+		StdVector<VoxelGenerator::Result> generator_results;
+		generator_results.resize(positions.size());
+		generator.generate_blocks(to_span(generator_queries), to_span(generator_results));
+
+		StdVector<VoxelStream::VoxelQueryData> stream_queries;
+		stream_queries.reserve(positions.size());
+		for (unsigned int i = 0; i < positions.size(); ++i) {
+			buffers[i].compress_uniform_channels();
+			stream_queries.push_back(
+					VoxelStream::VoxelQueryData{ buffers[i], positions[i], batch.lod_index, VoxelStream::RESULT_ERROR }
+			);
+		}
+		stream.save_voxel_blocks(to_span(stream_queries));
+
+		_state->generated_block_count += positions.size();
+	}
+
+private:
+	std::shared_ptr<VoxelPreGenerationJob::State> _state;
+};
+
+} // namespace
+
+VoxelPreGenerationJob::VoxelPreGenerationJob() {}
+
+VoxelPreGenerationJob::~VoxelPreGenerationJob() {
+	// Nothing could query progress anymore
+	cancel();
+}
+
+void VoxelPreGenerationJob::set_generator(Ref<VoxelGenerator> generator) {
+	_generator = generator;
+}
+
+Ref<VoxelGenerator> VoxelPreGenerationJob::get_generator() const {
+	return _generator;
+}
+
+void VoxelPreGenerationJob::set_stream(Ref<VoxelStream> stream) {
+	_stream = stream;
+}
+
+Ref<VoxelStream> VoxelPreGenerationJob::get_stream() const {
+	return _stream;
+}
+
+void VoxelPreGenerationJob::set_area_min(Vector3i min_pos) {
+	_area_min = min_pos;
+}
+
+Vector3i VoxelPreGenerationJob::get_area_min() const {
+	return _area_min;
+}
+
+void VoxelPreGenerationJob::set_area_max(Vector3i max_pos) {
+	_area_max = max_pos;
+}
+
+Vector3i VoxelPreGenerationJob::get_area_max() const {
+	return _area_max;
+}
+
+void VoxelPreGenerationJob::set_lod_min(int lod_index) {
+	ZN_ASSERT_RETURN(lod_index >= 0 && lod_index < static_cast<int>(constants::MAX_LOD));
+	_lod_min = lod_index;
+}
+
+int VoxelPreGenerationJob::get_lod_min() const {
+	return _lod_min;
+}
+
+void VoxelPreGenerationJob::set_lod_max(int lod_index) {
+	ZN_ASSERT_RETURN(lod_index >= 0 && lod_index < static_cast<int>(constants::MAX_LOD));
+	_lod_max = lod_index;
+}
+
+int VoxelPreGenerationJob::get_lod_max() const {
+	return _lod_max;
+}
+
+void VoxelPreGenerationJob::set_max_pending_tasks(int count) {
+	_max_pending_tasks = math::clamp(count, 1, 255);
+}
+
+int VoxelPreGenerationJob::get_max_pending_tasks() const {
+	return _max_pending_tasks;
+}
+
+void VoxelPreGenerationJob::start() {
+	ZN_ASSERT_RETURN_MSG(!is_running(), "The job is already running");
+	ZN_ASSERT_RETURN_MSG(_generator.is_valid(), "A generator is required");
+	ZN_ASSERT_RETURN_MSG(_stream.is_valid(), "A stream is required");
+	ZN_ASSERT_RETURN_MSG(_lod_min <= _lod_max, "The minimum LOD must not be greater than the maximum LOD");
+	ZN_ASSERT_RETURN_MSG(
+			_lod_max < _stream->get_lod_count(),
+			format("The stream only supports {} LODs", _stream->get_lod_count())
+	);
+	ZN_ASSERT_RETURN_MSG(_lod_max == 0 || _generator->supports_lod(), "The generator doesn't support LOD");
+
+	std::shared_ptr<State> state = make_shared_instance<State>();
+	state->generator = _generator;
+	state->stream = _stream;
+	state->block_size_po2 = _stream->get_block_size_po2();
+
+	const Box3i voxel_box = Box3i::from_min_max(_area_min, _area_max);
+	ZN_ASSERT_RETURN_MSG(Vector3iUtil::is_valid_size(voxel_box.size), "The area is invalid");
+
+	for (unsigned int lod_index = _lod_min; lod_index <= _lod_max; ++lod_index) {
+		const Box3i block_box = voxel_box.downscaled(1 << (state->block_size_po2 + lod_index));
+		const Box3i batch_box = block_box.downscaled(BATCH_SIZE_IN_BLOCKS);
+
+		batch_box.for_each_cell_zxy([&state, &block_box, lod_index](Vector3i batch_pos) {
+			Box3i box(batch_pos * BATCH_SIZE_IN_BLOCKS, Vector3iUtil::create(BATCH_SIZE_IN_BLOCKS));
+			box.clip(block_box);
+			state->batches.push_back(State::Batch{ box, static_cast<uint8_t>(lod_index) });
+			state->total_block_count += Vector3iUtil::get_volume(box.size);
+		});
+	}
+
+	state->batch_count = state->batches.size();
+
+	_state = state;
+
+	start_batched_stream_job_tasks<PreGenerateBlocksTask>(state, _max_pending_tasks);
+}
+
+void VoxelPreGenerationJob::cancel() {
+	if (_state != nullptr) {
+		_state->cancelled = true;
+	}
+}
+
+bool VoxelPreGenerationJob::is_running() const {
+	return _state != nullptr && _state->running_task_count > 0;
+}
+
+float VoxelPreGenerationJob::get_progress() const {
+	if (_state == nullptr || _state->total_block_count == 0) {
+		return 0.f;
+	}
+	const uint32_t done_count = _state->generated_block_count + _state->skipped_block_count;
+	return static_cast<float>(done_count) / static_cast<float>(_state->total_block_count);
+}
+
+int VoxelPreGenerationJob::get_total_block_count() const {
+	return _state != nullptr ? _state->total_block_count : 0;
+}
+
+int VoxelPreGenerationJob::get_generated_block_count() const {
+	return _state != nullptr ? _state->generated_block_count.load() : 0;
+}
+
+int VoxelPreGenerationJob::get_skipped_block_count() const {
+	return _state != nullptr ? _state->skipped_block_count.load() : 0;
+}
+
+void VoxelPreGenerationJob::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_generator", "generator"), &VoxelPreGenerationJob::set_generator);
+	ClassDB::bind_method(D_METHOD("get_generator"), &VoxelPreGenerationJob::get_generator);
+
+	ClassDB::bind_method(D_METHOD("set_stream", "stream"), &VoxelPreGenerationJob::set_stream);
+	ClassDB::bind_method(D_METHOD("get_stream"), &VoxelPreGenerationJob::get_stream);
+
+	ClassDB::bind_method(D_METHOD("set_area_min", "min_pos"), &VoxelPreGenerationJob::set_area_min);
+	ClassDB::bind_method(D_METHOD("get_area_min"), &VoxelPreGenerationJob::get_area_min);
+
+	ClassDB::bind_method(D_METHOD("set_area_max", "max_pos"), &VoxelPreGenerationJob::set_area_max);
+	ClassDB::bind_method(D_METHOD("get_area_max"), &VoxelPreGenerationJob::get_area_max);
+
+	ClassDB::bind_method(D_METHOD("set_lod_min", "lod_index"), &VoxelPreGenerationJob::set_lod_min);
+	ClassDB::bind_method(D_METHOD("get_lod_min"), &VoxelPreGenerationJob::get_lod_min);
+
+	ClassDB::bind_method(D_METHOD("set_lod_max", "lod_index"), &VoxelPreGenerationJob::set_lod_max);
+	ClassDB::bind_method(D_METHOD("get_lod_max"), &VoxelPreGenerationJob::get_lod_max);
+
+	ClassDB::bind_method(D_METHOD("set_max_pending_tasks", "count"), &VoxelPreGenerationJob::set_max_pending_tasks);
+	ClassDB::bind_method(D_METHOD("get_max_pending_tasks"), &VoxelPreGenerationJob::get_max_pending_tasks);
+
+	ClassDB::bind_method(D_METHOD("start"), &VoxelPreGenerationJob::start);
+	ClassDB::bind_method(D_METHOD("cancel"), &VoxelPreGenerationJob::cancel);
+	ClassDB::bind_method(D_METHOD("is_running"), &VoxelPreGenerationJob::is_running);
+	ClassDB::bind_method(D_METHOD("get_progress"), &VoxelPreGenerationJob::get_progress);
+	ClassDB::bind_method(D_METHOD("get_total_block_count"), &VoxelPreGenerationJob::get_total_block_count);
+	ClassDB::bind_method(D_METHOD("get_generated_block_count"), &VoxelPreGenerationJob::get_generated_block_count);
+	ClassDB::bind_method(D_METHOD("get_skipped_block_count"), &VoxelPreGenerationJob::get_skipped_block_count);
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "generator", PROPERTY_HINT_RESOURCE_TYPE, VoxelGenerator::get_class_static()),
+			"set_generator",
+			"get_generator"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()),
+			"set_stream",
+			"get_stream"
+	);
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR3I, "area_min"), "set_area_min", "get_area_min");
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR3I, "area_max"), "set_area_max", "get_area_max");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "lod_min"), "set_lod_min", "get_lod_min");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "lod_max"), "set_lod_max", "get_lod_max");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "max_pending_tasks", PROPERTY_HINT_RANGE, "1,255"),
+			"set_max_pending_tasks",
+			"get_max_pending_tasks"
+	);
+}
+
+} // namespace zylann::voxel
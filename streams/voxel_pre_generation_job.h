@@ -0,0 +1,78 @@
+#ifndef VOXEL_PRE_GENERATION_JOB_H
+#define VOXEL_PRE_GENERATION_JOB_H
+
+#include "../generators/voxel_generator.h"
+#include "../util/godot/classes/ref_counted.h"
+#include "../util/math/vector3i.h"
+#include "voxel_stream.h"
+#include <memory>
+
+namespace zylann::voxel {
+
+// Generates blocks of an area and saves them into a stream, using the engine's thread pool. Meant to bake large areas
+// ahead of time, for example on a server before players connect, so terrains don't have to generate them under load.
+// Blocks already present in the stream are skipped, so a job interrupted by a crash or a restart resumes where it left
+// off when started again with the same parameters.
+// Terrains using the same stream should not load the area while the job runs, otherwise edited blocks could be
+// overwritten. Modifiers are not applied, since they belong to terrains.
+class VoxelPreGenerationJob : public RefCounted {
+	GDCLASS(VoxelPreGenerationJob, RefCounted)
+public:
+	VoxelPreGenerationJob();
+	~VoxelPreGenerationJob();
+
+	void set_generator(Ref<VoxelGenerator> generator);
+	Ref<VoxelGenerator> get_generator() const;
+
+	void set_stream(Ref<VoxelStream> stream);
+	Ref<VoxelStream> get_stream() const;
+
+	// Area to generate in voxels, where `max` is excluded
+	void set_area_min(Vector3i min_pos);
+	Vector3i get_area_min() const;
+
+	void set_area_max(Vector3i max_pos);
+	Vector3i get_area_max() const;
+
+	// Range of LODs to generate, both included
+	void set_lod_min(int lod_index);
+	int get_lod_min() const;
+
+	void set_lod_max(int lod_index);
+	int get_lod_max() const;
+
+	// How many tasks of this job can be in the thread pool at once. Lower values leave more threads to other work.
+	void set_max_pending_tasks(int count);
+	int get_max_pending_tasks() const;
+
+	void start();
+	void cancel();
+
+	bool is_running() const;
+	// Ratio of blocks processed so far, between 0 and 1.
+	float get_progress() const;
+	int get_total_block_count() const;
+	// Blocks which were generated and saved by this job
+	int get_generated_block_count() const;
+	// Blocks which were already present in the stream
+	int get_skipped_block_count() const;
+
+	struct State;
+
+private:
+	static void _bind_methods();
+
+	Ref<VoxelGenerator> _generator;
+	Ref<VoxelStream> _stream;
+	Vector3i _area_min;
+	Vector3i _area_max;
+	uint8_t _lod_min = 0;
+	uint8_t _lod_max = 0;
+	uint8_t _max_pending_tasks = 4;
+	// Shared with tasks, which may outlive the job
+	std::shared_ptr<State> _state;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_PRE_GENERATION_JOB_H
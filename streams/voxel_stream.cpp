@@ -1,7 +1,9 @@
 #include "voxel_stream.h"
 #include "../storage/voxel_buffer_gd.h"
 #include "../util/godot/core/string.h"
+#include "../util/profiling.h"
 #include "../util/string/format.h"
+#include "voxel_block_serializer.h"
 
 namespace zylann::voxel {
 
@@ -47,10 +49,105 @@ void VoxelStream::save_instance_blocks(Span<InstancesQueryData> p_blocks) {
 	// Can be implemented in subclasses
 }
 
+bool VoxelStream::supports_mesh_blocks() const {
+	// Can be implemented in subclasses
+	return false;
+}
+
+void VoxelStream::load_mesh_blocks(Span<MeshesQueryData> out_blocks) {
+	// Can be implemented in subclasses
+	for (size_t i = 0; i < out_blocks.size(); ++i) {
+		out_blocks[i].result = RESULT_BLOCK_NOT_FOUND;
+	}
+}
+
+void VoxelStream::save_mesh_blocks(Span<MeshesQueryData> p_blocks) {
+	// Can be implemented in subclasses
+}
+
+bool VoxelStream::supports_compressed_voxel_blocks() const {
+	// Can be implemented in subclasses
+	return false;
+}
+
+void VoxelStream::load_compressed_voxel_blocks(Span<CompressedVoxelQueryData> out_blocks) {
+	// Can be implemented in subclasses
+	for (size_t i = 0; i < out_blocks.size(); ++i) {
+		out_blocks[i].result = RESULT_BLOCK_NOT_FOUND;
+	}
+}
+
+void VoxelStream::save_compressed_voxel_blocks(Span<CompressedVoxelQueryData> p_blocks) {
+	ZN_PRINT_ERROR(format("{} does not support `save_compressed_voxel_blocks`", get_class()));
+}
+
+bool VoxelStream::has_portable_compressed_voxel_blocks() const {
+	// Data is in the format of `BlockSerializer` unless a stream says otherwise
+	return supports_compressed_voxel_blocks();
+}
+
+bool VoxelStream::get_voxel_block_keys(StdVector<BlockKey> &out_keys) {
+	// Can be implemented in subclasses
+	return false;
+}
+
 void VoxelStream::load_all_blocks(FullLoadingResult &result) {
 	ZN_PRINT_ERROR(format("{} does not support `load_all_blocks`", get_class()));
 }
 
+bool VoxelStream::decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const {
+	return BlockSerializer::decompress_and_deserialize(data, out_voxels);
+}
+
+bool VoxelStream::compress_voxel_block(const VoxelBuffer &voxels, StdVector<uint8_t> &out_data) const {
+	const BlockSerializer::SerializeResult res = BlockSerializer::serialize_and_compress(voxels);
+	if (!res.success) {
+		return false;
+	}
+	out_data = res.data;
+	return true;
+}
+
+void VoxelStream::load_voxel_blocks_in_box(Box3i box_in_blocks, uint8_t lod_index, FullLoadingResult &result) {
+	ZN_PROFILE_SCOPE();
+	// Default implementation, using point queries
+	box_in_blocks.clip(get_supported_block_range());
+	if (box_in_blocks.is_empty()) {
+		return;
+	}
+
+	const Vector3i block_size = Vector3iUtil::create(1 << get_block_size_po2());
+
+	StdVector<std::shared_ptr<VoxelBuffer>> buffers;
+	StdVector<Vector3i> positions;
+	box_in_blocks.for_each_cell_zxy([&buffers, &positions, block_size](const Vector3i pos) {
+		std::shared_ptr<VoxelBuffer> buffer = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		buffer->create(block_size);
+		buffers.push_back(buffer);
+		positions.push_back(pos);
+	});
+
+	// Queries reference buffers, so they are made once buffers no longer move
+	StdVector<VoxelQueryData> queries;
+	queries.reserve(buffers.size());
+	for (unsigned int i = 0; i < buffers.size(); ++i) {
+		queries.push_back(VoxelQueryData{ *buffers[i], positions[i], lod_index, RESULT_ERROR });
+	}
+
+	load_voxel_blocks(to_span(queries));
+
+	for (unsigned int i = 0; i < queries.size(); ++i) {
+		if (queries[i].result != RESULT_BLOCK_FOUND) {
+			continue;
+		}
+		FullLoadingResult::Block block;
+		block.voxels = buffers[i];
+		block.position = positions[i];
+		block.lod = lod_index;
+		result.blocks.push_back(std::move(block));
+	}
+}
+
 int VoxelStream::get_used_channels_mask() const {
 	return 0;
 }
@@ -84,6 +181,10 @@ void VoxelStream::flush() {
 	// Can be implemented in subclasses
 }
 
+int64_t VoxelStream::get_memory_usage_bytes() const {
+	return 0;
+}
+
 // Binding land
 
 VoxelStream::ResultCode VoxelStream::_b_load_voxel_block(
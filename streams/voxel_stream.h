@@ -65,6 +65,23 @@ public:
 		ResultCode result;
 	};
 
+	struct MeshesQueryData {
+		// Serialized with `serialize_mesh_block`. The stream stores it as-is.
+		StdVector<uint8_t> data;
+		// In mesh blocks, which may have a different size than data blocks
+		Vector3i position_in_blocks;
+		uint8_t lod_index;
+		ResultCode result;
+	};
+
+	struct CompressedVoxelQueryData {
+		// Voxels in the format of `compress_voxel_block`. The stream stores it as-is.
+		StdVector<uint8_t> data;
+		Vector3i position_in_blocks;
+		uint8_t lod_index;
+		ResultCode result;
+	};
+
 	// TODO Deprecate
 	// Queries a block of voxels beginning at the given world-space voxel position and LOD.
 	// If you use LOD, the result at a given coordinate must always remain the same regardless of it.
@@ -87,15 +104,50 @@ public:
 	virtual void load_instance_blocks(Span<InstancesQueryData> out_blocks);
 	virtual void save_instance_blocks(Span<InstancesQueryData> p_blocks);
 
+	// Meshes can be stored alongside voxels, so terrains that never change can load them instead of meshing again.
+	// These functions may be called from multiple threads at once.
+	virtual bool supports_mesh_blocks() const;
+
+	virtual void load_mesh_blocks(Span<MeshesQueryData> out_blocks);
+	virtual void save_mesh_blocks(Span<MeshesQueryData> p_blocks);
+
+	// Streams storing voxels compressed can load and save them without decoding them. This allows the engine to
+	// compress and decompress blocks on multiple threads, while files are accessed by a single one.
+	// These functions may be called from multiple threads at once.
+	virtual bool supports_compressed_voxel_blocks() const;
+
+	virtual void load_compressed_voxel_blocks(Span<CompressedVoxelQueryData> out_blocks);
+	virtual void save_compressed_voxel_blocks(Span<CompressedVoxelQueryData> p_blocks);
+
+	// Tells if voxels loaded with `load_compressed_voxel_blocks` can be saved as-is into another stream supporting
+	// compressed blocks. This is not the case if they depend on data owned by the stream, like compression
+	// dictionaries. Blocks written with older versions of the block format remain readable, so they can be moved too.
+	virtual bool has_portable_compressed_voxel_blocks() const;
+
+	struct BlockKey {
+		Vector3i position;
+		uint8_t lod_index;
+	};
+
+	// Gets the location of every block of voxels saved in the stream, without loading them. Returns false if the stream
+	// can't list its blocks.
+	virtual bool get_voxel_block_keys(StdVector<BlockKey> &out_keys);
+
+	// Only contains voxel data. Instance blocks are loaded separately with `load_instance_blocks`, when an instancer
+	// needs them.
 	struct FullLoadingResult {
-		// TODO Perhaps this needs to be decoupled. Not all voxel blocks have instances and vice versa
 		struct Block {
 			std::shared_ptr<VoxelBuffer> voxels;
-			UniquePtr<InstanceBlockData> instances_data;
 			Vector3i position;
 			unsigned int lod;
+			// Voxel data not decoded yet, when `defer_voxel_decoding` was requested. `voxels` is null in that case,
+			// and this must be decoded with `decompress_voxel_block`.
+			StdVector<uint8_t> compressed_voxels;
 		};
 		StdVector<Block> blocks;
+		// If true, streams may return compressed voxel data instead of decoding it, so the caller can decode blocks
+		// in parallel.
+		bool defer_voxel_decoding = false;
 	};
 
 	virtual bool supports_loading_all_blocks() const {
@@ -104,6 +156,19 @@ public:
 
 	virtual void load_all_blocks(FullLoadingResult &result);
 
+	// Decodes voxel data returned by `load_all_blocks` when decoding was deferred.
+	// Must be thread-safe, it may be called from multiple threads at once.
+	virtual bool decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const;
+
+	// Encodes voxels in the format expected by `save_compressed_voxel_blocks`.
+	// Must be thread-safe, it may be called from multiple threads at once.
+	virtual bool compress_voxel_block(const VoxelBuffer &voxels, StdVector<uint8_t> &out_data) const;
+
+	// Loads voxels of all blocks found within a box, at a given LOD. Blocks that are not found are not returned.
+	// Instances are not loaded. Streams able to fetch neighbor blocks in a single ordered read should override this,
+	// as the default implementation performs one query per block of the box.
+	virtual void load_voxel_blocks_in_box(Box3i box_in_blocks, uint8_t lod_index, FullLoadingResult &result);
+
 	// Tells which channels can be found in this stream.
 	// The simplest implementation is to return them all.
 	// One reason to specify which channels are available is to help the editor detect configuration issues,
@@ -134,6 +199,9 @@ public:
 	// no cache.
 	virtual void flush();
 
+	// Approximate amount of memory used by data the stream keeps in memory, such as caches. Used for memory reports.
+	virtual int64_t get_memory_usage_bytes() const;
+
 private:
 	static void _bind_methods();
 
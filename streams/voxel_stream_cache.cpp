@@ -2,44 +2,62 @@
 
 namespace zylann::voxel {
 
+namespace {
+
+const VoxelStreamCache::Block *find_block(
+		const StdUnorderedMap<Vector3i, VoxelStreamCache::Block> &blocks,
+		Vector3i pos
+) {
+	auto it = blocks.find(pos);
+	if (it == blocks.end()) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+} // namespace
+
 bool VoxelStreamCache::load_voxel_block(Vector3i position, uint8_t lod_index, VoxelBuffer &out_voxels) {
-	const Lod &lod = _cache[lod_index];
+	const Shard &shard = get_shard(position, lod_index);
+
+	RWLockRead rlock(shard.rw_lock);
 
-	RWLockRead rlock(lod.rw_lock);
+	const Block *block = find_block(shard.blocks, position);
 
-	auto it = lod.blocks.find(position);
+	if (block == nullptr || !block->has_voxels) {
+		// The block may also be getting flushed, in which case it is not in the database yet
+		block = find_block(shard.flushing_blocks, position);
+	}
 
-	if (it == lod.blocks.end()) {
+	if (block == nullptr) {
 		// Not in cache, will have to query
 		return false;
 
 	} else {
-		const Block &block = it->second;
-		if (!block.has_voxels) {
+		if (!block->has_voxels) {
 			// Has a block in cache but there is no voxel data
 			return false;
 		}
 		// In cache, serve it
 
-
 		// Copying is required since the cache has ownership on its data,
 		// and the requests wants us to populate the buffer it provides
-		block.voxels.copy_to(out_voxels, true);
+		block->voxels.copy_to(out_voxels, true);
 
 		return true;
 	}
 }
 
 void VoxelStreamCache::save_voxel_block(Vector3i position, uint8_t lod_index, VoxelBuffer &voxels) {
-	Lod &lod = _cache[lod_index];
-	RWLockWrite wlock(lod.rw_lock);
-	auto it = lod.blocks.find(position);
+	Shard &shard = get_shard(position, lod_index);
+	RWLockWrite wlock(shard.rw_lock);
+	auto it = shard.blocks.find(position);
 
 	ZN_ASSERT_RETURN_MSG(
 			!Vector3iUtil::is_empty_size(voxels.get_size()), "Saving voxel buffer with empty size is not expected. Bug?"
 	);
 
-	if (it == lod.blocks.end()) {
+	if (it == shard.blocks.end()) {
 		// Not cached yet, create an entry
 		Block b;
 		b.position = position;
@@ -47,7 +65,7 @@ void VoxelStreamCache::save_voxel_block(Vector3i position, uint8_t lod_index, Vo
 		// TODO Optimization: if we know the buffer is not shared, we could use move instead
 		voxels.copy_to(b.voxels, true);
 		b.has_voxels = true;
-		lod.blocks.insert(std::make_pair(position, std::move(b)));
+		shard.blocks.insert(std::make_pair(position, std::move(b)));
 		++_count;
 
 	} else {
@@ -62,28 +80,30 @@ bool VoxelStreamCache::load_instance_block(
 		uint8_t lod_index,
 		UniquePtr<InstanceBlockData> &out_instances
 ) {
-	const Lod &lod = _cache[lod_index];
-	lod.rw_lock.read_lock();
-	auto it = lod.blocks.find(position);
+	const Shard &shard = get_shard(position, lod_index);
+	RWLockRead rlock(shard.rw_lock);
+
+	const Block *block = find_block(shard.blocks, position);
+	if (block == nullptr || !block->has_instances) {
+		block = find_block(shard.flushing_blocks, position);
+	}
 
-	if (it == lod.blocks.end()) {
+	if (block == nullptr || !block->has_instances) {
 		// Not in cache, will have to query
-		lod.rw_lock.read_unlock();
 		return false;
 
 	} else {
 		// In cache, serve it
 
-		if (it->second.instances == nullptr) {
+		if (block->instances == nullptr) {
 			out_instances = nullptr;
 
 		} else {
 			// Copying is required since the cache has ownership on its data
 			out_instances = make_unique_instance<InstanceBlockData>();
-			it->second.instances->copy_to(*out_instances);
+			block->instances->copy_to(*out_instances);
 		}
 
-		lod.rw_lock.read_unlock();
 		return true;
 	}
 }
@@ -93,22 +113,24 @@ void VoxelStreamCache::save_instance_block(
 		uint8_t lod_index,
 		UniquePtr<InstanceBlockData> instances
 ) {
-	Lod &lod = _cache[lod_index];
-	RWLockWrite wlock(lod.rw_lock);
-	auto it = lod.blocks.find(position);
+	Shard &shard = get_shard(position, lod_index);
+	RWLockWrite wlock(shard.rw_lock);
+	auto it = shard.blocks.find(position);
 
-	if (it == lod.blocks.end()) {
+	if (it == shard.blocks.end()) {
 		// Not cached yet, create an entry
 		Block b;
 		b.position = position;
 		b.lod = lod_index;
 		b.instances = std::move(instances);
-		lod.blocks.insert(std::make_pair(position, std::move(b)));
+		b.has_instances = true;
+		shard.blocks.insert(std::make_pair(position, std::move(b)));
 		++_count;
 
 	} else {
 		// Cached already, overwrite
 		it->second.instances = std::move(instances);
+		it->second.has_instances = true;
 	}
 }
 
@@ -116,4 +138,36 @@ unsigned int VoxelStreamCache::get_indicative_block_count() const {
 	return _count;
 }
 
+namespace {
+
+size_t get_block_memory_usage(const VoxelStreamCache::Block &block) {
+	// Doesn't account for the overhead of the map and allocators, which depends on the implementation
+	size_t size = sizeof(Vector3i) + sizeof(VoxelStreamCache::Block) + block.voxels.get_channels_size_in_bytes();
+	if (block.instances != nullptr) {
+		for (const InstanceBlockData::LayerData &layer : block.instances->layers) {
+			size += sizeof(InstanceBlockData::LayerData) +
+					layer.instances.capacity() * sizeof(InstanceBlockData::InstanceData);
+		}
+	}
+	return size;
+}
+
+} // namespace
+
+size_t VoxelStreamCache::get_memory_usage() const {
+	size_t size = 0;
+	for (const Lod &lod : _cache) {
+		for (const Shard &shard : lod.shards) {
+			RWLockRead rlock(shard.rw_lock);
+			for (auto it = shard.blocks.begin(); it != shard.blocks.end(); ++it) {
+				size += get_block_memory_usage(it->second);
+			}
+			for (auto it = shard.flushing_blocks.begin(); it != shard.flushing_blocks.end(); ++it) {
+				size += get_block_memory_usage(it->second);
+			}
+		}
+	}
+	return size;
+}
+
 } // namespace zylann::voxel
@@ -4,8 +4,10 @@
 #include "../storage/voxel_buffer.h"
 #include "../util/containers/std_unordered_map.h"
 #include "../util/memory/memory.h"
+#include "../util/thread/mutex.h"
 #include "../util/thread/rw_lock.h"
 #include "instance_data.h"
+#include <atomic>
 
 namespace zylann::voxel {
 
@@ -24,6 +26,9 @@ public:
 		bool voxels_deleted = false;
 
 		VoxelBuffer voxels;
+
+		// Same as voxels. Null instances with `has_instances` set means they were deleted.
+		bool has_instances = false;
 		UniquePtr<InstanceBlockData> instances;
 
 		Block() : voxels(VoxelBuffer::ALLOCATOR_POOL) {}
@@ -43,29 +48,86 @@ public:
 
 	unsigned int get_indicative_block_count() const;
 
-	template <typename F>
-	void flush(F save_func) {
-		_count = 0;
-		for (unsigned int lod_index = 0; lod_index < _cache.size(); ++lod_index) {
-			Lod &lod = _cache[lod_index];
-			RWLockWrite wlock(lod.rw_lock);
-			for (auto it = lod.blocks.begin(); it != lod.blocks.end(); ++it) {
-				Block &block = it->second;
-				save_func(block);
+	// Approximate amount of memory used by cached blocks, including those being flushed
+	size_t get_memory_usage() const;
+
+	// Calls `save_func` on every cached block, then `end_func` once they have all been passed. Blocks remain readable
+	// until `end_func` returns, and the cache is not locked while they are being saved, so other threads can still
+	// load and save blocks in the meantime.
+	template <typename FSave, typename FEnd>
+	void flush(FSave save_func, FEnd end_func) {
+		// Only one flush at a time, since blocks being flushed are stored separately
+		MutexLock flush_lock(_flush_mutex);
+
+		// Each shard is only locked for the time it takes to swap maps. Blocks saved meanwhile in shards already
+		// swapped remain in the cache, so only the blocks moved out are uncounted.
+		uint32_t moved_count = 0;
+		for (Lod &lod : _cache) {
+			for (Shard &shard : lod.shards) {
+				RWLockWrite wlock(shard.rw_lock);
+				shard.flushing_blocks.swap(shard.blocks);
+				moved_count += shard.flushing_blocks.size();
+			}
+		}
+		_count -= moved_count;
+
+		// Blocks being flushed don't change, and are only read from other threads
+		for (const Lod &lod : _cache) {
+			for (const Shard &shard : lod.shards) {
+				for (auto it = shard.flushing_blocks.begin(); it != shard.flushing_blocks.end(); ++it) {
+					const Block &block = it->second;
+					save_func(block);
+				}
+			}
+		}
+
+		end_func();
+
+		// Blocks are destroyed after unlocking, since freeing their memory takes longer than swapping
+		StdUnorderedMap<Vector3i, Block> flushed_blocks;
+		for (Lod &lod : _cache) {
+			for (Shard &shard : lod.shards) {
+				{
+					RWLockWrite wlock(shard.rw_lock);
+					flushed_blocks.swap(shard.flushing_blocks);
+				}
+				flushed_blocks.clear();
 			}
-			lod.blocks.clear();
 		}
 	}
 
 private:
-	struct Lod {
+	// Blocks are spread across shards with their own lock, so threads loading and saving different blocks rarely wait
+	// on each other. Must be a power of two.
+	static const unsigned int SHARD_COUNT = 16;
+
+	struct Shard {
 		// Not using pointers for values, since unordered_map does not invalidate pointers to values
 		StdUnorderedMap<Vector3i, Block> blocks;
+		// Blocks being saved by `flush`. Looked up after `blocks`, which may contain more recent versions.
+		StdUnorderedMap<Vector3i, Block> flushing_blocks;
 		RWLock rw_lock;
 	};
 
+	struct Lod {
+		FixedArray<Shard, SHARD_COUNT> shards;
+	};
+
+	static inline unsigned int get_shard_index(Vector3i position) {
+		return Vector3iHasher::hash(position) & (SHARD_COUNT - 1);
+	}
+
+	inline Shard &get_shard(Vector3i position, uint8_t lod_index) {
+		return _cache[lod_index].shards[get_shard_index(position)];
+	}
+
+	inline const Shard &get_shard(Vector3i position, uint8_t lod_index) const {
+		return _cache[lod_index].shards[get_shard_index(position)];
+	}
+
 	FixedArray<Lod, constants::MAX_LOD> _cache;
-	unsigned int _count = 0;
+	std::atomic_uint32_t _count = { 0 };
+	Mutex _flush_mutex;
 };
 
 } // namespace zylann::voxel
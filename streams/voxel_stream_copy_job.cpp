@@ -0,0 +1,339 @@
+#include "voxel_stream_copy_job.h"
+#include "../constants/voxel_constants.h"
+#include "../storage/voxel_buffer.h"
+#include "../util/containers/std_vector.h"
+#include "../util/godot/core/class_db.h"
+#include "../util/math/funcs.h"
+#include "../util/profiling.h"
+#include "../util/string/format.h"
+#include "batched_stream_job.h"
+#include <atomic>
+
+namespace zylann::voxel {
+
+// How many blocks a task processes at once. Streams get them in a single query.
+static const unsigned int BATCH_SIZE_IN_BLOCKS = 64;
+
+struct VoxelStreamCopyJob::State : BatchedStreamJobState {
+	Ref<VoxelStream> source;
+	Ref<VoxelStream> destination;
+	StdVector<VoxelStream::BlockKey> keys;
+	uint8_t block_size_po2 = 0;
+	// Compressed blocks of the source are saved as they are
+	bool copy_compressed_data = false;
+	bool source_supports_compressed_blocks = false;
+	bool destination_supports_compressed_blocks = false;
+
+	std::atomic_uint32_t copied_block_count = { 0 };
+	std::atomic_uint32_t failed_block_count = { 0 };
+	std::atomic_uint32_t processed_block_count = { 0 };
+
+	void finish() override {
+		// Streams may have kept blocks in a cache. Also done if the job was cancelled, so blocks copied until then are
+		// not left there.
+		destination->flush();
+	}
+};
+
+namespace {
+
+class CopyStreamBlocksTask : public BatchedStreamJobTask {
+public:
+	CopyStreamBlocksTask(std::shared_ptr<VoxelStreamCopyJob::State> state, uint32_t batch_index) :
+			BatchedStreamJobTask(state, batch_index), _state(state) {}
+
+	const char *get_debug_name() const override {
+		return "CopyStreamBlocks";
+	}
+
+protected:
+	void process_batch(uint32_t batch_index) override {
+		const unsigned int begin = batch_index * BATCH_SIZE_IN_BLOCKS;
+		const unsigned int end =
+				math::min(begin + BATCH_SIZE_IN_BLOCKS, static_cast<unsigned int>(_state->keys.size()));
+		copy_blocks(to_span_const(_state->keys).sub(begin, end - begin));
+		_state->processed_block_count += end - begin;
+	}
+
+private:
+	void copy_blocks(Span<const VoxelStream::BlockKey> keys) {
+		VoxelStream &source = **_state->source;
+
+		if (_state->source_supports_compressed_blocks) {
+			StdVector<VoxelStream::CompressedVoxelQueryData> queries;
+			queries.reserve(keys.size());
+			for (const VoxelStream::BlockKey &key : keys) {
+				queries.push_back(VoxelStream::CompressedVoxelQueryData{
+						StdVector<uint8_t>(), key.position, key.lod_index, VoxelStream::RESULT_ERROR });
+			}
+			source.load_compressed_voxel_blocks(to_span(queries));
+
+			if (_state->copy_compressed_data) {
+				save_compressed_blocks(queries);
+				return;
+			}
+
+			StdVector<VoxelBuffer> buffers;
+			StdVector<VoxelStream::BlockKey> found_keys;
+			buffers.reserve(queries.size());
+			for (const VoxelStream::CompressedVoxelQueryData &q : queries) {
+				if (!check_result(q.result)) {
+					continue;
+				}
+				buffers.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+				if (!source.decompress_voxel_block(to_span_const(q.data), buffers.back())) {
+					ZN_PRINT_ERROR(
+							format("Failed to decompress block {} lod {}", q.position_in_blocks, int(q.lod_index))
+					);
+					buffers.pop_back();
+					++_state->failed_block_count;
+					continue;
+				}
+				found_keys.push_back(VoxelStream::BlockKey{ q.position_in_blocks, q.lod_index });
+			}
+			save_blocks(buffers, found_keys);
+
+		} else {
+			const Vector3i block_size = Vector3iUtil::create(1 << _state->block_size_po2);
+
+			StdVector<VoxelBuffer> buffers;
+			buffers.reserve(keys.size());
+			for (unsigned int i = 0; i < keys.size(); ++i) {
+				buffers.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+				buffers.back().create(block_size);
+			}
+
+			// Queries reference buffers, so they are made once buffers no longer move
+			StdVector<VoxelStream::VoxelQueryData> queries;
+			queries.reserve(keys.size());
+			for (unsigned int i = 0; i < keys.size(); ++i) {
+				queries.push_back(VoxelStream::VoxelQueryData{
+						buffers[i], keys[i].position, keys[i].lod_index, VoxelStream::RESULT_ERROR });
+			}
+			source.load_voxel_blocks(to_span(queries));
+
+			StdVector<VoxelBuffer> found_buffers;
+			StdVector<VoxelStream::BlockKey> found_keys;
+			found_buffers.reserve(keys.size());
+			for (unsigned int i = 0; i < queries.size(); ++i) {
+				if (check_result(queries[i].result)) {
+					found_buffers.push_back(std::move(buffers[i]));
+					found_keys.push_back(keys[i]);
+				}
+			}
+			save_blocks(found_buffers, found_keys);
+		}
+	}
+
+	// Returns true if the block was found. Blocks may have been removed since they were listed.
+	bool check_result(VoxelStream::ResultCode result) {
+		if (result == VoxelStream::RESULT_ERROR) {
+			++_state->failed_block_count;
+		}
+		return result == VoxelStream::RESULT_BLOCK_FOUND;
+	}
+
+	void save_compressed_blocks(StdVector<VoxelStream::CompressedVoxelQueryData> &queries) {
+		unsigned int found_count = 0;
+		for (unsigned int i = 0; i < queries.size(); ++i) {
+			if (check_result(queries[i].result)) {
+				if (i != found_count) {
+					queries[found_count] = std::move(queries[i]);
+				}
+				++found_count;
+			}
+		}
+		queries.resize(found_count);
+		if (found_count == 0) {
+			return;
+		}
+		_state->destination->save_compressed_voxel_blocks(to_span(queries));
+		_state->copied_block_count += found_count;
+	}
+
+	void save_blocks(StdVector<VoxelBuffer> &buffers, const StdVector<VoxelStream::BlockKey> &keys) {
+		ZN_ASSERT(buffers.size() == keys.size());
+		if (buffers.size() == 0) {
+			return;
+		}
+		VoxelStream &destination = **_state->destination;
+
+		if (_state->destination_supports_compressed_blocks) {
+			// Encoding is done here rather than in the stream, which may run it on a single thread
+			StdVector<VoxelStream::CompressedVoxelQueryData> queries;
+			queries.reserve(buffers.size());
+			for (unsigned int i = 0; i < buffers.size(); ++i) {
+				VoxelStream::CompressedVoxelQueryData &q = queries.emplace_back();
+				q.position_in_blocks = keys[i].position;
+				q.lod_index = keys[i].lod_index;
+				q.result = VoxelStream::RESULT_ERROR;
+				if (!destination.compress_voxel_block(buffers[i], q.data)) {
+					ZN_PRINT_ERROR(
+							format("Failed to compress block {} lod {}", keys[i].position, int(keys[i].lod_index))
+					);
+					queries.pop_back();
+					++_state->failed_block_count;
+				}
+			}
+			destination.save_compressed_voxel_blocks(to_span(queries));
+			_state->copied_block_count += queries.size();
+
+		} else {
+			StdVector<VoxelStream::VoxelQueryData> queries;
+			queries.reserve(buffers.size());
+			for (unsigned int i = 0; i < buffers.size(); ++i) {
+				queries.push_back(VoxelStream::VoxelQueryData{
+						buffers[i], keys[i].position, keys[i].lod_index, VoxelStream::RESULT_ERROR });
+			}
+			destination.save_voxel_blocks(to_span(queries));
+			_state->copied_block_count += queries.size();
+		}
+	}
+
+	std::shared_ptr<VoxelStreamCopyJob::State> _state;
+};
+
+} // namespace
+
+VoxelStreamCopyJob::VoxelStreamCopyJob() {}
+
+VoxelStreamCopyJob::~VoxelStreamCopyJob() {
+	// Nothing could query progress anymore
+	cancel();
+}
+
+void VoxelStreamCopyJob::set_source(Ref<VoxelStream> stream) {
+	_source = stream;
+}
+
+Ref<VoxelStream> VoxelStreamCopyJob::get_source() const {
+	return _source;
+}
+
+void VoxelStreamCopyJob::set_destination(Ref<VoxelStream> stream) {
+	_destination = stream;
+}
+
+Ref<VoxelStream> VoxelStreamCopyJob::get_destination() const {
+	return _destination;
+}
+
+void VoxelStreamCopyJob::set_max_pending_tasks(int count) {
+	_max_pending_tasks = math::clamp(count, 1, 255);
+}
+
+int VoxelStreamCopyJob::get_max_pending_tasks() const {
+	return _max_pending_tasks;
+}
+
+void VoxelStreamCopyJob::start() {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_MSG(!is_running(), "The job is already running");
+	ZN_ASSERT_RETURN_MSG(_source.is_valid(), "A source stream is required");
+	ZN_ASSERT_RETURN_MSG(_destination.is_valid(), "A destination stream is required");
+	ZN_ASSERT_RETURN_MSG(_source != _destination, "The source and destination must be different streams");
+	ZN_ASSERT_RETURN_MSG(
+			_source->get_block_size_po2() == _destination->get_block_size_po2(),
+			"Copying between streams of different block sizes is not supported"
+	);
+
+	std::shared_ptr<State> state = make_shared_instance<State>();
+	state->source = _source;
+	state->destination = _destination;
+	state->block_size_po2 = _source->get_block_size_po2();
+
+	ZN_ASSERT_RETURN_MSG(
+			_source->get_voxel_block_keys(state->keys), format("{} can't list its blocks", _source->get_class())
+	);
+
+	const int destination_lod_count = _destination->get_lod_count();
+	for (const VoxelStream::BlockKey &key : state->keys) {
+		ZN_ASSERT_RETURN_MSG(
+				key.lod_index < destination_lod_count,
+				format("The destination stream only supports {} LODs", destination_lod_count)
+		);
+	}
+
+	// Checked after listing blocks, which may be what opens the source and tells how its blocks are compressed
+	state->source_supports_compressed_blocks = _source->supports_compressed_voxel_blocks();
+	state->destination_supports_compressed_blocks = _destination->supports_compressed_voxel_blocks();
+	state->copy_compressed_data =
+			_source->has_portable_compressed_voxel_blocks() && state->destination_supports_compressed_blocks;
+
+	state->batch_count = (state->keys.size() + BATCH_SIZE_IN_BLOCKS - 1) / BATCH_SIZE_IN_BLOCKS;
+
+	_state = state;
+
+	start_batched_stream_job_tasks<CopyStreamBlocksTask>(state, _max_pending_tasks);
+}
+
+void VoxelStreamCopyJob::cancel() {
+	if (_state != nullptr) {
+		_state->cancelled = true;
+	}
+}
+
+bool VoxelStreamCopyJob::is_running() const {
+	return _state != nullptr && _state->running_task_count > 0;
+}
+
+float VoxelStreamCopyJob::get_progress() const {
+	if (_state == nullptr || _state->keys.size() == 0) {
+		return 0.f;
+	}
+	return static_cast<float>(_state->processed_block_count) / static_cast<float>(_state->keys.size());
+}
+
+int VoxelStreamCopyJob::get_total_block_count() const {
+	return _state != nullptr ? _state->keys.size() : 0;
+}
+
+int VoxelStreamCopyJob::get_copied_block_count() const {
+	return _state != nullptr ? _state->copied_block_count.load() : 0;
+}
+
+int VoxelStreamCopyJob::get_failed_block_count() const {
+	return _state != nullptr ? _state->failed_block_count.load() : 0;
+}
+
+bool VoxelStreamCopyJob::is_copying_compressed_data() const {
+	return _state != nullptr && _state->copy_compressed_data;
+}
+
+void VoxelStreamCopyJob::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_source", "stream"), &VoxelStreamCopyJob::set_source);
+	ClassDB::bind_method(D_METHOD("get_source"), &VoxelStreamCopyJob::get_source);
+
+	ClassDB::bind_method(D_METHOD("set_destination", "stream"), &VoxelStreamCopyJob::set_destination);
+	ClassDB::bind_method(D_METHOD("get_destination"), &VoxelStreamCopyJob::get_destination);
+
+	ClassDB::bind_method(D_METHOD("set_max_pending_tasks", "count"), &VoxelStreamCopyJob::set_max_pending_tasks);
+	ClassDB::bind_method(D_METHOD("get_max_pending_tasks"), &VoxelStreamCopyJob::get_max_pending_tasks);
+
+	ClassDB::bind_method(D_METHOD("start"), &VoxelStreamCopyJob::start);
+	ClassDB::bind_method(D_METHOD("cancel"), &VoxelStreamCopyJob::cancel);
+	ClassDB::bind_method(D_METHOD("is_running"), &VoxelStreamCopyJob::is_running);
+	ClassDB::bind_method(D_METHOD("get_progress"), &VoxelStreamCopyJob::get_progress);
+	ClassDB::bind_method(D_METHOD("get_total_block_count"), &VoxelStreamCopyJob::get_total_block_count);
+	ClassDB::bind_method(D_METHOD("get_copied_block_count"), &VoxelStreamCopyJob::get_copied_block_count);
+	ClassDB::bind_method(D_METHOD("get_failed_block_count"), &VoxelStreamCopyJob::get_failed_block_count);
+	ClassDB::bind_method(D_METHOD("is_copying_compressed_data"), &VoxelStreamCopyJob::is_copying_compressed_data);
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "source", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()),
+			"set_source",
+			"get_source"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "destination", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()),
+			"set_destination",
+			"get_destination"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "max_pending_tasks", PROPERTY_HINT_RANGE, "1,255"),
+			"set_max_pending_tasks",
+			"get_max_pending_tasks"
+	);
+}
+
+} // namespace zylann::voxel
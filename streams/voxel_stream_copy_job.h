@@ -0,0 +1,60 @@
+#ifndef VOXEL_STREAM_COPY_JOB_H
+#define VOXEL_STREAM_COPY_JOB_H
+
+#include "../util/godot/classes/ref_counted.h"
+#include "voxel_stream.h"
+#include <memory>
+
+namespace zylann::voxel {
+
+// Copies all blocks of voxels of a stream into another, using the engine's thread pool. Meant to migrate or back up
+// saves. When the destination can store compressed blocks of the source as they are, blocks are moved without being
+// decoded. Otherwise, tasks of the job decode and encode them again in parallel, while streams only read and write
+// bytes if they support compressed blocks.
+// Both streams must use the same block size. Instances are not copied. Terrains should not use the destination while
+// the job runs.
+class VoxelStreamCopyJob : public RefCounted {
+	GDCLASS(VoxelStreamCopyJob, RefCounted)
+public:
+	VoxelStreamCopyJob();
+	~VoxelStreamCopyJob();
+
+	void set_source(Ref<VoxelStream> stream);
+	Ref<VoxelStream> get_source() const;
+
+	void set_destination(Ref<VoxelStream> stream);
+	Ref<VoxelStream> get_destination() const;
+
+	// How many tasks of this job can be in the thread pool at once. Lower values leave more threads to other work.
+	void set_max_pending_tasks(int count);
+	int get_max_pending_tasks() const;
+
+	void start();
+	void cancel();
+
+	bool is_running() const;
+	// Ratio of blocks processed so far, between 0 and 1.
+	float get_progress() const;
+	int get_total_block_count() const;
+	// Blocks which were saved into the destination
+	int get_copied_block_count() const;
+	// Blocks which could not be read or written
+	int get_failed_block_count() const;
+	// True if blocks are moved without being decoded
+	bool is_copying_compressed_data() const;
+
+	struct State;
+
+private:
+	static void _bind_methods();
+
+	Ref<VoxelStream> _source;
+	Ref<VoxelStream> _destination;
+	uint8_t _max_pending_tasks = 4;
+	// Shared with tasks, which may outlive the job
+	std::shared_ptr<State> _state;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_STREAM_COPY_JOB_H
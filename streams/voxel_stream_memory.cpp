@@ -85,50 +85,34 @@ bool VoxelStreamMemory::supports_loading_all_blocks() const {
 }
 
 void VoxelStreamMemory::load_all_blocks(FullLoadingResult &result) {
-	// The return value couples instances and voxels, but our storage is decoupled, so it complicates things a bit
-	StdUnorderedMap<Vector3i, unsigned int> bpos_to_index;
-
 	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
 		const Lod &lod = _lods[lod_index];
-		bpos_to_index.clear();
 
 		MutexLock mlock(lod.mutex);
 
 		for (auto it = lod.voxel_blocks.begin(); it != lod.voxel_blocks.end(); ++it) {
-			const Vector3i bpos = it->first;
-			const unsigned int index = result.blocks.size();
-			bpos_to_index.insert({ bpos, index });
-			result.blocks.resize(index + 1);
-
-			FullLoadingResult::Block &block = result.blocks[index];
-			block.position = bpos;
+			FullLoadingResult::Block &block = result.blocks.emplace_back();
+			block.position = it->first;
 			block.lod = lod_index;
 
 			const VoxelChunk &src = it->second;
 			block.voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
 			src.voxels.copy_to(*block.voxels, true);
 		}
+	}
+}
 
-		for (auto it = lod.instance_blocks.begin(); it != lod.instance_blocks.end(); ++it) {
-			const Vector3i bpos = it->first;
-			FullLoadingResult::Block *block = nullptr;
-			auto pos_it = bpos_to_index.find(bpos);
-			if (pos_it == bpos_to_index.end()) {
-				const unsigned int index = result.blocks.size();
-				result.blocks.resize(index + 1);
-				block = &result.blocks.back();
-				block->position = bpos;
-				block->lod = lod_index;
-				// bpos_to_index.insert({ bpos, index });
-			} else {
-				const unsigned int index = pos_it->second;
-				block = &result.blocks[index];
-			}
-
-			block->instances_data = make_unique_instance<InstanceBlockData>();
-			it->second.copy_to(*block->instances_data);
+bool VoxelStreamMemory::get_voxel_block_keys(StdVector<BlockKey> &out_keys) {
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		const Lod &lod = _lods[lod_index];
+
+		MutexLock mlock(lod.mutex);
+
+		for (auto it = lod.voxel_blocks.begin(); it != lod.voxel_blocks.end(); ++it) {
+			out_keys.push_back(BlockKey{ it->first, static_cast<uint8_t>(lod_index) });
 		}
 	}
+	return true;
 }
 
 int VoxelStreamMemory::get_used_channels_mask() const {
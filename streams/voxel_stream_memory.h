@@ -31,6 +31,8 @@ public:
 	bool supports_loading_all_blocks() const override;
 	void load_all_blocks(FullLoadingResult &result) override;
 
+	bool get_voxel_block_keys(StdVector<BlockKey> &out_keys) override;
+
 	int get_used_channels_mask() const override;
 
 	int get_lod_count() const override;
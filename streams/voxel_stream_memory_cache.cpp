@@ -0,0 +1,445 @@
+#include "voxel_stream_memory_cache.h"
+#include "../storage/voxel_buffer.h"
+#include "../util/profiling.h"
+#include "compressed_data.h"
+#include "voxel_block_serializer.h"
+#include <algorithm>
+
+namespace zylann::voxel {
+
+namespace {
+
+// Compressed blocks stay in memory for a while, so they are stored in vectors of the exact size
+bool compress_voxels(const VoxelBuffer &voxels, StdVector<uint8_t> &out_data) {
+	// Only grows, so it stops allocating after the first few blocks
+	thread_local StdVector<uint8_t> tls_compressed_data;
+
+	const CompressedData::Compression compression = CompressedData::COMPRESSION_LZ4;
+	const size_t size_bound = BlockSerializer::get_serialized_and_compressed_size_bound(voxels, compression);
+	if (tls_compressed_data.size() < size_bound) {
+		tls_compressed_data.resize(size_bound);
+	}
+
+	size_t size = 0;
+	ZN_ASSERT_RETURN_V(
+			BlockSerializer::serialize_and_compress(
+					voxels, to_span(tls_compressed_data), size, compression, CompressedData::ZstdOptions()
+			),
+			false
+	);
+	out_data.assign(tls_compressed_data.begin(), tls_compressed_data.begin() + size);
+	return true;
+}
+
+} // namespace
+
+VoxelStreamMemoryCache::VoxelStreamMemoryCache() {}
+
+VoxelStreamMemoryCache::~VoxelStreamMemoryCache() {
+	if (_modified_block_count > 0) {
+		flush();
+	}
+}
+
+void VoxelStreamMemoryCache::set_stream(Ref<VoxelStream> stream) {
+	ERR_FAIL_COND_MSG(stream.ptr() == this, "The stream can't use itself as backing stream");
+
+	MutexLock lock(_mutex);
+
+	if (stream == _stream) {
+		return;
+	}
+
+	if (_stream.is_valid()) {
+		write_modified_blocks();
+		_stream->flush();
+	}
+
+	// Unmodified blocks came from the previous stream, they don't represent the contents of the new one. Modified
+	// blocks can only remain if there was no stream, in which case they will be written to the new one.
+	for (StdUnorderedMap<Vector3i, Block> &blocks : _lods) {
+		for (auto it = blocks.begin(); it != blocks.end();) {
+			if (it->second.modified) {
+				++it;
+			} else {
+				_memory_usage -= get_memory_usage(it->second);
+				it = blocks.erase(it);
+			}
+		}
+	}
+
+	_stream = stream;
+}
+
+Ref<VoxelStream> VoxelStreamMemoryCache::get_stream() const {
+	MutexLock lock(_mutex);
+	return _stream;
+}
+
+void VoxelStreamMemoryCache::set_memory_budget_bytes(int64_t bytes) {
+	ERR_FAIL_COND(bytes < 0);
+	MutexLock lock(_mutex);
+	_memory_budget = bytes;
+	evict_over_budget();
+}
+
+int64_t VoxelStreamMemoryCache::get_memory_budget_bytes() const {
+	MutexLock lock(_mutex);
+	return _memory_budget;
+}
+
+int64_t VoxelStreamMemoryCache::get_memory_usage_bytes() const {
+	MutexLock lock(_mutex);
+	return _memory_usage;
+}
+
+void VoxelStreamMemoryCache::load_voxel_blocks(Span<VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	MutexLock lock(_mutex);
+
+	StdVector<unsigned int> missing_indices;
+
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		VoxelQueryData &q = p_blocks[i];
+		ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+
+		StdUnorderedMap<Vector3i, Block> &blocks = _lods[q.lod_index];
+		auto it = blocks.find(q.position_in_blocks);
+
+		if (it == blocks.end()) {
+			missing_indices.push_back(i);
+			continue;
+		}
+
+		Block &block = it->second;
+		block.last_use = ++_use_counter;
+
+		if (block.data.size() == 0) {
+			q.result = RESULT_BLOCK_NOT_FOUND;
+		} else if (BlockSerializer::decompress_and_deserialize(to_span(block.data), q.voxel_buffer)) {
+			q.result = RESULT_BLOCK_FOUND;
+		} else {
+			ZN_PRINT_ERROR("Failed to decompress block kept in memory");
+			q.result = RESULT_ERROR;
+		}
+	}
+
+	if (missing_indices.size() == 0) {
+		return;
+	}
+
+	if (_stream.is_null()) {
+		for (const unsigned int i : missing_indices) {
+			p_blocks[i].result = RESULT_BLOCK_NOT_FOUND;
+		}
+		return;
+	}
+
+	StdVector<VoxelQueryData> backing_queries;
+	backing_queries.reserve(missing_indices.size());
+	for (const unsigned int i : missing_indices) {
+		VoxelQueryData &q = p_blocks[i];
+		backing_queries.push_back(VoxelQueryData{ q.voxel_buffer, q.position_in_blocks, q.lod_index, RESULT_ERROR });
+	}
+
+	_stream->load_voxel_blocks(to_span(backing_queries));
+
+	StdVector<uint8_t> data;
+	for (unsigned int j = 0; j < backing_queries.size(); ++j) {
+		const VoxelQueryData &bq = backing_queries[j];
+		p_blocks[missing_indices[j]].result = bq.result;
+
+		data.clear();
+		if (bq.result == RESULT_BLOCK_FOUND) {
+			ZN_ASSERT_CONTINUE(compress_voxels(bq.voxel_buffer, data));
+		} else if (bq.result != RESULT_BLOCK_NOT_FOUND) {
+			// Don't keep errors, the block may load fine next time
+			continue;
+		}
+		set_block(bq.position_in_blocks, bq.lod_index, data, false);
+	}
+
+	evict_over_budget();
+}
+
+void VoxelStreamMemoryCache::save_voxel_blocks(Span<VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+
+	// Compress before locking, as it is the most expensive part
+	StdVector<StdVector<uint8_t>> compressed_blocks;
+	compressed_blocks.resize(p_blocks.size());
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		const VoxelQueryData &q = p_blocks[i];
+		ZN_ASSERT_CONTINUE(q.lod_index < _lods.size());
+		ZN_ASSERT_CONTINUE(compress_voxels(q.voxel_buffer, compressed_blocks[i]));
+	}
+
+	MutexLock lock(_mutex);
+
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		StdVector<uint8_t> &data = compressed_blocks[i];
+		if (data.size() == 0) {
+			// Failed to compress
+			continue;
+		}
+		const VoxelQueryData &q = p_blocks[i];
+		set_block(q.position_in_blocks, q.lod_index, data, true);
+	}
+
+	evict_over_budget();
+}
+
+void VoxelStreamMemoryCache::load_voxel_block(VoxelQueryData &query_data) {
+	load_voxel_blocks(Span<VoxelQueryData>(&query_data, 1));
+}
+
+void VoxelStreamMemoryCache::save_voxel_block(VoxelQueryData &query_data) {
+	save_voxel_blocks(Span<VoxelQueryData>(&query_data, 1));
+}
+
+bool VoxelStreamMemoryCache::supports_instance_blocks() const {
+	Ref<VoxelStream> stream = get_stream();
+	return stream.is_valid() && stream->supports_instance_blocks();
+}
+
+void VoxelStreamMemoryCache::load_instance_blocks(Span<InstancesQueryData> out_blocks) {
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		stream->load_instance_blocks(out_blocks);
+	} else {
+		VoxelStream::load_instance_blocks(out_blocks);
+	}
+}
+
+void VoxelStreamMemoryCache::save_instance_blocks(Span<InstancesQueryData> p_blocks) {
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		stream->save_instance_blocks(p_blocks);
+	} else {
+		VoxelStream::save_instance_blocks(p_blocks);
+	}
+}
+
+bool VoxelStreamMemoryCache::supports_loading_all_blocks() const {
+	Ref<VoxelStream> stream = get_stream();
+	return stream.is_valid() && stream->supports_loading_all_blocks();
+}
+
+void VoxelStreamMemoryCache::load_all_blocks(FullLoadingResult &result) {
+	ZN_PROFILE_SCOPE();
+	MutexLock lock(_mutex);
+	ERR_FAIL_COND(_stream.is_null());
+	// Blocks kept in memory may be more recent, the backing stream has to be up to date first
+	write_modified_blocks();
+	_stream->load_all_blocks(result);
+}
+
+bool VoxelStreamMemoryCache::decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const {
+	Ref<VoxelStream> stream = get_stream();
+	ZN_ASSERT_RETURN_V(stream.is_valid(), false);
+	return stream->decompress_voxel_block(data, out_voxels);
+}
+
+int VoxelStreamMemoryCache::get_used_channels_mask() const {
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		return stream->get_used_channels_mask();
+	}
+	return VoxelBuffer::ALL_CHANNELS_MASK;
+}
+
+int VoxelStreamMemoryCache::get_block_size_po2() const {
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		return stream->get_block_size_po2();
+	}
+	return VoxelStream::get_block_size_po2();
+}
+
+int VoxelStreamMemoryCache::get_lod_count() const {
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		return stream->get_lod_count();
+	}
+	return _lods.size();
+}
+
+Box3i VoxelStreamMemoryCache::get_supported_block_range() const {
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		return stream->get_supported_block_range();
+	}
+	return VoxelStream::get_supported_block_range();
+}
+
+void VoxelStreamMemoryCache::flush() {
+	ZN_PROFILE_SCOPE();
+	MutexLock lock(_mutex);
+	if (_stream.is_null()) {
+		return;
+	}
+	write_modified_blocks();
+	_stream->flush();
+}
+
+size_t VoxelStreamMemoryCache::get_memory_usage(const Block &block) {
+	// Doesn't account for the overhead of the map and allocators, which depends on the implementation
+	return sizeof(Vector3i) + sizeof(Block) + block.data.capacity();
+}
+
+void VoxelStreamMemoryCache::set_block(Vector3i position, uint8_t lod_index, StdVector<uint8_t> &data, bool modified) {
+	StdUnorderedMap<Vector3i, Block> &blocks = _lods[lod_index];
+
+	auto it = blocks.find(position);
+	if (it == blocks.end()) {
+		it = blocks.insert({ position, Block() }).first;
+	} else {
+		_memory_usage -= get_memory_usage(it->second);
+		if (it->second.modified) {
+			--_modified_block_count;
+		}
+	}
+
+	Block &block = it->second;
+	block.data.swap(data);
+	block.last_use = ++_use_counter;
+	block.modified = modified;
+
+	if (modified) {
+		++_modified_block_count;
+	}
+	_memory_usage += get_memory_usage(block);
+}
+
+// Must be called while locked
+void VoxelStreamMemoryCache::write_modified_blocks() {
+	if (_modified_block_count == 0 || _stream.is_null()) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	// Reserved so references to voxels remain valid
+	StdVector<VoxelBuffer> voxels;
+	voxels.reserve(_modified_block_count);
+	StdVector<VoxelQueryData> queries;
+	queries.reserve(_modified_block_count);
+
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		StdUnorderedMap<Vector3i, Block> &blocks = _lods[lod_index];
+
+		for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+			Block &block = it->second;
+			if (!block.modified) {
+				continue;
+			}
+			block.modified = false;
+
+			VoxelBuffer &vb = voxels.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+			if (!BlockSerializer::decompress_and_deserialize(to_span(block.data), vb)) {
+				ZN_PRINT_ERROR("Failed to decompress block kept in memory");
+				voxels.pop_back();
+				continue;
+			}
+			queries.push_back(VoxelQueryData{ vb, it->first, static_cast<uint8_t>(lod_index), RESULT_ERROR });
+		}
+	}
+
+	_modified_block_count = 0;
+
+	_stream->save_voxel_blocks(to_span(queries));
+}
+
+// Must be called while locked
+void VoxelStreamMemoryCache::evict_over_budget() {
+	if (_memory_usage <= static_cast<size_t>(_memory_budget)) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	// Evicting down to a lower target, so we don't have to do it again after every following save
+	const size_t target_usage = _memory_budget - _memory_budget / 4;
+
+	struct Candidate {
+		uint64_t last_use;
+		Vector3i position;
+		uint8_t lod_index;
+	};
+
+	StdVector<Candidate> candidates;
+	const bool can_write = _stream.is_valid();
+
+	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
+		const StdUnorderedMap<Vector3i, Block> &blocks = _lods[lod_index];
+		for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+			// Without a backing stream, modified blocks are kept because evicting them would lose data
+			if (it->second.modified && !can_write) {
+				continue;
+			}
+			candidates.push_back(Candidate{ it->second.last_use, it->first, static_cast<uint8_t>(lod_index) });
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+		return a.last_use < b.last_use;
+	});
+
+	// Reserved so references to voxels remain valid
+	StdVector<VoxelBuffer> voxels;
+	voxels.reserve(std::min(candidates.size(), static_cast<size_t>(_modified_block_count)));
+	StdVector<VoxelQueryData> queries;
+
+	for (const Candidate &candidate : candidates) {
+		if (_memory_usage <= target_usage) {
+			break;
+		}
+
+		StdUnorderedMap<Vector3i, Block> &blocks = _lods[candidate.lod_index];
+		auto it = blocks.find(candidate.position);
+		ZN_ASSERT_CONTINUE(it != blocks.end());
+		const Block &block = it->second;
+
+		if (block.modified) {
+			--_modified_block_count;
+			VoxelBuffer &vb = voxels.emplace_back(VoxelBuffer::ALLOCATOR_POOL);
+			if (BlockSerializer::decompress_and_deserialize(to_span(block.data), vb)) {
+				queries.push_back(VoxelQueryData{ vb, candidate.position, candidate.lod_index, RESULT_ERROR });
+			} else {
+				ZN_PRINT_ERROR("Failed to decompress block kept in memory");
+				voxels.pop_back();
+			}
+		}
+
+		_memory_usage -= get_memory_usage(block);
+		blocks.erase(it);
+	}
+
+	if (queries.size() > 0) {
+		_stream->save_voxel_blocks(to_span(queries));
+	}
+}
+
+void VoxelStreamMemoryCache::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_stream", "stream"), &VoxelStreamMemoryCache::set_stream);
+	ClassDB::bind_method(D_METHOD("get_stream"), &VoxelStreamMemoryCache::get_stream);
+
+	ClassDB::bind_method(
+			D_METHOD("set_memory_budget_bytes", "bytes"), &VoxelStreamMemoryCache::set_memory_budget_bytes
+	);
+	ClassDB::bind_method(D_METHOD("get_memory_budget_bytes"), &VoxelStreamMemoryCache::get_memory_budget_bytes);
+
+	ClassDB::bind_method(D_METHOD("get_memory_usage_bytes"), &VoxelStreamMemoryCache::get_memory_usage_bytes);
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()),
+			"set_stream",
+			"get_stream"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "memory_budget_bytes"), "set_memory_budget_bytes", "get_memory_budget_bytes"
+	);
+}
+
+} // namespace zylann::voxel
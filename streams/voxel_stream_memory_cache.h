@@ -0,0 +1,88 @@
+#ifndef VOXEL_STREAM_MEMORY_CACHE_H
+#define VOXEL_STREAM_MEMORY_CACHE_H
+
+#include "../constants/voxel_constants.h"
+#include "../util/containers/fixed_array.h"
+#include "../util/containers/span.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/vector3i.h"
+#include "../util/thread/mutex.h"
+#include "voxel_stream.h"
+
+namespace zylann::voxel {
+
+// Keeps recently used voxel blocks in memory in compressed form, in front of another stream.
+// Saved blocks are written to the backing stream only when they get evicted, or when the stream is flushed. Blocks
+// get evicted least recently used first, when memory usage exceeds the budget. Blocks loaded from the backing stream
+// are kept too, including the fact they were not found, so loading them again doesn't access the backing stream.
+// Instances are not kept in memory, they are directly forwarded to the backing stream.
+class VoxelStreamMemoryCache : public VoxelStream {
+	GDCLASS(VoxelStreamMemoryCache, VoxelStream)
+public:
+	static const int64_t DEFAULT_MEMORY_BUDGET_BYTES = 64 * 1024 * 1024;
+
+	VoxelStreamMemoryCache();
+	~VoxelStreamMemoryCache();
+
+	// Modified blocks are written to the previous stream before it gets replaced.
+	void set_stream(Ref<VoxelStream> stream);
+	Ref<VoxelStream> get_stream() const;
+
+	void set_memory_budget_bytes(int64_t bytes);
+	int64_t get_memory_budget_bytes() const;
+
+	// Approximate amount of memory used by blocks kept in memory
+	int64_t get_memory_usage_bytes() const override;
+
+	void load_voxel_blocks(Span<VoxelQueryData> p_blocks) override;
+	void save_voxel_blocks(Span<VoxelQueryData> p_blocks) override;
+	void load_voxel_block(VoxelQueryData &query_data) override;
+	void save_voxel_block(VoxelQueryData &query_data) override;
+
+	bool supports_instance_blocks() const override;
+	void load_instance_blocks(Span<InstancesQueryData> out_blocks) override;
+	void save_instance_blocks(Span<InstancesQueryData> p_blocks) override;
+
+	bool supports_loading_all_blocks() const override;
+	void load_all_blocks(FullLoadingResult &result) override;
+	bool decompress_voxel_block(Span<const uint8_t> data, VoxelBuffer &out_voxels) const override;
+
+	int get_used_channels_mask() const override;
+	int get_block_size_po2() const override;
+	int get_lod_count() const override;
+	Box3i get_supported_block_range() const override;
+
+	void flush() override;
+
+private:
+	struct Block {
+		// Compressed voxels. Empty if the block was not found in the backing stream.
+		StdVector<uint8_t> data;
+		// Value of the use counter the last time the block was loaded or saved
+		uint64_t last_use = 0;
+		// True if the block was saved and hasn't been written to the backing stream yet
+		bool modified = false;
+	};
+
+	static size_t get_memory_usage(const Block &block);
+
+	void set_block(Vector3i position, uint8_t lod_index, StdVector<uint8_t> &data, bool modified);
+	void write_modified_blocks();
+	void evict_over_budget();
+
+	static void _bind_methods();
+
+	FixedArray<StdUnorderedMap<Vector3i, Block>, constants::MAX_LOD> _lods;
+	Ref<VoxelStream> _stream;
+	int64_t _memory_budget = DEFAULT_MEMORY_BUDGET_BYTES;
+	size_t _memory_usage = 0;
+	uint64_t _use_counter = 0;
+	unsigned int _modified_block_count = 0;
+	// Also held while accessing the backing stream, so blocks being evicted can't be seen as missing
+	Mutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_STREAM_MEMORY_CACHE_H
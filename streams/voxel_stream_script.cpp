@@ -1,18 +1,46 @@
 #include "voxel_stream_script.h"
 #include "../constants/voxel_string_names.h"
 #include "../storage/voxel_buffer_gd.h"
+#include "../util/containers/std_vector.h"
 #include "../util/godot/check_ref_ownership.h"
+#include "../util/godot/core/packed_arrays.h"
+#include "../util/io/log.h"
+#include "../util/profiling.h"
+#include "../util/string/format.h"
 
 namespace zylann::voxel {
 
+namespace {
+
+// Creates a temporary wrapper so Godot can pass it to scripts, with the same format and size as the queried buffer
+Ref<godot::VoxelBuffer> create_load_buffer_wrapper(const VoxelBuffer &voxel_buffer) {
+	Ref<godot::VoxelBuffer> buffer_wrapper(
+			memnew(godot::VoxelBuffer(static_cast<godot::VoxelBuffer::Allocator>(voxel_buffer.get_allocator())))
+	);
+	buffer_wrapper->get_buffer().copy_format(voxel_buffer);
+	buffer_wrapper->get_buffer().create(voxel_buffer.get_size());
+	return buffer_wrapper;
+}
+
+// For now the callee can exceptionally take ownership of this wrapper, because we copy the data to it.
+Ref<godot::VoxelBuffer> create_save_buffer_wrapper(const VoxelBuffer &voxel_buffer) {
+	Ref<godot::VoxelBuffer> buffer_wrapper(
+			memnew(godot::VoxelBuffer(static_cast<godot::VoxelBuffer::Allocator>(voxel_buffer.get_allocator())))
+	);
+	voxel_buffer.copy_to(buffer_wrapper->get_buffer(), true);
+	return buffer_wrapper;
+}
+
+} // namespace
+
 void VoxelStreamScript::load_voxel_block(VoxelStream::VoxelQueryData &query_data) {
-	Variant output;
-	// Create a temporary wrapper so Godot can pass it to scripts
-	Ref<godot::VoxelBuffer> buffer_wrapper(memnew(
-			godot::VoxelBuffer(static_cast<godot::VoxelBuffer::Allocator>(query_data.voxel_buffer.get_allocator()))));
-	buffer_wrapper->get_buffer().copy_format(query_data.voxel_buffer);
-	buffer_wrapper->get_buffer().create(query_data.voxel_buffer.get_size());
+	load_voxel_block_with_buffer_wrapper(query_data, create_load_buffer_wrapper(query_data.voxel_buffer));
+}
 
+void VoxelStreamScript::load_voxel_block_with_buffer_wrapper(
+		VoxelStream::VoxelQueryData &query_data,
+		Ref<godot::VoxelBuffer> buffer_wrapper
+) {
 	query_data.result = RESULT_ERROR;
 
 	ZN_GODOT_CHECK_REF_COUNT_DOES_NOT_CHANGE(buffer_wrapper);
@@ -33,15 +61,107 @@ void VoxelStreamScript::load_voxel_block(VoxelStream::VoxelQueryData &query_data
 }
 
 void VoxelStreamScript::save_voxel_block(VoxelStream::VoxelQueryData &query_data) {
-	// For now the callee can exceptionally take ownership of this wrapper, because we copy the data to it.
-	Ref<godot::VoxelBuffer> buffer_wrapper(memnew(
-			godot::VoxelBuffer(static_cast<godot::VoxelBuffer::Allocator>(query_data.voxel_buffer.get_allocator()))));
-	query_data.voxel_buffer.copy_to(buffer_wrapper->get_buffer(), true);
+	save_voxel_block_with_buffer_wrapper(query_data, create_save_buffer_wrapper(query_data.voxel_buffer));
+}
+
+void VoxelStreamScript::save_voxel_block_with_buffer_wrapper(
+		VoxelStream::VoxelQueryData &query_data,
+		Ref<godot::VoxelBuffer> buffer_wrapper
+) {
 	if (!GDVIRTUAL_CALL(_save_voxel_block, buffer_wrapper, query_data.position_in_blocks, query_data.lod_index)) {
 		WARN_PRINT_ONCE("VoxelStreamScript::_save_voxel_block is unimplemented!");
 	}
 }
 
+void VoxelStreamScript::load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+	if (p_blocks.size() == 0) {
+		return;
+	}
+
+	// Wrappers are kept on our side too, in case the script modifies the array
+	StdVector<Ref<godot::VoxelBuffer>> buffer_wrappers;
+	buffer_wrappers.reserve(p_blocks.size());
+
+	Array buffers;
+	TypedArray<Vector3i> positions;
+	PackedInt32Array lods;
+	buffers.resize(p_blocks.size());
+	positions.resize(p_blocks.size());
+	lods.resize(p_blocks.size());
+
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		VoxelStream::VoxelQueryData &q = p_blocks[i];
+		q.result = RESULT_ERROR;
+		Ref<godot::VoxelBuffer> buffer_wrapper = create_load_buffer_wrapper(q.voxel_buffer);
+		buffer_wrappers.push_back(buffer_wrapper);
+		buffers[i] = buffer_wrapper;
+		positions[i] = q.position_in_blocks;
+		lods.set(i, q.lod_index);
+	}
+
+	PackedInt32Array results;
+	if (!GDVIRTUAL_CALL(_load_voxel_blocks, buffers, positions, lods, results)) {
+		// The script only loads one block at a time
+		buffers.clear();
+		for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+			load_voxel_block_with_buffer_wrapper(p_blocks[i], buffer_wrappers[i]);
+		}
+		return;
+	}
+
+	if (static_cast<unsigned int>(results.size()) != p_blocks.size()) {
+		ZN_PRINT_ERROR(format(
+				"VoxelStreamScript::_load_voxel_blocks returned {} results, expected {}",
+				results.size(),
+				p_blocks.size()
+		));
+		return;
+	}
+
+	Span<const int32_t> results_s = to_span(results);
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		const int res = results_s[i];
+		// Check if the return enum is valid
+		ERR_CONTINUE(res < 0 || res >= _RESULT_COUNT);
+		VoxelStream::VoxelQueryData &q = p_blocks[i];
+		if (res == RESULT_BLOCK_FOUND) {
+			buffer_wrappers[i]->get_buffer().move_to(q.voxel_buffer);
+		}
+		q.result = ResultCode(res);
+	}
+}
+
+void VoxelStreamScript::save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) {
+	ZN_PROFILE_SCOPE();
+	if (p_blocks.size() == 0) {
+		return;
+	}
+
+	// The callee can take ownership of these wrappers, so it may finish saving them later
+	Array buffers;
+	TypedArray<Vector3i> positions;
+	PackedInt32Array lods;
+	buffers.resize(p_blocks.size());
+	positions.resize(p_blocks.size());
+	lods.resize(p_blocks.size());
+
+	for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+		const VoxelStream::VoxelQueryData &q = p_blocks[i];
+		buffers[i] = create_save_buffer_wrapper(q.voxel_buffer);
+		positions[i] = q.position_in_blocks;
+		lods.set(i, q.lod_index);
+	}
+
+	if (!GDVIRTUAL_CALL(_save_voxel_blocks, buffers, positions, lods)) {
+		// The script only saves one block at a time
+		for (unsigned int i = 0; i < p_blocks.size(); ++i) {
+			Ref<godot::VoxelBuffer> buffer_wrapper = buffers[i];
+			save_voxel_block_with_buffer_wrapper(p_blocks[i], buffer_wrapper);
+		}
+	}
+}
+
 int VoxelStreamScript::get_used_channels_mask() const {
 	int mask = 0;
 	if (!GDVIRTUAL_CALL(_get_used_channels_mask, mask)) {
@@ -54,6 +174,8 @@ void VoxelStreamScript::_bind_methods() {
 	// TODO Test if GDVIRTUAL can print errors properly when GDScript fails inside a different thread.
 	GDVIRTUAL_BIND(_load_voxel_block, "out_buffer", "position_in_blocks", "lod");
 	GDVIRTUAL_BIND(_save_voxel_block, "buffer", "position_in_blocks", "lod");
+	GDVIRTUAL_BIND(_load_voxel_blocks, "out_buffers", "positions_in_blocks", "lods");
+	GDVIRTUAL_BIND(_save_voxel_blocks, "buffers", "positions_in_blocks", "lods");
 	GDVIRTUAL_BIND(_get_used_channels_mask);
 }
 
@@ -2,6 +2,7 @@
 #define VOXEL_STREAM_SCRIPT_H
 
 #include "../util/godot/core/gdvirtual.h"
+#include "../util/godot/core/typed_array.h"
 #include "voxel_stream.h"
 
 #ifdef ZN_GODOT_EXTENSION
@@ -14,20 +15,31 @@ namespace zylann::voxel {
 // Provides access to a source of paged voxel data, which may load and save.
 // Must be implemented in a multi-thread-safe way.
 // If you are looking for a more specialized API to generate voxels, use VoxelGenerator.
+// Scripts may load and save several blocks in one call, which allows them to send requests for all blocks at once
+// instead of waiting for each block one after the other (for example with a remote database).
 class VoxelStreamScript : public VoxelStream {
 	GDCLASS(VoxelStreamScript, VoxelStream)
 public:
 	void load_voxel_block(VoxelStream::VoxelQueryData &q) override;
 	void save_voxel_block(VoxelStream::VoxelQueryData &q) override;
 
+	void load_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) override;
+	void save_voxel_blocks(Span<VoxelStream::VoxelQueryData> p_blocks) override;
+
 	int get_used_channels_mask() const override;
 
 protected:
 	// TODO Why is it unable to convert `Result` into `Variant` even though a cast is defined in voxel_stream.h???
 	GDVIRTUAL3R(int, _load_voxel_block, Ref<godot::VoxelBuffer>, Vector3i, int)
 	GDVIRTUAL3(_save_voxel_block, Ref<godot::VoxelBuffer>, Vector3i, int)
+	GDVIRTUAL3R(PackedInt32Array, _load_voxel_blocks, Array, TypedArray<Vector3i>, PackedInt32Array)
+	GDVIRTUAL3(_save_voxel_blocks, Array, TypedArray<Vector3i>, PackedInt32Array)
 	GDVIRTUAL0RC(int, _get_used_channels_mask) // I think `C` means `const`?
 
+private:
+	void load_voxel_block_with_buffer_wrapper(VoxelStream::VoxelQueryData &q, Ref<godot::VoxelBuffer> buffer_wrapper);
+	void save_voxel_block_with_buffer_wrapper(VoxelStream::VoxelQueryData &q, Ref<godot::VoxelBuffer> buffer_wrapper);
+
 	static void _bind_methods();
 };
 
@@ -0,0 +1,31 @@
+#include "compress_cold_blocks_task.h"
+#include "../constants/voxel_constants.h"
+#include "../engine/voxel_engine.h"
+#include "../storage/voxel_data.h"
+#include "../util/errors.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+void CompressColdBlocksTask::run(ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(data != nullptr);
+	ZN_ASSERT(state != nullptr);
+
+	const uint64_t saved_bytes = data->compress_block_voxels(to_span_const(block_positions));
+	state->saved_bytes += saved_bytes;
+	state->running = false;
+}
+
+TaskPriority CompressColdBlocksTask::get_priority() {
+	TaskPriority p;
+	p.band2 = constants::TASK_PRIORITY_COMPRESS_COLD_BLOCKS_BAND2;
+	p.band3 = constants::TASK_PRIORITY_BAND3_DEFAULT;
+	return p;
+}
+
+int CompressColdBlocksTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
+} // namespace zylann::voxel
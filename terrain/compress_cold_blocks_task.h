@@ -0,0 +1,42 @@
+#ifndef VOXEL_COMPRESS_COLD_BLOCKS_TASK_H
+#define VOXEL_COMPRESS_COLD_BLOCKS_TASK_H
+
+#include "../engine/ids.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/vector3i.h"
+#include "../util/tasks/threaded_task.h"
+#include <atomic>
+#include <memory>
+
+namespace zylann::voxel {
+
+class VoxelData;
+
+// Compresses voxels of data blocks that were not accessed for a while, so loaded blocks use less memory.
+class CompressColdBlocksTask : public IThreadedTask {
+public:
+	// Shared with the terrain scheduling the task
+	struct State {
+		// Set until the task completes, so only one runs at a time
+		std::atomic_bool running = { false };
+		// Total amount of bytes saved by compression so far
+		std::atomic_uint64_t saved_bytes = { 0 };
+	};
+
+	VolumeID volume_id;
+	std::shared_ptr<VoxelData> data;
+	StdVector<Vector3i> block_positions;
+	std::shared_ptr<State> state;
+
+	const char *get_debug_name() const override {
+		return "CompressColdBlocks";
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+	int get_group() const override;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_COMPRESS_COLD_BLOCKS_TASK_H
@@ -0,0 +1,105 @@
+#include "mesh_quick_reloading_cache.h"
+#include "../../util/errors.h"
+
+namespace zylann::voxel {
+
+void MeshQuickReloadingCache::set_max_size_in_bytes(uint64_t max_size) {
+	_max_size_in_bytes = max_size;
+	evict();
+}
+
+uint64_t MeshQuickReloadingCache::get_entry_cost(const Entry &entry) {
+	// Empty blocks are cached too, so they must not be free
+	return sizeof(Item) + entry.mesh_size_in_bytes + entry.collision_size_in_bytes;
+}
+
+void MeshQuickReloadingCache::put(Vector3i position, Entry &&entry) {
+	if (_max_size_in_bytes == 0) {
+		return;
+	}
+
+	auto it = _entries.find(position);
+	if (it != _entries.end()) {
+		remove_item(it);
+	}
+
+	const uint32_t stamp = _next_stamp;
+	++_next_stamp;
+
+	_size_in_bytes += get_entry_cost(entry);
+	_entries.insert({ position, Item{ std::move(entry), stamp } });
+	_order.push(QueuedPosition{ position, stamp });
+
+	if (_order.size() > 2 * _entries.size() + 64) {
+		// Too many positions of entries that were taken or removed, drop them
+		StdQueue<QueuedPosition> order;
+		while (!_order.empty()) {
+			const QueuedPosition qp = _order.front();
+			_order.pop();
+			auto item_it = _entries.find(qp.position);
+			if (item_it != _entries.end() && item_it->second.stamp == qp.stamp) {
+				order.push(qp);
+			}
+		}
+		_order = std::move(order);
+	}
+
+	evict();
+}
+
+bool MeshQuickReloadingCache::take(Vector3i position, Entry &out_entry) {
+	auto it = _entries.find(position);
+	if (it == _entries.end()) {
+		return false;
+	}
+	out_entry = std::move(it->second.entry);
+	remove_item(it);
+	return true;
+}
+
+void MeshQuickReloadingCache::remove(Vector3i position) {
+	auto it = _entries.find(position);
+	if (it != _entries.end()) {
+		remove_item(it);
+	}
+}
+
+void MeshQuickReloadingCache::remove_area(const Box3i &box) {
+	if (_entries.size() == 0) {
+		return;
+	}
+	for (auto it = _entries.begin(); it != _entries.end();) {
+		if (box.contains(it->first)) {
+			_size_in_bytes -= get_entry_cost(it->second.entry);
+			it = _entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void MeshQuickReloadingCache::clear() {
+	_entries.clear();
+	_order = StdQueue<QueuedPosition>();
+	_size_in_bytes = 0;
+}
+
+void MeshQuickReloadingCache::remove_item(StdUnorderedMap<Vector3i, Item>::iterator it) {
+	const uint64_t cost = get_entry_cost(it->second.entry);
+	ZN_ASSERT(cost <= _size_in_bytes);
+	_size_in_bytes -= cost;
+	_entries.erase(it);
+}
+
+void MeshQuickReloadingCache::evict() {
+	while (_size_in_bytes > _max_size_in_bytes && !_order.empty()) {
+		const QueuedPosition qp = _order.front();
+		_order.pop();
+		auto it = _entries.find(qp.position);
+		if (it != _entries.end() && it->second.stamp == qp.stamp) {
+			remove_item(it);
+		}
+	}
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,82 @@
+#ifndef VOXEL_MESH_QUICK_RELOADING_CACHE_H
+#define VOXEL_MESH_QUICK_RELOADING_CACHE_H
+
+#include "../../util/containers/std_queue.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/godot/classes/mesh.h"
+#include "../../util/godot/classes/shape_3d.h"
+#include "../../util/math/box3i.h"
+
+namespace zylann::voxel {
+
+// Keeps meshes of blocks that recently left the view distance of `VoxelTerrain`, so they can be shown again without
+// meshing if viewers come back to them, for example when they turn around or move back and forth across the view
+// boundary. Entries are removed when they are reused, when voxels around them change, or when the size limit is
+// exceeded, least recently cached first. Only used on the main thread.
+class MeshQuickReloadingCache {
+public:
+	struct Entry {
+		Ref<Mesh> mesh;
+		Ref<Mesh> shadow_occluder_mesh;
+		Ref<Shape3D> collision_shape;
+		uint32_t mesh_size_in_bytes = 0;
+		uint32_t collision_size_in_bytes = 0;
+		// False if the block did not have collision when it was cached, so the collision shape is not known
+		bool has_collision = false;
+	};
+
+	// 0 disables the cache.
+	void set_max_size_in_bytes(uint64_t max_size);
+
+	inline uint64_t get_max_size_in_bytes() const {
+		return _max_size_in_bytes;
+	}
+
+	inline uint64_t get_size_in_bytes() const {
+		return _size_in_bytes;
+	}
+
+	inline unsigned int get_entry_count() const {
+		return _entries.size();
+	}
+
+	void put(Vector3i position, Entry &&entry);
+
+	// Removes the entry at the given position and returns it, if any.
+	bool take(Vector3i position, Entry &out_entry);
+
+	void remove(Vector3i position);
+
+	// Removes entries at positions contained in the given box, in mesh blocks.
+	void remove_area(const Box3i &box);
+
+	void clear();
+
+private:
+	struct Item {
+		Entry entry;
+		uint32_t stamp;
+	};
+
+	struct QueuedPosition {
+		Vector3i position;
+		uint32_t stamp;
+	};
+
+	static uint64_t get_entry_cost(const Entry &entry);
+
+	void remove_item(StdUnorderedMap<Vector3i, Item>::iterator it);
+	void evict();
+
+	StdUnorderedMap<Vector3i, Item> _entries;
+	// Positions in the order they were cached. Positions of removed entries are left in it and skipped when evicting,
+	// which is why they carry a stamp.
+	StdQueue<QueuedPosition> _order;
+	uint32_t _next_stamp = 0;
+	uint64_t _size_in_bytes = 0;
+	uint64_t _max_size_in_bytes = 0;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_MESH_QUICK_RELOADING_CACHE_H
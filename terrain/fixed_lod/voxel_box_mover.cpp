@@ -3,7 +3,10 @@
 #include "../../meshers/cubes/voxel_mesher_cubes.h"
 #include "../../storage/voxel_buffer.h"
 #include "../../storage/voxel_data.h"
+#include "../../util/containers/std_unordered_map.h"
 #include "../../util/containers/std_vector.h"
+#include "../../util/godot/core/packed_arrays.h"
+#include "../../util/math/box3i.h"
 #include "../../util/profiling.h"
 #include "voxel_terrain.h"
 
@@ -186,90 +189,270 @@ bool intersects(Span<const AABB> aabbs, const AABB &box) {
 	return false;
 }
 
-void collect_boxes(VoxelTerrain &p_terrain, AABB query_box, uint32_t collision_nask, StdVector<AABB> &potential_boxes) {
-	ZN_PROFILE_SCOPE();
-	const VoxelData &voxels = p_terrain.get_storage();
-
-	const int min_x = int(Math::floor(query_box.position.x));
-	const int min_y = int(Math::floor(query_box.position.y));
-	const int min_z = int(Math::floor(query_box.position.z));
-
-	const Vector3 query_box_end = query_box.position + query_box.size;
-	const int max_x = int(Math::ceil(query_box_end.x));
-	const int max_y = int(Math::ceil(query_box_end.y));
-	const int max_z = int(Math::ceil(query_box_end.z));
-
-	Vector3i i(min_x, min_y, min_z);
+// Tells how voxels of a terrain collide with boxes
+struct BoxCollisionSource {
+	const VoxelData *voxels = nullptr;
+	unsigned int channel = 0;
+	// Set when the terrain uses blocky voxels. Otherwise, every non-zero voxel is a unit cube.
+	const VoxelBlockyLibraryBase::BakedData *baked_data = nullptr;
+	uint32_t collision_mask = 0;
+};
 
+bool get_box_collision_source(VoxelTerrain &terrain, uint32_t collision_mask, BoxCollisionSource &out_source) {
 	Ref<VoxelMesherBlocky> mesher_blocky;
 	Ref<VoxelMesherCubes> mesher_cubes;
 
-	if (zylann::godot::try_get_as(p_terrain.get_mesher(), mesher_blocky)) {
+	if (zylann::godot::try_get_as(terrain.get_mesher(), mesher_blocky)) {
 		Ref<VoxelBlockyLibraryBase> library_ref = mesher_blocky->get_library();
-		ERR_FAIL_COND_MSG(library_ref.is_null(), "VoxelMesherBlocky has no library assigned");
-		const int channel = VoxelBuffer::CHANNEL_TYPE;
-		VoxelSingleValue defval;
-		defval.i = 0;
+		ERR_FAIL_COND_V_MSG(library_ref.is_null(), false, "VoxelMesherBlocky has no library assigned");
+		out_source.channel = VoxelBuffer::CHANNEL_TYPE;
+		out_source.baked_data = &library_ref->get_baked_data();
 
-		const VoxelBlockyLibraryBase::BakedData &baked_data = library_ref->get_baked_data();
+	} else if (zylann::godot::try_get_as(terrain.get_mesher(), mesher_cubes)) {
+		out_source.channel = VoxelBuffer::CHANNEL_COLOR;
+		out_source.baked_data = nullptr;
 
-		// TODO Optimization: read the whole box of voxels at once, querying individually is slower
-		for (i.z = min_z; i.z < max_z; ++i.z) {
-			for (i.y = min_y; i.y < max_y; ++i.y) {
-				for (i.x = min_x; i.x < max_x; ++i.x) {
-					const int type_id = voxels.get_voxel(i, channel, defval).i;
+	} else {
+		return false;
+	}
 
-					if (baked_data.has_model(type_id)) {
-						const VoxelBlockyModel::BakedData &model = baked_data.models[type_id];
+	out_source.voxels = &terrain.get_storage();
+	out_source.collision_mask = collision_mask;
+	return true;
+}
 
-						if ((model.box_collision_mask & collision_nask) == 0) {
-							continue;
+enum VoxelBoxCollision { //
+	VOXEL_BOX_COLLISION_NONE,
+	// The voxel collides as a unit cube, so it can be merged with neighbors
+	VOXEL_BOX_COLLISION_CUBE,
+	// The voxel collides with the boxes of its model
+	VOXEL_BOX_COLLISION_MODEL
+};
+
+VoxelBoxCollision get_voxel_box_collision(const BoxCollisionSource &source, uint64_t value) {
+	if (source.baked_data == nullptr) {
+		return value != 0 ? VOXEL_BOX_COLLISION_CUBE : VOXEL_BOX_COLLISION_NONE;
+	}
+
+	if (!source.baked_data->has_model(value)) {
+		return VOXEL_BOX_COLLISION_NONE;
+	}
+	const VoxelBlockyModel::BakedData &model = source.baked_data->models[value];
+
+	if ((model.box_collision_mask & source.collision_mask) == 0 || model.box_collision_aabbs.size() == 0) {
+		return VOXEL_BOX_COLLISION_NONE;
+	}
+	if (model.box_collision_aabbs.size() == 1 &&
+		model.box_collision_aabbs[0].is_equal_approx(AABB(Vector3(), Vector3(1, 1, 1)))) {
+		return VOXEL_BOX_COLLISION_CUBE;
+	}
+	return VOXEL_BOX_COLLISION_MODEL;
+}
+
+// Turns unit cubes into fewer, larger boxes. Each box grows along X, then Y, then Z as long as all the cubes it would
+// cover are present. Cubes are cleared as they get merged.
+void merge_unit_cubes(Span<uint8_t> cubes, Vector3i size, Vector3 origin, StdVector<AABB> &out_boxes) {
+	const auto get_index = [size](int x, int y, int z) { //
+		return x + size.x * (y + size.y * z);
+	};
+
+	for (int z = 0; z < size.z; ++z) {
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				if (cubes[get_index(x, y, z)] == 0) {
+					continue;
+				}
+
+				int end_x = x + 1;
+				while (end_x < size.x && cubes[get_index(end_x, y, z)] != 0) {
+					++end_x;
+				}
+
+				int end_y = y + 1;
+				for (; end_y < size.y; ++end_y) {
+					bool full_row = true;
+					for (int rx = x; rx < end_x && full_row; ++rx) {
+						full_row = cubes[get_index(rx, end_y, z)] != 0;
+					}
+					if (!full_row) {
+						break;
+					}
+				}
+
+				int end_z = z + 1;
+				for (; end_z < size.z; ++end_z) {
+					bool full_slab = true;
+					for (int ry = y; ry < end_y && full_slab; ++ry) {
+						for (int rx = x; rx < end_x && full_slab; ++rx) {
+							full_slab = cubes[get_index(rx, ry, end_z)] != 0;
 						}
+					}
+					if (!full_slab) {
+						break;
+					}
+				}
 
-						for (const AABB &aabb : model.box_collision_aabbs) {
-							AABB world_box = aabb;
-							world_box.position += i;
-							potential_boxes.push_back(world_box);
+				for (int rz = z; rz < end_z; ++rz) {
+					for (int ry = y; ry < end_y; ++ry) {
+						for (int rx = x; rx < end_x; ++rx) {
+							cubes[get_index(rx, ry, rz)] = 0;
 						}
 					}
 				}
+
+				out_boxes.push_back(AABB(origin + Vector3(x, y, z), Vector3(end_x - x, end_y - y, end_z - z)));
 			}
 		}
+	}
+}
 
-	} else if (zylann::godot::try_get_as(p_terrain.get_mesher(), mesher_cubes)) {
-		const int channel = VoxelBuffer::CHANNEL_COLOR;
-		VoxelSingleValue defval;
-		defval.i = 0;
-
-		// TODO Optimization: read the whole box of voxels at once, querying individually is slower
-		for (i.z = min_z; i.z < max_z; ++i.z) {
-			for (i.y = min_y; i.y < max_y; ++i.y) {
-				for (i.x = min_x; i.x < max_x; ++i.x) {
-					const int color_data = voxels.get_voxel(i, channel, defval).i;
-					if (color_data != 0) {
-						potential_boxes.push_back(AABB(i, Vector3(1, 1, 1)));
-					}
+// Gets boxes of all solid voxels of a buffer, whose first voxel is at `origin` in the terrain.
+void collect_boxes_from_buffer(
+		const BoxCollisionSource &source,
+		const VoxelBuffer &buffer,
+		Vector3i origin,
+		StdVector<AABB> &out_boxes
+) {
+	const Vector3i size = buffer.get_size();
+
+	if (buffer.is_uniform(source.channel)) {
+		// Common in open air or underground
+		const uint64_t value = buffer.get_voxel(0, 0, 0, source.channel);
+		const VoxelBoxCollision collision = get_voxel_box_collision(source, value);
+		if (collision == VOXEL_BOX_COLLISION_NONE) {
+			return;
+		}
+		if (collision == VOXEL_BOX_COLLISION_CUBE) {
+			out_boxes.push_back(AABB(origin, size));
+			return;
+		}
+	}
+
+	static thread_local StdVector<uint8_t> tls_cubes;
+	tls_cubes.clear();
+	tls_cubes.resize(Vector3iUtil::get_volume(size), 0);
+	bool has_cubes = false;
+
+	unsigned int cube_index = 0;
+	for (int z = 0; z < size.z; ++z) {
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				const uint64_t value = buffer.get_voxel(x, y, z, source.channel);
+
+				switch (get_voxel_box_collision(source, value)) {
+					case VOXEL_BOX_COLLISION_NONE:
+						break;
+
+					case VOXEL_BOX_COLLISION_CUBE:
+						tls_cubes[cube_index] = 1;
+						has_cubes = true;
+						break;
+
+					case VOXEL_BOX_COLLISION_MODEL: {
+						const VoxelBlockyModel::BakedData &model = source.baked_data->models[value];
+						const Vector3 pos(origin + Vector3i(x, y, z));
+						for (const AABB &aabb : model.box_collision_aabbs) {
+							out_boxes.push_back(AABB(aabb.position + pos, aabb.size));
+						}
+					} break;
 				}
+
+				++cube_index;
 			}
 		}
 	}
+
+	if (has_cubes) {
+		merge_unit_cubes(to_span(tls_cubes), size, origin, out_boxes);
+	}
 }
 
-} // namespace
+// Voxels intersecting a box, in which collision boxes are searched
+Box3i get_voxel_query_box(const AABB &query_box) {
+	const Vector3 query_box_end = query_box.position + query_box.size;
+	const Vector3i min_pos(
+			Math::floor(query_box.position.x), Math::floor(query_box.position.y), Math::floor(query_box.position.z)
+	);
+	const Vector3i max_pos(Math::ceil(query_box_end.x), Math::ceil(query_box_end.y), Math::ceil(query_box_end.z));
+	return Box3i::from_min_max(min_pos, max_pos);
+}
 
-Vector3 VoxelBoxMover::get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb, VoxelTerrain &p_terrain) {
+void collect_boxes(const BoxCollisionSource &source, AABB query_box, StdVector<AABB> &potential_boxes) {
 	ZN_PROFILE_SCOPE();
-	// The mesher is required to know how collisions should be processed
-	ERR_FAIL_COND_V(p_terrain.get_mesher().is_null(), Vector3());
 
-	// Transform to local in case the volume is transformed
-	const Transform3D to_world = p_terrain.get_global_transform();
-	const Transform3D to_local = to_world.affine_inverse();
-	const Vector3 pos = to_local.xform(p_pos);
-	const Vector3 motion = to_local.basis.xform(p_motion);
-	const AABB aabb = Transform3D(to_local.basis, Vector3()).xform(p_aabb);
+	const Box3i voxel_box = get_voxel_query_box(query_box);
+	if (Vector3iUtil::get_volume(voxel_box.size) == 0) {
+		return;
+	}
 
-	const AABB box(aabb.position + pos, aabb.size);
+	// Reading the whole box at once is much faster than querying voxels individually
+	VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_POOL);
+	voxels.create(voxel_box.size);
+	source.voxels->copy(voxel_box.position, voxels, 1 << source.channel);
+
+	collect_boxes_from_buffer(source, voxels, voxel_box.position, potential_boxes);
+}
+
+// Boxes of the terrain, collected per block. Used when moving many boxes at once, so those in the same area don't read
+// and merge the same voxels again.
+class BlockBoxCache {
+public:
+	BlockBoxCache(const BoxCollisionSource &source) : _source(source), _voxels(VoxelBuffer::ALLOCATOR_POOL) {}
+
+	void collect_boxes(AABB query_box, StdVector<AABB> &potential_boxes) {
+		ZN_PROFILE_SCOPE();
+
+		const Box3i voxel_box = get_voxel_query_box(query_box);
+		if (Vector3iUtil::get_volume(voxel_box.size) == 0) {
+			return;
+		}
+		const AABB voxel_aabb(voxel_box.position, voxel_box.size);
+		const int block_size = _source.voxels->get_block_size();
+
+		const Box3i blocks_box = voxel_box.downscaled(block_size);
+		blocks_box.for_each_cell([this, block_size, &voxel_aabb, &potential_boxes](Vector3i bpos) {
+			const StdVector<AABB> &block_boxes = get_block_boxes(bpos, block_size);
+			for (const AABB &box : block_boxes) {
+				// Clip boxes to the query, so results are the same as when collecting from the query box only
+				if (box.intersects(voxel_aabb)) {
+					potential_boxes.push_back(box.intersection(voxel_aabb));
+				}
+			}
+		});
+	}
+
+private:
+	const StdVector<AABB> &get_block_boxes(Vector3i bpos, int block_size) {
+		auto it = _blocks.find(bpos);
+		if (it != _blocks.end()) {
+			return it->second;
+		}
+
+		const Vector3i origin = bpos * block_size;
+		_voxels.create(Vector3iUtil::create(block_size));
+		_source.voxels->copy(origin, _voxels, 1 << _source.channel);
+
+		StdVector<AABB> &block_boxes = _blocks[bpos];
+		collect_boxes_from_buffer(_source, _voxels, origin, block_boxes);
+		return block_boxes;
+	}
+
+	const BoxCollisionSource &_source;
+	StdUnorderedMap<Vector3i, StdVector<AABB>> _blocks;
+	// Reused to read blocks
+	VoxelBuffer _voxels;
+};
+
+// Moves a box in the local space of the terrain. `collect_boxes_func(query_box, out_boxes)` gets collision boxes.
+template <typename FCollectBoxes>
+Vector3 get_motion_with_step_climbing(
+		const AABB &box,
+		const Vector3 motion,
+		bool step_climbing_enabled,
+		real_t max_step_height,
+		FCollectBoxes collect_boxes_func,
+		bool &out_has_stepped_up
+) {
 	const AABB expanded_box = expand_with_vector(box, motion);
 
 	static thread_local StdVector<AABB> s_colliding_boxes;
@@ -278,15 +461,15 @@ Vector3 VoxelBoxMover::get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb,
 
 	// Collect potential collisions with the terrain (broad phase)
 	// TODO If motion is really big, we may want something more optimal or reject it
-	collect_boxes(p_terrain, expanded_box, _collision_mask, potential_boxes);
+	collect_boxes_func(expanded_box, potential_boxes);
 
 	// Calculate collisions (narrow phase)
 	Vector3 slided_motion = zylann::voxel::get_motion(box, motion, to_span(potential_boxes));
 
 	// Minecraft-style stair climbing:
 	// If we were moving, changed horizontal direction due to collision, and resulting motion is about horizontal
-	_has_stepped_up = false;
-	if (_step_climbing_enabled &&
+	out_has_stepped_up = false;
+	if (step_climbing_enabled &&
 			// Movement is horizontal?
 			Math::abs(slided_motion.y) < 0.001 && Vector2(motion.x, motion.z).length_squared() > 0.0001 &&
 			// Motor movement isn't the same as resulting slided motion?
@@ -297,7 +480,7 @@ Vector3 VoxelBoxMover::get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb,
 		// Find out the height of the step
 		if (boxcast_down(to_span(potential_boxes), get_xz(expanded_box.position), get_xz(expanded_box.size), hit_y)) {
 			// If the step is up and not too high
-			if (hit_y > box.position.y && (hit_y - box.position.y) <= _max_step_height) {
+			if (hit_y > box.position.y && (hit_y - box.position.y) <= max_step_height) {
 				// Check if we would fit if we move the box above the step.
 				// Raise it slightly higher to avoid precision issues. Even if the final motion would move the box
 				// exactly on top of the stair, gameplay code could do some additional calculations with that motion
@@ -307,24 +490,114 @@ Vector3 VoxelBoxMover::get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb,
 						Vector3(box.position.x + motion.x, hit_y + epsilon, box.position.z + motion.z), box.size);
 
 				potential_boxes.clear();
-				collect_boxes(p_terrain, hyp_box, _collision_mask, potential_boxes);
+				collect_boxes_func(hyp_box, potential_boxes);
 
 				// If the box fits on top of the step
 				if (!intersects(to_span(potential_boxes), hyp_box)) {
 					// Change motion so that it brings the box on top of the step
 					slided_motion = hyp_box.position - box.position;
-					_has_stepped_up = true;
+					out_has_stepped_up = true;
 				}
 			}
 		}
 	}
 
+	return slided_motion;
+}
+
+} // namespace
+
+Vector3 VoxelBoxMover::get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb, VoxelTerrain &p_terrain) {
+	ZN_PROFILE_SCOPE();
+	// The mesher is required to know how collisions should be processed
+	ERR_FAIL_COND_V(p_terrain.get_mesher().is_null(), Vector3());
+
+	BoxCollisionSource source;
+	if (!get_box_collision_source(p_terrain, _collision_mask, source)) {
+		_has_stepped_up = false;
+		return p_motion;
+	}
+
+	// Transform to local in case the volume is transformed
+	const Transform3D to_world = p_terrain.get_global_transform();
+	const Transform3D to_local = to_world.affine_inverse();
+	const Vector3 pos = to_local.xform(p_pos);
+	const Vector3 motion = to_local.basis.xform(p_motion);
+	const AABB aabb = Transform3D(to_local.basis, Vector3()).xform(p_aabb);
+
+	const AABB box(aabb.position + pos, aabb.size);
+
+	const Vector3 slided_motion = get_motion_with_step_climbing(
+			box,
+			motion,
+			_step_climbing_enabled,
+			_max_step_height,
+			[&source](const AABB &query_box, StdVector<AABB> &out_boxes) { //
+				collect_boxes(source, query_box, out_boxes);
+			},
+			_has_stepped_up
+	);
+
 	// Switch back to world
 	const Vector3 world_slided_motion = to_world.basis.xform(slided_motion);
 
 	return world_slided_motion;
 }
 
+void VoxelBoxMover::get_motions(
+		Span<const Vector3> positions,
+		Span<const Vector3> motions,
+		AABB p_aabb,
+		VoxelTerrain &p_terrain,
+		Span<Vector3> out_motions
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(positions.size() == motions.size());
+	ZN_ASSERT_RETURN(out_motions.size() == motions.size());
+	// The mesher is required to know how collisions should be processed
+	ERR_FAIL_COND(p_terrain.get_mesher().is_null());
+
+	BoxCollisionSource source;
+	if (!get_box_collision_source(p_terrain, _collision_mask, source)) {
+		_has_stepped_up = false;
+		for (unsigned int i = 0; i < motions.size(); ++i) {
+			out_motions[i] = motions[i];
+		}
+		return;
+	}
+
+	// Transform to local in case the volume is transformed
+	const Transform3D to_world = p_terrain.get_global_transform();
+	const Transform3D to_local = to_world.affine_inverse();
+	const AABB aabb = Transform3D(to_local.basis, Vector3()).xform(p_aabb);
+
+	BlockBoxCache cache(source);
+	bool any_stepped_up = false;
+
+	for (unsigned int i = 0; i < positions.size(); ++i) {
+		const Vector3 pos = to_local.xform(positions[i]);
+		const Vector3 motion = to_local.basis.xform(motions[i]);
+		const AABB box(aabb.position + pos, aabb.size);
+
+		bool stepped_up;
+		const Vector3 slided_motion = get_motion_with_step_climbing(
+				box,
+				motion,
+				_step_climbing_enabled,
+				_max_step_height,
+				[&cache](const AABB &query_box, StdVector<AABB> &out_boxes) { //
+					cache.collect_boxes(query_box, out_boxes);
+				},
+				stepped_up
+		);
+
+		any_stepped_up |= stepped_up;
+		out_motions[i] = to_world.basis.xform(slided_motion);
+	}
+
+	_has_stepped_up = any_stepped_up;
+}
+
 void VoxelBoxMover::set_collision_mask(uint32_t mask) {
 	_collision_mask = mask;
 }
@@ -361,8 +634,39 @@ Vector3 VoxelBoxMover::_b_get_motion(Vector3 pos, Vector3 motion, AABB aabb, Obj
 	return get_motion(pos, motion, aabb, *terrain);
 }
 
+#if defined(ZN_GODOT)
+PackedVector3Array VoxelBoxMover::_b_get_motions(
+		PackedVector3Array positions,
+		PackedVector3Array motions,
+		AABB aabb,
+		Node *terrain_node
+) {
+#elif defined(ZN_GODOT_EXTENSION)
+PackedVector3Array VoxelBoxMover::_b_get_motions(
+		PackedVector3Array positions,
+		PackedVector3Array motions,
+		AABB aabb,
+		Object *terrain_node_o
+) {
+	Node *terrain_node = Object::cast_to<Node>(terrain_node_o);
+#endif
+	ERR_FAIL_COND_V(terrain_node == nullptr, PackedVector3Array());
+	VoxelTerrain *terrain = Object::cast_to<VoxelTerrain>(terrain_node);
+	ERR_FAIL_COND_V(terrain == nullptr, PackedVector3Array());
+	ERR_FAIL_COND_V(positions.size() != motions.size(), PackedVector3Array());
+	PackedVector3Array out_motions;
+	out_motions.resize(motions.size());
+	get_motions(
+			to_span(positions), to_span(motions), aabb, *terrain, Span<Vector3>(out_motions.ptrw(), out_motions.size())
+	);
+	return out_motions;
+}
+
 void VoxelBoxMover::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_motion", "pos", "motion", "aabb", "terrain"), &VoxelBoxMover::_b_get_motion);
+	ClassDB::bind_method(
+			D_METHOD("get_motions", "positions", "motions", "aabb", "terrain"), &VoxelBoxMover::_b_get_motions
+	);
 
 	ClassDB::bind_method(D_METHOD("set_collision_mask", "mask"), &VoxelBoxMover::set_collision_mask);
 	ClassDB::bind_method(D_METHOD("get_collision_mask"), &VoxelBoxMover::get_collision_mask);
@@ -1,6 +1,7 @@
 #ifndef VOXEL_BOX_MOVER_H
 #define VOXEL_BOX_MOVER_H
 
+#include "../../util/containers/span.h"
 #include "../../util/godot/classes/ref_counted.h"
 #include "../../util/godot/macros.h"
 
@@ -16,6 +17,17 @@ class VoxelBoxMover : public RefCounted {
 public:
 	Vector3 get_motion(Vector3 pos, Vector3 motion, AABB aabb, VoxelTerrain &terrain);
 
+	// Same as `get_motion`, for many boxes of the same size at once. Voxels around them are read and turned into
+	// collision boxes only once per call, which is much faster when boxes are close to each other.
+	// Boxes don't collide with each other.
+	void get_motions(
+			Span<const Vector3> positions,
+			Span<const Vector3> motions,
+			AABB aabb,
+			VoxelTerrain &terrain,
+			Span<Vector3> out_motions
+	);
+
 	void set_collision_mask(uint32_t mask);
 	inline uint32_t get_collision_mask() const {
 		return _collision_mask;
@@ -32,9 +44,21 @@ public:
 private:
 #if defined(ZN_GODOT)
 	Vector3 _b_get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb, Node *p_terrain_node);
+	PackedVector3Array _b_get_motions(
+			PackedVector3Array p_positions,
+			PackedVector3Array p_motions,
+			AABB p_aabb,
+			Node *p_terrain_node
+	);
 #elif defined(ZN_GODOT_EXTENSION)
 	// TODO GDX: it seems binding a method taking a `Node*` fails to compile. It is supposed to be working.
 	Vector3 _b_get_motion(Vector3 p_pos, Vector3 p_motion, AABB p_aabb, Object *p_terrain_node_o);
+	PackedVector3Array _b_get_motions(
+			PackedVector3Array p_positions,
+			PackedVector3Array p_motions,
+			AABB p_aabb,
+			Object *p_terrain_node_o
+	);
 #endif
 
 	static void _bind_methods();
@@ -25,6 +25,8 @@ public:
 	// True if this block is in the update list of `VoxelTerrain`, so multiple edits done before it processes will not
 	// add it multiple times
 	bool is_in_update_list = false;
+	// True if the pending update was requested by an edit, so it gets processed before streaming work
+	bool update_caused_by_edit = false;
 
 	// Will be true if the block has ever been processed by meshing (regardless of there being a mesh or not).
 	// This is needed to know if the area is loaded, in terms of collisions. If the game uses voxels directly for
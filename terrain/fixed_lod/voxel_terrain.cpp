@@ -11,6 +11,7 @@
 #include "../../storage/voxel_buffer_gd.h"
 #include "../../storage/voxel_data.h"
 #include "../../streams/load_block_data_task.h"
+#include "../../streams/mesh_block_serializer.h"
 #include "../../streams/save_block_data_task.h"
 #include "../../util/containers/container_funcs.h"
 #include "../../util/godot/classes/base_material_3d.h" // For property hint in release mode in GDExtension...
@@ -21,6 +22,7 @@
 #include "../../util/godot/classes/scene_tree.h"
 #include "../../util/godot/classes/script.h"
 #include "../../util/godot/classes/shader_material.h"
+#include "../../util/godot/classes/time.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/macros.h"
@@ -87,6 +89,10 @@ VoxelTerrain::VoxelTerrain() {
 		VoxelTerrain *self = reinterpret_cast<VoxelTerrain *>(cb_data);
 		self->apply_data_block_response(ob);
 	};
+	callbacks.memory_usage_callback = [](void *cb_data, VolumeMemoryUsage &usage) {
+		const VoxelTerrain *self = reinterpret_cast<const VoxelTerrain *>(cb_data);
+		self->get_memory_usage(usage);
+	};
 
 	_volume_id = VoxelEngine::get_singleton().add_volume(callbacks);
 
@@ -126,6 +132,69 @@ bool VoxelTerrain::get_generator_use_gpu() const {
 	return _generator_use_gpu;
 }
 
+void VoxelTerrain::set_data_memory_budget_mb(int mb) {
+	_data_memory_budget_mb = math::max(mb, 0);
+}
+
+int VoxelTerrain::get_data_memory_budget_mb() const {
+	return _data_memory_budget_mb;
+}
+
+void VoxelTerrain::set_cold_block_compression_delay(float seconds) {
+	_cold_block_compression_delay_sec = math::max(seconds, 0.f);
+	if (_cold_block_compression_delay_sec == 0.f) {
+		_access_time_samples.clear();
+	}
+}
+
+float VoxelTerrain::get_cold_block_compression_delay() const {
+	return _cold_block_compression_delay_sec;
+}
+
+void VoxelTerrain::set_blocky_simulation_enabled(bool enabled) {
+	_blocky_simulation_enabled = enabled;
+	if (!enabled) {
+		_blocky_simulation_pending_boxes.clear();
+	}
+}
+
+bool VoxelTerrain::is_blocky_simulation_enabled() const {
+	return _blocky_simulation_enabled;
+}
+
+void VoxelTerrain::set_blocky_simulation_interval(float seconds) {
+	_blocky_simulation_interval_sec = math::max(seconds, 0.f);
+}
+
+float VoxelTerrain::get_blocky_simulation_interval() const {
+	return _blocky_simulation_interval_sec;
+}
+
+void VoxelTerrain::set_mesh_reload_cache_budget_mb(int mb) {
+	_mesh_reload_cache.set_max_size_in_bytes(static_cast<uint64_t>(math::max(mb, 0)) << 20);
+}
+
+int VoxelTerrain::get_mesh_reload_cache_budget_mb() const {
+	return _mesh_reload_cache.get_max_size_in_bytes() >> 20;
+}
+
+void VoxelTerrain::set_mesh_baking_enabled(bool enabled) {
+	_mesh_baking_enabled = enabled;
+	update_baked_mesh_settings_hash();
+}
+
+bool VoxelTerrain::is_mesh_baking_enabled() const {
+	return _mesh_baking_enabled;
+}
+
+void VoxelTerrain::update_baked_mesh_settings_hash() {
+	// Computed on the main thread because it reads properties of the mesher and generator
+	if (_mesh_baking_enabled && _mesher.is_valid()) {
+		_baked_mesh_settings_hash =
+				get_mesh_block_settings_hash(**_mesher, get_generator().ptr(), get_mesh_block_size());
+	}
+}
+
 void VoxelTerrain::set_stream(Ref<VoxelStream> p_stream) {
 	if (p_stream == get_stream()) {
 		return;
@@ -227,6 +296,7 @@ void VoxelTerrain::set_mesh_block_size(unsigned int mesh_block_size) {
 	}
 
 	_mesh_block_size_po2 = po2;
+	update_baked_mesh_settings_hash();
 
 	// Unload all mesh blocks regardless of refcount
 	clear_mesh_map();
@@ -262,6 +332,8 @@ void VoxelTerrain::_on_stream_params_changed() {
 	// The whole map might change, so regenerate it
 	reset_map();
 
+	update_baked_mesh_settings_hash();
+
 	if ((get_stream().is_valid() || get_generator().is_valid()) &&
 		(Engine::get_singleton()->is_editor_hint() == false || _run_stream_in_editor)) {
 		start_streamer();
@@ -304,6 +376,7 @@ void VoxelTerrain::set_mesher(Ref<VoxelMesher> mesher) {
 	_mesher = mesher;
 
 	MeshingDependency::reset(_meshing_dependency, _mesher, get_generator());
+	update_baked_mesh_settings_hash();
 
 	stop_updater();
 
@@ -393,6 +466,23 @@ bool VoxelTerrain::is_block_enter_notification_enabled() const {
 	return _block_enter_notification_enabled;
 }
 
+void VoxelTerrain::set_block_enter_notification_batching_enabled(bool enable) {
+	_block_enter_notification_batching_enabled = enable;
+	// Notifications already queued are still delivered in batches
+}
+
+bool VoxelTerrain::is_block_enter_notification_batching_enabled() const {
+	return _block_enter_notification_batching_enabled;
+}
+
+void VoxelTerrain::set_block_enter_notification_time_budget_usec(int usec) {
+	_block_enter_notification_time_budget_usec = math::max(usec, 0);
+}
+
+int VoxelTerrain::get_block_enter_notification_time_budget_usec() const {
+	return _block_enter_notification_time_budget_usec;
+}
+
 void VoxelTerrain::set_area_edit_notification_enabled(bool enable) {
 	_area_edit_notification_enabled = enable;
 }
@@ -409,10 +499,11 @@ bool VoxelTerrain::is_automatic_loading_enabled() const {
 	return _automatic_loading_enabled;
 }
 
-void VoxelTerrain::try_schedule_mesh_update(VoxelMeshBlockVT &mesh_block) {
+void VoxelTerrain::try_schedule_mesh_update(VoxelMeshBlockVT &mesh_block, bool caused_by_edit) {
 	ZN_PROFILE_SCOPE();
 	if (mesh_block.is_in_update_list) {
 		// Already in the list
+		mesh_block.update_caused_by_edit |= caused_by_edit;
 		return;
 	}
 	if (mesh_block.mesh_viewers.get() == 0 && mesh_block.collision_viewers.get() == 0) {
@@ -434,6 +525,7 @@ void VoxelTerrain::try_schedule_mesh_update(VoxelMeshBlockVT &mesh_block) {
 		// Regardless of if the updater is updating the block already,
 		// the block could have been modified again so we schedule another update
 		mesh_block.is_in_update_list = true;
+		mesh_block.update_caused_by_edit = caused_by_edit;
 		_blocks_pending_update.push_back(mesh_block.position);
 	}
 }
@@ -445,12 +537,14 @@ void VoxelTerrain::view_mesh_block(Vector3i bpos, bool mesh_flag, bool collision
 	}
 
 	VoxelMeshBlockVT *block = _mesh_map.get_block(bpos);
+	bool created = false;
 
 	if (block == nullptr) {
 		// Create if not found
 		block = ZN_NEW(VoxelMeshBlockVT(bpos, get_mesh_block_size()));
 		block->set_world(get_world_3d());
 		_mesh_map.set_block(bpos, block);
+		created = true;
 	}
 	CRASH_COND(block == nullptr);
 
@@ -461,6 +555,10 @@ void VoxelTerrain::view_mesh_block(Vector3i bpos, bool mesh_flag, bool collision
 		block->collision_viewers.add();
 	}
 
+	if (created && try_restore_mesh_block_from_cache(*block)) {
+		return;
+	}
+
 	// This is needed in case a viewer wants to view meshes in places data blocks are already present.
 	// Before that, meshes were updated only when a data block was loaded or modified,
 	// so changing block size or viewer flags did not make meshes appear.
@@ -481,22 +579,29 @@ void VoxelTerrain::unview_mesh_block(Vector3i bpos, bool mesh_flag, bool collisi
 
 	if (mesh_flag) {
 		block->mesh_viewers.remove();
-		if (block->mesh_viewers.get() == 0) {
-			// Mesh no longer required
-			block->drop_mesh();
-		}
 	}
-
 	if (collision_flag) {
 		block->collision_viewers.remove();
-		if (block->collision_viewers.get() == 0) {
-			// Collision no longer required
-			block->drop_collision();
-		}
 	}
 
 	if (block->mesh_viewers.get() == 0 && block->collision_viewers.get() == 0) {
+		if (mesh_flag) {
+			// The mesh was in use until now, so it can be kept in case viewers come back. The collision shape is only
+			// known if it was in use as well.
+			cache_mesh_block(*block, collision_flag && _generate_collisions);
+		}
 		unload_mesh_block(bpos);
+		return;
+	}
+
+	if (mesh_flag && block->mesh_viewers.get() == 0) {
+		// Mesh no longer required
+		block->drop_mesh();
+	}
+
+	if (collision_flag && block->collision_viewers.get() == 0) {
+		// Collision no longer required
+		block->drop_collision();
 	}
 }
 
@@ -523,6 +628,87 @@ void VoxelTerrain::unload_mesh_block(Vector3i bpos) {
 	}
 }
 
+void VoxelTerrain::cache_mesh_block(VoxelMeshBlockVT &block, bool has_collision) {
+	if (!block.is_loaded || block.is_in_update_list) {
+		// The block has no mesh yet, or its mesh is outdated
+		return;
+	}
+	if (_instancer != nullptr) {
+		// The instancer needs surface arrays when a block enters, which are not kept after meshes are built
+		return;
+	}
+
+	MeshQuickReloadingCache::Entry entry;
+	entry.mesh = block.get_mesh();
+	if (block.shadow_occluder.is_valid()) {
+		entry.shadow_occluder_mesh = block.shadow_occluder.get_mesh();
+	}
+	entry.mesh_size_in_bytes = block.mesh_size_in_bytes;
+	if (has_collision) {
+		entry.collision_shape = block.get_collision_shape();
+		entry.collision_size_in_bytes = block.collision_size_in_bytes;
+		entry.has_collision = true;
+	}
+
+	_mesh_reload_cache.put(block.position, std::move(entry));
+}
+
+// Returns true if the block does not need meshing after being restored
+bool VoxelTerrain::try_restore_mesh_block_from_cache(VoxelMeshBlockVT &block) {
+	MeshQuickReloadingCache::Entry entry;
+	if (!_mesh_reload_cache.take(block.position, entry)) {
+		return false;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+#ifdef TOOLS_ENABLED
+	const RenderingServer::ShadowCastingSetting shadow_occluder_mode = _debug_draw_shadow_occluders
+			? RenderingServer::SHADOW_CASTING_SETTING_ON
+			: RenderingServer::SHADOW_CASTING_SETTING_SHADOWS_ONLY;
+#endif
+
+	block.set_mesh(
+			entry.mesh,
+			get_gi_mode(),
+			static_cast<RenderingServer::ShadowCastingSetting>(get_shadow_casting()),
+			get_render_layers_mask(),
+			entry.shadow_occluder_mesh
+#ifdef TOOLS_ENABLED
+			,
+			shadow_occluder_mode
+#endif
+	);
+	block.mesh_size_in_bytes = entry.mesh_size_in_bytes;
+
+	if (_material_override.is_valid()) {
+		block.set_material_override(_material_override);
+	}
+
+	const bool gen_collisions = _generate_collisions && block.collision_viewers.get() > 0;
+	if (gen_collisions && entry.has_collision) {
+		const bool debug_collisions = is_inside_tree() ? get_tree()->is_debugging_collisions_hint() : false;
+		block.set_collision_shape(entry.collision_shape, debug_collisions, this, _collision_margin);
+		block.collision_size_in_bytes = entry.collision_size_in_bytes;
+
+		block.set_collision_layer(_collision_layer);
+		block.set_collision_mask(_collision_mask);
+	}
+
+	block.set_visible(true);
+	block.set_collision_enabled(true);
+	block.set_parent_visible(is_visible());
+	block.set_parent_transform(get_global_transform());
+
+	block.is_loaded = true;
+	emit_mesh_block_entered(block.position);
+
+	++_stats.reloaded_block_meshes;
+
+	// If the collision shape was not cached, the block still has to be meshed to get it
+	return !gen_collisions || entry.has_collision;
+}
+
 void VoxelTerrain::save_all_modified_blocks(bool with_copy, std::shared_ptr<AsyncDependencyTracker> tracker) {
 	ZN_PROFILE_SCOPE();
 	Ref<VoxelStream> stream = get_stream();
@@ -563,6 +749,8 @@ void VoxelTerrain::set_instancer(VoxelInstancer *instancer) {
 		ERR_FAIL_COND_MSG(_instancer != nullptr, "No more than one VoxelInstancer per terrain");
 	}
 	_instancer = instancer;
+	// Cached meshes are not used with an instancer
+	_mesh_reload_cache.clear();
 }
 
 void VoxelTerrain::get_meshed_block_positions(StdVector<Vector3i> &out_positions) const {
@@ -605,8 +793,17 @@ Dictionary VoxelTerrain::_b_get_statistics() const {
 
 	d["dropped_block_loads"] = _stats.dropped_block_loads;
 	d["dropped_block_meshs"] = _stats.dropped_block_meshs;
+	d["reloaded_block_meshes"] = _stats.reloaded_block_meshes;
+	d["mesh_reload_cache_bytes"] = static_cast<int64_t>(_mesh_reload_cache.get_size_in_bytes());
 	d["updated_blocks"] = _stats.updated_blocks;
 
+	// Only updated when a data memory budget is set
+	d["resident_voxel_bytes"] = static_cast<int64_t>(_stats.resident_voxel_bytes);
+	d["evicted_voxel_bytes"] = static_cast<int64_t>(_stats.evicted_voxel_bytes);
+	d["compressed_voxel_bytes_saved"] = static_cast<int64_t>(
+			_cold_block_compression_state != nullptr ? _cold_block_compression_state->saved_bytes.load() : 0
+	);
+
 	return d;
 }
 
@@ -637,6 +834,7 @@ void VoxelTerrain::stop_updater() {
 		VoxelMeshBlockVT *block = _mesh_map.get_block(bpos);
 		if (block != nullptr) {
 			block->is_in_update_list = false;
+			block->update_caused_by_edit = false;
 		}
 	}
 
@@ -644,6 +842,7 @@ void VoxelTerrain::stop_updater() {
 }
 
 void VoxelTerrain::remesh_all_blocks() {
+	_mesh_reload_cache.clear();
 	_mesh_map.for_each_block([this](VoxelMeshBlockVT &block) { //
 		try_schedule_mesh_update(block);
 	});
@@ -697,6 +896,7 @@ void VoxelTerrain::stop_streamer() {
 	_blocks_pending_load.clear();
 	_quick_reloading_blocks.clear();
 	_unloaded_saving_blocks.clear();
+	_pending_data_block_enter_notifications.clear();
 }
 
 void VoxelTerrain::clear_mesh_map() {
@@ -717,6 +917,7 @@ void VoxelTerrain::clear_mesh_map() {
 	}
 
 	_mesh_map.clear();
+	_mesh_reload_cache.clear();
 }
 
 void VoxelTerrain::reset_map() {
@@ -726,6 +927,9 @@ void VoxelTerrain::reset_map() {
 		emit_data_block_unloaded(bpos);
 	});
 	_data->reset_maps();
+	_random_tick_index.clear();
+	_blocky_light_pending_boxes.clear();
+	_blocky_simulation_pending_boxes.clear();
 
 	clear_mesh_map();
 
@@ -733,6 +937,7 @@ void VoxelTerrain::reset_map() {
 	_blocks_pending_load.clear();
 	_blocks_pending_update.clear();
 	_blocks_to_save.clear();
+	_pending_data_block_enter_notifications.clear();
 
 	// No need to care about refcounts, we drop everything anyways. Will pair it back on next process.
 	_paired_viewers.clear();
@@ -747,29 +952,37 @@ void VoxelTerrain::post_edit_voxel(Vector3i pos) {
 	post_edit_area(Box3i(pos, Vector3i(1, 1, 1)), true);
 }
 
-void VoxelTerrain::try_schedule_mesh_update_from_data(const Box3i &box_in_voxels) {
+void VoxelTerrain::try_schedule_mesh_update_from_data(const Box3i &box_in_voxels, bool caused_by_edit) {
 	ZN_PROFILE_SCOPE();
+	// We pad by 1 because neighbor blocks might be affected visually (for example, baked ambient occlusion)
+	const Box3i mesh_box = box_in_voxels.padded(1).downscaled(get_mesh_block_size());
+
+	// Cached meshes of unloaded blocks in this area are outdated
+	_mesh_reload_cache.remove_area(mesh_box);
+
 	if (_mesher.is_null()) {
 		// No mesher, can't do updates
 		return;
 	}
-	// We pad by 1 because neighbor blocks might be affected visually (for example, baked ambient occlusion)
-	const Box3i mesh_box = box_in_voxels.padded(1).downscaled(get_mesh_block_size());
-	mesh_box.for_each_cell([this](Vector3i pos) {
+	mesh_box.for_each_cell([this, caused_by_edit](Vector3i pos) {
 		VoxelMeshBlockVT *block = _mesh_map.get_block(pos);
 		// There isn't necessarily a mesh block, if the edit happens in a boundary,
 		// or if it is done next to a viewer that doesn't need meshes
 		if (block != nullptr) {
-			try_schedule_mesh_update(*block);
+			try_schedule_mesh_update(*block, caused_by_edit);
 		}
 	});
 }
 
 void VoxelTerrain::post_edit_area(Box3i box_in_voxels, bool update_mesh) {
 	_data->mark_area_modified(box_in_voxels, nullptr, false);
+	_random_tick_index.invalidate_area(box_in_voxels);
 
 	box_in_voxels.clip(_data->get_bounds());
 
+	schedule_blocky_light_update(box_in_voxels, true);
+	schedule_blocky_simulation_update(box_in_voxels);
+
 	// TODO Maybe remove this in preference for multiplayer synchronizer virtual functions?
 	if (_area_edit_notification_enabled) {
 		GDVIRTUAL_CALL(_on_area_edited, box_in_voxels.position, box_in_voxels.size);
@@ -783,7 +996,7 @@ void VoxelTerrain::post_edit_area(Box3i box_in_voxels, bool update_mesh) {
 	}
 
 	if (update_mesh) {
-		try_schedule_mesh_update_from_data(box_in_voxels);
+		try_schedule_mesh_update_from_data(box_in_voxels, true);
 
 		if (_instancer != nullptr) {
 			_instancer->on_area_edited(box_in_voxels);
@@ -935,7 +1148,7 @@ void request_block_load(
 		);
 
 		const bool request_instances = false;
-		LoadBlockDataTask *task = ZN_NEW(LoadBlockDataTask(
+		LoadBlockDataTask *task = ThreadedTaskPool<LoadBlockDataTask>::get_singleton().create(
 				volume_id,
 				block_pos,
 				0,
@@ -947,7 +1160,7 @@ void request_block_load(
 				use_gpu,
 				voxel_data,
 				TaskCancellationToken()
-		));
+		);
 
 		scheduler.push_io_task(task);
 
@@ -1052,7 +1265,8 @@ void VoxelTerrain::consume_block_data_save_requests(
 			));
 
 			// No priority data, saving doesn't need sorting.
-			task_scheduler.push_io_task(task);
+			// Voxels are only compressed and queued, files are written by another task.
+			task_scheduler.push_main_task(task);
 		}
 	} else {
 		if (_blocks_to_save.size() > 0) {
@@ -1116,6 +1330,10 @@ void VoxelTerrain::notify_data_block_enter(const VoxelDataBlock &block, Vector3i
 		// loading it
 		return;
 	}
+	if (_block_enter_notification_batching_enabled) {
+		_pending_data_block_enter_notifications.push_back(PendingDataBlockEnter{ block, bpos, viewer_id });
+		return;
+	}
 	if (_data_block_enter_info_obj == nullptr) {
 		_data_block_enter_info_obj = zylann::godot::make_unique<VoxelDataBlockEnterInfo>();
 	}
@@ -1124,6 +1342,8 @@ void VoxelTerrain::notify_data_block_enter(const VoxelDataBlock &block, Vector3i
 	_data_block_enter_info_obj->voxel_block = block;
 	_data_block_enter_info_obj->block_position = bpos;
 
+	restore_evicted_block_voxels(_data_block_enter_info_obj->voxel_block, bpos);
+
 	if (!GDVIRTUAL_CALL(_on_data_block_entered, _data_block_enter_info_obj.get()) &&
 		_multiplayer_synchronizer == nullptr) {
 		WARN_PRINT_ONCE("VoxelTerrain::_on_data_block_entered is unimplemented!");
@@ -1135,6 +1355,85 @@ void VoxelTerrain::notify_data_block_enter(const VoxelDataBlock &block, Vector3i
 	}
 }
 
+void VoxelTerrain::restore_evicted_block_voxels(VoxelDataBlock &block, Vector3i bpos) {
+	if (!block.has_voxels() && _data_memory_budget_mb != 0) {
+		// Voxels were evicted to save memory, generate them again
+		_data->pre_generate_box(Box3i(_data->block_to_voxel(bpos), Vector3iUtil::create(get_data_block_size())));
+		SpatialLock3D::Read srlock(_data->get_spatial_lock(0), BoxBounds3i::from_position(bpos));
+		std::shared_ptr<VoxelBuffer> voxels = _data->try_get_block_voxels(bpos);
+		if (voxels != nullptr) {
+			block.set_voxels(voxels);
+		}
+	}
+}
+
+void VoxelTerrain::process_data_block_enter_notifications() {
+	if (_pending_data_block_enter_notifications.size() == 0) {
+		return;
+	}
+	ZN_PROFILE_SCOPE();
+
+	ProfilingClock profiling_clock;
+
+	struct Batch {
+		int network_peer_id;
+		PackedVector3Array positions;
+	};
+	// There are usually few peers
+	StdVector<Batch> batches;
+
+	const bool send_to_peers = _multiplayer_synchronizer != nullptr && !Engine::get_singleton()->is_editor_hint() &&
+			_multiplayer_synchronizer->is_server();
+
+	unsigned int processed_count = 0;
+	for (; processed_count < _pending_data_block_enter_notifications.size(); ++processed_count) {
+		// At least one notification is delivered every frame, so they can't stall
+		if (processed_count > 0 &&
+			profiling_clock.get_elapsed_microseconds() >= _block_enter_notification_time_budget_usec) {
+			break;
+		}
+
+		PendingDataBlockEnter &pending = _pending_data_block_enter_notifications[processed_count];
+
+		if (!VoxelEngine::get_singleton().viewer_exists(pending.viewer_id)) {
+			// The viewer was removed while the notification was waiting
+			continue;
+		}
+		const int network_peer_id = VoxelEngine::get_singleton().get_viewer_network_peer_id(pending.viewer_id);
+
+		if (send_to_peers && network_peer_id != MultiplayerPeer::TARGET_PEER_SERVER) {
+			restore_evicted_block_voxels(pending.block, pending.position);
+			_multiplayer_synchronizer->send_block(network_peer_id, pending.block, pending.position);
+		}
+
+		Batch *batch = nullptr;
+		for (Batch &b : batches) {
+			if (b.network_peer_id == network_peer_id) {
+				batch = &b;
+				break;
+			}
+		}
+		if (batch == nullptr) {
+			batches.push_back(Batch{ network_peer_id, PackedVector3Array() });
+			batch = &batches.back();
+		}
+		batch->positions.push_back(pending.position);
+	}
+
+	// Blocks hold references to voxels, don't keep them longer than needed
+	_pending_data_block_enter_notifications.erase(
+			_pending_data_block_enter_notifications.begin(),
+			_pending_data_block_enter_notifications.begin() + processed_count
+	);
+
+	for (const Batch &batch : batches) {
+		if (!GDVIRTUAL_CALL(_on_data_blocks_entered, batch.network_peer_id, batch.positions) &&
+			_multiplayer_synchronizer == nullptr) {
+			WARN_PRINT_ONCE("VoxelTerrain::_on_data_blocks_entered is unimplemented!");
+		}
+	}
+}
+
 void VoxelTerrain::process() {
 	ZN_PROFILE_SCOPE();
 
@@ -1166,9 +1465,16 @@ void VoxelTerrain::process() {
 		_quick_reloading_blocks.clear();
 	}
 
+	++_data_access_time;
+
 	process_viewers();
+	process_data_block_enter_notifications();
 	// process_received_data_blocks();
 	process_meshing();
+	process_data_memory_budget();
+	process_cold_block_compression();
+	process_blocky_simulation();
+	process_blocky_light();
 
 #ifdef TOOLS_ENABLED
 	if (debug_is_draw_enabled() && is_visible_in_tree()) {
@@ -1478,6 +1784,12 @@ void VoxelTerrain::process_viewer_data_box_change(
 		// Remove loading blocks (those were loaded and had their refcount reach zero)
 		for (const Vector3i bpos : tls_found_blocks_positions) {
 			emit_data_block_unloaded(bpos);
+			// Meshes can't be shown without the voxels they came from
+			_mesh_reload_cache.remove_area(
+					Box3i(_data->block_to_voxel(bpos), Vector3iUtil::create(get_data_block_size()))
+							.padded(1)
+							.downscaled(get_mesh_block_size())
+			);
 			// TODO If they were loaded, why would they be in loading blocks?
 			// Probably in case we move so fast that blocks haven't even finished loading
 			_loading_blocks.erase(bpos);
@@ -1575,6 +1887,26 @@ void VoxelTerrain::process_viewer_data_box_change(
 	}
 }
 
+void VoxelTerrain::get_memory_usage(VolumeMemoryUsage &usage) const {
+	ZN_PROFILE_SCOPE();
+
+	usage.object_id = get_instance_id();
+	usage.add_voxel_data(*_data);
+
+	_mesh_map.for_each_block([&usage](const VoxelMeshBlockVT &block) { //
+		usage.add_mesh_block(block);
+	});
+
+	if (_instancer != nullptr) {
+		usage.bytes[VolumeMemoryUsage::CATEGORY_INSTANCES] += _instancer->get_memory_usage_bytes();
+	}
+
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		usage.bytes[VolumeMemoryUsage::CATEGORY_STREAM_CACHE] += stream->get_memory_usage_bytes();
+	}
+}
+
 void VoxelTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob) {
 	ZN_PROFILE_SCOPE();
 
@@ -1647,6 +1979,7 @@ void VoxelTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob) {
 
 	VoxelDataBlock block(ob.voxels, ob.lod_index);
 	block.set_edited(ob.type == VoxelEngine::BlockDataOutput::TYPE_LOADED);
+	block.set_last_access_time(_data_access_time);
 	// Viewers will be set only if the block doesn't already exist
 	block.viewers = loading_block.viewers;
 
@@ -1679,6 +2012,10 @@ void VoxelTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob) {
 
 	emit_data_block_loaded(block_pos);
 
+	const Box3i block_voxel_box(_data->block_to_voxel(block_pos), Vector3iUtil::create(get_data_block_size()));
+	schedule_blocky_light_update(block_voxel_box, false);
+	schedule_blocky_simulation_update(block_voxel_box);
+
 	for (unsigned int i = 0; i < loading_block.viewers_to_notify.size(); ++i) {
 		const ViewerID viewer_id = loading_block.viewers_to_notify[i];
 		notify_data_block_enter(block, block_pos, viewer_id);
@@ -1748,10 +2085,13 @@ bool VoxelTerrain::try_set_block_data(Vector3i position, std::shared_ptr<VoxelBu
 		existing_block.set_edited(incoming_block.is_edited());
 	});
 
+	const Box3i voxel_box(_data->block_to_voxel(position), Vector3iUtil::create(get_data_block_size()));
+
+	schedule_blocky_light_update(voxel_box, false);
+	schedule_blocky_simulation_update(voxel_box);
+
 	// The block itself might not be suitable for meshing yet, but blocks surrounding it might be now
-	try_schedule_mesh_update_from_data(
-			Box3i(_data->block_to_voxel(position), Vector3iUtil::create(get_data_block_size()))
-	);
+	try_schedule_mesh_update_from_data(voxel_box);
 
 	return true;
 }
@@ -1777,6 +2117,24 @@ void VoxelTerrain::process_meshing() {
 
 	BufferedTaskScheduler &scheduler = BufferedTaskScheduler::get_for_current_thread();
 
+	// Tasks are created first, so we can then fetch voxels of all blocks at once
+	static thread_local StdVector<MeshBlockTask *> tls_tasks;
+	static thread_local StdVector<Box3i> tls_data_boxes;
+	static thread_local StdVector<std::shared_ptr<VoxelBuffer>> tls_blocks;
+	StdVector<MeshBlockTask *> &tasks = tls_tasks;
+	StdVector<Box3i> &data_boxes = tls_data_boxes;
+	StdVector<std::shared_ptr<VoxelBuffer>> &blocks = tls_blocks;
+	tasks.clear();
+	data_boxes.clear();
+
+	Ref<VoxelStream> baked_mesh_stream;
+	if (_mesh_baking_enabled) {
+		Ref<VoxelStream> stream = get_stream();
+		if (stream.is_valid() && stream->supports_mesh_blocks()) {
+			baked_mesh_stream = stream;
+		}
+	}
+
 	for (size_t bi = 0; bi < _blocks_pending_update.size(); ++bi) {
 		ZN_PROFILE_SCOPE_NAMED("Block");
 		const Vector3i mesh_block_pos = _blocks_pending_update[bi];
@@ -1800,18 +2158,45 @@ void VoxelTerrain::process_meshing() {
 #endif
 
 		// print_line(String("DDD request {0}").format(varray(mesh_request.render_block_position.to_vec3())));
-		// We'll allocate this quite often. If it becomes a problem, it should be easy to pool.
-		MeshBlockTask *task = ZN_NEW(MeshBlockTask);
+		MeshBlockTask *task = ThreadedTaskPool<MeshBlockTask>::get_singleton().create();
 		task->volume_id = _volume_id;
 		task->mesh_block_position = mesh_block_pos;
 		task->lod_index = 0;
 		task->meshing_dependency = _meshing_dependency;
 		task->collision_hint = _generate_collisions;
+		task->require_collision_shape = _generate_collisions && mesh_block->collision_viewers.get() > 0;
 		task->data = _data;
-
-		// This iteration order is specifically chosen to match VoxelEngine and threaded access
-		_data->get_blocks_with_voxel_data(data_box, 0, to_span(task->blocks));
 		task->blocks_count = Vector3iUtil::get_volume(data_box.size);
+		task->caused_by_edit = mesh_block->update_caused_by_edit;
+		task->baked_mesh_stream = baked_mesh_stream;
+		task->baked_mesh_settings_hash = _baked_mesh_settings_hash;
+
+		tasks.push_back(task);
+		data_boxes.push_back(data_box);
+
+		mesh_block->is_in_update_list = false;
+		mesh_block->update_caused_by_edit = false;
+
+		_data->set_blocks_access_time(data_box, _data_access_time);
+	}
+
+	unsigned int total_blocks_count = 0;
+	for (const MeshBlockTask *task : tasks) {
+		total_blocks_count += task->blocks_count;
+	}
+	blocks.clear();
+	blocks.resize(total_blocks_count);
+
+	// This iteration order is specifically chosen to match VoxelEngine and threaded access
+	_data->get_blocks_with_voxel_data(to_span(data_boxes), 0, to_span(blocks));
+
+	unsigned int blocks_index = 0;
+
+	for (MeshBlockTask *task : tasks) {
+		for (unsigned int i = 0; i < task->blocks_count; ++i) {
+			task->blocks[i] = std::move(blocks[blocks_index + i]);
+		}
+		blocks_index += task->blocks_count;
 
 #ifdef DEBUG_ENABLED
 		{
@@ -1822,9 +2207,10 @@ void VoxelTerrain::process_meshing() {
 				}
 			}
 			// Blocks that were in the list must have been scheduled because we have data for them!
-			if (count == 0) {
+			// Unless their voxels were evicted, in which case the generator is used.
+			if (count == 0 && _data_memory_budget_mb == 0) {
 				ZN_PRINT_ERROR("Unexpected empty block list in meshing block task");
-				ZN_DELETE(task);
+				task->dispose();
 				continue;
 			}
 		}
@@ -1839,8 +2225,6 @@ void VoxelTerrain::process_meshing() {
 		);
 
 		scheduler.push_main_task(task);
-
-		mesh_block->is_in_update_list = false;
 	}
 
 	scheduler.flush();
@@ -1853,6 +2237,250 @@ void VoxelTerrain::process_meshing() {
 	// String::num(_block_update_queue.size()));
 }
 
+void VoxelTerrain::process_data_memory_budget() {
+	if (_data_memory_budget_mb == 0) {
+		_stats.resident_voxel_bytes = 0;
+		return;
+	}
+
+	// Counting resident memory goes through all blocks, so it isn't done every frame
+	static const uint32_t CHECK_INTERVAL = 30;
+	if ((_data_access_time % CHECK_INTERVAL) != 0) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	const uint64_t budget = static_cast<uint64_t>(_data_memory_budget_mb) << 20;
+	uint64_t resident_bytes = _data->get_resident_voxel_bytes(0);
+
+	if (resident_bytes > budget) {
+		// Free a bit more than necessary, so eviction doesn't happen again as soon as a few more blocks load
+		const uint64_t target = budget - budget / 8;
+		const uint64_t freed_bytes = _data->evict_generated_block_voxels(resident_bytes - target);
+		resident_bytes -= freed_bytes;
+		_stats.evicted_voxel_bytes += freed_bytes;
+
+		if (resident_bytes > budget) {
+			// Remaining blocks are edited. They stay loaded while viewers need them, and are saved when unloaded.
+			ZN_PRINT_VERBOSE(
+					format("VoxelTerrain data uses {} bytes, exceeding its budget of {} bytes", resident_bytes, budget)
+			);
+		}
+	}
+
+	_stats.resident_voxel_bytes = resident_bytes;
+}
+
+void VoxelTerrain::process_cold_block_compression() {
+	if (_cold_block_compression_delay_sec <= 0.f) {
+		return;
+	}
+
+	// Finding cold blocks goes through all blocks, so it isn't done every frame
+	static const uint32_t CHECK_INTERVAL = 30;
+	if ((_data_access_time % CHECK_INTERVAL) != 0) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	// Access times count frames, so they are associated with real time to express the delay in seconds
+	const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
+	_access_time_samples.push_back(AccessTimeSample{ _data_access_time, now_usec });
+
+	const uint64_t delay_usec = static_cast<uint64_t>(_cold_block_compression_delay_sec * 1000000.f);
+	// Samples are in chronological order, find how many of them were taken at least the delay ago
+	unsigned int old_sample_count = 0;
+	while (old_sample_count < _access_time_samples.size() &&
+		   now_usec - _access_time_samples[old_sample_count].time_usec >= delay_usec) {
+		++old_sample_count;
+	}
+	if (old_sample_count == 0) {
+		return;
+	}
+	// Blocks last accessed before the most recent of these samples were not accessed for at least the delay
+	const uint32_t access_time_threshold = _access_time_samples[old_sample_count - 1].access_time;
+	_access_time_samples.erase(_access_time_samples.begin(), _access_time_samples.begin() + (old_sample_count - 1));
+
+	if (_cold_block_compression_state == nullptr) {
+		_cold_block_compression_state = make_shared_instance<CompressColdBlocksTask::State>();
+	}
+	if (_cold_block_compression_state->running) {
+		return;
+	}
+
+	StdVector<Vector3i> block_positions;
+	_data->find_cold_blocks(access_time_threshold, _data_access_time, block_positions);
+	if (block_positions.size() == 0) {
+		return;
+	}
+
+	_cold_block_compression_state->running = true;
+
+	CompressColdBlocksTask *task = ZN_NEW(CompressColdBlocksTask);
+	task->volume_id = _volume_id;
+	task->data = _data;
+	task->block_positions = std::move(block_positions);
+	task->state = _cold_block_compression_state;
+
+	VoxelEngine::get_singleton().push_async_task(task);
+}
+
+void VoxelTerrain::schedule_blocky_light_update(Box3i voxel_box, bool caused_by_edit) {
+	Ref<VoxelMesherBlocky> blocky_mesher = _mesher;
+	if (blocky_mesher.is_null() || !blocky_mesher->is_light_enabled()) {
+		return;
+	}
+	_blocky_light_pending_boxes.push_back(voxel_box);
+	_blocky_light_pending_edit |= caused_by_edit;
+}
+
+void VoxelTerrain::process_blocky_light() {
+	if (_blocky_light_state == nullptr) {
+		if (_blocky_light_pending_boxes.size() == 0) {
+			return;
+		}
+		_blocky_light_state = make_shared_instance<UpdateBlockyLightTask::State>();
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	// Mesh again where light changed
+	StdVector<Box3i> changed_boxes;
+	bool changed_by_edit;
+	{
+		UpdateBlockyLightTask::State &state = *_blocky_light_state;
+		MutexLock mlock(state.changed_boxes_mutex);
+		changed_boxes = std::move(state.changed_boxes);
+		state.changed_boxes.clear();
+		changed_by_edit = state.changed_by_edit;
+		state.changed_by_edit = false;
+	}
+	for (const Box3i &box : changed_boxes) {
+		try_schedule_mesh_update_from_data(box, changed_by_edit);
+	}
+
+	if (_blocky_light_pending_boxes.size() == 0 || _blocky_light_state->running) {
+		// Areas keep accumulating until the running task is done
+		return;
+	}
+
+	Ref<VoxelMesherBlocky> blocky_mesher = _mesher;
+	Ref<VoxelBlockyLibraryBase> library;
+	if (blocky_mesher.is_valid() && blocky_mesher->is_light_enabled()) {
+		library = blocky_mesher->get_library();
+	}
+	if (library.is_null()) {
+		_blocky_light_pending_boxes.clear();
+		_blocky_light_pending_edit = false;
+		return;
+	}
+
+	std::shared_ptr<blocky_light::ModelProperties> models = make_shared_instance<blocky_light::ModelProperties>();
+	get_light_properties(*library->get_baked_data_snapshot(), *models);
+
+	_blocky_light_state->running = true;
+
+	UpdateBlockyLightTask *task = ZN_NEW(UpdateBlockyLightTask);
+	task->volume_id = _volume_id;
+	task->data = _data;
+	task->models = models;
+	task->channel = blocky_mesher->get_light_channel();
+	task->voxel_boxes = std::move(_blocky_light_pending_boxes);
+	task->caused_by_edit = _blocky_light_pending_edit;
+	task->state = _blocky_light_state;
+
+	_blocky_light_pending_boxes.clear();
+	_blocky_light_pending_edit = false;
+
+	VoxelEngine::get_singleton().push_async_task(task);
+}
+
+void VoxelTerrain::schedule_blocky_simulation_update(Box3i voxel_box) {
+	if (!_blocky_simulation_enabled) {
+		return;
+	}
+	if (_multiplayer_synchronizer != nullptr && !_multiplayer_synchronizer->is_server()) {
+		// The server simulates voxels and sends changes
+		return;
+	}
+	// Neighbors of changed voxels may be able to move now
+	_blocky_simulation_pending_boxes.push_back(voxel_box.padded(1));
+}
+
+void VoxelTerrain::process_blocky_simulation() {
+	if (_blocky_simulation_state == nullptr) {
+		if (_blocky_simulation_pending_boxes.size() == 0) {
+			return;
+		}
+		_blocky_simulation_state = make_shared_instance<StepBlockySimulationTask::State>();
+	}
+
+	if (_blocky_simulation_state->running) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	// Apply changes of the last step. This also schedules the next step around them, and light updates.
+	StdVector<Box3i> changed_boxes;
+	{
+		StepBlockySimulationTask::State &state = *_blocky_simulation_state;
+		MutexLock mlock(state.changed_boxes_mutex);
+		changed_boxes = std::move(state.changed_boxes);
+		state.changed_boxes.clear();
+	}
+	for (const Box3i &box : changed_boxes) {
+		post_edit_area(box, true);
+	}
+
+	if (_blocky_simulation_pending_boxes.size() == 0) {
+		return;
+	}
+
+	const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
+	const uint64_t interval_usec = static_cast<uint64_t>(_blocky_simulation_interval_sec * 1000000.f);
+	if (now_usec - _blocky_simulation_last_step_time_usec < interval_usec) {
+		// Areas keep accumulating until the next step
+		return;
+	}
+
+	Ref<VoxelMesherBlocky> blocky_mesher = _mesher;
+	Ref<VoxelBlockyLibraryBase> library;
+	if (blocky_mesher.is_valid()) {
+		library = blocky_mesher->get_library();
+	}
+	if (library.is_null()) {
+		_blocky_simulation_pending_boxes.clear();
+		return;
+	}
+
+	std::shared_ptr<blocky_simulation::ModelProperties> models =
+			make_shared_instance<blocky_simulation::ModelProperties>();
+	get_simulation_properties(*library->get_baked_data_snapshot(), *models);
+	if (!models->has_simulated_models()) {
+		_blocky_simulation_pending_boxes.clear();
+		return;
+	}
+
+	_blocky_simulation_state->running = true;
+	_blocky_simulation_last_step_time_usec = now_usec;
+
+	StepBlockySimulationTask *task = ZN_NEW(StepBlockySimulationTask);
+	task->volume_id = _volume_id;
+	task->data = _data;
+	task->models = models;
+	task->step_index = _blocky_simulation_step_index;
+	task->voxel_boxes = std::move(_blocky_simulation_pending_boxes);
+	task->state = _blocky_simulation_state;
+
+	_blocky_simulation_pending_boxes.clear();
+	++_blocky_simulation_step_index;
+
+	VoxelEngine::get_singleton().push_async_task(task);
+}
+
 void VoxelTerrain::apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob) {
 	ZN_PROFILE_SCOPE();
 	// print_line(String("DDD receive {0}").format(varray(ob.position.to_vec3())));
@@ -1862,6 +2490,8 @@ void VoxelTerrain::apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob) {
 		// print_line("- no longer loaded");
 		// That block is no longer loaded, drop the result
 		++_stats.dropped_block_meshs;
+		// The block was unloaded while it was being meshed again, so if its mesh was cached, it is outdated
+		_mesh_reload_cache.remove(ob.position);
 		return;
 	}
 
@@ -1888,6 +2518,11 @@ void VoxelTerrain::apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob) {
 		shadow_occluder_mesh = ob.shadow_occluder_mesh;
 		// It can be empty
 		material_indices = std::move(ob.mesh_material_indices);
+	} else if (ob.has_staged_surfaces) {
+		// Surfaces were prepared in the threaded task, only upload them here
+		mesh = build_mesh(to_span_const(ob.staged_surfaces));
+		material_indices = std::move(ob.mesh_material_indices);
+		shadow_occluder_mesh = build_mesh(ob.surfaces.shadow_occluder);
 	} else {
 		// Can't build meshes in threads, do it here
 		material_indices.clear();
@@ -1940,6 +2575,7 @@ void VoxelTerrain::apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob) {
 			shadow_occluder_mode
 #endif
 	);
+	block->mesh_size_in_bytes = VoxelMesher::get_mesh_size_in_bytes(ob.surfaces);
 
 	if (_material_override.is_valid()) {
 		block->set_material_override(_material_override);
@@ -1947,9 +2583,15 @@ void VoxelTerrain::apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob) {
 
 	const bool gen_collisions = _generate_collisions && block->collision_viewers.get() > 0;
 	if (gen_collisions) {
-		Ref<Shape3D> collision_shape = make_collision_shape_from_mesher_output(ob.surfaces, **_mesher);
+		Ref<Shape3D> collision_shape;
+		if (ob.has_collision_shape) {
+			collision_shape = ob.collision_shape;
+		} else {
+			collision_shape = make_collision_shape_from_mesher_output(ob.surfaces, **_mesher);
+		}
 		const bool debug_collisions = is_inside_tree() ? get_tree()->is_debugging_collisions_hint() : false;
 		block->set_collision_shape(collision_shape, debug_collisions, this, _collision_margin);
+		block->collision_size_in_bytes = VoxelMesher::get_collision_size_in_bytes(ob.surfaces);
 
 		block->set_collision_layer(_collision_layer);
 		block->set_collision_mask(_collision_mask);
@@ -2266,6 +2908,24 @@ void VoxelTerrain::_bind_methods() {
 	);
 	ClassDB::bind_method(D_METHOD("is_block_enter_notification_enabled"), &Self::is_block_enter_notification_enabled);
 
+	ClassDB::bind_method(
+			D_METHOD("set_block_enter_notification_batching_enabled", "enabled"),
+			&Self::set_block_enter_notification_batching_enabled
+	);
+	ClassDB::bind_method(
+			D_METHOD("is_block_enter_notification_batching_enabled"),
+			&Self::is_block_enter_notification_batching_enabled
+	);
+
+	ClassDB::bind_method(
+			D_METHOD("set_block_enter_notification_time_budget_usec", "usec"),
+			&Self::set_block_enter_notification_time_budget_usec
+	);
+	ClassDB::bind_method(
+			D_METHOD("get_block_enter_notification_time_budget_usec"),
+			&Self::get_block_enter_notification_time_budget_usec
+	);
+
 	ClassDB::bind_method(
 			D_METHOD("set_area_edit_notification_enabled", "enabled"), &Self::set_area_edit_notification_enabled
 	);
@@ -2306,6 +2966,28 @@ void VoxelTerrain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_generator_use_gpu", "enable"), &Self::set_generator_use_gpu);
 	ClassDB::bind_method(D_METHOD("get_generator_use_gpu"), &Self::get_generator_use_gpu);
 
+	ClassDB::bind_method(D_METHOD("set_data_memory_budget_mb", "mb"), &Self::set_data_memory_budget_mb);
+	ClassDB::bind_method(D_METHOD("get_data_memory_budget_mb"), &Self::get_data_memory_budget_mb);
+
+	ClassDB::bind_method(
+			D_METHOD("set_cold_block_compression_delay", "seconds"), &Self::set_cold_block_compression_delay
+	);
+	ClassDB::bind_method(D_METHOD("get_cold_block_compression_delay"), &Self::get_cold_block_compression_delay);
+
+	ClassDB::bind_method(D_METHOD("set_blocky_simulation_enabled", "enabled"), &Self::set_blocky_simulation_enabled);
+	ClassDB::bind_method(D_METHOD("is_blocky_simulation_enabled"), &Self::is_blocky_simulation_enabled);
+
+	ClassDB::bind_method(
+			D_METHOD("set_blocky_simulation_interval", "seconds"), &Self::set_blocky_simulation_interval
+	);
+	ClassDB::bind_method(D_METHOD("get_blocky_simulation_interval"), &Self::get_blocky_simulation_interval);
+
+	ClassDB::bind_method(D_METHOD("set_mesh_reload_cache_budget_mb", "mb"), &Self::set_mesh_reload_cache_budget_mb);
+	ClassDB::bind_method(D_METHOD("get_mesh_reload_cache_budget_mb"), &Self::get_mesh_reload_cache_budget_mb);
+
+	ClassDB::bind_method(D_METHOD("set_mesh_baking_enabled", "enabled"), &Self::set_mesh_baking_enabled);
+	ClassDB::bind_method(D_METHOD("is_mesh_baking_enabled"), &Self::is_mesh_baking_enabled);
+
 	// TODO Rename `_voxel_bounds`
 	ClassDB::bind_method(D_METHOD("set_bounds", "bounds"), &Self::_b_set_bounds);
 	ClassDB::bind_method(D_METHOD("get_bounds"), &Self::_b_get_bounds);
@@ -2332,6 +3014,7 @@ void VoxelTerrain::_bind_methods() {
 
 #ifdef ZN_GODOT
 	GDVIRTUAL_BIND(_on_data_block_entered, "info");
+	GDVIRTUAL_BIND(_on_data_blocks_entered, "network_peer_id", "positions");
 	GDVIRTUAL_BIND(_on_area_edited, "area_origin", "area_size");
 #endif
 
@@ -2380,6 +3063,23 @@ void VoxelTerrain::_bind_methods() {
 			"is_block_enter_notification_enabled"
 	);
 
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "block_enter_notification_batching_enabled"),
+			"set_block_enter_notification_batching_enabled",
+			"is_block_enter_notification_batching_enabled"
+	);
+
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::INT,
+					"block_enter_notification_time_budget_usec",
+					PROPERTY_HINT_RANGE,
+					"0,100000,1,or_greater"
+			),
+			"set_block_enter_notification_time_budget_usec",
+			"get_block_enter_notification_time_budget_usec"
+	);
+
 	ADD_PROPERTY(
 			PropertyInfo(Variant::BOOL, "area_edit_notification_enabled"),
 			"set_area_edit_notification_enabled",
@@ -2403,6 +3103,34 @@ void VoxelTerrain::_bind_methods() {
 	);
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "mesh_block_size"), "set_mesh_block_size", "get_mesh_block_size");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_gpu_generation"), "set_generator_use_gpu", "get_generator_use_gpu");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "data_memory_budget_mb", PROPERTY_HINT_RANGE, "0,65536,1,or_greater"),
+			"set_data_memory_budget_mb",
+			"get_data_memory_budget_mb"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "cold_block_compression_delay", PROPERTY_HINT_RANGE, "0,600,0.1,or_greater"),
+			"set_cold_block_compression_delay",
+			"get_cold_block_compression_delay"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "blocky_simulation_enabled"),
+			"set_blocky_simulation_enabled",
+			"is_blocky_simulation_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "blocky_simulation_interval", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater"),
+			"set_blocky_simulation_interval",
+			"get_blocky_simulation_interval"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "mesh_reload_cache_budget_mb", PROPERTY_HINT_RANGE, "0,4096,1,or_greater"),
+			"set_mesh_reload_cache_budget_mb",
+			"get_mesh_reload_cache_budget_mb"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "mesh_baking_enabled"), "set_mesh_baking_enabled", "is_mesh_baking_enabled"
+	);
 
 	ADD_GROUP("Debug", "debug_");
 
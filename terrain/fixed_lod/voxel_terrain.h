@@ -2,6 +2,7 @@
 #define VOXEL_TERRAIN_H
 
 #include "../../constants/voxel_constants.h"
+#include "../../edition/random_tick_index.h"
 #include "../../engine/meshing_dependency.h"
 #include "../../storage/voxel_data.h"
 #include "../../util/containers/std_unordered_map.h"
@@ -9,9 +10,13 @@
 #include "../../util/godot/core/gdvirtual.h"
 #include "../../util/godot/memory.h"
 #include "../../util/math/box3i.h"
+#include "../compress_cold_blocks_task.h"
+#include "../step_blocky_simulation_task.h"
+#include "../update_blocky_light_task.h"
 #include "../voxel_data_block_enter_info.h"
 #include "../voxel_mesh_map.h"
 #include "../voxel_node.h"
+#include "mesh_quick_reloading_cache.h"
 #include "voxel_mesh_block_vt.h"
 #include "voxel_terrain_multiplayer_synchronizer.h"
 
@@ -86,6 +91,16 @@ public:
 	void set_block_enter_notification_enabled(bool enable);
 	bool is_block_enter_notification_enabled() const;
 
+	// When enabled, data block enter notifications are queued and delivered in batches once per frame, calling
+	// `_on_data_blocks_entered` once per network peer instead of `_on_data_block_entered` once per block.
+	void set_block_enter_notification_batching_enabled(bool enable);
+	bool is_block_enter_notification_batching_enabled() const;
+
+	// Time spent each frame delivering batched notifications, in microseconds. Notifications exceeding it are
+	// delivered in the next frames.
+	void set_block_enter_notification_time_budget_usec(int usec);
+	int get_block_enter_notification_time_budget_usec() const;
+
 	void set_area_edit_notification_enabled(bool enable);
 	bool is_area_edit_notification_enabled() const;
 
@@ -98,6 +113,40 @@ public:
 	void set_generator_use_gpu(bool enabled);
 	bool get_generator_use_gpu() const;
 
+	// Limits how much memory voxel data can use, in megabytes. When exceeded, generated blocks that were not edited
+	// get their voxels freed, least recently used first. They are generated again when needed.
+	// 0 means no limit.
+	void set_data_memory_budget_mb(int mb);
+	int get_data_memory_budget_mb() const;
+
+	// Voxels of blocks that were not accessed for this amount of time are compressed in memory with LZ4 by a
+	// background task. They are decompressed when accessed again.
+	// 0 disables compression.
+	void set_cold_block_compression_delay(float seconds);
+	float get_cold_block_compression_delay() const;
+
+	// Simulates blocky voxels whose model has a simulation behavior, such as falling sand or flowing water. Only voxels
+	// near recent changes are simulated. Requires a `VoxelMesherBlocky` with a library.
+	// On multiplayer clients, voxels are not simulated, the server sends changes instead.
+	void set_blocky_simulation_enabled(bool enabled);
+	bool is_blocky_simulation_enabled() const;
+
+	// Time between two steps of the simulation
+	void set_blocky_simulation_interval(float seconds);
+	float get_blocky_simulation_interval() const;
+
+	// Limits how much memory meshes of blocks that left the view distance can use, in megabytes. These meshes are
+	// shown again without meshing if viewers come back to them before they get evicted or edited.
+	// 0 disables caching. Not used when a `VoxelInstancer` is attached.
+	void set_mesh_reload_cache_budget_mb(int mb);
+	int get_mesh_reload_cache_budget_mb() const;
+
+	// If enabled and the stream supports it, meshes are saved to the stream after being built, and loaded from it
+	// instead of being built again. Meant for worlds that don't change. Baked meshes are discarded when the mesher,
+	// generator or mesh block size change.
+	void set_mesh_baking_enabled(bool enabled);
+	bool is_mesh_baking_enabled() const;
+
 	VoxelData &get_storage() const {
 		ZN_ASSERT(_data != nullptr);
 		return *_data;
@@ -107,6 +156,11 @@ public:
 		return _data;
 	}
 
+	// Used by random ticks to find tickable voxels. Edits invalidate the blocks they touch.
+	inline RandomTickIndex &get_random_tick_index() {
+		return _random_tick_index;
+	}
+
 	Ref<VoxelTool> get_voxel_tool() override;
 
 	// Creates or overrides whatever block data there is at the given position.
@@ -134,10 +188,13 @@ public:
 		int updated_blocks = 0;
 		int dropped_block_loads = 0;
 		int dropped_block_meshs = 0;
+		int reloaded_block_meshes = 0;
 		uint32_t time_detect_required_blocks = 0;
 		uint32_t time_request_blocks_to_load = 0;
 		uint32_t time_process_load_responses = 0;
 		uint32_t time_request_blocks_to_update = 0;
+		uint64_t resident_voxel_bytes = 0;
+		uint64_t evicted_voxel_bytes = 0;
 	};
 
 	const Stats &get_stats() const;
@@ -205,10 +262,18 @@ private:
 	);
 	// void process_received_data_blocks();
 	void process_meshing();
+	void process_data_memory_budget();
+	void process_cold_block_compression();
+	void process_blocky_light();
+	void schedule_blocky_light_update(Box3i voxel_box, bool caused_by_edit);
+	void process_blocky_simulation();
+	void schedule_blocky_simulation_update(Box3i voxel_box);
 	void apply_mesh_update(const VoxelEngine::BlockMeshOutput &ob);
 	void apply_data_block_response(VoxelEngine::BlockDataOutput &ob);
+	void get_memory_usage(VolumeMemoryUsage &usage) const;
 
 	void _on_stream_params_changed();
+	void update_baked_mesh_settings_hash();
 	// void _set_block_size_po2(int p_block_size_po2);
 	// void make_all_view_dirty();
 	void start_updater();
@@ -224,9 +289,11 @@ private:
 	void unview_mesh_block(Vector3i bpos, bool mesh_flag, bool collision_flag);
 	// void unload_data_block(Vector3i bpos);
 	void unload_mesh_block(Vector3i bpos);
+	void cache_mesh_block(VoxelMeshBlockVT &block, bool has_collision);
+	bool try_restore_mesh_block_from_cache(VoxelMeshBlockVT &block);
 	// void make_data_block_dirty(Vector3i bpos);
-	void try_schedule_mesh_update(VoxelMeshBlockVT &block);
-	void try_schedule_mesh_update_from_data(const Box3i &box_in_voxels);
+	void try_schedule_mesh_update(VoxelMeshBlockVT &block, bool caused_by_edit = false);
+	void try_schedule_mesh_update_from_data(const Box3i &box_in_voxels, bool caused_by_edit = false);
 
 	void save_all_modified_blocks(bool with_copy, std::shared_ptr<AsyncDependencyTracker> tracker);
 	void get_viewer_pos_and_direction(Vector3 &out_pos, Vector3 &out_direction) const;
@@ -246,6 +313,8 @@ private:
 	bool try_get_paired_viewer_index(ViewerID id, size_t &out_i) const;
 
 	void notify_data_block_enter(const VoxelDataBlock &block, Vector3i bpos, ViewerID viewer_id);
+	void process_data_block_enter_notifications();
+	void restore_evicted_block_voxels(VoxelDataBlock &block, Vector3i bpos);
 
 	bool is_area_meshed(const Box3i &box_in_voxels) const;
 
@@ -258,6 +327,10 @@ private:
 	// This only happens if data block enter notifications are enabled.
 	GDVIRTUAL1(_on_data_block_entered, VoxelDataBlockEnterInfo *);
 
+	// Called once per frame for each network peer, with positions of data blocks that entered its viewers' areas.
+	// This only happens if data block enter notifications are enabled and batched.
+	GDVIRTUAL2(_on_data_blocks_entered, int, PackedVector3Array);
+
 	// Called each time voxels are edited within a region.
 	GDVIRTUAL2(_on_area_edited, Vector3i, Vector3i);
 
@@ -301,8 +374,11 @@ private:
 	// Voxel storage. Using a shared_ptr so threaded tasks can use it safely.
 	std::shared_ptr<VoxelData> _data;
 
+	RandomTickIndex _random_tick_index;
+
 	// Mesh storage
 	VoxelMeshMap<VoxelMeshBlockVT> _mesh_map;
+	MeshQuickReloadingCache _mesh_reload_cache;
 	uint32_t _mesh_block_size_po2 = constants::DEFAULT_BLOCK_SIZE_PO2;
 
 	unsigned int _max_view_distance_voxels = 128;
@@ -352,15 +428,55 @@ private:
 	bool _run_stream_in_editor = true;
 	// bool _stream_enabled = false;
 	bool _block_enter_notification_enabled = false;
+	bool _block_enter_notification_batching_enabled = false;
+	unsigned int _block_enter_notification_time_budget_usec = 1000;
 	bool _area_edit_notification_enabled = false;
 	// If enabled, VoxelViewers will cause blocks to automatically load around them.
 	bool _automatic_loading_enabled = true;
 	bool _generator_use_gpu = false;
+	bool _mesh_baking_enabled = false;
+	uint64_t _baked_mesh_settings_hash = 0;
+
+	unsigned int _data_memory_budget_mb = 0;
+	// Incremented every process, used to find least recently used data blocks
+	uint32_t _data_access_time = 0;
+
+	float _cold_block_compression_delay_sec = 0.f;
+	struct AccessTimeSample {
+		uint32_t access_time;
+		uint64_t time_usec;
+	};
+	// Tells when access times were reached, to find blocks not accessed for a given amount of time
+	StdVector<AccessTimeSample> _access_time_samples;
+	std::shared_ptr<CompressColdBlocksTask::State> _cold_block_compression_state;
+
+	// Areas where light of blocky voxels has to be computed again
+	StdVector<Box3i> _blocky_light_pending_boxes;
+	bool _blocky_light_pending_edit = false;
+	std::shared_ptr<UpdateBlockyLightTask::State> _blocky_light_state;
+
+	bool _blocky_simulation_enabled = false;
+	float _blocky_simulation_interval_sec = 0.25f;
+	uint64_t _blocky_simulation_last_step_time_usec = 0;
+	uint32_t _blocky_simulation_step_index = 0;
+	// Areas where voxels may have to be simulated in the next step
+	StdVector<Box3i> _blocky_simulation_pending_boxes;
+	std::shared_ptr<StepBlockySimulationTask::State> _blocky_simulation_state;
 
 	Ref<Material> _material_override;
 
 	zylann::godot::ObjectUniquePtr<VoxelDataBlockEnterInfo> _data_block_enter_info_obj;
 
+	struct PendingDataBlockEnter {
+		// Shallow copy of the block when it entered
+		VoxelDataBlock block;
+		Vector3i position;
+		ViewerID viewer_id;
+	};
+
+	// Notifications waiting to be delivered when batching is enabled, oldest first
+	StdVector<PendingDataBlockEnter> _pending_data_block_enter_notifications;
+
 	// References to external nodes.
 	VoxelInstancer *_instancer = nullptr;
 	VoxelTerrainMultiplayerSynchronizer *_multiplayer_synchronizer = nullptr;
@@ -7,14 +7,14 @@
 #include "../../util/godot/classes/multiplayer_peer.h"
 #include "../../util/godot/classes/scene_tree.h"
 #include "../../util/godot/core/array.h"
+#include "../../util/godot/core/packed_arrays.h"
+#include "../../util/hash_funcs.h"
 #include "../../util/io/serialization.h"
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
 #include "voxel_terrain.h"
 
-#ifdef TOOLS_ENABLED
-#include "../../util/godot/core/packed_arrays.h"
-#endif
+#include <algorithm>
 
 namespace zylann::voxel {
 
@@ -27,6 +27,11 @@ VoxelTerrainMultiplayerSynchronizer::VoxelTerrainMultiplayerSynchronizer() {
 
 	rpc_config(VoxelStringNames::get_singleton()._rpc_receive_blocks, config);
 	rpc_config(VoxelStringNames::get_singleton()._rpc_receive_area, config);
+	rpc_config(VoxelStringNames::get_singleton()._rpc_receive_block_hashes, config);
+
+	// Sent by clients to the server
+	config["rpc_mode"] = MultiplayerAPI::RPC_MODE_ANY_PEER;
+	rpc_config(VoxelStringNames::get_singleton()._rpc_request_blocks, config);
 
 	set_process(true);
 }
@@ -49,30 +54,42 @@ void VoxelTerrainMultiplayerSynchronizer::send_block(
 		const VoxelDataBlock &data_block,
 		Vector3i bpos
 ) {
-	ZN_PROFILE_SCOPE();
+	// print_line(String("Server: send block {0}").format(varray(bpos)));
 
-	BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(data_block.get_voxels_const());
-	ZN_ASSERT_RETURN(result.success);
+	// rpc_id(viewer_peer_id, VoxelStringNames::get_singleton().receive_block, data);
+	// Instead of sending it right away, defer it until the terrain finished processing. Sending individual blocks with
+	// the RPC system is too slow. The block is serialized when actually sent, because rate limiting can delay it
+	// after edits have been made to it.
+	PeerQueue &queue = _peer_queues[viewer_peer_id];
+	if (_block_hashes_enabled) {
+		queue.hash_positions.push_back(bpos);
+	} else {
+		queue.block_positions.push_back(bpos);
+	}
+}
 
-	PackedByteArray message_data;
-	message_data.resize(4 * sizeof(int16_t) + result.data.size());
+void VoxelTerrainMultiplayerSynchronizer::set_max_bytes_per_second_per_peer(int bps) {
+	_max_bytes_per_second_per_peer = math::max(bps, 0);
+}
 
-	ByteSpanWithPosition mw_span(Span<uint8_t>(message_data.ptrw(), message_data.size()), 0);
-	MemoryWriterExistingBuffer mw(mw_span, ENDIANNESS_LITTLE_ENDIAN);
+int VoxelTerrainMultiplayerSynchronizer::get_max_bytes_per_second_per_peer() const {
+	return _max_bytes_per_second_per_peer;
+}
 
-	mw.store_16(bpos.x);
-	mw.store_16(bpos.y);
-	mw.store_16(bpos.z);
-	ZN_ASSERT_RETURN(result.data.size() <= 65535);
-	mw.store_16(result.data.size());
-	mw.store_buffer(to_span(result.data));
+void VoxelTerrainMultiplayerSynchronizer::set_block_hashes_enabled(bool enabled) {
+	_block_hashes_enabled = enabled;
+}
 
-	// print_line(String("Server: send block {0}").format(varray(bpos)));
+bool VoxelTerrainMultiplayerSynchronizer::is_block_hashes_enabled() const {
+	return _block_hashes_enabled;
+}
 
-	// rpc_id(viewer_peer_id, VoxelStringNames::get_singleton().receive_block, data);
-	// Instead of sending it right away, defer it until the terrain finished processing. Sending individual blocks with
-	// the RPC system is too slow.
-	_deferred_block_messages_per_peer[viewer_peer_id].push_back(DeferredBlockMessage{ message_data });
+void VoxelTerrainMultiplayerSynchronizer::set_cache_stream(Ref<VoxelStream> stream) {
+	_cache_stream = stream;
+}
+
+Ref<VoxelStream> VoxelTerrainMultiplayerSynchronizer::get_cache_stream() const {
+	return _cache_stream;
 }
 
 // TODO Have a way to implement ghost edits?
@@ -111,7 +128,9 @@ void VoxelTerrainMultiplayerSynchronizer::send_area(Box3i voxel_box) {
 		const int peer_id = VoxelEngine::get_singleton().get_viewer_network_peer_id(viewer_id);
 		// TODO Don't bother copying and serializing if no networked viewers are around?
 		if (peer_id != -1 && peer_id != MultiplayerPeer::TARGET_PEER_SERVER) {
-			rpc_id(peer_id, VoxelStringNames::get_singleton()._rpc_receive_area, pba);
+			// Sent in `process`, so edits are not sent before blocks they modify if those are still queued.
+			// PackedByteArray is copy-on-write, so this doesn't duplicate the data.
+			_peer_queues[peer_id].areas.push_back(pba);
 		}
 	}
 }
@@ -145,41 +164,299 @@ void VoxelTerrainMultiplayerSynchronizer::_notification(int p_what) {
 void VoxelTerrainMultiplayerSynchronizer::process() {
 	ZN_PROFILE_SCOPE();
 
-	for (auto it = _deferred_block_messages_per_peer.begin(); it != _deferred_block_messages_per_peer.end(); ++it) {
-		StdVector<DeferredBlockMessage> &messages = it->second;
+	if (_terrain == nullptr) {
+		return;
+	}
+
+	const float delta = get_process_delta_time();
+
+	for (auto it = _peer_queues.begin(); it != _peer_queues.end(); ++it) {
+		process_peer(it->first, delta);
+	}
+}
+
+void VoxelTerrainMultiplayerSynchronizer::process_peer(int peer_id, float delta) {
+	PeerQueue &queue = _peer_queues[peer_id];
+
+	const bool rate_limited = _max_bytes_per_second_per_peer > 0;
+	if (rate_limited) {
+		// Unused budget accumulates up to one second worth of data, to allow bursts
+		queue.budget = math::min(
+				queue.budget + static_cast<float>(_max_bytes_per_second_per_peer) * delta,
+				static_cast<float>(_max_bytes_per_second_per_peer)
+		);
+	}
+
+	if (queue.block_positions.size() == 0 && queue.hash_positions.size() == 0 && queue.areas.size() == 0) {
+		return;
+	}
+
+	// Positions of viewers of the peer, local to the terrain
+	static thread_local StdVector<Vector3> tls_viewer_positions;
+	StdVector<Vector3> &viewer_positions = tls_viewer_positions;
+	viewer_positions.clear();
+	{
+		const Transform3D world_to_local = _terrain->get_global_transform().affine_inverse();
+		VoxelEngine::get_singleton().for_each_viewer(
+				[peer_id, &world_to_local, &viewer_positions](ViewerID id, const VoxelEngine::Viewer &viewer) {
+					if (viewer.network_peer_id == peer_id) {
+						viewer_positions.push_back(world_to_local.xform(viewer.world_position));
+					}
+				}
+		);
+	}
+	if (viewer_positions.size() == 0) {
+		// The peer has left, or no longer has viewers needing the terrain
+		queue.block_positions.clear();
+		queue.hash_positions.clear();
+		queue.offered_blocks.clear();
+		queue.areas.clear();
+		return;
+	}
+
+	const VoxelStringNames &sn = VoxelStringNames::get_singleton();
+
+	// Edits are sent first, they are usually small and were made around players
+	unsigned int sent_area_count = 0;
+	for (; sent_area_count < queue.areas.size(); ++sent_area_count) {
+		if (rate_limited && queue.budget <= 0.f) {
+			break;
+		}
+		const PackedByteArray &pba = queue.areas[sent_area_count];
+		rpc_id(peer_id, sn._rpc_receive_area, pba);
+		queue.budget -= pba.size();
+	}
+	queue.areas.erase(queue.areas.begin(), queue.areas.begin() + sent_area_count);
+
+	// Hashes are much smaller than blocks, and the peer has to answer before blocks can be sent
+	if (queue.hash_positions.size() > 0 && !(rate_limited && queue.budget <= 0.f)) {
+		send_block_hashes(peer_id, queue, to_span(viewer_positions));
+	}
+
+	if (queue.block_positions.size() > 0 && !(rate_limited && queue.budget <= 0.f)) {
+		send_blocks(peer_id, queue, to_span(viewer_positions));
+	}
+}
+
+namespace {
 
-		if (messages.size() == 0) {
+struct BlockToSend {
+	float distance_sq;
+	Vector3i position;
+};
+
+// Sorts blocks so the closest to viewers are sent first
+void sort_blocks_to_send(
+		Span<const Vector3i> block_positions,
+		Span<const Vector3> viewer_positions,
+		unsigned int block_size_po2,
+		StdVector<BlockToSend> &blocks_to_send
+) {
+	ZN_ASSERT(viewer_positions.size() > 0);
+	blocks_to_send.clear();
+
+	const Vector3 half_block_size = Vector3(1, 1, 1) * static_cast<real_t>((1 << block_size_po2) / 2);
+	for (const Vector3i bpos : block_positions) {
+		const Vector3 center = Vector3(bpos << block_size_po2) + half_block_size;
+		float distance_sq = center.distance_squared_to(viewer_positions[0]);
+		for (unsigned int i = 1; i < viewer_positions.size(); ++i) {
+			const float d = center.distance_squared_to(viewer_positions[i]);
+			distance_sq = math::min(distance_sq, d);
+		}
+		blocks_to_send.push_back(BlockToSend{ distance_sq, bpos });
+	}
+	// Sorting by position too puts duplicates next to each other
+	std::sort(blocks_to_send.begin(), blocks_to_send.end(), [](const BlockToSend &a, const BlockToSend &b) {
+		if (a.distance_sq != b.distance_sq) {
+			return a.distance_sq < b.distance_sq;
+		}
+		return a.position < b.position;
+	});
+}
+
+// Keeps blocks that were not processed, so they are sent next time.
+// Order doesn't matter, they get sorted again.
+void requeue_remaining_blocks(
+		StdVector<Vector3i> &block_positions,
+		Span<const BlockToSend> blocks_to_send,
+		unsigned int processed_count
+) {
+	block_positions.clear();
+	for (unsigned int i = processed_count; i < blocks_to_send.size(); ++i) {
+		block_positions.push_back(blocks_to_send[i].position);
+	}
+}
+
+void write_message_count(StdVector<uint8_t> &message_data, uint32_t count) {
+	ByteSpanWithPosition count_span(Span<uint8_t>(message_data.data(), sizeof(uint32_t)), 0);
+	MemoryWriterExistingBuffer count_mw(count_span, ENDIANNESS_LITTLE_ENDIAN);
+	count_mw.store_32(count);
+}
+
+// Hash of the contents of a block. Computed on uncompressed data, so it doesn't depend on compression settings.
+uint64_t get_block_hash(const VoxelBuffer &voxels) {
+	BlockSerializer::SerializeResult result = BlockSerializer::serialize(voxels);
+	ZN_ASSERT_RETURN_V(result.success, 0);
+	return hash_fnv1a_64(result.data.data(), result.data.size());
+}
+
+} // namespace
+
+void VoxelTerrainMultiplayerSynchronizer::send_blocks(
+		int peer_id,
+		PeerQueue &queue,
+		Span<const Vector3> viewer_positions
+) {
+	ZN_PROFILE_SCOPE();
+
+	const bool rate_limited = _max_bytes_per_second_per_peer > 0;
+
+	static thread_local StdVector<BlockToSend> tls_blocks_to_send;
+	StdVector<BlockToSend> &blocks_to_send = tls_blocks_to_send;
+	sort_blocks_to_send(
+			to_span(queue.block_positions),
+			viewer_positions,
+			_terrain->get_data_block_size_pow2(),
+			blocks_to_send
+	);
+
+	// Make one big fat message per frame per peer, because sending many is super-slow with Godot's ENet multiplayer
+	// integration. It calls flush() on every RPC and that takes a lot of time, and there is overhead caused by
+	// the high-level features...
+	static thread_local StdVector<uint8_t> tls_message_data;
+	StdVector<uint8_t> &message_data = tls_message_data;
+	message_data.clear();
+	MemoryWriter mw(message_data, ENDIANNESS_LITTLE_ENDIAN);
+	// Block count, written at the end
+	mw.store_32(0);
+
+	VoxelData &data = _terrain->get_storage();
+	unsigned int block_count = 0;
+	unsigned int processed_count = 0;
+
+	for (; processed_count < blocks_to_send.size(); ++processed_count) {
+		if (rate_limited && queue.budget - static_cast<float>(message_data.size()) <= 0.f) {
+			break;
+		}
+		const Vector3i bpos = blocks_to_send[processed_count].position;
+		if (processed_count > 0 && blocks_to_send[processed_count - 1].position == bpos) {
+			// Duplicate
 			continue;
 		}
 
-		PackedByteArray pba;
-		// Make one big fat message per frame per peer, because sending many is super-slow with Godot's ENet multiplayer
-		// integration. It calls flush() on every RPC and that takes a lot of time, and there is overhead caused by
-		// the high-level features...
+		// Voxels of generated blocks may have been evicted to save memory
+		data.pre_generate_box(Box3i(data.block_to_voxel(bpos), Vector3iUtil::create(data.get_block_size())));
 
-		unsigned int size = 0;
-		for (const DeferredBlockMessage &message : messages) {
-			size += message.data.size();
+		SpatialLock3D::Read srlock(data.get_spatial_lock(0), BoxBounds3i::from_position(bpos));
+		std::shared_ptr<VoxelBuffer> voxels = data.try_get_block_voxels(bpos);
+		if (voxels == nullptr) {
+			// Got unloaded since it was requested
+			continue;
 		}
 
-		pba.resize(1 * sizeof(uint32_t) + size);
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(*voxels);
+		ZN_ASSERT_CONTINUE(result.success);
+		ZN_ASSERT_CONTINUE(result.data.size() <= 65535);
+
+		mw.store_16(bpos.x);
+		mw.store_16(bpos.y);
+		mw.store_16(bpos.z);
+		mw.store_16(result.data.size());
+		mw.store_buffer(to_span(result.data));
+		++block_count;
+	}
+
+	requeue_remaining_blocks(queue.block_positions, to_span(blocks_to_send), processed_count);
+
+	if (block_count == 0) {
+		return;
+	}
+
+	write_message_count(message_data, block_count);
+	queue.budget -= message_data.size();
+
+	PackedByteArray pba;
+	copy_to(pba, to_span(message_data));
+
+	ZN_PRINT_VERBOSE(format("Sending {} bytes of block data to peer {}", pba.size(), peer_id));
+	// print_data_hex(Span<const uint8_t>(pba.ptr(), pba.size()));
+	rpc_id(peer_id, VoxelStringNames::get_singleton()._rpc_receive_blocks, pba);
+}
+
+void VoxelTerrainMultiplayerSynchronizer::send_block_hashes(
+		int peer_id,
+		PeerQueue &queue,
+		Span<const Vector3> viewer_positions
+) {
+	ZN_PROFILE_SCOPE();
+
+	const bool rate_limited = _max_bytes_per_second_per_peer > 0;
+
+	static thread_local StdVector<BlockToSend> tls_blocks_to_send;
+	StdVector<BlockToSend> &blocks_to_send = tls_blocks_to_send;
+	sort_blocks_to_send(
+			to_span(queue.hash_positions),
+			viewer_positions,
+			_terrain->get_data_block_size_pow2(),
+			blocks_to_send
+	);
 
-		ByteSpanWithPosition mw_span(Span<uint8_t>(pba.ptrw(), pba.size()), 0);
-		MemoryWriterExistingBuffer mw(mw_span, ENDIANNESS_LITTLE_ENDIAN);
-		mw.store_32(messages.size());
+	static thread_local StdVector<uint8_t> tls_message_data;
+	StdVector<uint8_t> &message_data = tls_message_data;
+	message_data.clear();
+	MemoryWriter mw(message_data, ENDIANNESS_LITTLE_ENDIAN);
+	// Block count, written at the end
+	mw.store_32(0);
 
-		for (const DeferredBlockMessage &message : messages) {
-			mw.store_buffer(Span<const uint8_t>(message.data.ptr(), message.data.size()));
+	VoxelData &data = _terrain->get_storage();
+	unsigned int block_count = 0;
+	unsigned int processed_count = 0;
+
+	for (; processed_count < blocks_to_send.size(); ++processed_count) {
+		if (rate_limited && queue.budget - static_cast<float>(message_data.size()) <= 0.f) {
+			break;
+		}
+		const Vector3i bpos = blocks_to_send[processed_count].position;
+		if (processed_count > 0 && blocks_to_send[processed_count - 1].position == bpos) {
+			// Duplicate
+			continue;
 		}
-		ZN_ASSERT(mw.data.size() == mw.data.pos);
 
-		messages.clear();
+		data.pre_generate_box(Box3i(data.block_to_voxel(bpos), Vector3iUtil::create(data.get_block_size())));
 
-		const int peer_id = it->first;
-		ZN_PRINT_VERBOSE(format("Sending {} bytes of block data to peer {}", pba.size(), peer_id));
-		// print_data_hex(Span<const uint8_t>(pba.ptr(), pba.size()));
-		rpc_id(peer_id, VoxelStringNames::get_singleton()._rpc_receive_blocks, pba);
+		uint64_t hash;
+		{
+			SpatialLock3D::Read srlock(data.get_spatial_lock(0), BoxBounds3i::from_position(bpos));
+			std::shared_ptr<VoxelBuffer> voxels = data.try_get_block_voxels(bpos);
+			if (voxels == nullptr) {
+				// Got unloaded since it was requested
+				continue;
+			}
+			hash = get_block_hash(*voxels);
+		}
+
+		mw.store_16(bpos.x);
+		mw.store_16(bpos.y);
+		mw.store_16(bpos.z);
+		mw.store_64(hash);
+		queue.offered_blocks.insert(bpos);
+		++block_count;
+	}
+
+	requeue_remaining_blocks(queue.hash_positions, to_span(blocks_to_send), processed_count);
+
+	if (block_count == 0) {
+		return;
 	}
+
+	write_message_count(message_data, block_count);
+	queue.budget -= message_data.size();
+
+	PackedByteArray pba;
+	copy_to(pba, to_span(message_data));
+
+	ZN_PRINT_VERBOSE(format("Sending {} block hashes to peer {}", block_count, peer_id));
+	rpc_id(peer_id, VoxelStringNames::get_singleton()._rpc_receive_block_hashes, pba);
 }
 
 void VoxelTerrainMultiplayerSynchronizer::_b_receive_blocks(PackedByteArray message_data) {
@@ -193,6 +470,11 @@ void VoxelTerrainMultiplayerSynchronizer::_b_receive_blocks(PackedByteArray mess
 
 	const unsigned int block_count = mr.get_32();
 
+	const bool use_cache = _cache_stream.is_valid();
+	static thread_local StdVector<std::pair<Vector3i, std::shared_ptr<VoxelBuffer>>> tls_blocks_to_cache;
+	StdVector<std::pair<Vector3i, std::shared_ptr<VoxelBuffer>>> &blocks_to_cache = tls_blocks_to_cache;
+	blocks_to_cache.clear();
+
 	for (unsigned int i = 0; i < block_count; ++i) {
 		Vector3i bpos;
 		// This effectively limits volume size to 1,048,576. If really required, we could double this data to cover
@@ -213,6 +495,132 @@ void VoxelTerrainMultiplayerSynchronizer::_b_receive_blocks(PackedByteArray mess
 
 		ZN_ASSERT_RETURN(_terrain != nullptr);
 		_terrain->try_set_block_data(bpos, voxels_p);
+
+		if (use_cache) {
+			blocks_to_cache.push_back({ bpos, voxels_p });
+		}
+	}
+
+	if (blocks_to_cache.size() > 0) {
+		// Save received blocks so the server doesn't have to send them again next time
+		ZN_PROFILE_SCOPE_NAMED("Save to cache");
+		static thread_local StdVector<VoxelStream::VoxelQueryData> tls_queries;
+		StdVector<VoxelStream::VoxelQueryData> &queries = tls_queries;
+		queries.clear();
+		for (auto &p : blocks_to_cache) {
+			queries.push_back(VoxelStream::VoxelQueryData{ *p.second, p.first, 0, VoxelStream::RESULT_ERROR });
+		}
+		_cache_stream->save_voxel_blocks(to_span(queries));
+		queries.clear();
+		blocks_to_cache.clear();
+	}
+}
+
+bool VoxelTerrainMultiplayerSynchronizer::try_load_cached_block(Vector3i bpos, uint64_t hash) {
+	if (_cache_stream.is_null()) {
+		return false;
+	}
+
+	std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+	voxels->create(Vector3iUtil::create(_terrain->get_data_block_size()));
+
+	VoxelStream::VoxelQueryData query{ *voxels, bpos, 0, VoxelStream::RESULT_ERROR };
+	_cache_stream->load_voxel_block(query);
+	if (query.result != VoxelStream::RESULT_BLOCK_FOUND) {
+		return false;
+	}
+	if (get_block_hash(*voxels) != hash) {
+		// Outdated
+		return false;
+	}
+
+	_terrain->try_set_block_data(bpos, voxels);
+	return true;
+}
+
+void VoxelTerrainMultiplayerSynchronizer::_b_receive_block_hashes(PackedByteArray message_data) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(_terrain != nullptr);
+
+	MemoryReader mr(Span<const uint8_t>(message_data.ptr(), message_data.size()), ENDIANNESS_LITTLE_ENDIAN);
+
+	ZN_ASSERT_RETURN(static_cast<size_t>(message_data.size()) >= sizeof(uint32_t));
+	const unsigned int block_count = mr.get_32();
+	ZN_ASSERT_RETURN(
+			static_cast<size_t>(message_data.size()) ==
+			sizeof(uint32_t) + block_count * (3 * sizeof(int16_t) + sizeof(uint64_t))
+	);
+
+	// Answer about every block, so the server can forget which ones it offered
+	static thread_local StdVector<uint8_t> tls_answer_data;
+	StdVector<uint8_t> &answer_data = tls_answer_data;
+	answer_data.clear();
+	MemoryWriter mw(answer_data, ENDIANNESS_LITTLE_ENDIAN);
+	mw.store_32(block_count);
+
+	unsigned int cached_count = 0;
+
+	for (unsigned int i = 0; i < block_count; ++i) {
+		Vector3i bpos;
+		bpos.x = int16_t(mr.get_16());
+		bpos.y = int16_t(mr.get_16());
+		bpos.z = int16_t(mr.get_16());
+		const uint64_t hash = mr.get_64();
+
+		const bool needed = !try_load_cached_block(bpos, hash);
+		if (!needed) {
+			++cached_count;
+		}
+
+		mw.store_16(bpos.x);
+		mw.store_16(bpos.y);
+		mw.store_16(bpos.z);
+		mw.store_8(needed ? 1 : 0);
+	}
+
+	ZN_PRINT_VERBOSE(format("Loaded {} blocks out of {} from cache", cached_count, block_count));
+
+	PackedByteArray pba;
+	copy_to(pba, to_span(answer_data));
+	rpc_id(MultiplayerPeer::TARGET_PEER_SERVER, VoxelStringNames::get_singleton()._rpc_request_blocks, pba);
+}
+
+void VoxelTerrainMultiplayerSynchronizer::_b_request_blocks(PackedByteArray message_data) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(_terrain != nullptr);
+	// Clients are not trusted, anyone can call this
+	ZN_ASSERT_RETURN(is_server());
+
+	const int peer_id = get_multiplayer()->get_remote_sender_id();
+	auto queue_it = _peer_queues.find(peer_id);
+	if (queue_it == _peer_queues.end()) {
+		return;
+	}
+	PeerQueue &queue = queue_it->second;
+
+	MemoryReader mr(Span<const uint8_t>(message_data.ptr(), message_data.size()), ENDIANNESS_LITTLE_ENDIAN);
+
+	ZN_ASSERT_RETURN(static_cast<size_t>(message_data.size()) >= sizeof(uint32_t));
+	const unsigned int block_count = mr.get_32();
+	ZN_ASSERT_RETURN(
+			static_cast<size_t>(message_data.size()) ==
+			sizeof(uint32_t) + block_count * (3 * sizeof(int16_t) + sizeof(uint8_t))
+	);
+
+	for (unsigned int i = 0; i < block_count; ++i) {
+		Vector3i bpos;
+		bpos.x = int16_t(mr.get_16());
+		bpos.y = int16_t(mr.get_16());
+		bpos.z = int16_t(mr.get_16());
+		const bool needed = mr.get_8() != 0;
+
+		// Only blocks that were offered can be requested
+		if (queue.offered_blocks.erase(bpos) == 0) {
+			continue;
+		}
+		if (needed) {
+			queue.block_positions.push_back(bpos);
+		}
 	}
 }
 
@@ -286,6 +694,54 @@ void VoxelTerrainMultiplayerSynchronizer::_bind_methods() {
 			D_METHOD("_rpc_receive_blocks", "data"), &VoxelTerrainMultiplayerSynchronizer::_b_receive_blocks
 	);
 	ClassDB::bind_method(D_METHOD("_rpc_receive_area", "data"), &VoxelTerrainMultiplayerSynchronizer::_b_receive_area);
+	ClassDB::bind_method(
+			D_METHOD("_rpc_receive_block_hashes", "data"),
+			&VoxelTerrainMultiplayerSynchronizer::_b_receive_block_hashes
+	);
+	ClassDB::bind_method(
+			D_METHOD("_rpc_request_blocks", "data"), &VoxelTerrainMultiplayerSynchronizer::_b_request_blocks
+	);
+
+	ClassDB::bind_method(
+			D_METHOD("set_max_bytes_per_second_per_peer", "bps"),
+			&VoxelTerrainMultiplayerSynchronizer::set_max_bytes_per_second_per_peer
+	);
+	ClassDB::bind_method(
+			D_METHOD("get_max_bytes_per_second_per_peer"),
+			&VoxelTerrainMultiplayerSynchronizer::get_max_bytes_per_second_per_peer
+	);
+
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::INT, "max_bytes_per_second_per_peer", PROPERTY_HINT_RANGE, "0,100000000,1,or_greater"
+			),
+			"set_max_bytes_per_second_per_peer",
+			"get_max_bytes_per_second_per_peer"
+	);
+
+	ClassDB::bind_method(
+			D_METHOD("set_block_hashes_enabled", "enabled"),
+			&VoxelTerrainMultiplayerSynchronizer::set_block_hashes_enabled
+	);
+	ClassDB::bind_method(
+			D_METHOD("is_block_hashes_enabled"), &VoxelTerrainMultiplayerSynchronizer::is_block_hashes_enabled
+	);
+
+	ClassDB::bind_method(
+			D_METHOD("set_cache_stream", "stream"), &VoxelTerrainMultiplayerSynchronizer::set_cache_stream
+	);
+	ClassDB::bind_method(D_METHOD("get_cache_stream"), &VoxelTerrainMultiplayerSynchronizer::get_cache_stream);
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "block_hashes_enabled"), "set_block_hashes_enabled", "is_block_hashes_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::OBJECT, "cache_stream", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()
+			),
+			"set_cache_stream",
+			"get_cache_stream"
+	);
 }
 
 } // namespace zylann::voxel
@@ -2,7 +2,9 @@
 #define VOXEL_NETWORK_TERRAIN_SYNC_H
 
 #include "../../storage/voxel_data_block.h"
+#include "../../streams/voxel_stream.h"
 #include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_unordered_set.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/node.h"
 #include "../../util/math/box3i.h"
@@ -26,6 +28,20 @@ public:
 	void send_block(int viewer_peer_id, const VoxelDataBlock &data_block, Vector3i bpos);
 	void send_area(Box3i voxel_box);
 
+	// Limits how much voxel data is sent to each peer. Blocks closest to viewers of the peer are sent first.
+	// 0 means no limit.
+	void set_max_bytes_per_second_per_peer(int bps);
+	int get_max_bytes_per_second_per_peer() const;
+
+	// Server: sends hashes of blocks first, and only sends blocks clients don't already have in their cache.
+	void set_block_hashes_enabled(bool enabled);
+	bool is_block_hashes_enabled() const;
+
+	// Client: stream where received blocks are saved, so they don't have to be sent again next time the client
+	// joins the same server, if the server sends block hashes.
+	void set_cache_stream(Ref<VoxelStream> stream);
+	Ref<VoxelStream> get_cache_stream() const;
+
 #ifdef TOOLS_ENABLED
 #if defined(ZN_GODOT)
 	PackedStringArray get_configuration_warnings() const override;
@@ -39,20 +55,41 @@ private:
 	void _notification(int p_what);
 
 	void process();
+	void process_peer(int peer_id, float delta);
 
 	void _b_receive_blocks(PackedByteArray message_data);
 	void _b_receive_area(PackedByteArray message_data);
+	void _b_receive_block_hashes(PackedByteArray message_data);
+	void _b_request_blocks(PackedByteArray message_data);
+
+	bool try_load_cached_block(Vector3i bpos, uint64_t hash);
 
 	static void _bind_methods();
 
 	VoxelTerrain *_terrain = nullptr;
 	int _rpc_channel = 0;
 
-	struct DeferredBlockMessage {
-		PackedByteArray data;
+	int _max_bytes_per_second_per_peer = 0;
+	bool _block_hashes_enabled = false;
+	Ref<VoxelStream> _cache_stream;
+
+	struct PeerQueue {
+		// Blocks are serialized only when sent, so they contain the latest edits and can be sent in any order
+		StdVector<Vector3i> block_positions;
+		// Blocks to send the hash of, before sending them if the peer requests them
+		StdVector<Vector3i> hash_positions;
+		// Blocks whose hash was sent, and for which the peer didn't tell yet if it needs them
+		StdUnorderedSet<Vector3i> offered_blocks;
+		// Serialized edited areas, sent in order
+		StdVector<PackedByteArray> areas;
+		// Bytes that can be sent before exceeding the rate limit
+		float budget = 0.f;
 	};
 
-	StdUnorderedMap<int, StdVector<DeferredBlockMessage>> _deferred_block_messages_per_peer;
+	void send_blocks(int peer_id, PeerQueue &queue, Span<const Vector3> viewer_positions);
+	void send_block_hashes(int peer_id, PeerQueue &queue, Span<const Vector3> viewer_positions);
+
+	StdUnorderedMap<int, PeerQueue> _peer_queues;
 };
 
 } // namespace zylann::voxel
@@ -3,6 +3,7 @@
 
 #include "../engine/voxel_engine.h"
 #include "../util/godot/direct_mesh_instance.h"
+#include "../util/godot/direct_mesh_instance_pool.h"
 #include "../util/profiling.h"
 #include "../util/tasks/progressive_task_runner.h"
 
@@ -24,6 +25,21 @@ public:
 		mi.destroy();
 	}
 
+	// Same as `try_add_and_destroy`, but puts the instance back in a pool instead of freeing it.
+	static inline void try_add_and_recycle(
+			zylann::godot::DirectMeshInstance &mi,
+			zylann::godot::DirectMeshInstancePool &pool
+	) {
+		if (!mi.is_valid()) {
+			return;
+		}
+		const Mesh *mesh = mi.get_mesh_ptr();
+		if (mesh != nullptr && mesh->get_reference_count() == 1) {
+			add(mi.get_mesh());
+		}
+		pool.recycle(mi);
+	}
+
 	void run() override {
 		ZN_PROFILE_SCOPE();
 		if (_mesh->get_reference_count() > 1) {
@@ -0,0 +1,170 @@
+#include "generate_instances_block_gpu_task.h"
+#include "../../engine/gpu/compute_resource_cache.h"
+#include "../../engine/gpu/compute_shader.h"
+#include "../../engine/gpu/compute_shader_parameters.h"
+#include "../../engine/voxel_engine.h"
+#include "../../util/dstack.h"
+#include "../../util/math/funcs.h"
+#include "../../util/math/vector4f.h"
+#include "../../util/profiling.h"
+#include "generate_instances_block_task.h"
+
+#include "../../util/godot/classes/rd_uniform.h"
+#include "../../util/godot/classes/rendering_device.h"
+
+using namespace zylann::godot;
+
+namespace zylann::voxel {
+
+namespace {
+
+// Must match the shader
+const unsigned int SCATTER_GROUP_SIZE = 64;
+const unsigned int TRANSFORM_FLOAT_COUNT = 12;
+
+void copy_as_vec4(PackedByteArray &dst, const PackedVector3Array &src) {
+	dst.resize(src.size() * sizeof(Vector4f));
+	Span<Vector4f> dst_v = Span<uint8_t>(dst.ptrw(), dst.size()).reinterpret_cast_to<Vector4f>();
+	Span<const Vector3> src_v = to_span(src);
+	for (unsigned int i = 0; i < src_v.size(); ++i) {
+		const Vector3 v = src_v[i];
+		dst_v[i] = Vector4f(v.x, v.y, v.z, 0.f);
+	}
+}
+
+Ref<RDUniform> make_storage_buffer_uniform(RID rid, int binding) {
+	Ref<RDUniform> uniform;
+	uniform.instantiate();
+	uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
+	uniform->add_id(rid);
+	uniform->set_binding(binding);
+	return uniform;
+}
+
+} // namespace
+
+GenerateInstancesBlockGPUTask::~GenerateInstancesBlockGPUTask() {
+	if (consumer_task != nullptr) {
+		// The engine got shut down before the task could complete, so we still have ownership on it
+		ZN_PRINT_VERBOSE("Freeing interrupted consumer task");
+		consumer_task->dispose();
+	}
+}
+
+unsigned int GenerateInstancesBlockGPUTask::get_output_size(unsigned int candidate_count) {
+	return candidate_count * (TRANSFORM_FLOAT_COUNT * sizeof(float) + sizeof(uint32_t));
+}
+
+unsigned int GenerateInstancesBlockGPUTask::get_required_shared_output_buffer_size() const {
+	return get_output_size(params.candidate_count);
+}
+
+void GenerateInstancesBlockGPUTask::prepare_cpu() {
+	ZN_PROFILE_SCOPE();
+
+	copy_as_vec4(_vertices_pba, vertices);
+	copy_as_vec4(_normals_pba, normals);
+
+	_cpu_prepared = true;
+}
+
+void GenerateInstancesBlockGPUTask::prepare(GPUTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+	ZN_DSTACK();
+
+	ERR_FAIL_COND(vertices.size() == 0);
+	ERR_FAIL_COND(normals.size() != vertices.size());
+	ERR_FAIL_COND(params.candidate_count <= 0);
+
+	ERR_FAIL_COND(shader == nullptr);
+	ERR_FAIL_COND(shader->shader == nullptr);
+	ERR_FAIL_COND(!shader->shader->is_valid());
+
+	ZN_ASSERT(consumer_task != nullptr);
+
+	if (!_cpu_prepared) {
+		prepare_cpu();
+	}
+
+	RenderingDevice &rd = ctx.rendering_device;
+	GPUStorageBufferPool &storage_buffer_pool = ctx.storage_buffer_pool;
+
+	params.dst_offset = ctx.shared_output_buffer_begin / sizeof(uint32_t);
+
+	PackedByteArray params_pba;
+	copy_bytes_to(params_pba, params);
+
+	_params_sb = storage_buffer_pool.allocate(params_pba);
+	ERR_FAIL_COND(_params_sb.is_null());
+
+	_vertices_sb = storage_buffer_pool.allocate(_vertices_pba);
+	ERR_FAIL_COND(_vertices_sb.is_null());
+
+	_normals_sb = storage_buffer_pool.allocate(_normals_pba);
+	ERR_FAIL_COND(_normals_sb.is_null());
+
+	// Emitting from vertices doesn't use indices, but the binding still needs a buffer
+	if (indices.size() > 0) {
+		PackedByteArray indices_pba;
+		copy_bytes_to<int32_t>(indices_pba, to_span(indices));
+		_indices_sb = storage_buffer_pool.allocate(indices_pba);
+	} else {
+		_indices_sb = storage_buffer_pool.allocate(sizeof(int32_t));
+	}
+	ERR_FAIL_COND(_indices_sb.is_null());
+
+	Array uniforms;
+	uniforms.resize(5);
+	uniforms[0] = make_storage_buffer_uniform(_params_sb.rid, 0);
+	uniforms[1] = make_storage_buffer_uniform(_vertices_sb.rid, 1);
+	uniforms[2] = make_storage_buffer_uniform(_normals_sb.rid, 2);
+	uniforms[3] = make_storage_buffer_uniform(_indices_sb.rid, 3);
+	// Results are written directly into the buffer that will be downloaded
+	uniforms[4] = make_storage_buffer_uniform(ctx.shared_output_buffer_rid, 4);
+
+	// Resources of the noise graph
+	if (shader->params != nullptr && shader->params->params.size() > 0) {
+		add_uniform_params(shader->params->params, uniforms);
+	}
+
+	ComputeResourceCache &resource_cache = ctx.compute_resource_cache;
+
+	const RID shader_rid = shader->shader->get_rid();
+	const RID pipeline_rid = resource_cache.get_or_create_compute_pipeline(shader_rid);
+	ERR_FAIL_COND(!pipeline_rid.is_valid());
+
+	const RID uniform_set_rid = resource_cache.get_or_create_uniform_set(uniforms, shader_rid, 0);
+	ERR_FAIL_COND(!uniform_set_rid.is_valid());
+
+	const int compute_list_id = rd.compute_list_begin();
+	rd.compute_list_bind_compute_pipeline(compute_list_id, pipeline_rid);
+	rd.compute_list_bind_uniform_set(compute_list_id, uniform_set_rid, 0);
+	// The last group might not be full, the shader skips invocations beyond the candidate count
+	const unsigned int group_count =
+			math::ceildiv(static_cast<unsigned int>(params.candidate_count), SCATTER_GROUP_SIZE);
+	rd.compute_list_dispatch(compute_list_id, group_count, 1, 1);
+	rd.compute_list_end();
+}
+
+void GenerateInstancesBlockGPUTask::collect(GPUTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+	ZN_DSTACK();
+
+	GPUStorageBufferPool &storage_buffer_pool = ctx.storage_buffer_pool;
+	storage_buffer_pool.recycle(_params_sb);
+	storage_buffer_pool.recycle(_vertices_sb);
+	storage_buffer_pool.recycle(_normals_sb);
+	storage_buffer_pool.recycle(_indices_sb);
+
+	// Filtering out invalid candidates is left to the CPU task, because the GPU thread only exists for waiting
+	// blocking functions, not doing work
+	consumer_task->set_gpu_results(
+			ctx.downloaded_shared_output_data, ctx.shared_output_buffer_begin, params.candidate_count
+	);
+
+	// Resume the task, pass ownership back to the task runner.
+	VoxelEngine::get_singleton().push_async_task(consumer_task);
+	consumer_task = nullptr;
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,55 @@
+#ifndef ZN_VOXEL_GENERATE_INSTANCES_BLOCK_GPU_TASK_H
+#define ZN_VOXEL_GENERATE_INSTANCES_BLOCK_GPU_TASK_H
+
+#include "../../engine/gpu/gpu_storage_buffer_pool.h"
+#include "../../engine/gpu/gpu_task_runner.h"
+#include "../../util/godot/core/packed_arrays.h"
+#include "voxel_instance_generator.h"
+
+#include <memory>
+
+namespace zylann::voxel {
+
+class GenerateInstancesBlockTask;
+
+// Places instances on a mesh block with a compute shader. Must be scheduled from a `GenerateInstancesBlockTask`,
+// which will be resumed when this one finishes.
+class GenerateInstancesBlockGPUTask : public IGPUTask {
+public:
+	~GenerateInstancesBlockGPUTask();
+
+	PackedVector3Array vertices;
+	PackedVector3Array normals;
+	PackedInt32Array indices;
+
+	VoxelInstanceGenerator::GPUParams params;
+	std::shared_ptr<VoxelInstanceGenerator::GPUShader> shader;
+
+	// Task for which the instances are for.
+	GenerateInstancesBlockTask *consumer_task = nullptr;
+
+	// Size in bytes of the results of a given amount of candidates: one transform per candidate, followed by one flag
+	// per candidate telling if the transform is valid
+	static unsigned int get_output_size(unsigned int candidate_count);
+
+	unsigned int get_required_shared_output_buffer_size() const override;
+
+	void prepare_cpu() override;
+	void prepare(GPUTaskContext &ctx) override;
+	void collect(GPUTaskContext &ctx) override;
+
+private:
+	// Using 4-component vectors to match alignment rules
+	PackedByteArray _vertices_pba;
+	PackedByteArray _normals_pba;
+	bool _cpu_prepared = false;
+
+	GPUStorageBuffer _params_sb;
+	GPUStorageBuffer _vertices_sb;
+	GPUStorageBuffer _normals_sb;
+	GPUStorageBuffer _indices_sb;
+};
+
+} // namespace zylann::voxel
+
+#endif // ZN_VOXEL_GENERATE_INSTANCES_BLOCK_GPU_TASK_H
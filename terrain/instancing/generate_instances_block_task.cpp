@@ -1,38 +1,66 @@
 #include "generate_instances_block_task.h"
+#include "../../engine/voxel_engine.h"
 #include "../../util/godot/classes/array_mesh.h"
+#include "../../util/godot/core/packed_arrays.h"
+#include "../../util/godot/direct_multimesh_instance.h"
 #include "../../util/profiling.h"
+#include "generate_instances_block_gpu_task.h"
 
 namespace zylann::voxel {
 
+namespace {
+
+// Floats per transform in results of the compute shader, which uses the same layout as multimesh buffers
+const unsigned int GPU_TRANSFORM_FLOAT_COUNT = 12;
+
+} // namespace
+
 void GenerateInstancesBlockTask::run(ThreadedTaskContext &ctx) {
 	ZN_PROFILE_SCOPE();
 	ZN_ASSERT_RETURN(generator.is_valid());
 	ZN_ASSERT(output_queue != nullptr);
 
-	PackedVector3Array vertices = surface_arrays[ArrayMesh::ARRAY_VERTEX];
-	ZN_ASSERT_RETURN(vertices.size() > 0);
+	PackedFloat32Array multimesh_buffer;
 
-	PackedVector3Array normals = surface_arrays[ArrayMesh::ARRAY_NORMAL];
-	ZN_ASSERT_RETURN(normals.size() > 0);
+	if (_stage == 0) {
+		PackedVector3Array vertices = surface_arrays[ArrayMesh::ARRAY_VERTEX];
+		ZN_ASSERT_RETURN(vertices.size() > 0);
 
-	static thread_local StdVector<Transform3f> tls_generated_transforms;
-	tls_generated_transforms.clear();
+		PackedVector3Array normals = surface_arrays[ArrayMesh::ARRAY_NORMAL];
+		ZN_ASSERT_RETURN(normals.size() > 0);
 
-	const uint8_t gen_octant_mask = ~edited_mask;
+		if (try_start_gpu_task(ctx)) {
+			return;
+		}
 
-	generator->generate_transforms(
-			tls_generated_transforms,
-			mesh_block_grid_position,
-			lod_index,
-			layer_id,
-			surface_arrays,
-			up_mode,
-			gen_octant_mask,
-			mesh_block_size
-	);
+		static thread_local StdVector<Transform3f> tls_generated_transforms;
+		tls_generated_transforms.clear();
 
-	for (const Transform3f &t : tls_generated_transforms) {
-		transforms.push_back(t);
+		const uint8_t gen_octant_mask = ~edited_mask;
+
+		generator->generate_transforms(
+				tls_generated_transforms,
+				mesh_block_grid_position,
+				lod_index,
+				layer_id,
+				surface_arrays,
+				up_mode,
+				gen_octant_mask,
+				mesh_block_size
+		);
+
+		for (const Transform3f &t : tls_generated_transforms) {
+			transforms.push_back(t);
+		}
+
+		if (pack_multimesh_buffer && transforms.size() > 0) {
+			zylann::godot::DirectMultiMeshInstance::make_transform_3d_bulk_array(
+					to_span_const(transforms), multimesh_buffer
+			);
+		}
+
+	} else {
+		collect_gpu_results(multimesh_buffer);
 	}
 
 	{
@@ -43,7 +71,122 @@ void GenerateInstancesBlockTask::run(ThreadedTaskContext &ctx) {
 		o.edited_mask = edited_mask;
 		o.render_block_position = mesh_block_grid_position;
 		o.transforms = std::move(transforms);
+		o.multimesh_buffer = multimesh_buffer;
+	}
+}
+
+bool GenerateInstancesBlockTask::try_start_gpu_task(ThreadedTaskContext &ctx) {
+	std::shared_ptr<VoxelInstanceGenerator::GPUShader> shader = generator->get_gpu_shader();
+	if (shader == nullptr) {
+		return false;
+	}
+
+	PackedInt32Array indices = surface_arrays[ArrayMesh::ARRAY_INDEX];
+	if (indices.size() < 3) {
+		return false;
+	}
+	PackedVector3Array vertices = surface_arrays[ArrayMesh::ARRAY_VERTEX];
+
+	VoxelInstanceGenerator::GPUParams params;
+	if (!generator->get_gpu_params(
+				params,
+				mesh_block_grid_position,
+				lod_index,
+				layer_id,
+				up_mode,
+				~edited_mask,
+				mesh_block_size,
+				vertices.size(),
+				indices.size() / 3
+		)) {
+		// Nothing to generate, but edited transforms still have to be output
+		return false;
 	}
+
+	GenerateInstancesBlockGPUTask *gpu_task = ZN_NEW(GenerateInstancesBlockGPUTask);
+	gpu_task->vertices = vertices;
+	gpu_task->normals = surface_arrays[ArrayMesh::ARRAY_NORMAL];
+	gpu_task->indices = indices;
+	gpu_task->params = params;
+	gpu_task->shader = shader;
+	gpu_task->consumer_task = this;
+
+	ctx.status = ThreadedTaskContext::STATUS_TAKEN_OUT;
+
+	// Start GPU task, we'll continue after it
+	VoxelEngine::get_singleton().push_gpu_task(gpu_task);
+	return true;
+}
+
+void GenerateInstancesBlockTask::set_gpu_results(
+		PackedByteArray bytes,
+		unsigned int begin,
+		unsigned int candidate_count
+) {
+	_gpu_results = bytes;
+	_gpu_results_begin = begin;
+	_gpu_candidate_count = candidate_count;
+	_stage = 1;
+}
+
+void GenerateInstancesBlockTask::collect_gpu_results(PackedFloat32Array &multimesh_buffer) {
+	ZN_PROFILE_SCOPE();
+
+	const unsigned int transforms_size = _gpu_candidate_count * GPU_TRANSFORM_FLOAT_COUNT * sizeof(float);
+	const unsigned int results_size = GenerateInstancesBlockGPUTask::get_output_size(_gpu_candidate_count);
+	ZN_ASSERT_RETURN(_gpu_results_begin + results_size <= static_cast<unsigned int>(_gpu_results.size()));
+
+	const Span<const uint8_t> results = zylann::godot::to_span(_gpu_results).sub(_gpu_results_begin, results_size);
+	const Span<const float> gpu_transforms = results.sub(0, transforms_size).reinterpret_cast_to<const float>();
+	const Span<const uint32_t> valid_flags = results.sub(transforms_size).reinterpret_cast_to<const uint32_t>();
+
+	unsigned int valid_count = 0;
+	for (const uint32_t flag : valid_flags) {
+		if (flag != 0) {
+			++valid_count;
+		}
+	}
+
+	// Edited transforms come first
+	const unsigned int edited_count = transforms.size();
+	const unsigned int total_count = edited_count + valid_count;
+
+	float *multimesh_w = nullptr;
+	if (pack_multimesh_buffer && total_count > 0) {
+		if (edited_count > 0) {
+			zylann::godot::DirectMultiMeshInstance::make_transform_3d_bulk_array(
+					to_span_const(transforms), multimesh_buffer
+			);
+		}
+		multimesh_buffer.resize(total_count * GPU_TRANSFORM_FLOAT_COUNT);
+		multimesh_w = multimesh_buffer.ptrw() + edited_count * GPU_TRANSFORM_FLOAT_COUNT;
+	}
+
+	transforms.reserve(total_count);
+
+	for (unsigned int i = 0; i < valid_flags.size(); ++i) {
+		if (valid_flags[i] == 0) {
+			continue;
+		}
+		const float *src = gpu_transforms.data() + i * GPU_TRANSFORM_FLOAT_COUNT;
+
+		// Already in the layout of multimesh buffers
+		if (multimesh_w != nullptr) {
+			memcpy(multimesh_w, src, GPU_TRANSFORM_FLOAT_COUNT * sizeof(float));
+			multimesh_w += GPU_TRANSFORM_FLOAT_COUNT;
+		}
+
+		// Transforms are still needed for collisions and scene instances
+		Transform3f t;
+		t.basis.rows[0] = Vector3f(src[0], src[1], src[2]);
+		t.basis.rows[1] = Vector3f(src[4], src[5], src[6]);
+		t.basis.rows[2] = Vector3f(src[8], src[9], src[10]);
+		t.origin = Vector3f(src[3], src[7], src[11]);
+		transforms.push_back(t);
+	}
+
+	// Release our reference to the shared buffer
+	_gpu_results = PackedByteArray();
 }
 
 } // namespace zylann::voxel
@@ -3,6 +3,7 @@
 
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/core/array.h"
+#include "../../util/godot/core/packed_arrays.h"
 #include "../../util/tasks/threaded_task.h"
 #include "instancer_task_output_queue.h"
 #include "up_mode.h"
@@ -26,6 +27,8 @@ public:
 	Ref<VoxelInstanceGenerator> generator;
 	// Can be pre-populated by edited transforms
 	StdVector<Transform3f> transforms;
+	// If true, transforms are also packed into a multimesh buffer
+	bool pack_multimesh_buffer = false;
 	std::shared_ptr<InstancerTaskOutputQueue> output_queue;
 
 	const char *get_debug_name() const override {
@@ -33,6 +36,19 @@ public:
 	}
 
 	void run(ThreadedTaskContext &ctx) override;
+
+	// Called when the GPU task is complete. `bytes` is the downloaded buffer shared with other GPU tasks, results of
+	// this task start at `begin`.
+	void set_gpu_results(PackedByteArray bytes, unsigned int begin, unsigned int candidate_count);
+
+private:
+	bool try_start_gpu_task(ThreadedTaskContext &ctx);
+	void collect_gpu_results(PackedFloat32Array &multimesh_buffer);
+
+	uint8_t _stage = 0;
+	PackedByteArray _gpu_results;
+	unsigned int _gpu_results_begin = 0;
+	unsigned int _gpu_candidate_count = 0;
 };
 
 } // namespace zylann::voxel
@@ -2,6 +2,7 @@
 #define VOXEL_INSTANCER_TASK_OUTPUT_QUEUE_H
 
 #include "../../util/containers/std_vector.h"
+#include "../../util/godot/core/packed_arrays.h"
 #include "../../util/math/transform3f.h"
 #include "../../util/math/vector3i.h"
 #include "../../util/thread/mutex.h"
@@ -16,6 +17,9 @@ struct InstanceLoadingTaskOutput {
 	// When data chunks are half the size of render chunks, this is 8 bits in XYZ order.
 	uint8_t edited_mask;
 	StdVector<Transform3f> transforms;
+	// If not empty, contains `transforms` already packed in the layout `RenderingServer::multimesh_set_buffer` expects,
+	// so the main thread doesn't have to do it
+	PackedFloat32Array multimesh_buffer;
 };
 
 struct InstancerTaskOutputQueue {
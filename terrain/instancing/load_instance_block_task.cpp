@@ -4,6 +4,7 @@
 #include "../../util/containers/container_funcs.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/array_mesh.h"
+#include "../../util/godot/direct_multimesh_instance.h"
 #include "../../util/math/box3i.h"
 #include "../../util/math/conv.h"
 #include "../../util/profiling.h"
@@ -12,6 +13,19 @@
 
 namespace zylann::voxel {
 
+namespace {
+
+bool is_multimesh_item(Span<const VoxelInstanceLibrary::PackedItem> items, int id) {
+	for (const VoxelInstanceLibrary::PackedItem &item : items) {
+		if (static_cast<int>(item.id) == id) {
+			return item.is_multimesh;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
 LoadInstanceChunkTask::LoadInstanceChunkTask( //
 		std::shared_ptr<InstancerTaskOutputQueue> output_queue, //
 		Ref<VoxelStream> stream, //
@@ -22,7 +36,8 @@ LoadInstanceChunkTask::LoadInstanceChunkTask( //
 		uint8_t lod_index, //
 		uint8_t instance_block_size, //
 		uint8_t data_block_size, //
-		UpMode up_mode //
+		UpMode up_mode, //
+		bool pack_multimesh_buffers //
 ) :
 		//
 		_output_queue(output_queue), //
@@ -34,7 +49,8 @@ LoadInstanceChunkTask::LoadInstanceChunkTask( //
 		_lod_index(lod_index), //
 		_instance_block_size(instance_block_size), //
 		_data_block_size(data_block_size), //
-		_up_mode(up_mode) //
+		_up_mode(up_mode), //
+		_pack_multimesh_buffers(pack_multimesh_buffers) //
 {
 #ifdef DEBUG_ENABLED
 	ZN_ASSERT(_output_queue != nullptr);
@@ -194,14 +210,16 @@ void LoadInstanceChunkTask::run(ThreadedTaskContext &ctx) {
 		}
 	}
 
+	// TODO Cache memory
+	StdVector<VoxelInstanceLibrary::PackedItem> items;
+	if (_library.is_valid()) {
+		_library->get_packed_items_at_lod(items, _lod_index);
+	}
+
 	// Generate the rest
-	if (_mesh_arrays.size() != 0 && _library.is_valid()) {
+	if (_mesh_arrays.size() != 0) {
 		ZN_PROFILE_SCOPE();
 
-		// TODO Cache memory
-		StdVector<VoxelInstanceLibrary::PackedItem> items;
-		_library->get_packed_items_at_lod(items, _lod_index);
-
 		if (items.size() > 0) {
 			BufferedTaskScheduler &task_scheduler = BufferedTaskScheduler::get_for_current_thread();
 
@@ -238,6 +256,7 @@ void LoadInstanceChunkTask::run(ThreadedTaskContext &ctx) {
 						task->surface_arrays = _mesh_arrays;
 						task->generator = item.generator;
 						task->transforms = std::move(layer.transforms);
+						task->pack_multimesh_buffer = _pack_multimesh_buffers && item.is_multimesh;
 						task->output_queue = _output_queue;
 
 						task_scheduler.push_main_task(task);
@@ -261,6 +280,11 @@ void LoadInstanceChunkTask::run(ThreadedTaskContext &ctx) {
 		o.edited_mask = layer.edited_mask;
 		o.render_block_position = _render_grid_position;
 		o.transforms = std::move(layer.transforms);
+		if (_pack_multimesh_buffers && o.transforms.size() > 0 && is_multimesh_item(to_span_const(items), layer.id)) {
+			zylann::godot::DirectMultiMeshInstance::make_transform_3d_bulk_array(
+					to_span_const(o.transforms), o.multimesh_buffer
+			);
+		}
 		{
 			MutexLock(_output_queue->mutex);
 			_output_queue->results.push_back(std::move(o));
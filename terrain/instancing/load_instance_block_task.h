@@ -28,7 +28,8 @@ public:
 			uint8_t lod_index, //
 			uint8_t instance_block_size, //
 			uint8_t data_block_size, //
-			UpMode up_mode //
+			UpMode up_mode, //
+			bool pack_multimesh_buffers //
 	);
 
 	const char *get_debug_name() const override {
@@ -48,6 +49,9 @@ private:
 	uint8_t _instance_block_size;
 	uint8_t _data_block_size;
 	UpMode _up_mode;
+	// If true, transforms of multimesh items are packed into multimesh buffers, which the main thread can upload
+	// directly
+	bool _pack_multimesh_buffers;
 };
 
 } // namespace zylann::voxel
@@ -1,13 +1,20 @@
 #include "voxel_instance_generator.h"
 #include "../../constants/voxel_string_names.h"
+#include "../../engine/gpu/compute_shader.h"
+#include "../../engine/gpu/compute_shader_parameters.h"
+#include "../../engine/voxel_engine.h"
+#include "../../generators/graph/voxel_graph_shader_generator.h"
+#include "../../shaders/shaders.h"
 #include "../../util/containers/container_funcs.h"
 #include "../../util/godot/classes/array_mesh.h"
 #include "../../util/godot/classes/engine.h"
 #include "../../util/godot/core/array.h"
 #include "../../util/godot/core/random_pcg.h"
+#include "../../util/hash_funcs.h"
 #include "../../util/math/conv.h"
 #include "../../util/math/triangle.h"
 #include "../../util/profiling.h"
+#include "../../util/string/format.h"
 
 namespace zylann::voxel {
 
@@ -18,9 +25,128 @@ const float MAX_DENSITY = 10.f;
 // We expose a slider going below max density as it should not often be needed, but we allow greater if really necessary
 const char *DENSITY_HINT_STRING = "0.0, 1.0, 0.01, or_greater";
 
+// Limits how many generated transforms are kept in cache, summed over all cached blocks
+const unsigned int MAX_CACHED_TRANSFORMS = 1 << 16;
+
+// Must match the compute shader
+const int32_t GPU_FLAG_RANDOM_VERTICAL_FLIP = 1;
+const int32_t GPU_FLAG_RANDOM_ROTATION = 2;
+const int32_t GPU_FLAG_NOISE = 4;
+const int32_t GPU_FLAG_SLOPE_FILTER = 8;
+const int32_t GPU_FLAG_HEIGHT_FILTER = 16;
+// Bindings before this one are used by the compute shader template
+const unsigned int GPU_NOISE_BINDINGS_START = 5;
+
+template <typename TPackedArray>
+uint32_t hash_packed_array(const TPackedArray &array, uint32_t seed) {
+	static_assert(sizeof(array[0]) % sizeof(uint32_t) == 0);
+	const uint32_t *words = reinterpret_cast<const uint32_t *>(array.ptr());
+	const size_t word_count = array.size() * (sizeof(array[0]) / sizeof(uint32_t));
+	uint32_t h = seed;
+	for (size_t i = 0; i < word_count; ++i) {
+		h = hash_murmur3_one_32(words[i], h);
+	}
+	return hash_fmix32(h);
+}
+
 } // namespace
 
 void VoxelInstanceGenerator::generate_transforms(
+		StdVector<Transform3f> &out_transforms,
+		Vector3i grid_position,
+		int lod_index,
+		int layer_id,
+		Array surface_arrays,
+		UpMode up_mode,
+		uint8_t octant_mask,
+		float block_size
+) {
+	ZN_PROFILE_SCOPE();
+
+	if (surface_arrays.size() <= ArrayMesh::ARRAY_INDEX) {
+		generate_transforms_uncached(
+				out_transforms, grid_position, lod_index, layer_id, surface_arrays, up_mode, octant_mask, block_size
+		);
+		return;
+	}
+
+	// Blocks often get meshed again with the same surface, for example when they get unloaded and loaded back as
+	// viewers move around, or when LOD changes back and forth. Generating instances can be expensive so results are
+	// cached, identified by their inputs.
+	CacheKey key;
+	{
+		ZN_PROFILE_SCOPE_NAMED("Hash surface");
+		const PackedVector3Array vertices = surface_arrays[ArrayMesh::ARRAY_VERTEX];
+		const PackedVector3Array normals = surface_arrays[ArrayMesh::ARRAY_NORMAL];
+		const PackedInt32Array indices = surface_arrays[ArrayMesh::ARRAY_INDEX];
+		uint32_t h = hash_packed_array(vertices, HASH_MURMUR3_SEED);
+		h = hash_packed_array(normals, h);
+		h = hash_packed_array(indices, h);
+		key.surface_hash = h;
+		key.vertex_count = vertices.size();
+	}
+	key.grid_position = grid_position;
+	key.lod_index = lod_index;
+	key.layer_id = layer_id;
+	key.up_mode = up_mode;
+	key.octant_mask = octant_mask;
+	key.block_size = block_size;
+
+	uint32_t settings_version;
+	{
+		MutexLock mlock(_cache_mutex);
+		for (const CachedTransforms &cached : _cache) {
+			if (cached.key == key) {
+				out_transforms = cached.transforms;
+				return;
+			}
+		}
+		settings_version = _settings_version;
+	}
+
+	generate_transforms_uncached(
+			out_transforms, grid_position, lod_index, layer_id, surface_arrays, up_mode, octant_mask, block_size
+	);
+
+	if (out_transforms.size() > MAX_CACHED_TRANSFORMS) {
+		return;
+	}
+
+	MutexLock mlock(_cache_mutex);
+
+	if (settings_version != _settings_version) {
+		// Settings changed while we were generating, the result is already outdated
+		return;
+	}
+
+	// Evict oldest results first
+	unsigned int remove_count = 0;
+	while (remove_count < _cache.size() &&
+		   _cached_transform_count + out_transforms.size() > MAX_CACHED_TRANSFORMS) {
+		_cached_transform_count -= _cache[remove_count].transforms.size();
+		++remove_count;
+	}
+	if (remove_count > 0) {
+		_cache.erase(_cache.begin(), _cache.begin() + remove_count);
+	}
+
+	_cache.push_back(CachedTransforms{ key, out_transforms });
+	_cached_transform_count += out_transforms.size();
+}
+
+void VoxelInstanceGenerator::clear_cache() {
+	MutexLock mlock(_cache_mutex);
+	_cache.clear();
+	_cached_transform_count = 0;
+	++_settings_version;
+}
+
+void VoxelInstanceGenerator::notify_settings_changed() {
+	clear_cache();
+	emit_changed();
+}
+
+void VoxelInstanceGenerator::generate_transforms_uncached(
 		StdVector<Transform3f> &out_transforms,
 		Vector3i grid_position,
 		// TODO `lod_index` has become unused, remove?
@@ -655,7 +781,7 @@ void VoxelInstanceGenerator::set_density(float density) {
 		return;
 	}
 	_density = density;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_density() const {
@@ -668,7 +794,7 @@ void VoxelInstanceGenerator::set_emit_mode(EmitMode mode) {
 		return;
 	}
 	_emit_mode = mode;
-	emit_changed();
+	notify_settings_changed();
 	notify_property_list_changed();
 }
 
@@ -682,7 +808,7 @@ void VoxelInstanceGenerator::set_jitter(const float p_jitter) {
 		return;
 	}
 	_jitter = jitter;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_jitter() const {
@@ -695,7 +821,7 @@ void VoxelInstanceGenerator::set_triangle_area_threshold(const float p_threshold
 		return;
 	}
 	_triangle_area_threshold_lod0 = threshold;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_triangle_area_threshold() const {
@@ -707,7 +833,7 @@ void VoxelInstanceGenerator::set_min_scale(float min_scale) {
 		return;
 	}
 	_min_scale = min_scale;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_min_scale() const {
@@ -719,7 +845,7 @@ void VoxelInstanceGenerator::set_max_scale(float max_scale) {
 		return;
 	}
 	_max_scale = max_scale;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_max_scale() const {
@@ -732,7 +858,7 @@ void VoxelInstanceGenerator::set_scale_distribution(Distribution distribution) {
 		return;
 	}
 	_scale_distribution = distribution;
-	emit_changed();
+	notify_settings_changed();
 }
 
 VoxelInstanceGenerator::Distribution VoxelInstanceGenerator::get_scale_distribution() const {
@@ -745,7 +871,7 @@ void VoxelInstanceGenerator::set_vertical_alignment(float amount) {
 		return;
 	}
 	_vertical_alignment = amount;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_vertical_alignment() const {
@@ -757,7 +883,7 @@ void VoxelInstanceGenerator::set_offset_along_normal(float offset) {
 		return;
 	}
 	_offset_along_normal = offset;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_offset_along_normal() const {
@@ -771,7 +897,7 @@ void VoxelInstanceGenerator::set_min_slope_degrees(float degrees) {
 		return;
 	}
 	_max_surface_normal_y = max_surface_normal_y;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_min_slope_degrees() const {
@@ -785,7 +911,7 @@ void VoxelInstanceGenerator::set_max_slope_degrees(float degrees) {
 		return;
 	}
 	_min_surface_normal_y = min_surface_normal_y;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_max_slope_degrees() const {
@@ -797,7 +923,7 @@ void VoxelInstanceGenerator::set_min_height(float h) {
 		return;
 	}
 	_min_height = h;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_min_height() const {
@@ -809,7 +935,7 @@ void VoxelInstanceGenerator::set_max_height(float h) {
 		return;
 	}
 	_max_height = h;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_max_height() const {
@@ -821,7 +947,7 @@ void VoxelInstanceGenerator::set_random_vertical_flip(bool flip_enabled) {
 		return;
 	}
 	_random_vertical_flip = flip_enabled;
-	emit_changed();
+	notify_settings_changed();
 }
 
 bool VoxelInstanceGenerator::get_random_vertical_flip() const {
@@ -831,7 +957,7 @@ bool VoxelInstanceGenerator::get_random_vertical_flip() const {
 void VoxelInstanceGenerator::set_random_rotation(bool enabled) {
 	if (enabled != _random_rotation) {
 		_random_rotation = enabled;
-		emit_changed();
+		notify_settings_changed();
 	}
 }
 
@@ -861,7 +987,7 @@ void VoxelInstanceGenerator::set_noise(Ref<Noise> noise) {
 		}
 	}
 	// Emit signal outside of the locked region to avoid eventual deadlocks if handlers want to access the property
-	emit_changed();
+	notify_settings_changed();
 	notify_property_list_changed();
 }
 
@@ -889,6 +1015,7 @@ void VoxelInstanceGenerator::set_noise_graph(Ref<pg::VoxelGraphFunction> func) {
 		}
 
 		_noise_graph = func;
+		invalidate_gpu_shader();
 
 		if (_noise_graph.is_valid()) {
 			// Compile on assignment because there isn't really a good place to do it...
@@ -905,7 +1032,7 @@ void VoxelInstanceGenerator::set_noise_graph(Ref<pg::VoxelGraphFunction> func) {
 		}
 	}
 	// Emit signal outside of the locked region to avoid eventual deadlocks if handlers want to access the property
-	emit_changed();
+	notify_settings_changed();
 	notify_property_list_changed();
 }
 
@@ -920,7 +1047,7 @@ void VoxelInstanceGenerator::set_noise_dimension(Dimension dim) {
 		return;
 	}
 	_noise_dimension = dim;
-	emit_changed();
+	notify_settings_changed();
 }
 
 VoxelInstanceGenerator::Dimension VoxelInstanceGenerator::get_noise_dimension() const {
@@ -933,19 +1060,212 @@ void VoxelInstanceGenerator::set_noise_on_scale(float amount) {
 		return;
 	}
 	_noise_on_scale = amount;
-	emit_changed();
+	notify_settings_changed();
 }
 
 float VoxelInstanceGenerator::get_noise_on_scale() const {
 	return _noise_on_scale;
 }
 
+void VoxelInstanceGenerator::set_gpu_enabled(bool enabled) {
+	if (enabled == _gpu_enabled) {
+		return;
+	}
+	_gpu_enabled = enabled;
+	notify_settings_changed();
+}
+
+bool VoxelInstanceGenerator::get_gpu_enabled() const {
+	return _gpu_enabled;
+}
+
+namespace {
+
+std::shared_ptr<VoxelInstanceGenerator::GPUShader> compile_gpu_shader(const pg::VoxelGraphFunction *noise_graph) {
+	ZN_PROFILE_SCOPE();
+
+	std::shared_ptr<VoxelInstanceGenerator::GPUShader> gpu_shader =
+			make_shared_instance<VoxelInstanceGenerator::GPUShader>();
+	gpu_shader->params = make_shared_instance<ComputeShaderParameters>();
+
+	String source_text = g_instance_scatter_shader_template_0;
+
+	if (noise_graph != nullptr) {
+		StdString code_utf8;
+		StdVector<pg::ShaderParameter> params;
+		StdVector<pg::ShaderOutput> outputs;
+		const pg::CompilationResult result = pg::generate_shader(
+				noise_graph->get_graph(),
+				noise_graph->get_input_definitions(),
+				code_utf8,
+				params,
+				outputs,
+				Span<const pg::VoxelGraphFunction::NodeTypeID>()
+		);
+
+		if (!result.success || outputs.size() != 1) {
+			ZN_PRINT_WARNING(format(
+					"Can't generate instances on the GPU, the noise graph can't be converted to a shader. {}",
+					result.message
+			));
+			gpu_shader->shader = ComputeShader::create_invalid();
+			return gpu_shader;
+		}
+
+		for (unsigned int i = 0; i < params.size(); ++i) {
+			pg::ShaderParameter &p = params[i];
+			const unsigned int binding = GPU_NOISE_BINDINGS_START + i;
+			ZN_ASSERT(p.resource.get_type() == ComputeShaderResource::TYPE_TEXTURE_2D);
+			source_text += String("layout (set = 0, binding = {0}) uniform sampler2D {1};\n")
+								   .format(varray(binding, String::utf8(p.name.c_str())));
+			std::shared_ptr<ComputeShaderResource> res = make_shared_instance<ComputeShaderResource>();
+			*res = std::move(p.resource);
+			gpu_shader->params->params.push_back(ComputeShaderParameter{ binding, res });
+		}
+
+		source_text += String::utf8(code_utf8.c_str());
+		source_text += "float get_noise(vec3 pos) {\n\tfloat n;\n\tgenerate(pos, n);\n\treturn n;\n}\n";
+
+	} else {
+		source_text += "float get_noise(vec3 pos) {\n\treturn 1.0;\n}\n";
+	}
+
+	source_text += g_instance_scatter_shader_template_1;
+
+	gpu_shader->shader = ComputeShader::create_from_glsl(source_text, "zylann.voxel.instance_scatter.gen");
+	return gpu_shader;
+}
+
+} // namespace
+
+std::shared_ptr<VoxelInstanceGenerator::GPUShader> VoxelInstanceGenerator::get_gpu_shader() {
+	if (!_gpu_enabled || !VoxelEngine::get_singleton().has_rendering_device()) {
+		return nullptr;
+	}
+	// Emitting from faces accumulates area over triangles one after the other, which doesn't map well to a compute
+	// shader
+	if (_emit_mode == EMIT_FROM_FACES) {
+		return nullptr;
+	}
+
+	Ref<pg::VoxelGraphFunction> noise_graph;
+	{
+		ShortLockScope slock(_ptr_settings_lock);
+		// Noise resources only run on the CPU
+		if (_noise.is_valid()) {
+			return nullptr;
+		}
+		noise_graph = _noise_graph;
+	}
+
+	MutexLock mlock(_gpu_shader_mutex);
+	if (_gpu_shader == nullptr) {
+		// Also done when compilation failed, so it doesn't get attempted again for every block
+		_gpu_shader = compile_gpu_shader(noise_graph.ptr());
+	}
+	if (!_gpu_shader->shader->is_valid()) {
+		return nullptr;
+	}
+	return _gpu_shader;
+}
+
+void VoxelInstanceGenerator::invalidate_gpu_shader() {
+	MutexLock mlock(_gpu_shader_mutex);
+	_gpu_shader.reset();
+}
+
+bool VoxelInstanceGenerator::get_gpu_params(
+		GPUParams &out_params,
+		Vector3i grid_position,
+		int lod_index,
+		int layer_id,
+		UpMode up_mode,
+		uint8_t octant_mask,
+		float block_size,
+		unsigned int vertex_count,
+		unsigned int triangle_count
+) const {
+	if (_density <= 0.f || vertex_count == 0) {
+		return false;
+	}
+
+	GPUParams &p = out_params;
+
+	switch (_emit_mode) {
+		case EMIT_FROM_VERTICES:
+			p.candidate_count = vertex_count;
+			break;
+		case EMIT_FROM_FACES_FAST:
+			p.candidate_count = static_cast<int32_t>(_density * triangle_count);
+			break;
+		case EMIT_ONE_PER_TRIANGLE:
+			p.candidate_count = triangle_count;
+			break;
+		default:
+			ZN_PRINT_ERROR("Emit mode not supported on the GPU");
+			return false;
+	}
+	if (p.candidate_count == 0) {
+		return false;
+	}
+
+	Ref<Noise> noise;
+	Ref<pg::VoxelGraphFunction> noise_graph;
+	{
+		ShortLockScope slock(_ptr_settings_lock);
+		noise = _noise;
+		noise_graph = _noise_graph;
+	}
+
+	p.block_origin = to_vec3f(grid_position * block_size);
+	p.block_size = block_size;
+	p.emit_mode = _emit_mode;
+	p.triangle_count = triangle_count;
+	p.seed = Vector3iHasher::hash(grid_position) + layer_id;
+	p.density = math::clamp(_density, 0.f, 1.f);
+	p.jitter = _jitter;
+	p.triangle_area_threshold = math::squared(1 << lod_index) * _triangle_area_threshold_lod0;
+	p.vertical_alignment = _vertical_alignment;
+	p.min_scale = _min_scale;
+	p.max_scale = _max_scale;
+	p.scale_distribution = _scale_distribution;
+	p.offset_along_normal = _offset_along_normal;
+	p.min_normal_y = _min_surface_normal_y;
+	p.max_normal_y = _max_surface_normal_y;
+	p.min_height = _min_height;
+	p.max_height = _max_height;
+	p.up_mode = up_mode;
+	p.octant_mask = octant_mask;
+	p.noise_on_scale = _noise_on_scale;
+	p.dst_offset = 0;
+
+	p.flags = 0;
+	if (_random_vertical_flip) {
+		p.flags |= GPU_FLAG_RANDOM_VERTICAL_FLIP;
+	}
+	if (_random_rotation) {
+		p.flags |= GPU_FLAG_RANDOM_ROTATION;
+	}
+	if (noise_graph.is_valid()) {
+		p.flags |= GPU_FLAG_NOISE;
+	}
+	if (_min_surface_normal_y != -1.f || _max_surface_normal_y != 1.f) {
+		p.flags |= GPU_FLAG_SLOPE_FILTER;
+	}
+	if (_min_height != std::numeric_limits<float>::min() || _max_height != std::numeric_limits<float>::max()) {
+		p.flags |= GPU_FLAG_HEIGHT_FILTER;
+	}
+
+	return true;
+}
+
 void VoxelInstanceGenerator::_on_noise_changed() {
-	emit_changed();
+	notify_settings_changed();
 }
 
 void VoxelInstanceGenerator::_on_noise_graph_changed() {
-	emit_changed();
+	invalidate_gpu_shader();
+	notify_settings_changed();
 }
 
 #ifdef TOOLS_ENABLED
@@ -1075,6 +1395,9 @@ void VoxelInstanceGenerator::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_noise_on_scale", "amount"), &Self::set_noise_on_scale);
 	ClassDB::bind_method(D_METHOD("get_noise_on_scale"), &Self::get_noise_on_scale);
 
+	ClassDB::bind_method(D_METHOD("set_gpu_enabled", "enabled"), &Self::set_gpu_enabled);
+	ClassDB::bind_method(D_METHOD("get_gpu_enabled"), &Self::get_gpu_enabled);
+
 	ADD_GROUP("Emission", "");
 
 	ADD_PROPERTY(
@@ -1176,6 +1499,10 @@ void VoxelInstanceGenerator::_bind_methods() {
 			"get_noise_on_scale"
 	);
 
+	ADD_GROUP("GPU", "");
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "gpu_enabled"), "set_gpu_enabled", "get_gpu_enabled");
+
 	BIND_ENUM_CONSTANT(EMIT_FROM_VERTICES);
 	BIND_ENUM_CONSTANT(EMIT_FROM_FACES_FAST);
 	BIND_ENUM_CONSTANT(EMIT_FROM_FACES);
@@ -7,13 +7,18 @@
 #include "../../util/godot/classes/noise.h"
 #include "../../util/math/transform3f.h"
 #include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
 #include "../../util/thread/short_lock.h"
 #include "up_mode.h"
 
 #include <limits>
+#include <memory>
 
 namespace zylann::voxel {
 
+class ComputeShader;
+struct ComputeShaderParameters;
+
 // TODO This may have to be moved to the meshing thread some day
 
 // Decides where to spawn instances on top of a voxel surface.
@@ -51,6 +56,7 @@ public:
 	// This API might change so for now it's not exposed to scripts.
 	// Using 32-bit float transforms because those transforms are chunked, so their origins never really need to hold
 	// large coordinates.
+	// Results of recent calls are cached, so calling this again with the same surface and parameters is cheap.
 	void generate_transforms(
 			StdVector<Transform3f> &out_transforms,
 			Vector3i grid_position,
@@ -124,6 +130,65 @@ public:
 	void set_noise_on_scale(float amount);
 	float get_noise_on_scale() const;
 
+	// GPU support
+	// Instances can be generated with a compute shader, giving similar results as on the CPU but not the same ones.
+
+	void set_gpu_enabled(bool enabled);
+	bool get_gpu_enabled() const;
+
+	struct GPUShader {
+		std::shared_ptr<ComputeShader> shader;
+		// Resources used by the noise graph, if any
+		std::shared_ptr<ComputeShaderParameters> params;
+	};
+
+	// Must match parameters of the compute shader
+	struct GPUParams {
+		// Position of the mesh block relative to the instancer
+		Vector3f block_origin;
+		float block_size;
+		int32_t emit_mode;
+		int32_t candidate_count;
+		int32_t triangle_count;
+		uint32_t seed;
+		float density;
+		float jitter;
+		float triangle_area_threshold;
+		float vertical_alignment;
+		float min_scale;
+		float max_scale;
+		int32_t scale_distribution;
+		float offset_along_normal;
+		float min_normal_y;
+		float max_normal_y;
+		float min_height;
+		float max_height;
+		int32_t up_mode;
+		int32_t octant_mask;
+		int32_t flags;
+		float noise_on_scale;
+		// Where results start in the output buffer, in 32-bit elements
+		int32_t dst_offset;
+	};
+
+	// Gets the compute shader generating instances, or null if current settings can't be used on the GPU, in which
+	// case `generate_transforms` should be used. The shader is compiled the first time it is needed. Thread-safe.
+	std::shared_ptr<GPUShader> get_gpu_shader();
+
+	// Fills parameters of the compute shader to generate instances on a mesh. Each candidate position is handled by a
+	// separate invocation. Returns false if there is nothing to generate.
+	bool get_gpu_params(
+			GPUParams &out_params,
+			Vector3i grid_position,
+			int lod_index,
+			int layer_id,
+			UpMode up_mode,
+			uint8_t octant_mask,
+			float block_size,
+			unsigned int vertex_count,
+			unsigned int triangle_count
+	) const;
+
 	static inline int get_octant_index(const Vector3f pos, float half_block_size) {
 		return get_octant_index(pos.x > half_block_size, pos.y > half_block_size, pos.z > half_block_size);
 	}
@@ -138,6 +203,21 @@ public:
 #endif
 
 private:
+	void clear_cache();
+	void invalidate_gpu_shader();
+	void generate_transforms_uncached(
+			StdVector<Transform3f> &out_transforms,
+			Vector3i grid_position,
+			int lod_index,
+			int layer_id,
+			Array surface_arrays,
+			UpMode up_mode,
+			uint8_t octant_mask,
+			float block_size
+	);
+
+	void notify_settings_changed();
+
 	void _on_noise_changed();
 	void _on_noise_graph_changed();
 
@@ -161,6 +241,7 @@ private:
 	Ref<Noise> _noise;
 	Dimension _noise_dimension = DIMENSION_3D;
 	float _noise_on_scale = 0.f;
+	bool _gpu_enabled = false;
 
 	// TODO Protect noise and noise graph members from multithreaded access
 
@@ -182,6 +263,40 @@ private:
 	// Used when accessing pointer settings, since this generator can be used in a thread while the editor thread can
 	// modify settings.
 	mutable ShortLock _ptr_settings_lock;
+
+	struct CacheKey {
+		Vector3i grid_position;
+		uint32_t surface_hash;
+		uint32_t vertex_count;
+		int lod_index;
+		int layer_id;
+		UpMode up_mode;
+		uint8_t octant_mask;
+		float block_size;
+
+		inline bool operator==(const CacheKey &other) const {
+			return surface_hash == other.surface_hash && grid_position == other.grid_position &&
+					vertex_count == other.vertex_count && lod_index == other.lod_index &&
+					layer_id == other.layer_id && up_mode == other.up_mode && octant_mask == other.octant_mask &&
+					block_size == other.block_size;
+		}
+	};
+
+	struct CachedTransforms {
+		CacheKey key;
+		StdVector<Transform3f> transforms;
+	};
+
+	// Recently generated results, oldest first
+	StdVector<CachedTransforms> _cache;
+	unsigned int _cached_transform_count = 0;
+	// Incremented when settings change, so results that were generating at that time don't get cached
+	uint32_t _settings_version = 0;
+	Mutex _cache_mutex;
+
+	// Compiled when first needed, and dropped when the noise graph changes
+	std::shared_ptr<GPUShader> _gpu_shader;
+	Mutex _gpu_shader_mutex;
 };
 
 } // namespace zylann::voxel
@@ -65,8 +65,11 @@ public:
 #endif
 
 	struct PackedItem {
+		// May be null if instances of the item are only placed manually
 		Ref<VoxelInstanceGenerator> generator;
 		unsigned int id;
+		// True if instances of the item are rendered with multimeshes
+		bool is_multimesh;
 	};
 
 	void get_packed_items_at_lod(StdVector<PackedItem> &out_items, unsigned int lod_index) const;
@@ -111,7 +114,7 @@ private:
 		std::atomic_bool needs_update = false;
 	};
 
-	// Packed representation of items for use in procedural generation tasks
+	// Packed representation of items for use in loading and procedural generation tasks
 	PackedItems _packed_items;
 
 #ifdef TOOLS_ENABLED
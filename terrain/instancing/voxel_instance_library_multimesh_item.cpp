@@ -504,6 +504,58 @@ void VoxelInstanceLibraryMultiMeshItem::set_hide_beyond_max_lod(bool enabled) {
 	_hide_beyond_max_lod = enabled;
 }
 
+void VoxelInstanceLibraryMultiMeshItem::set_impostor_mesh(Ref<Mesh> mesh) {
+	if (mesh == _impostor_mesh) {
+		return;
+	}
+	_impostor_mesh = mesh;
+	notify_listeners(IInstanceLibraryItemListener::CHANGE_VISUAL);
+}
+
+Ref<Mesh> VoxelInstanceLibraryMultiMeshItem::get_impostor_mesh() const {
+	return _impostor_mesh;
+}
+
+void VoxelInstanceLibraryMultiMeshItem::set_impostor_density(float density) {
+	density = math::clamp(density, 0.f, 1.f);
+	if (density == _impostor_density) {
+		return;
+	}
+	_impostor_density = density;
+	if (_impostor_mesh.is_valid()) {
+		notify_listeners(IInstanceLibraryItemListener::CHANGE_VISUAL);
+	}
+}
+
+void VoxelInstanceLibraryMultiMeshItem::set_compound_collision_enabled(bool enabled) {
+	if (enabled == _compound_collision_enabled) {
+		return;
+	}
+	_compound_collision_enabled = enabled;
+	notify_listeners(IInstanceLibraryItemListener::CHANGE_VISUAL);
+}
+
+bool VoxelInstanceLibraryMultiMeshItem::is_compound_collision_enabled() const {
+	return _compound_collision_enabled;
+}
+
+void VoxelInstanceLibraryMultiMeshItem::set_compound_collision_distance(float distance) {
+	_compound_collision_distance = math::max(distance, 0.f);
+}
+
+float VoxelInstanceLibraryMultiMeshItem::get_compound_collision_distance() const {
+	return _compound_collision_distance;
+}
+
+float VoxelInstanceLibraryMultiMeshItem::get_impostor_density() const {
+	return _impostor_density;
+}
+
+unsigned int VoxelInstanceLibraryMultiMeshItem::get_extended_mesh_lod_count() const {
+	const unsigned int mesh_lod_count = get_multimesh_settings().mesh_lod_count;
+	return mesh_lod_count + ((_hide_beyond_max_lod || _impostor_mesh.is_valid()) ? 1 : 0);
+}
+
 const VoxelInstanceLibraryMultiMeshItem::Settings &VoxelInstanceLibraryMultiMeshItem::get_multimesh_settings() const {
 	if (_scene.is_valid()) {
 		return _scene_settings;
@@ -609,6 +661,12 @@ void VoxelInstanceLibraryMultiMeshItem::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_hide_beyond_max_lod", "enabled"), &Self::set_hide_beyond_max_lod);
 	ClassDB::bind_method(D_METHOD("get_hide_beyond_max_lod"), &Self::get_hide_beyond_max_lod);
 
+	ClassDB::bind_method(D_METHOD("set_impostor_mesh", "mesh"), &Self::set_impostor_mesh);
+	ClassDB::bind_method(D_METHOD("get_impostor_mesh"), &Self::get_impostor_mesh);
+
+	ClassDB::bind_method(D_METHOD("set_impostor_density", "density"), &Self::set_impostor_density);
+	ClassDB::bind_method(D_METHOD("get_impostor_density"), &Self::get_impostor_density);
+
 	ClassDB::bind_method(D_METHOD("set_render_layer", "render_layer"), &Self::set_render_layer);
 	ClassDB::bind_method(D_METHOD("get_render_layer"), &Self::get_render_layer);
 
@@ -633,6 +691,16 @@ void VoxelInstanceLibraryMultiMeshItem::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_collider_group_names", "names"), &Self::set_collider_group_names);
 	ClassDB::bind_method(D_METHOD("get_collider_group_names"), &Self::get_collider_group_names);
 
+	ClassDB::bind_method(
+			D_METHOD("set_compound_collision_enabled", "enabled"), &Self::set_compound_collision_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_compound_collision_enabled"), &Self::is_compound_collision_enabled);
+
+	ClassDB::bind_method(
+			D_METHOD("set_compound_collision_distance", "distance"), &Self::set_compound_collision_distance
+	);
+	ClassDB::bind_method(D_METHOD("get_compound_collision_distance"), &Self::get_compound_collision_distance);
+
 	ClassDB::bind_method(D_METHOD("setup_from_template", "node"), &Self::setup_from_template);
 
 	ClassDB::bind_method(D_METHOD("get_scene"), &Self::get_scene);
@@ -715,6 +783,21 @@ void VoxelInstanceLibraryMultiMeshItem::_bind_methods() {
 
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "collision_shapes"), "set_collision_shapes", "get_collision_shapes");
 
+	ADD_GROUP("Collision", "");
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "compound_collision_enabled"),
+			"set_compound_collision_enabled",
+			"is_compound_collision_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::FLOAT, "compound_collision_distance", PROPERTY_HINT_RANGE, "0.0,1024.0,0.1,or_greater"
+			),
+			"set_compound_collision_distance",
+			"get_compound_collision_distance"
+	);
+
 	ADD_GROUP("Mesh LOD settings", "");
 
 	// Only for editor and scripting
@@ -756,6 +839,17 @@ void VoxelInstanceLibraryMultiMeshItem::_bind_methods() {
 			PropertyInfo(Variant::BOOL, "hide_beyond_max_lod"), "set_hide_beyond_max_lod", "get_hide_beyond_max_lod"
 	);
 
+	ADD_PROPERTY(
+			PropertyInfo(Variant::OBJECT, "impostor_mesh", PROPERTY_HINT_RESOURCE_TYPE, Mesh::get_class_static()),
+			"set_impostor_mesh",
+			"get_impostor_mesh"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "impostor_density", PROPERTY_HINT_RANGE, "0.0,1.0,0.01"),
+			"set_impostor_density",
+			"get_impostor_density"
+	);
+
 	BIND_CONSTANT(MAX_MESH_LODS);
 }
 
@@ -85,6 +85,14 @@ public:
 	void set_collider_group_names(TypedArray<StringName> names);
 	TypedArray<StringName> get_collider_group_names() const;
 
+	// When enabled, instances don't get one body node each. Instead, each block gets a single static body holding the
+	// collision shapes of all its instances, which is only created when a viewer requiring collisions is close enough.
+	void set_compound_collision_enabled(bool enabled);
+	bool is_compound_collision_enabled() const;
+
+	void set_compound_collision_distance(float distance);
+	float get_compound_collision_distance() const;
+
 	// TODO GDX: it seems binding a method taking a `Node*` fails to compile. It is supposed to be working.
 #if defined(ZN_GODOT)
 	void setup_from_template(Node *root);
@@ -98,8 +106,24 @@ public:
 	bool get_hide_beyond_max_lod() const;
 	void set_hide_beyond_max_lod(bool enabled);
 
+	// Mesh drawn instead of instances beyond the last LOD. It is typically a cheap billboard or a cluster standing for
+	// several instances, so only a fraction of them get drawn.
+	void set_impostor_mesh(Ref<Mesh> mesh);
+	Ref<Mesh> get_impostor_mesh() const;
+
+	// Fraction of instances drawn with the impostor mesh
+	void set_impostor_density(float density);
+	float get_impostor_density() const;
+
 	// Internal
 
+	bool has_impostor() const {
+		return _impostor_mesh.is_valid();
+	}
+
+	// Number of mesh LODs, plus one if the item is hidden or drawn with an impostor beyond the last one
+	unsigned int get_extended_mesh_lod_count() const;
+
 	// If a scene is assigned to the item, returns settings converted from it.
 	// If no scene is assigned, returns manual settings.
 	const Settings &get_multimesh_settings() const;
@@ -196,6 +220,10 @@ private:
 	Ref<PackedScene> _scene;
 	// This may be used if the terrain has no LOD or the item is on its last LOD
 	bool _hide_beyond_max_lod = false;
+	Ref<Mesh> _impostor_mesh;
+	float _impostor_density = 0.25f;
+	bool _compound_collision_enabled = false;
+	float _compound_collision_distance = 64.f;
 	FixedArray<float, MAX_MESH_LODS> _mesh_lod_max_distance_ratios;
 };
 
@@ -1,4 +1,5 @@
 #include "voxel_instance_library_scene_item.h"
+#include "../../util/math/funcs.h"
 
 namespace zylann::voxel {
 
@@ -13,15 +14,29 @@ Ref<PackedScene> VoxelInstanceLibrarySceneItem::get_scene() const {
 	return _scene;
 }
 
+void VoxelInstanceLibrarySceneItem::set_pool_size(int size) {
+	_pool_size = math::clamp(size, 0, MAX_POOL_SIZE);
+}
+
+int VoxelInstanceLibrarySceneItem::get_pool_size() const {
+	return _pool_size;
+}
+
 void VoxelInstanceLibrarySceneItem::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_scene", "scene"), &VoxelInstanceLibrarySceneItem::set_scene);
 	ClassDB::bind_method(D_METHOD("get_scene"), &VoxelInstanceLibrarySceneItem::get_scene);
 
+	ClassDB::bind_method(D_METHOD("set_pool_size", "size"), &VoxelInstanceLibrarySceneItem::set_pool_size);
+	ClassDB::bind_method(D_METHOD("get_pool_size"), &VoxelInstanceLibrarySceneItem::get_pool_size);
+
 	ADD_PROPERTY(
 			PropertyInfo(Variant::OBJECT, "scene", PROPERTY_HINT_RESOURCE_TYPE, PackedScene::get_class_static()),
 			"set_scene",
 			"get_scene"
 	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "pool_size", PROPERTY_HINT_RANGE, "0,4096,1"), "set_pool_size", "get_pool_size"
+	);
 }
 
 } // namespace zylann::voxel
@@ -12,10 +12,17 @@ public:
 	void set_scene(Ref<PackedScene> scene);
 	Ref<PackedScene> get_scene() const;
 
+	// Maximum number of unloaded instances kept aside to be reused, instead of being freed and instantiated again.
+	void set_pool_size(int size);
+	int get_pool_size() const;
+
+	static const int MAX_POOL_SIZE = 4096;
+
 private:
 	static void _bind_methods();
 
 	Ref<PackedScene> _scene;
+	int _pool_size = 0;
 };
 
 } // namespace zylann::voxel
@@ -1,5 +1,6 @@
 #include "../../edition/voxel_tool.h"
 #include "../../engine/buffered_task_scheduler.h"
+#include "../../engine/voxel_engine.h"
 #include "../../streams/save_block_data_task.h"
 #include "../../util/containers/container_funcs.h"
 #include "../../util/dstack.h"
@@ -9,11 +10,14 @@
 #include "../../util/godot/classes/mesh_instance_3d.h"
 #include "../../util/godot/classes/multimesh.h"
 #include "../../util/godot/classes/node.h"
+#include "../../util/godot/classes/physics_server_3d.h"
 #include "../../util/godot/classes/ref_counted.h"
 #include "../../util/godot/classes/resource_saver.h"
 #include "../../util/godot/classes/time.h"
 #include "../../util/godot/classes/viewport.h"
+#include "../../util/godot/classes/world_3d.h"
 #include "../../util/godot/core/array.h"
+#include "../../util/godot/object_weak_ref.h"
 #include "../../util/math/conv.h"
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
@@ -40,10 +44,220 @@
 namespace zylann::voxel {
 
 namespace {
+
+// Scene instances spawned per time-spread step on the main thread. Instantiating scenes is slow, so it is done a few
+// at a time.
+static const unsigned int SCENE_INSTANCES_PER_SPAWN_STEP = 8;
+
 StdVector<Transform3f> &get_tls_transform_cache() {
 	static thread_local StdVector<Transform3f> tls_transform_cache;
 	return tls_transform_cache;
 }
+
+class SpawnSceneInstancesTask : public ITimeSpreadTask {
+public:
+	void run(TimeSpreadTaskContext &ctx) override {
+		VoxelInstancer *instancer = instancer_ref.get();
+		if (instancer == nullptr) {
+			// Destroyed in the meantime
+			return;
+		}
+		ctx.postpone = instancer->spawn_pending_scene_instances();
+	}
+
+	zylann::godot::ObjectWeakRef<VoxelInstancer> instancer_ref;
+};
+
+// Creates, updates or destroys the impostor instance of a block or batch, drawing a fraction of the given transforms
+// with the impostor mesh of the item
+void update_impostor_instance(
+		zylann::godot::DirectMultiMeshInstance &impostor_instance,
+		Span<const Transform3f> transforms,
+		const VoxelInstanceLibraryMultiMeshItem &item,
+		World3D &world,
+		const Transform3D &global_transform,
+		bool visible
+) {
+	Ref<Mesh> mesh = item.get_impostor_mesh();
+
+	if (mesh.is_null() || transforms.size() == 0) {
+		if (impostor_instance.is_valid()) {
+			impostor_instance.set_multimesh(Ref<MultiMesh>());
+			impostor_instance.destroy();
+		}
+		return;
+	}
+
+	// Thin out instances evenly. Their order is random already, so this doesn't produce visible patterns.
+	const unsigned int count = math::clamp(
+			static_cast<unsigned int>(transforms.size() * item.get_impostor_density() + 0.5f),
+			1u,
+			static_cast<unsigned int>(transforms.size())
+	);
+	static thread_local StdVector<Transform3f> tls_impostor_transforms;
+	StdVector<Transform3f> &impostor_transforms = tls_impostor_transforms;
+	impostor_transforms.resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		impostor_transforms[i] = transforms[(static_cast<uint64_t>(i) * transforms.size()) / count];
+	}
+
+	Ref<MultiMesh> multimesh = impostor_instance.get_multimesh();
+	if (multimesh.is_null()) {
+		multimesh.instantiate();
+		multimesh->set_transform_format(MultiMesh::TRANSFORM_3D);
+		multimesh->set_use_colors(false);
+		multimesh->set_use_custom_data(false);
+	} else {
+		multimesh->set_visible_instance_count(-1);
+	}
+	PackedFloat32Array bulk_array;
+	zylann::godot::DirectMultiMeshInstance::make_transform_3d_bulk_array(to_span(impostor_transforms), bulk_array);
+	multimesh->set_instance_count(count);
+	// Mesh must be set before the buffer, see `update_multimesh_instance`
+	multimesh->set_mesh(mesh);
+	RenderingServer::get_singleton()->multimesh_set_buffer(multimesh->get_rid(), bulk_array);
+
+	const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item.get_multimesh_settings();
+
+	if (!impostor_instance.is_valid()) {
+		impostor_instance.create();
+	}
+	impostor_instance.set_multimesh(multimesh);
+	impostor_instance.set_render_layer(settings.render_layer);
+	impostor_instance.set_world(&world);
+	impostor_instance.set_transform(global_transform);
+	impostor_instance.set_cast_shadows_setting(settings.shadow_casting_setting);
+	impostor_instance.set_gi_mode(settings.gi_mode);
+	impostor_instance.set_visible(visible);
+}
+
+// Creates, updates or destroys a multimesh instance so it renders the given transforms
+void update_multimesh_instance(
+		zylann::godot::DirectMultiMeshInstance &multimesh_instance,
+		zylann::godot::DirectMultiMeshInstance &impostor_instance,
+		uint8_t &current_mesh_lod,
+		Span<const Transform3f> transforms,
+		const VoxelInstanceLibraryMultiMeshItem &item,
+		World3D &world,
+		const Transform3D &global_transform,
+		bool instancer_is_visible,
+		// If not empty, contains `transforms` already packed with `make_transform_3d_bulk_array`
+		const PackedFloat32Array &packed_buffer
+) {
+	const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item.get_multimesh_settings();
+
+	if (transforms.size() == 0) {
+		if (multimesh_instance.is_valid()) {
+			multimesh_instance.set_multimesh(Ref<MultiMesh>());
+			multimesh_instance.destroy();
+		}
+		update_impostor_instance(impostor_instance, transforms, item, world, global_transform, false);
+		return;
+	}
+
+	Ref<MultiMesh> multimesh = multimesh_instance.get_multimesh();
+	if (multimesh.is_null()) {
+		multimesh.instantiate();
+		multimesh->set_transform_format(MultiMesh::TRANSFORM_3D);
+		multimesh->set_use_colors(false);
+		multimesh->set_use_custom_data(false);
+	} else {
+		multimesh->set_visible_instance_count(-1);
+	}
+	PackedFloat32Array bulk_array;
+	if (packed_buffer.size() == static_cast<int64_t>(transforms.size()) * 12) {
+		// Packed by the task that produced the transforms
+		bulk_array = packed_buffer;
+	} else {
+		zylann::godot::DirectMultiMeshInstance::make_transform_3d_bulk_array(transforms, bulk_array);
+	}
+	multimesh->set_instance_count(transforms.size());
+
+	// Setting the mesh BEFORE `multimesh_set_buffer` because otherwise Godot computes the AABB inside
+	// `multimesh_set_buffer` BY DOWNLOADING BACK THE BUFFER FROM THE GRAPHICS CARD which can incur a very harsh
+	// performance penalty
+	// TODO If we could use custom AABBs, we would not need this reordering
+	if (settings.mesh_lod_count > 0) {
+		if (current_mesh_lod < settings.mesh_lod_count) {
+			multimesh->set_mesh(settings.mesh_lods[current_mesh_lod]);
+		}
+	}
+
+	// TODO Waiting for Godot to expose the method on the resource object
+	// multimesh->set_as_bulk_array(bulk_array);
+	RenderingServer::get_singleton()->multimesh_set_buffer(multimesh->get_rid(), bulk_array);
+
+	if (!multimesh_instance.is_valid()) {
+		multimesh_instance.create();
+		multimesh_instance.set_visible(
+				instancer_is_visible &&
+				!(item.get_extended_mesh_lod_count() > settings.mesh_lod_count &&
+				  current_mesh_lod == settings.mesh_lod_count)
+		);
+	}
+	multimesh_instance.set_multimesh(multimesh);
+	multimesh_instance.set_render_layer(settings.render_layer);
+	multimesh_instance.set_world(&world);
+	multimesh_instance.set_transform(global_transform);
+	multimesh_instance.set_material_override(settings.material_override);
+	multimesh_instance.set_cast_shadows_setting(settings.shadow_casting_setting);
+	multimesh_instance.set_gi_mode(settings.gi_mode);
+
+	if (item.get_extended_mesh_lod_count() > 1) {
+		// Hide for now, let the LOD system show/hide and assign the right mesh when it runs. We do this because
+		// the LOD system doesn't necessarily update every blocks every frame, which would flicker at their full
+		// LOD when spawning
+		current_mesh_lod = settings.mesh_lod_count;
+		if (item.has_impostor()) {
+			// Out of range, so the impostor is hidden too until the LOD system runs
+			current_mesh_lod = settings.mesh_lod_count + 1;
+		}
+		multimesh_instance.set_visible(false);
+	}
+
+	update_impostor_instance(
+			impostor_instance,
+			transforms,
+			item,
+			world,
+			global_transform,
+			instancer_is_visible && current_mesh_lod == settings.mesh_lod_count
+	);
+}
+
+// Gets which mesh LOD to use at the given distance. The current index can be out of range due to eventual config
+// changes, or even as a way to force an update. This will bring it back in range.
+unsigned int get_mesh_lod_from_distance(
+		unsigned int current_mesh_lod,
+		unsigned int extended_mesh_lod_count,
+		float distance_squared,
+		Span<const float> distance_ratios,
+		float max_distance
+) {
+	const float hysteresis = 1.05;
+
+	while (current_mesh_lod + 1 < extended_mesh_lod_count &&
+		   distance_squared > math::squared(
+									  distance_ratios[current_mesh_lod] *
+									  max_distance
+									  // Exit distance is slightly higher so it has less chance to oscillate
+									  // often when near the threshold
+									  * hysteresis
+							  )) {
+		// Decrease detail
+		++current_mesh_lod;
+	}
+	while (current_mesh_lod > 0 &&
+		   (distance_squared < math::squared(distance_ratios[current_mesh_lod - 1] * max_distance)
+			// Allow mesh LOD index to go down if count is set lower
+			|| current_mesh_lod >= extended_mesh_lod_count)) {
+		// Increase detail
+		--current_mesh_lod;
+	}
+
+	return current_mesh_lod;
+}
+
 } // namespace
 
 VoxelInstancer::VoxelInstancer() {
@@ -55,7 +269,11 @@ VoxelInstancer::VoxelInstancer() {
 
 VoxelInstancer::~VoxelInstancer() {
 	// Destroy everything
-	// Note: we don't destroy instances using nodes, we assume they were detached already
+	// Note: we don't destroy instances using nodes, we assume they were detached already.
+	// Pooled ones are not in the tree though.
+	for (auto it = _layers.begin(); it != _layers.end(); ++it) {
+		clear_scene_instance_pool(it->second);
+	}
 
 	if (_library.is_valid()) {
 		_library->remove_listener(this);
@@ -71,6 +289,7 @@ void VoxelInstancer::clear_blocks() {
 			VoxelInstancerRigidBody *body = block.bodies[i];
 			body->detach_and_destroy();
 		}
+		free_compound_body(block);
 		for (unsigned int i = 0; i < block.scene_instances.size(); ++i) {
 			SceneInstance instance = block.scene_instances[i];
 			ERR_CONTINUE(instance.component == nullptr);
@@ -83,6 +302,8 @@ void VoxelInstancer::clear_blocks() {
 	for (auto it = _layers.begin(); it != _layers.end(); ++it) {
 		Layer &layer = it->second;
 		layer.blocks.clear();
+		layer.multimesh_batches.clear();
+		layer.dirty_multimesh_batches.clear();
 	}
 	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
 		Lod &lod = _lods[lod_index];
@@ -104,6 +325,9 @@ void VoxelInstancer::clear_blocks_in_layer(int layer_id) {
 
 void VoxelInstancer::clear_layers() {
 	clear_blocks();
+	for (auto it = _layers.begin(); it != _layers.end(); ++it) {
+		clear_scene_instance_pool(it->second);
+	}
 	for (unsigned int lod_index = 0; lod_index < _lods.size(); ++lod_index) {
 		Lod &lod = _lods[lod_index];
 		lod.layers.clear();
@@ -123,6 +347,8 @@ void VoxelInstancer::_notification(int p_what) {
 			break;
 
 		case NOTIFICATION_EXIT_WORLD:
+			// Compound bodies are created again when needed after entering a world
+			free_compound_bodies();
 			set_world(nullptr);
 #ifdef TOOLS_ENABLED
 			_debug_renderer.set_world(nullptr);
@@ -181,7 +407,7 @@ void VoxelInstancer::_notification(int p_what) {
 
 			for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
 				Block &block = **it;
-				if (!block.multimesh_instance.is_valid()) {
+				if (!block.multimesh_instance.is_valid() && !block.compound_body.is_valid()) {
 					// The block exists as an empty block (if it did not exist, it would get generated)
 					continue;
 				}
@@ -189,7 +415,37 @@ void VoxelInstancer::_notification(int p_what) {
 				const Vector3 block_local_pos(block.grid_position << block_size_po2);
 				// The local block transform never has rotation or scale so we can take a shortcut
 				const Transform3D block_transform(parent_transform.basis, parent_transform.xform(block_local_pos));
+				if (block.compound_body.is_valid()) {
+					PhysicsServer3D::get_singleton()->body_set_state(
+							block.compound_body, PhysicsServer3D::BODY_STATE_TRANSFORM, block_transform
+					);
+				}
+				if (!block.multimesh_instance.is_valid()) {
+					// Instances are rendered in a batch
+					continue;
+				}
 				block.multimesh_instance.set_transform(block_transform);
+				if (block.impostor_instance.is_valid()) {
+					block.impostor_instance.set_transform(block_transform);
+				}
+			}
+
+			for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
+				const Layer &layer = layer_it->second;
+				const int batch_size_po2 = base_block_size_po2 + layer.lod_index;
+				for (auto batch_it = layer.multimesh_batches.begin(); batch_it != layer.multimesh_batches.end();
+					 ++batch_it) {
+					MultiMeshBatch &batch = *batch_it->second;
+					if (!batch.multimesh_instance.is_valid()) {
+						continue;
+					}
+					const Vector3 batch_local_pos((batch_it->first * _multimesh_batch_size) << batch_size_po2);
+					const Transform3D batch_transform(parent_transform.basis, parent_transform.xform(batch_local_pos));
+					batch.multimesh_instance.set_transform(batch_transform);
+					if (batch.impostor_instance.is_valid()) {
+						batch.impostor_instance.set_transform(batch_transform);
+					}
+				}
 			}
 		} break;
 
@@ -210,6 +466,8 @@ void VoxelInstancer::_notification(int p_what) {
 
 void VoxelInstancer::process() {
 	process_task_results();
+	process_multimesh_batches();
+	process_compound_collisions();
 	if (_parent != nullptr) {
 		if (_library.is_valid() && _mesh_lod_distances[0] > 0.f) {
 			process_mesh_lods();
@@ -309,7 +567,8 @@ void VoxelInstancer::process_task_results() {
 				output.layer_id, //
 				world, //
 				block_global_transform, //
-				block_local_transform.origin //
+				block_local_transform.origin, //
+				output.multimesh_buffer //
 		);
 	}
 
@@ -361,7 +620,8 @@ void VoxelInstancer::process_gizmos() {
 					// Allocated but empty multimesh
 					color = Color8(255, 64, 0, 255);
 				}
-			} else if (block.scene_instances.size() == 0) {
+			} else if (block.scene_instances.size() == 0 && block.pending_scene_transforms.size() == 0 &&
+					   block.batched_instances.size() == 0) {
 				// Only draw blocks that are setup
 				continue;
 			}
@@ -430,25 +690,31 @@ Vector3 get_global_camera_position(const Node &node) {
 } // namespace
 
 void VoxelInstancer::update_mesh_from_mesh_lod(
-		Block &block,
-		const VoxelInstanceLibraryMultiMeshItem::Settings &settings,
-		bool hide_beyond_max_lod,
+		zylann::godot::DirectMultiMeshInstance &multimesh_instance,
+		zylann::godot::DirectMultiMeshInstance &impostor_instance,
+		unsigned int current_mesh_lod,
+		const InstanceLibraryMultiMeshItemSettings &settings,
 		bool instancer_is_visible
 ) {
-	if (hide_beyond_max_lod && block.current_mesh_lod == settings.mesh_lod_count) {
+	if (impostor_instance.is_valid()) {
+		impostor_instance.set_visible(instancer_is_visible && current_mesh_lod == settings.mesh_lod_count);
+	}
+
+	if (current_mesh_lod >= settings.mesh_lod_count) {
+		// Beyond the last LOD, hidden or replaced with an impostor.
 		// Godot doesn't like null meshes, so we have to implement a different code path
 
 		// Can be invalid if there is currently no instance in this block
-		if (block.multimesh_instance.is_valid()) {
-			block.multimesh_instance.set_visible(false);
+		if (multimesh_instance.is_valid()) {
+			multimesh_instance.set_visible(false);
 		}
 
 	} else {
-		Ref<MultiMesh> multimesh = block.multimesh_instance.get_multimesh();
+		Ref<MultiMesh> multimesh = multimesh_instance.get_multimesh();
 		if (multimesh.is_valid()) {
-			block.multimesh_instance.set_visible(instancer_is_visible);
+			multimesh_instance.set_visible(instancer_is_visible);
 			ZN_PROFILE_SCOPE();
-			multimesh->set_mesh(settings.mesh_lods[block.current_mesh_lod]);
+			multimesh->set_mesh(settings.mesh_lods[current_mesh_lod]);
 		}
 	}
 }
@@ -482,8 +748,6 @@ void VoxelInstancer::process_mesh_lods() {
 	ERR_FAIL_COND(_parent == nullptr);
 	const unsigned int block_size = 1 << _parent_mesh_block_size_po2;
 
-	const float hysteresis = 1.05;
-
 	const uint64_t mesh_lod_update_time_budget_microseconds = 500;
 	const uint64_t time_up_time = Time::get_singleton()->get_ticks_usec() + mesh_lod_update_time_budget_microseconds;
 
@@ -519,10 +783,9 @@ void VoxelInstancer::process_mesh_lods() {
 				continue;
 			}
 			const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item->get_multimesh_settings();
-			const bool hide_beyond_max_lod = item->get_hide_beyond_max_lod();
-			const unsigned int extended_mesh_lod_count = settings.mesh_lod_count + (hide_beyond_max_lod ? 1 : 0);
-			// Note, "hide beyond max lod" counts as having an extra LOD where the mesh is hidden. So an item can have
-			// only one mesh setup, yet be considered having LOD
+			const unsigned int extended_mesh_lod_count = item->get_extended_mesh_lod_count();
+			// Note, "hide beyond max lod" counts as having an extra LOD where the mesh is hidden, and impostors as an
+			// extra LOD using a different mesh. So an item can have only one mesh setup, yet be considered having LOD
 			if (extended_mesh_lod_count <= 1) {
 				// This block has no LOD
 				// TODO Optimization: would be nice to not need this conditional by iterating only item types that
@@ -546,32 +809,20 @@ void VoxelInstancer::process_mesh_lods() {
 			const Vector3 block_center_local(block.grid_position * lod_block_size + Vector3i(hs, hs, hs));
 			const float distance_squared = cam_pos_local.distance_squared_to(block_center_local);
 
-			// Compute current mesh LOD index (note, block.current_mesh_lod can totally be out of range due to eventual
-			// config changes, or even as a way to force an update. This will bring it back in range)
-			unsigned int current_mesh_lod = block.current_mesh_lod;
-			while (current_mesh_lod + 1 < extended_mesh_lod_count &&
-				   distance_squared > math::squared(
-											  distance_ratios[current_mesh_lod] *
-											  max_distance
-											  // Exit distance is slightly higher so it has less chance to oscillate
-											  // often when near the threshold
-											  * hysteresis
-									  )) {
-				// Decrease detail
-				++current_mesh_lod;
-			}
-			while (current_mesh_lod > 0 &&
-				   (distance_squared < math::squared(distance_ratios[current_mesh_lod - 1] * max_distance)
-					// Allow mesh LOD index to go down if count is set lower
-					|| current_mesh_lod >= extended_mesh_lod_count)) {
-				// Increase detail
-				--current_mesh_lod;
-			}
+			const unsigned int current_mesh_lod = get_mesh_lod_from_distance(
+					block.current_mesh_lod, extended_mesh_lod_count, distance_squared, distance_ratios, max_distance
+			);
 
 			// Apply if it changed
 			if (block.current_mesh_lod != current_mesh_lod) {
 				block.current_mesh_lod = current_mesh_lod;
-				update_mesh_from_mesh_lod(block, settings, hide_beyond_max_lod, instancer_is_visible);
+				update_mesh_from_mesh_lod(
+						block.multimesh_instance,
+						block.impostor_instance,
+						current_mesh_lod,
+						settings,
+						instancer_is_visible
+				);
 			}
 		}
 
@@ -589,6 +840,293 @@ void VoxelInstancer::process_mesh_lods() {
 	if (_mesh_lod_time_sliced_block_index >= _blocks.size()) {
 		_mesh_lod_time_sliced_block_index = 0;
 	}
+
+	// Batches are much fewer than blocks, so they are all updated every frame
+	for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
+		Layer &layer = layer_it->second;
+		if (layer.multimesh_batches.size() == 0) {
+			continue;
+		}
+
+		const VoxelInstanceLibraryMultiMeshItem *item =
+				Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(_library->get_item_const(layer_it->first));
+		ERR_CONTINUE(item == nullptr);
+		const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item->get_multimesh_settings();
+		const unsigned int extended_mesh_lod_count = item->get_extended_mesh_lod_count();
+		if (extended_mesh_lod_count <= 1) {
+			continue;
+		}
+
+		Span<const float> distance_ratios = item->get_mesh_lod_distance_ratios();
+		const float max_distance = _mesh_lod_distances[layer.lod_index];
+
+		const int batch_size = (block_size << layer.lod_index) * _multimesh_batch_size;
+		const int hs = batch_size >> 1;
+
+		for (auto batch_it = layer.multimesh_batches.begin(); batch_it != layer.multimesh_batches.end(); ++batch_it) {
+			MultiMeshBatch &batch = *batch_it->second;
+			const Vector3 batch_center_local(batch_it->first * batch_size + Vector3i(hs, hs, hs));
+			const float distance_squared = cam_pos_local.distance_squared_to(batch_center_local);
+
+			const unsigned int current_mesh_lod = get_mesh_lod_from_distance(
+					batch.current_mesh_lod, extended_mesh_lod_count, distance_squared, distance_ratios, max_distance
+			);
+
+			if (batch.current_mesh_lod != current_mesh_lod) {
+				batch.current_mesh_lod = current_mesh_lod;
+				update_mesh_from_mesh_lod(
+						batch.multimesh_instance,
+						batch.impostor_instance,
+						current_mesh_lod,
+						settings,
+						instancer_is_visible
+				);
+			}
+		}
+	}
+}
+
+void VoxelInstancer::process_multimesh_batches() {
+	if (_multimesh_batch_size <= 1 || _library.is_null()) {
+		return;
+	}
+
+	Ref<World3D> maybe_world = get_world_3d();
+	if (maybe_world.is_null()) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	const Transform3D parent_transform = get_global_transform();
+
+	// Blocks of a batch often change in the same frame, so batches are rebuilt once after all of them
+	for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
+		Layer &layer = layer_it->second;
+		if (layer.dirty_multimesh_batches.size() == 0) {
+			continue;
+		}
+
+		const VoxelInstanceLibraryItem *item = _library->get_item_const(layer_it->first);
+		ZN_ASSERT_CONTINUE(item != nullptr);
+
+		for (const Vector3i batch_position : layer.dirty_multimesh_batches) {
+			update_multimesh_batch(layer, batch_position, *item, **maybe_world, parent_transform);
+		}
+		layer.dirty_multimesh_batches.clear();
+	}
+}
+
+void VoxelInstancer::mark_multimesh_batch_dirty(Layer &layer, Vector3i block_position) {
+	const Vector3i batch_position = math::floordiv(block_position, _multimesh_batch_size);
+
+	MultiMeshBatch *batch;
+	auto it = layer.multimesh_batches.find(batch_position);
+	if (it == layer.multimesh_batches.end()) {
+		UniquePtr<MultiMeshBatch> new_batch = make_unique_instance<MultiMeshBatch>();
+		batch = new_batch.get();
+		layer.multimesh_batches.insert({ batch_position, std::move(new_batch) });
+	} else {
+		batch = it->second.get();
+	}
+
+	if (!batch->dirty) {
+		batch->dirty = true;
+		layer.dirty_multimesh_batches.push_back(batch_position);
+	}
+}
+
+void VoxelInstancer::update_multimesh_batch(
+		Layer &layer,
+		Vector3i batch_position,
+		const VoxelInstanceLibraryItem &item_base,
+		World3D &world,
+		const Transform3D &parent_transform
+) {
+	ZN_PROFILE_SCOPE();
+
+	auto batch_it = layer.multimesh_batches.find(batch_position);
+	ZN_ASSERT_RETURN(batch_it != layer.multimesh_batches.end());
+	MultiMeshBatch &batch = *batch_it->second;
+	batch.dirty = false;
+
+	const VoxelInstanceLibraryMultiMeshItem *item = Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(&item_base);
+	ZN_ASSERT_RETURN(item != nullptr);
+
+	const int block_size = (1 << _parent_mesh_block_size_po2) << layer.lod_index;
+	const Vector3i min_block_position = batch_position * _multimesh_batch_size;
+
+	// Gather instances of all blocks of the batch, relative to the batch
+	StdVector<Transform3f> &transforms = get_tls_transform_cache();
+	transforms.clear();
+
+	const Box3i blocks_box(min_block_position, Vector3iUtil::create(_multimesh_batch_size));
+	blocks_box.for_each_cell_zxy([this, &layer, &transforms, min_block_position, block_size](Vector3i block_position) {
+		auto block_it = layer.blocks.find(block_position);
+		if (block_it == layer.blocks.end()) {
+			return;
+		}
+		const Block &block = *_blocks[block_it->second];
+		const Vector3f offset = to_vec3f((block_position - min_block_position) * block_size);
+		block.batched_instances.decode(transforms, offset);
+	});
+
+	if (transforms.size() == 0) {
+		// No instances left, this also frees the multimesh
+		layer.multimesh_batches.erase(batch_it);
+		return;
+	}
+
+	const Transform3D batch_local_transform(Basis(), Vector3(min_block_position * block_size));
+
+	update_multimesh_instance(
+			batch.multimesh_instance,
+			batch.impostor_instance,
+			batch.current_mesh_lod,
+			to_span_const(transforms),
+			*item,
+			world,
+			parent_transform * batch_local_transform,
+			is_visible(),
+			PackedFloat32Array()
+	);
+}
+
+void VoxelInstancer::get_block_multimesh_transforms(const Block &block, StdVector<Transform3f> &dst) {
+	if (!block.multimesh_instance.is_valid()) {
+		// Instances are batched with other blocks, or the block is empty
+		block.batched_instances.decode(dst, Vector3f());
+		return;
+	}
+
+	Ref<MultiMesh> multimesh = block.multimesh_instance.get_multimesh();
+	ERR_FAIL_COND(multimesh.is_null());
+
+	const int instance_count = zylann::godot::get_visible_instance_count(**multimesh);
+
+	// TODO Optimization: it would be nice to get the whole array at once
+	for (int instance_index = 0; instance_index < instance_count; ++instance_index) {
+		// TODO This is terrible in MT mode! Think about keeping a local copy...
+		// TODO This is also terrible because it downloads the data from GPU (although Godot makes a cache
+		// by itself)
+		dst.push_back(to_transform3f(multimesh->get_instance_transform(instance_index)));
+	}
+}
+
+void VoxelInstancer::process_compound_collisions() {
+	if (_library.is_null() || _parent == nullptr) {
+		return;
+	}
+
+	Ref<World3D> maybe_world = get_world_3d();
+	if (maybe_world.is_null()) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	const Transform3D parent_transform = get_global_transform();
+	const Transform3D world_to_local = parent_transform.affine_inverse();
+
+	// Only viewers requiring collisions matter, other viewers are typically cameras or network observers
+	static thread_local StdVector<Vector3> tls_viewer_positions;
+	StdVector<Vector3> &viewer_positions = tls_viewer_positions;
+	viewer_positions.clear();
+	VoxelEngine::get_singleton().for_each_viewer(
+			[&viewer_positions, &world_to_local](ViewerID id, const VoxelEngine::Viewer &viewer) {
+				if (viewer.require_collisions) {
+					viewer_positions.push_back(world_to_local.xform(viewer.world_position));
+				}
+			}
+	);
+
+	// Bodies are freed a bit further than they are created, so they don't get rebuilt all the time when a viewer
+	// moves around the limit
+	const float removal_distance_ratio = 1.25f;
+
+	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
+		Block &block = **it;
+		if (block.compound_transforms.size() == 0) {
+			continue;
+		}
+
+		const VoxelInstanceLibraryMultiMeshItem *item =
+				Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(_library->get_item_const(block.layer_id));
+		ZN_ASSERT_CONTINUE(item != nullptr);
+
+		const int block_size_po2 = _parent_mesh_block_size_po2 + block.lod_index;
+		const Vector3 block_min(block.grid_position << block_size_po2);
+		const Vector3 block_max = block_min + Vector3(1 << block_size_po2, 1 << block_size_po2, 1 << block_size_po2);
+
+		// Distance to the closest point of the block
+		real_t closest_distance_sq = std::numeric_limits<real_t>::max();
+		for (const Vector3 viewer_position : viewer_positions) {
+			const Vector3 closest_point = viewer_position.clamp(block_min, block_max);
+			closest_distance_sq = math::min(closest_distance_sq, closest_point.distance_squared_to(viewer_position));
+		}
+
+		const float distance = item->get_compound_collision_distance();
+
+		if (block.compound_body.is_valid()) {
+			const float removal_distance = distance * removal_distance_ratio;
+			if (closest_distance_sq > removal_distance * removal_distance) {
+				free_compound_body(block);
+			}
+
+		} else if (closest_distance_sq < distance * distance) {
+			// The local block transform never has rotation or scale so we can take a shortcut
+			const Transform3D block_transform(parent_transform.basis, parent_transform.xform(block_min));
+			create_compound_body(block, item->get_multimesh_settings(), **maybe_world, block_transform);
+		}
+	}
+}
+
+void VoxelInstancer::create_compound_body(
+		Block &block,
+		const VoxelInstanceLibraryMultiMeshItem::Settings &settings,
+		World3D &world,
+		const Transform3D &block_global_transform
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(!block.compound_body.is_valid());
+
+	PhysicsServer3D &ps = *PhysicsServer3D::get_singleton();
+
+	const RID body = ps.body_create();
+	ps.body_set_mode(body, PhysicsServer3D::BODY_MODE_STATIC);
+	ps.body_set_ray_pickable(body, false);
+	// Collision queries report the instancer. The shape index divided by the number of collision shapes of the item
+	// gives the index of the instance in the block.
+	ps.body_attach_object_instance_id(body, get_instance_id());
+	ps.body_set_collision_layer(body, settings.collision_layer);
+	ps.body_set_collision_mask(body, settings.collision_mask);
+
+	for (const Transform3f &instance_transform_f : block.compound_transforms) {
+		const Transform3D instance_transform = to_transform3(instance_transform_f);
+		for (const CollisionShapeInfo &shape_info : settings.collision_shapes) {
+			ZN_ASSERT_CONTINUE(shape_info.shape.is_valid());
+			ps.body_add_shape(body, shape_info.shape->get_rid(), instance_transform * shape_info.transform, false);
+		}
+	}
+
+	ps.body_set_state(body, PhysicsServer3D::BODY_STATE_TRANSFORM, block_global_transform);
+	// Enter the space last, so the broadphase only has to insert the body once with all its shapes
+	ps.body_set_space(body, world.get_space());
+
+	block.compound_body = body;
+}
+
+void VoxelInstancer::free_compound_body(Block &block) {
+	if (block.compound_body.is_valid()) {
+		zylann::godot::free_physics_server_rid(*PhysicsServer3D::get_singleton(), block.compound_body);
+		block.compound_body = RID();
+	}
+}
+
+void VoxelInstancer::free_compound_bodies() {
+	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
+		free_compound_body(**it);
+	}
 }
 
 // We need to do this ourselves because we don't use nodes for multimeshes
@@ -601,8 +1139,9 @@ void VoxelInstancer::update_visibility() {
 	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
 		Block &block = **it;
 
-		if (block.multimesh_instance.is_valid()) {
+		if (block.multimesh_instance.is_valid() || block.impostor_instance.is_valid()) {
 			bool visible_with_lod = true;
+			bool impostor_visible = false;
 			{
 				const VoxelInstanceLibraryItem *item_base = _library->get_item_const(block.layer_id);
 				ERR_CONTINUE(item_base == nullptr);
@@ -611,14 +1150,43 @@ void VoxelInstancer::update_visibility() {
 						Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(item_base);
 				if (item != nullptr) {
 					const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item->get_multimesh_settings();
-					const bool hide_beyond_max_lod = item->get_hide_beyond_max_lod();
-					if (hide_beyond_max_lod) {
+					if (item->get_extended_mesh_lod_count() > settings.mesh_lod_count) {
 						visible_with_lod = block.current_mesh_lod < settings.mesh_lod_count;
+						impostor_visible = block.current_mesh_lod == settings.mesh_lod_count;
 					}
 				}
 			}
 
-			block.multimesh_instance.set_visible(instancer_is_visible && visible_with_lod);
+			if (block.multimesh_instance.is_valid()) {
+				block.multimesh_instance.set_visible(instancer_is_visible && visible_with_lod);
+			}
+			if (block.impostor_instance.is_valid()) {
+				block.impostor_instance.set_visible(instancer_is_visible && impostor_visible);
+			}
+		}
+	}
+
+	for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
+		Layer &layer = layer_it->second;
+		if (layer.multimesh_batches.size() == 0) {
+			continue;
+		}
+
+		const VoxelInstanceLibraryMultiMeshItem *item =
+				Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(_library->get_item_const(layer_it->first));
+		ERR_CONTINUE(item == nullptr);
+		const unsigned int mesh_lod_count = item->get_multimesh_settings().mesh_lod_count;
+		const bool has_extra_lod = item->get_extended_mesh_lod_count() > mesh_lod_count;
+
+		for (auto batch_it = layer.multimesh_batches.begin(); batch_it != layer.multimesh_batches.end(); ++batch_it) {
+			MultiMeshBatch &batch = *batch_it->second;
+			if (batch.multimesh_instance.is_valid()) {
+				const bool visible_with_lod = !has_extra_lod || batch.current_mesh_lod < mesh_lod_count;
+				batch.multimesh_instance.set_visible(instancer_is_visible && visible_with_lod);
+			}
+			if (batch.impostor_instance.is_valid()) {
+				batch.impostor_instance.set_visible(instancer_is_visible && batch.current_mesh_lod == mesh_lod_count);
+			}
 		}
 	}
 }
@@ -629,6 +1197,21 @@ void VoxelInstancer::set_world(World3D *world) {
 		if (block.multimesh_instance.is_valid()) {
 			block.multimesh_instance.set_world(world);
 		}
+		if (block.impostor_instance.is_valid()) {
+			block.impostor_instance.set_world(world);
+		}
+	}
+	for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
+		Layer &layer = layer_it->second;
+		for (auto batch_it = layer.multimesh_batches.begin(); batch_it != layer.multimesh_batches.end(); ++batch_it) {
+			MultiMeshBatch &batch = *batch_it->second;
+			if (batch.multimesh_instance.is_valid()) {
+				batch.multimesh_instance.set_world(world);
+			}
+			if (batch.impostor_instance.is_valid()) {
+				batch.impostor_instance.set_world(world);
+			}
+		}
 	}
 }
 
@@ -678,6 +1261,84 @@ Ref<VoxelInstanceLibrary> VoxelInstancer::get_library() const {
 	return _library;
 }
 
+void VoxelInstancer::set_multimesh_batch_size(int size) {
+	size = math::clamp(size, 1, MAX_MULTIMESH_BATCH_SIZE);
+	if (size == _multimesh_batch_size) {
+		return;
+	}
+	_multimesh_batch_size = size;
+
+	for (auto it = _layers.begin(); it != _layers.end(); ++it) {
+		Layer &layer = it->second;
+		layer.multimesh_batches.clear();
+		layer.dirty_multimesh_batches.clear();
+	}
+
+	if (_blocks.size() == 0 || _library.is_null() || !is_inside_tree()) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	Ref<World3D> maybe_world = get_world_3d();
+	ERR_FAIL_COND(maybe_world.is_null());
+
+	const Transform3D parent_transform = get_global_transform();
+	StdVector<Transform3f> &transforms = get_tls_transform_cache();
+
+	// Move existing instances to the new rendering setup
+	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
+		Block &block = **it;
+
+		const VoxelInstanceLibraryMultiMeshItem *item =
+				Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(_library->get_item_const(block.layer_id));
+		if (item == nullptr) {
+			continue;
+		}
+
+		transforms.clear();
+		get_block_multimesh_transforms(block, transforms);
+
+		block.batched_instances.clear();
+		if (block.multimesh_instance.is_valid()) {
+			block.multimesh_instance.set_multimesh(Ref<MultiMesh>());
+			block.multimesh_instance.destroy();
+		}
+		if (block.impostor_instance.is_valid()) {
+			block.impostor_instance.set_multimesh(Ref<MultiMesh>());
+			block.impostor_instance.destroy();
+		}
+
+		if (transforms.size() == 0) {
+			continue;
+		}
+
+		if (_multimesh_batch_size > 1) {
+			block.batched_instances.set(to_span_const(transforms));
+			mark_multimesh_batch_dirty(get_layer(block.layer_id), block.grid_position);
+
+		} else {
+			const Vector3 block_local_pos(block.grid_position << (_parent_mesh_block_size_po2 + block.lod_index));
+			const Transform3D block_transform(parent_transform.basis, parent_transform.xform(block_local_pos));
+			update_multimesh_instance(
+					block.multimesh_instance,
+					block.impostor_instance,
+					block.current_mesh_lod,
+					to_span_const(transforms),
+					*item,
+					**maybe_world,
+					block_transform,
+					is_visible(),
+					PackedFloat32Array()
+			);
+		}
+	}
+}
+
+int VoxelInstancer::get_multimesh_batch_size() const {
+	return _multimesh_batch_size;
+}
+
 void VoxelInstancer::regenerate_layer(uint16_t layer_id, bool regenerate_blocks) {
 	ZN_PROFILE_SCOPE();
 	ERR_FAIL_COND(_parent == nullptr);
@@ -741,13 +1402,21 @@ void VoxelInstancer::regenerate_layer(uint16_t layer_id, bool regenerate_blocks)
 				uint8_t octant_mask,
 				int render_block_size
 		) {
+			const float h = render_block_size / 2;
 			if (!render_block.multimesh_instance.is_valid()) {
+				// Instances may be batched with other blocks
+				const QuantizedInstanceTransforms &instances = render_block.batched_instances;
+				for (unsigned int i = 0; i < instances.size(); ++i) {
+					const uint8_t octant_index = VoxelInstanceGenerator::get_octant_index(instances.get_position(i), h);
+					if ((octant_mask & (1 << octant_index)) != 0) {
+						dst.push_back(instances.get_transform(i));
+					}
+				}
 				return;
 			}
 			Ref<MultiMesh> multimesh = render_block.multimesh_instance.get_multimesh();
 			ERR_FAIL_COND(multimesh.is_null());
 			const int instance_count = zylann::godot::get_visible_instance_count(**multimesh);
-			const float h = render_block_size / 2;
 			for (int i = 0; i < instance_count; ++i) {
 				// TODO This is terrible in MT mode! Think about keeping a local copy...
 				const Transform3D t = multimesh->get_instance_transform(i);
@@ -837,7 +1506,8 @@ void VoxelInstancer::regenerate_layer(uint16_t layer_id, bool regenerate_blocks)
 				layer_id,
 				world,
 				block_transform,
-				block_local_transform.origin
+				block_local_transform.origin,
+				PackedFloat32Array()
 		);
 	}
 }
@@ -849,16 +1519,19 @@ void VoxelInstancer::update_layer_meshes(int layer_id) {
 	VoxelInstanceLibraryMultiMeshItem *item = Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(*item_base);
 	ERR_FAIL_COND(item == nullptr);
 
-	const bool hide_beyond_max_lod = item->get_hide_beyond_max_lod();
-
 	const bool instancer_is_visible = is_inside_tree() && is_visible_in_tree();
 
 	const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item->get_multimesh_settings();
-	const unsigned int extended_mesh_lod_count = settings.mesh_lod_count + (hide_beyond_max_lod ? 1 : 0);
+	const unsigned int extended_mesh_lod_count = item->get_extended_mesh_lod_count();
 
 	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
 		Block &block = **it;
-		if (block.layer_id != layer_id || !block.multimesh_instance.is_valid()) {
+		if (block.layer_id != layer_id) {
+			continue;
+		}
+		// Collision settings may have changed, compound bodies will be created again with the new ones
+		free_compound_body(block);
+		if (!block.multimesh_instance.is_valid()) {
 			continue;
 		}
 		block.multimesh_instance.set_render_layer(settings.render_layer);
@@ -866,9 +1539,74 @@ void VoxelInstancer::update_layer_meshes(int layer_id) {
 		block.multimesh_instance.set_cast_shadows_setting(settings.shadow_casting_setting);
 		block.multimesh_instance.set_gi_mode(settings.gi_mode);
 
+		// The impostor mesh or density may have changed
+		update_block_impostor(block);
+
 		block.current_mesh_lod = math::min(static_cast<unsigned int>(block.current_mesh_lod), extended_mesh_lod_count);
-		update_mesh_from_mesh_lod(block, settings, hide_beyond_max_lod, instancer_is_visible);
+		update_mesh_from_mesh_lod(
+				block.multimesh_instance,
+				block.impostor_instance,
+				block.current_mesh_lod,
+				settings,
+				instancer_is_visible
+		);
+	}
+
+	Layer &layer = get_layer(layer_id);
+	for (auto it = layer.multimesh_batches.begin(); it != layer.multimesh_batches.end(); ++it) {
+		MultiMeshBatch &batch = *it->second;
+		if (!batch.multimesh_instance.is_valid()) {
+			continue;
+		}
+		batch.multimesh_instance.set_render_layer(settings.render_layer);
+		batch.multimesh_instance.set_material_override(settings.material_override);
+		batch.multimesh_instance.set_cast_shadows_setting(settings.shadow_casting_setting);
+		batch.multimesh_instance.set_gi_mode(settings.gi_mode);
+
+		batch.current_mesh_lod = math::min(static_cast<unsigned int>(batch.current_mesh_lod), extended_mesh_lod_count);
+		update_mesh_from_mesh_lod(
+				batch.multimesh_instance,
+				batch.impostor_instance,
+				batch.current_mesh_lod,
+				settings,
+				instancer_is_visible
+		);
+
+		// Rebuilt next frame, which also updates the impostor
+		if (!batch.dirty) {
+			batch.dirty = true;
+			layer.dirty_multimesh_batches.push_back(it->first);
+		}
+	}
+}
+
+void VoxelInstancer::update_block_impostor(Block &block) {
+	if (!block.multimesh_instance.is_valid() && !block.impostor_instance.is_valid()) {
+		return;
 	}
+	Ref<World3D> maybe_world = get_world_3d();
+	ZN_ASSERT_RETURN(maybe_world.is_valid());
+	ZN_ASSERT_RETURN(_library.is_valid());
+
+	const VoxelInstanceLibraryMultiMeshItem *item =
+			Object::cast_to<VoxelInstanceLibraryMultiMeshItem>(_library->get_item_const(block.layer_id));
+	ZN_ASSERT_RETURN(item != nullptr);
+
+	static thread_local StdVector<Transform3f> tls_transforms;
+	StdVector<Transform3f> &transforms = tls_transforms;
+	transforms.clear();
+	get_block_multimesh_transforms(block, transforms);
+
+	const Transform3D parent_transform = get_global_transform();
+	const Vector3 block_local_pos(block.grid_position << (_parent_mesh_block_size_po2 + block.lod_index));
+	const Transform3D block_transform(parent_transform.basis, parent_transform.xform(block_local_pos));
+
+	const bool visible = is_inside_tree() && is_visible_in_tree() &&
+			block.current_mesh_lod == item->get_multimesh_settings().mesh_lod_count;
+
+	update_impostor_instance(
+			block.impostor_instance, to_span_const(transforms), *item, **maybe_world, block_transform, visible
+	);
 }
 
 void VoxelInstancer::update_layer_scenes(int layer_id) {
@@ -879,6 +1617,9 @@ void VoxelInstancer::update_layer_scenes(int layer_id) {
 	ERR_FAIL_COND(item == nullptr);
 	const int data_block_size_po2 = _parent_data_block_size_po2;
 
+	// Pooled instances use the previous scene
+	clear_scene_instance_pool(get_layer(layer_id));
+
 	for (unsigned int block_index = 0; block_index < _blocks.size(); ++block_index) {
 		Block &block = *_blocks[block_index];
 
@@ -976,7 +1717,7 @@ void VoxelInstancer::add_layer(int layer_id, int lod_index) {
 
 	Layer layer;
 	layer.lod_index = lod_index;
-	_layers.insert({ layer_id, layer });
+	_layers.insert({ layer_id, std::move(layer) });
 
 	lod.layers.push_back(layer_id);
 }
@@ -995,6 +1736,7 @@ void VoxelInstancer::remove_layer(int layer_id) {
 	}
 
 	clear_blocks_in_layer(layer_id);
+	clear_scene_instance_pool(layer);
 
 	_layers.erase(layer_id);
 }
@@ -1013,6 +1755,9 @@ void VoxelInstancer::remove_block(unsigned int block_index) {
 	{
 		Layer &layer = get_layer(block->layer_id);
 		layer.blocks.erase(block->grid_position);
+		if (block->batched_instances.size() > 0) {
+			mark_multimesh_batch_dirty(layer, block->grid_position);
+		}
 	}
 	_blocks[block_index] = std::move(_blocks.back());
 	_blocks.pop_back();
@@ -1023,13 +1768,16 @@ void VoxelInstancer::remove_block(unsigned int block_index) {
 		VoxelInstancerRigidBody *body = block->bodies[i];
 		body->detach_and_destroy();
 	}
+	free_compound_body(*block);
 
-	for (unsigned int i = 0; i < block->scene_instances.size(); ++i) {
-		SceneInstance instance = block->scene_instances[i];
-		ERR_CONTINUE(instance.component == nullptr);
-		instance.component->detach();
-		ERR_CONTINUE(instance.root == nullptr);
-		instance.root->queue_free();
+	if (block->scene_instances.size() > 0) {
+		Layer &layer = get_layer(block->layer_id);
+		const VoxelInstanceLibrarySceneItem *scene_item = _library.is_valid()
+				? Object::cast_to<VoxelInstanceLibrarySceneItem>(_library->get_item_const(block->layer_id))
+				: nullptr;
+		for (unsigned int i = 0; i < block->scene_instances.size(); ++i) {
+			release_scene_instance(layer, scene_item, block->scene_instances[i]);
+		}
 	}
 
 	// If the block we removed was also the last one, we don't enter here
@@ -1181,6 +1929,131 @@ VoxelInstancer::SceneInstance VoxelInstancer::create_scene_instance(
 	return instance;
 }
 
+VoxelInstancer::SceneInstance VoxelInstancer::acquire_scene_instance(
+		Layer &layer,
+		const VoxelInstanceLibrarySceneItem &scene_item,
+		int instance_index,
+		unsigned int block_index,
+		Transform3D transform,
+		int data_block_size_po2
+) {
+	if (layer.scene_instance_pool.size() == 0) {
+		return create_scene_instance(scene_item, instance_index, block_index, transform, data_block_size_po2);
+	}
+
+	SceneInstance instance = layer.scene_instance_pool.back();
+	layer.scene_instance_pool.pop_back();
+
+	instance.component->attach(this);
+	instance.component->set_instance_index(instance_index);
+	instance.component->set_render_block_index(block_index);
+	instance.component->set_data_block_position(math::floor_to_int(transform.origin) >> data_block_size_po2);
+
+	instance.root->set_transform(transform);
+	// Gives scripts a chance to reset their state
+	instance.root->request_ready();
+
+	add_child(instance.root);
+
+	return instance;
+}
+
+void VoxelInstancer::release_scene_instance(
+		Layer &layer,
+		const VoxelInstanceLibrarySceneItem *scene_item,
+		SceneInstance instance
+) {
+	ERR_FAIL_COND(instance.component == nullptr);
+	instance.component->detach();
+	ERR_FAIL_COND(instance.root == nullptr);
+
+	if (scene_item != nullptr && layer.scene_instance_pool.size() < static_cast<size_t>(scene_item->get_pool_size()) &&
+		instance.root->get_parent() == this) {
+		remove_child(instance.root);
+		layer.scene_instance_pool.push_back(instance);
+	} else {
+		instance.root->queue_free();
+	}
+}
+
+void VoxelInstancer::clear_scene_instance_pool(Layer &layer) {
+	for (const SceneInstance &instance : layer.scene_instance_pool) {
+		// Not in the tree, so it can be freed right away
+		memdelete(instance.root);
+	}
+	layer.scene_instance_pool.clear();
+}
+
+void VoxelInstancer::schedule_scene_instances(const Block &block) {
+	_pending_scene_blocks.push(PendingSceneBlock{ block.layer_id, block.grid_position });
+
+	if (!_scene_spawn_task_scheduled) {
+		_scene_spawn_task_scheduled = true;
+		SpawnSceneInstancesTask *task = ZN_NEW(SpawnSceneInstancesTask);
+		task->instancer_ref.set(this);
+		VoxelEngine::get_singleton().push_main_thread_time_spread_task(task);
+	}
+}
+
+bool VoxelInstancer::spawn_pending_scene_instances() {
+	ZN_PROFILE_SCOPE();
+
+	unsigned int remaining_count = SCENE_INSTANCES_PER_SPAWN_STEP;
+
+	while (_pending_scene_blocks.size() > 0 && remaining_count > 0) {
+		const PendingSceneBlock pending_block = _pending_scene_blocks.front();
+
+		Layer *layer = nullptr;
+		Block *block = nullptr;
+		unsigned int block_index = 0;
+		const VoxelInstanceLibrarySceneItem *item = nullptr;
+
+		auto layer_it = _layers.find(pending_block.layer_id);
+		if (layer_it != _layers.end()) {
+			layer = &layer_it->second;
+			auto block_it = layer->blocks.find(pending_block.grid_position);
+			if (block_it != layer->blocks.end()) {
+				block_index = block_it->second;
+				block = _blocks[block_index].get();
+			}
+		}
+		if (block != nullptr && _library.is_valid()) {
+			item = Object::cast_to<VoxelInstanceLibrarySceneItem>(_library->get_item_const(pending_block.layer_id));
+		}
+
+		if (item == nullptr) {
+			// The block was removed, or the library changed
+			if (block != nullptr) {
+				block->pending_scene_transforms.clear();
+			}
+			_pending_scene_blocks.pop();
+			continue;
+		}
+
+		while (block->pending_scene_transforms.size() > 0 && remaining_count > 0) {
+			const Transform3D transform = block->pending_scene_transforms.back();
+			block->pending_scene_transforms.pop_back();
+			--remaining_count;
+
+			const SceneInstance instance = acquire_scene_instance(
+					*layer, *item, block->scene_instances.size(), block_index, transform, _parent_data_block_size_po2
+			);
+			ERR_CONTINUE(instance.root == nullptr);
+			block->scene_instances.push_back(instance);
+		}
+
+		if (block->pending_scene_transforms.size() == 0) {
+			_pending_scene_blocks.pop();
+		}
+	}
+
+	if (_pending_scene_blocks.size() == 0) {
+		_scene_spawn_task_scheduled = false;
+		return false;
+	}
+	return true;
+}
+
 unsigned int VoxelInstancer::create_block(
 		Layer &layer,
 		uint16_t layer_id,
@@ -1212,7 +2085,8 @@ void VoxelInstancer::update_block_from_transforms( //
 		uint16_t layer_id, //
 		World3D &world, //
 		const Transform3D &block_global_transform, //
-		Vector3 block_local_position //
+		Vector3 block_local_position, //
+		const PackedFloat32Array &packed_buffer //
 ) {
 	ZN_PROFILE_SCOPE();
 
@@ -1233,67 +2107,35 @@ void VoxelInstancer::update_block_from_transforms( //
 	if (item != nullptr) {
 		const VoxelInstanceLibraryMultiMeshItem::Settings &settings = item->get_multimesh_settings();
 
-		if (transforms.size() == 0) {
-			if (block.multimesh_instance.is_valid()) {
-				block.multimesh_instance.set_multimesh(Ref<MultiMesh>());
-				block.multimesh_instance.destroy();
-			}
-
+		if (_multimesh_batch_size > 1) {
+			// Rendered later together with neighbor blocks
+			block.batched_instances.set(transforms);
+			mark_multimesh_batch_dirty(layer, grid_position);
 		} else {
-			Ref<MultiMesh> multimesh = block.multimesh_instance.get_multimesh();
-			if (multimesh.is_null()) {
-				multimesh.instantiate();
-				multimesh->set_transform_format(MultiMesh::TRANSFORM_3D);
-				multimesh->set_use_colors(false);
-				multimesh->set_use_custom_data(false);
-			} else {
-				multimesh->set_visible_instance_count(-1);
-			}
-			PackedFloat32Array bulk_array;
-			zylann::godot::DirectMultiMeshInstance::make_transform_3d_bulk_array(transforms, bulk_array);
-			multimesh->set_instance_count(transforms.size());
-
-			// Setting the mesh BEFORE `multimesh_set_buffer` because otherwise Godot computes the AABB inside
-			// `multimesh_set_buffer` BY DOWNLOADING BACK THE BUFFER FROM THE GRAPHICS CARD which can incur a very harsh
-			// performance penalty
-			// TODO If we could use custom AABBs, we would not need this reordering
-			if (settings.mesh_lod_count > 0) {
-				if (block.current_mesh_lod < settings.mesh_lod_count) {
-					multimesh->set_mesh(settings.mesh_lods[block.current_mesh_lod]);
-				}
-			}
-
-			// TODO Waiting for Godot to expose the method on the resource object
-			// multimesh->set_as_bulk_array(bulk_array);
-			RenderingServer::get_singleton()->multimesh_set_buffer(multimesh->get_rid(), bulk_array);
-
-			if (!block.multimesh_instance.is_valid()) {
-				block.multimesh_instance.create();
-				block.multimesh_instance.set_visible(
-						is_visible() &&
-						!(item->get_hide_beyond_max_lod() && block.current_mesh_lod == settings.mesh_lod_count)
-				);
-			}
-			block.multimesh_instance.set_multimesh(multimesh);
-			block.multimesh_instance.set_render_layer(settings.render_layer);
-			block.multimesh_instance.set_world(&world);
-			block.multimesh_instance.set_transform(block_global_transform);
-			block.multimesh_instance.set_material_override(settings.material_override);
-			block.multimesh_instance.set_cast_shadows_setting(settings.shadow_casting_setting);
-			block.multimesh_instance.set_gi_mode(settings.gi_mode);
-
-			if (settings.mesh_lod_count > 1 || (settings.mesh_lod_count == 1 && item->get_hide_beyond_max_lod())) {
-				// Hide for now, let the LOD system show/hide and assign the right mesh when it runs. We do this because
-				// the LOD system doesn't necessarily update every blocks every frame, which would flicker at their full
-				// LOD when spawning
-				block.current_mesh_lod = settings.mesh_lod_count;
-				block.multimesh_instance.set_visible(false);
-			}
+			update_multimesh_instance(
+					block.multimesh_instance,
+					block.impostor_instance,
+					block.current_mesh_lod,
+					transforms,
+					*item,
+					world,
+					block_global_transform,
+					is_visible(),
+					packed_buffer
+			);
 		}
 
 		// Update bodies
 		Span<const CollisionShapeInfo> collision_shapes = to_span(settings.collision_shapes);
-		if (collision_shapes.size() > 0) {
+		if (collision_shapes.size() > 0 && item->is_compound_collision_enabled()) {
+			block.compound_transforms.resize(transforms.size());
+			for (unsigned int instance_index = 0; instance_index < transforms.size(); ++instance_index) {
+				block.compound_transforms[instance_index] = transforms[instance_index];
+			}
+			// The body is created again with the new transforms when needed
+			free_compound_body(block);
+
+		} else if (collision_shapes.size() > 0) {
 			ZN_PROFILE_SCOPE_NAMED("Update multimesh bodies");
 
 			const int data_block_size_po2 = _parent_data_block_size_po2;
@@ -1367,41 +2209,38 @@ void VoxelInstancer::update_block_from_transforms( //
 								get_path())
 		);
 
-		const int data_block_size_po2 = _parent_data_block_size_po2;
-
-		// Add new instances
-		for (unsigned int instance_index = 0; instance_index < transforms.size(); ++instance_index) {
+		// Move existing instances
+		const unsigned int reused_count = math::min(
+				static_cast<unsigned int>(transforms.size()), static_cast<unsigned int>(block.scene_instances.size())
+		);
+		for (unsigned int instance_index = 0; instance_index < reused_count; ++instance_index) {
 			const Transform3D local_transform = to_transform3(transforms[instance_index]);
 			const Transform3D body_transform(local_transform.basis, local_transform.origin + block_local_position);
-
-			SceneInstance instance;
-
-			if (instance_index < static_cast<unsigned int>(block.bodies.size())) {
-				instance = block.scene_instances[instance_index];
-				instance.root->set_transform(body_transform);
-
-			} else {
-				instance = create_scene_instance(
-						*scene_item, instance_index, block_index, body_transform, data_block_size_po2
-				);
-				ERR_CONTINUE(instance.root == nullptr);
-				block.scene_instances.push_back(instance);
-			}
-
+			SceneInstance instance = block.scene_instances[instance_index];
+			ERR_CONTINUE(instance.root == nullptr);
+			instance.root->set_transform(body_transform);
 			// TODO Deserialize state
 		}
 
 		// Remove old instances
-		for (unsigned int instance_index = transforms.size(); instance_index < block.scene_instances.size();
+		for (unsigned int instance_index = reused_count; instance_index < block.scene_instances.size();
 			 ++instance_index) {
-			SceneInstance instance = block.scene_instances[instance_index];
-			ERR_CONTINUE(instance.component == nullptr);
-			instance.component->detach();
-			ERR_CONTINUE(instance.root == nullptr);
-			instance.root->queue_free();
+			release_scene_instance(layer, scene_item, block.scene_instances[instance_index]);
 		}
+		block.scene_instances.resize(reused_count);
 
-		block.scene_instances.resize(transforms.size());
+		// New instances are spawned over the next frames
+		const bool was_pending = block.pending_scene_transforms.size() > 0;
+		block.pending_scene_transforms.clear();
+		for (unsigned int instance_index = reused_count; instance_index < transforms.size(); ++instance_index) {
+			const Transform3D local_transform = to_transform3(transforms[instance_index]);
+			block.pending_scene_transforms.push_back(
+					Transform3D(local_transform.basis, local_transform.origin + block_local_position)
+			);
+		}
+		if (!was_pending && block.pending_scene_transforms.size() > 0) {
+			schedule_scene_instances(block);
+		}
 	}
 }
 
@@ -1440,7 +2279,8 @@ void VoxelInstancer::create_render_blocks(Vector3i render_grid_position, int lod
 			lod_index, //
 			render_block_size, //
 			data_block_size, //
-			_up_mode //
+			_up_mode, //
+			_multimesh_batch_size <= 1 //
 	));
 
 	VoxelEngine::get_singleton().push_async_io_task(task);
@@ -1515,48 +2355,53 @@ SaveBlockDataTask *VoxelInstancer::save_block(
 			layer_data.scale_max = 10.f;
 		}
 
-		if (render_block.multimesh_instance.is_valid()) {
+		if (render_block.multimesh_instance.is_valid() || render_block.batched_instances.size() > 0) {
 			// Multimeshes
 
-			Ref<MultiMesh> multimesh = render_block.multimesh_instance.get_multimesh();
-			CRASH_COND(multimesh.is_null());
-
 			ZN_PROFILE_SCOPE();
 
-			const int instance_count = zylann::godot::get_visible_instance_count(**multimesh);
+			StdVector<Transform3f> &transforms = get_tls_transform_cache();
+			transforms.clear();
+			get_block_multimesh_transforms(render_block, transforms);
 
 			if (render_to_data_factor == 1) {
-				layer_data.instances.resize(instance_count);
+				layer_data.instances.resize(transforms.size());
 
-				// TODO Optimization: it would be nice to get the whole array at once
-				for (int instance_index = 0; instance_index < instance_count; ++instance_index) {
-					// TODO This is terrible in MT mode! Think about keeping a local copy...
-					// TODO This is also terrible because it downloads the data from GPU (although Godot makes a cache
-					// by itself)
-					layer_data.instances[instance_index].transform =
-							to_transform3f(multimesh->get_instance_transform(instance_index));
+				for (unsigned int instance_index = 0; instance_index < transforms.size(); ++instance_index) {
+					layer_data.instances[instance_index].transform = transforms[instance_index];
 				}
 
 			} else if (render_to_data_factor == 2) {
-				for (int instance_index = 0; instance_index < instance_count; ++instance_index) {
-					// TODO Optimize: This is terrible in MT mode! Think about keeping a local copy...
-					const Transform3D rendered_instance_transform = multimesh->get_instance_transform(instance_index);
+				for (const Transform3f &rendered_instance_transform : transforms) {
 					const int instance_octant_index = VoxelInstanceGenerator::get_octant_index(
-							to_vec3f(rendered_instance_transform.origin), half_render_block_size
+							rendered_instance_transform.origin, half_render_block_size
 					);
 					if (instance_octant_index == octant_index) {
 						InstanceBlockData::InstanceData d;
-						d.transform = to_transform3f(rendered_instance_transform);
+						d.transform = rendered_instance_transform;
 						layer_data.instances.push_back(d);
 					}
 				}
 			}
 
-		} else if (render_block.scene_instances.size() > 0) {
+		} else if (render_block.scene_instances.size() > 0 || render_block.pending_scene_transforms.size() > 0) {
 			// Scenes
 
 			ZN_PROFILE_SCOPE();
-			const unsigned int instance_count = render_block.scene_instances.size();
+
+			// Instances waiting to be spawned are saved too
+			StdVector<Transform3D> scene_transforms;
+			scene_transforms.reserve(
+					render_block.scene_instances.size() + render_block.pending_scene_transforms.size()
+			);
+			for (const SceneInstance &instance : render_block.scene_instances) {
+				ERR_CONTINUE(instance.root == nullptr);
+				scene_transforms.push_back(instance.root->get_transform());
+			}
+			for (const Transform3D &pending_transform : render_block.pending_scene_transforms) {
+				scene_transforms.push_back(pending_transform);
+			}
+			const unsigned int instance_count = scene_transforms.size();
 
 			const Vector3 render_block_origin = render_block_pos * render_block_size;
 
@@ -1564,17 +2409,13 @@ SaveBlockDataTask *VoxelInstancer::save_block(
 				layer_data.instances.resize(instance_count);
 
 				for (unsigned int instance_index = 0; instance_index < instance_count; ++instance_index) {
-					const SceneInstance instance = render_block.scene_instances[instance_index];
-					ERR_CONTINUE(instance.root == nullptr);
 					layer_data.instances[instance_index].transform =
-							to_transform3f(instance.root->get_transform().translated(-render_block_origin));
+							to_transform3f(scene_transforms[instance_index].translated(-render_block_origin));
 				}
 
 			} else if (render_to_data_factor == 2) {
 				for (unsigned int instance_index = 0; instance_index < instance_count; ++instance_index) {
-					const SceneInstance instance = render_block.scene_instances[instance_index];
-					ERR_CONTINUE(instance.root == nullptr);
-					Transform3D t = instance.root->get_transform();
+					Transform3D t = scene_transforms[instance_index];
 					t.origin -= render_block_origin;
 					const int instance_octant_index =
 							VoxelInstanceGenerator::get_octant_index(to_vec3f(t.origin), half_render_block_size);
@@ -1696,6 +2537,9 @@ void VoxelInstancer::remove_floating_multimesh_instances(
 				block.bodies[instance_index] = moved_rb;
 			}
 		}
+		if (block.compound_transforms.size() > 0) {
+			block.compound_transforms[instance_index] = block.compound_transforms[last_instance_index];
+		}
 
 		--instance_index;
 
@@ -1717,6 +2561,10 @@ void VoxelInstancer::remove_floating_multimesh_instances(
 		if (block.bodies.size() > 0) {
 			block.bodies.resize(instance_count);
 		}
+		if (block.compound_transforms.size() > 0) {
+			block.compound_transforms.resize(instance_count);
+			free_compound_body(block);
+		}
 
 		// Array args;
 		// args.push_back(instance_count);
@@ -1729,6 +2577,65 @@ void VoxelInstancer::remove_floating_multimesh_instances(
 	}
 }
 
+// Same as `remove_floating_multimesh_instances`, for blocks whose instances are rendered in a batch. The batch has to
+// be updated afterward.
+void VoxelInstancer::remove_floating_batched_instances(
+		Block &block,
+		const Transform3D &parent_transform,
+		Box3i p_voxel_box,
+		const VoxelTool &voxel_tool,
+		int block_size_po2
+) {
+	QuantizedInstanceTransforms &instances = block.batched_instances;
+	unsigned int instance_count = instances.size();
+
+	const Vector3 block_global_origin = parent_transform.xform(block.grid_position << block_size_po2);
+
+	for (unsigned int instance_index = 0; instance_index < instance_count; ++instance_index) {
+		const Vector3 local_pos = to_vec3(instances.get_position(instance_index));
+		const Vector3i voxel_pos(math::floor_to_int(local_pos + block_global_origin));
+
+		if (!p_voxel_box.contains(voxel_pos)) {
+			continue;
+		}
+
+		// 1-voxel cheap check without interpolation
+		const float sdf = voxel_tool.get_voxel_f(voxel_pos);
+		if (sdf < -0.0001f) {
+			// Still enough ground
+			continue;
+		}
+
+		const unsigned int last_instance_index = --instance_count;
+		instances.remove_unordered(instance_index);
+
+		if (block.bodies.size() > 0) {
+			VoxelInstancerRigidBody *rb = block.bodies[instance_index];
+			// Detach so it won't try to update our instances, we already do it here
+			rb->detach_and_destroy();
+
+			VoxelInstancerRigidBody *moved_rb = block.bodies[last_instance_index];
+			if (moved_rb != rb) {
+				moved_rb->set_instance_index(instance_index);
+				block.bodies[instance_index] = moved_rb;
+			}
+		}
+		if (block.compound_transforms.size() > 0) {
+			block.compound_transforms[instance_index] = block.compound_transforms[last_instance_index];
+		}
+
+		--instance_index;
+	}
+
+	if (block.bodies.size() > instance_count) {
+		block.bodies.resize(instance_count);
+	}
+	if (block.compound_transforms.size() > instance_count) {
+		block.compound_transforms.resize(instance_count);
+		free_compound_body(block);
+	}
+}
+
 void VoxelInstancer::remove_floating_scene_instances(
 		Block &block,
 		const Transform3D &parent_transform,
@@ -1742,6 +2649,18 @@ void VoxelInstancer::remove_floating_scene_instances(
 	const Transform3D block_global_transform =
 			Transform3D(parent_transform.basis, parent_transform.xform(block.grid_position << block_size_po2));
 
+	// Instances that were not spawned yet
+	for (unsigned int i = 0; i < block.pending_scene_transforms.size(); ++i) {
+		const Vector3i voxel_pos(
+				math::floor_to_int(block.pending_scene_transforms[i].origin + block_global_transform.origin)
+		);
+		if (!p_voxel_box.contains(voxel_pos) || voxel_tool.get_voxel_f(voxel_pos) < -0.1f) {
+			continue;
+		}
+		unordered_remove(block.pending_scene_transforms, i);
+		--i;
+	}
+
 	// Let's check all instances one by one
 	// Note: the fact we have to query VisualServer in and out is pretty bad though.
 	// - We probably have to sync with its thread in MT mode
@@ -1819,14 +2738,20 @@ void VoxelInstancer::on_area_edited(Box3i p_voxel_box) {
 		const Box3i data_blocks_box = p_voxel_box.downscaled(data_block_size << lod_index);
 
 		for (auto layer_it = lod.layers.begin(); layer_it != lod.layers.end(); ++layer_it) {
-			const Layer &layer = get_layer(*layer_it);
+			Layer &layer = get_layer(*layer_it);
 			const StdVector<UniquePtr<Block>> &blocks = _blocks;
 			const int block_size_po2 = base_block_size_po2 + layer.lod_index;
 
 			render_blocks_box.for_each_cell(
-					[layer, &blocks, &voxel_tool, p_voxel_box, parent_transform, block_size_po2, &lod, data_blocks_box](
-							Vector3i block_pos
-					) {
+					[this,
+					 &layer,
+					 &blocks,
+					 &voxel_tool,
+					 p_voxel_box,
+					 parent_transform,
+					 block_size_po2,
+					 &lod,
+					 data_blocks_box](Vector3i block_pos) {
 						const auto block_it = layer.blocks.find(block_pos);
 						if (block_it == layer.blocks.end()) {
 							// No instancing block here
@@ -1835,14 +2760,25 @@ void VoxelInstancer::on_area_edited(Box3i p_voxel_box) {
 
 						Block &block = *blocks[block_it->second];
 
-						if (block.scene_instances.size() > 0) {
+						if (block.scene_instances.size() > 0 || block.pending_scene_transforms.size() > 0) {
 							remove_floating_scene_instances(
 									block, parent_transform, p_voxel_box, voxel_tool, block_size_po2
 							);
+						} else if (block.batched_instances.size() > 0) {
+							const size_t prev_count = block.batched_instances.size();
+							remove_floating_batched_instances(
+									block, parent_transform, p_voxel_box, voxel_tool, block_size_po2
+							);
+							if (block.batched_instances.size() != prev_count) {
+								mark_multimesh_batch_dirty(layer, block_pos);
+							}
 						} else {
 							remove_floating_multimesh_instances(
 									block, parent_transform, p_voxel_box, voxel_tool, block_size_po2
 							);
+							if (block.impostor_instance.is_valid()) {
+								update_block_impostor(block);
+							}
 						}
 
 						// All instances have to be frozen as edited.
@@ -1881,6 +2817,16 @@ void VoxelInstancer::on_body_removed(
 		const Transform3D last_trans = multimesh->get_instance_transform(visible_count);
 		multimesh->set_instance_transform(instance_index, last_trans);
 		multimesh->set_visible_instance_count(visible_count);
+
+		if (block.impostor_instance.is_valid()) {
+			update_block_impostor(block);
+		}
+
+	} else if (block.batched_instances.size() > 0) {
+		// Remove the instance from its batch
+		ERR_FAIL_COND(instance_index >= block.batched_instances.size());
+		block.batched_instances.remove_unordered(instance_index);
+		mark_multimesh_batch_dirty(get_layer(block.layer_id), block.grid_position);
 	}
 
 	// Unregister the body
@@ -1972,7 +2918,7 @@ void VoxelInstancer::debug_get_instance_counts(StdUnorderedMap<uint32_t, uint32_
 	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
 		const Block &block = **it;
 
-		uint32_t count = block.scene_instances.size();
+		uint32_t count = block.scene_instances.size() + block.pending_scene_transforms.size();
 
 		if (block.multimesh_instance.is_valid()) {
 			Ref<MultiMesh> multimesh = block.multimesh_instance.get_multimesh();
@@ -1981,10 +2927,48 @@ void VoxelInstancer::debug_get_instance_counts(StdUnorderedMap<uint32_t, uint32_
 			count += zylann::godot::get_visible_instance_count(**multimesh);
 		}
 
+		count += block.batched_instances.size();
+
 		counts_per_layer[block.layer_id] += count;
 	}
 }
 
+uint64_t VoxelInstancer::get_memory_usage_bytes() const {
+	ZN_PROFILE_SCOPE();
+
+	// Multimeshes store 12 floats per 3D transform. Colors and custom data are not used.
+	const uint64_t multimesh_instance_size = 12 * sizeof(float);
+
+	uint64_t size = 0;
+
+	for (auto it = _blocks.begin(); it != _blocks.end(); ++it) {
+		const Block &block = **it;
+
+		if (block.multimesh_instance.is_valid()) {
+			Ref<MultiMesh> multimesh = block.multimesh_instance.get_multimesh();
+			ZN_ASSERT_CONTINUE(multimesh.is_valid());
+			size += multimesh->get_instance_count() * multimesh_instance_size;
+		}
+
+		size += block.batched_instances.get_memory_usage();
+		size += block.pending_scene_transforms.capacity() * sizeof(Transform3D);
+	}
+
+	for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
+		const Layer &layer = layer_it->second;
+		for (auto it = layer.multimesh_batches.begin(); it != layer.multimesh_batches.end(); ++it) {
+			const MultiMeshBatch &batch = *it->second;
+			if (batch.multimesh_instance.is_valid()) {
+				Ref<MultiMesh> multimesh = batch.multimesh_instance.get_multimesh();
+				ZN_ASSERT_CONTINUE(multimesh.is_valid());
+				size += multimesh->get_instance_count() * multimesh_instance_size;
+			}
+		}
+	}
+
+	return size;
+}
+
 Dictionary VoxelInstancer::_b_debug_get_instance_counts() const {
 	Dictionary d;
 	StdUnorderedMap<uint32_t, uint32_t> map;
@@ -2020,6 +3004,38 @@ Node *VoxelInstancer::debug_dump_as_nodes() const {
 
 	StdUnorderedMap<Ref<Mesh>, Ref<Mesh>> mesh_copies;
 
+	struct L {
+		static void dump_multimesh(
+				const zylann::godot::DirectMultiMeshInstance &multimesh_instance,
+				const Transform3D &local_transform,
+				Node &parent,
+				StdUnorderedMap<Ref<Mesh>, Ref<Mesh>> &mesh_copies
+		) {
+			Ref<MultiMesh> multimesh = multimesh_instance.get_multimesh();
+			ERR_FAIL_COND(multimesh.is_null());
+			Ref<Mesh> src_mesh = multimesh->get_mesh();
+			ERR_FAIL_COND(src_mesh.is_null());
+
+			// Duplicating the meshes because often they don't get saved even with `FLAG_BUNDLE_RESOURCES`
+			auto mesh_copy_it = mesh_copies.find(src_mesh);
+			Ref<Mesh> mesh_copy;
+			if (mesh_copy_it == mesh_copies.end()) {
+				mesh_copy = src_mesh->duplicate();
+				mesh_copies.insert({ src_mesh, mesh_copy });
+			} else {
+				mesh_copy = mesh_copy_it->second;
+			}
+
+			Ref<MultiMesh> multimesh_copy = multimesh->duplicate();
+			multimesh_copy->set_mesh(mesh_copy);
+
+			MultiMeshInstance3D *mmi = memnew(MultiMeshInstance3D);
+			mmi->set_multimesh(multimesh_copy);
+			mmi->set_transform(local_transform);
+			parent.add_child(mmi);
+		}
+	};
+
 	// For each layer
 	for (auto layer_it = _layers.begin(); layer_it != _layers.end(); ++layer_it) {
 		const Layer &layer = layer_it->second;
@@ -2037,33 +3053,22 @@ Node *VoxelInstancer::debug_dump_as_nodes() const {
 
 			if (block.multimesh_instance.is_valid()) {
 				const Transform3D block_local_transform(Basis(), Vector3(block.grid_position * lod_block_size));
-
-				Ref<MultiMesh> multimesh = block.multimesh_instance.get_multimesh();
-				ERR_CONTINUE(multimesh.is_null());
-				Ref<Mesh> src_mesh = multimesh->get_mesh();
-				ERR_CONTINUE(src_mesh.is_null());
-
-				// Duplicating the meshes because often they don't get saved even with `FLAG_BUNDLE_RESOURCES`
-				auto mesh_copy_it = mesh_copies.find(src_mesh);
-				Ref<Mesh> mesh_copy;
-				if (mesh_copy_it == mesh_copies.end()) {
-					mesh_copy = src_mesh->duplicate();
-					mesh_copies.insert({ src_mesh, mesh_copy });
-				} else {
-					mesh_copy = mesh_copy_it->second;
-				}
-
-				Ref<MultiMesh> multimesh_copy = multimesh->duplicate();
-				multimesh_copy->set_mesh(mesh_copy);
-
-				MultiMeshInstance3D *mmi = memnew(MultiMeshInstance3D);
-				mmi->set_multimesh(multimesh_copy);
-				mmi->set_transform(block_local_transform);
-				layer_node->add_child(mmi);
+				L::dump_multimesh(block.multimesh_instance, block_local_transform, *layer_node, mesh_copies);
 			}
 
 			// TODO Dump scene instances too
 		}
+
+		// For each batch in layer
+		for (auto batch_it = layer.multimesh_batches.begin(); batch_it != layer.multimesh_batches.end(); ++batch_it) {
+			const MultiMeshBatch &batch = *batch_it->second;
+			if (batch.multimesh_instance.is_valid()) {
+				const Transform3D batch_local_transform(
+						Basis(), Vector3(batch_it->first * _multimesh_batch_size * lod_block_size)
+				);
+				L::dump_multimesh(batch.multimesh_instance, batch_local_transform, *layer_node, mesh_copies);
+			}
+		}
 	}
 
 	return root;
@@ -2165,6 +3170,9 @@ void VoxelInstancer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_up_mode", "mode"), &VoxelInstancer::set_up_mode);
 	ClassDB::bind_method(D_METHOD("get_up_mode"), &VoxelInstancer::get_up_mode);
 
+	ClassDB::bind_method(D_METHOD("set_multimesh_batch_size", "size"), &VoxelInstancer::set_multimesh_batch_size);
+	ClassDB::bind_method(D_METHOD("get_multimesh_batch_size"), &VoxelInstancer::get_multimesh_batch_size);
+
 	ClassDB::bind_method(D_METHOD("debug_get_block_count"), &VoxelInstancer::debug_get_block_count);
 	ClassDB::bind_method(D_METHOD("debug_get_instance_counts"), &VoxelInstancer::_b_debug_get_instance_counts);
 	ClassDB::bind_method(D_METHOD("debug_dump_as_scene", "fpath"), &VoxelInstancer::debug_dump_as_scene);
@@ -2183,6 +3191,11 @@ void VoxelInstancer::_bind_methods() {
 	ADD_PROPERTY(
 			PropertyInfo(Variant::INT, "up_mode", PROPERTY_HINT_ENUM, "PositiveY,Sphere"), "set_up_mode", "get_up_mode"
 	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "multimesh_batch_size", PROPERTY_HINT_RANGE, "1,8,1"),
+			"set_multimesh_batch_size",
+			"get_multimesh_batch_size"
+	);
 
 	BIND_CONSTANT(MAX_LOD);
 
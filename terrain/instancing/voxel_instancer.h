@@ -5,6 +5,7 @@
 #include "../../streams/instance_data.h"
 #include "../../util/containers/fixed_array.h"
 #include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_queue.h"
 #include "../../util/containers/std_unordered_set.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/node_3d.h"
@@ -53,6 +54,7 @@ class VoxelInstancer : public Node3D, public IInstanceLibraryItemListener {
 	GDCLASS(VoxelInstancer, Node3D)
 public:
 	static const int MAX_LOD = 8;
+	static const int MAX_MULTIMESH_BATCH_SIZE = 8;
 
 	// I didn't want this enum to be here on the C++ side, because it prevents forward-declaring the class it is in.
 	// However Godot is forcing me to.
@@ -71,6 +73,12 @@ public:
 	void set_library(Ref<VoxelInstanceLibrary> library);
 	Ref<VoxelInstanceLibrary> get_library() const;
 
+	// Renders instances of multimesh items with one multimesh per group of blocks along each axis, instead of one per
+	// block. This reduces draw calls and culling work when many blocks are visible, at the cost of uploading the whole
+	// group when one of its blocks changes. 1 means each block has its own multimesh.
+	void set_multimesh_batch_size(int size);
+	int get_multimesh_batch_size() const;
+
 	// Actions
 
 	void save_all_modified_blocks(
@@ -103,10 +111,16 @@ public:
 
 	int get_library_item_id_from_render_block_index(unsigned render_block_index) const;
 
+	// Spawns some of the scene instances waiting to be added to the tree. Returns true if some are still waiting.
+	bool spawn_pending_scene_instances();
+
 	// Debug
 
 	int debug_get_block_count() const;
 	void debug_get_instance_counts(StdUnorderedMap<uint32_t, uint32_t> &counts_per_layer) const;
+
+	// Approximate amount of memory used by instance transforms, including multimesh buffers of the renderer.
+	uint64_t get_memory_usage_bytes() const;
 	void debug_dump_as_scene(String fpath) const;
 	Node *debug_dump_as_nodes() const;
 
@@ -142,6 +156,8 @@ private:
 	void process();
 	void process_task_results();
 	void process_mesh_lods();
+	void process_multimesh_batches();
+	void process_compound_collisions();
 
 	void add_layer(int layer_id, int lod_index);
 	void remove_layer(int layer_id);
@@ -166,6 +182,14 @@ private:
 
 	void regenerate_layer(uint16_t layer_id, bool regenerate_blocks);
 	void update_layer_meshes(int layer_id);
+	void mark_multimesh_batch_dirty(Layer &layer, Vector3i block_position);
+	void update_multimesh_batch(
+			Layer &layer,
+			Vector3i batch_position,
+			const VoxelInstanceLibraryItem &item_base,
+			World3D &world,
+			const Transform3D &parent_transform
+	);
 	void update_layer_scenes(int layer_id);
 	void create_render_blocks(Vector3i grid_position, int lod_index, Array surface_arrays);
 
@@ -187,6 +211,21 @@ private:
 			int data_block_size_po2
 	);
 
+	// Same as `create_scene_instance`, but reuses an instance from the pool of the layer if there is one
+	SceneInstance acquire_scene_instance(
+			Layer &layer,
+			const VoxelInstanceLibrarySceneItem &scene_item,
+			int instance_index,
+			unsigned int block_index,
+			Transform3D transform,
+			int data_block_size_po2
+	);
+	// Removes a scene instance from the tree. It is kept in the pool of the layer if there is room, otherwise it is
+	// freed. `scene_item` may be null if the item no longer exists.
+	void release_scene_instance(Layer &layer, const VoxelInstanceLibrarySceneItem *scene_item, SceneInstance instance);
+	static void clear_scene_instance_pool(Layer &layer);
+	void schedule_scene_instances(const Block &block);
+
 	void update_block_from_transforms(
 			int block_index,
 			Span<const Transform3f> transforms,
@@ -196,7 +235,9 @@ private:
 			uint16_t layer_id,
 			World3D &world,
 			const Transform3D &block_transform,
-			Vector3 block_local_position
+			Vector3 block_local_position,
+			// If not empty, contains `transforms` already packed for `RenderingServer::multimesh_set_buffer`
+			const PackedFloat32Array &packed_buffer
 	);
 
 	void on_library_item_changed(int item_id, IInstanceLibraryItemListener::ChangeType change) override;
@@ -211,6 +252,14 @@ private:
 			int block_size_po2
 	);
 
+	static void remove_floating_batched_instances(
+			Block &block,
+			const Transform3D &parent_transform,
+			Box3i p_voxel_box,
+			const VoxelTool &voxel_tool,
+			int block_size_po2
+	);
+
 	static void remove_floating_scene_instances(
 			Block &block,
 			const Transform3D &parent_transform,
@@ -220,12 +269,26 @@ private:
 	);
 
 	static void update_mesh_from_mesh_lod(
-			Block &block,
+			zylann::godot::DirectMultiMeshInstance &multimesh_instance,
+			zylann::godot::DirectMultiMeshInstance &impostor_instance,
+			unsigned int current_mesh_lod,
 			const InstanceLibraryMultiMeshItemSettings &settings,
-			bool hide_beyond_max_lod,
 			bool instancer_is_visible
 	);
 
+	static void get_block_multimesh_transforms(const Block &block, StdVector<Transform3f> &dst);
+
+	void create_compound_body(
+			Block &block,
+			const InstanceLibraryMultiMeshItemSettings &settings,
+			World3D &world,
+			const Transform3D &block_global_transform
+	);
+	static void free_compound_body(Block &block);
+	void free_compound_bodies();
+	// Rebuilds the impostor of a block that isn't batched, after its instances or the impostor settings changed
+	void update_block_impostor(Block &block);
+
 	Dictionary _b_debug_get_instance_counts() const;
 
 	static void _bind_methods();
@@ -234,7 +297,7 @@ private:
 	struct Block {
 		uint16_t layer_id = 0;
 		// Distance-based LOD index.
-		// Can be one index higher than max mesh lod count in case it should hide beyond last LOD
+		// Can be one index higher than max mesh lod count in case it should hide or use an impostor beyond last LOD
 		uint8_t current_mesh_lod = 0;
 		// LOD index corresponding to the terrain's ground chunk system
 		uint8_t lod_index = 0;
@@ -245,12 +308,35 @@ private:
 		// Position in mesh block coordinate system
 		Vector3i grid_position;
 		zylann::godot::DirectMultiMeshInstance multimesh_instance;
+		// Draws a fraction of instances with the impostor mesh of the item, when beyond the last mesh LOD
+		zylann::godot::DirectMultiMeshInstance impostor_instance;
+		// When multimeshes are batched, the block has no multimesh of its own, and its instances are stored here
+		// instead. Transforms are relative to the block.
+		QuantizedInstanceTransforms batched_instances;
 		// For physics we use nodes because it's easier to manage.
 		// Such instances may be less numerous.
 		// If the item associated to this block has no collisions, this will be empty.
 		// Indices in the vector correspond to index of the instance in multimesh.
 		StdVector<VoxelInstancerRigidBody *> bodies;
+		// If the item uses compound collision, instances have no body nodes. Instead, the block gets a single static
+		// body with shapes for all its instances when a viewer requiring collisions gets close enough. Transforms are
+		// relative to the block, and indices match instances of the block.
+		StdVector<Transform3f> compound_transforms;
+		RID compound_body;
 		StdVector<SceneInstance> scene_instances;
+		// Scene instances waiting to be spawned, which is spread over several frames.
+		// Transforms are relative to the instancer.
+		StdVector<Transform3D> pending_scene_transforms;
+	};
+
+	// Renders multimesh instances of a group of blocks of the same layer
+	struct MultiMeshBatch {
+		zylann::godot::DirectMultiMeshInstance multimesh_instance;
+		zylann::godot::DirectMultiMeshInstance impostor_instance;
+		// Same as in blocks, but for the whole batch
+		uint8_t current_mesh_lod = 0;
+		// If true, instances of one of the blocks changed and the multimesh must be rebuilt
+		bool dirty = false;
 	};
 
 	struct Layer {
@@ -258,6 +344,11 @@ private:
 		// Blocks indexed by grid position.
 		// Keys follow the mesh block coordinate system.
 		StdUnorderedMap<Vector3i, unsigned int> blocks;
+		// Only used when multimeshes are batched. Keys are block positions divided by the batch size.
+		StdUnorderedMap<Vector3i, UniquePtr<MultiMeshBatch>> multimesh_batches;
+		StdVector<Vector3i> dirty_multimesh_batches;
+		// Only used with scene items. Instances removed from the tree, ready to be reused.
+		StdVector<SceneInstance> scene_instance_pool;
 	};
 
 	struct MeshLodDistances {
@@ -317,6 +408,16 @@ private:
 	// Vector3 _mesh_lod_last_update_camera_position;
 	// float _mesh_lod_update_camera_threshold_distance = 8.f;
 	unsigned int _mesh_lod_time_sliced_block_index = 0;
+	int _multimesh_batch_size = 1;
+
+	struct PendingSceneBlock {
+		uint16_t layer_id;
+		Vector3i grid_position;
+	};
+	// Blocks that have scene instances waiting to be spawned, in the order they were loaded. Entries may refer to
+	// blocks that were since removed.
+	StdQueue<PendingSceneBlock> _pending_scene_blocks;
+	bool _scene_spawn_task_scheduled = false;
 
 	std::shared_ptr<InstancerTaskOutputQueue> _loading_results;
 
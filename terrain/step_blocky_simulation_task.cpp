@@ -0,0 +1,221 @@
+#include "step_blocky_simulation_task.h"
+#include "../constants/voxel_constants.h"
+#include "../engine/voxel_engine.h"
+#include "../storage/voxel_data.h"
+#include "../storage/voxel_data_grid.h"
+#include "../util/containers/container_funcs.h"
+#include "../util/containers/std_unordered_map.h"
+#include "../util/errors.h"
+#include "../util/math/funcs.h"
+#include "../util/memory/memory.h"
+#include "../util/profiling.h"
+#include "../util/tasks/async_dependency_tracker.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+// Shared by tasks of one simulation step
+struct StepContext {
+	VolumeID volume_id;
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<const blocky_simulation::ModelProperties> models;
+	uint32_t step_index;
+	std::shared_ptr<StepBlockySimulationTask::State> state;
+
+	StdVector<Vector3i> block_positions;
+	// Active cells of each block, relative to the block
+	StdVector<StdVector<Vector3i>> block_cells;
+	// Each block task writes only results of its own blocks
+	StdVector<blocky_simulation::BlockStepResult> block_results;
+};
+
+inline TaskPriority get_step_priority() {
+	TaskPriority p;
+	p.band2 = constants::TASK_PRIORITY_BLOCKY_SIMULATION_BAND2;
+	return p;
+}
+
+// Steps inner cells of a range of blocks. Each block is locked on its own, so other tasks can step neighbor blocks.
+class StepBlocksTask : public IThreadedTask {
+public:
+	std::shared_ptr<StepContext> context;
+	unsigned int begin_index;
+	unsigned int end_index;
+	std::shared_ptr<AsyncDependencyTracker> tracker;
+
+	const char *get_debug_name() const override {
+		return "StepBlockySimulationBlocks";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		StepContext &c = *context;
+		const unsigned int block_size_po2 = c.data->get_block_size_po2();
+		const Vector3i block_size = Vector3iUtil::create(1 << block_size_po2);
+
+		for (unsigned int i = begin_index; i < end_index; ++i) {
+			const Vector3i bpos = c.block_positions[i];
+			const Vector3i origin = bpos << block_size_po2;
+
+			VoxelDataGrid grid;
+			c.data->get_blocks_grid(grid, Box3i(origin, block_size), 0);
+			VoxelDataGrid::LockWrite wlock(grid);
+			VoxelBuffer *voxels = grid.get_block_no_lock(bpos);
+			if (voxels == nullptr) {
+				// Unloaded since the step started
+				continue;
+			}
+			blocky_simulation::step_block(
+					*voxels, origin, to_span(c.block_cells[i]), *c.models, c.step_index, c.block_results[i]
+			);
+		}
+
+		tracker->post_complete();
+	}
+
+	TaskPriority get_priority() override {
+		return get_step_priority();
+	}
+
+	int get_group() const override {
+		return VoxelEngine::get_volume_task_group(context->volume_id);
+	}
+};
+
+// Steps cells on the borders of blocks after all blocks were stepped, and publishes changes of the whole step
+class StepBorderCellsTask : public IThreadedTask {
+public:
+	std::shared_ptr<StepContext> context;
+
+	const char *get_debug_name() const override {
+		return "StepBlockySimulationBorders";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		StepContext &c = *context;
+		const unsigned int block_size_po2 = c.data->get_block_size_po2();
+		const Vector3i block_size = Vector3iUtil::create(1 << block_size_po2);
+
+		StdVector<Vector3i> changed_cells;
+
+		for (unsigned int i = 0; i < c.block_results.size(); ++i) {
+			blocky_simulation::BlockStepResult &result = c.block_results[i];
+			append_array(changed_cells, result.changed_cells);
+
+			if (result.border_cells.size() == 0) {
+				continue;
+			}
+			// Cells of the border access neighbor voxels
+			VoxelDataGrid grid;
+			c.data->get_blocks_grid(grid, Box3i(c.block_positions[i] << block_size_po2, block_size).padded(1), 0);
+			VoxelDataGrid::LockWrite wlock(grid);
+			blocky_simulation::step_cells(
+					grid, to_span(result.border_cells), *c.models, c.step_index, changed_cells
+			);
+		}
+
+		// Merge changes into one box per block, so meshing and networking only see changed areas
+		StdUnorderedMap<Vector3i, Box3i> changed_boxes_per_block;
+		for (const Vector3i pos : changed_cells) {
+			const Box3i cell_box(pos, Vector3i(1, 1, 1));
+			auto it = changed_boxes_per_block.find(pos >> block_size_po2);
+			if (it == changed_boxes_per_block.end()) {
+				changed_boxes_per_block.insert({ pos >> block_size_po2, cell_box });
+			} else {
+				it->second.merge_with(cell_box);
+			}
+		}
+
+		if (changed_boxes_per_block.size() > 0) {
+			MutexLock mlock(c.state->changed_boxes_mutex);
+			for (auto it = changed_boxes_per_block.begin(); it != changed_boxes_per_block.end(); ++it) {
+				c.state->changed_boxes.push_back(it->second);
+			}
+		}
+
+		c.state->running = false;
+	}
+
+	TaskPriority get_priority() override {
+		return get_step_priority();
+	}
+
+	int get_group() const override {
+		return VoxelEngine::get_volume_task_group(context->volume_id);
+	}
+};
+
+} // namespace
+
+void StepBlockySimulationTask::run(ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(data != nullptr);
+	ZN_ASSERT(models != nullptr);
+	ZN_ASSERT(state != nullptr);
+
+	StdUnorderedMap<Vector3i, StdVector<Vector3i>> cells_per_block;
+
+	for (const Box3i voxel_box : voxel_boxes) {
+		VoxelDataGrid grid;
+		data->get_blocks_grid(grid, voxel_box, 0);
+		VoxelDataGrid::LockRead rlock(grid);
+		blocky_simulation::find_active_cells(grid, *models, voxel_box, cells_per_block);
+	}
+
+	if (cells_per_block.size() == 0) {
+		state->running = false;
+		return;
+	}
+
+	std::shared_ptr<StepContext> context = make_shared_instance<StepContext>();
+	context->volume_id = volume_id;
+	context->data = data;
+	context->models = models;
+	context->step_index = step_index;
+	context->state = state;
+	context->block_positions.reserve(cells_per_block.size());
+	context->block_cells.reserve(cells_per_block.size());
+	for (auto it = cells_per_block.begin(); it != cells_per_block.end(); ++it) {
+		context->block_positions.push_back(it->first);
+		context->block_cells.push_back(std::move(it->second));
+	}
+	context->block_results.resize(context->block_positions.size());
+
+	// Blocks usually have few active cells, so they are grouped to avoid scheduling lots of tiny tasks
+	const unsigned int blocks_per_task = 8;
+	const unsigned int block_count = context->block_positions.size();
+	const unsigned int task_count = (block_count + blocks_per_task - 1) / blocks_per_task;
+
+	StepBorderCellsTask *border_task = ZN_NEW(StepBorderCellsTask);
+	border_task->context = context;
+	IThreadedTask *next_tasks[1] = { border_task };
+
+	std::shared_ptr<AsyncDependencyTracker> tracker = make_shared_instance<AsyncDependencyTracker>(
+			task_count, Span<IThreadedTask *>(next_tasks, 1), [](Span<IThreadedTask *> p_next_tasks) {
+				VoxelEngine::get_singleton().push_async_tasks(p_next_tasks);
+			});
+
+	StdVector<IThreadedTask *> tasks;
+	tasks.reserve(task_count);
+	for (unsigned int begin_index = 0; begin_index < block_count; begin_index += blocks_per_task) {
+		StepBlocksTask *task = ZN_NEW(StepBlocksTask);
+		task->context = context;
+		task->begin_index = begin_index;
+		task->end_index = math::min(begin_index + blocks_per_task, block_count);
+		task->tracker = tracker;
+		tasks.push_back(task);
+	}
+	VoxelEngine::get_singleton().push_async_tasks(to_span(tasks));
+}
+
+TaskPriority StepBlockySimulationTask::get_priority() {
+	return get_step_priority();
+}
+
+int StepBlockySimulationTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,50 @@
+#ifndef VOXEL_STEP_BLOCKY_SIMULATION_TASK_H
+#define VOXEL_STEP_BLOCKY_SIMULATION_TASK_H
+
+#include "../engine/ids.h"
+#include "../storage/blocky_simulation.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+#include "../util/tasks/threaded_task.h"
+#include "../util/thread/mutex.h"
+#include <atomic>
+#include <memory>
+
+namespace zylann::voxel {
+
+class VoxelData;
+
+// Runs one step of the simulation of blocky voxels, in areas where voxels changed or blocks were loaded.
+// This task finds active cells, then schedules one task per group of blocks to step them in parallel. A last task
+// steps cells on the borders of blocks once they are done.
+class StepBlockySimulationTask : public IThreadedTask {
+public:
+	// Shared with the terrain scheduling the task
+	struct State {
+		// Set until the step completes, so only one runs at a time
+		std::atomic_bool running = { false };
+		// Boxes of voxels changed by the step, at most one per block
+		StdVector<Box3i> changed_boxes;
+		Mutex changed_boxes_mutex;
+	};
+
+	VolumeID volume_id;
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<const blocky_simulation::ModelProperties> models;
+	uint32_t step_index = 0;
+	// Areas where voxels may be simulated
+	StdVector<Box3i> voxel_boxes;
+	std::shared_ptr<State> state;
+
+	const char *get_debug_name() const override {
+		return "StepBlockySimulation";
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+	int get_group() const override;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_STEP_BLOCKY_SIMULATION_TASK_H
@@ -0,0 +1,49 @@
+#include "update_blocky_light_task.h"
+#include "../constants/voxel_constants.h"
+#include "../engine/voxel_engine.h"
+#include "../storage/voxel_data.h"
+#include "../storage/voxel_data_grid.h"
+#include "../util/containers/container_funcs.h"
+#include "../util/errors.h"
+#include "../util/profiling.h"
+
+namespace zylann::voxel {
+
+void UpdateBlockyLightTask::run(ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(data != nullptr);
+	ZN_ASSERT(models != nullptr);
+	ZN_ASSERT(state != nullptr);
+
+	StdVector<Box3i> changed_boxes;
+
+	for (const Box3i voxel_box : voxel_boxes) {
+		// Boxes are handled one by one so they don't lock a huge area when they are far apart
+		VoxelDataGrid grid;
+		data->get_blocks_grid(grid, voxel_box.padded(blocky_light::MAX_UPDATE_DISTANCE), 0);
+		VoxelDataGrid::LockWrite wlock(grid);
+		// Light is derived from voxel types, so blocks are not marked as modified
+		blocky_light::update_area(grid, *models, channel, voxel_box, changed_boxes);
+	}
+
+	if (changed_boxes.size() > 0) {
+		MutexLock mlock(state->changed_boxes_mutex);
+		append_array(state->changed_boxes, changed_boxes);
+		state->changed_by_edit |= caused_by_edit;
+	}
+
+	state->running = false;
+}
+
+TaskPriority UpdateBlockyLightTask::get_priority() {
+	TaskPriority p;
+	p.band2 = constants::TASK_PRIORITY_BLOCKY_LIGHT_BAND2;
+	p.band3 = caused_by_edit ? constants::TASK_PRIORITY_BAND3_EDIT : constants::TASK_PRIORITY_BAND3_DEFAULT;
+	return p;
+}
+
+int UpdateBlockyLightTask::get_group() const {
+	return VoxelEngine::get_volume_task_group(volume_id);
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,50 @@
+#ifndef VOXEL_UPDATE_BLOCKY_LIGHT_TASK_H
+#define VOXEL_UPDATE_BLOCKY_LIGHT_TASK_H
+
+#include "../engine/ids.h"
+#include "../storage/blocky_light.h"
+#include "../util/containers/std_vector.h"
+#include "../util/math/box3i.h"
+#include "../util/tasks/threaded_task.h"
+#include "../util/thread/mutex.h"
+#include <atomic>
+#include <memory>
+
+namespace zylann::voxel {
+
+class VoxelData;
+
+// Computes light levels of blocky voxels again in areas where voxels changed or blocks were loaded.
+class UpdateBlockyLightTask : public IThreadedTask {
+public:
+	// Shared with the terrain scheduling the task
+	struct State {
+		// Set until the task completes, so only one runs at a time
+		std::atomic_bool running = { false };
+		// Boxes of voxels where light changed, which need to be meshed again
+		StdVector<Box3i> changed_boxes;
+		// True if the light changed because of edits
+		bool changed_by_edit = false;
+		Mutex changed_boxes_mutex;
+	};
+
+	VolumeID volume_id;
+	std::shared_ptr<VoxelData> data;
+	std::shared_ptr<const blocky_light::ModelProperties> models;
+	uint8_t channel;
+	StdVector<Box3i> voxel_boxes;
+	bool caused_by_edit = false;
+	std::shared_ptr<State> state;
+
+	const char *get_debug_name() const override {
+		return "UpdateBlockyLight";
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+	int get_group() const override;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_UPDATE_BLOCKY_LIGHT_TASK_H
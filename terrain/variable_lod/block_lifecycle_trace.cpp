@@ -0,0 +1,87 @@
+#include "block_lifecycle_trace.h"
+#include "../../constants/voxel_constants.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/errors.h"
+#include "../../util/godot/classes/time.h"
+#include "../../util/math/funcs.h"
+
+namespace zylann::voxel {
+
+void BlockLifecycleTrace::set_enabled(bool enabled) {
+	MutexLock mlock(_mutex);
+	if (enabled && _events.size() == 0) {
+		_events.resize(DEFAULT_CAPACITY);
+	}
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void BlockLifecycleTrace::add_event(Stage stage, Vector3i position, uint8_t lod_index) {
+	const uint64_t time_usec = Time::get_singleton()->get_ticks_usec();
+	MutexLock mlock(_mutex);
+	if (_events.size() == 0) {
+		// Disabled while we were about to add the event
+		return;
+	}
+	_events[_next_index] = Event{ time_usec, position, lod_index, stage };
+	++_next_index;
+	if (_next_index == _events.size()) {
+		_next_index = 0;
+		_full = true;
+	}
+}
+
+void BlockLifecycleTrace::clear() {
+	MutexLock mlock(_mutex);
+	_next_index = 0;
+	_full = false;
+}
+
+void BlockLifecycleTrace::get_events(StdVector<Event> &out_events) const {
+	MutexLock mlock(_mutex);
+	out_events.clear();
+	if (_full) {
+		out_events.insert(out_events.end(), _events.begin() + _next_index, _events.end());
+	}
+	out_events.insert(out_events.end(), _events.begin(), _events.begin() + _next_index);
+}
+
+void BlockLifecycleTrace::get_stage_latencies(FixedArray<StageLatency, STAGE_COUNT> &out_latencies) const {
+	StdVector<Event> events;
+	get_events(events);
+
+	fill(out_latencies, StageLatency());
+
+	// Time of the last event of each block, per LOD, for data blocks and then mesh blocks
+	FixedArray<StdUnorderedMap<Vector3i, uint64_t>, 2 * constants::MAX_LOD> last_times;
+
+	for (const Event &event : events) {
+		ZN_ASSERT_CONTINUE(event.lod_index < constants::MAX_LOD);
+		const bool is_mesh_stage = event.stage >= STAGE_MESH_QUEUED;
+		const unsigned int map_index = is_mesh_stage ? constants::MAX_LOD + event.lod_index : event.lod_index;
+		StdUnorderedMap<Vector3i, uint64_t> &map = last_times[map_index];
+
+		auto it = map.find(event.position);
+		if (it == map.end()) {
+			map.insert({ event.position, event.time_usec });
+			continue;
+		}
+
+		const uint64_t duration = event.time_usec - it->second;
+		it->second = event.time_usec;
+
+		StageLatency &latency = out_latencies[event.stage];
+		++latency.count;
+		latency.total_usec += duration;
+		latency.max_usec = math::max(latency.max_usec, duration);
+	}
+}
+
+const char *BlockLifecycleTrace::get_stage_name(Stage stage) {
+	static const char *s_names[STAGE_COUNT] = {
+		"load_queued", "generate_queued", "loaded", "generated", "mesh_queued", "meshed", "uploaded", "visible"
+	};
+	ZN_ASSERT_RETURN_V(stage < STAGE_COUNT, "");
+	return s_names[stage];
+}
+
+} // namespace zylann::voxel
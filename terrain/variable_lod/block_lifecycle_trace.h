@@ -0,0 +1,87 @@
+#ifndef VOXEL_BLOCK_LIFECYCLE_TRACE_H
+#define VOXEL_BLOCK_LIFECYCLE_TRACE_H
+
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/vector3i.h"
+#include "../../util/thread/mutex.h"
+#include <atomic>
+#include <cstdint>
+
+namespace zylann::voxel {
+
+// Optional record of the times at which blocks of a terrain go through each stage of streaming, to find out why some
+// of them take long to appear. Events are kept in a ring buffer, so only the most recent ones are available.
+// Recording can be done from the main thread and the update task.
+class BlockLifecycleTrace {
+public:
+	enum Stage : uint8_t {
+		// Data block stages, positions are in data blocks
+		STAGE_LOAD_QUEUED,
+		STAGE_GENERATE_QUEUED,
+		STAGE_LOADED,
+		STAGE_GENERATED,
+		// Mesh block stages, positions are in mesh blocks
+		STAGE_MESH_QUEUED,
+		STAGE_MESHED,
+		STAGE_UPLOADED,
+		STAGE_VISIBLE,
+
+		STAGE_COUNT
+	};
+
+	struct Event {
+		uint64_t time_usec;
+		Vector3i position;
+		uint8_t lod_index;
+		Stage stage;
+	};
+
+	struct StageLatency {
+		// Number of events of the stage which had a previous event for the same block
+		uint32_t count = 0;
+		// Time since the previous event of the same block
+		uint64_t total_usec = 0;
+		uint64_t max_usec = 0;
+	};
+
+	static const unsigned int DEFAULT_CAPACITY = 65536;
+
+	// Memory for events is only allocated when enabled.
+	void set_enabled(bool enabled);
+
+	inline bool is_enabled() const {
+		return _enabled.load(std::memory_order_relaxed);
+	}
+
+	inline void add(Stage stage, Vector3i position, uint8_t lod_index) {
+		if (is_enabled()) {
+			add_event(stage, position, lod_index);
+		}
+	}
+
+	void clear();
+
+	// Gets events from oldest to newest
+	void get_events(StdVector<Event> &out_events) const;
+
+	// For each stage, gets how long blocks took to reach it since the previous stage they went through. Data and mesh
+	// stages are tracked separately, since they use different block positions.
+	void get_stage_latencies(FixedArray<StageLatency, STAGE_COUNT> &out_latencies) const;
+
+	static const char *get_stage_name(Stage stage);
+
+private:
+	void add_event(Stage stage, Vector3i position, uint8_t lod_index);
+
+	std::atomic_bool _enabled = { false };
+	StdVector<Event> _events;
+	// Where the next event will be written. Events wrap around when the buffer is full.
+	unsigned int _next_index = 0;
+	bool _full = false;
+	mutable BinaryMutex _mutex;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_BLOCK_LIFECYCLE_TRACE_H
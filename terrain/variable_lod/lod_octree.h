@@ -3,6 +3,7 @@
 
 #include "../../util/containers/std_vector.h"
 #include "../../util/math/box3i.h"
+#include "../../util/profiling.h"
 
 namespace zylann::voxel {
 
@@ -115,6 +116,16 @@ public:
 				update(ROOT_INDEX, Vector3i(), _max_depth, actions);
 			}
 		}
+
+		if (_pool.is_fragmented()) {
+			optimize_layout();
+		}
+	}
+
+	// Re-orders nodes in memory so they are stored in the same order traversals visit them, and removes holes left by
+	// joined nodes. This is done automatically by `update` when the layout became too scattered.
+	void optimize_layout() {
+		_pool.compact(_root);
 	}
 
 	static inline Vector3i get_child_position(Vector3i parent_position, unsigned int i) {
@@ -239,6 +250,8 @@ private:
 			} else {
 				unsigned int i0 = _free_indexes[_free_indexes.size() - 1];
 				_free_indexes.pop_back();
+				// Re-used packs are out of traversal order
+				++_unordered_pack_count;
 				return i0;
 			}
 		}
@@ -258,13 +271,57 @@ private:
 		void clear() {
 			_nodes.clear();
 			_free_indexes.clear();
+			_unordered_pack_count = 0;
+		}
+
+		// Tells if enough packs are out of traversal order or free to be worth compacting.
+		inline bool is_fragmented() const {
+			const unsigned int pack_count = _nodes.size() / 8;
+			// Unordered packs are counted when re-used, free packs are holes
+			return pack_count >= MIN_PACKS_TO_COMPACT &&
+					4 * (_unordered_pack_count + _free_indexes.size()) > pack_count;
+		}
+
+		// Moves all nodes reachable from the root into a new contiguous array, in the order depth-first traversals
+		// visit them, which is also the order in which they get allocated when an octree is subdivided for the first
+		// time. Sibling packs are therefore next to each other in memory, and each pack is followed by the packs of
+		// its descendants.
+		void compact(Node &root) {
+			ZN_PROFILE_SCOPE();
+			StdVector<Node> nodes;
+			nodes.reserve(_nodes.size() - _free_indexes.size() * 8);
+			if (root.has_children()) {
+				root.first_child = append_children_recursive(root.first_child, nodes);
+			}
+			_nodes = std::move(nodes);
+			_free_indexes.clear();
+			_unordered_pack_count = 0;
 		}
 
 	private:
+		unsigned int append_children_recursive(unsigned int src_first_child, StdVector<Node> &dst) const {
+			const unsigned int dst_first_child = dst.size();
+			for (unsigned int i = 0; i < 8; ++i) {
+				dst.push_back(_nodes[src_first_child + i]);
+			}
+			for (unsigned int i = 0; i < 8; ++i) {
+				const Node &src_child = _nodes[src_first_child + i];
+				if (src_child.has_children()) {
+					dst[dst_first_child + i].first_child = append_children_recursive(src_child.first_child, dst);
+				}
+			}
+			return dst_first_child;
+		}
+
+		// Small octrees fit in cache anyways
+		static const unsigned int MIN_PACKS_TO_COMPACT = 8;
+
 		// TODO If this grows too much, mayyybe could implement a paged vector to fight fragmentation.
 		// If we do so, that may also solve pointer invalidation since pages would remain stable
 		StdVector<Node> _nodes;
 		StdVector<unsigned int> _free_indexes;
+		// Number of packs allocated from free indexes since the last compaction
+		unsigned int _unordered_pack_count = 0;
 	};
 
 	inline Node *get_node(unsigned int index) {
@@ -9,6 +9,7 @@
 #include "../../meshers/transvoxel/voxel_mesher_transvoxel.h"
 #include "../../storage/voxel_buffer_gd.h"
 #include "../../streams/load_all_blocks_data_task.h"
+#include "../../streams/mesh_block_serializer.h"
 #include "../../util/containers/container_funcs.h"
 #include "../../util/containers/std_unordered_set.h"
 #include "../../util/godot/classes/base_material_3d.h" // For property hint in release mode in GDExtension...
@@ -24,6 +25,7 @@
 #include "../../util/godot/classes/shader.h"
 #include "../../util/godot/classes/viewport.h"
 #include "../../util/godot/core/array.h"
+#include "../../util/godot/core/packed_arrays.h"
 #include "../../util/godot/core/string.h"
 #include "../../util/math/color.h"
 #include "../../util/math/conv.h"
@@ -36,7 +38,9 @@
 #include "../free_mesh_task.h"
 #include "../instancing/voxel_instancer.h"
 #include "../voxel_save_completion_tracker.h"
+#include "voxel_lod_terrain_multiplayer_synchronizer.h"
 #include "voxel_lod_terrain_update_task.h"
+#include <algorithm>
 
 namespace zylann::voxel {
 
@@ -54,8 +58,11 @@ void remove_shader_material_from_block(VoxelMeshBlockVLT &block, ShaderMaterialP
 
 struct BeforeUnloadMeshAction {
 	ShaderMaterialPoolVLT &shader_material_pool;
+	zylann::godot::DirectMeshInstancePool &mesh_instance_pool;
 	void operator()(VoxelMeshBlockVLT &block) {
 		remove_shader_material_from_block(block, shader_material_pool);
+		// Instances are re-used by blocks entering view later, which is cheaper than freeing and creating them
+		block.drop_visuals(mesh_instance_pool);
 	}
 };
 
@@ -63,6 +70,10 @@ inline uint64_t get_ticks_msec() {
 	return Time::get_singleton()->get_ticks_msec();
 }
 
+inline uint64_t get_ticks_usec() {
+	return Time::get_singleton()->get_ticks_usec();
+}
+
 inline void copy_param(ShaderMaterial &src, ShaderMaterial &dst, const StringName &name) {
 	dst.set_shader_parameter(name, src.get_shader_parameter(name));
 }
@@ -75,8 +86,6 @@ void copy_vlt_block_params(ShaderMaterial &src, ShaderMaterial &dst) {
 	copy_param(src, dst, sn.u_voxel_virtual_texture_offset_scale);
 	copy_param(src, dst, sn.u_voxel_cell_size);
 	copy_param(src, dst, sn.u_voxel_virtual_texture_fade);
-	copy_param(src, dst, sn.u_transition_mask);
-	copy_param(src, dst, sn.u_lod_fade);
 	copy_param(src, dst, sn.u_voxel_lod_info);
 }
 
@@ -157,6 +166,10 @@ VoxelLodTerrain::VoxelLodTerrain() {
 		VoxelLodTerrain *self = reinterpret_cast<VoxelLodTerrain *>(cb_data);
 		self->apply_detail_texture_update(ob);
 	};
+	callbacks.memory_usage_callback = [](void *cb_data, VolumeMemoryUsage &usage) {
+		const VoxelLodTerrain *self = reinterpret_cast<const VoxelLodTerrain *>(cb_data);
+		self->get_memory_usage(usage);
+	};
 
 	_volume_id = VoxelEngine::get_singleton().add_volume(callbacks);
 	// VoxelEngine::get_singleton().set_volume_octree_lod_distance(_volume_id, get_lod_distance());
@@ -194,6 +207,9 @@ void VoxelLodTerrain::set_material(Ref<Material> p_material) {
 	// TODO Update existing block surfaces
 	_material = p_material;
 
+	// Clusters will be built again with the new material
+	clear_mesh_clusters();
+
 	Ref<ShaderMaterial> shader_material = p_material;
 	const unsigned int lod_count = get_lod_count();
 
@@ -239,7 +255,8 @@ void VoxelLodTerrain::set_material(Ref<Material> p_material) {
 				Ref<ShaderMaterial> prev_material = block.get_shader_material();
 				if (prev_material.is_valid()) {
 					ZN_ASSERT_RETURN(sm.is_valid());
-					// Each block can have specific shader parameters so we have to keep them
+					// Each block can have specific shader parameters so we have to keep them.
+					// Transition mask and LOD fade are not copied, `set_shader_material` writes them.
 					copy_vlt_block_params(**prev_material, **sm);
 				}
 				// Do after copy, because otherwise it would be overwritten by default value
@@ -352,6 +369,11 @@ void VoxelLodTerrain::_on_gi_mode_changed() {
 		_mesh_maps_per_lod[lod_index].for_each_block([gi_mode](VoxelMeshBlockVLT &block) { //
 			block.set_gi_mode(gi_mode);
 		});
+		for (auto &it : _mesh_clusters_per_lod[lod_index]) {
+			if (it.second.mesh_instance.is_valid()) {
+				it.second.mesh_instance.set_gi_mode(gi_mode);
+			}
+		}
 	}
 }
 
@@ -361,6 +383,11 @@ void VoxelLodTerrain::_on_shadow_casting_changed() {
 		_mesh_maps_per_lod[lod_index].for_each_block([mode](VoxelMeshBlockVLT &block) { //
 			block.set_shadow_casting(mode);
 		});
+		for (auto &it : _mesh_clusters_per_lod[lod_index]) {
+			if (it.second.mesh_instance.is_valid()) {
+				it.second.mesh_instance.set_cast_shadows_setting(mode);
+			}
+		}
 	}
 }
 
@@ -370,6 +397,11 @@ void VoxelLodTerrain::_on_render_layers_mask_changed() {
 		_mesh_maps_per_lod[lod_index].for_each_block([mask](VoxelMeshBlockVLT &block) { //
 			block.set_render_layers_mask(mask);
 		});
+		for (auto &it : _mesh_clusters_per_lod[lod_index]) {
+			if (it.second.mesh_instance.is_valid()) {
+				it.second.mesh_instance.set_render_layers_mask(mask);
+			}
+		}
 	}
 }
 
@@ -393,6 +425,7 @@ void VoxelLodTerrain::set_mesher(Ref<VoxelMesher> p_mesher) {
 	update_shader_material_pool_template();
 
 	MeshingDependency::reset(_meshing_dependency, _mesher, get_generator());
+	update_baked_mesh_settings();
 
 	if (_mesher.is_valid()) {
 		start_updater();
@@ -445,6 +478,7 @@ void VoxelLodTerrain::_on_stream_params_changed() {
 
 	_update_data->wait_for_end_of_task();
 	_update_data->state.octree_streaming.force_update_octrees_next_update = true;
+	update_baked_mesh_settings();
 
 	// The whole map might change, so make all area dirty
 	const unsigned int lod_count = get_lod_count();
@@ -486,6 +520,7 @@ void VoxelLodTerrain::set_mesh_block_size(unsigned int mesh_block_size) {
 	ZN_ASSERT(_update_data->task_is_complete);
 	_update_data->settings.mesh_block_size_po2 = po2;
 	_update_data->state.octree_streaming.force_update_octrees_next_update = true;
+	update_baked_mesh_settings();
 
 	// Doing this after because `on_mesh_block_exit` may use the old size
 	if (_instancer != nullptr) {
@@ -537,28 +572,43 @@ void VoxelLodTerrain::set_mesh_block_visual_active(
 	// TODO Shouldn't we switch colliders with `active` instead of `visible`?
 	block.visual_active = active;
 
+	if (active) {
+		_update_data->state.block_trace.add(BlockLifecycleTrace::STAGE_VISIBLE, block.position, lod_index);
+	}
+
+	_detail_texture_budget.set_visible(block.position, lod_index, active, get_ticks_msec());
+
+	if (active && block.detail_texture_evicted) {
+		// The detail texture was evicted while the block was hidden. Use the parent's one until it is computed again.
+		block.detail_texture_evicted = false;
+		try_apply_parent_detail_texture_to_block(block, block.position, lod_index);
+
+		// This runs after the update task completed so we can access its state
+		VoxelLodTerrainUpdateData::Lod &lod = _update_data->state.lods[lod_index];
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_state = lod.mesh_map_state.map.find(block.position);
+		if (mesh_block_state != nullptr) {
+			VoxelLodTerrainUpdateTask::schedule_mesh_update(
+					*mesh_block_state, block.position, lod.mesh_blocks_pending_update, true
+			);
+		}
+	}
+
 	if (!with_fading) {
 		block.set_visible(active);
 
 		// Cancel fading if already in progress
 		if (block.fading_state != VoxelMeshBlockVLT::FADING_NONE) {
-			block.fading_state = VoxelMeshBlockVLT::FADING_NONE;
-
 			_fading_blocks_per_lod[lod_index].erase(block.position);
 
-			Ref<ShaderMaterial> mat = block.get_shader_material();
-			if (mat.is_valid()) {
-				mat->set_shader_parameter(VoxelStringNames::get_singleton().u_lod_fade, Vector2(0.0, 0.0));
-			}
+			block.clear_fading();
+			queue_shader_params_update(block, lod_index);
 
 		} else if (active && _lod_fade_duration > 0.f) {
 			// WHen LOD fade is enabled, it is possible that a block is disabled with a fade out, but later has to be
 			// enabled without a fade-in (because behind the camera for example). In this case we have to reset the
 			// parameter. Otherwise, it would be active but invisible due to still being faded out.
-			Ref<ShaderMaterial> mat = block.get_shader_material();
-			if (mat.is_valid()) {
-				mat->set_shader_parameter(VoxelStringNames::get_singleton().u_lod_fade, Vector2(0.0, 0.0));
-			}
+			block.clear_fading();
+			queue_shader_params_update(block, lod_index);
 		}
 
 		return;
@@ -599,6 +649,9 @@ void VoxelLodTerrain::post_edit_area(Box3i p_box, bool update_mesh) {
 		_update_data->state.edit_notifications.edited_voxel_areas_lod0.push_back(p_box);
 	}
 
+	_connectivity_cache.invalidate_area(p_box);
+	_random_tick_index.invalidate_area(p_box);
+
 #ifdef TOOLS_ENABLED
 	if (debug_is_draw_enabled() && debug_get_draw_flag(DEBUG_DRAW_EDIT_BOXES)) {
 		_debug_edit_items.push_back({ p_box, DebugEditItem::LINGER_FRAMES });
@@ -608,12 +661,17 @@ void VoxelLodTerrain::post_edit_area(Box3i p_box, bool update_mesh) {
 	if (_instancer != nullptr && update_mesh) {
 		_instancer->on_area_edited(p_box);
 	}
+
+	if (_multiplayer_synchronizer != nullptr && _multiplayer_synchronizer->is_server()) {
+		_multiplayer_synchronizer->send_area(p_box);
+	}
 }
 
 void VoxelLodTerrain::post_edit_modifiers(Box3i p_voxel_box) {
 	// clear_cached_blocks_in_voxel_area(*_data, p_voxel_box);
 	_data->clear_cached_blocks_in_voxel_area(p_voxel_box);
 	// Not sure if it is worth re-caching these blocks. We may see about that in the future if performance is an issue.
+	_connectivity_cache.invalidate_area(p_voxel_box);
 
 	MutexLock lock(_update_data->state.changed_generated_areas_mutex);
 	_update_data->state.changed_generated_areas.push_back(p_voxel_box);
@@ -625,7 +683,12 @@ void VoxelLodTerrain::post_edit_modifiers(Box3i p_voxel_box) {
 #endif
 }
 
-void VoxelLodTerrain::push_async_edit(IThreadedTask *task, Box3i box, std::shared_ptr<AsyncDependencyTracker> tracker) {
+void VoxelLodTerrain::push_async_edit(
+		IThreadedTask *task,
+		Box3i box,
+		std::shared_ptr<AsyncDependencyTracker> tracker,
+		bool read_only
+) {
 	CRASH_COND(task == nullptr);
 	CRASH_COND(tracker == nullptr);
 
@@ -633,6 +696,7 @@ void VoxelLodTerrain::push_async_edit(IThreadedTask *task, Box3i box, std::share
 	e.box = box;
 	e.task = task;
 	e.task_tracker = tracker;
+	e.read_only = read_only;
 
 	VoxelLodTerrainUpdateData::State &state = _update_data->state;
 	MutexLock lock(state.pending_async_edits_mutex);
@@ -671,6 +735,31 @@ void VoxelLodTerrain::start_updater() {
 			library->bake();
 		}
 	}
+	update_type_majority_downscaling();
+}
+
+void VoxelLodTerrain::update_type_majority_downscaling() {
+	// Blocky meshers render voxel types. Averaging or picking one voxel out of 8 when building LOD mips would make
+	// thin structures disappear or flicker, so the most common type is used instead.
+	std::shared_ptr<const VoxelBlockyLibraryBase::BakedData> baked_data;
+	Ref<VoxelMesherBlocky> blocky_mesher = _mesher;
+	if (blocky_mesher.is_valid()) {
+		Ref<VoxelBlockyLibraryBase> library = blocky_mesher->get_library();
+		if (library.is_valid()) {
+			baked_data = library->get_baked_data_snapshot();
+		}
+	}
+
+	if (baked_data == _type_downscaling_baked_data) {
+		return;
+	}
+	_type_downscaling_baked_data = baked_data;
+
+	StdVector<uint16_t> lod_replacements;
+	if (baked_data != nullptr) {
+		get_lod_replacements(*baked_data, lod_replacements);
+	}
+	_data->set_type_majority_downscaling(baked_data != nullptr, std::move(lod_replacements));
 }
 
 void VoxelLodTerrain::stop_updater() {
@@ -693,14 +782,13 @@ void VoxelLodTerrain::stop_updater() {
 		}
 		lod.mesh_blocks_pending_update.clear();
 
-		for (auto it = lod.mesh_map_state.map.begin(); it != lod.mesh_map_state.map.end(); ++it) {
-			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = it->second;
+		lod.mesh_map_state.map.for_each([](const Vector3i bpos, VoxelLodTerrainUpdateData::MeshBlockState &mesh_block) {
 			if (mesh_block.state == VoxelLodTerrainUpdateData::MESH_UPDATE_SENT) {
 				mesh_block.state = VoxelLodTerrainUpdateData::MESH_UPDATE_NOT_SENT;
 			}
 			// We cleared the list so we may clear this index
 			mesh_block.update_list_index = -1;
-		}
+		});
 	}
 }
 
@@ -857,6 +945,8 @@ void VoxelLodTerrain::reset_maps() {
 	_update_data->wait_for_end_of_task();
 
 	_data->reset_maps();
+	_connectivity_cache.clear();
+	_random_tick_index.clear();
 
 	abort_async_edits();
 
@@ -866,6 +956,9 @@ void VoxelLodTerrain::reset_maps() {
 void VoxelLodTerrain::reset_mesh_maps() {
 	_update_data->wait_for_end_of_task();
 
+	// Before blocks are destroyed, since clusters refer to them
+	clear_mesh_clusters();
+
 	const unsigned int lod_count = get_lod_count();
 	VoxelLodTerrainUpdateData::State &state = _update_data->state;
 
@@ -881,7 +974,7 @@ void VoxelLodTerrain::reset_mesh_maps() {
 			});
 		}
 
-		// mesh_map.for_each_block(BeforeUnloadMeshAction{ _shader_material_pool });
+		// mesh_map.for_each_block(BeforeUnloadMeshAction{ _shader_material_pool, _mesh_instance_pool });
 
 		// Instance new maps if we have more lods, or clear them otherwise
 		if (lod_index < lod_count) {
@@ -904,8 +997,11 @@ void VoxelLodTerrain::reset_mesh_maps() {
 		lod.mesh_blocks_to_update_transitions.clear();
 
 		_deferred_collision_updates_per_lod[lod_index].clear();
+		_shader_params_updates_per_lod[lod_index].clear();
 	}
 
+	_detail_texture_budget.clear();
+
 	// Reset LOD octrees
 	LodOctree::NoDestroyAction nda;
 	for (StdMap<Vector3i, VoxelLodTerrainUpdateData::OctreeItem>::iterator it =
@@ -921,6 +1017,7 @@ void VoxelLodTerrain::reset_mesh_maps() {
 	state.octree_streaming.lod_octrees.clear();
 	// No need to care about refcounts, we drop everything anyways. Will pair it back on next process.
 	state.clipbox_streaming.paired_viewers.clear();
+	state.clipbox_streaming.streaming_regions.clear();
 	state.clipbox_streaming.loaded_data_blocks.clear();
 	state.clipbox_streaming.loaded_mesh_blocks.clear();
 }
@@ -940,6 +1037,7 @@ bool VoxelLodTerrain::get_generate_collisions() const {
 void VoxelLodTerrain::set_collision_lod_count(int lod_count) {
 	ERR_FAIL_COND(lod_count < 0);
 	_collision_lod_count = static_cast<unsigned int>(math::min(lod_count, get_lod_count()));
+	_update_data->settings.collision_lod_count = _collision_lod_count;
 }
 
 int VoxelLodTerrain::get_collision_lod_count() const {
@@ -1090,6 +1188,7 @@ void VoxelLodTerrain::_notification(int p_what) {
 					block.set_world(nullptr);
 				});
 			}
+			clear_mesh_clusters();
 #ifdef TOOLS_ENABLED
 			_debug_renderer.set_world(nullptr);
 #endif
@@ -1105,6 +1204,9 @@ void VoxelLodTerrain::_notification(int p_what) {
 					block.set_parent_visible(visible);
 				});
 			}
+			if (!visible) {
+				clear_mesh_clusters();
+			}
 
 #ifdef TOOLS_ENABLED
 			if (debug_is_draw_enabled()) {
@@ -1137,6 +1239,15 @@ void VoxelLodTerrain::_notification(int p_what) {
 			for (FadingOutMesh &item : _fading_out_meshes) {
 				item.mesh_instance.set_transform(transform * Transform3D(Basis(), item.local_position));
 			}
+
+			for (unsigned int lod_index = 0; lod_index < _mesh_clusters_per_lod.size(); ++lod_index) {
+				for (auto &it : _mesh_clusters_per_lod[lod_index]) {
+					VoxelMeshClusterVLT &cluster = it.second;
+					if (cluster.mesh_instance.is_valid()) {
+						cluster.mesh_instance.set_transform(transform * Transform3D(Basis(), cluster.origin_in_voxels));
+					}
+				}
+			}
 		} break;
 
 		default:
@@ -1174,6 +1285,9 @@ void VoxelLodTerrain::process(float delta) {
 		return;
 	}
 
+	// The library can be modified at any time
+	update_type_majority_downscaling();
+
 	// TODO It is currently not possible to fully compile those shaders on the fly in a thread.
 	// The GLSL functions of VoxelGenerator need to be thread-safe. Compiling should be safe, but getting the source
 	// code isn't. VoxelGeneratorGraph's shader generation is not thread-safe, because it accesses its graph.
@@ -1260,6 +1374,12 @@ void VoxelLodTerrain::process(float delta) {
 
 	// Do it after we change mesh block states so materials are updated
 	process_fading_blocks(delta);
+
+	// Do it after every change of transition masks and fading of this frame
+	flush_shader_params_updates();
+
+	// Do it last so blocks that changed this frame are no longer hidden by outdated clusters
+	update_mesh_clusters();
 }
 
 void VoxelLodTerrain::apply_main_thread_update_tasks() {
@@ -1380,12 +1500,13 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 			if (block == nullptr) {
 				continue;
 			}
-			block->drop_visuals();
+			block->drop_visuals(_mesh_instance_pool);
 			remove_shader_material_from_block(*block, _shader_material_pool);
+			_detail_texture_budget.remove(bpos, lod_index);
 			// Also update the state in the threaded representation
-			auto it = lod.mesh_map_state.map.find(bpos);
-			if (it != lod.mesh_map_state.map.end()) {
-				it->second.visual_loaded = false;
+			VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_state = lod.mesh_map_state.map.find(bpos);
+			if (mesh_block_state != nullptr) {
+				mesh_block_state->visual_loaded = false;
 			}
 			// TODO When moving out of a region that already has collision-only viewers (causing the present visual-only
 			// unload), we may want to fade visuals the same way we do when the whole block is removed?
@@ -1470,9 +1591,13 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 									_shader_material_pool.get_cached_shader_uniforms()
 							);
 
-							item.mesh_instance.create();
+							item.mesh_instance = _mesh_instance_pool.allocate();
 							item.mesh_instance.set_mesh(mesh_block->get_mesh());
 							item.mesh_instance.set_gi_mode(get_gi_mode());
+							item.mesh_instance.set_cast_shadows_setting(
+									RenderingServer::ShadowCastingSetting(get_shadow_casting())
+							);
+							item.mesh_instance.set_render_layers_mask(get_render_layers_mask());
 							item.mesh_instance.set_transform(
 									volume_transform * Transform3D(Basis(), item.local_position)
 							);
@@ -1491,7 +1616,8 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 				fading_blocks_in_current_lod.erase(fading_block_it);
 			}
 
-			mesh_map.remove_block(bpos, BeforeUnloadMeshAction{ _shader_material_pool });
+			mesh_map.remove_block(bpos, BeforeUnloadMeshAction{ _shader_material_pool, _mesh_instance_pool });
+			_detail_texture_budget.remove(bpos, lod_index);
 
 			if (_instancer != nullptr) {
 				_instancer->on_mesh_block_exit(bpos, lod_index);
@@ -1559,9 +1685,13 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 						// item.shader_material->set_shader_param(
 						// 		VoxelStringNames::get_singleton().u_lod_fade, Vector2(item.progress, 0.f));
 
-						item.mesh_instance.create();
+						item.mesh_instance = _mesh_instance_pool.allocate();
 						item.mesh_instance.set_mesh(block->get_mesh());
 						item.mesh_instance.set_gi_mode(get_gi_mode());
+						item.mesh_instance.set_cast_shadows_setting(
+								RenderingServer::ShadowCastingSetting(get_shadow_casting())
+						);
+						item.mesh_instance.set_render_layers_mask(get_render_layers_mask());
 						item.mesh_instance.set_transform(volume_transform * Transform3D(Basis(), item.local_position));
 						item.mesh_instance.set_material_override(item.shader_material);
 						item.mesh_instance.set_world(*get_world_3d());
@@ -1578,6 +1708,7 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 				}
 
 				block->set_transition_mask(tu.transition_mask);
+				queue_shader_params_update(*block, lod_index);
 			}
 		}
 
@@ -1587,11 +1718,15 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 	} // for each lod
 
 	// Remove completed async edits
+	const size_t running_async_edit_count = state.running_async_edits.size();
 	unordered_remove_if(state.running_async_edits, [this](VoxelLodTerrainUpdateData::RunningAsyncEdit &e) {
 		if (e.tracker->is_complete()) {
 			if (e.tracker->has_next_tasks()) {
 				ERR_PRINT("Completed async edit had next tasks?");
 			}
+			if (e.read_only) {
+				return true;
+			}
 			post_edit_area(
 					e.box,
 					// Assume the async edit modified voxels in a way it affects the mesh.
@@ -1609,6 +1744,17 @@ void VoxelLodTerrain::apply_main_thread_update_tasks() {
 		return false;
 	});
 
+	if (running_async_edit_count > 0 && state.running_async_edits.size() == 0) {
+		bool has_pending_async_edits;
+		{
+			MutexLock lock(state.pending_async_edits_mutex);
+			has_pending_async_edits = state.pending_async_edits.size() > 0;
+		}
+		if (!has_pending_async_edits) {
+			emit_signal(VoxelStringNames::get_singleton().async_edits_completed);
+		}
+	}
+
 	_stats.blocked_lods = state.stats.blocked_lods;
 	_stats.time_detect_required_blocks = state.stats.time_detect_required_blocks;
 	_stats.time_io_requests = state.stats.time_io_requests;
@@ -1725,6 +1871,12 @@ void VoxelLodTerrain::apply_data_block_response(VoxelEngine::BlockDataOutput &ob
 		lod.loading_blocks.erase(ob.position);
 	}
 
+	if (ob.type == VoxelEngine::BlockDataOutput::TYPE_GENERATED) {
+		_update_data->state.block_trace.add(BlockLifecycleTrace::STAGE_GENERATED, ob.position, ob.lod_index);
+	} else {
+		_update_data->state.block_trace.add(BlockLifecycleTrace::STAGE_LOADED, ob.position, ob.lod_index);
+	}
+
 	if (_data->is_streaming_enabled() &&
 		_update_data->settings.streaming_system == VoxelLodTerrainUpdateData::STREAMING_SYSTEM_CLIPBOX) {
 		VoxelLodTerrainUpdateData::ClipboxStreamingState &cs = _update_data->state.clipbox_streaming;
@@ -1770,8 +1922,8 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 	{
 		VoxelLodTerrainUpdateData::Lod &lod = update_data.state.lods[ob.lod];
 		RWLockRead rlock(lod.mesh_map_state.map_lock);
-		auto mesh_block_state_it = lod.mesh_map_state.map.find(ob.position);
-		if (mesh_block_state_it == lod.mesh_map_state.map.end()) {
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_state_ptr = lod.mesh_map_state.map.find(ob.position);
+		if (mesh_block_state_ptr == nullptr) {
 			// That block is no longer loaded in the update map, drop the result
 			++_stats.dropped_block_meshs;
 			return;
@@ -1784,7 +1936,7 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 			return;
 		}
 
-		VoxelLodTerrainUpdateData::MeshBlockState &mesh_block_state = mesh_block_state_it->second;
+		VoxelLodTerrainUpdateData::MeshBlockState &mesh_block_state = *mesh_block_state_ptr;
 
 		transition_mask = mesh_block_state.transition_mask;
 
@@ -1810,6 +1962,7 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 			first_collision_load = (mesh_block_state.collision_loaded.exchange(true) == false);
 		}
 	}
+	update_data.state.block_trace.add(BlockLifecycleTrace::STAGE_MESHED, ob.position, ob.lod);
 	if ((first_visual_load || first_collision_load) &&
 		_update_data->settings.streaming_system == VoxelLodTerrainUpdateData::STREAMING_SYSTEM_CLIPBOX) {
 		// Notify streaming system so it can subdivide LODs as they load
@@ -1838,6 +1991,11 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 			shadow_occluder_mesh = ob.shadow_occluder_mesh;
 			// It can be empty
 			material_indices = std::move(ob.mesh_material_indices);
+		} else if (ob.has_staged_surfaces) {
+			// Surfaces were prepared in the threaded task, only upload them here
+			mesh = build_mesh(to_span_const(ob.staged_surfaces));
+			material_indices = std::move(ob.mesh_material_indices);
+			shadow_occluder_mesh = build_mesh(ob.surfaces.shadow_occluder);
 		} else {
 			// Can't build meshes in threads, do it here
 			mesh = build_mesh(
@@ -1865,7 +2023,8 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 		if (block != nullptr) {
 			// No surface anymore in this block, destroy it
 			// TODO Factor removal in a function, it's done in a few places
-			mesh_map.remove_block(ob.position, BeforeUnloadMeshAction{ _shader_material_pool });
+			mesh_map.remove_block(ob.position, BeforeUnloadMeshAction{ _shader_material_pool, _mesh_instance_pool });
+			_detail_texture_budget.remove(ob.position, ob.lod);
 
 			if (_instancer != nullptr) {
 				_instancer->on_mesh_block_exit(ob.position, ob.lod);
@@ -1907,6 +2066,7 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 
 	if (ob.visual_was_required && visual_expected) {
 		bool assign_material_after_mesh = false;
+		bool shown = false;
 
 		// We consider a block having a "rendering" mesh as having loaded visuals.
 		if (!block->has_mesh()) {
@@ -1914,6 +2074,7 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 
 			block->visual_active = visual_active;
 			block->set_visible(visual_active);
+			shown = visual_active;
 			// ZN_PRINT_VERBOSE(format("Created block pos {} lod {} time {}", ob.position, int(ob.lod),
 			// 		Time::get_singleton()->get_ticks_msec()));
 
@@ -1950,6 +2111,8 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 			}
 
 			block->set_transition_mask(transition_mask);
+			// Not deferred, the block is new and would show cracks until the end of the frame otherwise
+			block->flush_shader_params();
 		}
 
 #ifdef TOOLS_ENABLED
@@ -1959,6 +2122,7 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 #endif
 
 		block->set_mesh(
+				_mesh_instance_pool,
 				mesh,
 				get_gi_mode(),
 				RenderingServer::ShadowCastingSetting(get_shadow_casting()),
@@ -1969,6 +2133,22 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 				shadow_occluder_mode
 #endif
 		);
+		block->mesh_size_in_bytes = VoxelMesher::get_mesh_size_in_bytes(mesh_data);
+
+		update_data.state.block_trace.add(BlockLifecycleTrace::STAGE_UPLOADED, ob.position, ob.lod);
+		if (shown) {
+			update_data.state.block_trace.add(BlockLifecycleTrace::STAGE_VISIBLE, ob.position, ob.lod);
+		}
+
+		block->mesh_revision = ++_next_mesh_revision;
+		if (_mesh_clustering_enabled && ob.lod >= _mesh_clustering_begin_lod_index && mesh.is_valid()) {
+			// Kept so the block can be merged with its neighbors later. Arrays are shared, not copied.
+			block->cluster_surfaces = mesh_data.surfaces;
+			block->cluster_primitive_type = mesh_data.primitive_type;
+			block->cluster_mesh_flags = mesh_data.mesh_flags;
+		} else {
+			block->cluster_surfaces.clear();
+		}
 
 		if (assign_material_after_mesh) {
 			// Do this after assigning the mesh when not using a ShaderMaterial.
@@ -1996,6 +2176,7 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 			);
 
 			block->set_transition_mesh(
+					_mesh_instance_pool,
 					transition_mesh,
 					dir,
 					get_gi_mode(),
@@ -2015,23 +2196,40 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 
 		if (_collision_update_delay == 0 ||
 			static_cast<int>(now - block->last_collider_update_time) > _collision_update_delay) {
-			ZN_ASSERT(_mesher.is_valid());
-			Ref<Shape3D> collision_shape = make_collision_shape_from_mesher_output(ob.surfaces, **_mesher);
+			Ref<Shape3D> collision_shape;
+			if (ob.has_collision_shape) {
+				collision_shape = ob.collision_shape;
+			} else {
+				ZN_ASSERT(_mesher.is_valid());
+				collision_shape = make_collision_shape_from_mesher_output(ob.surfaces, **_mesher);
+			}
 			const bool debug_collisions = is_inside_tree() ? get_tree()->is_debugging_collisions_hint() : false;
 			block->set_collision_shape(collision_shape, debug_collisions, this, _collision_margin);
+			block->collision_size_in_bytes = VoxelMesher::get_collision_size_in_bytes(ob.surfaces);
 
 			block->set_collision_layer(_collision_layer);
 			block->set_collision_mask(_collision_mask);
 			block->set_collision_enabled(collision_active);
 			block->last_collider_update_time = now;
-			block->deferred_collider_data.reset();
+			block->clear_deferred_collision_update();
 
 		} else {
-			if (block->deferred_collider_data == nullptr) {
+			if (!block->has_deferred_collision_update()) {
 				_deferred_collision_updates_per_lod[ob.lod].push_back(ob.position);
-				block->deferred_collider_data = make_unique_instance<VoxelMesher::Output>();
 			}
-			*block->deferred_collider_data = std::move(ob.surfaces);
+			block->deferred_collision_size_in_bytes = VoxelMesher::get_collision_size_in_bytes(ob.surfaces);
+			if (ob.has_collision_shape) {
+				block->deferred_collider_data.reset();
+				block->deferred_collision_shape = ob.collision_shape;
+				block->has_deferred_collision_shape = true;
+			} else {
+				if (block->deferred_collider_data == nullptr) {
+					block->deferred_collider_data = make_unique_instance<VoxelMesher::Output>();
+				}
+				*block->deferred_collider_data = std::move(ob.surfaces);
+				block->deferred_collision_shape.unref();
+				block->has_deferred_collision_shape = false;
+			}
 		}
 	}
 
@@ -2059,6 +2257,30 @@ void VoxelLodTerrain::apply_mesh_update(VoxelEngine::BlockMeshOutput &ob) {
 #endif
 }
 
+void VoxelLodTerrain::get_memory_usage(VolumeMemoryUsage &usage) const {
+	ZN_PROFILE_SCOPE();
+
+	usage.object_id = get_instance_id();
+	usage.add_voxel_data(*_data);
+
+	for (const VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map : _mesh_maps_per_lod) {
+		mesh_map.for_each_block([&usage](const VoxelMeshBlockVLT &block) { //
+			usage.add_mesh_block(block);
+		});
+	}
+
+	usage.bytes[VolumeMemoryUsage::CATEGORY_DETAIL_TEXTURES] += _detail_texture_budget.get_used_bytes();
+
+	if (_instancer != nullptr) {
+		usage.bytes[VolumeMemoryUsage::CATEGORY_INSTANCES] += _instancer->get_memory_usage_bytes();
+	}
+
+	Ref<VoxelStream> stream = get_stream();
+	if (stream.is_valid()) {
+		usage.bytes[VolumeMemoryUsage::CATEGORY_STREAM_CACHE] += stream->get_memory_usage_bytes();
+	}
+}
+
 void VoxelLodTerrain::apply_detail_texture_update(VoxelEngine::BlockDetailTextureOutput &ob) {
 	ZN_PROFILE_SCOPE();
 	VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map = _mesh_maps_per_lod[ob.lod_index];
@@ -2215,6 +2437,14 @@ void VoxelLodTerrain::apply_detail_texture_update_to_block(
 		const unsigned int tile_size =
 				get_detail_texture_tile_resolution_for_lod(_update_data->settings.detail_texture_settings, lod_index);
 		material->set_shader_parameter(sn.u_voxel_virtual_texture_tile_size, tile_size);
+
+		_detail_texture_budget.add(
+				block.position,
+				lod_index,
+				get_detail_textures_size_in_bytes(normalmap_textures),
+				block.visual_active,
+				get_ticks_msec()
+		);
 	}
 	// If the material is not valid... well it means the user hasn't set up one, so all the hardwork of making these
 	// textures goes in the bin. That should be a warning in the editor.
@@ -2222,12 +2452,12 @@ void VoxelLodTerrain::apply_detail_texture_update_to_block(
 	{
 		VoxelLodTerrainUpdateData::Lod &lod = _update_data->state.lods[lod_index];
 		RWLockRead rlock(lod.mesh_map_state.map_lock);
-		auto mesh_block_state_it = lod.mesh_map_state.map.find(block.position);
-		if (mesh_block_state_it != lod.mesh_map_state.map.end()) {
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_state_ptr = lod.mesh_map_state.map.find(block.position);
+		if (mesh_block_state_ptr != nullptr) {
 			VoxelLodTerrainUpdateData::DetailTextureState expected_dt_state =
 					VoxelLodTerrainUpdateData::DETAIL_TEXTURE_PENDING;
 			// If it was PENDING, set it to IDLE.
-			mesh_block_state_it->second.detail_texture_state.compare_exchange_strong(
+			mesh_block_state_ptr->detail_texture_state.compare_exchange_strong(
 					expected_dt_state, VoxelLodTerrainUpdateData::DETAIL_TEXTURE_IDLE
 			);
 			// TODO If the mesh was modified again since, we need to schedule an extra update for the virtual texture to
@@ -2237,27 +2467,103 @@ void VoxelLodTerrain::apply_detail_texture_update_to_block(
 	}
 
 	block.detail_texture_fallback_level = 0;
+	block.detail_texture_evicted = false;
+
+	evict_detail_textures();
 }
 
-void VoxelLodTerrain::process_deferred_collision_updates(uint32_t timeout_msec) {
+void VoxelLodTerrain::evict_detail_textures() {
+	static thread_local StdVector<DetailTextureBudget::Key> tls_evicted;
+	tls_evicted.clear();
+	_detail_texture_budget.evict(tls_evicted);
+	if (tls_evicted.size() == 0) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+	const VoxelStringNames &sn = VoxelStringNames::get_singleton();
+	const unsigned int lod_count = get_lod_count();
+
+	for (const DetailTextureBudget::Key &key : tls_evicted) {
+		if (key.lod_index >= lod_count) {
+			continue;
+		}
+		VoxelMeshBlockVLT *block = _mesh_maps_per_lod[key.lod_index].get_block(key.position);
+		if (block == nullptr) {
+			continue;
+		}
+		Ref<ShaderMaterial> material = block->get_shader_material();
+		if (material.is_valid()) {
+			// Child blocks using this texture as fallback still reference it, it will be freed once they get their own
+			material->set_shader_parameter(sn.u_voxel_normalmap_atlas, Variant());
+			material->set_shader_parameter(sn.u_voxel_cell_lookup, Variant());
+		}
+		block->detail_texture_fallback_level = 0;
+		block->detail_texture_evicted = true;
+	}
+}
+
+void VoxelLodTerrain::process_deferred_collision_updates(uint32_t timeout_usec) {
 	ZN_PROFILE_SCOPE();
 
 	const unsigned int lod_count = get_lod_count();
 	// TODO We may move this in a time spread task somehow, the timeout does not account for them so could take longer
-	const uint64_t then = get_ticks_msec();
+	const uint64_t then = get_ticks_usec();
+
+	// Viewers requiring collisions usually follow physics bodies. Updates closest to them are done first, so bodies
+	// are less likely to fall through terrain when there are more updates than the time budget allows.
+	static thread_local StdVector<Vector3> tls_collision_viewer_positions;
+	StdVector<Vector3> &collision_viewer_positions = tls_collision_viewer_positions;
+	collision_viewer_positions.clear();
+	{
+		const Transform3D world_to_local = get_global_transform().affine_inverse();
+		VoxelEngine::get_singleton().for_each_viewer(
+				[&collision_viewer_positions, &world_to_local](ViewerID id, const VoxelEngine::Viewer &viewer) {
+					if (viewer.require_collisions) {
+						collision_viewer_positions.push_back(world_to_local.xform(viewer.world_position));
+					}
+				}
+		);
+	}
+
+	const int mesh_block_size = get_mesh_block_size();
 
 	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
 		VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map = _mesh_maps_per_lod[lod_index];
 		StdVector<Vector3i> &deferred_collision_updates = _deferred_collision_updates_per_lod[lod_index];
 
-		for (unsigned int i = 0; i < deferred_collision_updates.size(); ++i) {
+		if (deferred_collision_updates.size() > 1 && collision_viewer_positions.size() > 0) {
+			ZN_PROFILE_SCOPE_NAMED("Sort");
+			const int lod_mesh_block_size = mesh_block_size << lod_index;
+			auto get_distance_sq = [&collision_viewer_positions, lod_mesh_block_size](const Vector3i bpos) {
+				const Vector3 center(bpos * lod_mesh_block_size + Vector3iUtil::create(lod_mesh_block_size / 2));
+				real_t closest_distance_sq = center.distance_squared_to(collision_viewer_positions[0]);
+				for (unsigned int i = 1; i < collision_viewer_positions.size(); ++i) {
+					closest_distance_sq =
+							math::min(closest_distance_sq, center.distance_squared_to(collision_viewer_positions[i]));
+				}
+				return closest_distance_sq;
+			};
+			std::sort(
+					deferred_collision_updates.begin(),
+					deferred_collision_updates.end(),
+					[&get_distance_sq](const Vector3i a, const Vector3i b) {
+						return get_distance_sq(a) < get_distance_sq(b);
+					}
+			);
+		}
+
+		// Updates are removed while preserving order
+		unsigned int kept_count = 0;
+		unsigned int i = 0;
+		bool timed_out = false;
+
+		for (; i < deferred_collision_updates.size(); ++i) {
 			const Vector3i block_pos = deferred_collision_updates[i];
 			VoxelMeshBlockVLT *block = mesh_map.get_block(block_pos);
 
-			if (block == nullptr || block->deferred_collider_data == nullptr) {
+			if (block == nullptr || !block->has_deferred_collision_update()) {
 				// Block was unloaded or no longer needs a collision update
-				unordered_remove(deferred_collision_updates, i);
-				--i;
 				continue;
 			}
 
@@ -2265,7 +2571,10 @@ void VoxelLodTerrain::process_deferred_collision_updates(uint32_t timeout_msec)
 
 			if (static_cast<int>(now - block->last_collider_update_time) > _collision_update_delay) {
 				Ref<Shape3D> collision_shape;
-				if (_mesher.is_valid()) {
+				if (block->has_deferred_collision_shape) {
+					// Already built by the meshing task
+					collision_shape = block->deferred_collision_shape;
+				} else if (_mesher.is_valid()) {
 					collision_shape =
 							make_collision_shape_from_mesher_output(*block->deferred_collider_data, **_mesher);
 				}
@@ -2273,20 +2582,35 @@ void VoxelLodTerrain::process_deferred_collision_updates(uint32_t timeout_msec)
 				block->set_collision_shape(
 						collision_shape, get_tree()->is_debugging_collisions_hint(), this, _collision_margin
 				);
+				block->collision_size_in_bytes = block->deferred_collision_size_in_bytes;
 				block->set_collision_layer(_collision_layer);
 				block->set_collision_mask(_collision_mask);
 				block->last_collider_update_time = now;
-				block->deferred_collider_data.reset();
+				block->clear_deferred_collision_update();
 
-				unordered_remove(deferred_collision_updates, i);
-				--i;
+			} else {
+				deferred_collision_updates[kept_count] = block_pos;
+				++kept_count;
 			}
 
 			// We always process at least one, then we check the timeout
-			if (get_ticks_msec() - then >= timeout_msec) {
-				return;
+			if (get_ticks_usec() - then >= timeout_usec) {
+				++i;
+				timed_out = true;
+				break;
 			}
 		}
+
+		// Keep updates we didn't get to
+		for (; i < deferred_collision_updates.size(); ++i) {
+			deferred_collision_updates[kept_count] = deferred_collision_updates[i];
+			++kept_count;
+		}
+		deferred_collision_updates.resize(kept_count);
+
+		if (timed_out) {
+			return;
+		}
 	}
 }
 
@@ -2297,7 +2621,7 @@ void VoxelLodTerrain::abort_async_edits() {
 	for (auto it = state.pending_async_edits.begin(); it != state.pending_async_edits.end(); ++it) {
 		VoxelLodTerrainUpdateData::AsyncEdit &e = *it;
 		CRASH_COND(e.task == nullptr);
-		ZN_DELETE(e.task);
+		e.task->dispose();
 	}
 	state.pending_async_edits.clear();
 	state.running_async_edits.clear();
@@ -2305,6 +2629,38 @@ void VoxelLodTerrain::abort_async_edits() {
 	// so the caller of this function must ensure none of them are running, or none will have an effect
 }
 
+void VoxelLodTerrain::queue_shader_params_update(VoxelMeshBlockVLT &block, unsigned int lod_index) {
+	if (block.shader_params_update_queued) {
+		return;
+	}
+	block.shader_params_update_queued = true;
+	_shader_params_updates_per_lod[lod_index].push_back(block.position);
+}
+
+void VoxelLodTerrain::flush_shader_params_updates() {
+	ZN_PROFILE_SCOPE();
+
+	// Shader parameters of a block can change several times per frame (transition mask, then fading). Writing them to
+	// materials is not cheap, so it is done once for all blocks, after every change, and only for values that changed.
+	for (unsigned int lod_index = 0; lod_index < _shader_params_updates_per_lod.size(); ++lod_index) {
+		StdVector<Vector3i> &positions = _shader_params_updates_per_lod[lod_index];
+		if (positions.size() == 0) {
+			continue;
+		}
+		VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map = _mesh_maps_per_lod[lod_index];
+
+		for (const Vector3i bpos : positions) {
+			VoxelMeshBlockVLT *block = mesh_map.get_block(bpos);
+			// The block may have been unloaded since
+			if (block != nullptr) {
+				block->flush_shader_params();
+			}
+		}
+
+		positions.clear();
+	}
+}
+
 void VoxelLodTerrain::process_fading_blocks(float delta) {
 	ZN_PROFILE_SCOPE();
 
@@ -2323,6 +2679,7 @@ void VoxelLodTerrain::process_fading_blocks(float delta) {
 				ERR_FAIL_COND(block->fading_state == VoxelMeshBlockVLT::FADING_NONE);
 
 				const bool finished = block->update_fading(speed);
+				queue_shader_params_update(*block, lod_index);
 
 				if (finished) {
 					// `erase` returns the next iterator
@@ -2342,15 +2699,13 @@ void VoxelLodTerrain::process_fading_blocks(float delta) {
 			FadingOutMesh &item = _fading_out_meshes[i];
 			item.progress -= speed;
 			if (item.progress <= 0.f) {
-				FreeMeshTask::try_add_and_destroy(item.mesh_instance);
+				// Mesh instances are recycled rather than destroyed, because freeing them can be really slow due to
+				// materials. Profiling has shown that `RendererSceneCull::free` of a mesh instance leads to
+				// `RendererRD::MaterialStorage::_update_queued_materials()` to be called, which internally updates
+				// hundreds of materials (supposedly from every block). Can take 1ms for a single instance, while the
+				// rest of the work is barely 1%!
+				FreeMeshTask::try_add_and_recycle(item.mesh_instance, _mesh_instance_pool);
 				_shader_material_pool.recycle(item.shader_material);
-				// TODO Optimize: mesh instances destroyed here can be really slow due to materials...
-				// Profiling has shown that `RendererSceneCull::free` of a mesh instance
-				// leads to `RendererRD::MaterialStorage::_update_queued_materials()` to be called, which internally
-				// updates hundreds of materials (supposedly from every block). Can take 1ms for a single instance,
-				// while the rest of the work is barely 1%! Why is Godot doing this? I tried resetting the material like
-				// with blocks, but that didn't improve anything...
-				// item.mesh_instance.set_material_override(Ref<Material>());
 				_fading_out_meshes[i] = std::move(_fading_out_meshes.back());
 				_fading_out_meshes.pop_back();
 			} else {
@@ -2396,6 +2751,259 @@ void VoxelLodTerrain::process_fading_blocks(float delta) {
 	}
 }
 
+void VoxelLodTerrain::update_mesh_clusters() {
+	ZN_PROFILE_SCOPE();
+
+	if (!_mesh_clustering_enabled || !is_inside_tree() || _mesher.is_null()) {
+		return;
+	}
+
+	const unsigned int lod_count = get_lod_count();
+	const unsigned int cluster_size_po2 = _mesh_cluster_size_po2;
+	const DetailRenderingSettings &detail_settings = _update_data->settings.detail_texture_settings;
+
+	// TODO Candidate for temp allocator
+	StdUnorderedMap<Vector3i, StdVector<VoxelMeshClusterVLT::Member>> members_per_cluster;
+	const StdVector<VoxelMeshClusterVLT::Member> no_members;
+
+	for (unsigned int lod_index = _mesh_clustering_begin_lod_index; lod_index < lod_count; ++lod_index) {
+		VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map = _mesh_maps_per_lod[lod_index];
+		StdUnorderedMap<Vector3i, VoxelMeshClusterVLT> &clusters = _mesh_clusters_per_lod[lod_index];
+
+		members_per_cluster.clear();
+
+		// Blocks with detail textures need their own material, they can't share one with other blocks
+		if (!detail_settings.enabled || lod_index < detail_settings.begin_lod_index) {
+			mesh_map.for_each_block([&members_per_cluster, cluster_size_po2](VoxelMeshBlockVLT &block) {
+				if (block.is_clusterable()) {
+					members_per_cluster[block.position >> cluster_size_po2].push_back(
+							VoxelMeshClusterVLT::Member{ block.position, block.mesh_revision }
+					);
+				}
+			});
+		}
+
+		const int cluster_size_in_voxels = get_mesh_block_size() << (lod_index + cluster_size_po2);
+
+		for (auto it = members_per_cluster.begin(); it != members_per_cluster.end(); ++it) {
+			StdVector<VoxelMeshClusterVLT::Member> &members = it->second;
+			if (members.size() < 2) {
+				continue;
+			}
+			// Order of iteration in the map isn't stable
+			std::sort(members.begin(), members.end(), [](const auto &a, const auto &b) {
+				return a.block_position < b.block_position;
+			});
+			auto cluster_it = clusters.find(it->first);
+			if (cluster_it == clusters.end()) {
+				VoxelMeshClusterVLT &cluster = clusters[it->first];
+				cluster.origin_in_voxels = it->first * cluster_size_in_voxels;
+			}
+		}
+
+		for (auto it = clusters.begin(); it != clusters.end();) {
+			VoxelMeshClusterVLT &cluster = it->second;
+
+			auto members_it = members_per_cluster.find(it->first);
+			const StdVector<VoxelMeshClusterVLT::Member> &members =
+					members_it != members_per_cluster.end() ? members_it->second : no_members;
+			const bool can_merge = members.size() >= 2;
+
+			if (cluster.applied_members.size() > 0 && cluster.applied_members != members) {
+				// A block changed, so render blocks separately until the cluster is built again
+				hide_mesh_cluster(cluster, mesh_map);
+			}
+
+			if (cluster.pending_build != nullptr && cluster.pending_build->complete) {
+				std::shared_ptr<VoxelMeshClusterVLT::BuildOutput> output = std::move(cluster.pending_build);
+
+				// Results are outdated if blocks changed while the cluster was being built
+				if (output->members == members) {
+					if (output->success) {
+						show_mesh_cluster(cluster, *output, mesh_map, lod_index);
+					} else {
+						cluster.failed_members = std::move(output->members);
+					}
+				}
+			}
+
+			if (cluster.applied_members.size() == 0 && cluster.pending_build == nullptr) {
+				if (!can_merge) {
+					it = clusters.erase(it);
+					continue;
+				}
+				if (members != cluster.failed_members) {
+					start_mesh_cluster_build(cluster, to_span(members), mesh_map, lod_index);
+				}
+			}
+
+			++it;
+		}
+	}
+}
+
+void VoxelLodTerrain::start_mesh_cluster_build(
+		VoxelMeshClusterVLT &cluster,
+		Span<const VoxelMeshClusterVLT::Member> members,
+		const VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map,
+		unsigned int lod_index
+) {
+	ZN_PROFILE_SCOPE();
+
+	std::shared_ptr<VoxelMeshClusterVLT::BuildOutput> output = make_shared_instance<VoxelMeshClusterVLT::BuildOutput>();
+	output->members.resize(members.size());
+	for (unsigned int i = 0; i < members.size(); ++i) {
+		output->members[i] = members[i];
+	}
+
+	const int block_size_in_voxels = get_mesh_block_size() << lod_index;
+
+	BuildMeshClusterTask *task = ZN_NEW(BuildMeshClusterTask);
+	task->inputs.resize(members.size());
+
+	for (unsigned int i = 0; i < members.size(); ++i) {
+		const VoxelMeshBlockVLT *block = mesh_map.get_block(members[i].block_position);
+		ZN_ASSERT(block != nullptr);
+
+		if (i == 0) {
+			output->primitive_type = block->cluster_primitive_type;
+			output->mesh_flags = block->cluster_mesh_flags;
+
+		} else if (block->cluster_primitive_type != output->primitive_type ||
+				   block->cluster_mesh_flags != output->mesh_flags) {
+			// Meshes with different formats can't be merged
+			ZN_DELETE(task);
+			cluster.failed_members = std::move(output->members);
+			return;
+		}
+
+		VoxelMeshClusterInput &input = task->inputs[i];
+		input.surfaces = block->cluster_surfaces;
+		input.offset = Vector3(block->position * block_size_in_voxels - cluster.origin_in_voxels);
+	}
+
+	task->output = output;
+	cluster.pending_build = output;
+
+	VoxelEngine::get_singleton().push_async_task(task);
+}
+
+void VoxelLodTerrain::show_mesh_cluster(
+		VoxelMeshClusterVLT &cluster,
+		VoxelMeshClusterVLT::BuildOutput &output,
+		VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map,
+		unsigned int lod_index
+) {
+	ZN_PROFILE_SCOPE();
+
+	Ref<ArrayMesh> mesh;
+	if (output.has_mesh_resource) {
+		mesh = output.mesh;
+	} else if (output.has_staged_surfaces) {
+		mesh = build_mesh(to_span_const(output.staged_surfaces));
+	} else {
+		mesh = build_mesh(
+				to_span_const(output.surfaces), output.primitive_type, output.mesh_flags, output.mesh_material_indices
+		);
+	}
+	if (mesh.is_null()) {
+		cluster.failed_members = std::move(output.members);
+		return;
+	}
+
+	const unsigned int surface_count = mesh->get_surface_count();
+	for (unsigned int surface_index = 0; surface_index < surface_count; ++surface_index) {
+		const unsigned int material_index = output.mesh_material_indices[surface_index];
+		mesh->surface_set_material(surface_index, _mesher->get_material_by_index(material_index));
+	}
+
+	ZN_ASSERT(!cluster.mesh_instance.is_valid());
+	cluster.mesh_instance = _mesh_instance_pool.allocate();
+	cluster.mesh_instance.set_gi_mode(get_gi_mode());
+	cluster.mesh_instance.set_cast_shadows_setting(RenderingServer::ShadowCastingSetting(get_shadow_casting()));
+	cluster.mesh_instance.set_render_layers_mask(get_render_layers_mask());
+	cluster.mesh_instance.set_mesh(mesh);
+
+	const Transform3D local_transform(Basis(), cluster.origin_in_voxels);
+
+	if (_shader_material_pool.get_template().is_valid()) {
+		Ref<ShaderMaterial> sm = _shader_material_pool.allocate();
+		if (sm.is_valid()) {
+			const VoxelStringNames &sn = VoxelStringNames::get_singleton();
+			sm->set_shader_parameter(sn.u_block_local_transform, local_transform);
+			if (_material_uses_lod_info) {
+				sm->set_shader_parameter(
+						sn.u_voxel_lod_info, encode_lod_info_for_shader_uniform(lod_index, get_lod_count())
+				);
+			}
+			cluster.mesh_instance.set_material_override(sm);
+			cluster.shader_material = sm;
+		}
+	} else if (_material.is_valid()) {
+		cluster.mesh_instance.set_material_override(_material);
+	}
+
+	cluster.mesh_instance.set_transform(get_global_transform() * local_transform);
+	cluster.mesh_instance.set_world(*get_world_3d());
+
+	for (const VoxelMeshClusterVLT::Member &member : output.members) {
+		VoxelMeshBlockVLT *block = mesh_map.get_block(member.block_position);
+		ZN_ASSERT_CONTINUE(block != nullptr);
+		block->set_clustered(true);
+	}
+
+	cluster.applied_members = std::move(output.members);
+	cluster.failed_members.clear();
+}
+
+void VoxelLodTerrain::hide_mesh_cluster(VoxelMeshClusterVLT &cluster, VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map) {
+	for (const VoxelMeshClusterVLT::Member &member : cluster.applied_members) {
+		// The block may have been unloaded
+		VoxelMeshBlockVLT *block = mesh_map.get_block(member.block_position);
+		if (block != nullptr) {
+			block->set_clustered(false);
+		}
+	}
+	cluster.applied_members.clear();
+
+	// Recycling also removes the material override
+	FreeMeshTask::try_add_and_recycle(cluster.mesh_instance, _mesh_instance_pool);
+	if (cluster.shader_material.is_valid()) {
+		_shader_material_pool.recycle(cluster.shader_material);
+		cluster.shader_material.unref();
+	}
+}
+
+void VoxelLodTerrain::clear_mesh_clusters() {
+	for (unsigned int lod_index = 0; lod_index < _mesh_clusters_per_lod.size(); ++lod_index) {
+		StdUnorderedMap<Vector3i, VoxelMeshClusterVLT> &clusters = _mesh_clusters_per_lod[lod_index];
+		VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map = _mesh_maps_per_lod[lod_index];
+		for (auto it = clusters.begin(); it != clusters.end(); ++it) {
+			hide_mesh_cluster(it->second, mesh_map);
+		}
+		// Pending builds are dropped
+		clusters.clear();
+	}
+}
+
+void VoxelLodTerrain::reset_mesh_clusters() {
+	clear_mesh_clusters();
+
+	// Release surfaces blocks no longer need to keep
+	for (unsigned int lod_index = 0; lod_index < _mesh_maps_per_lod.size(); ++lod_index) {
+		if (!_mesh_clustering_enabled || lod_index < _mesh_clustering_begin_lod_index) {
+			_mesh_maps_per_lod[lod_index].for_each_block([](VoxelMeshBlockVLT &block) { //
+				block.cluster_surfaces.clear();
+			});
+		}
+	}
+
+	if (_mesh_clustering_enabled) {
+		// Surfaces of blocks already meshed were not kept, get them again
+		remesh_all_blocks_from_lod(_mesh_clustering_begin_lod_index);
+	}
+}
+
 VoxelLodTerrain::LocalCameraInfo VoxelLodTerrain::get_local_camera_info() const {
 	LocalCameraInfo info;
 	if (!is_inside_tree()) {
@@ -2430,6 +3038,14 @@ void VoxelLodTerrain::set_instancer(VoxelInstancer *instancer) {
 	_instancer = instancer;
 }
 
+void VoxelLodTerrain::set_multiplayer_synchronizer(VoxelLodTerrainMultiplayerSynchronizer *synchronizer) {
+	_multiplayer_synchronizer = synchronizer;
+}
+
+const VoxelLodTerrainMultiplayerSynchronizer *VoxelLodTerrain::get_multiplayer_synchronizer() const {
+	return _multiplayer_synchronizer;
+}
+
 // This function is primarily intended for editor use cases at the moment.
 // It will be slower than using the instancing generation events,
 // because it has to query VisualServer, which then allocates and decodes vertex buffers (assuming they are cached).
@@ -2539,6 +3155,16 @@ Dictionary VoxelLodTerrain::_b_get_statistics() const {
 	d["dropped_block_loads"] = _stats.dropped_block_loads;
 	d["dropped_block_meshs"] = _stats.dropped_block_meshs;
 
+	// Memory
+	Array resident_voxel_bytes_per_lod;
+	const unsigned int data_lod_count = _data->get_lod_count();
+	for (unsigned int lod_index = 0; lod_index < data_lod_count; ++lod_index) {
+		resident_voxel_bytes_per_lod.append(static_cast<int64_t>(_data->get_resident_voxel_bytes(lod_index)));
+	}
+	d["resident_voxel_bytes_per_lod"] = resident_voxel_bytes_per_lod;
+	d["detail_texture_bytes"] = static_cast<int64_t>(_detail_texture_budget.get_used_bytes());
+	d["detail_texture_count"] = _detail_texture_budget.get_count();
+
 	return d;
 }
 
@@ -2570,16 +3196,22 @@ void VoxelLodTerrain::restart_stream() {
 }
 
 void VoxelLodTerrain::remesh_all_blocks() {
+	remesh_all_blocks_from_lod(0);
+}
+
+void VoxelLodTerrain::remesh_all_blocks_from_lod(unsigned int begin_lod_index) {
 	// Requests a new mesh for all mesh blocks, without dropping everything first
 	_update_data->wait_for_end_of_task();
 	const unsigned int lod_count = get_lod_count();
-	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+	for (unsigned int lod_index = begin_lod_index; lod_index < lod_count; ++lod_index) {
 		VoxelLodTerrainUpdateData::Lod &lod = _update_data->state.lods[lod_index];
-		for (auto it = lod.mesh_map_state.map.begin(); it != lod.mesh_map_state.map.end(); ++it) {
-			VoxelLodTerrainUpdateTask::schedule_mesh_update(
-					it->second, it->first, lod.mesh_blocks_pending_update, it->second.mesh_viewers.get() > 0
-			);
-		}
+		lod.mesh_map_state.map.for_each( //
+				[&lod](const Vector3i bpos, VoxelLodTerrainUpdateData::MeshBlockState &mesh_block) {
+					VoxelLodTerrainUpdateTask::schedule_mesh_update(
+							mesh_block, bpos, lod.mesh_blocks_pending_update, mesh_block.mesh_viewers.get() > 0
+					);
+				}
+		);
 	}
 }
 
@@ -2591,12 +3223,11 @@ bool VoxelLodTerrain::is_area_meshed(const Box3i &box_in_voxels, unsigned int lo
 	VoxelLodTerrainUpdateData::MeshMapState &mms = _update_data->state.lods[lod_index].mesh_map_state;
 	RWLockRead rlock(mms.map_lock);
 	return box_in_blocks.all_cells_match([&mms](Vector3i bpos) {
-		auto it = mms.map.find(bpos);
-		if (it == mms.map.end()) {
+		const VoxelLodTerrainUpdateData::MeshBlockState *block = mms.map.find(bpos);
+		if (block == nullptr) {
 			return false;
 		}
-		const VoxelLodTerrainUpdateData::MeshBlockState &block = it->second;
-		return block.state == VoxelLodTerrainUpdateData::MESH_UP_TO_DATE;
+		return block->state == VoxelLodTerrainUpdateData::MESH_UP_TO_DATE;
 	});
 }
 
@@ -2616,6 +3247,15 @@ void VoxelLodTerrain::set_streaming_system(StreamingSystem v) {
 #endif
 }
 
+void VoxelLodTerrain::set_grouped_loading_begin_lod_index(int lod_index) {
+	ERR_FAIL_COND(lod_index < 0 || lod_index > int(constants::MAX_LOD));
+	_update_data->settings.grouped_loading_begin_lod_index = lod_index;
+}
+
+int VoxelLodTerrain::get_grouped_loading_begin_lod_index() const {
+	return _update_data->settings.grouped_loading_begin_lod_index;
+}
+
 void VoxelLodTerrain::set_voxel_bounds(Box3i p_box) {
 	_update_data->wait_for_end_of_task();
 	Box3i bounds_in_voxels =
@@ -2660,6 +3300,8 @@ void VoxelLodTerrain::set_lod_fade_duration(float seconds) {
 			VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map = _mesh_maps_per_lod[lod_index];
 			mesh_map.for_each_block([](VoxelMeshBlockVLT &mesh_block) { //
 				mesh_block.clear_fading();
+				// Not frequently called, so no need to defer
+				mesh_block.flush_shader_params();
 			});
 		}
 	}
@@ -2750,6 +3392,15 @@ bool VoxelLodTerrain::get_normalmap_use_gpu() const {
 	return _update_data->settings.detail_textures_use_gpu;
 }
 
+void VoxelLodTerrain::set_normalmap_memory_budget_mb(int budget) {
+	_detail_texture_budget.set_budget_bytes(static_cast<uint64_t>(math::max(budget, 0)) * 1024 * 1024);
+	evict_detail_textures();
+}
+
+int VoxelLodTerrain::get_normalmap_memory_budget_mb() const {
+	return _detail_texture_budget.get_budget_bytes() / (1024 * 1024);
+}
+
 void VoxelLodTerrain::set_generator_use_gpu(bool enabled) {
 	_update_data->settings.generator_use_gpu = enabled;
 	update_configuration_warnings();
@@ -2759,6 +3410,79 @@ bool VoxelLodTerrain::get_generator_use_gpu() const {
 	return _update_data->settings.generator_use_gpu;
 }
 
+void VoxelLodTerrain::set_mesh_baking_enabled(bool enabled) {
+	_mesh_baking_enabled = enabled;
+	update_baked_mesh_settings();
+}
+
+bool VoxelLodTerrain::is_mesh_baking_enabled() const {
+	return _mesh_baking_enabled;
+}
+
+void VoxelLodTerrain::update_baked_mesh_settings() {
+	Ref<VoxelStream> stream = get_stream();
+	Ref<VoxelStream> baked_mesh_stream;
+	uint64_t hash = 0;
+	if (_mesh_baking_enabled && _mesher.is_valid() && stream.is_valid() && stream->supports_mesh_blocks()) {
+		baked_mesh_stream = stream;
+		// Computed on the main thread because it reads properties of the mesher and generator
+		hash = get_mesh_block_settings_hash(**_mesher, get_generator().ptr(), get_mesh_block_size());
+	}
+	_update_data->wait_for_end_of_task();
+	_update_data->settings.baked_mesh_stream = baked_mesh_stream;
+	_update_data->settings.baked_mesh_settings_hash = hash;
+}
+
+void VoxelLodTerrain::set_mesh_clustering_enabled(bool enabled) {
+	if (enabled == _mesh_clustering_enabled) {
+		return;
+	}
+	_mesh_clustering_enabled = enabled;
+	reset_mesh_clusters();
+}
+
+bool VoxelLodTerrain::is_mesh_clustering_enabled() const {
+	return _mesh_clustering_enabled;
+}
+
+void VoxelLodTerrain::set_mesh_clustering_begin_lod_index(int lod_index) {
+	ERR_FAIL_INDEX(lod_index, int(constants::MAX_LOD));
+	if (lod_index == _mesh_clustering_begin_lod_index) {
+		return;
+	}
+	_mesh_clustering_begin_lod_index = lod_index;
+	reset_mesh_clusters();
+}
+
+int VoxelLodTerrain::get_mesh_clustering_begin_lod_index() const {
+	return _mesh_clustering_begin_lod_index;
+}
+
+void VoxelLodTerrain::set_mesh_cluster_size(int size_in_blocks) {
+	unsigned int po2;
+	switch (size_in_blocks) {
+		case 2:
+			po2 = 1;
+			break;
+		case 4:
+			po2 = 2;
+			break;
+		default:
+			ZN_PRINT_ERROR("Mesh cluster size must be 2 or 4");
+			return;
+	}
+	if (po2 == _mesh_cluster_size_po2) {
+		return;
+	}
+	_mesh_cluster_size_po2 = po2;
+	// Blocks still have their surfaces, so clusters only need to be built again
+	clear_mesh_clusters();
+}
+
+int VoxelLodTerrain::get_mesh_cluster_size() const {
+	return 1 << _mesh_cluster_size_po2;
+}
+
 #ifdef TOOLS_ENABLED
 
 void VoxelLodTerrain::get_configuration_warnings(PackedStringArray &warnings) const {
@@ -3006,9 +3730,9 @@ Dictionary VoxelLodTerrain::debug_get_mesh_block_info(Vector3 fbpos, int lod_ind
 			RWLockRead rlock(lod.mesh_map_state.map_lock);
 			recomputed_transition_mask =
 					VoxelLodTerrainUpdateTask::get_transition_mask(_update_data->state, bpos, lod_index, lod_count);
-			auto it = lod.mesh_map_state.map.find(bpos);
-			if (it != lod.mesh_map_state.map.end()) {
-				mesh_state = it->second.state;
+			const VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_state = lod.mesh_map_state.map.find(bpos);
+			if (mesh_block_state != nullptr) {
+				mesh_state = mesh_block_state->state;
 			}
 		}
 
@@ -3031,6 +3755,73 @@ Dictionary VoxelLodTerrain::debug_get_mesh_block_info(Vector3 fbpos, int lod_ind
 	return d;
 }
 
+void VoxelLodTerrain::debug_set_block_tracing_enabled(bool enabled) {
+	_update_data->state.block_trace.set_enabled(enabled);
+}
+
+bool VoxelLodTerrain::debug_is_block_tracing_enabled() const {
+	return _update_data->state.block_trace.is_enabled();
+}
+
+void VoxelLodTerrain::debug_clear_block_trace() {
+	_update_data->state.block_trace.clear();
+}
+
+Dictionary VoxelLodTerrain::debug_get_block_trace() const {
+	StdVector<BlockLifecycleTrace::Event> events;
+	_update_data->state.block_trace.get_events(events);
+
+	PackedInt64Array times;
+	PackedVector3Array positions;
+	PackedByteArray lods;
+	PackedByteArray stages;
+	times.resize(events.size());
+	positions.resize(events.size());
+	lods.resize(events.size());
+	stages.resize(events.size());
+	int64_t *times_w = times.ptrw();
+	Vector3 *positions_w = positions.ptrw();
+	uint8_t *lods_w = lods.ptrw();
+	uint8_t *stages_w = stages.ptrw();
+
+	for (unsigned int i = 0; i < events.size(); ++i) {
+		const BlockLifecycleTrace::Event &event = events[i];
+		times_w[i] = event.time_usec;
+		positions_w[i] = to_vec3(event.position);
+		lods_w[i] = event.lod_index;
+		stages_w[i] = event.stage;
+	}
+
+	PackedStringArray stage_names;
+	for (unsigned int i = 0; i < BlockLifecycleTrace::STAGE_COUNT; ++i) {
+		stage_names.append(BlockLifecycleTrace::get_stage_name(static_cast<BlockLifecycleTrace::Stage>(i)));
+	}
+
+	Dictionary d;
+	d["time_usec"] = times;
+	d["positions"] = positions;
+	d["lods"] = lods;
+	d["stages"] = stages;
+	d["stage_names"] = stage_names;
+	return d;
+}
+
+Dictionary VoxelLodTerrain::debug_get_block_trace_latencies() const {
+	FixedArray<BlockLifecycleTrace::StageLatency, BlockLifecycleTrace::STAGE_COUNT> latencies;
+	_update_data->state.block_trace.get_stage_latencies(latencies);
+
+	Dictionary d;
+	for (unsigned int i = 0; i < latencies.size(); ++i) {
+		const BlockLifecycleTrace::StageLatency &latency = latencies[i];
+		Dictionary stage_d;
+		stage_d["count"] = latency.count;
+		stage_d["average_usec"] = latency.count > 0 ? static_cast<int64_t>(latency.total_usec / latency.count) : 0;
+		stage_d["max_usec"] = static_cast<int64_t>(latency.max_usec);
+		d[BlockLifecycleTrace::get_stage_name(static_cast<BlockLifecycleTrace::Stage>(i))] = stage_d;
+	}
+	return d;
+}
+
 Array VoxelLodTerrain::debug_get_octree_positions() const {
 	_update_data->wait_for_end_of_task();
 	Array positions;
@@ -3073,11 +3864,11 @@ Array VoxelLodTerrain::debug_get_octrees_detailed() const {
 			Variant node_state;
 
 			const VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
-			auto mesh_block_it = lod.mesh_map_state.map.find(position);
-			if (mesh_block_it == lod.mesh_map_state.map.end()) {
+			const VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = lod.mesh_map_state.map.find(position);
+			if (mesh_block_ptr == nullptr) {
 				node_state = 0;
 			} else {
-				if (mesh_block_it->second.state == VoxelLodTerrainUpdateData::MESH_UP_TO_DATE) {
+				if (mesh_block_ptr->state == VoxelLodTerrainUpdateData::MESH_UP_TO_DATE) {
 					node_state = 2;
 				} else {
 					node_state = 1;
@@ -3280,20 +4071,22 @@ void VoxelLodTerrain::update_gizmos() {
 		for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
 			const VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
 
-			for (auto mesh_it = lod.mesh_map_state.map.begin(); mesh_it != lod.mesh_map_state.map.end(); ++mesh_it) {
-				const VoxelLodTerrainUpdateData::MeshBlockState &ms = mesh_it->second;
-				if (ms.visual_active) {
-					const int size = mesh_block_size << lod_index;
-					const Vector3i bpos = mesh_it->first;
-					const Vector3i voxel_pos = mesh_block_size * (bpos << lod_index);
-					const Transform3D local_transform(Basis().scaled(Vector3(size, size, size)), voxel_pos);
-					const Transform3D t = parent_transform * local_transform;
-					// Squaring because lower lod indexes are more interesting to see, so we give them more contrast.
-					// Also this might be better with sRGB?
-					const float g = math::squared(math::max(1.f - float(lod_index) / lod_count_f, 0.f));
-					dr.draw_box(t, Color8(255, uint8_t(g * 254.f), 0, 255));
-				}
-			}
+			lod.mesh_map_state.map.for_each( //
+					[mesh_block_size, lod_index, lod_count_f, &parent_transform, &dr](
+							const Vector3i bpos, const VoxelLodTerrainUpdateData::MeshBlockState &ms
+					) {
+						if (ms.visual_active) {
+							const int size = mesh_block_size << lod_index;
+							const Vector3i voxel_pos = mesh_block_size * (bpos << lod_index);
+							const Transform3D local_transform(Basis().scaled(Vector3(size, size, size)), voxel_pos);
+							const Transform3D t = parent_transform * local_transform;
+							// Squaring because lower lod indexes are more interesting to see, so we give them more
+							// contrast. Also this might be better with sRGB?
+							const float g = math::squared(math::max(1.f - float(lod_index) / lod_count_f, 0.f));
+							dr.draw_box(t, Color8(255, uint8_t(g * 254.f), 0, 255));
+						}
+					}
+			);
 		}
 	}
 
@@ -3680,6 +4473,11 @@ void VoxelLodTerrain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_normalmap_use_gpu", "enabled"), &Self::set_normalmap_use_gpu);
 	ClassDB::bind_method(D_METHOD("get_normalmap_use_gpu"), &Self::get_normalmap_use_gpu);
 
+	ClassDB::bind_method(
+			D_METHOD("set_normalmap_memory_budget_mb", "budget"), &Self::set_normalmap_memory_budget_mb
+	);
+	ClassDB::bind_method(D_METHOD("get_normalmap_memory_budget_mb"), &Self::get_normalmap_memory_budget_mb);
+
 	// Advanced
 
 	ClassDB::bind_method(D_METHOD("get_mesh_block_size"), &Self::get_mesh_block_size);
@@ -3700,9 +4498,28 @@ void VoxelLodTerrain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_generator_use_gpu", "enabled"), &Self::set_generator_use_gpu);
 	ClassDB::bind_method(D_METHOD("get_generator_use_gpu"), &Self::get_generator_use_gpu);
 
+	ClassDB::bind_method(D_METHOD("set_mesh_baking_enabled", "enabled"), &Self::set_mesh_baking_enabled);
+	ClassDB::bind_method(D_METHOD("is_mesh_baking_enabled"), &Self::is_mesh_baking_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_mesh_clustering_enabled", "enabled"), &Self::set_mesh_clustering_enabled);
+	ClassDB::bind_method(D_METHOD("is_mesh_clustering_enabled"), &Self::is_mesh_clustering_enabled);
+
+	ClassDB::bind_method(
+			D_METHOD("set_mesh_clustering_begin_lod_index", "lod_index"), &Self::set_mesh_clustering_begin_lod_index
+	);
+	ClassDB::bind_method(D_METHOD("get_mesh_clustering_begin_lod_index"), &Self::get_mesh_clustering_begin_lod_index);
+
+	ClassDB::bind_method(D_METHOD("set_mesh_cluster_size", "size_in_blocks"), &Self::set_mesh_cluster_size);
+	ClassDB::bind_method(D_METHOD("get_mesh_cluster_size"), &Self::get_mesh_cluster_size);
+
 	ClassDB::bind_method(D_METHOD("set_streaming_system", "system"), &Self::set_streaming_system);
 	ClassDB::bind_method(D_METHOD("get_streaming_system"), &Self::get_streaming_system);
 
+	ClassDB::bind_method(
+			D_METHOD("set_grouped_loading_begin_lod_index", "lod_index"), &Self::set_grouped_loading_begin_lod_index
+	);
+	ClassDB::bind_method(D_METHOD("get_grouped_loading_begin_lod_index"), &Self::get_grouped_loading_begin_lod_index);
+
 	// Debug
 
 	ClassDB::bind_method(D_METHOD("get_statistics"), &Self::_b_get_statistics);
@@ -3714,6 +4531,13 @@ void VoxelLodTerrain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("debug_print_sdf_top_down", "center", "extents"), &Self::_b_debug_print_sdf_top_down);
 	ClassDB::bind_method(D_METHOD("debug_get_mesh_block_count"), &Self::_b_debug_get_mesh_block_count);
 	ClassDB::bind_method(D_METHOD("debug_get_data_block_count"), &Self::_b_debug_get_data_block_count);
+	ClassDB::bind_method(
+			D_METHOD("debug_set_block_tracing_enabled", "enabled"), &Self::debug_set_block_tracing_enabled
+	);
+	ClassDB::bind_method(D_METHOD("debug_is_block_tracing_enabled"), &Self::debug_is_block_tracing_enabled);
+	ClassDB::bind_method(D_METHOD("debug_clear_block_trace"), &Self::debug_clear_block_trace);
+	ClassDB::bind_method(D_METHOD("debug_get_block_trace"), &Self::debug_get_block_trace);
+	ClassDB::bind_method(D_METHOD("debug_get_block_trace_latencies"), &Self::debug_get_block_trace_latencies);
 	ClassDB::bind_method(D_METHOD("debug_dump_as_scene", "path", "include_instancer"), &Self::_b_debug_dump_as_scene);
 	ClassDB::bind_method(D_METHOD("debug_is_draw_enabled"), &Self::debug_is_draw_enabled);
 	ClassDB::bind_method(D_METHOD("debug_set_draw_enabled", "enabled"), &Self::debug_set_draw_enabled);
@@ -3747,6 +4571,8 @@ void VoxelLodTerrain::_bind_methods() {
 	BIND_ENUM_CONSTANT(STREAMING_SYSTEM_LEGACY_OCTREE);
 	BIND_ENUM_CONSTANT(STREAMING_SYSTEM_CLIPBOX);
 
+	ADD_SIGNAL(MethodInfo("async_edits_completed"));
+
 	ADD_GROUP("Bounds", "");
 
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "view_distance"), "set_view_distance", "get_view_distance");
@@ -3806,6 +4632,29 @@ void VoxelLodTerrain::_bind_methods() {
 			"get_octahedral_normal_encoding"
 	);
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "normalmap_use_gpu"), "set_normalmap_use_gpu", "get_normalmap_use_gpu");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "normalmap_memory_budget_mb"),
+			"set_normalmap_memory_budget_mb",
+			"get_normalmap_memory_budget_mb"
+	);
+
+	ADD_GROUP("Mesh clustering", "mesh_cluster");
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "mesh_clustering_enabled"),
+			"set_mesh_clustering_enabled",
+			"is_mesh_clustering_enabled"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "mesh_clustering_begin_lod_index"),
+			"set_mesh_clustering_begin_lod_index",
+			"get_mesh_clustering_begin_lod_index"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "mesh_cluster_size", PROPERTY_HINT_ENUM, "2:2,4:4"),
+			"set_mesh_cluster_size",
+			"get_mesh_cluster_size"
+	);
 
 	ADD_GROUP("Collisions", "");
 
@@ -3852,11 +4701,19 @@ void VoxelLodTerrain::_bind_methods() {
 			"is_threaded_update_enabled"
 	);
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_gpu_generation"), "set_generator_use_gpu", "get_generator_use_gpu");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "mesh_baking_enabled"), "set_mesh_baking_enabled", "is_mesh_baking_enabled"
+	);
 	ADD_PROPERTY(
 			PropertyInfo(Variant::INT, "streaming_system", PROPERTY_HINT_ENUM, "Octree (legacy),Clipbox"),
 			"set_streaming_system",
 			"get_streaming_system"
 	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "grouped_loading_begin_lod_index"),
+			"set_grouped_loading_begin_lod_index",
+			"get_grouped_loading_begin_lod_index"
+	);
 
 	ADD_GROUP("Debug Drawing", "debug_");
 
@@ -1,7 +1,11 @@
 #ifndef VOXEL_LOD_TERRAIN_HPP
 #define VOXEL_LOD_TERRAIN_HPP
 
+#include "../../edition/connectivity_cache.h"
+#include "../../edition/random_tick_index.h"
+#include "../../engine/detail_rendering/detail_texture_budget.h"
 #include "../../engine/voxel_engine.h"
+#include "../../meshers/blocky/voxel_blocky_library_base.h"
 #include "../../meshers/mesh_block_task.h"
 #include "../../storage/voxel_data.h"
 #include "../../util/containers/std_map.h"
@@ -13,6 +17,7 @@
 #include "shader_material_pool_vlt.h"
 #include "voxel_lod_terrain_update_data.h"
 #include "voxel_mesh_block_vlt.h"
+#include "voxel_mesh_cluster_vlt.h"
 
 #ifdef TOOLS_ENABLED
 #include "../../util/godot/debug_renderer.h"
@@ -24,6 +29,7 @@ class VoxelTool;
 class VoxelStream;
 class VoxelInstancer;
 class VoxelSaveCompletionTracker;
+class VoxelLodTerrainMultiplayerSynchronizer;
 
 // Paged terrain made of voxel blocks of variable level of detail.
 // Designed for highest view distances, preferably using smooth voxels.
@@ -122,15 +128,38 @@ public:
 	void set_normalmap_use_gpu(bool enabled);
 	bool get_normalmap_use_gpu() const;
 
+	void set_normalmap_memory_budget_mb(int budget);
+	int get_normalmap_memory_budget_mb() const;
+
 	void set_generator_use_gpu(bool enabled);
 	bool get_generator_use_gpu() const;
 
+	// If enabled and the stream supports it, meshes are saved to the stream after being built, and loaded from it
+	// instead of being built again. Meant for worlds that don't change. Baked meshes are discarded when the mesher,
+	// generator or mesh block size change.
+	void set_mesh_baking_enabled(bool enabled);
+	bool is_mesh_baking_enabled() const;
+
+	void set_mesh_clustering_enabled(bool enabled);
+	bool is_mesh_clustering_enabled() const;
+
+	void set_mesh_clustering_begin_lod_index(int lod_index);
+	int get_mesh_clustering_begin_lod_index() const;
+
+	void set_mesh_cluster_size(int size_in_blocks);
+	int get_mesh_cluster_size() const;
+
 	// These must be called after an edit
 	void post_edit_area(Box3i p_box, bool update_mesh);
 	void post_edit_modifiers(Box3i p_voxel_box);
 
 	// TODO This still sucks atm cuz the edit will still run on the main thread
-	void push_async_edit(IThreadedTask *task, Box3i box, std::shared_ptr<AsyncDependencyTracker> tracker);
+	void push_async_edit(
+			IThreadedTask *task,
+			Box3i box,
+			std::shared_ptr<AsyncDependencyTracker> tracker,
+			bool read_only = false
+	);
 	void abort_async_edits();
 
 	void set_voxel_bounds(Box3i p_box);
@@ -199,6 +228,9 @@ public:
 	StreamingSystem get_streaming_system() const;
 	void set_streaming_system(StreamingSystem v);
 
+	void set_grouped_loading_begin_lod_index(int lod_index);
+	int get_grouped_loading_begin_lod_index() const;
+
 	// Debugging
 
 	Array debug_raycast_mesh_block(Vector3 world_origin, Vector3 world_direction) const;
@@ -207,6 +239,12 @@ public:
 	Array debug_get_octree_positions() const;
 	Array debug_get_octrees_detailed() const;
 
+	void debug_set_block_tracing_enabled(bool enabled);
+	bool debug_is_block_tracing_enabled() const;
+	void debug_clear_block_trace();
+	Dictionary debug_get_block_trace() const;
+	Dictionary debug_get_block_trace_latencies() const;
+
 	enum DebugDrawFlag {
 		DEBUG_DRAW_OCTREE_NODES = 0,
 		DEBUG_DRAW_OCTREE_BOUNDS = 1,
@@ -251,6 +289,10 @@ public:
 	// Internal
 
 	void set_instancer(VoxelInstancer *instancer);
+
+	void set_multiplayer_synchronizer(VoxelLodTerrainMultiplayerSynchronizer *synchronizer);
+	const VoxelLodTerrainMultiplayerSynchronizer *get_multiplayer_synchronizer() const;
+
 	VolumeID get_volume_id() const override {
 		return _volume_id;
 	}
@@ -270,6 +312,16 @@ public:
 		return _data;
 	}
 
+	// Used to find floating chunks of voxels. Edits invalidate the blocks they touch.
+	inline ConnectivityCache &get_connectivity_cache() {
+		return _connectivity_cache;
+	}
+
+	// Used by random ticks to find tickable voxels. Edits invalidate the blocks they touch.
+	inline RandomTickIndex &get_random_tick_index() {
+		return _random_tick_index;
+	}
+
 	void get_lod_distances(Span<float> distances);
 
 protected:
@@ -287,15 +339,18 @@ private:
 	void apply_mesh_update(VoxelEngine::BlockMeshOutput &ob);
 	void apply_data_block_response(VoxelEngine::BlockDataOutput &ob);
 	void apply_detail_texture_update(VoxelEngine::BlockDetailTextureOutput &ob);
+	void get_memory_usage(VolumeMemoryUsage &usage) const;
 	void apply_detail_texture_update_to_block(
 			VoxelMeshBlockVLT &block,
 			DetailTextureOutput &ob,
 			unsigned int lod_index
 	);
 	void try_apply_parent_detail_texture_to_block(VoxelMeshBlockVLT &block, Vector3i bpos, unsigned int lod_index);
+	void evict_detail_textures();
 
 	void start_updater();
 	void stop_updater();
+	void update_type_majority_downscaling();
 	void start_streamer();
 	void stop_streamer();
 	void reset_maps();
@@ -306,14 +361,35 @@ private:
 	void set_mesh_block_visual_active(VoxelMeshBlockVLT &block, bool active, bool with_fading, unsigned int lod_index);
 
 	void _on_stream_params_changed();
+	void update_baked_mesh_settings();
 
 	void update_shader_material_pool_template();
 
 	void save_all_modified_blocks(bool with_copy, std::shared_ptr<AsyncDependencyTracker> tracker);
 
-	void process_deferred_collision_updates(uint32_t timeout_msec);
+	void process_deferred_collision_updates(uint32_t timeout_usec);
+	void queue_shader_params_update(VoxelMeshBlockVLT &block, unsigned int lod_index);
+	void flush_shader_params_updates();
 	void process_fading_blocks(float delta);
 
+	void update_mesh_clusters();
+	void start_mesh_cluster_build(
+			VoxelMeshClusterVLT &cluster,
+			Span<const VoxelMeshClusterVLT::Member> members,
+			const VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map,
+			unsigned int lod_index
+	);
+	void show_mesh_cluster(
+			VoxelMeshClusterVLT &cluster,
+			VoxelMeshClusterVLT::BuildOutput &output,
+			VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map,
+			unsigned int lod_index
+	);
+	void hide_mesh_cluster(VoxelMeshClusterVLT &cluster, VoxelMeshMap<VoxelMeshBlockVLT> &mesh_map);
+	void clear_mesh_clusters();
+	void reset_mesh_clusters();
+	void remesh_all_blocks_from_lod(unsigned int begin_lod_index);
+
 	struct LocalCameraInfo {
 		Vector3 position;
 		Vector3 forward;
@@ -357,6 +433,8 @@ private:
 	// The problem is, that also means every time `ShaderMaterial::duplicate()` is called, when it assigns `shader`,
 	// it has to add a connection to a HUGE list. Which is very slow, enough to cause stutters.
 	ShaderMaterialPoolVLT _shader_material_pool;
+	// Mesh instances of blocks that left view, re-used when other blocks enter view
+	zylann::godot::DirectMeshInstancePool _mesh_instance_pool;
 
 	FixedArray<VoxelMeshMap<VoxelMeshBlockVLT>, constants::MAX_LOD> _mesh_maps_per_lod;
 
@@ -388,6 +466,8 @@ private:
 	// thread that updates fading blocks. If a mesh block is destroyed, these maps should be updated at the same time.
 	// TODO Optimization: use FlatMap? Need to check how many blocks get in there, probably not many
 	FixedArray<StdMap<Vector3i, VoxelMeshBlockVLT *>, constants::MAX_LOD> _fading_blocks_per_lod;
+	// Blocks whose shader parameters changed this frame, written to their material once at the end of `process`
+	FixedArray<StdVector<Vector3i>, constants::MAX_LOD> _shader_params_updates_per_lod;
 
 	struct FadingDetailTexture {
 		Vector3i block_position;
@@ -396,18 +476,33 @@ private:
 	};
 
 	StdVector<FadingDetailTexture> _fading_detail_textures;
+	// Limits video memory taken by detail textures. Evicted textures are computed again when their block gets visible.
+	DetailTextureBudget _detail_texture_budget;
+
+	bool _mesh_clustering_enabled = false;
+	uint8_t _mesh_clustering_begin_lod_index = 3;
+	uint8_t _mesh_cluster_size_po2 = 1;
+	uint32_t _next_mesh_revision = 0;
+	FixedArray<StdUnorderedMap<Vector3i, VoxelMeshClusterVLT>, constants::MAX_LOD> _mesh_clusters_per_lod;
 
 	VoxelInstancer *_instancer = nullptr;
+	VoxelLodTerrainMultiplayerSynchronizer *_multiplayer_synchronizer = nullptr;
 
 	Ref<VoxelMesher> _mesher;
+	// Library data last used to configure majority downscaling of voxel types, when the mesher is blocky
+	std::shared_ptr<const VoxelBlockyLibraryBase::BakedData> _type_downscaling_baked_data;
 
 	// Data stored with a shared pointer so it can be sent to asynchronous tasks
 	bool _threaded_update_enabled = false;
+	bool _mesh_baking_enabled = false;
 	std::shared_ptr<VoxelData> _data;
 	std::shared_ptr<VoxelLodTerrainUpdateData> _update_data;
 	std::shared_ptr<StreamingDependency> _streaming_dependency;
 	std::shared_ptr<MeshingDependency> _meshing_dependency;
 
+	ConnectivityCache _connectivity_cache;
+	RandomTickIndex _random_tick_index;
+
 	struct ApplyMeshUpdateTask : public ITimeSpreadTask {
 		void run(TimeSpreadTaskContext &ctx) override;
 
@@ -0,0 +1,546 @@
+#include "voxel_lod_terrain_multiplayer_synchronizer.h"
+#include "../../constants/voxel_string_names.h"
+#include "../../engine/voxel_engine.h"
+#include "../../streams/voxel_block_serializer.h"
+#include "../../util/containers/container_funcs.h"
+#include "../../util/godot/classes/engine.h"
+#include "../../util/godot/classes/multiplayer_api.h"
+#include "../../util/godot/classes/multiplayer_peer.h"
+#include "../../util/godot/core/array.h"
+#include "../../util/godot/core/packed_arrays.h"
+#include "../../util/io/serialization.h"
+#include "../../util/math/conv.h"
+#include "../../util/profiling.h"
+#include "../../util/string/format.h"
+#include "voxel_lod_terrain.h"
+
+#include <algorithm>
+
+namespace zylann::voxel {
+
+namespace {
+
+// Received data waiting for the client to load the area is dropped beyond this amount, oldest first
+static const unsigned int MAX_PENDING_EDITS = 4096;
+
+float get_distance_squared_to_box(const Vector3 p, const Box3i box) {
+	const Vector3i box_max = box.position + box.size;
+	const Vector3 closest( //
+			math::clamp(p.x, real_t(box.position.x), real_t(box_max.x)),
+			math::clamp(p.y, real_t(box.position.y), real_t(box_max.y)),
+			math::clamp(p.z, real_t(box.position.z), real_t(box_max.z))
+	);
+	return p.distance_squared_to(closest);
+}
+
+float get_min_distance_squared(const Vector3 p, Span<const Vector3> positions) {
+	float distance_sq = p.distance_squared_to(positions[0]);
+	for (unsigned int i = 1; i < positions.size(); ++i) {
+		distance_sq = math::min(distance_sq, p.distance_squared_to(positions[i]));
+	}
+	return distance_sq;
+}
+
+} // namespace
+
+VoxelLodTerrainMultiplayerSynchronizer::VoxelLodTerrainMultiplayerSynchronizer() {
+	Dictionary config;
+	config["rpc_mode"] = MultiplayerAPI::RPC_MODE_AUTHORITY;
+	config["transfer_mode"] = MultiplayerPeer::TRANSFER_MODE_RELIABLE;
+	config["call_local"] = false;
+	config["channel"] = _rpc_channel;
+
+	rpc_config(VoxelStringNames::get_singleton()._rpc_receive_blocks, config);
+	rpc_config(VoxelStringNames::get_singleton()._rpc_receive_area, config);
+
+	set_process(true);
+}
+
+bool VoxelLodTerrainMultiplayerSynchronizer::is_server() const {
+	ZN_ASSERT_RETURN_V(is_inside_tree(), false);
+	Ref<MultiplayerAPI> mp = get_multiplayer();
+	ZN_ASSERT_RETURN_V(mp.is_valid(), false);
+	return mp->is_server();
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::set_max_bytes_per_second_per_peer(int bps) {
+	_max_bytes_per_second_per_peer = math::max(bps, 0);
+}
+
+int VoxelLodTerrainMultiplayerSynchronizer::get_max_bytes_per_second_per_peer() const {
+	return _max_bytes_per_second_per_peer;
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::send_area(Box3i voxel_box) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(_terrain != nullptr);
+
+	if (_peers.size() == 0) {
+		return;
+	}
+
+	VoxelData &data = _terrain->get_storage();
+	voxel_box.clip(data.get_bounds());
+	if (Vector3iUtil::is_empty_size(voxel_box.size)) {
+		return;
+	}
+
+	const float block_size = _terrain->get_data_block_size();
+
+	PackedByteArray pba;
+
+	for (auto it = _peers.begin(); it != _peers.end(); ++it) {
+		Peer &peer = it->second;
+		if (peer.viewer_positions.size() == 0) {
+			continue;
+		}
+		// Peers further away will get the whole block if they come closer, since it is now edited. Range is the
+		// same as the one where peers are assumed to have edited blocks (see `update_known_blocks`).
+		const float max_distance = static_cast<float>(peer.view_distance) + 2.f * block_size;
+		float distance_sq = get_distance_squared_to_box(peer.viewer_positions[0], voxel_box);
+		for (unsigned int i = 1; i < peer.viewer_positions.size(); ++i) {
+			distance_sq = math::min(distance_sq, get_distance_squared_to_box(peer.viewer_positions[i], voxel_box));
+		}
+		if (distance_sq > max_distance * max_distance) {
+			continue;
+		}
+
+		if (pba.size() == 0) {
+			// Not particularly efficient for single-voxel edits, but should scale ok with bigger boxes
+			VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_POOL);
+			voxels.create(voxel_box.size);
+			data.copy(voxel_box.position, voxels, 0xff);
+
+			BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(voxels);
+			ZN_ASSERT_RETURN(result.success);
+
+			pba.resize(4 * sizeof(int32_t) + result.data.size());
+
+			ByteSpanWithPosition mw_span(Span<uint8_t>(pba.ptrw(), pba.size()), 0);
+			MemoryWriterExistingBuffer mw(mw_span, ENDIANNESS_LITTLE_ENDIAN);
+
+			mw.store_32(voxel_box.position.x);
+			mw.store_32(voxel_box.position.y);
+			mw.store_32(voxel_box.position.z);
+			mw.store_32(result.data.size());
+			mw.store_buffer(to_span(result.data));
+		}
+
+		// Sent in `process`, so edits are not sent before blocks they modify if those are still queued.
+		// PackedByteArray is copy-on-write, so this doesn't duplicate the data.
+		peer.areas.push_back(pba);
+	}
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::_notification(int p_what) {
+	if (p_what == NOTIFICATION_PARENTED) {
+		VoxelLodTerrain *terrain = Object::cast_to<VoxelLodTerrain>(get_parent());
+		if (terrain != nullptr && terrain->get_multiplayer_synchronizer() == nullptr) {
+			terrain->set_multiplayer_synchronizer(this);
+			_terrain = terrain;
+		}
+
+	} else if (p_what == NOTIFICATION_UNPARENTED) {
+		if (_terrain != nullptr && _terrain->get_multiplayer_synchronizer() == this) {
+			_terrain->set_multiplayer_synchronizer(nullptr);
+		}
+		_terrain = nullptr;
+
+	} else if (p_what == NOTIFICATION_PROCESS) {
+		if (_terrain == nullptr || Engine::get_singleton()->is_editor_hint()) {
+			return;
+		}
+		if (is_server()) {
+			process_server(get_process_delta_time());
+		} else {
+			process_client();
+		}
+	}
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::process_server(float delta) {
+	ZN_PROFILE_SCOPE();
+
+	update_peers();
+
+	const VoxelStringNames &sn = VoxelStringNames::get_singleton();
+	const bool rate_limited = _max_bytes_per_second_per_peer > 0;
+
+	for (auto it = _peers.begin(); it != _peers.end(); ++it) {
+		const int peer_id = it->first;
+		Peer &peer = it->second;
+
+		if (rate_limited) {
+			// Unused budget accumulates up to one second worth of data, to allow bursts
+			peer.budget = math::min(
+					peer.budget + static_cast<float>(_max_bytes_per_second_per_peer) * delta,
+					static_cast<float>(_max_bytes_per_second_per_peer)
+			);
+		}
+
+		update_known_blocks(peer);
+
+		// Edits are sent first, they are usually small and were made around players
+		unsigned int sent_area_count = 0;
+		for (; sent_area_count < peer.areas.size(); ++sent_area_count) {
+			if (rate_limited && peer.budget <= 0.f) {
+				break;
+			}
+			const PackedByteArray &pba = peer.areas[sent_area_count];
+			rpc_id(peer_id, sn._rpc_receive_area, pba);
+			peer.budget -= pba.size();
+		}
+		peer.areas.erase(peer.areas.begin(), peer.areas.begin() + sent_area_count);
+
+		if (peer.block_positions.size() > 0 && !(rate_limited && peer.budget <= 0.f)) {
+			send_blocks(peer_id, peer);
+		}
+	}
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::update_peers() {
+	for (auto it = _peers.begin(); it != _peers.end(); ++it) {
+		Peer &peer = it->second;
+		peer.viewer_positions.clear();
+		peer.view_distance = 0;
+	}
+
+	const Transform3D world_to_local = _terrain->get_global_transform().affine_inverse();
+	VoxelEngine::get_singleton().for_each_viewer(
+			[this, &world_to_local](ViewerID id, const VoxelEngine::Viewer &viewer) {
+				if (viewer.network_peer_id == -1 || viewer.network_peer_id == MultiplayerPeer::TARGET_PEER_SERVER) {
+					return;
+				}
+				Peer &peer = _peers[viewer.network_peer_id];
+				peer.viewer_positions.push_back(world_to_local.xform(viewer.world_position));
+				peer.view_distance = math::max(peer.view_distance, viewer.view_distances.max());
+			}
+	);
+
+	// Forget peers that left, or no longer have viewers needing the terrain
+	for (auto it = _peers.begin(); it != _peers.end();) {
+		if (it->second.viewer_positions.size() == 0) {
+			it = _peers.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::update_known_blocks(Peer &peer) {
+	const unsigned int block_size_po2 = _terrain->get_data_block_size_pow2();
+
+	// Only look for edited blocks when viewers cross block boundaries. Blocks edited while in range are sent as areas.
+	static thread_local StdVector<Vector3i> tls_viewer_block_positions;
+	StdVector<Vector3i> &viewer_block_positions = tls_viewer_block_positions;
+	viewer_block_positions.clear();
+	for (const Vector3 vpos : peer.viewer_positions) {
+		viewer_block_positions.push_back(math::floor_to_int(vpos) >> block_size_po2);
+	}
+	if (viewer_block_positions == peer.scanned_viewer_block_positions) {
+		return;
+	}
+	peer.scanned_viewer_block_positions = viewer_block_positions;
+
+	ZN_PROFILE_SCOPE();
+
+	const real_t block_size = 1 << block_size_po2;
+	const Vector3 half_block_size = Vector3(1, 1, 1) * (block_size / 2);
+	const Span<const Vector3> viewer_positions = to_span(peer.viewer_positions);
+
+	// Blocks are sent when their center is in range, and forgotten a bit further away, so the peer doesn't need to
+	// receive them again if its viewers move back and forth. Clients are expected to have a slightly larger view
+	// distance, so they unload blocks after the server forgot about them.
+	const float send_distance = static_cast<float>(peer.view_distance) + block_size;
+	const float send_distance_sq = send_distance * send_distance;
+	const float forget_distance = send_distance + block_size;
+	const float forget_distance_sq = forget_distance * forget_distance;
+
+	for (auto it = peer.known_blocks.begin(); it != peer.known_blocks.end();) {
+		const Vector3 center = Vector3(*it << block_size_po2) + half_block_size;
+		if (get_min_distance_squared(center, viewer_positions) > forget_distance_sq) {
+			it = peer.known_blocks.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	const VoxelData &data = _terrain->get_storage();
+	data.for_each_block_at_lod_r(
+			[&peer, viewer_positions, block_size_po2, half_block_size, send_distance_sq](
+					Vector3i bpos, const VoxelDataBlock &block
+			) {
+				// Blocks that were not edited can be generated by the peer
+				if (!block.is_edited()) {
+					return;
+				}
+				const Vector3 center = Vector3(bpos << block_size_po2) + half_block_size;
+				if (get_min_distance_squared(center, viewer_positions) > send_distance_sq) {
+					return;
+				}
+				if (peer.known_blocks.insert(bpos).second) {
+					peer.block_positions.push_back(bpos);
+				}
+			},
+			0
+	);
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::send_blocks(int peer_id, Peer &peer) {
+	ZN_PROFILE_SCOPE();
+
+	const bool rate_limited = _max_bytes_per_second_per_peer > 0;
+	const unsigned int block_size_po2 = _terrain->get_data_block_size_pow2();
+	const Vector3 half_block_size = Vector3(1, 1, 1) * static_cast<real_t>((1 << block_size_po2) / 2);
+	const Span<const Vector3> viewer_positions = to_span(peer.viewer_positions);
+
+	// Send closest blocks first
+	struct BlockToSend {
+		float distance_sq;
+		Vector3i position;
+	};
+	static thread_local StdVector<BlockToSend> tls_blocks_to_send;
+	StdVector<BlockToSend> &blocks_to_send = tls_blocks_to_send;
+	blocks_to_send.clear();
+	for (const Vector3i bpos : peer.block_positions) {
+		const Vector3 center = Vector3(bpos << block_size_po2) + half_block_size;
+		blocks_to_send.push_back(BlockToSend{ get_min_distance_squared(center, viewer_positions), bpos });
+	}
+	std::sort(blocks_to_send.begin(), blocks_to_send.end(), [](const BlockToSend &a, const BlockToSend &b) {
+		return a.distance_sq < b.distance_sq;
+	});
+
+	// Make one big message per frame per peer, because sending many RPCs is slow
+	static thread_local StdVector<uint8_t> tls_message_data;
+	StdVector<uint8_t> &message_data = tls_message_data;
+	message_data.clear();
+	MemoryWriter mw(message_data, ENDIANNESS_LITTLE_ENDIAN);
+	// Block count, written at the end
+	mw.store_32(0);
+
+	VoxelData &data = _terrain->get_storage();
+	unsigned int block_count = 0;
+	unsigned int processed_count = 0;
+
+	for (; processed_count < blocks_to_send.size(); ++processed_count) {
+		if (rate_limited && peer.budget - static_cast<float>(message_data.size()) <= 0.f) {
+			break;
+		}
+		const Vector3i bpos = blocks_to_send[processed_count].position;
+
+		SpatialLock3D::Read srlock(data.get_spatial_lock(0), BoxBounds3i::from_position(bpos));
+		std::shared_ptr<VoxelBuffer> voxels = data.try_get_block_voxels(bpos);
+		if (voxels == nullptr) {
+			// Got unloaded since it was found
+			peer.known_blocks.erase(bpos);
+			continue;
+		}
+
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(*voxels);
+		ZN_ASSERT_CONTINUE(result.success);
+		ZN_ASSERT_CONTINUE(result.data.size() <= 65535);
+
+		mw.store_16(bpos.x);
+		mw.store_16(bpos.y);
+		mw.store_16(bpos.z);
+		mw.store_16(result.data.size());
+		mw.store_buffer(to_span(result.data));
+		++block_count;
+	}
+
+	// Keep remaining blocks for next time. Order doesn't matter, they get sorted again.
+	peer.block_positions.clear();
+	for (unsigned int i = processed_count; i < blocks_to_send.size(); ++i) {
+		peer.block_positions.push_back(blocks_to_send[i].position);
+	}
+
+	if (block_count == 0) {
+		return;
+	}
+
+	{
+		ByteSpanWithPosition count_span(Span<uint8_t>(message_data.data(), sizeof(uint32_t)), 0);
+		MemoryWriterExistingBuffer count_mw(count_span, ENDIANNESS_LITTLE_ENDIAN);
+		count_mw.store_32(block_count);
+	}
+
+	peer.budget -= message_data.size();
+
+	PackedByteArray pba;
+	copy_to(pba, to_span(message_data));
+
+	ZN_PRINT_VERBOSE(format("Sending {} edited blocks ({} bytes) to peer {}", block_count, pba.size(), peer_id));
+	rpc_id(peer_id, VoxelStringNames::get_singleton()._rpc_receive_blocks, pba);
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::add_pending_edit(Vector3i position, std::shared_ptr<VoxelBuffer> voxels) {
+	if (_pending_edits.size() >= MAX_PENDING_EDITS) {
+		ZN_PRINT_VERBOSE("Too many received edits waiting for the terrain to load, dropping the oldest");
+		_pending_edits.erase(_pending_edits.begin());
+	}
+	_pending_edits.push_back(PendingEdit{ position, voxels });
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::process_client() {
+	if (_pending_edits.size() == 0) {
+		return;
+	}
+
+	ZN_PROFILE_SCOPE();
+
+	VoxelData &data = _terrain->get_storage();
+
+	// Areas of edits that can't be applied yet. Later edits overlapping them must wait too, to keep them in order.
+	static thread_local StdVector<Box3i> tls_waiting_boxes;
+	StdVector<Box3i> &waiting_boxes = tls_waiting_boxes;
+	waiting_boxes.clear();
+
+	unsigned int remaining_count = 0;
+
+	for (unsigned int i = 0; i < _pending_edits.size(); ++i) {
+		PendingEdit &edit = _pending_edits[i];
+		const Box3i box(edit.position, edit.voxels->get_size());
+
+		bool can_apply = data.is_area_loaded(box);
+		if (can_apply) {
+			for (const Box3i &waiting_box : waiting_boxes) {
+				if (waiting_box.intersects(box)) {
+					can_apply = false;
+					break;
+				}
+			}
+		}
+
+		if (can_apply) {
+			data.paste(edit.position, *edit.voxels, 0xff, false);
+			// This also schedules updates of LOD mips and meshes
+			_terrain->post_edit_area(box, true);
+		} else {
+			waiting_boxes.push_back(box);
+			if (remaining_count != i) {
+				_pending_edits[remaining_count] = std::move(edit);
+			}
+			++remaining_count;
+		}
+	}
+
+	_pending_edits.resize(remaining_count);
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::_b_receive_blocks(PackedByteArray message_data) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(_terrain != nullptr);
+
+	MemoryReader mr(Span<const uint8_t>(message_data.ptr(), message_data.size()), ENDIANNESS_LITTLE_ENDIAN);
+
+	const unsigned int block_count = mr.get_32();
+	const unsigned int block_size_po2 = _terrain->get_data_block_size_pow2();
+
+	for (unsigned int i = 0; i < block_count; ++i) {
+		Vector3i bpos;
+		bpos.x = int16_t(mr.get_16());
+		bpos.y = int16_t(mr.get_16());
+		bpos.z = int16_t(mr.get_16());
+		const int voxel_data_size = mr.get_16();
+
+		std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+		ZN_ASSERT_RETURN(BlockSerializer::decompress_and_deserialize(mr.data.sub(mr.pos, voxel_data_size), *voxels));
+		ZN_ASSERT_RETURN(voxels->get_size() == Vector3iUtil::create(1 << block_size_po2));
+
+		mr.pos += voxel_data_size;
+
+		add_pending_edit(bpos << block_size_po2, voxels);
+	}
+
+	// Apply right away what can be
+	process_client();
+}
+
+void VoxelLodTerrainMultiplayerSynchronizer::_b_receive_area(PackedByteArray message_data) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(_terrain != nullptr);
+
+	MemoryReader mr(Span<const uint8_t>(message_data.ptr(), message_data.size()), ENDIANNESS_LITTLE_ENDIAN);
+
+	Vector3i pos;
+	pos.x = int32_t(mr.get_32());
+	pos.y = int32_t(mr.get_32());
+	pos.z = int32_t(mr.get_32());
+	const int voxel_data_size = mr.get_32();
+
+	std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_POOL);
+	ZN_ASSERT_RETURN(BlockSerializer::decompress_and_deserialize(mr.data.sub(mr.pos, voxel_data_size), *voxels));
+
+	add_pending_edit(pos, voxels);
+	process_client();
+}
+
+#ifdef TOOLS_ENABLED
+
+#if defined(ZN_GODOT)
+PackedStringArray VoxelLodTerrainMultiplayerSynchronizer::get_configuration_warnings() const {
+	PackedStringArray warnings;
+	get_configuration_warnings(warnings);
+	return warnings;
+}
+#elif defined(ZN_GODOT_EXTENSION)
+PackedStringArray VoxelLodTerrainMultiplayerSynchronizer::_get_configuration_warnings() const {
+	PackedStringArray warnings;
+	get_configuration_warnings(warnings);
+	return warnings;
+}
+#endif
+
+void VoxelLodTerrainMultiplayerSynchronizer::get_configuration_warnings(PackedStringArray &warnings) const {
+	if (is_inside_tree()) {
+		if (_terrain == nullptr) {
+			warnings.append(
+					ZN_TTR("This node must be child of {0}").format(varray(VoxelLodTerrain::get_class_static()))
+			);
+		}
+
+		const Node *parent_node = get_parent();
+
+		if (parent_node != nullptr) {
+			const VoxelLodTerrain *terrain = Object::cast_to<VoxelLodTerrain>(parent_node);
+			if (terrain != nullptr && terrain->get_multiplayer_synchronizer() != this) {
+				warnings.append(ZN_TTR("Only one instance of {0} should exist under a {1}")
+										.format(
+												varray(VoxelLodTerrainMultiplayerSynchronizer::get_class_static(),
+													   VoxelLodTerrain::get_class_static())
+										));
+			}
+		}
+	}
+}
+
+#endif
+
+void VoxelLodTerrainMultiplayerSynchronizer::_bind_methods() {
+	// These methods are not supposed to be exposed. They only exist for Godot's high-level multiplayer to find them.
+	ClassDB::bind_method(
+			D_METHOD("_rpc_receive_blocks", "data"), &VoxelLodTerrainMultiplayerSynchronizer::_b_receive_blocks
+	);
+	ClassDB::bind_method(
+			D_METHOD("_rpc_receive_area", "data"), &VoxelLodTerrainMultiplayerSynchronizer::_b_receive_area
+	);
+
+	ClassDB::bind_method(
+			D_METHOD("set_max_bytes_per_second_per_peer", "bps"),
+			&VoxelLodTerrainMultiplayerSynchronizer::set_max_bytes_per_second_per_peer
+	);
+	ClassDB::bind_method(
+			D_METHOD("get_max_bytes_per_second_per_peer"),
+			&VoxelLodTerrainMultiplayerSynchronizer::get_max_bytes_per_second_per_peer
+	);
+
+	ADD_PROPERTY(
+			PropertyInfo(
+					Variant::INT, "max_bytes_per_second_per_peer", PROPERTY_HINT_RANGE, "0,100000000,1,or_greater"
+			),
+			"set_max_bytes_per_second_per_peer",
+			"get_max_bytes_per_second_per_peer"
+	);
+}
+
+} // namespace zylann::voxel
@@ -0,0 +1,104 @@
+#ifndef VOXEL_LOD_TERRAIN_MULTIPLAYER_SYNCHRONIZER_H
+#define VOXEL_LOD_TERRAIN_MULTIPLAYER_SYNCHRONIZER_H
+
+#include "../../storage/voxel_buffer.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_unordered_set.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/node.h"
+#include "../../util/math/box3i.h"
+
+#include <memory>
+
+#ifdef TOOLS_ENABLED
+#include "../../util/godot/core/version.h"
+#endif
+
+namespace zylann::voxel {
+
+class VoxelLodTerrain;
+
+// Implements multiplayer replication for `VoxelLodTerrain`.
+// Only edited blocks of LOD0 are sent. Clients generate everything else locally, and compute LOD mips of the blocks
+// they receive.
+class VoxelLodTerrainMultiplayerSynchronizer : public Node {
+	GDCLASS(VoxelLodTerrainMultiplayerSynchronizer, Node)
+public:
+	VoxelLodTerrainMultiplayerSynchronizer();
+
+	bool is_server() const;
+
+	void send_area(Box3i voxel_box);
+
+	// Limits how much voxel data is sent to each peer. Blocks closest to viewers of the peer are sent first.
+	// 0 means no limit.
+	void set_max_bytes_per_second_per_peer(int bps);
+	int get_max_bytes_per_second_per_peer() const;
+
+#ifdef TOOLS_ENABLED
+#if defined(ZN_GODOT)
+	PackedStringArray get_configuration_warnings() const override;
+#elif defined(ZN_GODOT_EXTENSION)
+	PackedStringArray _get_configuration_warnings() const override;
+#endif
+	void get_configuration_warnings(PackedStringArray &warnings) const;
+#endif
+
+private:
+	void _notification(int p_what);
+
+	void process_server(float delta);
+	void process_client();
+
+	void _b_receive_blocks(PackedByteArray message_data);
+	void _b_receive_area(PackedByteArray message_data);
+
+	void add_pending_edit(Vector3i position, std::shared_ptr<VoxelBuffer> voxels);
+
+	static void _bind_methods();
+
+	VoxelLodTerrain *_terrain = nullptr;
+	int _rpc_channel = 0;
+
+	int _max_bytes_per_second_per_peer = 0;
+
+	// Server
+
+	struct Peer {
+		// Positions of viewers of the peer in the last frame, local to the terrain
+		StdVector<Vector3> viewer_positions;
+		// Largest view distance of viewers of the peer
+		unsigned int view_distance = 0;
+		// Block positions of viewers when edited blocks were last looked up around them
+		StdVector<Vector3i> scanned_viewer_block_positions;
+		// Edited blocks that were sent or are waiting to be sent. The peer is assumed to have them as long as they
+		// remain in range of its viewers.
+		StdUnorderedSet<Vector3i> known_blocks;
+		// Blocks are serialized only when sent, so they contain the latest edits and can be sent in any order
+		StdVector<Vector3i> block_positions;
+		// Serialized edited areas, sent in order
+		StdVector<PackedByteArray> areas;
+		// Bytes that can be sent before exceeding the rate limit
+		float budget = 0.f;
+	};
+
+	void update_peers();
+	void update_known_blocks(Peer &peer);
+	void send_blocks(int peer_id, Peer &peer);
+
+	StdUnorderedMap<int, Peer> _peers;
+
+	// Client
+
+	// Received data can't be applied until the client has loaded the area, so it is kept until then, in the order
+	// it was received.
+	struct PendingEdit {
+		Vector3i position;
+		std::shared_ptr<VoxelBuffer> voxels;
+	};
+	StdVector<PendingEdit> _pending_edits;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_LOD_TERRAIN_MULTIPLAYER_SYNCHRONIZER_H
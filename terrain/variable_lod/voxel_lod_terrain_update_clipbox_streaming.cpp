@@ -1,8 +1,11 @@
 #include "voxel_lod_terrain_update_clipbox_streaming.h"
+#include "../../engine/voxel_engine.h"
+#include "../../util/containers/container_funcs.h"
 #include "../../util/containers/std_unordered_set.h"
 #include "../../util/math/conv.h"
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
+#include "voxel_lod_terrain_update_parallel_jobs.h"
 #include "voxel_lod_terrain_update_task.h"
 
 // #include <fstream>
@@ -103,6 +106,18 @@ Box3i enforce_neighboring_rule(Box3i box, const Box3i &child_lod_box, bool make_
 	return box;
 }
 
+// Extends a box of data chunks so it also covers where it would be if the viewer moved by the given offset. This
+// allows to load data ahead of fast viewers.
+Box3i get_prefetch_box(Box3i box, Vector3i prefetch_offset_voxels, int lod_data_block_size) {
+	// Rounding towards zero, so jitter around a still viewer doesn't cause loading
+	const Vector3i offset_in_chunks = prefetch_offset_voxels / lod_data_block_size;
+	if (offset_in_chunks == Vector3i()) {
+		return box;
+	}
+	box.merge_with(Box3i(box.position + offset_in_chunks, box.size));
+	return box;
+}
+
 inline int get_lod_distance_in_mesh_chunks(float lod_distance_in_voxels, int mesh_block_size) {
 	return math::max(static_cast<int>(Math::ceil(lod_distance_in_voxels)) / mesh_block_size, 1);
 }
@@ -248,6 +263,16 @@ void process_viewers(
 		paired_viewer.state.requires_collisions = viewer.require_collisions && can_mesh;
 		paired_viewer.state.requires_visuals = viewer.require_visuals && can_mesh;
 
+		// Data is also loaded where the viewer is predicted to be soon, so it is ready by the time meshes need it.
+		// The offset is limited to view distance, so a wrong estimation can't cause huge areas to load.
+		Vector3i prefetch_offset_voxels;
+		if (viewer.prediction_time > 0.f) {
+			Vector3 prefetch_offset = world_to_local_transform.xform(viewer.get_predicted_world_position()) -
+					local_position;
+			prefetch_offset = prefetch_offset.limit_length(paired_viewer.state.view_distance_voxels.horizontal);
+			prefetch_offset_voxels = math::floor_to_int(prefetch_offset);
+		}
+
 		// Viewers can request any box they like, but they must follow these rules:
 		// - Boxes of parent LODs must contain child boxes (when converted into world coordinates)
 		// - Mesh boxes that have a parent LOD must have an even size and even position, in order to support subdivision
@@ -341,10 +366,11 @@ void process_viewers(
 								// To account for meshes requiring neighbor data chunks.
 								// It technically breaks the subdivision rule (where every parent block always has 8
 								// children), but it should only matter in areas where meshes must actually spawn
-								.padded(1)
-								.clipped(volume_bounds_in_data_blocks);
+								.padded(1);
 
-				paired_viewer.state.data_box_per_lod[lod_index] = data_box;
+				paired_viewer.state.data_box_per_lod[lod_index] =
+						get_prefetch_box(data_box, prefetch_offset_voxels, 1 << lod_data_block_size_po2)
+								.clipped(volume_bounds_in_data_blocks);
 			}
 
 		} else {
@@ -374,17 +400,18 @@ void process_viewers(
 						)
 				);
 
-				const Box3i new_data_box =
-						get_base_box_in_chunks(
-								paired_viewer.state.local_position_voxels,
-								// Making sure that distance is a multiple of chunk size, for consistent box size
-								ld * lod_data_block_size,
-								lod_data_block_size,
-								// Make min and max coordinates even in child LODs, to respect subdivision rule.
-								// Root LOD doesn't need to respect that,
-								lod_index != lod_count - 1
-						)
-								.clipped(volume_bounds_in_data_blocks);
+				const Box3i base_data_box = get_base_box_in_chunks(
+						paired_viewer.state.local_position_voxels,
+						// Making sure that distance is a multiple of chunk size, for consistent box size
+						ld * lod_data_block_size,
+						lod_data_block_size,
+						// Make min and max coordinates even in child LODs, to respect subdivision rule.
+						// Root LOD doesn't need to respect that,
+						lod_index != lod_count - 1
+				);
+
+				const Box3i new_data_box = get_prefetch_box(base_data_box, prefetch_offset_voxels, lod_data_block_size)
+												   .clipped(volume_bounds_in_data_blocks);
 
 				// const Box3i new_data_box = get_lod_box_in_chunks(paired_viewer.state.local_position_voxels,
 				// 		lod_distance_in_data_chunks, data_block_size_po2, lod_index)
@@ -409,6 +436,155 @@ void remove_unpaired_viewers(
 	}
 }
 
+// Viewers are merged only if the bounding box of their boxes doesn't add more than this fraction of blocks that none of
+// them would view on their own
+const float STREAMING_REGION_MAX_WASTE_RATIO = 0.25f;
+
+bool is_viewing_anything(const VoxelLodTerrainUpdateData::PairedViewer::State &state, unsigned int lod_count) {
+	// Parent boxes contain child boxes, and data boxes contain mesh boxes, so checking the last LOD is enough
+	return lod_count > 0 && !state.data_box_per_lod[lod_count - 1].is_empty();
+}
+
+bool can_merge_into_streaming_region(
+		const VoxelLodTerrainUpdateData::PairedViewer::State &region_state,
+		const VoxelLodTerrainUpdateData::PairedViewer::State &viewer_state
+) {
+	// All blocks of a region are viewed with the same flags
+	if (region_state.requires_collisions != viewer_state.requires_collisions ||
+		region_state.requires_visuals != viewer_state.requires_visuals) {
+		return false;
+	}
+
+	// Only LOD0 is compared. It has the most blocks to stream, and boxes of parent LODs overlap even more.
+	const Box3i &a = region_state.data_box_per_lod[0];
+	const Box3i &b = viewer_state.data_box_per_lod[0];
+	if (!a.intersects(b)) {
+		return false;
+	}
+
+	const int64_t union_volume = Vector3iUtil::get_volume(a.size) + Vector3iUtil::get_volume(b.size) -
+			Vector3iUtil::get_volume(a.clipped(b).size);
+	const int64_t merged_volume = Vector3iUtil::get_volume(Box3i::get_bounding_box(a, b).size);
+
+	return merged_volume - union_volume <= static_cast<int64_t>(union_volume * STREAMING_REGION_MAX_WASTE_RATIO);
+}
+
+inline Box3i get_bounding_box_of_non_empty(const Box3i &a, const Box3i &b) {
+	if (a.is_empty()) {
+		return b;
+	}
+	if (b.is_empty()) {
+		return a;
+	}
+	return Box3i::get_bounding_box(a, b);
+}
+
+void merge_into_streaming_region(
+		VoxelLodTerrainUpdateData::PairedViewer::State &region_state,
+		const VoxelLodTerrainUpdateData::PairedViewer::State &viewer_state,
+		unsigned int lod_count
+) {
+	// Bounding boxes still follow the rules of viewer boxes: they contain the boxes of child LODs, have even
+	// coordinates where those did, and data boxes contain mesh boxes.
+	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+		region_state.data_box_per_lod[lod_index] = get_bounding_box_of_non_empty(
+				region_state.data_box_per_lod[lod_index], viewer_state.data_box_per_lod[lod_index]
+		);
+		region_state.mesh_box_per_lod[lod_index] = get_bounding_box_of_non_empty(
+				region_state.mesh_box_per_lod[lod_index], viewer_state.mesh_box_per_lod[lod_index]
+		);
+	}
+}
+
+// Assigns paired viewers to streaming regions. Regions are what the sliding box logic iterates, so blocks are
+// referenced once per region rather than once per viewer.
+void update_streaming_regions(VoxelLodTerrainUpdateData::ClipboxStreamingState &cs, unsigned int lod_count) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<VoxelLodTerrainUpdateData::StreamingRegion> &regions = cs.streaming_regions;
+
+	for (VoxelLodTerrainUpdateData::StreamingRegion &region : regions) {
+		region.prev_state = region.state;
+		region.viewer_count = 0;
+	}
+
+	for (VoxelLodTerrainUpdateData::PairedViewer &viewer : cs.paired_viewers) {
+		const unsigned int prev_region_index = viewer.region_index;
+		viewer.region_index = VoxelLodTerrainUpdateData::NO_STREAMING_REGION;
+
+		// Destroyed viewers have empty boxes
+		if (!is_viewing_anything(viewer.state, lod_count)) {
+			continue;
+		}
+
+		// Staying in the same region is preferred, so regions keep their boxes while their viewers stay together
+		if (prev_region_index < regions.size()) {
+			VoxelLodTerrainUpdateData::StreamingRegion &region = regions[prev_region_index];
+			if (region.viewer_count == 0) {
+				region.state = viewer.state;
+				region.viewer_count = 1;
+				viewer.region_index = prev_region_index;
+				continue;
+			}
+			if (can_merge_into_streaming_region(region.state, viewer.state)) {
+				merge_into_streaming_region(region.state, viewer.state, lod_count);
+				++region.viewer_count;
+				viewer.region_index = prev_region_index;
+				continue;
+			}
+		}
+
+		for (unsigned int region_index = 0; region_index < regions.size(); ++region_index) {
+			VoxelLodTerrainUpdateData::StreamingRegion &region = regions[region_index];
+			if (region.viewer_count > 0 && can_merge_into_streaming_region(region.state, viewer.state)) {
+				merge_into_streaming_region(region.state, viewer.state, lod_count);
+				++region.viewer_count;
+				viewer.region_index = region_index;
+				break;
+			}
+		}
+
+		if (viewer.region_index == VoxelLodTerrainUpdateData::NO_STREAMING_REGION) {
+			VoxelLodTerrainUpdateData::StreamingRegion region;
+			region.state = viewer.state;
+			region.viewer_count = 1;
+			viewer.region_index = regions.size();
+			regions.push_back(region);
+		}
+	}
+
+	// Interpret regions left without viewers as having empty boxes, the same way as destroyed viewers. They are
+	// removed after boxes were processed.
+	for (VoxelLodTerrainUpdateData::StreamingRegion &region : regions) {
+		if (region.viewer_count == 0) {
+			region.state = region.prev_state;
+			for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+				region.state.data_box_per_lod[lod_index] = Box3i();
+				region.state.mesh_box_per_lod[lod_index] = Box3i();
+			}
+		}
+	}
+}
+
+void remove_unused_streaming_regions(VoxelLodTerrainUpdateData::ClipboxStreamingState &cs) {
+	StdVector<VoxelLodTerrainUpdateData::StreamingRegion> &regions = cs.streaming_regions;
+
+	for (unsigned int region_index = 0; region_index < regions.size();) {
+		if (regions[region_index].viewer_count > 0) {
+			++region_index;
+			continue;
+		}
+		const unsigned int last_index = regions.size() - 1;
+		regions[region_index] = regions[last_index];
+		regions.pop_back();
+		for (VoxelLodTerrainUpdateData::PairedViewer &viewer : cs.paired_viewers) {
+			if (viewer.region_index == last_index) {
+				viewer.region_index = region_index;
+			}
+		}
+	}
+}
+
 void add_loading_block(
 		VoxelLodTerrainUpdateData::Lod &lod,
 		Vector3i position,
@@ -476,209 +652,230 @@ void unreference_data_block_from_loading_lists(
 	}
 }
 
-void process_data_blocks_sliding_box(
+void process_lod_data_blocks_sliding_box(
 		VoxelLodTerrainUpdateData::State &state,
 		VoxelData &data,
+		const unsigned int lod_index,
+		const unsigned int lod_count,
 		StdVector<VoxelData::BlockToSave> *blocks_to_save,
-		// TODO We should be able to work in BOXES to load, it can help compressing network messages
 		StdVector<VoxelLodTerrainUpdateData::BlockToLoad> &data_blocks_to_load,
-		const VoxelLodTerrainUpdateData::Settings &settings,
-		int lod_count,
 		bool can_load
 ) {
 	ZN_PROFILE_SCOPE();
-	ZN_ASSERT_RETURN_MSG(data.is_streaming_enabled(), "This function is not meant to run in full load mode");
 
-	const int data_block_size_po2 = data.get_block_size_po2();
-	const Box3i bounds_in_voxels = data.get_bounds();
+	VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
 
-	// const int mesh_to_data_factor = mesh_block_size / data_block_size;
+	// Each LOD keeps a box of loaded blocks, and only some of the blocks will get polygonized.
+	// The player can edit them so changes can be propagated to lower lods.
 
-	// const int lod_distance_in_mesh_chunks = get_lod_distance_in_mesh_chunks(settings.lod_distance, mesh_block_size);
+	const Box3i bounds_in_voxels = data.get_bounds();
+	const unsigned int lod_data_block_size_po2 = data.get_block_size_po2() + lod_index;
 
-	// // Data chunks are driven by mesh chunks, because mesh needs data
-	// const int lod_distance_in_data_chunks = lod_distance_in_mesh_chunks * mesh_to_data_factor
-	// 		// To account for the fact meshes need neighbor data chunks
-	// 		+ 1;
+	// Should be correct as long as bounds size is a multiple of the biggest LOD chunk
+	const Box3i bounds_in_data_blocks =
+			Box3i(bounds_in_voxels.position >> lod_data_block_size_po2,
+				  bounds_in_voxels.size >> lod_data_block_size_po2);
 
 	static thread_local StdVector<Vector3i> tls_missing_blocks;
 	static thread_local StdVector<Vector3i> tls_found_blocks_positions;
 
+	for (const VoxelLodTerrainUpdateData::StreamingRegion &region : state.clipbox_streaming.streaming_regions) {
+		const Box3i &new_data_box = region.state.data_box_per_lod[lod_index];
+		const Box3i &prev_data_box = region.prev_state.data_box_per_lod[lod_index];
+
+		if (!new_data_box.intersects(bounds_in_data_blocks) && !prev_data_box.intersects(bounds_in_data_blocks)) {
+			// Out of bounds now and before
+			continue;
+		}
+
 #ifdef DEV_ENABLED
-	Box3i debug_parent_box;
+		if (lod_index + 1 != lod_count) {
+			const Box3i &parent_box = region.state.data_box_per_lod[lod_index + 1];
+			const Box3i parent_box_in_current_lod(parent_box.position << 1, parent_box.size << 1);
+			ZN_ASSERT(parent_box_in_current_lod.contains(new_data_box));
+		}
 #endif
 
-	for (const VoxelLodTerrainUpdateData::PairedViewer &paired_viewer : state.clipbox_streaming.paired_viewers) {
-		// Iterating from big to small LOD so we can exit earlier if bounds don't intersect.
-		for (int lod_index = lod_count - 1; lod_index >= 0; --lod_index) {
-			ZN_PROFILE_SCOPE();
-			VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+		if (prev_data_box == new_data_box) {
+			continue;
+		}
 
-			// Each LOD keeps a box of loaded blocks, and only some of the blocks will get polygonized.
-			// The player can edit them so changes can be propagated to lower lods.
+		// Detect blocks to load.
+		if (can_load) {
+			tls_missing_blocks.clear();
 
-			const unsigned int lod_data_block_size_po2 = data_block_size_po2 + lod_index;
+			new_data_box.difference(prev_data_box, [&data, lod_index](Box3i box_to_load) {
+				data.view_area(box_to_load, lod_index, &tls_missing_blocks, nullptr, nullptr);
+			});
 
-			// Should be correct as long as bounds size is a multiple of the biggest LOD chunk
-			const Box3i bounds_in_data_blocks =
-					Box3i(bounds_in_voxels.position >> lod_data_block_size_po2,
-						  bounds_in_voxels.size >> lod_data_block_size_po2);
+			{
+				ZN_PROFILE_SCOPE_NAMED("Add loading blocks");
+				MutexLock mlock(lod.loading_blocks_mutex);
+				for (const Vector3i bpos : tls_missing_blocks) {
+					add_loading_block(lod, bpos, lod_index, data_blocks_to_load);
+				}
+			}
+		}
 
-			// const Box3i new_data_box = get_lod_box_in_chunks(
-			// 		viewer_pos_in_lod0_voxels, lod_distance_in_data_chunks, data_block_size_po2, lod_index)
-			// 								   .clipped(bounds_in_data_blocks);
+		// Detect blocks to unload
+		{
+			tls_missing_blocks.clear();
+			tls_found_blocks_positions.clear();
 
-			const Box3i &new_data_box = paired_viewer.state.data_box_per_lod[lod_index];
-			const Box3i &prev_data_box = paired_viewer.prev_state.data_box_per_lod[lod_index];
+			const unsigned int to_save_index0 = blocks_to_save != nullptr ? blocks_to_save->size() : 0;
 
-#ifdef DEV_ENABLED
-			if (lod_index + 1 != lod_count) {
-				const Box3i debug_parent_box_in_current_lod(debug_parent_box.position << 1, debug_parent_box.size << 1);
-				ZN_ASSERT(debug_parent_box_in_current_lod.contains(new_data_box));
+			prev_data_box.difference(new_data_box, [&data, blocks_to_save, lod_index](Box3i box_to_remove) {
+				data.unview_area(
+						box_to_remove, lod_index, &tls_found_blocks_positions, &tls_missing_blocks, blocks_to_save
+				);
+			});
+
+			if (blocks_to_save != nullptr && blocks_to_save->size() > to_save_index0) {
+				add_unloaded_saving_blocks(lod, to_span(*blocks_to_save).sub(to_save_index0));
 			}
-			debug_parent_box = new_data_box;
-#endif
 
-			// const Box3i prev_data_box = get_lod_box_in_chunks(
-			// 		state.clipbox_streaming.viewer_pos_in_lod0_voxels_previous_update,
-			// 		state.clipbox_streaming.lod_distance_in_data_chunks_previous_update, data_block_size_po2, lod_index)
-			// 									.clipped(bounds_in_data_blocks);
+			// Remove loading blocks regardless of refcount (those were loaded and had their refcount reach
+			// zero)
+			if (tls_found_blocks_positions.size() > 0) {
+				MutexLock mlock(lod.loading_blocks_mutex);
+				for (const Vector3i bpos : tls_found_blocks_positions) {
+					// emit_data_block_unloaded(bpos);
 
-			if (!new_data_box.intersects(bounds_in_data_blocks) && !prev_data_box.intersects(bounds_in_data_blocks)) {
-				// If this box doesn't intersect either now or before, there is no chance a smaller one will
-				break;
+					// TODO If they were loaded, why would they be in loading blocks?
+					// Maybe to make sure they are not in here regardless
+					lod.loading_blocks.erase(bpos);
+				}
 			}
 
-			if (prev_data_box != new_data_box) {
-				// Detect blocks to load.
-				if (can_load) {
-					tls_missing_blocks.clear();
+			// Remove refcount from loading blocks, and cancel loading if it reaches zero
+			if (tls_missing_blocks.size() > 0) {
+				MutexLock mlock(lod.loading_blocks_mutex);
+				for (const Vector3i bpos : tls_missing_blocks) {
+					unreference_data_block_from_loading_lists(lod.loading_blocks, data_blocks_to_load, bpos, lod_index);
+				}
+			}
+		}
 
-					new_data_box.difference(prev_data_box, [&data, lod_index](Box3i box_to_load) {
-						data.view_area(box_to_load, lod_index, &tls_missing_blocks, nullptr, nullptr);
-					});
+		// Turned this off because I don't remember why I added it. Keeping it in case a bug occurs that could
+		// highlight why it was there.
+		// Was originally added in 17c6b1f557c5abc447cb62c200afcff1298fadff
+		// Perhaps that's in case there was updates pending in the list before we get here, so there needs to be
+		// some way of cancelling them? But with clipbox logic and multiple viewers, that no longer works
+#if 0
+		// TODO Why do we do this here? Sounds like it should be done in the mesh clipbox logic
+		{
+			ZN_PROFILE_SCOPE_NAMED("Cancel updates");
+			// Cancel mesh block updates that are not within the padded region
+			// (since neighbors are always required to remesh)
+
+			// TODO This might break at terrain borders
+			const Box3i padded_new_box = new_data_box.padded(-1);
+			Box3i mesh_box;
+			if (mesh_block_size > data_block_size) {
+				const int factor = mesh_block_size / data_block_size;
+				mesh_box = padded_new_box.downscaled_inner(factor);
+			} else {
+				mesh_box = padded_new_box;
+			}
 
-					{
-						ZN_PROFILE_SCOPE_NAMED("Add loading blocks");
-						MutexLock mlock(lod.loading_blocks_mutex);
-						for (const Vector3i bpos : tls_missing_blocks) {
-							add_loading_block(lod, bpos, lod_index, data_blocks_to_load);
+			unordered_remove_if(lod.mesh_blocks_pending_update,
+					[&lod, mesh_box](const VoxelLodTerrainUpdateData::MeshToUpdate &mtu) {
+						if (mesh_box.contains(mtu.position)) {
+							return false;
+						} else {
+							VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr =
+									lod.mesh_map_state.map.find(mtu.position);
+							if (mesh_block_ptr != nullptr) {
+								mesh_block_ptr->state = VoxelLodTerrainUpdateData::MESH_NEED_UPDATE;
+							}
+							return true;
 						}
-					}
-				}
-
-				// Detect blocks to unload
-				{
-					tls_missing_blocks.clear();
-					tls_found_blocks_positions.clear();
-
-					const unsigned int to_save_index0 = blocks_to_save != nullptr ? blocks_to_save->size() : 0;
-
-					prev_data_box.difference(new_data_box, [&data, blocks_to_save, lod_index](Box3i box_to_remove) {
-						data.unview_area(
-								box_to_remove,
-								lod_index,
-								&tls_found_blocks_positions,
-								&tls_missing_blocks,
-								blocks_to_save
-						);
 					});
+		}
+#endif
+	} // for each region
+}
 
-					if (blocks_to_save != nullptr && blocks_to_save->size() > to_save_index0) {
-						add_unloaded_saving_blocks(lod, to_span(*blocks_to_save).sub(to_save_index0));
-					}
-
-					// Remove loading blocks regardless of refcount (those were loaded and had their refcount reach
-					// zero)
-					if (tls_found_blocks_positions.size() > 0) {
-						MutexLock mlock(lod.loading_blocks_mutex);
-						for (const Vector3i bpos : tls_found_blocks_positions) {
-							// emit_data_block_unloaded(bpos);
-
-							// TODO If they were loaded, why would they be in loading blocks?
-							// Maybe to make sure they are not in here regardless
-							lod.loading_blocks.erase(bpos);
-						}
-					}
+void process_data_blocks_sliding_box(
+		VoxelLodTerrainUpdateData::State &state,
+		VoxelData &data,
+		StdVector<VoxelData::BlockToSave> *blocks_to_save,
+		// TODO We should be able to work in BOXES to load, it can help compressing network messages
+		StdVector<VoxelLodTerrainUpdateData::BlockToLoad> &data_blocks_to_load,
+		const VoxelLodTerrainUpdateData::Settings &settings,
+		int lod_count,
+		bool can_load
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN_MSG(data.is_streaming_enabled(), "This function is not meant to run in full load mode");
 
-					// Remove refcount from loading blocks, and cancel loading if it reaches zero
-					if (tls_missing_blocks.size() > 0) {
-						MutexLock mlock(lod.loading_blocks_mutex);
-						for (const Vector3i bpos : tls_missing_blocks) {
-							unreference_data_block_from_loading_lists(
-									lod.loading_blocks, data_blocks_to_load, bpos, lod_index
-							);
-						}
-					}
-				}
+	// Only LODs where a region's box moved have work to do
+	FixedArray<unsigned int, constants::MAX_LOD> lods_to_process;
+	unsigned int lods_to_process_count = 0;
+	// From big to small LOD, which is also the order in which results are merged
+	for (int lod_index = lod_count - 1; lod_index >= 0; --lod_index) {
+		for (const VoxelLodTerrainUpdateData::StreamingRegion &region : state.clipbox_streaming.streaming_regions) {
+			const Box3i &new_data_box = region.state.data_box_per_lod[lod_index];
+			if (new_data_box != region.prev_state.data_box_per_lod[lod_index]) {
+				lods_to_process[lods_to_process_count] = lod_index;
+				++lods_to_process_count;
+				break;
 			}
+		}
+	}
 
-			// Turned this off because I don't remember why I added it. Keeping it in case a bug occurs that could
-			// highlight why it was there.
-			// Was originally added in 17c6b1f557c5abc447cb62c200afcff1298fadff
-			// Perhaps that's in case there was updates pending in the list before we get here, so there needs to be
-			// some way of cancelling them? But with clipbox logic and multiple viewers, that no longer works
-#if 0
-			// TODO Why do we do this here? Sounds like it should be done in the mesh clipbox logic
-			{
-				ZN_PROFILE_SCOPE_NAMED("Cancel updates");
-				// Cancel mesh block updates that are not within the padded region
-				// (since neighbors are always required to remesh)
-
-				// TODO This might break at terrain borders
-				const Box3i padded_new_box = new_data_box.padded(-1);
-				Box3i mesh_box;
-				if (mesh_block_size > data_block_size) {
-					const int factor = mesh_block_size / data_block_size;
-					mesh_box = padded_new_box.downscaled_inner(factor);
-				} else {
-					mesh_box = padded_new_box;
-				}
+	// LODs have separate loading lists and voxel data locks, so they can be processed in parallel. Each one outputs
+	// to its own lists, which are then merged in a fixed order so results don't depend on scheduling.
+	static thread_local FixedArray<StdVector<VoxelLodTerrainUpdateData::BlockToLoad>, constants::MAX_LOD>
+			tls_blocks_to_load_per_lod;
+	static thread_local FixedArray<StdVector<VoxelData::BlockToSave>, constants::MAX_LOD> tls_blocks_to_save_per_lod;
+	// Thread-locals have to be referenced here, otherwise helpers would access their own
+	FixedArray<StdVector<VoxelLodTerrainUpdateData::BlockToLoad>, constants::MAX_LOD> &blocks_to_load_per_lod =
+			tls_blocks_to_load_per_lod;
+	FixedArray<StdVector<VoxelData::BlockToSave>, constants::MAX_LOD> &blocks_to_save_per_lod =
+			tls_blocks_to_save_per_lod;
+
+	run_parallel_jobs(lods_to_process_count, [&](unsigned int job_index) {
+		const unsigned int lod_index = lods_to_process[job_index];
+		process_lod_data_blocks_sliding_box(
+				state,
+				data,
+				lod_index,
+				lod_count,
+				blocks_to_save != nullptr ? &blocks_to_save_per_lod[lod_index] : nullptr,
+				blocks_to_load_per_lod[lod_index],
+				can_load
+		);
+	});
 
-				unordered_remove_if(lod.mesh_blocks_pending_update,
-						[&lod, mesh_box](const VoxelLodTerrainUpdateData::MeshToUpdate &mtu) {
-							if (mesh_box.contains(mtu.position)) {
-								return false;
-							} else {
-								auto mesh_block_it = lod.mesh_map_state.map.find(mtu.position);
-								if (mesh_block_it != lod.mesh_map_state.map.end()) {
-									mesh_block_it->second.state = VoxelLodTerrainUpdateData::MESH_NEED_UPDATE;
-								}
-								return true;
-							}
-						});
-			}
-#endif
+	for (unsigned int i = 0; i < lods_to_process_count; ++i) {
+		const unsigned int lod_index = lods_to_process[i];
 
-		} // for each lod
-	} // for each viewer
+		StdVector<VoxelLodTerrainUpdateData::BlockToLoad> &lod_blocks_to_load = blocks_to_load_per_lod[lod_index];
+		append_array(data_blocks_to_load, lod_blocks_to_load);
+		lod_blocks_to_load.clear();
+
+		if (blocks_to_save != nullptr) {
+			StdVector<VoxelData::BlockToSave> &lod_blocks_to_save = blocks_to_save_per_lod[lod_index];
+			append_array(*blocks_to_save, lod_blocks_to_save);
+			lod_blocks_to_save.clear();
+		}
+	}
 
 	// state.clipbox_streaming.lod_distance_in_data_chunks_previous_update = lod_distance_in_data_chunks;
 }
 
 // TODO Copypasta from octree streaming file
 VoxelLodTerrainUpdateData::MeshBlockState &insert_new(
-		StdUnorderedMap<Vector3i, VoxelLodTerrainUpdateData::MeshBlockState> &mesh_map,
+		SpatialHashMap<VoxelLodTerrainUpdateData::MeshBlockState> &mesh_map,
 		Vector3i pos
 ) {
 #ifdef DEBUG_ENABLED
 	// We got here because the map didn't contain the element. If it did contain it already, that's a bug.
 	static VoxelLodTerrainUpdateData::MeshBlockState s_default;
-	ERR_FAIL_COND_V(mesh_map.find(pos) != mesh_map.end(), s_default);
+	ERR_FAIL_COND_V(mesh_map.has(pos), s_default);
 #endif
-	// C++ standard says if the element is not present, it will be default-constructed.
-	// So here is how to insert a default, non-movable struct into an unordered_map.
-	// https://stackoverflow.com/questions/22229773/map-unordered-map-with-non-movable-default-constructible-value-type
-	VoxelLodTerrainUpdateData::MeshBlockState &block = mesh_map[pos];
-
-	// This approach doesn't compile, had to workaround with the writing [] operator.
-	/*
-	auto p = lod.mesh_map_state.map.emplace(pos, VoxelLodTerrainUpdateData::MeshBlockState());
-	// We got here because the map didn't contain the element. If it did contain it already, that's a bug.
-	CRASH_COND(p.second == false);
-	*/
-
-	return block;
+	return mesh_map.get_or_insert(pos);
 }
 
 inline Vector3i get_relative_child_position(unsigned int child_index) {
@@ -755,18 +952,30 @@ void view_mesh_box(
 
 	const Box3i bounds_in_data_blocks = voxel_data.get_bounds().downscaled(voxel_data.get_block_size() << lod_index);
 
+	// Neighboring mesh blocks share most of the data blocks they depend on, so instead of querying each mesh block's
+	// area separately, we query data presence once for the whole box being added.
+	static thread_local StdVector<uint8_t> tls_data_presence;
+	StdVector<uint8_t> &data_presence = tls_data_presence;
+	Box3i data_presence_box;
+	if (!is_full_load_mode) {
+		data_presence_box = Box3i(box_to_add.position * mesh_to_data_factor, box_to_add.size * mesh_to_data_factor)
+									.padded(1)
+									.clipped(bounds_in_data_blocks);
+		voxel_data.get_blocks_presence_unbound(data_presence_box, lod_index, data_presence);
+	}
+
 	box_to_add.for_each_cell([&lod, //
 							  is_full_load_mode, //
 							  mesh_to_data_factor, //
-							  &voxel_data,
-							  lod_index, //
+							  &data_presence,
+							  data_presence_box,
 							  require_visuals, //
 							  require_collisions, //
 							  bounds_in_data_blocks](Vector3i bpos) {
 		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block;
-		auto mesh_block_it = lod.mesh_map_state.map.find(bpos);
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = lod.mesh_map_state.map.find(bpos);
 
-		if (mesh_block_it == lod.mesh_map_state.map.end()) {
+		if (mesh_block_ptr == nullptr) {
 			// RWLockWrite wlock(lod.mesh_map_state.map_lock);
 			mesh_block = &insert_new(lod.mesh_map_state.map, bpos);
 
@@ -777,7 +986,7 @@ void view_mesh_box(
 			// }
 
 		} else {
-			mesh_block = &mesh_block_it->second;
+			mesh_block = mesh_block_ptr;
 		}
 
 		bool first_visuals = false;
@@ -826,7 +1035,12 @@ void view_mesh_box(
 				// If we get an empty box at this point, something is wrong with the caller
 				ZN_ASSERT_RETURN(!data_box.is_empty());
 
-				const bool data_available = voxel_data.has_all_blocks_in_area_unbound(data_box, lod_index);
+				const bool data_available = data_box.all_cells_match( //
+						[&data_presence, data_presence_box](Vector3i dpos) {
+							const Vector3i rpos = dpos - data_presence_box.position;
+							return data_presence[Vector3iUtil::get_zxy_index(rpos, data_presence_box.size)] != 0;
+						}
+				);
 
 				if (data_available) {
 					schedule_mesh_load(lod.mesh_blocks_pending_update, bpos, *mesh_block, require_visuals);
@@ -874,23 +1088,28 @@ void view_mesh_box(
 	});
 }
 
+// Boxes of meshes that were unviewed, whose parents may have to be shown
+struct UnviewedMeshBox {
+	Box3i box;
+	bool visual_flag;
+	bool collision_flag;
+};
+
 void unview_mesh_box(
 		const Box3i out_of_range_box,
 		VoxelLodTerrainUpdateData::Lod &lod,
-		unsigned int lod_index,
-		unsigned int lod_count,
-		VoxelLodTerrainUpdateData::State &state,
 		bool visual_flag,
-		bool collision_flag
+		bool collision_flag,
+		StdVector<UnviewedMeshBox> &unviewed_boxes
 ) {
 	ZN_PROFILE_SCOPE();
 	ZN_ASSERT_RETURN(collision_flag || visual_flag);
 
 	out_of_range_box.for_each_cell([&lod, visual_flag, collision_flag](Vector3i bpos) {
-		auto mesh_block_it = lod.mesh_map_state.map.find(bpos);
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = lod.mesh_map_state.map.find(bpos);
 
-		if (mesh_block_it != lod.mesh_map_state.map.end()) {
-			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = mesh_block_it->second;
+		if (mesh_block_ptr != nullptr) {
+			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = *mesh_block_ptr;
 
 			bool visual_needed;
 			if (visual_flag) {
@@ -922,7 +1141,7 @@ void unview_mesh_box(
 				// loaded? That will trigger a reload, but if mesh load is fast, what if the main thread unloads the new
 				// mesh due to the old momentary unload? Very edge case, but keeping a note in case something weird
 				// happens in practice.
-				lod.mesh_map_state.map.erase(mesh_block_it);
+				lod.mesh_map_state.map.erase(bpos);
 				lod.mesh_blocks_to_unload.push_back(bpos);
 
 			} else {
@@ -942,6 +1161,22 @@ void unview_mesh_box(
 		}
 	});
 
+	// Parents are shown afterward, because they are in another LOD which may be processed in parallel
+	unviewed_boxes.push_back(UnviewedMeshBox{ out_of_range_box, visual_flag, collision_flag });
+}
+
+void show_parents_of_unviewed_mesh_box(
+		const UnviewedMeshBox &unviewed_box,
+		VoxelLodTerrainUpdateData::State &state,
+		unsigned int lod_index,
+		unsigned int lod_count
+) {
+	ZN_PROFILE_SCOPE();
+
+	const bool visual_flag = unviewed_box.visual_flag;
+	const bool collision_flag = unviewed_box.collision_flag;
+	VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+
 	// Immediately show parent when children are removed.
 	// This is a cheap approach as the parent mesh will be available most of the time.
 	// However, at high speeds, if loading can't keep up, holes and overlaps will start happening in the
@@ -950,7 +1185,7 @@ void unview_mesh_box(
 	if (parent_lod_index < lod_count) {
 		// Should always work without reaching zero size because non-max LODs are always
 		// multiple of 2 due to subdivision rules
-		const Box3i parent_box = Box3i(out_of_range_box.position >> 1, out_of_range_box.size >> 1);
+		const Box3i parent_box = Box3i(unviewed_box.box.position >> 1, unviewed_box.box.size >> 1);
 
 		VoxelLodTerrainUpdateData::Lod &parent_lod = state.lods[parent_lod_index];
 
@@ -960,13 +1195,13 @@ void unview_mesh_box(
 								  visual_flag, //
 								  collision_flag //
 		](Vector3i bpos) {
-			auto mesh_it = parent_lod.mesh_map_state.map.find(bpos);
+			VoxelLodTerrainUpdateData::MeshBlockState *mesh_ptr = parent_lod.mesh_map_state.map.find(bpos);
 
-			if (mesh_it == parent_lod.mesh_map_state.map.end()) {
+			if (mesh_ptr == nullptr) {
 				return;
 			}
 
-			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = mesh_it->second;
+			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = *mesh_ptr;
 
 			bool activated = false;
 
@@ -978,10 +1213,9 @@ void unview_mesh_box(
 					// them yet.
 					// This check assumes there is always 8 children or no children
 					const Vector3i child_bpos0 = bpos << 1;
-					auto child_mesh0_it = lod.mesh_map_state.map.find(child_bpos0);
+					VoxelLodTerrainUpdateData::MeshBlockState *child_mesh0 = lod.mesh_map_state.map.find(child_bpos0);
 
-					if (child_mesh0_it == lod.mesh_map_state.map.end() ||
-						child_mesh0_it->second.mesh_viewers.get() == 0) {
+					if (child_mesh0 == nullptr || child_mesh0->mesh_viewers.get() == 0) {
 						mesh_block.visual_active = true;
 						parent_lod.mesh_blocks_to_activate_visuals.push_back(bpos);
 						activated = true;
@@ -997,10 +1231,9 @@ void unview_mesh_box(
 			if (collision_flag) {
 				if (!mesh_block.collision_active) {
 					const Vector3i child_bpos0 = bpos << 1;
-					auto child_mesh0_it = lod.mesh_map_state.map.find(child_bpos0);
+					VoxelLodTerrainUpdateData::MeshBlockState *child_mesh0 = lod.mesh_map_state.map.find(child_bpos0);
 
-					if (child_mesh0_it == lod.mesh_map_state.map.end() ||
-						child_mesh0_it->second.collision_viewers.get() == 0) {
+					if (child_mesh0 == nullptr || child_mesh0->collision_viewers.get() == 0) {
 						mesh_block.collision_active = true;
 						parent_lod.mesh_blocks_to_activate_collision.push_back(bpos);
 						activated = true;
@@ -1039,67 +1272,64 @@ inline bool requires_meshes(const VoxelLodTerrainUpdateData::PairedViewer::State
 	return viewer_state.requires_collisions || viewer_state.requires_visuals;
 }
 
-void process_viewer_mesh_blocks_sliding_box(
+bool has_mesh_box_changes(const VoxelLodTerrainUpdateData::StreamingRegion &region, unsigned int lod_index) {
+	return region.state.mesh_box_per_lod[lod_index] != region.prev_state.mesh_box_per_lod[lod_index] ||
+			region.state.requires_collisions != region.prev_state.requires_collisions ||
+			region.state.requires_visuals != region.prev_state.requires_visuals;
+}
+
+void process_lod_mesh_blocks_sliding_box(
 		VoxelLodTerrainUpdateData::State &state,
 		int mesh_block_size_po2,
-		int lod_count,
+		unsigned int lod_index,
+		unsigned int lod_count,
 		const Box3i &volume_bounds_in_voxels,
-		const VoxelLodTerrainUpdateData::PairedViewer &paired_viewer,
 		bool can_load,
 		bool is_full_load_mode,
 		int mesh_to_data_factor,
-		const VoxelData &data
+		const VoxelData &data,
+		StdVector<UnviewedMeshBox> &unviewed_boxes
 ) {
 	ZN_PROFILE_SCOPE();
 
-#ifdef DEV_ENABLED
-	Box3i debug_parent_box;
-#endif
+	VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
 
-	// TODO Optimize: when a viewer doesn't need visuals, we only need to build meshes for collisions up to a certain
-	// LOD (collision max LOD property). That would be an optimization for servers, NPCs and player hosts
+	const int lod_mesh_block_size_po2 = mesh_block_size_po2 + lod_index;
+	const int lod_mesh_block_size = 1 << lod_mesh_block_size_po2;
 
-	// Iterating from big to small LOD so we can exit earlier if bounds don't intersect.
-	for (int lod_index = lod_count - 1; lod_index >= 0; --lod_index) {
-		ZN_PROFILE_SCOPE();
-		VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+	const Box3i bounds_in_mesh_blocks = volume_bounds_in_voxels.downscaled(lod_mesh_block_size);
 
-		const int lod_mesh_block_size_po2 = mesh_block_size_po2 + lod_index;
-		const int lod_mesh_block_size = 1 << lod_mesh_block_size_po2;
-		// const Vector3i viewer_block_pos_within_lod = math::floor_to_int(p_viewer_pos) >> block_size_po2;
+	// TODO Optimize: when a viewer doesn't need visuals, we only need to build meshes for collisions up to a certain
+	// LOD (collision max LOD property). That would be an optimization for servers, NPCs and player hosts
 
-		const Box3i bounds_in_mesh_blocks = volume_bounds_in_voxels.downscaled(lod_mesh_block_size);
+	for (const VoxelLodTerrainUpdateData::StreamingRegion &region : state.clipbox_streaming.streaming_regions) {
+		// Only update around regions that need meshes.
+		// Check previous state too in case we have to handle them changing
+		if (!requires_meshes(region.state) && !requires_meshes(region.prev_state)) {
+			continue;
+		}
 
-		// const Box3i new_mesh_box = get_lod_box_in_chunks(
-		// 		viewer_pos_in_lod0_voxels, lod_distance_in_mesh_chunks, mesh_block_size_po2, lod_index)
-		// 								   .clipped(bounds_in_mesh_blocks);
+		const Box3i &new_mesh_box = region.state.mesh_box_per_lod[lod_index];
+		const Box3i &prev_mesh_box = region.prev_state.mesh_box_per_lod[lod_index];
 
-		const Box3i &new_mesh_box = paired_viewer.state.mesh_box_per_lod[lod_index];
-		const Box3i &prev_mesh_box = paired_viewer.prev_state.mesh_box_per_lod[lod_index];
+		if (!new_mesh_box.intersects(bounds_in_mesh_blocks) && !prev_mesh_box.intersects(bounds_in_mesh_blocks)) {
+			// Out of bounds now and before
+			continue;
+		}
 
 #ifdef DEV_ENABLED
 		if (lod_index + 1 != lod_count) {
-			const Box3i debug_parent_box_in_current_lod(debug_parent_box.position << 1, debug_parent_box.size << 1);
-			ZN_ASSERT(debug_parent_box_in_current_lod.contains(new_mesh_box));
+			const Box3i &parent_box = region.state.mesh_box_per_lod[lod_index + 1];
+			const Box3i parent_box_in_current_lod(parent_box.position << 1, parent_box.size << 1);
+			ZN_ASSERT(parent_box_in_current_lod.contains(new_mesh_box));
 		}
-		debug_parent_box = new_mesh_box;
 #endif
 
-		// const Box3i prev_mesh_box = get_lod_box_in_chunks(
-		// 		state.clipbox_streaming.viewer_pos_in_lod0_voxels_previous_update,
-		// 		state.clipbox_streaming.lod_distance_in_mesh_chunks_previous_update, mesh_block_size_po2, lod_index)
-		// 									.clipped(bounds_in_mesh_blocks);
-
-		if (!new_mesh_box.intersects(bounds_in_mesh_blocks) && !prev_mesh_box.intersects(bounds_in_mesh_blocks)) {
-			// If this box doesn't intersect either now or before, there is no chance a smaller one will
-			break;
-		}
-
 		if (prev_mesh_box != new_mesh_box) {
 			RWLockWrite wlock(lod.mesh_map_state.map_lock);
 
 			// Add meshes entering range
-			if (requires_meshes(paired_viewer.state) && can_load) {
+			if (requires_meshes(region.state) && can_load) {
 				SmallVector<Box3i, 6> new_mesh_boxes;
 				new_mesh_box.difference_to_vec(prev_mesh_box, new_mesh_boxes);
 
@@ -1111,14 +1341,14 @@ void process_viewer_mesh_blocks_sliding_box(
 							is_full_load_mode,
 							mesh_to_data_factor,
 							data,
-							paired_viewer.state.requires_visuals,
-							paired_viewer.state.requires_collisions
+							region.state.requires_visuals,
+							region.state.requires_collisions
 					);
 				}
 			}
 
 			// Remove meshes out or range
-			if (requires_meshes(paired_viewer.prev_state)) {
+			if (requires_meshes(region.prev_state)) {
 				SmallVector<Box3i, 6> old_mesh_boxes;
 				prev_mesh_box.difference_to_vec(new_mesh_box, old_mesh_boxes);
 
@@ -1126,12 +1356,10 @@ void process_viewer_mesh_blocks_sliding_box(
 					unview_mesh_box(
 							out_of_range_box,
 							lod,
-							lod_index,
-							lod_count,
-							state,
 							// Use previous state because old boxes were loaded because of them
-							paired_viewer.prev_state.requires_visuals,
-							paired_viewer.prev_state.requires_collisions
+							region.prev_state.requires_visuals,
+							region.prev_state.requires_collisions,
+							unviewed_boxes
 					);
 				}
 			}
@@ -1143,23 +1371,23 @@ void process_viewer_mesh_blocks_sliding_box(
 		// Also, this won't do anything on new viewers that have no previous state, because the previous box will be
 		// empty.
 		if (!Vector3iUtil::is_empty_size(prev_mesh_box.size)) {
-			if (paired_viewer.state.requires_collisions != paired_viewer.prev_state.requires_collisions) {
+			if (region.state.requires_collisions != region.prev_state.requires_collisions) {
 				const Box3i box = new_mesh_box.clipped(prev_mesh_box);
-				if (paired_viewer.state.requires_collisions) {
+				if (region.state.requires_collisions) {
 					// Add refcount to just collisions
 					view_mesh_box(box, lod, lod_index, is_full_load_mode, mesh_to_data_factor, data, false, true);
 				} else {
 					// Remove refcount to just collisions
-					unview_mesh_box(box, lod, lod_index, lod_count, state, false, true);
+					unview_mesh_box(box, lod, false, true, unviewed_boxes);
 				}
 			}
 
-			if (paired_viewer.state.requires_visuals != paired_viewer.prev_state.requires_visuals) {
+			if (region.state.requires_visuals != region.prev_state.requires_visuals) {
 				const Box3i box = new_mesh_box.clipped(prev_mesh_box);
-				if (paired_viewer.state.requires_visuals) {
+				if (region.state.requires_visuals) {
 					view_mesh_box(box, lod, lod_index, is_full_load_mode, mesh_to_data_factor, data, true, false);
 				} else {
-					unview_mesh_box(box, lod, lod_index, lod_count, state, true, false);
+					unview_mesh_box(box, lod, true, false, unviewed_boxes);
 				}
 			}
 		}
@@ -1194,22 +1422,49 @@ void process_mesh_blocks_sliding_box(
 	const int mesh_block_size = 1 << mesh_block_size_po2;
 	const int mesh_to_data_factor = mesh_block_size / data_block_size;
 
-	for (const VoxelLodTerrainUpdateData::PairedViewer &paired_viewer : state.clipbox_streaming.paired_viewers) {
-		// Only update around viewers that need meshes.
-		// Check previous state too in case we have to handle them changing
-		if (requires_meshes(paired_viewer.state) || requires_meshes(paired_viewer.prev_state)) {
-			process_viewer_mesh_blocks_sliding_box(
-					state,
-					mesh_block_size_po2,
-					lod_count,
-					bounds_in_voxels,
-					paired_viewer,
-					can_load,
-					is_full_load_mode,
-					mesh_to_data_factor,
-					data
-			);
+	// Only LODs where a region's box or flags changed have work to do
+	FixedArray<unsigned int, constants::MAX_LOD> lods_to_process;
+	unsigned int lods_to_process_count = 0;
+	// From big to small LOD, which is also the order in which parents are shown afterward
+	for (int lod_index = lod_count - 1; lod_index >= 0; --lod_index) {
+		for (const VoxelLodTerrainUpdateData::StreamingRegion &region : state.clipbox_streaming.streaming_regions) {
+			if (has_mesh_box_changes(region, lod_index)) {
+				lods_to_process[lods_to_process_count] = lod_index;
+				++lods_to_process_count;
+				break;
+			}
+		}
+	}
+
+	// Each LOD only modifies its own mesh map, so they can be processed in parallel
+	static thread_local FixedArray<StdVector<UnviewedMeshBox>, constants::MAX_LOD> tls_unviewed_boxes_per_lod;
+	// Thread-locals have to be referenced here, otherwise helpers would access their own
+	FixedArray<StdVector<UnviewedMeshBox>, constants::MAX_LOD> &unviewed_boxes_per_lod = tls_unviewed_boxes_per_lod;
+
+	run_parallel_jobs(lods_to_process_count, [&](unsigned int job_index) {
+		const unsigned int lod_index = lods_to_process[job_index];
+		process_lod_mesh_blocks_sliding_box(
+				state,
+				mesh_block_size_po2,
+				lod_index,
+				lod_count,
+				bounds_in_voxels,
+				can_load,
+				is_full_load_mode,
+				mesh_to_data_factor,
+				data,
+				unviewed_boxes_per_lod[lod_index]
+		);
+	});
+
+	// Showing parents crosses LODs, so it is done once all of them are processed, in a fixed order
+	for (unsigned int i = 0; i < lods_to_process_count; ++i) {
+		const unsigned int lod_index = lods_to_process[i];
+		StdVector<UnviewedMeshBox> &unviewed_boxes = unviewed_boxes_per_lod[lod_index];
+		for (const UnviewedMeshBox &unviewed_box : unviewed_boxes) {
+			show_parents_of_unviewed_mesh_box(unviewed_box, state, lod_index, lod_count);
 		}
+		unviewed_boxes.clear();
 	}
 
 	// VoxelLodTerrainUpdateData::ClipboxStreamingState &clipbox_streaming = state.clipbox_streaming;
@@ -1283,12 +1538,12 @@ void process_loaded_data_blocks_trigger_meshing(
 			// We don't add/remove items from the map here, and only the update task can do that, so no need
 			// to lock
 			// RWLockRead rlock(lod.mesh_map_state.map_lock);
-			auto mesh_it = lod.mesh_map_state.map.find(mesh_block_pos);
-			if (mesh_it == lod.mesh_map_state.map.end()) {
+			VoxelLodTerrainUpdateData::MeshBlockState *mesh_ptr = lod.mesh_map_state.map.find(mesh_block_pos);
+			if (mesh_ptr == nullptr) {
 				// Not requested
 				return;
 			}
-			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = mesh_it->second;
+			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = *mesh_ptr;
 			const VoxelLodTerrainUpdateData::MeshState mesh_state = mesh_block.state;
 
 			// TODO Check if there is more flags to compute with the mesh (collider? rendering?)
@@ -1449,12 +1704,12 @@ void update_mesh_block_load(
 		MeshBlockFeatureIndex feature_index
 ) {
 	VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
-	auto mesh_it = lod.mesh_map_state.map.find(bpos);
+	VoxelLodTerrainUpdateData::MeshBlockState *mesh_ptr = lod.mesh_map_state.map.find(bpos);
 
-	if (mesh_it == lod.mesh_map_state.map.end()) {
+	if (mesh_ptr == nullptr) {
 		return;
 	}
-	VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = mesh_it->second;
+	VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = *mesh_ptr;
 
 	if (!is_loaded(mesh_block, feature_index)) {
 		return;
@@ -1485,17 +1740,17 @@ void update_mesh_block_load(
 		const Vector3i parent_bpos = bpos >> 1;
 		VoxelLodTerrainUpdateData::Lod &parent_lod = state.lods[parent_lod_index];
 
-		auto parent_mesh_it = parent_lod.mesh_map_state.map.find(parent_bpos);
-		// if (parent_mesh_it == parent_lod.mesh_map_state.map.end()) {
+		VoxelLodTerrainUpdateData::MeshBlockState *parent_mesh = parent_lod.mesh_map_state.map.find(parent_bpos);
+		// if (parent_mesh == nullptr) {
 		// 	debug_dump_mesh_maps(state, lod_count);
 		// }
 		// The parent must exist because sliding boxes contain each other. Maybe in the future that won't always be true
 		// if a viewer has special behavior?
 		ZN_ASSERT_RETURN_MSG(
-				parent_mesh_it != parent_lod.mesh_map_state.map.end(), "Expected parent due to subdivision rules, bug?"
+				parent_mesh != nullptr, "Expected parent due to subdivision rules, bug?"
 		);
 
-		VoxelLodTerrainUpdateData::MeshBlockState &parent_mesh_block = parent_mesh_it->second;
+		VoxelLodTerrainUpdateData::MeshBlockState &parent_mesh_block = *parent_mesh;
 
 		if (is_active(parent_mesh_block, feature_index)) {
 			bool all_siblings_loaded = true;
@@ -1504,15 +1759,15 @@ void update_mesh_block_load(
 			// TODO This needs to be optimized. Store a cache in parent?
 			for (unsigned int sibling_index = 0; sibling_index < 8; ++sibling_index) {
 				const Vector3i sibling_bpos = get_child_position(parent_bpos, sibling_index);
-				auto sibling_it = lod.mesh_map_state.map.find(sibling_bpos);
-				if (sibling_it == lod.mesh_map_state.map.end()) {
+				VoxelLodTerrainUpdateData::MeshBlockState *sibling_ptr = lod.mesh_map_state.map.find(sibling_bpos);
+				if (sibling_ptr == nullptr) {
 					// Finding this in the mesh map would be weird due to subdivision rules. We don't expect a sibling
 					// to be missing, because every mesh block always has 8 children.
 					ZN_PRINT_ERROR("Didn't expect missing sibling");
 					all_siblings_loaded = false;
 					break;
 				}
-				const VoxelLodTerrainUpdateData::MeshBlockState &sibling = sibling_it->second;
+				const VoxelLodTerrainUpdateData::MeshBlockState &sibling = *sibling_ptr;
 				if (!is_loaded(sibling, feature_index)) {
 					all_siblings_loaded = false;
 					break;
@@ -1526,8 +1781,8 @@ void update_mesh_block_load(
 				// Show siblings
 				for (unsigned int sibling_index = 0; sibling_index < 8; ++sibling_index) {
 					const Vector3i sibling_bpos = get_child_position(parent_bpos, sibling_index);
-					auto sibling_it = lod.mesh_map_state.map.find(sibling_bpos);
-					VoxelLodTerrainUpdateData::MeshBlockState &sibling = sibling_it->second;
+					VoxelLodTerrainUpdateData::MeshBlockState *sibling_ptr = lod.mesh_map_state.map.find(sibling_bpos);
+					VoxelLodTerrainUpdateData::MeshBlockState &sibling = *sibling_ptr;
 					// TODO Optimize: if that sibling itself subdivides, it should not need to be made visible.
 					// Maybe make `update_mesh_block_load` return that info so we can avoid scheduling activation?
 					set_active(sibling, feature_index, lod, sibling_bpos);
@@ -1630,6 +1885,8 @@ void process_clipbox_streaming(
 			unpaired_viewers_to_remove
 	);
 
+	update_streaming_regions(state.clipbox_streaming, lod_count);
+
 	if (streaming_enabled) {
 		process_data_blocks_sliding_box(
 				state, data, data_blocks_to_save, data_blocks_to_load, settings, lod_count, can_load
@@ -1648,9 +1905,10 @@ void process_clipbox_streaming(
 			state, settings, bounds_in_voxels, lod_count, !streaming_enabled, can_load, data, 1 << data_block_size_po2
 	);
 
-	// Removing paired viewers after box diffs because we interpret viewer removal as boxes becoming zero-size, so we
-	// need one processing step to handle that before actually removing them
+	// Removing paired viewers and regions after box diffs because we interpret their removal as boxes becoming
+	// zero-size, so we need one processing step to handle that before actually removing them
 	remove_unpaired_viewers(unpaired_viewers_to_remove, state.clipbox_streaming.paired_viewers);
+	remove_unused_streaming_regions(state.clipbox_streaming);
 
 	if (streaming_enabled) {
 		// TODO Have an option to turn off meshing entirely (may be useful on servers if the game doesn't use mesh
@@ -6,12 +6,14 @@
 #include "../../generators/voxel_generator.h"
 #include "../../streams/voxel_stream.h"
 #include "../../util/containers/fixed_array.h"
+#include "../../util/containers/spatial_hash_map.h"
 #include "../../util/containers/std_map.h"
 #include "../../util/containers/std_unordered_map.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/safe_ref_count.h"
 #include "../../util/tasks/cancellation_token.h"
 #include "../voxel_mesh_map.h"
+#include "block_lifecycle_trace.h"
 #include "lod_octree.h"
 
 namespace zylann {
@@ -74,12 +76,20 @@ struct VoxelLodTerrainUpdateData {
 		// Not really exposed for now, will wait for it to be really needed. It might never be.
 		bool cache_generated_blocks = false;
 		bool collision_enabled = true;
+		// Collisions are only generated for LODs below this count. 0 means all LODs.
+		unsigned int collision_lod_count = 0;
 		bool detail_textures_use_gpu = false;
 		bool generator_use_gpu = false;
 		uint8_t detail_texture_generator_override_begin_lod_index = 0;
+		// From this LOD index, the octree streaming system loads data blocks by groups of 2x2x2 neighbors instead of
+		// one by one, so distant LODs don't spawn as many tasks and stream queries
+		uint8_t grouped_loading_begin_lod_index = 3;
 		unsigned int mesh_block_size_po2 = 4;
 		DetailRenderingSettings detail_texture_settings;
 		Ref<VoxelGenerator> detail_texture_generator_override;
+		// Set when mesh baking is enabled and the stream supports storing meshes
+		Ref<VoxelStream> baked_mesh_stream;
+		uint64_t baked_mesh_settings_hash = 0;
 	};
 
 	enum MeshState {
@@ -122,6 +132,9 @@ struct VoxelLodTerrainUpdateData {
 		uint8_t transition_mask;
 		bool visual_active;
 		bool collision_active;
+		// True if the pending update was requested by an edit, so it gets processed before streaming work. Only
+		// accessed by the update task.
+		bool update_caused_by_edit;
 
 		// Tells whether the first meshing was done since this block was added.
 		// Written by the main thread only, when it receives mesh updates or when it unloads resources.
@@ -139,6 +152,7 @@ struct VoxelLodTerrainUpdateData {
 				transition_mask(0),
 				visual_active(false),
 				collision_active(false),
+				update_caused_by_edit(false),
 				visual_loaded(false),
 				collision_loaded(false) {}
 	};
@@ -147,7 +161,7 @@ struct VoxelLodTerrainUpdateData {
 	// It contains states used to determine when to actually load/unload meshes.
 	struct MeshMapState {
 		// Values in this map are expected to have stable addresses.
-		StdUnorderedMap<Vector3i, MeshBlockState> map;
+		SpatialHashMap<MeshBlockState> map;
 		// Locked for writing when blocks get inserted or removed from the map.
 		// If you need to lock more than one Lod, always do so in increasing order, to avoid deadlocks.
 		// IMPORTANT:
@@ -221,11 +235,15 @@ struct VoxelLodTerrainUpdateData {
 		IThreadedTask *task;
 		Box3i box;
 		std::shared_ptr<AsyncDependencyTracker> task_tracker;
+		// Read-only tasks (like async copies) go through the same pipeline so the area gets loaded first and they run
+		// in order with edits, but don't need post-edit
+		bool read_only;
 	};
 
 	struct RunningAsyncEdit {
 		std::shared_ptr<AsyncDependencyTracker> tracker;
 		Box3i box;
+		bool read_only;
 	};
 
 	struct Stats {
@@ -238,6 +256,8 @@ struct VoxelLodTerrainUpdateData {
 
 	struct OctreeItem {
 		LodOctree octree;
+		// Tells if some nodes of this octree could not split or join during its last update
+		bool had_blocked_nodes = false;
 	};
 
 	struct OctreeStreamingState {
@@ -256,6 +276,8 @@ struct VoxelLodTerrainUpdateData {
 		bool force_update_octrees_next_update = false;
 	};
 
+	static const unsigned int NO_STREAMING_REGION = 0xffffffff;
+
 	// Paired viewers are VoxelViewers which intersect with the boundaries of the volume
 	struct PairedViewer {
 		struct Distances {
@@ -276,6 +298,18 @@ struct VoxelLodTerrainUpdateData {
 		ViewerID id;
 		State state;
 		State prev_state;
+		// Index of the streaming region the viewer was merged into
+		unsigned int region_index = NO_STREAMING_REGION;
+	};
+
+	// Viewers with the same requirements whose boxes mostly overlap are merged into one streaming region, which views
+	// the bounding box of their boxes. Blocks are referenced once per region, so the cost of sliding boxes scales with
+	// the number of distinct areas rather than the number of viewers (like many players gathered on a server).
+	struct StreamingRegion {
+		PairedViewer::State state;
+		PairedViewer::State prev_state;
+		// Regions no viewer was merged into get empty boxes, so their blocks are unviewed before they are removed
+		unsigned int viewer_count = 0;
 	};
 
 	struct LoadedMeshBlockEvent {
@@ -287,6 +321,7 @@ struct VoxelLodTerrainUpdateData {
 
 	struct ClipboxStreamingState {
 		StdVector<PairedViewer> paired_viewers;
+		StdVector<StreamingRegion> streaming_regions;
 		// Vector3i viewer_pos_in_lod0_voxels_previous_update;
 		// int lod_distance_in_data_chunks_previous_update = 0;
 		// int lod_distance_in_mesh_chunks_previous_update = 0;
@@ -335,6 +370,9 @@ struct VoxelLodTerrainUpdateData {
 		BinaryMutex changed_generated_areas_mutex;
 
 		Stats stats;
+
+		// Disabled by default, only used for debugging
+		BlockLifecycleTrace block_trace;
 	};
 
 	// Set to true when the update task is finished
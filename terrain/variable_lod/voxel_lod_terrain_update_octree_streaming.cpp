@@ -1,6 +1,8 @@
 #include "../../storage/voxel_data.h"
+#include "../../util/containers/container_funcs.h"
 #include "../../util/math/conv.h"
 #include "voxel_lod_terrain_update_data.h"
+#include "voxel_lod_terrain_update_parallel_jobs.h"
 #include "voxel_lod_terrain_update_task.h"
 
 namespace zylann::voxel {
@@ -101,9 +103,10 @@ void process_unload_data_blocks_sliding_box(
 						if (mesh_box.contains(mtl.position)) {
 							return false;
 						} else {
-							auto mesh_block_it = lod.mesh_map_state.map.find(mtl.position);
-							if (mesh_block_it != lod.mesh_map_state.map.end()) {
-								mesh_block_it->second.state = VoxelLodTerrainUpdateData::MESH_NEED_UPDATE;
+							VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr =
+									lod.mesh_map_state.map.find(mtl.position);
+							if (mesh_block_ptr != nullptr) {
+								mesh_block_ptr->state = VoxelLodTerrainUpdateData::MESH_NEED_UPDATE;
 							}
 							return true;
 						}
@@ -224,12 +227,12 @@ void process_octrees_sliding_box(
 
 				Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
 
-				auto block_it = lod.mesh_map_state.map.find(bpos);
-				if (block_it != lod.mesh_map_state.map.end()) {
+				VoxelLodTerrainUpdateData::MeshBlockState *block_ptr = lod.mesh_map_state.map.find(bpos);
+				if (block_ptr != nullptr) {
 					lod.mesh_blocks_to_deactivate_visuals.push_back(bpos);
 					lod.mesh_blocks_to_deactivate_collision.push_back(bpos);
-					block_it->second.visual_active = false;
-					block_it->second.collision_active = false;
+					block_ptr->visual_active = false;
+					block_ptr->collision_active = false;
 				}
 			}
 		};
@@ -335,13 +338,54 @@ bool add_loading_block(VoxelLodTerrainUpdateData::Lod &lod, Vector3i position) {
 	return false;
 }
 
+// What fitting one octree produces. Octrees are fitted in parallel, so instead of writing into lists shared by the
+// whole terrain, each of them fills its own output, which is merged into the state afterwards.
+struct OctreeFittingOutput {
+	struct Lod {
+		StdVector<VoxelLodTerrainUpdateData::MeshToUpdate> mesh_blocks_pending_update;
+		StdVector<Vector3i> mesh_blocks_to_activate_visuals;
+		StdVector<Vector3i> mesh_blocks_to_deactivate_visuals;
+		StdVector<Vector3i> mesh_blocks_to_activate_collision;
+		StdVector<Vector3i> mesh_blocks_to_deactivate_collision;
+
+		void clear() {
+			mesh_blocks_pending_update.clear();
+			mesh_blocks_to_activate_visuals.clear();
+			mesh_blocks_to_deactivate_visuals.clear();
+			mesh_blocks_to_activate_collision.clear();
+			mesh_blocks_to_deactivate_collision.clear();
+		}
+	};
+
+	FixedArray<Lod, constants::MAX_LOD> lods;
+	StdVector<VoxelLodTerrainUpdateData::BlockToLoad> data_blocks_to_load;
+	unsigned int blocked_count = 0;
+	// Off by one bit: second bit is LOD0, first bit is unused
+	uint32_t lods_to_update_transitions = 0;
+
+	void clear(unsigned int lod_count) {
+		for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+			lods[lod_index].clear();
+		}
+		data_blocks_to_load.clear();
+		blocked_count = 0;
+		lods_to_update_transitions = 0;
+	}
+};
+
+VoxelLodTerrainUpdateData::MeshBlockState *find_mesh_block(VoxelLodTerrainUpdateData::Lod &lod, Vector3i bpos) {
+	// Other octrees may be inserting blocks at the same time
+	RWLockRead rlock(lod.mesh_map_state.map_lock);
+	return lod.mesh_map_state.map.find(bpos);
+}
+
 bool check_block_mesh_updated(
 		VoxelLodTerrainUpdateData::State &state,
 		const VoxelData &data,
 		VoxelLodTerrainUpdateData::MeshBlockState &mesh_block,
 		Vector3i mesh_block_pos,
 		uint8_t lod_index,
-		StdVector<VoxelLodTerrainUpdateData::BlockToLoad> &blocks_to_load,
+		OctreeFittingOutput &output,
 		const VoxelLodTerrainUpdateData::Settings &settings
 ) {
 	// ZN_PROFILE_SCOPE();
@@ -392,7 +436,7 @@ bool check_block_mesh_updated(
 				MutexLock lock(lod.loading_blocks_mutex);
 				for (const Vector3i &missing_pos : tls_missing) {
 					if (add_loading_block(lod, missing_pos)) {
-						blocks_to_load.push_back(VoxelLodTerrainUpdateData::BlockToLoad{
+						output.data_blocks_to_load.push_back(VoxelLodTerrainUpdateData::BlockToLoad{
 								VoxelLodTerrainUpdateData::BlockLocation{ missing_pos, lod_index },
 								TaskCancellationToken() });
 					}
@@ -400,7 +444,7 @@ bool check_block_mesh_updated(
 			}
 
 			if (surrounded) {
-				lod.mesh_blocks_pending_update.push_back(VoxelLodTerrainUpdateData::MeshToUpdate{
+				output.lods[lod_index].mesh_blocks_pending_update.push_back(VoxelLodTerrainUpdateData::MeshToUpdate{
 						mesh_block_pos, TaskCancellationToken(), true });
 				mesh_block.state = VoxelLodTerrainUpdateData::MESH_UPDATE_NOT_SENT;
 			}
@@ -424,27 +468,15 @@ bool check_block_mesh_updated(
 }
 
 VoxelLodTerrainUpdateData::MeshBlockState &insert_new(
-		StdUnorderedMap<Vector3i, VoxelLodTerrainUpdateData::MeshBlockState> &mesh_map,
+		SpatialHashMap<VoxelLodTerrainUpdateData::MeshBlockState> &mesh_map,
 		Vector3i pos
 ) {
 #ifdef DEBUG_ENABLED
 	// We got here because the map didn't contain the element. If it did contain it already, that's a bug.
 	static VoxelLodTerrainUpdateData::MeshBlockState s_default;
-	ERR_FAIL_COND_V(mesh_map.find(pos) != mesh_map.end(), s_default);
+	ERR_FAIL_COND_V(mesh_map.has(pos), s_default);
 #endif
-	// C++ standard says if the element is not present, it will be default-constructed.
-	// So here is how to insert a default, non-movable struct into an unordered_map.
-	// https://stackoverflow.com/questions/22229773/map-unordered-map-with-non-movable-default-constructible-value-type
-	VoxelLodTerrainUpdateData::MeshBlockState &block = mesh_map[pos];
-
-	// This approach doesn't compile, had to workaround with the writing [] operator.
-	/*
-	auto p = lod.mesh_map_state.map.emplace(pos, VoxelLodTerrainUpdateData::MeshBlockState());
-	// We got here because the map didn't contain the element. If it did contain it already, that's a bug.
-	CRASH_COND(p.second == false);
-	*/
-
-	return block;
+	return mesh_map.get_or_insert(pos);
 }
 
 bool check_block_loaded_and_meshed(
@@ -453,7 +485,7 @@ bool check_block_loaded_and_meshed(
 		const VoxelData &data,
 		const Vector3i &p_mesh_block_pos,
 		uint8_t lod_index,
-		StdVector<VoxelLodTerrainUpdateData::BlockToLoad> &blocks_to_load
+		OctreeFittingOutput &output
 ) {
 	//
 
@@ -488,7 +520,7 @@ bool check_block_loaded_and_meshed(
 			MutexLock mlock(lod.loading_blocks_mutex);
 			for (const Vector3i &missing_bpos : tls_missing) {
 				if (add_loading_block(lod, missing_bpos)) {
-					blocks_to_load.push_back(VoxelLodTerrainUpdateData::BlockToLoad{
+					output.data_blocks_to_load.push_back(VoxelLodTerrainUpdateData::BlockToLoad{
 							VoxelLodTerrainUpdateData::BlockLocation{ missing_bpos, lod_index },
 							TaskCancellationToken() });
 				}
@@ -500,21 +532,166 @@ bool check_block_loaded_and_meshed(
 	VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
 
 	VoxelLodTerrainUpdateData::MeshBlockState *mesh_block = nullptr;
-	auto mesh_block_it = lod.mesh_map_state.map.find(p_mesh_block_pos);
-	if (mesh_block_it == lod.mesh_map_state.map.end()) {
+	VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = find_mesh_block(lod, p_mesh_block_pos);
+	if (mesh_block_ptr == nullptr) {
 		// If this ever becomes a source of contention with the main thread's `apply_mesh_update`,
 		// we could defer additions to the end of octree fitting.
+		// Octrees don't overlap, so no other octree can be inserting the same position meanwhile.
 		RWLockWrite wlock(lod.mesh_map_state.map_lock);
 		mesh_block = &insert_new(lod.mesh_map_state.map, p_mesh_block_pos);
 		mesh_block->mesh_viewers.add();
 		mesh_block->collision_viewers.add();
 	} else {
-		mesh_block = &mesh_block_it->second;
+		mesh_block = mesh_block_ptr;
 	}
 
-	return check_block_mesh_updated(state, data, *mesh_block, p_mesh_block_pos, lod_index, blocks_to_load, settings);
+	return check_block_mesh_updated(state, data, *mesh_block, p_mesh_block_pos, lod_index, output, settings);
 }
 
+struct OctreeActions {
+	VoxelLodTerrainUpdateData::State &state;
+	const VoxelLodTerrainUpdateData::Settings &settings;
+	VoxelData &data;
+	OctreeFittingOutput &output;
+	Vector3i block_offset_lod0;
+	float lod_distance_octree_space;
+	Vector3 viewer_pos_octree_space;
+
+	void create_child(Vector3i node_pos, int lod_index, LodOctree::NodeData &node_data) {
+		VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+		const Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = find_mesh_block(lod, bpos);
+
+		// Never show a child that hasn't been meshed, if we got here that would be a bug
+		CRASH_COND(mesh_block_ptr == nullptr);
+		CRASH_COND(mesh_block_ptr->state != VoxelLodTerrainUpdateData::MESH_UP_TO_DATE);
+
+		// self->set_mesh_block_active(*block, true);
+		OctreeFittingOutput::Lod &output_lod = output.lods[lod_index];
+		output_lod.mesh_blocks_to_activate_visuals.push_back(bpos);
+		output_lod.mesh_blocks_to_activate_collision.push_back(bpos);
+		mesh_block_ptr->visual_active = true;
+		mesh_block_ptr->collision_active = true;
+		output.lods_to_update_transitions |= (0b111 << lod_index);
+	}
+
+	void destroy_child(Vector3i node_pos, int lod_index) {
+		VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+		const Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = find_mesh_block(lod, bpos);
+
+		if (mesh_block_ptr != nullptr) {
+			// self->set_mesh_block_active(*block, false);
+			mesh_block_ptr->visual_active = false;
+			mesh_block_ptr->collision_active = false;
+			OctreeFittingOutput::Lod &output_lod = output.lods[lod_index];
+			output_lod.mesh_blocks_to_deactivate_visuals.push_back(bpos);
+			output_lod.mesh_blocks_to_deactivate_collision.push_back(bpos);
+			output.lods_to_update_transitions |= (0b111 << lod_index);
+		}
+	}
+
+	void show_parent(Vector3i node_pos, int lod_index) {
+		VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+		Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = find_mesh_block(lod, bpos);
+
+		// If we teleport far away, the area we were in is going to merge,
+		// and blocks may have been unloaded completely.
+		// So in that case it's normal to not find any block.
+		// Otherwise, there must always be a visible parent in the end, unless the octree vanished.
+		if (mesh_block_ptr != nullptr && mesh_block_ptr->state == VoxelLodTerrainUpdateData::MESH_UP_TO_DATE) {
+			// self->set_mesh_block_active(*block, true);
+			mesh_block_ptr->visual_active = true;
+			mesh_block_ptr->collision_active = true;
+			OctreeFittingOutput::Lod &output_lod = output.lods[lod_index];
+			output_lod.mesh_blocks_to_activate_visuals.push_back(bpos);
+			output_lod.mesh_blocks_to_activate_collision.push_back(bpos);
+			output.lods_to_update_transitions |= (0b111 << lod_index);
+		}
+	}
+
+	void hide_parent(Vector3i node_pos, int lod_index) {
+		destroy_child(node_pos, lod_index); // Same
+	}
+
+	bool can_create_root(int lod_index) {
+		const Vector3i offset = block_offset_lod0 >> lod_index;
+		const bool can = check_block_loaded_and_meshed(state, settings, data, offset, lod_index, output);
+		if (!can) {
+			++output.blocked_count;
+		}
+		return can;
+	}
+
+	bool can_split(Vector3i node_pos, int lod_index, LodOctree::NodeData &node_data) {
+		ZN_PROFILE_SCOPE();
+		if (!LodOctree::is_below_split_distance(
+					node_pos, lod_index, viewer_pos_octree_space, lod_distance_octree_space
+			)) {
+			return false;
+		}
+		const int child_lod_index = lod_index - 1;
+		const Vector3i offset = block_offset_lod0 >> child_lod_index;
+		bool can = true;
+
+		// Can only subdivide if higher detail meshes are ready to be shown, otherwise it will produce holes
+		for (int i = 0; i < 8; ++i) {
+			// Get block pos local-to-region + convert to local-to-terrain
+			const Vector3i child_pos = LodOctree::get_child_position(node_pos, i) + offset;
+			// We have to ping ALL children, because the reason we are here is we want them loaded
+			can &= check_block_loaded_and_meshed(state, settings, data, child_pos, child_lod_index, output);
+		}
+
+		// Can only subdivide if blocks of a higher LOD index are present around,
+		// otherwise it will cause cracks.
+		// Need to check meshes, not voxels?
+		// const int lod_index = child_lod_index + 1;
+		// if (lod_index < self->get_lod_count()) {
+		// 	const Vector3i parent_offset = block_offset_lod0 >> lod_index;
+		// 	const Lod &lod = self->_lods[lod_index];
+		// 	can &= self->is_block_surrounded(node_pos + parent_offset, lod_index, lod.map);
+		// }
+
+		if (!can) {
+			++output.blocked_count;
+		}
+
+		return can;
+	}
+
+	bool can_join(Vector3i node_pos, int parent_lod_index) {
+		ZN_PROFILE_SCOPE();
+		if (LodOctree::is_below_split_distance(
+					node_pos, parent_lod_index, viewer_pos_octree_space, lod_distance_octree_space
+			)) {
+			return false;
+		}
+		// Can only unsubdivide if the parent mesh is ready
+		VoxelLodTerrainUpdateData::Lod &lod = state.lods[parent_lod_index];
+
+		Vector3i bpos = node_pos + (block_offset_lod0 >> parent_lod_index);
+		VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = find_mesh_block(lod, bpos);
+
+		if (mesh_block_ptr == nullptr) {
+			// The block got unloaded. Exceptionally, we can join.
+			// There will always be a grand-parent because we never destroy them when they split,
+			// and we never create a child without creating a parent first.
+			return true;
+		}
+
+		// The block is loaded (?) but the mesh isn't up to date, we need to ping and wait.
+		const bool can =
+				check_block_mesh_updated(state, data, *mesh_block_ptr, bpos, parent_lod_index, output, settings);
+
+		if (!can) {
+			++output.blocked_count;
+		}
+
+		return can;
+	}
+};
+
 void process_octrees_fitting(
 		VoxelLodTerrainUpdateData::State &state,
 		const VoxelLodTerrainUpdateData::Settings &settings,
@@ -532,193 +709,92 @@ void process_octrees_fitting(
 	const bool force_update_octrees = state.octree_streaming.force_update_octrees_next_update;
 	state.octree_streaming.force_update_octrees_next_update = false;
 
+	const bool viewer_moved =
+			p_viewer_pos.distance_squared_to(Vector3(state.octree_streaming.local_viewer_pos_previous_octree_update)) >=
+			math::squared(octree_leaf_node_size / 2);
+
 	// Octrees may not need to update every frame under certain conditions
-	if (!state.octree_streaming.had_blocked_octree_nodes_previous_update && !force_update_octrees &&
-		p_viewer_pos.distance_squared_to(Vector3(state.octree_streaming.local_viewer_pos_previous_octree_update)) <
-				math::squared(octree_leaf_node_size / 2)) {
+	if (!state.octree_streaming.had_blocked_octree_nodes_previous_update && !force_update_octrees && !viewer_moved) {
 		return;
 	}
 
-	state.octree_streaming.local_viewer_pos_previous_octree_update = p_viewer_pos;
+	// When the viewer barely moved, octrees that were not blocked would fit the same way again, so only blocked ones
+	// are updated. The reference position is kept, so small moves can't accumulate without updating every octree.
+	const bool update_all_octrees = force_update_octrees || viewer_moved;
+	if (update_all_octrees) {
+		state.octree_streaming.local_viewer_pos_previous_octree_update = p_viewer_pos;
+	}
 
 	const float lod_distance_octree_space = settings.lod_distance / octree_leaf_node_size;
 
-	unsigned int blocked_octree_nodes = 0;
+	// Octrees don't overlap, so they can be fitted in parallel. Their outputs are merged afterwards.
+	static thread_local StdVector<std::pair<Vector3i, VoxelLodTerrainUpdateData::OctreeItem *>> tls_octrees;
+	static thread_local StdVector<OctreeFittingOutput> tls_outputs;
+	// Jobs run on other threads too, where thread-locals refer to different vectors
+	StdVector<std::pair<Vector3i, VoxelLodTerrainUpdateData::OctreeItem *>> &octrees = tls_octrees;
+	StdVector<OctreeFittingOutput> &outputs = tls_outputs;
 
-	// Off by one bit: second bit is LOD0, first bit is unused
-	uint32_t lods_to_update_transitions = 0;
-
-	// TODO Optimization: Maintain a vector to make iteration faster?
+	octrees.clear();
 	for (auto octree_it = state.octree_streaming.lod_octrees.begin();
 		 octree_it != state.octree_streaming.lod_octrees.end();
 		 ++octree_it) {
-		ZN_PROFILE_SCOPE();
-
-		struct OctreeActions {
-			VoxelLodTerrainUpdateData::State &state;
-			const VoxelLodTerrainUpdateData::Settings &settings;
-			VoxelData &data;
-			StdVector<VoxelLodTerrainUpdateData::BlockToLoad> &data_blocks_to_load;
-			Vector3i block_offset_lod0;
-			unsigned int blocked_count = 0;
-			float lod_distance_octree_space;
-			Vector3 viewer_pos_octree_space;
-			uint32_t &lods_to_update_transitions;
-
-			void create_child(Vector3i node_pos, int lod_index, LodOctree::NodeData &node_data) {
-				VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
-				const Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
-				auto mesh_block_it = lod.mesh_map_state.map.find(bpos);
-
-				// Never show a child that hasn't been meshed, if we got here that would be a bug
-				CRASH_COND(mesh_block_it == lod.mesh_map_state.map.end());
-				CRASH_COND(mesh_block_it->second.state != VoxelLodTerrainUpdateData::MESH_UP_TO_DATE);
-
-				// self->set_mesh_block_active(*block, true);
-				lod.mesh_blocks_to_activate_visuals.push_back(bpos);
-				lod.mesh_blocks_to_activate_collision.push_back(bpos);
-				mesh_block_it->second.visual_active = true;
-				mesh_block_it->second.collision_active = true;
-				lods_to_update_transitions |= (0b111 << lod_index);
-			}
-
-			void destroy_child(Vector3i node_pos, int lod_index) {
-				VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
-				const Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
-				auto mesh_block_it = lod.mesh_map_state.map.find(bpos);
-
-				if (mesh_block_it != lod.mesh_map_state.map.end()) {
-					// self->set_mesh_block_active(*block, false);
-					mesh_block_it->second.visual_active = false;
-					mesh_block_it->second.collision_active = false;
-					lod.mesh_blocks_to_deactivate_visuals.push_back(bpos);
-					lod.mesh_blocks_to_deactivate_collision.push_back(bpos);
-					lods_to_update_transitions |= (0b111 << lod_index);
-				}
-			}
-
-			void show_parent(Vector3i node_pos, int lod_index) {
-				VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
-				Vector3i bpos = node_pos + (block_offset_lod0 >> lod_index);
-				auto mesh_block_it = lod.mesh_map_state.map.find(bpos);
-
-				// If we teleport far away, the area we were in is going to merge,
-				// and blocks may have been unloaded completely.
-				// So in that case it's normal to not find any block.
-				// Otherwise, there must always be a visible parent in the end, unless the octree vanished.
-				if (mesh_block_it != lod.mesh_map_state.map.end() &&
-					mesh_block_it->second.state == VoxelLodTerrainUpdateData::MESH_UP_TO_DATE) {
-					// self->set_mesh_block_active(*block, true);
-					mesh_block_it->second.visual_active = true;
-					mesh_block_it->second.collision_active = true;
-					lod.mesh_blocks_to_activate_visuals.push_back(bpos);
-					lod.mesh_blocks_to_activate_collision.push_back(bpos);
-					lods_to_update_transitions |= (0b111 << lod_index);
-				}
-			}
-
-			void hide_parent(Vector3i node_pos, int lod_index) {
-				destroy_child(node_pos, lod_index); // Same
-			}
-
-			bool can_create_root(int lod_index) {
-				const Vector3i offset = block_offset_lod0 >> lod_index;
-				const bool can =
-						check_block_loaded_and_meshed(state, settings, data, offset, lod_index, data_blocks_to_load);
-				if (!can) {
-					++blocked_count;
-				}
-				return can;
-			}
-
-			bool can_split(Vector3i node_pos, int lod_index, LodOctree::NodeData &node_data) {
-				ZN_PROFILE_SCOPE();
-				if (!LodOctree::is_below_split_distance(
-							node_pos, lod_index, viewer_pos_octree_space, lod_distance_octree_space
-					)) {
-					return false;
-				}
-				const int child_lod_index = lod_index - 1;
-				const Vector3i offset = block_offset_lod0 >> child_lod_index;
-				bool can = true;
-
-				// Can only subdivide if higher detail meshes are ready to be shown, otherwise it will produce holes
-				for (int i = 0; i < 8; ++i) {
-					// Get block pos local-to-region + convert to local-to-terrain
-					const Vector3i child_pos = LodOctree::get_child_position(node_pos, i) + offset;
-					// We have to ping ALL children, because the reason we are here is we want them loaded
-					can &= check_block_loaded_and_meshed(
-							state, settings, data, child_pos, child_lod_index, data_blocks_to_load
-					);
-				}
-
-				// Can only subdivide if blocks of a higher LOD index are present around,
-				// otherwise it will cause cracks.
-				// Need to check meshes, not voxels?
-				// const int lod_index = child_lod_index + 1;
-				// if (lod_index < self->get_lod_count()) {
-				// 	const Vector3i parent_offset = block_offset_lod0 >> lod_index;
-				// 	const Lod &lod = self->_lods[lod_index];
-				// 	can &= self->is_block_surrounded(node_pos + parent_offset, lod_index, lod.map);
-				// }
-
-				if (!can) {
-					++blocked_count;
-				}
-
-				return can;
-			}
-
-			bool can_join(Vector3i node_pos, int parent_lod_index) {
-				ZN_PROFILE_SCOPE();
-				if (LodOctree::is_below_split_distance(
-							node_pos, parent_lod_index, viewer_pos_octree_space, lod_distance_octree_space
-					)) {
-					return false;
-				}
-				// Can only unsubdivide if the parent mesh is ready
-				VoxelLodTerrainUpdateData::Lod &lod = state.lods[parent_lod_index];
+		if (update_all_octrees || octree_it->second.had_blocked_nodes) {
+			octrees.push_back({ octree_it->first, &octree_it->second });
+		}
+	}
 
-				Vector3i bpos = node_pos + (block_offset_lod0 >> parent_lod_index);
-				auto mesh_block_it = lod.mesh_map_state.map.find(bpos);
+	if (outputs.size() < octrees.size()) {
+		outputs.resize(octrees.size());
+	}
 
-				if (mesh_block_it == lod.mesh_map_state.map.end()) {
-					// The block got unloaded. Exceptionally, we can join.
-					// There will always be a grand-parent because we never destroy them when they split,
-					// and we never create a child without creating a parent first.
-					return true;
-				}
+	run_parallel_jobs(octrees.size(), [&](unsigned int job_index) {
+		ZN_PROFILE_SCOPE();
 
-				// The block is loaded (?) but the mesh isn't up to date, we need to ping and wait.
-				const bool can = check_block_mesh_updated(
-						state, data, mesh_block_it->second, bpos, parent_lod_index, data_blocks_to_load, settings
-				);
+		const Vector3i block_pos_maxlod = octrees[job_index].first;
+		VoxelLodTerrainUpdateData::OctreeItem &item = *octrees[job_index].second;
 
-				if (!can) {
-					++blocked_count;
-				}
+		OctreeFittingOutput &output = outputs[job_index];
+		output.clear(lod_count);
 
-				return can;
-			}
-		};
-
-		const Vector3i block_pos_maxlod = octree_it->first;
 		const Vector3i block_offset_lod0 = block_pos_maxlod << (lod_count - 1);
 		const Vector3 relative_viewer_pos = p_viewer_pos - Vector3(mesh_block_size * block_offset_lod0);
 
 		OctreeActions octree_actions{ state,
 									  settings,
 									  data,
-									  data_blocks_to_load,
+									  output,
 									  block_offset_lod0,
-									  0,
 									  lod_distance_octree_space,
-									  relative_viewer_pos / octree_leaf_node_size,
-									  lods_to_update_transitions };
-		VoxelLodTerrainUpdateData::OctreeItem &item = octree_it->second;
+									  relative_viewer_pos / octree_leaf_node_size };
 		item.octree.update(octree_actions);
 
-		blocked_octree_nodes += octree_actions.blocked_count;
+		item.had_blocked_nodes = output.blocked_count > 0;
+	});
+
+	unsigned int blocked_octree_nodes = 0;
+	uint32_t lods_to_update_transitions = 0;
+
+	{
+		ZN_PROFILE_SCOPE_NAMED("Merge octree outputs");
+
+		for (unsigned int octree_index = 0; octree_index < octrees.size(); ++octree_index) {
+			const OctreeFittingOutput &output = outputs[octree_index];
+
+			for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+				const OctreeFittingOutput::Lod &output_lod = output.lods[lod_index];
+				VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+
+				append_array(lod.mesh_blocks_pending_update, output_lod.mesh_blocks_pending_update);
+				append_array(lod.mesh_blocks_to_activate_visuals, output_lod.mesh_blocks_to_activate_visuals);
+				append_array(lod.mesh_blocks_to_deactivate_visuals, output_lod.mesh_blocks_to_deactivate_visuals);
+				append_array(lod.mesh_blocks_to_activate_collision, output_lod.mesh_blocks_to_activate_collision);
+				append_array(lod.mesh_blocks_to_deactivate_collision, output_lod.mesh_blocks_to_deactivate_collision);
+			}
+
+			append_array(data_blocks_to_load, output.data_blocks_to_load);
+			blocked_octree_nodes += output.blocked_count;
+			lods_to_update_transitions |= output.lods_to_update_transitions;
+		}
 	}
 
 	// Ideally, this stat should stabilize to zero.
@@ -0,0 +1,49 @@
+#include "voxel_lod_terrain_update_parallel_jobs.h"
+#include "../../engine/voxel_engine.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/math/funcs.h"
+#include "../../util/profiling.h"
+
+namespace zylann::voxel {
+
+namespace {
+
+class ParallelJobsTask : public IThreadedTask {
+public:
+	ParallelJobsTask(std::shared_ptr<ParallelJobs> jobs) : _jobs(jobs) {}
+
+	const char *get_debug_name() const override {
+		return "VoxelLodTerrainUpdateHelper";
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ZN_PROFILE_SCOPE();
+		while (_jobs->run_next_job()) {
+		}
+	}
+
+private:
+	// Jobs are shared so helpers starting after the update task moved on don't access freed memory
+	std::shared_ptr<ParallelJobs> _jobs;
+};
+
+} // namespace
+
+unsigned int get_parallel_job_helper_count(unsigned int job_count) {
+	if (job_count == 0) {
+		return 0;
+	}
+	// The current thread runs jobs too
+	return math::min(job_count, VoxelEngine::get_singleton().get_thread_count()) - 1;
+}
+
+void push_parallel_job_helpers(std::shared_ptr<ParallelJobs> jobs, unsigned int helper_count) {
+	static thread_local StdVector<IThreadedTask *> tls_helpers;
+	tls_helpers.clear();
+	for (unsigned int i = 0; i < helper_count; ++i) {
+		tls_helpers.push_back(ZN_NEW(ParallelJobsTask(jobs)));
+	}
+	VoxelEngine::get_singleton().push_async_tasks(to_span(tls_helpers));
+}
+
+} // namespace zylann::voxel
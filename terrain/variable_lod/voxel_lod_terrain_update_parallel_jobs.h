@@ -0,0 +1,72 @@
+#ifndef VOXEL_LOD_TERRAIN_UPDATE_PARALLEL_JOBS_H
+#define VOXEL_LOD_TERRAIN_UPDATE_PARALLEL_JOBS_H
+
+#include "../../util/memory/memory.h"
+#include "../../util/thread/semaphore.h"
+#include <atomic>
+
+namespace zylann::voxel {
+
+// Work shared by the update task and its helpers. Jobs are claimed with an atomic counter, so helpers that start late
+// or never start don't prevent the update task from completing them.
+struct ParallelJobs {
+	void (*func)(void *ctx, unsigned int job_index) = nullptr;
+	void *ctx = nullptr;
+	unsigned int job_count = 0;
+	std::atomic_uint32_t next_job_index = { 0 };
+	std::atomic_uint32_t completed_job_count = { 0 };
+	// Posted when the last job completes
+	Semaphore done_semaphore;
+
+	bool run_next_job() {
+		const unsigned int job_index = next_job_index.fetch_add(1, std::memory_order_relaxed);
+		if (job_index >= job_count) {
+			return false;
+		}
+		func(ctx, job_index);
+		if (completed_job_count.fetch_add(1, std::memory_order_acq_rel) + 1 == job_count) {
+			done_semaphore.post();
+		}
+		return true;
+	}
+};
+
+// Returns how many helper tasks `run_parallel_jobs` would use for the given amount of jobs
+unsigned int get_parallel_job_helper_count(unsigned int job_count);
+
+// Pushes helper tasks taking jobs in the general thread pool
+void push_parallel_job_helpers(std::shared_ptr<ParallelJobs> jobs, unsigned int helper_count);
+
+// Runs `func(job_index)` for every job, using the current thread and helper tasks in the general thread pool.
+// Returns when all jobs are done. Jobs must be independent from each other.
+template <typename F>
+void run_parallel_jobs(const unsigned int job_count, F func) {
+	if (job_count == 0) {
+		return;
+	}
+
+	const unsigned int helper_count = get_parallel_job_helper_count(job_count);
+
+	if (helper_count == 0) {
+		for (unsigned int job_index = 0; job_index < job_count; ++job_index) {
+			func(job_index);
+		}
+		return;
+	}
+
+	std::shared_ptr<ParallelJobs> jobs = make_shared_instance<ParallelJobs>();
+	jobs->func = [](void *ctx, unsigned int job_index) { (*static_cast<F *>(ctx))(job_index); };
+	jobs->ctx = &func;
+	jobs->job_count = job_count;
+
+	push_parallel_job_helpers(jobs, helper_count);
+
+	// The current thread takes jobs too, so this can't wait forever if the thread pool is busy
+	while (jobs->run_next_job()) {
+	}
+	jobs->done_semaphore.wait();
+}
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_LOD_TERRAIN_UPDATE_PARALLEL_JOBS_H
@@ -6,8 +6,10 @@
 #include "../../meshers/transvoxel/voxel_mesher_transvoxel.h"
 #include "../../storage/voxel_data.h"
 #include "../../streams/load_block_data_task.h"
+#include "../../streams/load_blocks_in_box_data_task.h"
 #include "../../streams/save_block_data_task.h"
 #include "../../util/containers/container_funcs.h"
+#include "../../util/containers/std_unordered_map.h"
 #include "../../util/dstack.h"
 #include "../../util/godot/classes/engine.h"
 #include "../../util/math/conv.h"
@@ -93,6 +95,23 @@ void request_block_generate( //
 	task_scheduler.push_main_task(task);
 }
 
+// If the block was unloaded while its data is still being saved, reuses that data instead of loading it
+bool try_quick_reload_block(VoxelLodTerrainUpdateData::Lod &lod, Vector3i block_pos) {
+	std::shared_ptr<VoxelBuffer> voxels;
+	{
+		MutexLock mlock(lod.unloaded_saving_blocks_mutex);
+		auto saving_it = lod.unloaded_saving_blocks.find(block_pos);
+		if (saving_it != lod.unloaded_saving_blocks.end()) {
+			voxels = saving_it->second;
+		}
+	}
+	if (voxels != nullptr) {
+		lod.quick_reloading_blocks.push_back(VoxelLodTerrainUpdateData::QuickReloadingBlock{ voxels, block_pos });
+		return true;
+	}
+	return false;
+}
+
 // Used only when streaming block by block
 void request_block_load( //
 		VolumeID volume_id, //
@@ -112,20 +131,8 @@ void request_block_load( //
 	ZN_ASSERT(data_block_size < 256);
 	ZN_ASSERT(stream_dependency != nullptr);
 
-	VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
-	{
-		std::shared_ptr<VoxelBuffer> voxels;
-		{
-			MutexLock mlock(lod.unloaded_saving_blocks_mutex);
-			auto saving_it = lod.unloaded_saving_blocks.find(block_pos);
-			if (saving_it != lod.unloaded_saving_blocks.end()) {
-				voxels = saving_it->second;
-			}
-		}
-		if (voxels != nullptr) {
-			lod.quick_reloading_blocks.push_back(VoxelLodTerrainUpdateData::QuickReloadingBlock{ voxels, block_pos });
-			return;
-		}
+	if (try_quick_reload_block(state.lods[lod_index], block_pos)) {
+		return;
 	}
 
 	if (stream_dependency->stream.is_valid()) {
@@ -134,22 +141,85 @@ void request_block_load( //
 				shared_viewers_data, volume_transform, settings.lod_distance);
 
 		const bool request_instances = false;
-		LoadBlockDataTask *task = ZN_NEW(LoadBlockDataTask(volume_id, block_pos, lod_index, data_block_size,
-				request_instances, stream_dependency, priority_dependency, settings.cache_generated_blocks,
-				settings.generator_use_gpu, data, cancellation_token));
+		LoadBlockDataTask *task = ThreadedTaskPool<LoadBlockDataTask>::get_singleton().create(volume_id, block_pos,
+				lod_index, data_block_size, request_instances, stream_dependency, priority_dependency,
+				settings.cache_generated_blocks, settings.generator_use_gpu, data, cancellation_token);
 
 		task_scheduler.push_io_task(task);
+		state.block_trace.add(BlockLifecycleTrace::STAGE_LOAD_QUEUED, block_pos, lod_index);
 
 	} else if (settings.cache_generated_blocks) {
 		// Directly generate the block without checking the stream.
 		request_block_generate(volume_id, data_block_size, stream_dependency, data, block_pos, lod_index,
 				shared_viewers_data, volume_transform, settings, nullptr, true, task_scheduler, cancellation_token);
+		state.block_trace.add(BlockLifecycleTrace::STAGE_GENERATE_QUEUED, block_pos, lod_index);
 
 	} else {
 		ZN_PRINT_WARNING("Requesting a block load when it should not have been necessary");
 	}
 }
 
+// Groups blocks to load into aligned chunks of neighbor blocks, and loads each chunk with one box query
+void send_block_data_requests_in_boxes( //
+		VolumeID volume_id, //
+		Span<const VoxelLodTerrainUpdateData::BlockToLoad> blocks_to_load, //
+		std::shared_ptr<StreamingDependency> &stream_dependency, //
+		const std::shared_ptr<VoxelData> &data, //
+		std::shared_ptr<PriorityDependency::ViewersData> &shared_viewers_data, //
+		unsigned int data_block_size, //
+		unsigned int chunk_size_po2, //
+		const Transform3D &volume_transform, //
+		const VoxelLodTerrainUpdateData::Settings &settings, //
+		BufferedTaskScheduler &task_scheduler, //
+		VoxelLodTerrainUpdateData::State &state //
+) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(data_block_size < 256);
+
+	// Requests grouped by chunk position, for each LOD
+	FixedArray<StdUnorderedMap<Vector3i, StdVector<LoadBlocksInBoxDataTask::BlockRequest>>, constants::MAX_LOD>
+			chunks_per_lod;
+
+	for (const VoxelLodTerrainUpdateData::BlockToLoad &btl : blocks_to_load) {
+		if (try_quick_reload_block(state.lods[btl.loc.lod], btl.loc.position)) {
+			continue;
+		}
+		chunks_per_lod[btl.loc.lod][btl.loc.position >> chunk_size_po2].push_back(
+				LoadBlocksInBoxDataTask::BlockRequest{ btl.loc.position, btl.cancellation_token }
+		);
+	}
+
+	for (unsigned int lod_index = 0; lod_index < chunks_per_lod.size(); ++lod_index) {
+		StdUnorderedMap<Vector3i, StdVector<LoadBlocksInBoxDataTask::BlockRequest>> &chunks = chunks_per_lod[lod_index];
+
+		for (auto it = chunks.begin(); it != chunks.end(); ++it) {
+			StdVector<LoadBlocksInBoxDataTask::BlockRequest> &requests = it->second;
+
+			// Only query the part of the chunk that contains requested blocks
+			Box3i box(requests[0].position, Vector3i(1, 1, 1));
+			for (const LoadBlocksInBoxDataTask::BlockRequest &request : requests) {
+				box.merge_with(Box3i(request.position, Vector3i(1, 1, 1)));
+			}
+
+			if (state.block_trace.is_enabled()) {
+				for (const LoadBlocksInBoxDataTask::BlockRequest &request : requests) {
+					state.block_trace.add(BlockLifecycleTrace::STAGE_LOAD_QUEUED, request.position, lod_index);
+				}
+			}
+
+			PriorityDependency priority_dependency;
+			init_sparse_octree_priority_dependency(priority_dependency, box.position + box.size / 2, lod_index,
+					data_block_size, shared_viewers_data, volume_transform, settings.lod_distance);
+
+			LoadBlocksInBoxDataTask *task = ZN_NEW(LoadBlocksInBoxDataTask(volume_id, box, lod_index,
+					data_block_size, std::move(requests), stream_dependency, priority_dependency,
+					settings.cache_generated_blocks, settings.generator_use_gpu, data));
+
+			task_scheduler.push_io_task(task);
+		}
+	}
+}
+
 void send_block_data_requests( //
 		VolumeID volume_id, //
 		Span<const VoxelLodTerrainUpdateData::BlockToLoad> blocks_to_load, //
@@ -163,8 +233,24 @@ void send_block_data_requests( //
 		VoxelLodTerrainUpdateData::State &state //
 ) {
 	//
+	if (settings.streaming_system == VoxelLodTerrainUpdateData::STREAMING_SYSTEM_CLIPBOX &&
+		stream_dependency->stream.is_valid()) {
+		// Clipbox streaming requests whole slabs of blocks when viewers move, so neighbor blocks are loaded together.
+		// Chunks are big enough to cover slabs with few queries, small enough to keep priorities meaningful.
+		send_block_data_requests_in_boxes(volume_id, blocks_to_load, stream_dependency, data, shared_viewers_data,
+				data_block_size, 3, volume_transform, settings, task_scheduler, state);
+		return;
+	}
+
+	StdVector<VoxelLodTerrainUpdateData::BlockToLoad> grouped_blocks_to_load;
+
 	for (unsigned int i = 0; i < blocks_to_load.size(); ++i) {
 		const VoxelLodTerrainUpdateData::BlockToLoad btl = blocks_to_load[i];
+		if (btl.loc.lod >= settings.grouped_loading_begin_lod_index && stream_dependency->stream.is_valid()) {
+			// Blocks of coarse LODs hold few voxels each, so the cost of loading them one by one dominates
+			grouped_blocks_to_load.push_back(btl);
+			continue;
+		}
 		request_block_load( //
 				volume_id, //
 				data_block_size, //
@@ -180,6 +266,11 @@ void send_block_data_requests( //
 				state //
 		);
 	}
+
+	if (grouped_blocks_to_load.size() > 0) {
+		send_block_data_requests_in_boxes(volume_id, to_span(grouped_blocks_to_load), stream_dependency, data,
+				shared_viewers_data, data_block_size, 1, volume_transform, settings, task_scheduler, state);
+	}
 }
 
 // This is used when streaming is enabled, yet the terrain has no stream and no generator (There can only be empty
@@ -244,8 +335,44 @@ void request_voxel_block_save( //
 			ZN_NEW(SaveBlockDataTask(volume_id, block_pos, lod_index, voxels, stream_dependency, tracker, with_flush));
 
 	// No priority data, saving doesn't need sorting.
+	// Voxels are only compressed and queued, files are written by another task.
+	task_scheduler.push_main_task(task);
+}
+
+// When all data is in memory, edits are not passed to data LODs above 0 until something needs them. Meshes about to
+// be requested need their LOD to be up to date.
+void update_deferred_lods_for_mesh_requests( //
+		const VoxelLodTerrainUpdateData::State &state, //
+		VoxelData &data, //
+		const int mesh_block_size //
+) {
+	if (!data.has_deferred_lod_updates()) {
+		return;
+	}
+	ZN_PROFILE_SCOPE();
 
-	task_scheduler.push_io_task(task);
+	const int render_to_data_factor = mesh_block_size / data.get_block_size();
+	const unsigned int lod_count = data.get_lod_count();
+
+	static thread_local StdVector<Box3i> tls_data_blocks_boxes;
+	StdVector<Box3i> &data_blocks_boxes = tls_data_blocks_boxes;
+
+	// LOD0 is always up to date
+	for (unsigned int lod_index = 1; lod_index < lod_count; ++lod_index) {
+		const VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
+
+		data_blocks_boxes.clear();
+		for (const VoxelLodTerrainUpdateData::MeshToUpdate &mesh_to_update : lod.mesh_blocks_pending_update) {
+			const Box3i mesh_data_blocks_box(
+					mesh_to_update.position * render_to_data_factor, Vector3iUtil::create(render_to_data_factor)
+			);
+			// Padded because meshing also reads voxels of neighbor data blocks
+			data_blocks_boxes.push_back(mesh_data_blocks_box.padded(1));
+		}
+
+		// Blocks of all LODs in between are updated along the way
+		data.update_deferred_lods(to_span(data_blocks_boxes), lod_index, nullptr);
+	}
 }
 
 void send_mesh_requests( //
@@ -268,18 +395,30 @@ void send_mesh_requests( //
 	const int render_to_data_factor = mesh_block_size / data_block_size;
 	const unsigned int lod_count = data.get_lod_count();
 
+	// Tasks are created first, so we can then fetch voxels of all blocks of each LOD at once
+	static thread_local StdVector<MeshBlockTask *> tls_tasks;
+	static thread_local StdVector<Box3i> tls_data_boxes;
+	static thread_local StdVector<std::shared_ptr<VoxelBuffer>> tls_blocks;
+	StdVector<MeshBlockTask *> &tasks = tls_tasks;
+	StdVector<Box3i> &data_boxes = tls_data_boxes;
+	StdVector<std::shared_ptr<VoxelBuffer>> &blocks = tls_blocks;
+
 	for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
 		ZN_PROFILE_SCOPE();
 		VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
 
+		tasks.clear();
+		data_boxes.clear();
+
 		for (unsigned int bi = 0; bi < lod.mesh_blocks_pending_update.size(); ++bi) {
 			ZN_PROFILE_SCOPE();
 			const VoxelLodTerrainUpdateData::MeshToUpdate &mesh_to_update = lod.mesh_blocks_pending_update[bi];
 
-			auto mesh_block_it = lod.mesh_map_state.map.find(mesh_to_update.position);
+			VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr =
+					lod.mesh_map_state.map.find(mesh_to_update.position);
 			// A block must have been allocated before we ask for a mesh update
-			ZN_ASSERT_CONTINUE(mesh_block_it != lod.mesh_map_state.map.end());
-			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = mesh_block_it->second;
+			ZN_ASSERT_CONTINUE(mesh_block_ptr != nullptr);
+			VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = *mesh_block_ptr;
 			// All blocks we get here must be in the scheduled state
 			ZN_ASSERT_CONTINUE(mesh_block.state == VoxelLodTerrainUpdateData::MESH_UPDATE_NOT_SENT);
 
@@ -288,8 +427,7 @@ void send_mesh_requests( //
 			// mesh_request.render_block_position = mesh_block_pos;
 			// mesh_request.lod = lod_index;
 
-			// We'll allocate this quite often. If it becomes a problem, it should be easy to pool.
-			MeshBlockTask *task = ZN_NEW(MeshBlockTask);
+			MeshBlockTask *task = ThreadedTaskPool<MeshBlockTask>::get_singleton().create();
 			task->volume_id = volume_id;
 			task->mesh_block_position = mesh_to_update.position;
 			task->lod_index = lod_index;
@@ -298,6 +436,9 @@ void send_mesh_requests( //
 			task->data = data_ptr;
 			task->require_visual = mesh_to_update.require_visual;
 			task->collision_hint = settings.collision_enabled;
+			task->require_collision_shape = settings.collision_enabled &&
+					(settings.collision_lod_count == 0 || lod_index < settings.collision_lod_count) &&
+					mesh_block.collision_viewers.get() > 0;
 			task->detail_texture_settings = settings.detail_texture_settings;
 			task->detail_texture_generator_override = settings.detail_texture_generator_override;
 			task->detail_texture_generator_override_begin_lod_index =
@@ -305,6 +446,9 @@ void send_mesh_requests( //
 			task->detail_texture_use_gpu = settings.detail_textures_use_gpu;
 			task->block_generation_use_gpu = settings.generator_use_gpu;
 			task->cancellation_token = mesh_to_update.cancellation_token;
+			task->caused_by_edit = mesh_block.update_caused_by_edit;
+			task->baked_mesh_stream = settings.baked_mesh_stream;
+			task->baked_mesh_settings_hash = settings.baked_mesh_settings_hash;
 
 			// Don't update a detail texture if one update is already processing
 			if (settings.detail_texture_settings.enabled &&
@@ -318,12 +462,38 @@ void send_mesh_requests( //
 					Box3i(render_to_data_factor * mesh_to_update.position, Vector3iUtil::create(render_to_data_factor))
 							.padded(1);
 
-			// Iteration order matters for thread access.
-			// The array also implicitly encodes block position due to the convention being used,
-			// so there is no need to also include positions in the request
-			data.get_blocks_with_voxel_data(data_box, lod_index, to_span(task->blocks));
 			task->blocks_count = Vector3iUtil::get_volume(data_box.size);
 
+			tasks.push_back(task);
+			data_boxes.push_back(data_box);
+
+			mesh_block.state = VoxelLodTerrainUpdateData::MESH_UPDATE_SENT;
+			mesh_block.update_list_index = -1;
+			mesh_block.update_caused_by_edit = false;
+
+			state.block_trace.add(BlockLifecycleTrace::STAGE_MESH_QUEUED, mesh_to_update.position, lod_index);
+		}
+
+		unsigned int total_blocks_count = 0;
+		for (const MeshBlockTask *task : tasks) {
+			total_blocks_count += task->blocks_count;
+		}
+		blocks.clear();
+		blocks.resize(total_blocks_count);
+
+		// Iteration order matters for thread access.
+		// The array also implicitly encodes block position due to the convention being used,
+		// so there is no need to also include positions in the request
+		data.get_blocks_with_voxel_data(to_span(data_boxes), lod_index, to_span(blocks));
+
+		unsigned int blocks_index = 0;
+
+		for (MeshBlockTask *task : tasks) {
+			for (unsigned int i = 0; i < task->blocks_count; ++i) {
+				task->blocks[i] = std::move(blocks[blocks_index + i]);
+			}
+			blocks_index += task->blocks_count;
+
 			// TODO There is inconsistency with coordinates sent to this function.
 			// Sometimes we send data block coordinates, sometimes we send mesh block coordinates. They aren't always
 			// the same, it might cause issues in priority sorting?
@@ -331,9 +501,6 @@ void send_mesh_requests( //
 					task->lod_index, mesh_block_size, shared_viewers_data, volume_transform, settings.lod_distance);
 
 			task_scheduler.push_main_task(task);
-
-			mesh_block.state = VoxelLodTerrainUpdateData::MESH_UPDATE_SENT;
-			mesh_block.update_list_index = -1;
 		}
 
 		lod.mesh_blocks_pending_update.clear();
@@ -474,14 +641,14 @@ void process_async_edits( //
 			// Not sure if worth doing, I don't think tasks can be aborted before even being scheduled.
 			if (edit.task_tracker->is_aborted()) {
 				ZN_PRINT_VERBOSE("Aborted async edit");
-				ZN_DELETE(edit.task);
+				edit.task->dispose();
 				continue;
 			}
 
 			boxes_to_preload.push_back(edit.box);
 			tasks_to_schedule.push_back(edit.task);
 			state.running_async_edits.push_back(
-					VoxelLodTerrainUpdateData::RunningAsyncEdit{ edit.task_tracker, edit.box });
+					VoxelLodTerrainUpdateData::RunningAsyncEdit{ edit.task_tracker, edit.box, edit.read_only });
 		}
 
 		if (boxes_to_preload.size() > 0) {
@@ -528,10 +695,10 @@ void process_changed_generated_areas( //
 			RWLockRead rlock(lod.mesh_map_state.map_lock);
 
 			bbox.for_each_cell_zxy([&lod](const Vector3i bpos) {
-				auto block_it = lod.mesh_map_state.map.find(bpos);
-				if (block_it != lod.mesh_map_state.map.end()) {
-					VoxelLodTerrainUpdateTask::schedule_mesh_update(block_it->second, bpos,
-							lod.mesh_blocks_pending_update, block_it->second.mesh_viewers.get() > 0);
+				VoxelLodTerrainUpdateData::MeshBlockState *block_ptr = lod.mesh_map_state.map.find(bpos);
+				if (block_ptr != nullptr) {
+					VoxelLodTerrainUpdateTask::schedule_mesh_update(*block_ptr, bpos,
+							lod.mesh_blocks_pending_update, block_ptr->mesh_viewers.get() > 0);
 				}
 			});
 		}
@@ -613,15 +780,16 @@ void VoxelLodTerrainUpdateTask::flush_pending_lod_edits( //
 			const Box3i mesh_block_box = padded_voxel_box.downscaled(mesh_block_size_at_lod);
 
 			mesh_block_box.for_each_cell([&lod](Vector3i mesh_block_pos) {
-				auto mesh_block_it = lod.mesh_map_state.map.find(mesh_block_pos);
-				if (mesh_block_it != lod.mesh_map_state.map.end()) {
+				VoxelLodTerrainUpdateData::MeshBlockState *mesh_block_ptr = lod.mesh_map_state.map.find(mesh_block_pos);
+				if (mesh_block_ptr != nullptr) {
 					// If a mesh block state exists here, it will need an update.
 					// If there is none, it will probably get created later when we come closer to it
 					schedule_mesh_update( //
-							mesh_block_it->second, //
+							*mesh_block_ptr, //
 							mesh_block_pos, //
 							lod.mesh_blocks_pending_update, //
-							mesh_block_it->second.mesh_viewers.get() > 0 //
+							mesh_block_ptr->mesh_viewers.get() > 0, //
+							true //
 					);
 				}
 			});
@@ -669,9 +837,9 @@ uint8_t VoxelLodTerrainUpdateTask::get_transition_mask( //
 	for (unsigned int dir = 0; dir < Cube::SIDE_COUNT; ++dir) {
 		const Vector3i npos = block_pos + Cube::g_side_normals[dir];
 
-		auto nblock_it = lod.mesh_map_state.map.find(npos);
+		const VoxelLodTerrainUpdateData::MeshBlockState *nblock = lod.mesh_map_state.map.find(npos);
 
-		if (nblock_it != lod.mesh_map_state.map.end() && nblock_it->second.visual_active) {
+		if (nblock != nullptr && nblock->visual_active) {
 			visible_neighbors_of_same_lod |= (1 << dir);
 		}
 	}
@@ -700,10 +868,10 @@ uint8_t VoxelLodTerrainUpdateTask::get_transition_mask( //
 			const Vector3i lower_neighbor_pos = (block_pos + side_normal) >> 1;
 
 			if (lower_neighbor_pos != lower_pos) {
-				auto lower_neighbor_block_it = lower_lod.mesh_map_state.map.find(lower_neighbor_pos);
+				const VoxelLodTerrainUpdateData::MeshBlockState *lower_neighbor_block =
+						lower_lod.mesh_map_state.map.find(lower_neighbor_pos);
 
-				if (lower_neighbor_block_it != lower_lod.mesh_map_state.map.end() &&
-						lower_neighbor_block_it->second.visual_active) {
+				if (lower_neighbor_block != nullptr && lower_neighbor_block->visual_active) {
 					// The block has a visible neighbor of lower LOD
 					transition_mask |= dir_mask;
 					continue;
@@ -724,10 +892,10 @@ uint8_t VoxelLodTerrainUpdateTask::get_transition_mask( //
 				}
 
 				const VoxelLodTerrainUpdateData::Lod &upper_lod = state.lods[lod_index - 1];
-				auto upper_neighbor_block_it = upper_lod.mesh_map_state.map.find(upper_neighbor_pos);
+				const VoxelLodTerrainUpdateData::MeshBlockState *upper_neighbor_block =
+						upper_lod.mesh_map_state.map.find(upper_neighbor_pos);
 
-				if (upper_neighbor_block_it == upper_lod.mesh_map_state.map.end() ||
-						upper_neighbor_block_it->second.visual_active == false) {
+				if (upper_neighbor_block == nullptr || upper_neighbor_block->visual_active == false) {
 					// The block has no visible neighbor yet. World border? Assume lower LOD.
 					transition_mask |= dir_mask;
 				}
@@ -770,20 +938,23 @@ void update_transition_masks( //
 			// this map while the task is running.
 			RWLockRead rlock(lod.mesh_map_state.map_lock);
 
-			for (auto it = lod.mesh_map_state.map.begin(); it != lod.mesh_map_state.map.end(); ++it) {
-				VoxelLodTerrainUpdateData::MeshBlockState &mesh_block = it->second;
-
-				if (mesh_block.visual_active && (!use_refcounts || mesh_block.mesh_viewers.get() > 0)) {
-					const uint8_t recomputed_mask =
-							VoxelLodTerrainUpdateTask::get_transition_mask(state, it->first, lod_index, lod_count);
-
-					if (recomputed_mask != it->second.transition_mask) {
-						mesh_block.transition_mask = recomputed_mask;
-						lod.mesh_blocks_to_update_transitions.push_back(
-								VoxelLodTerrainUpdateData::TransitionUpdate{ it->first, recomputed_mask });
+			lod.mesh_map_state.map.for_each( //
+					[&state, &lod, lod_index, lod_count, use_refcounts](
+							const Vector3i bpos, VoxelLodTerrainUpdateData::MeshBlockState &mesh_block
+					) {
+						if (mesh_block.visual_active && (!use_refcounts || mesh_block.mesh_viewers.get() > 0)) {
+							const uint8_t recomputed_mask =
+									VoxelLodTerrainUpdateTask::get_transition_mask(state, bpos, lod_index, lod_count);
+
+							if (recomputed_mask != mesh_block.transition_mask) {
+								mesh_block.transition_mask = recomputed_mask;
+								lod.mesh_blocks_to_update_transitions.push_back(
+										VoxelLodTerrainUpdateData::TransitionUpdate{ bpos, recomputed_mask }
+								);
+							}
+						}
 					}
-				}
-			}
+			);
 		}
 	}
 #if 0
@@ -793,13 +964,17 @@ void update_transition_masks( //
 		for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
 			const VoxelLodTerrainUpdateData::Lod &lod = state.lods[lod_index];
 			RWLockRead rlock(lod.mesh_map_state.map_lock);
-			for (auto it = lod.mesh_map_state.map.begin(); it != lod.mesh_map_state.map.end(); ++it) {
-				if (it->second.active) {
-					const uint8_t recomputed_mask =
-							VoxelLodTerrainUpdateTask::get_transition_mask(state, it->first, lod_index, lod_count);
-					CRASH_COND(recomputed_mask != it->second.transition_mask);
-				}
-			}
+			lod.mesh_map_state.map.for_each( //
+					[&state, lod_index, lod_count](
+							const Vector3i bpos, const VoxelLodTerrainUpdateData::MeshBlockState &mesh_block
+					) {
+						if (mesh_block.active) {
+							const uint8_t recomputed_mask =
+									VoxelLodTerrainUpdateTask::get_transition_mask(state, bpos, lod_index, lod_count);
+							CRASH_COND(recomputed_mask != mesh_block.transition_mask);
+						}
+					}
+			);
 		}
 	}
 #endif
@@ -979,6 +1154,8 @@ void VoxelLodTerrainUpdateTask::run(ThreadedTaskContext &ctx) {
 	// TODO When no mesher is assigned, mesh requests are still accumulated but not being sent. A better way to support
 	// this is by allowing voxels-only/mesh-less viewers, similar to VoxelTerrain
 	if (_meshing_dependency->mesher.is_valid()) {
+		update_deferred_lods_for_mesh_requests(state, data, 1 << settings.mesh_block_size_po2);
+
 		send_mesh_requests( //
 				_volume_id, //
 				state, //
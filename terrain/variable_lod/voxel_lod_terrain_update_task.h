@@ -69,19 +69,24 @@ public:
 			VoxelLodTerrainUpdateData::MeshBlockState &block, //
 			Vector3i bpos, //
 			StdVector<VoxelLodTerrainUpdateData::MeshToUpdate> &blocks_pending_update, //
-			bool require_visual //
+			bool require_visual, //
+			bool caused_by_edit = false //
 	) {
 		if (block.state != VoxelLodTerrainUpdateData::MESH_UPDATE_NOT_SENT) {
 			if (block.visual_active || block.collision_active) {
 				// Schedule an update
 				block.state = VoxelLodTerrainUpdateData::MESH_UPDATE_NOT_SENT;
 				block.update_list_index = blocks_pending_update.size();
+				block.update_caused_by_edit = caused_by_edit;
 				blocks_pending_update.push_back(
 						VoxelLodTerrainUpdateData::MeshToUpdate{ bpos, TaskCancellationToken(), require_visual });
 			} else {
 				// Just mark it as needing update, so the visibility system will schedule its update when needed.
 				block.state = VoxelLodTerrainUpdateData::MESH_NEED_UPDATE;
 			}
+		} else {
+			// Already scheduled
+			block.update_caused_by_edit |= caused_by_edit;
 		}
 	}
 
@@ -9,6 +9,26 @@ using namespace zylann::godot;
 
 namespace zylann::voxel {
 
+namespace {
+
+uint8_t encode_transition_mask(uint8_t m) {
+	// TODO Needs translation here, because Cube:: tables use slightly different order...
+	// We may get rid of this once cube tables respects -x+x-y+y-z+z order
+	uint8_t bits[Cube::SIDE_COUNT];
+	for (unsigned int dir = 0; dir < Cube::SIDE_COUNT; ++dir) {
+		bits[dir] = (m >> dir) & 1;
+	}
+	uint8_t tm = bits[Cube::SIDE_NEGATIVE_X];
+	tm |= bits[Cube::SIDE_POSITIVE_X] << 1;
+	tm |= bits[Cube::SIDE_NEGATIVE_Y] << 2;
+	tm |= bits[Cube::SIDE_POSITIVE_Y] << 3;
+	tm |= bits[Cube::SIDE_NEGATIVE_Z] << 4;
+	tm |= bits[Cube::SIDE_POSITIVE_Z] << 5;
+	return tm;
+}
+
+} // namespace
+
 VoxelMeshBlockVLT::VoxelMeshBlockVLT(const Vector3i bpos, unsigned int size, unsigned int p_lod_index) :
 		VoxelMeshBlock(bpos) {
 	_position_in_voxels = bpos * (size << p_lod_index);
@@ -50,6 +70,7 @@ VoxelMeshBlockVLT::~VoxelMeshBlockVLT() {
 }
 
 void VoxelMeshBlockVLT::set_mesh(
+		DirectMeshInstancePool &mesh_instance_pool,
 		Ref<Mesh> mesh,
 		GeometryInstance3D::GIMode gi_mode,
 		RenderingServer::ShadowCastingSetting shadow_casting,
@@ -66,12 +87,12 @@ void VoxelMeshBlockVLT::set_mesh(
 	// This needs investigation.
 
 	if (shadow_occluder_mesh.is_null()) {
-		if (_shadow_occluder.is_valid()) {
-			_shadow_occluder.destroy();
-		}
+		FreeMeshTask::try_add_and_recycle(_shadow_occluder, mesh_instance_pool);
 	} else {
 		if (!_shadow_occluder.is_valid()) {
-			_shadow_occluder.create();
+			_shadow_occluder = mesh_instance_pool.allocate();
+			// Pooled instances may have been used with different settings
+			_shadow_occluder.set_gi_mode(GeometryInstance3D::GI_MODE_DISABLED);
 			_shadow_occluder.set_render_layers_mask(render_layers_mask);
 #ifdef TOOLS_ENABLED
 			_shadow_occluder.set_cast_shadows_setting(shadow_occluder_mode);
@@ -88,11 +109,11 @@ void VoxelMeshBlockVLT::set_mesh(
 	if (mesh.is_valid()) {
 		if (!_mesh_instance.is_valid()) {
 			// Create instance if it doesn't exist
-			_mesh_instance.create();
+			_mesh_instance = mesh_instance_pool.allocate();
 			_mesh_instance.set_gi_mode(gi_mode);
 			_mesh_instance.set_cast_shadows_setting(shadow_casting);
 			_mesh_instance.set_render_layers_mask(render_layers_mask);
-			set_mesh_instance_visible(_mesh_instance, _visible && _parent_visible);
+			set_mesh_instance_visible(_mesh_instance, _visible && _parent_visible && !_clustered);
 		}
 
 		_mesh_instance.set_mesh(mesh);
@@ -106,41 +127,30 @@ void VoxelMeshBlockVLT::set_mesh(
 
 	} else {
 		// TODO We should no longer expect `set_mesh` to be called with a null mesh, instead we use `drop_visuals`
-		if (_mesh_instance.is_valid()) {
-			// Delete instance if it exists
-			_mesh_instance.destroy();
-		}
+		// Recycle instance if it exists
+		FreeMeshTask::try_add_and_recycle(_mesh_instance, mesh_instance_pool);
 	}
 }
 
-void VoxelMeshBlockVLT::drop_visuals() {
-	if (_mesh_instance.is_valid()) {
-		// Make sure no material override is set, because it's possible the material will get destroyed before the mesh
-		// instance, which would cause errors in RenderingServer. Our thin wrapper does not take ownership of the
-		// material.
-		// TODO Eventually it would be better if we could just unref the material after having destroyed the mesh...
-		// VoxelMeshBlock inheritance isn't helping us here
-		_mesh_instance.set_material_override(Ref<Material>());
-	}
-	FreeMeshTask::try_add_and_destroy(_mesh_instance);
-
-	if (_shadow_occluder.is_valid()) {
-		_shadow_occluder.destroy();
-	}
+void VoxelMeshBlockVLT::drop_visuals(DirectMeshInstancePool &mesh_instance_pool) {
+	// Recycling also removes material overrides, so materials can't get destroyed before the instances referencing
+	// them
+	FreeMeshTask::try_add_and_recycle(_mesh_instance, mesh_instance_pool);
+	FreeMeshTask::try_add_and_recycle(_shadow_occluder, mesh_instance_pool);
 
 	for (unsigned int i = 0; i < _transition_mesh_instances.size(); ++i) {
-		DirectMeshInstance &tmi = _transition_mesh_instances[i];
-		if (tmi.is_valid()) {
-			tmi.set_material_override(Ref<Material>());
-			FreeMeshTask::try_add_and_destroy(tmi);
-		}
+		FreeMeshTask::try_add_and_recycle(_transition_mesh_instances[i], mesh_instance_pool);
 	}
 
 	detail_texture_fallback_level = 0;
+	detail_texture_evicted = false;
 	fading_state = FADING_NONE;
 	fading_progress = 0.f;
 	visual_active = false;
 	_transition_mask = 0;
+	_lod_fade = Vector2();
+	_clustered = false;
+	cluster_surfaces.clear();
 }
 
 void VoxelMeshBlockVLT::set_gi_mode(GeometryInstance3D::GIMode mode) {
@@ -175,6 +185,7 @@ void VoxelMeshBlockVLT::set_render_layers_mask(int mask) {
 }
 
 void VoxelMeshBlockVLT::set_transition_mesh(
+		DirectMeshInstancePool &mesh_instance_pool,
 		Ref<Mesh> mesh,
 		unsigned int side,
 		GeometryInstance3D::GIMode gi_mode,
@@ -186,7 +197,7 @@ void VoxelMeshBlockVLT::set_transition_mesh(
 	if (mesh.is_valid()) {
 		if (!mesh_instance.is_valid()) {
 			// Create instance if it doesn't exist
-			mesh_instance.create();
+			mesh_instance = mesh_instance_pool.allocate();
 			mesh_instance.set_gi_mode(gi_mode);
 			mesh_instance.set_cast_shadows_setting(shadow_casting);
 			mesh_instance.set_render_layers_mask(render_layers_mask);
@@ -203,10 +214,8 @@ void VoxelMeshBlockVLT::set_transition_mesh(
 #endif
 
 	} else {
-		if (mesh_instance.is_valid()) {
-			// Delete instance if it exists
-			mesh_instance.destroy();
-		}
+		// Recycle instance if it exists
+		FreeMeshTask::try_add_and_recycle(mesh_instance, mesh_instance_pool);
 	}
 }
 
@@ -232,7 +241,7 @@ void VoxelMeshBlockVLT::set_visible(bool visible) {
 }
 
 void VoxelMeshBlockVLT::_set_visible(bool visible) {
-	VoxelMeshBlock::_set_visible(visible);
+	VoxelMeshBlock::_set_visible(visible && !_clustered);
 
 	if (_shadow_occluder.is_valid()) {
 		set_mesh_instance_visible(_shadow_occluder, visible);
@@ -246,6 +255,16 @@ void VoxelMeshBlockVLT::_set_visible(bool visible) {
 	}
 }
 
+void VoxelMeshBlockVLT::set_clustered(bool clustered) {
+	if (_clustered == clustered) {
+		return;
+	}
+	_clustered = clustered;
+	if (_mesh_instance.is_valid()) {
+		set_mesh_instance_visible(_mesh_instance, _visible && _parent_visible && !_clustered);
+	}
+}
+
 void VoxelMeshBlockVLT::set_shader_material(Ref<ShaderMaterial> material) {
 	_shader_material = material;
 
@@ -256,6 +275,12 @@ void VoxelMeshBlockVLT::set_shader_material(Ref<ShaderMaterial> material) {
 		const VoxelStringNames &sn = VoxelStringNames::get_singleton();
 		_shader_material->set_shader_parameter(sn.u_block_local_transform, local_transform);
 		_shader_material->set_shader_parameter(sn.u_voxel_virtual_texture_offset_scale, Vector4(0, 0, 0, 1));
+
+		// The material may have been used by another block, so these are written regardless of previous values
+		_shader_material->set_shader_parameter(sn.u_transition_mask, encode_transition_mask(_transition_mask));
+		_shader_material->set_shader_parameter(sn.u_lod_fade, _lod_fade);
+		_written_transition_mask = _transition_mask;
+		_written_lod_fade = _lod_fade;
 	}
 }
 
@@ -301,23 +326,7 @@ void VoxelMeshBlockVLT::set_transition_mask(uint8_t m) {
 		return;
 	}
 	_transition_mask = m;
-	if (_shader_material.is_valid()) {
-		// TODO Needs translation here, because Cube:: tables use slightly different order...
-		// We may get rid of this once cube tables respects -x+x-y+y-z+z order
-		uint8_t bits[Cube::SIDE_COUNT];
-		for (unsigned int dir = 0; dir < Cube::SIDE_COUNT; ++dir) {
-			bits[dir] = (m >> dir) & 1;
-		}
-		uint8_t tm = bits[Cube::SIDE_NEGATIVE_X];
-		tm |= bits[Cube::SIDE_POSITIVE_X] << 1;
-		tm |= bits[Cube::SIDE_NEGATIVE_Y] << 2;
-		tm |= bits[Cube::SIDE_POSITIVE_Y] << 3;
-		tm |= bits[Cube::SIDE_NEGATIVE_Z] << 4;
-		tm |= bits[Cube::SIDE_POSITIVE_Z] << 5;
-
-		// TODO Godot 4: we may replace this with a per-instance parameter so we can lift material access limitation
-		_shader_material->set_shader_parameter(VoxelStringNames::get_singleton().u_transition_mask, tm);
-	}
+	// The shader parameter is written in `flush_shader_params`
 	for (int dir = 0; dir < Cube::SIDE_COUNT; ++dir) {
 		DirectMeshInstance &mi = _transition_mesh_instances[dir];
 		if (mi.is_valid() && (diff & (1 << dir))) {
@@ -326,6 +335,27 @@ void VoxelMeshBlockVLT::set_transition_mask(uint8_t m) {
 	}
 }
 
+void VoxelMeshBlockVLT::flush_shader_params() {
+	shader_params_update_queued = false;
+
+	if (_shader_material.is_null()) {
+		return;
+	}
+
+	const VoxelStringNames &sn = VoxelStringNames::get_singleton();
+
+	if (_transition_mask != _written_transition_mask) {
+		// TODO Godot 4: we may replace this with a per-instance parameter so we can lift material access limitation
+		_shader_material->set_shader_parameter(sn.u_transition_mask, encode_transition_mask(_transition_mask));
+		_written_transition_mask = _transition_mask;
+	}
+
+	if (_lod_fade != _written_lod_fade) {
+		_shader_material->set_shader_parameter(sn.u_lod_fade, _lod_fade);
+		_written_lod_fade = _lod_fade;
+	}
+}
+
 void VoxelMeshBlockVLT::set_parent_visible(bool parent_visible) {
 	if (_parent_visible && parent_visible) {
 		return;
@@ -418,9 +448,8 @@ bool VoxelMeshBlockVLT::update_fading(float speed) {
 			break;
 	}
 
-	if (_shader_material.is_valid()) {
-		_shader_material->set_shader_parameter(VoxelStringNames::get_singleton().u_lod_fade, p);
-	}
+	// The shader parameter is written in `flush_shader_params`
+	_lod_fade = p;
 
 	return finished;
 }
@@ -428,9 +457,8 @@ bool VoxelMeshBlockVLT::update_fading(float speed) {
 void VoxelMeshBlockVLT::clear_fading() {
 	fading_state = FADING_NONE;
 	fading_progress = 0.f;
-	if (_shader_material.is_valid()) {
-		_shader_material->set_shader_parameter(VoxelStringNames::get_singleton().u_lod_fade, Vector2(0.0, 0.0));
-	}
+	// The shader parameter is written in `flush_shader_params`
+	_lod_fade = Vector2(0.0, 0.0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -473,7 +501,7 @@ Ref<ArrayMesh> build_mesh(
 
 		// TODO Use `add_surface`, it's about 20% faster after measuring in Tracy (though we may see if Godot 4 expects
 		// the same)
-		mesh->add_surface_from_arrays(primitive, arrays, Array(), Dictionary(), flags);
+		mesh->add_surface_from_arrays(primitive, arrays, Array(), surface.lods, flags);
 		mesh->surface_set_material(surface_index, material);
 		// No multi-material supported yet
 		++surface_index;
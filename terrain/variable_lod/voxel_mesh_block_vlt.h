@@ -2,6 +2,7 @@
 #define VOXEL_MESH_BLOCK_VLT_H
 
 #include "../../util/godot/classes/shader_material.h"
+#include "../../util/godot/direct_mesh_instance_pool.h"
 #include "../../util/memory/memory.h"
 #include "../../util/tasks/time_spread_task_runner.h"
 #include "../voxel_mesh_block.h"
@@ -36,8 +37,28 @@ public:
 	// 2 means using texture of grand-parent LOD (lod_index+2), etc.
 	uint8_t detail_texture_fallback_level = 0;
 
+	// True when the detail texture of this block was unloaded to save video memory. It will have to be computed again
+	// when the block becomes visible.
+	bool detail_texture_evicted = false;
+
 	uint64_t last_collider_update_time = 0;
+	// Collision update waiting for the collision update delay to elapse. Either the shape was already built by the
+	// meshing task, or it has to be built from mesher output.
 	UniquePtr<VoxelMesher::Output> deferred_collider_data;
+	Ref<Shape3D> deferred_collision_shape;
+	bool has_deferred_collision_shape = false;
+	uint32_t deferred_collision_size_in_bytes = 0;
+
+	// Shader parameters changing often are not written to the material immediately, because they can change several
+	// times in a frame. They are written once per frame by the terrain, when this is true.
+	bool shader_params_update_queued = false;
+
+	// Identifies the current mesh of the block, so clusters can tell when it changed. Unique within a terrain.
+	uint32_t mesh_revision = 0;
+	// Surfaces of the current mesh, kept only when the block can be merged into a cluster
+	StdVector<VoxelMesher::Output::Surface> cluster_surfaces;
+	Mesh::PrimitiveType cluster_primitive_type = Mesh::PRIMITIVE_TRIANGLES;
+	uint32_t cluster_mesh_flags = 0;
 
 	VoxelMeshBlockVLT(const Vector3i bpos, unsigned int size, unsigned int p_lod_index);
 	~VoxelMeshBlockVLT();
@@ -47,13 +68,40 @@ public:
 
 	// Visuals
 
+	inline bool has_deferred_collision_update() const {
+		return deferred_collider_data != nullptr || has_deferred_collision_shape;
+	}
+
+	inline void clear_deferred_collision_update() {
+		deferred_collider_data.reset();
+		deferred_collision_shape.unref();
+		has_deferred_collision_shape = false;
+	}
+
 	void set_visible(bool visible);
 	bool update_fading(float speed);
 	void clear_fading();
 
+	// Writes shader parameters that changed since the last call to the material of the block
+	void flush_shader_params();
+
 	void set_parent_visible(bool parent_visible);
 
+	// When clustered, the main mesh of the block is rendered by a cluster, so its own mesh instance is hidden
+	void set_clustered(bool clustered);
+	inline bool is_clustered() const {
+		return _clustered;
+	}
+
+	// Tells if the main mesh of the block can currently be rendered by a cluster
+	inline bool is_clusterable() const {
+		return cluster_surfaces.size() > 0 && _mesh_instance.is_valid() && _visible && _parent_visible &&
+				visual_active && fading_state == FADING_NONE && _transition_mask == 0;
+	}
+
+	// Mesh instances are taken from and returned to `mesh_instance_pool`
 	void set_mesh(
+			zylann::godot::DirectMeshInstancePool &mesh_instance_pool,
 			Ref<Mesh> mesh,
 			GeometryInstance3D::GIMode gi_mode,
 			RenderingServer::ShadowCastingSetting shadow_casting,
@@ -64,7 +112,7 @@ public:
 			RenderingServer::ShadowCastingSetting shadow_occluder_mode
 #endif
 	);
-	void drop_visuals();
+	void drop_visuals(zylann::godot::DirectMeshInstancePool &mesh_instance_pool);
 
 	void set_transition_mask(uint8_t m);
 	inline uint8_t get_transition_mask() const {
@@ -76,6 +124,7 @@ public:
 	void set_render_layers_mask(int mask);
 
 	void set_transition_mesh(
+			zylann::godot::DirectMeshInstancePool &mesh_instance_pool,
 			Ref<Mesh> mesh,
 			unsigned int side,
 			GeometryInstance3D::GIMode gi_mode,
@@ -128,6 +177,12 @@ private:
 	FixedArray<zylann::godot::DirectMeshInstance, Cube::SIDE_COUNT> _transition_mesh_instances;
 
 	uint8_t _transition_mask = 0;
+	bool _clustered = false;
+
+	Vector2 _lod_fade;
+	// Last values written to `_shader_material`
+	uint8_t _written_transition_mask = 0;
+	Vector2 _written_lod_fade;
 
 	// See VoxelMesherBlocky.
 	// This unfortunately has to be a whole separate mesh instance because Godot doesn't support setting
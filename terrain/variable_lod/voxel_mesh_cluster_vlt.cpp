@@ -0,0 +1,226 @@
+#include "voxel_mesh_cluster_vlt.h"
+#include "../../constants/voxel_constants.h"
+#include "../../engine/voxel_engine.h"
+#include "../../meshers/mesh_block_task.h"
+#include "../../util/godot/classes/mesh.h"
+#include "../../util/profiling.h"
+#include "../free_mesh_task.h"
+
+namespace zylann::voxel {
+
+VoxelMeshClusterVLT::~VoxelMeshClusterVLT() {
+	if (mesh_instance.is_valid()) {
+		// Same as mesh blocks, the material could get destroyed before the instance
+		mesh_instance.set_material_override(Ref<Material>());
+		FreeMeshTask::try_add_and_destroy(mesh_instance);
+	}
+}
+
+namespace {
+
+struct SurfaceRef {
+	const Array *arrays;
+	Vector3 offset;
+	int32_t first_vertex;
+};
+
+template <typename TPackedArray, typename F>
+TPackedArray concatenate_packed_arrays(Span<const SurfaceRef> surfaces, unsigned int array_index, F f) {
+	unsigned int total_size = 0;
+	for (const SurfaceRef &surface : surfaces) {
+		const TPackedArray src = (*surface.arrays)[array_index];
+		total_size += src.size();
+	}
+
+	TPackedArray dst;
+	dst.resize(total_size);
+	// Getting raw pointer because between GDExtension and modules, syntax and performance of operator[] differs.
+	auto *dst_data = dst.ptrw();
+
+	unsigned int dst_index = 0;
+	for (const SurfaceRef &surface : surfaces) {
+		const TPackedArray src = (*surface.arrays)[array_index];
+		const auto *src_data = src.ptr();
+		const unsigned int src_size = src.size();
+		for (unsigned int i = 0; i < src_size; ++i) {
+			dst_data[dst_index] = f(src_data[i], surface);
+			++dst_index;
+		}
+	}
+
+	return dst;
+}
+
+template <typename TPackedArray>
+inline TPackedArray concatenate_packed_arrays(Span<const SurfaceRef> surfaces, unsigned int array_index) {
+	return concatenate_packed_arrays<TPackedArray>(
+			surfaces, array_index, [](const auto &v, const SurfaceRef &) { return v; }
+	);
+}
+
+bool merge_surface_arrays(Span<const SurfaceRef> surfaces, Array &out_arrays) {
+	out_arrays.resize(Mesh::ARRAY_MAX);
+
+	for (unsigned int array_index = 0; array_index < Mesh::ARRAY_MAX; ++array_index) {
+		const Variant::Type type = (*surfaces[0].arrays)[array_index].get_type();
+
+		for (const SurfaceRef &surface : surfaces) {
+			if ((*surface.arrays)[array_index].get_type() != type) {
+				// Different vertex formats
+				return false;
+			}
+		}
+
+		Variant merged;
+
+		if (array_index == Mesh::ARRAY_VERTEX) {
+			ZN_ASSERT_RETURN_V(type == Variant::PACKED_VECTOR3_ARRAY, false);
+			merged = concatenate_packed_arrays<PackedVector3Array>(
+					surfaces,
+					array_index,
+					[](const Vector3 &v, const SurfaceRef &surface) { return v + surface.offset; }
+			);
+
+		} else if (array_index == Mesh::ARRAY_INDEX) {
+			ZN_ASSERT_RETURN_V(type == Variant::PACKED_INT32_ARRAY, false);
+			merged = concatenate_packed_arrays<PackedInt32Array>(
+					surfaces,
+					array_index,
+					[](const int32_t i, const SurfaceRef &surface) { return i + surface.first_vertex; }
+			);
+
+		} else {
+			switch (type) {
+				case Variant::NIL:
+					break;
+				case Variant::PACKED_BYTE_ARRAY:
+					merged = concatenate_packed_arrays<PackedByteArray>(surfaces, array_index);
+					break;
+				case Variant::PACKED_INT32_ARRAY:
+					merged = concatenate_packed_arrays<PackedInt32Array>(surfaces, array_index);
+					break;
+				case Variant::PACKED_FLOAT32_ARRAY:
+					merged = concatenate_packed_arrays<PackedFloat32Array>(surfaces, array_index);
+					break;
+				case Variant::PACKED_FLOAT64_ARRAY:
+					merged = concatenate_packed_arrays<PackedFloat64Array>(surfaces, array_index);
+					break;
+				case Variant::PACKED_VECTOR2_ARRAY:
+					merged = concatenate_packed_arrays<PackedVector2Array>(surfaces, array_index);
+					break;
+				case Variant::PACKED_VECTOR3_ARRAY:
+					merged = concatenate_packed_arrays<PackedVector3Array>(surfaces, array_index);
+					break;
+				case Variant::PACKED_COLOR_ARRAY:
+					merged = concatenate_packed_arrays<PackedColorArray>(surfaces, array_index);
+					break;
+				default:
+					return false;
+			}
+		}
+
+		out_arrays[array_index] = merged;
+	}
+
+	return true;
+}
+
+} // namespace
+
+bool merge_mesh_cluster_surfaces(
+		Span<const VoxelMeshClusterInput> inputs,
+		StdVector<VoxelMesher::Output::Surface> &out_surfaces
+) {
+	ZN_PROFILE_SCOPE();
+
+	out_surfaces.clear();
+
+	// Group surfaces by material. There are usually very few materials.
+	StdVector<uint16_t> material_indices;
+	StdVector<StdVector<SurfaceRef>> groups;
+
+	for (const VoxelMeshClusterInput &input : inputs) {
+		for (const VoxelMesher::Output::Surface &surface : input.surfaces) {
+			// Same filtering as `build_mesh`
+			if (surface.arrays.size() != Mesh::ARRAY_MAX || !zylann::godot::is_surface_triangulated(surface.arrays)) {
+				continue;
+			}
+
+			unsigned int group_index = 0;
+			for (; group_index < material_indices.size(); ++group_index) {
+				if (material_indices[group_index] == surface.material_index) {
+					break;
+				}
+			}
+			if (group_index == material_indices.size()) {
+				material_indices.push_back(surface.material_index);
+				groups.push_back(StdVector<SurfaceRef>());
+			}
+
+			StdVector<SurfaceRef> &group = groups[group_index];
+
+			int32_t first_vertex = 0;
+			if (group.size() > 0) {
+				const SurfaceRef &prev = group.back();
+				const PackedVector3Array prev_vertices = (*prev.arrays)[Mesh::ARRAY_VERTEX];
+				first_vertex = prev.first_vertex + prev_vertices.size();
+			}
+
+			group.push_back(SurfaceRef{ &surface.arrays, input.offset, first_vertex });
+		}
+	}
+
+	for (unsigned int group_index = 0; group_index < groups.size(); ++group_index) {
+		VoxelMesher::Output::Surface surface;
+		surface.material_index = material_indices[group_index];
+
+		if (!merge_surface_arrays(to_span(groups[group_index]), surface.arrays)) {
+			out_surfaces.clear();
+			return false;
+		}
+
+		out_surfaces.push_back(surface);
+	}
+
+	return true;
+}
+
+void BuildMeshClusterTask::run(ThreadedTaskContext &ctx) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(output != nullptr);
+	VoxelMeshClusterVLT::BuildOutput &o = *output;
+
+	o.success = merge_mesh_cluster_surfaces(to_span(inputs), o.surfaces);
+
+	// Drop references to mesh arrays of blocks as soon as possible, these blocks may have changed already
+	inputs.clear();
+
+	if (o.success) {
+		if (VoxelEngine::get_singleton().is_threaded_graphics_resource_building_enabled()) {
+			o.mesh = build_mesh(to_span(o.surfaces), o.primitive_type, o.mesh_flags, o.mesh_material_indices);
+			o.has_mesh_resource = true;
+			o.success = o.mesh.is_valid();
+			o.surfaces.clear();
+
+		} else {
+			o.has_staged_surfaces = stage_mesh_surfaces(
+					to_span(o.surfaces), o.primitive_type, o.mesh_flags, o.staged_surfaces, o.mesh_material_indices
+			);
+			if (o.has_staged_surfaces) {
+				o.success = o.staged_surfaces.size() > 0;
+				o.surfaces.clear();
+			}
+		}
+	}
+
+	o.complete = true;
+}
+
+TaskPriority BuildMeshClusterTask::get_priority() {
+	TaskPriority p;
+	p.band2 = constants::TASK_PRIORITY_MESH_CLUSTER_BAND2;
+	p.band3 = constants::TASK_PRIORITY_BAND3_DEFAULT;
+	return p;
+}
+
+} // namespace zylann::voxel
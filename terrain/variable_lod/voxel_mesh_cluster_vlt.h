@@ -0,0 +1,90 @@
+#ifndef VOXEL_MESH_CLUSTER_VLT_H
+#define VOXEL_MESH_CLUSTER_VLT_H
+
+#include "../../meshers/voxel_mesher.h"
+#include "../../util/containers/span.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/array_mesh.h"
+#include "../../util/godot/classes/shader_material.h"
+#include "../../util/godot/direct_mesh_instance.h"
+#include "../../util/tasks/threaded_task.h"
+#include <atomic>
+#include <memory>
+
+namespace zylann::voxel {
+
+// Far away from the viewer, mesh blocks of `VoxelLodTerrain` are small on screen and have few triangles, so rendering
+// them costs mostly in draw calls. A cluster merges the meshes of neighbor blocks of the same LOD into a single mesh
+// instance, while the mesh instances of those blocks are hidden.
+class VoxelMeshClusterVLT {
+public:
+	struct Member {
+		Vector3i block_position;
+		// Identifies the mesh the block had when it was merged
+		uint32_t mesh_revision;
+
+		inline bool operator==(const Member &other) const {
+			return block_position == other.block_position && mesh_revision == other.mesh_revision;
+		}
+	};
+
+	// Filled by `BuildMeshClusterTask`, then read on the main thread once `complete` is set.
+	struct BuildOutput {
+		StdVector<Member> members;
+		StdVector<VoxelMesher::Output::Surface> surfaces;
+		Mesh::PrimitiveType primitive_type = Mesh::PRIMITIVE_TRIANGLES;
+		uint32_t mesh_flags = 0;
+		// Same meaning as in `VoxelEngine::BlockMeshOutput`
+		Ref<Mesh> mesh;
+		StdVector<uint16_t> mesh_material_indices;
+		StdVector<zylann::godot::StagedMeshSurface> staged_surfaces;
+		bool has_mesh_resource = false;
+		bool has_staged_surfaces = false;
+		// False if meshes of members could not be merged
+		bool success = false;
+		std::atomic_bool complete = { false };
+	};
+
+	// Sorted by position. Empty if the cluster is not shown.
+	StdVector<Member> applied_members;
+	// Members of the last build that failed. The cluster will not be built again until they change.
+	StdVector<Member> failed_members;
+	std::shared_ptr<BuildOutput> pending_build;
+
+	zylann::godot::DirectMeshInstance mesh_instance;
+	Ref<ShaderMaterial> shader_material;
+	Vector3i origin_in_voxels;
+
+	~VoxelMeshClusterVLT();
+};
+
+// Meshes of one block to merge into a cluster
+struct VoxelMeshClusterInput {
+	StdVector<VoxelMesher::Output::Surface> surfaces;
+	// Position of the block relative to the origin of the cluster
+	Vector3 offset;
+};
+
+// Concatenates surfaces using the same material, moving their vertices by the offset of their block. LOD index buffers
+// are not kept. Returns false if surfaces can't be merged, for example if they have different vertex formats.
+bool merge_mesh_cluster_surfaces(
+		Span<const VoxelMeshClusterInput> inputs,
+		StdVector<VoxelMesher::Output::Surface> &out_surfaces
+);
+
+class BuildMeshClusterTask : public IThreadedTask {
+public:
+	StdVector<VoxelMeshClusterInput> inputs;
+	std::shared_ptr<VoxelMeshClusterVLT::BuildOutput> output;
+
+	const char *get_debug_name() const override {
+		return "BuildMeshCluster";
+	}
+
+	void run(ThreadedTaskContext &ctx) override;
+	TaskPriority get_priority() override;
+};
+
+} // namespace zylann::voxel
+
+#endif // VOXEL_MESH_CLUSTER_VLT_H
@@ -8,94 +8,74 @@ namespace zylann::voxel {
 
 VoxelAStarGrid3DInternal::VoxelAStarGrid3DInternal() : _voxel_buffer(VoxelBuffer::ALLOCATOR_POOL) {}
 
-void VoxelAStarGrid3DInternal::init_cache() {
-	_grid_cache_size = math::ceildiv(get_region().size, Chunk::SIZE);
-	_grid_cache.resize(_grid_cache_size.x * _grid_cache_size.y * _grid_cache_size.z);
-	_grid_chunk_states.resize_no_init(_grid_cache.size());
-	_grid_chunk_states.fill(false);
-	_voxel_buffer.create(Vector3iUtil::create(Chunk::SIZE));
-
-	// const Box3i region = get_region();
-	// for (int y = region.pos.y; y < region.pos.y + region.size.y; ++y) {
-	// 	println(format("Y={}", y));
-	// 	for (int z = region.pos.z; z < region.pos.z + region.size.z; ++z) {
-	// 		std::string s;
-	// 		for (int x = region.pos.x; x < region.pos.x + region.size.x; ++x) {
-	// 			if (is_solid(Vector3i(x, y, z))) {
-	// 				s += " O";
-	// 			} else {
-	// 				s += " -";
-	// 			}
-	// 		}
-	// 		println(s);
-	// 	}
-	// }
-}
-
-bool VoxelAStarGrid3DInternal::is_solid(Vector3i pos) {
-	// TODO We could align the cache with the voxel chunk grid to avoid more expensive copies across chunk borders
-	const Vector3i gpos = pos - get_region().position;
-	const Vector3i cpos = gpos >> Chunk::SIZE_PO2;
-	const Vector3i rpos = gpos & Chunk::SIZE_MASK;
-
-	const unsigned int chunk_loc = Vector3iUtil::get_zxy_index(cpos, _grid_cache_size);
-	Chunk chunk;
-
-	if (_grid_chunk_states.get(chunk_loc)) {
-		chunk = _grid_cache[chunk_loc];
-
-	} else {
-		ZN_PROFILE_SCOPE_NAMED("Caching voxels");
-		ZN_ASSERT(data != nullptr);
-
-		const VoxelBuffer::ChannelId channel_index = VoxelBuffer::CHANNEL_TYPE;
-		const Vector3i copy_origin = (cpos << Chunk::SIZE_PO2) + get_region().position;
-		data->copy(copy_origin, _voxel_buffer, 1 << channel_index);
-
-		if (_voxel_buffer.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_UNIFORM) {
-			if (_voxel_buffer.get_voxel(0, 0, 0, channel_index) != 0) {
-				chunk.solid_bits = 0xffffffffffffffff;
-			} else {
-				chunk.solid_bits = 0;
-			}
+namespace {
 
-		} else {
-			chunk.solid_bits = 0;
-
-			switch (_voxel_buffer.get_channel_depth(channel_index)) {
-				case VoxelBuffer::DEPTH_8_BIT: {
-					Span<const uint8_t> values;
-					ZN_ASSERT(_voxel_buffer.get_channel_data(channel_index, values));
-					uint64_t i = 0;
-					// Assuming ZXY loop order
-					for (const uint8_t v : values) {
-						chunk.solid_bits |= (v == 0 ? uint64_t(0) : (uint64_t(1) << i));
-						++i;
-					}
-				} break;
-
-				case VoxelBuffer::DEPTH_16_BIT: {
-					Span<const uint16_t> values;
-					ZN_ASSERT(_voxel_buffer.get_channel_data(channel_index, values));
-					uint64_t i = 0;
-					for (const uint16_t v : values) {
-						chunk.solid_bits |= (v == 0 ? uint64_t(0) : (uint64_t(1) << i));
-						++i;
-					}
-				} break;
-
-				default:
-					ZN_PRINT_ERROR("Unhandled channel depth");
-					break;
+template <typename T>
+void pack_solid_bits(Span<const T> values, Span<uint64_t> out_chunks, int page_size, int chunk_size_po2) {
+	const int chunk_size_mask = (1 << chunk_size_po2) - 1;
+	const int chunks_per_page_po2 = math::get_shift_from_power_of_two_32(page_size) - chunk_size_po2;
+
+	unsigned int i = 0;
+	// Assuming ZXY loop order
+	Vector3i pos;
+	for (pos.z = 0; pos.z < page_size; ++pos.z) {
+		for (pos.x = 0; pos.x < page_size; ++pos.x) {
+			for (pos.y = 0; pos.y < page_size; ++pos.y, ++i) {
+				if (values[i] == 0) {
+					continue;
+				}
+				const Vector3i cpos = pos >> chunk_size_po2;
+				const Vector3i rpos = pos & chunk_size_mask;
+				const unsigned int chunk_index =
+						cpos.y + (cpos.x << chunks_per_page_po2) + (cpos.z << (2 * chunks_per_page_po2));
+				const unsigned int bit_index = rpos.y + (rpos.x << chunk_size_po2) + (rpos.z << (2 * chunk_size_po2));
+				out_chunks[chunk_index] |= uint64_t(1) << bit_index;
 			}
+		}
+	}
+}
+
+} // namespace
 
-			_grid_chunk_states.set(chunk_loc);
+void VoxelAStarGrid3DInternal::load_solid_chunks(Vector3i origin, Span<uint64_t> out_chunks) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT(data != nullptr);
+
+	const VoxelBuffer::ChannelId channel_index = VoxelBuffer::CHANNEL_TYPE;
+	if (_voxel_buffer.get_size() != Vector3iUtil::create(SOLID_PAGE_SIZE)) {
+		_voxel_buffer.create(Vector3iUtil::create(SOLID_PAGE_SIZE));
+	}
+	data->copy(origin, _voxel_buffer, 1 << channel_index);
+
+	if (_voxel_buffer.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_UNIFORM) {
+		const uint64_t bits = _voxel_buffer.get_voxel(0, 0, 0, channel_index) != 0 ? 0xffffffffffffffff : 0;
+		for (uint64_t &chunk : out_chunks) {
+			chunk = bits;
 		}
+		return;
+	}
 
-		_grid_cache[chunk_loc] = chunk;
+	for (uint64_t &chunk : out_chunks) {
+		chunk = 0;
 	}
 
-	return chunk.get_solid_bit(rpos);
+	switch (_voxel_buffer.get_channel_depth(channel_index)) {
+		case VoxelBuffer::DEPTH_8_BIT: {
+			Span<const uint8_t> values;
+			ZN_ASSERT(_voxel_buffer.get_channel_data(channel_index, values));
+			pack_solid_bits(values, out_chunks, SOLID_PAGE_SIZE, SOLID_CHUNK_SIZE_PO2);
+		} break;
+
+		case VoxelBuffer::DEPTH_16_BIT: {
+			Span<const uint16_t> values;
+			ZN_ASSERT(_voxel_buffer.get_channel_data(channel_index, values));
+			pack_solid_bits(values, out_chunks, SOLID_PAGE_SIZE, SOLID_CHUNK_SIZE_PO2);
+		} break;
+
+		default:
+			ZN_PRINT_ERROR("Unhandled channel depth");
+			break;
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -105,6 +85,8 @@ void VoxelAStarGrid3D::set_terrain(VoxelTerrain *node) {
 	// Can't modify the pathfinder while it is running in a different thread
 	ZN_ASSERT_RETURN(_is_running_async == false);
 	_path_finder.data = node->get_storage_shared();
+	_path_finder.clear_solid_cache();
+	_clusters.clear();
 }
 
 TypedArray<Vector3i> VoxelAStarGrid3D::find_path(Vector3i from_position, Vector3i to_position) {
@@ -142,8 +124,14 @@ TypedArray<Vector3i> to_typed_array(Span<const Vector3i> items) {
 } // namespace
 
 TypedArray<Vector3i> VoxelAStarGrid3D::find_path_internal(Vector3i from_position, Vector3i to_position) {
+	if (_hierarchical_enabled) {
+		_clusters.find_path(_path_finder, from_position, to_position, _path);
+		return to_typed_array(to_span(_path));
+	}
+
+	// Voxels may have changed since the last query
+	_path_finder.clear_solid_cache();
 	_path_finder.start(from_position, to_position);
-	_path_finder.init_cache();
 
 	while (_path_finder.is_running()) {
 		_path_finder.step();
@@ -156,6 +144,7 @@ TypedArray<Vector3i> VoxelAStarGrid3D::find_path_internal(Vector3i from_position
 void VoxelAStarGrid3D::set_region(Box3i region) {
 	ZN_ASSERT_RETURN(_is_running_async == false);
 	_path_finder.set_region(region);
+	_clusters.clear();
 }
 
 Box3i VoxelAStarGrid3D::get_region() {
@@ -200,6 +189,24 @@ bool VoxelAStarGrid3D::is_running_async() const {
 	return _is_running_async;
 }
 
+void VoxelAStarGrid3D::set_hierarchical_enabled(bool enabled) {
+	ZN_ASSERT_RETURN(_is_running_async == false);
+	_hierarchical_enabled = enabled;
+	if (!enabled) {
+		_clusters.clear();
+	}
+}
+
+bool VoxelAStarGrid3D::is_hierarchical_enabled() const {
+	return _hierarchical_enabled;
+}
+
+void VoxelAStarGrid3D::invalidate_area(Box3i box) {
+	ZN_ASSERT_RETURN(_is_running_async == false);
+	_path_finder.invalidate_solid_cache(box);
+	_clusters.invalidate_area(_path_finder, box);
+}
+
 TypedArray<Vector3i> VoxelAStarGrid3D::debug_get_visited_positions() const {
 	ZN_ASSERT_RETURN_V(_is_running_async == false, TypedArray<Vector3i>());
 	StdVector<Vector3i> positions;
@@ -216,6 +223,12 @@ AABB VoxelAStarGrid3D::_b_get_region() {
 	return AABB(to_vec3(region.position), to_vec3(region.size));
 }
 
+void VoxelAStarGrid3D::_b_invalidate_area(AABB aabb) {
+	invalidate_area(
+			Box3i::from_min_max(math::floor_to_int(aabb.position), math::ceil_to_int(aabb.position + aabb.size))
+	);
+}
+
 // Intermediate method to enforce the signal to be emitted on the main thread
 void VoxelAStarGrid3D::_b_on_async_search_completed(TypedArray<Vector3i> path) {
 	_is_running_async = false;
@@ -233,6 +246,10 @@ void VoxelAStarGrid3D::_bind_methods() {
 			D_METHOD("find_path_async", "from_position", "to_position"), &VoxelAStarGrid3D::find_path_async);
 	ClassDB::bind_method(D_METHOD("is_running_async"), &VoxelAStarGrid3D::is_running_async);
 
+	ClassDB::bind_method(D_METHOD("set_hierarchical_enabled", "enabled"), &VoxelAStarGrid3D::set_hierarchical_enabled);
+	ClassDB::bind_method(D_METHOD("is_hierarchical_enabled"), &VoxelAStarGrid3D::is_hierarchical_enabled);
+	ClassDB::bind_method(D_METHOD("invalidate_area", "box"), &VoxelAStarGrid3D::_b_invalidate_area);
+
 	ClassDB::bind_method(D_METHOD("debug_get_visited_positions"), &VoxelAStarGrid3D::debug_get_visited_positions);
 
 	// Internal
@@ -4,7 +4,7 @@
 #include "../storage/voxel_buffer.h"
 #include "../storage/voxel_data.h"
 #include "../util/a_star_grid_3d.h"
-#include "../util/containers/dynamic_bitset.h"
+#include "../util/a_star_grid_3d_clusters.h"
 #include "../util/containers/std_vector.h"
 #include <atomic>
 
@@ -21,38 +21,12 @@ public:
 	// any time.
 	std::shared_ptr<VoxelData> data;
 
-	void init_cache();
-
 protected:
-	bool is_solid(Vector3i pos) override;
+	void load_solid_chunks(Vector3i origin, Span<uint64_t> out_chunks) override;
 
 private:
-	// We store a cache of solid bits for the whole pathfindable region.
-	// To minimize multithreaded access to the main voxel data, we only load chunks of bits as they are needed.
-
-	struct Chunk {
-		static const int SIZE_PO2 = 2;
-		static const int SIZE = 1 << SIZE_PO2;
-		static const int SIZE_MASK = SIZE - 1;
-
-		// 4x4x4 bits in ZXY order
-		uint64_t solid_bits = 0;
-
-		inline bool get_solid_bit(Vector3i rel) const {
-			const uint64_t i = Vector3iUtil::get_zxy_index(rel, Vector3i(SIZE, SIZE, SIZE));
-			// const unsigned int i = rel.y + (rel.x << 2) + (rel.z << 4);
-			return ((solid_bits >> i) & uint64_t(1)) != 0;
-		}
-	};
-
-	// Cached 3D bitmap
-	StdVector<Chunk> _grid_cache;
-	Vector3i _grid_cache_size;
-
-	// Tracks which chunks are loaded
-	DynamicBitset _grid_chunk_states;
-
-	// Temporary buffer used to read voxels from the main voxel storage
+	// Temporary buffer used to read voxels from the main voxel storage. Pages of the solid cache are read at once, to
+	// minimize multithreaded access to the main voxel data.
 	VoxelBuffer _voxel_buffer;
 };
 
@@ -61,7 +35,7 @@ class VoxelAStarGrid3D : public RefCounted {
 	GDCLASS(VoxelAStarGrid3D, RefCounted)
 public:
 	// Bare bones at the moment. May need more configurations and customization.
-	// Also, it does not cache data between queries.
+	// It does not cache data between queries, unless hierarchical search is enabled.
 
 	void set_terrain(VoxelTerrain *node);
 
@@ -73,6 +47,13 @@ public:
 	void find_path_async(Vector3i from_position, Vector3i to_position);
 	bool is_running_async() const;
 
+	// Finds long paths faster by reusing data cached between queries. Paths may not be the shortest.
+	void set_hierarchical_enabled(bool enabled);
+	bool is_hierarchical_enabled() const;
+
+	// Must be called when voxels are modified, if hierarchical search is enabled.
+	void invalidate_area(Box3i box);
+
 	TypedArray<Vector3i> debug_get_visited_positions() const;
 
 private:
@@ -83,11 +64,15 @@ private:
 
 	void _b_set_region(AABB aabb);
 	AABB _b_get_region();
+	void _b_invalidate_area(AABB aabb);
 	void _b_on_async_search_completed(TypedArray<Vector3i> path);
 
 	static void _bind_methods();
 
 	VoxelAStarGrid3DInternal _path_finder;
+	AStarGrid3DClusters _clusters;
+	bool _hierarchical_enabled = false;
+	StdVector<Vector3i> _path;
 	std::atomic_bool _is_running_async = { false };
 };
 
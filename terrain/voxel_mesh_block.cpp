@@ -169,6 +169,13 @@ bool VoxelMeshBlock::has_collision_shape() const {
 	return _static_body.is_valid();
 }
 
+Ref<Shape3D> VoxelMeshBlock::get_collision_shape() {
+	if (_static_body.is_valid()) {
+		return _static_body.get_shape(0);
+	}
+	return Ref<Shape3D>();
+}
+
 void VoxelMeshBlock::set_collision_layer(int layer) {
 	if (_static_body.is_valid()) {
 		_static_body.set_collision_layer(layer);
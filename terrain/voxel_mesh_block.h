@@ -25,6 +25,11 @@ class VoxelMeshBlock : public NonCopyable {
 public:
 	Vector3i position; // In blocks
 
+	// Approximate memory used by the current mesh and collision shape, for memory reports. Only relevant while the
+	// block has them.
+	uint32_t mesh_size_in_bytes = 0;
+	uint32_t collision_size_in_bytes = 0;
+
 protected:
 	VoxelMeshBlock(Vector3i bpos);
 
@@ -63,6 +68,7 @@ public:
 
 	void set_collision_shape(Ref<Shape3D> shape, bool debug_collision, Node3D *node, float margin);
 	bool has_collision_shape() const;
+	Ref<Shape3D> get_collision_shape();
 	void set_collision_layer(int layer);
 	void set_collision_mask(int mask);
 	void set_collision_margin(float margin);
@@ -1,5 +1,6 @@
 #include "voxel_node.h"
 #include "../edition/voxel_tool.h"
+#include "../engine/voxel_engine.h"
 #include "../generators/voxel_generator.h"
 #include "../meshers/blocky/voxel_mesher_blocky.h"
 #include "../meshers/voxel_mesher.h"
@@ -54,6 +55,50 @@ VolumeID VoxelNode::get_volume_id() const {
 	return VolumeID();
 }
 
+void VoxelNode::set_task_weight(int weight) {
+	_task_weight = math::clamp(weight, 1, 100);
+	update_task_settings();
+}
+
+int VoxelNode::get_task_weight() const {
+	return _task_weight;
+}
+
+void VoxelNode::set_task_min_threads(int count) {
+	_task_min_threads = math::clamp(count, 0, static_cast<int>(ThreadedTaskRunner::MAX_THREADS));
+	update_task_settings();
+}
+
+int VoxelNode::get_task_min_threads() const {
+	return _task_min_threads;
+}
+
+void VoxelNode::set_task_max_running(int count) {
+	_task_max_running = math::clamp(count, 0, static_cast<int>(ThreadedTaskRunner::MAX_THREADS));
+	update_task_settings();
+}
+
+int VoxelNode::get_task_max_running() const {
+	return _task_max_running;
+}
+
+void VoxelNode::update_task_settings() {
+	ThreadedTaskRunner::GroupSettings settings;
+	settings.weight = _task_weight;
+	settings.min_threads = _task_min_threads;
+	settings.max_running = _task_max_running;
+	VoxelEngine::get_singleton().set_volume_task_settings(get_volume_id(), settings);
+}
+
+Dictionary VoxelNode::get_task_stats() const {
+	const ThreadedTaskRunner::GroupStats stats = VoxelEngine::get_singleton().get_volume_task_stats(get_volume_id());
+	Dictionary d;
+	d["pending"] = stats.pending;
+	d["running"] = stats.running;
+	d["completed"] = stats.completed;
+	return d;
+}
+
 std::shared_ptr<StreamingDependency> VoxelNode::get_streaming_dependency() const {
 	ZN_PRINT_ERROR("Not implemented");
 	// Implemented in subclasses
@@ -235,6 +280,17 @@ void VoxelNode::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_render_layers_mask", "mask"), &VoxelNode::set_render_layers_mask);
 	ClassDB::bind_method(D_METHOD("get_render_layers_mask"), &VoxelNode::get_render_layers_mask);
 
+	ClassDB::bind_method(D_METHOD("set_task_weight", "weight"), &VoxelNode::set_task_weight);
+	ClassDB::bind_method(D_METHOD("get_task_weight"), &VoxelNode::get_task_weight);
+
+	ClassDB::bind_method(D_METHOD("set_task_min_threads", "count"), &VoxelNode::set_task_min_threads);
+	ClassDB::bind_method(D_METHOD("get_task_min_threads"), &VoxelNode::get_task_min_threads);
+
+	ClassDB::bind_method(D_METHOD("set_task_max_running", "count"), &VoxelNode::set_task_max_running);
+	ClassDB::bind_method(D_METHOD("get_task_max_running"), &VoxelNode::get_task_max_running);
+
+	ClassDB::bind_method(D_METHOD("get_task_stats"), &VoxelNode::get_task_stats);
+
 	ADD_PROPERTY(
 			PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, VoxelStream::get_class_static()),
 			"set_stream",
@@ -265,6 +321,24 @@ void VoxelNode::_bind_methods() {
 			"set_render_layers_mask",
 			"get_render_layers_mask"
 	);
+
+	ADD_GROUP("Tasks", "task_");
+
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "task_weight", PROPERTY_HINT_RANGE, "1,100"),
+			"set_task_weight",
+			"get_task_weight"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "task_min_threads", PROPERTY_HINT_RANGE, "0,16"),
+			"set_task_min_threads",
+			"get_task_min_threads"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::INT, "task_max_running", PROPERTY_HINT_RANGE, "0,16"),
+			"set_task_max_running",
+			"get_task_max_running"
+	);
 }
 
 } // namespace zylann::voxel
@@ -42,6 +42,20 @@ public:
 	virtual void remesh_all_blocks();
 
 	virtual VolumeID get_volume_id() const;
+
+	// Share of threads tasks of this volume get, relative to other volumes
+	void set_task_weight(int weight);
+	int get_task_weight() const;
+
+	// Threads this volume can use before other volumes, when it has tasks
+	void set_task_min_threads(int count);
+	int get_task_min_threads() const;
+
+	// How many tasks of this volume can run at once. 0 means no limit.
+	void set_task_max_running(int count);
+	int get_task_max_running() const;
+
+	Dictionary get_task_stats() const;
 	virtual std::shared_ptr<StreamingDependency> get_streaming_dependency() const;
 
 	virtual Ref<VoxelTool> get_voxel_tool();
@@ -62,6 +76,8 @@ protected:
 	virtual void _on_shadow_casting_changed() {}
 	virtual void _on_render_layers_mask_changed() {}
 
+	void update_task_settings();
+
 private:
 	Ref<VoxelMesher> _b_get_mesher() {
 		return get_mesher();
@@ -89,6 +105,9 @@ private:
 	GeometryInstance3D::GIMode _gi_mode = GeometryInstance3D::GI_MODE_DISABLED;
 	GeometryInstance3D::ShadowCastingSetting _shadow_casting = GeometryInstance3D::SHADOW_CASTING_SETTING_ON;
 	int _render_layers_mask = 1;
+	uint32_t _task_weight = 1;
+	uint32_t _task_min_threads = 0;
+	uint32_t _task_max_running = 0;
 };
 
 } // namespace zylann::voxel
@@ -77,6 +77,54 @@ int VoxelViewer::get_network_peer_id() const {
 	return _network_peer_id;
 }
 
+void VoxelViewer::set_prediction_time(float seconds) {
+	_prediction_time = math::max(seconds, 0.f);
+	if (is_active()) {
+		VoxelEngine::get_singleton().set_viewer_prediction_time(_viewer_id, _prediction_time);
+	}
+}
+
+float VoxelViewer::get_prediction_time() const {
+	return _prediction_time;
+}
+
+void VoxelViewer::set_velocity_estimation_enabled(bool enabled) {
+	_velocity_estimation_enabled = enabled;
+	if (is_active()) {
+		VoxelEngine::get_singleton().set_viewer_velocity_estimation_enabled(_viewer_id, enabled);
+		if (!enabled) {
+			VoxelEngine::get_singleton().set_viewer_velocity(_viewer_id, _velocity);
+		}
+	}
+}
+
+bool VoxelViewer::is_velocity_estimation_enabled() const {
+	return _velocity_estimation_enabled;
+}
+
+void VoxelViewer::set_velocity(Vector3 velocity) {
+	_velocity = velocity;
+	if (is_active() && !_velocity_estimation_enabled) {
+		VoxelEngine::get_singleton().set_viewer_velocity(_viewer_id, velocity);
+	}
+}
+
+Vector3 VoxelViewer::get_velocity() const {
+	return _velocity;
+}
+
+void VoxelViewer::set_view_cone_angle(float degrees) {
+	_view_cone_angle = math::clamp(degrees, 0.f, 180.f);
+	if (is_active()) {
+		VoxelEngine::get_singleton().set_viewer_view_cone_half_angle(_viewer_id, math::deg_to_rad(_view_cone_angle));
+		sync_transform();
+	}
+}
+
+float VoxelViewer::get_view_cone_angle() const {
+	return _view_cone_angle;
+}
+
 void VoxelViewer::set_enabled_in_editor(bool enable) {
 	if (_enabled_in_editor == enable) {
 		return;
@@ -127,8 +175,25 @@ void VoxelViewer::sync_all_parameters() {
 	VoxelEngine::get_singleton().set_viewer_requires_data_block_notifications(
 			_viewer_id, _requires_data_block_notifications);
 	VoxelEngine::get_singleton().set_viewer_network_peer_id(_viewer_id, _network_peer_id);
-	const Vector3 pos = get_global_transform().origin;
-	VoxelEngine::get_singleton().set_viewer_position(_viewer_id, pos);
+	VoxelEngine::get_singleton().set_viewer_prediction_time(_viewer_id, _prediction_time);
+	VoxelEngine::get_singleton().set_viewer_velocity_estimation_enabled(_viewer_id, _velocity_estimation_enabled);
+	if (!_velocity_estimation_enabled) {
+		VoxelEngine::get_singleton().set_viewer_velocity(_viewer_id, _velocity);
+	}
+	VoxelEngine::get_singleton().set_viewer_view_cone_half_angle(_viewer_id, math::deg_to_rad(_view_cone_angle));
+	sync_transform();
+}
+
+void VoxelViewer::sync_transform() {
+	const Transform3D transform = get_global_transform();
+	VoxelEngine::get_singleton().set_viewer_position(_viewer_id, transform.origin);
+	if (_view_cone_angle > 0.f) {
+		// Same convention as cameras, which look towards -Z
+		const Vector3 forward = -transform.basis.get_column(Vector3::AXIS_Z);
+		if (!forward.is_zero_approx()) {
+			VoxelEngine::get_singleton().set_viewer_view_direction(_viewer_id, forward);
+		}
+	}
 }
 
 void VoxelViewer::_notification(int p_what) {
@@ -153,8 +218,7 @@ void VoxelViewer::_notification(int p_what) {
 
 		case NOTIFICATION_TRANSFORM_CHANGED:
 			if (is_active()) {
-				const Vector3 pos = get_global_transform().origin;
-				VoxelEngine::get_singleton().set_viewer_position(_viewer_id, pos);
+				sync_transform();
 			}
 			break;
 
@@ -189,6 +253,20 @@ void VoxelViewer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_network_peer_id", "id"), &VoxelViewer::set_network_peer_id);
 	ClassDB::bind_method(D_METHOD("get_network_peer_id"), &VoxelViewer::get_network_peer_id);
 
+	ClassDB::bind_method(D_METHOD("set_prediction_time", "seconds"), &VoxelViewer::set_prediction_time);
+	ClassDB::bind_method(D_METHOD("get_prediction_time"), &VoxelViewer::get_prediction_time);
+
+	ClassDB::bind_method(
+			D_METHOD("set_velocity_estimation_enabled", "enabled"), &VoxelViewer::set_velocity_estimation_enabled
+	);
+	ClassDB::bind_method(D_METHOD("is_velocity_estimation_enabled"), &VoxelViewer::is_velocity_estimation_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_velocity", "velocity"), &VoxelViewer::set_velocity);
+	ClassDB::bind_method(D_METHOD("get_velocity"), &VoxelViewer::get_velocity);
+
+	ClassDB::bind_method(D_METHOD("set_view_cone_angle", "degrees"), &VoxelViewer::set_view_cone_angle);
+	ClassDB::bind_method(D_METHOD("get_view_cone_angle"), &VoxelViewer::get_view_cone_angle);
+
 	ClassDB::bind_method(D_METHOD("set_enabled_in_editor", "enabled"), &VoxelViewer::set_enabled_in_editor);
 	ClassDB::bind_method(D_METHOD("is_enabled_in_editor"), &VoxelViewer::is_enabled_in_editor);
 
@@ -201,6 +279,22 @@ void VoxelViewer::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "requires_data_block_notifications"),
 			"set_requires_data_block_notifications", "is_requiring_data_block_notifications");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "enabled_in_editor"), "set_enabled_in_editor", "is_enabled_in_editor");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "prediction_time", PROPERTY_HINT_RANGE, "0.0,10.0,0.01,or_greater"),
+			"set_prediction_time",
+			"get_prediction_time"
+	);
+	ADD_PROPERTY(
+			PropertyInfo(Variant::BOOL, "velocity_estimation_enabled"),
+			"set_velocity_estimation_enabled",
+			"is_velocity_estimation_enabled"
+	);
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "velocity"), "set_velocity", "get_velocity");
+	ADD_PROPERTY(
+			PropertyInfo(Variant::FLOAT, "view_cone_angle", PROPERTY_HINT_RANGE, "0.0,180.0,0.1"),
+			"set_view_cone_angle",
+			"get_view_cone_angle"
+	);
 }
 
 } // namespace zylann::voxel
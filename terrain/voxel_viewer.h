@@ -36,6 +36,21 @@ public:
 	void set_network_peer_id(int id);
 	int get_network_peer_id() const;
 
+	// Seconds ahead along the viewer's motion in which blocks start loading. 0 disables it.
+	void set_prediction_time(float seconds);
+	float get_prediction_time() const;
+
+	void set_velocity_estimation_enabled(bool enabled);
+	bool is_velocity_estimation_enabled() const;
+
+	// Used for prediction when velocity estimation is disabled
+	void set_velocity(Vector3 velocity);
+	Vector3 get_velocity() const;
+
+	// Angle in degrees around the forward direction of the viewer, in which blocks are prioritized. 0 disables it.
+	void set_view_cone_angle(float degrees);
+	float get_view_cone_angle() const;
+
 	void set_enabled_in_editor(bool enable);
 	bool is_enabled_in_editor() const;
 
@@ -47,12 +62,17 @@ private:
 
 	void sync_all_parameters();
 	void sync_view_distances();
+	void sync_transform();
 
 	bool is_active() const;
 
 	ViewerID _viewer_id;
 	unsigned int _view_distance = 128;
 	float _view_distance_vertical_ratio = 1.f;
+	float _prediction_time = 0.f;
+	Vector3 _velocity;
+	float _view_cone_angle = 0.f;
+	bool _velocity_estimation_enabled = true;
 	bool _requires_visuals = true;
 	bool _requires_collisions = true;
 	bool _requires_data_block_notifications = false;
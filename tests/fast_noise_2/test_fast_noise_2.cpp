@@ -2,7 +2,9 @@
 #include "../../util/godot/classes/image.h"
 #include "../../util/io/log.h"
 #include "../../util/noise/fast_noise_2.h"
+#include "../../util/containers/std_vector.h"
 #include "../../util/string/format.h"
+#include "../testing.h"
 
 namespace zylann::tests {
 
@@ -26,4 +28,42 @@ void test_fast_noise_2_empty_encoded_node_tree() {
 	noise->update_generator();
 }
 
+void test_fast_noise_2_series_as_grid() {
+	Ref<FastNoise2> noise;
+	noise.instantiate();
+
+	// Positions laid out like a slice of block generated by VoxelGeneratorGraph at LOD 1
+	const int size = 16;
+	const int stride = 2;
+	StdVector<float> x;
+	StdVector<float> y;
+	StdVector<float> z;
+	for (int rz = 0; rz < size; ++rz) {
+		for (int rx = 0; rx < size; ++rx) {
+			x.push_back(-64 + rx * stride);
+			y.push_back(10 * stride);
+			z.push_back(32 + rz * stride);
+		}
+	}
+
+	StdVector<float> expected;
+	expected.resize(x.size());
+	StdVector<float> actual;
+	actual.resize(x.size());
+
+	noise->get_noise_3d_series(to_span(x), to_span(y), to_span(z), to_span(expected));
+	ZN_TEST_ASSERT(noise->try_get_noise_3d_series_as_grid(to_span(x), to_span(y), to_span(z), to_span(actual)));
+	ZN_TEST_ASSERT(expected == actual);
+
+	noise->get_noise_2d_series(to_span(x), to_span(z), to_span(expected));
+	ZN_TEST_ASSERT(noise->try_get_noise_2d_series_as_grid(to_span(x), to_span(z), to_span(actual)));
+	ZN_TEST_ASSERT(expected == actual);
+
+	// Not a grid FastNoise2 can generate, because coordinates are not multiples of the spacing
+	for (float &v : x) {
+		v += 0.5f;
+	}
+	ZN_TEST_ASSERT(!noise->try_get_noise_3d_series_as_grid(to_span(x), to_span(y), to_span(z), to_span(actual)));
+}
+
 } // namespace zylann::tests
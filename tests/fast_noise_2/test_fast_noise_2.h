@@ -5,6 +5,7 @@ namespace zylann::tests {
 
 void test_fast_noise_2_basic();
 void test_fast_noise_2_empty_encoded_node_tree();
+void test_fast_noise_2_series_as_grid();
 
 } // namespace zylann::tests
 
@@ -2,31 +2,54 @@
 #include "../util/profiling.h"
 #include "testing.h"
 
+#include "util/test_a_star_grid_3d.h"
 #include "util/test_box3i.h"
+#include "util/test_byte_budget_lru_map.h"
 #include "util/test_container_funcs.h"
+#include "util/test_dynamic_aabb_tree.h"
 #include "util/test_expression_parser.h"
+#include "util/test_file_locker.h"
 #include "util/test_flat_map.h"
 #include "util/test_island_finder.h"
+#include "util/test_latency_histogram.h"
+#include "util/test_light_profiler.h"
 #include "util/test_math_funcs.h"
+#include "util/test_mpsc_batch_queue.h"
 #include "util/test_slot_map.h"
+#include "util/test_spatial_hash_map.h"
 #include "util/test_spatial_lock.h"
 #include "util/test_string_funcs.h"
+#include "util/test_task_graph.h"
 #include "util/test_threaded_task_runner.h"
 
+#include "voxel/test_block_lifecycle_trace.h"
+#include "voxel/test_blocky_light.h"
+#include "voxel/test_blocky_simulation.h"
 #include "voxel/test_block_serializer.h"
 #include "voxel/test_curve_range.h"
 #include "voxel/test_detail_rendering_gpu.h"
 #include "voxel/test_edition_funcs.h"
+#include "voxel/test_mesh_quick_reloading_cache.h"
 #include "voxel/test_mesh_sdf.h"
 #include "voxel/test_octree.h"
+#include "voxel/test_priority_dependency.h"
 #include "voxel/test_region_file.h"
+#include "voxel/test_save_block_queue.h"
 #include "voxel/test_storage_funcs.h"
+#include "voxel/test_stream_log.h"
 #include "voxel/test_stream_sqlite.h"
 #include "voxel/test_voxel_buffer.h"
 #include "voxel/test_voxel_data_map.h"
 #include "voxel/test_voxel_graph.h"
 #include "voxel/test_voxel_instancer.h"
+#include "voxel/test_voxel_mesher_blocky.h"
 #include "voxel/test_voxel_mesher_cubes.h"
+#include "voxel/test_voxel_mesher_transvoxel.h"
+#include "voxel/test_voxel_pre_generation_job.h"
+#include "voxel/test_voxel_stream_cache.h"
+#include "voxel/test_voxel_stream_copy_job.h"
+#include "voxel/test_voxel_stream_memory_cache.h"
+#include "voxel/test_voxel_stream_remote.h"
 
 #ifdef VOXEL_ENABLE_FAST_NOISE_2
 #include "fast_noise_2/test_fast_noise_2.h"
@@ -56,7 +79,12 @@ void run_voxel_tests() {
 	VOXEL_TEST(test_voxel_data_map_paste_fill);
 	VOXEL_TEST(test_voxel_data_map_paste_mask);
 	VOXEL_TEST(test_voxel_data_map_copy);
+	VOXEL_TEST(test_voxel_data_get_blocks_with_voxel_data_batched);
+	VOXEL_TEST(test_voxel_data_compress_cold_blocks);
+	VOXEL_TEST(test_voxel_data_partial_lod_update);
+	VOXEL_TEST(test_voxel_data_deferred_lod_update);
 	VOXEL_TEST(test_encode_weights_packed_u16);
+	VOXEL_TEST(test_decode_packed_u16_4i4w);
 	VOXEL_TEST(test_copy_3d_region_zxy);
 	VOXEL_TEST(test_voxel_graph_invalid_connection);
 	VOXEL_TEST(test_voxel_graph_generator_default_graph_compilation);
@@ -66,6 +94,7 @@ void run_voxel_tests() {
 	VOXEL_TEST(test_voxel_graph_generator_expressions_2);
 	VOXEL_TEST(test_voxel_graph_generator_texturing);
 	VOXEL_TEST(test_voxel_graph_equivalence_merging);
+	VOXEL_TEST(test_voxel_graph_optimizations_preserve_results);
 	VOXEL_TEST(test_voxel_graph_generate_block_with_input_sdf);
 	VOXEL_TEST(test_voxel_graph_functions_pass_through);
 	VOXEL_TEST(test_voxel_graph_functions_nested_pass_through);
@@ -83,51 +112,134 @@ void run_voxel_tests() {
 	VOXEL_TEST(test_voxel_graph_issue471);
 	VOXEL_TEST(test_voxel_graph_unused_single_texture_output);
 	VOXEL_TEST(test_voxel_graph_spots2d_optimized_execution_map);
+	VOXEL_TEST(test_voxel_graph_spots_series);
 	VOXEL_TEST(test_voxel_graph_unused_inner_output);
 	VOXEL_TEST(test_voxel_graph_function_execute);
+	VOXEL_TEST(test_voxel_graph_fused_operations);
+	VOXEL_TEST(test_voxel_graph_expression_fused_with_other_nodes);
+	VOXEL_TEST(test_voxel_graph_simd_kernels);
+	VOXEL_TEST(test_voxel_graph_column_cache);
 	VOXEL_TEST(test_voxel_graph_image);
+	VOXEL_TEST(test_voxel_graph_fast_noise_2d_range_clipping);
+	VOXEL_TEST(test_voxel_graph_fast_noise_3d_series);
 	VOXEL_TEST(test_voxel_graph_many_weight_outputs);
 	VOXEL_TEST(test_voxel_graph_many_subdivisions);
 	VOXEL_TEST(test_voxel_graph_non_square_image);
 	VOXEL_TEST(test_voxel_graph_4_default_weights);
 	VOXEL_TEST(test_island_finder);
+	VOXEL_TEST(test_a_star_grid_3d_clusters);
 	VOXEL_TEST(test_unordered_remove_if);
 	VOXEL_TEST(test_instance_data_serialization);
+	VOXEL_TEST(test_quantized_instance_transforms);
 	VOXEL_TEST(test_transform_3d_array_zxy);
 	VOXEL_TEST(test_octree_update);
+	VOXEL_TEST(test_octree_moving_viewer);
 	VOXEL_TEST(test_octree_find_in_box);
 	VOXEL_TEST(test_get_curve_monotonic_sections);
+	VOXEL_TEST(test_get_curve_range_data);
+	VOXEL_TEST(test_curve_lut);
 	VOXEL_TEST(test_voxel_buffer_create);
 	VOXEL_TEST(test_block_serializer);
 	VOXEL_TEST(test_block_serializer_stream_peer);
+	VOXEL_TEST(test_block_serializer_into_buffer);
+	VOXEL_TEST(test_block_serializer_sparse_values);
+	VOXEL_TEST(test_block_serializer_filters);
+#ifdef VOXEL_ENABLE_ZSTD
+	VOXEL_TEST(test_block_serializer_zstd);
+#endif
 	VOXEL_TEST(test_region_file);
+	VOXEL_TEST(test_region_file_memory_mapping);
+	VOXEL_TEST(test_region_file_compaction);
 	VOXEL_TEST(test_voxel_stream_region_files);
+	VOXEL_TEST(test_voxel_stream_region_files_threaded);
+	VOXEL_TEST(test_voxel_stream_region_files_load_blocks_in_box);
+	VOXEL_TEST(test_voxel_stream_log_basic);
+	VOXEL_TEST(test_voxel_stream_log_compaction);
+	VOXEL_TEST(test_save_block_queue);
+	VOXEL_TEST(test_voxel_stream_memory_cache);
+	VOXEL_TEST(test_voxel_stream_cache_flush_concurrent);
+	VOXEL_TEST(test_voxel_stream_remote_batch);
+	VOXEL_TEST(test_voxel_stream_remote_cache_validation);
+	VOXEL_TEST(test_voxel_pre_generation_job);
+	VOXEL_TEST(test_voxel_stream_copy_job);
+	VOXEL_TEST(test_priority_dependency_cache);
+	VOXEL_TEST(test_priority_dependency_prediction);
+	VOXEL_TEST(test_priority_dependency_view_cone);
+	VOXEL_TEST(test_block_lifecycle_trace);
+	VOXEL_TEST(test_mesh_quick_reloading_cache);
 #ifdef VOXEL_ENABLE_FAST_NOISE_2
 	VOXEL_TEST(test_fast_noise_2_basic);
 	VOXEL_TEST(test_fast_noise_2_empty_encoded_node_tree);
+	VOXEL_TEST(test_fast_noise_2_series_as_grid);
 #endif
 	VOXEL_TEST(test_run_blocky_random_tick);
+	VOXEL_TEST(test_random_tick_index);
+	VOXEL_TEST(test_voxel_tool_buffer_uniform_edits);
+	VOXEL_TEST(test_connectivity_cache);
 	VOXEL_TEST(test_flat_map);
+	VOXEL_TEST(test_byte_budget_lru_map);
 	VOXEL_TEST(test_expression_parser);
 	VOXEL_TEST(test_voxel_buffer_metadata);
 	VOXEL_TEST(test_voxel_buffer_metadata_gd);
+	VOXEL_TEST(test_voxel_buffer_palette_compression);
+	VOXEL_TEST(test_voxel_buffer_brick_compression);
+	VOXEL_TEST(test_voxel_buffer_copy_on_write);
+	VOXEL_TEST(test_voxel_buffer_downscale);
+	VOXEL_TEST(test_voxel_buffer_downscale_majority);
+	VOXEL_TEST(test_voxel_buffer_bulk_access_gd);
+	VOXEL_TEST(test_voxel_buffer_sdf_quantization_factor);
+	VOXEL_TEST(test_voxel_buffer_views);
 	VOXEL_TEST(test_voxel_mesher_cubes);
+	VOXEL_TEST(test_voxel_mesher_cubes_occluder_boxes);
+	VOXEL_TEST(test_voxel_mesher_cubes_palette_indexed);
+	VOXEL_TEST(test_voxel_mesher_cubes_mesh_optimization);
+	VOXEL_TEST(test_voxel_mesher_cubes_mesh_cluster_merge);
+	VOXEL_TEST(test_voxel_mesher_blocky_greedy);
+	VOXEL_TEST(test_voxel_mesher_blocky_incremental);
+	VOXEL_TEST(test_voxel_blocky_library_side_culling_cache);
+	VOXEL_TEST(test_voxel_mesher_transvoxel_sign_bits_prepass);
+	VOXEL_TEST(test_voxel_mesher_transvoxel_corner_gradient_cache);
+	VOXEL_TEST(test_blocky_light_propagation);
+	VOXEL_TEST(test_blocky_simulation_fall_and_flow);
 	VOXEL_TEST(test_threaded_task_runner_misc);
 	VOXEL_TEST(test_threaded_task_runner_debug_names);
+	VOXEL_TEST(test_threaded_task_runner_priority_order);
 	VOXEL_TEST(test_task_priority_values);
 	VOXEL_TEST(test_voxel_mesh_sdf_issue463);
+	VOXEL_TEST(test_voxel_mesh_sdf_bvh);
 	VOXEL_TEST(test_normalmap_render_gpu);
+	VOXEL_TEST(test_detail_texture_budget);
 	VOXEL_TEST(test_slot_map);
+	VOXEL_TEST(test_spatial_hash_map);
+	VOXEL_TEST(test_dynamic_aabb_tree);
 	VOXEL_TEST(test_box_blur);
 	VOXEL_TEST(test_threaded_task_postponing);
+	VOXEL_TEST(test_threaded_task_pool);
+	VOXEL_TEST(test_threaded_task_runner_thread_limit);
+	VOXEL_TEST(test_threaded_task_runner_groups);
+	VOXEL_TEST(test_mpsc_batch_queue);
+	VOXEL_TEST(test_task_graph_order);
+	VOXEL_TEST(test_task_graph_cancel);
+	VOXEL_TEST(test_latency_histogram);
+	VOXEL_TEST(test_light_profiler);
 	VOXEL_TEST(test_spatial_lock_misc);
 	VOXEL_TEST(test_spatial_lock_spam);
 	VOXEL_TEST(test_spatial_lock_dependent_map_chunks);
+	VOXEL_TEST(test_spatial_lock_buckets);
+	VOXEL_TEST(test_file_locker);
 	VOXEL_TEST(test_discord_soakil_copypaste);
 	VOXEL_TEST(test_voxel_stream_sqlite_key_string_csd_encoding);
 	VOXEL_TEST(test_voxel_stream_sqlite_key_blob80_encoding);
 	VOXEL_TEST(test_voxel_stream_sqlite_basic);
 	VOXEL_TEST(test_voxel_stream_sqlite_coordinate_format);
+	VOXEL_TEST(test_voxel_stream_sqlite_wal_threaded);
+	VOXEL_TEST(test_voxel_stream_sqlite_block_key_index);
+	VOXEL_TEST(test_voxel_stream_sqlite_persistent_key_cache);
+	VOXEL_TEST(test_voxel_stream_sqlite_load_blocks_in_box);
+	VOXEL_TEST(test_voxel_stream_sqlite_load_all_blocks_deferred_decoding);
+	VOXEL_TEST(test_voxel_stream_sqlite_separate_instance_blocks);
+	VOXEL_TEST(test_voxel_stream_sqlite_mesh_blocks);
+	VOXEL_TEST(test_voxel_stream_sqlite_compressed_voxel_blocks);
 	VOXEL_TEST(test_sdf_hemisphere);
 
 	print_line("------------ Voxel tests end -------------");
@@ -0,0 +1,310 @@
+#include "benchmark_threaded_task_runner.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/time.h"
+#include "../../util/godot/core/random_pcg.h"
+#include "../../util/io/log.h"
+#include "../../util/math/funcs.h"
+#include "../../util/memory/memory.h"
+#include "../../util/string/format.h"
+#include "../../util/tasks/latency_histogram.h"
+#include "../../util/tasks/threaded_task_runner.h"
+#include "../../util/thread/thread.h"
+#include <atomic>
+
+namespace zylann::tests {
+
+namespace {
+
+// Tasks get priorities among this many levels, in the highest band so they take precedence over anything else
+const unsigned int PRIORITY_LEVEL_COUNT = 8;
+// Values of `SyntheticTask::level` once the task can no longer change priority
+const int32_t LEVEL_STARTED = -1;
+const int32_t LEVEL_CANCELLED = -2;
+
+struct TaskRunnerBenchmarkState {
+	// Tasks enqueued and not started yet, for each priority level
+	FixedArray<std::atomic_int32_t, PRIORITY_LEVEL_COUNT> waiting_per_level;
+	// Time from being enqueued to starting for the first time
+	LatencyHistogram pickup_latency;
+	// Tasks that started while tasks of higher priority were waiting
+	std::atomic_uint64_t priority_inversions = { 0 };
+	std::atomic_uint64_t cancelled_tasks = { 0 };
+
+	TaskRunnerBenchmarkState() {
+		for (std::atomic_int32_t &count : waiting_per_level) {
+			count = 0;
+		}
+	}
+};
+
+class SyntheticTask : public IThreadedTask {
+public:
+	TaskRunnerBenchmarkState *state = nullptr;
+	// Priority level, or one of the LEVEL_* constants
+	std::atomic_int32_t level = { 0 };
+	uint32_t work_usec = 0;
+	uint32_t remaining_postpones = 0;
+	uint64_t enqueue_time_usec = 0;
+	bool started = false;
+
+	void run(ThreadedTaskContext &ctx) override {
+		const uint64_t start_time_usec = Time::get_singleton()->get_ticks_usec();
+
+		if (!started) {
+			started = true;
+			state->pickup_latency.add(start_time_usec - enqueue_time_usec);
+
+			const int32_t prev_level = level.exchange(LEVEL_STARTED);
+			if (prev_level >= 0) {
+				--state->waiting_per_level[prev_level];
+				for (unsigned int i = prev_level + 1; i < PRIORITY_LEVEL_COUNT; ++i) {
+					if (state->waiting_per_level[i] > 0) {
+						++state->priority_inversions;
+						break;
+					}
+				}
+			}
+		}
+
+		// Keep the thread busy instead of sleeping, like a real task would
+		while (Time::get_singleton()->get_ticks_usec() - start_time_usec < work_usec) {
+		}
+
+		if (remaining_postpones > 0) {
+			--remaining_postpones;
+			ctx.status = ThreadedTaskContext::STATUS_POSTPONED;
+		}
+	}
+
+	TaskPriority get_priority() override {
+		const int32_t l = level.load(std::memory_order_relaxed);
+		return TaskPriority(0, 0, 0, l < 0 ? 0 : l);
+	}
+
+	bool is_cancelled() override {
+		return level.load(std::memory_order_relaxed) == LEVEL_CANCELLED;
+	}
+
+	const char *get_debug_name() const override {
+		return "SyntheticTask";
+	}
+
+	// Changes the level of the task if it didn't start yet
+	bool try_set_level(int32_t new_level) {
+		int32_t prev_level = level.load();
+		while (prev_level >= 0) {
+			if (level.compare_exchange_weak(prev_level, new_level)) {
+				--state->waiting_per_level[prev_level];
+				if (new_level >= 0) {
+					++state->waiting_per_level[new_level];
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+inline bool pick(RandomPCG &rng, float ratio) {
+	return ratio > 0.f && rng.randf() < ratio;
+}
+
+} // namespace
+
+void run_threaded_task_runner_benchmark(const TaskRunnerBenchmarkConfig &config, uint32_t thread_count) {
+	ZN_ASSERT_RETURN(thread_count >= 1 && thread_count <= ThreadedTaskRunner::MAX_THREADS);
+	ZN_ASSERT_RETURN(config.task_count > 0);
+	ZN_ASSERT_RETURN(config.min_work_usec <= config.max_work_usec);
+
+	TaskRunnerBenchmarkState state;
+	RandomPCG rng;
+
+	// Tasks are kept until the end, so churn and cancellation can be applied to any of them without tracking which
+	// ones were completed
+	StdVector<SyntheticTask *> tasks;
+	tasks.reserve(config.task_count);
+	for (unsigned int i = 0; i < config.task_count; ++i) {
+		SyntheticTask *task = ZN_NEW(SyntheticTask);
+		task->state = &state;
+		task->level = rng.rand() % PRIORITY_LEVEL_COUNT;
+		if (pick(rng, config.heavy_ratio)) {
+			task->work_usec = config.heavy_work_usec;
+		} else {
+			task->work_usec = config.min_work_usec + rng.rand() % (config.max_work_usec - config.min_work_usec + 1);
+		}
+		if (pick(rng, config.postpone_ratio)) {
+			task->remaining_postpones = config.postpone_count;
+		}
+		tasks.push_back(task);
+	}
+
+	const uint32_t batch_size = config.batch_size > 0 ? config.batch_size : config.task_count;
+	StdVector<IThreadedTask *> parallel_batch;
+	StdVector<IThreadedTask *> serial_batch;
+	StdVector<SyntheticTask *> tasks_to_cancel;
+	unsigned int enqueued_count = 0;
+	unsigned int completed_count = 0;
+
+	ThreadedTaskRunner runner;
+	runner.set_name("Benchmark");
+	runner.set_thread_count(thread_count);
+
+	const uint64_t begin_time_usec = Time::get_singleton()->get_ticks_usec();
+
+	while (completed_count < config.task_count) {
+		if (enqueued_count < config.task_count) {
+			// Cancel tasks of the previous batch, some of which will have started
+			for (SyntheticTask *task : tasks_to_cancel) {
+				if (task->try_set_level(LEVEL_CANCELLED)) {
+					++state.cancelled_tasks;
+				}
+			}
+			tasks_to_cancel.clear();
+
+			if (config.priority_churn_ratio > 0.f) {
+				const unsigned int churn_count =
+						static_cast<unsigned int>(config.priority_churn_ratio * enqueued_count);
+				for (unsigned int i = 0; i < churn_count; ++i) {
+					tasks[rng.rand() % enqueued_count]->try_set_level(rng.rand() % PRIORITY_LEVEL_COUNT);
+				}
+				runner.request_priority_update();
+			}
+
+			const unsigned int end_index = math::min(enqueued_count + batch_size, config.task_count);
+			const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
+			for (unsigned int i = enqueued_count; i < end_index; ++i) {
+				SyntheticTask *task = tasks[i];
+				task->enqueue_time_usec = now_usec;
+				++state.waiting_per_level[task->level];
+				if (pick(rng, config.serial_ratio)) {
+					serial_batch.push_back(task);
+				} else {
+					parallel_batch.push_back(task);
+				}
+				if (pick(rng, config.cancel_ratio)) {
+					tasks_to_cancel.push_back(task);
+				}
+			}
+			enqueued_count = end_index;
+
+			if (parallel_batch.size() > 0) {
+				runner.enqueue(to_span(parallel_batch), false);
+				parallel_batch.clear();
+			}
+			if (serial_batch.size() > 0) {
+				runner.enqueue(to_span(serial_batch), true);
+				serial_batch.clear();
+			}
+		}
+
+		runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+			++completed_count;
+		});
+
+		if (enqueued_count == config.task_count) {
+			Thread::sleep_usec(100);
+		} else if (config.batch_interval_usec > 0) {
+			Thread::sleep_usec(config.batch_interval_usec);
+		}
+	}
+
+	const uint64_t time_usec = Time::get_singleton()->get_ticks_usec() - begin_time_usec;
+	const ThreadedTaskRunner::LockStats lock_stats = runner.get_lock_stats();
+
+	for (SyntheticTask *task : tasks) {
+		ZN_DELETE(task);
+	}
+
+	print_line(format(
+			"workload={} threads={} tasks={} time_ms={} tasks_per_second={} pickup_p50_us={} pickup_p99_us={} "
+			"pickup_max_us={} lock_contentions={} lock_wait_us={} priority_inversions={} cancelled={}",
+			config.name,
+			thread_count,
+			config.task_count,
+			time_usec / 1000,
+			static_cast<uint64_t>(1'000'000.0 * config.task_count / math::max(time_usec, uint64_t(1))),
+			state.pickup_latency.get_percentile_usec(0.5f),
+			state.pickup_latency.get_percentile_usec(0.99f),
+			state.pickup_latency.get_percentile_usec(1.f),
+			lock_stats.contended_count,
+			lock_stats.wait_usec,
+			state.priority_inversions.load(),
+			state.cancelled_tasks.load()
+	));
+}
+
+void run_threaded_task_runner_benchmarks() {
+	print_line("------------ Task runner benchmarks begin -------------");
+
+	StdVector<TaskRunnerBenchmarkConfig> configs;
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "small_tasks";
+		configs.push_back(c);
+
+		c.name = "tiny_tasks";
+		c.min_work_usec = 0;
+		c.max_work_usec = 2;
+		c.task_count = 100000;
+		configs.push_back(c);
+	}
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "heavy_tail";
+		c.heavy_ratio = 0.02f;
+		configs.push_back(c);
+	}
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "serial_mix";
+		c.serial_ratio = 0.2f;
+		configs.push_back(c);
+	}
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "priority_churn";
+		c.batch_interval_usec = 500;
+		c.priority_churn_ratio = 0.05f;
+		configs.push_back(c);
+	}
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "cancellations";
+		c.batch_interval_usec = 500;
+		c.cancel_ratio = 0.3f;
+		configs.push_back(c);
+	}
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "postponed";
+		c.postpone_ratio = 0.1f;
+		configs.push_back(c);
+	}
+	{
+		TaskRunnerBenchmarkConfig c;
+		c.name = "mixed";
+		c.batch_interval_usec = 200;
+		c.heavy_ratio = 0.01f;
+		c.serial_ratio = 0.1f;
+		c.priority_churn_ratio = 0.02f;
+		c.cancel_ratio = 0.1f;
+		c.postpone_ratio = 0.05f;
+		configs.push_back(c);
+	}
+
+	const unsigned int hw_concurrency = Thread::get_hardware_concurrency();
+	print_line(format(
+			"hardware_concurrency={} max_threads={}", hw_concurrency, unsigned(ThreadedTaskRunner::MAX_THREADS)
+	));
+
+	for (const TaskRunnerBenchmarkConfig &config : configs) {
+		for (uint32_t thread_count = 1; thread_count <= ThreadedTaskRunner::MAX_THREADS; thread_count *= 2) {
+			run_threaded_task_runner_benchmark(config, thread_count);
+		}
+	}
+
+	print_line("------------ Task runner benchmarks end -------------");
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,41 @@
+#ifndef ZN_BENCHMARK_THREADED_TASK_RUNNER_H
+#define ZN_BENCHMARK_THREADED_TASK_RUNNER_H
+
+#include <cstdint>
+
+namespace zylann::tests {
+
+// Workload of synthetic tasks flooding a ThreadedTaskRunner. Ratios are between 0 and 1.
+struct TaskRunnerBenchmarkConfig {
+	const char *name = "default";
+	uint32_t task_count = 20000;
+	// Tasks are enqueued in batches, with a pause between them. 0 enqueues everything as fast as possible.
+	uint32_t batch_size = 256;
+	uint32_t batch_interval_usec = 0;
+	// Tasks keep a thread busy for a random duration in this range
+	uint32_t min_work_usec = 5;
+	uint32_t max_work_usec = 50;
+	// Portion of tasks taking `heavy_work_usec` instead, to simulate a long tail of big tasks
+	float heavy_ratio = 0.f;
+	uint32_t heavy_work_usec = 2000;
+	// Portion of tasks scheduled as serial
+	float serial_ratio = 0.f;
+	// Portion of waiting tasks getting a new random priority after each batch
+	float priority_churn_ratio = 0.f;
+	// Portion of tasks cancelled after the next batch was enqueued. Some of them will already have run.
+	float cancel_ratio = 0.f;
+	// Portion of tasks postponing themselves `postpone_count` times before completing
+	float postpone_ratio = 0.f;
+	uint32_t postpone_count = 2;
+};
+
+// Runs one workload with the given amount of threads, and prints one line of results
+void run_threaded_task_runner_benchmark(const TaskRunnerBenchmarkConfig &config, uint32_t thread_count);
+
+// Runs a set of workloads stressing different parts of the scheduler, with 1 thread up to the maximum supported by
+// ThreadedTaskRunner. Results can be compared before and after changes to the runner.
+void run_threaded_task_runner_benchmarks();
+
+} // namespace zylann::tests
+
+#endif // ZN_BENCHMARK_THREADED_TASK_RUNNER_H
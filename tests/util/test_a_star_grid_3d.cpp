@@ -0,0 +1,113 @@
+#include "test_a_star_grid_3d.h"
+#include "../../util/a_star_grid_3d_clusters.h"
+#include "../testing.h"
+#include <algorithm>
+
+namespace zylann::tests {
+
+namespace {
+
+// Flat ground with a wall 3 voxels high, which agents can't jump over. It has an opening unless closed.
+class TestAStarGrid3D : public AStarGrid3D {
+public:
+	bool wall_closed = false;
+
+	bool is_solid_test(Vector3i pos) const {
+		if (pos.y <= 0) {
+			return true;
+		}
+		if (pos.x == 40 && pos.y <= 3) {
+			return wall_closed || pos.z < 50 || pos.z > 52;
+		}
+		return false;
+	}
+
+protected:
+	void load_solid_chunks(Vector3i origin, Span<uint64_t> out_chunks) override {
+		const int chunks_per_page = SOLID_PAGE_SIZE / SOLID_CHUNK_SIZE;
+		for (uint64_t &chunk : out_chunks) {
+			chunk = 0;
+		}
+		Vector3i rpos;
+		for (rpos.z = 0; rpos.z < SOLID_PAGE_SIZE; ++rpos.z) {
+			for (rpos.x = 0; rpos.x < SOLID_PAGE_SIZE; ++rpos.x) {
+				for (rpos.y = 0; rpos.y < SOLID_PAGE_SIZE; ++rpos.y) {
+					if (!is_solid_test(origin + rpos)) {
+						continue;
+					}
+					const Vector3i cpos = rpos >> SOLID_CHUNK_SIZE_PO2;
+					const unsigned int chunk_index = Vector3iUtil::get_zxy_index(
+							cpos, Vector3i(chunks_per_page, chunks_per_page, chunks_per_page)
+					);
+					const unsigned int bit_index = Vector3iUtil::get_zxy_index(
+							rpos & SOLID_CHUNK_SIZE_MASK, Vector3iUtil::create(SOLID_CHUNK_SIZE)
+					);
+					out_chunks[chunk_index] |= uint64_t(1) << bit_index;
+				}
+			}
+		}
+	}
+};
+
+bool is_path_valid(TestAStarGrid3D &grid, Span<const Vector3i> path, Vector3i from, Vector3i to) {
+	if (path.size() == 0 || path[0] != from) {
+		return false;
+	}
+	StdVector<Vector3i> neighbors;
+	for (unsigned int i = 0; i < path.size(); ++i) {
+		const Vector3i next = i + 1 < path.size() ? path[i + 1] : to;
+		neighbors.clear();
+		grid.get_neighbor_positions(path[i], neighbors);
+		if (std::find(neighbors.begin(), neighbors.end(), next) == neighbors.end()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+void test_a_star_grid_3d_clusters() {
+	TestAStarGrid3D grid;
+	grid.set_region(Box3i(Vector3i(-5, -3, -5), Vector3i(100, 20, 80)));
+
+	const Vector3i from(2, 1, 3);
+	const Vector3i to(80, 1, 10);
+
+	// Regular search, for reference
+	grid.start(from, to);
+	while (grid.is_running()) {
+		grid.step();
+	}
+	ZN_TEST_ASSERT(is_path_valid(grid, grid.get_path(), from, to));
+	const unsigned int regular_path_size = grid.get_path().size();
+
+	AStarGrid3DClusters clusters;
+	StdVector<Vector3i> path;
+
+	ZN_TEST_ASSERT(clusters.find_path(grid, from, to, path));
+	ZN_TEST_ASSERT(is_path_valid(grid, to_span_const(path), from, to));
+	// Not always the shortest, but close
+	ZN_TEST_ASSERT(path.size() >= regular_path_size);
+	ZN_TEST_ASSERT(path.size() < regular_path_size * 2);
+	ZN_TEST_ASSERT(clusters.get_cluster_count() > 0);
+
+	// Other direction, reusing clusters
+	ZN_TEST_ASSERT(clusters.find_path(grid, to, from, path));
+	ZN_TEST_ASSERT(is_path_valid(grid, to_span_const(path), to, from));
+
+	// Within a single cluster
+	ZN_TEST_ASSERT(clusters.find_path(grid, Vector3i(1, 1, 1), Vector3i(5, 1, 7), path));
+	ZN_TEST_ASSERT(is_path_valid(grid, to_span_const(path), Vector3i(1, 1, 1), Vector3i(5, 1, 7)));
+
+	// Close the opening
+	grid.wall_closed = true;
+	const Box3i edited_box(Vector3i(40, 1, 50), Vector3i(1, 3, 3));
+	grid.invalidate_solid_cache(edited_box);
+	clusters.invalidate_area(grid, edited_box);
+
+	ZN_TEST_ASSERT(!clusters.find_path(grid, from, to, path));
+	ZN_TEST_ASSERT(path.size() == 0);
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,10 @@
+#ifndef ZN_TESTS_A_STAR_GRID_3D_H
+#define ZN_TESTS_A_STAR_GRID_3D_H
+
+namespace zylann::tests {
+
+void test_a_star_grid_3d_clusters();
+
+} // namespace zylann::tests
+
+#endif // ZN_TESTS_A_STAR_GRID_3D_H
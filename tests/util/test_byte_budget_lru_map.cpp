@@ -0,0 +1,44 @@
+#include "test_byte_budget_lru_map.h"
+#include "../../util/containers/byte_budget_lru_map.h"
+#include "../testing.h"
+
+namespace zylann::tests {
+
+void test_byte_budget_lru_map() {
+	ByteBudgetLRUMap<int, int> map;
+
+	for (int i = 0; i < 8; ++i) {
+		map.set(i, 100 * i, 10);
+	}
+	ZN_TEST_ASSERT(map.get_count() == 8);
+	ZN_TEST_ASSERT(map.get_memory_usage() == 80);
+
+	// Replacing a value updates memory usage instead of adding to it
+	map.set(3, 300, 20);
+	ZN_TEST_ASSERT(map.get_count() == 8);
+	ZN_TEST_ASSERT(map.get_memory_usage() == 90);
+
+	// Nothing to evict when within budget
+	map.evict(90);
+	ZN_TEST_ASSERT(map.get_count() == 8);
+
+	// Use the oldest values so they become the most recent ones
+	ZN_TEST_ASSERT(map.get(0) != nullptr && *map.get(0) == 0);
+	ZN_TEST_ASSERT(map.get(1) != nullptr && *map.get(1) == 100);
+	ZN_TEST_ASSERT(map.get(100) == nullptr);
+
+	// Evicts down to 3/4 of the budget, least recently used first
+	map.evict(80);
+	ZN_TEST_ASSERT(map.get_memory_usage() <= 60);
+	ZN_TEST_ASSERT(map.get(0) != nullptr);
+	ZN_TEST_ASSERT(map.get(1) != nullptr);
+	ZN_TEST_ASSERT(map.get(2) == nullptr);
+	ZN_TEST_ASSERT(map.get(4) == nullptr);
+	ZN_TEST_ASSERT(map.get(7) != nullptr && *map.get(7) == 700);
+
+	map.clear();
+	ZN_TEST_ASSERT(map.get_count() == 0);
+	ZN_TEST_ASSERT(map.get_memory_usage() == 0);
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,10 @@
+#ifndef ZN_TESTS_BYTE_BUDGET_LRU_MAP_H
+#define ZN_TESTS_BYTE_BUDGET_LRU_MAP_H
+
+namespace zylann::tests {
+
+void test_byte_budget_lru_map();
+
+} // namespace zylann::tests
+
+#endif // ZN_TESTS_BYTE_BUDGET_LRU_MAP_H
@@ -0,0 +1,99 @@
+#include "test_dynamic_aabb_tree.h"
+#include "../../util/containers/dynamic_aabb_tree.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/core/random_pcg.h"
+#include "../testing.h"
+#include <algorithm>
+
+namespace zylann::tests {
+
+namespace {
+
+AABB make_random_box(RandomPCG &rng) {
+	const Vector3 pos(rng.rand() % 1000, rng.rand() % 100, rng.rand() % 1000);
+	const Vector3 size(1 + rng.rand() % 20, 1 + rng.rand() % 20, 1 + rng.rand() % 20);
+	return AABB(pos, size);
+}
+
+} // namespace
+
+void test_dynamic_aabb_tree() {
+	DynamicAABBTree<unsigned int> tree;
+
+	struct Item {
+		AABB aabb;
+		uint32_t leaf;
+		bool alive;
+	};
+	// Used as reference
+	StdVector<Item> items;
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	StdVector<unsigned int> found;
+	StdVector<unsigned int> expected;
+
+	for (unsigned int i = 0; i < 10000; ++i) {
+		const unsigned int op = rng.rand() % 4;
+
+		if (op < 2 || items.size() == 0) {
+			const AABB aabb = make_random_box(rng);
+			const uint32_t leaf = tree.add(aabb, items.size());
+			items.push_back(Item{ aabb, leaf, true });
+
+		} else {
+			Item &item = items[rng.rand() % items.size()];
+			if (item.alive) {
+				if (op == 2) {
+					tree.remove(item.leaf);
+					item.alive = false;
+				} else {
+					item.aabb = make_random_box(rng);
+					tree.update(item.leaf, item.aabb);
+				}
+			}
+		}
+
+		if (i % 100 == 0) {
+			const AABB query_box(
+					Vector3(rng.rand() % 1000, rng.rand() % 100, rng.rand() % 1000),
+					Vector3(rng.rand() % 100, rng.rand() % 100, rng.rand() % 100)
+			);
+
+			found.clear();
+			tree.query(query_box, [&found](unsigned int item_index) { //
+				found.push_back(item_index);
+			});
+			std::sort(found.begin(), found.end());
+
+			expected.clear();
+			for (unsigned int item_index = 0; item_index < items.size(); ++item_index) {
+				const Item &item = items[item_index];
+				if (item.alive && item.aabb.intersects(query_box)) {
+					expected.push_back(item_index);
+				}
+			}
+
+			ZN_TEST_ASSERT(found == expected);
+		}
+	}
+
+	unsigned int alive_count = 0;
+	for (const Item &item : items) {
+		if (item.alive) {
+			ZN_TEST_ASSERT(tree.get_aabb(item.leaf) == item.aabb);
+			++alive_count;
+		}
+	}
+	ZN_TEST_ASSERT(tree.count() == alive_count);
+
+	// Must remain balanced, a degenerate tree would be as slow as testing every box
+	ZN_TEST_ASSERT(tree.get_height() < 32);
+
+	tree.clear();
+	ZN_TEST_ASSERT(tree.count() == 0);
+	ZN_TEST_ASSERT(tree.get_height() == 0);
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,113 @@
+#include "test_file_locker.h"
+#include "../../util/io/file_locker.h"
+#include "../../util/thread/thread.h"
+#include "../testing.h"
+#include <atomic>
+
+namespace zylann::tests {
+
+void test_file_locker() {
+	FileLocker locker;
+	const StdString path = "test_file_locker_a";
+	const StdString other_path = "test_file_locker_b";
+
+	// Entries only exist while something uses them
+	locker.lock_read(path);
+	ZN_TEST_ASSERT(locker.get_entry_count() == 1);
+	locker.unlock(path);
+	ZN_TEST_ASSERT(locker.get_entry_count() == 0);
+
+	{
+		FileLocker::Handle handle = locker.get_handle(path);
+		ZN_TEST_ASSERT(handle.is_valid());
+		ZN_TEST_ASSERT(locker.get_entry_count() == 1);
+
+		// Locking and unlocking by path must not erase the entry while the handle still pins it
+		locker.lock_write(path);
+		locker.unlock(path);
+		ZN_TEST_ASSERT(locker.get_entry_count() == 1);
+
+		locker.lock_read(other_path);
+		ZN_TEST_ASSERT(locker.get_entry_count() == 2);
+		locker.unlock(other_path);
+		ZN_TEST_ASSERT(locker.get_entry_count() == 1);
+
+		// Moving the handle keeps the entry pinned once
+		FileLocker::Handle moved_handle = std::move(handle);
+		ZN_TEST_ASSERT(!handle.is_valid());
+		ZN_TEST_ASSERT(moved_handle.is_valid());
+		ZN_TEST_ASSERT(locker.get_entry_count() == 1);
+
+		{
+			FileLocker::Read rlock(moved_handle);
+		}
+		ZN_TEST_ASSERT(locker.get_entry_count() == 1);
+	}
+	ZN_TEST_ASSERT(locker.get_entry_count() == 0);
+
+	// Read and write locks on the same path exclude each other, whether they use handles or paths
+
+	struct Context {
+		FileLocker *locker;
+		StdString path;
+		std::atomic_bool locked = { false };
+	};
+
+	Context ctx;
+	ctx.locker = &locker;
+	ctx.path = path;
+
+	struct L {
+		static void wait_and_check_blocked(Context &ctx) {
+			// Give time to the thread to try locking
+			Thread::sleep_usec(20000);
+			ZN_TEST_ASSERT(ctx.locked == false);
+		}
+	};
+
+	{
+		FileLocker::Handle handle = locker.get_handle(path);
+		handle.lock_read();
+
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					Context &ctx = *static_cast<Context *>(userdata);
+					ctx.locker->lock_write(ctx.path);
+					ctx.locked = true;
+					ctx.locker->unlock(ctx.path);
+				},
+				&ctx
+		);
+
+		L::wait_and_check_blocked(ctx);
+		handle.unlock();
+		thread.wait_to_finish();
+		ZN_TEST_ASSERT(ctx.locked == true);
+	}
+
+	{
+		ctx.locked = false;
+		locker.lock_write(path);
+
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					Context &ctx = *static_cast<Context *>(userdata);
+					FileLocker::Handle handle = ctx.locker->get_handle(ctx.path);
+					FileLocker::Read rlock(handle);
+					ctx.locked = true;
+				},
+				&ctx
+		);
+
+		L::wait_and_check_blocked(ctx);
+		locker.unlock(path);
+		thread.wait_to_finish();
+		ZN_TEST_ASSERT(ctx.locked == true);
+	}
+
+	ZN_TEST_ASSERT(locker.get_entry_count() == 0);
+}
+
+} // namespace zylann::tests
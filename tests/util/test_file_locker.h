@@ -0,0 +1,10 @@
+#ifndef ZN_TESTS_FILE_LOCKER_H
+#define ZN_TESTS_FILE_LOCKER_H
+
+namespace zylann::tests {
+
+void test_file_locker();
+
+} // namespace zylann::tests
+
+#endif // ZN_TESTS_FILE_LOCKER_H
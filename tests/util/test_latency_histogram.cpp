@@ -0,0 +1,48 @@
+#include "test_latency_histogram.h"
+#include "../../util/tasks/latency_histogram.h"
+#include "../testing.h"
+
+namespace zylann::tests {
+
+void test_latency_histogram() {
+	// Every duration must fall in a bucket whose range contains it
+	for (uint64_t d = 0; d < 10'000'000; d += (d < 1000 ? 1 : 997)) {
+		const unsigned int bucket_index = LatencyHistogram::get_bucket_index(d);
+		ZN_TEST_ASSERT(bucket_index < LatencyHistogram::BUCKET_COUNT);
+		ZN_TEST_ASSERT(d <= LatencyHistogram::get_bucket_max_usec(bucket_index));
+		if (bucket_index > 0) {
+			ZN_TEST_ASSERT(d > LatencyHistogram::get_bucket_max_usec(bucket_index - 1));
+		}
+	}
+
+	LatencyHistogram histogram;
+	ZN_TEST_ASSERT(histogram.get_count() == 0);
+	ZN_TEST_ASSERT(histogram.get_percentile_usec(0.5f) == 0);
+
+	for (uint64_t d = 1; d <= 1000; ++d) {
+		histogram.add(d);
+	}
+	ZN_TEST_ASSERT(histogram.get_count() == 1000);
+
+	// Percentiles are over-estimated by at most the size of a bucket
+	struct L {
+		static bool is_close(uint64_t estimated, uint64_t expected) {
+			return estimated >= expected && estimated <= expected + expected / 4;
+		}
+	};
+	ZN_TEST_ASSERT(L::is_close(histogram.get_percentile_usec(0.5f), 500));
+	ZN_TEST_ASSERT(L::is_close(histogram.get_percentile_usec(0.95f), 950));
+	ZN_TEST_ASSERT(L::is_close(histogram.get_percentile_usec(0.99f), 990));
+	ZN_TEST_ASSERT(histogram.get_percentile_usec(0.5f) <= histogram.get_percentile_usec(0.99f));
+
+	// Durations too long for the last bucket are clamped
+	histogram.add(uint64_t(1) << 50);
+	ZN_TEST_ASSERT(histogram.get_percentile_usec(1.f) ==
+			LatencyHistogram::get_bucket_max_usec(LatencyHistogram::BUCKET_COUNT - 1));
+
+	histogram.clear();
+	ZN_TEST_ASSERT(histogram.get_count() == 0);
+	ZN_TEST_ASSERT(histogram.get_percentile_usec(0.99f) == 0);
+}
+
+} // namespace zylann::tests
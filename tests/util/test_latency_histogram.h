@@ -0,0 +1,10 @@
+#ifndef ZN_TEST_LATENCY_HISTOGRAM_H
+#define ZN_TEST_LATENCY_HISTOGRAM_H
+
+namespace zylann::tests {
+
+void test_latency_histogram();
+
+} // namespace zylann::tests
+
+#endif // ZN_TEST_LATENCY_HISTOGRAM_H
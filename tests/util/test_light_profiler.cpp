@@ -0,0 +1,96 @@
+#include "test_light_profiler.h"
+#include "../../util/light_profiler.h"
+#include "../testing.h"
+
+namespace zylann::tests {
+
+void test_light_profiler() {
+	static const char *SCOPE_NAME = "test_light_profiler_scope";
+	static const char *COUNTER_NAME = "test_light_profiler_counter";
+
+	const bool was_enabled = light_profiler::is_enabled();
+
+	struct L {
+		static void record(int64_t counter_value) {
+			ZN_LIGHT_PROFILE_SCOPE_NAMED(SCOPE_NAME);
+			ZN_LIGHT_PROFILE_COUNTER_ADD(COUNTER_NAME, counter_value);
+		}
+
+		static unsigned int count_scopes(const StdVector<light_profiler::ThreadEvents> &threads) {
+			unsigned int count = 0;
+			for (const light_profiler::ThreadEvents &te : threads) {
+				for (const light_profiler::Event &event : te.events) {
+					if (event.name == SCOPE_NAME) {
+						ZN_TEST_ASSERT(event.begin_usec <= event.end_usec);
+						++count;
+					}
+				}
+			}
+			return count;
+		}
+
+		static int64_t get_counter(const StdVector<light_profiler::CounterSample> &counters) {
+			for (const light_profiler::CounterSample &counter : counters) {
+				if (counter.name == COUNTER_NAME) {
+					return counter.value;
+				}
+			}
+			return -1;
+		}
+	};
+
+	// Nothing is recorded while disabled
+	light_profiler::set_enabled(false);
+	light_profiler::clear();
+	L::record(5);
+	{
+		StdVector<light_profiler::ThreadEvents> threads;
+		light_profiler::get_events(threads);
+		ZN_TEST_ASSERT(L::count_scopes(threads) == 0);
+	}
+
+	light_profiler::set_enabled(true);
+	L::record(2);
+	L::record(3);
+	{
+		StdVector<light_profiler::ThreadEvents> threads;
+		light_profiler::get_events(threads);
+		ZN_TEST_ASSERT(L::count_scopes(threads) == 2);
+
+		StdVector<light_profiler::CounterSample> counters;
+		light_profiler::get_counters(counters);
+		ZN_TEST_ASSERT(L::get_counter(counters) == 5);
+
+		StdString json;
+		light_profiler::write_chrome_trace(json);
+		ZN_TEST_ASSERT(json.find(SCOPE_NAME) != StdString::npos);
+		ZN_TEST_ASSERT(json.find(COUNTER_NAME) != StdString::npos);
+		ZN_TEST_ASSERT(json.front() == '{' && json.back() == '}');
+	}
+
+	// Ring buffers only keep the most recent events
+	for (unsigned int i = 0; i < 100'000; ++i) {
+		L::record(0);
+	}
+	{
+		StdVector<light_profiler::ThreadEvents> threads;
+		light_profiler::get_events(threads);
+		const unsigned int count = L::count_scopes(threads);
+		ZN_TEST_ASSERT(count > 0 && count < 100'000);
+	}
+
+	light_profiler::clear();
+	{
+		StdVector<light_profiler::ThreadEvents> threads;
+		light_profiler::get_events(threads);
+		ZN_TEST_ASSERT(L::count_scopes(threads) == 0);
+
+		StdVector<light_profiler::CounterSample> counters;
+		light_profiler::get_counters(counters);
+		ZN_TEST_ASSERT(L::get_counter(counters) == 0);
+	}
+
+	light_profiler::set_enabled(was_enabled);
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,85 @@
+#include "test_mpsc_batch_queue.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/mpsc_batch_queue.h"
+#include "../../util/thread/thread.h"
+#include "../testing.h"
+
+namespace zylann::tests {
+
+void test_mpsc_batch_queue() {
+	static const unsigned int PRODUCER_COUNT = 4;
+	static const unsigned int BATCH_COUNT = 10'000;
+	static const unsigned int BATCH_SIZE = 3;
+
+	typedef MPSCBatchQueue<uint32_t, PRODUCER_COUNT> Queue;
+
+	// Single thread, batches come out in the order they were pushed
+	{
+		Queue queue;
+		ZN_TEST_ASSERT(queue.is_empty());
+		for (uint32_t i = 0; i < 10; ++i) {
+			const uint32_t items[2] = { 2 * i, 2 * i + 1 };
+			queue.push(i % PRODUCER_COUNT, Span<const uint32_t>(items, 0, 2));
+		}
+		ZN_TEST_ASSERT(!queue.is_empty());
+		uint32_t expected = 0;
+		queue.consume([&expected](uint32_t item) {
+			ZN_TEST_ASSERT(item == expected);
+			++expected;
+		});
+		ZN_TEST_ASSERT(expected == 20);
+		ZN_TEST_ASSERT(queue.is_empty());
+	}
+
+	// Producers push while the consumer drains
+	{
+		struct Context {
+			Queue *queue;
+			unsigned int producer_index;
+		};
+
+		struct L {
+			static void producer_func(void *userdata) {
+				Context &ctx = *static_cast<Context *>(userdata);
+				for (unsigned int batch_index = 0; batch_index < BATCH_COUNT; ++batch_index) {
+					FixedArray<uint32_t, BATCH_SIZE> items;
+					for (unsigned int i = 0; i < BATCH_SIZE; ++i) {
+						items[i] = ctx.producer_index;
+					}
+					ctx.queue->push(ctx.producer_index, to_span_const(items));
+				}
+			}
+		};
+
+		Queue queue;
+		FixedArray<Thread, PRODUCER_COUNT> threads;
+		FixedArray<Context, PRODUCER_COUNT> contexts;
+		FixedArray<unsigned int, PRODUCER_COUNT> received_counts;
+		fill(received_counts, 0u);
+
+		for (unsigned int i = 0; i < threads.size(); ++i) {
+			contexts[i] = Context{ &queue, i };
+			threads[i].start(L::producer_func, &contexts[i]);
+		}
+
+		unsigned int total_count = 0;
+		while (total_count < PRODUCER_COUNT * BATCH_COUNT * BATCH_SIZE) {
+			queue.consume([&received_counts, &total_count](uint32_t item) {
+				ZN_TEST_ASSERT(item < PRODUCER_COUNT);
+				++received_counts[item];
+				++total_count;
+			});
+		}
+
+		for (unsigned int i = 0; i < threads.size(); ++i) {
+			threads[i].wait_to_finish();
+		}
+
+		ZN_TEST_ASSERT(queue.is_empty());
+		for (const unsigned int count : received_counts) {
+			ZN_TEST_ASSERT(count == BATCH_COUNT * BATCH_SIZE);
+		}
+	}
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,10 @@
+#ifndef ZN_TEST_MPSC_BATCH_QUEUE_H
+#define ZN_TEST_MPSC_BATCH_QUEUE_H
+
+namespace zylann::tests {
+
+void test_mpsc_batch_queue();
+
+} // namespace zylann::tests
+
+#endif // ZN_TEST_MPSC_BATCH_QUEUE_H
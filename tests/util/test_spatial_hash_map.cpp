@@ -0,0 +1,74 @@
+#include "test_spatial_hash_map.h"
+#include "../../util/containers/spatial_hash_map.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/godot/core/random_pcg.h"
+#include "../testing.h"
+
+namespace zylann::tests {
+
+void test_spatial_hash_map() {
+	SpatialHashMap<int> map;
+	// Used as reference
+	StdUnorderedMap<Vector3i, int> expected_map;
+
+	ZN_TEST_ASSERT(map.size() == 0);
+	ZN_TEST_ASSERT(map.find(Vector3i()) == nullptr);
+	ZN_TEST_ASSERT(!map.erase(Vector3i()));
+
+	// Small range of positions so insertions and removals often hit the same keys
+	RandomPCG rng;
+	rng.seed(131183);
+	for (unsigned int i = 0; i < 20000; ++i) {
+		const Vector3i pos(int(rng.rand() % 24) - 12, int(rng.rand() % 24) - 12, int(rng.rand() % 24) - 12);
+		if (rng.rand() % 3 == 0) {
+			const bool erased = map.erase(pos);
+			ZN_TEST_ASSERT(erased == (expected_map.erase(pos) == 1));
+		} else {
+			map.get_or_insert(pos) = i;
+			expected_map[pos] = i;
+		}
+	}
+
+	ZN_TEST_ASSERT(map.size() == expected_map.size());
+	for (auto it = expected_map.begin(); it != expected_map.end(); ++it) {
+		const int *value = map.find(it->first);
+		ZN_TEST_ASSERT(value != nullptr);
+		ZN_TEST_ASSERT(*value == it->second);
+	}
+
+	unsigned int iterated_count = 0;
+	map.for_each([&expected_map, &iterated_count](const Vector3i &pos, const int &value) {
+		auto it = expected_map.find(pos);
+		ZN_TEST_ASSERT(it != expected_map.end());
+		ZN_TEST_ASSERT(it->second == value);
+		++iterated_count;
+	});
+	ZN_TEST_ASSERT(iterated_count == expected_map.size());
+
+	// Pointers to values must remain valid when other elements are inserted and removed
+	const Vector3i stable_pos(1000, 0, 0);
+	int *stable_value = &map.get_or_insert(stable_pos);
+	*stable_value = -1;
+	for (int i = 0; i < 5000; ++i) {
+		map.get_or_insert(Vector3i(i, 1000, 0)) = i;
+	}
+	for (int i = 0; i < 5000; i += 2) {
+		ZN_TEST_ASSERT(map.erase(Vector3i(i, 1000, 0)));
+	}
+	ZN_TEST_ASSERT(map.find(stable_pos) == stable_value);
+	ZN_TEST_ASSERT(*stable_value == -1);
+
+	SpatialHashMap<int> map_copy = map;
+	ZN_TEST_ASSERT(map_copy.size() == map.size());
+	ZN_TEST_ASSERT(map_copy.find(Vector3i(1, 1000, 0)) != nullptr && *map_copy.find(Vector3i(1, 1000, 0)) == 1);
+	ZN_TEST_ASSERT(map_copy.find(Vector3i(2, 1000, 0)) == nullptr);
+
+	map.clear();
+	ZN_TEST_ASSERT(map.size() == 0);
+	ZN_TEST_ASSERT(map.find(stable_pos) == nullptr);
+	map.get_or_insert(stable_pos) = 42;
+	ZN_TEST_ASSERT(map.size() == 1);
+	ZN_TEST_ASSERT(*map.find(stable_pos) == 42);
+}
+
+} // namespace zylann::tests
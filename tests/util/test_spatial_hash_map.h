@@ -0,0 +1,10 @@
+#ifndef ZN_TESTS_SPATIAL_HASH_MAP_H
+#define ZN_TESTS_SPATIAL_HASH_MAP_H
+
+namespace zylann::tests {
+
+void test_spatial_hash_map();
+
+} // namespace zylann::tests
+
+#endif // ZN_TESTS_SPATIAL_HASH_MAP_H
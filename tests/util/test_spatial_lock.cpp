@@ -6,8 +6,10 @@
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
 #include "../../util/tasks/threaded_task_runner.h"
+#include "../../util/thread/mutex.h"
 #include "../../util/thread/spatial_lock_3d.h"
 #include "../testing.h"
+#include <atomic>
 
 // #define VOXEL_TEST_TASK_POSTPONING_DUMP_EVENTS
 #ifdef VOXEL_TEST_TASK_POSTPONING_DUMP_EVENTS
@@ -438,4 +440,135 @@ void test_spatial_lock_dependent_map_chunks() {
 #endif
 }
 
+void test_spatial_lock_buckets() {
+	// Boxes are stored in hashed buckets. Boxes sharing buckets without intersecting must not exclude each other, boxes
+	// covering many buckets must still exclude those they intersect, and waiting threads must resume once the box they
+	// wait for gets unlocked.
+
+	struct Context {
+		SpatialLock3D spatial_lock;
+		std::atomic_bool locked = { false };
+	};
+
+	Context ctx;
+
+	// Read locks on overlapping boxes don't exclude each other, but write locks do
+	const BoxBounds3i box1 = BoxBounds3i::from_min_max_included(Vector3i(0, 0, 0), Vector3i(3, 3, 3));
+	ctx.spatial_lock.lock_read(box1);
+	{
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					SpatialLock3D &spatial_lock = static_cast<Context *>(userdata)->spatial_lock;
+
+					const BoxBounds3i box2 = BoxBounds3i::from_min_max_included(Vector3i(2, 2, 2), Vector3i(5, 5, 5));
+					ZN_TEST_ASSERT(spatial_lock.try_lock_read(box2) == true);
+					spatial_lock.unlock_read(box2);
+					ZN_TEST_ASSERT(spatial_lock.try_lock_write(box2) == false);
+
+					// Boxes far away may share buckets with the locked box, but don't intersect it
+					for (int i = 1; i <= 200; ++i) {
+						const BoxBounds3i far_box = BoxBounds3i::from_position(Vector3i(i * 37, -i * 11, i * 23));
+						ZN_TEST_ASSERT(spatial_lock.try_lock_write(far_box) == true);
+						spatial_lock.unlock_write(far_box);
+					}
+				},
+				&ctx);
+		thread.wait_to_finish();
+	}
+	ctx.spatial_lock.unlock_read(box1);
+
+	// A write lock excludes reads of overlapping boxes
+	ctx.spatial_lock.lock_write(box1);
+	{
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					SpatialLock3D &spatial_lock = static_cast<Context *>(userdata)->spatial_lock;
+					ZN_TEST_ASSERT(spatial_lock.try_lock_read(BoxBounds3i::from_position(Vector3i(3, 3, 3))) == false);
+					ZN_TEST_ASSERT(spatial_lock.try_lock_read(BoxBounds3i::from_position(Vector3i(5, 5, 5))) == true);
+					spatial_lock.unlock_read(BoxBounds3i::from_position(Vector3i(5, 5, 5)));
+				},
+				&ctx);
+		thread.wait_to_finish();
+	}
+	ctx.spatial_lock.unlock_write(box1);
+
+	// Boxes spanning several buckets, or too many to be stored in buckets
+	FixedArray<BoxBounds3i, 2> wide_boxes;
+	wide_boxes[0] = BoxBounds3i::from_min_max_included(Vector3i(-8, -8, -8), Vector3i(6, 6, 6));
+	wide_boxes[1] = BoxBounds3i::from_min_max_included(Vector3i(-100, -100, -100), Vector3i(100, 100, 100));
+
+	for (const BoxBounds3i &wide_box : wide_boxes) {
+		ctx.spatial_lock.lock_read(wide_box);
+
+		struct ThreadData {
+			Context *ctx;
+			BoxBounds3i wide_box;
+		};
+		ThreadData thread_data{ &ctx, wide_box };
+
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					ThreadData &data = *static_cast<ThreadData *>(userdata);
+					SpatialLock3D &spatial_lock = data.ctx->spatial_lock;
+
+					// Corners of the box are in different buckets
+					const Vector3i min_pos = data.wide_box.min_pos;
+					const Vector3i max_pos = data.wide_box.max_pos - Vector3i(1, 1, 1);
+					ZN_TEST_ASSERT(spatial_lock.try_lock_write(BoxBounds3i::from_position(min_pos)) == false);
+					ZN_TEST_ASSERT(spatial_lock.try_lock_write(BoxBounds3i::from_position(max_pos)) == false);
+
+					ZN_TEST_ASSERT(spatial_lock.try_lock_read(BoxBounds3i::from_position(max_pos)) == true);
+					spatial_lock.unlock_read(BoxBounds3i::from_position(max_pos));
+
+					const BoxBounds3i outside_box = BoxBounds3i::from_position(max_pos + Vector3i(10, 0, 0));
+					ZN_TEST_ASSERT(spatial_lock.try_lock_write(outside_box) == true);
+					spatial_lock.unlock_write(outside_box);
+				},
+				&thread_data);
+		thread.wait_to_finish();
+
+		ctx.spatial_lock.unlock_read(wide_box);
+	}
+
+	// A thread blocked on a box resumes when the box is unlocked
+	FixedArray<BoxBounds3i, 3> waited_boxes;
+	waited_boxes[0] = BoxBounds3i::from_position(Vector3i(2, 2, 2));
+	waited_boxes[1] = wide_boxes[0];
+	waited_boxes[2] = wide_boxes[1];
+
+	for (const BoxBounds3i &waited_box : waited_boxes) {
+		ctx.spatial_lock.lock_write(box1);
+		ctx.locked = false;
+
+		struct ThreadData {
+			Context *ctx;
+			BoxBounds3i box;
+		};
+		ThreadData thread_data{ &ctx, waited_box };
+
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					ThreadData &data = *static_cast<ThreadData *>(userdata);
+					data.ctx->spatial_lock.lock_write(data.box);
+					data.ctx->locked = true;
+					data.ctx->spatial_lock.unlock_write(data.box);
+				},
+				&thread_data);
+
+		// Give time to the thread to start waiting
+		Thread::sleep_usec(20000);
+		ZN_TEST_ASSERT(ctx.locked == false);
+
+		ctx.spatial_lock.unlock_write(box1);
+		thread.wait_to_finish();
+		ZN_TEST_ASSERT(ctx.locked == true);
+	}
+
+	ZN_TEST_ASSERT(ctx.spatial_lock.get_locked_boxes_count() == 0);
+}
+
 } // namespace zylann::tests
@@ -0,0 +1,149 @@
+#include "test_task_graph.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/memory/memory.h"
+#include "../../util/tasks/task_graph.h"
+#include "../../util/tasks/threaded_task_runner.h"
+#include "../testing.h"
+
+namespace zylann::tests {
+
+namespace {
+
+static const unsigned int TEST_TASK_COUNT = 8;
+
+struct TaskLog {
+	std::atomic_int next_order = { 0 };
+	// Order in which each task ran, or -1 if it didn't run
+	FixedArray<std::atomic_int, TEST_TASK_COUNT> run_orders;
+	std::atomic_int applied_count = { 0 };
+
+	TaskLog() {
+		for (std::atomic_int &order : run_orders) {
+			order = -1;
+		}
+	}
+};
+
+class TestTask : public IThreadedTask {
+public:
+	TestTask(TaskLog &log, unsigned int id, std::atomic_bool *gate = nullptr) : _log(log), _id(id), _gate(gate) {}
+
+	void run(ThreadedTaskContext &ctx) override {
+		if (_gate != nullptr) {
+			while (!*_gate) {
+				Thread::sleep_usec(1'000);
+			}
+		}
+		_log.run_orders[_id] = _log.next_order++;
+	}
+
+	void apply_result() override {
+		++_log.applied_count;
+	}
+
+private:
+	TaskLog &_log;
+	unsigned int _id;
+	std::atomic_bool *_gate;
+};
+
+void run_and_dequeue(ThreadedTaskRunner &runner) {
+	runner.wait_for_all_tasks();
+	runner.dequeue_completed_tasks([](IThreadedTask *task) {
+		task->apply_result();
+		ZN_DELETE(task);
+	});
+}
+
+} // namespace
+
+void test_task_graph_order() {
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(4);
+	runner.set_name("Test");
+
+	// Run several times since threads can pick tasks in different orders
+	for (unsigned int iteration = 0; iteration < 20; ++iteration) {
+		TaskLog log;
+
+		std::shared_ptr<TaskGraph> graph = make_shared_instance<TaskGraph>(runner);
+		FixedArray<TaskGraph::NodeID, TEST_TASK_COUNT> ids;
+		for (unsigned int i = 0; i < ids.size(); ++i) {
+			ids[i] = graph->add_task(ZN_NEW(TestTask(log, i)));
+		}
+
+		// 0 -> (1, 2) -> 3 -> 6 -> 7
+		// 4 -> 5
+		graph->add_dependency(ids[1], ids[0]);
+		graph->add_dependency(ids[2], ids[0]);
+		graph->add_dependency(ids[3], ids[1]);
+		graph->add_dependency(ids[3], ids[2]);
+		graph->add_dependency(ids[6], ids[3]);
+		graph->add_dependency(ids[7], ids[6]);
+		graph->add_dependency(ids[5], ids[4]);
+
+		TaskGraph::schedule(graph);
+		run_and_dequeue(runner);
+
+		ZN_TEST_ASSERT(graph->is_finished());
+		ZN_TEST_ASSERT(log.applied_count == TEST_TASK_COUNT);
+		ZN_TEST_ASSERT(log.run_orders[0] < log.run_orders[1]);
+		ZN_TEST_ASSERT(log.run_orders[0] < log.run_orders[2]);
+		ZN_TEST_ASSERT(log.run_orders[1] < log.run_orders[3]);
+		ZN_TEST_ASSERT(log.run_orders[2] < log.run_orders[3]);
+		ZN_TEST_ASSERT(log.run_orders[3] < log.run_orders[6]);
+		ZN_TEST_ASSERT(log.run_orders[6] < log.run_orders[7]);
+		ZN_TEST_ASSERT(log.run_orders[4] < log.run_orders[5]);
+	}
+}
+
+void test_task_graph_cancel() {
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(2);
+	runner.set_name("Test");
+
+	TaskLog log;
+	std::atomic_bool gate = { false };
+
+	std::shared_ptr<TaskGraph> graph = make_shared_instance<TaskGraph>(runner);
+	std::weak_ptr<TaskGraph> graph_weak = graph;
+
+	// The root task waits so we can cancel a branch before it gets released.
+	// 0 -> 1 -> 2
+	//   -> 3 -> 2
+	//   -> 4
+	const TaskGraph::NodeID root = graph->add_task(ZN_NEW(TestTask(log, 0, &gate)));
+	FixedArray<TaskGraph::NodeID, 4> ids;
+	for (unsigned int i = 0; i < ids.size(); ++i) {
+		ids[i] = graph->add_task(ZN_NEW(TestTask(log, i + 1)));
+	}
+	graph->add_dependency(ids[0], root);
+	graph->add_dependency(ids[1], ids[0]);
+	graph->add_dependency(ids[2], root);
+	graph->add_dependency(ids[1], ids[2]);
+	graph->add_dependency(ids[3], root);
+
+	TaskGraph::schedule(graph);
+	graph->cancel(ids[0]);
+	ZN_TEST_ASSERT(graph->is_cancelled(ids[0]));
+	// Depends on a cancelled task
+	ZN_TEST_ASSERT(graph->is_cancelled(ids[1]));
+	ZN_TEST_ASSERT(!graph->is_cancelled(ids[2]));
+
+	// Tasks keep the graph alive
+	graph = nullptr;
+	gate = true;
+	run_and_dequeue(runner);
+
+	ZN_TEST_ASSERT(log.run_orders[0] != -1);
+	ZN_TEST_ASSERT(log.run_orders[1] == -1);
+	ZN_TEST_ASSERT(log.run_orders[2] == -1);
+	ZN_TEST_ASSERT(log.run_orders[3] != -1);
+	ZN_TEST_ASSERT(log.run_orders[4] != -1);
+	// Cancelled tasks are destroyed without applying results
+	ZN_TEST_ASSERT(log.applied_count == 3);
+	// All tasks are gone, so the graph is too
+	ZN_TEST_ASSERT(graph_weak.expired());
+}
+
+} // namespace zylann::tests
@@ -0,0 +1,11 @@
+#ifndef ZN_TEST_TASK_GRAPH_H
+#define ZN_TEST_TASK_GRAPH_H
+
+namespace zylann::tests {
+
+void test_task_graph_order();
+void test_task_graph_cancel();
+
+} // namespace zylann::tests
+
+#endif // ZN_TEST_TASK_GRAPH_H
@@ -1,4 +1,5 @@
 #include "test_threaded_task_runner.h"
+#include "../../util/containers/fixed_array.h"
 #include "../../util/containers/std_unordered_map.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/os.h"
@@ -9,6 +10,7 @@
 #include "../../util/profiling.h"
 #include "../../util/string/format.h"
 #include "../../util/string/std_stringstream.h"
+#include "../../util/tasks/threaded_task_pool.h"
 #include "../../util/tasks/threaded_task_runner.h"
 #include "../testing.h"
 
@@ -266,6 +268,79 @@ void test_threaded_task_runner_debug_names() {
 	print_line(ss.str());
 }
 
+void test_threaded_task_runner_priority_order() {
+	// With a single thread, waiting tasks must run highest priority first, regardless of the order they were
+	// scheduled and whether they are serial or not.
+
+	static const unsigned int task_count = 16;
+
+	struct RunOrder {
+		std::atomic_uint32_t next_index = { 0 };
+		FixedArray<uint8_t, task_count> task_ids;
+	};
+
+	class GateTask : public IThreadedTask {
+	public:
+		std::atomic_bool started = { false };
+		std::atomic_bool released = { false };
+
+		void run(ThreadedTaskContext &ctx) override {
+			started = true;
+			while (!released) {
+				Thread::sleep_usec(1'000);
+			}
+		}
+	};
+
+	class TestTask : public IThreadedTask {
+	public:
+		std::shared_ptr<RunOrder> order;
+		uint8_t id;
+
+		TestTask(std::shared_ptr<RunOrder> p_order, uint8_t p_id) : order(p_order), id(p_id) {}
+
+		void run(ThreadedTaskContext &ctx) override {
+			const uint32_t i = order->next_index++;
+			ZN_ASSERT(i < order->task_ids.size());
+			order->task_ids[i] = id;
+		}
+
+		TaskPriority get_priority() override {
+			return TaskPriority(id, 0, 0, 0);
+		}
+	};
+
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(1);
+	runner.set_name("Test");
+
+	// Keep the only thread busy while tasks get scheduled, so they all wait in the queue
+	GateTask *gate_task = ZN_NEW(GateTask);
+	runner.enqueue(gate_task, false);
+	while (!gate_task->started) {
+		Thread::sleep_usec(1'000);
+	}
+
+	std::shared_ptr<RunOrder> order = make_shared_instance<RunOrder>();
+	for (unsigned int i = 0; i < task_count; ++i) {
+		// Scatter priorities so they don't come in order
+		const uint8_t id = (i * 7) % task_count;
+		TestTask *task = ZN_NEW(TestTask(order, id));
+		runner.enqueue(task, (id & 1) == 0);
+	}
+
+	gate_task->released = true;
+	runner.wait_for_all_tasks();
+	runner.dequeue_completed_tasks([](IThreadedTask *task) {
+		ZN_DELETE(task);
+	});
+
+	ZN_TEST_ASSERT(order->next_index == task_count);
+	for (unsigned int i = 0; i < task_count; ++i) {
+		ZN_TEST_ASSERT(order->task_ids[i] == task_count - 1 - i);
+	}
+}
+
 void test_task_priority_values() {
 	ZN_TEST_ASSERT(TaskPriority(0, 0, 0, 0) < TaskPriority(1, 0, 0, 0));
 	ZN_TEST_ASSERT(TaskPriority(0, 0, 0, 0) < TaskPriority(0, 0, 0, 1));
@@ -457,4 +532,184 @@ void test_threaded_task_postponing() {
 #endif
 }
 
+void test_threaded_task_pool() {
+	class PooledTask : public IThreadedTask {
+	public:
+		PooledTask(std::atomic_uint32_t &p_run_count) : _run_count(p_run_count) {}
+
+		void run(ThreadedTaskContext &ctx) override {
+			++_run_count;
+		}
+
+		void dispose() override {
+			ThreadedTaskPool<PooledTask>::get_singleton().recycle(this);
+		}
+
+	private:
+		std::atomic_uint32_t &_run_count;
+	};
+
+	ThreadedTaskPool<PooledTask> &pool = ThreadedTaskPool<PooledTask>::get_singleton();
+	std::atomic_uint32_t run_count = { 0 };
+	static const unsigned int task_count = 100;
+
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(4);
+	runner.set_name("Test");
+
+	// Run two waves of tasks, the second one should reuse memory released by the first
+	for (unsigned int wave = 0; wave < 2; ++wave) {
+		StdVector<IThreadedTask *> tasks;
+		for (unsigned int i = 0; i < task_count; ++i) {
+			tasks.push_back(pool.create(run_count));
+		}
+		runner.enqueue(to_span(tasks), false);
+		runner.wait_for_all_tasks();
+		runner.dequeue_completed_tasks([](IThreadedTask *task) { task->dispose(); });
+
+		ZN_TEST_ASSERT(pool.get_free_count() >= task_count);
+	}
+
+	ZN_TEST_ASSERT(run_count == 2 * task_count);
+}
+
+void test_threaded_task_runner_thread_limit() {
+	struct TaskCounter {
+		std::atomic_uint32_t max_count = { 0 };
+		std::atomic_uint32_t current_count = { 0 };
+		std::atomic_uint32_t completed_count = { 0 };
+	};
+
+	class TestTask : public IThreadedTask {
+	public:
+		TestTask(TaskCounter &p_counter) : _counter(p_counter) {}
+
+		void run(ThreadedTaskContext &ctx) override {
+			const uint32_t current_count = ++_counter.current_count;
+			uint32_t prev_max = _counter.max_count;
+			while (prev_max < current_count && !_counter.max_count.compare_exchange_weak(prev_max, current_count)) {
+			}
+			Thread::sleep_usec(20'000);
+			--_counter.current_count;
+			++_counter.completed_count;
+		}
+
+	private:
+		TaskCounter &_counter;
+	};
+
+	struct L {
+		static void run_tasks(ThreadedTaskRunner &runner, TaskCounter &counter, unsigned int task_count) {
+			counter.max_count = 0;
+			counter.completed_count = 0;
+			for (unsigned int i = 0; i < task_count; ++i) {
+				runner.enqueue(ZN_NEW(TestTask(counter)), false);
+			}
+			runner.wait_for_all_tasks();
+			runner.dequeue_completed_tasks([](IThreadedTask *task) { ZN_DELETE(task); });
+		}
+	};
+
+	TaskCounter counter;
+
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(4);
+	runner.set_name("Test");
+	ZN_TEST_ASSERT(runner.get_thread_limit() == 4);
+
+	runner.set_thread_limit(2);
+	L::run_tasks(runner, counter, 12);
+	ZN_TEST_ASSERT(counter.completed_count == 12);
+	ZN_TEST_ASSERT(counter.max_count <= 2);
+
+	// At least one thread keeps running
+	runner.set_thread_limit(0);
+	ZN_TEST_ASSERT(runner.get_thread_limit() == 1);
+	L::run_tasks(runner, counter, 4);
+	ZN_TEST_ASSERT(counter.completed_count == 4);
+	ZN_TEST_ASSERT(counter.max_count == 1);
+
+	// Parked threads resume
+	runner.set_thread_limit(10);
+	ZN_TEST_ASSERT(runner.get_thread_limit() == 4);
+	L::run_tasks(runner, counter, 16);
+	ZN_TEST_ASSERT(counter.completed_count == 16);
+	ZN_TEST_ASSERT(counter.max_count <= 4);
+}
+
+void test_threaded_task_runner_groups() {
+	struct TaskCounter {
+		std::atomic_uint32_t max_count = { 0 };
+		std::atomic_uint32_t current_count = { 0 };
+	};
+
+	class TestTask : public IThreadedTask {
+	public:
+		TestTask(TaskCounter &p_counter, int p_group) : _counter(p_counter), _group(p_group) {}
+
+		void run(ThreadedTaskContext &ctx) override {
+			const uint32_t current_count = ++_counter.current_count;
+			uint32_t prev_max = _counter.max_count;
+			while (prev_max < current_count && !_counter.max_count.compare_exchange_weak(prev_max, current_count)) {
+			}
+			Thread::sleep_usec(10'000);
+			--_counter.current_count;
+		}
+
+		int get_group() const override {
+			return _group;
+		}
+
+	private:
+		TaskCounter &_counter;
+		int _group;
+	};
+
+	TaskCounter limited_counter;
+	TaskCounter unlimited_counter;
+	TaskCounter ungrouped_counter;
+
+	ThreadedTaskRunner runner;
+	runner.set_thread_count(4);
+	runner.set_name("Test");
+
+	ThreadedTaskRunner::GroupSettings limited_settings;
+	limited_settings.max_running = 1;
+	runner.set_group_settings(0, limited_settings);
+
+	ThreadedTaskRunner::GroupSettings weighted_settings;
+	weighted_settings.weight = 3;
+	weighted_settings.min_threads = 1;
+	runner.set_group_settings(5, weighted_settings);
+
+	StdVector<IThreadedTask *> tasks;
+	for (unsigned int i = 0; i < 12; ++i) {
+		tasks.push_back(ZN_NEW(TestTask(limited_counter, 0)));
+		tasks.push_back(ZN_NEW(TestTask(unlimited_counter, 5)));
+		tasks.push_back(ZN_NEW(TestTask(ungrouped_counter, -1)));
+	}
+	runner.enqueue(to_span(tasks), false);
+	runner.wait_for_all_tasks();
+
+	unsigned int completed_count = 0;
+	runner.dequeue_completed_tasks([&completed_count](IThreadedTask *task) {
+		++completed_count;
+		ZN_DELETE(task);
+	});
+	ZN_TEST_ASSERT(completed_count == tasks.size());
+	ZN_TEST_ASSERT(limited_counter.max_count == 1);
+	ZN_TEST_ASSERT(unlimited_counter.max_count <= 4);
+
+	for (const uint32_t group : { 0u, 5u }) {
+		const ThreadedTaskRunner::GroupStats stats = runner.get_group_stats(group);
+		ZN_TEST_ASSERT(stats.pending == 0);
+		ZN_TEST_ASSERT(stats.running == 0);
+		ZN_TEST_ASSERT(stats.completed == 12);
+	}
+
+	runner.reset_group(0);
+	ZN_TEST_ASSERT(runner.get_group_stats(0).completed == 0);
+	ZN_TEST_ASSERT(runner.get_group_settings(0).max_running == 0);
+}
+
 } // namespace zylann::tests
@@ -5,8 +5,12 @@ namespace zylann::tests {
 
 void test_threaded_task_runner_misc();
 void test_threaded_task_runner_debug_names();
+void test_threaded_task_runner_priority_order();
 void test_task_priority_values();
 void test_threaded_task_postponing();
+void test_threaded_task_pool();
+void test_threaded_task_runner_thread_limit();
+void test_threaded_task_runner_groups();
 
 } // namespace zylann::tests
 
@@ -0,0 +1,376 @@
+#include "benchmark_voxel_graph.h"
+#include "../../generators/graph/node_type_db.h"
+#include "../../generators/graph/simd/graph_kernels.h"
+#include "../../generators/graph/voxel_generator_graph.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/image.h"
+#include "../../util/godot/core/string.h"
+#include "../../util/io/log.h"
+#include "../../util/math/funcs.h"
+#include "../../util/noise/fast_noise_lite/fast_noise_lite.h"
+#include "../../util/profiling_clock.h"
+#include "../../util/string/format.h"
+#include <limits>
+
+namespace zylann::voxel::tests {
+
+using namespace pg;
+
+namespace {
+
+// Each case runs several times, and the fastest pass is kept to reduce noise
+const unsigned int PASS_COUNT = 3;
+// Values generated per pass, so timings are well above clock resolution regardless of series size
+const unsigned int VALUES_PER_PASS = 1 << 20;
+const unsigned int MAX_SERIES_SIZE = 32768;
+
+struct GraphBenchmarkPositions {
+	StdVector<float> x;
+	StdVector<float> y;
+	StdVector<float> z;
+	StdVector<float> sdf;
+
+	GraphBenchmarkPositions() {
+		x.resize(MAX_SERIES_SIZE);
+		y.resize(MAX_SERIES_SIZE);
+		z.resize(MAX_SERIES_SIZE);
+		sdf.resize(MAX_SERIES_SIZE);
+		// A 32x32x32 area around the origin, in the same order as blocks
+		for (unsigned int i = 0; i < MAX_SERIES_SIZE; ++i) {
+			x[i] = static_cast<float>(i & 31) - 16.f;
+			y[i] = static_cast<float>((i >> 10) & 31) - 16.f;
+			z[i] = static_cast<float>((i >> 5) & 31) - 16.f;
+			sdf[i] = y[i];
+		}
+	}
+};
+
+void set_noise_seed(VoxelGraphFunction &g, uint32_t node_id, int seed, float period) {
+	Ref<ZN_FastNoiseLite> noise = g.get_node_param(node_id, 0);
+	ZN_ASSERT_RETURN(noise.is_valid());
+	noise->set_seed(seed);
+	noise->set_period(period);
+}
+
+// The node gets X, Y and Z as inputs, in turn, and its first output goes to the SDF output
+void load_single_node_graph(VoxelGraphFunction &g, VoxelGraphFunction::NodeTypeID type_id, Ref<Image> image) {
+	const NodeType &type = NodeTypeDB::get_singleton().get_type(type_id);
+
+	const uint32_t n_x = g.create_node(VoxelGraphFunction::NODE_INPUT_X);
+	const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y);
+	const uint32_t n_z = g.create_node(VoxelGraphFunction::NODE_INPUT_Z);
+	const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF);
+	const uint32_t n = g.create_node(type_id);
+
+	switch (type_id) {
+		case VoxelGraphFunction::NODE_IMAGE_2D:
+			g.set_node_param(n, 0, image);
+			break;
+
+		case VoxelGraphFunction::NODE_EXPRESSION: {
+			g.set_node_param(n, 0, "0.1 * x + 0.2 * z + min(y, 0.5)");
+			PackedStringArray var_names;
+			var_names.push_back("x");
+			var_names.push_back("y");
+			var_names.push_back("z");
+			g.set_expression_node_inputs(n, var_names);
+		} break;
+
+		default:
+			break;
+	}
+
+	const uint32_t axes[3] = { n_x, n_y, n_z };
+	const unsigned int input_count = g.get_node_input_count(n);
+	for (unsigned int i = 0; i < input_count; ++i) {
+		// Ports with a hint get connected automatically to the matching axis
+		if (i < type.inputs.size() && type.inputs[i].auto_connect != VoxelGraphFunction::AUTO_CONNECT_NONE) {
+			continue;
+		}
+		g.add_connection(axes[i % 3], 0, n, i);
+	}
+
+	g.add_connection(n, 0, n_out, 0);
+}
+
+void load_caves_graph(VoxelGraphFunction &g) {
+	//                         SdfPlane
+	//                                 \
+	//   FastNoise3D --- Abs --- - --- SdfSmoothSubtract --- Sdf
+	//                          /
+	//                        0.1
+
+	const uint32_t n_plane = g.create_node(VoxelGraphFunction::NODE_SDF_PLANE);
+	const uint32_t n_noise = g.create_node(VoxelGraphFunction::NODE_FAST_NOISE_3D);
+	const uint32_t n_abs = g.create_node(VoxelGraphFunction::NODE_ABS);
+	const uint32_t n_sub = g.create_node(VoxelGraphFunction::NODE_SUBTRACT);
+	const uint32_t n_carve = g.create_node(VoxelGraphFunction::NODE_SDF_SMOOTH_SUBTRACT);
+	const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF);
+
+	set_noise_seed(g, n_noise, 131183, 32.f);
+	g.set_node_default_input(n_sub, 1, 0.1f);
+	g.set_node_param(n_carve, 0, 2.f);
+
+	g.add_connection(n_noise, 0, n_abs, 0);
+	g.add_connection(n_abs, 0, n_sub, 0);
+	g.add_connection(n_plane, 0, n_carve, 0);
+	g.add_connection(n_sub, 0, n_carve, 1);
+	g.add_connection(n_carve, 0, n_out, 0);
+}
+
+void load_planet_graph(VoxelGraphFunction &g) {
+	//              X
+	//               \
+	//   Y --- + --- SdfSphere --- + --- Sdf
+	//        /      /            /
+	//     100      Z            *
+	//                          / \
+	//                FastNoise3D  8
+
+	const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y);
+	const uint32_t n_center = g.create_node(VoxelGraphFunction::NODE_ADD);
+	const uint32_t n_sphere = g.create_node(VoxelGraphFunction::NODE_SDF_SPHERE);
+	const uint32_t n_noise = g.create_node(VoxelGraphFunction::NODE_FAST_NOISE_3D);
+	const uint32_t n_amplitude = g.create_node(VoxelGraphFunction::NODE_MULTIPLY);
+	const uint32_t n_add = g.create_node(VoxelGraphFunction::NODE_ADD);
+	const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF);
+
+	g.set_node_default_input(n_center, 1, 100.f);
+	g.set_node_param(n_sphere, 0, 100.f);
+	set_noise_seed(g, n_noise, 131183, 64.f);
+	g.set_node_default_input(n_amplitude, 1, 8.f);
+
+	g.add_connection(n_y, 0, n_center, 0);
+	g.add_connection(n_center, 0, n_sphere, 1);
+	g.add_connection(n_noise, 0, n_amplitude, 0);
+	g.add_connection(n_sphere, 0, n_add, 0);
+	g.add_connection(n_amplitude, 0, n_add, 1);
+	g.add_connection(n_add, 0, n_out, 0);
+}
+
+void load_biome_blend_graph(VoxelGraphFunction &g) {
+	//   FastNoise2D --- * -------- Mix --- SdfPlane --- Sdf
+	//                  /          / /     (height)
+	//                 8          / /
+	//   FastNoise2D --- * ------- /
+	//                  /         /
+	//                60         /
+	//   FastNoise2D --- ClampC -
+
+	const uint32_t n_plains_noise = g.create_node(VoxelGraphFunction::NODE_FAST_NOISE_2D);
+	const uint32_t n_plains = g.create_node(VoxelGraphFunction::NODE_MULTIPLY);
+	const uint32_t n_mountains_noise = g.create_node(VoxelGraphFunction::NODE_FAST_NOISE_2D);
+	const uint32_t n_mountains = g.create_node(VoxelGraphFunction::NODE_MULTIPLY);
+	const uint32_t n_biome_noise = g.create_node(VoxelGraphFunction::NODE_FAST_NOISE_2D);
+	const uint32_t n_biome = g.create_node(VoxelGraphFunction::NODE_CLAMP_C);
+	const uint32_t n_mix = g.create_node(VoxelGraphFunction::NODE_MIX);
+	const uint32_t n_plane = g.create_node(VoxelGraphFunction::NODE_SDF_PLANE);
+	const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF);
+
+	set_noise_seed(g, n_plains_noise, 1, 128.f);
+	set_noise_seed(g, n_mountains_noise, 2, 64.f);
+	set_noise_seed(g, n_biome_noise, 3, 512.f);
+	g.set_node_default_input(n_plains, 1, 8.f);
+	g.set_node_default_input(n_mountains, 1, 60.f);
+	g.set_node_param(n_biome, 0, 0.f);
+	g.set_node_param(n_biome, 1, 1.f);
+
+	g.add_connection(n_plains_noise, 0, n_plains, 0);
+	g.add_connection(n_mountains_noise, 0, n_mountains, 0);
+	g.add_connection(n_biome_noise, 0, n_biome, 0);
+	g.add_connection(n_plains, 0, n_mix, 0);
+	g.add_connection(n_mountains, 0, n_mix, 1);
+	g.add_connection(n_biome, 0, n_mix, 2);
+	g.add_connection(n_mix, 0, n_plane, 1);
+	g.add_connection(n_plane, 0, n_out, 0);
+}
+
+Ref<Image> make_benchmark_image() {
+	const int size = 256;
+	Ref<Image> image = zylann::godot::create_empty_image(size, size, false, Image::FORMAT_RF);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			const float h = 0.5f + 0.25f * (Math::sin(x * 0.1f) + Math::cos(y * 0.13f));
+			image->set_pixel(x, y, Color(h, h, h));
+		}
+	}
+	return image;
+}
+
+void run_series_benchmark(
+		VoxelGeneratorGraph &generator,
+		const StdString &graph_name,
+		simd::SIMDLevel simd_level,
+		unsigned int series_size,
+		GraphBenchmarkPositions &positions
+) {
+	Span<float> x = to_span_from_position_and_size(positions.x, 0, series_size);
+	Span<float> y = to_span_from_position_and_size(positions.y, 0, series_size);
+	Span<float> z = to_span_from_position_and_size(positions.z, 0, series_size);
+	Span<float> sdf = to_span_from_position_and_size(positions.sdf, 0, series_size);
+
+	const unsigned int iterations = math::max(VALUES_PER_PASS / series_size, 1u);
+
+	// Warm up thread-local caches
+	generator.generate_series(x, y, z, sdf);
+
+	uint64_t best_time_us = std::numeric_limits<uint64_t>::max();
+
+	for (unsigned int pass = 0; pass < PASS_COUNT; ++pass) {
+		ProfilingClock profiling_clock;
+		for (unsigned int i = 0; i < iterations; ++i) {
+			generator.generate_series(x, y, z, sdf);
+		}
+		best_time_us = math::min(best_time_us, profiling_clock.get_elapsed_microseconds());
+	}
+
+	const double ns_per_voxel = 1000.0 * best_time_us / (double(iterations) * series_size);
+
+	print_line(format(
+			"graph={} simd={} series_size={} time_us={} ns_per_voxel={}",
+			graph_name,
+			simd::get_simd_level_name(simd_level),
+			series_size,
+			best_time_us,
+			ns_per_voxel
+	));
+}
+
+void run_block_benchmark(
+		VoxelGeneratorGraph &generator,
+		const StdString &graph_name,
+		simd::SIMDLevel simd_level,
+		int block_size
+) {
+	// Blocks around the origin, where reference graphs have their surfaces, so they can't all be skipped by range
+	// analysis
+	StdVector<Vector3i> origins;
+	for (int bz = -2; bz < 2; ++bz) {
+		for (int by = -1; by < 1; ++by) {
+			for (int bx = -2; bx < 2; ++bx) {
+				origins.push_back(Vector3i(bx, by, bz) * block_size);
+			}
+		}
+	}
+
+	VoxelBuffer buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+	buffer.create(Vector3iUtil::create(block_size));
+
+	uint64_t best_time_us = std::numeric_limits<uint64_t>::max();
+
+	// The first pass warms up caches and is not counted
+	for (unsigned int pass = 0; pass < PASS_COUNT + 1; ++pass) {
+		ProfilingClock profiling_clock;
+		for (const Vector3i origin : origins) {
+			VoxelGenerator::VoxelQueryData query{ buffer, origin, 0 };
+			generator.generate_block(query);
+		}
+		if (pass > 0) {
+			best_time_us = math::min(best_time_us, profiling_clock.get_elapsed_microseconds());
+		}
+	}
+
+	const uint64_t voxel_count = origins.size() * Vector3iUtil::get_volume(buffer.get_size());
+	const double ns_per_voxel = 1000.0 * best_time_us / voxel_count;
+
+	print_line(format(
+			"graph={} simd={} block_size={} blocks={} time_us={} ns_per_voxel={}",
+			graph_name,
+			simd::get_simd_level_name(simd_level),
+			block_size,
+			origins.size(),
+			best_time_us,
+			ns_per_voxel
+	));
+}
+
+} // namespace
+
+void run_voxel_graph_benchmarks() {
+	print_line("------------ Voxel graph benchmarks begin -------------");
+
+	const unsigned int series_sizes[] = { 64, 512, 4096, MAX_SERIES_SIZE };
+	const int block_sizes[] = { 16, 32 };
+
+	GraphBenchmarkPositions positions;
+	Ref<Image> image = make_benchmark_image();
+
+	struct ReferenceGraph {
+		const char *name;
+		void (*load)(VoxelGraphFunction &g);
+	};
+	const ReferenceGraph reference_graphs[] = {
+		{ "plane", nullptr },
+		{ "caves", &load_caves_graph },
+		{ "planet", &load_planet_graph },
+		{ "biome_blend", &load_biome_blend_graph },
+	};
+
+	const NodeTypeDB &type_db = NodeTypeDB::get_singleton();
+
+	for (unsigned int level_index = 0; level_index < simd::SIMD_LEVEL_COUNT; ++level_index) {
+		const simd::SIMDLevel simd_level = static_cast<simd::SIMDLevel>(level_index);
+		if (!simd::is_simd_level_supported(simd_level)) {
+			continue;
+		}
+		simd::set_active_simd_level(simd_level);
+
+		for (unsigned int type_index = 0; type_index < VoxelGraphFunction::NODE_TYPE_COUNT; ++type_index) {
+			const VoxelGraphFunction::NodeTypeID type_id = static_cast<VoxelGraphFunction::NodeTypeID>(type_index);
+			const NodeType &type = type_db.get_type(type_index);
+
+			if (type.category == CATEGORY_INPUT || type.category == CATEGORY_OUTPUT || type.debug_only ||
+				type.outputs.size() == 0 || type_id == VoxelGraphFunction::NODE_FUNCTION) {
+				continue;
+			}
+
+			const StdString graph_name = zylann::godot::to_std_string(type.name);
+
+			Ref<VoxelGeneratorGraph> generator;
+			generator.instantiate();
+			load_single_node_graph(**generator->get_main_function(), type_id, image);
+
+			const CompilationResult result = generator->compile(false);
+			if (!result.success) {
+				print_line(format(
+						"graph={} simd={} skipped=\"{}\"",
+						graph_name,
+						simd::get_simd_level_name(simd_level),
+						zylann::godot::to_std_string(result.message)
+				));
+				continue;
+			}
+
+			for (const unsigned int series_size : series_sizes) {
+				run_series_benchmark(**generator, graph_name, simd_level, series_size, positions);
+			}
+		}
+
+		for (const ReferenceGraph &rg : reference_graphs) {
+			Ref<VoxelGeneratorGraph> generator;
+			generator.instantiate();
+			if (rg.load == nullptr) {
+				generator->load_plane_preset();
+			} else {
+				rg.load(**generator->get_main_function());
+			}
+
+			const CompilationResult result = generator->compile(false);
+			ZN_ASSERT_CONTINUE_MSG(result.success, zylann::godot::to_std_string(result.message));
+
+			for (const unsigned int series_size : series_sizes) {
+				run_series_benchmark(**generator, rg.name, simd_level, series_size, positions);
+			}
+			for (const int block_size : block_sizes) {
+				run_block_benchmark(**generator, rg.name, simd_level, block_size);
+			}
+		}
+	}
+
+	simd::set_active_simd_level(simd::get_simd_level());
+
+	print_line("------------ Voxel graph benchmarks end -------------");
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,12 @@
+#ifndef VOXEL_TESTS_BENCHMARK_VOXEL_GRAPH_H
+#define VOXEL_TESTS_BENCHMARK_VOXEL_GRAPH_H
+
+namespace zylann::voxel::tests {
+
+// Measures nanoseconds per voxel of every graph node type, and of a few reference graphs, with several buffer sizes and
+// every SIMD level supported by the CPU. Prints one line of results per case.
+void run_voxel_graph_benchmarks();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TESTS_BENCHMARK_VOXEL_GRAPH_H
@@ -0,0 +1,358 @@
+#include "benchmark_voxel_meshers.h"
+#include "../../meshers/blocky/voxel_blocky_library.h"
+#include "../../meshers/blocky/voxel_blocky_model_cube.h"
+#include "../../meshers/blocky/voxel_blocky_model_empty.h"
+#include "../../meshers/blocky/voxel_mesher_blocky.h"
+#include "../../meshers/cubes/voxel_mesher_cubes.h"
+#include "../../meshers/transvoxel/voxel_mesher_transvoxel.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../streams/vox/vox_data.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/godot/classes/mesh.h"
+#include "../../util/io/log.h"
+#include "../../util/math/box3i.h"
+#include "../../util/math/funcs.h"
+#include "../../util/memory/std_allocator.h"
+#include "../../util/noise/fast_noise_lite/fast_noise_lite.h"
+#include "../../util/profiling_clock.h"
+#include "../../util/string/format.h"
+#include <limits>
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+// Each case is meshed several times, and the fastest pass is kept to reduce noise
+const unsigned int PASS_COUNT = 3;
+
+// Voxels are stored in ZXY order, like VoxelBuffer
+struct MesherBenchmarkDataset {
+	StdString name;
+	Vector3i size;
+	// Negative inside matter
+	StdVector<float> sdf;
+	// Indices into `palette`. 0 is air.
+	StdVector<uint8_t> colors;
+	FixedArray<Color8, 256> palette;
+};
+
+enum MesherBenchmarkFormat { //
+	FORMAT_SDF,
+	FORMAT_TYPE,
+	FORMAT_COLOR
+};
+
+template <typename F>
+MesherBenchmarkDataset make_dataset(const char *name, const Vector3i size, F sdf_func) {
+	MesherBenchmarkDataset ds;
+	ds.name = name;
+	ds.size = size;
+
+	const unsigned int volume = Vector3iUtil::get_volume(size);
+	ds.sdf.resize(volume);
+	ds.colors.resize(volume);
+
+	fill(ds.palette, Color8(0, 0, 0, 0));
+	ds.palette[1] = Color8(96, 160, 64, 255);
+	ds.palette[2] = Color8(128, 96, 64, 255);
+	ds.palette[3] = Color8(128, 128, 128, 255);
+	ds.palette[4] = Color8(224, 208, 160, 255);
+
+	unsigned int i = 0;
+	for (int z = 0; z < size.z; ++z) {
+		for (int x = 0; x < size.x; ++x) {
+			for (int y = 0; y < size.y; ++y) {
+				const float sd = sdf_func(Vector3i(x, y, z));
+				ds.sdf[i] = sd;
+				// Layers of different colors, so greedy meshing can't merge everything
+				ds.colors[i] = sd < 0.f ? 1 + (y / 4) % 4 : 0;
+				++i;
+			}
+		}
+	}
+
+	return ds;
+}
+
+bool load_vox_dataset(const String &fpath, MesherBenchmarkDataset &ds) {
+	magica::Data data;
+	const Error err = data.load_from_file(fpath);
+	if (err != OK || data.get_model_count() == 0) {
+		ZN_PRINT_ERROR(format("Could not load {}", to_std_string(fpath)));
+		return false;
+	}
+
+	const magica::Model &model = data.get_model(0);
+	ds.name = to_std_string(fpath.get_file());
+	ds.size = model.size;
+	ds.colors = model.color_indexes;
+	ds.palette = data.get_palette();
+
+	// Only the shape is available, so SDF meshers get a binary field
+	ds.sdf.resize(ds.colors.size());
+	for (unsigned int i = 0; i < ds.colors.size(); ++i) {
+		ds.sdf[i] = ds.colors[i] == 0 ? 1.f : -1.f;
+	}
+
+	return true;
+}
+
+unsigned int get_channel(const MesherBenchmarkFormat format) {
+	switch (format) {
+		case FORMAT_SDF:
+			return VoxelBuffer::CHANNEL_SDF;
+		case FORMAT_TYPE:
+			return VoxelBuffer::CHANNEL_TYPE;
+		case FORMAT_COLOR:
+			return VoxelBuffer::CHANNEL_COLOR;
+		default:
+			ZN_CRASH();
+			return 0;
+	}
+}
+
+// Cuts the dataset into padded blocks, the same way terrains feed meshers
+void create_blocks(
+		const MesherBenchmarkDataset &ds,
+		const int block_size,
+		const VoxelMesher &mesher,
+		const VoxelBuffer::Depth depth,
+		const MesherBenchmarkFormat format,
+		StdVector<VoxelBuffer> &out_blocks,
+		StdVector<Vector3i> &out_origins
+) {
+	const Vector3i min_padding = Vector3iUtil::create(mesher.get_minimum_padding());
+	const Vector3i padded_size =
+			Vector3iUtil::create(block_size + mesher.get_minimum_padding() + mesher.get_maximum_padding());
+	const Vector3i block_count = (ds.size + Vector3iUtil::create(block_size - 1)) / block_size;
+	const unsigned int channel = get_channel(format);
+	const Box3i ds_box(Vector3i(), ds.size);
+
+	out_blocks.reserve(Vector3iUtil::get_volume(block_count));
+
+	Vector3i bpos;
+	for (bpos.z = 0; bpos.z < block_count.z; ++bpos.z) {
+		for (bpos.x = 0; bpos.x < block_count.x; ++bpos.x) {
+			for (bpos.y = 0; bpos.y < block_count.y; ++bpos.y) {
+				const Vector3i origin = bpos * block_size;
+
+				out_blocks.emplace_back(VoxelBuffer::ALLOCATOR_DEFAULT);
+				VoxelBuffer &voxels = out_blocks.back();
+				voxels.create(padded_size);
+				voxels.set_channel_depth(channel, depth);
+
+				Vector3i pos;
+				for (pos.z = 0; pos.z < padded_size.z; ++pos.z) {
+					for (pos.x = 0; pos.x < padded_size.x; ++pos.x) {
+						for (pos.y = 0; pos.y < padded_size.y; ++pos.y) {
+							const Vector3i ds_pos = origin - min_padding + pos;
+
+							// Outside of the dataset is air
+							float sd = 1.f;
+							uint8_t color_index = 0;
+							if (ds_box.contains(ds_pos)) {
+								const unsigned int i = Vector3iUtil::get_zxy_index(ds_pos, ds.size);
+								sd = ds.sdf[i];
+								color_index = ds.colors[i];
+							}
+
+							switch (format) {
+								case FORMAT_SDF:
+									voxels.set_voxel_f(sd, pos, channel);
+									break;
+								case FORMAT_TYPE:
+									// The library only has air and a cube
+									voxels.set_voxel(sd < 0.f ? 1 : 0, pos, channel);
+									break;
+								case FORMAT_COLOR:
+									if (color_index != 0) {
+										const Color8 color = ds.palette[color_index];
+										voxels.set_voxel(
+												depth == VoxelBuffer::DEPTH_8_BIT ? color.to_u8() : color.to_u16(),
+												pos,
+												channel
+										);
+									}
+									break;
+							}
+						}
+					}
+				}
+
+				// Terrains compress uniform blocks, which meshers handle with fast paths
+				voxels.compress_uniform_channels();
+
+				out_origins.push_back(origin);
+			}
+		}
+	}
+}
+
+uint64_t get_triangle_count(const VoxelMesher::Output &output) {
+	uint64_t count = 0;
+	for (const VoxelMesher::Output::Surface &surface : output.surfaces) {
+		if (surface.arrays.size() != Mesh::ARRAY_MAX) {
+			continue;
+		}
+		const PackedInt32Array indices = surface.arrays[Mesh::ARRAY_INDEX];
+		count += indices.size() / 3;
+	}
+	return count;
+}
+
+void run_mesher_benchmark(
+		VoxelMesher &mesher,
+		const char *mesher_name,
+		const MesherBenchmarkDataset &ds,
+		const int block_size,
+		const VoxelBuffer::Depth depth,
+		const MesherBenchmarkFormat format
+) {
+	StdVector<VoxelBuffer> blocks;
+	StdVector<Vector3i> origins;
+	create_blocks(ds, block_size, mesher, depth, format, blocks, origins);
+
+#ifdef DEBUG_ENABLED
+	const uint64_t std_current_before =
+			StdDefaultAllocatorCounters::g_allocated - StdDefaultAllocatorCounters::g_deallocated;
+#endif
+
+	uint64_t best_time_us = std::numeric_limits<uint64_t>::max();
+	uint64_t triangle_count = 0;
+	int64_t allocated_bytes = -1;
+
+	for (unsigned int pass_index = 0; pass_index < PASS_COUNT; ++pass_index) {
+#ifdef DEBUG_ENABLED
+		const uint64_t std_allocated_before = StdDefaultAllocatorCounters::g_allocated;
+#endif
+		triangle_count = 0;
+
+		ProfilingClock clock;
+
+		for (unsigned int i = 0; i < blocks.size(); ++i) {
+			VoxelMesher::Input input{ blocks[i], nullptr, origins[i], 0, false };
+			VoxelMesher::Output output;
+			mesher.build(output, input);
+			triangle_count += get_triangle_count(output);
+		}
+
+		best_time_us = math::min(best_time_us, clock.get_elapsed_microseconds());
+
+#ifdef DEBUG_ENABLED
+		// Only the last pass is kept, after thread-local caches have grown
+		allocated_bytes = StdDefaultAllocatorCounters::g_allocated - std_allocated_before;
+#endif
+	}
+
+	// Memory kept by meshers after they are done, mostly thread-local caches
+	int64_t retained_bytes = -1;
+#ifdef DEBUG_ENABLED
+	retained_bytes = int64_t(StdDefaultAllocatorCounters::g_allocated - StdDefaultAllocatorCounters::g_deallocated) -
+			int64_t(std_current_before);
+#endif
+
+	const uint64_t voxel_count = blocks.size() * Vector3iUtil::get_volume(Vector3iUtil::create(block_size));
+	const double seconds = math::max(best_time_us, uint64_t(1)) / 1000000.0;
+
+	print_line(format(
+			"mesher={} dataset={} block_size={} depth={} blocks={} time_us={} voxels_per_second={} triangles={} "
+			"triangles_per_second={} allocated_bytes_per_block={} retained_bytes={}",
+			mesher_name,
+			ds.name,
+			block_size,
+			VoxelBuffer::get_depth_bit_count(depth),
+			blocks.size(),
+			best_time_us,
+			uint64_t(voxel_count / seconds),
+			triangle_count,
+			uint64_t(triangle_count / seconds),
+			allocated_bytes < 0 ? -1 : allocated_bytes / int64_t(blocks.size()),
+			retained_bytes
+	));
+}
+
+} // namespace
+
+void run_voxel_mesher_benchmarks(const StdVector<String> &vox_file_paths) {
+	print_line("------------ Voxel mesher benchmarks begin -------------");
+
+	const Vector3i synthetic_size(128, 64, 128);
+
+	StdVector<MesherBenchmarkDataset> datasets;
+
+	datasets.push_back(make_dataset("flat", synthetic_size, [&synthetic_size](Vector3i pos) {
+		return pos.y - synthetic_size.y / 2 + 0.5f;
+	}));
+
+	{
+		Ref<ZN_FastNoiseLite> noise;
+		noise.instantiate();
+		noise->set_seed(131183);
+		noise->set_period(32);
+		// Roughly half of the volume is matter, with many tunnels and holes
+		datasets.push_back(make_dataset("caves", synthetic_size, [&noise](Vector3i pos) {
+			return 8.f * noise->get_noise_3d(pos.x, pos.y, pos.z);
+		}));
+	}
+
+	// Worst case: every voxel has all its faces exposed
+	datasets.push_back(make_dataset("checkerboard", synthetic_size, [](Vector3i pos) {
+		return ((pos.x + pos.y + pos.z) & 1) == 0 ? -1.f : 1.f;
+	}));
+
+	for (const String &fpath : vox_file_paths) {
+		MesherBenchmarkDataset ds;
+		if (load_vox_dataset(fpath, ds)) {
+			datasets.push_back(std::move(ds));
+		}
+	}
+
+	Ref<VoxelBlockyLibrary> library;
+	library.instantiate();
+	{
+		Ref<VoxelBlockyModelEmpty> air;
+		air.instantiate();
+		library->add_model(air);
+	}
+	{
+		Ref<VoxelBlockyModelCube> cube;
+		cube.instantiate();
+		library->add_model(cube);
+	}
+	library->bake();
+
+	Ref<VoxelMesherBlocky> blocky_mesher;
+	blocky_mesher.instantiate();
+	blocky_mesher->set_library(library);
+
+	Ref<VoxelMesherCubes> cubes_mesher;
+	cubes_mesher.instantiate();
+	cubes_mesher->set_color_mode(VoxelMesherCubes::COLOR_RAW);
+
+	Ref<VoxelMesherTransvoxel> transvoxel_mesher;
+	transvoxel_mesher.instantiate();
+
+	const int block_sizes[] = { 16, 32 };
+	const VoxelBuffer::Depth index_depths[] = { VoxelBuffer::DEPTH_8_BIT, VoxelBuffer::DEPTH_16_BIT };
+	const VoxelBuffer::Depth sdf_depths[] = {
+		VoxelBuffer::DEPTH_8_BIT, VoxelBuffer::DEPTH_16_BIT, VoxelBuffer::DEPTH_32_BIT
+	};
+
+	for (const MesherBenchmarkDataset &ds : datasets) {
+		for (const int block_size : block_sizes) {
+			for (const VoxelBuffer::Depth depth : index_depths) {
+				run_mesher_benchmark(**blocky_mesher, "VoxelMesherBlocky", ds, block_size, depth, FORMAT_TYPE);
+			}
+			for (const VoxelBuffer::Depth depth : index_depths) {
+				run_mesher_benchmark(**cubes_mesher, "VoxelMesherCubes", ds, block_size, depth, FORMAT_COLOR);
+			}
+			for (const VoxelBuffer::Depth depth : sdf_depths) {
+				run_mesher_benchmark(**transvoxel_mesher, "VoxelMesherTransvoxel", ds, block_size, depth, FORMAT_SDF);
+			}
+		}
+	}
+
+	print_line("------------ Voxel mesher benchmarks end -------------");
+}
+
+} // namespace zylann::voxel::tests
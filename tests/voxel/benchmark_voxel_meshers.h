@@ -0,0 +1,15 @@
+#ifndef VOXEL_TESTS_BENCHMARK_VOXEL_MESHERS_H
+#define VOXEL_TESTS_BENCHMARK_VOXEL_MESHERS_H
+
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/core/string.h"
+
+namespace zylann::voxel::tests {
+
+// Meshes a set of canonical voxel datasets with every mesher, several block sizes and depths, and prints one line of
+// results per case. MagicaVoxel files can be given to also benchmark real models.
+void run_voxel_mesher_benchmarks(const StdVector<String> &vox_file_paths);
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TESTS_BENCHMARK_VOXEL_MESHERS_H
@@ -0,0 +1,413 @@
+#include "benchmark_voxel_streaming.h"
+#include "../../constants/voxel_constants.h"
+#include "../../engine/voxel_engine.h"
+#include "../../generators/simple/voxel_generator_waves.h"
+#include "../../meshers/transvoxel/voxel_mesher_transvoxel.h"
+#include "../../streams/sqlite/voxel_stream_sqlite.h"
+#include "../../terrain/fixed_lod/voxel_terrain.h"
+#include "../../terrain/variable_lod/voxel_lod_terrain.h"
+#include "../../terrain/voxel_viewer.h"
+#include "../../util/godot/classes/engine.h"
+#include "../../util/godot/classes/file_access.h"
+#include "../../util/godot/classes/json.h"
+#include "../../util/godot/classes/os.h"
+#include "../../util/godot/classes/scene_tree.h"
+#include "../../util/godot/classes/window.h"
+#include "../../util/godot/core/dictionary.h"
+#include "../../util/godot/core/string.h"
+#include "../../util/io/log.h"
+#include "../../util/math/box3i.h"
+#include "../../util/math/conv.h"
+#include "../../util/math/funcs.h"
+#include "../../util/string/format.h"
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+// The viewer moves by a fixed amount each frame, so paths are the same regardless of framerate. Slow frames will
+// instead show up as more time spent waiting for blocks.
+const float PATH_TIME_STEP = 1.f / 60.f;
+const unsigned int PATH_FRAME_COUNT = 600;
+// Give up waiting for an area to load after this time
+const uint64_t LOAD_TIMEOUT_USEC = 60'000'000;
+// Distance from the viewer within which blocks must be meshed for the viewer to be considered not waiting
+const int VIEWER_AREA_RADIUS = 32;
+const float VIEWER_HEIGHT = 20.f;
+
+enum TerrainType { //
+	TERRAIN_FIXED_LOD,
+	TERRAIN_VARIABLE_LOD
+};
+
+enum PathType { //
+	// Straight line at constant speed
+	PATH_FLYOVER,
+	// Jumps far away every few seconds, like respawns or fast travel
+	PATH_TELEPORT,
+	// Growing circles around the origin, revisiting areas that were already loaded
+	PATH_SPIRAL
+};
+
+struct StreamingScenario {
+	const char *name;
+	TerrainType terrain;
+	PathType path;
+	bool use_stream;
+};
+
+const StreamingScenario g_scenarios[] = {
+	{ "fixed_lod_flyover", TERRAIN_FIXED_LOD, PATH_FLYOVER, false },
+	{ "fixed_lod_teleport", TERRAIN_FIXED_LOD, PATH_TELEPORT, false },
+	{ "fixed_lod_spiral", TERRAIN_FIXED_LOD, PATH_SPIRAL, false },
+	{ "fixed_lod_flyover_sqlite", TERRAIN_FIXED_LOD, PATH_FLYOVER, true },
+	{ "fixed_lod_teleport_sqlite", TERRAIN_FIXED_LOD, PATH_TELEPORT, true },
+	{ "fixed_lod_spiral_sqlite", TERRAIN_FIXED_LOD, PATH_SPIRAL, true },
+	{ "variable_lod_flyover", TERRAIN_VARIABLE_LOD, PATH_FLYOVER, false },
+	{ "variable_lod_teleport", TERRAIN_VARIABLE_LOD, PATH_TELEPORT, false },
+	{ "variable_lod_spiral", TERRAIN_VARIABLE_LOD, PATH_SPIRAL, false },
+	{ "variable_lod_flyover_sqlite", TERRAIN_VARIABLE_LOD, PATH_FLYOVER, true },
+	{ "variable_lod_teleport_sqlite", TERRAIN_VARIABLE_LOD, PATH_TELEPORT, true },
+	{ "variable_lod_spiral_sqlite", TERRAIN_VARIABLE_LOD, PATH_SPIRAL, true },
+};
+
+const unsigned int SCENARIO_COUNT = sizeof(g_scenarios) / sizeof(g_scenarios[0]);
+
+// Task categories counted as processed blocks. Each task of these categories handles one block.
+const constants::TaskLatencyCategory g_block_categories[] = {
+	constants::TASK_LATENCY_GENERATE,
+	constants::TASK_LATENCY_MESH,
+	constants::TASK_LATENCY_LOAD,
+	constants::TASK_LATENCY_SAVE,
+};
+const char *g_block_category_names[] = { "generate", "mesh", "load", "save" };
+const unsigned int BLOCK_CATEGORY_COUNT = sizeof(g_block_categories) / sizeof(g_block_categories[0]);
+
+Vector3 get_path_position(PathType path, float time) {
+	switch (path) {
+		case PATH_FLYOVER:
+			return Vector3(50.f * time, VIEWER_HEIGHT, 0.f);
+
+		case PATH_TELEPORT:
+			return Vector3(1000.f * Math::floor(time / 2.f), VIEWER_HEIGHT, 0.f);
+
+		case PATH_SPIRAL: {
+			const float radius = 20.f + 15.f * time;
+			return Vector3(radius * Math::cos(time), VIEWER_HEIGHT, radius * Math::sin(time));
+		}
+
+		default:
+			ZN_PRINT_ERROR("Unknown path");
+			return Vector3();
+	}
+}
+
+Dictionary make_latency_dict(const LatencyHistogram &histogram, uint64_t max_usec) {
+	Dictionary d;
+	d["count"] = histogram.get_count();
+	d["p50_usec"] = histogram.get_percentile_usec(0.50f);
+	d["p95_usec"] = histogram.get_percentile_usec(0.95f);
+	d["p99_usec"] = histogram.get_percentile_usec(0.99f);
+	d["max_usec"] = max_usec;
+	return d;
+}
+
+uint64_t get_block_task_count(unsigned int i) {
+	return VoxelEngine::get_singleton().get_task_latency_stats(g_block_categories[i]).run.get_count();
+}
+
+void start_voxel_streaming_benchmarks(String output_path) {
+	SceneTree *scene_tree = Object::cast_to<SceneTree>(Engine::get_singleton()->get_main_loop());
+	ZN_ASSERT_RETURN_MSG(scene_tree != nullptr, "Streaming benchmarks require the main loop to be a SceneTree");
+
+	VoxelStreamingBenchmarkRunner *runner = memnew(VoxelStreamingBenchmarkRunner);
+	runner->set_name("VoxelStreamingBenchmarkRunner");
+	runner->set_output_path(output_path);
+	scene_tree->get_root()->add_child(runner);
+}
+
+} // namespace
+
+void schedule_voxel_streaming_benchmarks(const String &output_path) {
+	callable_mp_static(&start_voxel_streaming_benchmarks).call_deferred(output_path);
+}
+
+VoxelStreamingBenchmarkRunner::VoxelStreamingBenchmarkRunner() {
+	set_process(true);
+	_task_counts_before.resize(BLOCK_CATEGORY_COUNT, 0);
+}
+
+VoxelStreamingBenchmarkRunner::~VoxelStreamingBenchmarkRunner() {}
+
+void VoxelStreamingBenchmarkRunner::set_output_path(const String &path) {
+	_output_path = path;
+}
+
+void VoxelStreamingBenchmarkRunner::_notification(int p_what) {
+	switch (p_what) {
+		case NOTIFICATION_READY:
+			ZN_PRINT_VERBOSE(format("Running {} voxel streaming benchmarks", SCENARIO_COUNT));
+			_test_dir = UniquePtr<zylann::testing::TestDirectory>(ZN_NEW(zylann::testing::TestDirectory));
+			break;
+
+		case NOTIFICATION_PROCESS:
+			process_frame();
+			break;
+
+		default:
+			break;
+	}
+}
+
+bool VoxelStreamingBenchmarkRunner::is_area_around_viewer_meshed() const {
+	const Vector3i center = math::floor_to_int(_viewer->get_position());
+	const Box3i box = Box3i::from_center_extents(center, Vector3iUtil::create(VIEWER_AREA_RADIUS));
+
+	VoxelTerrain *fixed_lod_terrain = Object::cast_to<VoxelTerrain>(_terrain);
+	if (fixed_lod_terrain != nullptr) {
+		return fixed_lod_terrain->is_area_meshed(box);
+	}
+	VoxelLodTerrain *variable_lod_terrain = Object::cast_to<VoxelLodTerrain>(_terrain);
+	if (variable_lod_terrain != nullptr) {
+		return variable_lod_terrain->is_area_meshed(box, 0);
+	}
+	return false;
+}
+
+bool VoxelStreamingBenchmarkRunner::is_fully_loaded() const {
+	if (!is_area_around_viewer_meshed()) {
+		return false;
+	}
+	const VoxelEngine::Stats stats = VoxelEngine::get_singleton().get_stats();
+	return stats.generation_tasks == 0 && stats.streaming_tasks == 0 && stats.meshing_tasks == 0;
+}
+
+void VoxelStreamingBenchmarkRunner::process_frame() {
+	const uint64_t frame_time_usec = _frame_clock.restart();
+
+	switch (_phase) {
+		case PHASE_IDLE: {
+			// Don't let tasks of the previous scenario pollute measurements, and let it release its stream
+			const VoxelEngine::Stats stats = VoxelEngine::get_singleton().get_stats();
+			if (stats.general.tasks != 0 || stats.main_thread_tasks != 0) {
+				break;
+			}
+			if (_scenario_index == SCENARIO_COUNT) {
+				finish();
+			} else {
+				start_scenario();
+			}
+		} break;
+
+		case PHASE_LOAD:
+			_frame_times.add(frame_time_usec);
+			_max_frame_time_usec = math::max(_max_frame_time_usec, frame_time_usec);
+
+			if (is_fully_loaded()) {
+				_load_time_usec = _phase_clock.get_elapsed_microseconds();
+				_phase = PHASE_PATH;
+				_phase_frame = 0;
+
+			} else if (_phase_clock.get_elapsed_microseconds() > LOAD_TIMEOUT_USEC) {
+				_load_time_usec = _phase_clock.get_elapsed_microseconds();
+				_load_timed_out = true;
+				_phase = PHASE_PATH;
+				_phase_frame = 0;
+			}
+			break;
+
+		case PHASE_PATH: {
+			_frame_times.add(frame_time_usec);
+			_max_frame_time_usec = math::max(_max_frame_time_usec, frame_time_usec);
+
+			const bool meshed = is_area_around_viewer_meshed();
+			if (meshed && _viewer_waiting) {
+				const uint64_t wait_usec = _viewer_wait_clock.get_elapsed_microseconds();
+				_viewer_waits.add(wait_usec);
+				_max_viewer_wait_usec = math::max(_max_viewer_wait_usec, wait_usec);
+				_viewer_waiting = false;
+			} else if (!meshed && !_viewer_waiting) {
+				_viewer_wait_clock.restart();
+				_viewer_waiting = true;
+			}
+
+			if (_phase_frame == PATH_FRAME_COUNT) {
+				_phase = PHASE_SETTLE;
+				_phase_clock.restart();
+				break;
+			}
+
+			const StreamingScenario &scenario = g_scenarios[_scenario_index];
+			_viewer->set_position(get_path_position(scenario.path, _phase_frame * PATH_TIME_STEP));
+			++_phase_frame;
+		} break;
+
+		case PHASE_SETTLE:
+			_frame_times.add(frame_time_usec);
+			_max_frame_time_usec = math::max(_max_frame_time_usec, frame_time_usec);
+
+			if (is_fully_loaded() || _phase_clock.get_elapsed_microseconds() > LOAD_TIMEOUT_USEC) {
+				finish_scenario();
+			}
+			break;
+
+		default:
+			ZN_PRINT_ERROR("Unknown phase");
+			break;
+	}
+}
+
+void VoxelStreamingBenchmarkRunner::start_scenario() {
+	const StreamingScenario &scenario = g_scenarios[_scenario_index];
+	ZN_PRINT_VERBOSE(format("Starting streaming scenario {}", scenario.name));
+
+	Ref<VoxelGeneratorWaves> generator;
+	generator.instantiate();
+
+	Ref<VoxelMesherTransvoxel> mesher;
+	mesher.instantiate();
+
+	Ref<VoxelStreamSQLite> stream;
+	if (scenario.use_stream) {
+		ZN_ASSERT(_test_dir != nullptr && _test_dir->is_valid());
+		stream.instantiate();
+		stream->set_database_path(_test_dir->get_path().path_join(String(scenario.name) + ".sqlite"));
+		// So the stream has something to save
+		stream->set_save_generator_output(true);
+	}
+
+	_viewer = memnew(VoxelViewer);
+	_viewer->set_position(get_path_position(scenario.path, 0.f));
+
+	switch (scenario.terrain) {
+		case TERRAIN_FIXED_LOD: {
+			VoxelTerrain *terrain = memnew(VoxelTerrain);
+			terrain->set_generator(generator);
+			terrain->set_mesher(mesher);
+			terrain->set_stream(stream);
+			_viewer->set_view_distance(128);
+			_terrain = terrain;
+		} break;
+
+		case TERRAIN_VARIABLE_LOD: {
+			VoxelLodTerrain *terrain = memnew(VoxelLodTerrain);
+			terrain->set_generator(generator);
+			terrain->set_mesher(mesher);
+			terrain->set_stream(stream);
+			terrain->set_lod_count(6);
+			terrain->set_view_distance(512);
+			_viewer->set_view_distance(512);
+			_terrain = terrain;
+		} break;
+
+		default:
+			ZN_CRASH_MSG("Unknown terrain type");
+			break;
+	}
+
+	add_child(_terrain);
+	add_child(_viewer);
+
+	_frame_times.clear();
+	_max_frame_time_usec = 0;
+	_viewer_waits.clear();
+	_max_viewer_wait_usec = 0;
+	_viewer_waiting = false;
+	_load_time_usec = 0;
+	_load_timed_out = false;
+	for (unsigned int i = 0; i < BLOCK_CATEGORY_COUNT; ++i) {
+		_task_counts_before[i] = get_block_task_count(i);
+	}
+
+	_phase = PHASE_LOAD;
+	_phase_clock.restart();
+	_scenario_clock.restart();
+}
+
+void VoxelStreamingBenchmarkRunner::finish_scenario() {
+	const StreamingScenario &scenario = g_scenarios[_scenario_index];
+	const uint64_t duration_usec = _scenario_clock.get_elapsed_microseconds();
+	const uint64_t settle_time_usec = _phase_clock.get_elapsed_microseconds();
+	const bool settle_timed_out = settle_time_usec > LOAD_TIMEOUT_USEC;
+
+	if (_viewer_waiting) {
+		// The viewer stopped before its area could load, count what was waited so far
+		const uint64_t wait_usec = _viewer_wait_clock.get_elapsed_microseconds();
+		_viewer_waits.add(wait_usec);
+		_max_viewer_wait_usec = math::max(_max_viewer_wait_usec, wait_usec);
+	}
+
+	Dictionary blocks_per_second;
+	for (unsigned int i = 0; i < BLOCK_CATEGORY_COUNT; ++i) {
+		const uint64_t count = get_block_task_count(i) - _task_counts_before[i];
+		blocks_per_second[g_block_category_names[i]] = duration_usec > 0 ? 1'000'000.0 * count / duration_usec : 0.0;
+	}
+
+	Dictionary result;
+	result["name"] = scenario.name;
+	result["duration_usec"] = duration_usec;
+	result["time_to_load_usec"] = _load_time_usec;
+	result["load_timed_out"] = _load_timed_out;
+	result["time_to_settle_usec"] = settle_time_usec;
+	result["settle_timed_out"] = settle_timed_out;
+	result["frame_time"] = make_latency_dict(_frame_times, _max_frame_time_usec);
+	result["viewer_wait"] = make_latency_dict(_viewer_waits, _max_viewer_wait_usec);
+	result["blocks_per_second"] = blocks_per_second;
+	// Godot only tracks the peak since the application started, so it never decreases from one scenario to the next
+	result["static_memory_peak_bytes"] = OS::get_singleton()->get_static_memory_peak_usage();
+	result["static_memory_usage_bytes"] = OS::get_singleton()->get_static_memory_usage();
+	_results.push_back(result);
+
+	print_line(format(
+			"Streaming {}: load {} ms{}, settle {} ms{}, frame p50 {} us p99 {} us max {} us, "
+			"viewer waits {} max {} ms",
+			scenario.name,
+			_load_time_usec / 1000,
+			_load_timed_out ? " (timed out)" : "",
+			settle_time_usec / 1000,
+			settle_timed_out ? " (timed out)" : "",
+			_frame_times.get_percentile_usec(0.5f),
+			_frame_times.get_percentile_usec(0.99f),
+			_max_frame_time_usec,
+			_viewer_waits.get_count(),
+			_max_viewer_wait_usec / 1000
+	));
+
+	// Freeing the terrain also releases the stream, so its database is closed before the next scenario
+	_terrain->queue_free();
+	_viewer->queue_free();
+	_terrain = nullptr;
+	_viewer = nullptr;
+
+	++_scenario_index;
+	_phase = PHASE_IDLE;
+}
+
+void VoxelStreamingBenchmarkRunner::finish() {
+	set_process(false);
+
+	if (!_output_path.is_empty()) {
+		Dictionary root;
+		root["scenarios"] = _results;
+
+		Error err;
+		Ref<FileAccess> f = zylann::godot::open_file(_output_path, FileAccess::WRITE, err);
+		if (f.is_valid()) {
+			f->store_string(JSON::stringify(root, "\t"));
+			print_line(format("Wrote streaming benchmark results to {}", _output_path));
+		} else {
+			ZN_PRINT_ERROR(format(
+					"Could not open {} to write streaming benchmark results, error {}",
+					zylann::godot::to_std_string(_output_path),
+					err
+			));
+		}
+	}
+
+	// Release the test directory before quitting, it would otherwise be removed after the engine is gone
+	_test_dir.reset();
+
+	get_tree()->quit();
+}
+
+} // namespace zylann::voxel::tests
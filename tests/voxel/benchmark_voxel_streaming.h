@@ -0,0 +1,92 @@
+#ifndef VOXEL_TESTS_BENCHMARK_VOXEL_STREAMING_H
+#define VOXEL_TESTS_BENCHMARK_VOXEL_STREAMING_H
+
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/node.h"
+#include "../../util/godot/core/array.h"
+#include "../../util/godot/macros.h"
+#include "../../util/memory/memory.h"
+#include "../../util/profiling_clock.h"
+#include "../../util/tasks/latency_histogram.h"
+#include "../testing.h"
+
+ZN_GODOT_FORWARD_DECLARE(class Node3D);
+
+namespace zylann::voxel {
+
+class VoxelViewer;
+
+namespace tests {
+
+// Schedules end-to-end streaming benchmarks. They start on the first frame, because the scene tree doesn't exist yet
+// when modules are initialized. Terrains are created in the scene tree, while a viewer moves along scripted paths.
+// When all scenarios are done, results are printed, written as JSON to `output_path` if not empty, and the application
+// quits. Meant to run headless from a project with a main scene, like:
+// `godot --headless --path <project> --run_voxel_streaming_benchmarks --voxel_benchmark_output=results.json`
+void schedule_voxel_streaming_benchmarks(const String &output_path);
+
+// Runs streaming scenarios one after the other, driven by process notifications.
+class VoxelStreamingBenchmarkRunner : public Node {
+	GDCLASS(VoxelStreamingBenchmarkRunner, Node)
+public:
+	VoxelStreamingBenchmarkRunner();
+	~VoxelStreamingBenchmarkRunner();
+
+	void set_output_path(const String &path);
+
+protected:
+	void _notification(int p_what);
+
+private:
+	enum Phase { //
+		// Waiting for tasks of the previous scenario to finish
+		PHASE_IDLE,
+		// The viewer doesn't move until the area around it is fully loaded
+		PHASE_LOAD,
+		// The viewer follows the path of the scenario
+		PHASE_PATH,
+		// The viewer stopped at the end of the path, waiting for the area to be fully loaded again
+		PHASE_SETTLE
+	};
+
+	void process_frame();
+	void start_scenario();
+	void finish_scenario();
+	void finish();
+	bool is_area_around_viewer_meshed() const;
+	bool is_fully_loaded() const;
+
+	// When compiling with GodotCpp, `_bind_methods` is not optional.
+	static void _bind_methods() {}
+
+	String _output_path;
+	UniquePtr<zylann::testing::TestDirectory> _test_dir;
+	Array _results;
+
+	unsigned int _scenario_index = 0;
+	Phase _phase = PHASE_IDLE;
+	unsigned int _phase_frame = 0;
+	ProfilingClock _phase_clock;
+	ProfilingClock _scenario_clock;
+	ProfilingClock _frame_clock;
+
+	Node3D *_terrain = nullptr;
+	VoxelViewer *_viewer = nullptr;
+
+	// Measurements of the current scenario
+	LatencyHistogram _frame_times;
+	uint64_t _max_frame_time_usec = 0;
+	// Periods during which the area around the moving viewer was not meshed yet
+	LatencyHistogram _viewer_waits;
+	uint64_t _max_viewer_wait_usec = 0;
+	bool _viewer_waiting = false;
+	ProfilingClock _viewer_wait_clock;
+	uint64_t _load_time_usec = 0;
+	bool _load_timed_out = false;
+	StdVector<uint64_t> _task_counts_before;
+};
+
+} // namespace tests
+} // namespace zylann::voxel
+
+#endif // VOXEL_TESTS_BENCHMARK_VOXEL_STREAMING_H
@@ -0,0 +1,60 @@
+#include "test_block_lifecycle_trace.h"
+#include "../../terrain/variable_lod/block_lifecycle_trace.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_block_lifecycle_trace() {
+	BlockLifecycleTrace trace;
+	StdVector<BlockLifecycleTrace::Event> events;
+
+	// Nothing is recorded while disabled
+	trace.add(BlockLifecycleTrace::STAGE_LOAD_QUEUED, Vector3i(0, 0, 0), 0);
+	trace.get_events(events);
+	ZN_TEST_ASSERT(events.size() == 0);
+
+	trace.set_enabled(true);
+
+	// Data and mesh blocks are tracked separately even if they have the same position
+	trace.add(BlockLifecycleTrace::STAGE_LOAD_QUEUED, Vector3i(1, 2, 3), 0);
+	trace.add(BlockLifecycleTrace::STAGE_MESH_QUEUED, Vector3i(1, 2, 3), 0);
+	trace.add(BlockLifecycleTrace::STAGE_LOADED, Vector3i(1, 2, 3), 0);
+	trace.add(BlockLifecycleTrace::STAGE_LOAD_QUEUED, Vector3i(1, 2, 3), 1);
+	trace.add(BlockLifecycleTrace::STAGE_MESHED, Vector3i(1, 2, 3), 0);
+	trace.add(BlockLifecycleTrace::STAGE_VISIBLE, Vector3i(1, 2, 3), 0);
+
+	trace.get_events(events);
+	ZN_TEST_ASSERT(events.size() == 6);
+	ZN_TEST_ASSERT(events[0].stage == BlockLifecycleTrace::STAGE_LOAD_QUEUED);
+	ZN_TEST_ASSERT(events[3].lod_index == 1);
+	ZN_TEST_ASSERT(events[5].stage == BlockLifecycleTrace::STAGE_VISIBLE);
+	for (unsigned int i = 1; i < events.size(); ++i) {
+		ZN_TEST_ASSERT(events[i].time_usec >= events[i - 1].time_usec);
+	}
+
+	FixedArray<BlockLifecycleTrace::StageLatency, BlockLifecycleTrace::STAGE_COUNT> latencies;
+	trace.get_stage_latencies(latencies);
+	// First events of a block have nothing to be compared with
+	ZN_TEST_ASSERT(latencies[BlockLifecycleTrace::STAGE_LOAD_QUEUED].count == 0);
+	ZN_TEST_ASSERT(latencies[BlockLifecycleTrace::STAGE_MESH_QUEUED].count == 0);
+	ZN_TEST_ASSERT(latencies[BlockLifecycleTrace::STAGE_LOADED].count == 1);
+	ZN_TEST_ASSERT(latencies[BlockLifecycleTrace::STAGE_MESHED].count == 1);
+	ZN_TEST_ASSERT(latencies[BlockLifecycleTrace::STAGE_VISIBLE].count == 1);
+	ZN_TEST_ASSERT(latencies[BlockLifecycleTrace::STAGE_GENERATED].count == 0);
+
+	// Only the most recent events are kept
+	const unsigned int extra_count = 10;
+	for (unsigned int i = 0; i < BlockLifecycleTrace::DEFAULT_CAPACITY + extra_count; ++i) {
+		trace.add(BlockLifecycleTrace::STAGE_MESH_QUEUED, Vector3i(i, 0, 0), 0);
+	}
+	trace.get_events(events);
+	ZN_TEST_ASSERT(events.size() == BlockLifecycleTrace::DEFAULT_CAPACITY);
+	ZN_TEST_ASSERT(events.front().position == Vector3i(extra_count, 0, 0));
+	ZN_TEST_ASSERT(events.back().position == Vector3i(BlockLifecycleTrace::DEFAULT_CAPACITY + extra_count - 1, 0, 0));
+
+	trace.clear();
+	trace.get_events(events);
+	ZN_TEST_ASSERT(events.size() == 0);
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_BLOCK_LIFECYCLE_TRACE_H
+#define VOXEL_TEST_BLOCK_LIFECYCLE_TRACE_H
+
+namespace zylann::voxel::tests {
+
+void test_block_lifecycle_trace();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_BLOCK_LIFECYCLE_TRACE_H
@@ -3,6 +3,7 @@
 #include "../../streams/voxel_block_serializer.h"
 #include "../../streams/voxel_block_serializer_gd.h"
 #include "../../util/godot/classes/stream_peer_buffer.h"
+#include "../../util/godot/core/random_pcg.h"
 #include "../testing.h"
 
 namespace zylann::voxel::tests {
@@ -49,6 +50,237 @@ void test_block_serializer() {
 	}
 }
 
+void test_block_serializer_sparse_values() {
+	VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+	voxel_buffer.create(Vector3i(16, 16, 16));
+	voxel_buffer.fill_area(42, Vector3i(1, 2, 3), Vector3i(5, 5, 5), 0);
+	// Set out of order on purpose
+	voxel_buffer.set_voxel_sparse_value(Vector3i(4, 5, 6), 3);
+	voxel_buffer.set_voxel_sparse_value(Vector3i(1, 2, 3), 1);
+	voxel_buffer.set_voxel_sparse_value(Vector3i(15, 15, 15), 2);
+	voxel_buffer.set_voxel_sparse_value(Vector3i(1, 2, 3), 4);
+	voxel_buffer.set_voxel_sparse_value(Vector3i(0, 0, 0), 5);
+	voxel_buffer.erase_voxel_sparse_value(Vector3i(0, 0, 0));
+	ZN_TEST_ASSERT(voxel_buffer.get_voxel_sparse_values().size() == 3);
+
+	uint32_t value = 0;
+	ZN_TEST_ASSERT(voxel_buffer.get_voxel_sparse_value(Vector3i(1, 2, 3), value) && value == 4);
+	ZN_TEST_ASSERT(!voxel_buffer.get_voxel_sparse_value(Vector3i(0, 0, 0), value));
+
+	// Values fitting in 16 bits and values that don't are stored differently
+	for (const uint32_t large_value : { 6u, 0x12345678u }) {
+		voxel_buffer.set_voxel_sparse_value(Vector3i(4, 5, 6), large_value);
+
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(voxel_buffer);
+		ZN_TEST_ASSERT(result.success);
+		ZN_TEST_ASSERT(BlockSerializer::get_serialized_size(voxel_buffer) == result.data.size());
+
+		VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(result.data), deserialized_voxel_buffer));
+		ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+		ZN_TEST_ASSERT(
+				voxel_buffer.get_voxel_sparse_values() == deserialized_voxel_buffer.get_voxel_sparse_values()
+		);
+	}
+
+	{
+		// Values follow voxels when copied with metadata
+		VoxelBuffer dst(VoxelBuffer::ALLOCATOR_DEFAULT);
+		dst.create(Vector3i(8, 8, 8));
+		dst.set_voxel_sparse_value(Vector3i(0, 0, 0), 7);
+		dst.set_voxel_sparse_value(Vector3i(7, 7, 7), 8);
+		dst.clear_voxel_metadata_in_area(Box3i(Vector3i(), Vector3i(4, 4, 4)));
+		dst.copy_voxel_metadata_in_area(voxel_buffer, Box3i(Vector3i(1, 2, 3), Vector3i(4, 4, 4)), Vector3i());
+
+		ZN_TEST_ASSERT(dst.get_voxel_sparse_values().size() == 3);
+		ZN_TEST_ASSERT(dst.get_voxel_sparse_value(Vector3i(0, 0, 0), value) && value == 4);
+		ZN_TEST_ASSERT(dst.get_voxel_sparse_value(Vector3i(3, 3, 3), value) && value == 0x12345678u);
+		ZN_TEST_ASSERT(dst.get_voxel_sparse_value(Vector3i(7, 7, 7), value) && value == 8);
+	}
+}
+
+void test_block_serializer_into_buffer() {
+	VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+	voxel_buffer.create(Vector3i(16, 16, 16));
+	voxel_buffer.fill_area(42, Vector3i(1, 2, 3), Vector3i(5, 5, 5), 0);
+	voxel_buffer.fill_area(43, Vector3i(2, 3, 4), Vector3i(6, 6, 6), 0);
+	voxel_buffer.fill_area(44, Vector3i(1, 2, 3), Vector3i(5, 5, 5), 1);
+	// Metadata is serialized in place too
+	voxel_buffer.get_or_create_voxel_metadata(Vector3i(1, 2, 3))->set_u64(1234);
+	voxel_buffer.get_block_metadata().set_u64(5678);
+
+	ZN_TEST_ASSERT(
+			BlockSerializer::get_serialized_size(voxel_buffer) == BlockSerializer::serialize(voxel_buffer).data.size()
+	);
+
+	// The same buffer is used for all calls, and is larger than needed
+	StdVector<uint8_t> buffer;
+
+	for (const CompressedData::Compression compression :
+		 { CompressedData::COMPRESSION_NONE, CompressedData::COMPRESSION_LZ4 }) {
+		const size_t size_bound = BlockSerializer::get_serialized_and_compressed_size_bound(voxel_buffer, compression);
+		ZN_TEST_ASSERT(size_bound > 0);
+		buffer.resize(size_bound + 100);
+
+		size_t size = 0;
+		ZN_TEST_ASSERT(BlockSerializer::serialize_and_compress(
+				voxel_buffer, to_span(buffer), size, compression, CompressedData::ZstdOptions()
+		));
+		ZN_TEST_ASSERT(size > 0);
+		ZN_TEST_ASSERT(size <= size_bound);
+
+		// Must produce the same data as the variant returning a buffer
+		BlockSerializer::SerializeResult result =
+				BlockSerializer::serialize_and_compress(voxel_buffer, compression, CompressedData::ZstdOptions());
+		ZN_TEST_ASSERT(result.success);
+		ZN_TEST_ASSERT(result.data.size() == size);
+		ZN_TEST_ASSERT(memcmp(result.data.data(), buffer.data(), size) == 0);
+
+		VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(
+				Span<const uint8_t>(buffer.data(), size), deserialized_voxel_buffer
+		));
+		ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+	}
+}
+
+void test_block_serializer_filters() {
+	// Not a cube, rows along Y are filtered separately
+	const Vector3i block_size(16, 17, 18);
+	VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+	voxel_buffer.create(block_size);
+	voxel_buffer.set_channel_depth(VoxelBuffer::CHANNEL_COLOR, VoxelBuffer::DEPTH_32_BIT);
+	voxel_buffer.set_channel_depth(VoxelBuffer::CHANNEL_DATA5, VoxelBuffer::DEPTH_64_BIT);
+	voxel_buffer.set_channel_depth(VoxelBuffer::CHANNEL_DATA6, VoxelBuffer::DEPTH_8_BIT);
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	Vector3i pos;
+	for (pos.z = 0; pos.z < block_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < block_size.x; ++pos.x) {
+			for (pos.y = 0; pos.y < block_size.y; ++pos.y) {
+				// Smooth SDF going through the middle of the block, with negative and positive values
+				voxel_buffer.set_voxel_f(0.1f * (pos.y - 8) + 0.01f * pos.x, pos, VoxelBuffer::CHANNEL_SDF);
+				voxel_buffer.set_voxel(rng.rand() % 4, pos, VoxelBuffer::CHANNEL_TYPE);
+				voxel_buffer.set_voxel(rng.rand(), pos, VoxelBuffer::CHANNEL_COLOR);
+				voxel_buffer.set_voxel(
+						(static_cast<uint64_t>(rng.rand()) << 32) | rng.rand(), pos, VoxelBuffer::CHANNEL_DATA5
+				);
+				voxel_buffer.set_voxel(rng.rand() % 256, pos, VoxelBuffer::CHANNEL_DATA6);
+			}
+		}
+	}
+
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(voxel_buffer);
+		ZN_TEST_ASSERT(result.success);
+		ZN_TEST_ASSERT(BlockSerializer::get_serialized_size(voxel_buffer) == result.data.size());
+		StdVector<uint8_t> data = result.data;
+
+		VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(data), deserialized_voxel_buffer));
+		ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+	}
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(voxel_buffer);
+		ZN_TEST_ASSERT(result.success);
+		StdVector<uint8_t> data = result.data;
+
+		VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(to_span_const(data), deserialized_voxel_buffer));
+		ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+	}
+	{
+		// Version 5 data has no filter byte in uncompressed channels. Make some by removing it from a block where
+		// only the first channel is not uniform, and uses a depth that doesn't get filtered.
+		VoxelBuffer legacy_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		legacy_buffer.create(block_size);
+		legacy_buffer.set_channel_depth(VoxelBuffer::CHANNEL_TYPE, VoxelBuffer::DEPTH_8_BIT);
+		legacy_buffer.fill_area(42, Vector3i(1, 2, 3), Vector3i(5, 5, 5), VoxelBuffer::CHANNEL_TYPE);
+
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(legacy_buffer);
+		ZN_TEST_ASSERT(result.success);
+		StdVector<uint8_t> data = result.data;
+
+		// Version, size, then format of the first channel
+		const unsigned int filter_offset = 1 + 3 * sizeof(uint16_t) + 1;
+		ZN_TEST_ASSERT(data[filter_offset] == 0);
+		data.erase(data.begin() + filter_offset);
+		data[0] = 5;
+
+		VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(data), deserialized_voxel_buffer));
+		ZN_TEST_ASSERT(legacy_buffer.equals(deserialized_voxel_buffer));
+	}
+}
+
+#ifdef VOXEL_ENABLE_ZSTD
+
+void test_block_serializer_zstd() {
+	StdVector<VoxelBuffer> voxel_buffers;
+	StdVector<StdVector<uint8_t>> serialized_blocks;
+	for (unsigned int i = 0; i < 8; ++i) {
+		VoxelBuffer &voxel_buffer = voxel_buffers.emplace_back(VoxelBuffer::ALLOCATOR_DEFAULT);
+		voxel_buffer.create(Vector3i(16, 16, 16));
+		voxel_buffer.fill_area(i, Vector3i(0, 0, 0), Vector3i(16, 4, 16), 0);
+		for (int y = 0; y < 16; ++y) {
+			voxel_buffer.fill_area_f(float(y - 8) * 0.1f, Vector3i(0, y, 0), Vector3i(16, y + 1, 16), 1);
+		}
+		voxel_buffer.set_voxel(i, i, i, i, 2);
+
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(voxel_buffer);
+		ZN_TEST_ASSERT(result.success);
+		serialized_blocks.push_back(result.data);
+	}
+
+	StdVector<Span<const uint8_t>> samples;
+	for (const StdVector<uint8_t> &data : serialized_blocks) {
+		samples.push_back(to_span(data));
+	}
+	StdVector<uint8_t> dictionary_data;
+	CompressedData::build_zstd_dictionary(to_span(samples), 4096, dictionary_data);
+	ZN_TEST_ASSERT(dictionary_data.size() > 0);
+	ZN_TEST_ASSERT(dictionary_data.size() <= 4096);
+
+	StdVector<std::shared_ptr<CompressedData::ZstdDictionary>> dictionaries;
+	dictionaries.push_back(CompressedData::ZstdDictionary::create(
+			to_span(dictionary_data), CompressedData::ZSTD_DEFAULT_COMPRESSION_LEVEL
+	));
+	ZN_TEST_ASSERT(dictionaries[0] != nullptr);
+
+	for (const VoxelBuffer &voxel_buffer : voxel_buffers) {
+		CompressedData::ZstdOptions options;
+		{
+			BlockSerializer::SerializeResult result =
+					BlockSerializer::serialize_and_compress(voxel_buffer, CompressedData::COMPRESSION_ZSTD, options);
+			ZN_TEST_ASSERT(result.success);
+			StdVector<uint8_t> data = result.data;
+
+			VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(to_span(data), deserialized_voxel_buffer));
+			ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+		}
+		// With a dictionary, and a level it wasn't prepared for
+		options.dictionary = dictionaries[0].get();
+		for (const int level : { CompressedData::ZSTD_DEFAULT_COMPRESSION_LEVEL, 9 }) {
+			options.compression_level = level;
+			BlockSerializer::SerializeResult result =
+					BlockSerializer::serialize_and_compress(voxel_buffer, CompressedData::COMPRESSION_ZSTD, options);
+			ZN_TEST_ASSERT(result.success);
+			StdVector<uint8_t> data = result.data;
+
+			VoxelBuffer deserialized_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(
+					to_span(data), deserialized_voxel_buffer, to_span(dictionaries)
+			));
+			ZN_TEST_ASSERT(voxel_buffer.equals(deserialized_voxel_buffer));
+		}
+	}
+}
+
+#endif
+
 void test_block_serializer_stream_peer() {
 	// Create an example buffer
 	const Vector3i block_size(8, 9, 10);
@@ -5,6 +5,12 @@ namespace zylann::voxel::tests {
 
 void test_block_serializer();
 void test_block_serializer_stream_peer();
+void test_block_serializer_into_buffer();
+void test_block_serializer_sparse_values();
+void test_block_serializer_filters();
+#ifdef VOXEL_ENABLE_ZSTD
+void test_block_serializer_zstd();
+#endif
 
 } // namespace zylann::voxel::tests
 
@@ -0,0 +1,95 @@
+#include "test_blocky_light.h"
+#include "../../storage/blocky_light.h"
+#include "../../storage/voxel_data.h"
+#include "../../storage/voxel_data_grid.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_blocky_light_propagation() {
+	static const uint32_t AIR = 0;
+	static const uint32_t STONE = 1;
+	static const uint32_t LAMP = 2;
+	static const unsigned int LIGHT_CHANNEL = VoxelBuffer::CHANNEL_DATA5;
+
+	blocky_light::ModelProperties models;
+	models.emission = { 0, 0, blocky_light::MAX_LEVEL };
+	models.opaque = { 0, 1, 0 };
+
+	// Two blocks side by side along X, surrounded by nothing
+	VoxelData data;
+	const int bs = data.get_block_size();
+	for (int i = 0; i < 2; ++i) {
+		std::shared_ptr<VoxelBuffer> buffer = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+		buffer->create(Vector3iUtil::create(bs));
+		VoxelDataBlock block(buffer, 0);
+		ZN_TEST_ASSERT(data.try_set_block(Vector3i(i, 0, 0), block));
+	}
+
+	struct L {
+		static void set_type(VoxelData &data, Vector3i pos, uint32_t type) {
+			ZN_TEST_ASSERT(data.try_set_voxel(type, pos, VoxelBuffer::CHANNEL_TYPE));
+		}
+
+		static void update(
+				VoxelData &data,
+				const blocky_light::ModelProperties &models,
+				Box3i box,
+				StdVector<Box3i> &changed_boxes
+		) {
+			changed_boxes.clear();
+			VoxelDataGrid grid;
+			data.get_blocks_grid(grid, box.padded(blocky_light::MAX_UPDATE_DISTANCE), 0);
+			VoxelDataGrid::LockWrite wlock(grid);
+			blocky_light::update_area(grid, models, LIGHT_CHANNEL, box, changed_boxes);
+		}
+
+		static int get_level(const VoxelData &data, Vector3i pos) {
+			VoxelSingleValue defval;
+			defval.i = 0;
+			return data.get_voxel(pos, LIGHT_CHANNEL, defval).i & blocky_light::LEVEL_MASK;
+		}
+	};
+
+	StdVector<Box3i> changed_boxes;
+
+	// Light spreads from the lamp into both blocks
+	const Vector3i lamp_pos(5, 5, 5);
+	L::set_type(data, lamp_pos, LAMP);
+	L::update(data, models, Box3i(lamp_pos, Vector3i(1, 1, 1)), changed_boxes);
+
+	ZN_TEST_ASSERT(L::get_level(data, lamp_pos) == blocky_light::MAX_LEVEL);
+	ZN_TEST_ASSERT(L::get_level(data, lamp_pos + Vector3i(1, 0, 0)) == blocky_light::MAX_LEVEL - 1);
+	ZN_TEST_ASSERT(L::get_level(data, lamp_pos + Vector3i(1, 2, -1)) == blocky_light::MAX_LEVEL - 4);
+	ZN_TEST_ASSERT(L::get_level(data, lamp_pos + Vector3i(14, 0, 0)) == 1);
+	ZN_TEST_ASSERT(L::get_level(data, lamp_pos + Vector3i(15, 0, 0)) == 0);
+	ZN_TEST_ASSERT(changed_boxes.size() == 2);
+
+	// Updating again without changes doesn't change anything
+	L::update(data, models, Box3i(lamp_pos, Vector3i(1, 1, 1)), changed_boxes);
+	ZN_TEST_ASSERT(changed_boxes.size() == 0);
+	ZN_TEST_ASSERT(L::get_level(data, lamp_pos + Vector3i(1, 0, 0)) == blocky_light::MAX_LEVEL - 1);
+
+	// A wall covering the whole cross-section of the blocks stops light
+	const int wall_x = bs + 2;
+	const Box3i wall_box(Vector3i(wall_x, 0, 0), Vector3i(1, bs, bs));
+	wall_box.for_each_cell([&data](Vector3i pos) { L::set_type(data, pos, STONE); });
+	L::update(data, models, wall_box, changed_boxes);
+
+	ZN_TEST_ASSERT(L::get_level(data, Vector3i(wall_x - 1, 5, 5)) > 0);
+	ZN_TEST_ASSERT(L::get_level(data, Vector3i(wall_x, 5, 5)) == 0);
+	ZN_TEST_ASSERT(L::get_level(data, Vector3i(wall_x + 1, 5, 5)) == 0);
+	ZN_TEST_ASSERT(changed_boxes.size() == 1);
+	ZN_TEST_ASSERT(changed_boxes[0].position.x >= wall_x);
+
+	// Removing the lamp removes its light, including light that went around other voxels
+	L::set_type(data, lamp_pos, AIR);
+	L::update(data, models, Box3i(lamp_pos, Vector3i(1, 1, 1)), changed_boxes);
+
+	Box3i(Vector3i(), Vector3i(2 * bs, bs, bs)).for_each_cell([&data](Vector3i pos) { //
+		ZN_TEST_ASSERT(L::get_level(data, pos) == 0);
+	});
+	ZN_TEST_ASSERT(changed_boxes.size() == 2);
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_BLOCKY_LIGHT_H
+#define VOXEL_TEST_BLOCKY_LIGHT_H
+
+namespace zylann::voxel::tests {
+
+void test_blocky_light_propagation();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_BLOCKY_LIGHT_H
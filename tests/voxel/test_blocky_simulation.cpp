@@ -0,0 +1,122 @@
+#include "test_blocky_simulation.h"
+#include "../../storage/blocky_simulation.h"
+#include "../../storage/voxel_data.h"
+#include "../../storage/voxel_data_grid.h"
+#include "../../util/containers/container_funcs.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_blocky_simulation_fall_and_flow() {
+	static const uint32_t AIR = 0;
+	static const uint32_t STONE = 1;
+	static const uint32_t SAND = 2;
+	static const uint32_t WATER = 3;
+
+	blocky_simulation::ModelProperties models;
+	models.behaviors = {
+		blocky_simulation::BEHAVIOR_NONE,
+		blocky_simulation::BEHAVIOR_NONE,
+		blocky_simulation::BEHAVIOR_FALL,
+		blocky_simulation::BEHAVIOR_FLOW,
+	};
+	models.replaceable = { 1, 0, 0, 0 };
+
+	// Two blocks side by side along X, with a floor of stone
+	VoxelData data;
+	const int bs = data.get_block_size();
+	for (int i = 0; i < 2; ++i) {
+		std::shared_ptr<VoxelBuffer> buffer = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+		buffer->create(Vector3iUtil::create(bs));
+		VoxelDataBlock block(buffer, 0);
+		ZN_TEST_ASSERT(data.try_set_block(Vector3i(i, 0, 0), block));
+	}
+	const Box3i area(Vector3i(), Vector3i(2 * bs, bs, bs));
+	const int floor_y = 1;
+	Box3i(Vector3i(0, floor_y, 0), Vector3i(2 * bs, 1, bs)).for_each_cell_zxy([&data](Vector3i pos) {
+		ZN_TEST_ASSERT(data.try_set_voxel(STONE, pos, VoxelBuffer::CHANNEL_TYPE));
+	});
+
+	struct L {
+		static uint32_t get_type(const VoxelData &data, Vector3i pos) {
+			VoxelSingleValue defval;
+			defval.i = AIR;
+			return data.get_voxel(pos, VoxelBuffer::CHANNEL_TYPE, defval).i;
+		}
+
+		// Same as a step done by terrain tasks, but on the calling thread. Returns true if voxels changed.
+		static bool step(VoxelData &data, const blocky_simulation::ModelProperties &models, Box3i box, uint32_t index) {
+			VoxelDataGrid grid;
+			data.get_blocks_grid(grid, box, 0);
+			VoxelDataGrid::LockWrite wlock(grid);
+
+			StdUnorderedMap<Vector3i, StdVector<Vector3i>> cells_per_block;
+			blocky_simulation::find_active_cells(grid, models, box, cells_per_block);
+
+			StdVector<Vector3i> changed_cells;
+			StdVector<Vector3i> border_cells;
+			for (auto it = cells_per_block.begin(); it != cells_per_block.end(); ++it) {
+				VoxelBuffer *voxels = grid.get_block_no_lock(it->first);
+				ZN_TEST_ASSERT(voxels != nullptr);
+				blocky_simulation::BlockStepResult result;
+				blocky_simulation::step_block(
+						*voxels, it->first << data.get_block_size_po2(), to_span(it->second), models, index, result
+				);
+				append_array(changed_cells, result.changed_cells);
+				append_array(border_cells, result.border_cells);
+			}
+			blocky_simulation::sort_bottom_to_top(border_cells);
+			blocky_simulation::step_cells(grid, to_span(border_cells), models, index, changed_cells);
+			return changed_cells.size() > 0;
+		}
+
+		static unsigned int settle(VoxelData &data, const blocky_simulation::ModelProperties &models, Box3i box) {
+			unsigned int step_count = 0;
+			while (step(data, models, box, step_count)) {
+				++step_count;
+				// Simulated voxels must come to rest
+				ZN_TEST_ASSERT(step_count < 100);
+			}
+			return step_count;
+		}
+	};
+
+	// Sand falls inside a block, one voxel per step
+	{
+		const Vector3i sand_pos(5, 10, 5);
+		ZN_TEST_ASSERT(data.try_set_voxel(SAND, sand_pos, VoxelBuffer::CHANNEL_TYPE));
+		const unsigned int step_count = L::settle(data, models, area);
+		ZN_TEST_ASSERT(step_count == static_cast<unsigned int>(sand_pos.y - floor_y - 1));
+		ZN_TEST_ASSERT(L::get_type(data, sand_pos) == AIR);
+		ZN_TEST_ASSERT(L::get_type(data, Vector3i(sand_pos.x, floor_y + 1, sand_pos.z)) == SAND);
+	}
+
+	// Sand on the border of a block falls too
+	{
+		const Vector3i sand_pos(bs - 1, 8, 5);
+		ZN_TEST_ASSERT(data.try_set_voxel(SAND, sand_pos, VoxelBuffer::CHANNEL_TYPE));
+		L::settle(data, models, area);
+		ZN_TEST_ASSERT(L::get_type(data, sand_pos) == AIR);
+		ZN_TEST_ASSERT(L::get_type(data, Vector3i(sand_pos.x, floor_y + 1, sand_pos.z)) == SAND);
+	}
+
+	// A column of water across the border of blocks levels out into one layer, without losing voxels
+	{
+		const int column_height = 4;
+		for (int y = 0; y < column_height; ++y) {
+			ZN_TEST_ASSERT(data.try_set_voxel(WATER, Vector3i(bs, floor_y + 1 + y, 10), VoxelBuffer::CHANNEL_TYPE));
+		}
+		L::settle(data, models, area);
+
+		int water_count = 0;
+		area.for_each_cell_zxy([&data, &water_count](Vector3i pos) {
+			if (L::get_type(data, pos) == WATER) {
+				ZN_TEST_ASSERT(pos.y == floor_y + 1);
+				++water_count;
+			}
+		});
+		ZN_TEST_ASSERT(water_count == column_height);
+	}
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_BLOCKY_SIMULATION_H
+#define VOXEL_TEST_BLOCKY_SIMULATION_H
+
+namespace zylann::voxel::tests {
+
+void test_blocky_simulation_fall_and_flow();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_BLOCKY_SIMULATION_H
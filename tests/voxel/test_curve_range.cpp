@@ -1,7 +1,9 @@
 #include "test_curve_range.h"
+#include "../../generators/graph/baked_resources.h"
 #include "../../generators/graph/range_utility.h"
 #include "../../util/containers/std_vector.h"
 #include "../../util/godot/classes/curve.h"
+#include "../../util/godot/core/random_pcg.h"
 #include "../testing.h"
 
 namespace zylann::voxel::tests {
@@ -132,4 +134,66 @@ void test_get_curve_monotonic_sections() {
 	}
 }
 
+void test_get_curve_range_data() {
+	// Wavy curve with many monotonic sections
+	Ref<Curve> curve;
+	curve.instantiate();
+	const int point_count = 20;
+	for (int i = 0; i < point_count; ++i) {
+		const float x = static_cast<float>(i) / (point_count - 1);
+		curve->add_point(Vector2(x, (i % 2) == 0 ? 0.2f * x : 1.f - 0.3f * x));
+	}
+	curve->bake();
+
+	CurveRangeData data;
+	get_curve_range_data(**curve, data);
+	ZN_TEST_ASSERT(data.sections.size() >= point_count - 1);
+	ZN_TEST_ASSERT(data.section_ranges.size() > 1);
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	for (int test_index = 0; test_index < 1000; ++test_index) {
+		const math::Interval x = math::Interval::from_unordered_values(
+				rng.randf() * 1.2f - 0.1f, //
+				rng.randf() * 1.2f - 0.1f
+		);
+
+		const math::Interval y = get_curve_range(**curve, data, x);
+
+		// Must be the same as the linear search
+		const math::Interval y_expected = get_curve_range(**curve, data.sections, x);
+		ZN_TEST_ASSERT(Math::is_equal_approx(y.min, y_expected.min));
+		ZN_TEST_ASSERT(Math::is_equal_approx(y.max, y_expected.max));
+
+		// Must contain all values of the curve in the X range
+		const int sample_count = 100;
+		for (int i = 0; i <= sample_count; ++i) {
+			const float sx = Math::lerp(x.min, x.max, static_cast<float>(i) / sample_count);
+			const float sy = curve->sample_baked(sx);
+			ZN_TEST_ASSERT(y.contains(sy));
+		}
+	}
+}
+
+void test_curve_lut() {
+	Ref<Curve> curve;
+	curve.instantiate();
+	curve->add_point(Vector2(0, 0.5f));
+	curve->add_point(Vector2(0.3f, 1.f));
+	curve->add_point(Vector2(0.6f, 0.1f));
+	curve->add_point(Vector2(1, 0.7f));
+
+	CurveLUT lut;
+	lut.bake(**curve);
+	ZN_TEST_ASSERT(lut.get_resolution() == static_cast<unsigned int>(curve->get_bake_resolution()));
+
+	// Must give the same results as the curve, including outside of its range
+	const int sample_count = 1000;
+	for (int i = 0; i <= sample_count; ++i) {
+		const float x = Math::lerp(-0.2f, 1.2f, static_cast<float>(i) / sample_count);
+		ZN_TEST_ASSERT(Math::is_equal_approx(lut.sample(x), curve->sample_baked(x)));
+	}
+}
+
 } // namespace zylann::voxel::tests
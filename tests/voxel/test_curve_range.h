@@ -4,6 +4,8 @@
 namespace zylann::voxel::tests {
 
 void test_get_curve_monotonic_sections();
+void test_get_curve_range_data();
+void test_curve_lut();
 
 } // namespace zylann::voxel::tests
 
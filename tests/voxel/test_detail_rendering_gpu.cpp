@@ -1,5 +1,7 @@
+#include "../../engine/detail_rendering/detail_texture_budget.h"
 #include "../../engine/detail_rendering/render_detail_texture_gpu_task.h"
 #include "../../engine/detail_rendering/render_detail_texture_task.h"
+#include "../../engine/gpu/compute_resource_cache.h"
 #include "../../engine/voxel_engine.h"
 #include "../../generators/graph/voxel_generator_graph.h"
 #include "../../meshers/mesh_block_task.h"
@@ -108,7 +110,9 @@ void test_normalmap_render_gpu() {
 	GPUStorageBufferPool storage_buffer_pool;
 	storage_buffer_pool.set_rendering_device(&rd);
 
-	GPUTaskContext gpu_task_context{ rd, storage_buffer_pool };
+	ComputeResourceCache compute_resource_cache(rd);
+
+	GPUTaskContext gpu_task_context{ rd, storage_buffer_pool, compute_resource_cache };
 	gpu_task->prepare(gpu_task_context);
 
 	rd.submit();
@@ -191,4 +195,48 @@ void test_normalmap_render_gpu() {
 	ZN_TEST_ASSERT(diff < 0.1);
 }
 
+void test_detail_texture_budget() {
+	DetailTextureBudget budget;
+	budget.set_budget_bytes(300);
+
+	// Time 0 is the oldest
+	budget.add(Vector3i(0, 0, 0), 0, 100, false, 0);
+	budget.add(Vector3i(1, 0, 0), 0, 100, false, 2);
+	budget.add(Vector3i(0, 0, 0), 1, 100, true, 0);
+	ZN_TEST_ASSERT(budget.get_used_bytes() == 300);
+	ZN_TEST_ASSERT(budget.get_count() == 3);
+
+	// Replacing a texture updates its size
+	budget.add(Vector3i(1, 0, 0), 0, 150, false, 2);
+	ZN_TEST_ASSERT(budget.get_used_bytes() == 350);
+
+	StdVector<DetailTextureBudget::Key> evicted;
+	budget.evict(evicted);
+	// The least recently visible goes first. The visible one is never evicted.
+	ZN_TEST_ASSERT(evicted.size() == 1);
+	ZN_TEST_ASSERT(evicted[0].position == Vector3i(0, 0, 0));
+	ZN_TEST_ASSERT(evicted[0].lod_index == 0);
+	ZN_TEST_ASSERT(budget.get_used_bytes() == 250);
+
+	// Hiding the visible block makes it the most recently visible one
+	budget.set_visible(Vector3i(0, 0, 0), 1, false, 5);
+	budget.add(Vector3i(2, 0, 0), 0, 100, true, 6);
+	evicted.clear();
+	budget.evict(evicted);
+	ZN_TEST_ASSERT(evicted.size() == 1);
+	ZN_TEST_ASSERT(evicted[0].position == Vector3i(1, 0, 0));
+	ZN_TEST_ASSERT(budget.get_used_bytes() == 200);
+
+	// Visible textures can exceed the budget
+	budget.set_budget_bytes(50);
+	evicted.clear();
+	budget.evict(evicted);
+	ZN_TEST_ASSERT(evicted.size() == 1);
+	ZN_TEST_ASSERT(budget.get_used_bytes() == 100);
+
+	budget.remove(Vector3i(2, 0, 0), 0);
+	ZN_TEST_ASSERT(budget.get_used_bytes() == 0);
+	ZN_TEST_ASSERT(budget.get_count() == 0);
+}
+
 } // namespace zylann::voxel::tests
@@ -1,5 +1,8 @@
 #include "test_edition_funcs.h"
+#include "../../edition/connectivity_cache.h"
 #include "../../edition/funcs.h"
+#include "../../edition/random_tick_index.h"
+#include "../../edition/voxel_tool_buffer.h"
 #include "../../edition/voxel_tool_terrain.h"
 #include "../../generators/graph/voxel_generator_graph.h"
 #include "../../meshers/blocky/voxel_blocky_library.h"
@@ -99,6 +102,8 @@ void test_run_blocky_random_tick() {
 
 	Callback cb(voxel_box, tickable_id);
 
+	RandomTickIndex index;
+
 	RandomPCG random;
 	random.seed(131183);
 	zylann::voxel::run_blocky_random_tick(
@@ -108,6 +113,7 @@ void test_run_blocky_random_tick() {
 			random,
 			1000,
 			4,
+			&index,
 			&cb,
 			[](void *self, Vector3i pos, int64_t val) {
 				Callback *cb = (Callback *)self;
@@ -132,6 +138,126 @@ void test_run_blocky_random_tick() {
 		ZN_TEST_ASSERT(Math::abs(nd) <= error_margin);
 		ZN_TEST_ASSERT(Math::abs(pd) <= error_margin);
 	}
+
+	ZN_TEST_ASSERT(index.get_cached_block_count() > 0);
+}
+
+void test_random_tick_index() {
+	Ref<VoxelBlockyLibrary> library;
+	library.instantiate();
+	{
+		Ref<VoxelBlockyModelMesh> air;
+		air.instantiate();
+		library->add_model(air);
+	}
+	Ref<VoxelBlockyModel> tickable;
+	tickable.instantiate();
+	tickable->set_random_tickable(true);
+	const int tickable_id = library->add_model(tickable);
+	library->bake();
+
+	const Vector3i block_size(16, 16, 16);
+	const Vector3i block_pos(1, 2, 3);
+	std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	voxels->create(block_size);
+	voxels->set_voxel(tickable_id, Vector3i(1, 2, 3), VoxelBuffer::CHANNEL_TYPE);
+	voxels->set_voxel(tickable_id, Vector3i(15, 0, 7), VoxelBuffer::CHANNEL_TYPE);
+
+	RandomTickIndex index;
+	const unsigned int block_size_po2 = 4;
+	{
+		Span<const uint16_t> candidates =
+				index.get_block_candidates(block_pos, block_size_po2, voxels, library->get_baked_data());
+		ZN_TEST_ASSERT(candidates.size() == 2);
+		ZN_TEST_ASSERT(candidates[0] == Vector3iUtil::get_zxy_index(Vector3i(1, 2, 3), block_size));
+		ZN_TEST_ASSERT(candidates[1] == Vector3iUtil::get_zxy_index(Vector3i(15, 0, 7), block_size));
+	}
+
+	// Edits are not seen until the area is invalidated
+	voxels->set_voxel(tickable_id, Vector3i(4, 4, 4), VoxelBuffer::CHANNEL_TYPE);
+	ZN_TEST_ASSERT(
+			index.get_block_candidates(block_pos, block_size_po2, voxels, library->get_baked_data()).size() == 2
+	);
+
+	index.invalidate_area(Box3i(Vector3i(16 + 4, 32 + 4, 48 + 4), Vector3i(1, 1, 1)));
+	ZN_TEST_ASSERT(index.get_cached_block_count() == 0);
+	ZN_TEST_ASSERT(
+			index.get_block_candidates(block_pos, block_size_po2, voxels, library->get_baked_data()).size() == 3
+	);
+
+	// Replacing voxels of the block, as loading would do
+	std::shared_ptr<VoxelBuffer> uniform_voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	uniform_voxels->create(block_size);
+	uniform_voxels->fill(tickable_id, VoxelBuffer::CHANNEL_TYPE);
+	ZN_TEST_ASSERT(
+			index.get_block_candidates(block_pos, block_size_po2, uniform_voxels, library->get_baked_data()).size() ==
+			Vector3iUtil::get_volume(block_size)
+	);
+
+	// Rebaking the library with a voxel that no longer ticks
+	tickable->set_random_tickable(false);
+	library->bake();
+	ZN_TEST_ASSERT(
+			index.get_block_candidates(block_pos, block_size_po2, uniform_voxels, library->get_baked_data()).size() == 0
+	);
+}
+
+void test_voxel_tool_buffer_uniform_edits() {
+	Ref<godot::VoxelBuffer> vb;
+	vb.instantiate();
+	vb->create(16, 16, 16);
+	VoxelBuffer &buffer = vb->get_buffer();
+	Ref<VoxelToolBuffer> tool(memnew(VoxelToolBuffer(vb)));
+
+	// Removing matter from air does nothing, so the SDF channel doesn't have to be decompressed
+	tool->set_channel(VoxelBuffer::CHANNEL_SDF);
+	tool->set_mode(VoxelTool::MODE_REMOVE);
+	tool->do_sphere(Vector3(8, 8, 8), 4.f);
+	tool->do_box(Vector3i(2, 2, 2), Vector3i(6, 6, 6));
+	ZN_TEST_ASSERT(buffer.get_channel_compression(VoxelBuffer::CHANNEL_SDF) == VoxelBuffer::COMPRESSION_UNIFORM);
+
+	tool->set_mode(VoxelTool::MODE_ADD);
+	tool->do_sphere(Vector3(8, 8, 8), 4.f);
+	ZN_TEST_ASSERT(buffer.get_channel_compression(VoxelBuffer::CHANNEL_SDF) != VoxelBuffer::COMPRESSION_UNIFORM);
+	ZN_TEST_ASSERT(buffer.get_voxel_f(Vector3i(8, 8, 8), VoxelBuffer::CHANNEL_SDF) < 0.f);
+
+	// Filling with the same value, or filling the whole buffer, keeps the channel uniform
+	tool->set_channel(VoxelBuffer::CHANNEL_TYPE);
+	tool->set_value(0);
+	tool->do_box(Vector3i(2, 2, 2), Vector3i(6, 6, 6));
+	tool->do_sphere(Vector3(8, 8, 8), 4.f);
+	ZN_TEST_ASSERT(buffer.get_channel_compression(VoxelBuffer::CHANNEL_TYPE) == VoxelBuffer::COMPRESSION_UNIFORM);
+
+	tool->set_value(3);
+	tool->do_box(Vector3i(0, 0, 0), Vector3i(15, 15, 15));
+	ZN_TEST_ASSERT(buffer.get_channel_compression(VoxelBuffer::CHANNEL_TYPE) == VoxelBuffer::COMPRESSION_UNIFORM);
+	ZN_TEST_ASSERT(buffer.get_voxel(Vector3i(), VoxelBuffer::CHANNEL_TYPE) == 3);
+
+	tool->do_box(Vector3i(2, 2, 2), Vector3i(6, 6, 6));
+	ZN_TEST_ASSERT(buffer.get_channel_compression(VoxelBuffer::CHANNEL_TYPE) == VoxelBuffer::COMPRESSION_UNIFORM);
+
+	// Pasting a uniform buffer over the whole buffer keeps it uniform
+	{
+		VoxelBuffer src(VoxelBuffer::ALLOCATOR_DEFAULT);
+		src.create(Vector3i(20, 20, 20));
+		src.fill(5, VoxelBuffer::CHANNEL_TYPE);
+		tool->paste(Vector3i(-2, -2, -2), src, 1 << VoxelBuffer::CHANNEL_TYPE);
+		ZN_TEST_ASSERT(
+				buffer.get_channel_compression(VoxelBuffer::CHANNEL_TYPE) == VoxelBuffer::COMPRESSION_UNIFORM
+		);
+		ZN_TEST_ASSERT(buffer.get_voxel(Vector3i(), VoxelBuffer::CHANNEL_TYPE) == 5);
+	}
+
+	// Pasting part of a non-uniform buffer
+	{
+		VoxelBuffer src(VoxelBuffer::ALLOCATOR_DEFAULT);
+		src.create(Vector3i(4, 4, 4));
+		src.set_voxel(7, Vector3i(1, 2, 3), VoxelBuffer::CHANNEL_TYPE);
+		tool->paste(Vector3i(14, 0, 0), src, 1 << VoxelBuffer::CHANNEL_TYPE);
+		ZN_TEST_ASSERT(buffer.get_voxel(Vector3i(15, 2, 3), VoxelBuffer::CHANNEL_TYPE) == 7);
+		ZN_TEST_ASSERT(buffer.get_voxel(Vector3i(14, 2, 3), VoxelBuffer::CHANNEL_TYPE) == 0);
+		ZN_TEST_ASSERT(buffer.get_voxel(Vector3i(13, 2, 3), VoxelBuffer::CHANNEL_TYPE) == 5);
+	}
 }
 
 void test_box_blur() {
@@ -359,4 +485,65 @@ void test_sdf_hemisphere() {
 	ZN_TEST_ASSERT(shape(Vector3f(2, 0, 0)) > 0);
 }
 
+void test_connectivity_cache() {
+	VoxelData data;
+	const int block_size = data.get_block_size();
+
+	const Box3i blocks_box(Vector3i(), Vector3i(2, 1, 1));
+	blocks_box.for_each_cell_zxy([&data](Vector3i block_pos) {
+		std::shared_ptr<VoxelBuffer> buffer = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+		buffer->create(Vector3iUtil::create(data.get_block_size()));
+		buffer->fill_f(1.f, VoxelBuffer::CHANNEL_SDF);
+		VoxelDataBlock block(buffer, 0);
+		ZN_TEST_ASSERT(data.try_set_block(block_pos, block));
+	});
+
+	// A bar crossing the border between the two blocks, and an isolated voxel
+	for (int x = block_size - 4; x < block_size + 4; ++x) {
+		ZN_TEST_ASSERT(data.try_set_voxel_f(-1.f, Vector3i(x, 5, 5), VoxelBuffer::CHANNEL_SDF));
+	}
+	ZN_TEST_ASSERT(data.try_set_voxel_f(-1.f, Vector3i(2, 10, 10), VoxelBuffer::CHANNEL_SDF));
+
+	const Box3i voxel_box(Vector3i(), Vector3i(2 * block_size, block_size, block_size));
+	StdVector<uint8_t> labels;
+	labels.resize(Vector3iUtil::get_volume(voxel_box.size));
+
+	struct L {
+		static uint8_t get_label(const StdVector<uint8_t> &labels, Vector3i pos, Vector3i size) {
+			return labels[Vector3iUtil::get_zxy_index(pos, size)];
+		}
+	};
+
+	ConnectivityCache cache;
+	unsigned int label_count = 0;
+	ZN_TEST_ASSERT(cache.label_area(data, voxel_box, to_span(labels), label_count));
+	ZN_TEST_ASSERT(label_count == 2);
+	ZN_TEST_ASSERT(cache.get_cached_block_count() == 2);
+
+	const uint8_t bar_label = L::get_label(labels, Vector3i(block_size - 4, 5, 5), voxel_box.size);
+	ZN_TEST_ASSERT(bar_label != 0);
+	ZN_TEST_ASSERT(L::get_label(labels, Vector3i(block_size + 3, 5, 5), voxel_box.size) == bar_label);
+	const uint8_t voxel_label = L::get_label(labels, Vector3i(2, 10, 10), voxel_box.size);
+	ZN_TEST_ASSERT(voxel_label != 0 && voxel_label != bar_label);
+	ZN_TEST_ASSERT(L::get_label(labels, Vector3i(0, 0, 0), voxel_box.size) == 0);
+
+	// Cut the bar right after the border. Only the edited block should have to be labelled again.
+	const Vector3i cut_pos(block_size + 1, 5, 5);
+	ZN_TEST_ASSERT(data.try_set_voxel_f(1.f, cut_pos, VoxelBuffer::CHANNEL_SDF));
+	cache.invalidate_area(Box3i(cut_pos, Vector3i(1, 1, 1)));
+	ZN_TEST_ASSERT(cache.get_cached_block_count() == 1);
+
+	ZN_TEST_ASSERT(cache.label_area(data, voxel_box, to_span(labels), label_count));
+	ZN_TEST_ASSERT(label_count == 3);
+	ZN_TEST_ASSERT(cache.get_cached_block_count() == 2);
+	ZN_TEST_ASSERT(
+			L::get_label(labels, Vector3i(block_size - 4, 5, 5), voxel_box.size) ==
+			L::get_label(labels, Vector3i(block_size, 5, 5), voxel_box.size)
+	);
+	ZN_TEST_ASSERT(
+			L::get_label(labels, Vector3i(block_size, 5, 5), voxel_box.size) !=
+			L::get_label(labels, Vector3i(block_size + 3, 5, 5), voxel_box.size)
+	);
+}
+
 } // namespace zylann::voxel::tests
\ No newline at end of file
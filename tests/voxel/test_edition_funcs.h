@@ -4,9 +4,12 @@
 namespace zylann::voxel::tests {
 
 void test_run_blocky_random_tick();
+void test_random_tick_index();
+void test_voxel_tool_buffer_uniform_edits();
 void test_box_blur();
 void test_discord_soakil_copypaste();
 void test_sdf_hemisphere();
+void test_connectivity_cache();
 
 } // namespace zylann::voxel::tests
 
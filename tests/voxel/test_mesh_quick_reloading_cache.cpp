@@ -0,0 +1,59 @@
+#include "test_mesh_quick_reloading_cache.h"
+#include "../../terrain/fixed_lod/mesh_quick_reloading_cache.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_mesh_quick_reloading_cache() {
+	const uint32_t entry_size = 1000;
+
+	MeshQuickReloadingCache::Entry entry;
+	MeshQuickReloadingCache cache;
+
+	// Disabled by default
+	entry.mesh_size_in_bytes = entry_size;
+	cache.put(Vector3i(0, 0, 0), std::move(entry));
+	ZN_TEST_ASSERT(cache.get_entry_count() == 0);
+
+	// Room for 3 entries, including overhead
+	cache.set_max_size_in_bytes(3 * entry_size + 1000);
+
+	for (int i = 0; i < 4; ++i) {
+		entry.mesh_size_in_bytes = entry_size;
+		cache.put(Vector3i(i, 0, 0), std::move(entry));
+	}
+
+	// The first entry got evicted
+	ZN_TEST_ASSERT(cache.get_entry_count() == 3);
+	ZN_TEST_ASSERT(cache.get_size_in_bytes() <= cache.get_max_size_in_bytes());
+	ZN_TEST_ASSERT(!cache.take(Vector3i(0, 0, 0), entry));
+
+	// Taking an entry removes it
+	ZN_TEST_ASSERT(cache.take(Vector3i(1, 0, 0), entry));
+	ZN_TEST_ASSERT(entry.mesh_size_in_bytes == entry_size);
+	ZN_TEST_ASSERT(!cache.take(Vector3i(1, 0, 0), entry));
+	ZN_TEST_ASSERT(cache.get_entry_count() == 2);
+
+	// Putting it back makes it the most recent, so the next eviction removes the oldest remaining one
+	cache.put(Vector3i(1, 0, 0), std::move(entry));
+	entry.mesh_size_in_bytes = entry_size;
+	cache.put(Vector3i(4, 0, 0), std::move(entry));
+	ZN_TEST_ASSERT(cache.get_entry_count() == 3);
+	ZN_TEST_ASSERT(!cache.take(Vector3i(2, 0, 0), entry));
+
+	// Edits remove entries in an area
+	cache.remove_area(Box3i(Vector3i(3, 0, 0), Vector3i(2, 1, 1)));
+	ZN_TEST_ASSERT(cache.get_entry_count() == 1);
+	ZN_TEST_ASSERT(cache.take(Vector3i(1, 0, 0), entry));
+	ZN_TEST_ASSERT(cache.get_entry_count() == 0);
+	ZN_TEST_ASSERT(cache.get_size_in_bytes() == 0);
+
+	// Many cycles of putting and taking the same entry
+	for (int i = 0; i < 1000; ++i) {
+		cache.put(Vector3i(5, 0, 0), std::move(entry));
+		ZN_TEST_ASSERT(cache.take(Vector3i(5, 0, 0), entry));
+	}
+	ZN_TEST_ASSERT(cache.get_size_in_bytes() == 0);
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_MESH_QUICK_RELOADING_CACHE_H
+#define VOXEL_TEST_MESH_QUICK_RELOADING_CACHE_H
+
+namespace zylann::voxel::tests {
+
+void test_mesh_quick_reloading_cache();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_MESH_QUICK_RELOADING_CACHE_H
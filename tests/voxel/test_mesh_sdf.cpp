@@ -1,5 +1,8 @@
 #include "test_mesh_sdf.h"
+#include "../../edition/mesh_sdf.h"
 #include "../../edition/voxel_mesh_sdf_gd.h"
+#include "../../util/containers/fixed_array.h"
+#include "../testing.h"
 
 namespace zylann::voxel::tests {
 
@@ -30,4 +33,44 @@ void test_voxel_mesh_sdf_issue463() {
 	msdf->call("_set_data", d);
 }
 
+void test_voxel_mesh_sdf_bvh() {
+	// Box with outward-facing triangles
+	FixedArray<Vector3, 8> vertices;
+	for (unsigned int i = 0; i < vertices.size(); ++i) {
+		vertices[i] = Vector3((i & 1) == 0 ? -1 : 1, (i & 2) == 0 ? -1 : 1, (i & 4) == 0 ? -1 : 1);
+	}
+	const int indices[] = {
+		0, 1, 3, 0, 3, 2, // -Z
+		4, 6, 7, 4, 7, 5, // +Z
+		0, 4, 5, 0, 5, 1, // -Y
+		2, 3, 7, 2, 7, 6, // +Y
+		0, 2, 6, 0, 6, 4, // -X
+		1, 5, 7, 1, 7, 3 // +X
+	};
+
+	StdVector<mesh_sdf::Triangle> triangles;
+	Vector3f min_pos;
+	Vector3f max_pos;
+	ZN_TEST_ASSERT(mesh_sdf::prepare_triangles(
+			to_span_const(vertices), Span<const int>(indices, 36), triangles, min_pos, max_pos
+	));
+
+	const Vector3f box_min_pos = min_pos - Vector3f(0.5f);
+	const Vector3f box_max_pos = max_pos + Vector3f(0.5f);
+	const Vector3i res(12, 12, 12);
+
+	StdVector<float> expected_sdf;
+	expected_sdf.resize(Vector3iUtil::get_volume(res));
+	mesh_sdf::generate_mesh_sdf_naive(to_span(expected_sdf), res, to_span(triangles), box_min_pos, box_max_pos);
+
+	StdVector<float> sdf;
+	sdf.resize(Vector3iUtil::get_volume(res));
+	mesh_sdf::generate_mesh_sdf_bvh(to_span(sdf), res, to_span(triangles), box_min_pos, box_max_pos);
+
+	// The BVH only skips triangles that can't be the closest, so results must be the same
+	for (unsigned int i = 0; i < sdf.size(); ++i) {
+		ZN_TEST_ASSERT(Math::abs(Math::abs(sdf[i]) - Math::abs(expected_sdf[i])) < 0.0001f);
+	}
+}
+
 } // namespace zylann::voxel::tests
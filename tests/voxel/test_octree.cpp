@@ -151,6 +151,109 @@ void test_octree_update() {
 	ZN_TEST_ASSERT(block_count == 0);
 }
 
+void test_octree_moving_viewer() {
+	static const int lod_count = 8;
+	static const float lod_distance_octree_space = 2.f;
+
+	struct OctreeActions {
+		int created_count = 0;
+		int destroyed_count = 0;
+		Vector3 viewer_pos_octree_space;
+
+		void create_child(Vector3i node_pos, int lod_index, LodOctree::NodeData &data) {
+			++created_count;
+		}
+
+		void destroy_child(Vector3i node_pos, int lod_index) {
+			++destroyed_count;
+		}
+
+		void show_parent(Vector3i node_pos, int lod_index) {}
+
+		void hide_parent(Vector3i node_pos, int lod_index) {}
+
+		bool can_create_root(int lod_index) {
+			return true;
+		}
+
+		bool can_split(Vector3i node_pos, int lod_index, LodOctree::NodeData &data) {
+			return LodOctree::is_below_split_distance(
+					node_pos, lod_index, viewer_pos_octree_space, lod_distance_octree_space
+			);
+		}
+
+		bool can_join(Vector3i node_pos, int parent_lod_index) {
+			return !LodOctree::is_below_split_distance(
+					node_pos, parent_lod_index, viewer_pos_octree_space, lod_distance_octree_space
+			);
+		}
+	};
+
+	// Joins only go up one level per update, so update until the octree doesn't change
+	struct L {
+		static void update_until_stable(LodOctree &octree, Vector3 viewer_pos) {
+			for (unsigned int i = 0; i < lod_count + 1; ++i) {
+				OctreeActions actions;
+				actions.viewer_pos_octree_space = viewer_pos;
+				octree.update(actions);
+				if (actions.created_count == 0 && actions.destroyed_count == 0) {
+					return;
+				}
+			}
+			ZN_TEST_ASSERT_MSG(false, "Octree did not stabilize");
+		}
+
+		static StdMap<Vector3i, int> get_leaves(const LodOctree &octree) {
+			StdMap<Vector3i, int> leaves;
+			octree.for_each_leaf([&leaves](Vector3i node_pos, int lod_index, const LodOctree::NodeData &data) {
+				leaves.insert({ node_pos, lod_index });
+			});
+			return leaves;
+		}
+	};
+
+	const float octree_size = 1 << (lod_count - 1);
+	const Vector3 center = Vector3(octree_size, octree_size, octree_size) * 0.5f;
+
+	// Move the viewer around so nodes keep getting split and joined, which scatters them in the node pool
+	LodOctree octree;
+	octree.create(lod_count);
+	Vector3 viewer_pos;
+	ProfilingClock profiling_clock;
+	for (unsigned int i = 0; i < 200; ++i) {
+		const float t = i * 0.1f;
+		viewer_pos = center + Vector3(Math::cos(t), Math::sin(t * 0.7f), Math::sin(t)) * (0.4f * octree_size);
+		L::update_until_stable(octree, viewer_pos);
+	}
+	const int time_moving = profiling_clock.restart();
+
+	// Must have the same shape as an octree built at the last position directly
+	LodOctree expected_octree;
+	expected_octree.create(lod_count);
+	L::update_until_stable(expected_octree, viewer_pos);
+
+	ZN_TEST_ASSERT(octree.get_node_count() == expected_octree.get_node_count());
+	ZN_TEST_ASSERT(L::get_leaves(octree) == L::get_leaves(expected_octree));
+
+	// Compacting doesn't change the shape
+	octree.optimize_layout();
+	ZN_TEST_ASSERT(octree.get_node_count() == expected_octree.get_node_count());
+	ZN_TEST_ASSERT(L::get_leaves(octree) == L::get_leaves(expected_octree));
+
+	// Measure traversal after compaction
+	profiling_clock.restart();
+	for (unsigned int i = 0; i < 100; ++i) {
+		OctreeActions actions;
+		actions.viewer_pos_octree_space = viewer_pos;
+		octree.update(actions);
+		ZN_TEST_ASSERT(actions.created_count == 0 && actions.destroyed_count == 0);
+	}
+	const int time_stay = profiling_clock.restart();
+
+	print_line(String("Moving viewer: {0} nodes, moving time: {1} us, 100 stay updates time: {2} us")
+					   .format(varray(octree.get_node_count(), time_moving, time_stay)));
+}
+
 void test_octree_find_in_box() {
 	const int blocks_across = 32;
 	const int block_size = 16;
@@ -4,6 +4,7 @@
 namespace zylann::voxel::tests {
 
 void test_octree_update();
+void test_octree_moving_viewer();
 void test_octree_find_in_box();
 
 } // namespace zylann::voxel::tests
@@ -0,0 +1,157 @@
+#include "test_priority_dependency.h"
+#include "../../engine/priority_dependency.h"
+#include "../../util/math/funcs.h"
+#include "../../util/memory/memory.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_priority_dependency_cache() {
+	std::shared_ptr<PriorityDependency::ViewersData> viewers = make_shared_instance<PriorityDependency::ViewersData>();
+	viewers->viewers.resize(1);
+	viewers->viewers[0] = Vector3f();
+	viewers->viewers_count = 1;
+
+	const uint8_t lod_index = 0;
+	const float drop_distance = 200.f;
+
+	PriorityDependency cached_dep;
+	cached_dep.shared = viewers;
+	cached_dep.world_position = Vector3f(100.f, 0.f, 0.f);
+	cached_dep.drop_distance_squared = drop_distance * drop_distance;
+
+	bool reused_cache = false;
+
+	// Move the viewer away from the task by small steps, updating travel like viewer syncing does.
+	// Results must be the same as if priority was evaluated from scratch every time.
+	for (unsigned int i = 0; i < 200; ++i) {
+		const Vector3f prev_position = viewers->viewers[0];
+		const Vector3f position(-1.5f * i, 0.5f, 0.f);
+		viewers->viewers[0] = position;
+		viewers->travelled_distance = viewers->travelled_distance + math::distance(prev_position, position);
+
+		PriorityDependency fresh_dep;
+		fresh_dep.shared = viewers;
+		fresh_dep.world_position = cached_dep.world_position;
+		fresh_dep.drop_distance_squared = cached_dep.drop_distance_squared;
+
+		const double prev_cached_travelled_distance = cached_dep.cached_travelled_distance;
+
+		float cached_distance_sq;
+		const TaskPriority cached_priority = cached_dep.evaluate(lod_index, 0, &cached_distance_sq);
+		float fresh_distance_sq;
+		const TaskPriority fresh_priority = fresh_dep.evaluate(lod_index, 0, &fresh_distance_sq);
+
+		ZN_TEST_ASSERT(cached_priority == fresh_priority);
+		ZN_TEST_ASSERT(
+				(cached_distance_sq > cached_dep.drop_distance_squared) ==
+				(fresh_distance_sq > fresh_dep.drop_distance_squared)
+		);
+
+		if (i > 0 && cached_dep.cached_travelled_distance == prev_cached_travelled_distance) {
+			reused_cache = true;
+		}
+	}
+
+	ZN_TEST_ASSERT(reused_cache);
+
+	// Replacing viewers invalidates cached results even if they didn't travel
+	viewers->viewers[0] = cached_dep.world_position;
+	++viewers->version;
+	float distance_sq;
+	const TaskPriority priority = cached_dep.evaluate(lod_index, 0, &distance_sq);
+	ZN_TEST_ASSERT(distance_sq == 0.f);
+	ZN_TEST_ASSERT(priority.band0 == TaskPriority::BAND_MAX);
+}
+
+void test_priority_dependency_prediction() {
+	std::shared_ptr<PriorityDependency::ViewersData> viewers = make_shared_instance<PriorityDependency::ViewersData>();
+	viewers->viewers.resize(1);
+	viewers->predicted_viewers.resize(1);
+	viewers->viewers[0] = Vector3f();
+	viewers->predicted_viewers[0] = Vector3f(250.f, 0.f, 0.f);
+	viewers->viewers_count = 1;
+
+	const uint8_t lod_index = 0;
+	const float drop_distance = 100.f;
+
+	// Task ahead of the viewer, beyond drop distance but close to where the viewer is going
+	PriorityDependency ahead_dep;
+	ahead_dep.shared = viewers;
+	ahead_dep.world_position = Vector3f(200.f, 0.f, 0.f);
+	ahead_dep.drop_distance_squared = drop_distance * drop_distance;
+
+	// Task behind, at the same distance
+	PriorityDependency behind_dep;
+	behind_dep.shared = viewers;
+	behind_dep.world_position = Vector3f(-200.f, 0.f, 0.f);
+	behind_dep.drop_distance_squared = drop_distance * drop_distance;
+
+	float ahead_distance_sq;
+	const TaskPriority ahead_priority = ahead_dep.evaluate(lod_index, 0, &ahead_distance_sq);
+	float behind_distance_sq;
+	const TaskPriority behind_priority = behind_dep.evaluate(lod_index, 0, &behind_distance_sq);
+
+	// Only the task ahead is kept
+	ZN_TEST_ASSERT(ahead_distance_sq <= ahead_dep.drop_distance_squared);
+	ZN_TEST_ASSERT(behind_distance_sq > behind_dep.drop_distance_squared);
+	// Priority still depends on the current position of the viewer
+	ZN_TEST_ASSERT(ahead_priority == behind_priority);
+
+	// Without prediction, the task ahead is dropped too
+	viewers->predicted_viewers[0] = viewers->viewers[0];
+	++viewers->version;
+	ahead_dep.evaluate(lod_index, 0, &ahead_distance_sq);
+	ZN_TEST_ASSERT(ahead_distance_sq > ahead_dep.drop_distance_squared);
+}
+
+void test_priority_dependency_view_cone() {
+	std::shared_ptr<PriorityDependency::ViewersData> viewers = make_shared_instance<PriorityDependency::ViewersData>();
+	viewers->viewers.resize(1);
+	viewers->view_cones.resize(1);
+	viewers->viewers[0] = Vector3f();
+	viewers->viewers_count = 1;
+
+	PriorityDependency::ViewCone &cone = viewers->view_cones[0];
+	cone.direction = Vector3f(1.f, 0.f, 0.f);
+	cone.cos_half_angle = Math::cos(math::deg_to_rad(45.f));
+	cone.enabled = true;
+
+	const uint8_t lod_index = 0;
+	const float drop_distance = 200.f;
+
+	auto evaluate = [&viewers, lod_index, drop_distance](Vector3f position, float &out_distance_sq) {
+		PriorityDependency dep;
+		dep.shared = viewers;
+		dep.world_position = position;
+		dep.drop_distance_squared = drop_distance * drop_distance;
+		return dep.evaluate(lod_index, 0, &out_distance_sq);
+	};
+
+	float in_view_distance_sq;
+	const TaskPriority in_view_priority = evaluate(Vector3f(100.f, 0.f, 0.f), in_view_distance_sq);
+	float side_distance_sq;
+	const TaskPriority side_priority = evaluate(Vector3f(0.f, 0.f, 100.f), side_distance_sq);
+	float behind_distance_sq;
+	const TaskPriority behind_priority = evaluate(Vector3f(-100.f, 0.f, 0.f), behind_distance_sq);
+	float near_behind_distance_sq;
+	const TaskPriority near_behind_priority = evaluate(Vector3f(-10.f, 0.f, 0.f), near_behind_distance_sq);
+	float near_distance_sq;
+	const TaskPriority near_priority = evaluate(Vector3f(0.f, 0.f, 10.f), near_distance_sq);
+
+	ZN_TEST_ASSERT(in_view_priority.band0 > side_priority.band0);
+	ZN_TEST_ASSERT(side_priority.band0 > behind_priority.band0);
+	// Surroundings of the viewer are not affected
+	ZN_TEST_ASSERT(near_behind_priority == near_priority);
+	// Dropping is not affected
+	ZN_TEST_ASSERT(in_view_distance_sq == side_distance_sq);
+	ZN_TEST_ASSERT(side_distance_sq == behind_distance_sq);
+
+	// Without view cone, priority only depends on distance
+	cone.enabled = false;
+	float distance_sq;
+	ZN_TEST_ASSERT(evaluate(Vector3f(100.f, 0.f, 0.f), distance_sq) == side_priority);
+	ZN_TEST_ASSERT(evaluate(Vector3f(-100.f, 0.f, 0.f), distance_sq) == side_priority);
+}
+
+} // namespace zylann::voxel::tests
@@ -1,9 +1,12 @@
 #include "test_region_file.h"
 #include "../../streams/region/region_file.h"
 #include "../../streams/region/voxel_stream_region_files.h"
+#include "../../streams/voxel_block_serializer.h"
 #include "../../util/containers/std_unordered_map.h"
 #include "../../util/godot/core/random_pcg.h"
+#include "../../util/thread/thread.h"
 #include "../testing.h"
+#include <atomic>
 
 namespace zylann::voxel::tests {
 
@@ -200,4 +203,397 @@ void test_voxel_stream_region_files() {
 	}
 }
 
+void test_voxel_stream_region_files_load_blocks_in_box() {
+	const int block_size_po2 = 4;
+	const int block_size = 1 << block_size_po2;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	Ref<VoxelStreamRegionFiles> stream;
+	stream.instantiate();
+	stream->set_block_size_po2(block_size_po2);
+	// Small regions, so boxes overlap several of them
+	stream->set_region_size_po2(2);
+	stream->set_directory(test_dir.get_path());
+
+	struct L {
+		static unsigned int get_block_value(Vector3i bpos) {
+			return (bpos.x + 10) + (bpos.y + 10) * 20 + (bpos.z + 10) * 400;
+		}
+	};
+
+	StdVector<Vector3i> saved_positions;
+	const Box3i saved_box(Vector3i(-5, -5, -5), Vector3i(10, 10, 10));
+	saved_box.for_each_cell_zxy([&saved_positions](const Vector3i bpos) {
+		if (math::wrap(bpos.x + 2 * bpos.y + bpos.z, 3) == 0) {
+			saved_positions.push_back(bpos);
+		}
+	});
+
+	// Save in random order, so the order of blocks in files doesn't match their positions
+	RandomPCG rng;
+	rng.seed(131183);
+	for (unsigned int i = 0; i < saved_positions.size(); ++i) {
+		const unsigned int j = rng.rand() % saved_positions.size();
+		std::swap(saved_positions[i], saved_positions[j]);
+	}
+
+	StdUnorderedMap<Vector3i, unsigned int> expected_blocks;
+	for (const Vector3i bpos : saved_positions) {
+		VoxelBuffer buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		buffer.create(block_size, block_size, block_size);
+		buffer.fill(L::get_block_value(bpos), 0);
+		VoxelStream::VoxelQueryData q{ buffer, bpos, 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+		expected_blocks[bpos] = L::get_block_value(bpos);
+	}
+	stream->flush();
+
+	const Box3i boxes[] = {
+		Box3i(Vector3i(-3, -2, -4), Vector3i(6, 5, 7)), //
+		Box3i(Vector3i(2, 2, 2), Vector3i(10, 10, 10)), //
+		Box3i(Vector3i(100, 100, 100), Vector3i(4, 4, 4)) //
+	};
+
+	for (const Box3i box : boxes) {
+		VoxelStream::FullLoadingResult result;
+		stream->load_voxel_blocks_in_box(box, 0, result);
+
+		unsigned int expected_count = 0;
+		for (auto it = expected_blocks.begin(); it != expected_blocks.end(); ++it) {
+			if (box.contains(it->first)) {
+				++expected_count;
+			}
+		}
+		ZN_TEST_ASSERT(result.blocks.size() == expected_count);
+
+		for (const VoxelStream::FullLoadingResult::Block &block : result.blocks) {
+			ZN_TEST_ASSERT(box.contains(block.position));
+			ZN_TEST_ASSERT(block.voxels != nullptr);
+			auto it = expected_blocks.find(block.position);
+			ZN_TEST_ASSERT(it != expected_blocks.end());
+			ZN_TEST_ASSERT(block.voxels->get_voxel(Vector3i(3, 2, 1), 0) == it->second);
+		}
+	}
+}
+
+void test_voxel_stream_region_files_threaded() {
+	// Several threads load and save blocks in different regions at the same time, with fewer open regions allowed
+	// than there are regions in use, so they get closed and reopened often.
+	static const int block_size_po2 = 4;
+	static const int block_size = 1 << block_size_po2;
+	static const int region_size_po2 = 1;
+	static const unsigned int THREAD_COUNT = 4;
+	static const unsigned int REGIONS_PER_THREAD = 3;
+	static const unsigned int CYCLES = 100;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	Ref<VoxelStreamRegionFiles> stream;
+	stream.instantiate();
+	stream->set_block_size_po2(block_size_po2);
+	stream->set_region_size_po2(region_size_po2);
+	stream->set_max_open_regions(2);
+	stream->set_directory(test_dir.get_path());
+	ZN_TEST_ASSERT(stream->get_max_open_regions() == 2);
+
+	struct ThreadData {
+		VoxelStreamRegionFiles *stream = nullptr;
+		unsigned int thread_index = 0;
+		bool success = false;
+	};
+
+	FixedArray<ThreadData, THREAD_COUNT> thread_data;
+	FixedArray<Thread, THREAD_COUNT> threads;
+
+	for (unsigned int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+		ThreadData &td = thread_data[thread_index];
+		td.stream = stream.ptr();
+		td.thread_index = thread_index;
+
+		threads[thread_index].start(
+				[](void *userdata) {
+					ThreadData &td = *static_cast<ThreadData *>(userdata);
+					const int region_size = 1 << region_size_po2;
+
+					for (unsigned int cycle = 0; cycle < CYCLES; ++cycle) {
+						// Each thread uses its own row of regions
+						const Vector3i block_pos(
+								(cycle % REGIONS_PER_THREAD) * region_size, td.thread_index * region_size, 0);
+
+						VoxelBuffer buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+						buffer.create(block_size, block_size, block_size);
+						// Each block has a different value, so blocks mixed up across threads would be noticed
+						const int value = (td.thread_index * CYCLES + cycle) % 256;
+						const Vector3i fill_max(block_size, 1 + cycle % block_size, block_size);
+						buffer.fill_area(value, Vector3i(), fill_max, 0);
+
+						VoxelStream::VoxelQueryData save_query{ buffer, block_pos, 0, VoxelStream::RESULT_ERROR };
+						td.stream->save_voxel_block(save_query);
+
+						VoxelBuffer loaded_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+						loaded_buffer.create(block_size, block_size, block_size);
+						VoxelStream::VoxelQueryData load_query{
+							loaded_buffer, block_pos, 0, VoxelStream::RESULT_ERROR
+						};
+						td.stream->load_voxel_block(load_query);
+
+						if (load_query.result != VoxelStream::RESULT_BLOCK_FOUND || !loaded_buffer.equals(buffer)) {
+							return;
+						}
+					}
+					td.success = true;
+				},
+				&td);
+	}
+
+	for (unsigned int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+		threads[thread_index].wait_to_finish();
+		ZN_TEST_ASSERT(thread_data[thread_index].success);
+	}
+}
+
+void test_region_file_compaction() {
+	const int block_size_po2 = 4;
+	const int block_size = 1 << block_size_po2;
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String region_file_path = test_dir.get_path().path_join("test_region_file_compaction.vxr");
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	struct Chunk {
+		VoxelBuffer voxels;
+		Chunk() : voxels(VoxelBuffer::ALLOCATOR_DEFAULT) {}
+	};
+	StdUnorderedMap<Vector3i, Chunk> buffers;
+
+	RegionFormat region_format;
+	{
+		RegionFile region_file;
+
+		region_format = region_file.get_format();
+		region_format.block_size_po2 = block_size_po2;
+		{
+			VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+				region_format.channel_depths[channel_index] = voxel_buffer.get_channel_depth(channel_index);
+			}
+		}
+		ZN_TEST_ASSERT(region_file.set_format(region_format));
+		ZN_TEST_ASSERT(region_file.open(region_file_path, true) == OK);
+		const Vector3i region_size = region_format.region_size;
+
+		// Saving blocks of varying sizes several times leaves unused space at the end of the file, and blocks end up
+		// in the order they were last saved
+		for (int i = 0; i < 300; ++i) {
+			const Vector3i pos = Vector3i( //
+					rng.rand() % uint32_t(region_size.x / 4), //
+					rng.rand() % uint32_t(region_size.y / 4), //
+					rng.rand() % uint32_t(region_size.z / 4) //
+			);
+			VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			voxel_buffer.create(Vector3iUtil::create(block_size));
+			const int ymax = rng.rand() % block_size;
+			for (int z = 0; z < block_size; ++z) {
+				for (int x = 0; x < block_size; ++x) {
+					for (int y = 0; y < ymax; ++y) {
+						voxel_buffer.set_voxel(rng.rand() % 256, x, y, z, 0);
+					}
+				}
+			}
+			ZN_TEST_ASSERT(region_file.save_block(pos, voxel_buffer) == OK);
+			buffers[pos].voxels = std::move(voxel_buffer);
+		}
+
+		int64_t freed_bytes = 0;
+		ZN_TEST_ASSERT(region_file.compact(&freed_bytes) == OK);
+		ZN_TEST_ASSERT(freed_bytes > 0);
+
+		// Blocks remain readable from the same object
+		for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+			VoxelBuffer loaded_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(region_file.load_block(it->first, loaded_voxel_buffer) == OK);
+			ZN_TEST_ASSERT(it->second.voxels.equals(loaded_voxel_buffer));
+		}
+
+		// Nothing left to compact
+		ZN_TEST_ASSERT(region_file.compact(&freed_bytes) == OK);
+		ZN_TEST_ASSERT(freed_bytes == 0);
+
+		// Saving still works after compaction
+		VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		voxel_buffer.create(Vector3iUtil::create(block_size));
+		voxel_buffer.fill(42, 0);
+		const Vector3i pos(region_size.x - 1, 0, 0);
+		ZN_TEST_ASSERT(region_file.save_block(pos, voxel_buffer) == OK);
+		buffers[pos].voxels = std::move(voxel_buffer);
+	}
+	{
+		// Reopen
+		RegionFile region_file;
+		ZN_TEST_ASSERT(region_file.set_format(region_format));
+		ZN_TEST_ASSERT(region_file.open(region_file_path, false) == OK);
+
+		for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+			VoxelBuffer loaded_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(region_file.load_block(it->first, loaded_voxel_buffer) == OK);
+			ZN_TEST_ASSERT(it->second.voxels.equals(loaded_voxel_buffer));
+		}
+	}
+}
+
+void test_region_file_memory_mapping() {
+	const int block_size_po2 = 4;
+	const int block_size = 1 << block_size_po2;
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String region_file_path = test_dir.get_path().path_join("test_region_file_memory_mapping.vxr");
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	struct Chunk {
+		VoxelBuffer voxels;
+		Chunk() : voxels(VoxelBuffer::ALLOCATOR_DEFAULT) {}
+	};
+	StdUnorderedMap<Vector3i, Chunk> buffers;
+
+	{
+		RegionFile region_file;
+		region_file.set_memory_mapping_enabled(true);
+
+		RegionFormat region_format = region_file.get_format();
+		region_format.block_size_po2 = block_size_po2;
+		{
+			VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+				region_format.channel_depths[channel_index] = voxel_buffer.get_channel_depth(channel_index);
+			}
+		}
+		ZN_TEST_ASSERT(region_file.set_format(region_format));
+
+		ZN_TEST_ASSERT(region_file.open(region_file_path, true) == OK);
+		const Vector3i region_size = region_format.region_size;
+
+		for (int i = 0; i < 200; ++i) {
+			const Vector3i pos = Vector3i( //
+					rng.rand() % uint32_t(region_size.x), //
+					rng.rand() % uint32_t(region_size.y), //
+					rng.rand() % uint32_t(region_size.z) //
+			);
+			VoxelBuffer voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			voxel_buffer.create(Vector3iUtil::create(block_size));
+			// Vary how much data is written so blocks sometimes have to move to other sectors
+			const int ymax = rng.rand() % block_size;
+			for (int z = 0; z < block_size; ++z) {
+				for (int x = 0; x < block_size; ++x) {
+					for (int y = 0; y < ymax; ++y) {
+						voxel_buffer.set_voxel(rng.rand() % 256, x, y, z, 0);
+					}
+				}
+			}
+			ZN_TEST_ASSERT(region_file.save_block(pos, voxel_buffer) == OK);
+			buffers[pos].voxels = std::move(voxel_buffer);
+
+			// Interleave reads with writes, so the mapping has to be updated
+			VoxelBuffer loaded_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(region_file.load_block(pos, loaded_voxel_buffer) == OK);
+			ZN_TEST_ASSERT(buffers[pos].voxels.equals(loaded_voxel_buffer));
+		}
+
+		if (region_file.is_memory_mapping_enabled()) {
+			// Mapped data must remain unmodified while it is held, even if another thread closes the region and
+			// rewrites the block with a new region file object
+			struct Context {
+				RegionFile *region_file;
+				String path;
+				Vector3i position;
+				VoxelBuffer *new_voxels;
+				std::atomic_bool closed = { false };
+				std::atomic_bool rewritten = { false };
+			};
+
+			RegionFile::MappedBlockData mapped_data;
+			const Vector3i pos = buffers.begin()->first;
+			ZN_TEST_ASSERT(region_file.get_mapped_block_data(pos, mapped_data) == OK);
+
+			// Smaller than the original, so it gets written in place over the sectors being read
+			VoxelBuffer new_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			buffers.begin()->second.voxels.copy_to(new_voxel_buffer, true);
+			new_voxel_buffer.fill(0, 0);
+			new_voxel_buffer.set_voxel(1, Vector3i(1, 2, 3), 0);
+
+			Context ctx;
+			ctx.region_file = &region_file;
+			ctx.path = region_file_path;
+			ctx.position = pos;
+			ctx.new_voxels = &new_voxel_buffer;
+
+			Thread thread;
+			thread.start(
+					[](void *userdata) {
+						Context &ctx = *static_cast<Context *>(userdata);
+						ZN_TEST_ASSERT(ctx.region_file->close() == OK);
+						ctx.closed = true;
+
+						RegionFile other_region_file;
+						other_region_file.set_memory_mapping_enabled(true);
+						ZN_TEST_ASSERT(other_region_file.open(ctx.path, false) == OK);
+						ZN_TEST_ASSERT(other_region_file.save_block(ctx.position, *ctx.new_voxels) == OK);
+						ZN_TEST_ASSERT(other_region_file.close() == OK);
+						ctx.rewritten = true;
+					},
+					&ctx
+			);
+
+			// Give time to the thread to try closing
+			Thread::sleep_usec(20000);
+			ZN_TEST_ASSERT(ctx.closed == false);
+
+			VoxelBuffer loaded_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+				loaded_voxel_buffer.set_channel_depth(channel_index, region_format.channel_depths[channel_index]);
+			}
+			ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(mapped_data.get_data(), loaded_voxel_buffer));
+			ZN_TEST_ASSERT(buffers.begin()->second.voxels.equals(loaded_voxel_buffer));
+			ZN_TEST_ASSERT(ctx.rewritten == false);
+
+			mapped_data.release();
+			thread.wait_to_finish();
+			ZN_TEST_ASSERT(ctx.rewritten == true);
+
+			buffers.begin()->second.voxels = std::move(new_voxel_buffer);
+		}
+	}
+	// Read back with a new region file object
+	{
+		RegionFile region_file;
+		region_file.set_memory_mapping_enabled(true);
+		ZN_TEST_ASSERT(region_file.open(region_file_path, false) == OK);
+
+		for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+			VoxelBuffer loaded_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(region_file.load_block(it->first, loaded_voxel_buffer) == OK);
+			ZN_TEST_ASSERT(it->second.voxels.equals(loaded_voxel_buffer));
+		}
+
+		VoxelBuffer loaded_voxel_buffer(VoxelBuffer::ALLOCATOR_DEFAULT);
+		const Vector3i region_size = region_file.get_format().region_size;
+		for (int z = 0; z < region_size.z; ++z) {
+			for (int x = 0; x < region_size.x; ++x) {
+				for (int y = 0; y < region_size.y; ++y) {
+					const Vector3i pos(x, y, z);
+					if (buffers.find(pos) == buffers.end()) {
+						ZN_TEST_ASSERT(region_file.load_block(pos, loaded_voxel_buffer) == ERR_DOES_NOT_EXIST);
+					}
+				}
+			}
+		}
+	}
+}
+
 } // namespace zylann::voxel::tests
@@ -4,7 +4,11 @@
 namespace zylann::voxel::tests {
 
 void test_region_file();
+void test_region_file_memory_mapping();
+void test_region_file_compaction();
 void test_voxel_stream_region_files();
+void test_voxel_stream_region_files_threaded();
+void test_voxel_stream_region_files_load_blocks_in_box();
 
 } // namespace zylann::voxel::tests
 
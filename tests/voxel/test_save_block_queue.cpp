@@ -0,0 +1,100 @@
+#include "test_save_block_queue.h"
+#include "../../streams/save_block_queue.h"
+#include "../../streams/voxel_stream_memory.h"
+#include "../../util/memory/memory.h"
+#include "../../util/tasks/async_dependency_tracker.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_save_block_queue() {
+	Ref<VoxelStreamMemory> stream;
+	stream.instantiate();
+
+	SaveBlockQueue queue;
+
+	const Vector3i pos0(1, 2, 3);
+	const Vector3i pos1(-4, 0, 5);
+
+	std::shared_ptr<VoxelBuffer> vb0a = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb0a->create(Vector3i(16, 16, 16));
+	vb0a->fill_area(1, Vector3i(2, 2, 2), Vector3i(8, 8, 8), 0);
+
+	std::shared_ptr<VoxelBuffer> vb0b = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb0b->create(Vector3i(16, 16, 16));
+	vb0b->fill_area(2, Vector3i(4, 4, 4), Vector3i(12, 12, 12), 0);
+
+	std::shared_ptr<VoxelBuffer> vb1 = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb1->create(Vector3i(16, 16, 16));
+	vb1->fill_area(3, Vector3i(0, 0, 0), Vector3i(16, 1, 16), 0);
+
+	std::shared_ptr<AsyncDependencyTracker> tracker = make_shared_instance<AsyncDependencyTracker>(3);
+
+	for (int i = 0; i < 3; ++i) {
+		queue.add_pending_task();
+	}
+
+	{
+		const SaveBlockQueue::PushResult res = queue.push(pos0, 0, vb0a, StdVector<uint8_t>(), tracker, true);
+		ZN_TEST_ASSERT(res.block_count == 1);
+		ZN_TEST_ASSERT(res.pending_task_count == 2);
+	}
+	{
+		// Saving the same block again replaces the queued one
+		const SaveBlockQueue::PushResult res = queue.push(pos0, 0, vb0b, StdVector<uint8_t>(), tracker, true);
+		ZN_TEST_ASSERT(res.block_count == 1);
+		ZN_TEST_ASSERT(res.pending_task_count == 1);
+	}
+	{
+		// Same position but different LOD is a different block
+		const SaveBlockQueue::PushResult res = queue.push(pos1, 1, vb1, StdVector<uint8_t>(), tracker, true);
+		ZN_TEST_ASSERT(res.block_count == 2);
+		ZN_TEST_ASSERT(res.pending_task_count == 0);
+	}
+
+	// Queued blocks are loaded with their latest data, even though they haven't been written yet
+	{
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(queue.load_voxel_block(pos0, 0, loaded));
+		ZN_TEST_ASSERT(loaded.equals(*vb0b));
+		ZN_TEST_ASSERT(queue.load_voxel_block(pos1, 0, loaded) == false);
+	}
+	{
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		VoxelStream::VoxelQueryData q{ loaded, pos0, 0, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+	}
+	ZN_TEST_ASSERT(tracker->is_complete() == false);
+
+	// Only one flush task is needed until it runs
+	ZN_TEST_ASSERT(queue.request_flush());
+	ZN_TEST_ASSERT(queue.request_flush() == false);
+
+	queue.flush(**stream);
+
+	ZN_TEST_ASSERT(queue.request_flush());
+
+	ZN_TEST_ASSERT(queue.get_block_count() == 0);
+	ZN_TEST_ASSERT(tracker->is_complete());
+	{
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(queue.load_voxel_block(pos0, 0, loaded) == false);
+	}
+	{
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		VoxelStream::VoxelQueryData q{ loaded, pos0, 0, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(loaded.equals(*vb0b));
+	}
+	{
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		VoxelStream::VoxelQueryData q{ loaded, pos1, 1, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(loaded.equals(*vb1));
+	}
+}
+
+} // namespace zylann::voxel::tests
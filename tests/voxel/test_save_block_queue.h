@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_SAVE_BLOCK_QUEUE_H
+#define VOXEL_TEST_SAVE_BLOCK_QUEUE_H
+
+namespace zylann::voxel::tests {
+
+void test_save_block_queue();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_SAVE_BLOCK_QUEUE_H
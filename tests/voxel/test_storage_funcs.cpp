@@ -20,6 +20,47 @@ void test_encode_weights_packed_u16() {
 	ZN_TEST_ASSERT(weights == decoded_weights);
 }
 
+void test_decode_packed_u16_4i4w() {
+	for (unsigned int packed = 0; packed <= 0xffff; ++packed) {
+		const FixedArray<uint8_t, 4> indices = decode_indices_from_packed_u16(packed);
+		const FixedArray<uint8_t, 4> weights = decode_weights_from_packed_u16(packed);
+
+		bool distinct = true;
+		for (unsigned int i = 0; i < 4; ++i) {
+			const unsigned int nibble = (packed >> (i * 4)) & 0xf;
+			ZN_TEST_ASSERT(indices[i] == nibble);
+			ZN_TEST_ASSERT(weights[i] == (nibble << 4));
+			for (unsigned int j = i + 1; j < 4; ++j) {
+				if (((packed >> (j * 4)) & 0xf) == nibble) {
+					distinct = false;
+				}
+			}
+		}
+		ZN_TEST_ASSERT(are_packed_u16_indices_distinct(packed) == distinct);
+
+		for (unsigned int texture_index = 0; texture_index < 16; ++texture_index) {
+			unsigned int expected_position = 4;
+			for (unsigned int i = 0; i < 4; ++i) {
+				if (indices[i] == texture_index) {
+					expected_position = i;
+					break;
+				}
+			}
+			ZN_TEST_ASSERT(find_index_in_packed_u16(packed, texture_index) == expected_position);
+		}
+	}
+
+	// Painting with full weight
+	uint16_t indices = encode_indices_to_packed_u16(0, 1, 2, 3);
+	uint16_t weights = encode_weights_to_packed_u16_lossy(64, 64, 64, 64);
+	blend_texture_packed_u16(5, 1.f, indices, weights);
+	ZN_TEST_ASSERT(find_index_in_packed_u16(indices, 5) < 4);
+	const FixedArray<uint8_t, 4> decoded_weights = decode_weights_from_packed_u16(weights);
+	for (unsigned int i = 0; i < 4; ++i) {
+		ZN_TEST_ASSERT(decoded_weights[i] == (i == find_index_in_packed_u16(indices, 5) ? 240 : 0));
+	}
+}
+
 void test_copy_3d_region_zxy() {
 	struct L {
 		static void compare(Span<const uint16_t> srcs, Vector3i src_size, Vector3i src_min, Vector3i src_max,
@@ -0,0 +1,277 @@
+#include "test_stream_log.h"
+#include "../../streams/instance_data.h"
+#include "../../streams/log/voxel_stream_log.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/godot/classes/directory.h"
+#include "../../util/godot/classes/file_access.h"
+#include "../../util/godot/core/random_pcg.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+Ref<VoxelStreamLog> open_stream_log(const String &dirpath) {
+	Ref<VoxelStreamLog> stream;
+	stream.instantiate();
+	stream->set_directory(dirpath);
+	return stream;
+}
+
+void save_uniform_block(VoxelStreamLog &stream, Vector3i bpos, unsigned int value) {
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(16, 16, 16));
+	vb.fill(value, 0);
+	vb.set_voxel(value + 1, 1, 2, 3, 0);
+	VoxelStream::VoxelQueryData q{ vb, bpos, 0, VoxelStream::RESULT_ERROR };
+	stream.save_voxel_block(q);
+}
+
+// Noise so blocks take some space even when compressed
+void save_noise_block(VoxelStreamLog &stream, Vector3i bpos, unsigned int value, RandomPCG &rng) {
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(16, 16, 16));
+	vb.set_channel_depth(0, VoxelBuffer::DEPTH_16_BIT);
+	for (int z = 1; z < 16; ++z) {
+		for (int x = 1; x < 16; ++x) {
+			for (int y = 1; y < 16; ++y) {
+				vb.set_voxel(rng.rand() % 256, x, y, z, 0);
+			}
+		}
+	}
+	vb.set_voxel(value, 0, 0, 0, 0);
+
+	VoxelStream::VoxelQueryData q{ vb, bpos, 0, VoxelStream::RESULT_ERROR };
+	stream.save_voxel_block(q);
+}
+
+void check_block_values(VoxelStreamLog &stream, const StdUnorderedMap<Vector3i, unsigned int> &expected_values) {
+	for (auto it = expected_values.begin(); it != expected_values.end(); ++it) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		VoxelStream::VoxelQueryData q{ vb, it->first, 0, VoxelStream::RESULT_ERROR };
+		stream.load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.get_voxel(0, 0, 0, 0) == it->second);
+	}
+}
+
+VoxelStream::ResultCode load_block_value(VoxelStreamLog &stream, Vector3i bpos, unsigned int &out_value) {
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	VoxelStream::VoxelQueryData q{ vb, bpos, 0, VoxelStream::RESULT_ERROR };
+	stream.load_voxel_block(q);
+	if (q.result == VoxelStream::RESULT_BLOCK_FOUND) {
+		out_value = vb.get_voxel(0, 0, 0, 0);
+		ZN_TEST_ASSERT(vb.get_voxel(1, 2, 3, 0) == out_value + 1);
+	}
+	return q.result;
+}
+
+void save_instances(VoxelStreamLog &stream, Vector3i bpos, bool remove) {
+	UniquePtr<InstanceBlockData> data;
+	if (!remove) {
+		data = make_unique_instance<InstanceBlockData>();
+		data->position_range = 16.f;
+		InstanceBlockData::LayerData &layer = data->layers.emplace_back();
+		layer.id = 1;
+		layer.scale_min = 1.f;
+		layer.scale_max = 1.f;
+		layer.instances.push_back(InstanceBlockData::InstanceData{ Transform3f(Basis3f(), Vector3f(1, 2, 3)) });
+	}
+	VoxelStream::InstancesQueryData q{ std::move(data), bpos, 0, VoxelStream::RESULT_ERROR };
+	stream.save_instance_blocks(Span<VoxelStream::InstancesQueryData>(&q, 1));
+}
+
+VoxelStream::ResultCode load_instances(VoxelStreamLog &stream, Vector3i bpos) {
+	VoxelStream::InstancesQueryData q{ nullptr, bpos, 0, VoxelStream::RESULT_ERROR };
+	stream.load_instance_blocks(Span<VoxelStream::InstancesQueryData>(&q, 1));
+	if (q.result == VoxelStream::RESULT_BLOCK_FOUND) {
+		ZN_TEST_ASSERT(q.data != nullptr);
+		ZN_TEST_ASSERT(q.data->layers.size() == 1);
+		ZN_TEST_ASSERT(q.data->layers[0].instances.size() == 1);
+	}
+	return q.result;
+}
+
+} // namespace
+
+void test_voxel_stream_log_basic() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String dirpath = test_dir.get_path();
+
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath);
+		save_uniform_block(**stream, Vector3i(0, 0, 0), 10);
+		save_uniform_block(**stream, Vector3i(1, 0, 0), 20);
+		// Newer versions replace older ones
+		save_uniform_block(**stream, Vector3i(0, 0, 0), 11);
+		save_instances(**stream, Vector3i(0, 0, 0), false);
+		save_instances(**stream, Vector3i(1, 0, 0), false);
+		save_instances(**stream, Vector3i(1, 0, 0), true);
+
+		unsigned int value = 0;
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(0, 0, 0), value) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(value == 11);
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(2, 0, 0), value) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+		// Voxels and instances of a block are separate
+		ZN_TEST_ASSERT(load_instances(**stream, Vector3i(0, 0, 0)) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(load_instances(**stream, Vector3i(1, 0, 0)) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+
+		save_uniform_block(**stream, Vector3i(3, 0, 0), 30);
+	}
+
+	// Simulate a record partially written at the end of the last segment
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath);
+		save_uniform_block(**stream, Vector3i(4, 0, 0), 40);
+		ZN_TEST_ASSERT(stream->get_segment_count() >= 1);
+	}
+	{
+		Ref<DirAccess> da = zylann::godot::open_directory(dirpath);
+		ZN_TEST_ASSERT(da.is_valid());
+		String last_segment_path;
+		int64_t last_segment_id = -1;
+		da->list_dir_begin();
+		for (String fname = da->get_next(); fname != ""; fname = da->get_next()) {
+			if (fname.ends_with(".seg") && fname.get_basename().to_int() > last_segment_id) {
+				last_segment_id = fname.get_basename().to_int();
+				last_segment_path = dirpath.path_join(fname);
+			}
+		}
+		da->list_dir_end();
+		ZN_TEST_ASSERT(last_segment_id >= 0);
+
+		Error err;
+		Ref<FileAccess> f = zylann::godot::open_file(last_segment_path, FileAccess::READ_WRITE, err);
+		ZN_TEST_ASSERT(f.is_valid());
+		f->seek_end();
+		const uint8_t garbage[] = { 0x56, 0x4c, 0x4f, 0x47, 0, 0, 0, 0, 1, 2, 3 };
+		zylann::godot::store_buffer(**f, Span<const uint8_t>(garbage, sizeof(garbage)));
+	}
+
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath);
+		unsigned int value = 0;
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(0, 0, 0), value) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(value == 11);
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(1, 0, 0), value) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(value == 20);
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(3, 0, 0), value) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(value == 30);
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(4, 0, 0), value) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(value == 40);
+		ZN_TEST_ASSERT(load_instances(**stream, Vector3i(0, 0, 0)) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(load_instances(**stream, Vector3i(1, 0, 0)) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+
+		VoxelStream::FullLoadingResult result;
+		stream->load_all_blocks(result);
+		ZN_TEST_ASSERT(result.blocks.size() == 4);
+	}
+}
+
+void test_voxel_stream_log_compaction() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+	const String dirpath = test_dir.get_path();
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	StdUnorderedMap<Vector3i, unsigned int> expected_values;
+
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath);
+		stream->set_max_segment_size(VoxelStreamLog::MIN_SEGMENT_SIZE);
+		// Only compact when asked to
+		stream->set_compaction_threshold(0.f);
+
+		for (unsigned int cycle = 0; cycle < 400; ++cycle) {
+			const Vector3i bpos(cycle % 20, 0, 0);
+			const unsigned int value = cycle;
+			save_noise_block(**stream, bpos, value, rng);
+			expected_values[bpos] = value;
+		}
+
+		const int segment_count_before = stream->get_segment_count();
+		ZN_TEST_ASSERT(segment_count_before > 2);
+		ZN_TEST_ASSERT(stream->compact_segments() > 0);
+		ZN_TEST_ASSERT(stream->get_segment_count() < segment_count_before);
+	}
+
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath);
+		check_block_values(**stream, expected_values);
+	}
+
+	// Deleted blocks must not come back when compaction removes the segment where they were deleted, while an older
+	// segment still has them
+	const String dirpath2 = dirpath.path_join("deletions");
+	const unsigned int instance_block_count = 4;
+	expected_values.clear();
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath2);
+		stream->set_max_segment_size(VoxelStreamLog::MIN_SEGMENT_SIZE);
+		stream->set_compaction_threshold(0.f);
+
+		// First segment: instances, then blocks that remain live
+		for (unsigned int i = 0; i < instance_block_count; ++i) {
+			save_instances(**stream, Vector3i(i, 1, 0), false);
+		}
+		unsigned int value = 0;
+		while (stream->get_segment_count() < 2) {
+			const Vector3i bpos(value, 2, 0);
+			save_noise_block(**stream, bpos, value, rng);
+			expected_values[bpos] = value;
+			++value;
+		}
+
+		// Second segment: deletions, then blocks that get replaced in the third segment
+		for (unsigned int i = 0; i < instance_block_count; ++i) {
+			save_instances(**stream, Vector3i(i, 1, 0), true);
+		}
+		const unsigned int replaced_block_count = 3;
+		unsigned int cycle = 0;
+		while (stream->get_segment_count() < 3) {
+			const Vector3i bpos(cycle % replaced_block_count, 0, 0);
+			save_noise_block(**stream, bpos, value, rng);
+			expected_values[bpos] = value;
+			++value;
+			++cycle;
+		}
+		for (unsigned int i = 0; i < replaced_block_count; ++i) {
+			const Vector3i bpos(i, 0, 0);
+			save_noise_block(**stream, bpos, value, rng);
+			expected_values[bpos] = value;
+			++value;
+		}
+		ZN_TEST_ASSERT(stream->get_segment_count() == 3);
+
+		// Only deletions are live in the second segment now, so it is the only one to compact
+		stream->set_compaction_threshold(0.5f);
+		save_uniform_block(**stream, Vector3i(0, 3, 0), 10);
+		ZN_TEST_ASSERT(stream->get_segment_count() == 2);
+
+		for (unsigned int i = 0; i < instance_block_count; ++i) {
+			ZN_TEST_ASSERT(load_instances(**stream, Vector3i(i, 1, 0)) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+		}
+	}
+
+	// Without checkpoint, all segments are read again
+	{
+		Ref<DirAccess> da = zylann::godot::open_directory(dirpath2);
+		ZN_TEST_ASSERT(da.is_valid());
+		ZN_TEST_ASSERT(da->remove(dirpath2.path_join("index.bin")) == OK);
+	}
+	{
+		Ref<VoxelStreamLog> stream = open_stream_log(dirpath2);
+		for (unsigned int i = 0; i < instance_block_count; ++i) {
+			ZN_TEST_ASSERT(load_instances(**stream, Vector3i(i, 1, 0)) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+		}
+		check_block_values(**stream, expected_values);
+		unsigned int value = 0;
+		ZN_TEST_ASSERT(load_block_value(**stream, Vector3i(0, 3, 0), value) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(value == 10);
+	}
+}
+
+} // namespace zylann::voxel::tests
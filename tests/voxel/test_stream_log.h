@@ -0,0 +1,11 @@
+#ifndef VOXEL_TESTS_STREAM_LOG_H
+#define VOXEL_TESTS_STREAM_LOG_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_stream_log_basic();
+void test_voxel_stream_log_compaction();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TESTS_STREAM_LOG_H
@@ -1,13 +1,20 @@
 #include "test_stream_sqlite.h"
+#include "../../streams/sqlite/block_key_index.h"
 #include "../../streams/sqlite/block_location.h"
+#include "../../streams/instance_data.h"
+#include "../../streams/mesh_block_serializer.h"
 #include "../../streams/sqlite/voxel_stream_sqlite.h"
 #include "../../util/containers/container_funcs.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_unordered_set.h"
 #include "../../util/godot/core/random_pcg.h"
 #include "../../util/math/conv.h"
 #include "../../util/math/vector3i.h"
+#include "../../util/memory/memory.h"
 #include "../../util/profiling.h"
 #include "../../util/profiling_clock.h"
 #include "../../util/string/format.h"
+#include "../../util/thread/thread.h"
 #include "../testing.h"
 
 namespace zylann::voxel::tests {
@@ -281,4 +288,639 @@ void test_voxel_stream_sqlite_key_blob80_encoding() {
 	test_voxel_stream_sqlite_key_blob80_encoding(Vector3i(max_pos.x, min_pos.y, max_pos.z), max_lod_index);
 }
 
+void test_voxel_stream_sqlite_wal_threaded() {
+	// Several threads save and load blocks at the same time, so connections get used concurrently. Enough blocks are
+	// saved to go through multiple cache flushes and transactions.
+	static const int block_size = 16;
+	static const unsigned int THREAD_COUNT = 4;
+	static const unsigned int BLOCKS_PER_THREAD = 200;
+
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+
+	struct L {
+		static void make_block(VoxelBuffer &vb, unsigned int thread_index, unsigned int block_index) {
+			vb.create(Vector3i(block_size, block_size, block_size));
+			// Each block has different contents, so blocks mixed up across threads would be noticed
+			const int value = (thread_index * BLOCKS_PER_THREAD + block_index) % 256;
+			vb.fill_area(value, Vector3i(), Vector3i(block_size, 1 + block_index % block_size, block_size), 0);
+		}
+
+		static Vector3i get_block_position(unsigned int thread_index, unsigned int block_index) {
+			return Vector3i(block_index, thread_index, -1);
+		}
+	};
+
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_wal_enabled(true);
+		stream->set_database_path(database_path);
+		ZN_TEST_ASSERT(stream->is_wal_enabled());
+
+		struct ThreadData {
+			VoxelStreamSQLite *stream = nullptr;
+			unsigned int thread_index = 0;
+			bool success = false;
+		};
+
+		FixedArray<ThreadData, THREAD_COUNT> thread_data;
+		FixedArray<Thread, THREAD_COUNT> threads;
+
+		for (unsigned int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+			ThreadData &td = thread_data[thread_index];
+			td.stream = stream.ptr();
+			td.thread_index = thread_index;
+
+			threads[thread_index].start(
+					[](void *userdata) {
+						ThreadData &td = *static_cast<ThreadData *>(userdata);
+
+						for (unsigned int block_index = 0; block_index < BLOCKS_PER_THREAD; ++block_index) {
+							const Vector3i bpos = L::get_block_position(td.thread_index, block_index);
+
+							VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+							L::make_block(vb, td.thread_index, block_index);
+
+							VoxelStream::VoxelQueryData save_query{ vb, bpos, 0, VoxelStream::RESULT_ERROR };
+							td.stream->save_voxel_block(save_query);
+
+							// Load a block saved earlier, which may have been flushed to the database by now
+							const unsigned int prev_block_index = block_index / 2;
+							VoxelBuffer expected_prev_vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+							L::make_block(expected_prev_vb, td.thread_index, prev_block_index);
+
+							VoxelBuffer loaded_vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+							VoxelStream::VoxelQueryData load_query{
+								loaded_vb,
+								L::get_block_position(td.thread_index, prev_block_index),
+								0,
+								VoxelStream::RESULT_ERROR
+							};
+							td.stream->load_voxel_block(load_query);
+
+							if (load_query.result != VoxelStream::RESULT_BLOCK_FOUND ||
+								!loaded_vb.equals(expected_prev_vb)) {
+								return;
+							}
+						}
+						td.success = true;
+					},
+					&td
+			);
+		}
+
+		for (unsigned int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+			threads[thread_index].wait_to_finish();
+			ZN_TEST_ASSERT(thread_data[thread_index].success);
+		}
+
+		stream->flush();
+	}
+	{
+		// Reopen and check everything got saved
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_wal_enabled(true);
+		stream->set_database_path(database_path);
+
+		for (unsigned int thread_index = 0; thread_index < THREAD_COUNT; ++thread_index) {
+			for (unsigned int block_index = 0; block_index < BLOCKS_PER_THREAD; ++block_index) {
+				VoxelBuffer expected_vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+				L::make_block(expected_vb, thread_index, block_index);
+
+				VoxelBuffer loaded_vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+				VoxelStream::VoxelQueryData q{
+					loaded_vb, L::get_block_position(thread_index, block_index), 0, VoxelStream::RESULT_ERROR
+				};
+				stream->load_voxel_block(q);
+				ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+				ZN_TEST_ASSERT(loaded_vb.equals(expected_vb));
+			}
+		}
+	}
+}
+
+void test_voxel_stream_sqlite_block_key_index() {
+	using namespace sqlite;
+
+	RandomPCG rng;
+	rng.seed(131183);
+
+	BlockKeyIndex index;
+	StdUnorderedSet<Vector3i> expected_keys;
+
+	// Random blocks, including negative coordinates, with more of them than some chunks can contain
+	for (unsigned int i = 0; i < 2000; ++i) {
+		const Vector3i bpos(int(rng.rand() % 40) - 20, int(rng.rand() % 40) - 20, int(rng.rand() % 40) - 20);
+		index.add(bpos, 0);
+		expected_keys.insert(bpos);
+	}
+	index.add(Vector3i(0, 0, 0), 2);
+
+	ZN_TEST_ASSERT(index.get_block_count() == expected_keys.size() + 1);
+
+	const Box3i test_box(Vector3i(-24, -24, -24), Vector3i(48, 48, 48));
+	test_box.for_each_cell([&index, &expected_keys](Vector3i bpos) {
+		const bool expected = expected_keys.find(bpos) != expected_keys.end();
+		ZN_TEST_ASSERT(index.contains(bpos, 0) == expected);
+		ZN_TEST_ASSERT(index.contains(bpos, 1) == false);
+	});
+	ZN_TEST_ASSERT(index.contains(Vector3i(0, 0, 0), 2));
+
+	for (unsigned int i = 0; i < 500; ++i) {
+		const Box3i box(
+				Vector3i(int(rng.rand() % 50) - 25, int(rng.rand() % 50) - 25, int(rng.rand() % 50) - 25),
+				Vector3i(1 + int(rng.rand() % 6), 1 + int(rng.rand() % 6), 1 + int(rng.rand() % 6))
+		);
+		bool expected = false;
+		box.for_each_cell([&expected, &expected_keys](Vector3i bpos) {
+			if (expected_keys.find(bpos) != expected_keys.end()) {
+				expected = true;
+			}
+		});
+		ZN_TEST_ASSERT(index.contains_any(box, 0) == expected);
+	}
+
+	StdVector<uint8_t> data;
+	index.serialize(data);
+
+	BlockKeyIndex index2;
+	ZN_TEST_ASSERT(index2.deserialize(to_span(data)));
+	ZN_TEST_ASSERT(index2.get_block_count() == index.get_block_count());
+	ZN_TEST_ASSERT(index2.get_chunk_count() == index.get_chunk_count());
+	for (const Vector3i bpos : expected_keys) {
+		ZN_TEST_ASSERT(index2.contains(bpos, 0));
+	}
+	ZN_TEST_ASSERT(index2.contains(Vector3i(0, 0, 0), 2));
+
+	// Truncated data must be rejected
+	BlockKeyIndex index3;
+	ZN_TEST_ASSERT(index3.deserialize(to_span(data).sub(0, data.size() - 1)) == false);
+	ZN_TEST_ASSERT(index3.get_block_count() == 0);
+}
+
+void test_voxel_stream_sqlite_persistent_key_cache() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(16, 16, 16));
+	vb.fill_area(1, Vector3i(5, 5, 5), Vector3i(10, 11, 12), 0);
+
+	const Vector3i saved_positions[] = { Vector3i(0, 0, 0), Vector3i(1, 0, 0), Vector3i(-5, 3, 100) };
+
+	struct L {
+		static Ref<VoxelStreamSQLite> open(const String &path) {
+			Ref<VoxelStreamSQLite> stream;
+			stream.instantiate();
+			stream->set_key_cache_enabled(true);
+			stream->set_key_cache_persistent(true);
+			stream->set_database_path(path);
+			return stream;
+		}
+
+		static VoxelStream::ResultCode load(VoxelStreamSQLite &stream, Vector3i bpos) {
+			VoxelBuffer loaded_vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+			VoxelStream::VoxelQueryData q{ loaded_vb, bpos, 0, VoxelStream::RESULT_ERROR };
+			stream.load_voxel_block(q);
+			return q.result;
+		}
+	};
+
+	{
+		Ref<VoxelStreamSQLite> stream = L::open(database_path);
+		// Loading first so the key cache gets initialized empty
+		ZN_TEST_ASSERT(L::load(**stream, Vector3i(0, 0, 0)) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+		for (const Vector3i bpos : saved_positions) {
+			VoxelBuffer vb_copy(VoxelBuffer::ALLOCATOR_DEFAULT);
+			vb.copy_to(vb_copy, true);
+			VoxelStream::VoxelQueryData q{ vb_copy, bpos, 0, VoxelStream::RESULT_ERROR };
+			stream->save_voxel_block(q);
+		}
+		stream->flush();
+	}
+	{
+		// The key cache is loaded from the database
+		Ref<VoxelStreamSQLite> stream = L::open(database_path);
+		for (const Vector3i bpos : saved_positions) {
+			ZN_TEST_ASSERT(L::load(**stream, bpos) == VoxelStream::RESULT_BLOCK_FOUND);
+		}
+		ZN_TEST_ASSERT(L::load(**stream, Vector3i(2, 0, 0)) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+	}
+	{
+		// Save a block without the key cache, so the saved one becomes outdated
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+		VoxelBuffer vb_copy(VoxelBuffer::ALLOCATOR_DEFAULT);
+		vb.copy_to(vb_copy, true);
+		VoxelStream::VoxelQueryData q{ vb_copy, Vector3i(2, 0, 0), 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+		stream->flush();
+	}
+	{
+		// The key cache has to be rebuilt, and must not miss the new block
+		Ref<VoxelStreamSQLite> stream = L::open(database_path);
+		ZN_TEST_ASSERT(L::load(**stream, Vector3i(2, 0, 0)) == VoxelStream::RESULT_BLOCK_FOUND);
+		for (const Vector3i bpos : saved_positions) {
+			ZN_TEST_ASSERT(L::load(**stream, bpos) == VoxelStream::RESULT_BLOCK_FOUND);
+		}
+	}
+}
+
+namespace {
+
+void test_voxel_stream_sqlite_load_blocks_in_box(
+		const VoxelStreamSQLite::CoordinateFormat coordinate_format,
+		const bool with_key_cache
+) {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+	const uint8_t lod_index = 2;
+
+	struct L {
+		static unsigned int get_block_value(Vector3i bpos) {
+			return (bpos.x + 10) + (bpos.y + 10) * 20 + (bpos.z + 10) * 400;
+		}
+
+		static void save(VoxelStreamSQLite &stream, Vector3i bpos, uint8_t lod_index, unsigned int value) {
+			VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+			vb.create(Vector3iUtil::create(1 << constants::DEFAULT_BLOCK_SIZE_PO2));
+			vb.fill(value, 0);
+			VoxelStream::VoxelQueryData q{ vb, bpos, lod_index, VoxelStream::RESULT_ERROR };
+			stream.save_voxel_block(q);
+		}
+	};
+
+	// Expected value of every block in the stream
+	StdUnorderedMap<Vector3i, unsigned int> expected_blocks;
+
+	Ref<VoxelStreamSQLite> stream;
+	stream.instantiate();
+	stream->set_preferred_coordinate_format(coordinate_format);
+	stream->set_key_cache_enabled(with_key_cache);
+	stream->set_database_path(database_path);
+
+	// Sparse blocks on both sides of zero, in the database
+	const Box3i saved_box(Vector3i(-4, -4, -4), Vector3i(8, 8, 8));
+	saved_box.for_each_cell_zxy([&stream, &expected_blocks, lod_index](const Vector3i bpos) {
+		if (math::wrap(bpos.x + bpos.y + bpos.z, 3) == 0) {
+			const unsigned int value = L::get_block_value(bpos);
+			L::save(**stream, bpos, lod_index, value);
+			expected_blocks[bpos] = value;
+		}
+	});
+	// Same positions in another LOD must not be returned
+	L::save(**stream, Vector3i(1, 1, 1), lod_index + 1, 1);
+	stream->flush();
+
+	// Blocks only in the cache, one of them more recent than the database
+	L::save(**stream, Vector3i(0, 0, 1), lod_index, 7);
+	expected_blocks[Vector3i(0, 0, 1)] = 7;
+	L::save(**stream, Vector3i(0, 0, 0), lod_index, 9);
+	expected_blocks[Vector3i(0, 0, 0)] = 9;
+
+	const Box3i boxes[] = {
+		// Crossing zero on all axes
+		Box3i(Vector3i(-2, -3, -2), Vector3i(5, 4, 6)),
+		// Only negative Z
+		Box3i(Vector3i(-1, 0, -4), Vector3i(3, 2, 3)),
+		// Partially outside of saved blocks
+		Box3i(Vector3i(2, 2, 2), Vector3i(10, 10, 10)),
+		// Empty area
+		Box3i(Vector3i(100, 100, 100), Vector3i(4, 4, 4)),
+	};
+
+	for (const Box3i box : boxes) {
+		VoxelStream::FullLoadingResult result;
+		stream->load_voxel_blocks_in_box(box, lod_index, result);
+
+		StdUnorderedSet<Vector3i> found_positions;
+		for (const VoxelStream::FullLoadingResult::Block &block : result.blocks) {
+			ZN_TEST_ASSERT(box.contains(block.position));
+			ZN_TEST_ASSERT(block.lod == lod_index);
+			ZN_TEST_ASSERT(block.voxels != nullptr);
+			// No duplicates
+			ZN_TEST_ASSERT(found_positions.insert(block.position).second);
+
+			auto it = expected_blocks.find(block.position);
+			ZN_TEST_ASSERT(it != expected_blocks.end());
+			ZN_TEST_ASSERT(block.voxels->get_voxel(Vector3i(1, 2, 3), 0) == it->second);
+		}
+
+		unsigned int expected_count = 0;
+		for (auto it = expected_blocks.begin(); it != expected_blocks.end(); ++it) {
+			if (box.contains(it->first)) {
+				++expected_count;
+			}
+		}
+		ZN_TEST_ASSERT(found_positions.size() == expected_count);
+	}
+}
+
+} // namespace
+
+void test_voxel_stream_sqlite_load_blocks_in_box() {
+	for (unsigned int format_index = 0; format_index < VoxelStreamSQLite::COORDINATE_FORMAT_COUNT; ++format_index) {
+		const VoxelStreamSQLite::CoordinateFormat format =
+				static_cast<VoxelStreamSQLite::CoordinateFormat>(format_index);
+		test_voxel_stream_sqlite_load_blocks_in_box(format, false);
+		test_voxel_stream_sqlite_load_blocks_in_box(format, true);
+	}
+}
+
+void test_voxel_stream_sqlite_load_all_blocks_deferred_decoding() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+
+	Ref<VoxelStreamSQLite> stream;
+	stream.instantiate();
+	stream->set_database_path(database_path);
+
+	StdUnorderedMap<Vector3i, unsigned int> expected_blocks;
+	const Box3i saved_box(Vector3i(-2, -2, -2), Vector3i(4, 4, 4));
+	saved_box.for_each_cell_zxy([&stream, &expected_blocks](const Vector3i bpos) {
+		const unsigned int value = 1 + (bpos.x + 2) + (bpos.y + 2) * 4 + (bpos.z + 2) * 16;
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		vb.create(Vector3iUtil::create(1 << constants::DEFAULT_BLOCK_SIZE_PO2));
+		vb.fill(value, 0);
+		VoxelStream::VoxelQueryData q{ vb, bpos, 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+		expected_blocks[bpos] = value;
+	});
+	stream->flush();
+
+	VoxelStream::FullLoadingResult result;
+	result.defer_voxel_decoding = true;
+	stream->load_all_blocks(result);
+
+	ZN_TEST_ASSERT(result.blocks.size() == expected_blocks.size());
+	for (const VoxelStream::FullLoadingResult::Block &block : result.blocks) {
+		ZN_TEST_ASSERT(block.voxels == nullptr);
+		ZN_TEST_ASSERT(block.compressed_voxels.size() > 0);
+
+		VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(stream->decompress_voxel_block(to_span_const(block.compressed_voxels), voxels));
+
+		auto it = expected_blocks.find(block.position);
+		ZN_TEST_ASSERT(it != expected_blocks.end());
+		ZN_TEST_ASSERT(voxels.get_voxel(Vector3i(1, 2, 3), 0) == it->second);
+	}
+}
+
+void test_voxel_stream_sqlite_separate_instance_blocks() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(16, 16, 16));
+	vb.fill_area(1, Vector3i(5, 5, 5), Vector3i(10, 11, 12), 0);
+
+	const Vector3i voxels_only_position(0, 0, 0);
+	const Vector3i both_position(1, 0, 0);
+	const Vector3i instances_only_position(2, 0, 0);
+
+	struct L {
+		static Ref<VoxelStreamSQLite> open(const String &path) {
+			Ref<VoxelStreamSQLite> stream;
+			stream.instantiate();
+			stream->set_key_cache_enabled(true);
+			stream->set_database_path(path);
+			return stream;
+		}
+
+		static void save_voxels(VoxelStreamSQLite &stream, const VoxelBuffer &src, Vector3i bpos) {
+			VoxelBuffer vb_copy(VoxelBuffer::ALLOCATOR_DEFAULT);
+			src.copy_to(vb_copy, true);
+			VoxelStream::VoxelQueryData q{ vb_copy, bpos, 0, VoxelStream::RESULT_ERROR };
+			stream.save_voxel_block(q);
+		}
+
+		static VoxelStream::ResultCode load_voxels(VoxelStreamSQLite &stream, Vector3i bpos) {
+			VoxelBuffer loaded_vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+			VoxelStream::VoxelQueryData q{ loaded_vb, bpos, 0, VoxelStream::RESULT_ERROR };
+			stream.load_voxel_block(q);
+			return q.result;
+		}
+
+		static void save_instances(VoxelStreamSQLite &stream, Vector3i bpos) {
+			UniquePtr<InstanceBlockData> data = make_unique_instance<InstanceBlockData>();
+			data->position_range = 16.f;
+			InstanceBlockData::LayerData &layer = data->layers.emplace_back();
+			layer.id = 1;
+			layer.scale_min = 1.f;
+			layer.scale_max = 1.f;
+			layer.instances.push_back(InstanceBlockData::InstanceData{ Transform3f(Basis3f(), Vector3f(1, 2, 3)) });
+			VoxelStream::InstancesQueryData q{ std::move(data), bpos, 0, VoxelStream::RESULT_ERROR };
+			stream.save_instance_blocks(Span<VoxelStream::InstancesQueryData>(&q, 1));
+		}
+
+		static VoxelStream::ResultCode load_instances(VoxelStreamSQLite &stream, Vector3i bpos) {
+			VoxelStream::InstancesQueryData q{ nullptr, bpos, 0, VoxelStream::RESULT_ERROR };
+			stream.load_instance_blocks(Span<VoxelStream::InstancesQueryData>(&q, 1));
+			if (q.result == VoxelStream::RESULT_BLOCK_FOUND) {
+				ZN_TEST_ASSERT(q.data != nullptr);
+				ZN_TEST_ASSERT(q.data->layers.size() == 1);
+				ZN_TEST_ASSERT(q.data->layers[0].instances.size() == 1);
+			}
+			return q.result;
+		}
+	};
+
+	{
+		Ref<VoxelStreamSQLite> stream = L::open(database_path);
+		L::save_voxels(**stream, vb, voxels_only_position);
+		L::save_voxels(**stream, vb, both_position);
+		L::save_instances(**stream, both_position);
+		L::save_instances(**stream, instances_only_position);
+		stream->flush();
+	}
+	{
+		// Saving voxels of a block must not affect its instances
+		Ref<VoxelStreamSQLite> stream = L::open(database_path);
+		L::save_voxels(**stream, vb, both_position);
+		stream->flush();
+	}
+	{
+		Ref<VoxelStreamSQLite> stream = L::open(database_path);
+
+		ZN_TEST_ASSERT(L::load_voxels(**stream, voxels_only_position) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(L::load_voxels(**stream, both_position) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(L::load_voxels(**stream, instances_only_position) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+
+		ZN_TEST_ASSERT(L::load_instances(**stream, voxels_only_position) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+		ZN_TEST_ASSERT(L::load_instances(**stream, both_position) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(L::load_instances(**stream, instances_only_position) == VoxelStream::RESULT_BLOCK_FOUND);
+
+		// Only blocks having voxels are returned
+		VoxelStream::FullLoadingResult result;
+		stream->load_all_blocks(result);
+		ZN_TEST_ASSERT(result.blocks.size() == 2);
+		for (const VoxelStream::FullLoadingResult::Block &block : result.blocks) {
+			ZN_TEST_ASSERT(block.position == voxels_only_position || block.position == both_position);
+			ZN_TEST_ASSERT(block.voxels != nullptr);
+		}
+	}
+}
+
+void test_voxel_stream_sqlite_mesh_blocks() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+	const uint64_t settings_hash = 0x123456789abcdef0;
+	const Vector3i position(1, -2, 3);
+
+	VoxelMesher::Output output;
+	{
+		PackedVector3Array vertices;
+		vertices.push_back(Vector3(0, 0, 0));
+		vertices.push_back(Vector3(1, 0, 0));
+		vertices.push_back(Vector3(0, 1, 0));
+		PackedInt32Array indices;
+		indices.push_back(0);
+		indices.push_back(1);
+		indices.push_back(2);
+		Array arrays;
+		arrays.resize(Mesh::ARRAY_MAX);
+		arrays[Mesh::ARRAY_VERTEX] = vertices;
+		arrays[Mesh::ARRAY_INDEX] = indices;
+		VoxelMesher::Output::Surface &surface = output.surfaces.emplace_back();
+		surface.arrays = arrays;
+		surface.material_index = 2;
+		output.collision_surface.positions.push_back(Vector3f(0, 0, 0));
+		output.collision_surface.positions.push_back(Vector3f(1, 0, 0));
+		output.collision_surface.positions.push_back(Vector3f(0, 1, 0));
+		output.collision_surface.indices.push_back(0);
+		output.collision_surface.indices.push_back(1);
+		output.collision_surface.indices.push_back(2);
+		output.occluder_boxes.push_back(Box3f{ Vector3f(1, 2, 3), Vector3f(4, 5, 6) });
+	}
+
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+		ZN_TEST_ASSERT(stream->supports_mesh_blocks());
+
+		VoxelStream::MeshesQueryData q{ StdVector<uint8_t>(), position, 0, VoxelStream::RESULT_ERROR };
+		ZN_TEST_ASSERT(serialize_mesh_block(output, settings_hash, true, q.data));
+		stream->save_mesh_blocks(Span<VoxelStream::MeshesQueryData>(&q, 1));
+	}
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+
+		VoxelStream::MeshesQueryData q{ StdVector<uint8_t>(), position, 0, VoxelStream::RESULT_ERROR };
+		q.position_in_blocks = position + Vector3i(1, 0, 0);
+		stream->load_mesh_blocks(Span<VoxelStream::MeshesQueryData>(&q, 1));
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+
+		q.position_in_blocks = position;
+		stream->load_mesh_blocks(Span<VoxelStream::MeshesQueryData>(&q, 1));
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+
+		// Meshes baked with other settings must not be used
+		VoxelMesher::Output loaded;
+		ZN_TEST_ASSERT(!deserialize_mesh_block(to_span_const(q.data), settings_hash + 1, false, loaded));
+
+		ZN_TEST_ASSERT(deserialize_mesh_block(to_span_const(q.data), settings_hash, true, loaded));
+		ZN_TEST_ASSERT(loaded.surfaces.size() == 1);
+		ZN_TEST_ASSERT(loaded.surfaces[0].material_index == 2);
+		const PackedVector3Array loaded_vertices = loaded.surfaces[0].arrays[Mesh::ARRAY_VERTEX];
+		ZN_TEST_ASSERT(loaded_vertices.size() == 3);
+		ZN_TEST_ASSERT(loaded_vertices[1] == Vector3(1, 0, 0));
+		ZN_TEST_ASSERT(loaded.collision_surface.positions.size() == 3);
+		ZN_TEST_ASSERT(loaded.collision_surface.indices.size() == 3);
+		ZN_TEST_ASSERT(loaded.occluder_boxes.size() == 1);
+		ZN_TEST_ASSERT(loaded.occluder_boxes[0].max == Vector3f(4, 5, 6));
+	}
+}
+
+void test_voxel_stream_sqlite_compressed_voxel_blocks() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const String database_path = test_dir.get_path().path_join("database.sqlite");
+
+	VoxelBuffer vb1(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb1.create(Vector3i(16, 16, 16));
+	vb1.fill_area(1, Vector3i(5, 5, 5), Vector3i(10, 11, 12), 0);
+
+	VoxelBuffer vb2(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb2.create(Vector3i(16, 16, 16));
+	vb2.fill_area(2, Vector3i(0, 0, 0), Vector3i(16, 4, 16), 0);
+
+	const Vector3i pos1(1, 2, 3);
+	const Vector3i pos2(-4, 0, 5);
+
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+		stream->set_compression_mode(VoxelStreamSQLite::COMPRESSION_ZSTD);
+		ZN_TEST_ASSERT(stream->supports_compressed_voxel_blocks());
+
+		// Goes to the cache first
+		{
+			VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+			vb1.copy_to(vb, true);
+			VoxelStream::VoxelQueryData q{ vb, pos1, 0, VoxelStream::RESULT_ERROR };
+			stream->save_voxel_block(q);
+		}
+		// Blocks still in the cache can be loaded compressed too
+		{
+			VoxelStream::CompressedVoxelQueryData q{ StdVector<uint8_t>(), pos1, 0, VoxelStream::RESULT_ERROR };
+			stream->load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData>(&q, 1));
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+			ZN_TEST_ASSERT(stream->decompress_voxel_block(to_span_const(q.data), loaded));
+			ZN_TEST_ASSERT(loaded.equals(vb1));
+		}
+		// Newer versions saved compressed must not be overwritten by the cached ones
+		{
+			StdVector<VoxelStream::CompressedVoxelQueryData> queries;
+			queries.push_back({ StdVector<uint8_t>(), pos1, 0, VoxelStream::RESULT_ERROR });
+			queries.push_back({ StdVector<uint8_t>(), pos2, 0, VoxelStream::RESULT_ERROR });
+			ZN_TEST_ASSERT(stream->compress_voxel_block(vb2, queries[0].data));
+			ZN_TEST_ASSERT(stream->compress_voxel_block(vb1, queries[1].data));
+			stream->save_compressed_voxel_blocks(to_span(queries));
+		}
+		stream->flush();
+	}
+	{
+		Ref<VoxelStreamSQLite> stream;
+		stream.instantiate();
+		stream->set_database_path(database_path);
+
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		VoxelStream::VoxelQueryData q{ loaded, pos1, 0, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(loaded.equals(vb2));
+
+		VoxelStream::CompressedVoxelQueryData cq{ StdVector<uint8_t>(), pos2, 0, VoxelStream::RESULT_ERROR };
+		stream->load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData>(&cq, 1));
+		ZN_TEST_ASSERT(cq.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(stream->decompress_voxel_block(to_span_const(cq.data), loaded));
+		ZN_TEST_ASSERT(loaded.equals(vb1));
+
+		cq.position_in_blocks = pos2 + Vector3i(1, 0, 0);
+		stream->load_compressed_voxel_blocks(Span<VoxelStream::CompressedVoxelQueryData>(&cq, 1));
+		ZN_TEST_ASSERT(cq.result == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+	}
+}
+
 } // namespace zylann::voxel::tests
@@ -7,6 +7,14 @@ void test_voxel_stream_sqlite_basic();
 void test_voxel_stream_sqlite_coordinate_format();
 void test_voxel_stream_sqlite_key_string_csd_encoding();
 void test_voxel_stream_sqlite_key_blob80_encoding();
+void test_voxel_stream_sqlite_wal_threaded();
+void test_voxel_stream_sqlite_block_key_index();
+void test_voxel_stream_sqlite_persistent_key_cache();
+void test_voxel_stream_sqlite_load_blocks_in_box();
+void test_voxel_stream_sqlite_load_all_blocks_deferred_decoding();
+void test_voxel_stream_sqlite_separate_instance_blocks();
+void test_voxel_stream_sqlite_mesh_blocks();
+void test_voxel_stream_sqlite_compressed_voxel_blocks();
 
 } // namespace zylann::voxel::tests
 
@@ -2,6 +2,7 @@
 #include "../../storage/metadata/voxel_metadata_factory.h"
 #include "../../storage/metadata/voxel_metadata_variant.h"
 #include "../../storage/voxel_buffer_gd.h"
+#include "../../storage/voxel_buffer_view.h"
 #include "../../streams/voxel_block_serializer.h"
 #include "../../util/string/std_stringstream.h"
 #include "../testing.h"
@@ -378,4 +379,545 @@ void test_voxel_buffer_paste_masked() {
 	ZN_TEST_ASSERT(dst.equals(expected));
 }
 
+namespace {
+
+// `VoxelBuffer::equals` compares storage, so it can't be used to compare a palette channel with a dense one
+bool has_same_voxels(const VoxelBuffer &a, const VoxelBuffer &b, unsigned int channel_index) {
+	if (a.get_size() != b.get_size()) {
+		return false;
+	}
+	Vector3i pos;
+	for (pos.z = 0; pos.z < a.get_size().z; ++pos.z) {
+		for (pos.x = 0; pos.x < a.get_size().x; ++pos.x) {
+			for (pos.y = 0; pos.y < a.get_size().y; ++pos.y) {
+				if (a.get_voxel(pos, channel_index) != b.get_voxel(pos, channel_index)) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+void test_voxel_buffer_palette_compression() {
+	const VoxelBuffer::ChannelId channel_index = VoxelBuffer::CHANNEL_TYPE;
+
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(16, 16, 16));
+	vb.fill_area(3, Vector3i(0, 0, 0), Vector3i(16, 8, 16), channel_index);
+	vb.set_voxel(5, 1, 2, 3, channel_index);
+
+	VoxelBuffer expected(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.copy_to(expected, false);
+
+	ZN_TEST_ASSERT(vb.compress_channel_to_palette(channel_index));
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_PALETTE);
+	ZN_TEST_ASSERT(vb.get_channel_palette_size(channel_index) == 3);
+	ZN_TEST_ASSERT(vb.get_channel_palette_index_bits(channel_index) == 2);
+	ZN_TEST_ASSERT(has_same_voxels(vb, expected, channel_index));
+
+	// Adding values should grow the palette without decompressing
+	for (int i = 0; i < 20; ++i) {
+		const Vector3i pos(i % 16, 10, i / 16);
+		vb.set_voxel(100 + i, pos, channel_index);
+		expected.set_voxel(100 + i, pos, channel_index);
+	}
+	vb.fill_area(7, Vector3i(2, 2, 2), Vector3i(5, 6, 7), channel_index);
+	expected.fill_area(7, Vector3i(2, 2, 2), Vector3i(5, 6, 7), channel_index);
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_PALETTE);
+	ZN_TEST_ASSERT(vb.get_channel_palette_index_bits(channel_index) == 8);
+	ZN_TEST_ASSERT(has_same_voxels(vb, expected, channel_index));
+
+	// Copying a region out of a palette channel gives dense voxels
+	{
+		VoxelBuffer dst(VoxelBuffer::ALLOCATOR_DEFAULT);
+		dst.create(Vector3i(18, 18, 18));
+		dst.copy_channel_from(vb, Vector3i(), vb.get_size(), Vector3i(1, 1, 1), channel_index);
+		ZN_TEST_ASSERT(dst.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_NONE);
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(2, 3, 4), channel_index) == 5);
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(1, 11, 1), channel_index) == 100);
+	}
+
+	// Serialization preserves palette data
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(vb);
+		ZN_TEST_ASSERT(result.success);
+		StdVector<uint8_t> data = result.data;
+
+		VoxelBuffer vb2(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(to_span(data), vb2));
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_PALETTE);
+		ZN_TEST_ASSERT(vb2.equals(vb));
+	}
+
+	// Exceeding the maximum palette size falls back to uncompressed
+	for (int i = 0; i < 300; ++i) {
+		const Vector3i pos(i % 16, 12, (i / 16) % 16);
+		vb.set_voxel(1000 + i, pos, channel_index);
+		expected.set_voxel(1000 + i, pos, channel_index);
+	}
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_NONE);
+	ZN_TEST_ASSERT(has_same_voxels(vb, expected, channel_index));
+}
+
+void test_voxel_buffer_brick_compression() {
+	const VoxelBuffer::ChannelId channel_index = VoxelBuffer::CHANNEL_SDF;
+
+	// A surface crossing only one corner of the buffer, so most bricks are uniform
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(18, 18, 18));
+	vb.set_channel_depth(channel_index, VoxelBuffer::DEPTH_16_BIT);
+	vb.fill_f(1.f, channel_index);
+	Vector3i pos;
+	for (pos.z = 0; pos.z < 6; ++pos.z) {
+		for (pos.x = 0; pos.x < 6; ++pos.x) {
+			for (pos.y = 0; pos.y < 6; ++pos.y) {
+				vb.set_voxel_f(math::length(Vector3f(pos.x, pos.y, pos.z)) - 4.f, pos, channel_index);
+			}
+		}
+	}
+
+	VoxelBuffer expected(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.copy_to(expected, false);
+
+	vb.compress_uniform_channels();
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_BRICKS);
+	ZN_TEST_ASSERT(vb.get_channel_brick_size_po2(channel_index) == VoxelBuffer::MIN_BRICK_SIZE_PO2);
+	ZN_TEST_ASSERT(vb.get_channel_brick_grid_size(channel_index) == Vector3i(5, 5, 5));
+	ZN_TEST_ASSERT(vb.get_channel_dense_brick_count(channel_index) == 8);
+	ZN_TEST_ASSERT(has_same_voxels(vb, expected, channel_index));
+	ZN_TEST_ASSERT(!vb.is_uniform(channel_index));
+	{
+		uint64_t value;
+		ZN_TEST_ASSERT(!vb.get_channel_brick_uniform_value(channel_index, Vector3i(0, 0, 0), value));
+		ZN_TEST_ASSERT(vb.get_channel_brick_uniform_value(channel_index, Vector3i(4, 4, 4), value));
+		ZN_TEST_ASSERT(value == expected.get_voxel(Vector3i(17, 17, 17), channel_index));
+	}
+	{
+		float expected_min, expected_max;
+		expected.get_range_f(expected_min, expected_max, channel_index);
+		float min_value, max_value;
+		vb.get_range_f(min_value, max_value, channel_index);
+		ZN_TEST_ASSERT(min_value == expected_min && max_value == expected_max);
+	}
+
+	// Modifying a uniform brick should only make that brick dense
+	vb.set_voxel(5, Vector3i(10, 11, 12), channel_index);
+	expected.set_voxel(5, Vector3i(10, 11, 12), channel_index);
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_BRICKS);
+	ZN_TEST_ASSERT(vb.get_channel_dense_brick_count(channel_index) == 9);
+	ZN_TEST_ASSERT(has_same_voxels(vb, expected, channel_index));
+
+	// Copying a region out of a brick channel gives dense voxels
+	{
+		VoxelBuffer dst(VoxelBuffer::ALLOCATOR_DEFAULT);
+		dst.create(Vector3i(8, 8, 8));
+		dst.set_channel_depth(channel_index, VoxelBuffer::DEPTH_16_BIT);
+		dst.copy_channel_from(vb, Vector3i(3, 3, 3), Vector3i(11, 11, 11), Vector3i(), channel_index);
+		ZN_TEST_ASSERT(dst.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_NONE);
+		for (pos.z = 0; pos.z < 8; ++pos.z) {
+			for (pos.x = 0; pos.x < 8; ++pos.x) {
+				for (pos.y = 0; pos.y < 8; ++pos.y) {
+					const Vector3i src_pos = pos + Vector3i(3, 3, 3);
+					ZN_TEST_ASSERT(dst.get_voxel(pos, channel_index) == expected.get_voxel(src_pos, channel_index));
+				}
+			}
+		}
+	}
+
+	// Serialization preserves brick data
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(vb);
+		ZN_TEST_ASSERT(result.success);
+		StdVector<uint8_t> data = result.data;
+
+		VoxelBuffer vb2(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::decompress_and_deserialize(to_span(data), vb2));
+		ZN_TEST_ASSERT(vb2.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_BRICKS);
+		ZN_TEST_ASSERT(vb2.equals(vb));
+	}
+
+	// Making too many bricks dense falls back to uncompressed
+	for (pos.z = 0; pos.z < 18; pos.z += 4) {
+		for (pos.x = 0; pos.x < 18; pos.x += 4) {
+			for (pos.y = 0; pos.y < 18; pos.y += 4) {
+				vb.set_voxel(7, pos + Vector3i(1, 1, 1), channel_index);
+				expected.set_voxel(7, pos + Vector3i(1, 1, 1), channel_index);
+			}
+		}
+	}
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_NONE);
+	ZN_TEST_ASSERT(has_same_voxels(vb, expected, channel_index));
+}
+
+void test_voxel_buffer_copy_on_write() {
+	const unsigned int channel_index = VoxelBuffer::CHANNEL_TYPE;
+	const Vector3i size(8, 9, 10);
+
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(size);
+	for (int i = 0; i < 20; ++i) {
+		vb.set_voxel(i + 1, Vector3i(i % size.x, i % size.y, i % size.z), channel_index);
+	}
+	vb.set_voxel(3, Vector3i(1, 2, 3), VoxelBuffer::CHANNEL_SDF);
+
+	struct L {
+		static const uint8_t *get_data(const VoxelBuffer &vb, unsigned int channel_index) {
+			Span<const uint8_t> data;
+			ZN_TEST_ASSERT(vb.get_channel_as_bytes_read_only(channel_index, data));
+			return data.data();
+		}
+	};
+
+	// Copies share data
+	VoxelBuffer copy1(VoxelBuffer::ALLOCATOR_POOL);
+	vb.copy_to(copy1, false);
+	VoxelBuffer copy2(VoxelBuffer::ALLOCATOR_DEFAULT);
+	copy1.copy_to(copy2, false);
+	ZN_TEST_ASSERT(L::get_data(copy1, channel_index) == L::get_data(vb, channel_index));
+	ZN_TEST_ASSERT(L::get_data(copy2, channel_index) == L::get_data(vb, channel_index));
+	ZN_TEST_ASSERT(copy2.equals(vb));
+
+	// Writing to a copy only duplicates the modified channel
+	copy1.set_voxel(42, Vector3i(4, 4, 4), channel_index);
+	ZN_TEST_ASSERT(L::get_data(copy1, channel_index) != L::get_data(vb, channel_index));
+	ZN_TEST_ASSERT(L::get_data(copy1, VoxelBuffer::CHANNEL_SDF) == L::get_data(vb, VoxelBuffer::CHANNEL_SDF));
+	ZN_TEST_ASSERT(copy1.get_voxel(Vector3i(4, 4, 4), channel_index) == 42);
+	ZN_TEST_ASSERT(vb.get_voxel(Vector3i(4, 4, 4), channel_index) != 42);
+	ZN_TEST_ASSERT(copy2.equals(vb));
+
+	// Writing to the original doesn't affect copies
+	vb.fill_area(7, Vector3i(0, 0, 0), Vector3i(2, 2, 2), channel_index);
+	ZN_TEST_ASSERT(vb.get_voxel(Vector3i(1, 1, 1), channel_index) == 7);
+	ZN_TEST_ASSERT(copy2.get_voxel(Vector3i(1, 1, 1), channel_index) == 1 + 1);
+	ZN_TEST_ASSERT(copy1.get_voxel(Vector3i(1, 1, 1), channel_index) == 1 + 1);
+
+	// Data remains valid after the buffer it was copied from is destroyed
+	{
+		VoxelBuffer temp(VoxelBuffer::ALLOCATOR_POOL);
+		temp.create(size);
+		temp.fill(5, VoxelBuffer::CHANNEL_COLOR);
+		temp.set_voxel(6, Vector3i(1, 1, 1), VoxelBuffer::CHANNEL_COLOR);
+		copy2.copy_channel_from(temp, VoxelBuffer::CHANNEL_COLOR);
+	}
+	ZN_TEST_ASSERT(copy2.get_voxel(Vector3i(1, 1, 1), VoxelBuffer::CHANNEL_COLOR) == 6);
+	ZN_TEST_ASSERT(copy2.get_voxel(Vector3i(2, 1, 1), VoxelBuffer::CHANNEL_COLOR) == 5);
+
+	// Compressed channels are shared too
+	ZN_TEST_ASSERT(vb.compress_channel_to_palette(channel_index));
+	VoxelBuffer copy3(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.copy_to(copy3, false);
+	ZN_TEST_ASSERT(copy3.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_PALETTE);
+	copy3.set_voxel(7, Vector3i(5, 5, 5), channel_index);
+	ZN_TEST_ASSERT(copy3.get_voxel(Vector3i(5, 5, 5), channel_index) == 7);
+	ZN_TEST_ASSERT(vb.get_voxel(Vector3i(5, 5, 5), channel_index) == 5 + 1);
+}
+
+void test_voxel_buffer_downscale() {
+	const Vector3i src_size(16, 16, 16);
+	const Vector3i dst_size(16, 16, 16);
+	const Vector3i dst_min(8, 0, 8);
+
+	VoxelBuffer src(VoxelBuffer::ALLOCATOR_DEFAULT);
+	src.create(src_size);
+	// Dense channel
+	src.set_channel_depth(VoxelBuffer::CHANNEL_SDF, VoxelBuffer::DEPTH_16_BIT);
+	// Palette channel
+	src.set_channel_depth(VoxelBuffer::CHANNEL_TYPE, VoxelBuffer::DEPTH_16_BIT);
+	// Uniform channel
+	src.fill(9, VoxelBuffer::CHANNEL_COLOR);
+	Vector3i pos;
+	for (pos.z = 0; pos.z < src_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < src_size.x; ++pos.x) {
+			for (pos.y = 0; pos.y < src_size.y; ++pos.y) {
+				src.set_voxel(pos.x + pos.y * 16 + pos.z * 256, pos, VoxelBuffer::CHANNEL_SDF);
+				src.set_voxel((pos.x + pos.y + pos.z) % 3, pos, VoxelBuffer::CHANNEL_TYPE);
+			}
+		}
+	}
+	ZN_TEST_ASSERT(src.compress_channel_to_palette(VoxelBuffer::CHANNEL_TYPE));
+
+	VoxelBuffer dst(VoxelBuffer::ALLOCATOR_DEFAULT);
+	dst.create(dst_size);
+	dst.set_channel_depth(VoxelBuffer::CHANNEL_SDF, VoxelBuffer::DEPTH_16_BIT);
+	dst.set_channel_depth(VoxelBuffer::CHANNEL_TYPE, VoxelBuffer::DEPTH_16_BIT);
+	dst.fill(1, VoxelBuffer::CHANNEL_SDF);
+
+	src.downscale_to(dst, Vector3i(), src_size, dst_min);
+
+	for (pos.z = 0; pos.z < dst_size.z; ++pos.z) {
+		for (pos.x = 0; pos.x < dst_size.x; ++pos.x) {
+			for (pos.y = 0; pos.y < dst_size.y; ++pos.y) {
+				const Vector3i rpos = pos - dst_min;
+				if (rpos.x < 0 || rpos.y < 0 || rpos.z < 0 || rpos.x >= 8 || rpos.y >= 8 || rpos.z >= 8) {
+					// Outside of the downscaled area, voxels must not have changed
+					ZN_TEST_ASSERT(dst.get_voxel(pos, VoxelBuffer::CHANNEL_SDF) == 1);
+					ZN_TEST_ASSERT(dst.get_voxel(pos, VoxelBuffer::CHANNEL_COLOR) == 0);
+					continue;
+				}
+				const Vector3i src_pos = rpos * 2;
+				for (unsigned int channel_index = 0; channel_index < VoxelBuffer::MAX_CHANNELS; ++channel_index) {
+					ZN_TEST_ASSERT(
+							dst.get_voxel(pos, channel_index) == src.get_voxel(src_pos, channel_index)
+					);
+				}
+			}
+		}
+	}
+}
+
+void test_voxel_buffer_downscale_majority() {
+	const Vector3i src_size(4, 4, 4);
+
+	VoxelBuffer src(VoxelBuffer::ALLOCATOR_DEFAULT);
+	src.create(src_size);
+	src.set_channel_depth(VoxelBuffer::CHANNEL_TYPE, VoxelBuffer::DEPTH_16_BIT);
+
+	// Cell at (0, 0, 0): mostly air, with a single solid voxel that must not be lost
+	src.set_voxel(3, Vector3i(1, 1, 1), VoxelBuffer::CHANNEL_TYPE);
+	// Cell at (1, 0, 0): two voxels of 4, three voxels of 5
+	src.set_voxel(4, Vector3i(2, 0, 0), VoxelBuffer::CHANNEL_TYPE);
+	src.set_voxel(4, Vector3i(2, 1, 0), VoxelBuffer::CHANNEL_TYPE);
+	src.set_voxel(5, Vector3i(3, 0, 0), VoxelBuffer::CHANNEL_TYPE);
+	src.set_voxel(5, Vector3i(3, 1, 0), VoxelBuffer::CHANNEL_TYPE);
+	src.set_voxel(5, Vector3i(3, 0, 1), VoxelBuffer::CHANNEL_TYPE);
+	// Cell at (0, 1, 0): one voxel of 6, replaced with 7 in lower LODs
+	src.set_voxel(6, Vector3i(0, 2, 0), VoxelBuffer::CHANNEL_TYPE);
+
+	FixedArray<uint16_t, 8> replacements;
+	for (unsigned int i = 0; i < replacements.size(); ++i) {
+		replacements[i] = i;
+	}
+	replacements[6] = 7;
+
+	// Raw and palette destinations must give the same results
+	for (unsigned int test_index = 0; test_index < 2; ++test_index) {
+		VoxelBuffer dst(VoxelBuffer::ALLOCATOR_DEFAULT);
+		dst.create(src_size);
+		dst.set_channel_depth(VoxelBuffer::CHANNEL_TYPE, VoxelBuffer::DEPTH_16_BIT);
+		dst.fill(1, VoxelBuffer::CHANNEL_TYPE);
+		if (test_index == 0) {
+			dst.decompress_channel(VoxelBuffer::CHANNEL_TYPE);
+		} else {
+			ZN_TEST_ASSERT(dst.compress_channel_to_palette(VoxelBuffer::CHANNEL_TYPE));
+		}
+
+		src.downscale_majority_to(
+				dst, Vector3i(), src_size, Vector3i(), VoxelBuffer::CHANNEL_TYPE, to_span(replacements)
+		);
+
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(0, 0, 0), VoxelBuffer::CHANNEL_TYPE) == 3);
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(1, 0, 0), VoxelBuffer::CHANNEL_TYPE) == 5);
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(0, 1, 0), VoxelBuffer::CHANNEL_TYPE) == 7);
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(1, 1, 1), VoxelBuffer::CHANNEL_TYPE) == 0);
+		// Outside of the downscaled area, voxels must not have changed
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(2, 0, 0), VoxelBuffer::CHANNEL_TYPE) == 1);
+		ZN_TEST_ASSERT(dst.get_voxel(Vector3i(3, 3, 3), VoxelBuffer::CHANNEL_TYPE) == 1);
+	}
+}
+
+void test_voxel_buffer_bulk_access_gd() {
+	const Vector3i size(8, 9, 10);
+
+	Ref<godot::VoxelBuffer> vb;
+	vb.instantiate();
+	vb->create(size.x, size.y, size.z);
+	vb->set_channel_depth(godot::VoxelBuffer::CHANNEL_TYPE, godot::VoxelBuffer::DEPTH_16_BIT);
+	vb->set_channel_depth(godot::VoxelBuffer::CHANNEL_SDF, godot::VoxelBuffer::DEPTH_16_BIT);
+
+	// Whole channel of raw values, read back from a palette-compressed channel
+	{
+		PackedByteArray data;
+		data.resize(Vector3iUtil::get_volume(size) * sizeof(uint16_t));
+		Span<uint16_t> values = Span<uint8_t>(data.ptrw(), data.size()).reinterpret_cast_to<uint16_t>();
+		for (unsigned int i = 0; i < values.size(); ++i) {
+			values[i] = i % 5;
+		}
+		vb->set_channel_from_byte_array(data, godot::VoxelBuffer::CHANNEL_TYPE);
+		const uint64_t expected = values[(3 * size.x + 1) * size.y + 2];
+		ZN_TEST_ASSERT(vb->get_voxel(1, 2, 3, godot::VoxelBuffer::CHANNEL_TYPE) == expected);
+
+		vb->compress_palette_channels();
+		ZN_TEST_ASSERT(
+				vb->get_channel_compression(godot::VoxelBuffer::CHANNEL_TYPE) == godot::VoxelBuffer::COMPRESSION_PALETTE
+		);
+		const PackedByteArray read_data = vb->get_channel_as_byte_array(godot::VoxelBuffer::CHANNEL_TYPE);
+		ZN_TEST_ASSERT(read_data == data);
+	}
+	// Box of float values. 16-bit SDF is quantized, so values are compared with a tolerance
+	{
+		const Vector3i min_pos(1, 2, 3);
+		const Vector3i max_pos(5, 6, 8);
+		const Vector3i area_size = max_pos - min_pos;
+
+		PackedFloat32Array values;
+		values.resize(Vector3iUtil::get_volume(area_size));
+		for (int i = 0; i < values.size(); ++i) {
+			values.set(i, -1.f + 0.01f * i);
+		}
+		vb->set_channel_area_from_float_array(values, min_pos, max_pos, godot::VoxelBuffer::CHANNEL_SDF);
+
+		const Vector3i rpos(2, 3, 4);
+		const float expected = values[(rpos.z * area_size.x + rpos.x) * area_size.y + rpos.y];
+		const Vector3i pos = min_pos + rpos;
+		ZN_TEST_ASSERT(Math::is_equal_approx(
+				vb->get_voxel_f(pos.x, pos.y, pos.z, godot::VoxelBuffer::CHANNEL_SDF), expected, 0.02f
+		));
+		// Outside of the box
+		ZN_TEST_ASSERT(vb->get_voxel_f(0, 0, 0, godot::VoxelBuffer::CHANNEL_SDF) > 0.f);
+
+		const PackedFloat32Array read_values =
+				vb->get_channel_area_as_float_array(min_pos, max_pos, godot::VoxelBuffer::CHANNEL_SDF);
+		ZN_TEST_ASSERT(read_values.size() == values.size());
+		for (int i = 0; i < values.size(); ++i) {
+			ZN_TEST_ASSERT(Math::is_equal_approx(read_values[i], values[i], 0.02f));
+		}
+	}
+}
+
+void test_voxel_buffer_sdf_quantization_factor() {
+	const Vector3i size(8, 8, 8);
+	const unsigned int channel = VoxelBuffer::CHANNEL_SDF;
+
+	// With a factor of 1, 8-bit SDF saturates at 10
+	VoxelBuffer wide(VoxelBuffer::ALLOCATOR_DEFAULT);
+	wide.create(size);
+	wide.set_channel_depth(channel, VoxelBuffer::DEPTH_8_BIT);
+	wide.set_sdf_quantization_factor(VoxelBuffer::get_sdf_quantization_factor_for_lod(2));
+	wide.set_voxel_f(30.f, 1, 2, 3, channel);
+	wide.set_voxel_f(-5.f, 4, 4, 4, channel);
+	// Values are truncated to steps of 1 / (127 * 0.1 * 0.25)
+	const float wide_tolerance = 0.35f;
+	ZN_TEST_ASSERT(Math::is_equal_approx(wide.get_voxel_f(1, 2, 3, channel), 30.f, wide_tolerance));
+	ZN_TEST_ASSERT(Math::is_equal_approx(wide.get_voxel_f(4, 4, 4, channel), -5.f, wide_tolerance));
+	{
+		float min_value;
+		float max_value;
+		wide.get_range_f(min_value, max_value, VoxelBuffer::CHANNEL_SDF);
+		ZN_TEST_ASSERT(Math::is_equal_approx(min_value, -5.f, wide_tolerance));
+		ZN_TEST_ASSERT(max_value >= 30.f - wide_tolerance);
+	}
+
+	// Copying an area into a buffer with another factor keeps distances
+	{
+		VoxelBuffer narrow(VoxelBuffer::ALLOCATOR_DEFAULT);
+		narrow.create(size);
+		narrow.set_channel_depth(channel, VoxelBuffer::DEPTH_8_BIT);
+		narrow.copy_channel_from(wide, Vector3i(), size, Vector3i(), channel);
+		ZN_TEST_ASSERT(narrow.get_sdf_quantization_factor() == 1.f);
+		// Steps are 4 times larger in the destination
+		ZN_TEST_ASSERT(Math::is_equal_approx(narrow.get_voxel_f(4, 4, 4, channel), -5.f, 0.8f));
+		// Out of range of the destination
+		ZN_TEST_ASSERT(Math::is_equal_approx(narrow.get_voxel_f(1, 2, 3, channel), 10.f, 0.1f));
+	}
+
+	// Copying a whole channel shares raw values, so the factor goes with them
+	{
+		VoxelBuffer copy(VoxelBuffer::ALLOCATOR_DEFAULT);
+		wide.copy_to(copy, false);
+		ZN_TEST_ASSERT(copy.get_sdf_quantization_factor() == wide.get_sdf_quantization_factor());
+		ZN_TEST_ASSERT(copy.equals(wide));
+	}
+
+	// Downscaling into the next LOD converts distances
+	{
+		VoxelBuffer lod0(VoxelBuffer::ALLOCATOR_DEFAULT);
+		lod0.create(size);
+		lod0.set_channel_depth(channel, VoxelBuffer::DEPTH_16_BIT);
+		lod0.fill_f(3.f, channel);
+		lod0.set_voxel_f(-2.f, 2, 2, 2, channel);
+
+		VoxelBuffer lod1(VoxelBuffer::ALLOCATOR_DEFAULT);
+		lod1.create(size);
+		lod1.set_channel_depth(channel, VoxelBuffer::DEPTH_16_BIT);
+		lod1.set_sdf_quantization_factor(VoxelBuffer::get_sdf_quantization_factor_for_lod(1));
+		lod0.downscale_to(lod1, Vector3i(), size, Vector3i(), 1 << channel);
+		const float lod1_tolerance = 0.05f;
+		ZN_TEST_ASSERT(Math::is_equal_approx(lod1.get_voxel_f(1, 1, 1, channel), -2.f, lod1_tolerance));
+		ZN_TEST_ASSERT(Math::is_equal_approx(lod1.get_voxel_f(0, 0, 0, channel), 3.f, lod1_tolerance));
+	}
+
+	// The factor is saved with the block
+	{
+		BlockSerializer::SerializeResult result = BlockSerializer::serialize(wide);
+		ZN_TEST_ASSERT(result.success);
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(BlockSerializer::deserialize(to_span_const(result.data), loaded));
+		ZN_TEST_ASSERT(loaded.get_sdf_quantization_factor() == wide.get_sdf_quantization_factor());
+		ZN_TEST_ASSERT(loaded.equals(wide));
+	}
+}
+
+void test_voxel_buffer_views() {
+	const VoxelBuffer::ChannelId channel_index = VoxelBuffer::CHANNEL_TYPE;
+
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(Vector3i(8, 9, 10));
+	vb.set_channel_depth(channel_index, VoxelBuffer::DEPTH_16_BIT);
+
+	struct L {
+		static bool view_matches(const VoxelBuffer &vb, unsigned int channel_index) {
+			VoxelBufferReadView<uint16_t> view;
+			ZN_TEST_ASSERT(view.init(vb, channel_index));
+			ZN_TEST_ASSERT(view.get_size() == vb.get_size());
+			bool matches = true;
+			Box3i(Vector3i(), vb.get_size()).for_each_cell_zxy([&](Vector3i pos) {
+				matches &= view.get(pos) == vb.get_voxel(pos, channel_index);
+			});
+			return matches;
+		}
+	};
+
+	// Uniform
+	vb.fill(42, channel_index);
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_UNIFORM);
+	{
+		VoxelBufferReadView<uint16_t> view;
+		ZN_TEST_ASSERT(view.init(vb, channel_index));
+		ZN_TEST_ASSERT(view.is_uniform());
+		ZN_TEST_ASSERT(view.get(view.get_volume() - 1) == 42);
+	}
+
+	// Dense
+	vb.fill_area(3, Vector3i(1, 2, 3), Vector3i(4, 5, 6), channel_index);
+	vb.set_voxel(1000, Vector3i(7, 8, 9), channel_index);
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_NONE);
+	ZN_TEST_ASSERT(L::view_matches(vb, channel_index));
+
+	// Neighbors are reached with offsets
+	{
+		VoxelBufferReadView<uint16_t> view;
+		ZN_TEST_ASSERT(view.init(vb, channel_index));
+		const unsigned int i = view.get_index(Vector3i(6, 7, 8));
+		ZN_TEST_ASSERT(view.get(i + view.get_offset(Vector3i(1, 1, 1))) == 1000);
+		ZN_TEST_ASSERT(view.get_offset(Vector3i(0, 1, 0)) == static_cast<int>(VoxelBufferReadView<uint16_t>::Y_STRIDE));
+	}
+
+	// Palette
+	ZN_TEST_ASSERT(vb.compress_channel_to_palette(channel_index));
+	ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_PALETTE);
+	ZN_TEST_ASSERT(L::view_matches(vb, channel_index));
+
+	// Writing decompresses the channel
+	{
+		VoxelBufferWriteView<uint16_t> view;
+		ZN_TEST_ASSERT(view.init(vb, channel_index));
+		ZN_TEST_ASSERT(vb.get_channel_compression(channel_index) == VoxelBuffer::COMPRESSION_NONE);
+		view.set(Vector3i(0, 1, 2), 7);
+	}
+	ZN_TEST_ASSERT(vb.get_voxel(Vector3i(0, 1, 2), channel_index) == 7);
+	ZN_TEST_ASSERT(L::view_matches(vb, channel_index));
+
+	// Views can be picked from the depth at runtime
+	{
+		unsigned int byte_count = 0;
+		dispatch_depth(vb.get_channel_depth(channel_index), [&byte_count](auto zero) {
+			byte_count = sizeof(zero);
+		});
+		ZN_TEST_ASSERT(byte_count == 2);
+	}
+}
+
 } // namespace zylann::voxel::tests
@@ -7,6 +7,14 @@ void test_voxel_buffer_create();
 void test_voxel_buffer_metadata();
 void test_voxel_buffer_metadata_gd();
 void test_voxel_buffer_paste_masked();
+void test_voxel_buffer_palette_compression();
+void test_voxel_buffer_brick_compression();
+void test_voxel_buffer_copy_on_write();
+void test_voxel_buffer_downscale();
+void test_voxel_buffer_downscale_majority();
+void test_voxel_buffer_bulk_access_gd();
+void test_voxel_buffer_sdf_quantization_factor();
+void test_voxel_buffer_views();
 
 } // namespace zylann::voxel::tests
 
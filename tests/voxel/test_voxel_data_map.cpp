@@ -1,5 +1,6 @@
 #include "test_voxel_data_map.h"
 #include "../../storage/voxel_buffer.h"
+#include "../../storage/voxel_data.h"
 #include "../../storage/voxel_data_map.h"
 #include "../testing.h"
 
@@ -162,4 +163,367 @@ void test_voxel_data_map_copy() {
 	ZN_TEST_ASSERT(buffer.equals(buffer2));
 }
 
+void test_voxel_data_get_blocks_with_voxel_data_batched() {
+	VoxelData voxel_data;
+	voxel_data.set_streaming_enabled(true);
+
+	// Blocks with voxels on even X coordinates, and loaded blocks without voxels on odd ones
+	const Box3i loaded_blocks_box(Vector3i(-3, -3, -3), Vector3i(6, 6, 6));
+	loaded_blocks_box.for_each_cell([&voxel_data](Vector3i bpos) {
+		VoxelDataBlock block;
+		if ((bpos.x & 1) == 0) {
+			std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+			voxels->create(Vector3iUtil::create(voxel_data.get_block_size()));
+			block = VoxelDataBlock(voxels, 0);
+		}
+		const bool inserted = voxel_data.try_set_block(bpos, block);
+		ZN_TEST_ASSERT(inserted);
+	});
+
+	// Overlapping areas, some reaching outside of loaded blocks
+	FixedArray<Box3i, 3> boxes;
+	boxes[0] = Box3i(Vector3i(-1, -1, -1), Vector3i(3, 3, 3));
+	boxes[1] = Box3i(Vector3i(0, -1, -1), Vector3i(3, 3, 3));
+	boxes[2] = Box3i(Vector3i(1, 1, 1), Vector3i(4, 4, 4));
+
+	unsigned int total_volume = 0;
+	for (const Box3i &box : boxes) {
+		total_volume += Vector3iUtil::get_volume(box.size);
+	}
+
+	StdVector<std::shared_ptr<VoxelBuffer>> batched_blocks;
+	batched_blocks.resize(total_volume);
+	voxel_data.get_blocks_with_voxel_data(to_span(boxes), 0, to_span(batched_blocks));
+
+	unsigned int index = 0;
+	for (const Box3i &box : boxes) {
+		const unsigned int volume = Vector3iUtil::get_volume(box.size);
+		StdVector<std::shared_ptr<VoxelBuffer>> blocks;
+		blocks.resize(volume);
+		voxel_data.get_blocks_with_voxel_data(box, 0, to_span(blocks));
+
+		unsigned int box_index = 0;
+		box.for_each_cell_zxy([&](Vector3i bpos) {
+			const std::shared_ptr<VoxelBuffer> &block = blocks[box_index];
+			ZN_TEST_ASSERT(batched_blocks[index + box_index] == block);
+			const bool expect_voxels = loaded_blocks_box.contains(bpos) && (bpos.x & 1) == 0;
+			ZN_TEST_ASSERT((block != nullptr) == expect_voxels);
+			++box_index;
+		});
+
+		index += volume;
+	}
+}
+
+void test_voxel_data_compress_cold_blocks() {
+	VoxelData voxel_data;
+	voxel_data.set_streaming_enabled(true);
+
+	const int block_size = voxel_data.get_block_size();
+	const unsigned int channel = VoxelBuffer::CHANNEL_TYPE;
+
+	auto get_expected_value = [](Vector3i pos) { //
+		return static_cast<uint64_t>((pos.x + 3 * pos.y + 7 * pos.z) % 5);
+	};
+
+	FixedArray<Vector3i, 2> block_positions;
+	block_positions[0] = Vector3i(0, 0, 0);
+	block_positions[1] = Vector3i(1, 0, 0);
+
+	for (unsigned int i = 0; i < block_positions.size(); ++i) {
+		const Vector3i bpos = block_positions[i];
+		std::shared_ptr<VoxelBuffer> voxels = make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+		voxels->create(Vector3iUtil::create(block_size));
+		const Vector3i origin = bpos * block_size;
+		Box3i(Vector3i(), voxels->get_size()).for_each_cell([&voxels, &get_expected_value, origin](Vector3i rpos) {
+			voxels->set_voxel(get_expected_value(origin + rpos), rpos, channel);
+		});
+		VoxelDataBlock block(voxels, 0);
+		const bool inserted = voxel_data.try_set_block(bpos, block);
+		ZN_TEST_ASSERT(inserted);
+		voxel_data.set_blocks_access_time(Box3i(bpos, Vector3i(1, 1, 1)), i == 0 ? 1 : 10);
+	}
+
+	const uint64_t resident_bytes = voxel_data.get_resident_voxel_bytes(0);
+
+	// Only the first block was accessed before the threshold
+	StdVector<Vector3i> cold_blocks;
+	voxel_data.find_cold_blocks(5, 20, cold_blocks);
+	ZN_TEST_ASSERT(cold_blocks.size() == 1);
+	ZN_TEST_ASSERT(cold_blocks[0] == block_positions[0]);
+
+	const uint64_t saved_bytes = voxel_data.compress_block_voxels(to_span_const(cold_blocks));
+	ZN_TEST_ASSERT(saved_bytes > 0);
+	ZN_TEST_ASSERT(voxel_data.get_resident_voxel_bytes(0) == resident_bytes - saved_bytes);
+
+	auto is_block_compressed = [&voxel_data](Vector3i bpos) {
+		bool compressed = false;
+		voxel_data.for_each_block_at_lod_r(
+				[&compressed, bpos](Vector3i block_pos, const VoxelDataBlock &block) {
+					if (block_pos == bpos) {
+						compressed = block.is_voxels_compressed();
+					}
+				},
+				0
+		);
+		return compressed;
+	};
+
+	ZN_TEST_ASSERT(is_block_compressed(block_positions[0]));
+	ZN_TEST_ASSERT(!is_block_compressed(block_positions[1]));
+
+	// Reading voxels decompresses the block transparently
+	VoxelSingleValue defval;
+	defval.i = 0;
+	const Vector3i pos(3, 4, 5);
+	const VoxelSingleValue value = voxel_data.get_voxel(pos, channel, defval);
+	ZN_TEST_ASSERT(value.i == get_expected_value(pos));
+	ZN_TEST_ASSERT(!is_block_compressed(block_positions[0]));
+	ZN_TEST_ASSERT(voxel_data.get_resident_voxel_bytes(0) == resident_bytes);
+
+	// The decompressed block counts as accessed, so it is not cold anymore
+	cold_blocks.clear();
+	voxel_data.find_cold_blocks(5, 20, cold_blocks);
+	ZN_TEST_ASSERT(cold_blocks.size() == 0);
+
+	cold_blocks.clear();
+	voxel_data.find_cold_blocks(25, 30, cold_blocks);
+	ZN_TEST_ASSERT(cold_blocks.size() == 2);
+}
+
+void test_voxel_data_partial_lod_update() {
+	// Downscaling only the edited area of blocks must give the same LOD as downscaling whole blocks
+
+	const unsigned int channel = VoxelBuffer::CHANNEL_TYPE;
+
+	struct L {
+		static void init(VoxelData &vd) {
+			vd.set_lod_count(2);
+			vd.set_streaming_enabled(true);
+
+			const int block_size = vd.get_block_size();
+
+			// 2x2x2 blocks at LOD0, covered by one block at LOD1
+			Box3i(Vector3i(), Vector3i(2, 2, 2)).for_each_cell([&vd, block_size](Vector3i bpos) {
+				std::shared_ptr<VoxelBuffer> voxels =
+						make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+				voxels->create(Vector3iUtil::create(block_size));
+				const Vector3i origin = bpos * block_size;
+				Box3i(Vector3i(), voxels->get_size()).for_each_cell([&voxels, origin](Vector3i rpos) {
+					const Vector3i pos = origin + rpos;
+					voxels->set_voxel((pos.x + 3 * pos.y + 7 * pos.z) % 5, rpos, channel);
+				});
+				ZN_TEST_ASSERT(vd.try_set_block(bpos, VoxelDataBlock(voxels, 0)));
+			});
+			{
+				std::shared_ptr<VoxelBuffer> voxels =
+						make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+				voxels->create(Vector3iUtil::create(block_size));
+				ZN_TEST_ASSERT(vd.try_set_block(Vector3i(), VoxelDataBlock(voxels, 1)));
+			}
+
+			// Initial update of the whole LOD
+			update(vd, get_area(vd));
+		}
+
+		static Box3i get_area(const VoxelData &vd) {
+			return Box3i(Vector3i(), Vector3iUtil::create(2 * vd.get_block_size()));
+		}
+
+		static void edit(VoxelData &vd, Box3i box) {
+			box.for_each_cell([&vd](Vector3i pos) { //
+				ZN_TEST_ASSERT(vd.try_set_voxel(20 + (5 * pos.x + 3 * pos.y + pos.z) % 13, pos, channel));
+			});
+		}
+
+		static void update(VoxelData &vd, Box3i modified_box) {
+			StdVector<Vector3i> blocks;
+			vd.mark_area_modified(modified_box, &blocks, true);
+			vd.update_lods(to_span(blocks), nullptr);
+		}
+
+		static void get_lod1_values(const VoxelData &vd, StdVector<uint64_t> &values) {
+			values.clear();
+			VoxelSingleValue defval;
+			defval.i = 0;
+			const Box3i lod1_box(Vector3i(), Vector3iUtil::create(vd.get_block_size()));
+			lod1_box.for_each_cell([&vd, &values, defval](Vector3i pos) {
+				values.push_back(vd.get_voxel_at_lod(pos << 1, 1, channel, defval).i);
+			});
+		}
+	};
+
+	VoxelData partial_data;
+	VoxelData full_data;
+	L::init(partial_data);
+	L::init(full_data);
+
+	const int bs = partial_data.get_block_size();
+
+	FixedArray<Box3i, 3> edited_boxes;
+	// Inside a block, at odd coordinates
+	edited_boxes[0] = Box3i(Vector3i(5, 6, 7), Vector3i(3, 2, 5));
+	// Touching the edge of blocks and crossing into their neighbors
+	edited_boxes[1] = Box3i(Vector3i(bs - 3, 0, bs - 1), Vector3i(6, 3, 1));
+	// Touching the far edge of the area
+	edited_boxes[2] = Box3i(Vector3i(2 * bs - 1, 2 * bs - 2, 3), Vector3i(1, 2, 4));
+
+	StdVector<uint64_t> values_before;
+	StdVector<uint64_t> partial_values;
+	StdVector<uint64_t> full_values;
+
+	for (const Box3i &box : edited_boxes) {
+		L::get_lod1_values(full_data, values_before);
+
+		L::edit(partial_data, box);
+		L::update(partial_data, box);
+
+		L::edit(full_data, box);
+		// Pretend the whole area changed, so whole blocks get downscaled
+		L::update(full_data, L::get_area(full_data));
+
+		L::get_lod1_values(partial_data, partial_values);
+		L::get_lod1_values(full_data, full_values);
+
+		ZN_TEST_ASSERT(full_values != values_before);
+		ZN_TEST_ASSERT(partial_values == full_values);
+	}
+}
+
+
+void test_voxel_data_deferred_lod_update() {
+	// When streaming is disabled, LODs are only updated when meshes need them. By then, they must be the same as if
+	// they were updated right after every edit.
+
+	const unsigned int channel = VoxelBuffer::CHANNEL_TYPE;
+	const unsigned int lod_count = 3;
+
+	struct L {
+		static void init(VoxelData &vd) {
+			vd.set_lod_count(lod_count);
+			// Blocks are updated eagerly while creating the initial LODs
+			vd.set_streaming_enabled(true);
+
+			const int block_size = vd.get_block_size();
+
+			// 4x4x4 blocks at LOD0, 2x2x2 at LOD1, covered by one block at LOD2
+			for (unsigned int lod_index = 0; lod_index < lod_count; ++lod_index) {
+				const int blocks_across = 4 >> lod_index;
+				Box3i(Vector3i(), Vector3iUtil::create(blocks_across))
+						.for_each_cell([&vd, block_size, lod_index](Vector3i bpos) {
+							std::shared_ptr<VoxelBuffer> voxels =
+									make_shared_instance<VoxelBuffer>(VoxelBuffer::ALLOCATOR_DEFAULT);
+							voxels->create(Vector3iUtil::create(block_size));
+							if (lod_index == 0) {
+								const Vector3i origin = bpos * block_size;
+								Box3i(Vector3i(), voxels->get_size()).for_each_cell([&voxels, origin](Vector3i rpos) {
+									const Vector3i pos = origin + rpos;
+									voxels->set_voxel((pos.x + 3 * pos.y + 7 * pos.z) % 5, rpos, channel);
+								});
+							}
+							ZN_TEST_ASSERT(vd.try_set_block(bpos, VoxelDataBlock(voxels, lod_index)));
+						});
+			}
+
+			update(vd, Box3i(Vector3i(), Vector3iUtil::create(4 * block_size)));
+		}
+
+		static void edit(VoxelData &vd, Box3i box, int seed) {
+			box.for_each_cell([&vd, seed](Vector3i pos) { //
+				ZN_TEST_ASSERT(vd.try_set_voxel(20 + (5 * pos.x + 3 * pos.y + pos.z + seed) % 13, pos, channel));
+			});
+		}
+
+		static void update(VoxelData &vd, Box3i modified_box) {
+			StdVector<Vector3i> blocks;
+			vd.mark_area_modified(modified_box, &blocks, true);
+			vd.update_lods(to_span(blocks), nullptr);
+		}
+
+		static void edit_and_update(VoxelData &eager_data, VoxelData &deferred_data, Box3i box, int seed) {
+			edit(eager_data, box, seed);
+			update(eager_data, box);
+			edit(deferred_data, box, seed);
+			update(deferred_data, box);
+		}
+
+		// Does what the terrain does before building meshes of the given LOD, in the given area in blocks
+		static void request_meshes(VoxelData &vd, Box3i blocks_box, unsigned int lod_index) {
+			vd.update_deferred_lods(Span<const Box3i>(&blocks_box, 1), lod_index, nullptr);
+		}
+
+		static void get_values(
+				const VoxelData &vd,
+				Box3i blocks_box,
+				unsigned int lod_index,
+				StdVector<uint64_t> &values
+		) {
+			values.clear();
+			VoxelSingleValue defval;
+			defval.i = 0;
+			const Box3i box(blocks_box.position * vd.get_block_size(), blocks_box.size * vd.get_block_size());
+			box.for_each_cell([&vd, &values, defval, lod_index](Vector3i pos) {
+				values.push_back(vd.get_voxel_at_lod(pos << lod_index, lod_index, channel, defval).i);
+			});
+		}
+
+		static bool are_lods_equal(
+				const VoxelData &vd1,
+				const VoxelData &vd2,
+				Box3i blocks_box,
+				unsigned int lod_index
+		) {
+			StdVector<uint64_t> values1;
+			StdVector<uint64_t> values2;
+			get_values(vd1, blocks_box, lod_index, values1);
+			get_values(vd2, blocks_box, lod_index, values2);
+			return values1 == values2;
+		}
+	};
+
+	VoxelData eager_data;
+	VoxelData deferred_data;
+	L::init(eager_data);
+	L::init(deferred_data);
+	deferred_data.set_streaming_enabled(false);
+
+	const int bs = deferred_data.get_block_size();
+	const Box3i all_lod1_blocks(Vector3i(), Vector3i(2, 2, 2));
+	const Box3i all_lod2_blocks(Vector3i(), Vector3i(1, 1, 1));
+
+	// Two edits in the same block, before LODs get updated
+	L::edit_and_update(eager_data, deferred_data, Box3i(Vector3i(2, 3, 4), Vector3i(3, 3, 3)), 0);
+	L::edit_and_update(eager_data, deferred_data, Box3i(Vector3i(bs - 5, bs - 4, bs - 3), Vector3i(3, 2, 3)), 1);
+	ZN_TEST_ASSERT(deferred_data.has_deferred_lod_updates());
+	ZN_TEST_ASSERT(!L::are_lods_equal(eager_data, deferred_data, all_lod1_blocks, 1));
+
+	// Only the meshes of one LOD1 block are needed
+	const Box3i first_lod1_block(Vector3i(), Vector3i(1, 1, 1));
+	L::request_meshes(deferred_data, first_lod1_block, 1);
+	ZN_TEST_ASSERT(L::are_lods_equal(eager_data, deferred_data, first_lod1_block, 1));
+	// LOD2 was not needed yet
+	ZN_TEST_ASSERT(deferred_data.has_deferred_lod_updates());
+
+	// More edits before the next meshes are needed: one crossing block edges, and one under the LOD1 block that was
+	// just updated, whose own area still waiting for LOD2 must not be lost
+	L::edit_and_update(eager_data, deferred_data, Box3i(Vector3i(2 * bs - 3, bs - 1, 5), Vector3i(6, 2, 4)), 2);
+	L::edit_and_update(eager_data, deferred_data, Box3i(Vector3i(7, 1, 9), Vector3i(2, 5, 2)), 3);
+
+	L::request_meshes(deferred_data, all_lod1_blocks, 1);
+	ZN_TEST_ASSERT(L::are_lods_equal(eager_data, deferred_data, all_lod1_blocks, 1));
+
+	L::request_meshes(deferred_data, all_lod2_blocks, 2);
+	ZN_TEST_ASSERT(L::are_lods_equal(eager_data, deferred_data, all_lod2_blocks, 2));
+	ZN_TEST_ASSERT(!deferred_data.has_deferred_lod_updates());
+
+	// Flushing everything at once gives the same result
+	const Vector3i corner(3 * bs, 2 * bs, 3 * bs);
+	L::edit_and_update(eager_data, deferred_data, Box3i(corner + Vector3i(-1, 0, 2), Vector3i(2, 2, 2)), 4);
+	L::edit_and_update(eager_data, deferred_data, Box3i(corner + Vector3i(-2, 0, 2), Vector3i(1, 3, 1)), 5);
+	deferred_data.update_all_deferred_lods();
+	ZN_TEST_ASSERT(!deferred_data.has_deferred_lod_updates());
+	ZN_TEST_ASSERT(L::are_lods_equal(eager_data, deferred_data, all_lod1_blocks, 1));
+	ZN_TEST_ASSERT(L::are_lods_equal(eager_data, deferred_data, all_lod2_blocks, 2));
+}
+
 } // namespace zylann::voxel::tests
@@ -6,6 +6,10 @@ namespace zylann::voxel::tests {
 void test_voxel_data_map_paste_fill();
 void test_voxel_data_map_paste_mask();
 void test_voxel_data_map_copy();
+void test_voxel_data_get_blocks_with_voxel_data_batched();
+void test_voxel_data_compress_cold_blocks();
+void test_voxel_data_partial_lod_update();
+void test_voxel_data_deferred_lod_update();
 
 } // namespace zylann::voxel::tests
 
@@ -1,7 +1,9 @@
 #include "test_voxel_graph.h"
 #include "../../generators/graph/image_range_grid.h"
+#include "../../generators/graph/voxel_graph_compiler.h"
 #include "../../generators/graph/node_type_db.h"
 #include "../../generators/graph/range_utility.h"
+#include "../../generators/graph/simd/graph_kernels.h"
 #include "../../generators/graph/voxel_generator_graph.h"
 #include "../../storage/materials_4i4w.h"
 #include "../../storage/voxel_buffer.h"
@@ -13,6 +15,7 @@
 #include "../../util/math/conv.h"
 #include "../../util/math/sdf.h"
 #include "../../util/noise/fast_noise_lite/fast_noise_lite.h"
+#include "../../util/noise/spot_noise.h"
 #include "../../util/string/format.h"
 #include "../../util/string/std_string.h"
 #include "../testing.h"
@@ -649,6 +652,124 @@ void test_voxel_graph_equivalence_merging() {
 	}
 }
 
+void test_voxel_graph_optimizations_preserve_results() {
+	// Graphs are rewritten when expanded (constant folding, removal of unused nodes, merging of equivalent nodes and
+	// simplifications). Results must be the same as when they are compiled without these rewrites.
+	struct L {
+		// Constant branches, and a branch that doesn't reach the output
+		//
+		//    2                                      X --- + --- Out
+		//     \                                          /
+		//      * --- Sin --- + --- Out       =>     Const
+		//     /             /
+		//    3             X       Y --- * --- (unused)
+		//                                 \
+		//                                  4
+		static void load_constants(VoxelGraphFunction &g) {
+			const uint32_t n_x = g.create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+			const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+			const uint32_t n_mul1 = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			const uint32_t n_sin = g.create_node(VoxelGraphFunction::NODE_SIN, Vector2());
+			const uint32_t n_add = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+			const uint32_t n_mul2 = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+			g.set_node_default_input(n_mul1, 0, 2.0);
+			g.set_node_default_input(n_mul1, 1, 3.0);
+			g.set_node_default_input(n_mul2, 1, 4.0);
+			g.add_connection(n_mul1, 0, n_sin, 0);
+			g.add_connection(n_sin, 0, n_add, 0);
+			g.add_connection(n_x, 0, n_add, 1);
+			g.add_connection(n_add, 0, n_out, 0);
+			g.add_connection(n_y, 0, n_mul2, 0);
+		}
+
+		// Commutative operations with inputs connected in swapped order, which get merged.
+		// Subtract is not commutative, so its branches must not be merged.
+		//
+		//    Out = (X + Y) * (Y + X) + max(X * Z, Z * X) + (X - Z) * (Z - X)
+		static void load_swapped_inputs(VoxelGraphFunction &g) {
+			const uint32_t n_x = g.create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+			const uint32_t n_y = g.create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+			const uint32_t n_z = g.create_node(VoxelGraphFunction::NODE_INPUT_Z, Vector2());
+
+			const uint32_t n_add_xy = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+			const uint32_t n_add_yx = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+			const uint32_t n_mul_sums = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			g.add_connection(n_x, 0, n_add_xy, 0);
+			g.add_connection(n_y, 0, n_add_xy, 1);
+			g.add_connection(n_y, 0, n_add_yx, 0);
+			g.add_connection(n_x, 0, n_add_yx, 1);
+			g.add_connection(n_add_xy, 0, n_mul_sums, 0);
+			g.add_connection(n_add_yx, 0, n_mul_sums, 1);
+
+			const uint32_t n_mul_xz = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			const uint32_t n_mul_zx = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			const uint32_t n_max = g.create_node(VoxelGraphFunction::NODE_MAX, Vector2());
+			g.add_connection(n_x, 0, n_mul_xz, 0);
+			g.add_connection(n_z, 0, n_mul_xz, 1);
+			g.add_connection(n_z, 0, n_mul_zx, 0);
+			g.add_connection(n_x, 0, n_mul_zx, 1);
+			g.add_connection(n_mul_xz, 0, n_max, 0);
+			g.add_connection(n_mul_zx, 0, n_max, 1);
+
+			const uint32_t n_sub_xz = g.create_node(VoxelGraphFunction::NODE_SUBTRACT, Vector2());
+			const uint32_t n_sub_zx = g.create_node(VoxelGraphFunction::NODE_SUBTRACT, Vector2());
+			const uint32_t n_mul_diffs = g.create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			g.add_connection(n_x, 0, n_sub_xz, 0);
+			g.add_connection(n_z, 0, n_sub_xz, 1);
+			g.add_connection(n_z, 0, n_sub_zx, 0);
+			g.add_connection(n_x, 0, n_sub_zx, 1);
+			g.add_connection(n_sub_xz, 0, n_mul_diffs, 0);
+			g.add_connection(n_sub_zx, 0, n_mul_diffs, 1);
+
+			const uint32_t n_add1 = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+			const uint32_t n_add2 = g.create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+			const uint32_t n_out = g.create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+			g.add_connection(n_mul_sums, 0, n_add1, 0);
+			g.add_connection(n_max, 0, n_add1, 1);
+			g.add_connection(n_add1, 0, n_add2, 0);
+			g.add_connection(n_mul_diffs, 0, n_add2, 1);
+			g.add_connection(n_add2, 0, n_out, 0);
+		}
+
+		static Ref<VoxelGeneratorGraph> create_graph(
+				void (*load_func)(VoxelGraphFunction &),
+				bool optimized,
+				unsigned int &out_expanded_nodes_count
+		) {
+			Ref<VoxelGeneratorGraph> generator;
+			generator.instantiate();
+			load_func(**generator->get_main_function());
+			pg::set_optimizations_enabled(optimized);
+			const pg::CompilationResult result = generator->compile(false);
+			pg::set_optimizations_enabled(true);
+			ZN_TEST_ASSERT_MSG(
+					result.success,
+					String("Failed to compile graph: {0}: {1}").format(varray(result.node_id, result.message))
+			);
+			out_expanded_nodes_count = result.expanded_nodes_count;
+			return generator;
+		}
+
+		static void test(void (*load_func)(VoxelGraphFunction &), bool expect_less_nodes) {
+			unsigned int optimized_nodes_count;
+			unsigned int unoptimized_nodes_count;
+			Ref<VoxelGeneratorGraph> optimized = create_graph(load_func, true, optimized_nodes_count);
+			Ref<VoxelGeneratorGraph> unoptimized = create_graph(load_func, false, unoptimized_nodes_count);
+			if (expect_less_nodes) {
+				ZN_TEST_ASSERT(optimized_nodes_count < unoptimized_nodes_count);
+			}
+			ZN_TEST_ASSERT(check_graph_results_are_equal(**optimized, **unoptimized));
+			ZN_TEST_ASSERT(check_graph_results_are_equal(**optimized, **unoptimized, Vector3i(-3, 5, 7)));
+		}
+	};
+
+	L::test(L::load_constants, true);
+	L::test(L::load_swapped_inputs, true);
+	// Clamp gets replaced with ClampC, which doesn't change the node count
+	L::test([](VoxelGraphFunction &g) { load_graph_with_clamp(g, 4.f); }, false);
+}
+
 int get_decimal_integer_character_count(int n) {
 	if (n == 0) {
 		return 1;
@@ -1817,6 +1938,58 @@ void test_voxel_graph_spots2d_optimized_execution_map() {
 	}*/
 }
 
+void test_voxel_graph_spots_series() {
+	// Series must give the same results as single queries, including negative coordinates
+	const unsigned int count = 4096;
+	StdVector<float> xs;
+	StdVector<float> ys;
+	StdVector<float> zs;
+	StdVector<float> spot_sizes;
+	StdVector<float> out;
+	xs.resize(count);
+	ys.resize(count);
+	zs.resize(count);
+	spot_sizes.resize(count);
+	out.resize(count);
+
+	RandomPCG rng;
+	rng.seed(131183);
+	for (unsigned int i = 0; i < count; ++i) {
+		xs[i] = rng.random(-500.f, 500.f);
+		ys[i] = rng.random(-500.f, 500.f);
+		zs[i] = rng.random(-500.f, 500.f);
+		spot_sizes[i] = rng.random(2.f, 12.f);
+	}
+
+	const float cell_size = 32.f;
+	const float jitter = 0.9f;
+	const int seed = 42;
+
+	SpotNoise::spot_noise_2d_series(
+			to_span_const(xs), to_span_const(ys), to_span_const(spot_sizes), cell_size, jitter, seed, to_span(out)
+	);
+	for (unsigned int i = 0; i < count; ++i) {
+		const float expected = SpotNoise::spot_noise_2d(Vector2f(xs[i], ys[i]), cell_size, spot_sizes[i], jitter, seed);
+		ZN_TEST_ASSERT(out[i] == expected);
+	}
+
+	SpotNoise::spot_noise_3d_series(
+			to_span_const(xs),
+			to_span_const(ys),
+			to_span_const(zs),
+			to_span_const(spot_sizes),
+			cell_size,
+			jitter,
+			seed,
+			to_span(out)
+	);
+	for (unsigned int i = 0; i < count; ++i) {
+		const float expected =
+				SpotNoise::spot_noise_3d(Vector3f(xs[i], ys[i], zs[i]), cell_size, spot_sizes[i], jitter, seed);
+		ZN_TEST_ASSERT(out[i] == expected);
+	}
+}
+
 void test_voxel_graph_unused_inner_output() {
 	// When compiling a graph with an unused output in one if its inner nodes (not an Output* node), compiling in debug
 	// would crash because it tries to allocate an output buffer with 0 users, which should be allowed specifically in
@@ -1936,6 +2109,332 @@ void test_voxel_graph_function_execute() {
 	}
 }
 
+void test_voxel_graph_fused_operations() {
+	Ref<VoxelGraphFunction> function;
+	function.instantiate();
+
+	// Chain of elementwise nodes, which get fused and processed in chunks.
+	// out = sdf_sphere(clamp((x + y) * (x + y), -50, 50), y, z)
+	{
+		const uint32_t n_x = function->create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+		const uint32_t n_y = function->create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+		const uint32_t n_z = function->create_node(VoxelGraphFunction::NODE_INPUT_Z, Vector2());
+		const uint32_t n_add = function->create_node(VoxelGraphFunction::NODE_ADD, Vector2());
+		const uint32_t n_mul = function->create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+		const uint32_t n_clamp = function->create_node(VoxelGraphFunction::NODE_CLAMP, Vector2());
+		const uint32_t n_sphere = function->create_node(VoxelGraphFunction::NODE_SDF_SPHERE, Vector2());
+		const uint32_t n_out_sd = function->create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+
+		function->add_connection(n_x, 0, n_add, 0);
+		function->add_connection(n_y, 0, n_add, 1);
+		// Same buffer used twice by the same operation
+		function->add_connection(n_add, 0, n_mul, 0);
+		function->add_connection(n_add, 0, n_mul, 1);
+		function->add_connection(n_mul, 0, n_clamp, 0);
+		function->add_connection(n_clamp, 0, n_sphere, 0);
+		function->add_connection(n_y, 0, n_sphere, 1);
+		function->add_connection(n_z, 0, n_sphere, 2);
+		function->add_connection(n_sphere, 0, n_out_sd, 0);
+
+		function->set_node_default_input(n_clamp, 1, -50.f);
+		function->set_node_default_input(n_clamp, 2, 50.f);
+
+		function->auto_pick_inputs_and_outputs();
+		const CompilationResult result = function->compile(false);
+		ZN_TEST_ASSERT(result.success);
+	}
+
+	// Not a multiple of chunk sizes, so the last chunk is partial
+	const unsigned int count = 1000;
+
+	StdVector<float> x_buffer;
+	StdVector<float> y_buffer;
+	StdVector<float> z_buffer;
+	StdVector<float> sd_buffer;
+
+	x_buffer.resize(count);
+	y_buffer.resize(count);
+	z_buffer.resize(count);
+	sd_buffer.resize(count);
+
+	for (unsigned int i = 0; i < count; ++i) {
+		x_buffer[i] = static_cast<float>(i % 17) - 8.f;
+		y_buffer[i] = static_cast<float>(i % 13) - 6.f;
+		z_buffer[i] = static_cast<float>(i) * 0.01f;
+	}
+
+	Span<float> inputs[3] = { to_span(x_buffer), to_span(y_buffer), to_span(z_buffer) };
+	Span<float> outputs = to_span(sd_buffer);
+	function->execute(Span<Span<float>>(inputs, 3), Span<Span<float>>(&outputs, 1));
+
+	for (unsigned int i = 0; i < count; ++i) {
+		const float x = x_buffer[i];
+		const float y = y_buffer[i];
+		const float z = z_buffer[i];
+		const float c = math::clamp((x + y) * (x + y), -50.f, 50.f);
+		const float expected_result = Math::sqrt(c * c + y * y + z * z) - 1.f;
+		ZN_TEST_ASSERT(Math::is_equal_approx(sd_buffer[i], expected_result));
+	}
+}
+
+void test_voxel_graph_expression_fused_with_other_nodes() {
+	Ref<VoxelGraphFunction> function;
+	function.instantiate();
+
+	// Expressions taking inputs from non-elementwise nodes. Their operations get reordered so they can be fused.
+	// e1 = x + y * 0.5
+	// a = select(e1, y, z)
+	// b = select(z, x, y)
+	// out = a * a - b * b + sqrt(abs(a - b))
+	{
+		const uint32_t n_x = function->create_node(VoxelGraphFunction::NODE_INPUT_X, Vector2());
+		const uint32_t n_y = function->create_node(VoxelGraphFunction::NODE_INPUT_Y, Vector2());
+		const uint32_t n_z = function->create_node(VoxelGraphFunction::NODE_INPUT_Z, Vector2());
+		const uint32_t n_e1 = function->create_node(VoxelGraphFunction::NODE_EXPRESSION, Vector2());
+		const uint32_t n_select_a = function->create_node(VoxelGraphFunction::NODE_SELECT, Vector2());
+		const uint32_t n_select_b = function->create_node(VoxelGraphFunction::NODE_SELECT, Vector2());
+		const uint32_t n_e2 = function->create_node(VoxelGraphFunction::NODE_EXPRESSION, Vector2());
+		const uint32_t n_out_sd = function->create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+
+		function->set_node_param(n_e1, 0, "x + y * 0.5");
+		{
+			PackedStringArray var_names;
+			var_names.push_back("x");
+			var_names.push_back("y");
+			function->set_expression_node_inputs(n_e1, var_names);
+		}
+
+		function->set_node_param(n_e2, 0, "a * a - b * b + sqrt(abs(a - b))");
+		{
+			PackedStringArray var_names;
+			var_names.push_back("a");
+			var_names.push_back("b");
+			function->set_expression_node_inputs(n_e2, var_names);
+		}
+
+		function->add_connection(n_x, 0, n_e1, 0);
+		function->add_connection(n_y, 0, n_e1, 1);
+
+		function->add_connection(n_e1, 0, n_select_a, 0);
+		function->add_connection(n_y, 0, n_select_a, 1);
+		function->add_connection(n_z, 0, n_select_a, 2);
+
+		function->add_connection(n_z, 0, n_select_b, 0);
+		function->add_connection(n_x, 0, n_select_b, 1);
+		function->add_connection(n_y, 0, n_select_b, 2);
+
+		function->add_connection(n_select_a, 0, n_e2, 0);
+		function->add_connection(n_select_b, 0, n_e2, 1);
+		function->add_connection(n_e2, 0, n_out_sd, 0);
+
+		function->auto_pick_inputs_and_outputs();
+		const CompilationResult result = function->compile(false);
+		ZN_TEST_ASSERT(result.success);
+	}
+
+	// Larger than a chunk, so operations run fused
+	const unsigned int count = 1000;
+
+	StdVector<float> x_buffer;
+	StdVector<float> y_buffer;
+	StdVector<float> z_buffer;
+	StdVector<float> sd_buffer;
+
+	x_buffer.resize(count);
+	y_buffer.resize(count);
+	z_buffer.resize(count);
+	sd_buffer.resize(count);
+
+	for (unsigned int i = 0; i < count; ++i) {
+		x_buffer[i] = static_cast<float>(i % 17) - 8.f;
+		y_buffer[i] = static_cast<float>(i % 13) - 6.f;
+		z_buffer[i] = static_cast<float>(i % 7) - 3.f;
+	}
+
+	Span<float> inputs[3] = { to_span(x_buffer), to_span(y_buffer), to_span(z_buffer) };
+	Span<float> outputs = to_span(sd_buffer);
+	function->execute(Span<Span<float>>(inputs, 3), Span<Span<float>>(&outputs, 1));
+
+	for (unsigned int i = 0; i < count; ++i) {
+		const float x = x_buffer[i];
+		const float y = y_buffer[i];
+		const float z = z_buffer[i];
+		// Select outputs its first input when the tested value is below the threshold, which defaults to 0
+		const float a = z < 0.f ? x + y * 0.5f : y;
+		const float b = y < 0.f ? z : x;
+		const float expected_result = a * a - b * b + Math::sqrt(Math::abs(a - b));
+		ZN_TEST_ASSERT(Math::is_equal_approx(sd_buffer[i], expected_result));
+	}
+}
+
+void test_voxel_graph_simd_kernels() {
+	// Not a multiple of vector sizes, so remainders get processed too
+	const unsigned int count = 1003;
+
+	StdVector<float> a;
+	StdVector<float> b;
+	StdVector<float> c;
+	a.resize(count);
+	b.resize(count);
+	c.resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		a[i] = static_cast<float>(i % 37) * 0.7f - 12.f;
+		b[i] = static_cast<float>(i % 29) * -0.3f + 4.1f;
+		// Never zero, to avoid NaNs when normalizing
+		c[i] = static_cast<float>(i) * 0.013f + 0.5f;
+	}
+
+	struct Results {
+		StdVector<float> add;
+		StdVector<float> constant_subtract;
+		StdVector<float> clamp;
+		StdVector<float> mix;
+		StdVector<float> smoothstep;
+		StdVector<float> sdf_sphere;
+		StdVector<float> sdf_box;
+		StdVector<float> sdf_torus;
+		StdVector<float> distance_3d;
+		StdVector<float> normalized_x;
+		StdVector<float> normalized_y;
+		StdVector<float> normalized_z;
+		StdVector<float> length;
+		StdVector<float> smooth_union;
+		StdVector<float> smooth_subtract;
+		StdVector<float> sphere_smooth_union;
+		StdVector<float> sphere_smooth_subtract;
+
+		void compute(const simd::Kernels &k, const float *a, const float *b, const float *c, unsigned int count) {
+			for (StdVector<float> *v : { &add, &constant_subtract, &clamp, &mix, &smoothstep, &sdf_sphere, &sdf_box,
+						 &sdf_torus, &distance_3d, &normalized_x, &normalized_y, &normalized_z, &length, &smooth_union,
+						 &smooth_subtract }) {
+				v->resize(count);
+			}
+			// These are modified in place
+			sphere_smooth_union.assign(b, b + count);
+			sphere_smooth_subtract.assign(b, b + count);
+			k.add(a, b, add.data(), count);
+			k.constant_subtract(a, 1.5f, constant_subtract.data(), count);
+			k.clamp(a, b, c, clamp.data(), count);
+			k.mix(a, b, c, mix.data(), count);
+			k.smoothstep(a, -3.f, 5.f, smoothstep.data(), count);
+			k.sdf_sphere(a, b, c, 3.f, sdf_sphere.data(), count);
+			k.sdf_box(a, b, c, 3.f, 2.f, 1.f, sdf_box.data(), count);
+			k.sdf_torus(a, b, c, 3.f, 1.f, sdf_torus.data(), count);
+			k.distance_3d(a, b, c, c, a, b, distance_3d.data(), count);
+			k.normalize_3d(
+					a, b, c, normalized_x.data(), normalized_y.data(), normalized_z.data(), length.data(), count
+			);
+			k.sdf_smooth_union(a, b, 2.f, smooth_union.data(), count);
+			k.sdf_smooth_subtract(a, b, 2.f, smooth_subtract.data(), count);
+			k.sdf_sphere_smooth_union(a, c, b, 1.f, 2.f, 3.f, 4.f, 1.5f, sphere_smooth_union.data(), count);
+			k.sdf_sphere_smooth_subtract(a, c, b, 1.f, 2.f, 3.f, 4.f, 1.5f, sphere_smooth_subtract.data(), count);
+		}
+
+		bool operator==(const Results &other) const {
+			return add == other.add && constant_subtract == other.constant_subtract && clamp == other.clamp &&
+					mix == other.mix && smoothstep == other.smoothstep && sdf_sphere == other.sdf_sphere &&
+					sdf_box == other.sdf_box && sdf_torus == other.sdf_torus && distance_3d == other.distance_3d &&
+					normalized_x == other.normalized_x && normalized_y == other.normalized_y &&
+					normalized_z == other.normalized_z && length == other.length &&
+					smooth_union == other.smooth_union && smooth_subtract == other.smooth_subtract &&
+					sphere_smooth_union == other.sphere_smooth_union &&
+					sphere_smooth_subtract == other.sphere_smooth_subtract;
+		}
+	};
+
+	Results expected;
+	expected.compute(simd::get_kernels(simd::SIMD_SCALAR), a.data(), b.data(), c.data(), count);
+
+	// Scalar kernels must match the math used elsewhere. Not compared exactly, because depending on the platform, the
+	// compiler may contract operations differently.
+	for (unsigned int i = 0; i < count; ++i) {
+		ZN_TEST_ASSERT(Math::is_equal_approx(expected.clamp[i], math::clamp(a[i], b[i], c[i])));
+		ZN_TEST_ASSERT(Math::is_equal_approx(expected.smoothstep[i], math::smoothstep(-3.f, 5.f, a[i])));
+		ZN_TEST_ASSERT(Math::is_equal_approx(
+				expected.sdf_box[i], math::sdf_box(Vector3f(a[i], b[i], c[i]), Vector3f(3.f, 2.f, 1.f))
+		));
+		ZN_TEST_ASSERT(Math::is_equal_approx(expected.sdf_torus[i], math::sdf_torus(a[i], b[i], c[i], 3.f, 1.f)));
+		ZN_TEST_ASSERT(Math::is_equal_approx(expected.smooth_union[i], math::sdf_smooth_union(a[i], b[i], 2.f)));
+		ZN_TEST_ASSERT(Math::is_equal_approx(expected.smooth_subtract[i], math::sdf_smooth_subtract(a[i], b[i], 2.f)));
+		const float sphere_sd = math::sdf_sphere(Vector3f(a[i], c[i], b[i]), Vector3f(1.f, 2.f, 3.f), 4.f);
+		ZN_TEST_ASSERT(Math::is_equal_approx(
+				expected.sphere_smooth_union[i], math::sdf_smooth_union(b[i], sphere_sd, 1.5f)
+		));
+		ZN_TEST_ASSERT(Math::is_equal_approx(
+				expected.sphere_smooth_subtract[i], math::sdf_smooth_subtract(b[i], sphere_sd, 1.5f)
+		));
+	}
+
+	// Other levels must give exactly the same results, so generators remain deterministic across CPUs
+	for (unsigned int level = simd::SIMD_SCALAR + 1; level < simd::SIMD_LEVEL_COUNT; ++level) {
+		const simd::SIMDLevel simd_level = static_cast<simd::SIMDLevel>(level);
+		if (!simd::is_simd_level_supported(simd_level)) {
+			continue;
+		}
+		Results results;
+		results.compute(simd::get_kernels(simd_level), a.data(), b.data(), c.data(), count);
+		ZN_TEST_ASSERT(results == expected);
+	}
+}
+
+void test_voxel_graph_column_cache() {
+	struct L {
+		// Plane - Noise2D * 10, where the noise part only depends on X and Z
+		static Ref<VoxelGeneratorGraph> create_generator(bool use_xz_caching) {
+			Ref<VoxelGeneratorGraph> generator;
+			generator.instantiate();
+
+			Ref<VoxelGraphFunction> func = generator->get_main_function();
+			ZN_ASSERT(func.is_valid());
+
+			const uint32_t n_out_sdf = func->create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+			const uint32_t n_plane = func->create_node(VoxelGraphFunction::NODE_SDF_PLANE, Vector2());
+
+			const uint32_t n_noise = func->create_node(VoxelGraphFunction::NODE_FAST_NOISE_2D, Vector2());
+			Ref<ZN_FastNoiseLite> fnl;
+			fnl.instantiate();
+			fnl->set_period(64);
+			func->set_node_param(n_noise, 0, fnl);
+
+			const uint32_t n_mul = func->create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+			func->set_node_default_input(n_mul, 1, 10.0);
+
+			const uint32_t n_sub = func->create_node(VoxelGraphFunction::NODE_SUBTRACT, Vector2());
+
+			func->add_connection(n_plane, 0, n_sub, 0);
+			func->add_connection(n_noise, 0, n_mul, 0);
+			func->add_connection(n_mul, 0, n_sub, 1);
+			func->add_connection(n_sub, 0, n_out_sdf, 0);
+
+			// Compute every voxel
+			generator->set_sdf_clip_threshold(10000.f);
+			generator->set_use_xz_caching(use_xz_caching);
+
+			const CompilationResult result = generator->compile(false);
+			ZN_TEST_ASSERT(result.success);
+			return generator;
+		}
+	};
+
+	Ref<VoxelGeneratorGraph> generator_cached = L::create_generator(true);
+	Ref<VoxelGeneratorGraph> generator_reference = L::create_generator(false);
+
+	// Blocks above each other re-use results of the first block generated in their column.
+	// Also check with the optimized execution map, which can skip computing parts of the graph in some blocks.
+	for (const bool use_optimized_execution_map : { false, true }) {
+		generator_cached->set_use_optimized_execution_map(use_optimized_execution_map);
+		generator_reference->set_use_optimized_execution_map(use_optimized_execution_map);
+
+		for (int x = -32; x <= 32; x += 16) {
+			for (int y = -32; y <= 32; y += 16) {
+				ZN_TEST_ASSERT(
+						check_graph_results_are_equal(**generator_cached, **generator_reference, Vector3i(x, y, 16))
+				);
+			}
+		}
+	}
+}
+
 void test_voxel_graph_image() {
 	struct L {
 		static void test_range(Ref<Image> image, Box3i box, math::Interval expected_bound) {
@@ -2019,6 +2518,151 @@ void test_voxel_graph_image() {
 	}
 }
 
+void test_voxel_graph_fast_noise_2d_range_clipping() {
+	// Heightmap made of 2D noise. Measures how many sections range analysis can skip, and checks that estimated noise
+	// ranges contain the actual values.
+	Ref<ZN_FastNoiseLite> fnl;
+	fnl.instantiate();
+	fnl->set_period(256);
+	fnl->set_seed(131183);
+
+	const float amplitude = 100.f;
+
+	Ref<VoxelGeneratorGraph> generator;
+	generator.instantiate();
+	uint32_t n_noise;
+	{
+		Ref<VoxelGraphFunction> g = generator->get_main_function();
+		ZN_ASSERT(g.is_valid());
+
+		//   SdfPlane --- - --- OutputSDF
+		//               /
+		//  Noise2D --- *
+
+		const uint32_t n_plane = g->create_node(VoxelGraphFunction::NODE_SDF_PLANE, Vector2());
+		n_noise = g->create_node(VoxelGraphFunction::NODE_FAST_NOISE_2D, Vector2());
+		const uint32_t n_mul = g->create_node(VoxelGraphFunction::NODE_MULTIPLY, Vector2());
+		const uint32_t n_sub = g->create_node(VoxelGraphFunction::NODE_SUBTRACT, Vector2());
+		const uint32_t n_out = g->create_node(VoxelGraphFunction::NODE_OUTPUT_SDF, Vector2());
+
+		g->set_node_param(n_noise, 0, fnl);
+		g->set_node_default_input(n_mul, 1, amplitude);
+
+		g->add_connection(n_noise, 0, n_mul, 0);
+		g->add_connection(n_plane, 0, n_sub, 0);
+		g->add_connection(n_mul, 0, n_sub, 1);
+		g->add_connection(n_sub, 0, n_out, 0);
+	}
+
+	CompilationResult result = generator->compile(true);
+	ZN_TEST_ASSERT(result.success);
+
+	uint32_t noise_output_address;
+	ZN_TEST_ASSERT(
+			generator->try_get_output_port_address(ProgramGraph::PortLocation{ n_noise, 0 }, noise_output_address)
+	);
+
+	const int section_size = 16;
+	const float clip_threshold = generator->get_sdf_clip_threshold();
+
+	unsigned int section_count = 0;
+	unsigned int clipped_count = 0;
+	// Sections that would be clipped if noise was assumed to be in [-1, 1]
+	unsigned int clipped_count_with_unit_range = 0;
+
+	for (int z = -128; z < 128; z += section_size) {
+		for (int x = -128; x < 128; x += section_size) {
+			for (int y = -128; y < 128; y += section_size) {
+				const Vector3i min_pos(x, y, z);
+				const Vector3i max_pos = min_pos + Vector3iUtil::create(section_size);
+
+				const math::Interval sdf_range = generator->debug_analyze_range(min_pos, max_pos, false);
+				if (sdf_range.min > clip_threshold || sdf_range.max < -clip_threshold) {
+					++clipped_count;
+				}
+				if (min_pos.y - amplitude > clip_threshold || max_pos.y + amplitude < -clip_threshold) {
+					++clipped_count_with_unit_range;
+				}
+				++section_count;
+
+				if (y != 0) {
+					continue;
+				}
+				// Noise doesn't depend on Y, check it once per column
+				const pg::Runtime::State &state = generator->get_last_state_from_current_thread();
+				const math::Interval noise_range = state.get_range(noise_output_address);
+				for (int pz = min_pos.z; pz <= max_pos.z; ++pz) {
+					for (int px = min_pos.x; px <= max_pos.x; ++px) {
+						ZN_TEST_ASSERT(noise_range.contains(fnl->get_noise_2d(px, pz)));
+					}
+				}
+			}
+		}
+	}
+
+	ZN_PRINT_VERBOSE(format(
+			"Clipped {} sections out of {}, {} assuming a unit noise range",
+			clipped_count,
+			section_count,
+			clipped_count_with_unit_range
+	));
+	ZN_TEST_ASSERT(clipped_count > clipped_count_with_unit_range);
+}
+
+void test_voxel_graph_fast_noise_3d_series() {
+	Ref<ZN_FastNoiseLite> fnl;
+	fnl.instantiate();
+	fnl->set_period(37);
+	fnl->set_seed(131183);
+	fnl->set_fractal_octaves(4);
+	fnl->set_fractal_weighted_strength(0.3f);
+
+	// Enough positions for several chunks, and a partial one
+	const unsigned int count = 200;
+	StdVector<float> xs;
+	StdVector<float> ys;
+	StdVector<float> zs;
+	StdVector<float> out;
+	xs.resize(count);
+	ys.resize(count);
+	zs.resize(count);
+	out.resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		xs[i] = static_cast<float>(i % 7) * 13.3f - 40.f;
+		ys[i] = static_cast<float>(i % 11) * 5.1f;
+		zs[i] = static_cast<float>(i) * -2.7f;
+	}
+
+	const ZN_FastNoiseLite::NoiseType noise_types[] = {
+		ZN_FastNoiseLite::TYPE_OPEN_SIMPLEX_2,
+		ZN_FastNoiseLite::TYPE_OPEN_SIMPLEX_2S,
+		ZN_FastNoiseLite::TYPE_CELLULAR,
+		ZN_FastNoiseLite::TYPE_PERLIN,
+		ZN_FastNoiseLite::TYPE_VALUE_CUBIC,
+		ZN_FastNoiseLite::TYPE_VALUE
+	};
+	const ZN_FastNoiseLite::FractalType fractal_types[] = {
+		ZN_FastNoiseLite::FRACTAL_NONE,
+		ZN_FastNoiseLite::FRACTAL_FBM,
+		ZN_FastNoiseLite::FRACTAL_RIDGED,
+		ZN_FastNoiseLite::FRACTAL_PING_PONG
+	};
+
+	for (const ZN_FastNoiseLite::NoiseType noise_type : noise_types) {
+		for (const ZN_FastNoiseLite::FractalType fractal_type : fractal_types) {
+			fnl->set_noise_type(noise_type);
+			fnl->set_fractal_type(fractal_type);
+
+			fnl->get_noise_3d_series(to_span_const(xs), to_span_const(ys), to_span_const(zs), to_span(out));
+
+			// Series must give exactly the same results as single queries
+			for (unsigned int i = 0; i < count; ++i) {
+				ZN_TEST_ASSERT(out[i] == fnl->get_noise_3d(xs[i], ys[i], zs[i]));
+			}
+		}
+	}
+}
+
 void test_voxel_graph_many_weight_outputs() {
 	Ref<VoxelGeneratorGraph> generator;
 	generator.instantiate();
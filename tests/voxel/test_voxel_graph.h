@@ -11,6 +11,7 @@ void test_voxel_graph_generator_expressions();
 void test_voxel_graph_generator_expressions_2();
 void test_voxel_graph_generator_texturing();
 void test_voxel_graph_equivalence_merging();
+void test_voxel_graph_optimizations_preserve_results();
 void test_voxel_graph_generate_block_with_input_sdf();
 void test_voxel_graph_functions_pass_through();
 void test_voxel_graph_functions_nested_pass_through();
@@ -28,9 +29,16 @@ void test_voxel_graph_hash();
 void test_voxel_graph_issue471();
 void test_voxel_graph_unused_single_texture_output();
 void test_voxel_graph_spots2d_optimized_execution_map();
+void test_voxel_graph_spots_series();
 void test_voxel_graph_unused_inner_output();
 void test_voxel_graph_function_execute();
+void test_voxel_graph_fused_operations();
+void test_voxel_graph_expression_fused_with_other_nodes();
+void test_voxel_graph_simd_kernels();
+void test_voxel_graph_column_cache();
 void test_voxel_graph_image();
+void test_voxel_graph_fast_noise_2d_range_clipping();
+void test_voxel_graph_fast_noise_3d_series();
 void test_voxel_graph_many_weight_outputs();
 void test_image_range_grid();
 void test_voxel_graph_many_subdivisions();
@@ -121,4 +121,44 @@ void test_instance_data_serialization() {
 	}
 }
 
+void test_quantized_instance_transforms() {
+	StdVector<Transform3f> src_transforms;
+	for (unsigned int i = 0; i < 100; ++i) {
+		const float scale = 0.5 + 0.02 * i;
+		const Basis basis = Basis().rotated(Vector3(0.05 * i, 0.3, -0.02 * i)).scaled(Vector3(scale, scale, scale));
+		src_transforms.push_back(to_transform3f(Transform3D(basis, Vector3(0.3 * i, 16.0 - 0.1 * i, 2.0))));
+	}
+
+	QuantizedInstanceTransforms instances;
+	instances.set(to_span_const(src_transforms));
+	ZN_TEST_ASSERT(instances.size() == src_transforms.size());
+
+	const Vector3f offset(1, 2, 3);
+	StdVector<Transform3f> dst_transforms;
+	instances.decode(dst_transforms, offset);
+	ZN_TEST_ASSERT(dst_transforms.size() == src_transforms.size());
+
+	// Positions are quantized over their bounding box, with 16 bits per axis
+	const float distance_error = 30.f / float(InstanceBlockData::POSITION_RESOLUTION);
+	// Rotation uses 8 bits per quaternion component, and scale 8 bits over its range
+	const float basis_error = 0.1f;
+
+	for (unsigned int i = 0; i < src_transforms.size(); ++i) {
+		const Transform3f &src = src_transforms[i];
+		const Transform3f &dst = dst_transforms[i];
+		ZN_TEST_ASSERT(math::distance(src.origin + offset, dst.origin) <= distance_error);
+		for (unsigned int row = 0; row < 3; ++row) {
+			ZN_TEST_ASSERT(math::distance(src.basis.rows[row], dst.basis.rows[row]) <= basis_error);
+		}
+
+		const Transform3f t = instances.get_transform(i);
+		ZN_TEST_ASSERT(math::distance(t.origin + offset, dst.origin) <= 0.0001f);
+	}
+
+	const Vector3f last_position = instances.get_position(instances.size() - 1);
+	instances.remove_unordered(10);
+	ZN_TEST_ASSERT(instances.size() == src_transforms.size() - 1);
+	ZN_TEST_ASSERT(math::distance(instances.get_position(10), last_position) <= 0.0001f);
+}
+
 } // namespace zylann::voxel::tests
@@ -4,6 +4,7 @@
 namespace zylann::voxel::tests {
 
 void test_instance_data_serialization();
+void test_quantized_instance_transforms();
 
 } // namespace zylann::voxel::tests
 
@@ -0,0 +1,196 @@
+#include "test_voxel_mesher_blocky.h"
+#include "../../meshers/blocky/voxel_blocky_library.h"
+#include "../../meshers/blocky/voxel_blocky_model_cube.h"
+#include "../../meshers/blocky/voxel_blocky_model_empty.h"
+#include "../../meshers/blocky/voxel_mesher_blocky.h"
+#include "../../storage/voxel_buffer.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_voxel_mesher_blocky_greedy() {
+	Ref<VoxelBlockyLibrary> library;
+	library.instantiate();
+	{
+		Ref<VoxelBlockyModelEmpty> air;
+		air.instantiate();
+		library->add_model(air);
+	}
+	int cube_id = -1;
+	{
+		Ref<VoxelBlockyModelCube> cube;
+		cube.instantiate();
+		cube_id = library->add_model(cube);
+	}
+	library->bake();
+
+	// Slab of 3x1x3 cubes
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(8, 8, 8);
+	for (int z = 2; z < 5; ++z) {
+		for (int x = 2; x < 5; ++x) {
+			vb.set_voxel(cube_id, Vector3i(x, 3, z), VoxelBuffer::CHANNEL_TYPE);
+		}
+	}
+
+	Ref<VoxelMesherBlocky> mesher;
+	mesher.instantiate();
+	mesher->set_library(library);
+
+	struct L {
+		static unsigned int get_vertex_count(VoxelMesherBlocky &mesher, const VoxelBuffer &vb) {
+			VoxelMesher::Input input{ vb, nullptr, Vector3i(), 0, false };
+			VoxelMesher::Output output;
+			mesher.build(output, input);
+			ZN_TEST_ASSERT(output.surfaces.size() == 1);
+			const PackedVector3Array vertices = output.surfaces[0].arrays[Mesh::ARRAY_VERTEX];
+			return vertices.size();
+		}
+	};
+
+	// 9 faces on top and bottom, 3 faces on each of the 4 sides, 4 vertices per face
+	mesher->set_greedy_meshing_enabled(false);
+	ZN_TEST_ASSERT(L::get_vertex_count(**mesher, vb) == (9 * 2 + 3 * 4) * 4);
+
+	// Each side of the slab becomes a single quad.
+	// Occlusion is the same on all corners of the slab's faces so it doesn't prevent merging.
+	mesher->set_greedy_meshing_enabled(true);
+	mesher->set_occlusion_enabled(true);
+	ZN_TEST_ASSERT(L::get_vertex_count(**mesher, vb) == 6 * 4);
+
+	mesher->set_occlusion_enabled(false);
+	ZN_TEST_ASSERT(L::get_vertex_count(**mesher, vb) == 6 * 4);
+
+	// A voxel on top of the slab occludes corners of the faces around it, which can't be merged with the others
+	vb.set_voxel(cube_id, Vector3i(3, 4, 3), VoxelBuffer::CHANNEL_TYPE);
+	mesher->set_occlusion_enabled(true);
+	const unsigned int occluded_count = L::get_vertex_count(**mesher, vb);
+	mesher->set_occlusion_enabled(false);
+	const unsigned int non_occluded_count = L::get_vertex_count(**mesher, vb);
+	ZN_TEST_ASSERT(occluded_count > non_occluded_count);
+}
+
+void test_voxel_mesher_blocky_incremental() {
+	Ref<VoxelBlockyLibrary> library;
+	library.instantiate();
+	{
+		Ref<VoxelBlockyModelEmpty> air;
+		air.instantiate();
+		library->add_model(air);
+	}
+	int cube_id = -1;
+	{
+		Ref<VoxelBlockyModelCube> cube;
+		cube.instantiate();
+		cube_id = library->add_model(cube);
+	}
+	library->bake();
+
+	// Ground covering the bottom half of a block spanning several sections
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(18, 18, 18);
+	for (int z = 0; z < 18; ++z) {
+		for (int x = 0; x < 18; ++x) {
+			for (int y = 0; y < 9; ++y) {
+				vb.set_voxel(cube_id, Vector3i(x, y, z), VoxelBuffer::CHANNEL_TYPE);
+			}
+		}
+	}
+
+	struct L {
+		static PackedVector3Array build(VoxelMesherBlocky &mesher, const VoxelBuffer &vb) {
+			VoxelMesher::Input input{ vb, nullptr, Vector3i(), 0, false };
+			VoxelMesher::Output output;
+			mesher.build(output, input);
+			ZN_TEST_ASSERT(output.surfaces.size() == 1);
+			return output.surfaces[0].arrays[Mesh::ARRAY_VERTEX];
+		}
+	};
+
+	Ref<VoxelMesherBlocky> incremental_mesher;
+	incremental_mesher.instantiate();
+	incremental_mesher->set_library(library);
+	incremental_mesher->set_incremental_meshing_enabled(true);
+
+	Ref<VoxelMesherBlocky> mesher;
+	mesher.instantiate();
+	mesher->set_library(library);
+
+	// Sections only change the order of faces
+	ZN_TEST_ASSERT(L::build(**incremental_mesher, vb).size() == L::build(**mesher, vb).size());
+
+	// Dig a hole, then fill it back. Reused sections must give the same result as meshing from scratch.
+	vb.set_voxel(0, Vector3i(4, 8, 4), VoxelBuffer::CHANNEL_TYPE);
+	const PackedVector3Array edited_vertices = L::build(**incremental_mesher, vb);
+	ZN_TEST_ASSERT(edited_vertices.size() == L::build(**mesher, vb).size());
+	{
+		Ref<VoxelMesherBlocky> fresh_mesher;
+		fresh_mesher.instantiate();
+		fresh_mesher->set_library(library);
+		fresh_mesher->set_incremental_meshing_enabled(true);
+		ZN_TEST_ASSERT(L::build(**fresh_mesher, vb) == edited_vertices);
+	}
+
+	vb.set_voxel(cube_id, Vector3i(4, 8, 4), VoxelBuffer::CHANNEL_TYPE);
+	ZN_TEST_ASSERT(L::build(**incremental_mesher, vb).size() == L::build(**mesher, vb).size());
+}
+
+void test_voxel_blocky_library_side_culling_cache() {
+	// Enough models for sides to be rasterized by several threads
+	Ref<VoxelBlockyLibrary> library;
+	library.instantiate();
+	{
+		Ref<VoxelBlockyModelEmpty> air;
+		air.instantiate();
+		library->add_model(air);
+	}
+	Ref<VoxelBlockyModelCube> last_cube;
+	for (unsigned int i = 0; i < 300; ++i) {
+		Ref<VoxelBlockyModelCube> cube;
+		cube.instantiate();
+		cube->set_height(static_cast<float>(i % 8 + 1) / 8.f);
+		library->add_model(cube);
+		last_cube = cube;
+	}
+	library->bake();
+
+	const VoxelBlockyLibraryBase::BakedData &baked_data = library->get_baked_data();
+	ZN_TEST_ASSERT(baked_data.side_pattern_count > 1);
+
+	const uint64_t hash = get_side_culling_geometry_hash(baked_data);
+	StdVector<uint8_t> cache;
+	save_side_culling_cache(baked_data, hash, cache);
+
+	// Loading the cache gives the same results as generating them
+	VoxelBlockyLibraryBase::BakedData loaded_data;
+	loaded_data.models = baked_data.models;
+	for (VoxelBlockyModel::BakedData &model_data : loaded_data.models) {
+		model_data.model.full_sides_mask = 0;
+		fill(model_data.model.side_pattern_indices, uint32_t(0));
+	}
+	ZN_TEST_ASSERT(load_side_culling_cache(loaded_data, hash, to_span_const(cache)));
+
+	ZN_TEST_ASSERT(loaded_data.side_pattern_count == baked_data.side_pattern_count);
+	ZN_TEST_ASSERT(loaded_data.side_pattern_culling.size() == baked_data.side_pattern_culling.size());
+	for (unsigned int i = 0; i < baked_data.side_pattern_culling.size(); ++i) {
+		ZN_TEST_ASSERT(loaded_data.side_pattern_culling.get(i) == baked_data.side_pattern_culling.get(i));
+	}
+	ZN_TEST_ASSERT(loaded_data.model_culling.size() == baked_data.model_culling.size());
+	for (unsigned int i = 0; i < baked_data.model_culling.size(); ++i) {
+		const VoxelBlockyLibraryBase::BakedData::ModelCulling &expected = baked_data.model_culling[i];
+		const VoxelBlockyLibraryBase::BakedData::ModelCulling &loaded = loaded_data.model_culling[i];
+		ZN_TEST_ASSERT(loaded.side_pattern_indices == expected.side_pattern_indices);
+		ZN_TEST_ASSERT(loaded.mergeable_sides_mask == expected.mergeable_sides_mask);
+		ZN_TEST_ASSERT(loaded.contributes_to_ao == expected.contributes_to_ao);
+		ZN_TEST_ASSERT(loaded_data.models[i].model.full_sides_mask == baked_data.models[i].model.full_sides_mask);
+	}
+
+	// A cache made from different geometry doesn't get loaded
+	ZN_TEST_ASSERT(!load_side_culling_cache(loaded_data, hash + 1, to_span_const(cache)));
+
+	last_cube->set_height(0.3f);
+	library->bake();
+	ZN_TEST_ASSERT(get_side_culling_geometry_hash(library->get_baked_data()) != hash);
+}
+
+} // namespace zylann::voxel::tests
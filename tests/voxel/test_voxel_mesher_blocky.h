@@ -0,0 +1,12 @@
+#ifndef VOXEL_TESTS_VOXEL_MESHER_BLOCKY_H
+#define VOXEL_TESTS_VOXEL_MESHER_BLOCKY_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_mesher_blocky_greedy();
+void test_voxel_mesher_blocky_incremental();
+void test_voxel_blocky_library_side_culling_cache();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TESTS_VOXEL_MESHER_BLOCKY_H
@@ -1,7 +1,11 @@
 #include "test_voxel_mesher_cubes.h"
+#include "../../meshers/cubes/voxel_color_palette.h"
 #include "../../meshers/cubes/voxel_mesher_cubes.h"
 #include "../../storage/voxel_buffer.h"
+#include "../../terrain/variable_lod/voxel_mesh_cluster_vlt.h"
 #include "../testing.h"
+#include <algorithm>
+#include <array>
 
 namespace zylann::voxel::tests {
 
@@ -51,4 +55,217 @@ void test_voxel_mesher_cubes() {
 	ZN_TEST_ASSERT(surface1_vertices_count == 20);
 }
 
+void test_voxel_mesher_cubes_occluder_boxes() {
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(10, 10, 10);
+	vb.set_channel_depth(VoxelBuffer::CHANNEL_COLOR, VoxelBuffer::DEPTH_16_BIT);
+	// Opaque cube, which should be covered by a single occluder
+	vb.fill_area(
+			Color8(0, 255, 0, 255).to_u16(), Vector3i(2, 2, 2), Vector3i(8, 8, 8), VoxelBuffer::CHANNEL_COLOR
+	);
+	// Single voxels and transparent voxels can't be used
+	vb.set_voxel(Color8(0, 0, 255, 255).to_u16(), Vector3i(1, 1, 1), VoxelBuffer::CHANNEL_COLOR);
+	vb.fill_area(
+			Color8(0, 0, 255, 128).to_u16(), Vector3i(2, 8, 2), Vector3i(8, 9, 8), VoxelBuffer::CHANNEL_COLOR
+	);
+
+	Ref<VoxelMesherCubes> mesher;
+	mesher.instantiate();
+	mesher->set_color_mode(VoxelMesherCubes::COLOR_RAW);
+	mesher->set_occluder_boxes_enabled(true);
+
+	VoxelMesher::Input input{ vb, nullptr, Vector3i(), 0, false };
+	VoxelMesher::Output output;
+	mesher->build(output, input);
+
+	ZN_TEST_ASSERT(output.occluder_boxes.size() == 1);
+	// Mesh space doesn't include padding
+	const Box3f &box = output.occluder_boxes[0];
+	ZN_TEST_ASSERT(box.min == Vector3f(1, 1, 1));
+	ZN_TEST_ASSERT(box.max == Vector3f(7, 7, 7));
+}
+
+void test_voxel_mesher_cubes_palette_indexed() {
+	// 8-bit palette indices are meshed with a dedicated path, which must give the same results as 16-bit indices
+	Ref<VoxelColorPalette> palette;
+	palette.instantiate();
+	palette->set_color(1, Color(1, 0, 0, 1));
+	palette->set_color(2, Color(0, 1, 0, 1));
+	palette->set_color(3, Color(0, 0, 1, 0.5));
+
+	Ref<VoxelMesherCubes> mesher;
+	mesher.instantiate();
+	mesher->set_color_mode(VoxelMesherCubes::COLOR_MESHER_PALETTE);
+	mesher->set_palette(palette);
+
+	FixedArray<VoxelMesher::Output, 2> outputs;
+
+	for (unsigned int test_index = 0; test_index < outputs.size(); ++test_index) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		vb.create(10, 10, 10);
+		vb.set_channel_depth(
+				VoxelBuffer::CHANNEL_COLOR, test_index == 0 ? VoxelBuffer::DEPTH_8_BIT : VoxelBuffer::DEPTH_16_BIT
+		);
+		vb.fill_area(1, Vector3i(2, 2, 2), Vector3i(6, 5, 7), VoxelBuffer::CHANNEL_COLOR);
+		vb.fill_area(2, Vector3i(3, 5, 2), Vector3i(5, 8, 4), VoxelBuffer::CHANNEL_COLOR);
+		vb.set_voxel(3, Vector3i(7, 2, 2), VoxelBuffer::CHANNEL_COLOR);
+		vb.set_voxel(3, Vector3i(6, 2, 2), VoxelBuffer::CHANNEL_COLOR);
+
+		VoxelMesher::Input input{ vb, nullptr, Vector3i(), 0, false };
+		mesher->build(outputs[test_index], input);
+	}
+
+	const VoxelMesher::Output &output8 = outputs[0];
+	const VoxelMesher::Output &output16 = outputs[1];
+
+	ZN_TEST_ASSERT(output8.surfaces.size() == 2);
+	ZN_TEST_ASSERT(output8.surfaces.size() == output16.surfaces.size());
+	for (unsigned int surface_index = 0; surface_index < output8.surfaces.size(); ++surface_index) {
+		const Array &arrays8 = output8.surfaces[surface_index].arrays;
+		const Array &arrays16 = output16.surfaces[surface_index].arrays;
+		ZN_TEST_ASSERT(arrays8.size() > 0);
+
+		const PackedVector3Array vertices8 = arrays8[Mesh::ARRAY_VERTEX];
+		const PackedVector3Array vertices16 = arrays16[Mesh::ARRAY_VERTEX];
+		ZN_TEST_ASSERT(vertices8.size() > 0);
+		ZN_TEST_ASSERT(vertices8 == vertices16);
+
+		const PackedColorArray colors8 = arrays8[Mesh::ARRAY_COLOR];
+		const PackedColorArray colors16 = arrays16[Mesh::ARRAY_COLOR];
+		ZN_TEST_ASSERT(colors8 == colors16);
+
+		const PackedInt32Array indices8 = arrays8[Mesh::ARRAY_INDEX];
+		const PackedInt32Array indices16 = arrays16[Mesh::ARRAY_INDEX];
+		ZN_TEST_ASSERT(indices8 == indices16);
+	}
+}
+
+void test_voxel_mesher_cubes_mesh_optimization() {
+	VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb.create(10, 10, 10);
+	vb.set_channel_depth(VoxelBuffer::CHANNEL_COLOR, VoxelBuffer::DEPTH_16_BIT);
+	vb.fill_area(Color8(0, 255, 0, 255).to_u16(), Vector3i(2, 2, 2), Vector3i(6, 5, 7), VoxelBuffer::CHANNEL_COLOR);
+	vb.fill_area(Color8(255, 0, 0, 255).to_u16(), Vector3i(4, 5, 3), Vector3i(8, 8, 5), VoxelBuffer::CHANNEL_COLOR);
+
+	Ref<VoxelMesherCubes> mesher;
+	mesher.instantiate();
+	mesher->set_color_mode(VoxelMesherCubes::COLOR_RAW);
+	// More triangles to reorder
+	mesher->set_greedy_meshing_enabled(false);
+
+	VoxelMesher::Input input{ vb, nullptr, Vector3i(), 0, false };
+
+	// Surface arrays are shared when copied, so the mesh is built twice
+	VoxelMesher::Output output;
+	mesher->build(output, input);
+	VoxelMesher::Output optimized_output;
+	mesher->build(optimized_output, input);
+	VoxelMesher::optimize_output_for_gpu(optimized_output);
+
+	typedef std::array<float, 9> Triangle;
+
+	struct L {
+		static StdVector<Triangle> get_sorted_triangles(const Array &arrays) {
+			const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+			const PackedInt32Array indices = arrays[Mesh::ARRAY_INDEX];
+			StdVector<Triangle> triangles;
+			for (int i = 0; i + 2 < indices.size(); i += 3) {
+				Triangle t;
+				for (unsigned int corner = 0; corner < 3; ++corner) {
+					const Vector3 v = vertices[indices[i + corner]];
+					t[corner * 3 + 0] = v.x;
+					t[corner * 3 + 1] = v.y;
+					t[corner * 3 + 2] = v.z;
+				}
+				triangles.push_back(t);
+			}
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		}
+	};
+
+	ZN_TEST_ASSERT(output.surfaces.size() == optimized_output.surfaces.size());
+	const Array &arrays = output.surfaces[VoxelMesherCubes::MATERIAL_OPAQUE].arrays;
+	const Array &optimized_arrays = optimized_output.surfaces[VoxelMesherCubes::MATERIAL_OPAQUE].arrays;
+
+	const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+	const PackedVector3Array optimized_vertices = optimized_arrays[Mesh::ARRAY_VERTEX];
+	const PackedColorArray optimized_colors = optimized_arrays[Mesh::ARRAY_COLOR];
+	const PackedVector3Array optimized_normals = optimized_arrays[Mesh::ARRAY_NORMAL];
+	ZN_TEST_ASSERT(optimized_vertices.size() > 0);
+	ZN_TEST_ASSERT(optimized_vertices.size() <= vertices.size());
+	ZN_TEST_ASSERT(optimized_colors.size() == optimized_vertices.size());
+	ZN_TEST_ASSERT(optimized_normals.size() == optimized_vertices.size());
+
+	// Triangles may be in a different order, but the same triangles must be rendered
+	const StdVector<Triangle> triangles = L::get_sorted_triangles(arrays);
+	const StdVector<Triangle> optimized_triangles = L::get_sorted_triangles(optimized_arrays);
+	ZN_TEST_ASSERT(triangles.size() > 0);
+	ZN_TEST_ASSERT(triangles == optimized_triangles);
+}
+
+void test_voxel_mesher_cubes_mesh_cluster_merge() {
+	Ref<VoxelMesherCubes> mesher;
+	mesher.instantiate();
+	mesher->set_color_mode(VoxelMesherCubes::COLOR_RAW);
+
+	VoxelBuffer vb0(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb0.create(10, 10, 10);
+	vb0.set_channel_depth(VoxelBuffer::CHANNEL_COLOR, VoxelBuffer::DEPTH_16_BIT);
+	vb0.fill_area(Color8(0, 255, 0, 255).to_u16(), Vector3i(2, 2, 2), Vector3i(6, 5, 7), VoxelBuffer::CHANNEL_COLOR);
+
+	VoxelBuffer vb1(VoxelBuffer::ALLOCATOR_DEFAULT);
+	vb1.create(10, 10, 10);
+	vb1.set_channel_depth(VoxelBuffer::CHANNEL_COLOR, VoxelBuffer::DEPTH_16_BIT);
+	vb1.fill_area(Color8(255, 0, 0, 255).to_u16(), Vector3i(1, 3, 2), Vector3i(8, 8, 5), VoxelBuffer::CHANNEL_COLOR);
+
+	VoxelMesher::Output output0;
+	mesher->build(output0, VoxelMesher::Input{ vb0, nullptr, Vector3i(), 0, false });
+	VoxelMesher::Output output1;
+	mesher->build(output1, VoxelMesher::Input{ vb1, nullptr, Vector3i(), 0, false });
+
+	const Vector3 offset1(8, 0, 0);
+
+	StdVector<VoxelMeshClusterInput> inputs;
+	inputs.push_back(VoxelMeshClusterInput{ output0.surfaces, Vector3() });
+	inputs.push_back(VoxelMeshClusterInput{ output1.surfaces, offset1 });
+
+	StdVector<VoxelMesher::Output::Surface> merged_surfaces;
+	ZN_TEST_ASSERT(merge_mesh_cluster_surfaces(to_span(inputs), merged_surfaces));
+	ZN_TEST_ASSERT(merged_surfaces.size() == 1);
+	ZN_TEST_ASSERT(merged_surfaces[0].material_index == VoxelMesherCubes::MATERIAL_OPAQUE);
+
+	const Array &arrays0 = output0.surfaces[VoxelMesherCubes::MATERIAL_OPAQUE].arrays;
+	const Array &arrays1 = output1.surfaces[VoxelMesherCubes::MATERIAL_OPAQUE].arrays;
+	const Array &merged_arrays = merged_surfaces[0].arrays;
+
+	const PackedVector3Array vertices0 = arrays0[Mesh::ARRAY_VERTEX];
+	const PackedVector3Array vertices1 = arrays1[Mesh::ARRAY_VERTEX];
+	const PackedInt32Array indices0 = arrays0[Mesh::ARRAY_INDEX];
+	const PackedInt32Array indices1 = arrays1[Mesh::ARRAY_INDEX];
+	const PackedVector3Array merged_vertices = merged_arrays[Mesh::ARRAY_VERTEX];
+	const PackedInt32Array merged_indices = merged_arrays[Mesh::ARRAY_INDEX];
+	const PackedColorArray merged_colors = merged_arrays[Mesh::ARRAY_COLOR];
+
+	ZN_TEST_ASSERT(merged_vertices.size() == vertices0.size() + vertices1.size());
+	ZN_TEST_ASSERT(merged_indices.size() == indices0.size() + indices1.size());
+	ZN_TEST_ASSERT(merged_colors.size() == merged_vertices.size());
+
+	// Triangles of each block must be found at the same place, with vertices of the second block moved
+	for (int i = 0; i < indices0.size(); ++i) {
+		ZN_TEST_ASSERT(merged_vertices[merged_indices[i]] == vertices0[indices0[i]]);
+	}
+	for (int i = 0; i < indices1.size(); ++i) {
+		const Vector3 v = merged_vertices[merged_indices[indices0.size() + i]];
+		ZN_TEST_ASSERT(v.is_equal_approx(vertices1[indices1[i]] + offset1));
+	}
+
+	// Surfaces with different vertex formats can't be merged
+	Array arrays1_without_colors = arrays1.duplicate();
+	arrays1_without_colors[Mesh::ARRAY_COLOR] = Variant();
+	inputs[1].surfaces[VoxelMesherCubes::MATERIAL_OPAQUE].arrays = arrays1_without_colors;
+	ZN_TEST_ASSERT(merge_mesh_cluster_surfaces(to_span(inputs), merged_surfaces) == false);
+	ZN_TEST_ASSERT(merged_surfaces.size() == 0);
+}
+
 } // namespace zylann::voxel::tests
@@ -4,6 +4,10 @@
 namespace zylann::voxel::tests {
 
 void test_voxel_mesher_cubes();
+void test_voxel_mesher_cubes_occluder_boxes();
+void test_voxel_mesher_cubes_palette_indexed();
+void test_voxel_mesher_cubes_mesh_optimization();
+void test_voxel_mesher_cubes_mesh_cluster_merge();
 
 } // namespace zylann::voxel::tests
 
@@ -0,0 +1,163 @@
+#include "test_voxel_mesher_transvoxel.h"
+#include "../../meshers/transvoxel/transvoxel.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../util/math/conv.h"
+#include "../testing.h"
+#include <cstring>
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+float get_test_sdf(Vector3i pos, unsigned int shape) {
+	const Vector3f p = to_vec3f(pos);
+	switch (shape) {
+		case 0:
+			// Sphere centered on a corner of the block, so the surface crosses padding on the negative sides
+			return math::length(p) - 10.f;
+		case 1:
+			// Tilted plane crossing the whole block, including padding on all sides
+			return p.y - 0.5f * p.x - 0.25f * p.z - 4.f;
+		default:
+			// Wavy surface with many cells crossing the isolevel
+			return Math::sin(0.7f * p.x) * Math::cos(0.5f * p.z) * 3.f + Math::sin(0.3f * p.y) * 2.f;
+	}
+}
+
+// Block size is without padding
+void make_test_voxels(VoxelBuffer &voxels, Vector3i block_size, VoxelBuffer::Depth depth, unsigned int shape) {
+	const int padding = transvoxel::MIN_PADDING + transvoxel::MAX_PADDING;
+	voxels.create(block_size + Vector3iUtil::create(padding));
+	voxels.set_channel_depth(VoxelBuffer::CHANNEL_SDF, depth);
+
+	// Positions are relative to the origin of the block, padding is on the negative side
+	const Vector3i origin = -Vector3iUtil::create(transvoxel::MIN_PADDING);
+	Box3i(Vector3i(), voxels.get_size()).for_each_cell([&voxels, origin, shape](Vector3i pos) {
+		voxels.set_voxel_f(get_test_sdf(origin + pos, shape), pos, VoxelBuffer::CHANNEL_SDF);
+	});
+}
+
+template <typename T>
+bool spans_equal(const StdVector<T> &a, const StdVector<T> &b) {
+	// Reference paths must produce exactly the same geometry, so it is fine to compare floats bitwise
+	return a.size() == b.size() && (a.size() == 0 || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+bool mesh_arrays_equal(const transvoxel::MeshArrays &a, const transvoxel::MeshArrays &b) {
+	return spans_equal(a.vertices, b.vertices) && spans_equal(a.normals, b.normals) &&
+			spans_equal(a.lod_data, b.lod_data) && spans_equal(a.indices, b.indices);
+}
+
+void build_test_mesh(
+		const VoxelBuffer &voxels,
+		unsigned int lod_index,
+		transvoxel::ReferenceOptions reference_options,
+		transvoxel::MeshArrays &out
+) {
+	transvoxel::Cache cache;
+	out.clear();
+	transvoxel::build_regular_mesh(
+			voxels,
+			VoxelBuffer::CHANNEL_SDF,
+			lod_index,
+			transvoxel::TEXTURES_NONE,
+			cache,
+			out,
+			nullptr,
+			0.f,
+			false,
+			reference_options
+	);
+}
+
+} // namespace
+
+void test_voxel_mesher_transvoxel_sign_bits_prepass() {
+	// Finding cells crossing the isolevel with the sign bits pre-pass must give the same mesh as checking corners of
+	// each cell
+
+	FixedArray<int, 2> block_sizes;
+	block_sizes[0] = 16;
+	// More than 64 voxels along Y, so sign bits span multiple words per column
+	block_sizes[1] = 64;
+
+	FixedArray<VoxelBuffer::Depth, 3> depths;
+	depths[0] = VoxelBuffer::DEPTH_8_BIT;
+	depths[1] = VoxelBuffer::DEPTH_16_BIT;
+	depths[2] = VoxelBuffer::DEPTH_32_BIT;
+
+	transvoxel::ReferenceOptions reference_options;
+	reference_options.check_cell_corners = true;
+
+	transvoxel::MeshArrays reference_arrays;
+	transvoxel::MeshArrays prepass_arrays;
+
+	for (const int block_size : block_sizes) {
+		for (const VoxelBuffer::Depth depth : depths) {
+			for (unsigned int shape = 0; shape < 3; ++shape) {
+				VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_DEFAULT);
+				make_test_voxels(voxels, Vector3iUtil::create(block_size), depth, shape);
+
+				for (unsigned int lod_index = 0; lod_index < 4; ++lod_index) {
+					build_test_mesh(voxels, lod_index, reference_options, reference_arrays);
+					build_test_mesh(voxels, lod_index, transvoxel::ReferenceOptions(), prepass_arrays);
+
+					ZN_TEST_ASSERT(reference_arrays.vertices.size() > 0);
+					ZN_TEST_ASSERT(mesh_arrays_equal(reference_arrays, prepass_arrays));
+				}
+			}
+		}
+	}
+}
+
+void test_voxel_mesher_transvoxel_corner_gradient_cache() {
+	// Taking gradients of corners from the cache must give the same normals as computing them for every cell.
+	// The cache only keeps two decks of corners along Z, and indexes them with the size of the block, so blocks have
+	// several decks and different sizes on each axis.
+
+	FixedArray<Vector3i, 4> block_sizes;
+	block_sizes[0] = Vector3i(16, 16, 16);
+	block_sizes[1] = Vector3i(8, 24, 16);
+	block_sizes[2] = Vector3i(32, 8, 12);
+	// Fewer decks than the other sizes, with columns longer than 64 voxels
+	block_sizes[3] = Vector3i(12, 70, 5);
+
+	transvoxel::ReferenceOptions reference_options;
+	reference_options.compute_all_corner_gradients = true;
+
+	transvoxel::MeshArrays reference_arrays;
+	transvoxel::MeshArrays cached_arrays;
+	transvoxel::Cache cache;
+
+	for (const Vector3i block_size : block_sizes) {
+		for (unsigned int shape = 0; shape < 3; ++shape) {
+			VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_DEFAULT);
+			make_test_voxels(voxels, block_size, VoxelBuffer::DEPTH_16_BIT, shape);
+
+			for (unsigned int lod_index = 0; lod_index < 2; ++lod_index) {
+				build_test_mesh(voxels, lod_index, reference_options, reference_arrays);
+
+				// The same cache is used for all sizes, like meshing threads do, so gradients left from a previous
+				// block must not be reused
+				cached_arrays.clear();
+				transvoxel::build_regular_mesh(
+						voxels,
+						VoxelBuffer::CHANNEL_SDF,
+						lod_index,
+						transvoxel::TEXTURES_NONE,
+						cache,
+						cached_arrays,
+						nullptr,
+						0.f,
+						false
+				);
+
+				ZN_TEST_ASSERT(reference_arrays.vertices.size() > 0);
+				ZN_TEST_ASSERT(reference_arrays.normals.size() == reference_arrays.vertices.size());
+				ZN_TEST_ASSERT(mesh_arrays_equal(reference_arrays, cached_arrays));
+			}
+		}
+	}
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,11 @@
+#ifndef VOXEL_TESTS_VOXEL_MESHER_TRANSVOXEL_H
+#define VOXEL_TESTS_VOXEL_MESHER_TRANSVOXEL_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_mesher_transvoxel_sign_bits_prepass();
+void test_voxel_mesher_transvoxel_corner_gradient_cache();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TESTS_VOXEL_MESHER_TRANSVOXEL_H
@@ -0,0 +1,67 @@
+#include "test_voxel_pre_generation_job.h"
+#include "../../generators/simple/voxel_generator_flat.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../streams/voxel_pre_generation_job.h"
+#include "../../streams/voxel_stream_memory.h"
+#include "../../util/godot/classes/os.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_voxel_pre_generation_job() {
+	Ref<VoxelGeneratorFlat> generator;
+	generator.instantiate();
+	generator->set_height(3.f);
+
+	Ref<VoxelStreamMemory> stream;
+	stream.instantiate();
+
+	Ref<VoxelPreGenerationJob> job;
+	job.instantiate();
+	job->set_generator(generator);
+	job->set_stream(stream);
+	// Not aligned to blocks, so it gets expanded to 4x1x2 blocks at LOD 0, and 2x1x1 blocks at LOD 1
+	job->set_area_min(Vector3i(-20, 0, 0));
+	job->set_area_max(Vector3i(20, 10, 20));
+	job->set_lod_max(1);
+
+	auto wait_for_job = [&job]() {
+		while (job->is_running()) {
+			OS::get_singleton()->delay_usec(1000);
+		}
+	};
+
+	job->start();
+	wait_for_job();
+
+	ZN_TEST_ASSERT(job->get_total_block_count() == 10);
+	ZN_TEST_ASSERT(job->get_generated_block_count() == 10);
+	ZN_TEST_ASSERT(job->get_skipped_block_count() == 0);
+	ZN_TEST_ASSERT(job->get_progress() == 1.f);
+
+	// Blocks must have been saved with what the generator produces
+	{
+		VoxelBuffer expected(VoxelBuffer::ALLOCATOR_DEFAULT);
+		expected.create(Vector3i(16, 16, 16));
+		VoxelGenerator::VoxelQueryData gq{ expected, Vector3i(-32, 0, 0), 1 };
+		generator->generate_block(gq);
+
+		VoxelBuffer saved(VoxelBuffer::ALLOCATOR_DEFAULT);
+		saved.create(Vector3i(16, 16, 16));
+		VoxelStream::VoxelQueryData sq{ saved, Vector3i(-1, 0, 0), 1, VoxelStream::RESULT_ERROR };
+		stream->load_voxel_block(sq);
+		ZN_TEST_ASSERT(sq.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(saved.equals(expected));
+	}
+
+	// Running the job again over a larger area only generates missing blocks
+	job->set_area_max(Vector3i(20, 10, 40));
+	job->start();
+	wait_for_job();
+
+	ZN_TEST_ASSERT(job->get_total_block_count() == 16);
+	ZN_TEST_ASSERT(job->get_generated_block_count() == 6);
+	ZN_TEST_ASSERT(job->get_skipped_block_count() == 10);
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_VOXEL_PRE_GENERATION_JOB_H
+#define VOXEL_TEST_VOXEL_PRE_GENERATION_JOB_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_pre_generation_job();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_VOXEL_PRE_GENERATION_JOB_H
@@ -0,0 +1,180 @@
+#include "test_voxel_stream_cache.h"
+#include "../../streams/voxel_stream_cache.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/thread/thread.h"
+#include "../testing.h"
+#include <atomic>
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+const Vector3i BLOCK_SIZE(4, 4, 4);
+
+Vector3i get_block_position(unsigned int i) {
+	return Vector3i(i % 8, (i / 8) % 8, i / 64);
+}
+
+void save_block(VoxelStreamCache &cache, Vector3i position, uint64_t value) {
+	VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_DEFAULT);
+	voxels.create(BLOCK_SIZE);
+	voxels.fill(value, VoxelBuffer::CHANNEL_TYPE);
+	cache.save_voxel_block(position, 0, voxels);
+}
+
+// Returns 0 if the block is not found
+uint64_t load_block(VoxelStreamCache &cache, Vector3i position) {
+	VoxelBuffer voxels(VoxelBuffer::ALLOCATOR_DEFAULT);
+	if (!cache.load_voxel_block(position, 0, voxels)) {
+		return 0;
+	}
+	return voxels.get_voxel(Vector3i(), VoxelBuffer::CHANNEL_TYPE);
+}
+
+// Flushes the cache and returns the value of every saved block
+StdUnorderedMap<Vector3i, uint64_t> flush(VoxelStreamCache &cache) {
+	StdUnorderedMap<Vector3i, uint64_t> saved_blocks;
+	cache.flush(
+			[&saved_blocks](const VoxelStreamCache::Block &block) {
+				ZN_TEST_ASSERT(block.has_voxels);
+				ZN_TEST_ASSERT(saved_blocks.find(block.position) == saved_blocks.end());
+				saved_blocks[block.position] = block.voxels.get_voxel(Vector3i(), VoxelBuffer::CHANNEL_TYPE);
+			},
+			[]() {}
+	);
+	return saved_blocks;
+}
+
+} // namespace
+
+void test_voxel_stream_cache_flush_concurrent() {
+	const unsigned int block_count = 64;
+
+	{
+		// Loads and saves done by another thread while blocks are being flushed
+		VoxelStreamCache cache;
+
+		for (unsigned int i = 0; i < block_count; ++i) {
+			save_block(cache, get_block_position(i), i + 1);
+		}
+		ZN_TEST_ASSERT(cache.get_indicative_block_count() == block_count);
+
+		struct Context {
+			VoxelStreamCache *cache;
+			unsigned int block_count;
+			std::atomic_bool done = { false };
+			std::atomic_bool loaded_all = { false };
+		};
+		Context ctx;
+		ctx.cache = &cache;
+		ctx.block_count = block_count;
+
+		Thread thread;
+		bool thread_started = false;
+
+		StdUnorderedMap<Vector3i, uint64_t> saved_blocks;
+		cache.flush(
+				[&](const VoxelStreamCache::Block &block) {
+					if (!thread_started) {
+						// Run the thread while the flush is in progress, and wait for it before saving blocks
+						thread_started = true;
+						thread.start(
+								[](void *userdata) {
+									Context &ctx = *static_cast<Context *>(userdata);
+									VoxelStreamCache &cache = *ctx.cache;
+									bool loaded_all = true;
+									// Blocks being flushed can still be loaded
+									for (unsigned int i = 0; i < ctx.block_count; ++i) {
+										if (load_block(cache, get_block_position(i)) != i + 1) {
+											loaded_all = false;
+										}
+									}
+									ctx.loaded_all = loaded_all;
+									// Overwrite a block being flushed, and add new ones
+									save_block(cache, get_block_position(0), 1000);
+									for (unsigned int i = ctx.block_count; i < 2 * ctx.block_count; ++i) {
+										save_block(cache, get_block_position(i), i + 1);
+									}
+									ctx.done = true;
+								},
+								&ctx
+						);
+						while (ctx.done == false) {
+							Thread::sleep_usec(1000);
+						}
+					}
+					ZN_TEST_ASSERT(saved_blocks.find(block.position) == saved_blocks.end());
+					saved_blocks[block.position] = block.voxels.get_voxel(Vector3i(), VoxelBuffer::CHANNEL_TYPE);
+				},
+				[&cache]() {
+					// The most recent version of a block is loaded, even if an older one is still being flushed
+					ZN_TEST_ASSERT(load_block(cache, get_block_position(0)) == 1000);
+				}
+		);
+		thread.wait_to_finish();
+
+		ZN_TEST_ASSERT(ctx.loaded_all);
+
+		// Only blocks present when the flush started were saved
+		ZN_TEST_ASSERT(saved_blocks.size() == block_count);
+		for (unsigned int i = 0; i < block_count; ++i) {
+			auto it = saved_blocks.find(get_block_position(i));
+			ZN_TEST_ASSERT(it != saved_blocks.end());
+			ZN_TEST_ASSERT(it->second == i + 1);
+		}
+
+		// Blocks saved during the flush are still cached and counted
+		ZN_TEST_ASSERT(cache.get_indicative_block_count() == block_count + 1);
+		ZN_TEST_ASSERT(load_block(cache, get_block_position(0)) == 1000);
+		ZN_TEST_ASSERT(load_block(cache, get_block_position(1)) == 0);
+		for (unsigned int i = block_count; i < 2 * block_count; ++i) {
+			ZN_TEST_ASSERT(load_block(cache, get_block_position(i)) == i + 1);
+		}
+
+		saved_blocks = flush(cache);
+		ZN_TEST_ASSERT(saved_blocks.size() == block_count + 1);
+		ZN_TEST_ASSERT(saved_blocks[get_block_position(0)] == 1000);
+		ZN_TEST_ASSERT(cache.get_indicative_block_count() == 0);
+	}
+	{
+		// Saves keep happening on another thread while flushing repeatedly. The block count must always match the
+		// number of blocks the next flush finds.
+		VoxelStreamCache cache;
+
+		struct Context {
+			VoxelStreamCache *cache;
+			unsigned int block_count;
+			std::atomic_bool stop = { false };
+		};
+		Context ctx;
+		ctx.cache = &cache;
+		ctx.block_count = block_count;
+
+		Thread thread;
+		thread.start(
+				[](void *userdata) {
+					Context &ctx = *static_cast<Context *>(userdata);
+					unsigned int i = 0;
+					while (ctx.stop == false) {
+						save_block(*ctx.cache, get_block_position(i % ctx.block_count), i + 1);
+						++i;
+					}
+				},
+				&ctx
+		);
+
+		for (unsigned int i = 0; i < 200; ++i) {
+			flush(cache);
+		}
+
+		ctx.stop = true;
+		thread.wait_to_finish();
+
+		const unsigned int count = cache.get_indicative_block_count();
+		const StdUnorderedMap<Vector3i, uint64_t> saved_blocks = flush(cache);
+		ZN_TEST_ASSERT(saved_blocks.size() == count);
+		ZN_TEST_ASSERT(cache.get_indicative_block_count() == 0);
+	}
+}
+
+} // namespace zylann::voxel::tests
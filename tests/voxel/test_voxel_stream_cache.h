@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_VOXEL_STREAM_CACHE_H
+#define VOXEL_TEST_VOXEL_STREAM_CACHE_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_stream_cache_flush_concurrent();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_VOXEL_STREAM_CACHE_H
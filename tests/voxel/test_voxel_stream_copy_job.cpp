@@ -0,0 +1,97 @@
+#include "test_voxel_stream_copy_job.h"
+#include "../../storage/voxel_buffer.h"
+#include "../../streams/log/voxel_stream_log.h"
+#include "../../streams/voxel_stream_copy_job.h"
+#include "../../streams/voxel_stream_memory.h"
+#include "../../util/godot/classes/os.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+void make_test_block(VoxelBuffer &vb, Vector3i bpos, uint8_t lod_index) {
+	vb.create(Vector3i(16, 16, 16));
+	vb.fill(lod_index + 1, VoxelBuffer::CHANNEL_TYPE);
+	// Tells blocks apart
+	vb.set_voxel(100 + bpos.x + 10 * bpos.y + 20 * bpos.z, 1, 2, 3, VoxelBuffer::CHANNEL_TYPE);
+}
+
+void run_job(VoxelStreamCopyJob &job) {
+	job.start();
+	while (job.is_running()) {
+		OS::get_singleton()->delay_usec(1000);
+	}
+}
+
+void check_blocks(VoxelStream &stream, Span<const VoxelStream::BlockKey> keys) {
+	for (const VoxelStream::BlockKey &key : keys) {
+		VoxelBuffer expected(VoxelBuffer::ALLOCATOR_DEFAULT);
+		make_test_block(expected, key.position, key.lod_index);
+
+		VoxelBuffer loaded(VoxelBuffer::ALLOCATOR_DEFAULT);
+		loaded.create(Vector3i(16, 16, 16));
+		VoxelStream::VoxelQueryData q{ loaded, key.position, key.lod_index, VoxelStream::RESULT_ERROR };
+		stream.load_voxel_block(q);
+		ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(loaded.equals(expected));
+	}
+}
+
+} // namespace
+
+void test_voxel_stream_copy_job() {
+	zylann::testing::TestDirectory test_dir;
+	ZN_TEST_ASSERT(test_dir.is_valid());
+
+	const StdVector<VoxelStream::BlockKey> keys = {
+		{ Vector3i(0, 0, 0), 0 }, //
+		{ Vector3i(-1, 2, 3), 0 }, //
+		{ Vector3i(5, -4, 1), 1 }, //
+		{ Vector3i(0, 0, 0), 2 } //
+	};
+
+	Ref<VoxelStreamMemory> memory_stream;
+	memory_stream.instantiate();
+	for (const VoxelStream::BlockKey &key : keys) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		make_test_block(vb, key.position, key.lod_index);
+		VoxelStream::VoxelQueryData q{ vb, key.position, key.lod_index, VoxelStream::RESULT_ERROR };
+		memory_stream->save_voxel_block(q);
+	}
+
+	Ref<VoxelStreamLog> log_stream1;
+	log_stream1.instantiate();
+	log_stream1->set_directory(test_dir.get_path().path_join("log1"));
+
+	Ref<VoxelStreamLog> log_stream2;
+	log_stream2.instantiate();
+	log_stream2->set_directory(test_dir.get_path().path_join("log2"));
+
+	Ref<VoxelStreamCopyJob> job;
+	job.instantiate();
+
+	// The memory stream doesn't store compressed blocks, so they get encoded by the job
+	job->set_source(memory_stream);
+	job->set_destination(log_stream1);
+	run_job(**job);
+
+	ZN_TEST_ASSERT(!job->is_copying_compressed_data());
+	ZN_TEST_ASSERT(job->get_total_block_count() == 4);
+	ZN_TEST_ASSERT(job->get_copied_block_count() == 4);
+	ZN_TEST_ASSERT(job->get_failed_block_count() == 0);
+	ZN_TEST_ASSERT(job->get_progress() == 1.f);
+	check_blocks(**log_stream1, to_span(keys));
+
+	// Between streams storing compressed blocks, data is moved as-is
+	job->set_source(log_stream1);
+	job->set_destination(log_stream2);
+	run_job(**job);
+
+	ZN_TEST_ASSERT(job->is_copying_compressed_data());
+	ZN_TEST_ASSERT(job->get_copied_block_count() == 4);
+	ZN_TEST_ASSERT(job->get_failed_block_count() == 0);
+	check_blocks(**log_stream2, to_span(keys));
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,10 @@
+#ifndef VOXEL_TEST_VOXEL_STREAM_COPY_JOB_H
+#define VOXEL_TEST_VOXEL_STREAM_COPY_JOB_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_stream_copy_job();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_VOXEL_STREAM_COPY_JOB_H
@@ -0,0 +1,97 @@
+#include "test_voxel_stream_memory_cache.h"
+#include "../../streams/voxel_stream_memory.h"
+#include "../../streams/voxel_stream_memory_cache.h"
+#include "../testing.h"
+
+namespace zylann::voxel::tests {
+
+void test_voxel_stream_memory_cache() {
+	Ref<VoxelStreamMemory> backing_stream;
+	backing_stream.instantiate();
+
+	Ref<VoxelStreamMemoryCache> stream;
+	stream.instantiate();
+	stream->set_stream(backing_stream);
+
+	const unsigned int block_count = 32;
+	const Vector3i block_size(16, 16, 16);
+
+	StdVector<VoxelBuffer> blocks;
+	blocks.reserve(block_count);
+	for (unsigned int i = 0; i < block_count; ++i) {
+		VoxelBuffer &vb = blocks.emplace_back(VoxelBuffer::ALLOCATOR_DEFAULT);
+		vb.create(block_size);
+		vb.fill_area(i + 1, Vector3i(0, 0, 0), Vector3i(16, 1 + i % 15, 16), 0);
+		for (unsigned int j = 0; j < 64; ++j) {
+			vb.set_voxel(j, (i + j * 7) % 16, (i * 3 + j) % 16, (j * 5) % 16, 0);
+		}
+	}
+
+	auto get_position = [](unsigned int i) { return Vector3i(i % 4, i / 16, (i / 4) % 4); };
+
+	auto load = [](VoxelStream &stream, Vector3i position, VoxelBuffer &vb) {
+		VoxelStream::VoxelQueryData q{ vb, position, 0, VoxelStream::RESULT_ERROR };
+		stream.load_voxel_block(q);
+		return q.result;
+	};
+
+	for (unsigned int i = 0; i < block_count; ++i) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		blocks[i].copy_to(vb, true);
+		VoxelStream::VoxelQueryData q{ vb, get_position(i), 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+	}
+
+	const int64_t full_usage = stream->get_memory_usage_bytes();
+	ZN_TEST_ASSERT(full_usage > 0);
+
+	// Everything fits in the budget, so nothing got written yet
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(load(**backing_stream, get_position(0), vb) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+	}
+
+	// Use the last blocks, so the first ones remain the least recently used
+	for (unsigned int i = block_count / 2; i < block_count; ++i) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(load(**stream, get_position(i), vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(blocks[i]));
+	}
+
+	// Reducing the budget evicts blocks to the backing stream
+	stream->set_memory_budget_bytes(full_usage / 4);
+	ZN_TEST_ASSERT(stream->get_memory_usage_bytes() <= full_usage / 4);
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(load(**backing_stream, get_position(0), vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(blocks[0]));
+	}
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(
+				load(**backing_stream, get_position(block_count - 1), vb) == VoxelStream::RESULT_BLOCK_NOT_FOUND
+		);
+	}
+
+	// All blocks can still be loaded, either from memory or from the backing stream
+	for (unsigned int i = 0; i < block_count; ++i) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(load(**stream, get_position(i), vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(blocks[i]));
+		ZN_TEST_ASSERT(stream->get_memory_usage_bytes() <= full_usage / 4);
+	}
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(load(**stream, Vector3i(100, 0, 0), vb) == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+	}
+
+	// Flushing writes remaining blocks
+	stream->flush();
+	for (unsigned int i = 0; i < block_count; ++i) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(load(**backing_stream, get_position(i), vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(blocks[i]));
+	}
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,427 @@
+#include "test_voxel_stream_remote.h"
+#include "../../streams/remote/voxel_stream_remote.h"
+#include "../../streams/voxel_block_serializer.h"
+#include "../../streams/voxel_stream_memory.h"
+#include "../../util/containers/fixed_array.h"
+#include "../../util/containers/std_unordered_map.h"
+#include "../../util/containers/std_vector.h"
+#include "../../util/godot/classes/stream_peer_tcp.h"
+#include "../../util/godot/classes/tcp_server.h"
+#include "../../util/io/serialization.h"
+#include "../../util/thread/mutex.h"
+#include "../../util/thread/thread.h"
+#include "../testing.h"
+#include <atomic>
+
+namespace zylann::voxel::tests {
+
+namespace {
+
+// Minimal server implementing `remote_protocol_v0.md` on the loopback interface, storing blocks in memory
+class LoopbackServer {
+public:
+	~LoopbackServer() {
+		stop();
+	}
+
+	bool start() {
+		_server.instantiate();
+		// Trying a few ports in case one is already used
+		for (int port = 19786; port < 19886; ++port) {
+			if (zylann::godot::listen(**_server, port, "127.0.0.1") == OK) {
+				_port = port;
+				_thread.start(thread_func, this);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void stop() {
+		if (_port == 0) {
+			return;
+		}
+		_stop = true;
+		_thread.wait_to_finish();
+		_server->stop();
+		_port = 0;
+	}
+
+	int get_port() const {
+		return _port;
+	}
+
+	// Stores a block as if another client saved it. Returns its new version.
+	uint64_t set_block(Vector3i position, uint8_t lod_index, const VoxelBuffer &voxels) {
+		const BlockSerializer::SerializeResult result = BlockSerializer::serialize_and_compress(voxels);
+		ZN_TEST_ASSERT(result.success);
+		MutexLock lock(_mutex);
+		StoredBlock &block = _blocks[lod_index][position];
+		block.data = result.data;
+		block.version = ++_last_version;
+		return block.version;
+	}
+
+	unsigned int get_sent_block_count() const {
+		return _sent_block_count;
+	}
+
+	unsigned int get_not_modified_count() const {
+		return _not_modified_count;
+	}
+
+	unsigned int get_saved_block_count() const {
+		return _saved_block_count;
+	}
+
+	unsigned int get_accepted_connection_count() const {
+		return _accepted_connection_count;
+	}
+
+private:
+	static const uint32_t PROTOCOL_MAGIC = 0x52584f56;
+	static const unsigned int HANDSHAKE_SIZE = 5;
+	// Command, position and LOD index
+	static const unsigned int REQUEST_HEADER_SIZE = 14;
+
+	struct StoredBlock {
+		StdVector<uint8_t> data;
+		uint64_t version = 0;
+	};
+
+	struct Client {
+		Ref<StreamPeerTCP> peer;
+		StdVector<uint8_t> input;
+		bool handshake_received = false;
+	};
+
+	static void thread_func(void *userdata) {
+		LoopbackServer &server = *static_cast<LoopbackServer *>(userdata);
+		server.run();
+	}
+
+	void run() {
+		StdVector<Client> clients;
+		StdVector<uint8_t> buffer;
+		buffer.resize(4096);
+
+		while (_stop == false) {
+			while (_server->is_connection_available()) {
+				Client client;
+				client.peer = _server->take_connection();
+				clients.push_back(client);
+				++_accepted_connection_count;
+			}
+
+			for (unsigned int i = 0; i < clients.size();) {
+				Client &client = clients[i];
+				client.peer->poll();
+				if (client.peer->get_status() != StreamPeerTCP::STATUS_CONNECTED) {
+					clients[i] = clients.back();
+					clients.pop_back();
+					continue;
+				}
+
+				int received = 0;
+				do {
+					if (zylann::godot::get_partial_data(**client.peer, to_span(buffer), received) != OK) {
+						break;
+					}
+					client.input.insert(client.input.end(), buffer.data(), buffer.data() + received);
+				} while (received > 0);
+
+				if (!client.handshake_received && client.input.size() >= HANDSHAKE_SIZE) {
+					MemoryReader mr(to_span_const(client.input), ENDIANNESS_LITTLE_ENDIAN);
+					ZN_TEST_ASSERT(mr.get_32() == PROTOCOL_MAGIC);
+					ZN_TEST_ASSERT(mr.get_8() == 0);
+					client.input.erase(client.input.begin(), client.input.begin() + HANDSHAKE_SIZE);
+					client.handshake_received = true;
+				}
+
+				if (client.handshake_received) {
+					while (try_process_request(client)) {
+					}
+				}
+
+				++i;
+			}
+
+			Thread::sleep_usec(200);
+		}
+	}
+
+	// Processes the first request received from the client, if it was received entirely
+	bool try_process_request(Client &client) {
+		if (client.input.size() < REQUEST_HEADER_SIZE) {
+			return false;
+		}
+		MemoryReader mr(to_span_const(client.input), ENDIANNESS_LITTLE_ENDIAN);
+		const uint8_t command = mr.get_8();
+		Vector3i position;
+		position.x = static_cast<int32_t>(mr.get_32());
+		position.y = static_cast<int32_t>(mr.get_32());
+		position.z = static_cast<int32_t>(mr.get_32());
+		const uint8_t lod_index = mr.get_8();
+		ZN_TEST_ASSERT(lod_index < constants::MAX_LOD);
+
+		StdVector<uint8_t> response;
+		MemoryWriter mw(response, ENDIANNESS_LITTLE_ENDIAN);
+
+		if (command == 0) {
+			// Load
+			if (client.input.size() < REQUEST_HEADER_SIZE + 8) {
+				return false;
+			}
+			const uint64_t known_version = mr.get_64();
+
+			MutexLock lock(_mutex);
+			const StdUnorderedMap<Vector3i, StoredBlock> &blocks = _blocks[lod_index];
+			auto it = blocks.find(position);
+			if (it == blocks.end()) {
+				mw.store_8(1);
+			} else if (it->second.version == known_version) {
+				mw.store_8(2);
+				++_not_modified_count;
+			} else {
+				const StoredBlock &block = it->second;
+				mw.store_8(0);
+				mw.store_64(block.version);
+				mw.store_32(block.data.size());
+				mw.store_buffer(to_span(block.data));
+				++_sent_block_count;
+			}
+
+		} else {
+			// Save
+			ZN_TEST_ASSERT(command == 1);
+			if (client.input.size() < REQUEST_HEADER_SIZE + 4) {
+				return false;
+			}
+			const uint32_t size = mr.get_32();
+			if (client.input.size() < REQUEST_HEADER_SIZE + 4 + size) {
+				return false;
+			}
+
+			MutexLock lock(_mutex);
+			StoredBlock &block = _blocks[lod_index][position];
+			block.data.assign(client.input.begin() + mr.pos, client.input.begin() + mr.pos + size);
+			block.version = ++_last_version;
+			mr.pos += size;
+			mw.store_8(0);
+			mw.store_64(block.version);
+			++_saved_block_count;
+		}
+
+		client.input.erase(client.input.begin(), client.input.begin() + mr.pos);
+		ZN_TEST_ASSERT(zylann::godot::put_data(**client.peer, to_span(response)) == OK);
+		return true;
+	}
+
+	Ref<TCPServer> _server;
+	int _port = 0;
+	Thread _thread;
+	std::atomic_bool _stop = { false };
+
+	FixedArray<StdUnorderedMap<Vector3i, StoredBlock>, constants::MAX_LOD> _blocks;
+	uint64_t _last_version = 0;
+	Mutex _mutex;
+
+	std::atomic_uint32_t _sent_block_count = { 0 };
+	std::atomic_uint32_t _not_modified_count = { 0 };
+	std::atomic_uint32_t _saved_block_count = { 0 };
+	std::atomic_uint32_t _accepted_connection_count = { 0 };
+};
+
+void make_test_block(VoxelBuffer &vb, unsigned int seed) {
+	vb.create(Vector3i(16, 16, 16));
+	vb.fill_area(seed % 7 + 1, Vector3i(0, 0, 0), Vector3i(16, 1 + seed % 15, 16), VoxelBuffer::CHANNEL_TYPE);
+	for (unsigned int j = 0; j < 32; ++j) {
+		vb.set_voxel(seed + j, (seed + j * 7) % 16, (seed * 3 + j) % 16, (j * 5) % 16, VoxelBuffer::CHANNEL_TYPE);
+	}
+}
+
+Vector3i get_block_position(unsigned int i) {
+	return Vector3i(i % 4, i / 16, (i / 4) % 4) - Vector3i(2, 2, 2);
+}
+
+Ref<VoxelStreamRemote> create_stream(const LoopbackServer &server) {
+	Ref<VoxelStreamRemote> stream;
+	stream.instantiate();
+	stream->set_host("127.0.0.1");
+	stream->set_port(server.get_port());
+	stream->set_timeout_msec(5000);
+	return stream;
+}
+
+} // namespace
+
+void test_voxel_stream_remote_batch() {
+	LoopbackServer server;
+	ZN_TEST_ASSERT(server.start());
+
+	Ref<VoxelStreamRemote> stream = create_stream(server);
+	stream->set_max_connections(4);
+
+	// Large enough to be spread over several connections
+	const unsigned int block_count = 40;
+	const unsigned int missing_block_count = 5;
+
+	StdVector<VoxelBuffer> expected_blocks;
+	expected_blocks.reserve(block_count);
+	for (unsigned int i = 0; i < block_count; ++i) {
+		make_test_block(expected_blocks.emplace_back(VoxelBuffer::ALLOCATOR_DEFAULT), i);
+	}
+
+	{
+		StdVector<VoxelBuffer> buffers;
+		StdVector<VoxelStream::VoxelQueryData> queries;
+		buffers.reserve(block_count);
+		queries.reserve(block_count);
+		for (unsigned int i = 0; i < block_count; ++i) {
+			VoxelBuffer &vb = buffers.emplace_back(VoxelBuffer::ALLOCATOR_DEFAULT);
+			expected_blocks[i].copy_to(vb, true);
+			queries.push_back(VoxelStream::VoxelQueryData{ vb, get_block_position(i), 0, VoxelStream::RESULT_ERROR });
+		}
+		stream->save_voxel_blocks(to_span(queries));
+	}
+
+	ZN_TEST_ASSERT(server.get_saved_block_count() == block_count);
+	ZN_TEST_ASSERT(server.get_accepted_connection_count() > 1);
+
+	{
+		StdVector<VoxelBuffer> buffers;
+		StdVector<VoxelStream::VoxelQueryData> queries;
+		buffers.reserve(block_count + missing_block_count);
+		queries.reserve(block_count + missing_block_count);
+		// Missing blocks are interleaved with existing ones
+		unsigned int block_index = 0;
+		for (unsigned int i = 0; i < block_count + missing_block_count; ++i) {
+			VoxelBuffer &vb = buffers.emplace_back(VoxelBuffer::ALLOCATOR_DEFAULT);
+			Vector3i position;
+			if (i % 9 == 4) {
+				position = Vector3i(100, 100, 100 + i);
+			} else {
+				position = get_block_position(block_index);
+				++block_index;
+			}
+			queries.push_back(VoxelStream::VoxelQueryData{ vb, position, 0, VoxelStream::RESULT_ERROR });
+		}
+		ZN_TEST_ASSERT(block_index == block_count);
+
+		stream->load_voxel_blocks(to_span(queries));
+
+		for (const VoxelStream::VoxelQueryData &q : queries) {
+			if (q.position_in_blocks.x == 100) {
+				ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_NOT_FOUND);
+				continue;
+			}
+			ZN_TEST_ASSERT(q.result == VoxelStream::RESULT_BLOCK_FOUND);
+			bool found = false;
+			for (unsigned int i = 0; i < block_count; ++i) {
+				if (get_block_position(i) == q.position_in_blocks) {
+					ZN_TEST_ASSERT(q.voxel_buffer.equals(expected_blocks[i]));
+					found = true;
+					break;
+				}
+			}
+			ZN_TEST_ASSERT(found);
+		}
+	}
+
+	ZN_TEST_ASSERT(server.get_sent_block_count() == block_count);
+
+	// Destroy the client first, so the server sees connections closing
+	stream.unref();
+	server.stop();
+}
+
+void test_voxel_stream_remote_cache_validation() {
+	LoopbackServer server;
+	ZN_TEST_ASSERT(server.start());
+
+	Ref<VoxelStreamMemory> cache_stream;
+	cache_stream.instantiate();
+
+	Ref<VoxelStreamRemote> stream = create_stream(server);
+	stream->set_cache_stream(cache_stream);
+
+	const Vector3i position(1, 2, 3);
+
+	struct L {
+		static VoxelStream::ResultCode load(VoxelStream &stream, Vector3i position, VoxelBuffer &vb) {
+			VoxelStream::VoxelQueryData q{ vb, position, 0, VoxelStream::RESULT_ERROR };
+			stream.load_voxel_block(q);
+			return q.result;
+		}
+	};
+
+	// A block present on the server but not in the cache is transferred, and written to the cache
+	VoxelBuffer vb1(VoxelBuffer::ALLOCATOR_DEFAULT);
+	make_test_block(vb1, 1);
+	server.set_block(position, 0, vb1);
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb1));
+		ZN_TEST_ASSERT(server.get_sent_block_count() == 1);
+	}
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**cache_stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb1));
+	}
+
+	// The server version did not change, so the cached block is used
+	for (unsigned int i = 0; i < 3; ++i) {
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb1));
+	}
+	ZN_TEST_ASSERT(server.get_sent_block_count() == 1);
+	ZN_TEST_ASSERT(server.get_not_modified_count() == 3);
+
+	// The block changed on the server, so it is transferred again and replaces the cached one
+	VoxelBuffer vb2(VoxelBuffer::ALLOCATOR_DEFAULT);
+	make_test_block(vb2, 2);
+	server.set_block(position, 0, vb2);
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb2));
+		ZN_TEST_ASSERT(server.get_sent_block_count() == 2);
+	}
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**cache_stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb2));
+	}
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb2));
+		ZN_TEST_ASSERT(server.get_sent_block_count() == 2);
+		ZN_TEST_ASSERT(server.get_not_modified_count() == 4);
+	}
+
+	// Blocks saved by the client get their version from the server, so they are not transferred back
+	VoxelBuffer vb3(VoxelBuffer::ALLOCATOR_DEFAULT);
+	make_test_block(vb3, 3);
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		vb3.copy_to(vb, true);
+		VoxelStream::VoxelQueryData q{ vb, position, 0, VoxelStream::RESULT_ERROR };
+		stream->save_voxel_block(q);
+	}
+	{
+		VoxelBuffer vb(VoxelBuffer::ALLOCATOR_DEFAULT);
+		ZN_TEST_ASSERT(L::load(**stream, position, vb) == VoxelStream::RESULT_BLOCK_FOUND);
+		ZN_TEST_ASSERT(vb.equals(vb3));
+		ZN_TEST_ASSERT(server.get_sent_block_count() == 2);
+		ZN_TEST_ASSERT(server.get_not_modified_count() == 5);
+	}
+
+	stream.unref();
+	server.stop();
+}
+
+} // namespace zylann::voxel::tests
@@ -0,0 +1,11 @@
+#ifndef VOXEL_TEST_VOXEL_STREAM_REMOTE_H
+#define VOXEL_TEST_VOXEL_STREAM_REMOTE_H
+
+namespace zylann::voxel::tests {
+
+void test_voxel_stream_remote_batch();
+void test_voxel_stream_remote_cache_validation();
+
+} // namespace zylann::voxel::tests
+
+#endif // VOXEL_TEST_VOXEL_STREAM_REMOTE_H
@@ -12,6 +12,17 @@ AStarGrid3D::AStarGrid3D() {
 
 void AStarGrid3D::set_region(Box3i region) {
 	_region = region;
+
+	if (Vector3iUtil::get_volume(region.size) == 0) {
+		_solid_cache_size_in_chunks = Vector3i();
+	} else {
+		const Box3i pages_box = region.downscaled(SOLID_PAGE_SIZE);
+		_solid_cache_origin = pages_box.position << SOLID_PAGE_SIZE_PO2;
+		_solid_cache_size_in_chunks = pages_box.size << SOLID_CHUNKS_PER_PAGE_PO2;
+	}
+	_solid_chunks.resize(Vector3iUtil::get_volume(_solid_cache_size_in_chunks));
+	_solid_chunk_states.resize_no_init(_solid_chunks.size());
+	_solid_chunk_states.fill(false);
 }
 
 void AStarGrid3D::set_agent_size(Vector3f size) {
@@ -36,9 +47,43 @@ float AStarGrid3D::get_max_path_cost() const {
 }
 
 void AStarGrid3D::start(Vector3i from_position, Vector3i target_position) {
+	start_internal(from_position, target_position, _region, false);
+}
+
+void AStarGrid3D::start_in_box(Vector3i from_position, Vector3i target_position, Box3i box) {
+	start_internal(from_position, target_position, box.clipped(_region), false);
+}
+
+void AStarGrid3D::flood(Vector3i from_position, Box3i box) {
+	ZN_PROFILE_SCOPE();
+	start_internal(from_position, from_position, box.clipped(_region), true);
+	while (_is_running) {
+		step();
+	}
+}
+
+bool AStarGrid3D::get_flood_path(Vector3i position, StdVector<Vector3i> &out_path, float &out_cost) const {
+	auto it = _points_map.find(position);
+	if (it == _points_map.end()) {
+		return false;
+	}
+	const uint32_t point_index = it->second;
+	if (point_index != _start_point_index &&
+		_points_pool[point_index].came_from_point_index == Point::NO_CAME_FROM) {
+		// Seen as a neighbor, but could not be reached
+		return false;
+	}
+	reconstruct_path(point_index, out_path);
+	out_cost = _points_pool[point_index].gscore;
+	return true;
+}
+
+void AStarGrid3D::start_internal(Vector3i from_position, Vector3i target_position, Box3i box, bool flood) {
 	clear();
 
 	_target_position = target_position;
+	_search_box = box;
+	_flooding = flood;
 
 	_fitting_offset = Vector3f( //
 			(int(_agent_size.x) & 1) == 1 ? 0.5f : 0.f, //
@@ -46,10 +91,10 @@ void AStarGrid3D::start(Vector3i from_position, Vector3i target_position) {
 			(int(_agent_size.z) & 1) == 1 ? 0.5f : 0.f
 	);
 
-	if (!_region.contains(from_position)) {
+	if (!_search_box.contains(from_position)) {
 		return;
 	}
-	if (!_region.contains(target_position)) {
+	if (!_search_box.contains(target_position)) {
 		return;
 	}
 
@@ -89,8 +134,8 @@ void AStarGrid3D::step() {
 
 	Point current_point = _points_pool[current_point_index];
 
-	if (current_point.position == _target_position) {
-		reconstruct_path(current_point_index);
+	if (!_flooding && current_point.position == _target_position) {
+		reconstruct_path(current_point_index, _path);
 		_is_running = false;
 		return;
 	}
@@ -101,7 +146,7 @@ void AStarGrid3D::step() {
 	_points_pool[current_point_index].in_open_set = false;
 
 	_neighbor_positions.clear();
-	get_neighbor_positions(current_point.position, _neighbor_positions);
+	get_neighbor_positions(current_point.position, _search_box, _neighbor_positions);
 
 	for (const Vector3i npos : _neighbor_positions) {
 		uint32_t neighbor_point_index;
@@ -156,9 +201,46 @@ void AStarGrid3D::step() {
 	}
 }
 
-bool AStarGrid3D::is_solid(Vector3i pos) {
+void AStarGrid3D::load_solid_chunks(Vector3i origin, Span<uint64_t> out_chunks) {
 	// Implemented in subclasses
-	return false;
+	for (uint64_t &chunk : out_chunks) {
+		chunk = 0;
+	}
+}
+
+void AStarGrid3D::load_solid_page(Vector3i page_pos) {
+	ZN_PROFILE_SCOPE();
+
+	const int chunks_per_page = 1 << SOLID_CHUNKS_PER_PAGE_PO2;
+	_solid_page_chunks.resize(chunks_per_page * chunks_per_page * chunks_per_page);
+	load_solid_chunks(_solid_cache_origin + (page_pos << SOLID_PAGE_SIZE_PO2), to_span(_solid_page_chunks));
+
+	const Vector3i page_chunk_origin = page_pos << SOLID_CHUNKS_PER_PAGE_PO2;
+	unsigned int src_index = 0;
+	Vector3i rpos;
+	for (rpos.z = 0; rpos.z < chunks_per_page; ++rpos.z) {
+		for (rpos.x = 0; rpos.x < chunks_per_page; ++rpos.x) {
+			for (rpos.y = 0; rpos.y < chunks_per_page; ++rpos.y, ++src_index) {
+				const unsigned int dst_index =
+						Vector3iUtil::get_zxy_index(page_chunk_origin + rpos, _solid_cache_size_in_chunks);
+				_solid_chunks[dst_index] = _solid_page_chunks[src_index];
+				_solid_chunk_states.set(dst_index);
+			}
+		}
+	}
+}
+
+void AStarGrid3D::clear_solid_cache() {
+	_solid_chunk_states.fill(false);
+}
+
+void AStarGrid3D::invalidate_solid_cache(Box3i voxel_box) {
+	const Box3i chunks_box = Box3i(voxel_box.position - _solid_cache_origin, voxel_box.size)
+									 .downscaled(SOLID_CHUNK_SIZE)
+									 .clipped(_solid_cache_size_in_chunks);
+	chunks_box.for_each_cell_zxy([this](Vector3i cpos) {
+		_solid_chunk_states.unset(Vector3iUtil::get_zxy_index(cpos, _solid_cache_size_in_chunks));
+	});
 }
 
 bool AStarGrid3D::is_ground_close_enough(Vector3i pos) {
@@ -200,6 +282,10 @@ const Vector3i g_directions_2d[8] = {
 } // namespace
 
 void AStarGrid3D::get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_positions) {
+	get_neighbor_positions(pos, _region, out_positions);
+}
+
+void AStarGrid3D::get_neighbor_positions(Vector3i pos, Box3i box, StdVector<Vector3i> &out_positions) {
 	// Implementation specialized for agents walking on top of solid surfaces
 
 	ZN_PROFILE_SCOPE();
@@ -212,7 +298,7 @@ void AStarGrid3D::get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_
 	for (unsigned int dir_index = 0; dir_index < 8; ++dir_index) {
 		const Vector3i npos = pos + g_directions_2d[dir_index];
 
-		if (!_region.contains(npos)) {
+		if (!box.contains(npos)) {
 			continue;
 		}
 
@@ -245,7 +331,7 @@ void AStarGrid3D::get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_
 	if (may_jump) {
 		if (c_below) {
 			const Vector3i npos = pos + Vector3i(0, 1, 0);
-			if (_region.contains(npos)) {
+			if (box.contains(npos)) {
 				out_positions.push_back(npos);
 			}
 		}
@@ -253,7 +339,7 @@ void AStarGrid3D::get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_
 
 	if (c_below == false) {
 		const Vector3i npos = pos - Vector3i(0, 1, 0);
-		if (_region.contains(npos)) {
+		if (box.contains(npos)) {
 			// Fall
 			out_positions.push_back(npos);
 		}
@@ -278,10 +364,10 @@ void AStarGrid3D::get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_
 	}
 }
 
-void AStarGrid3D::reconstruct_path(uint32_t end_point_index) {
+void AStarGrid3D::reconstruct_path(uint32_t end_point_index, StdVector<Vector3i> &out_path) const {
 	ZN_PROFILE_SCOPE();
 
-	_path.clear();
+	out_path.clear();
 
 	unsigned int i = 0;
 	unsigned int point_index = end_point_index;
@@ -291,12 +377,12 @@ void AStarGrid3D::reconstruct_path(uint32_t end_point_index) {
 		ZN_ASSERT_RETURN(came_from_index != Point::NO_CAME_FROM);
 		point_index = came_from_index;
 		const Vector3i pos = _points_pool[point_index].position;
-		_path.push_back(pos);
+		out_path.push_back(pos);
 		++i;
 		ZN_ASSERT_RETURN_MSG(i < 10000, "Too many iterations");
 	}
 
-	std::reverse(_path.begin(), _path.end());
+	std::reverse(out_path.begin(), out_path.end());
 }
 
 bool AStarGrid3D::is_running() const {
@@ -317,6 +403,10 @@ void AStarGrid3D::clear() {
 }
 
 float AStarGrid3D::evaluate_heuristic(Vector3i pos, Vector3i target_pos) const {
+	if (_flooding) {
+		// Visit points in order of distance
+		return 0.f;
+	}
 	const Vector3i diff = target_pos - pos;
 	// Manhattan
 	return Math::abs(diff.x) + Math::abs(diff.y) + Math::abs(diff.z);
@@ -1,6 +1,7 @@
 #ifndef ZN_ASTAR_GRID_3D_H
 #define ZN_ASTAR_GRID_3D_H
 
+#include "../util/containers/dynamic_bitset.h"
 #include "../util/containers/std_unordered_map.h"
 #include "../util/containers/std_vector.h"
 #include "../util/godot/core/sort_array.h"
@@ -35,23 +36,66 @@ public:
 	}
 
 	void start(Vector3i from_position, Vector3i target_position);
+	// Same as `start`, but the search can't go outside of the given box, which must be inside the region.
+	void start_in_box(Vector3i from_position, Vector3i target_position, Box3i box);
 	void step();
 	bool is_running() const;
 	Span<const Vector3i> get_path() const;
 	void clear();
 
+	// Visits all points reachable from a position without going outside of the given box, so paths to many
+	// destinations can be obtained at once with `get_flood_path`. Runs to completion.
+	void flood(Vector3i from_position, Box3i box);
+	// Gets the path to a point visited by the last search, with the same convention as `get_path`.
+	bool get_flood_path(Vector3i position, StdVector<Vector3i> &out_path, float &out_cost) const;
+
+	// Gets positions an agent can move to from the given position in one step
+	void get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_positions);
+
+	// Solidity of voxels is cached as the search reaches them, and is kept between searches until cleared.
+	void clear_solid_cache();
+	void invalidate_solid_cache(Box3i voxel_box);
+
+	static const int SOLID_PAGE_SIZE_PO2 = 4;
+	static const int SOLID_PAGE_SIZE = 1 << SOLID_PAGE_SIZE_PO2;
+
+	inline bool is_solid(Vector3i pos) {
+		if (!_region.contains(pos)) {
+			return false;
+		}
+		const Vector3i gpos = pos - _solid_cache_origin;
+		const Vector3i cpos = gpos >> SOLID_CHUNK_SIZE_PO2;
+		const unsigned int chunk_index = Vector3iUtil::get_zxy_index(cpos, _solid_cache_size_in_chunks);
+		if (!_solid_chunk_states.get(chunk_index)) {
+			load_solid_page(gpos >> SOLID_PAGE_SIZE_PO2);
+		}
+		const Vector3i rpos = gpos & SOLID_CHUNK_SIZE_MASK;
+		const unsigned int bit_index =
+				rpos.y + (rpos.x << SOLID_CHUNK_SIZE_PO2) + (rpos.z << (2 * SOLID_CHUNK_SIZE_PO2));
+		return ((_solid_chunks[chunk_index] >> bit_index) & uint64_t(1)) != 0;
+	}
+
 	// Debug
 
 	void debug_get_visited_points(StdVector<Vector3i> &out_positions) const;
 	bool debug_get_next_step_point(Vector3i &out_pos) const;
 
 protected:
-	virtual bool is_solid(Vector3i pos);
+	static const int SOLID_CHUNK_SIZE_PO2 = 2;
+	static const int SOLID_CHUNK_SIZE = 1 << SOLID_CHUNK_SIZE_PO2;
+	static const int SOLID_CHUNK_SIZE_MASK = SOLID_CHUNK_SIZE - 1;
+	static const int SOLID_CHUNKS_PER_PAGE_PO2 = SOLID_PAGE_SIZE_PO2 - SOLID_CHUNK_SIZE_PO2;
+
+	// Implemented in subclasses. Gets solid bits of a cube of voxels of size `SOLID_PAGE_SIZE`, as chunks of 4x4x4
+	// bits. Chunks and bits within chunks are in ZXY order.
+	virtual void load_solid_chunks(Vector3i origin, Span<uint64_t> out_chunks);
 
 private:
+	void start_internal(Vector3i from_position, Vector3i target_position, Box3i box, bool flood);
+	void load_solid_page(Vector3i page_pos);
 	float evaluate_heuristic(Vector3i pos, Vector3i target_pos) const;
-	void reconstruct_path(uint32_t end_point_index);
-	void get_neighbor_positions(Vector3i pos, StdVector<Vector3i> &out_positions);
+	void reconstruct_path(uint32_t end_point_index, StdVector<Vector3i> &out_path) const;
+	void get_neighbor_positions(Vector3i pos, Box3i box, StdVector<Vector3i> &out_positions);
 	bool is_ground_close_enough(Vector3i pos);
 	bool fits(Vector3f pos, Vector3f agent_extents);
 
@@ -152,6 +196,10 @@ private:
 	float _max_path_cost = 1000.f;
 
 	Box3i _region;
+	// Box the current search can't go out of
+	Box3i _search_box;
+	bool _flooding = false;
+
 	StdVector<Point> _points_pool;
 	PriorityQueue _open_list;
 
@@ -162,6 +210,14 @@ private:
 
 	StdVector<Vector3i> _path;
 	StdVector<Vector3i> _neighbor_positions;
+
+	// Cached 3D bitmap of solid voxels covering the region, aligned to pages
+	StdVector<uint64_t> _solid_chunks;
+	// Tracks which chunks are loaded. They are loaded one page at a time.
+	DynamicBitset _solid_chunk_states;
+	Vector3i _solid_cache_origin;
+	Vector3i _solid_cache_size_in_chunks;
+	StdVector<uint64_t> _solid_page_chunks;
 };
 
 } // namespace zylann
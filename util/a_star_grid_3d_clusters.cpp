@@ -0,0 +1,425 @@
+#include "a_star_grid_3d_clusters.h"
+#include "../util/math/conv.h"
+#include "../util/profiling.h"
+#include <algorithm>
+#include <functional>
+
+namespace zylann {
+
+namespace {
+
+// clang-format off
+const Vector3i g_cluster_directions[10] = {
+	Vector3i(-1, 0, -1),
+	Vector3i(0, 0, -1),
+	Vector3i(1, 0, -1),
+	Vector3i(-1, 0, 0),
+	Vector3i(1, 0, 0),
+	Vector3i(-1, 0, 1),
+	Vector3i(0, 0, 1),
+	Vector3i(1, 0, 1),
+	// Agents only move vertically when jumping or falling straight
+	Vector3i(0, 1, 0),
+	Vector3i(0, -1, 0),
+};
+// clang-format on
+
+const uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+inline float get_move_cost(Vector3i from, Vector3i to) {
+	return math::length(to_vec3f(to - from));
+}
+
+float get_path_cost(Span<const Vector3i> path, Vector3i end) {
+	float cost = 0.f;
+	for (unsigned int i = 1; i < path.size(); ++i) {
+		cost += get_move_cost(path[i - 1], path[i]);
+	}
+	if (path.size() > 0) {
+		cost += get_move_cost(path[path.size() - 1], end);
+	}
+	return cost;
+}
+
+inline float evaluate_heuristic(Vector3i pos, Vector3i target_pos) {
+	const Vector3i diff = target_pos - pos;
+	// Manhattan, like AStarGrid3D
+	return Math::abs(diff.x) + Math::abs(diff.y) + Math::abs(diff.z);
+}
+
+inline bool are_touching(Vector3i a, Vector3i b) {
+	const Vector3i d = a - b;
+	return Math::abs(d.x) <= 1 && Math::abs(d.y) <= 1 && Math::abs(d.z) <= 1;
+}
+
+uint32_t find_root(Span<uint32_t> parents, uint32_t i) {
+	while (parents[i] != i) {
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+	return i;
+}
+
+inline Box3i get_cluster_box(Vector3i cluster_pos, Box3i region) {
+	const int size = AStarGrid3DClusters::CLUSTER_SIZE;
+	return Box3i(cluster_pos * size, Vector3iUtil::create(size)).clipped(region);
+}
+
+inline void append(StdVector<Vector3i> &dst, Span<const Vector3i> src) {
+	dst.insert(dst.end(), src.data(), src.data() + src.size());
+}
+
+bool run_search(AStarGrid3D &grid, Vector3i from_position, Vector3i to_position, Box3i box) {
+	grid.start_in_box(from_position, to_position, box);
+	while (grid.is_running()) {
+		grid.step();
+	}
+	return from_position == to_position || grid.get_path().size() > 0;
+}
+
+} // namespace
+
+bool AStarGrid3DClusters::find_path(
+		AStarGrid3D &grid,
+		Vector3i from_position,
+		Vector3i to_position,
+		StdVector<Vector3i> &out_path
+) {
+	ZN_PROFILE_SCOPE();
+
+	out_path.clear();
+
+	const Box3i region = grid.get_region();
+	if (!region.contains(from_position) || !region.contains(to_position)) {
+		return false;
+	}
+
+	const Vector3i from_cluster_pos = from_position >> CLUSTER_SIZE_PO2;
+	const Vector3i to_cluster_pos = to_position >> CLUSTER_SIZE_PO2;
+
+	if (from_cluster_pos == to_cluster_pos) {
+		// Close enough for a regular search
+		const bool found = run_search(grid, from_position, to_position, region);
+		append(out_path, grid.get_path());
+		return found;
+	}
+
+	_nodes.clear();
+	_nodes_map.clear();
+	_open_list.clear();
+	_segments.clear();
+
+	_nodes.push_back(Node{ from_position, 0.f, evaluate_heuristic(from_position, to_position), NO_NODE, 0, 0 });
+	_nodes_map.insert({ from_position, 0 });
+
+	// Leave the start cluster with a fine search. The cluster is built first because it uses the grid too.
+	{
+		const Cluster &cluster = get_or_build_cluster(grid, from_cluster_pos);
+		grid.flood(from_position, get_cluster_box(from_cluster_pos, region));
+
+		for (const Transition &exit : cluster.exits) {
+			float cost;
+			if (grid.get_flood_path(exit.from, _tmp_path, cost)) {
+				visit(
+						0,
+						exit.to,
+						cost + get_move_cost(exit.from, exit.to),
+						to_position,
+						to_span_const(_tmp_path),
+						Span<const Vector3i>(&exit.from, 1)
+				);
+			}
+		}
+	}
+
+	const float max_cost = grid.get_max_path_cost();
+	const Box3i to_cluster_box = get_cluster_box(to_cluster_pos, region);
+
+	while (_open_list.size() > 0) {
+		std::pop_heap(_open_list.begin(), _open_list.end(), std::greater<std::pair<float, uint32_t>>());
+		const std::pair<float, uint32_t> item = _open_list.back();
+		_open_list.pop_back();
+
+		// Copied because nodes may be added while it is used
+		const uint32_t node_index = item.second;
+		const Node node = _nodes[node_index];
+		if (item.first > node.fscore) {
+			// Outdated entry, the node was reached with a lower cost since
+			continue;
+		}
+
+		if (node.position == to_position) {
+			// Reconstruct path
+			static thread_local StdVector<uint32_t> tls_node_indices;
+			tls_node_indices.clear();
+			for (uint32_t i = node_index; i != NO_NODE; i = _nodes[i].came_from_node_index) {
+				tls_node_indices.push_back(i);
+			}
+			for (auto it = tls_node_indices.rbegin(); it != tls_node_indices.rend(); ++it) {
+				const Node &path_node = _nodes[*it];
+				append(
+						out_path,
+						to_span_from_position_and_size(_segments, path_node.segment_begin, path_node.segment_size)
+				);
+			}
+			return true;
+		}
+
+		const Vector3i cluster_pos = node.position >> CLUSTER_SIZE_PO2;
+		const Cluster &cluster = get_or_build_cluster(grid, cluster_pos);
+
+		if (cluster_pos == to_cluster_pos) {
+			// Try to reach the destination within its cluster
+			if (run_search(grid, node.position, to_position, to_cluster_box)) {
+				Span<const Vector3i> path = grid.get_path();
+				visit(
+						node_index,
+						to_position,
+						node.gscore + get_path_cost(path, to_position),
+						to_position,
+						path,
+						Span<const Vector3i>()
+				);
+			}
+		}
+
+		const auto entry_it = std::find(cluster.entries.begin(), cluster.entries.end(), node.position);
+		if (entry_it == cluster.entries.end()) {
+			continue;
+		}
+		const unsigned int entry_index = entry_it - cluster.entries.begin();
+
+		for (const Edge &edge : cluster.edges) {
+			if (edge.entry_index != entry_index) {
+				continue;
+			}
+			const Transition &exit = cluster.exits[edge.exit_index];
+			const float gscore = node.gscore + edge.cost + get_move_cost(exit.from, exit.to);
+			if (gscore >= max_cost) {
+				continue;
+			}
+			visit(
+					node_index,
+					exit.to,
+					gscore,
+					to_position,
+					to_span_from_position_and_size(cluster.paths, edge.path_begin, edge.path_size),
+					Span<const Vector3i>(&exit.from, 1)
+			);
+		}
+	}
+
+	return false;
+}
+
+void AStarGrid3DClusters::visit(
+		uint32_t from_node_index,
+		Vector3i position,
+		float gscore,
+		Vector3i target_position,
+		Span<const Vector3i> segment_a,
+		Span<const Vector3i> segment_b
+) {
+	uint32_t node_index;
+	auto it = _nodes_map.find(position);
+	if (it != _nodes_map.end()) {
+		node_index = it->second;
+	} else {
+		node_index = _nodes.size();
+		_nodes.push_back(Node{ position, std::numeric_limits<float>::max(), 0.f, NO_NODE, 0, 0 });
+		_nodes_map.insert({ position, node_index });
+	}
+
+	Node &node = _nodes[node_index];
+
+	// Same epsilon as AStarGrid3D
+	const float epsilon = 0.001f;
+	if (gscore + epsilon >= node.gscore) {
+		return;
+	}
+
+	node.gscore = gscore;
+	node.fscore = gscore + evaluate_heuristic(position, target_position);
+	node.came_from_node_index = from_node_index;
+	node.segment_begin = _segments.size();
+	node.segment_size = segment_a.size() + segment_b.size();
+	append(_segments, segment_a);
+	append(_segments, segment_b);
+
+	_open_list.push_back({ node.fscore, node_index });
+	std::push_heap(_open_list.begin(), _open_list.end(), std::greater<std::pair<float, uint32_t>>());
+}
+
+const AStarGrid3DClusters::Cluster &AStarGrid3DClusters::get_or_build_cluster(
+		AStarGrid3D &grid,
+		Vector3i cluster_pos
+) {
+	auto it = _clusters.find(cluster_pos);
+	if (it != _clusters.end()) {
+		return it->second;
+	}
+	// References to elements of the map remain valid when other elements get inserted
+	Cluster &cluster = _clusters[cluster_pos];
+	build_cluster(grid, cluster_pos, cluster);
+	return cluster;
+}
+
+void AStarGrid3DClusters::build_cluster(AStarGrid3D &grid, Vector3i cluster_pos, Cluster &cluster) {
+	ZN_PROFILE_SCOPE();
+
+	StdVector<Transition> incoming;
+
+	for (const Vector3i dir : g_cluster_directions) {
+		const Vector3i neighbor_pos = cluster_pos + dir;
+		find_transitions(grid, cluster_pos, neighbor_pos, cluster.exits);
+		// Computed the same way as the neighbor would, so entries match its exits
+		find_transitions(grid, neighbor_pos, cluster_pos, incoming);
+	}
+
+	for (const Transition &transition : incoming) {
+		if (std::find(cluster.entries.begin(), cluster.entries.end(), transition.to) == cluster.entries.end()) {
+			cluster.entries.push_back(transition.to);
+		}
+	}
+
+	const Box3i box = get_cluster_box(cluster_pos, grid.get_region());
+
+	for (unsigned int entry_index = 0; entry_index < cluster.entries.size(); ++entry_index) {
+		grid.flood(cluster.entries[entry_index], box);
+
+		for (unsigned int exit_index = 0; exit_index < cluster.exits.size(); ++exit_index) {
+			float cost;
+			if (!grid.get_flood_path(cluster.exits[exit_index].from, _tmp_path, cost)) {
+				continue;
+			}
+			Edge edge;
+			edge.entry_index = entry_index;
+			edge.exit_index = exit_index;
+			edge.cost = cost;
+			edge.path_begin = cluster.paths.size();
+			edge.path_size = _tmp_path.size();
+			cluster.edges.push_back(edge);
+			append(cluster.paths, to_span_const(_tmp_path));
+		}
+	}
+}
+
+// Finds moves going from a cluster to another. Only a few are kept: when several moves start from touching positions,
+// the one in the middle represents them.
+void AStarGrid3DClusters::find_transitions(
+		AStarGrid3D &grid,
+		Vector3i from_cluster_pos,
+		Vector3i to_cluster_pos,
+		StdVector<Transition> &out_transitions
+) {
+	const Box3i region = grid.get_region();
+	const Box3i from_box = get_cluster_box(from_cluster_pos, region);
+	const Box3i to_box = get_cluster_box(to_cluster_pos, region);
+	if (Vector3iUtil::get_volume(from_box.size) == 0 || Vector3iUtil::get_volume(to_box.size) == 0) {
+		return;
+	}
+
+	StdVector<Transition> &candidates = _tmp_transitions;
+	candidates.clear();
+
+	// Only positions close to the other cluster can move into it
+	const Box3i border_box = from_box.clipped(to_box.padded(1));
+	border_box.for_each_cell_zxy([this, &grid, &candidates, to_box](Vector3i pos) {
+		if (grid.is_solid(pos)) {
+			return;
+		}
+		_tmp_positions.clear();
+		grid.get_neighbor_positions(pos, _tmp_positions);
+		for (const Vector3i npos : _tmp_positions) {
+			if (to_box.contains(npos)) {
+				candidates.push_back(Transition{ pos, npos });
+			}
+		}
+	});
+
+	if (candidates.size() == 0) {
+		return;
+	}
+
+	// Group moves starting from touching positions
+	static thread_local StdVector<uint32_t> tls_parents;
+	tls_parents.resize(candidates.size());
+	for (uint32_t i = 0; i < tls_parents.size(); ++i) {
+		tls_parents[i] = i;
+	}
+	Span<uint32_t> parents = to_span(tls_parents);
+	for (uint32_t i = 0; i < candidates.size(); ++i) {
+		for (uint32_t j = i + 1; j < candidates.size(); ++j) {
+			if (are_touching(candidates[i].from, candidates[j].from)) {
+				const uint32_t a = find_root(parents, i);
+				const uint32_t b = find_root(parents, j);
+				// The lowest index wins, so results don't depend on the order of unions
+				parents[math::max(a, b)] = math::min(a, b);
+			}
+		}
+	}
+
+	struct Group {
+		Vector3f sum;
+		unsigned int count = 0;
+		uint32_t best_index = NO_NODE;
+		float best_distance_squared = 0.f;
+	};
+	static thread_local StdVector<Group> tls_groups;
+	tls_groups.clear();
+	tls_groups.resize(candidates.size());
+
+	for (uint32_t i = 0; i < candidates.size(); ++i) {
+		Group &group = tls_groups[find_root(parents, i)];
+		group.sum += to_vec3f(candidates[i].from);
+		++group.count;
+	}
+
+	// Pick the move closest to the middle of each group
+	for (uint32_t i = 0; i < candidates.size(); ++i) {
+		Group &group = tls_groups[find_root(parents, i)];
+		const Vector3f center = group.sum / static_cast<float>(group.count);
+		const float distance_squared = math::length_squared(to_vec3f(candidates[i].from) - center);
+		if (group.best_index == NO_NODE || distance_squared < group.best_distance_squared) {
+			group.best_index = i;
+			group.best_distance_squared = distance_squared;
+		}
+	}
+
+	for (uint32_t i = 0; i < candidates.size(); ++i) {
+		if (tls_groups[find_root(parents, i)].best_index == i) {
+			out_transitions.push_back(candidates[i]);
+		}
+	}
+}
+
+void AStarGrid3DClusters::invalidate_area(const AStarGrid3D &grid, Box3i voxel_box) {
+	if (_clusters.size() == 0) {
+		return;
+	}
+
+	// Moves depend on voxels around them, within the size of the agent and how far it can fall
+	const Vector3f agent_size = grid.get_agent_size();
+	const int agent_margin = Math::ceil(math::max(agent_size.x, math::max(agent_size.y, agent_size.z)));
+	const int margin = math::max(grid.get_max_fall_height(), agent_margin) + 1;
+
+	const Box3i clusters_box = voxel_box.padded(margin).downscaled(CLUSTER_SIZE);
+
+	if (Vector3iUtil::get_volume(clusters_box.size) > static_cast<int64_t>(_clusters.size())) {
+		for (auto it = _clusters.begin(); it != _clusters.end();) {
+			if (clusters_box.contains(it->first)) {
+				it = _clusters.erase(it);
+			} else {
+				++it;
+			}
+		}
+	} else {
+		clusters_box.for_each_cell_zxy([this](Vector3i cpos) { _clusters.erase(cpos); });
+	}
+}
+
+void AStarGrid3DClusters::clear() {
+	_clusters.clear();
+}
+
+} // namespace zylann
@@ -0,0 +1,102 @@
+#ifndef ZN_ASTAR_GRID_3D_CLUSTERS_H
+#define ZN_ASTAR_GRID_3D_CLUSTERS_H
+
+#include "a_star_grid_3d.h"
+
+namespace zylann {
+
+// Hierarchical pathfinding on top of AStarGrid3D, for long distance paths.
+// The grid is divided in clusters of 16x16x16 voxels. Each cluster caches the moves crossing its borders, and paths
+// going between them inside the cluster. A search travels across clusters using those cached paths, so fine
+// searches only happen around the start and destination.
+// Paths are not always the shortest, and a path may not be found in rare cases where the only way through a cluster
+// border was not picked as one of its crossings.
+class AStarGrid3DClusters {
+public:
+	static const int CLUSTER_SIZE_PO2 = AStarGrid3D::SOLID_PAGE_SIZE_PO2;
+	static const int CLUSTER_SIZE = 1 << CLUSTER_SIZE_PO2;
+
+	// Finds a path with the same convention as `AStarGrid3D::get_path`. Clusters get built as they are reached.
+	// Returns false if no path was found.
+	bool find_path(AStarGrid3D &grid, Vector3i from_position, Vector3i to_position, StdVector<Vector3i> &out_path);
+
+	// Forgets clusters that can be affected by changes of voxels in the given area. Must be called when voxels are
+	// modified, or when the region or agent settings change.
+	void invalidate_area(const AStarGrid3D &grid, Box3i voxel_box);
+	void clear();
+
+	unsigned int get_cluster_count() const {
+		return _clusters.size();
+	}
+
+private:
+	struct Transition {
+		// Position within the cluster
+		Vector3i from;
+		// Position within a neighbor cluster
+		Vector3i to;
+	};
+
+	struct Edge {
+		// Index of the position in `entries`
+		uint16_t entry_index;
+		// Index of the transition in `exits`
+		uint16_t exit_index;
+		float cost;
+		// Range in `paths`
+		uint32_t path_begin;
+		uint32_t path_size;
+	};
+
+	struct Cluster {
+		// Positions where moves coming from neighbor clusters arrive
+		StdVector<Vector3i> entries;
+		// Moves leaving the cluster
+		StdVector<Transition> exits;
+		// Paths from entries to exits, sorted by entry
+		StdVector<Edge> edges;
+		StdVector<Vector3i> paths;
+	};
+
+	struct Node {
+		Vector3i position;
+		float gscore;
+		float fscore;
+		uint32_t came_from_node_index;
+		// Range in `_segments` leading from the previous node to this one
+		uint32_t segment_begin;
+		uint32_t segment_size;
+	};
+
+	const Cluster &get_or_build_cluster(AStarGrid3D &grid, Vector3i cluster_pos);
+	void build_cluster(AStarGrid3D &grid, Vector3i cluster_pos, Cluster &cluster);
+	void find_transitions(
+			AStarGrid3D &grid,
+			Vector3i from_cluster_pos,
+			Vector3i to_cluster_pos,
+			StdVector<Transition> &out_transitions
+	);
+	void visit(
+			uint32_t from_node_index,
+			Vector3i position,
+			float gscore,
+			Vector3i target_position,
+			Span<const Vector3i> segment_a,
+			Span<const Vector3i> segment_b
+	);
+
+	StdUnorderedMap<Vector3i, Cluster> _clusters;
+
+	// Search state, kept to reuse memory
+	StdVector<Node> _nodes;
+	StdUnorderedMap<Vector3i, uint32_t> _nodes_map;
+	StdVector<std::pair<float, uint32_t>> _open_list;
+	StdVector<Vector3i> _segments;
+	StdVector<Vector3i> _tmp_path;
+	StdVector<Vector3i> _tmp_positions;
+	StdVector<Transition> _tmp_transitions;
+};
+
+} // namespace zylann
+
+#endif // ZN_ASTAR_GRID_3D_CLUSTERS_H
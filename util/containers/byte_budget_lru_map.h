@@ -0,0 +1,100 @@
+#ifndef ZN_BYTE_BUDGET_LRU_MAP_H
+#define ZN_BYTE_BUDGET_LRU_MAP_H
+
+#include "../profiling.h"
+#include "std_unordered_map.h"
+#include "std_vector.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace zylann {
+
+// Map where each value has a size in bytes, and where the least recently used values can be dropped when their total
+// size exceeds a budget. Meant for caches holding values of varying sizes.
+// Not thread-safe.
+template <typename TKey, typename TValue, typename THasher = std::hash<TKey>>
+class ByteBudgetLRUMap {
+public:
+	// Gets the value associated to the key and marks it as used. Returns null if not found.
+	TValue *get(const TKey &key) {
+		auto it = _entries.find(key);
+		if (it == _entries.end()) {
+			return nullptr;
+		}
+		Entry &entry = it->second;
+		entry.last_used_time = ++_time;
+		return &entry.value;
+	}
+
+	// Adds or replaces the value associated to the key, and marks it as used.
+	// Doesn't evict anything, `evict` should be called after.
+	void set(const TKey &key, TValue value, uint64_t size_in_bytes) {
+		auto it = _entries.find(key);
+		if (it != _entries.end()) {
+			_memory_usage -= it->second.size_in_bytes;
+			it->second = Entry{ std::move(value), size_in_bytes, ++_time };
+		} else {
+			_entries.insert({ key, Entry{ std::move(value), size_in_bytes, ++_time } });
+		}
+		_memory_usage += size_in_bytes;
+	}
+
+	// Drops least recently used values if memory usage exceeds the budget.
+	void evict(uint64_t budget) {
+		if (_memory_usage <= budget) {
+			return;
+		}
+		ZN_PROFILE_SCOPE();
+
+		// Evicting more than necessary, so sorting doesn't have to happen every time a value is added
+		const uint64_t target = budget - budget / 4;
+
+		using Iterator = typename Map::iterator;
+		StdVector<Iterator> sorted_entries;
+		sorted_entries.reserve(_entries.size());
+		for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+			sorted_entries.push_back(it);
+		}
+		std::sort(sorted_entries.begin(), sorted_entries.end(), [](const Iterator &a, const Iterator &b) {
+			return a->second.last_used_time < b->second.last_used_time;
+		});
+
+		for (Iterator it : sorted_entries) {
+			if (_memory_usage <= target) {
+				break;
+			}
+			_memory_usage -= it->second.size_in_bytes;
+			_entries.erase(it);
+		}
+	}
+
+	void clear() {
+		_entries.clear();
+		_memory_usage = 0;
+	}
+
+	inline unsigned int get_count() const {
+		return _entries.size();
+	}
+
+	inline uint64_t get_memory_usage() const {
+		return _memory_usage;
+	}
+
+private:
+	struct Entry {
+		TValue value;
+		uint64_t size_in_bytes;
+		uint64_t last_used_time;
+	};
+
+	using Map = StdUnorderedMap<TKey, Entry, THasher>;
+
+	Map _entries;
+	uint64_t _memory_usage = 0;
+	uint64_t _time = 0;
+};
+
+} // namespace zylann
+
+#endif // ZN_BYTE_BUDGET_LRU_MAP_H
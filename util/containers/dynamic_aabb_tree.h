@@ -0,0 +1,381 @@
+#ifndef ZN_DYNAMIC_AABB_TREE_H
+#define ZN_DYNAMIC_AABB_TREE_H
+
+#include "../errors.h"
+#include "../math/funcs.h"
+#include "std_vector.h"
+#include <cstdint>
+#include <limits>
+
+#if defined(ZN_GODOT)
+#include <core/math/aabb.h>
+#elif defined(ZN_GODOT_EXTENSION)
+#include <godot_cpp/variant/aabb.hpp>
+using namespace godot;
+#endif
+
+namespace zylann {
+
+// Bounding volume hierarchy of boxes, each associated with a value. Boxes can be added, moved and removed one by one,
+// without rebuilding the whole tree. Leaves are inserted next to the node whose bounds grow the least, and the tree
+// is kept balanced with rotations, so queries remain logarithmic in most cases.
+// Not thread-safe.
+template <typename T>
+class DynamicAABBTree {
+public:
+	static const uint32_t NULL_INDEX = std::numeric_limits<uint32_t>::max();
+
+	// Returns an ID that can be used to update or remove the leaf
+	uint32_t add(const AABB &aabb, const T &value) {
+		const uint32_t leaf_index = allocate_node();
+		Node &leaf = _nodes[leaf_index];
+		leaf.aabb = aabb;
+		leaf.value = value;
+		leaf.height = 0;
+		insert_leaf(leaf_index);
+		++_count;
+		return leaf_index;
+	}
+
+	void remove(uint32_t leaf_index) {
+		ZN_ASSERT_RETURN(is_leaf(leaf_index));
+		remove_leaf(leaf_index);
+		free_node(leaf_index);
+		--_count;
+	}
+
+	void update(uint32_t leaf_index, const AABB &aabb) {
+		ZN_ASSERT_RETURN(is_leaf(leaf_index));
+		if (_nodes[leaf_index].aabb == aabb) {
+			return;
+		}
+		remove_leaf(leaf_index);
+		_nodes[leaf_index].aabb = aabb;
+		insert_leaf(leaf_index);
+	}
+
+	const T &get_value(uint32_t leaf_index) const {
+		ZN_ASSERT(is_leaf(leaf_index));
+		return _nodes[leaf_index].value;
+	}
+
+	const AABB &get_aabb(uint32_t leaf_index) const {
+		ZN_ASSERT(is_leaf(leaf_index));
+		return _nodes[leaf_index].aabb;
+	}
+
+	inline unsigned int count() const {
+		return _count;
+	}
+
+	// Height of the root, 0 if the tree contains one or no leaf
+	int get_height() const {
+		if (_root == NULL_INDEX) {
+			return 0;
+		}
+		return _nodes[_root].height;
+	}
+
+	void clear() {
+		_nodes.clear();
+		_root = NULL_INDEX;
+		_free_head = NULL_INDEX;
+		_count = 0;
+	}
+
+	// Calls `f(const T &value)` for every leaf intersecting the given box. Order is not specified.
+	template <typename F>
+	void query(const AABB &aabb, F f) const {
+		if (_root != NULL_INDEX) {
+			query_recursive(_root, aabb, f);
+		}
+	}
+
+private:
+	struct Node {
+		AABB aabb;
+		// Parent node when used, next free node otherwise
+		uint32_t parent = NULL_INDEX;
+		uint32_t child1 = NULL_INDEX;
+		uint32_t child2 = NULL_INDEX;
+		// Leaves have a height of 0. Free nodes have a height of -1.
+		int32_t height = -1;
+		T value;
+
+		inline bool is_leaf() const {
+			return child1 == NULL_INDEX;
+		}
+	};
+
+	inline bool is_leaf(uint32_t index) const {
+		return index < _nodes.size() && _nodes[index].height == 0;
+	}
+
+	static inline float get_cost(const AABB &aabb) {
+		// Surface area is a good estimate of how likely a box is to be hit by queries
+		const Vector3 s = aabb.size;
+		return s.x * s.y + s.y * s.z + s.z * s.x;
+	}
+
+	template <typename F>
+	void query_recursive(uint32_t index, const AABB &aabb, F &f) const {
+		const Node &node = _nodes[index];
+		if (!node.aabb.intersects(aabb)) {
+			return;
+		}
+		if (node.is_leaf()) {
+			f(node.value);
+		} else {
+			query_recursive(node.child1, aabb, f);
+			query_recursive(node.child2, aabb, f);
+		}
+	}
+
+	uint32_t allocate_node() {
+		if (_free_head != NULL_INDEX) {
+			const uint32_t index = _free_head;
+			Node &node = _nodes[index];
+			_free_head = node.parent;
+			node.parent = NULL_INDEX;
+			node.child1 = NULL_INDEX;
+			node.child2 = NULL_INDEX;
+			return index;
+		}
+		const uint32_t index = _nodes.size();
+		_nodes.push_back(Node());
+		return index;
+	}
+
+	void free_node(uint32_t index) {
+		Node &node = _nodes[index];
+		node.height = -1;
+		node.value = T();
+		node.parent = _free_head;
+		_free_head = index;
+	}
+
+	void insert_leaf(uint32_t leaf_index) {
+		if (_root == NULL_INDEX) {
+			_root = leaf_index;
+			_nodes[leaf_index].parent = NULL_INDEX;
+			return;
+		}
+
+		const AABB leaf_aabb = _nodes[leaf_index].aabb;
+
+		// Find the best sibling
+		uint32_t index = _root;
+		while (!_nodes[index].is_leaf()) {
+			const Node &node = _nodes[index];
+
+			const float cost_here = get_cost(node.aabb);
+			const float combined_cost = get_cost(node.aabb.merge(leaf_aabb));
+
+			// Cost of creating a new parent for this node and the new leaf
+			const float cost = 2.f * combined_cost;
+			// Minimum cost of pushing the leaf further down the tree
+			const float inheritance_cost = 2.f * (combined_cost - cost_here);
+
+			const float cost1 = get_descent_cost(node.child1, leaf_aabb) + inheritance_cost;
+			const float cost2 = get_descent_cost(node.child2, leaf_aabb) + inheritance_cost;
+
+			if (cost < cost1 && cost < cost2) {
+				break;
+			}
+
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		const uint32_t sibling_index = index;
+
+		// Create a new parent
+		const uint32_t old_parent_index = _nodes[sibling_index].parent;
+		const uint32_t new_parent_index = allocate_node();
+		{
+			Node &new_parent = _nodes[new_parent_index];
+			new_parent.parent = old_parent_index;
+			new_parent.aabb = leaf_aabb.merge(_nodes[sibling_index].aabb);
+			new_parent.height = _nodes[sibling_index].height + 1;
+			new_parent.child1 = sibling_index;
+			new_parent.child2 = leaf_index;
+		}
+
+		if (old_parent_index != NULL_INDEX) {
+			Node &old_parent = _nodes[old_parent_index];
+			if (old_parent.child1 == sibling_index) {
+				old_parent.child1 = new_parent_index;
+			} else {
+				old_parent.child2 = new_parent_index;
+			}
+		} else {
+			_root = new_parent_index;
+		}
+
+		_nodes[sibling_index].parent = new_parent_index;
+		_nodes[leaf_index].parent = new_parent_index;
+
+		refit_ancestors(new_parent_index);
+	}
+
+	float get_descent_cost(uint32_t child_index, const AABB &leaf_aabb) const {
+		const Node &child = _nodes[child_index];
+		const float merged_cost = get_cost(leaf_aabb.merge(child.aabb));
+		if (child.is_leaf()) {
+			return merged_cost;
+		}
+		return merged_cost - get_cost(child.aabb);
+	}
+
+	void remove_leaf(uint32_t leaf_index) {
+		if (leaf_index == _root) {
+			_root = NULL_INDEX;
+			return;
+		}
+
+		const uint32_t parent_index = _nodes[leaf_index].parent;
+		const Node &parent = _nodes[parent_index];
+		const uint32_t grand_parent_index = parent.parent;
+		const uint32_t sibling_index = parent.child1 == leaf_index ? parent.child2 : parent.child1;
+
+		// The sibling takes the place of the parent
+		if (grand_parent_index != NULL_INDEX) {
+			Node &grand_parent = _nodes[grand_parent_index];
+			if (grand_parent.child1 == parent_index) {
+				grand_parent.child1 = sibling_index;
+			} else {
+				grand_parent.child2 = sibling_index;
+			}
+			_nodes[sibling_index].parent = grand_parent_index;
+			free_node(parent_index);
+			refit_ancestors(grand_parent_index);
+
+		} else {
+			_root = sibling_index;
+			_nodes[sibling_index].parent = NULL_INDEX;
+			free_node(parent_index);
+		}
+
+		_nodes[leaf_index].parent = NULL_INDEX;
+	}
+
+	// Updates bounds and heights from the given node up to the root, balancing the tree along the way
+	void refit_ancestors(uint32_t index) {
+		while (index != NULL_INDEX) {
+			index = balance(index);
+
+			Node &node = _nodes[index];
+			const Node &child1 = _nodes[node.child1];
+			const Node &child2 = _nodes[node.child2];
+			node.height = 1 + math::max(child1.height, child2.height);
+			node.aabb = child1.aabb.merge(child2.aabb);
+
+			index = node.parent;
+		}
+	}
+
+	void replace_child_of_parent(uint32_t parent_index, uint32_t old_child_index, uint32_t new_child_index) {
+		if (parent_index == NULL_INDEX) {
+			_root = new_child_index;
+			return;
+		}
+		Node &parent = _nodes[parent_index];
+		if (parent.child1 == old_child_index) {
+			parent.child1 = new_child_index;
+		} else {
+			ZN_ASSERT(parent.child2 == old_child_index);
+			parent.child2 = new_child_index;
+		}
+	}
+
+	// Performs a left or right rotation if node A is imbalanced. Returns the index of the node now at the place of A.
+	uint32_t balance(uint32_t a_index) {
+		Node &a = _nodes[a_index];
+		if (a.is_leaf() || a.height < 2) {
+			return a_index;
+		}
+
+		const uint32_t b_index = a.child1;
+		const uint32_t c_index = a.child2;
+		Node &b = _nodes[b_index];
+		Node &c = _nodes[c_index];
+
+		const int32_t balance = c.height - b.height;
+
+		if (balance > 1) {
+			// Rotate C up
+			const uint32_t f_index = c.child1;
+			const uint32_t g_index = c.child2;
+			Node &f = _nodes[f_index];
+			Node &g = _nodes[g_index];
+
+			c.child1 = a_index;
+			c.parent = a.parent;
+			a.parent = c_index;
+			replace_child_of_parent(c.parent, a_index, c_index);
+
+			if (f.height > g.height) {
+				c.child2 = f_index;
+				a.child2 = g_index;
+				g.parent = a_index;
+				a.aabb = b.aabb.merge(g.aabb);
+				c.aabb = a.aabb.merge(f.aabb);
+				a.height = 1 + math::max(b.height, g.height);
+				c.height = 1 + math::max(a.height, f.height);
+			} else {
+				c.child2 = g_index;
+				a.child2 = f_index;
+				f.parent = a_index;
+				a.aabb = b.aabb.merge(f.aabb);
+				c.aabb = a.aabb.merge(g.aabb);
+				a.height = 1 + math::max(b.height, f.height);
+				c.height = 1 + math::max(a.height, g.height);
+			}
+
+			return c_index;
+		}
+
+		if (balance < -1) {
+			// Rotate B up
+			const uint32_t d_index = b.child1;
+			const uint32_t e_index = b.child2;
+			Node &d = _nodes[d_index];
+			Node &e = _nodes[e_index];
+
+			b.child1 = a_index;
+			b.parent = a.parent;
+			a.parent = b_index;
+			replace_child_of_parent(b.parent, a_index, b_index);
+
+			if (d.height > e.height) {
+				b.child2 = d_index;
+				a.child1 = e_index;
+				e.parent = a_index;
+				a.aabb = c.aabb.merge(e.aabb);
+				b.aabb = a.aabb.merge(d.aabb);
+				a.height = 1 + math::max(c.height, e.height);
+				b.height = 1 + math::max(a.height, d.height);
+			} else {
+				b.child2 = e_index;
+				a.child1 = d_index;
+				d.parent = a_index;
+				a.aabb = c.aabb.merge(d.aabb);
+				b.aabb = a.aabb.merge(e.aabb);
+				a.height = 1 + math::max(c.height, d.height);
+				b.height = 1 + math::max(a.height, e.height);
+			}
+
+			return b_index;
+		}
+
+		return a_index;
+	}
+
+	StdVector<Node> _nodes;
+	uint32_t _root = NULL_INDEX;
+	uint32_t _free_head = NULL_INDEX;
+	unsigned int _count = 0;
+};
+
+} // namespace zylann
+
+#endif // ZN_DYNAMIC_AABB_TREE_H
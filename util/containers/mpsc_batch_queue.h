@@ -0,0 +1,129 @@
+#ifndef ZN_MPSC_BATCH_QUEUE_H
+#define ZN_MPSC_BATCH_QUEUE_H
+
+#include "../errors.h"
+#include "../memory/memory.h"
+#include "fixed_array.h"
+#include "span.h"
+#include "std_vector.h"
+#include <atomic>
+
+namespace zylann {
+
+// Lock-free queue where multiple producer threads push batches of items, and a single consumer thread takes all of
+// them at once. Neither side can block the other.
+// Each producer is identified by an index and gets back the batches the consumer is done with, so once warmed up, the
+// queue doesn't allocate memory. Producers only ever take their returned batches all at once, which avoids the ABA
+// problem of lock-free stacks.
+template <typename T, unsigned int MAX_PRODUCERS>
+class MPSCBatchQueue {
+public:
+	~MPSCBatchQueue() {
+		free_list(_pushed.exchange(nullptr));
+		for (Producer &producer : _producers) {
+			free_list(producer.returned.exchange(nullptr));
+			free_list(producer.free);
+			producer.free = nullptr;
+		}
+	}
+
+	// Must only be called by the producer owning the given index, which must be lower than `MAX_PRODUCERS`.
+	void push(unsigned int producer_index, Span<const T> items) {
+		if (items.size() == 0) {
+			return;
+		}
+		ZN_ASSERT(producer_index < MAX_PRODUCERS);
+		Producer &producer = _producers[producer_index];
+
+		if (producer.free == nullptr) {
+			producer.free = producer.returned.exchange(nullptr, std::memory_order_acquire);
+		}
+		Batch *batch = producer.free;
+		if (batch != nullptr) {
+			producer.free = batch->next;
+		} else {
+			batch = ZN_NEW(Batch);
+			batch->producer_index = producer_index;
+		}
+
+		for (const T &item : items) {
+			batch->items.push_back(item);
+		}
+
+		batch->next = _pushed.load(std::memory_order_relaxed);
+		while (!_pushed.compare_exchange_weak(
+				batch->next, batch, std::memory_order_release, std::memory_order_relaxed
+		)) {
+		}
+	}
+
+	// Must only be called by the consumer. Calls `f` on every item pushed so far, in the order batches were pushed.
+	template <typename F>
+	void consume(F f) {
+		// Most recently pushed first
+		Batch *batch = _pushed.exchange(nullptr, std::memory_order_acquire);
+
+		Batch *oldest = nullptr;
+		while (batch != nullptr) {
+			Batch *next = batch->next;
+			batch->next = oldest;
+			oldest = batch;
+			batch = next;
+		}
+
+		batch = oldest;
+		while (batch != nullptr) {
+			Batch *next = batch->next;
+
+			for (T &item : batch->items) {
+				f(item);
+			}
+			batch->items.clear();
+
+			// Give the batch back to its producer
+			Producer &producer = _producers[batch->producer_index];
+			batch->next = producer.returned.load(std::memory_order_relaxed);
+			while (!producer.returned.compare_exchange_weak(
+					batch->next, batch, std::memory_order_release, std::memory_order_relaxed
+			)) {
+			}
+
+			batch = next;
+		}
+	}
+
+	// Result may be outdated by the time it is used if producers are running
+	bool is_empty() const {
+		return _pushed.load(std::memory_order_relaxed) == nullptr;
+	}
+
+private:
+	struct Batch {
+		StdVector<T> items;
+		Batch *next = nullptr;
+		unsigned int producer_index = 0;
+	};
+
+	struct Producer {
+		// Batches given back by the consumer
+		std::atomic<Batch *> returned = { nullptr };
+		// Batches only accessed by the producer
+		Batch *free = nullptr;
+	};
+
+	static void free_list(Batch *batch) {
+		while (batch != nullptr) {
+			Batch *next = batch->next;
+			ZN_DELETE(batch);
+			batch = next;
+		}
+	}
+
+	// Most recently pushed first
+	std::atomic<Batch *> _pushed = { nullptr };
+	FixedArray<Producer, MAX_PRODUCERS> _producers;
+};
+
+} // namespace zylann
+
+#endif // ZN_MPSC_BATCH_QUEUE_H
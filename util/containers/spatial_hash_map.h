@@ -0,0 +1,332 @@
+#ifndef ZN_SPATIAL_HASH_MAP_H
+#define ZN_SPATIAL_HASH_MAP_H
+
+#include "../errors.h"
+#include "../hash_funcs.h"
+#include "../math/vector3i.h"
+#include "../memory/memory.h"
+#include "fixed_array.h"
+#include "std_vector.h"
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace zylann {
+
+// Map of values identified by 3D integer coordinates, using open addressing with Robin Hood probing.
+// Lookups only go through a contiguous array of small buckets, instead of chasing a pointer per node like
+// `std::unordered_map`.
+// Values are stored in fixed-size pages, so pointers to values remain valid when inserting or removing other elements.
+// Iteration goes through pages in order, which is roughly the order in which elements were inserted.
+template <typename T>
+class SpatialHashMap {
+public:
+	SpatialHashMap() {}
+
+	SpatialHashMap(const SpatialHashMap &other) {
+		*this = other;
+	}
+
+	SpatialHashMap(SpatialHashMap &&other) {
+		swap(other);
+	}
+
+	~SpatialHashMap() {
+		clear();
+	}
+
+	SpatialHashMap &operator=(const SpatialHashMap &other) {
+		if (this != &other) {
+			clear();
+			reserve(other.size());
+			other.for_each([this](const Vector3i &key, const T &value) { //
+				get_or_insert(key) = value;
+			});
+		}
+		return *this;
+	}
+
+	SpatialHashMap &operator=(SpatialHashMap &&other) {
+		if (this != &other) {
+			clear();
+			swap(other);
+		}
+		return *this;
+	}
+
+	void swap(SpatialHashMap &other) {
+		_buckets.swap(other._buckets);
+		_slots.swap(other._slots);
+		_free_slots.swap(other._free_slots);
+		_pages.swap(other._pages);
+		std::swap(_bucket_mask, other._bucket_mask);
+		std::swap(_count, other._count);
+	}
+
+	inline unsigned int size() const {
+		return _count;
+	}
+
+	T *find(const Vector3i &key) {
+		const uint32_t bucket_index = find_bucket(key);
+		if (bucket_index == NOT_FOUND) {
+			return nullptr;
+		}
+		return &get_slot_value(_buckets[bucket_index].slot);
+	}
+
+	const T *find(const Vector3i &key) const {
+		const uint32_t bucket_index = find_bucket(key);
+		if (bucket_index == NOT_FOUND) {
+			return nullptr;
+		}
+		return &get_slot_value(_buckets[bucket_index].slot);
+	}
+
+	inline bool has(const Vector3i &key) const {
+		return find_bucket(key) != NOT_FOUND;
+	}
+
+	// Gets the value at the given key, or inserts a default-constructed one if there is none.
+	T &get_or_insert(const Vector3i &key) {
+		const uint32_t bucket_index = find_bucket(key);
+		if (bucket_index != NOT_FOUND) {
+			return get_slot_value(_buckets[bucket_index].slot);
+		}
+		if ((_count + 1) * MAX_LOAD_DENOMINATOR > _buckets.size() * MAX_LOAD_NUMERATOR) {
+			rehash(math::max(MIN_BUCKET_COUNT, static_cast<uint32_t>(2 * _buckets.size())));
+		}
+		const uint32_t slot = allocate_slot(key);
+		insert_bucket(Bucket{ key, slot });
+		++_count;
+		return get_slot_value(slot);
+	}
+
+	// void pre_erase(T &value)
+	template <typename F>
+	bool erase(const Vector3i &key, F pre_erase) {
+		uint32_t bucket_index = find_bucket(key);
+		if (bucket_index == NOT_FOUND) {
+			return false;
+		}
+		const uint32_t slot = _buckets[bucket_index].slot;
+		pre_erase(get_slot_value(slot));
+		free_slot(slot);
+
+		// Shift back following buckets until one is at its ideal position, so no tombstone is needed
+		uint32_t next_index = (bucket_index + 1) & _bucket_mask;
+		while (_buckets[next_index].slot != EMPTY_SLOT &&
+			   get_probe_distance(next_index, _buckets[next_index].key) > 0) {
+			_buckets[bucket_index] = _buckets[next_index];
+			bucket_index = next_index;
+			next_index = (next_index + 1) & _bucket_mask;
+		}
+		_buckets[bucket_index].slot = EMPTY_SLOT;
+
+		--_count;
+		return true;
+	}
+
+	inline bool erase(const Vector3i &key) {
+		return erase(key, [](T &) {});
+	}
+
+	void clear() {
+		for (Page *page : _pages) {
+			ZN_DELETE(page);
+		}
+		_pages.clear();
+		_slots.clear();
+		_free_slots.clear();
+		_buckets.clear();
+		_bucket_mask = 0;
+		_count = 0;
+	}
+
+	// Allocates buckets so the given amount of elements can be stored without rehashing
+	void reserve(unsigned int count) {
+		uint32_t bucket_count = MIN_BUCKET_COUNT;
+		while (count * MAX_LOAD_DENOMINATOR > bucket_count * MAX_LOAD_NUMERATOR) {
+			bucket_count *= 2;
+		}
+		if (bucket_count > _buckets.size()) {
+			rehash(bucket_count);
+		}
+	}
+
+	// void f(const Vector3i &key, T &value)
+	template <typename F>
+	void for_each(F f) {
+		for (uint32_t slot = 0; slot < _slots.size(); ++slot) {
+			const Slot &s = _slots[slot];
+			if (s.used) {
+				f(s.key, get_slot_value(slot));
+			}
+		}
+	}
+
+	// void f(const Vector3i &key, const T &value)
+	template <typename F>
+	void for_each(F f) const {
+		for (uint32_t slot = 0; slot < _slots.size(); ++slot) {
+			const Slot &s = _slots[slot];
+			if (s.used) {
+				f(s.key, get_slot_value(slot));
+			}
+		}
+	}
+
+	// void f(const Vector3i &key)
+	template <typename F>
+	void for_each_key(F f) const {
+		for (const Slot &s : _slots) {
+			if (s.used) {
+				f(s.key);
+			}
+		}
+	}
+
+private:
+	static const uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+	static const uint32_t NOT_FOUND = std::numeric_limits<uint32_t>::max();
+	static const uint32_t MIN_BUCKET_COUNT = 16;
+	// Robin Hood probing keeps probe sequences short even at high load
+	static const uint32_t MAX_LOAD_NUMERATOR = 7;
+	static const uint32_t MAX_LOAD_DENOMINATOR = 8;
+	static const unsigned int PAGE_SIZE_PO2 = 8;
+	static const unsigned int PAGE_SIZE = 1 << PAGE_SIZE_PO2;
+	static const unsigned int PAGE_SIZE_MASK = PAGE_SIZE - 1;
+
+	struct Bucket {
+		Vector3i key;
+		// Index of the value in pages
+		uint32_t slot = EMPTY_SLOT;
+	};
+
+	struct Slot {
+		Vector3i key;
+		bool used = false;
+	};
+
+	struct Page {
+		FixedArray<T, PAGE_SIZE> values;
+	};
+
+	static inline uint32_t hash(const Vector3i &key) {
+		// djb2 as used by `std::hash<Vector3i>` clusters too much for linear probing
+		uint32_t h = hash_murmur3_one_32(key.x);
+		h = hash_murmur3_one_32(key.y, h);
+		h = hash_murmur3_one_32(key.z, h);
+		return hash_fmix32(h);
+	}
+
+	// How far a bucket is from the ideal position of the key it contains
+	inline uint32_t get_probe_distance(uint32_t bucket_index, const Vector3i &key) const {
+		return (bucket_index - hash(key)) & _bucket_mask;
+	}
+
+	inline T &get_slot_value(uint32_t slot) {
+		return _pages[slot >> PAGE_SIZE_PO2]->values[slot & PAGE_SIZE_MASK];
+	}
+
+	inline const T &get_slot_value(uint32_t slot) const {
+		return _pages[slot >> PAGE_SIZE_PO2]->values[slot & PAGE_SIZE_MASK];
+	}
+
+	uint32_t find_bucket(const Vector3i &key) const {
+		if (_count == 0) {
+			return NOT_FOUND;
+		}
+		uint32_t bucket_index = hash(key) & _bucket_mask;
+		for (uint32_t distance = 0;; ++distance) {
+			const Bucket &bucket = _buckets[bucket_index];
+			if (bucket.slot == EMPTY_SLOT) {
+				return NOT_FOUND;
+			}
+			if (bucket.key == key) {
+				return bucket_index;
+			}
+			// Had the key been there, it would have taken the place of a key closer to its ideal position
+			if (get_probe_distance(bucket_index, bucket.key) < distance) {
+				return NOT_FOUND;
+			}
+			bucket_index = (bucket_index + 1) & _bucket_mask;
+		}
+	}
+
+	// The key must not be present already, and there must be at least one empty bucket
+	void insert_bucket(Bucket bucket) {
+		uint32_t bucket_index = hash(bucket.key) & _bucket_mask;
+		uint32_t distance = 0;
+		while (true) {
+			Bucket &other = _buckets[bucket_index];
+			if (other.slot == EMPTY_SLOT) {
+				other = bucket;
+				return;
+			}
+			const uint32_t other_distance = get_probe_distance(bucket_index, other.key);
+			if (other_distance < distance) {
+				// Take the place of keys closer to their ideal position, and carry on inserting them instead
+				std::swap(bucket, other);
+				distance = other_distance;
+			}
+			bucket_index = (bucket_index + 1) & _bucket_mask;
+			++distance;
+		}
+	}
+
+	void rehash(uint32_t bucket_count) {
+#ifdef DEBUG_ENABLED
+		ZN_ASSERT(math::is_power_of_two(bucket_count));
+		ZN_ASSERT(bucket_count > _count);
+#endif
+		StdVector<Bucket> old_buckets;
+		old_buckets.swap(_buckets);
+		_buckets.resize(bucket_count);
+		_bucket_mask = bucket_count - 1;
+		for (const Bucket &bucket : old_buckets) {
+			if (bucket.slot != EMPTY_SLOT) {
+				insert_bucket(bucket);
+			}
+		}
+	}
+
+	uint32_t allocate_slot(const Vector3i &key) {
+		uint32_t slot;
+		if (_free_slots.size() > 0) {
+			slot = _free_slots.back();
+			_free_slots.pop_back();
+		} else {
+			slot = _slots.size();
+			if ((slot & PAGE_SIZE_MASK) == 0) {
+				_pages.push_back(ZN_NEW(Page));
+			}
+			_slots.push_back(Slot());
+		}
+		Slot &s = _slots[slot];
+		s.key = key;
+		s.used = true;
+		return slot;
+	}
+
+	void free_slot(uint32_t slot) {
+		// Release resources held by the value now rather than when the slot gets reused.
+		// Re-constructed in place so values don't need to be assignable (they may contain atomics).
+		T &value = get_slot_value(slot);
+		value.~T();
+		new (&value) T();
+		_slots[slot].used = false;
+		_free_slots.push_back(slot);
+	}
+
+	StdVector<Bucket> _buckets;
+	StdVector<Slot> _slots;
+	StdVector<uint32_t> _free_slots;
+	StdVector<Page *> _pages;
+	uint32_t _bucket_mask = 0;
+	unsigned int _count = 0;
+};
+
+} // namespace zylann
+
+#endif // ZN_SPATIAL_HASH_MAP_H
@@ -2,10 +2,57 @@
 #include "../../containers/std_map.h"
 #include "../../containers/std_unordered_map.h"
 #include "../../containers/std_vector.h"
+#include "../../io/log.h"
 #include "../core/packed_arrays.h"
 
+#if defined(ZN_GODOT)
+#include <core/version.h>
+#endif
+
 namespace zylann::godot {
 
+bool stage_mesh_surface(
+		StagedMeshSurface &out_surface,
+		Mesh::PrimitiveType primitive,
+		const Array &arrays,
+		const Dictionary &lods,
+		uint32_t flags
+) {
+#if defined(ZN_GODOT)
+	const Error err = RenderingServer::get_singleton()->mesh_create_surface_data_from_arrays(
+			&out_surface, static_cast<RenderingServer::PrimitiveType>(primitive), arrays, Array(), lods, flags
+	);
+	return err == OK;
+#else
+	return false;
+#endif
+}
+
+void add_staged_mesh_surface(ArrayMesh &mesh, const StagedMeshSurface &surface) {
+#if defined(ZN_GODOT)
+	mesh.add_surface(
+			surface.format,
+			static_cast<Mesh::PrimitiveType>(surface.primitive),
+			surface.vertex_data,
+			surface.attribute_data,
+			surface.skin_data,
+			surface.vertex_count,
+			surface.index_data,
+			surface.index_count,
+			surface.aabb,
+			surface.blend_shape_data,
+			surface.bone_aabbs,
+			surface.lods
+#if !(VERSION_MAJOR == 4 && VERSION_MINOR <= 1)
+			,
+			surface.uv_scale
+#endif
+	);
+#else
+	ZN_PRINT_ERROR("Staged mesh surfaces are not supported");
+#endif
+}
+
 #ifdef TOOLS_ENABLED
 
 Array generate_debug_seams_wireframe_surface(const ArrayMesh &src_mesh, int surface_index) {
@@ -8,6 +8,8 @@
 using namespace godot;
 #endif
 
+#include "rendering_server.h"
+
 namespace zylann::godot {
 
 // TODO The following functions should be able to work on `Mesh`,
@@ -25,6 +27,28 @@ inline bool is_mesh_empty(const ArrayMesh &mesh) {
 	return false;
 }
 
+#if defined(ZN_GODOT)
+// Surface data formatted in the layout used by the renderer
+using StagedMeshSurface = RenderingServer::SurfaceData;
+#else
+// Not exposed to extensions, surfaces can't be staged
+struct StagedMeshSurface {};
+#endif
+
+// Formats surface arrays the same way `ArrayMesh::add_surface_from_arrays` does, without creating any resource. This
+// can run in any thread, even if the renderer doesn't support creating meshes from threads. Returns false if it failed
+// or isn't supported.
+bool stage_mesh_surface(
+		StagedMeshSurface &out_surface,
+		Mesh::PrimitiveType primitive,
+		const Array &arrays,
+		const Dictionary &lods,
+		uint32_t flags
+);
+
+// Adds a surface formatted by `stage_mesh_surface`. Only the upload to the renderer is left to do.
+void add_staged_mesh_surface(ArrayMesh &mesh, const StagedMeshSurface &surface);
+
 #ifdef TOOLS_ENABLED
 
 // Generates a wireframe-mesh that highlights edges of a triangle-mesh where vertices are not shared.
@@ -1,7 +1,20 @@
 #include "mesh.h"
 
+#if defined(ZN_GODOT)
+#include <core/version.h>
+#endif
+
 namespace zylann::godot {
 
+uint32_t get_mesh_attribute_compression_flags() {
+#if defined(ZN_GODOT) && VERSION_MAJOR == 4 && VERSION_MINOR <= 1
+	// Introduced in Godot 4.2
+	return 0;
+#else
+	return Mesh::ARRAY_FLAG_COMPRESS_ATTRIBUTES;
+#endif
+}
+
 bool is_surface_triangulated(const Array &surface) {
 	PackedVector3Array positions = surface[Mesh::ARRAY_VERTEX];
 	PackedInt32Array indices = surface[Mesh::ARRAY_INDEX];
@@ -20,6 +33,42 @@ bool is_mesh_empty(Span<const Array> surfaces) {
 	return true;
 }
 
+size_t get_surface_size_in_bytes(const Array &surface) {
+	size_t size = 0;
+	for (int i = 0; i < surface.size(); ++i) {
+		const Variant v = surface[i];
+		switch (v.get_type()) {
+			case Variant::PACKED_BYTE_ARRAY:
+				size += PackedByteArray(v).size();
+				break;
+			case Variant::PACKED_INT32_ARRAY:
+				size += PackedInt32Array(v).size() * sizeof(int32_t);
+				break;
+			case Variant::PACKED_INT64_ARRAY:
+				size += PackedInt64Array(v).size() * sizeof(int64_t);
+				break;
+			case Variant::PACKED_FLOAT32_ARRAY:
+				size += PackedFloat32Array(v).size() * sizeof(float);
+				break;
+			case Variant::PACKED_FLOAT64_ARRAY:
+				size += PackedFloat64Array(v).size() * sizeof(double);
+				break;
+			case Variant::PACKED_VECTOR2_ARRAY:
+				size += PackedVector2Array(v).size() * sizeof(Vector2);
+				break;
+			case Variant::PACKED_VECTOR3_ARRAY:
+				size += PackedVector3Array(v).size() * sizeof(Vector3);
+				break;
+			case Variant::PACKED_COLOR_ARRAY:
+				size += PackedColorArray(v).size() * sizeof(Color);
+				break;
+			default:
+				break;
+		}
+	}
+	return size;
+}
+
 void scale_vec3_array(PackedVector3Array &array, float scale) {
 	// Getting raw pointer because between GDExtension and modules, syntax and performance of operator[] differs.
 	Vector3 *array_data = array.ptrw();
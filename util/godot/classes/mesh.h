@@ -17,6 +17,13 @@ namespace zylann::godot {
 bool is_surface_triangulated(const Array &surface);
 bool is_mesh_empty(Span<const Array> surfaces);
 
+// Gets how many bytes are used by the packed arrays of a surface. Other kinds of values are not counted.
+size_t get_surface_size_in_bytes(const Array &surface);
+
+// Flags to use when creating a mesh so its vertex attributes are stored in a compressed format (16-bit positions
+// relative to the mesh bounds, octahedral normals and tangents, 16-bit UVs). Returns 0 if Godot doesn't support it.
+uint32_t get_mesh_attribute_compression_flags();
+
 void scale_vec3_array(PackedVector3Array &array, float scale);
 void offset_vec3_array(PackedVector3Array &array, Vector3 offset);
 void scale_surface(Array &surface, float scale);
@@ -2,10 +2,61 @@
 #define ZN_GODOT_STREAM_PEER_TCP_H
 
 #if defined(ZN_GODOT)
+#include <core/io/ip.h>
 #include <core/io/stream_peer_tcp.h>
 #elif defined(ZN_GODOT_EXTENSION)
 #include <godot_cpp/classes/stream_peer_tcp.hpp>
 using namespace godot;
 #endif
 
+#include "../../containers/span.h"
+#include <cstring>
+
+namespace zylann::godot {
+
+// Starts connecting to a host given either by name or IP address
+inline Error connect_to_host(StreamPeerTCP &peer, const String &host, int port) {
+#if defined(ZN_GODOT)
+	IPAddress ip;
+	if (host.is_valid_ip_address()) {
+		ip = IPAddress(host);
+	} else {
+		ip = IP::get_singleton()->resolve_hostname(host);
+	}
+	if (!ip.is_valid()) {
+		return ERR_CANT_RESOLVE;
+	}
+	return peer.connect_to_host(ip, port);
+#elif defined(ZN_GODOT_EXTENSION)
+	return peer.connect_to_host(host, port);
+#endif
+}
+
+// Sends all the data, blocking until done
+inline Error put_data(StreamPeer &peer, Span<const uint8_t> data) {
+#if defined(ZN_GODOT)
+	return peer.put_data(data.data(), data.size());
+#elif defined(ZN_GODOT_EXTENSION)
+	PackedByteArray bytes;
+	bytes.resize(data.size());
+	memcpy(bytes.ptrw(), data.data(), data.size());
+	return peer.put_data(bytes);
+#endif
+}
+
+// Receives the data currently available, up to the size of `dst`, without blocking
+inline Error get_partial_data(StreamPeer &peer, Span<uint8_t> dst, int &out_received) {
+#if defined(ZN_GODOT)
+	return peer.get_partial_data(dst.data(), dst.size(), out_received);
+#elif defined(ZN_GODOT_EXTENSION)
+	const Array result = peer.get_partial_data(dst.size());
+	const PackedByteArray bytes = result[1];
+	out_received = bytes.size();
+	memcpy(dst.data(), bytes.ptr(), bytes.size());
+	return static_cast<Error>(int(result[0]));
+#endif
+}
+
+} // namespace zylann::godot
+
 #endif // ZN_GODOT_STREAM_PEER_TCP_H
@@ -8,4 +8,17 @@
 using namespace godot;
 #endif
 
+namespace zylann::godot {
+
+// Starts listening on the given port, for connections to the given address (or "*" for any)
+inline Error listen(TCPServer &server, int port, const String &bind_address) {
+#if defined(ZN_GODOT)
+	return server.listen(port, IPAddress(bind_address));
+#elif defined(ZN_GODOT_EXTENSION)
+	return server.listen(port, bind_address);
+#endif
+}
+
+} // namespace zylann::godot
+
 #endif // ZN_GODOT_TCP_SERVER_H
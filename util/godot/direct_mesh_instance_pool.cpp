@@ -0,0 +1,33 @@
+#include "direct_mesh_instance_pool.h"
+#include "../errors.h"
+#include "../profiling.h"
+#include "classes/material.h"
+
+namespace zylann::godot {
+
+DirectMeshInstance DirectMeshInstancePool::allocate() {
+	DirectMeshInstance mi;
+	if (_instances.size() > 0) {
+		mi = std::move(_instances.back());
+		_instances.pop_back();
+	} else {
+		mi.create();
+	}
+	return mi;
+}
+
+void DirectMeshInstancePool::recycle(DirectMeshInstance &mi) {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(mi.is_valid());
+	// Hide it by removing it from the scenario, the same way hidden chunks are
+	mi.set_world(nullptr);
+	mi.set_material_override(Ref<Material>());
+	mi.set_mesh(Ref<Mesh>());
+	_instances.push_back(std::move(mi));
+}
+
+void DirectMeshInstancePool::clear() {
+	_instances.clear();
+}
+
+} // namespace zylann::godot
@@ -0,0 +1,34 @@
+#ifndef ZN_DIRECT_MESH_INSTANCE_POOL_H
+#define ZN_DIRECT_MESH_INSTANCE_POOL_H
+
+#include "../containers/std_vector.h"
+#include "direct_mesh_instance.h"
+
+namespace zylann::godot {
+
+// Keeps mesh instances around instead of freeing them, so they can be re-used by other meshes later. Creating and
+// especially freeing instances in RenderingServer is expensive, which matters when lots of chunks enter and leave
+// view, like when crossing LOD boundaries.
+class DirectMeshInstancePool {
+public:
+	// Gets an instance from the pool, or creates a new one. It isn't in any world and has no mesh or material.
+	DirectMeshInstance allocate();
+
+	// Takes back an instance, which gets removed from its world and loses its mesh and material. If the instance
+	// holds the last reference to its mesh, consider releasing it separately first.
+	void recycle(DirectMeshInstance &mi);
+
+	// Frees all pooled instances.
+	void clear();
+
+	unsigned int get_count() const {
+		return _instances.size();
+	}
+
+private:
+	StdVector<DirectMeshInstance> _instances;
+};
+
+} // namespace zylann::godot
+
+#endif // ZN_DIRECT_MESH_INSTANCE_POOL_H
@@ -0,0 +1,138 @@
+#include "file_locker.h"
+
+namespace zylann {
+
+FileLocker::Handle::Handle(Handle &&other) {
+	_locker = other._locker;
+	_file = other._file;
+	_path = std::move(other._path);
+	other._locker = nullptr;
+	other._file = nullptr;
+}
+
+FileLocker::Handle::~Handle() {
+	release();
+}
+
+FileLocker::Handle &FileLocker::Handle::operator=(Handle &&other) {
+	if (this != &other) {
+		release();
+		_locker = other._locker;
+		_file = other._file;
+		_path = std::move(other._path);
+		other._locker = nullptr;
+		other._file = nullptr;
+	}
+	return *this;
+}
+
+void FileLocker::Handle::lock_read() {
+	ZN_ASSERT_RETURN(_file != nullptr);
+	lock_file(*_file, true);
+}
+
+void FileLocker::Handle::lock_write() {
+	ZN_ASSERT_RETURN(_file != nullptr);
+	lock_file(*_file, false);
+}
+
+void FileLocker::Handle::unlock() {
+	ZN_ASSERT_RETURN(_file != nullptr);
+	unlock_file(*_file);
+}
+
+void FileLocker::Handle::release() {
+	if (_file != nullptr) {
+		_locker->release(_path);
+		_locker = nullptr;
+		_file = nullptr;
+	}
+}
+
+FileLocker::Handle FileLocker::get_handle(const StdString &fpath) {
+	Handle handle;
+	handle._file = &acquire(fpath);
+	handle._locker = this;
+	handle._path = fpath;
+	return handle;
+}
+
+unsigned int FileLocker::get_entry_count() const {
+	unsigned int count = 0;
+	for (const Shard &shard : _shards) {
+		MutexLock lock(shard.mutex);
+		count += shard.files.size();
+	}
+	return count;
+}
+
+FileLocker::File &FileLocker::acquire(const StdString &fpath) {
+	Shard &shard = get_shard(fpath);
+	MutexLock lock(shard.mutex);
+	// Get or create.
+	// Elements of an unordered map don't move when other elements are added or removed, so the file can be used
+	// without holding the mutex as long as it is referenced.
+	File &file = shard.files[fpath];
+	++file.ref_count;
+	return file;
+}
+
+void FileLocker::release(const StdString &fpath) {
+	Shard &shard = get_shard(fpath);
+	MutexLock lock(shard.mutex);
+	auto it = shard.files.find(fpath);
+	ZN_ASSERT_RETURN(it != shard.files.end());
+	File &file = it->second;
+	ZN_ASSERT_RETURN(file.ref_count > 0);
+	--file.ref_count;
+	if (file.ref_count == 0) {
+		shard.files.erase(it);
+	}
+}
+
+void FileLocker::lock(const StdString &fpath, bool read_only) {
+	File &file = acquire(fpath);
+	lock_file(file, read_only);
+}
+
+void FileLocker::unlock_internal(const StdString &fpath) {
+	Shard &shard = get_shard(fpath);
+	MutexLock lock(shard.mutex);
+	auto it = shard.files.find(fpath);
+	ZN_ASSERT_RETURN(it != shard.files.end());
+	File &file = it->second;
+	// TODO FileAccess::reopen can have been called, nullifying my efforts to enforce thread sync :|
+	// So for now please don't do that
+
+	// Unlocking doesn't block, so it is fine to do it while the shard is locked
+	unlock_file(file);
+
+	ZN_ASSERT_RETURN(file.ref_count > 0);
+	--file.ref_count;
+	if (file.ref_count == 0) {
+		shard.files.erase(it);
+	}
+}
+
+void FileLocker::lock_file(File &file, bool read_only) {
+	if (read_only) {
+		file.lock.read_lock();
+		// The read lock was acquired. It means nobody is writing.
+		file.read_only = true;
+
+	} else {
+		file.lock.write_lock();
+		// The write lock was acquired. It means only one thread is writing.
+		file.read_only = false;
+	}
+}
+
+void FileLocker::unlock_file(File &file) {
+	if (file.read_only) {
+		file.lock.read_unlock();
+	} else {
+		file.lock.write_unlock();
+	}
+}
+
+} // namespace zylann
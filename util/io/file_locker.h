@@ -1,6 +1,7 @@
 #ifndef ZN_FILE_LOCKER_H
 #define ZN_FILE_LOCKER_H
 
+#include "../containers/fixed_array.h"
 #include "../containers/std_unordered_map.h"
 #include "../errors.h"
 #include "../string/std_string.h"
@@ -11,8 +12,68 @@ namespace zylann {
 
 // Performs software locking on paths,
 // so that multiple threads (controlled by this module) wanting to access the same file will lock a shared mutex.
+// Paths are spread in shards so threads looking up different paths rarely wait for each other. Entries are removed
+// when no thread uses them.
 class FileLocker {
+private:
+	struct File {
+		RWLock lock;
+		bool read_only = false;
+		// Threads locking the file, and handles to it
+		unsigned int ref_count = 0;
+	};
+
 public:
+	// Keeps the entry of a path alive, so it can be locked without looking it up.
+	// Useful for files that are kept open and accessed often.
+	class Handle {
+	public:
+		Handle() {}
+		Handle(Handle &&other);
+		~Handle();
+
+		Handle &operator=(Handle &&other);
+
+		inline bool is_valid() const {
+			return _file != nullptr;
+		}
+
+		void lock_read();
+		void lock_write();
+		void unlock();
+
+	private:
+		friend class FileLocker;
+
+		void release();
+
+		FileLocker *_locker = nullptr;
+		File *_file = nullptr;
+		StdString _path;
+	};
+
+	// Scoped helpers for handles
+
+	struct Read {
+		Read(Handle &p_handle) : handle(p_handle) {
+			handle.lock_read();
+		}
+		~Read() {
+			handle.unlock();
+		}
+		Handle &handle;
+	};
+
+	struct Write {
+		Write(Handle &p_handle) : handle(p_handle) {
+			handle.lock_write();
+		}
+		~Write() {
+			handle.unlock();
+		}
+		Handle &handle;
+	};
+
 	void lock_read(const StdString &fpath) {
 		lock(fpath, true);
 	}
@@ -25,56 +86,33 @@ public:
 		unlock_internal(fpath);
 	}
 
+	Handle get_handle(const StdString &fpath);
+
+	// For debugging
+	unsigned int get_entry_count() const;
+
 private:
-	struct File {
-		RWLock lock;
-		bool read_only;
+	static const unsigned int SHARD_COUNT = 16;
+
+	struct Shard {
+		mutable Mutex mutex;
+		StdUnorderedMap<StdString, File> files;
 	};
 
-	void lock(const StdString &fpath, bool read_only) {
-		File *fp = nullptr;
-		{
-			MutexLock lock(_files_mutex);
-			// Get or create.
-			// Note, we never remove entries from the map
-			fp = &_files[fpath];
-		}
+	inline Shard &get_shard(const StdString &fpath) {
+		return _shards[std::hash<StdString>()(fpath) % SHARD_COUNT];
+	}
 
-		if (read_only) {
-			fp->lock.read_lock();
-			// The read lock was acquired. It means nobody is writing.
-			fp->read_only = true;
+	File &acquire(const StdString &fpath);
+	void release(const StdString &fpath);
 
-		} else {
-			fp->lock.write_lock();
-			// The write lock was acquired. It means only one thread is writing.
-			fp->read_only = false;
-		}
-	}
+	void lock(const StdString &fpath, bool read_only);
+	void unlock_internal(const StdString &fpath);
 
-	void unlock_internal(const StdString &fpath) {
-		File *fp = nullptr;
-		{
-			MutexLock lock(_files_mutex);
-			auto it = _files.find(fpath);
-			if (it != _files.end()) {
-				fp = &it->second;
-			}
-		}
-		ZN_ASSERT_RETURN(fp != nullptr);
-		// TODO FileAccess::reopen can have been called, nullifying my efforts to enforce thread sync :|
-		// So for now please don't do that
-
-		if (fp->read_only) {
-			fp->lock.read_unlock();
-		} else {
-			fp->lock.write_unlock();
-		}
-	}
+	static void lock_file(File &file, bool read_only);
+	static void unlock_file(File &file);
 
-private:
-	Mutex _files_mutex;
-	StdUnorderedMap<StdString, File> _files;
+	FixedArray<Shard, SHARD_COUNT> _shards;
 };
 
 } // namespace zylann
@@ -0,0 +1,139 @@
+#include "memory_mapped_file.h"
+#include "../containers/std_vector.h"
+#include "../errors.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define ZN_MEMORY_MAPPED_FILE_WINDOWS
+
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ZN_MEMORY_MAPPED_FILE_POSIX
+#endif
+
+namespace zylann {
+
+MemoryMappedFile::~MemoryMappedFile() {
+	close();
+}
+
+bool MemoryMappedFile::is_supported() {
+#if defined(ZN_MEMORY_MAPPED_FILE_WINDOWS) || defined(ZN_MEMORY_MAPPED_FILE_POSIX)
+	return true;
+#else
+	return false;
+#endif
+}
+
+#if defined(ZN_MEMORY_MAPPED_FILE_POSIX)
+
+bool MemoryMappedFile::open(const char *utf8_path) {
+	close();
+	ZN_ASSERT_RETURN_V(utf8_path != nullptr, false);
+
+	const int fd = ::open(utf8_path, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	const size_t size = static_cast<size_t>(st.st_size);
+
+	void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping remains valid after the file descriptor is closed
+	::close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	_data = static_cast<const uint8_t *>(data);
+	_size = size;
+	return true;
+}
+
+void MemoryMappedFile::close() {
+	if (_data != nullptr) {
+		munmap(const_cast<uint8_t *>(_data), _size);
+		_data = nullptr;
+		_size = 0;
+	}
+}
+
+#elif defined(ZN_MEMORY_MAPPED_FILE_WINDOWS)
+
+bool MemoryMappedFile::open(const char *utf8_path) {
+	close();
+	ZN_ASSERT_RETURN_V(utf8_path != nullptr, false);
+
+	const int wide_len = MultiByteToWideChar(CP_UTF8, 0, utf8_path, -1, nullptr, 0);
+	if (wide_len <= 0) {
+		return false;
+	}
+	StdVector<wchar_t> wide_path;
+	wide_path.resize(wide_len);
+	MultiByteToWideChar(CP_UTF8, 0, utf8_path, -1, wide_path.data(), wide_len);
+
+	// Other handles must still be allowed to write the file, it will be re-mapped after that
+	HANDLE file = CreateFileW(wide_path.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	// The view remains valid after its handles are closed
+	CloseHandle(mapping);
+	CloseHandle(file);
+	if (data == nullptr) {
+		return false;
+	}
+
+	_data = static_cast<const uint8_t *>(data);
+	_size = static_cast<size_t>(file_size.QuadPart);
+	return true;
+}
+
+void MemoryMappedFile::close() {
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+		_size = 0;
+	}
+}
+
+#else
+
+bool MemoryMappedFile::open(const char *) {
+	return false;
+}
+
+void MemoryMappedFile::close() {}
+
+#endif
+
+} // namespace zylann
@@ -0,0 +1,45 @@
+#ifndef ZN_MEMORY_MAPPED_FILE_H
+#define ZN_MEMORY_MAPPED_FILE_H
+
+#include "../containers/span.h"
+#include <cstdint>
+
+namespace zylann {
+
+// Read-only view of a whole file mapped into the address space of the process.
+// Once open, the data can be read by multiple threads at once without any locking, as long as nothing writes to the
+// file in the meantime. Writes performed through other handles are not guaranteed to be visible in the mapping, so
+// the file should be re-mapped after being written.
+class MemoryMappedFile {
+public:
+	MemoryMappedFile() {}
+	~MemoryMappedFile();
+
+	MemoryMappedFile(const MemoryMappedFile &) = delete;
+	MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+
+	// Maps an existing file from the filesystem. The path must be absolute and encoded in UTF-8.
+	// Returns false if the file could not be mapped, in which case the caller should fallback on regular reads.
+	// Empty files cannot be mapped.
+	bool open(const char *utf8_path);
+	void close();
+
+	inline bool is_open() const {
+		return _data != nullptr;
+	}
+
+	inline Span<const uint8_t> get_data() const {
+		return Span<const uint8_t>(_data, _size);
+	}
+
+	// Returns false if memory mapping is not implemented on the current platform
+	static bool is_supported();
+
+private:
+	const uint8_t *_data = nullptr;
+	size_t _size = 0;
+};
+
+} // namespace zylann
+
+#endif // ZN_MEMORY_MAPPED_FILE_H
@@ -0,0 +1,217 @@
+#include "light_profiler.h"
+#include "containers/fixed_array.h"
+#include "memory/memory.h"
+#include "string/std_stringstream.h"
+#include "thread/mutex.h"
+#include "thread/spin_lock.h"
+#include <chrono>
+#include <sstream>
+
+namespace zylann::light_profiler {
+
+namespace internal {
+std::atomic_bool g_enabled = { false };
+}
+
+namespace {
+
+// Number of most recent events kept per thread
+static const unsigned int RING_BUFFER_SIZE = 4096;
+
+struct ThreadBuffer {
+	// Only contended while another thread samples events
+	SpinLock spin_lock;
+	StdString thread_name;
+	uint32_t thread_index;
+	// Index where the next event will be written
+	uint32_t write_index = 0;
+	// Number of events that were written since last clear, capped to the size of the ring buffer
+	uint32_t count = 0;
+	FixedArray<Event, RING_BUFFER_SIZE> events;
+};
+
+struct Registry {
+	BinaryMutex mutex;
+	// Buffers are never freed, so threads that exited can still be looked at, and so there is no need to
+	// synchronize destruction of thread-locals with sampling
+	StdVector<ThreadBuffer *> thread_buffers;
+	StdVector<Counter *> counters;
+};
+
+Registry &get_registry() {
+	// Intentionally leaked, it can be used by threads and static counters until the very end of the program
+	static Registry *s_registry = ZN_NEW(Registry);
+	return *s_registry;
+}
+
+ThreadBuffer &get_tls_buffer() {
+	thread_local ThreadBuffer *tls_buffer = nullptr;
+	if (ZN_UNLIKELY(tls_buffer == nullptr)) {
+		Registry &registry = get_registry();
+		MutexLock<BinaryMutex> mlock(registry.mutex);
+		tls_buffer = ZN_NEW(ThreadBuffer);
+		tls_buffer->thread_index = registry.thread_buffers.size();
+		registry.thread_buffers.push_back(tls_buffer);
+	}
+	return *tls_buffer;
+}
+
+void write_json_string(StdStringStream &ss, const char *s) {
+	ss << '"';
+	for (; *s != '\0'; ++s) {
+		const char c = *s;
+		switch (c) {
+			case '"':
+				ss << "\\\"";
+				break;
+			case '\\':
+				ss << "\\\\";
+				break;
+			case '\n':
+				ss << "\\n";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) >= 0x20) {
+					ss << c;
+				}
+				break;
+		}
+	}
+	ss << '"';
+}
+
+} // namespace
+
+void set_enabled(bool enabled) {
+	internal::g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void clear() {
+	Registry &registry = get_registry();
+	MutexLock<BinaryMutex> mlock(registry.mutex);
+
+	for (ThreadBuffer *tb : registry.thread_buffers) {
+		tb->spin_lock.lock();
+		tb->write_index = 0;
+		tb->count = 0;
+		tb->spin_lock.unlock();
+	}
+
+	for (Counter *counter : registry.counters) {
+		counter->reset();
+	}
+}
+
+void set_thread_name(const char *name) {
+	ThreadBuffer &tb = get_tls_buffer();
+	tb.spin_lock.lock();
+	tb.thread_name = name;
+	tb.spin_lock.unlock();
+}
+
+uint64_t get_time_usec() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+				   std::chrono::steady_clock::now().time_since_epoch())
+			.count();
+}
+
+void add_event(const char *name, uint64_t begin_usec, uint64_t end_usec) {
+	ThreadBuffer &tb = get_tls_buffer();
+	tb.spin_lock.lock();
+	tb.events[tb.write_index] = Event{ name, begin_usec, end_usec };
+	tb.write_index = (tb.write_index + 1) % RING_BUFFER_SIZE;
+	if (tb.count < RING_BUFFER_SIZE) {
+		++tb.count;
+	}
+	tb.spin_lock.unlock();
+}
+
+Counter::Counter(const char *name) : _name(name) {
+	Registry &registry = get_registry();
+	MutexLock<BinaryMutex> mlock(registry.mutex);
+	registry.counters.push_back(this);
+}
+
+void get_events(StdVector<ThreadEvents> &out_threads) {
+	Registry &registry = get_registry();
+	MutexLock<BinaryMutex> mlock(registry.mutex);
+
+	for (ThreadBuffer *tb : registry.thread_buffers) {
+		out_threads.push_back(ThreadEvents());
+		ThreadEvents &te = out_threads.back();
+		te.thread_index = tb->thread_index;
+
+		tb->spin_lock.lock();
+		te.thread_name = tb->thread_name;
+		te.events.reserve(tb->count);
+		// When the buffer is full, the oldest event is the one about to be overwritten
+		const uint32_t begin_index = (tb->write_index + RING_BUFFER_SIZE - tb->count) % RING_BUFFER_SIZE;
+		for (uint32_t i = 0; i < tb->count; ++i) {
+			te.events.push_back(tb->events[(begin_index + i) % RING_BUFFER_SIZE]);
+		}
+		tb->spin_lock.unlock();
+	}
+}
+
+void get_counters(StdVector<CounterSample> &out_counters) {
+	Registry &registry = get_registry();
+	MutexLock<BinaryMutex> mlock(registry.mutex);
+
+	for (const Counter *counter : registry.counters) {
+		out_counters.push_back(CounterSample{ counter->get_name(), counter->get() });
+	}
+}
+
+void write_chrome_trace(StdString &out_json) {
+	StdVector<ThreadEvents> threads;
+	get_events(threads);
+
+	StdVector<CounterSample> counters;
+	get_counters(counters);
+
+	// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+	StdStringStream ss;
+	ss << "{\"traceEvents\":[";
+	bool first = true;
+
+	for (const ThreadEvents &te : threads) {
+		if (!te.thread_name.empty()) {
+			if (!first) {
+				ss << ',';
+			}
+			first = false;
+			ss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << te.thread_index
+			   << ",\"args\":{\"name\":";
+			write_json_string(ss, te.thread_name.c_str());
+			ss << "}}";
+		}
+
+		for (const Event &event : te.events) {
+			if (!first) {
+				ss << ',';
+			}
+			first = false;
+			ss << "{\"name\":";
+			write_json_string(ss, event.name);
+			ss << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << te.thread_index << ",\"ts\":" << event.begin_usec
+			   << ",\"dur\":" << (event.end_usec - event.begin_usec) << '}';
+		}
+	}
+
+	// Counters only have their current total, so they are written as a single sample
+	const uint64_t now_usec = get_time_usec();
+	for (const CounterSample &counter : counters) {
+		if (!first) {
+			ss << ',';
+		}
+		first = false;
+		ss << "{\"name\":";
+		write_json_string(ss, counter.name);
+		ss << ",\"ph\":\"C\",\"pid\":0,\"ts\":" << now_usec << ",\"args\":{\"value\":" << counter.value << "}}";
+	}
+
+	ss << "]}";
+	out_json = ss.str();
+}
+
+} // namespace zylann::light_profiler
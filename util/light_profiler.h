@@ -0,0 +1,127 @@
+#ifndef ZN_LIGHT_PROFILER_H
+#define ZN_LIGHT_PROFILER_H
+
+#include "containers/std_vector.h"
+#include "macros.h"
+#include "string/std_string.h"
+#include <atomic>
+#include <cstdint>
+
+// Built-in profiler cheap enough to be left in release builds, unlike Tracy. It is off by default, and when it is, the
+// cost of an instrumented scope is a single relaxed atomic read.
+// When on, each thread records timings of its scopes in its own ring buffer, keeping only the most recent ones.
+// Counters are global and only keep a total.
+
+// Measures time spent until the end of the current C++ scope. Name must be a string literal.
+#define ZN_LIGHT_PROFILE_SCOPE_NAMED(name)                                                                             \
+	zylann::light_profiler::Scope ZN_CONCAT(zn_light_profiler_scope_, __LINE__)(name)
+
+// Adds a value to a named counter. Name must be a string literal.
+#define ZN_LIGHT_PROFILE_COUNTER_ADD(name, value)                                                                      \
+	do {                                                                                                               \
+		if (zylann::light_profiler::is_enabled()) {                                                                    \
+			static zylann::light_profiler::Counter zn_light_profiler_counter(name);                                    \
+			zn_light_profiler_counter.add(value);                                                                      \
+		}                                                                                                              \
+	} while (false)
+
+namespace zylann::light_profiler {
+
+namespace internal {
+extern std::atomic_bool g_enabled;
+}
+
+inline bool is_enabled() {
+	return internal::g_enabled.load(std::memory_order_relaxed);
+}
+
+// Starts or stops recording. Previously recorded data is kept until `clear` is called.
+void set_enabled(bool enabled);
+
+// Forgets all recorded timings and resets counters to zero.
+void clear();
+
+// Sets the name the calling thread will have in sampled data. The name is copied.
+void set_thread_name(const char *name);
+
+uint64_t get_time_usec();
+
+// Records a timing for the calling thread. Name must have static lifetime.
+void add_event(const char *name, uint64_t begin_usec, uint64_t end_usec);
+
+struct Scope {
+	const char *name;
+	uint64_t begin_usec;
+
+	inline Scope(const char *p_name) : name(p_name), begin_usec(0) {
+		if (is_enabled()) {
+			begin_usec = get_time_usec();
+		}
+	}
+
+	inline ~Scope() {
+		// Scopes which started while the profiler was disabled are not recorded
+		if (begin_usec != 0 && is_enabled()) {
+			add_event(name, begin_usec, get_time_usec());
+		}
+	}
+};
+
+// Counters register themselves globally and must have static lifetime. Mostly used through
+// `ZN_LIGHT_PROFILE_COUNTER_ADD`.
+class Counter {
+public:
+	Counter(const char *name);
+
+	inline void add(int64_t value) {
+		_value.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	inline int64_t get() const {
+		return _value.load(std::memory_order_relaxed);
+	}
+
+	inline void reset() {
+		_value.store(0, std::memory_order_relaxed);
+	}
+
+	inline const char *get_name() const {
+		return _name;
+	}
+
+private:
+	const char *_name;
+	std::atomic_int64_t _value = { 0 };
+};
+
+struct Event {
+	const char *name;
+	uint64_t begin_usec;
+	uint64_t end_usec;
+};
+
+struct ThreadEvents {
+	StdString thread_name;
+	uint32_t thread_index;
+	// Oldest first
+	StdVector<Event> events;
+};
+
+struct CounterSample {
+	const char *name;
+	int64_t value;
+};
+
+// Copies events currently held in the ring buffers of all threads. Can be called from any thread, including while
+// recording.
+void get_events(StdVector<ThreadEvents> &out_threads);
+
+void get_counters(StdVector<CounterSample> &out_counters);
+
+// Writes recorded events and counters in the JSON format of Chrome's trace viewer (`chrome://tracing`), which is
+// also supported by Perfetto.
+void write_chrome_trace(StdString &out_json);
+
+} // namespace zylann::light_profiler
+
+#endif // ZN_LIGHT_PROFILER_H
@@ -12,6 +12,7 @@ using namespace godot;
 
 #include "constants.h"
 #include <cmath>
+#include <cstdint>
 #include <type_traits>
 
 namespace zylann::math {
@@ -256,6 +257,23 @@ inline unsigned int get_shift_from_power_of_two_32(unsigned int pot) {
 	return 0;
 }
 
+// Returns the index of the least significant bit set in `x`. `x` must not be zero.
+inline unsigned int get_lowest_set_bit_index_64(uint64_t x) {
+#ifdef DEBUG_ENABLED
+	ZN_ASSERT(x != 0);
+#endif
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#else
+	unsigned int i = 0;
+	while ((x & 1) == 0) {
+		x >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
 // If `num` == 2^N, returns N. Otherwise, returns the exponent of the next power of two.
 // 0 => 0
 // 1 => 0
@@ -0,0 +1,109 @@
+#include "large_pages.h"
+#include "../errors.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define ZN_LARGE_PAGES_WINDOWS
+
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <cstdint>
+#define ZN_LARGE_PAGES_POSIX
+
+#else
+#include "memory.h"
+#endif
+
+namespace zylann {
+
+#if defined(ZN_LARGE_PAGES_POSIX)
+
+void *allocate_large_pages(size_t size, bool &out_large_pages) {
+	ZN_ASSERT_RETURN_V(size > 0 && size % LARGE_PAGE_SIZE == 0, nullptr);
+
+#ifdef MAP_HUGETLB
+	// Only succeeds if huge pages were reserved on the system
+	void *huge = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (huge != MAP_FAILED) {
+		out_large_pages = true;
+		return huge;
+	}
+#endif
+	out_large_pages = false;
+
+	// Map more than needed, so the range can be aligned. Transparent huge pages only back aligned ranges.
+	const size_t mapped_size = size + LARGE_PAGE_SIZE;
+	void *mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapped == MAP_FAILED) {
+		return nullptr;
+	}
+	const uintptr_t mapped_begin = reinterpret_cast<uintptr_t>(mapped);
+	const uintptr_t begin = (mapped_begin + LARGE_PAGE_SIZE - 1) & ~uintptr_t(LARGE_PAGE_SIZE - 1);
+	const uintptr_t end = begin + size;
+	if (begin > mapped_begin) {
+		munmap(mapped, begin - mapped_begin);
+	}
+	if (mapped_begin + mapped_size > end) {
+		munmap(reinterpret_cast<void *>(end), mapped_begin + mapped_size - end);
+	}
+	void *ptr = reinterpret_cast<void *>(begin);
+#ifdef MADV_HUGEPAGE
+	// This is only a hint, failing is fine
+	madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	return ptr;
+}
+
+void free_large_pages(void *ptr, size_t size) {
+	if (ptr != nullptr) {
+		munmap(ptr, size);
+	}
+}
+
+#elif defined(ZN_LARGE_PAGES_WINDOWS)
+
+void *allocate_large_pages(size_t size, bool &out_large_pages) {
+	ZN_ASSERT_RETURN_V(size > 0 && size % LARGE_PAGE_SIZE == 0, nullptr);
+
+	// Only succeeds if the process has the privilege to lock pages in memory
+	const size_t large_page_minimum = GetLargePageMinimum();
+	if (large_page_minimum > 0 && size % large_page_minimum == 0) {
+		void *ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (ptr != nullptr) {
+			out_large_pages = true;
+			return ptr;
+		}
+	}
+	out_large_pages = false;
+	return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void free_large_pages(void *ptr, size_t size) {
+	if (ptr != nullptr) {
+		VirtualFree(ptr, 0, MEM_RELEASE);
+	}
+}
+
+#else
+
+void *allocate_large_pages(size_t size, bool &out_large_pages) {
+	ZN_ASSERT_RETURN_V(size > 0 && size % LARGE_PAGE_SIZE == 0, nullptr);
+	out_large_pages = false;
+	return ZN_ALLOC(size);
+}
+
+void free_large_pages(void *ptr, size_t size) {
+	if (ptr != nullptr) {
+		ZN_FREE(ptr);
+	}
+}
+
+#endif
+
+} // namespace zylann
@@ -0,0 +1,25 @@
+#ifndef ZN_LARGE_PAGES_H
+#define ZN_LARGE_PAGES_H
+
+#include <cstddef>
+
+namespace zylann {
+
+// Size of slabs allocated with `allocate_large_pages`. It matches the most common large page size on x86_64 and ARM64.
+static constexpr size_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Allocates memory directly from the OS, preferably backed by large pages so accessing it causes fewer TLB misses.
+// `size` must be a multiple of `LARGE_PAGE_SIZE`. The returned memory is aligned at least to the size of regular
+// pages.
+// Large pages often need to be reserved or allowed by the system (`vm.nr_hugepages` on Linux, the "Lock pages in
+// memory" privilege on Windows). When they are not available, regular pages are used instead, and
+// `out_large_pages` is set to false. On Linux, transparent huge pages are still requested in that case.
+// Returns null if the allocation failed.
+void *allocate_large_pages(size_t size, bool &out_large_pages);
+
+// Frees memory obtained with `allocate_large_pages`, with the same size.
+void free_large_pages(void *ptr, size_t size);
+
+} // namespace zylann
+
+#endif // ZN_LARGE_PAGES_H
@@ -7,6 +7,126 @@
 
 namespace zylann {
 
+namespace {
+
+// FastNoise2 computes positions of grids as `float(start + i) * frequency`. If given positions are computed the same
+// way, we can generate a grid instead, which gives the same results.
+bool get_grid_start(float first, float step, int &out_start) {
+	const float f = first / step;
+	// Also excludes NaN
+	if (!(Math::abs(f) < 1e9f)) {
+		return false;
+	}
+	out_start = static_cast<int>(Math::round(f));
+	return static_cast<float>(out_start) * step == first;
+}
+
+bool find_grid_2d(
+		Span<const float> src_x,
+		Span<const float> src_y,
+		Vector2i &out_start,
+		Vector2i &out_size,
+		float &out_step
+) {
+	const unsigned int count = src_x.size();
+	if (count < 2) {
+		return false;
+	}
+	const float step = src_x[1] - src_x[0];
+	if (!(step > 0.f)) {
+		return false;
+	}
+
+	unsigned int size_x = 1;
+	while (size_x < count && src_y[size_x] == src_y[0]) {
+		++size_x;
+	}
+	if (count % size_x != 0) {
+		return false;
+	}
+	const unsigned int size_y = count / size_x;
+
+	Vector2i start;
+	if (!get_grid_start(src_x[0], step, start.x) || !get_grid_start(src_y[0], step, start.y)) {
+		return false;
+	}
+
+	unsigned int i = 0;
+	for (unsigned int y = 0; y < size_y; ++y) {
+		const float gy = static_cast<float>(start.y + int(y)) * step;
+		for (unsigned int x = 0; x < size_x; ++x) {
+			if (src_x[i] != static_cast<float>(start.x + int(x)) * step || src_y[i] != gy) {
+				return false;
+			}
+			++i;
+		}
+	}
+
+	out_start = start;
+	out_size = Vector2i(size_x, size_y);
+	out_step = step;
+	return true;
+}
+
+bool find_grid_3d(
+		Span<const float> src_x,
+		Span<const float> src_y,
+		Span<const float> src_z,
+		Vector3i &out_start,
+		Vector3i &out_size,
+		float &out_step
+) {
+	const unsigned int count = src_x.size();
+	if (count < 2) {
+		return false;
+	}
+	const float step = src_x[1] - src_x[0];
+	if (!(step > 0.f)) {
+		return false;
+	}
+
+	unsigned int size_x = 1;
+	while (size_x < count && src_y[size_x] == src_y[0] && src_z[size_x] == src_z[0]) {
+		++size_x;
+	}
+	unsigned int size_y = 1;
+	while (size_y * size_x < count && src_z[size_y * size_x] == src_z[0]) {
+		++size_y;
+	}
+	const unsigned int layer_size = size_x * size_y;
+	if (count % layer_size != 0) {
+		return false;
+	}
+	const unsigned int size_z = count / layer_size;
+
+	Vector3i start;
+	if (!get_grid_start(src_x[0], step, start.x) || !get_grid_start(src_y[0], step, start.y) ||
+			!get_grid_start(src_z[0], step, start.z)) {
+		return false;
+	}
+
+	unsigned int i = 0;
+	for (unsigned int z = 0; z < size_z; ++z) {
+		const float gz = static_cast<float>(start.z + int(z)) * step;
+		for (unsigned int y = 0; y < size_y; ++y) {
+			const float gy = static_cast<float>(start.y + int(y)) * step;
+			for (unsigned int x = 0; x < size_x; ++x) {
+				if (src_x[i] != static_cast<float>(start.x + int(x)) * step || src_y[i] != gy || src_z[i] != gz) {
+					return false;
+				}
+				++i;
+			}
+		}
+	}
+
+	out_start = start;
+	out_size = Vector3i(size_x, size_y, size_z);
+	out_step = step;
+	return true;
+}
+
+} // namespace
+
 FastNoise2::FastNoise2() {
 	// Setup default
 	update_generator();
@@ -391,6 +511,48 @@ void FastNoise2::get_noise_3d_series(
 	}
 }
 
+bool FastNoise2::try_get_noise_2d_series_as_grid(
+		Span<const float> src_x,
+		Span<const float> src_y,
+		Span<float> dst
+) const {
+	ERR_FAIL_COND_V(!is_valid(), false);
+	ERR_FAIL_COND_V(src_x.size() != src_y.size() || src_x.size() != dst.size(), false);
+	// Small buffers have the same issue as in `get_noise_2d_series`
+	if (src_x.size() < MIN_BUFFER_SIZE) {
+		return false;
+	}
+	Vector2i start;
+	Vector2i size;
+	float step;
+	if (!find_grid_2d(src_x, src_y, start, size, step)) {
+		return false;
+	}
+	_generator->GenUniformGrid2D(dst.data(), start.x, start.y, size.x, size.y, step, _seed);
+	return true;
+}
+
+bool FastNoise2::try_get_noise_3d_series_as_grid(
+		Span<const float> src_x,
+		Span<const float> src_y,
+		Span<const float> src_z,
+		Span<float> dst
+) const {
+	ERR_FAIL_COND_V(!is_valid(), false);
+	ERR_FAIL_COND_V(src_x.size() != src_y.size() || src_x.size() != src_z.size() || src_x.size() != dst.size(), false);
+	if (src_x.size() < MIN_BUFFER_SIZE) {
+		return false;
+	}
+	Vector3i start;
+	Vector3i size;
+	float step;
+	if (!find_grid_3d(src_x, src_y, src_z, start, size, step)) {
+		return false;
+	}
+	_generator->GenUniformGrid3D(dst.data(), start.x, start.y, start.z, size.x, size.y, size.z, step, _seed);
+	return true;
+}
+
 void FastNoise2::get_noise_2d_grid(Vector2 origin, Vector2i size, Span<float> dst) const {
 	ERR_FAIL_COND(!is_valid());
 	ERR_FAIL_COND(size.x < 0 || size.y < 0);
@@ -168,6 +168,17 @@ public:
 	void get_noise_3d_series(Span<const float> src_x, Span<const float> src_y, Span<const float> src_z, Span<float> dst)
 			const;
 
+	// Same as `get_noise_*_series`, but faster when positions form a grid ordered by X, then Y (then Z), with the same
+	// spacing on all axes, and coordinates being multiples of that spacing. Results are identical. If positions don't
+	// match these conditions, nothing is written and false is returned.
+	bool try_get_noise_2d_series_as_grid(Span<const float> src_x, Span<const float> src_y, Span<float> dst) const;
+	bool try_get_noise_3d_series_as_grid(
+			Span<const float> src_x,
+			Span<const float> src_y,
+			Span<const float> src_z,
+			Span<float> dst
+	) const;
+
 	void get_noise_2d_grid(Vector2 origin, Vector2i size, Span<float> dst) const;
 	void get_noise_3d_grid(Vector3 origin, Vector3i size, Span<float> dst) const;
 
@@ -1,6 +1,8 @@
 #include "fast_noise_lite.h"
+#include "../../containers/fixed_array.h"
 #include "../../godot/core/array.h"
 #include "../../math/funcs.h"
+#include "../../profiling.h"
 
 namespace zylann {
 
@@ -222,6 +224,199 @@ ZN_FastNoiseLite::RotationType3D ZN_FastNoiseLite::get_rotation_type_3d() const
 	return _rotation_type_3d;
 }
 
+namespace {
+
+// Positions are processed in groups small enough to stay on the stack
+const unsigned int NOISE_SERIES_CHUNK_SIZE = 64;
+
+struct NoiseSeriesChunk {
+	FixedArray<real_t, NOISE_SERIES_CHUNK_SIZE> x;
+	FixedArray<real_t, NOISE_SERIES_CHUNK_SIZE> y;
+	FixedArray<real_t, NOISE_SERIES_CHUNK_SIZE> z;
+	unsigned int size;
+
+	inline void scale(const float s) {
+		for (unsigned int i = 0; i < size; ++i) {
+			x[i] *= s;
+			y[i] *= s;
+			z[i] *= s;
+		}
+	}
+};
+
+// Does the same operations as `FastNoiseLite::GetNoise` after coordinates are transformed, in the same order, so
+// results are identical. `noise_func` is the noise type, so it is selected only once.
+template <typename NoiseFunc_T>
+void gen_fractal_series(
+		const ::fast_noise_lite::FastNoiseLite &fn,
+		NoiseFunc_T noise_func,
+		NoiseSeriesChunk &chunk,
+		float *out
+) {
+	typedef ::fast_noise_lite::FastNoiseLite FNL;
+
+	const unsigned int size = chunk.size;
+	FixedArray<float, NOISE_SERIES_CHUNK_SIZE> amps;
+
+	if (fn.mFractalType == FNL::FractalType_FBm || fn.mFractalType == FNL::FractalType_Ridged ||
+		fn.mFractalType == FNL::FractalType_PingPong) {
+		for (unsigned int i = 0; i < size; ++i) {
+			out[i] = 0.f;
+			amps[i] = fn.mFractalBounding;
+		}
+	}
+
+	int seed = fn.mSeed;
+
+	switch (fn.mFractalType) {
+		case FNL::FractalType_FBm:
+			for (int octave = 0; octave < fn.mOctaves; ++octave) {
+				for (unsigned int i = 0; i < size; ++i) {
+					const float noise = noise_func(seed, chunk.x[i], chunk.y[i], chunk.z[i]);
+					out[i] += noise * amps[i];
+					amps[i] *= FNL::Lerp(1.0f, (noise + 1) * 0.5f, fn.mWeightedStrength);
+					amps[i] *= fn.mGain;
+				}
+				++seed;
+				chunk.scale(fn.mLacunarity);
+			}
+			break;
+
+		case FNL::FractalType_Ridged:
+			for (int octave = 0; octave < fn.mOctaves; ++octave) {
+				for (unsigned int i = 0; i < size; ++i) {
+					const float noise = FNL::FastAbs(noise_func(seed, chunk.x[i], chunk.y[i], chunk.z[i]));
+					out[i] += (noise * -2 + 1) * amps[i];
+					amps[i] *= FNL::Lerp(1.0f, 1 - noise, fn.mWeightedStrength);
+					amps[i] *= fn.mGain;
+				}
+				++seed;
+				chunk.scale(fn.mLacunarity);
+			}
+			break;
+
+		case FNL::FractalType_PingPong:
+			for (int octave = 0; octave < fn.mOctaves; ++octave) {
+				for (unsigned int i = 0; i < size; ++i) {
+					const float noise = FNL::PingPong(
+							(noise_func(seed, chunk.x[i], chunk.y[i], chunk.z[i]) + 1) * fn.mPingPongStength
+					);
+					out[i] += (noise - 0.5f) * 2 * amps[i];
+					amps[i] *= FNL::Lerp(1.0f, noise, fn.mWeightedStrength);
+					amps[i] *= fn.mGain;
+				}
+				++seed;
+				chunk.scale(fn.mLacunarity);
+			}
+			break;
+
+		default:
+			for (unsigned int i = 0; i < size; ++i) {
+				out[i] = noise_func(seed, chunk.x[i], chunk.y[i], chunk.z[i]);
+			}
+			break;
+	}
+}
+
+void gen_noise_series(const ::fast_noise_lite::FastNoiseLite &fn, NoiseSeriesChunk &chunk, float *out) {
+	typedef ::fast_noise_lite::FastNoiseLite FNL;
+
+	switch (fn.mNoiseType) {
+		case FNL::NoiseType_OpenSimplex2:
+			gen_fractal_series(
+					fn,
+					[&fn](int seed, real_t x, real_t y, real_t z) { return fn.SingleOpenSimplex2(seed, x, y, z); },
+					chunk,
+					out
+			);
+			break;
+		case FNL::NoiseType_OpenSimplex2S:
+			gen_fractal_series(
+					fn,
+					[&fn](int seed, real_t x, real_t y, real_t z) { return fn.SingleOpenSimplex2S(seed, x, y, z); },
+					chunk,
+					out
+			);
+			break;
+		case FNL::NoiseType_Cellular:
+			gen_fractal_series(
+					fn,
+					[&fn](int seed, real_t x, real_t y, real_t z) { return fn.SingleCellular(seed, x, y, z); },
+					chunk,
+					out
+			);
+			break;
+		case FNL::NoiseType_Perlin:
+			gen_fractal_series(
+					fn,
+					[&fn](int seed, real_t x, real_t y, real_t z) { return fn.SinglePerlin(seed, x, y, z); },
+					chunk,
+					out
+			);
+			break;
+		case FNL::NoiseType_ValueCubic:
+			gen_fractal_series(
+					fn,
+					[&fn](int seed, real_t x, real_t y, real_t z) { return fn.SingleValueCubic(seed, x, y, z); },
+					chunk,
+					out
+			);
+			break;
+		case FNL::NoiseType_Value:
+			gen_fractal_series(
+					fn,
+					[&fn](int seed, real_t x, real_t y, real_t z) { return fn.SingleValue(seed, x, y, z); },
+					chunk,
+					out
+			);
+			break;
+		default:
+			for (unsigned int i = 0; i < chunk.size; ++i) {
+				out[i] = 0.f;
+			}
+			break;
+	}
+}
+
+} // namespace
+
+void ZN_FastNoiseLite::get_noise_3d_series(
+		Span<const float> x,
+		Span<const float> y,
+		Span<const float> z,
+		Span<float> out
+) const {
+	ZN_PROFILE_SCOPE();
+	ZN_ASSERT_RETURN(x.size() == out.size() && y.size() == out.size() && z.size() == out.size());
+
+	const ZN_FastNoiseLiteGradient *warp_noise = _warp_noise.ptr();
+	NoiseSeriesChunk chunk;
+
+	const unsigned int total_size = out.size();
+
+	for (unsigned int begin = 0; begin < total_size; begin += NOISE_SERIES_CHUNK_SIZE) {
+		chunk.size = math::min(total_size - begin, NOISE_SERIES_CHUNK_SIZE);
+
+		for (unsigned int i = 0; i < chunk.size; ++i) {
+			chunk.x[i] = x[begin + i];
+			chunk.y[i] = y[begin + i];
+			chunk.z[i] = z[begin + i];
+		}
+
+		if (warp_noise != nullptr) {
+			for (unsigned int i = 0; i < chunk.size; ++i) {
+				warp_noise->warp_3d(chunk.x[i], chunk.y[i], chunk.z[i]);
+			}
+		}
+
+		for (unsigned int i = 0; i < chunk.size; ++i) {
+			_fn.TransformNoiseCoordinate(chunk.x[i], chunk.y[i], chunk.z[i]);
+		}
+
+		gen_noise_series(_fn, chunk, out.data() + begin);
+	}
+}
+
 void ZN_FastNoiseLite::_on_warp_noise_changed() {
 	emit_changed();
 }
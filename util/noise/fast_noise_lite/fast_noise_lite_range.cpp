@@ -8,26 +8,30 @@ using namespace math;
 
 namespace {
 
-Interval get_fnl_cellular_value_range_2d(const ZN_FastNoiseLite &noise, Interval x, Interval y) {
-	const float c0 = noise.get_noise_2d(x.min, y.min);
-	const float c1 = noise.get_noise_2d(x.max, y.min);
-	const float c2 = noise.get_noise_2d(x.min, y.max);
-	const float c3 = noise.get_noise_2d(x.max, y.max);
+// Cells have a constant value, so if all corners of the area have the same value, we assume they are in the same cell.
+// `noise_func` must sample the noise at coordinates in the same space as the given intervals.
+template <typename Noise_F>
+Interval get_fnl_cellular_value_range_2d(Noise_F noise_func, Interval x, Interval y) {
+	const float c0 = noise_func(x.min, y.min);
+	const float c1 = noise_func(x.max, y.min);
+	const float c2 = noise_func(x.min, y.max);
+	const float c3 = noise_func(x.max, y.max);
 	if (c0 == c1 && c1 == c2 && c2 == c3) {
 		return Interval::from_single_value(c0);
 	}
 	return Interval{ -1, 1 };
 }
 
-Interval get_fnl_cellular_value_range_3d(const fast_noise_lite::FastNoiseLite &fn, Interval x, Interval y, Interval z) {
-	const float c0 = fn.GetNoise(x.min, y.min, z.min);
-	const float c1 = fn.GetNoise(x.max, y.min, z.min);
-	const float c2 = fn.GetNoise(x.min, y.max, z.min);
-	const float c3 = fn.GetNoise(x.max, y.max, z.min);
-	const float c4 = fn.GetNoise(x.max, y.max, z.max);
-	const float c5 = fn.GetNoise(x.max, y.max, z.max);
-	const float c6 = fn.GetNoise(x.max, y.max, z.max);
-	const float c7 = fn.GetNoise(x.max, y.max, z.max);
+template <typename Noise_F>
+Interval get_fnl_cellular_value_range_3d(Noise_F noise_func, Interval x, Interval y, Interval z) {
+	const float c0 = noise_func(x.min, y.min, z.min);
+	const float c1 = noise_func(x.max, y.min, z.min);
+	const float c2 = noise_func(x.min, y.max, z.min);
+	const float c3 = noise_func(x.max, y.max, z.min);
+	const float c4 = noise_func(x.min, y.min, z.max);
+	const float c5 = noise_func(x.max, y.min, z.max);
+	const float c6 = noise_func(x.min, y.max, z.max);
+	const float c7 = noise_func(x.max, y.max, z.max);
 	if (c0 == c1 && c1 == c2 && c2 == c3 && c3 == c4 && c4 == c5 && c5 == c6 && c6 == c7) {
 		return Interval::from_single_value(c0);
 	}
@@ -117,6 +121,27 @@ Interval get_fnl_cellular_range(const ZN_FastNoiseLite &noise) {
 	return Interval{ -1.f, 1.f };
 }
 
+void fnl_transform_noise_coordinate(const fast_noise_lite::FastNoiseLite &fn, Interval &x, Interval &y) {
+	// Same logic as in the FastNoiseLite internal function
+
+	x *= fn.mFrequency;
+	y *= fn.mFrequency;
+
+	switch (fn.mNoiseType) {
+		case fast_noise_lite::FastNoiseLite::NoiseType_OpenSimplex2:
+		case fast_noise_lite::FastNoiseLite::NoiseType_OpenSimplex2S: {
+			const float SQRT3 = 1.7320508075688772935274463415059;
+			const float F2 = 0.5f * (SQRT3 - 1);
+			// Expanded so each interval is used only once, otherwise the result would be wider than necessary
+			const Interval x0 = x;
+			x = x * (1.f + F2) + y * F2;
+			y = y * (1.f + F2) + x0 * F2;
+		} break;
+		default:
+			break;
+	}
+}
+
 void fnl_transform_noise_coordinate(const fast_noise_lite::FastNoiseLite &fn, Interval &x, Interval &y, Interval &z) {
 	// Same logic as in the FastNoiseLite internal function
 
@@ -184,20 +209,27 @@ Interval fnl_single_opensimplex2s(
 ) {
 	return get_noise_range_3d(
 			[&fn, seed](real_t x, real_t y, real_t z) { //
-				return fn.SingleOpenSimplex2(seed, x, y, z);
+				return fn.SingleOpenSimplex2S(seed, x, y, z);
 			},
 			// Max derivative found from empiric tests
 			p_x,
 			p_y,
 			p_z,
-			2.5f
+			6.0f
 	);
 }
 
-Interval fnl_single_cellular(const ZN_FastNoiseLite &noise, Interval x, Interval y, Interval z) {
+Interval fnl_single_cellular(const ZN_FastNoiseLite &noise, int seed, Interval x, Interval y, Interval z) {
 	const fast_noise_lite::FastNoiseLite &fn = noise.get_noise_internal();
 	if (fn.mCellularReturnType == fast_noise_lite::FastNoiseLite::CellularReturnType_CellValue) {
-		return get_fnl_cellular_value_range_3d(fn, x, y, z);
+		return get_fnl_cellular_value_range_3d(
+				[&fn, seed](real_t x, real_t y, real_t z) { //
+					return fn.SingleCellular(seed, x, y, z);
+				},
+				x,
+				y,
+				z
+		);
 	}
 	return get_fnl_cellular_range(noise);
 }
@@ -269,7 +301,7 @@ Interval fnl_gen_noise_single(const ZN_FastNoiseLite &noise, int seed, Interval
 		case fast_noise_lite::FastNoiseLite::NoiseType_OpenSimplex2S:
 			return fnl_single_opensimplex2s(fn, seed, x, y, z);
 		case fast_noise_lite::FastNoiseLite::NoiseType_Cellular:
-			return fnl_single_cellular(noise, x, y, z);
+			return fnl_single_cellular(noise, seed, x, y, z);
 		case fast_noise_lite::FastNoiseLite::NoiseType_Perlin:
 			return fnl_single_perlin(fn, seed, x, y, z);
 		case fast_noise_lite::FastNoiseLite::NoiseType_ValueCubic:
@@ -331,6 +363,140 @@ Interval fnl_gen_fractal_ridged(const ZN_FastNoiseLite &p_noise, Interval x, Int
 	return sum;
 }
 
+Interval fnl_gen_noise_single_2d(const ZN_FastNoiseLite &noise, int seed, Interval x, Interval y) {
+	// Same logic as in the FastNoiseLite internal function
+	const fast_noise_lite::FastNoiseLite &fn = noise.get_noise_internal();
+
+	// Max derivatives were found from empiric tests
+	switch (fn.mNoiseType) {
+		case fast_noise_lite::FastNoiseLite::NoiseType_OpenSimplex2:
+			return get_noise_range_2d(
+					[&fn, seed](real_t x, real_t y) { //
+						return fn.SingleSimplex(seed, x, y);
+					},
+					x,
+					y,
+					7.0f
+			);
+		case fast_noise_lite::FastNoiseLite::NoiseType_OpenSimplex2S:
+			return get_noise_range_2d(
+					[&fn, seed](real_t x, real_t y) { //
+						return fn.SingleOpenSimplex2S(seed, x, y);
+					},
+					x,
+					y,
+					4.7f
+			);
+		case fast_noise_lite::FastNoiseLite::NoiseType_Cellular:
+			if (fn.mCellularReturnType == fast_noise_lite::FastNoiseLite::CellularReturnType_CellValue) {
+				return get_fnl_cellular_value_range_2d(
+						[&fn, seed](real_t x, real_t y) { //
+							return fn.SingleCellular(seed, x, y);
+						},
+						x,
+						y
+				);
+			}
+			return get_fnl_cellular_range(noise);
+		case fast_noise_lite::FastNoiseLite::NoiseType_Perlin:
+			return get_noise_range_2d(
+					[&fn, seed](real_t x, real_t y) { //
+						return fn.SinglePerlin(seed, x, y);
+					},
+					x,
+					y,
+					3.0f
+			);
+		case fast_noise_lite::FastNoiseLite::NoiseType_ValueCubic:
+			return get_noise_range_2d(
+					[&fn, seed](real_t x, real_t y) { //
+						return fn.SingleValueCubic(seed, x, y);
+					},
+					x,
+					y,
+					1.6f
+			);
+		case fast_noise_lite::FastNoiseLite::NoiseType_Value:
+			return get_noise_range_2d(
+					[&fn, seed](real_t x, real_t y) { //
+						return fn.SingleValue(seed, x, y);
+					},
+					x,
+					y,
+					3.0f
+			);
+		default:
+			return Interval::from_single_value(0);
+	}
+}
+
+Interval fnl_gen_fractal_fbm(const ZN_FastNoiseLite &p_noise, Interval x, Interval y) {
+	// Same logic as in the FastNoiseLite internal function
+	const fast_noise_lite::FastNoiseLite &fn = p_noise.get_noise_internal();
+
+	int seed = fn.mSeed;
+	Interval sum;
+	Interval amp = Interval::from_single_value(fn.mFractalBounding);
+
+	for (int i = 0; i < fn.mOctaves; i++) {
+		Interval noise = fnl_gen_noise_single_2d(p_noise, seed++, x, y);
+		sum += noise * amp;
+		amp *=
+				lerp(Interval::from_single_value(1.0f),
+					 (noise + Interval::from_single_value(1.0f)) * 0.5f,
+					 Interval::from_single_value(fn.mWeightedStrength));
+
+		x *= fn.mLacunarity;
+		y *= fn.mLacunarity;
+		amp *= fn.mGain;
+	}
+
+	return sum;
+}
+
+Interval fnl_gen_fractal_ridged(const ZN_FastNoiseLite &p_noise, Interval x, Interval y) {
+	// Same logic as in the FastNoiseLite internal function
+	const fast_noise_lite::FastNoiseLite &fn = p_noise.get_noise_internal();
+
+	int seed = fn.mSeed;
+	Interval sum;
+	Interval amp = Interval::from_single_value(fn.mFractalBounding);
+
+	for (int i = 0; i < fn.mOctaves; i++) {
+		Interval noise = abs(fnl_gen_noise_single_2d(p_noise, seed++, x, y));
+		sum += (noise * -2 + 1) * amp;
+		amp *=
+				lerp(Interval::from_single_value(1.0f),
+					 Interval::from_single_value(1.0f) - noise,
+					 Interval::from_single_value(fn.mWeightedStrength));
+
+		x *= fn.mLacunarity;
+		y *= fn.mLacunarity;
+		amp *= fn.mGain;
+	}
+
+	return sum;
+}
+
+Interval fnl_get_noise(const ZN_FastNoiseLite &noise, Interval x, Interval y) {
+	// Same logic as in the FastNoiseLite internal function
+	const fast_noise_lite::FastNoiseLite &fn = noise.get_noise_internal();
+
+	fnl_transform_noise_coordinate(fn, x, y);
+
+	switch (noise.get_fractal_type()) {
+		default:
+			return fnl_gen_noise_single_2d(noise, noise.get_seed(), x, y);
+		case ZN_FastNoiseLite::FRACTAL_FBM:
+			return fnl_gen_fractal_fbm(noise, x, y);
+		case ZN_FastNoiseLite::FRACTAL_RIDGED:
+			return fnl_gen_fractal_ridged(noise, x, y);
+		case ZN_FastNoiseLite::FRACTAL_PING_PONG:
+			// TODO Ping pong
+			return Interval(-1.f, 1.f);
+	}
+}
+
 Interval fnl_get_noise(const ZN_FastNoiseLite &noise, Interval x, Interval y, Interval z) {
 	// Same logic as in the FastNoiseLite internal function
 	const fast_noise_lite::FastNoiseLite &fn = noise.get_noise_internal();
@@ -353,12 +519,20 @@ Interval fnl_get_noise(const ZN_FastNoiseLite &noise, Interval x, Interval y, In
 } // namespace
 
 Interval get_fnl_range_2d(const ZN_FastNoiseLite &noise, Interval x, Interval y) {
-	// TODO More precise analysis using derivatives
+	if (noise.get_warp_noise().is_null()) {
+		return fnl_get_noise(noise, x, y);
+	}
 	// TODO Take warp noise into account
 	switch (noise.get_noise_type()) {
 		case ZN_FastNoiseLite::TYPE_CELLULAR:
 			if (noise.get_cellular_return_type() == ZN_FastNoiseLite::CELLULAR_RETURN_CELL_VALUE) {
-				return get_fnl_cellular_value_range_2d(noise, x, y);
+				return get_fnl_cellular_value_range_2d(
+						[&noise](real_t x, real_t y) { //
+							return noise.get_noise_2d(x, y);
+						},
+						x,
+						y
+				);
 			}
 			return get_fnl_cellular_range(noise);
 		default:
@@ -374,7 +548,14 @@ Interval get_fnl_range_3d(const ZN_FastNoiseLite &noise, Interval x, Interval y,
 	switch (noise.get_noise_type()) {
 		case ZN_FastNoiseLite::TYPE_CELLULAR:
 			if (noise.get_cellular_return_type() == ZN_FastNoiseLite::CELLULAR_RETURN_CELL_VALUE) {
-				return get_fnl_cellular_value_range_3d(noise.get_noise_internal(), x, y, z);
+				return get_fnl_cellular_value_range_3d(
+						[&noise](real_t x, real_t y, real_t z) { //
+							return noise.get_noise_3d(x, y, z);
+						},
+						x,
+						y,
+						z
+				);
 			}
 			return get_fnl_cellular_range(noise);
 		default:
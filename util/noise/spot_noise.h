@@ -1,6 +1,7 @@
 #ifndef ZN_SPOT_NOISE_H
 #define ZN_SPOT_NOISE_H
 
+#include "../containers/span.h"
 #include "../math/conv.h"
 #include "../math/interval.h"
 
@@ -102,6 +103,115 @@ inline float spot_noise_3d(vec3 pos, float cell_size, float spot_size, float jit
 	return float(ds < spot_size * spot_size);
 }
 
+// Same as `hash3`, with unsigned integers. Overflow of unsigned integers is defined, which leaves compilers free to
+// vectorize. Gives the same bits as `hash3`.
+inline uint32_t hash3_u(int x, int y, int z, int seed) {
+	const uint32_t hash = static_cast<uint32_t>(seed) ^ (static_cast<uint32_t>(x) * static_cast<uint32_t>(PRIME_X)) ^
+			(static_cast<uint32_t>(y) * static_cast<uint32_t>(PRIME_Y)) ^
+			(static_cast<uint32_t>(z) * static_cast<uint32_t>(PRIME_Z));
+	return hash * 0x27d4eb2du;
+}
+
+inline uint32_t hash2_u(int x, int y, int seed) {
+	const uint32_t hash = static_cast<uint32_t>(seed) ^ (static_cast<uint32_t>(x) * static_cast<uint32_t>(PRIME_X)) ^
+			(static_cast<uint32_t>(y) * static_cast<uint32_t>(PRIME_Y));
+	return hash * 0x27d4eb2du;
+}
+
+// Same as `static_cast<int>(Math::floor(x))`, without a call to `floorf`, which prevents compilers from vectorizing
+// loops unless specific instruction sets are enabled.
+inline int floor_to_int(float x) {
+	const int i = static_cast<int>(x);
+	return i - (x < static_cast<float>(i) ? 1 : 0);
+}
+
+// Same results as `spot_noise_2d` for each position. The loop only uses float and integer math without calls or
+// vector types, so compilers can vectorize it. Cells are hashed with a few integer operations, which is cheaper than
+// looking up a cache of spot positions.
+inline void spot_noise_2d_series(
+		Span<const float> xs,
+		Span<const float> ys,
+		Span<const float> spot_sizes,
+		const float cell_size,
+		const float jitter,
+		const int seed,
+		Span<float> out
+) {
+	const unsigned int count = out.size();
+	const float *xs_data = xs.data();
+	const float *ys_data = ys.data();
+	const float *spot_sizes_data = spot_sizes.data();
+	float *out_data = out.data();
+
+	for (unsigned int i = 0; i < count; ++i) {
+		const float x = xs_data[i];
+		const float y = ys_data[i];
+
+		const int cxi = floor_to_int(x / cell_size);
+		const float cx = static_cast<float>(cxi);
+		const int cyi = floor_to_int(y / cell_size);
+		const float cy = static_cast<float>(cyi);
+
+		const uint32_t h = hash2_u(cxi, cyi, seed);
+
+		// Same as `hash_to_vec2`
+		const float sx = Math::lerp(0.5f, static_cast<float>(h & 0xffff) / 65535.f, jitter);
+		const float sy = Math::lerp(0.5f, static_cast<float>((h >> 16) & 0xffff) / 65535.f, jitter);
+
+		const float dx = x - (cx + sx) * cell_size;
+		const float dy = y - (cy + sy) * cell_size;
+
+		const float spot_size = spot_sizes_data[i];
+		out_data[i] = (dx * dx + dy * dy) < spot_size * spot_size ? 1.f : 0.f;
+	}
+}
+
+// Same results as `spot_noise_3d` for each position. See `spot_noise_2d_series`.
+inline void spot_noise_3d_series(
+		Span<const float> xs,
+		Span<const float> ys,
+		Span<const float> zs,
+		Span<const float> spot_sizes,
+		const float cell_size,
+		const float jitter,
+		const int seed,
+		Span<float> out
+) {
+	const unsigned int count = out.size();
+	const float *xs_data = xs.data();
+	const float *ys_data = ys.data();
+	const float *zs_data = zs.data();
+	const float *spot_sizes_data = spot_sizes.data();
+	float *out_data = out.data();
+
+	for (unsigned int i = 0; i < count; ++i) {
+		const float x = xs_data[i];
+		const float y = ys_data[i];
+		const float z = zs_data[i];
+
+		const int cxi = floor_to_int(x / cell_size);
+		const float cx = static_cast<float>(cxi);
+		const int cyi = floor_to_int(y / cell_size);
+		const float cy = static_cast<float>(cyi);
+		const int czi = floor_to_int(z / cell_size);
+		const float cz = static_cast<float>(czi);
+
+		const uint32_t h = hash3_u(cxi, cyi, czi, seed);
+
+		// Same as `hash_to_vec3`
+		const float sx = Math::lerp(0.5f, static_cast<float>(h & 0x3ff) / 1024.f, jitter);
+		const float sy = Math::lerp(0.5f, static_cast<float>((h >> 10) & 0x3ff) / 1024.f, jitter);
+		const float sz = Math::lerp(0.5f, static_cast<float>((h >> 20) & 0x3ff) / 1024.f, jitter);
+
+		const float dx = x - (cx + sx) * cell_size;
+		const float dy = y - (cy + sy) * cell_size;
+		const float dz = z - (cz + sz) * cell_size;
+
+		const float spot_size = spot_sizes_data[i];
+		out_data[i] = (dx * dx + dy * dy + dz * dz) < spot_size * spot_size ? 1.f : 0.f;
+	}
+}
+
 inline bool box_intersects(Vector2f a_min, Vector2f a_max, Vector2f b_min, Vector2f b_max) {
 	if (a_min.x >= b_max.x) {
 		return false;
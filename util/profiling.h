@@ -1,6 +1,24 @@
 #ifndef ZN_PROFILING_H
 #define ZN_PROFILING_H
 
+// Named scopes and thread names are also fed to the built-in light profiler, which can be used without Tracy.
+#if defined(ZN_LIGHT_PROFILER_ENABLED)
+
+#include "light_profiler.h"
+
+#define ZN_INTERNAL_LIGHT_PROFILE_SCOPE_NAMED(name) ZN_LIGHT_PROFILE_SCOPE_NAMED(name)
+#define ZN_INTERNAL_LIGHT_PROFILE_SET_THREAD_NAME(name) zylann::light_profiler::set_thread_name(name)
+// Counters are only available with the light profiler. Name must be a string literal.
+#define ZN_PROFILE_COUNTER_ADD(name, value) ZN_LIGHT_PROFILE_COUNTER_ADD(name, value)
+
+#else
+
+#define ZN_INTERNAL_LIGHT_PROFILE_SCOPE_NAMED(name)
+#define ZN_INTERNAL_LIGHT_PROFILE_SET_THREAD_NAME(name)
+#define ZN_PROFILE_COUNTER_ADD(name, value)
+
+#endif
+
 #if defined(TRACY_ENABLE)
 
 #include <tracy/Tracy.hpp>
@@ -8,9 +26,13 @@
 #define ZN_PROFILER_ENABLED
 
 #define ZN_PROFILE_SCOPE() ZoneScoped
-#define ZN_PROFILE_SCOPE_NAMED(name) ZoneScopedN(name)
+#define ZN_PROFILE_SCOPE_NAMED(name)                                                                                   \
+	ZoneScopedN(name);                                                                                                 \
+	ZN_INTERNAL_LIGHT_PROFILE_SCOPE_NAMED(name)
 #define ZN_PROFILE_MARK_FRAME() FrameMark
-#define ZN_PROFILE_SET_THREAD_NAME(name) tracy::SetThreadName(name)
+#define ZN_PROFILE_SET_THREAD_NAME(name)                                                                               \
+	tracy::SetThreadName(name);                                                                                        \
+	ZN_INTERNAL_LIGHT_PROFILE_SET_THREAD_NAME(name)
 #define ZN_PROFILE_PLOT(name, number) TracyPlot(name, number)
 #define ZN_PROFILE_MESSAGE(message) TracyMessageL(message)
 #define ZN_PROFILE_MESSAGE_DYN(message, size) TracyMessage(message, size)
@@ -19,7 +41,7 @@
 
 #define ZN_PROFILE_SCOPE()
 // Name must be static const char* (usually string litteral)
-#define ZN_PROFILE_SCOPE_NAMED(name)
+#define ZN_PROFILE_SCOPE_NAMED(name) ZN_INTERNAL_LIGHT_PROFILE_SCOPE_NAMED(name)
 #define ZN_PROFILE_MARK_FRAME()
 #define ZN_PROFILE_PLOT(name, number)
 #define ZN_PROFILE_MESSAGE(message)
@@ -27,7 +49,7 @@
 // Size does not include the terminating character.
 #define ZN_PROFILE_MESSAGE_DYN(message, size)
 // Name must be const char*. An internal copy will be made so it can be temporary.
-#define ZN_PROFILE_SET_THREAD_NAME(name)
+#define ZN_PROFILE_SET_THREAD_NAME(name) ZN_INTERNAL_LIGHT_PROFILE_SET_THREAD_NAME(name)
 
 #endif
 
@@ -39,8 +39,7 @@ AsyncDependencyTracker::~AsyncDependencyTracker() {
 	// ownership on them, so we have to clean them up.
 	for (auto it = _next_tasks.begin(); it != _next_tasks.end(); ++it) {
 		IThreadedTask *task = *it;
-		// TODO Might want to allow customizing that, maybe calling a `->dispose()` function instead?
-		ZN_DELETE(task);
+		task->dispose();
 	}
 }
 
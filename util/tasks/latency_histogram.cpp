@@ -0,0 +1,79 @@
+#include "latency_histogram.h"
+#include "../math/funcs.h"
+
+namespace zylann {
+
+namespace {
+
+inline unsigned int get_msb_index(uint64_t v) {
+	unsigned int i = 0;
+	while (v >>= 1) {
+		++i;
+	}
+	return i;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+	clear();
+}
+
+void LatencyHistogram::add(uint64_t duration_usec) {
+	++_buckets[get_bucket_index(duration_usec)];
+	++_count;
+}
+
+uint64_t LatencyHistogram::get_percentile_usec(float ratio) const {
+	// Counts can change while we read them, so the total is computed from buckets
+	FixedArray<uint32_t, BUCKET_COUNT> counts;
+	uint64_t total = 0;
+	for (unsigned int i = 0; i < _buckets.size(); ++i) {
+		counts[i] = _buckets[i];
+		total += counts[i];
+	}
+	if (total == 0) {
+		return 0;
+	}
+
+	const uint64_t rank = math::max(static_cast<uint64_t>(math::clamp(ratio, 0.f, 1.f) * total), uint64_t(1));
+	uint64_t sum = 0;
+	for (unsigned int i = 0; i < counts.size(); ++i) {
+		sum += counts[i];
+		if (sum >= rank) {
+			return get_bucket_max_usec(i);
+		}
+	}
+	return get_bucket_max_usec(BUCKET_COUNT - 1);
+}
+
+void LatencyHistogram::clear() {
+	for (std::atomic_uint32_t &bucket : _buckets) {
+		bucket = 0;
+	}
+	_count = 0;
+}
+
+// Small durations get one bucket each. Larger ones go in a power of two range, subdivided by the next most
+// significant bits.
+unsigned int LatencyHistogram::get_bucket_index(uint64_t duration_usec) {
+	if (duration_usec < SUB_BUCKET_COUNT) {
+		return duration_usec;
+	}
+	const unsigned int msb = get_msb_index(duration_usec);
+	const unsigned int sub_bucket = (duration_usec >> (msb - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+	const unsigned int index = (msb - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket;
+	return math::min(index, BUCKET_COUNT - 1);
+}
+
+uint64_t LatencyHistogram::get_bucket_max_usec(unsigned int bucket_index) {
+	if (bucket_index < SUB_BUCKET_COUNT) {
+		return bucket_index;
+	}
+	const unsigned int msb = bucket_index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+	const unsigned int sub_bucket = bucket_index % SUB_BUCKET_COUNT;
+	const uint64_t min_usec = static_cast<uint64_t>(SUB_BUCKET_COUNT + sub_bucket) << (msb - SUB_BUCKET_BITS);
+	return min_usec + (uint64_t(1) << (msb - SUB_BUCKET_BITS)) - 1;
+}
+
+} // namespace zylann
@@ -0,0 +1,51 @@
+#ifndef ZN_LATENCY_HISTOGRAM_H
+#define ZN_LATENCY_HISTOGRAM_H
+
+#include "../containers/fixed_array.h"
+#include <atomic>
+#include <cstdint>
+
+namespace zylann {
+
+// Counts durations in buckets of exponentially increasing size, in order to estimate percentiles with a precision
+// of about 25%, using fixed memory. Thread-safe.
+class LatencyHistogram {
+public:
+	// Each power of two is split into this many buckets
+	static constexpr unsigned int SUB_BUCKET_BITS = 2;
+	static constexpr unsigned int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	// Enough to count up to an hour in microseconds
+	static constexpr unsigned int BUCKET_COUNT = 32 * SUB_BUCKET_COUNT;
+
+	LatencyHistogram();
+
+	void add(uint64_t duration_usec);
+
+	// Gets the duration below which the given ratio of durations were counted (for example, 0.95 for P95).
+	// Returns 0 if nothing was counted.
+	uint64_t get_percentile_usec(float ratio) const;
+
+	uint64_t get_count() const {
+		return _count;
+	}
+
+	void clear();
+
+	static unsigned int get_bucket_index(uint64_t duration_usec);
+	// Gets the largest duration the bucket can count
+	static uint64_t get_bucket_max_usec(unsigned int bucket_index);
+
+private:
+	FixedArray<std::atomic_uint32_t, BUCKET_COUNT> _buckets;
+	std::atomic_uint64_t _count;
+};
+
+// Latency of a type of task, from when it gets scheduled to when it starts running, and how long it runs
+struct TaskLatencyStats {
+	LatencyHistogram wait;
+	LatencyHistogram run;
+};
+
+} // namespace zylann
+
+#endif // ZN_LATENCY_HISTOGRAM_H
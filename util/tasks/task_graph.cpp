@@ -0,0 +1,212 @@
+#include "task_graph.h"
+#include "../containers/container_funcs.h"
+#include "../errors.h"
+#include "../memory/memory.h"
+#include "threaded_task_runner.h"
+
+namespace zylann {
+
+// Wraps tasks of the graph so the runner can release their dependents when they complete
+class TaskGraph::NodeTask : public IThreadedTask {
+public:
+	NodeTask(IThreadedTask *task, NodeID id) : _task(task), _id(id) {}
+
+	~NodeTask() {
+		if (_graph != nullptr && !_ran) {
+			// Dropped without running, tasks depending on it won't get what they need
+			_graph->release_dependents(_id, true, nullptr);
+		}
+		_task->dispose();
+	}
+
+	void run(ThreadedTaskContext &ctx) override {
+		ThreadedTaskContext task_ctx(ctx.thread_index, ctx.task_priority);
+		_task->run(task_ctx);
+
+		ZN_ASSERT_MSG(task_ctx.status != ThreadedTaskContext::STATUS_TAKEN_OUT,
+				"Tasks of a TaskGraph can't be taken out");
+		ZN_ASSERT_MSG(task_ctx.next_immediate_task == nullptr,
+				"Tasks of a TaskGraph can't have immediate tasks, use dependencies instead");
+
+		if (task_ctx.status == ThreadedTaskContext::STATUS_POSTPONED) {
+			ctx.status = ThreadedTaskContext::STATUS_POSTPONED;
+			return;
+		}
+
+		_ran = true;
+		_graph->release_dependents(_id, false, &ctx.next_immediate_task);
+	}
+
+	void apply_result() override {
+		if (_ran || _cancelled_itself) {
+			_task->apply_result();
+		}
+	}
+
+	TaskPriority get_priority() override {
+		return _task->get_priority();
+	}
+
+	bool is_cancelled() override {
+		if (_graph->is_cancelled(_id)) {
+			return true;
+		}
+		if (_task->is_cancelled()) {
+			// The runner won't run it, but the task may still want its result to be applied
+			_cancelled_itself = true;
+			return true;
+		}
+		return false;
+	}
+
+	const char *get_debug_name() const override {
+		return _task->get_debug_name();
+	}
+
+	int get_latency_category() const override {
+		return _task->get_latency_category();
+	}
+
+	int get_group() const override {
+		return _task->get_group();
+	}
+
+	// Set when the graph is scheduled
+	std::shared_ptr<TaskGraph> _graph;
+
+private:
+	IThreadedTask *_task;
+	NodeID _id;
+	bool _ran = false;
+	bool _cancelled_itself = false;
+};
+
+TaskGraph::TaskGraph(ThreadedTaskRunner &runner) : _runner(runner) {}
+
+TaskGraph::~TaskGraph() {
+	// Tasks remaining here were never released, which only happens if the graph was not scheduled
+	for (Node &node : _nodes) {
+		ZN_DELETE(node.task);
+	}
+}
+
+TaskGraph::NodeID TaskGraph::add_task(IThreadedTask *task) {
+	ZN_ASSERT(task != nullptr);
+	ZN_ASSERT_MSG(!_scheduled, "Can't add tasks to a graph after it was scheduled");
+	const NodeID id = _nodes.size();
+	_nodes.push_back(Node());
+	_nodes.back().task = ZN_NEW(NodeTask(task, id));
+	return id;
+}
+
+void TaskGraph::add_dependency(NodeID task_id, NodeID dependency_id) {
+	ZN_ASSERT_RETURN(task_id < _nodes.size());
+	ZN_ASSERT_RETURN(dependency_id < _nodes.size());
+	ZN_ASSERT_RETURN(task_id != dependency_id);
+	ZN_ASSERT_RETURN_MSG(!_scheduled, "Can't add dependencies to a graph after it was scheduled");
+	_nodes[dependency_id].dependents.push_back(task_id);
+	++_nodes[task_id].dependency_count;
+}
+
+void TaskGraph::schedule(std::shared_ptr<TaskGraph> graph) {
+	ZN_ASSERT_RETURN(graph != nullptr);
+	ZN_ASSERT_RETURN_MSG(!graph->_scheduled, "Graph was already scheduled");
+
+	TaskGraph &g = *graph;
+
+	unsigned int root_count = 0;
+	for (const Node &node : g._nodes) {
+		if (node.dependency_count == 0) {
+			++root_count;
+		}
+	}
+	ZN_ASSERT_RETURN_MSG(root_count > 0 || g._nodes.size() == 0, "Dependencies form a cycle");
+
+	g._scheduled = true;
+
+	// Atomics can't be moved, so the array is built at once
+	StdVector<NodeState> states(g._nodes.size());
+	g._states.swap(states);
+	g._remaining_task_count = g._nodes.size();
+
+	StdVector<IThreadedTask *> root_tasks;
+	root_tasks.reserve(root_count);
+	for (unsigned int id = 0; id < g._nodes.size(); ++id) {
+		Node &node = g._nodes[id];
+		node.task->_graph = graph;
+		g._states[id].remaining_dependencies = node.dependency_count;
+		if (node.dependency_count == 0) {
+			root_tasks.push_back(node.task);
+			node.task = nullptr;
+		}
+	}
+
+	g._runner.enqueue(to_span(root_tasks), false);
+}
+
+void TaskGraph::cancel(NodeID id) {
+	ZN_ASSERT_RETURN(id < _nodes.size());
+	ZN_ASSERT_RETURN_MSG(_scheduled, "Graph must be scheduled before cancelling tasks");
+
+	StdVector<NodeID> to_visit;
+	to_visit.push_back(id);
+	while (to_visit.size() > 0) {
+		const NodeID visited_id = to_visit.back();
+		to_visit.pop_back();
+		if (_states[visited_id].cancelled.exchange(true)) {
+			// Already cancelled, so its dependents were as well
+			continue;
+		}
+		// Dependents are not modified after scheduling, so they can be read from any thread
+		append_array(to_visit, _nodes[visited_id].dependents);
+	}
+}
+
+void TaskGraph::cancel_all() {
+	ZN_ASSERT_RETURN_MSG(_scheduled, "Graph must be scheduled before cancelling tasks");
+	for (NodeState &state : _states) {
+		state.cancelled = true;
+	}
+}
+
+bool TaskGraph::is_cancelled(NodeID id) const {
+	ZN_ASSERT_RETURN_V(id < _states.size(), false);
+	return _states[id].cancelled;
+}
+
+void TaskGraph::release_dependents(NodeID id, bool cancelled, IThreadedTask **out_immediate_task) {
+	StdVector<IThreadedTask *> ready_tasks;
+
+	for (const NodeID dependent_id : _nodes[id].dependents) {
+		NodeState &state = _states[dependent_id];
+		if (cancelled) {
+			state.cancelled = true;
+		}
+
+		if (--state.remaining_dependencies != 0) {
+			continue;
+		}
+
+		// Only the thread completing the last dependency gets here, so it is the only one to access this node
+		Node &node = _nodes[dependent_id];
+		NodeTask *task = node.task;
+		node.task = nullptr;
+
+		if (state.cancelled) {
+			// Releases its own dependents as cancelled
+			ZN_DELETE(task);
+		} else if (out_immediate_task != nullptr && *out_immediate_task == nullptr) {
+			*out_immediate_task = task;
+		} else {
+			ready_tasks.push_back(task);
+		}
+	}
+
+	if (ready_tasks.size() > 0) {
+		_runner.enqueue(to_span(ready_tasks), false);
+	}
+
+	--_remaining_task_count;
+}
+
+} // namespace zylann
@@ -0,0 +1,85 @@
+#ifndef ZYLANN_TASK_GRAPH_H
+#define ZYLANN_TASK_GRAPH_H
+
+#include "../containers/std_vector.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace zylann {
+
+class IThreadedTask;
+class ThreadedTaskRunner;
+
+// Runs tasks in an order respecting dependencies between them, without going through the main thread in between.
+// When a task completes, tasks that were only waiting for it are released: one of them runs right after on the same
+// thread, which likely still has the data it needs in cache, and others are scheduled in the runner.
+//
+// Tasks still get their `apply_result` called by whoever dequeues completed tasks from the runner, as they complete.
+// Tasks that get cancelled before running, or depend on such tasks, are destroyed without running nor having
+// `apply_result` called, except if they cancelled themselves with `is_cancelled`, in which case the runner handles them
+// as usual.
+//
+// Tasks of a graph should not be serial, and must not use `STATUS_TAKEN_OUT` or `next_immediate_task`. Postponing is
+// supported.
+class TaskGraph {
+public:
+	typedef uint32_t NodeID;
+
+	TaskGraph(ThreadedTaskRunner &runner);
+	~TaskGraph();
+
+	// Adds a task to the graph, which takes ownership of it until it gets scheduled.
+	NodeID add_task(IThreadedTask *task);
+
+	// Makes a task wait for another one to complete before running. Dependencies must not form cycles.
+	void add_dependency(NodeID task_id, NodeID dependency_id);
+
+	// Schedules tasks that have no dependencies. Other tasks will be scheduled as their dependencies complete.
+	// The graph can't be modified after that. Tasks keep a reference to the graph, so it is not necessary to keep it.
+	static void schedule(std::shared_ptr<TaskGraph> graph);
+
+	// Cancels a task and all tasks depending on it. Tasks that are already running are not interrupted, but tasks
+	// depending on them won't run. Can be called from any thread after the graph is scheduled.
+	void cancel(NodeID id);
+	void cancel_all();
+
+	bool is_cancelled(NodeID id) const;
+
+	unsigned int get_task_count() const {
+		return _nodes.size();
+	}
+
+	// Returns `true` when every task of the graph has either completed or been cancelled.
+	bool is_finished() const {
+		return _remaining_task_count == 0;
+	}
+
+private:
+	class NodeTask;
+
+	void release_dependents(NodeID id, bool cancelled, IThreadedTask **out_immediate_task);
+
+	struct Node {
+		// Owned by the graph until released
+		NodeTask *task = nullptr;
+		StdVector<NodeID> dependents;
+		uint32_t dependency_count = 0;
+	};
+
+	struct NodeState {
+		std::atomic_uint32_t remaining_dependencies = { 0 };
+		std::atomic_bool cancelled = { false };
+	};
+
+	StdVector<Node> _nodes;
+	// Only allocated when the graph is scheduled, and never resized after that
+	StdVector<NodeState> _states;
+	std::atomic_uint32_t _remaining_task_count = { 0 };
+	ThreadedTaskRunner &_runner;
+	bool _scheduled = false;
+};
+
+} // namespace zylann
+
+#endif // ZYLANN_TASK_GRAPH_H
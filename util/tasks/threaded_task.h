@@ -1,11 +1,14 @@
 #ifndef THREADED_TASK_H
 #define THREADED_TASK_H
 
+#include "../memory/memory.h"
 #include "task_priority.h"
 #include <cstdint>
 
 namespace zylann {
 
+class IThreadedTask;
+
 struct ThreadedTaskContext {
 	enum Status : uint8_t {
 		// The task is complete and will be put in the list of completed tasks by the TaskRunner. It will be deleted
@@ -28,14 +31,15 @@ struct ThreadedTaskContext {
 	const TaskPriority task_priority;
 	// If this is set to a non-null task, it will run right after the current one on the same thread.
 	// By doing so, ownership is given to ThreadedTaskRunner. These tasks must not have been owned by the runner
-	// already. Priority of such tasks is not relevant.
-	// IThreadedTask *next_immediate_task;
+	// already. Priority of such tasks is not relevant, and they run in parallel even if the current one is serial.
+	IThreadedTask *next_immediate_task;
 
 	ThreadedTaskContext(uint8_t p_thread_index, TaskPriority p_priority) :
 			thread_index(p_thread_index),
 			// By default, if the task does not set this status, it will be considered complete after run
 			status(STATUS_COMPLETE),
-			task_priority(p_priority) {}
+			task_priority(p_priority),
+			next_immediate_task(nullptr) {}
 
 	// To allow scheduling tasks from within tasks, without having to pass it in or use a global
 	// ThreadedTaskRunner &runner;
@@ -72,6 +76,25 @@ public:
 	virtual const char *get_debug_name() const {
 		return "<unnamed>";
 	}
+
+	// Gets which latency statistics the task should be counted in, as an index lower than
+	// `ThreadedTaskRunner::MAX_LATENCY_CATEGORIES`. Returns -1 if the task should not be counted.
+	virtual int get_latency_category() const {
+		return -1;
+	}
+
+	// Gets which group the task belongs to, as an index lower than `ThreadedTaskRunner::MAX_GROUPS`. Groups get their
+	// share of threads according to settings given to the runner, regardless of how many tasks other groups have.
+	// Returns -1 if the task doesn't belong to any group, in which case it only competes by priority.
+	virtual int get_group() const {
+		return -1;
+	}
+
+	// Called by the owner of the task when it is no longer needed, instead of deleting it directly. Tasks not created
+	// with `ZN_NEW` must override this, for example to go back to their `ThreadedTaskPool`.
+	virtual void dispose() {
+		ZN_DELETE(this);
+	}
 };
 
 } // namespace zylann
@@ -0,0 +1,86 @@
+#ifndef ZN_THREADED_TASK_POOL_H
+#define ZN_THREADED_TASK_POOL_H
+
+#include "../containers/std_vector.h"
+#include "../memory/memory.h"
+#include "../thread/spin_lock.h"
+#include <cstddef>
+#include <new>
+
+namespace zylann {
+
+// Recycles memory of tasks of a given type, for tasks that get created and destroyed in large numbers (like one per
+// block). Tasks are still constructed and destroyed normally, so a recycled task starts from a clean state.
+// Tasks of a pooled type must be created with `create()`, and override `IThreadedTask::dispose()` to call `recycle()`.
+// Thread-safe.
+template <typename T>
+class ThreadedTaskPool {
+public:
+	// Beyond this amount, recycled memory is freed instead of being kept
+	static constexpr unsigned int MAX_FREE_COUNT = 4096;
+
+	static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+
+	static ThreadedTaskPool<T> &get_singleton() {
+		static ThreadedTaskPool<T> s_pool;
+		return s_pool;
+	}
+
+	~ThreadedTaskPool() {
+		for (void *mem : _free) {
+			ZN_FREE(mem);
+		}
+	}
+
+	template <typename... Types>
+	T *create(Types &&...args) {
+		void *mem = nullptr;
+		_spin_lock.lock();
+		if (_free.size() > 0) {
+			mem = _free.back();
+			_free.pop_back();
+		}
+		_spin_lock.unlock();
+
+		if (mem == nullptr) {
+			mem = ZN_ALLOC(sizeof(T));
+		}
+		return new (mem) T(std::forward<Types>(args)...);
+	}
+
+	void recycle(T *task) {
+		task->~T();
+		void *mem = task;
+
+		_spin_lock.lock();
+		if (_free.size() < MAX_FREE_COUNT) {
+			// Capacity was reserved so this does not allocate while locked
+			_free.push_back(mem);
+			mem = nullptr;
+		}
+		_spin_lock.unlock();
+
+		if (mem != nullptr) {
+			ZN_FREE(mem);
+		}
+	}
+
+	unsigned int get_free_count() const {
+		_spin_lock.lock();
+		const unsigned int count = _free.size();
+		_spin_lock.unlock();
+		return count;
+	}
+
+private:
+	ThreadedTaskPool() {
+		_free.reserve(MAX_FREE_COUNT);
+	}
+
+	StdVector<void *> _free;
+	mutable SpinLock _spin_lock;
+};
+
+} // namespace zylann
+
+#endif // ZN_THREADED_TASK_POOL_H
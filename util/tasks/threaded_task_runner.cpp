@@ -1,11 +1,60 @@
 #include "threaded_task_runner.h"
 #include "../dstack.h"
 #include "../godot/classes/time.h"
+#include "../math/funcs.h"
 #include "../profiling.h"
 #include "../string/format.h"
+#include <algorithm>
 
 namespace zylann {
 
+namespace {
+
+// Serial tasks already run one at a time, so they are not grouped
+inline int8_t get_task_group(const IThreadedTask &task, bool serial) {
+	if (serial) {
+		return -1;
+	}
+	const int group = task.get_group();
+	ZN_ASSERT_RETURN_V(group < static_cast<int>(ThreadedTaskRunner::MAX_GROUPS), -1);
+	return group < 0 ? -1 : group;
+}
+
+// Parked threads don't wait on the task semaphore, because there is no way to wake up one specific thread with it
+const uint32_t PARKED_THREAD_POLL_PERIOD_USEC = 4000;
+
+struct TaskComparator {
+	template <typename TaskItem>
+	inline bool operator()(const TaskItem &a, const TaskItem &b) const {
+		// Tasks with highest priority come first in heaps
+		return a.cached_priority < b.cached_priority;
+	}
+};
+
+// Locks a mutex like MutexLock, and measures how long it waited if the mutex was already locked
+class TimedMutexLock {
+public:
+	TimedMutexLock(const Mutex &mutex, std::atomic_uint64_t &contended_count, std::atomic_uint64_t &wait_usec) :
+			_mutex(mutex) {
+		if (_mutex.try_lock()) {
+			return;
+		}
+		const uint64_t begin_usec = Time::get_singleton()->get_ticks_usec();
+		_mutex.lock();
+		wait_usec += Time::get_singleton()->get_ticks_usec() - begin_usec;
+		++contended_count;
+	}
+
+	~TimedMutexLock() {
+		_mutex.unlock();
+	}
+
+private:
+	const Mutex &_mutex;
+};
+
+} // namespace
+
 ThreadedTaskRunner::ThreadedTaskRunner() {}
 
 ThreadedTaskRunner::~ThreadedTaskRunner() {
@@ -15,13 +64,13 @@ ThreadedTaskRunner::~ThreadedTaskRunner() {
 	if (_staged_tasks.size() != 0) {
 		ZN_PRINT_ERROR("There are staged tasks remaining!");
 	}
-	if (_tasks.size() != 0) {
+	if (_tasks.size() != 0 || _serial_tasks.size() != 0 || _grouped_task_count != 0) {
 		ZN_PRINT_ERROR("There are tasks remaining!");
 	}
 	if (_spinning_tasks.size() != 0) {
 		ZN_PRINT_ERROR("There are spinning tasks remaining!");
 	}
-	if (_completed_tasks.size() != 0) {
+	if (!_completed_tasks.is_empty()) {
 		ZN_PRINT_ERROR("There are completed tasks remaining!");
 	}
 }
@@ -34,6 +83,10 @@ void ThreadedTaskRunner::create_thread(ThreadData &d, uint32_t i) {
 	if (!_name.empty()) {
 		d.name = format("{} {}", _name, i);
 	}
+	d.cpu_affinity.clear();
+	if (_cpu_affinity_groups.size() > 0) {
+		d.cpu_affinity = _cpu_affinity_groups[i % _cpu_affinity_groups.size()];
+	}
 	d.thread.start(thread_func_static, &d);
 }
 
@@ -85,6 +138,15 @@ void ThreadedTaskRunner::set_name(const char *name) {
 	_name = name;
 }
 
+void ThreadedTaskRunner::set_cpu_affinity_groups(Span<const StdVector<uint32_t>> groups) {
+	_cpu_affinity_groups.clear();
+	for (const StdVector<uint32_t> &group : groups) {
+		if (group.size() > 0) {
+			_cpu_affinity_groups.push_back(group);
+		}
+	}
+}
+
 void ThreadedTaskRunner::set_thread_count(uint32_t count) {
 	if (count > MAX_THREADS) {
 		count = MAX_THREADS;
@@ -95,20 +157,63 @@ void ThreadedTaskRunner::set_thread_count(uint32_t count) {
 		create_thread(d, i);
 	}
 	_thread_count = count;
+	_thread_limit = count;
+}
+
+void ThreadedTaskRunner::set_thread_limit(uint32_t count) {
+	// At least one thread must keep running, otherwise tasks would never complete
+	_thread_limit = math::min(math::max(count, uint32_t(1)), _thread_count);
+}
+
+void ThreadedTaskRunner::set_group_settings(uint32_t group, GroupSettings settings) {
+	ZN_ASSERT_RETURN(group < MAX_GROUPS);
+	settings.weight = math::max(settings.weight, uint32_t(1));
+	MutexLock lock(_tasks_mutex);
+	_groups[group].settings = settings;
+}
+
+ThreadedTaskRunner::GroupSettings ThreadedTaskRunner::get_group_settings(uint32_t group) const {
+	ZN_ASSERT_RETURN_V(group < MAX_GROUPS, GroupSettings());
+	MutexLock lock(_tasks_mutex);
+	return _groups[group].settings;
+}
+
+void ThreadedTaskRunner::reset_group(uint32_t group) {
+	ZN_ASSERT_RETURN(group < MAX_GROUPS);
+	MutexLock lock(_tasks_mutex);
+	Group &g = _groups[group];
+	g.settings = GroupSettings();
+	g.completed_count = 0;
+}
+
+ThreadedTaskRunner::GroupStats ThreadedTaskRunner::get_group_stats(uint32_t group) const {
+	ZN_ASSERT_RETURN_V(group < MAX_GROUPS, GroupStats());
+	const Group &g = _groups[group];
+	GroupStats stats;
+	stats.pending = g.pending_count;
+	stats.running = g.running_count;
+	stats.completed = g.completed_count;
+	return stats;
 }
 
 void ThreadedTaskRunner::set_priority_update_period(uint32_t milliseconds) {
 	_priority_update_period_ms = milliseconds;
 }
 
+void ThreadedTaskRunner::request_priority_update() {
+	_priority_update_requested = true;
+}
+
 void ThreadedTaskRunner::enqueue(IThreadedTask *task, bool serial) {
 	ZN_PROFILE_SCOPE();
 	ZN_ASSERT(task != nullptr);
 	TaskItem t;
 	t.task = task;
 	t.is_serial = serial;
+	t.group = get_task_group(*task, serial);
+	t.enqueue_time_usec = Time::get_singleton()->get_ticks_usec();
 	{
-		MutexLock lock(_staged_tasks_mutex);
+		TimedMutexLock lock(_staged_tasks_mutex, _lock_contended_count, _lock_wait_usec);
 		_staged_tasks.push_back(t);
 		++_debug_received_tasks;
 
@@ -127,8 +232,9 @@ void ThreadedTaskRunner::enqueue(Span<IThreadedTask *> new_tasks, bool serial) {
 		ZN_ASSERT(new_tasks[i] != nullptr);
 	}
 #endif
+	const uint64_t now_usec = Time::get_singleton()->get_ticks_usec();
 	{
-		MutexLock lock(_staged_tasks_mutex);
+		TimedMutexLock lock(_staged_tasks_mutex, _lock_contended_count, _lock_wait_usec);
 		const size_t dst_begin = _staged_tasks.size();
 		_staged_tasks.resize(_staged_tasks.size() + new_tasks.size());
 		for (size_t i = 0; i < new_tasks.size(); ++i) {
@@ -136,6 +242,8 @@ void ThreadedTaskRunner::enqueue(Span<IThreadedTask *> new_tasks, bool serial) {
 			TaskItem t;
 			t.task = new_task;
 			t.is_serial = serial;
+			t.group = get_task_group(*new_task, serial);
+			t.enqueue_time_usec = now_usec;
 			_staged_tasks[dst_begin + i] = t;
 
 #ifdef ZN_THREADED_TASK_RUNNER_CHECK_DUPLICATE_TASKS
@@ -163,6 +271,12 @@ void ThreadedTaskRunner::thread_func_static(void *p_data) {
 #endif
 	}
 
+	if (data.cpu_affinity.size() > 0) {
+		if (!Thread::set_cpu_affinity(to_span(data.cpu_affinity))) {
+			ZN_PRINT_WARNING(format("Could not set CPU affinity of thread {}", data.index));
+		}
+	}
+
 	pool.thread_func(data);
 }
 
@@ -170,10 +284,25 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 	data.debug_state = STATE_RUNNING;
 
 	StdVector<TaskItem> tasks;
+	StdVector<TaskItem> staged_tasks;
 	StdVector<TaskItem> postponed_tasks;
 	StdVector<IThreadedTask *> cancelled_tasks;
+	StdVector<IThreadedTask *> completed_tasks;
 
 	while (!data.stop) {
+		if (data.index >= _thread_limit) {
+			// Parked. The thread may have been woken up for a task it will not pick, so another thread has to be
+			// woken up instead.
+			_tasks_semaphore.post();
+			data.debug_state = STATE_PARKED;
+			data.waiting = true;
+			while (data.index >= _thread_limit && !data.stop) {
+				Thread::sleep_usec(PARKED_THREAD_POLL_PERIOD_USEC);
+			}
+			data.waiting = false;
+			continue;
+		}
+
 		bool is_running_serial_task = false;
 		bool task_queue_was_empty = false;
 		{
@@ -190,86 +319,103 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 			// TODO What if postponed tasks remain while one big task is locking what they need to access?
 			// Those postponed tasks will sort of spinlock with no sleeping. Is that a bad thing?
 			{
-				MutexLock lock2(_spinning_tasks_mutex);
+				TimedMutexLock lock2(_spinning_tasks_mutex, _lock_contended_count, _lock_wait_usec);
 				if (_spinning_tasks.size() > 0) {
 					tasks.push_back(_spinning_tasks.front());
 					_spinning_tasks.pop();
 				}
 			}
 
+			// Move tasks from the staging queue.
+			// Lock with minimal risk of blocking the main thread, it should be very short.
+			if (_staged_tasks_mutex.try_lock()) {
+				append_array(staged_tasks, _staged_tasks);
+				_staged_tasks.clear();
+				_staged_tasks_mutex.unlock();
+			}
+			if (staged_tasks.size() > 0) {
+				// Polling priorities can be expensive when a lot of tasks get scheduled at once, so it is done before
+				// locking the main queues.
+				update_priorities(staged_tasks, cancelled_tasks);
+			}
+
 			{
-				// TODO When tasks are very short and there are a lot of tasks, one thread can monopolize this mutex.
-				//
-				MutexLock lock(_tasks_mutex);
-
-				// Move tasks from the staging queue.
-				// Lock with minimal risk of blocking the main thread, it should be very short.
-				if (_staged_tasks_mutex.try_lock()) {
-					append_array(_tasks, _staged_tasks);
-					_staged_tasks.clear();
-					_staged_tasks_mutex.unlock();
+				// Picking up a task only takes logarithmic time, so threads don't hold this mutex for long even with
+				// lots of waiting tasks. Updating priorities is linear, but it only happens periodically.
+				TimedMutexLock lock(_tasks_mutex, _lock_contended_count, _lock_wait_usec);
+
+				for (const TaskItem &item : staged_tasks) {
+					StdVector<TaskItem> *heap = &_tasks;
+					if (item.is_serial) {
+						heap = &_serial_tasks;
+					} else if (item.group >= 0) {
+						Group &group = _groups[item.group];
+						heap = &group.tasks;
+						++group.pending_count;
+						++_grouped_task_count;
+						_used_group_count = math::max(_used_group_count, uint32_t(item.group + 1));
+					}
+					heap->push_back(item);
+					std::push_heap(heap->begin(), heap->end(), TaskComparator());
 				}
+				staged_tasks.clear();
 
-				// Pick best tasks from the prioritized queue
-				if (_tasks.size() != 0) {
-					// Sort periodically.
-					// The point to keep sorting after tasks have been inserted is in case there are lots of pending
+				if (_tasks.size() != 0 || _serial_tasks.size() != 0 || _grouped_task_count != 0) {
+					// Update priorities periodically.
+					// The point to keep updating after tasks have been inserted is in case there are lots of pending
 					// tasks, which can take more than a few seconds to be processed. A player can move fast and the
 					// priority location can change. Some tasks can even become irrelevant before they are run,so we
 					// may remove them from the list so they don't slow down the process.
 					const uint64_t now = Time::get_singleton()->get_ticks_msec();
-					if (now - _last_priority_update_time_ms > _priority_update_period_ms) {
-						ZN_PROFILE_SCOPE_NAMED("Sorting");
-
-						{
-							ZN_PROFILE_SCOPE_NAMED("Update priorities");
-							for (unsigned int i = 0; i < _tasks.size();) {
-								TaskItem &item = _tasks[i];
-								item.cached_priority = item.task->get_priority();
-
-								if (item.task->is_cancelled()) {
-									cancelled_tasks.push_back(item.task);
-									_tasks[i] = _tasks.back();
-									_tasks.pop_back();
-									continue;
-								}
-
-								++i;
+					const bool update_requested = _priority_update_requested.exchange(false);
+					if (update_requested || now - _last_priority_update_time_ms > _priority_update_period_ms) {
+						ZN_PROFILE_SCOPE_NAMED("Update priorities");
+
+						update_priorities(_tasks, cancelled_tasks);
+						update_priorities(_serial_tasks, cancelled_tasks);
+						std::make_heap(_tasks.begin(), _tasks.end(), TaskComparator());
+						std::make_heap(_serial_tasks.begin(), _serial_tasks.end(), TaskComparator());
+
+						for (uint32_t group_index = 0; group_index < _used_group_count; ++group_index) {
+							Group &group = _groups[group_index];
+							if (group.tasks.size() == 0) {
+								continue;
 							}
+							const size_t count_before = group.tasks.size();
+							update_priorities(group.tasks, cancelled_tasks);
+							std::make_heap(group.tasks.begin(), group.tasks.end(), TaskComparator());
+							const uint32_t cancelled_count = count_before - group.tasks.size();
+							group.pending_count -= cancelled_count;
+							_grouped_task_count -= cancelled_count;
 						}
 
-						struct TaskComparator {
-							inline bool operator()(const TaskItem &a, const TaskItem &b) const {
-								// Tasks with highest priority come last (easier pop back)
-								return a.cached_priority < b.cached_priority;
-							}
-						};
-						SortArray<TaskItem, TaskComparator> sorter;
-						sorter.sort(_tasks.data(), _tasks.size());
-
 						_last_priority_update_time_ms = Time::get_singleton()->get_ticks_msec();
 					}
 
-					// Pick task with highest priority if possible
-					// for (int i = int(_tasks.size()) - 1; i >= 0; --i) {
-					for (unsigned int i = _tasks.size(); i-- > 0;) {
-						const TaskItem item = _tasks[i];
-						// Serial tasks are a bit annoying in that regard...
-						// We could make the save/load tasks accept more than one work, which is the best way to do
-						// serial work, but in some cases it's harder to know in advance...
-						if (item.is_serial && _is_serial_task_running) {
-							// Try previous task
-							continue;
+					// Pick task with highest priority if possible.
+					// Serial tasks are a bit annoying in that regard...
+					// We could make the save/load tasks accept more than one work, which is the best way to do
+					// serial work, but in some cases it's harder to know in advance...
+					StdVector<TaskItem> *parallel_heap = pick_parallel_heap();
+					const bool pick_serial = _serial_tasks.size() != 0 && !_is_serial_task_running &&
+							(parallel_heap == nullptr ||
+							 !(_serial_tasks.front().cached_priority < parallel_heap->front().cached_priority));
+					StdVector<TaskItem> *heap = pick_serial ? &_serial_tasks : parallel_heap;
+
+					if (heap != nullptr) {
+						std::pop_heap(heap->begin(), heap->end(), TaskComparator());
+						TaskItem &item = heap->back();
+						if (heap != &_tasks && heap != &_serial_tasks) {
+							Group &group = _groups[item.group];
+							--group.pending_count;
+							++group.running_count;
+							--_grouped_task_count;
+							item.running_in_group = true;
 						}
-
 						tasks.push_back(item);
-						// We don't just pop the last item because of serial task handling. But ordered removal should
-						// be fast enough since serial tasks aren't common.
-						_tasks.erase(_tasks.begin() + i);
-						break;
+						heap->pop_back();
 					}
-
-				} // For each task to pick
+				}
 
 				// If we picked up a serial task, we must set the shared boolean to `true`.
 				// More than one serial task can be in the list of tasks the current thread picks up,
@@ -287,16 +433,14 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 					}
 				}
 
-				task_queue_was_empty = _tasks.size() == 0;
+				task_queue_was_empty = _tasks.size() == 0 && _serial_tasks.size() == 0 && _grouped_task_count == 0;
 
 			} // Tasks queue mutex lock
 		}
 
 		if (cancelled_tasks.size() > 0) {
-			MutexLock lock(_completed_tasks_mutex);
-			const size_t count = cancelled_tasks.size();
-			append_array(_completed_tasks, cancelled_tasks);
-			_debug_completed_tasks += count;
+			_debug_completed_tasks += cancelled_tasks.size();
+			_completed_tasks.push(data.index, to_span(cancelled_tasks));
 			cancelled_tasks.clear();
 		}
 
@@ -325,14 +469,34 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 		} else {
 			data.debug_state = STATE_RUNNING;
 
-			// Run each task
+			unsigned int immediate_task_count = 0;
+
+			// Run each task. Tasks can add more to run right after them.
 			for (size_t i = 0; i < tasks.size(); ++i) {
 				TaskItem &item = tasks[i];
 
 				if (!item.task->is_cancelled()) {
 					ThreadedTaskContext ctx(data.index, item.cached_priority);
 					data.debug_running_task_name = item.task->get_debug_name();
+
+					// Obtained before running, because tasks taken out may be deleted by another thread after that
+					const int latency_category = item.task->get_latency_category();
+					uint64_t start_time_usec = 0;
+					if (latency_category >= 0) {
+						ZN_ASSERT(latency_category < static_cast<int>(MAX_LATENCY_CATEGORIES));
+						start_time_usec = Time::get_singleton()->get_ticks_usec();
+						if (!item.started) {
+							_latency_stats[latency_category].wait.add(start_time_usec - item.enqueue_time_usec);
+						}
+					}
+					item.started = true;
+
 					item.task->run(ctx);
+
+					if (latency_category >= 0 && ctx.status == ThreadedTaskContext::STATUS_COMPLETE) {
+						_latency_stats[latency_category].run.add(
+								Time::get_singleton()->get_ticks_usec() - start_time_usec);
+					}
 #ifdef ZN_THREADED_TASK_RUNNER_CHECK_DUPLICATE_TASKS
 					if (ctx.status == ThreadedTaskContext::STATUS_TAKEN_OUT) {
 						debug_remove_owned_task(item.task);
@@ -341,16 +505,29 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 					item.status = ctx.status;
 					data.debug_running_task_name = nullptr;
 
-					/*
 					if (ctx.next_immediate_task != nullptr) {
 						TaskItem next;
 						next.task = ctx.next_immediate_task;
+						next.cached_priority = item.cached_priority;
+						next.enqueue_time_usec = Time::get_singleton()->get_ticks_usec();
 #ifdef ZN_THREADED_TASK_RUNNER_CHECK_DUPLICATE_TASKS
 						debug_add_owned_task(next.task);
 #endif
+						// Note, this invalidates `item`
 						tasks.push_back(next);
+						++immediate_task_count;
 					}
-					*/
+				}
+
+				TaskItem &ran_item = tasks[i];
+				if (ran_item.running_in_group) {
+					// Postponed tasks run again from the queue of spinning tasks, which ignores groups
+					Group &group = _groups[ran_item.group];
+					--group.running_count;
+					if (ran_item.status == ThreadedTaskContext::STATUS_COMPLETE) {
+						++group.completed_count;
+					}
+					ran_item.running_in_group = false;
 				}
 			}
 
@@ -363,36 +540,42 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 				_is_serial_task_running = false;
 			}
 
-			{
-				MutexLock lock(_completed_tasks_mutex);
-				for (size_t i = 0; i < tasks.size(); ++i) {
-					const TaskItem &item = tasks[i];
-					switch (item.status) {
-						case ThreadedTaskContext::STATUS_COMPLETE:
-							_completed_tasks.push_back(item.task);
-							++_debug_completed_tasks;
-							break;
+			_debug_immediate_tasks += immediate_task_count;
+			unsigned int taken_out_count = 0;
 
-						case ThreadedTaskContext::STATUS_POSTPONED:
-							postponed_tasks.push_back(item);
-							break;
+			for (size_t i = 0; i < tasks.size(); ++i) {
+				const TaskItem &item = tasks[i];
+				switch (item.status) {
+					case ThreadedTaskContext::STATUS_COMPLETE:
+						completed_tasks.push_back(item.task);
+						break;
 
-						case ThreadedTaskContext::STATUS_TAKEN_OUT:
-							// Drop task pointer, its ownership may have been passed to another task
-							++_debug_taken_out_tasks;
-							break;
+					case ThreadedTaskContext::STATUS_POSTPONED:
+						postponed_tasks.push_back(item);
+						break;
 
-						default:
-							ZN_PRINT_ERROR("Unknown task status");
-							break;
-					}
+					case ThreadedTaskContext::STATUS_TAKEN_OUT:
+						// Drop task pointer, its ownership may have been passed to another task
+						++taken_out_count;
+						break;
+
+					default:
+						ZN_PRINT_ERROR("Unknown task status");
+						break;
 				}
 			}
 
 			tasks.clear();
 
+			_debug_taken_out_tasks += taken_out_count;
+			if (completed_tasks.size() > 0) {
+				_debug_completed_tasks += completed_tasks.size();
+				_completed_tasks.push(data.index, to_span(completed_tasks));
+				completed_tasks.clear();
+			}
+
 			{
-				MutexLock lock(_spinning_tasks_mutex);
+				TimedMutexLock lock(_spinning_tasks_mutex, _lock_contended_count, _lock_wait_usec);
 				for (const TaskItem &item : postponed_tasks) {
 					_spinning_tasks.push(item);
 				}
@@ -405,6 +588,82 @@ void ThreadedTaskRunner::thread_func(ThreadData &data) {
 	data.debug_state = STATE_STOPPED;
 }
 
+// Polls priorities of tasks, and removes cancelled ones. Doesn't preserve order.
+void ThreadedTaskRunner::update_priorities(StdVector<TaskItem> &tasks, StdVector<IThreadedTask *> &cancelled_tasks) {
+	for (unsigned int i = 0; i < tasks.size();) {
+		TaskItem &item = tasks[i];
+
+		if (item.task->is_cancelled()) {
+			cancelled_tasks.push_back(item.task);
+			item = tasks.back();
+			tasks.pop_back();
+			continue;
+		}
+
+		item.cached_priority = item.task->get_priority();
+		++i;
+	}
+}
+
+// Chooses where the next parallel task is taken from. Must be called while holding `_tasks_mutex`.
+StdVector<ThreadedTaskRunner::TaskItem> *ThreadedTaskRunner::pick_parallel_heap() {
+	if (_grouped_task_count == 0) {
+		return _tasks.size() != 0 ? &_tasks : nullptr;
+	}
+
+	struct L {
+		static void keep_best(StdVector<TaskItem> *&best, StdVector<TaskItem> &heap) {
+			if (best == nullptr || best->front().cached_priority < heap.front().cached_priority) {
+				best = &heap;
+			}
+		}
+	};
+
+	// Groups below their minimum amount of threads come first
+	StdVector<TaskItem> *best = nullptr;
+	uint32_t total_weight = 0;
+	for (uint32_t group_index = 0; group_index < _used_group_count; ++group_index) {
+		Group &group = _groups[group_index];
+		const uint32_t running_count = group.running_count;
+		if (group.tasks.size() == 0) {
+			if (running_count > 0) {
+				total_weight += group.settings.weight;
+			}
+			continue;
+		}
+		total_weight += group.settings.weight;
+		if (running_count < group.settings.min_threads &&
+			(group.settings.max_running == 0 || running_count < group.settings.max_running)) {
+			L::keep_best(best, group.tasks);
+		}
+	}
+	if (best != nullptr) {
+		return best;
+	}
+
+	// Then tasks without group and groups below their share of threads, by priority. Once every group got its share,
+	// remaining threads still pick tasks by priority rather than staying idle.
+	const uint32_t thread_limit = _thread_limit;
+	if (_tasks.size() != 0) {
+		best = &_tasks;
+	}
+	StdVector<TaskItem> *best_over_share = nullptr;
+	for (uint32_t group_index = 0; group_index < _used_group_count; ++group_index) {
+		Group &group = _groups[group_index];
+		const uint32_t running_count = group.running_count;
+		if (group.tasks.size() == 0 ||
+			(group.settings.max_running != 0 && running_count >= group.settings.max_running)) {
+			continue;
+		}
+		if (running_count * total_weight < group.settings.weight * thread_limit) {
+			L::keep_best(best, group.tasks);
+		} else {
+			L::keep_best(best_over_share, group.tasks);
+		}
+	}
+	return best != nullptr ? best : best_over_share;
+}
+
 void ThreadedTaskRunner::wait_for_all_tasks() {
 	const uint32_t suspicious_delay_msec = 10'000;
 
@@ -422,7 +681,7 @@ void ThreadedTaskRunner::wait_for_all_tasks() {
 		}
 		if (!any_staged_tasks) {
 			MutexLock lock(_tasks_mutex);
-			if (_tasks.size() == 0) {
+			if (_tasks.size() == 0 && _serial_tasks.size() == 0 && _grouped_task_count == 0) {
 				MutexLock lock2(_spinning_tasks_mutex);
 				if (_spinning_tasks.size() == 0) {
 					break;
@@ -475,12 +734,18 @@ const char *ThreadedTaskRunner::get_thread_debug_task_name(unsigned int thread_i
 }
 
 unsigned int ThreadedTaskRunner::get_debug_remaining_tasks() const {
-	return _debug_received_tasks - _debug_completed_tasks - _debug_taken_out_tasks;
+	return _debug_received_tasks + _debug_immediate_tasks - _debug_completed_tasks - _debug_taken_out_tasks;
+}
+
+const TaskLatencyStats &ThreadedTaskRunner::get_latency_stats(unsigned int category) const {
+	return _latency_stats[category];
 }
 
-StdVector<IThreadedTask *> &ThreadedTaskRunner::get_completed_tasks_temp_tls() {
-	static thread_local StdVector<IThreadedTask *> tls_temp;
-	return tls_temp;
+ThreadedTaskRunner::LockStats ThreadedTaskRunner::get_lock_stats() const {
+	LockStats stats;
+	stats.contended_count = _lock_contended_count;
+	stats.wait_usec = _lock_wait_usec;
+	return stats;
 }
 
 } // namespace zylann
@@ -3,6 +3,7 @@
 
 #include "../containers/container_funcs.h"
 #include "../containers/fixed_array.h"
+#include "../containers/mpsc_batch_queue.h"
 #include "../containers/span.h"
 #include "../containers/std_queue.h"
 #include "../containers/std_vector.h"
@@ -11,6 +12,7 @@
 #include "../thread/mutex.h"
 #include "../thread/semaphore.h"
 #include "../thread/thread.h"
+#include "latency_histogram.h"
 #include "threaded_task.h"
 
 // For debugging
@@ -28,12 +30,15 @@ namespace zylann {
 class ThreadedTaskRunner {
 public:
 	static const uint32_t MAX_THREADS = 16;
+	static const uint32_t MAX_LATENCY_CATEGORIES = 8;
+	static const uint32_t MAX_GROUPS = 64;
 
 	enum State { //
 		STATE_RUNNING = 0,
 		STATE_PICKING,
 		STATE_WAITING,
-		STATE_STOPPED
+		STATE_STOPPED,
+		STATE_PARKED
 	};
 
 	ThreadedTaskRunner();
@@ -43,6 +48,12 @@ public:
 	// Must be called before configuring thread count.
 	void set_name(const char *name);
 
+	// Restricts threads to run on specific CPUs. Each group is a list of CPU indices, and threads are assigned to
+	// groups in turn. For example, with one group per NUMA node, threads stay on the same node, and so does the memory
+	// they allocate on most platforms. Empty groups are ignored, and no groups means no restriction.
+	// Must be called before configuring thread count.
+	void set_cpu_affinity_groups(Span<const StdVector<uint32_t>> groups);
+
 	// TODO Add ability to change it while running without skipping tasks
 	// Can't be changed after tasks have been queued
 	void set_thread_count(uint32_t count);
@@ -50,12 +61,49 @@ public:
 		return _thread_count;
 	}
 
+	// Limits how many threads can pick up tasks, without destroying the others. Threads above the limit are parked
+	// after finishing their current tasks, and resume when the limit goes up again. This can be changed at any time,
+	// from any thread. It is reset to the thread count when the thread count is set.
+	void set_thread_limit(uint32_t count);
+	uint32_t get_thread_limit() const {
+		return _thread_limit;
+	}
+
+	struct GroupSettings {
+		// Groups having tasks share threads in proportion to their weight
+		uint32_t weight = 1;
+		// How many threads the group can use before any other group, when it has tasks
+		uint32_t min_threads = 0;
+		// How many tasks of the group can run at once. 0 means no limit.
+		uint32_t max_running = 0;
+	};
+
+	struct GroupStats {
+		// Tasks waiting in the queue. Doesn't include tasks that were just scheduled.
+		uint32_t pending = 0;
+		uint32_t running = 0;
+		uint64_t completed = 0;
+	};
+
+	// Sets how tasks returning the given group are scheduled relatively to other groups. Only affects parallel tasks.
+	// Can be called from any thread.
+	void set_group_settings(uint32_t group, GroupSettings settings);
+	GroupSettings get_group_settings(uint32_t group) const;
+	// Restores default settings and clears stats, for when the group gets re-used for something else
+	void reset_group(uint32_t group);
+	GroupStats get_group_stats(uint32_t group) const;
+
 	// TODO Add ability to change it while running
 	// Task priorities can change over time, but computing them too often with many tasks can be expensive,
 	// so they are cached. This sets how often task priorities will be polled.
 	// Can't be changed after tasks have been queued.
 	void set_priority_update_period(uint32_t milliseconds);
 
+	// Makes the next thread picking up a task update priorities, without waiting for the end of the period.
+	// Useful when something affecting priorities changed a lot, like a viewer moving fast. Can be called from any
+	// thread.
+	void request_priority_update();
+
 	// TODO Expect tasks to be unique ptrs?
 
 	// Schedules a task.
@@ -68,25 +116,17 @@ public:
 	// Schedules multiple tasks at once. Involves less internal locking.
 	void enqueue(Span<IThreadedTask *> new_tasks, bool serial);
 
+	// Calls `f` on every task completed since the last call. Must always be called from the same thread (usually the
+	// main thread). Never waits for worker threads.
 	template <typename F>
 	void dequeue_completed_tasks(F f) {
 		ZN_PROFILE_SCOPE();
-		StdVector<IThreadedTask *> &temp = get_completed_tasks_temp_tls();
-		ZN_ASSERT(temp.size() == 0);
-		{
-			MutexLock lock(_completed_tasks_mutex);
-			append_array(temp, _completed_tasks);
-			_completed_tasks.clear();
-			// std::move doesn't guarantee preservation of vector capacity
-			// temp = std::move(_completed_tasks);
-		}
-		for (IThreadedTask *task : temp) {
+		_completed_tasks.consume([&](IThreadedTask *task) {
 #ifdef ZN_THREADED_TASK_RUNNER_CHECK_DUPLICATE_TASKS
 			debug_remove_owned_task(task);
 #endif
 			f(task);
-		}
-		temp.clear();
+		});
 	}
 
 	// Blocks and wait for all tasks to finish (assuming no more are getting added!)
@@ -96,13 +136,34 @@ public:
 	const char *get_thread_debug_task_name(unsigned int thread_index) const;
 	unsigned int get_debug_remaining_tasks() const;
 
-private:
-	static StdVector<IThreadedTask *> &get_completed_tasks_temp_tls();
+	// Gets how long tasks reporting the given latency category waited before running, and how long they ran.
+	// Can be read from any thread.
+	const TaskLatencyStats &get_latency_stats(unsigned int category) const;
+
+	struct LockStats {
+		// How many times a thread found a queue mutex already locked
+		uint64_t contended_count = 0;
+		// Time spent waiting for queue mutexes in these cases
+		uint64_t wait_usec = 0;
+	};
+
+	// Gets how much threads waited for each other to access task queues, since the runner was created. Waits are only
+	// timed when a mutex is already locked, so measuring them costs nothing without contention. Can be read from any
+	// thread.
+	LockStats get_lock_stats() const;
 
+private:
 	struct TaskItem {
 		IThreadedTask *task = nullptr;
 		TaskPriority cached_priority;
+		uint64_t enqueue_time_usec = 0;
 		bool is_serial = false;
+		// Group of the task, or -1
+		int8_t group = -1;
+		// Set while the task counts as running in its group
+		bool running_in_group = false;
+		// Set when the task runs for the first time, so postponed tasks only count their wait once
+		bool started = false;
 		ThreadedTaskContext::Status status = ThreadedTaskContext::STATUS_COMPLETE;
 	};
 
@@ -114,6 +175,8 @@ private:
 		bool waiting = false;
 		State debug_state = STATE_STOPPED;
 		StdString name;
+		// CPUs the thread is allowed to run on. Empty means any.
+		StdVector<uint32_t> cpu_affinity;
 		std::atomic<const char *> debug_running_task_name = { nullptr };
 
 		void wait_to_finish_and_reset() {
@@ -130,6 +193,9 @@ private:
 	static void thread_func_static(void *p_data);
 	void thread_func(ThreadData &data);
 
+	void update_priorities(StdVector<TaskItem> &tasks, StdVector<IThreadedTask *> &cancelled_tasks);
+	StdVector<TaskItem> *pick_parallel_heap();
+
 	void create_thread(ThreadData &d, uint32_t i);
 	void destroy_all_threads();
 
@@ -140,38 +206,68 @@ private:
 
 	FixedArray<ThreadData, MAX_THREADS> _threads;
 	uint32_t _thread_count = 0;
+	std::atomic_uint32_t _thread_limit = { 0 };
 
-	// Scheduled tasks are put here first. They will be moved to the main waiting queue by the next available thread.
-	// This is because the main waiting queue can be locked for longer due to dynamic priority sorting.
+	// Scheduled tasks are put here first. They will be moved to the main waiting queues by the next available thread,
+	// which also computes their initial priority outside of any lock.
+	// This is because the main waiting queues can be locked for longer due to dynamic priority updates.
 	StdVector<TaskItem> _staged_tasks;
 	Mutex _staged_tasks_mutex;
 
-	// Main waiting list. Tasks are picked from it by priority. Priority can also change while tasks are in this list,
-	// so we can't use a simple queue or sort at insertion. Every available thread has to find it and potentially update
-	// it every once in a while.
+	// Main waiting lists, as binary heaps where the task with highest cached priority comes first. Priority can also
+	// change while tasks are in these lists, so every once in a while, an available thread polls priorities and
+	// rebuilds the heaps. That only takes linear time, unlike sorting.
+	// Serial tasks have their own heap, so threads can pick the best parallel task while a serial one is running,
+	// without having to search for it.
 	StdVector<TaskItem> _tasks;
-	Mutex _tasks_mutex;
+	StdVector<TaskItem> _serial_tasks;
+	mutable Mutex _tasks_mutex;
+
+	// Parallel tasks having a group wait in the heap of their group instead of `_tasks`, so the best task of a group
+	// can be found quickly when it has to get threads before others.
+	struct Group {
+		// Guarded by `_tasks_mutex`
+		StdVector<TaskItem> tasks;
+		GroupSettings settings;
+		// Can be read without locking, for stats
+		std::atomic_uint32_t pending_count = { 0 };
+		std::atomic_uint32_t running_count = { 0 };
+		std::atomic_uint64_t completed_count = { 0 };
+	};
+	FixedArray<Group, MAX_GROUPS> _groups;
+	// Guarded by `_tasks_mutex`. Total of tasks in group heaps, and how many groups have to be looked at when picking.
+	uint32_t _grouped_task_count = 0;
+	uint32_t _used_group_count = 0;
 	Semaphore _tasks_semaphore;
 
 	// Ongoing tasks that may take more than one iteration
 	StdQueue<TaskItem> _spinning_tasks;
 	Mutex _spinning_tasks_mutex;
 
-	StdVector<IThreadedTask *> _completed_tasks;
-	Mutex _completed_tasks_mutex;
+	// Worker threads push tasks they are done with here without locking, each using its index as producer index
+	MPSCBatchQueue<IThreadedTask *, MAX_THREADS> _completed_tasks;
 
 	uint32_t _priority_update_period_ms = 32;
 	uint64_t _last_priority_update_time_ms = 0;
+	std::atomic_bool _priority_update_requested = { false };
 
 	// This boolean is also guarded with `_tasks_mutex`.
 	// Tasks marked as "serial" must be executed by only one thread at a time.
 	bool _is_serial_task_running = false;
 
 	StdString _name;
+	StdVector<StdVector<uint32_t>> _cpu_affinity_groups;
+
+	FixedArray<TaskLatencyStats, MAX_LATENCY_CATEGORIES> _latency_stats;
+
+	std::atomic_uint64_t _lock_contended_count = { 0 };
+	std::atomic_uint64_t _lock_wait_usec = { 0 };
 
 	unsigned int _debug_received_tasks = 0;
-	unsigned int _debug_completed_tasks = 0;
-	unsigned int _debug_taken_out_tasks = 0;
+	std::atomic_uint32_t _debug_completed_tasks = { 0 };
+	std::atomic_uint32_t _debug_taken_out_tasks = { 0 };
+	// Tasks given through `ThreadedTaskContext::next_immediate_task`
+	std::atomic_uint32_t _debug_immediate_tasks = { 0 };
 
 #ifdef ZN_THREADED_TASK_RUNNER_CHECK_DUPLICATE_TASKS
 	StdUnorderedMap<IThreadedTask *, StdString> _debug_owned_tasks;
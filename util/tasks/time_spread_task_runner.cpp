@@ -1,6 +1,7 @@
 #include "time_spread_task_runner.h"
 #include "../containers/std_vector.h"
 #include "../godot/classes/time.h"
+#include "../math/funcs.h"
 #include "../memory/memory.h"
 #include "../profiling.h"
 
@@ -34,6 +35,8 @@ void TimeSpreadTaskRunner::process(uint64_t time_budget_usec) {
 	}
 
 	const uint64_t time_before = time.get_ticks_usec();
+	uint64_t time_spent = 0;
+	bool first_task = true;
 
 	// Do at least one task
 	do {
@@ -45,6 +48,11 @@ void TimeSpreadTaskRunner::process(uint64_t time_budget_usec) {
 			Queue &queue = _queues[queue_index];
 			MutexLock lock(queue.tasks_mutex);
 			if (queue.tasks.size() != 0) {
+				if (!first_task && time_spent + queue.average_task_cost_usec > time_budget_usec) {
+					// Would likely exceed the budget. Lower priority queues are not considered either, so they don't
+					// get ahead.
+					break;
+				}
 				task = queue.tasks.front();
 				queue.tasks.pop();
 				break;
@@ -55,6 +63,8 @@ void TimeSpreadTaskRunner::process(uint64_t time_budget_usec) {
 			break;
 		}
 
+		const uint64_t task_time_before = time.get_ticks_usec();
+
 		TimeSpreadTaskContext ctx;
 		task->run(ctx);
 
@@ -65,7 +75,14 @@ void TimeSpreadTaskRunner::process(uint64_t time_budget_usec) {
 			ZN_DELETE(task);
 		}
 
-	} while (time.get_ticks_usec() - time_before < time_budget_usec);
+		const uint64_t now = time.get_ticks_usec();
+		Queue &queue = _queues[queue_index];
+		queue.average_task_cost_usec =
+				math::lerp(queue.average_task_cost_usec, static_cast<float>(now - task_time_before), 0.1f);
+		time_spent = now - time_before;
+		first_task = false;
+
+	} while (time_spent < time_budget_usec);
 
 	// Push postponed task back into queues
 	for (unsigned int queue_index = 0; queue_index < tls_postponed_tasks.size(); ++queue_index) {
@@ -37,6 +37,8 @@ public:
 	void push(ITimeSpreadTask *task, Priority priority = PRIORITY_NORMAL);
 	void push(Span<ITimeSpreadTask *> tasks, Priority priority = PRIORITY_NORMAL);
 
+	// Runs tasks until the time budget is spent. At least one task runs if any are pending. A task is not started if
+	// tasks of its queue usually take longer than the remaining time.
 	void process(uint64_t time_budget_usec);
 	void flush();
 	unsigned int get_pending_count() const;
@@ -46,6 +48,8 @@ private:
 		StdQueue<ITimeSpreadTask *> tasks;
 		// TODO Optimization: naive thread safety. Should be enough for now.
 		BinaryMutex tasks_mutex;
+		// Moving average of how long tasks of this queue take to run
+		float average_task_cost_usec = 0.f;
 	};
 	FixedArray<Queue, PRIORITY_COUNT> _queues;
 };
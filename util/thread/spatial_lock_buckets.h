@@ -0,0 +1,377 @@
+#ifndef ZN_SPATIAL_LOCK_BUCKETS_H
+#define ZN_SPATIAL_LOCK_BUCKETS_H
+
+#include "../containers/fixed_array.h"
+#include "../containers/std_vector.h"
+#include "../errors.h"
+#include "../io/log.h"
+#include "../string/format.h"
+#include "short_lock.h"
+#include "thread.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#ifdef TOOLS_ENABLED
+#define ZN_SPATIAL_LOCK_CHECKS
+#endif
+
+namespace zylann {
+
+// Common implementation of `SpatialLock2D` and `SpatialLock3D`.
+//
+// Locked boxes are stored in buckets, by hashing the cells of a coarse grid they cover. Locking or unlocking a box
+// only locks the few buckets it covers, so threads working on different areas rarely contend, and only boxes sharing
+// those buckets have to be checked. Boxes covering too many cells (like "everywhere" boxes) are stored separately, and
+// lock all buckets instead.
+//
+// Threads failing to lock a box sleep until another box gets unlocked, and then retry.
+template <typename TBoxBounds, unsigned int TDimensions>
+class SpatialLockBuckets {
+public:
+	enum Mode { //
+		MODE_READ = 0,
+		MODE_WRITE = 1
+	};
+
+	struct Box {
+		TBoxBounds bounds;
+		Mode mode;
+#ifdef ZN_SPATIAL_LOCK_CHECKS
+		Thread::ID thread_id;
+#endif
+	};
+
+	SpatialLockBuckets() {
+		for (Bucket &bucket : _buckets) {
+			bucket.boxes.reserve(4);
+		}
+	}
+
+	~SpatialLockBuckets() {
+		ZN_ASSERT_RETURN(_locked_boxes_count == 0);
+	}
+
+	inline bool try_lock_read(const TBoxBounds &box) {
+		return try_lock(box, MODE_READ);
+	}
+
+	inline void lock_read(const TBoxBounds &box) {
+		lock(box, MODE_READ);
+	}
+
+	inline void unlock_read(const TBoxBounds &box) {
+		unlock(box, MODE_READ);
+	}
+
+	inline bool try_lock_write(const TBoxBounds &box) {
+		return try_lock(box, MODE_WRITE);
+	}
+
+	inline void lock_write(const TBoxBounds &box) {
+		lock(box, MODE_WRITE);
+	}
+
+	inline void unlock_write(const TBoxBounds &box) {
+		unlock(box, MODE_WRITE);
+	}
+
+	inline int get_locked_boxes_count() const {
+		return _locked_boxes_count;
+	}
+
+	// Scoped helpers
+
+	struct Read {
+		Read(SpatialLockBuckets &p_locker, const TBoxBounds p_box) : locker(p_locker), box(p_box) {
+			locker.lock_read(box);
+		}
+		~Read() {
+			locker.unlock_read(box);
+		}
+		SpatialLockBuckets &locker;
+		const TBoxBounds box;
+	};
+
+	struct Write {
+		Write(SpatialLockBuckets &p_locker, const TBoxBounds p_box) : locker(p_locker), box(p_box) {
+			locker.lock_write(box);
+		}
+		~Write() {
+			locker.unlock_write(box);
+		}
+		SpatialLockBuckets &locker;
+		const TBoxBounds box;
+	};
+
+	struct UnlockWriteOnScopeExit {
+		UnlockWriteOnScopeExit(SpatialLockBuckets &p_locker, const TBoxBounds p_box) : locker(p_locker), box(p_box) {}
+		~UnlockWriteOnScopeExit() {
+			locker.unlock_write(box);
+		}
+		SpatialLockBuckets &locker;
+		const TBoxBounds box;
+	};
+
+	struct UnlockReadOnScopeExit {
+		UnlockReadOnScopeExit(SpatialLockBuckets &p_locker, const TBoxBounds p_box) : locker(p_locker), box(p_box) {}
+		~UnlockReadOnScopeExit() {
+			locker.unlock_read(box);
+		}
+		SpatialLockBuckets &locker;
+		const TBoxBounds box;
+	};
+
+private:
+	// Boxes are usually a few blocks wide
+	static const unsigned int CELL_SIZE_PO2 = 3;
+	static const unsigned int BUCKET_COUNT = 64;
+	static const unsigned int MAX_CELLS_PER_BOX = 8;
+
+	struct Bucket {
+		StdVector<Box> boxes;
+		// Locked for very small periods of time, just to lookup, add or remove boxes.
+		// The long-period locking states are the boxes themselves.
+		ShortLock mutex;
+	};
+
+	struct BucketIndices {
+		FixedArray<uint8_t, MAX_CELLS_PER_BOX> indices;
+		unsigned int count = 0;
+		// If true, the box is too large and goes in `_large_boxes`
+		bool large = false;
+	};
+
+	static void get_bucket_indices(const TBoxBounds &box, BucketIndices &out) {
+		int cell_min[TDimensions];
+		int cell_max[TDimensions];
+		int64_t cell_count = 1;
+		for (unsigned int i = 0; i < TDimensions; ++i) {
+			// Boxes are considered intersecting when they only touch, so the max position is included
+			cell_min[i] = box.min_pos[i] >> CELL_SIZE_PO2;
+			cell_max[i] = box.max_pos[i] >> CELL_SIZE_PO2;
+			cell_count *= int64_t(cell_max[i]) - int64_t(cell_min[i]) + 1;
+			if (cell_count > MAX_CELLS_PER_BOX) {
+				out.large = true;
+				return;
+			}
+		}
+
+		int cell[TDimensions];
+		for (unsigned int i = 0; i < TDimensions; ++i) {
+			cell[i] = cell_min[i];
+		}
+		for (int64_t n = 0; n < cell_count; ++n) {
+			const uint32_t primes[3] = { 73856093, 19349663, 83492791 };
+			uint32_t h = 0;
+			for (unsigned int i = 0; i < TDimensions; ++i) {
+				h ^= static_cast<uint32_t>(cell[i]) * primes[i];
+			}
+			out.indices[out.count] = h % BUCKET_COUNT;
+			++out.count;
+
+			for (unsigned int i = 0; i < TDimensions; ++i) {
+				++cell[i];
+				if (cell[i] <= cell_max[i]) {
+					break;
+				}
+				cell[i] = cell_min[i];
+			}
+		}
+
+		// Buckets are always locked in the same order, to prevent deadlocks
+		uint8_t *begin = out.indices.data();
+		std::sort(begin, begin + out.count);
+		out.count = std::unique(begin, begin + out.count) - begin;
+	}
+
+	void lock_buckets(const BucketIndices &bi) {
+		if (bi.large) {
+			for (Bucket &bucket : _buckets) {
+				bucket.mutex.lock();
+			}
+		} else {
+			for (unsigned int i = 0; i < bi.count; ++i) {
+				_buckets[bi.indices[i]].mutex.lock();
+			}
+		}
+	}
+
+	void unlock_buckets(const BucketIndices &bi) {
+		if (bi.large) {
+			for (Bucket &bucket : _buckets) {
+				bucket.mutex.unlock();
+			}
+		} else {
+			for (unsigned int i = 0; i < bi.count; ++i) {
+				_buckets[bi.indices[i]].mutex.unlock();
+			}
+		}
+	}
+
+	static bool can_lock(const StdVector<Box> &boxes, const TBoxBounds &box, Mode mode) {
+#ifdef ZN_SPATIAL_LOCK_CHECKS
+		const Thread::ID thread_id = Thread::get_caller_id();
+#endif
+		for (const Box &existing_box : boxes) {
+#ifdef ZN_SPATIAL_LOCK_CHECKS
+			// Each thread can lock only one box at a time, otherwise there can be deadlocks depending on the order of
+			// locks. For example:
+			// - Thread 1 locks A
+			// - Thread 2 locks B
+			// - Thread 1 locks B, but blocks because it is already locked
+			// - Thread 2 locks A, but blocks because it is already locked:
+			//   This is a deadlock.
+			// Note: this is not true if threads only lock for reading, but if we didn't ever write we'd not use locks.
+			// Note: this is also not true if threads use `try_lock` instead!
+			// Note: only boxes sharing buckets with the new one are checked.
+			ZN_ASSERT_RETURN_V_MSG(
+					existing_box.thread_id != thread_id, false, "Locking two areas from the same thread is not allowed"
+			);
+#endif
+			if (existing_box.bounds.intersects(box) && (mode == MODE_WRITE || existing_box.mode == MODE_WRITE)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool remove_box(StdVector<Box> &boxes, const TBoxBounds &box, Mode mode) {
+#ifdef ZN_SPATIAL_LOCK_CHECKS
+		const Thread::ID thread_id = Thread::get_caller_id();
+#endif
+		for (unsigned int i = 0; i < boxes.size(); ++i) {
+			const Box &existing_box = boxes[i];
+			if (existing_box.bounds == box && existing_box.mode == mode
+#ifdef ZN_SPATIAL_LOCK_CHECKS
+				&& existing_box.thread_id == thread_id
+#endif
+			) {
+				boxes[i] = boxes.back();
+				boxes.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool try_lock(const TBoxBounds &box, Mode mode) {
+		BucketIndices bi;
+		get_bucket_indices(box, bi);
+
+		lock_buckets(bi);
+
+		// Large boxes can only change while all buckets are locked, so holding any of them is enough to read them
+		bool ok = can_lock(_large_boxes, box, mode);
+		if (bi.large) {
+			for (unsigned int i = 0; i < BUCKET_COUNT && ok; ++i) {
+				ok = can_lock(_buckets[i].boxes, box, mode);
+			}
+		} else {
+			for (unsigned int i = 0; i < bi.count && ok; ++i) {
+				ok = can_lock(_buckets[bi.indices[i]].boxes, box, mode);
+			}
+		}
+
+		if (ok) {
+			const Box new_box{ box, mode,
+#ifdef ZN_SPATIAL_LOCK_CHECKS
+				Thread::get_caller_id()
+#endif
+			};
+			if (bi.large) {
+				_large_boxes.push_back(new_box);
+			} else {
+				for (unsigned int i = 0; i < bi.count; ++i) {
+					_buckets[bi.indices[i]].boxes.push_back(new_box);
+				}
+			}
+			++_locked_boxes_count;
+		}
+
+		unlock_buckets(bi);
+		return ok;
+	}
+
+	void lock(const TBoxBounds &box, Mode mode) {
+		if (try_lock(box, mode)) {
+			return;
+		}
+
+		_waiting_threads_count.fetch_add(1);
+		// Pairs with the fence in `unlock`, so either we see the box was unlocked, or the unlocking thread sees us
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		std::unique_lock<std::mutex> wait_lock(_wait_mutex);
+		while (true) {
+			const uint32_t generation = _unlock_generation;
+			wait_lock.unlock();
+
+			if (try_lock(box, mode)) {
+				break;
+			}
+
+			wait_lock.lock();
+			// Sleep until another box gets unlocked
+			while (generation == _unlock_generation) {
+				_wait_condition.wait(wait_lock);
+			}
+		}
+
+		_waiting_threads_count.fetch_sub(1);
+	}
+
+	void unlock(const TBoxBounds &box, Mode mode) {
+		BucketIndices bi;
+		get_bucket_indices(box, bi);
+
+		lock_buckets(bi);
+
+		bool found = true;
+		if (bi.large) {
+			found = remove_box(_large_boxes, box, mode);
+		} else {
+			for (unsigned int i = 0; i < bi.count; ++i) {
+				found &= remove_box(_buckets[bi.indices[i]].boxes, box, mode);
+			}
+		}
+		if (found) {
+			--_locked_boxes_count;
+		}
+
+		unlock_buckets(bi);
+
+		if (!found) {
+			// Could be a bug
+			ZN_PRINT_ERROR(format("Could not find box to remove {} with mode {}", box, mode));
+			return;
+		}
+
+		// Tell eventual waiting threads that they might be able to lock their box now.
+		// No need to wake anyone when nobody waits, which is the common case.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_waiting_threads_count.load() > 0) {
+			{
+				std::lock_guard<std::mutex> lock(_wait_mutex);
+				++_unlock_generation;
+			}
+			_wait_condition.notify_all();
+		}
+	}
+
+	FixedArray<Bucket, BUCKET_COUNT> _buckets;
+	// Boxes covering too many cells. Can only be modified while all buckets are locked.
+	StdVector<Box> _large_boxes;
+	std::atomic_int _locked_boxes_count = { 0 };
+
+	std::atomic_uint32_t _waiting_threads_count = { 0 };
+	// Incremented everytime a box is unlocked while threads are waiting
+	uint32_t _unlock_generation = 0;
+	std::mutex _wait_mutex;
+	std::condition_variable _wait_condition;
+};
+
+} // namespace zylann
+
+#endif // ZN_SPATIAL_LOCK_BUCKETS_H
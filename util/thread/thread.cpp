@@ -12,6 +12,22 @@
 
 #include <thread>
 
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define ZN_THREAD_AFFINITY_WINDOWS
+
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#define ZN_THREAD_AFFINITY_LINUX
+#endif
+
 namespace zylann {
 
 #if defined(ZN_GODOT)
@@ -113,4 +129,40 @@ Thread::ID Thread::get_caller_id() {
 	return caller_id;
 }
 
+bool Thread::set_cpu_affinity(Span<const uint32_t> cpu_indices) {
+	if (cpu_indices.size() == 0) {
+		return false;
+	}
+
+#if defined(ZN_THREAD_AFFINITY_LINUX)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	for (const uint32_t cpu_index : cpu_indices) {
+		if (cpu_index < CPU_SETSIZE) {
+			CPU_SET(cpu_index, &cpus);
+		}
+	}
+	if (CPU_COUNT(&cpus) == 0) {
+		return false;
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+
+#elif defined(ZN_THREAD_AFFINITY_WINDOWS)
+	// Only CPUs of the processor group the thread is in can be targeted this way
+	DWORD_PTR mask = 0;
+	for (const uint32_t cpu_index : cpu_indices) {
+		if (cpu_index < sizeof(DWORD_PTR) * 8) {
+			mask |= DWORD_PTR(1) << cpu_index;
+		}
+	}
+	if (mask == 0) {
+		return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+
+#else
+	return false;
+#endif
+}
+
 } // namespace zylann
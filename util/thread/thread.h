@@ -1,6 +1,7 @@
 #ifndef ZN_THREAD_H
 #define ZN_THREAD_H
 
+#include "../containers/span.h"
 #include <cstdint>
 
 namespace zylann {
@@ -36,6 +37,10 @@ public:
 	// Get ID of the current thread
 	static ID get_caller_id();
 
+	// Restricts the current thread to run on the given CPUs. Indices that don't exist are ignored.
+	// Returns false if it failed or isn't supported on the platform. On Windows, only the first 64 CPUs can be used.
+	static bool set_cpu_affinity(Span<const uint32_t> cpu_indices);
+
 private:
 	ThreadImpl *_impl = nullptr;
 };